@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/allocator.hpp"
+
+#include <cstdint>
+
+#include "bench_utils.hpp"
+
+using namespace h2;
+
+namespace
+{
+
+// Latency of an allocation followed by its deallocation. Repeated
+// sizes are served from the caching allocators after the first
+// iteration.
+template <Device Dev, MemoryKind Kind>
+void BM_alloc_free(benchmark::State& state)
+{
+  std::size_t const size = state.range(0);
+  ComputeStream const stream{Dev};
+  for (auto _ : state)
+  {
+    float* buf = internal::allocate<float, Dev>(size, stream, Kind);
+    benchmark::DoNotOptimize(buf);
+    internal::deallocate<float, Dev>(buf, size, stream, Kind);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Latency of allocating a batch of buffers of distinct sizes and then
+// freeing them, as a workload with many live allocations would.
+template <Device Dev>
+void BM_alloc_free_batch(benchmark::State& state)
+{
+  constexpr std::size_t batch = 64;
+  std::size_t const size = state.range(0);
+  ComputeStream const stream{Dev};
+  float* bufs[batch];
+  for (auto _ : state)
+  {
+    for (std::size_t i = 0; i < batch; ++i)
+    {
+      bufs[i] =
+        internal::allocate<float, Dev>(size + i, stream, MemoryKind::Default);
+    }
+    benchmark::DoNotOptimize(bufs);
+    for (std::size_t i = 0; i < batch; ++i)
+    {
+      internal::deallocate<float, Dev>(
+        bufs[i], size + i, stream, MemoryKind::Default);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * batch);
+}
+
+void alloc_args(benchmark::internal::Benchmark* b)
+{
+  b->RangeMultiplier(64)->Range(1, std::int64_t{1} << 24);
+}
+
+}  // namespace
+
+BENCHMARK(BM_alloc_free<Device::CPU, MemoryKind::Default>)->Apply(alloc_args);
+BENCHMARK(BM_alloc_free_batch<Device::CPU>)->Apply(alloc_args);
+
+#ifdef H2_HAS_GPU
+BENCHMARK(BM_alloc_free<Device::CPU, MemoryKind::Pinned>)->Apply(alloc_args);
+BENCHMARK(BM_alloc_free<Device::GPU, MemoryKind::Default>)->Apply(alloc_args);
+BENCHMARK(BM_alloc_free<Device::GPU, MemoryKind::Managed>)->Apply(alloc_args);
+BENCHMARK(BM_alloc_free_batch<Device::GPU>)->Apply(alloc_args);
+#endif
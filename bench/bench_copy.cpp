@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/allocator.hpp"
+#include "h2/tensor/copy.hpp"
+#include "h2/tensor/copy_buffer.hpp"
+#include "h2/tensor/init/fill.hpp"
+#include "h2/tensor/tensor.hpp"
+
+#include <cstdint>
+
+#include "bench_utils.hpp"
+
+using namespace h2;
+
+namespace
+{
+
+// Copy between buffers on SrcDev and DstDev, with host buffers pinned
+// when the copy involves a GPU.
+template <Device SrcDev, Device DstDev>
+void BM_copy_buffer(benchmark::State& state)
+{
+  std::size_t const size = state.range(0);
+  ComputeStream const src_stream{SrcDev};
+  ComputeStream const dst_stream{DstDev};
+  constexpr MemoryKind host_kind =
+    (SrcDev == Device::CPU && DstDev == Device::CPU) ? MemoryKind::Default
+                                                     : MemoryKind::Pinned;
+  internal::ManagedBuffer<float> src{
+    size,
+    SrcDev,
+    src_stream,
+    (SrcDev == Device::CPU) ? host_kind : MemoryKind::Default};
+  internal::ManagedBuffer<float> dst{
+    size,
+    DstDev,
+    dst_stream,
+    (DstDev == Device::CPU) ? host_kind : MemoryKind::Default};
+  zero(src.data(), src_stream, size);
+  for (auto _ : state)
+  {
+    copy_buffer(dst.data(), dst_stream, src.const_data(), src_stream, size);
+    bench::finish(src_stream);
+    bench::finish(dst_stream);
+  }
+  bench::set_throughput(state, size * sizeof(float), size);
+}
+
+// Type conversion of a tensor into an existing tensor.
+template <typename DstT, typename SrcT, Device Dev>
+void BM_cast(benchmark::State& state)
+{
+  std::size_t const size = state.range(0);
+  Tensor<SrcT> src{
+    Dev, {static_cast<DimType>(size)}, {DimensionType::Any}};
+  Tensor<DstT> dst{
+    Dev, {static_cast<DimType>(size)}, {DimensionType::Any}};
+  fill(src, static_cast<SrcT>(1));
+  for (auto _ : state)
+  {
+    copy(dst, src);
+    bench::finish(dst.get_stream());
+  }
+  bench::set_throughput(state, size * (sizeof(SrcT) + sizeof(DstT)), size);
+}
+
+template <typename T, Device Dev>
+void BM_fill(benchmark::State& state)
+{
+  std::size_t const size = state.range(0);
+  Tensor<T> tensor{
+    Dev, {static_cast<DimType>(size)}, {DimensionType::Any}};
+  for (auto _ : state)
+  {
+    fill(tensor, static_cast<T>(42));
+    bench::finish(tensor.get_stream());
+  }
+  bench::set_throughput(state, size * sizeof(T), size);
+}
+
+template <typename T, Device Dev>
+void BM_zero(benchmark::State& state)
+{
+  std::size_t const size = state.range(0);
+  Tensor<T> tensor{
+    Dev, {static_cast<DimType>(size)}, {DimensionType::Any}};
+  for (auto _ : state)
+  {
+    zero(tensor);
+    bench::finish(tensor.get_stream());
+  }
+  bench::set_throughput(state, size * sizeof(T), size);
+}
+
+}  // namespace
+
+#define H2_BENCH_DEVICE(Dev)                                                   \
+  BENCHMARK(BM_cast<float, double, Dev>)->Apply(bench::size_args);             \
+  BENCHMARK(BM_cast<double, float, Dev>)->Apply(bench::size_args);             \
+  BENCHMARK(BM_cast<float, std::int32_t, Dev>)->Apply(bench::size_args);       \
+  BENCHMARK(BM_fill<float, Dev>)->Apply(bench::size_args);                     \
+  BENCHMARK(BM_fill<double, Dev>)->Apply(bench::size_args);                    \
+  BENCHMARK(BM_zero<float, Dev>)->Apply(bench::size_args);                     \
+  BENCHMARK(BM_zero<double, Dev>)->Apply(bench::size_args)
+
+BENCHMARK(BM_copy_buffer<Device::CPU, Device::CPU>)->Apply(bench::size_args);
+H2_BENCH_DEVICE(Device::CPU);
+
+#ifdef H2_HAS_GPU
+BENCHMARK(BM_copy_buffer<Device::CPU, Device::GPU>)->Apply(bench::size_args);
+BENCHMARK(BM_copy_buffer<Device::GPU, Device::CPU>)->Apply(bench::size_args);
+BENCHMARK(BM_copy_buffer<Device::GPU, Device::GPU>)->Apply(bench::size_args);
+H2_BENCH_DEVICE(Device::GPU);
+#endif
+
+#undef H2_BENCH_DEVICE
@@ -0,0 +1,126 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/dispatch.hpp"
+#include "h2/core/types.hpp"
+
+#include <array>
+#include <string>
+
+#include "bench_utils.hpp"
+
+using namespace h2;
+
+namespace
+{
+
+void dispatch_bench_func(int& v)
+{
+  benchmark::DoNotOptimize(++v);
+}
+
+// Native entries for float only; other types fall back to registered
+// dispatch.
+std::array<internal::DispatchFunctionEntry, NumComputeTypes> const&
+get_dispatch_table()
+{
+  static std::array<internal::DispatchFunctionEntry, NumComputeTypes> table =
+    [] {
+      std::array<internal::DispatchFunctionEntry, NumComputeTypes> t{};
+      t[internal::get_native_dispatch_key(get_h2_type<float>())] = {
+        reinterpret_cast<void*>(&dispatch_bench_func),
+        &internal::DispatchFunctionWrapper<void, int&>::call};
+      return t;
+    }();
+  return table;
+}
+
+constexpr char const* dispatch_bench_name = "dispatch_bench";
+
+// Registers dispatch_bench_func for double for the lifetime of the
+// object.
+struct RegisterDispatchBench
+{
+  RegisterDispatchBench()
+  {
+    dispatch_register(dispatch_bench_name,
+                      get_dispatch_key(get_h2_type<double>()),
+                      &dispatch_bench_func);
+  }
+  ~RegisterDispatchBench()
+  {
+    dispatch_unregister(dispatch_bench_name,
+                        get_dispatch_key(get_h2_type<double>()));
+  }
+};
+
+// Baseline: calling the function directly.
+void BM_dispatch_direct(benchmark::State& state)
+{
+  int v = 0;
+  for (auto _ : state)
+  {
+    dispatch_bench_func(v);
+  }
+}
+
+// Static dispatch on the device.
+void BM_dispatch_static_device(benchmark::State& state)
+{
+  float v = 0;
+  for (auto _ : state)
+  {
+    dispatch_test(Device::CPU, &v);
+    benchmark::DoNotOptimize(v);
+  }
+}
+
+// Dynamic dispatch on a native compute type.
+void BM_dispatch_native(benchmark::State& state)
+{
+  internal::DispatchSite site{dispatch_bench_name};
+  TypeInfo const type = get_h2_type<float>();
+  int v = 0;
+  for (auto _ : state)
+  {
+    do_dispatch(get_dispatch_table(), site, DispatchOn<1>(type), v);
+  }
+}
+
+// Dynamic dispatch on a registered entry, cached by a call site.
+void BM_dispatch_registered_site(benchmark::State& state)
+{
+  RegisterDispatchBench const registered;
+  internal::DispatchSite site{dispatch_bench_name};
+  TypeInfo const type = get_h2_type<double>();
+  int v = 0;
+  for (auto _ : state)
+  {
+    do_dispatch(get_dispatch_table(), site, DispatchOn<1>(type), v);
+  }
+}
+
+// Dynamic dispatch on a registered entry, looked up by name.
+void BM_dispatch_registered_name(benchmark::State& state)
+{
+  RegisterDispatchBench const registered;
+  std::string const name{dispatch_bench_name};
+  TypeInfo const type = get_h2_type<double>();
+  int v = 0;
+  for (auto _ : state)
+  {
+    do_dispatch(get_dispatch_table(), name, DispatchOn<1>(type), v);
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_dispatch_direct);
+BENCHMARK(BM_dispatch_static_device);
+BENCHMARK(BM_dispatch_native);
+BENCHMARK(BM_dispatch_registered_site);
+BENCHMARK(BM_dispatch_registered_name);
@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/allocator.hpp"
+#include "h2/loops/gpu_loops.cuh"
+
+#include <cstdint>
+
+#include "bench_utils.hpp"
+
+using namespace h2;
+
+namespace
+{
+
+// Unary loop (out = 2 * in + 1). The second argument offsets the
+// buffers by that many elements, which limits the vector width the
+// loop can use: e.g., for float, offsets 0, 2, and 1 give widths 4, 2,
+// and 1.
+template <typename T>
+void BM_gpu_unary_loop(benchmark::State& state)
+{
+  std::size_t const size = state.range(0);
+  std::size_t const offset = state.range(1);
+  ComputeStream const stream{Device::GPU};
+  internal::ManagedBuffer<T> in{size + offset, Device::GPU, stream};
+  internal::ManagedBuffer<T> out{size + offset, Device::GPU, stream};
+  gpu::launch_elementwise_loop(
+    [] H2_GPU_LAMBDA() -> T { return T{1}; }, stream, size + offset, in.data());
+  for (auto _ : state)
+  {
+    gpu::launch_elementwise_loop(
+      [] H2_GPU_LAMBDA(T x) -> T { return static_cast<T>(T{2} * x + T{1}); },
+      stream,
+      size,
+      out.data() + offset,
+      static_cast<T const*>(in.data() + offset));
+    bench::finish(stream);
+  }
+  bench::set_throughput(state, 2 * size * sizeof(T), size);
+}
+
+// Binary loop (out = a + b).
+template <typename T>
+void BM_gpu_binary_loop(benchmark::State& state)
+{
+  std::size_t const size = state.range(0);
+  ComputeStream const stream{Device::GPU};
+  internal::ManagedBuffer<T> a{size, Device::GPU, stream};
+  internal::ManagedBuffer<T> b{size, Device::GPU, stream};
+  internal::ManagedBuffer<T> out{size, Device::GPU, stream};
+  gpu::launch_elementwise_loop(
+    [] H2_GPU_LAMBDA() -> T { return T{1}; }, stream, size, a.data());
+  gpu::launch_elementwise_loop(
+    [] H2_GPU_LAMBDA() -> T { return T{2}; }, stream, size, b.data());
+  for (auto _ : state)
+  {
+    gpu::launch_elementwise_loop(
+      [] H2_GPU_LAMBDA(T x, T y) -> T { return static_cast<T>(x + y); },
+      stream,
+      size,
+      out.data(),
+      static_cast<T const*>(a.data()),
+      static_cast<T const*>(b.data()));
+    bench::finish(stream);
+  }
+  bench::set_throughput(state, 3 * size * sizeof(T), size);
+}
+
+// Unary loop with an immediate (out = scale * in).
+template <typename T>
+void BM_gpu_immediate_loop(benchmark::State& state)
+{
+  std::size_t const size = state.range(0);
+  ComputeStream const stream{Device::GPU};
+  internal::ManagedBuffer<T> in{size, Device::GPU, stream};
+  internal::ManagedBuffer<T> out{size, Device::GPU, stream};
+  gpu::launch_elementwise_loop(
+    [] H2_GPU_LAMBDA() -> T { return T{1}; }, stream, size, in.data());
+  for (auto _ : state)
+  {
+    gpu::launch_elementwise_loop_with_immediate(
+      [] H2_GPU_LAMBDA(T scale, T x) -> T {
+        return static_cast<T>(scale * x);
+      },
+      stream,
+      size,
+      T{3},
+      out.data(),
+      static_cast<T const*>(in.data()));
+    bench::finish(stream);
+  }
+  bench::set_throughput(state, 2 * size * sizeof(T), size);
+}
+
+void unary_args(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"size", "offset"});
+  for (std::int64_t size = bench::min_size; size <= bench::max_size;
+       size *= 16)
+  {
+    for (std::int64_t offset : {0, 1, 2})
+    {
+      b->Args({size, offset});
+    }
+  }
+}
+
+}  // namespace
+
+#define H2_BENCH_GPU_LOOPS(T)                                                  \
+  BENCHMARK(BM_gpu_unary_loop<T>)->Apply(unary_args)->UseRealTime();           \
+  BENCHMARK(BM_gpu_binary_loop<T>)->Apply(bench::size_args)->UseRealTime();    \
+  BENCHMARK(BM_gpu_immediate_loop<T>)->Apply(bench::size_args)->UseRealTime()
+
+H2_BENCH_GPU_LOOPS(float);
+H2_BENCH_GPU_LOOPS(double);
+H2_BENCH_GPU_LOOPS(std::int32_t);
+
+#undef H2_BENCH_GPU_LOOPS
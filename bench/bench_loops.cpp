@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/allocator.hpp"
+#include "h2/loops/cpu_loops.hpp"
+
+#include <cstdint>
+
+#include "bench_utils.hpp"
+
+using namespace h2;
+
+namespace
+{
+
+enum class CPULoop
+{
+  Serial,
+  Vectorized,
+  Parallel
+};
+
+template <CPULoop Loop, typename FuncT, typename... Args>
+void run_cpu_loop(FuncT&& func, std::size_t size, Args... args)
+{
+  if constexpr (Loop == CPULoop::Serial)
+  {
+    cpu::elementwise_loop(func, size, args...);
+  }
+  else if constexpr (Loop == CPULoop::Vectorized)
+  {
+    cpu::vectorized_elementwise_loop(func, size, args...);
+  }
+  else
+  {
+    cpu::parallel_elementwise_loop(func, size, args...);
+  }
+}
+
+// Unary loop (out = 2 * in + 1). The second argument offsets the
+// buffers by that many elements, so that vectorized loops must peel
+// elements to reach alignment.
+template <typename T, CPULoop Loop>
+void BM_cpu_unary_loop(benchmark::State& state)
+{
+  std::size_t const size = state.range(0);
+  std::size_t const offset = state.range(1);
+  internal::ManagedBuffer<T> in{size + offset, Device::CPU};
+  internal::ManagedBuffer<T> out{size + offset, Device::CPU};
+  run_cpu_loop<Loop>([]() { return T{1}; }, size + offset, in.data());
+  for (auto _ : state)
+  {
+    run_cpu_loop<Loop>([](T x) { return static_cast<T>(T{2} * x + T{1}); },
+                       size,
+                       out.data() + offset,
+                       static_cast<T const*>(in.data() + offset));
+    benchmark::ClobberMemory();
+  }
+  bench::set_throughput(state, 2 * size * sizeof(T), size);
+}
+
+// Binary loop (out = a + b).
+template <typename T, CPULoop Loop>
+void BM_cpu_binary_loop(benchmark::State& state)
+{
+  std::size_t const size = state.range(0);
+  internal::ManagedBuffer<T> a{size, Device::CPU};
+  internal::ManagedBuffer<T> b{size, Device::CPU};
+  internal::ManagedBuffer<T> out{size, Device::CPU};
+  run_cpu_loop<Loop>([]() { return T{1}; }, size, a.data());
+  run_cpu_loop<Loop>([]() { return T{2}; }, size, b.data());
+  for (auto _ : state)
+  {
+    run_cpu_loop<Loop>([](T x, T y) { return static_cast<T>(x + y); },
+                       size,
+                       out.data(),
+                       static_cast<T const*>(a.data()),
+                       static_cast<T const*>(b.data()));
+    benchmark::ClobberMemory();
+  }
+  bench::set_throughput(state, 3 * size * sizeof(T), size);
+}
+
+void unary_args(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"size", "offset"});
+  for (std::int64_t size = bench::min_size; size <= bench::max_size;
+       size *= 16)
+  {
+    b->Args({size, 0});
+    b->Args({size, 1});
+  }
+}
+
+}  // namespace
+
+#define H2_BENCH_CPU_LOOPS(T)                                                  \
+  BENCHMARK(BM_cpu_unary_loop<T, CPULoop::Serial>)->Apply(unary_args);         \
+  BENCHMARK(BM_cpu_unary_loop<T, CPULoop::Vectorized>)->Apply(unary_args);     \
+  BENCHMARK(BM_cpu_unary_loop<T, CPULoop::Parallel>)->Apply(unary_args);       \
+  BENCHMARK(BM_cpu_binary_loop<T, CPULoop::Serial>)->Apply(bench::size_args);  \
+  BENCHMARK(BM_cpu_binary_loop<T, CPULoop::Vectorized>)                        \
+    ->Apply(bench::size_args);                                                 \
+  BENCHMARK(BM_cpu_binary_loop<T, CPULoop::Parallel>)->Apply(bench::size_args)
+
+H2_BENCH_CPU_LOOPS(float);
+H2_BENCH_CPU_LOOPS(double);
+H2_BENCH_CPU_LOOPS(std::int32_t);
+
+#undef H2_BENCH_CPU_LOOPS
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+// Small operations issued concurrently from several host threads. With
+// real time, per-thread throughput should stay flat as threads are
+// added if nothing serializes them.
+
+#include "h2/core/sync.hpp"
+#include "h2/tensor/init/fill.hpp"
+#include "h2/tensor/tensor.hpp"
+
+#include <optional>
+
+#include "bench_utils.hpp"
+
+using namespace h2;
+
+namespace
+{
+
+constexpr int max_bench_threads = 16;
+
+void thread_args(benchmark::internal::Benchmark* b)
+{
+  b->ThreadRange(1, max_bench_threads)->UseRealTime();
+}
+
+// Gives the calling thread a new stream, installed as its default for
+// the lifetime of the object, so threads do not share a GPU stream.
+template <Device Dev>
+class PerThreadStream
+{
+public:
+  PerThreadStream() : stream(create_new_compute_stream<Dev>())
+  {
+#ifdef H2_HAS_GPU
+    if constexpr (Dev == Device::GPU)
+    {
+      guard.emplace(stream);
+    }
+#endif
+  }
+
+  ~PerThreadStream()
+  {
+#ifdef H2_HAS_GPU
+    guard.reset();
+#endif
+    destroy_compute_stream(stream);
+  }
+
+  ComputeStream stream;
+
+private:
+#ifdef H2_HAS_GPU
+  std::optional<ThreadDefaultStreamGuard> guard;
+#endif
+};
+
+// Fill a small tensor (dispatch and one kernel per iteration).
+template <Device Dev>
+void BM_threads_fill(benchmark::State& state)
+{
+  PerThreadStream<Dev> const thread_stream;
+  Tensor<float> tensor{
+    Dev, {static_cast<DimType>(bench::min_size)}, {DimensionType::Any}};
+  for (auto _ : state)
+  {
+    fill(tensor, 42.0f);
+    bench::finish(tensor.get_stream());
+  }
+  bench::set_throughput(state, bench::min_size * sizeof(float), 1);
+}
+
+// Create, fill, and destroy a small tensor (allocation, the object
+// pool, and dispatch).
+template <Device Dev>
+void BM_threads_create_fill(benchmark::State& state)
+{
+  PerThreadStream<Dev> const thread_stream;
+  for (auto _ : state)
+  {
+    Tensor<float> tensor{
+      Dev, {static_cast<DimType>(bench::min_size)}, {DimensionType::Any}};
+    fill(tensor, 42.0f);
+    bench::finish(tensor.get_stream());
+  }
+  bench::set_throughput(state, bench::min_size * sizeof(float), 1);
+}
+
+// Create and destroy views of a tensor (no device work).
+template <Device Dev>
+void BM_threads_view(benchmark::State& state)
+{
+  PerThreadStream<Dev> const thread_stream;
+  Tensor<float> tensor{
+    Dev, {static_cast<DimType>(bench::min_size)}, {DimensionType::Any}};
+  for (auto _ : state)
+  {
+    auto view = tensor.view();
+    benchmark::DoNotOptimize(view->data());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK(BM_threads_fill<Device::CPU>)->Apply(thread_args);
+BENCHMARK(BM_threads_create_fill<Device::CPU>)->Apply(thread_args);
+BENCHMARK(BM_threads_view<Device::CPU>)->Apply(thread_args);
+
+#ifdef H2_HAS_GPU
+BENCHMARK(BM_threads_fill<Device::GPU>)->Apply(thread_args);
+BENCHMARK(BM_threads_create_fill<Device::GPU>)->Apply(thread_args);
+BENCHMARK(BM_threads_view<Device::GPU>)->Apply(thread_args);
+#endif
@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Helpers shared by the H2 microbenchmarks.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+#include "h2/core/sync.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace h2
+{
+namespace bench
+{
+
+/** Smallest and largest element counts of size sweeps. */
+constexpr std::int64_t min_size = std::int64_t{1} << 10;
+constexpr std::int64_t max_size = std::int64_t{1} << 24;
+
+/** Sweep the first argument over sizes in multiples of 16. */
+inline void size_args(benchmark::internal::Benchmark* b)
+{
+  b->RangeMultiplier(16)->Range(min_size, max_size);
+}
+
+/**
+ * Report the throughput of a benchmark that touches `bytes` bytes and
+ * `items` elements per iteration.
+ */
+inline void set_throughput(benchmark::State& state,
+                           std::size_t bytes,
+                           std::size_t items)
+{
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations())
+                          * static_cast<std::int64_t>(bytes));
+  state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations())
+                          * static_cast<std::int64_t>(items));
+}
+
+/**
+ * Wait for outstanding work on `stream` so that asynchronous (GPU)
+ * work is included in the time of the iteration.
+ */
+inline void finish(ComputeStream const& stream)
+{
+  stream.wait_for_this();
+}
+
+}  // namespace bench
+}  // namespace h2
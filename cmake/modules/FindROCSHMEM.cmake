@@ -0,0 +1,67 @@
+################################################################################
+## Copyright 2019-2020 Lawrence Livermore National Security, LLC and other
+## DiHydrogen Project Developers. See the top-level LICENSE file for details.
+##
+## SPDX-License-Identifier: Apache-2.0
+################################################################################
+
+# Defines the following variables:
+#   - ROCSHMEM_FOUND
+#   - ROCSHMEM_LIBRARIES
+#   - ROCSHMEM_INCLUDE_DIRS
+#
+# Also creates an imported target ROCSHMEM::ROCSHMEM
+
+message(STATUS "ROCSHMEM_DIR: ${ROCSHMEM_DIR}")
+
+# Find the header
+find_path(ROCSHMEM_INCLUDE_DIRS rocshmem/rocshmem.hpp
+  HINTS ${ROCSHMEM_DIR} $ENV{ROCSHMEM_DIR}
+  PATH_SUFFIXES include
+  NO_DEFAULT_PATH
+  DOC "Directory with ROC_SHMEM header.")
+find_path(ROCSHMEM_INCLUDE_DIRS rocshmem/rocshmem.hpp)
+
+message(STATUS "ROCSHMEM_INCLUDE_DIRS: ${ROCSHMEM_INCLUDE_DIRS}")
+
+# Find the library
+find_library(ROCSHMEM_LIBRARY rocshmem
+  HINTS ${ROCSHMEM_DIR} $ENV{ROCSHMEM_DIR}
+  PATH_SUFFIXES lib lib64
+  NO_DEFAULT_PATH
+  DOC "The ROC_SHMEM library.")
+find_library(ROCSHMEM_LIBRARY rocshmem)
+
+message(STATUS "ROCSHMEM_LIBRARY: ${ROCSHMEM_LIBRARY}")
+
+# Standard handling of the package arguments
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(ROCSHMEM
+  DEFAULT_MSG
+  ROCSHMEM_LIBRARY ROCSHMEM_INCLUDE_DIRS)
+
+# Setup the imported target
+if (NOT TARGET ROCSHMEM::ROCSHMEM)
+  add_library(ROCSHMEM::ROCSHMEM INTERFACE IMPORTED)
+endif (NOT TARGET ROCSHMEM::ROCSHMEM)
+
+# Set the include directories for the target
+target_include_directories(ROCSHMEM::ROCSHMEM
+  INTERFACE
+  ${ROCSHMEM_INCLUDE_DIRS})
+
+# Set the link libraries for the target
+target_link_libraries(ROCSHMEM::ROCSHMEM
+  INTERFACE
+  ${ROCSHMEM_LIBRARY})
+
+#
+# Cleanup
+#
+
+# Set the include directories
+mark_as_advanced(FORCE ROCSHMEM_INCLUDE_DIRS)
+
+# Set the libraries
+set(ROCSHMEM_LIBRARIES ROCSHMEM::ROCSHMEM)
+mark_as_advanced(FORCE ROCSHMEM_LIBRARY)
@@ -14,24 +14,87 @@
 
 #include <h2_config.hpp>
 
+#include "h2/core/allocator_stats.hpp"
 #include "h2/core/device.hpp"
+#include "h2/core/numa.hpp"
+#include "h2/core/profiling.hpp"
 #include "h2/core/sync.hpp"
 
+#include <chrono>
 #include <cstddef>
 #include <new>
 #include <optional>
+#include <ostream>
+#include <type_traits>
 
 #ifdef H2_HAS_GPU
+#include "h2/core/graph.hpp"
+#include "h2/core/size_class_allocator.hpp"
 #include "h2/gpu/memory_utils.hpp"
 #endif
 
 namespace h2
 {
 
+/**
+ * Kinds of memory that may back an allocation.
+ *
+ * Not every kind is meaningful on every device; see the individual
+ * entries.
+ */
+enum class MemoryKind
+{
+  /** The ordinary memory for the device. */
+  Default,
+  /**
+   * Page-locked host memory (CPU only).
+   *
+   * Copies between this and GPU memory can run asynchronously on a
+   * stream. Allocations are served from a cache, as pinning is slow.
+   * Without GPU support this is the same as `Default`.
+   */
+  Pinned,
+  /**
+   * Managed (unified) memory (GPU only).
+   *
+   * This is accessible from both host and device, with pages migrated
+   * on demand, so allocations may exceed device memory. Use `prefetch`
+   * and `advise` on the buffer to control where pages reside.
+   */
+  Managed
+};
+
+inline std::ostream& operator<<(std::ostream& os, MemoryKind kind)
+{
+  switch (kind)
+  {
+  case MemoryKind::Default: os << "Default"; break;
+  case MemoryKind::Pinned: os << "Pinned"; break;
+  case MemoryKind::Managed: os << "Managed"; break;
+  default: os << "Unknown"; break;
+  }
+  return os;
+}
+
+/**
+ * Placement hints for managed memory.
+ *
+ * Each hint is given with respect to a device (see `RawBuffer::advise`).
+ */
+enum class ManagedAdvice
+{
+  /** Data is mostly read, so pages may be duplicated on readers. */
+  ReadMostly,
+  /** Pages should preferably reside on the device. */
+  PreferredLocation,
+  /** The device will access the data, so keep it mapped there. */
+  AccessedBy
+};
+
 namespace internal
 {
 
-// TODO: Use proper memory pools (probably Hydrogen's).
+// TODO: Use proper memory pools for CPU allocations.
 
 template <typename T, Device Dev>
 struct Allocator
@@ -40,44 +103,233 @@ struct Allocator
   static void deallocate(T* buf, ComputeStream const& stream);
 };
 
+/**
+ * CPU allocations use the backend given by `cpu::allocator_backend()`
+ * (see `numa.hpp`).
+ *
+ * Only types that need no construction or destruction can come from
+ * the NUMA backend; others always use `new[]`.
+ */
 template <typename T>
 struct Allocator<T, Device::CPU>
 {
+  static constexpr bool is_raw = std::is_trivially_default_constructible_v<T>
+                                 && std::is_trivially_destructible_v<T>;
+
   static T* allocate(std::size_t size, ComputeStream const&)
   {
+    if constexpr (is_raw)
+    {
+      if (cpu::allocator_backend() == cpu::AllocatorBackend::NUMA)
+      {
+        return static_cast<T*>(cpu::internal::numa_allocate(size * sizeof(T)));
+      }
+    }
     return new T[size];
   }
 
-  static void deallocate(T* buf, ComputeStream const&) { delete[] buf; }
+  static void deallocate(T* buf, ComputeStream const&)
+  {
+    if constexpr (is_raw)
+    {
+      if (cpu::allocator_backend() == cpu::AllocatorBackend::NUMA)
+      {
+        cpu::internal::numa_deallocate(buf);
+        return;
+      }
+    }
+    delete[] buf;
+  }
 };
 
 #ifdef H2_HAS_GPU
+/**
+ * GPU allocations use the pool for the backend given by
+ * `gpu::allocator_backend()` (see `gpu::memory_pool()`).
+ *
+ * With the stream-ordered backend, both allocation and deallocation
+ * are ordered on the given stream, so buffers may be released without
+ * any host synchronization once the stream has waited on other users.
+ *
+ * With the size-class backend, memory is cached per allocation stream
+ * and only reused by later allocations on that stream.
+ *
+ * Allocations and releases on a stream being captured by a
+ * `ComputeGraph` bypass the backend, so that the addresses the graph
+ * uses stay valid for its lifetime (see `graph.hpp`).
+ *
+ * Memory is allocated on, and returned to the pool of, the GPU of the
+ * stream, which is made current for the call.
+ */
 template <typename T>
 struct Allocator<T, Device::GPU>
 {
   static T* allocate(std::size_t size, ComputeStream const& stream)
   {
-    T* buf = nullptr;
-    // FIXME: add H2_CHECK_GPU...
-    H2_ASSERT(gpu::default_cub_allocator().DeviceAllocate(
-                reinterpret_cast<void**>(&buf),
-                size * sizeof(T),
-                stream.get_stream<Device::GPU>())
-                == 0,
-              std::runtime_error,
-              "CUB allocation failed.");
-    return buf;
+    gpu::CurrentGPUGuard const guard(stream.get_device_id());
+    if (graph_capture_in_progress()
+        && is_graph_capture_stream(stream.get_stream<Device::GPU>()))
+    {
+      return static_cast<T*>(graph_capture_allocate(
+        size * sizeof(T), stream.get_stream<Device::GPU>()));
+    }
+    return static_cast<T*>(gpu::memory_pool().allocate(
+      size * sizeof(T), stream.get_stream<Device::GPU>()));
+  }
+
+  static void deallocate(T* buf, ComputeStream const& stream)
+  {
+    if (release_graph_allocation(buf))
+    {
+      return;
+    }
+    gpu::CurrentGPUGuard const guard(stream.get_device_id());
+    if (graph_capture_in_progress()
+        && defer_graph_release(stream.get_stream<Device::GPU>(),
+                               [buf, stream]() { deallocate(buf, stream); }))
+    {
+      return;
+    }
+    gpu::memory_pool().deallocate(buf, stream.get_stream<Device::GPU>());
+  }
+};
+#endif
+
+/**
+ * Allocate `bytes` of pinned host memory from H2's pinned memory cache.
+ *
+ * Memory is only pinned when GPU support is available.
+ */
+void* pinned_allocate(std::size_t bytes);
+
+/** Return memory from `pinned_allocate` to the cache. */
+void pinned_deallocate(void* ptr);
+
+/** Return all cached (unused) pinned memory to the system. */
+void pinned_release_cached();
+
+/** Return the number of bytes of unused pinned memory in the cache. */
+std::size_t pinned_cached_bytes();
+
+template <typename T>
+struct PinnedAllocator
+{
+  static T* allocate(std::size_t size, ComputeStream const&)
+  {
+    return static_cast<T*>(pinned_allocate(size * sizeof(T)));
   }
 
   static void deallocate(T* buf, ComputeStream const&)
   {
-    H2_ASSERT(gpu::default_cub_allocator().DeviceFree(buf) == 0,
-              std::runtime_error,
-              "CUB deallocation failed.");
+    pinned_deallocate(buf);
+  }
+};
+
+#ifdef H2_HAS_GPU
+template <typename T>
+struct ManagedAllocator
+{
+  static T* allocate(std::size_t size, ComputeStream const&)
+  {
+    return static_cast<T*>(gpu::mem_alloc_managed(size * sizeof(T)));
   }
+
+  static void deallocate(T* buf, ComputeStream const&) { gpu::mem_free(buf); }
 };
 #endif
 
+/**
+ * Asynchronously migrate `bytes` of managed memory at `ptr` to `dev`.
+ *
+ * This is ordered on `stream`, which must be a GPU stream. Without GPU
+ * support this does nothing.
+ */
+void managed_prefetch(void const* ptr,
+                      std::size_t bytes,
+                      Device dev,
+                      ComputeStream const& stream);
+
+/** Set a placement hint for `bytes` of managed memory at `ptr`. */
+void managed_advise(void const* ptr,
+                    std::size_t bytes,
+                    ManagedAdvice advice,
+                    Device dev);
+
+/**
+ * Allocate memory of the given kind on `Dev`.
+ *
+ * This records the allocation in the allocator statistics.
+ */
+template <typename T, Device Dev>
+T* allocate(std::size_t size, ComputeStream const& stream, MemoryKind kind)
+{
+  H2_PROFILE_RANGE("h2::allocate", Memory);
+  auto do_allocate = [&]() {
+    if constexpr (Dev == Device::CPU)
+    {
+      if (kind == MemoryKind::Pinned)
+      {
+        return PinnedAllocator<T>::allocate(size, stream);
+      }
+    }
+#ifdef H2_HAS_GPU
+    if constexpr (Dev == Device::GPU)
+    {
+      if (kind == MemoryKind::Managed)
+      {
+        return ManagedAllocator<T>::allocate(size, stream);
+      }
+    }
+#endif
+    return Allocator<T, Dev>::allocate(size, stream);
+  };
+  if (allocator_timing_enabled())
+  {
+    auto const start = std::chrono::steady_clock::now();
+    T* buf = do_allocate();
+    record_allocation(Dev,
+                      size * sizeof(T),
+                      std::chrono::steady_clock::now() - start);
+    return buf;
+  }
+  T* buf = do_allocate();
+  record_allocation(Dev, size * sizeof(T));
+  return buf;
+}
+
+/**
+ * Deallocate memory of `size` elements that came from `allocate` with
+ * the same kind.
+ */
+template <typename T, Device Dev>
+void deallocate(T* buf,
+                std::size_t size,
+                ComputeStream const& stream,
+                MemoryKind kind)
+{
+  H2_PROFILE_RANGE("h2::deallocate", Memory);
+  record_deallocation(Dev, size * sizeof(T));
+  if constexpr (Dev == Device::CPU)
+  {
+    if (kind == MemoryKind::Pinned)
+    {
+      PinnedAllocator<T>::deallocate(buf, stream);
+      return;
+    }
+  }
+#ifdef H2_HAS_GPU
+  if constexpr (Dev == Device::GPU)
+  {
+    if (kind == MemoryKind::Managed)
+    {
+      ManagedAllocator<T>::deallocate(buf, stream);
+      return;
+    }
+  }
+#endif
+  Allocator<T, Dev>::deallocate(buf, stream);
+}
+
 /**
  * Helper class to wrap an allocation in RAII semantics.
  */
@@ -90,21 +342,24 @@ public:
     : buf(nullptr),
       buf_size(0),
       device(dev),
-      stream(stream_.value_or(ComputeStream{dev}))
+      stream(stream_.value_or(ComputeStream{dev})),
+      kind(MemoryKind::Default)
   {}
 
   ManagedBuffer(std::size_t size_,
                 Device dev,
-                std::optional<ComputeStream> const stream_ = std::nullopt)
+                std::optional<ComputeStream> const stream_ = std::nullopt,
+                MemoryKind kind_ = MemoryKind::Default)
     : buf(nullptr),
       buf_size(size_),
       device(dev),
-      stream(stream_.value_or(ComputeStream{dev}))
+      stream(stream_.value_or(ComputeStream{dev})),
+      kind(kind_)
   {
     if (buf_size)
     {
       H2_DEVICE_DISPATCH_SAME(
-        device, (buf = Allocator<T, Dev>::allocate(buf_size, stream)));
+        device, (buf = allocate<T, Dev>(buf_size, stream, kind)));
     }
   }
 
@@ -113,7 +368,7 @@ public:
     if (buf)
     {
       H2_TERMINATE_ON_THROW_DEBUG(H2_DEVICE_DISPATCH_SAME(
-        device, (Allocator<T, Dev>::deallocate(buf, stream))));
+        device, (deallocate<T, Dev>(buf, buf_size, stream, kind))));
     }
   }
 
@@ -124,7 +379,8 @@ public:
     : buf(other.buf),
       buf_size(other.buf_size),
       device(other.device),
-      stream(other.stream)
+      stream(other.stream),
+      kind(other.kind)
   {
     other.buf = nullptr;
     other.buf_size = 0;
@@ -136,6 +392,7 @@ public:
     buf_size = other.buf_size;
     device = other.device;
     stream = other.stream;
+    kind = other.kind;
     other.buf = nullptr;
     other.buf_size = 0;
     return *this;
@@ -153,11 +410,14 @@ public:
 
   ComputeStream const& get_stream() const H2_NOEXCEPT { return stream; }
 
+  MemoryKind get_memory_kind() const H2_NOEXCEPT { return kind; }
+
 private:
   T* buf;
   std::size_t buf_size;
   Device device;
   ComputeStream stream;
+  MemoryKind kind;
 };
 
 }  // namespace internal
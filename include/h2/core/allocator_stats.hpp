@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Statistics on memory allocated through H2's allocators.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+namespace h2
+{
+
+/**
+ * Summary of the memory H2 has allocated on one device type.
+ *
+ * Counters cover allocations made through `RawBuffer` and
+ * `ManagedBuffer` (i.e., tensor data and internal staging buffers).
+ * Memory allocated directly through the `Allocator` classes is not
+ * tracked.
+ *
+ * Allocation latency is only recorded when the `H2_ALLOCATOR_STATS`
+ * environment variable is set, which also dumps the statistics for
+ * every device via `h2::Logger` at exit.
+ */
+struct AllocatorStats
+{
+  /** Number of buckets in the latency histogram. */
+  static constexpr std::size_t num_latency_buckets = 32;
+
+  /** Bytes currently allocated. */
+  std::size_t bytes_live = 0;
+  /** Maximum of `bytes_live` since the last reset. */
+  std::size_t peak_bytes_live = 0;
+  /**
+   * Bytes held by the underlying memory pool but not in use.
+   *
+   * This is queried from the pool (CUB, the stream-ordered pool, or
+   * the pinned host cache) for the current device when the statistics
+   * are requested.
+   */
+  std::size_t bytes_cached = 0;
+  /** Number of allocations. */
+  std::size_t num_allocations = 0;
+  /** Number of deallocations. */
+  std::size_t num_deallocations = 0;
+  /**
+   * Allocations served from and missing H2's own caches.
+   *
+   * Only caches managed by H2 (currently the pinned host cache) can
+   * report these; external pools do not expose them.
+   */
+  std::size_t num_cache_hits = 0;
+  std::size_t num_cache_misses = 0;
+  /**
+   * Histogram of allocation latencies.
+   *
+   * Entry `i` counts allocations that took [2^i, 2^(i+1)) ns, with the
+   * last bucket catching everything longer.
+   */
+  std::array<std::size_t, num_latency_buckets> allocation_latency_ns{};
+
+  /** Fraction of cache lookups that hit, or 0 if there were none. */
+  double cache_hit_rate() const noexcept
+  {
+    std::size_t const lookups = num_cache_hits + num_cache_misses;
+    return lookups ? static_cast<double>(num_cache_hits) / lookups : 0.0;
+  }
+};
+
+/** Return the current allocator statistics for a device type. */
+AllocatorStats get_allocator_stats(Device dev);
+
+/**
+ * Reset the counters for a device type.
+ *
+ * Live bytes are not reset, as that memory is still allocated; the
+ * peak is reset to the current live bytes.
+ */
+void reset_allocator_stats(Device dev);
+
+/** Print allocator statistics. */
+std::ostream& operator<<(std::ostream& os, AllocatorStats const& stats);
+
+namespace internal
+{
+
+/** Return true if allocation latencies should be recorded. */
+bool allocator_timing_enabled();
+
+/** Record an allocation of `bytes` on `dev`. */
+void record_allocation(Device dev, std::size_t bytes);
+
+/** Record an allocation of `bytes` on `dev` that took `latency`. */
+void record_allocation(Device dev,
+                       std::size_t bytes,
+                       std::chrono::nanoseconds latency);
+
+/** Record a deallocation of `bytes` on `dev`. */
+void record_deallocation(Device dev, std::size_t bytes);
+
+/** Record whether a lookup in an H2-managed cache on `dev` hit. */
+void record_cache_lookup(Device dev, bool hit);
+
+}  // namespace internal
+
+}  // namespace h2
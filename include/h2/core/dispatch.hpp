@@ -15,9 +15,14 @@
 #include <h2_config.hpp>
 
 #include "h2/core/device.hpp"
+#include "h2/core/profiling.hpp"
 #include "h2/core/types.hpp"
 #include "h2/utils/IntegerMath.hpp"
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
 #include <type_traits>
 #include <utility>
 
@@ -134,6 +139,12 @@
  * support custom compute types. If there are CPU and GPU versions, the
  * name will have "_cpu" and "_gpu" appended (respectively).
  *
+ * The generated code keeps a `DispatchSite` for each dispatch, which
+ * interns the dispatch name once, when the dispatching function is
+ * first called, and caches the method it last dispatched to, so
+ * dispatching repeatedly to the same registered method does not look
+ * it up again.
+ *
  * The dispatch code is generated in a preprocessing pass during the
  * build by `scripts/dispatch_gen.py`. This runs *only on source files*
  * so make sure your dispatch code is there and not in a header.
@@ -151,31 +162,98 @@
  * - func is a function pointer to the method.
  * The function may be unregistered with `dispatch_unregister`.
  * Note that this will not allow you to override internal H2
- * implementations of functions.
+ * implementations of functions. Registration is thread-safe, and may
+ * happen concurrently with dispatch.
  */
 
+#if H2_HAS_GPU_LOW_PRECISION
+
+#define H2_INSTANTIATE_LOW_PRECISION_DEV_1_(device)                            \
+  PROTO(device, ::h2::gpu::Half);                                              \
+  PROTO(device, ::h2::gpu::BFloat16);
+
+// Pairs of compute types involving low-precision types.
+#define H2_FOR_EACH_LOW_PRECISION_TYPE_PAIR_(F, arg)                           \
+  F(arg, float, float, fp16, ::h2::gpu::Half)                                  \
+  F(arg, float, float, bf16, ::h2::gpu::BFloat16)                              \
+  F(arg, double, double, fp16, ::h2::gpu::Half)                                \
+  F(arg, double, double, bf16, ::h2::gpu::BFloat16)                            \
+  F(arg, int32, std::int32_t, fp16, ::h2::gpu::Half)                           \
+  F(arg, int32, std::int32_t, bf16, ::h2::gpu::BFloat16)                       \
+  F(arg, uint32, std::uint32_t, fp16, ::h2::gpu::Half)                         \
+  F(arg, uint32, std::uint32_t, bf16, ::h2::gpu::BFloat16)                     \
+  F(arg, fp16, ::h2::gpu::Half, float, float)                                  \
+  F(arg, fp16, ::h2::gpu::Half, double, double)                                \
+  F(arg, fp16, ::h2::gpu::Half, int32, std::int32_t)                           \
+  F(arg, fp16, ::h2::gpu::Half, uint32, std::uint32_t)                         \
+  F(arg, fp16, ::h2::gpu::Half, fp16, ::h2::gpu::Half)                         \
+  F(arg, fp16, ::h2::gpu::Half, bf16, ::h2::gpu::BFloat16)                     \
+  F(arg, bf16, ::h2::gpu::BFloat16, float, float)                              \
+  F(arg, bf16, ::h2::gpu::BFloat16, double, double)                            \
+  F(arg, bf16, ::h2::gpu::BFloat16, int32, std::int32_t)                       \
+  F(arg, bf16, ::h2::gpu::BFloat16, uint32, std::uint32_t)                     \
+  F(arg, bf16, ::h2::gpu::BFloat16, fp16, ::h2::gpu::Half)                     \
+  F(arg, bf16, ::h2::gpu::BFloat16, bf16, ::h2::gpu::BFloat16)
+
+#else  // H2_HAS_GPU_LOW_PRECISION
+
+#define H2_INSTANTIATE_LOW_PRECISION_DEV_1_(device)
+#define H2_FOR_EACH_LOW_PRECISION_TYPE_PAIR_(F, arg)
+
+#endif  // H2_HAS_GPU_LOW_PRECISION
+
 #define H2_INSTANTIATE_DEV_1(device)                                           \
   PROTO(device, float);                                                        \
   PROTO(device, double);                                                       \
   PROTO(device, std::int32_t);                                                 \
-  PROTO(device, std::uint32_t);
+  PROTO(device, std::uint32_t);                                                \
+  H2_INSTANTIATE_LOW_PRECISION_DEV_1_(device)
+
+/**
+ * Invoke `F(arg, id1, T1, id2, T2)` for every pair of compute types,
+ * where `id1` and `id2` are the short names of `T1` and `T2` used in
+ * `H2_NATIVE_DISPATCH_PAIRS`.
+ */
+#define H2_FOR_EACH_COMPUTE_TYPE_PAIR(F, arg)                                  \
+  F(arg, float, float, float, float)                                           \
+  F(arg, float, float, double, double)                                         \
+  F(arg, float, float, int32, std::int32_t)                                    \
+  F(arg, float, float, uint32, std::uint32_t)                                  \
+  F(arg, double, double, float, float)                                         \
+  F(arg, double, double, double, double)                                       \
+  F(arg, double, double, int32, std::int32_t)                                  \
+  F(arg, double, double, uint32, std::uint32_t)                                \
+  F(arg, int32, std::int32_t, float, float)                                    \
+  F(arg, int32, std::int32_t, double, double)                                  \
+  F(arg, int32, std::int32_t, int32, std::int32_t)                             \
+  F(arg, int32, std::int32_t, uint32, std::uint32_t)                           \
+  F(arg, uint32, std::uint32_t, float, float)                                  \
+  F(arg, uint32, std::uint32_t, double, double)                                \
+  F(arg, uint32, std::uint32_t, int32, std::int32_t)                           \
+  F(arg, uint32, std::uint32_t, uint32, std::uint32_t)                         \
+  H2_FOR_EACH_LOW_PRECISION_TYPE_PAIR_(F, arg)
+
+// Expand the arguments only if enabled is 1. This takes two steps so
+// that enabled is expanded before it is pasted.
+#define H2_EXPAND_IF_(enabled, ...) H2_EXPAND_IF_IMPL_(enabled, __VA_ARGS__)
+#define H2_EXPAND_IF_IMPL_(enabled, ...) H2_EXPAND_IF_##enabled(__VA_ARGS__)
+#define H2_EXPAND_IF_0(...)
+#define H2_EXPAND_IF_1(...) __VA_ARGS__;
+
+#define H2_INSTANTIATE_NATIVE_PAIR_(device, id1, t1, id2, t2)                  \
+  H2_EXPAND_IF_(H2_NATIVE_DISPATCH_##id1##_##id2, PROTO(device, t1, t2))
+
+/**
+ * Instantiate `PROTO(device, T1, T2)` for every pair of compute types
+ * with native dispatch.
+ *
+ * Which pairs are native is set at configure time with
+ * `H2_NATIVE_DISPATCH_PAIRS` (see also `NativeDispatchPairs`). The
+ * generated dispatch tables have no entries for other pairs, which
+ * fall back to registered dispatch.
+ */
 #define H2_INSTANTIATE_DEV_2(device)                                           \
-  PROTO(device, float, float);                                                 \
-  PROTO(device, float, double);                                                \
-  PROTO(device, float, std::int32_t);                                          \
-  PROTO(device, float, std::uint32_t);                                         \
-  PROTO(device, double, float);                                                \
-  PROTO(device, double, double);                                               \
-  PROTO(device, double, std::int32_t);                                         \
-  PROTO(device, double, std::uint32_t);                                        \
-  PROTO(device, std::int32_t, float);                                          \
-  PROTO(device, std::int32_t, double);                                         \
-  PROTO(device, std::int32_t, std::int32_t);                                   \
-  PROTO(device, std::int32_t, std::uint32_t);                                  \
-  PROTO(device, std::uint32_t, float);                                         \
-  PROTO(device, std::uint32_t, double);                                        \
-  PROTO(device, std::uint32_t, std::int32_t);                                  \
-  PROTO(device, std::uint32_t, std::uint32_t);
+  H2_FOR_EACH_COMPUTE_TYPE_PAIR(H2_INSTANTIATE_NATIVE_PAIR_, device)
 
 #define H2_INSTANTIATE_CPU_1 H2_INSTANTIATE_DEV_1(CPUDev_t)
 #define H2_INSTANTIATE_CPU_2 H2_INSTANTIATE_DEV_2(CPUDev_t)
@@ -207,12 +285,51 @@ namespace h2
 namespace internal
 {
 
+/**
+ * A type trait with member `value` which will be true if the pair
+ * `meta::TL<T1, T2>` of compute types has native dispatch.
+ */
+template <typename Pair>
+struct IsNativeDispatchPair : std::false_type
+{};
+
+#define H2_NATIVE_DISPATCH_PAIR_TRAIT_(unused, id1, t1, id2, t2)               \
+  template <>                                                                  \
+  struct IsNativeDispatchPair<meta::TL<t1, t2>>                                \
+    : std::bool_constant<H2_NATIVE_DISPATCH_##id1##_##id2>                     \
+  {};
+H2_FOR_EACH_COMPUTE_TYPE_PAIR(H2_NATIVE_DISPATCH_PAIR_TRAIT_, none)
+#undef H2_NATIVE_DISPATCH_PAIR_TRAIT_
+
+}  // namespace internal
+
+/**
+ * List of the pairs (`meta::TL<T1, T2>`) of compute types that methods
+ * dispatching on two types have native implementations for.
+ *
+ * This is set at configure time with `H2_NATIVE_DISPATCH_PAIRS`.
+ */
+using NativeDispatchPairs =
+  meta::tlist::SelectAll<meta::tlist::CartProdTL<ComputeTypes, ComputeTypes>,
+                         internal::IsNativeDispatchPair>;
+
+/** True if the compute types `T1` and `T2` have native dispatch. */
+template <typename T1, typename T2>
+inline constexpr bool IsNativeDispatchPair_v =
+  meta::tlist::Member<meta::TL<T1, T2>, NativeDispatchPairs>;
+
+namespace internal
+{
+
 /**
  * An entry in a dynamic dispatch table.
  *
  * This holds a function pointer (which will be dispatched to) and a
  * function pointer to a "trampoline" caller which can reconstruct the
  * true types of the function from a void*[] argument list.
+ *
+ * Native dispatch tables have entries with null pointers for types
+ * without a native implementation.
  */
 struct DispatchFunctionEntry
 {
@@ -384,17 +501,23 @@ bool contains_nonnative_compute_type(TypeInfoHavers const&... args)
           && ...);
 }
 
-/** Construct a native dispatch key for dispatching on tokens. */
+/**
+ * Construct a native dispatch key for dispatching on tokens.
+ *
+ * This is the index of the tokens in the N-fold Cartesian product of
+ * the compute types (i.e., the tokens as digits in base
+ * `NumComputeTypes`, the first being most significant), so native
+ * dispatch tables are dense even when the number of compute types is
+ * not a power of 2.
+ */
 template <std::size_t N>
 constexpr NativeDispatchKeyT<N>
 get_native_dispatch_key(std::array<TypeInfo::TokenType, N> const& tokens)
 {
   NativeDispatchKeyT<N> dispatch_key = 0;
-  // Shift tokens, with the first being leftmost, to construct the key.
   for (std::size_t i = 0; i < N; ++i)
   {
-    dispatch_key |= tokens[i]
-                    << (dispatch_bits_per_native_compute_type * (N - 1 - i));
+    dispatch_key = dispatch_key * NumComputeTypes + tokens[i];
   }
   return dispatch_key;
 }
@@ -412,12 +535,51 @@ get_native_dispatch_key(TypeInfoHavers const&... args)
   return get_native_dispatch_key(tokens);
 }
 
+/**
+ * Handle for an interned dispatch name.
+ *
+ * Handles are small integers assigned in the order names are first
+ * interned, and are only meaningful within one process.
+ */
+using DispatchNameHandle = std::uint32_t;
+
+/**
+ * Return the handle for a dispatch name, interning it if needed.
+ *
+ * This takes a lock, so resolve handles once (e.g., in a static) and
+ * reuse them.
+ */
+DispatchNameHandle get_dispatch_name_handle(std::string const& name);
+
+/** Return the name that was interned as `handle`. */
+std::string get_dispatch_name(DispatchNameHandle handle);
+
 /** Add a dispatch entry to the dispatch table for the name and key. */
+void add_dispatch_entry(DispatchNameHandle handle,
+                        DispatchKeyT const& dispatch_key,
+                        DispatchFunctionEntry const& dispatch_entry);
 void add_dispatch_entry(std::string const& name,
                         DispatchKeyT const& dispatch_key,
                         DispatchFunctionEntry const& dispatch_entry);
 
+/** Remove the dispatch entry for the name and key, if present. */
+void remove_dispatch_entry(DispatchNameHandle handle,
+                           DispatchKeyT const& dispatch_key);
+
+/**
+ * Return the dispatch entry for the name and key, or null if there is
+ * none.
+ *
+ * This is lock-free. Entries are never freed, so the result remains
+ * valid even if the entry is later replaced or removed.
+ */
+DispatchFunctionEntry const*
+find_dispatch_entry(DispatchNameHandle handle,
+                    DispatchKeyT const& dispatch_key) H2_NOEXCEPT;
+
 /** Return true if a dispatch entry exists for the name and key. */
+bool has_dispatch_entry(DispatchNameHandle handle,
+                        DispatchKeyT const& dispatch_key);
 bool has_dispatch_entry(std::string const& name,
                         DispatchKeyT const& dispatch_key);
 
@@ -427,22 +589,130 @@ bool has_dispatch_entry(std::string const& name,
  * Throws if the entry is not present.
  */
 DispatchFunctionEntry const&
+get_dispatch_entry(DispatchNameHandle handle, DispatchKeyT const& dispatch_key);
+DispatchFunctionEntry const&
 get_dispatch_entry(std::string const& name, DispatchKeyT const& dispatch_key);
 
+/**
+ * Counter incremented on every change to registered dispatch entries.
+ *
+ * This is used to invalidate cached lookups.
+ */
+extern std::atomic<std::uint64_t> dispatch_generation;
+
+/** Return the current dispatch generation. */
+inline std::uint64_t get_dispatch_generation() H2_NOEXCEPT
+{
+  return dispatch_generation.load(std::memory_order_acquire);
+}
+
+/**
+ * State for one dynamic dispatch call site: The interned dispatch name
+ * and a cache of the registered entry it last resolved.
+ *
+ * This is a monomorphic inline cache: A call site almost always sees
+ * the same types, so when the dispatch key matches the last one (and
+ * no entries have been registered or unregistered since), the entry is
+ * reused without a lookup. The cache is a seqlock, so it is safe for
+ * concurrent use; contended updates are simply skipped.
+ */
+class DispatchSite
+{
+public:
+  explicit DispatchSite(std::string const& name_)
+    : name(name_), handle(get_dispatch_name_handle(name_))
+  {}
+
+  DispatchSite(DispatchSite const&) = delete;
+  DispatchSite& operator=(DispatchSite const&) = delete;
+
+  /** Return the handle of the dispatch name. */
+  DispatchNameHandle get_handle() const H2_NOEXCEPT { return handle; }
+
+  /** Return the dispatch name. */
+  char const* get_name() const H2_NOEXCEPT { return name.c_str(); }
+
+  /** Return the cached entry for `key`, or null if it is not cached. */
+  DispatchFunctionEntry const* lookup(DispatchKeyT key) const H2_NOEXCEPT
+  {
+    std::uint64_t const start_seq = seq.load(std::memory_order_acquire);
+    if (start_seq & 1)
+    {
+      return nullptr;  // Update in progress.
+    }
+    DispatchKeyT const cached_key_ = cached_key.load(std::memory_order_relaxed);
+    std::uint64_t const cached_generation_ =
+      cached_generation.load(std::memory_order_relaxed);
+    DispatchFunctionEntry const* cached_entry_ =
+      cached_entry.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq.load(std::memory_order_relaxed) != start_seq
+        || cached_entry_ == nullptr || cached_key_ != key
+        || cached_generation_ != get_dispatch_generation())
+    {
+      return nullptr;
+    }
+    return cached_entry_;
+  }
+
+  /**
+   * Cache `entry` for `key`, which was looked up at dispatch generation
+   * `generation`.
+   */
+  void update(DispatchKeyT key,
+              std::uint64_t generation,
+              DispatchFunctionEntry const* entry) H2_NOEXCEPT
+  {
+    std::uint64_t cur_seq = seq.load(std::memory_order_relaxed);
+    if ((cur_seq & 1)
+        || !seq.compare_exchange_strong(cur_seq,
+                                        cur_seq + 1,
+                                        std::memory_order_relaxed))
+    {
+      return;  // Another thread is updating.
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    cached_key.store(key, std::memory_order_relaxed);
+    cached_generation.store(generation, std::memory_order_relaxed);
+    cached_entry.store(entry, std::memory_order_relaxed);
+    seq.store(cur_seq + 2, std::memory_order_release);
+  }
+
+private:
+  /** Dispatch name, kept for profiler ranges. */
+  std::string name;
+  DispatchNameHandle handle;
+  /** Sequence number, odd while an update is in progress. */
+  std::atomic<std::uint64_t> seq{0};
+  std::atomic<DispatchKeyT> cached_key{0};
+  std::atomic<std::uint64_t> cached_generation{0};
+  std::atomic<DispatchFunctionEntry const*> cached_entry{nullptr};
+};
+
 /**
  * Call the dispatch entry for name and key with the given arguments.
  *
  * Throws if the entry is not present.
  */
 template <typename... Args>
-void call_dispatch_entry(std::string const& name,
+void call_dispatch_entry(DispatchNameHandle handle,
                          DispatchKeyT const& dispatch_key,
                          Args&&... args)
 {
-  auto entry = get_dispatch_entry(name, dispatch_key);
+  auto const& entry = get_dispatch_entry(handle, dispatch_key);
   dispatch_call(entry, std::forward<Args>(args)...);
 }
 
+template <typename... Args>
+void call_dispatch_entry(std::string const& name,
+                         DispatchKeyT const& dispatch_key,
+                         Args&&... args)
+{
+  call_dispatch_entry(get_dispatch_name_handle(name),
+                      dispatch_key,
+                      std::forward<Args>(args)...);
+}
+
 /** Construct a dispatch key for dispatching on tokens. */
 template <std::size_t N>
 constexpr DispatchKeyT
@@ -523,6 +793,41 @@ struct DispatchOn
  * Dispatch on dispatch_types and invoke the function with args.
  *
  * This will handle both native compute type and registered dispatch.
+ * `name` is the handle of the name methods are registered under.
+ *
+ * Prefer dispatching through a `DispatchSite`, which caches lookups.
+ */
+template <std::size_t N, std::size_t num_types, typename... Args>
+void do_dispatch(
+  std::array<internal::DispatchFunctionEntry, N> const& dispatch_table,
+  internal::DispatchNameHandle name,
+  DispatchOn<num_types> const& dispatch_types,
+  Args&&... args)
+{
+  if (dispatch_types.all_native)
+  {
+    auto const native_dispatch_key =
+      internal::get_native_dispatch_key(dispatch_types.tokens);
+    H2_ASSERT_DEBUG(native_dispatch_key < dispatch_table.size(),
+                    "Native dispatch key exceeds dispatch table size");
+    auto const& entry = dispatch_table[native_dispatch_key];
+    if (entry.func_ptr != nullptr)
+    {
+      internal::dispatch_call(entry, std::forward<Args>(args)...);
+      return;
+    }
+    // Types without a native implementation use registered dispatch.
+  }
+  auto const dispatch_key = internal::get_dispatch_key(dispatch_types.tokens);
+  internal::call_dispatch_entry(
+    name, dispatch_key, std::forward<Args>(args)...);
+}
+
+/**
+ * Dispatch on dispatch_types and invoke the function with args,
+ * looking up the name `name` for registered dispatch.
+ *
+ * Prefer passing an interned handle, which avoids the lookup.
  */
 template <std::size_t N, std::size_t num_types, typename... Args>
 void do_dispatch(
@@ -531,21 +836,69 @@ void do_dispatch(
   DispatchOn<num_types> const& dispatch_types,
   Args&&... args)
 {
+  if (dispatch_types.all_native)
+  {
+    auto const native_dispatch_key =
+      internal::get_native_dispatch_key(dispatch_types.tokens);
+    if (native_dispatch_key < dispatch_table.size()
+        && dispatch_table[native_dispatch_key].func_ptr != nullptr)
+    {
+      // The name is not needed.
+      do_dispatch(dispatch_table,
+                  internal::DispatchNameHandle{0},
+                  dispatch_types,
+                  std::forward<Args>(args)...);
+      return;
+    }
+  }
+  do_dispatch(dispatch_table,
+              internal::get_dispatch_name_handle(name),
+              dispatch_types,
+              std::forward<Args>(args)...);
+}
+
+/**
+ * Dispatch on dispatch_types and invoke the function with args, using
+ * the call site `site` for registered dispatch.
+ *
+ * Native compute types dispatch directly through `dispatch_table`,
+ * which is already a single index; registered entries (including for
+ * native types without an entry in `dispatch_table`) are cached in
+ * `site`.
+ *
+ * In profiling builds, the call is a profiler range named after the
+ * dispatch name (see `profiling.hpp`).
+ */
+template <std::size_t N, std::size_t num_types, typename... Args>
+void do_dispatch(
+  std::array<internal::DispatchFunctionEntry, N> const& dispatch_table,
+  internal::DispatchSite& site,
+  DispatchOn<num_types> const& dispatch_types,
+  Args&&... args)
+{
+  H2_PROFILE_RANGE(site.get_name(), Dispatch);
   if (dispatch_types.all_native)
   {
     auto const native_dispatch_key =
       internal::get_native_dispatch_key(dispatch_types.tokens);
     H2_ASSERT_DEBUG(native_dispatch_key < dispatch_table.size(),
                     "Native dispatch key exceeds dispatch table size");
-    internal::dispatch_call(dispatch_table[native_dispatch_key],
-                            std::forward<Args>(args)...);
+    auto const& native_entry = dispatch_table[native_dispatch_key];
+    if (native_entry.func_ptr != nullptr)
+    {
+      internal::dispatch_call(native_entry, std::forward<Args>(args)...);
+      return;
+    }
   }
-  else
+  auto const dispatch_key = internal::get_dispatch_key(dispatch_types.tokens);
+  internal::DispatchFunctionEntry const* entry = site.lookup(dispatch_key);
+  if (entry == nullptr)
   {
-    auto const dispatch_key = internal::get_dispatch_key(dispatch_types.tokens);
-    internal::call_dispatch_entry(
-      name, dispatch_key, std::forward<Args>(args)...);
+    std::uint64_t const generation = internal::get_dispatch_generation();
+    entry = &internal::get_dispatch_entry(site.get_handle(), dispatch_key);
+    site.update(dispatch_key, generation, entry);
   }
+  internal::dispatch_call(*entry, std::forward<Args>(args)...);
 }
 
 }  // namespace h2
@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Capture and replay of work on GPU compute streams.
+ *
+ * Many small operations are bound by kernel launch latency. A
+ * `ComputeGraph` records the work submitted to a `ComputeStream`
+ * (e.g., a sequence of H2 loops) once, as a CUDA/HIP graph, which can
+ * then be replayed with a single launch.
+ *
+ * A replay reuses exactly the buffers used during capture, so H2's GPU
+ * allocator treats a capturing stream specially: memory allocated on
+ * it during capture is owned by the graph and is not reused until both
+ * the graph and the buffer have been released, and buffers released
+ * on it during capture are not released until the graph is. Hence the
+ * addresses baked into a graph remain valid for as long as it exists.
+ * Work enqueued on other streams that join the capture (by waiting on
+ * the capturing stream) is captured, but their allocations are not
+ * handled specially. Neither are buffers from a `ScratchArena`, which
+ * must not be rewound while a graph uses them.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+#include "h2/core/sync.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+
+#ifdef H2_HAS_GPU
+#include "h2/gpu/runtime.hpp"
+#endif
+
+namespace h2
+{
+
+#ifdef H2_HAS_GPU
+
+namespace internal
+{
+
+/** Memory and deferred releases belonging to one captured graph. */
+struct GraphResources;
+
+/**
+ * Return whether any stream is being captured by a `ComputeGraph`.
+ *
+ * This is cheap, so allocators may check it before looking up
+ * individual streams.
+ */
+bool graph_capture_in_progress() H2_NOEXCEPT;
+
+/** Return whether `stream` is being captured by a `ComputeGraph`. */
+bool is_graph_capture_stream(gpu::DeviceStream stream);
+
+/**
+ * Allocate `bytes` of GPU memory owned by the graph capturing
+ * `stream`, which must be capturing.
+ */
+void* graph_capture_allocate(std::size_t bytes, gpu::DeviceStream stream);
+
+/**
+ * Release `ptr` if it came from `graph_capture_allocate`, returning
+ * whether it did.
+ *
+ * The memory is freed once its graph is also destroyed.
+ */
+bool release_graph_allocation(void* ptr);
+
+/**
+ * Defer `release` until the graph capturing `stream` is destroyed,
+ * returning whether `stream` is capturing (otherwise this does
+ * nothing).
+ */
+bool defer_graph_release(gpu::DeviceStream stream,
+                         std::function<void()> release);
+
+}  // namespace internal
+
+/**
+ * A sequence of GPU work captured from a `ComputeStream`, which may be
+ * replayed.
+ *
+ * Capture with `begin_capture` and `end_capture` (or `capture_graph`),
+ * then `replay` as many times as desired. Work submitted to the stream
+ * during capture is not executed. Host code run during capture is not
+ * part of the graph; in particular, anything that synchronizes with the
+ * stream is an error.
+ *
+ * Kernel arguments (including buffer addresses and immediates) are
+ * fixed at capture, so to run the same work on new data, copy the data
+ * into the buffers that were captured.
+ */
+class ComputeGraph
+{
+public:
+  ComputeGraph() = default;
+  ~ComputeGraph();
+
+  ComputeGraph(ComputeGraph const&) = delete;
+  ComputeGraph& operator=(ComputeGraph const&) = delete;
+
+  ComputeGraph(ComputeGraph&& other) H2_NOEXCEPT
+    : capture_stream(std::exchange(other.capture_stream, nullptr)),
+      graph(std::exchange(other.graph, nullptr)),
+      graph_exec(std::exchange(other.graph_exec, nullptr)),
+      resources(std::move(other.resources))
+  {}
+  ComputeGraph& operator=(ComputeGraph&& other);
+
+  /**
+   * Begin capturing work submitted to `stream`.
+   *
+   * This discards any previously captured graph. `stream` must be a
+   * GPU stream other than the legacy default stream, and must not
+   * already be capturing.
+   */
+  void begin_capture(ComputeStream const& stream);
+
+  /** End capture and prepare the captured work for replay. */
+  void end_capture();
+
+  /** Return whether this graph is currently capturing. */
+  bool is_capturing() const H2_NOEXCEPT { return capture_stream != nullptr; }
+
+  /** Return whether this graph holds captured work to replay. */
+  bool is_captured() const H2_NOEXCEPT { return graph_exec != nullptr; }
+
+  /**
+   * Enqueue the captured work on `stream`.
+   *
+   * The graph may be replayed on any GPU stream, but only one replay
+   * may run at a time, as all replays use the same buffers.
+   */
+  void replay(ComputeStream const& stream) const;
+
+  /**
+   * Release the captured graph and its memory.
+   *
+   * This waits for all GPU work to complete, as a replay may still be
+   * running.
+   */
+  void reset();
+
+private:
+  /** Stream being captured, if capture is in progress. */
+  gpu::DeviceStream capture_stream = nullptr;
+  gpu::DeviceGraph graph = nullptr;
+  gpu::DeviceGraphExec graph_exec = nullptr;
+  std::shared_ptr<internal::GraphResources> resources;
+};
+
+/**
+ * Capture the work that `f` submits to `stream` into a graph.
+ *
+ * If `f` throws, capture is abandoned and the exception propagated.
+ */
+template <typename FuncT>
+ComputeGraph capture_graph(ComputeStream const& stream, FuncT&& f)
+{
+  ComputeGraph graph;
+  graph.begin_capture(stream);
+  try
+  {
+    std::forward<FuncT>(f)();
+  }
+  catch (...)
+  {
+    // Abandoning the capture may itself fail (the capture may have
+    // been invalidated); the original error is more useful.
+    try
+    {
+      graph.reset();
+    }
+    catch (...)
+    {}
+    throw;
+  }
+  graph.end_capture();
+  return graph;
+}
+
+#endif  // H2_HAS_GPU
+
+}  // namespace h2
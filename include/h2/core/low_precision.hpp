@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Low-precision (16-bit) floating point types.
+ *
+ * When H2 is built with `H2_ENABLE_GPU_LOW_PRECISION`, the GPU
+ * runtime's half (`gpu::Half`) and bfloat16 (`gpu::BFloat16`) types
+ * are compute types. These have no direct conversions between each
+ * other (and, depending on the runtime, some integer types), so
+ * generic code should convert compute types with
+ * `convert_compute_type`.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/gpu/macros.hpp"
+#include "h2/meta/typelist/Member.hpp"
+#include "h2/meta/typelist/TypeList.hpp"
+
+#include <ostream>
+#include <type_traits>
+
+#if H2_HAS_GPU_LOW_PRECISION
+#if H2_HAS_CUDA
+#include <cuda_bf16.h>
+#include <cuda_fp16.h>
+#elif H2_HAS_ROCM
+#include <hip/hip_bf16.h>
+#include <hip/hip_fp16.h>
+#endif
+#endif  // H2_HAS_GPU_LOW_PRECISION
+
+namespace h2
+{
+
+#if H2_HAS_GPU_LOW_PRECISION
+
+namespace gpu
+{
+
+#if H2_HAS_CUDA
+/** IEEE half precision type. */
+using Half = __half;
+/** bfloat16 type. */
+using BFloat16 = __nv_bfloat16;
+#elif H2_HAS_ROCM
+/** IEEE half precision type. */
+using Half = __half;
+/** bfloat16 type. */
+using BFloat16 = __hip_bfloat16;
+#endif
+
+}  // namespace gpu
+
+/** List of low-precision floating point types. */
+using LowPrecisionFloatTypes = meta::TL<gpu::Half, gpu::BFloat16>;
+
+#else  // H2_HAS_GPU_LOW_PRECISION
+
+/** List of low-precision floating point types. */
+using LowPrecisionFloatTypes = meta::TL<>;
+
+#endif  // H2_HAS_GPU_LOW_PRECISION
+
+/**
+ * A type trait with member `value` which will be true if `T` is a
+ * low-precision floating point type.
+ */
+template <typename T>
+struct IsLowPrecisionFloat
+  : std::bool_constant<meta::tlist::Member<T, LowPrecisionFloatTypes>>
+{};
+
+/** Helper variable for `IsLowPrecisionFloat`. */
+template <typename T>
+inline constexpr bool IsLowPrecisionFloat_v = IsLowPrecisionFloat<T>::value;
+
+/**
+ * True if `convert_compute_type` can convert from `SrcT` to `DstT`.
+ */
+template <typename SrcT, typename DstT>
+inline constexpr bool IsComputeConvertible_v =
+  std::is_convertible_v<SrcT, DstT>
+  || ((IsLowPrecisionFloat_v<SrcT> || IsLowPrecisionFloat_v<DstT>)
+      && std::is_convertible_v<SrcT, float>
+      && std::is_convertible_v<float, DstT>);
+
+/**
+ * Convert `x` from one compute type to another.
+ *
+ * This is a `static_cast`, except conversions involving low-precision
+ * types go through `float`.
+ */
+template <typename DstT, typename SrcT>
+H2_GPU_HOST_DEVICE inline DstT convert_compute_type(SrcT const& x)
+{
+  if constexpr (std::is_same_v<DstT, SrcT>)
+  {
+    return x;
+  }
+  else if constexpr (IsLowPrecisionFloat_v<DstT>
+                     || IsLowPrecisionFloat_v<SrcT>)
+  {
+    return static_cast<DstT>(static_cast<float>(x));
+  }
+  else
+  {
+    return static_cast<DstT>(x);
+  }
+}
+
+}  // namespace h2
+
+#if H2_HAS_GPU_LOW_PRECISION
+
+// These are in the global namespace, with the types, so they are found
+// by argument-dependent lookup.
+
+/** Print a half precision value. */
+inline std::ostream& operator<<(std::ostream& os, h2::gpu::Half const& x)
+{
+  return os << static_cast<float>(x);
+}
+
+/** Print a bfloat16 value. */
+inline std::ostream& operator<<(std::ostream& os, h2::gpu::BFloat16 const& x)
+{
+  return os << static_cast<float>(x);
+}
+
+#endif  // H2_HAS_GPU_LOW_PRECISION
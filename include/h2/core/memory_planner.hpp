@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Static planning of memory reuse for buffers with known lifetimes.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/device.hpp"
+#include "h2/core/sync.hpp"
+
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace h2
+{
+
+/**
+ * The size and lifetime of a buffer to plan.
+ *
+ * Lifetimes are closed intervals `[first_use, last_use]` of abstract
+ * time steps. Buffers whose lifetimes overlap are never assigned
+ * overlapping memory.
+ */
+struct BufferLifetime
+{
+  std::size_t bytes;
+  std::size_t first_use;
+  std::size_t last_use;
+};
+
+/** An assignment of buffers to offsets in one slab. */
+struct MemoryPlan
+{
+  /** Offset, in bytes, of each buffer, in the order they were given. */
+  std::vector<std::size_t> offsets;
+  /** Bytes needed for the slab holding every buffer. */
+  std::size_t total_bytes = 0;
+};
+
+/**
+ * Compute a static offset for each buffer so that buffers with
+ * disjoint lifetimes share memory.
+ *
+ * This places buffers in order of decreasing size, each at the
+ * smallest gap between already-placed, lifetime-overlapping buffers
+ * that fits it (or after all of them). Each offset is a multiple of
+ * `alignment`.
+ */
+MemoryPlan plan_memory_reuse(std::vector<BufferLifetime> const& buffers,
+                             std::size_t alignment = 256);
+
+/**
+ * Record buffer lifetimes from a sequence of ensure and release
+ * events, e.g., over one training iteration.
+ *
+ * Each event advances a logical clock. Keys identify the object being
+ * ensured (typically the address of a `Tensor` or `DistTensor`); a key
+ * may be ensured again after being released, which starts a new
+ * buffer. Buffers that are never released live until the end.
+ */
+class MemoryPlanRecorder
+{
+public:
+  using Key = void const*;
+
+  /**
+   * Record that `key` needs `bytes` of memory from now on.
+   *
+   * Returns the index of the new buffer in the recorded lifetimes.
+   */
+  std::size_t record_ensure(Key key, std::size_t bytes);
+
+  /** Record that `key` no longer needs its memory. */
+  void record_release(Key key);
+
+  /** Return the lifetimes of all buffers recorded so far. */
+  std::vector<BufferLifetime> get_lifetimes() const;
+
+  /** Plan the recorded buffers (see `plan_memory_reuse`). */
+  MemoryPlan plan(std::size_t alignment = 256) const
+  {
+    return plan_memory_reuse(get_lifetimes(), alignment);
+  }
+
+  /** Number of buffers recorded so far. */
+  std::size_t num_buffers() const H2_NOEXCEPT { return lifetimes.size(); }
+
+  /** Discard all recorded events. */
+  void clear();
+
+private:
+  static constexpr std::size_t still_live =
+    std::numeric_limits<std::size_t>::max();
+
+  std::vector<BufferLifetime> lifetimes;
+  /** Index of the live buffer for each key. */
+  std::unordered_map<Key, std::size_t> live;
+  std::size_t clock = 0;
+};
+
+/**
+ * One allocation holding every buffer of a `MemoryPlan`.
+ *
+ * Buffers may be wrapped by tensors using their external-buffer
+ * constructors. Callers must respect the planned lifetimes: buffers
+ * sharing memory must not be in use at the same time.
+ */
+class MemorySlab
+{
+public:
+  MemorySlab(Device dev,
+             MemoryPlan plan_,
+             std::optional<ComputeStream> const stream = std::nullopt);
+
+  MemorySlab(MemorySlab const&) = delete;
+  MemorySlab& operator=(MemorySlab const&) = delete;
+
+  Device get_device() const H2_NOEXCEPT { return slab.get_device(); }
+
+  ComputeStream const& get_stream() const H2_NOEXCEPT
+  {
+    return slab.get_stream();
+  }
+
+  /** Total bytes in the slab. */
+  std::size_t size() const H2_NOEXCEPT { return slab.size(); }
+
+  /** Number of buffers in the plan. */
+  std::size_t num_buffers() const H2_NOEXCEPT { return plan.offsets.size(); }
+
+  /** Return the memory for buffer `i` of the plan. */
+  void* get(std::size_t i);
+
+  /** Return the memory for buffer `i` as a `T*`. */
+  template <typename T>
+  T* get_as(std::size_t i)
+  {
+    return static_cast<T*>(get(i));
+  }
+
+private:
+  MemoryPlan plan;
+  internal::ManagedBuffer<std::byte> slab;
+};
+
+}  // namespace h2
@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * NUMA-aware CPU memory allocation.
+ *
+ * By default, CPU buffers come from `new[]`, and their pages land on
+ * whichever NUMA node first touches them, in 4 KiB pages. With
+ * `H2_CPU_ALLOCATOR=numa`, large buffers (at least
+ * `H2_CPU_NUMA_THRESHOLD` bytes) are instead mapped directly and bound
+ * to a preferred NUMA node: the node set for the allocating thread
+ * (see `set_numa_node`, e.g., the node of the GPU it drives), or else
+ * the node the thread is running on. Buffers of at least
+ * `H2_CPU_HUGE_PAGE_THRESHOLD` bytes use huge pages, either
+ * transparent ones or, with `H2_CPU_HUGE_PAGES=explicit`, pages from
+ * the reserved huge page pool when any are free. With
+ * `H2_CPU_FIRST_TOUCH`, pages are faulted in by the CPU thread pool at
+ * allocation, rather than serially by whatever first writes them.
+ *
+ * Placement uses the Linux memory policy system calls directly, so
+ * this needs neither libnuma nor hwloc. Elsewhere the NUMA backend
+ * behaves like the default one.
+ */
+
+#include <h2_config.hpp>
+
+#include <cstddef>
+#include <ostream>
+
+namespace h2
+{
+namespace cpu
+{
+
+/** Backends for CPU memory allocations. */
+enum class AllocatorBackend
+{
+  /** `new[]`, with no control over placement. */
+  Default,
+  /** Mapped memory bound to a NUMA node, with huge pages. */
+  NUMA
+};
+
+inline std::ostream& operator<<(std::ostream& os, AllocatorBackend backend)
+{
+  switch (backend)
+  {
+  case AllocatorBackend::Default: os << "Default"; break;
+  case AllocatorBackend::NUMA: os << "NUMA"; break;
+  default: os << "Unknown"; break;
+  }
+  return os;
+}
+
+/**
+ * Return the backend H2 uses for CPU allocations.
+ *
+ * This is determined on first call and is fixed thereafter, since
+ * memory must be returned to the backend it came from.
+ *
+ * Environment variable: H2_CPU_ALLOCATOR ("default" or "numa")
+ */
+AllocatorBackend allocator_backend();
+
+/**
+ * Return the NUMA node of the CPU the calling thread is running on, or
+ * -1 if this is not known.
+ */
+int get_current_numa_node() noexcept;
+
+#ifdef H2_HAS_GPU
+/**
+ * Return the NUMA node GPU `gpu_id` is attached to, or -1 if this is
+ * not known (e.g., on single-node systems).
+ */
+int get_gpu_numa_node(int gpu_id);
+#endif
+
+/**
+ * Return the NUMA node the calling thread's CPU allocations are bound
+ * to, or -1 if they follow the node it is running on.
+ */
+int get_numa_node() noexcept;
+
+/**
+ * Bind the calling thread's subsequent CPU allocations to NUMA node
+ * `node`, or to the node it is running on if `node` is -1.
+ *
+ * This only affects allocations from the NUMA backend.
+ */
+void set_numa_node(int node) noexcept;
+
+/** Bind the calling thread's CPU allocations to a node while in scope. */
+class NumaNodeGuard
+{
+public:
+  explicit NumaNodeGuard(int node) noexcept : prev_node(get_numa_node())
+  {
+    set_numa_node(node);
+  }
+
+  ~NumaNodeGuard() { set_numa_node(prev_node); }
+
+  NumaNodeGuard(NumaNodeGuard const&) = delete;
+  NumaNodeGuard& operator=(NumaNodeGuard const&) = delete;
+
+private:
+  int prev_node;
+};
+
+namespace internal
+{
+
+/**
+ * Allocate `bytes` of CPU memory from the NUMA backend.
+ *
+ * The memory is aligned to at least `alignof(std::max_align_t)`.
+ */
+void* numa_allocate(std::size_t bytes);
+
+/** Return memory from `numa_allocate`. */
+void numa_deallocate(void* ptr);
+
+}  // namespace internal
+
+}  // namespace cpu
+}  // namespace h2
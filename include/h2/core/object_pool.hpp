@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Thread-local pools for small, frequently allocated objects.
+ *
+ * Views, casts, and interop conversions each allocate a `Tensor` or
+ * `DistTensor`, and often a `RawBuffer` with its `shared_ptr` control
+ * block. These are small, but at tens of thousands per second they
+ * contend in `malloc`. Pooled objects instead come from per-thread
+ * freelists of fixed-size blocks, which need no locking.
+ *
+ * Blocks freed on a different thread than they were allocated on join
+ * the freeing thread's freelist. Each freelist caches at most
+ * `H2_OBJECT_POOL_SIZE` blocks (0 disables pooling), and the rest, and
+ * objects larger than `max_pooled_object_size`, go to the global heap.
+ * Cached blocks are released when their thread exits.
+ */
+
+#include <h2_config.hpp>
+
+#include <cstddef>
+#include <new>
+
+namespace h2
+{
+namespace internal
+{
+
+/** Pooled objects are rounded up to a multiple of this size. */
+inline constexpr std::size_t pool_size_class_bytes = 64;
+
+/** Objects larger than this are not pooled. */
+inline constexpr std::size_t max_pooled_object_size = 2048;
+
+/**
+ * Allocate `bytes` from the calling thread's pool.
+ *
+ * The memory is suitably aligned for any type without extended
+ * alignment, and must be freed with `pool_deallocate` and the same
+ * `bytes`.
+ */
+void* pool_allocate(std::size_t bytes);
+
+/** Return `ptr`, allocated by `pool_allocate(bytes)`, to the pool. */
+void pool_deallocate(void* ptr, std::size_t bytes) noexcept;
+
+/**
+ * Return the number of blocks cached in the calling thread's pool.
+ *
+ * This is mainly for testing.
+ */
+std::size_t pool_num_cached() noexcept;
+
+/**
+ * Standard allocator drawing single objects from the object pool.
+ *
+ * This is meant for `std::allocate_shared`, so the object and its
+ * control block are pooled together. Arrays go to the global heap.
+ */
+template <typename T>
+class PoolAllocator
+{
+public:
+  using value_type = T;
+
+  PoolAllocator() noexcept = default;
+
+  template <typename U>
+  PoolAllocator(PoolAllocator<U> const&) noexcept
+  {}
+
+  T* allocate(std::size_t n)
+  {
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+                  "Pooled objects cannot have extended alignment");
+    if (n == 1)
+    {
+      return static_cast<T*>(pool_allocate(sizeof(T)));
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, std::size_t n) noexcept
+  {
+    if (n == 1)
+    {
+      pool_deallocate(ptr, sizeof(T));
+    }
+    else
+    {
+      ::operator delete(ptr);
+    }
+  }
+
+  template <typename U>
+  bool operator==(PoolAllocator<U> const&) const noexcept
+  {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(PoolAllocator<U> const&) const noexcept
+  {
+    return false;
+  }
+};
+
+}  // namespace internal
+}  // namespace h2
@@ -0,0 +1,149 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Profiler annotations for H2 operations.
+ *
+ * When H2 is built with `H2_ENABLE_PROFILING`, `H2_PROFILE_RANGE`
+ * marks the enclosing scope as a named NVTX (CUDA) or ROCTX (ROCm)
+ * range, so H2 work can be attributed in, e.g., Nsight Systems. NVTX
+ * ranges are in the "h2" domain and tagged with their category; ROCTX
+ * has neither, so its ranges are prefixed with "h2:<category>:".
+ *
+ * Which categories are emitted is controlled at runtime by the
+ * `H2_PROFILING` environment variable. Otherwise, `H2_PROFILE_RANGE`
+ * compiles to nothing.
+ */
+
+#include <h2_config.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace h2
+{
+
+/** Categories of profiled H2 operations. */
+enum class ProfileCategory : std::uint32_t
+{
+  /** Copying buffers and tensors. */
+  Copy = 1,
+  /** Element-wise loops and other kernels. */
+  Compute,
+  /** Allocating and releasing memory. */
+  Memory,
+  /** Communication. */
+  Comm,
+  /** Dynamic dispatch. */
+  Dispatch
+};
+
+/** Number of profile categories. */
+constexpr std::uint32_t num_profile_categories = 5;
+
+/** Return the lowercase name of a profile category. */
+char const* get_profile_category_name(ProfileCategory category);
+
+inline std::ostream& operator<<(std::ostream& os, ProfileCategory category)
+{
+  os << get_profile_category_name(category);
+  return os;
+}
+
+namespace internal
+{
+
+/**
+ * Return the mask of profile categories named in `categories`.
+ *
+ * This is "all", "none" (or empty), or a comma-separated list of
+ * category names; bit `c` of the result is set for category `c`.
+ */
+std::uint32_t parse_profile_categories(std::string const& categories);
+
+/** Return the mask of categories enabled by `H2_PROFILING`. */
+std::uint32_t get_enabled_profile_categories();
+
+/** Start a profiler range. */
+void profile_range_push(char const* name, ProfileCategory category);
+
+/** End the most recent profiler range on this thread. */
+void profile_range_pop();
+
+}  // namespace internal
+
+/**
+ * Return true if profiler ranges in `category` are emitted.
+ *
+ * This is always false when H2 is built without profiling support.
+ */
+inline bool profiling_enabled(ProfileCategory category)
+{
+#if H2_HAS_PROFILING
+  static std::uint32_t const enabled =
+    internal::get_enabled_profile_categories();
+  return enabled & (std::uint32_t{1} << static_cast<std::uint32_t>(category));
+#else
+  static_cast<void>(category);
+  return false;
+#endif
+}
+
+/**
+ * Profiler range covering the lifetime of the object.
+ *
+ * Prefer `H2_PROFILE_RANGE`, which compiles away when profiling is
+ * not enabled. `name` must outlive the range.
+ */
+class ProfileRange
+{
+public:
+  ProfileRange(char const* name, ProfileCategory category)
+    : active(profiling_enabled(category))
+  {
+    if (active)
+    {
+      internal::profile_range_push(name, category);
+    }
+  }
+
+  ~ProfileRange()
+  {
+    if (active)
+    {
+      internal::profile_range_pop();
+    }
+  }
+
+  ProfileRange(ProfileRange const&) = delete;
+  ProfileRange& operator=(ProfileRange const&) = delete;
+
+private:
+  bool active;
+};
+
+}  // namespace h2
+
+#define H2_PROFILE_CONCAT_IMPL(a, b) a##b
+#define H2_PROFILE_CONCAT(a, b) H2_PROFILE_CONCAT_IMPL(a, b)
+
+/**
+ * Mark the rest of the enclosing scope as a profiler range named
+ * `name` in category `category` (a `ProfileCategory` member name,
+ * e.g., `Copy`).
+ */
+#if H2_HAS_PROFILING
+#define H2_PROFILE_RANGE(name, category)                                       \
+  ::h2::ProfileRange H2_PROFILE_CONCAT(h2_profile_range_, __LINE__)(           \
+    name, ::h2::ProfileCategory::category)
+#else
+#define H2_PROFILE_RANGE(name, category) static_cast<void>(0)
+#endif
@@ -0,0 +1,174 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Asynchronous readback of small values (losses, norms, flags) from a
+ * device without synchronizing the host with it.
+ *
+ * A `ScalarReadbackRing` owns a ring of small slots in pinned host
+ * memory. `read` enqueues a copy of a value into the next slot on a
+ * stream and records an event, returning a `ScalarReadback` handle
+ * that can be polled (`ready`) or waited on (`get`). Slots are reused
+ * round-robin, so a handle must be read before its ring wraps around
+ * to its slot again.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#ifdef H2_HAS_GPU
+#include "h2/gpu/memory_utils.hpp"
+#endif
+
+namespace h2
+{
+
+template <typename T>
+class ScalarReadback;
+
+/** A ring of pinned host slots for asynchronous readback of values. */
+class ScalarReadbackRing
+{
+public:
+  /** Maximum size of a value that can be read back. */
+  static constexpr std::size_t slot_bytes = 16;
+
+  /** Create a ring of `num_slots` slots for reading from `device`. */
+  ScalarReadbackRing(Device device, std::size_t num_slots = 64);
+  ~ScalarReadbackRing();
+
+  ScalarReadbackRing(ScalarReadbackRing const&) = delete;
+  ScalarReadbackRing& operator=(ScalarReadbackRing const&) = delete;
+
+  /** Return the device values are read from. */
+  Device get_device() const H2_NOEXCEPT { return device; }
+
+  /** Return the number of slots in the ring. */
+  std::size_t num_slots() const H2_NOEXCEPT { return slots.size(); }
+
+  /**
+   * Enqueue a copy of the value at `src` to the host on `stream`.
+   *
+   * `src` must be in memory accessible on `stream`'s device, which
+   * must be this ring's device. This does not wait for `stream`.
+   */
+  template <typename T>
+  ScalarReadback<T> read(T const* src, ComputeStream const& stream)
+  {
+    static_assert(sizeof(T) <= slot_bytes,
+                  "Value is too large for a readback slot");
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Readback values must be trivially copyable");
+    H2_ASSERT_ALWAYS(stream.get_device() == device,
+                     "Cannot read back from a ",
+                     stream.get_device(),
+                     " stream with a ",
+                     device,
+                     " readback ring");
+    std::size_t const slot = acquire_slot();
+    void* dst = get_slot_buf(slot);
+    H2_DEVICE_DISPATCH(
+      device,
+      enqueue_cpu_task(stream,
+                       [dst, src]() { std::memcpy(dst, src, sizeof(T)); }),
+      gpu::mem_copy(dst, src, sizeof(T), stream.get_stream<Device::GPU>()));
+    stream.add_sync_point(slots[slot].event);
+    return ScalarReadback<T>(this, slot, slots[slot].generation);
+  }
+
+private:
+  struct Slot
+  {
+    /** Recorded after the copy into the slot. */
+    SyncEvent event;
+    /** Incremented each time the slot is reused. */
+    std::uint64_t generation;
+  };
+
+  Device device;
+  /** Pinned host memory for all slots. */
+  void* host_buf;
+  std::vector<Slot> slots;
+  std::size_t next_slot = 0;
+
+  /**
+   * Return the index of the next slot, waiting for any copy still
+   * writing to it.
+   */
+  std::size_t acquire_slot();
+
+  void* get_slot_buf(std::size_t slot) const H2_NOEXCEPT
+  {
+    return static_cast<unsigned char*>(host_buf) + slot * slot_bytes;
+  }
+
+  template <typename T>
+  friend class ScalarReadback;
+};
+
+/**
+ * Future-like handle to a value being read back by a
+ * `ScalarReadbackRing`.
+ *
+ * The ring must outlive the handle.
+ */
+template <typename T>
+class ScalarReadback
+{
+public:
+  /** Return whether the value has arrived, without blocking. */
+  bool ready() const
+  {
+    check_valid();
+    return ring->slots[slot].event.is_complete();
+  }
+
+  /** Wait for the value to arrive and return it. */
+  T get() const
+  {
+    check_valid();
+    ring->slots[slot].event.wait_for_this();
+    T val;
+    std::memcpy(&val, ring->get_slot_buf(slot), sizeof(T));
+    return val;
+  }
+
+private:
+  ScalarReadbackRing const* ring;
+  std::size_t slot;
+  std::uint64_t generation;
+
+  ScalarReadback(ScalarReadbackRing const* ring_,
+                 std::size_t slot_,
+                 std::uint64_t generation_)
+    : ring(ring_), slot(slot_), generation(generation_)
+  {}
+
+  void check_valid() const
+  {
+    H2_ASSERT_ALWAYS(ring->slots[slot].generation == generation,
+                     "Readback slot ",
+                     slot,
+                     " was reused before its value was read");
+  }
+
+  friend class ScalarReadbackRing;
+};
+
+}  // namespace h2
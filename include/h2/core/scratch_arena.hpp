@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Bump allocation for short-lived temporary buffers.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/device.hpp"
+#include "h2/core/sync.hpp"
+
+#include <cstddef>
+#include <optional>
+
+namespace h2
+{
+
+/**
+ * A fixed-capacity region of memory that hands out buffers by bumping
+ * a pointer.
+ *
+ * An arena is not used directly. Instead, a `ScratchArenaScope` makes
+ * it the current arena for its device on the calling thread, and all
+ * `RawBuffer`s (and hence `Tensor`s) allocated on that device within
+ * the scope draw their memory from it. When the scope exits, the arena
+ * is rewound to where it was when the scope was entered.
+ *
+ * This is meant for glue code that creates many transient tensors,
+ * e.g., via `cast` or `make_accessible_on_device`, which are destroyed
+ * before the scope ends. Every buffer allocated from the arena within
+ * a scope must be released before the scope exits.
+ *
+ * If a request does not fit in the remaining capacity, it falls back
+ * to the regular allocator.
+ *
+ * Arena memory is reused in the order of the arena's stream: when a
+ * buffer on another stream is released, the arena's stream waits for
+ * that stream, so later reuse cannot race with pending work.
+ */
+class ScratchArena
+{
+public:
+  /** Alignment, in bytes, of every buffer handed out. */
+  static constexpr std::size_t alignment = 256;
+
+  ScratchArena(Device dev,
+               std::size_t capacity_,
+               std::optional<ComputeStream> const stream_ = std::nullopt);
+
+  ScratchArena(ScratchArena const&) = delete;
+  ScratchArena& operator=(ScratchArena const&) = delete;
+
+  Device get_device() const H2_NOEXCEPT { return buf.get_device(); }
+
+  ComputeStream const& get_stream() const H2_NOEXCEPT
+  {
+    return buf.get_stream();
+  }
+
+  /** Total bytes the arena may hand out. */
+  std::size_t capacity() const H2_NOEXCEPT { return buf.size(); }
+
+  /** Bytes currently handed out. */
+  std::size_t used() const H2_NOEXCEPT { return offset; }
+
+  /** Maximum of `used()` over the arena's lifetime. */
+  std::size_t high_water_mark() const H2_NOEXCEPT { return peak_offset; }
+
+  /** Number of requests that did not fit and used the regular allocator. */
+  std::size_t num_fallbacks() const H2_NOEXCEPT { return fallbacks; }
+
+  /** Number of buffers from the arena that have not been released. */
+  std::size_t num_live() const H2_NOEXCEPT { return live; }
+
+  /**
+   * Return `bytes` of memory from the arena, or null if there is not
+   * enough space.
+   */
+  void* allocate(std::size_t bytes);
+
+  /**
+   * Release a buffer from `allocate` that was last used on `stream`.
+   *
+   * The memory is not reused until the enclosing scope is rewound.
+   */
+  void deallocate(void* ptr, ComputeStream const& stream);
+
+private:
+  internal::ManagedBuffer<std::byte> buf; /**< Backing memory. */
+  std::size_t offset;                     /**< Current bump offset. */
+  std::size_t peak_offset;                /**< High-water mark. */
+  std::size_t live;                       /**< Unreleased buffers. */
+  std::size_t fallbacks;                  /**< Requests that overflowed. */
+
+  friend class ScratchArenaScope;
+};
+
+/**
+ * Make an arena the current arena for its device on this thread.
+ *
+ * Scopes may be nested (including on the same arena); only the
+ * innermost scope for each device is used.
+ */
+class ScratchArenaScope
+{
+public:
+  explicit ScratchArenaScope(ScratchArena& arena_);
+  ~ScratchArenaScope();
+
+  ScratchArenaScope(ScratchArenaScope const&) = delete;
+  ScratchArenaScope& operator=(ScratchArenaScope const&) = delete;
+
+private:
+  ScratchArena& arena;         /**< Arena this scope manages. */
+  ScratchArena* prev_arena;    /**< Prior current arena for the device. */
+  std::size_t start_offset;    /**< Arena offset on entry. */
+  std::size_t start_live;      /**< Live buffers on entry. */
+};
+
+namespace internal
+{
+
+/** Return the current arena for `dev` on this thread, or null. */
+ScratchArena* get_current_arena(Device dev) H2_NOEXCEPT;
+
+}  // namespace internal
+
+}  // namespace h2
@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * A caching allocator with configurable size classes and block
+ * splitting.
+ */
+
+#include <h2_config.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace h2
+{
+namespace internal
+{
+
+/**
+ * Rounding policy for `SizeClassAllocator`.
+ *
+ * Requests smaller than `linear_threshold` are rounded up to the next
+ * power of two (but at least `min_block_size`). Larger requests are
+ * rounded up to a multiple of `linear_step`, which bounds the memory
+ * lost to rounding by `linear_step` rather than by the request size.
+ *
+ * Requests of at least `linear_threshold` bytes are "large": they are
+ * carved from segments obtained from the underlying allocator, may be
+ * split from larger free blocks, and are coalesced with free neighbors
+ * when released.
+ */
+struct SizeClassPolicy
+{
+  std::size_t min_block_size = 512;
+  std::size_t linear_threshold = std::size_t{1} << 20;
+  std::size_t linear_step = std::size_t{128} << 10;
+
+  /** Return the size of the block used to satisfy `bytes`. */
+  std::size_t round(std::size_t bytes) const;
+};
+
+/**
+ * A thread-safe caching allocator on top of raw allocation functions.
+ *
+ * Memory is cached per stream: a freed block is only handed out again
+ * to requests on the stream it was freed on, which keeps reuse
+ * stream-ordered without events. Streams are opaque keys.
+ *
+ * If the raw allocator fails (returns null), all unused cached memory
+ * is returned to it and the allocation is retried once.
+ */
+class SizeClassAllocator
+{
+public:
+  using StreamKey = void const*;
+  using RawAllocFn = std::function<void*(std::size_t)>;
+  using RawFreeFn = std::function<void(void*)>;
+
+  SizeClassAllocator(RawAllocFn raw_alloc_,
+                     RawFreeFn raw_free_,
+                     SizeClassPolicy policy_ = SizeClassPolicy{});
+  ~SizeClassAllocator();
+
+  SizeClassAllocator(SizeClassAllocator const&) = delete;
+  SizeClassAllocator& operator=(SizeClassAllocator const&) = delete;
+
+  /** Allocate at least `bytes` for use on `stream`. */
+  void* allocate(std::size_t bytes, StreamKey stream);
+
+  /** Return memory from `allocate` to the cache. */
+  void deallocate(void* ptr);
+
+  /**
+   * Return all unused cached memory to the underlying allocator.
+   *
+   * Large segments are only returned if none of their blocks are in
+   * use. The caller must ensure no pending work uses cached memory.
+   */
+  void trim();
+
+  /** Bytes held by the cache that are not in use. */
+  std::size_t cached_bytes() const;
+
+  /** Bytes handed out and not yet returned. */
+  std::size_t allocated_bytes() const;
+
+  /** Bytes currently obtained from the underlying allocator. */
+  std::size_t reserved_bytes() const;
+
+  SizeClassPolicy const& get_policy() const noexcept { return policy; }
+
+private:
+  /** A chunk of a segment obtained from the raw allocator. */
+  struct Block
+  {
+    char* ptr;
+    std::size_t size;
+    StreamKey stream;
+    bool in_use;
+    Block* prev; /**< Adjacent block before this in its segment. */
+    Block* next; /**< Adjacent block after this in its segment. */
+  };
+
+  /** Order free large blocks for best-fit lookup. */
+  struct BlockCompare
+  {
+    bool operator()(Block const* a, Block const* b) const noexcept
+    {
+      if (a->stream != b->stream)
+      {
+        return a->stream < b->stream;
+      }
+      if (a->size != b->size)
+      {
+        return a->size < b->size;
+      }
+      return a->ptr < b->ptr;
+    }
+  };
+
+  RawAllocFn raw_alloc;
+  RawFreeFn raw_free;
+  SizeClassPolicy policy;
+
+  mutable std::mutex mutex;
+  /** Free small blocks, by stream and block size. */
+  std::map<std::pair<StreamKey, std::size_t>, std::vector<void*>> small_free;
+  /** Size and stream of every small block handed out, by pointer. */
+  std::unordered_map<void*, std::pair<std::size_t, StreamKey>> small_in_use;
+  /** Free large blocks. */
+  std::set<Block*, BlockCompare> large_free;
+  /** Large blocks handed out, by pointer. */
+  std::unordered_map<void*, Block*> large_in_use;
+
+  std::size_t num_cached_bytes = 0;
+  std::size_t num_allocated_bytes = 0;
+  std::size_t num_reserved_bytes = 0;
+
+  void* allocate_small(std::size_t size, StreamKey stream);
+  void* allocate_large(std::size_t size, StreamKey stream);
+  void free_large(Block* block);
+  /** Allocate from the raw allocator, trimming and retrying on failure. */
+  void* raw_alloc_with_retry(std::size_t size);
+  /** Assumes the caller holds the mutex. */
+  void trim_unlocked();
+};
+
+}  // namespace internal
+}  // namespace h2
@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Pools of reusable compute streams with priorities.
+ *
+ * Rather than creating streams for each operation, code that wants to
+ * overlap work (e.g., halo exchanges or allreduces with computation)
+ * should take streams from a pool. Each GPU has a fixed number
+ * (`H2_STREAM_POOL_SIZE`) of streams for each priority, which are
+ * created on first use and handed out round-robin. Communication
+ * kernels should use high-priority streams so they are scheduled
+ * ahead of computation on normal-priority streams.
+ *
+ * Pool streams are owned by the pool and live until the program
+ * exits; they must not be destroyed. Pool streams do not synchronize
+ * with the legacy default stream. On CPUs, the pool returns the
+ * default CPU stream.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+#include "h2/core/sync.hpp"
+
+#include <cstddef>
+#include <ostream>
+
+namespace h2
+{
+
+/** Priority of a pooled compute stream. */
+enum class StreamPriority
+{
+  Normal,
+  High
+};
+
+/** Support printing stream priorities. */
+inline std::ostream& operator<<(std::ostream& os, StreamPriority priority)
+{
+  switch (priority)
+  {
+  case StreamPriority::Normal: os << "normal"; break;
+  case StreamPriority::High: os << "high"; break;
+  default: os << "unknown"; break;
+  }
+  return os;
+}
+
+#ifdef H2_HAS_GPU
+namespace internal
+{
+
+/** Return the next pool stream for the current GPU. */
+ComputeStream get_gpu_pool_stream(StreamPriority priority);
+
+/** Return the `idx`'th pool stream for the current GPU. */
+ComputeStream get_gpu_pool_stream(StreamPriority priority, std::size_t idx);
+
+}  // namespace internal
+#endif  // H2_HAS_GPU
+
+/** Return the number of streams of each priority in each pool. */
+std::size_t get_stream_pool_size();
+
+/**
+ * Return the next stream with the given priority from `Dev`'s pool.
+ *
+ * Successive calls cycle through the pool.
+ */
+template <Device Dev>
+inline ComputeStream
+get_pool_stream(StreamPriority priority = StreamPriority::Normal)
+{
+  H2_DEVICE_DISPATCH_CONST(Dev,
+                           return ComputeStream{Dev},
+                           return internal::get_gpu_pool_stream(priority));
+}
+
+inline ComputeStream
+get_pool_stream(Device device,
+                StreamPriority priority = StreamPriority::Normal)
+{
+  H2_DEVICE_DISPATCH_SAME(device, return get_pool_stream<Dev>(priority));
+}
+
+/**
+ * Return the `idx`'th stream (modulo the pool size) with the given
+ * priority from `Dev`'s pool.
+ *
+ * This allows callers to consistently use the same streams.
+ */
+template <Device Dev>
+inline ComputeStream get_pool_stream(StreamPriority priority, std::size_t idx)
+{
+  H2_DEVICE_DISPATCH_CONST(
+    Dev,
+    return ComputeStream{Dev},
+    return internal::get_gpu_pool_stream(priority, idx));
+}
+
+inline ComputeStream
+get_pool_stream(Device device, StreamPriority priority, std::size_t idx)
+{
+  H2_DEVICE_DISPATCH_SAME(device, return get_pool_stream<Dev>(priority, idx));
+}
+
+}  // namespace h2
@@ -19,18 +19,18 @@
 
 #include <El.hpp>
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
 #include <tuple>
 #include <utility>
 
 #ifdef H2_HAS_GPU
+#include "h2/gpu/event_pool.hpp"
 #include "h2/gpu/runtime.hpp"
-
-// We use Aluminum's internal event pool for GPU events.
-#ifndef HYDROGEN_HAVE_ALUMINUM
-#error "Aluminum support is required"
-#endif
-#include <Al.hpp>
-
 #endif
 
 namespace h2
@@ -103,6 +103,19 @@ namespace h2
  * An implementation note (separate from the above semantics):
  * ComputeStream objects are stored in StridedMemory, rather than
  * directly in a Tensor. This is just to simplify implementation.
+ *
+ * A note on concurrency: H2 may be used from multiple host threads at
+ * once. Process-wide state is synchronized: dispatch registration and
+ * lookup, the default GPU streams, the GPU memory pools and their
+ * lazily-created allocators, the event pools, stream trackers, and
+ * asynchronous CPU streams and events may all be used concurrently.
+ * Tensors and ComputeStreams themselves are not synchronized: distinct
+ * Tensors (including views of the same data) may be used concurrently,
+ * but a Tensor must not be modified while another thread uses it, and
+ * threads sharing data must order their work as with any other
+ * streams. By default, every thread uses the same default stream on a
+ * GPU, which serializes their work; `ThreadDefaultStreamGuard` gives a
+ * thread its own.
  */
 
 namespace internal
@@ -126,18 +139,15 @@ struct RawSyncEvent<Device::GPU>
   using type = gpu::DeviceEvent;
 };
 
-static_assert(std::is_same_v<AlGpuEvent_t, gpu::DeviceEvent>,
-              "Aluminum GPU events are not DeviceEvents");
-
-// Wrap Aluminum's internal event pool.
+// Events are recycled through the per-device event pool.
 inline gpu::DeviceEvent get_new_device_event()
 {
-  return Al::internal::cuda::event_pool.get();
+  return gpu::get_pooled_event();
 }
 
 inline void release_device_event(gpu::DeviceEvent event)
 {
-  Al::internal::cuda::event_pool.release(event);
+  gpu::release_pooled_event(event);
 }
 
 #endif  // H2_HAS_GPU
@@ -207,6 +217,160 @@ get_default_compute_stream<Device::GPU>()
 }
 #endif
 
+// Asynchronous CPU streams and events:
+//
+// CPU streams and events are identified by integers. 0 is the default
+// synchronous stream, and the default event, which is always complete.
+// Other ids refer to a queue run by a worker thread, or an event that
+// tracks work on such a queue.
+
+/** Create the queue for a new asynchronous CPU stream, returning its id. */
+int create_async_cpu_stream();
+
+/** Wait for all work on an asynchronous CPU stream, then destroy it. */
+void destroy_async_cpu_stream(int stream);
+
+/** Create a new asynchronous CPU event, returning its id. */
+int create_async_cpu_event();
+
+/** Destroy an asynchronous CPU event. */
+void destroy_async_cpu_event(int event);
+
+/** Enqueue `task` on a CPU stream (running it now on the default). */
+void enqueue_cpu_task(int stream, std::function<void()> task);
+
+/** Record the work currently enqueued on a CPU stream in `event`. */
+void record_cpu_event(int event, int stream);
+
+/** Block the caller until all work recorded in `event` completes. */
+void wait_for_cpu_event(int event);
+
+/** Return whether all work recorded in `event` has completed. */
+bool query_cpu_event(int event);
+
+/**
+ * Block the caller until all work currently enqueued on `stream`
+ * completes.
+ *
+ * If `rethrow` is true, this rethrows the first exception thrown by a
+ * task on the stream, if any.
+ */
+void wait_for_cpu_stream(int stream, bool rethrow = false);
+
+/** Have a CPU stream wait for a CPU event. */
+void cpu_stream_wait_for_cpu_event(int stream, int event);
+
+/** Have a CPU stream wait for the work enqueued on another. */
+void cpu_stream_wait_for_cpu_stream(int stream, int other);
+
+#ifdef H2_HAS_GPU
+/** Have an asynchronous CPU stream wait for a GPU event. */
+void cpu_stream_wait_for_gpu_event(int stream, gpu::DeviceEvent event);
+
+/**
+ * Have an asynchronous CPU stream wait for work on a GPU stream, which
+ * is on GPU `device`.
+ */
+void cpu_stream_wait_for_gpu_stream(int stream,
+                                    gpu::DeviceStream other,
+                                    int device);
+
+/**
+ * Return the default stream for GPU `device`.
+ *
+ * This is Hydrogen's default stream for the GPU selected by the
+ * runtime (see `gpu::selected_gpu`). Other GPUs get a stream created
+ * on first use, which lives until the process exits.
+ */
+gpu::DeviceStream get_default_gpu_stream(int device);
+#endif  // H2_HAS_GPU
+
+#ifdef H2_HAS_GPU
+
+/**
+ * Tracks work submitted to a GPU stream created by H2, so that
+ * redundant cross-stream waits can be skipped.
+ *
+ * The stream's epoch is incremented whenever its raw stream is
+ * obtained (which is necessary to submit work to it), so if a stream's
+ * epoch has not changed since another stream last waited on it, that
+ * other stream need not wait again. Epochs only ever increase, even
+ * when trackers are reused for new streams.
+ */
+struct StreamTracker
+{
+  /** A stream this stream waited on, and its epoch at the time. */
+  struct WaitRecord
+  {
+    StreamTracker const* stream = nullptr;
+    std::uint64_t epoch = 0;
+  };
+
+  static constexpr std::size_t num_wait_records = 8;
+
+  /** Incremented whenever the raw stream is accessed. */
+  std::atomic<std::uint64_t> epoch{0};
+
+  /** Protects `waits` and `next_wait`. */
+  std::mutex mutex;
+  /** The most recent waits on other streams. */
+  std::array<WaitRecord, num_wait_records> waits;
+  /** Next entry in `waits` to be replaced. */
+  std::size_t next_wait = 0;
+};
+
+/** Begin tracking work on `stream`, which was just created. */
+void start_tracking_stream(gpu::DeviceStream stream);
+
+/** Stop tracking work on `stream`, which is being destroyed. */
+void stop_tracking_stream(gpu::DeviceStream stream);
+
+/**
+ * Return the tracker for `stream`, or null if `stream` was not created
+ * by H2 and so is not tracked.
+ */
+StreamTracker* find_stream_tracker(gpu::DeviceStream stream);
+
+/**
+ * Return whether `waiter` has already waited on `src` since `src`
+ * reached `src_epoch`.
+ */
+bool stream_wait_is_satisfied(StreamTracker* waiter,
+                              StreamTracker const* src,
+                              std::uint64_t src_epoch);
+
+/** Note that `waiter` waited on `src` when `src` was at `src_epoch`. */
+void record_stream_wait(StreamTracker* waiter,
+                        StreamTracker const* src,
+                        std::uint64_t src_epoch);
+
+/** A thread's default stream for a GPU, and its tracker (if any). */
+struct ThreadDefaultGPUStream
+{
+  gpu::DeviceStream stream = nullptr;
+  StreamTracker* tracker = nullptr;
+};
+
+/** Maximum GPU ordinal, plus one, that may have per-thread streams. */
+inline constexpr int max_thread_default_gpus = 16;
+
+/**
+ * Return the calling thread's default stream for GPU `device`.
+ *
+ * This is the stream set with `ThreadDefaultStreamGuard`, if any, and
+ * otherwise the process-wide default (`get_default_gpu_stream`).
+ */
+ThreadDefaultGPUStream get_thread_default_gpu_stream(int device);
+
+/**
+ * Set the calling thread's default stream for GPU `device`, returning
+ * the previous one. A null stream restores the process-wide default.
+ */
+ThreadDefaultGPUStream
+exchange_thread_default_gpu_stream(int device, ThreadDefaultGPUStream stream);
+
+#endif  // H2_HAS_GPU
+
 }  // namespace internal
 
 // Forward-declarations:
@@ -222,7 +386,9 @@ inline void destroy_compute_stream(ComputeStream&);
  *
  * These are used to synchronize between ComputeStreams.
  *
- * On CPUs, these do nothing. On GPUs, these correspond to events.
+ * On CPUs, the default event is always complete, and asynchronous CPU
+ * events track work on asynchronous CPU streams. On GPUs, these
+ * correspond to events.
  */
 class SyncEvent
 {
@@ -268,8 +434,8 @@ public:
   /**
    * Wait for all work currently recorded by the event to complete.
    *
-   * This does nothing if this is a CPU event. If this is a GPU event,
-   * the caller will wait for it.
+   * The caller will wait for the work recorded by the event. This does
+   * nothing for the default CPU event.
    */
   void wait_for_this() const
   {
@@ -281,7 +447,30 @@ public:
   {
     H2_ASSERT_DEBUG(
       Dev == device, "Incorrect device ", Dev, " (expected ", device, ")");
-    H2_DEVICE_DISPATCH_CONST(Dev, (void) 0, gpu::sync(gpu_event));
+    H2_DEVICE_DISPATCH_CONST(Dev,
+                             internal::wait_for_cpu_event(cpu_event),
+                             gpu::sync(gpu_event));
+  }
+
+  /**
+   * Return whether all work currently recorded by the event has
+   * completed, without blocking.
+   *
+   * This is always true for the default CPU event.
+   */
+  bool is_complete() const
+  {
+    H2_DEVICE_DISPATCH_SAME(device, return is_complete<Dev>());
+  }
+
+  template <Device Dev>
+  bool is_complete() const
+  {
+    H2_ASSERT_DEBUG(
+      Dev == device, "Incorrect device ", Dev, " (expected ", device, ")");
+    H2_DEVICE_DISPATCH_CONST(Dev,
+                             return internal::query_cpu_event(cpu_event),
+                             return gpu::query(gpu_event));
   }
 
   /** Return the underlying raw event for the device. */
@@ -305,10 +494,9 @@ private:
 #endif
   };
 
-#ifdef H2_HAS_GPU
   template <Device D>
   friend void destroy_sync_event(SyncEvent&);
-#endif
+  friend SyncEvent create_new_async_cpu_event();
 };
 
 /** Support printing synchronization events. */
@@ -328,9 +516,9 @@ inline bool operator==(SyncEvent const& event1,
   {
     return false;
   }
-  H2_DEVICE_DISPATCH(event1.get_device(),
-                     return true,
-                     return event1.get_event<Dev>() == event2.get_event<Dev>());
+  H2_DEVICE_DISPATCH_SAME(
+    event1.get_device(),
+    return event1.get_event<Dev>() == event2.get_event<Dev>());
 }
 
 /** Inequality for synchronization events. */
@@ -341,9 +529,9 @@ inline bool operator!=(SyncEvent const& event1,
   {
     return true;
   }
-  H2_DEVICE_DISPATCH(event1.get_device(),
-                     return false,
-                     return event1.get_event<Dev>() != event2.get_event<Dev>());
+  H2_DEVICE_DISPATCH_SAME(
+    event1.get_device(),
+    return event1.get_event<Dev>() != event2.get_event<Dev>());
 }
 
 /** Create a fresh synchronization event for a particular device. */
@@ -365,7 +553,12 @@ template <Device Dev>
 inline void destroy_sync_event(SyncEvent& event)
 {
   H2_DEVICE_DISPATCH_CONST(
-    Dev, (void) event, if (event.gpu_event != nullptr) {
+    Dev,
+    if (event.cpu_event != 0) {
+      internal::destroy_async_cpu_event(event.cpu_event);
+      event.cpu_event = 0;
+    },
+    if (event.gpu_event != nullptr) {
       internal::release_device_event(event.gpu_event);
       event.gpu_event = nullptr;
     });
@@ -376,6 +569,19 @@ inline void destroy_sync_event(SyncEvent& event)
   H2_DEVICE_DISPATCH_SAME(event.get_device(), destroy_sync_event<Dev>(event));
 }
 
+/**
+ * Create a new event for use with asynchronous CPU streams.
+ *
+ * Unlike the default CPU event, recording this on an asynchronous CPU
+ * stream does not block. Destroy it with `destroy_sync_event`.
+ */
+inline SyncEvent create_new_async_cpu_event()
+{
+  SyncEvent event{Device::CPU};
+  event.cpu_event = internal::create_async_cpu_event();
+  return event;
+}
+
 /**
  * RAII manager for events.
  *
@@ -418,43 +624,83 @@ public:
  * use by device-specific code. These are wrappers and do not directly
  * manage resources.
  *
- * On CPUs, these are empty, as we currently assume a single-threaded,
- * synchronous model. On GPUs, these correspond to streams.
+ * On CPUs, the default stream is synchronous: work runs on the caller.
+ * Asynchronous CPU streams (see `create_new_async_cpu_stream`) run
+ * tasks in order on a worker thread. On GPUs, these correspond to
+ * streams.
  *
  * Currently, we operate with the following semantics:
- * - CPU streams are inherently ordered, so there is no synchronization
- * between them.
- * - A GPU stream is inherently ordered with respect to itself and so
+ * - The default CPU stream is inherently ordered, so there is no
+ * synchronization needed to wait on it.
+ * - A stream is inherently ordered with respect to itself and so
  * there is no synchronization needed.
- * - Two different GPU streams can be synchronized (i.e., one waits on
- * the other).
- * - A CPU stream can be synchronized to a GPU stream (i.e., the CPU
- * waits on the GPU).
- * - A GPU stream never waits for a CPU stream. (This may be revised in
- * the future, but we currently do not need it.)
+ * - Two different streams can be synchronized (i.e., one waits on the
+ * other), whatever their devices.
+ * - A GPU stream waits for a CPU stream by having the caller wait for
+ * the CPU stream, as GPUs cannot wait on the host without host
+ * callbacks.
+ *
+ * GPU streams know the ordinal of the GPU they are on (see
+ * `get_device_id`), so one process may drive several GPUs, e.g., with
+ * one host thread per GPU. Streams are on the GPU that is current when
+ * they are created or wrapped, unless an ordinal is given. H2 makes
+ * the stream's GPU current where needed (e.g., when allocating memory
+ * on it), and each GPU has its own memory pool.
  *
  * Compute streams may be constructed from their corresponding Hydrogen
- * SyncInfo object; the event will be discrded. Likewise, they may be
+ * SyncInfo object, and remember its event. Likewise, they may be
  * converted to their corresponding Hydrogen SyncInfo objects, which
- * will use the default Hydrogen event.
+ * will use that event, or the default Hydrogen event if there is none.
+ * Hydrogen only skips synchronizing two SyncInfos if both their
+ * streams and events match, so this lets data converted back and forth
+ * between Hydrogen and H2 on one stream avoid redundant event waits.
  */
 class ComputeStream
 {
 public:
-  /** Create a new compute stream with the device's default stream. */
+  /**
+   * Create a new compute stream with the device's default stream.
+   *
+   * For GPUs, this is the calling thread's default stream of the
+   * current GPU (see `ThreadDefaultStreamGuard`).
+   */
   ComputeStream(Device device_) : device(device_)
   {
     H2_DEVICE_DISPATCH(device,
                        cpu_stream = internal::get_default_compute_stream<Dev>(),
-                       gpu_stream =
-                         internal::get_default_compute_stream<Dev>());
+                       set_thread_default_gpu_stream(gpu::current_gpu()));
+  }
+
+  /**
+   * Create a new compute stream with the default stream of the given
+   * GPU (`device_id` is ignored for CPUs).
+   */
+  ComputeStream(Device device_, int device_id) : device(device_)
+  {
+    H2_DEVICE_DISPATCH(device,
+                       {
+                         (void) device_id;
+                         cpu_stream =
+                           internal::get_default_compute_stream<Dev>();
+                       },
+                       set_thread_default_gpu_stream(device_id));
   }
 
 #ifdef H2_HAS_GPU
-  /** Wrap an existing device stream. */
+  /** Wrap an existing device stream on the current GPU. */
   ComputeStream(
     typename internal::RawComputeStream<Device::GPU>::type raw_stream)
-    : device(Device::GPU), gpu_stream(raw_stream)
+    : ComputeStream(raw_stream, gpu::current_gpu())
+  {}
+
+  /** Wrap an existing device stream on GPU `device_id`. */
+  ComputeStream(
+    typename internal::RawComputeStream<Device::GPU>::type raw_stream,
+    int device_id)
+    : device(Device::GPU),
+      gpu_stream(raw_stream),
+      tracker(internal::find_stream_tracker(raw_stream)),
+      gpu_id(device_id)
   {}
 #endif
 
@@ -462,10 +708,13 @@ public:
   template <Device Dev>
   explicit ComputeStream(El::SyncInfo<Dev> const& sync_info) : device(Dev)
   {
-    H2_DEVICE_DISPATCH_CONST(Dev,
-                             cpu_stream =
-                               internal::get_default_compute_stream<Dev>(),
-                             gpu_stream = sync_info.Stream());
+    H2_DEVICE_DISPATCH_CONST(
+      Dev, cpu_stream = internal::get_default_compute_stream<Dev>(), {
+        gpu_stream = sync_info.Stream();
+        tracker = internal::find_stream_tracker(gpu_stream);
+        hydrogen_event = sync_info.Event();
+        gpu_id = gpu::current_gpu();
+      });
   }
 
   /** Support conversion to El::SyncInfo. */
@@ -476,7 +725,9 @@ public:
       Dev,
       return El::SyncInfo<Dev>{},
       return El::SyncInfo<Dev>(get_stream<Dev>(),
-                               internal::get_default_event<Dev>()));
+                               (hydrogen_event != nullptr)
+                                 ? hydrogen_event
+                                 : internal::get_default_event<Dev>()));
   }
 
   ComputeStream(ComputeStream const&) = default;
@@ -485,23 +736,42 @@ public:
   ComputeStream(ComputeStream&& other) : device(other.device)
   {
     H2_DEVICE_DISPATCH(
-      device,
-      { cpu_stream = std::exchange(other.cpu_stream, 0); },
-      { gpu_stream = std::exchange(other.gpu_stream, nullptr); });
+      device, { cpu_stream = std::exchange(other.cpu_stream, 0); }, {
+        gpu_stream = std::exchange(other.gpu_stream, nullptr);
+        tracker = std::exchange(other.tracker, nullptr);
+        hydrogen_event = std::exchange(other.hydrogen_event, nullptr);
+        gpu_id = other.gpu_id;
+      });
   }
   ComputeStream& operator=(ComputeStream&& other)
   {
     device = other.device;
     H2_DEVICE_DISPATCH(
-      device,
-      { cpu_stream = std::exchange(other.cpu_stream, 0); },
-      { gpu_stream = std::exchange(other.gpu_stream, nullptr); });
+      device, { cpu_stream = std::exchange(other.cpu_stream, 0); }, {
+        gpu_stream = std::exchange(other.gpu_stream, nullptr);
+        tracker = std::exchange(other.tracker, nullptr);
+        hydrogen_event = std::exchange(other.hydrogen_event, nullptr);
+        gpu_id = other.gpu_id;
+      });
     return *this;
   }
 
   /** Return the device type of the stream. */
   Device get_device() const H2_NOEXCEPT { return device; }
 
+  /**
+   * Return the ordinal of the GPU the stream is on, or -1 for CPU
+   * streams.
+   */
+  int get_device_id() const H2_NOEXCEPT
+  {
+#ifdef H2_HAS_GPU
+    return (device == Device::GPU) ? gpu_id : -1;
+#else
+    return -1;
+#endif
+  }
+
   /** Record the current state of the stream in the given event. */
   void add_sync_point(SyncEvent const& event) const
   {
@@ -528,7 +798,16 @@ public:
     {
       if constexpr (EventDev == Device::CPU)
       {
-        // Nothing to do: CPU is inherently ordered.
+        if (event.get_event<Device::CPU>() != 0)
+        {
+          internal::record_cpu_event(event.get_event<Device::CPU>(),
+                                     cpu_stream);
+        }
+        else if (cpu_stream != 0)
+        {
+          // The default event is always complete, so make it so.
+          internal::wait_for_cpu_stream(cpu_stream);
+        }
       }
 #ifdef H2_HAS_GPU
       else if constexpr (EventDev == Device::GPU)
@@ -578,13 +857,22 @@ public:
     {
       if constexpr (EventDev == Device::CPU)
       {
-        // Nothing to do: CPU is inherently ordered.
+        internal::cpu_stream_wait_for_cpu_event(
+          cpu_stream, event.get_event<Device::CPU>());
       }
 #ifdef H2_HAS_GPU
       else if constexpr (EventDev == Device::GPU)
       {
-        // CPU waits on the event.
-        event.wait_for_this();
+        if (cpu_stream == 0)
+        {
+          // CPU waits on the event.
+          event.wait_for_this();
+        }
+        else
+        {
+          internal::cpu_stream_wait_for_gpu_event(
+            cpu_stream, event.get_event<Device::GPU>());
+        }
       }
 #endif
     }
@@ -593,7 +881,10 @@ public:
     {
       if constexpr (EventDev == Device::CPU)
       {
-        // Nothing to do: GPUs do not wait on CPUs.
+        // GPUs cannot wait on the host without host callbacks, but all
+        // later work on this stream is submitted after the caller
+        // waits.
+        event.wait_for_this();
       }
       else if constexpr (EventDev == Device::GPU)
       {
@@ -633,13 +924,22 @@ public:
     {
       if constexpr (StreamDev == Device::CPU)
       {
-        // Nothing to do: CPU is inherently ordered.
+        internal::cpu_stream_wait_for_cpu_stream(cpu_stream,
+                                                 other_stream.cpu_stream);
       }
 #ifdef H2_HAS_GPU
       else if constexpr (StreamDev == Device::GPU)
       {
-        // CPU waits on the stream.
-        other_stream.wait_for_this();
+        if (cpu_stream == 0)
+        {
+          // CPU waits on the stream.
+          other_stream.wait_for_this();
+        }
+        else
+        {
+          internal::cpu_stream_wait_for_gpu_stream(
+            cpu_stream, other_stream.gpu_stream, other_stream.gpu_id);
+        }
       }
 #endif
     }
@@ -648,7 +948,8 @@ public:
     {
       if constexpr (StreamDev == Device::CPU)
       {
-        // Nothing to do: GPUs do not wait on CPUs.
+        // As when waiting on CPU events, the caller waits instead.
+        internal::wait_for_cpu_stream(other_stream.cpu_stream);
       }
       else if constexpr (StreamDev == Device::GPU)
       {
@@ -656,11 +957,33 @@ public:
         {
           return;  // No need to sync when these are the same stream.
         }
-        // Add an event and wait on it.
+        // If both streams are tracked and the other stream has had no
+        // work submitted since we last waited on it, we need not wait.
+        bool const tracked =
+          tracker != nullptr && other_stream.tracker != nullptr;
+        std::uint64_t other_epoch = 0;
+        if (tracked)
+        {
+          other_epoch = other_stream.tracker->epoch.load();
+          if (internal::stream_wait_is_satisfied(
+                tracker, other_stream.tracker, other_epoch))
+          {
+            return;
+          }
+        }
+        // Add an event and wait on it. This accesses the other stream
+        // directly, as it does not submit work to it. The event must
+        // be on the other stream's GPU, but any stream may wait on it.
+        gpu::CurrentGPUGuard const guard(other_stream.gpu_id);
         gpu::DeviceEvent event = internal::get_new_device_event();
-        gpu::record_event(event, other_stream.get_stream<Device::GPU>());
+        gpu::record_event(event, other_stream.gpu_stream);
         gpu::sync(gpu_stream, event);
         internal::release_device_event(event);
+        if (tracked)
+        {
+          internal::record_stream_wait(
+            tracker, other_stream.tracker, other_epoch);
+        }
       }
     }
 #endif
@@ -669,8 +992,8 @@ public:
   /**
    * Wait for all work currently on this stream to complete.
    *
-   * This does nothing if this is a CPU stream. If this is a GPU
-   * stream, the caller will wait for it.
+   * The caller will wait for the stream. For asynchronous CPU streams,
+   * this rethrows the first exception thrown by a task on the stream.
    */
   void wait_for_this() const
   {
@@ -686,10 +1009,18 @@ public:
                     " (expected ",
                     device,
                     ")");
-    H2_DEVICE_DISPATCH_CONST(ThisDev, (void) 0, gpu::sync(gpu_stream));
+    H2_DEVICE_DISPATCH_CONST(ThisDev,
+                             internal::wait_for_cpu_stream(cpu_stream, true),
+                             gpu::sync(gpu_stream));
   }
 
-  /** Return the underlying raw stream for the device. */
+  /**
+   * Return the underlying raw stream for the device.
+   *
+   * For GPU streams created by H2, this counts as submitting work to
+   * the stream, so that other streams will not skip waiting on it. Do
+   * not hold onto the raw stream to submit more work later.
+   */
   template <Device ThisDev>
   typename internal::RawComputeStream<ThisDev>::type
   get_stream() const H2_NOEXCEPT
@@ -700,7 +1031,13 @@ public:
                     " (expected ",
                     device,
                     ")");
-    H2_DEVICE_DISPATCH_CONST(ThisDev, return cpu_stream, return gpu_stream);
+    H2_DEVICE_DISPATCH_CONST(ThisDev, return cpu_stream, {
+      if (tracker != nullptr)
+      {
+        tracker->epoch.fetch_add(1, std::memory_order_relaxed);
+      }
+      return gpu_stream;
+    });
   }
 
 private:
@@ -716,9 +1053,33 @@ private:
   };
 
 #ifdef H2_HAS_GPU
+  /** Work tracking for streams created by H2, otherwise null. */
+  internal::StreamTracker* tracker = nullptr;
+  /**
+   * Event of the Hydrogen SyncInfo this was constructed from, used when
+   * converting back, otherwise null.
+   */
+  typename internal::RawSyncEvent<Device::GPU>::type hydrogen_event = nullptr;
+  /** Ordinal of the GPU a GPU stream is on. */
+  int gpu_id = -1;
+#endif
+
+#ifdef H2_HAS_GPU
+  /** Use the calling thread's default stream for GPU `device_id`. */
+  void set_thread_default_gpu_stream(int device_id)
+  {
+    internal::ThreadDefaultGPUStream const default_stream =
+      internal::get_thread_default_gpu_stream(device_id);
+    gpu_stream = default_stream.stream;
+    tracker = default_stream.tracker;
+    gpu_id = device_id;
+  }
+#endif
+
   template <Device D>
   friend void destroy_compute_stream(ComputeStream&);
-#endif
+  friend ComputeStream create_new_async_cpu_stream();
+  friend class ThreadDefaultStreamGuard;
 };
 
 /** Support printing compute streams. */
@@ -739,10 +1100,9 @@ inline bool operator==(ComputeStream const& stream1,
   {
     return false;
   }
-  H2_DEVICE_DISPATCH(stream1.get_device(),
-                     return true,
-                     return stream1.get_stream<Dev>()
-                            == stream2.get_stream<Dev>());
+  H2_DEVICE_DISPATCH_SAME(
+    stream1.get_device(),
+    return stream1.get_stream<Dev>() == stream2.get_stream<Dev>());
 }
 
 /** Inequality for compute streams. */
@@ -753,23 +1113,41 @@ inline bool operator!=(ComputeStream const& stream1,
   {
     return true;
   }
-  H2_DEVICE_DISPATCH(stream1.get_device(),
-                     return false,
-                     return stream1.get_stream<Dev>()
-                            != stream2.get_stream<Dev>());
+  H2_DEVICE_DISPATCH_SAME(
+    stream1.get_device(),
+    return stream1.get_stream<Dev>() != stream2.get_stream<Dev>());
 }
 
-/** Create a fresh compute stream for a particular device. */
+/**
+ * Create a fresh compute stream for a particular device.
+ *
+ * New GPU streams track the work submitted to them, allowing
+ * redundant waits on them to be skipped. GPU streams are created on
+ * GPU `device_id`, or the current GPU if it is negative. `device_id`
+ * is ignored for CPUs.
+ */
 template <Device Dev>
-inline ComputeStream create_new_compute_stream()
+inline ComputeStream create_new_compute_stream(int device_id = -1)
 {
   H2_DEVICE_DISPATCH_CONST(
-    Dev, return ComputeStream{Dev}, return ComputeStream{gpu::make_stream()});
+    Dev,
+    {
+      (void) device_id;
+      return ComputeStream{Dev};
+    },
+    {
+      gpu::CurrentGPUGuard const guard(device_id);
+      gpu::DeviceStream raw_stream = gpu::make_stream();
+      internal::start_tracking_stream(raw_stream);
+      return ComputeStream{raw_stream};
+    });
 }
 
-inline ComputeStream create_new_compute_stream(Device device)
+inline ComputeStream create_new_compute_stream(Device device,
+                                               int device_id = -1)
 {
-  H2_DEVICE_DISPATCH_SAME(device, return create_new_compute_stream<Dev>());
+  H2_DEVICE_DISPATCH_SAME(device,
+                          return create_new_compute_stream<Dev>(device_id));
 }
 
 /** Destroy a compute stream for a particular device. */
@@ -777,7 +1155,18 @@ template <Device Dev>
 inline void destroy_compute_stream(ComputeStream& stream)
 {
   H2_DEVICE_DISPATCH_CONST(
-    Dev, (void) stream, if (stream.gpu_stream != nullptr) {
+    Dev,
+    if (stream.cpu_stream != 0) {
+      internal::destroy_async_cpu_stream(stream.cpu_stream);
+      stream.cpu_stream = 0;
+    },
+    if (stream.gpu_stream != nullptr) {
+      if (stream.tracker != nullptr)
+      {
+        internal::stop_tracking_stream(stream.gpu_stream);
+        stream.tracker = nullptr;
+      }
+      gpu::CurrentGPUGuard const guard(stream.gpu_id);
       gpu::destroy(stream.gpu_stream);
       stream.gpu_stream = nullptr;
     });
@@ -789,6 +1178,105 @@ inline void destroy_compute_stream(ComputeStream& stream)
                           destroy_compute_stream<Dev>(stream));
 }
 
+#ifdef H2_HAS_GPU
+
+/**
+ * Make a GPU stream the calling thread's default stream for its GPU
+ * while this guard exists.
+ *
+ * GPU compute streams constructed on this thread from just a device
+ * (and GPU ordinal), including those of Tensors created without an
+ * explicit stream, then use this stream. This lets host threads issue
+ * work concurrently without serializing on the shared default stream:
+ * e.g., each thread may create a stream with `create_new_compute_stream`
+ * and install it with a guard.
+ *
+ * Guards may be nested, and must be destroyed on the thread that
+ * created them, in reverse order. The stream must outlive the guard.
+ * Other threads are unaffected.
+ */
+class ThreadDefaultStreamGuard
+{
+public:
+  ThreadDefaultStreamGuard(ComputeStream const& stream)
+    : gpu_id(stream.get_device_id())
+  {
+    H2_ASSERT_ALWAYS(stream.get_device() == Device::GPU,
+                     "Thread default streams must be GPU streams, not ",
+                     stream.get_device());
+    prev_stream = internal::exchange_thread_default_gpu_stream(
+      gpu_id, {stream.gpu_stream, stream.tracker});
+  }
+
+  ~ThreadDefaultStreamGuard()
+  {
+    internal::exchange_thread_default_gpu_stream(gpu_id, prev_stream);
+  }
+
+  ThreadDefaultStreamGuard(ThreadDefaultStreamGuard const&) = delete;
+  ThreadDefaultStreamGuard& operator=(ThreadDefaultStreamGuard const&) =
+    delete;
+
+private:
+  /** GPU the stream is on. */
+  int gpu_id;
+  /** Thread default stream to restore. */
+  internal::ThreadDefaultGPUStream prev_stream;
+};
+
+#endif  // H2_HAS_GPU
+
+/**
+ * Create a new asynchronous CPU compute stream.
+ *
+ * Work submitted to this stream with `enqueue_cpu_task` is run in
+ * order by a dedicated worker thread, so the caller need not wait for
+ * it. Such streams may wait on, and be waited on by, events and other
+ * streams. Because GPU streams cannot wait on the host without host
+ * callbacks, a GPU stream waiting on a CPU stream or event instead
+ * has the caller wait, so work later submitted to the GPU stream is
+ * still ordered after it. Likewise, recording the default CPU event on
+ * an asynchronous stream waits for it (use
+ * `create_new_async_cpu_event` instead).
+ *
+ * H2 operations on CPU data run on the calling thread, regardless of
+ * their stream; to order them with an asynchronous stream, wait for
+ * it or enqueue them as tasks.
+ *
+ * Destroying the stream waits for its work to complete.
+ */
+inline ComputeStream create_new_async_cpu_stream()
+{
+  ComputeStream stream{Device::CPU};
+  stream.cpu_stream = internal::create_async_cpu_stream();
+  return stream;
+}
+
+/**
+ * Run `task` on `stream`, which must be a CPU stream.
+ *
+ * On asynchronous CPU streams, this enqueues the task and returns
+ * immediately; the task must not wait on its own stream. Otherwise the
+ * task runs immediately on the caller.
+ */
+template <typename FuncT>
+inline void enqueue_cpu_task(ComputeStream const& stream, FuncT&& task)
+{
+  H2_ASSERT_ALWAYS(stream.get_device() == Device::CPU,
+                   "Can only enqueue tasks on CPU streams, not ",
+                   stream.get_device());
+  auto const raw_stream = stream.get_stream<Device::CPU>();
+  if (raw_stream == 0)
+  {
+    std::forward<FuncT>(task)();
+  }
+  else
+  {
+    internal::enqueue_cpu_task(
+      raw_stream, std::function<void()>(std::forward<FuncT>(task)));
+  }
+}
+
 // General utilities for interacting with compute streams and events:
 
 /**
@@ -888,7 +1376,7 @@ struct hash<h2::SyncEvent>
   {
     using h2::Device;
     H2_DEVICE_DISPATCH(event.get_device(),
-                       return 0,
+                       return hash<int>()(event.get_event<Dev>()),
                        return hash<void*>()((void*) event.get_event<Dev>()));
   }
 };
@@ -900,7 +1388,7 @@ struct hash<h2::ComputeStream>
   {
     using h2::Device;
     H2_DEVICE_DISPATCH(stream.get_device(),
-                       return 0,
+                       return hash<int>()(stream.get_stream<Dev>()),
                        return hash<void*>()((void*) stream.get_stream<Dev>()));
   }
 };
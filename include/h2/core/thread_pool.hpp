@@ -0,0 +1,73 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * The process-wide CPU thread pool.
+ *
+ * All of H2's multithreaded CPU work (e.g., element-wise loops, and
+ * hence fills, casts, and copies) runs on a single work-stealing pool,
+ * so concurrent operations (say, from several CPU streams) share the
+ * cores rather than each starting its own team of threads. The pool
+ * has `H2_CPU_NUM_THREADS` threads (by default, one per hardware
+ * thread), including the thread that submits work, which always
+ * participates.
+ */
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace h2
+{
+namespace cpu
+{
+
+/**
+ * Return the number of threads that run work submitted to the pool,
+ * including the submitting thread.
+ */
+std::size_t get_num_threads();
+
+/** Return whether the caller is one of the pool's worker threads. */
+bool in_thread_pool() noexcept;
+
+namespace internal
+{
+
+/** Type-erased implementation of `parallel_for`. */
+void parallel_for_impl(std::size_t num_blocks,
+                       void (*invoke)(void*, std::size_t),
+                       void* func);
+
+}  // namespace internal
+
+/**
+ * Call `func(block)` for each block in [0, `num_blocks`) on the pool,
+ * returning once all calls have completed.
+ *
+ * Blocks are initially given to one thread and are split among idle
+ * threads by work stealing, so the blocks should be large enough to
+ * amortize this (at least thousands of element operations each).
+ * `func` may be invoked concurrently, and may itself call
+ * `parallel_for`. If any call throws, one of the exceptions is
+ * rethrown after all calls complete.
+ */
+template <typename FuncT>
+void parallel_for(std::size_t num_blocks, FuncT&& func)
+{
+  using FuncPtrT = std::remove_reference_t<FuncT>*;
+  internal::parallel_for_impl(
+    num_blocks,
+    [](void* f, std::size_t block) { (*static_cast<FuncPtrT>(f))(block); },
+    const_cast<void*>(static_cast<void const*>(&func)));
+}
+
+}  // namespace cpu
+}  // namespace h2
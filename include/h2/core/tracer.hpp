@@ -0,0 +1,210 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * A lightweight built-in tracer for H2 operations.
+ *
+ * Unlike profiler ranges (see `profiling.hpp`), this needs no external
+ * tools and is always available. When the `H2_TRACE` environment
+ * variable is set, each `TraceScope` records the operation's name,
+ * category, stream, bytes moved, and host duration, and for GPU
+ * streams, also records events around the operation to time it on the
+ * device. Records are written to a Chrome trace JSON file (viewable in
+ * `chrome://tracing` or Perfetto) for each rank at exit or on
+ * `flush_trace`.
+ *
+ * Operations may also give the floating-point operations they do. When
+ * `H2_TRACE_ROOFLINE` is set, the bytes, FLOPs, and times of written
+ * records are aggregated per operation name and device into a report
+ * of achieved versus peak bandwidth, which is logged at exit (see
+ * `write_roofline_report`).
+ *
+ * Each thread records into its own fixed-size ring buffer
+ * (`H2_TRACE_BUFFER_SIZE` records) without locks. Records are dropped,
+ * and counted, when a buffer is full, so flush periodically in long
+ * runs.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/profiling.hpp"
+#include "h2/core/sync.hpp"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace h2
+{
+
+namespace internal
+{
+
+struct TraceRecord;
+
+/**
+ * Return true if `H2_TRACE` is set, and if so, arrange for the trace
+ * to be flushed at exit.
+ */
+bool check_tracing_enabled();
+
+/** Return the number of records each thread's buffer holds. */
+std::size_t get_trace_buffer_size();
+
+/**
+ * Start recording an operation on this thread.
+ *
+ * Returns null if the thread's buffer is full.
+ */
+TraceRecord* trace_begin(char const* name,
+                         ProfileCategory category,
+                         ComputeStream const& stream,
+                         std::size_t bytes,
+                         std::size_t flops = 0);
+
+/** Finish recording an operation started with `trace_begin`. */
+void trace_end(TraceRecord* record, ComputeStream const& stream);
+
+}  // namespace internal
+
+/** Return true if H2 operations are traced. */
+inline bool tracing_enabled()
+{
+  static bool const enabled = internal::check_tracing_enabled();
+  return enabled;
+}
+
+/**
+ * Trace the lifetime of the object as an operation on `stream`.
+ *
+ * Prefer `H2_TRACE_SCOPE`. `name` and `stream` must outlive the scope.
+ */
+class TraceScope
+{
+public:
+  TraceScope(char const* name,
+             ProfileCategory category,
+             ComputeStream const& stream_,
+             std::size_t bytes = 0,
+             std::size_t flops = 0)
+    : record(tracing_enabled()
+               ? internal::trace_begin(name, category, stream_, bytes, flops)
+               : nullptr),
+      stream(&stream_)
+  {}
+
+  ~TraceScope()
+  {
+    if (record)
+    {
+      internal::trace_end(record, *stream);
+    }
+  }
+
+  TraceScope(TraceScope const&) = delete;
+  TraceScope& operator=(TraceScope const&) = delete;
+
+private:
+  internal::TraceRecord* record;
+  ComputeStream const* stream;
+};
+
+/**
+ * Write the records traced so far as Chrome trace JSON to `os`.
+ *
+ * This waits for the GPU events of the records to complete. Records
+ * are consumed, so each is written only once. Records of operations
+ * still in progress are written by a later call.
+ */
+void write_trace(std::ostream& os);
+
+/**
+ * Write the records traced so far to a new file, if there are any.
+ *
+ * The file is named by `H2_TRACE_FILE`, with the hostname and rank
+ * flags of logger patterns (e.g., `%h` and `%w`) expanded, and with
+ * a sequence number added after the first flush. This is called at
+ * exit when tracing is enabled.
+ */
+void flush_trace();
+
+/** Return the number of records dropped because a buffer was full. */
+std::size_t get_num_dropped_trace_records();
+
+/** Totals of the written records of one operation on one device. */
+struct KernelRooflineStats
+{
+  std::string name;
+  Device device = Device::CPU;
+  std::size_t num_calls = 0;
+  std::size_t bytes = 0;
+  std::size_t flops = 0;
+  /** Total time, in seconds, on the device for GPU operations. */
+  double time = 0.0;
+  /** Peak memory bandwidth of the device in bytes/s, or 0 if unknown. */
+  double peak_bandwidth = 0.0;
+
+  /** Return the achieved bandwidth in bytes/s. */
+  double achieved_bandwidth() const
+  {
+    return time > 0.0 ? bytes / time : 0.0;
+  }
+
+  /** Return the achieved fraction of the peak bandwidth, or 0. */
+  double fraction_of_peak() const
+  {
+    return peak_bandwidth > 0.0 ? achieved_bandwidth() / peak_bandwidth
+                                : 0.0;
+  }
+
+  /** Return the FLOPs per byte moved. */
+  double arithmetic_intensity() const
+  {
+    return bytes > 0 ? static_cast<double>(flops) / bytes : 0.0;
+  }
+};
+
+/**
+ * Return the roofline statistics of the records written so far by
+ * `write_trace` or `flush_trace`, sorted by decreasing total time.
+ *
+ * Statistics are only gathered when `H2_TRACE_ROOFLINE` is set or
+ * after `enable_roofline_stats`.
+ */
+std::vector<KernelRooflineStats> get_roofline_stats();
+
+/** Write the roofline statistics as a table to `os`. */
+void write_roofline_report(std::ostream& os);
+
+/** Discard the roofline statistics gathered so far. */
+void clear_roofline_stats();
+
+/** Gather roofline statistics whether or not `H2_TRACE_ROOFLINE` is set. */
+void enable_roofline_stats();
+
+}  // namespace h2
+
+/**
+ * Trace the rest of the enclosing scope as an operation named `name`
+ * in category `category` (a `ProfileCategory` member name) on
+ * `stream`, moving `bytes` bytes.
+ */
+#define H2_TRACE_SCOPE(name, category, stream, bytes)                          \
+  ::h2::TraceScope H2_PROFILE_CONCAT(h2_trace_scope_, __LINE__)(               \
+    name, ::h2::ProfileCategory::category, stream, bytes)
+
+/**
+ * Like `H2_TRACE_SCOPE`, but also giving the floating-point operations
+ * the operation does, for the roofline statistics.
+ */
+#define H2_TRACE_SCOPE_WITH_FLOPS(name, category, stream, bytes, flops)        \
+  ::h2::TraceScope H2_PROFILE_CONCAT(h2_trace_scope_, __LINE__)(               \
+    name, ::h2::ProfileCategory::category, stream, bytes, flops)
@@ -14,6 +14,7 @@
 
 #include <h2_config.hpp>
 
+#include "h2/core/low_precision.hpp"
 #include "h2/meta/TypeList.hpp"
 #include "h2/utils/Error.hpp"
 
@@ -76,7 +77,14 @@ struct IsH2ComputeType<float> : std::true_type
 template <>
 struct IsH2ComputeType<double> : std::true_type
 {};
-// TODO: FP16 and BF16 support.
+#if H2_HAS_GPU_LOW_PRECISION
+template <>
+struct IsH2ComputeType<gpu::Half> : std::true_type
+{};
+template <>
+struct IsH2ComputeType<gpu::BFloat16> : std::true_type
+{};
+#endif
 
 // Integral types:
 
@@ -106,14 +114,21 @@ inline constexpr bool IsH2ComputeType_v = IsH2ComputeType<T>::value;
 // Helpers to explicitly enumerate compute types:
 
 /** List of floating point compute types. */
-using FloatComputeTypes = meta::TL<float, double>;
+using FloatComputeTypes =
+  meta::tlist::Append<meta::TL<float, double>, LowPrecisionFloatTypes>;
 
 /** List of integral compute types. */
 using IntegralComputeTypes = meta::TL<std::int32_t, std::uint32_t>;
 
-/** List of all compute types. */
-using ComputeTypes =
-  meta::tlist::Append<FloatComputeTypes, IntegralComputeTypes>;
+/**
+ * List of all compute types.
+ *
+ * The order determines type tokens. Low-precision types, which are not
+ * always present, are last so the other tokens do not change.
+ */
+using ComputeTypes = meta::tlist::Append<
+  meta::tlist::Append<meta::TL<float, double>, IntegralComputeTypes>,
+  LowPrecisionFloatTypes>;
 
 /** Number of compute types. */
 constexpr unsigned long NumComputeTypes = meta::tlist::Length<ComputeTypes>;
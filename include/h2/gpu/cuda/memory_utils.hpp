@@ -9,8 +9,9 @@
 
 /** @file
  *
- *  Thin wrappers around cudaMem{cpy,set} functions. These are here so
- *  they can be inlined if possible.
+ *  Thin wrappers around cudaMem{cpy,set}, stream-ordered and managed
+ *  allocation functions. These are here so they can be inlined if
+ *  possible.
  */
 #include "h2_config.hpp"
 
@@ -20,11 +21,16 @@
 #include <cuda_runtime.h>
 #include <hydrogen/PoolAllocator.hpp>
 
+#include <cstdint>
+
 namespace h2
 {
 namespace gpu
 {
 
+/** Device ID that refers to the host in prefetches and advice. */
+inline constexpr int host_device_id = cudaCpuDeviceId;
+
 inline MemInfo mem_info()
 {
   MemInfo info;
@@ -55,6 +61,69 @@ mem_copy(void* dst, void const* src, size_t bytes, DeviceStream stream)
   H2_CHECK_CUDA(cudaMemcpyAsync(dst, src, bytes, cudaMemcpyDefault, stream));
 }
 
+/**
+ * Copy `height` rows of `width` bytes, where consecutive rows start
+ * `dpitch` and `spitch` bytes apart in `dst` and `src`.
+ */
+inline void mem_copy_2d(void* dst,
+                        size_t dpitch,
+                        void const* src,
+                        size_t spitch,
+                        size_t width,
+                        size_t height,
+                        DeviceStream stream)
+{
+  H2_GPU_TRACE("cudaMemcpy2DAsync(dst={}, dpitch={}, src={}, spitch={}, "
+               "width={}, height={}, kind=cudaMemcpyDefault, stream={})",
+               dst,
+               dpitch,
+               src,
+               spitch,
+               width,
+               height,
+               (void*) stream);
+  H2_CHECK_CUDA(cudaMemcpy2DAsync(
+    dst, dpitch, src, spitch, width, height, cudaMemcpyDefault, stream));
+}
+
+/**
+ * Copy `depth` slices of `height` rows of `width` bytes. Rows start
+ * `dpitch` and `spitch` bytes apart, and slices `dheight` and
+ * `sheight` rows apart, in `dst` and `src`.
+ */
+inline void mem_copy_3d(void* dst,
+                        size_t dpitch,
+                        size_t dheight,
+                        void const* src,
+                        size_t spitch,
+                        size_t sheight,
+                        size_t width,
+                        size_t height,
+                        size_t depth,
+                        DeviceStream stream)
+{
+  H2_GPU_TRACE("cudaMemcpy3DAsync(dst={}, dpitch={}, dheight={}, src={}, "
+               "spitch={}, sheight={}, width={}, height={}, depth={}, "
+               "kind=cudaMemcpyDefault, stream={})",
+               dst,
+               dpitch,
+               dheight,
+               src,
+               spitch,
+               sheight,
+               width,
+               height,
+               depth,
+               (void*) stream);
+  cudaMemcpy3DParms params = {};
+  params.dstPtr = make_cudaPitchedPtr(dst, dpitch, width, dheight);
+  params.srcPtr =
+    make_cudaPitchedPtr(const_cast<void*>(src), spitch, width, sheight);
+  params.extent = make_cudaExtent(width, height, depth);
+  params.kind = cudaMemcpyDefault;
+  H2_CHECK_CUDA(cudaMemcpy3DAsync(&params, stream));
+}
+
 inline void mem_zero(void* mem, size_t bytes)
 {
   H2_GPU_TRACE("cudaMemset(mem={}, value=0x0, bytes={})", mem, bytes);
@@ -70,5 +139,226 @@ inline void mem_zero(void* mem, size_t bytes, DeviceStream stream)
   H2_CHECK_CUDA(cudaMemsetAsync(mem, 0x0, bytes, stream));
 }
 
+/** Allocate device memory, returning null if out of memory. */
+inline void* mem_alloc(size_t bytes)
+{
+  void* ptr = nullptr;
+  auto const status = cudaMalloc(&ptr, bytes);
+  if (status == cudaErrorMemoryAllocation)
+  {
+    // Clear the error so it is not reported by later calls.
+    static_cast<void>(cudaGetLastError());
+    H2_GPU_TRACE("cudaMalloc(bytes={}) out of memory", bytes);
+    return nullptr;
+  }
+  H2_CHECK_CUDA(status);
+  H2_GPU_TRACE("cudaMalloc(ptr={}, bytes={})", ptr, bytes);
+  return ptr;
+}
+
+inline void mem_free(void* ptr)
+{
+  H2_GPU_TRACE("cudaFree(ptr={})", ptr);
+  H2_CHECK_CUDA(cudaFree(ptr));
+}
+
+inline void* mem_alloc_managed(size_t bytes)
+{
+  void* ptr = nullptr;
+  H2_CHECK_CUDA(cudaMallocManaged(&ptr, bytes, cudaMemAttachGlobal));
+  H2_GPU_TRACE("cudaMallocManaged(ptr={}, bytes={})", ptr, bytes);
+  return ptr;
+}
+
+#if CUDART_VERSION >= 13000
+inline cudaMemLocation to_mem_location(int device)
+{
+  cudaMemLocation loc = {};
+  loc.type = (device == host_device_id) ? cudaMemLocationTypeHost
+                                        : cudaMemLocationTypeDevice;
+  loc.id = (device == host_device_id) ? 0 : device;
+  return loc;
+}
+#endif
+
+inline void mem_prefetch_async(void const* ptr,
+                               size_t bytes,
+                               int device,
+                               DeviceStream stream)
+{
+  H2_GPU_TRACE("cudaMemPrefetchAsync(ptr={}, bytes={}, device={}, stream={})",
+               ptr,
+               bytes,
+               device,
+               (void*) stream);
+#if CUDART_VERSION >= 13000
+  H2_CHECK_CUDA(
+    cudaMemPrefetchAsync(ptr, bytes, to_mem_location(device), 0, stream));
+#else
+  H2_CHECK_CUDA(cudaMemPrefetchAsync(ptr, bytes, device, stream));
+#endif
+}
+
+inline void
+mem_advise(void const* ptr, size_t bytes, MemAdvice advice, int device)
+{
+  cudaMemoryAdvise cuda_advice = cudaMemAdviseSetReadMostly;
+  switch (advice)
+  {
+  case MemAdvice::ReadMostly: cuda_advice = cudaMemAdviseSetReadMostly; break;
+  case MemAdvice::PreferredLocation:
+    cuda_advice = cudaMemAdviseSetPreferredLocation;
+    break;
+  case MemAdvice::AccessedBy: cuda_advice = cudaMemAdviseSetAccessedBy; break;
+  }
+  H2_GPU_TRACE("cudaMemAdvise(ptr={}, bytes={}, advice={}, device={})",
+               ptr,
+               bytes,
+               static_cast<int>(cuda_advice),
+               device);
+#if CUDART_VERSION >= 13000
+  H2_CHECK_CUDA(
+    cudaMemAdvise(ptr, bytes, cuda_advice, to_mem_location(device)));
+#else
+  H2_CHECK_CUDA(cudaMemAdvise(ptr, bytes, cuda_advice, device));
+#endif
+}
+
+inline void* mem_alloc_async(size_t bytes, DeviceStream stream)
+{
+  void* ptr = nullptr;
+  H2_CHECK_CUDA(cudaMallocAsync(&ptr, bytes, stream));
+  H2_GPU_TRACE("cudaMallocAsync(ptr={}, bytes={}, stream={})",
+               ptr,
+               bytes,
+               (void*) stream);
+  return ptr;
+}
+
+inline void mem_free_async(void* ptr, DeviceStream stream)
+{
+  H2_GPU_TRACE("cudaFreeAsync(ptr={}, stream={})", ptr, (void*) stream);
+  H2_CHECK_CUDA(cudaFreeAsync(ptr, stream));
+}
+
+inline void* host_alloc_pinned(size_t bytes)
+{
+  void* ptr = nullptr;
+  H2_CHECK_CUDA(cudaMallocHost(&ptr, bytes));
+  H2_GPU_TRACE("cudaMallocHost(ptr={}, bytes={})", ptr, bytes);
+  return ptr;
+}
+
+inline void host_free_pinned(void* ptr)
+{
+  H2_GPU_TRACE("cudaFreeHost(ptr={})", ptr);
+  H2_CHECK_CUDA(cudaFreeHost(ptr));
+}
+
+inline void host_register(void* ptr, size_t bytes, bool read_only)
+{
+  unsigned int const flags =
+    read_only ? cudaHostRegisterReadOnly : cudaHostRegisterDefault;
+  H2_GPU_TRACE("cudaHostRegister(ptr={}, bytes={}, flags={})",
+               ptr,
+               bytes,
+               flags);
+  H2_CHECK_CUDA(cudaHostRegister(ptr, bytes, flags));
+}
+
+inline void host_unregister(void* ptr)
+{
+  H2_GPU_TRACE("cudaHostUnregister(ptr={})", ptr);
+  H2_CHECK_CUDA(cudaHostUnregister(ptr));
+}
+
+/**
+ * Return true if `ptr` is ordinary (pageable) host memory, i.e., not
+ * pinned, registered, managed, or device memory.
+ */
+inline bool is_pageable_host_memory(void const* ptr)
+{
+  cudaPointerAttributes attr;
+  H2_CHECK_CUDA(cudaPointerGetAttributes(&attr, ptr));
+  return attr.type == cudaMemoryTypeUnregistered;
+}
+
+/** Return the ID of the GPU that owns the device memory at `ptr`. */
+inline int get_mem_device(void const* ptr)
+{
+  cudaPointerAttributes attr;
+  H2_CHECK_CUDA(cudaPointerGetAttributes(&attr, ptr));
+  return attr.device;
+}
+
+/** Return true if GPU `device` can directly access memory on `peer`. */
+inline bool can_access_peer(int device, int peer)
+{
+  int can_access = 0;
+  H2_CHECK_CUDA(cudaDeviceCanAccessPeer(&can_access, device, peer));
+  return can_access != 0;
+}
+
+/**
+ * Enable direct access from the current GPU to memory on `peer`.
+ *
+ * It is not an error if access is already enabled.
+ */
+inline void enable_peer_access(int peer)
+{
+  H2_GPU_TRACE("cudaDeviceEnablePeerAccess(peer={})", peer);
+  cudaError_t const status = cudaDeviceEnablePeerAccess(peer, 0);
+  if (status == cudaErrorPeerAccessAlreadyEnabled)
+  {
+    (void) cudaGetLastError();
+    return;
+  }
+  H2_CHECK_CUDA(status);
+}
+
+inline void mem_copy_peer(void* dst,
+                          int dst_device,
+                          void const* src,
+                          int src_device,
+                          size_t bytes,
+                          DeviceStream stream)
+{
+  H2_GPU_TRACE("cudaMemcpyPeerAsync(dst={}, dst_device={}, src={}, "
+               "src_device={}, bytes={}, stream={})",
+               dst,
+               dst_device,
+               src,
+               src_device,
+               bytes,
+               (void*) stream);
+  H2_CHECK_CUDA(cudaMemcpyPeerAsync(
+    dst, dst_device, src, src_device, bytes, stream));
+}
+
+inline void set_mem_pool_release_threshold(int device, uint64_t threshold)
+{
+  cudaMemPool_t pool;
+  H2_CHECK_CUDA(cudaDeviceGetDefaultMemPool(&pool, device));
+  H2_GPU_TRACE("setting release threshold of memory pool {} on device {} to {}",
+               (void*) pool,
+               device,
+               threshold);
+  H2_CHECK_CUDA(
+    cudaMemPoolSetAttribute(pool, cudaMemPoolAttrReleaseThreshold, &threshold));
+}
+
+inline uint64_t mem_pool_cached_bytes(int device)
+{
+  cudaMemPool_t pool;
+  H2_CHECK_CUDA(cudaDeviceGetDefaultMemPool(&pool, device));
+  uint64_t reserved = 0;
+  uint64_t used = 0;
+  H2_CHECK_CUDA(cudaMemPoolGetAttribute(
+    pool, cudaMemPoolAttrReservedMemCurrent, &reserved));
+  H2_CHECK_CUDA(
+    cudaMemPoolGetAttribute(pool, cudaMemPoolAttrUsedMemCurrent, &used));
+  return reserved - used;
+}
+
 }  // namespace gpu
 }  // namespace h2
@@ -37,6 +37,8 @@ namespace gpu
 typedef cudaStream_t DeviceStream;
 typedef cudaEvent_t DeviceEvent;
 typedef cudaError_t DeviceError;
+typedef cudaGraph_t DeviceGraph;
+typedef cudaGraphExec_t DeviceGraphExec;
 
 constexpr unsigned int max_grid_x = 2147483647;
 constexpr unsigned int max_grid_y = 65535;
@@ -126,5 +128,20 @@ void launch_kernel_internal(void (*kernel)(KernelArgs...),
   }
 }
 
+/**
+ * Return the maximum number of blocks of `kernel` that may be resident
+ * on one multiprocessor when launched with the given block size.
+ */
+template <typename... KernelArgs>
+unsigned int max_active_blocks_per_sm(void (*kernel)(KernelArgs...),
+                                      unsigned int block_size,
+                                      std::size_t shared_mem = 0)
+{
+  int num_blocks = 0;
+  H2_CHECK_CUDA(cudaOccupancyMaxActiveBlocksPerMultiprocessor(
+    &num_blocks, kernel, static_cast<int>(block_size), shared_mem));
+  return static_cast<unsigned int>(num_blocks);
+}
+
 }  // namespace gpu
 }  // namespace h2
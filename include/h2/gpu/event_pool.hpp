@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Recycled GPU events.
+ *
+ * Creating and destroying events are driver calls, which add
+ * noticeable host overhead to operations that synchronize streams
+ * (e.g., every `MultiSync`). Instead, short-lived events should be
+ * obtained from and returned to a per-device pool. Pooled events do
+ * not record timing.
+ *
+ * The pools are lock-free and may be used concurrently from any
+ * thread. Each pool holds a bounded number of idle events; releasing
+ * an event to a full pool destroys it.
+ */
+
+#include "h2/gpu/runtime.hpp"
+
+#include <cstddef>
+
+namespace h2
+{
+namespace gpu
+{
+
+/**
+ * Return an event from the current GPU's pool, creating one if the
+ * pool is empty.
+ */
+DeviceEvent get_pooled_event();
+
+/**
+ * Return an event obtained with `get_pooled_event` to the current
+ * GPU's pool.
+ *
+ * This must be the GPU that was current when the event was obtained.
+ * The event must not be used afterward, but work it recorded may
+ * still be pending.
+ */
+void release_pooled_event(DeviceEvent event);
+
+/** Destroy all idle events in every GPU's pool. */
+void clear_event_pools();
+
+/** Return the number of idle events in the current GPU's pool. */
+std::size_t num_pooled_events();
+
+}  // namespace gpu
+}  // namespace h2
@@ -0,0 +1,193 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Runtime (NVRTC/hipRTC) compilation of GPU element-wise kernels.
+ *
+ * Element-wise loops launched with `launch_elementwise_loop` must be
+ * compiled into the library, which does not work for operations only
+ * known at runtime (e.g., defined by a Python front end). Instead, an
+ * operation can be given as source code and type names, and compiled
+ * into a vectorized element-wise kernel when first used:
+ *
+ * ```
+ * JitElementwiseOp op{"axpb", "float", {"float", "float"},
+ *                     "return 2.0f * in0 + in1;"};
+ * get_jit_elementwise_kernel(op)(stream, size, out, x, y);
+ * ```
+ *
+ * Compiled kernels are cached in memory for each GPU. If
+ * `H2_GPU_JIT_CACHE_PATH` names a directory, the compiled binaries are
+ * also stored there, keyed by a hash of the generated source and the
+ * GPU architecture, so later runs skip compilation.
+ *
+ * Kernels use the same launch policy as `launch_elementwise_loop`:
+ * buffers are accessed with the widest vector width (4, 2, or 1) their
+ * alignment allows, `num_threads_per_block` threads per block, and
+ * about `work_per_thread` vectors per thread.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/gpu/runtime.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace h2
+{
+namespace gpu
+{
+
+/** An element-wise operation to be compiled at runtime. */
+struct JitElementwiseOp
+{
+  /** Name of the operation, which must be a valid identifier. */
+  std::string name;
+  /** Name of the output type (see `jit_type_name`). */
+  std::string out_type;
+  /** Names of the input types, in order. */
+  std::vector<std::string> in_types;
+  /**
+   * Body of a device function with arguments `in0`, `in1`, etc. of the
+   * input types that returns the output value.
+   */
+  std::string body;
+  /** Optional code (e.g., helper device functions) preceding `body`. */
+  std::string preamble = "";
+};
+
+/**
+ * Return the name of `T` in the source of JIT-compiled kernels.
+ *
+ * Supported types are the fixed-width integer types, `float`,
+ * `double`, and `bool`.
+ */
+template <typename T>
+constexpr char const* jit_type_name()
+{
+  using U = std::remove_cv_t<T>;
+  if constexpr (std::is_same_v<U, float>)
+    return "float";
+  else if constexpr (std::is_same_v<U, double>)
+    return "double";
+  else if constexpr (std::is_same_v<U, bool>)
+    return "bool";
+  else if constexpr (std::is_same_v<U, std::int8_t>)
+    return "int8_t";
+  else if constexpr (std::is_same_v<U, std::uint8_t>)
+    return "uint8_t";
+  else if constexpr (std::is_same_v<U, std::int16_t>)
+    return "int16_t";
+  else if constexpr (std::is_same_v<U, std::uint16_t>)
+    return "uint16_t";
+  else if constexpr (std::is_same_v<U, std::int32_t>)
+    return "int32_t";
+  else if constexpr (std::is_same_v<U, std::uint32_t>)
+    return "uint32_t";
+  else if constexpr (std::is_same_v<U, std::int64_t>)
+    return "int64_t";
+  else if constexpr (std::is_same_v<U, std::uint64_t>)
+    return "uint64_t";
+  else
+    static_assert(!std::is_same_v<U, U>,
+                  "Type is not supported in JIT kernels");
+}
+
+/**
+ * Return the size in bytes of the type named `type` in JIT-compiled
+ * kernels, throwing if it is not supported.
+ */
+std::size_t jit_type_size(std::string const& type);
+
+/**
+ * Return the source of the kernels compiled for `op`.
+ *
+ * There is one kernel for each vector width, named
+ * `h2_jit_<name>_vec<width>`. This throws if `op` is invalid.
+ */
+std::string make_jit_elementwise_source(JitElementwiseOp const& op);
+
+/** Vector widths JIT-compiled element-wise kernels are compiled for. */
+constexpr std::array<std::size_t, 3> jit_vec_widths = {4, 2, 1};
+
+/**
+ * Return the vector width a JIT-compiled element-wise kernel uses for
+ * buffers `bufs` with elements of sizes `sizes`.
+ *
+ * This is the widest width in `jit_vec_widths` for which every buffer
+ * is aligned to a full vector.
+ */
+std::size_t get_jit_vec_width(std::vector<void const*> const& bufs,
+                              std::vector<std::size_t> const& sizes);
+
+/** An element-wise kernel compiled at runtime. */
+class JitElementwiseKernel
+{
+public:
+  /** The operation this kernel computes. */
+  JitElementwiseOp const& get_op() const noexcept { return op; }
+
+  /**
+   * Launch the kernel over `size` elements on `stream`, writing to
+   * `out` and reading from `ins`, whose elements must have the types of
+   * the operation.
+   */
+  void launch(DeviceStream stream,
+              std::size_t size,
+              void* out,
+              std::vector<void const*> const& ins) const;
+
+  /** Launch the kernel, checking the buffer types match the operation. */
+  template <typename OutT, typename... InTs>
+  void operator()(DeviceStream stream,
+                  std::size_t size,
+                  OutT* out,
+                  InTs const*... ins) const
+  {
+    check_types({jit_type_name<OutT>(), jit_type_name<InTs>()...});
+    launch(stream, size, out, {static_cast<void const*>(ins)...});
+  }
+
+  JitElementwiseKernel(JitElementwiseOp op_,
+                       void* module_,
+                       std::array<void*, jit_vec_widths.size()> functions_);
+  ~JitElementwiseKernel();
+  JitElementwiseKernel(JitElementwiseKernel const&) = delete;
+  JitElementwiseKernel& operator=(JitElementwiseKernel const&) = delete;
+
+private:
+  void check_types(std::vector<char const*> const& types) const;
+
+  JitElementwiseOp op;
+  /** Size of the output type followed by those of the input types. */
+  std::vector<std::size_t> type_sizes;
+  /** Backend-specific module handle. */
+  void* module;
+  /** Kernel for each of `jit_vec_widths`. */
+  std::array<void*, jit_vec_widths.size()> functions;
+};
+
+/**
+ * Return the kernel for `op` on the current GPU, compiling it (or
+ * loading it from the on-disk cache) if it has not been used yet.
+ *
+ * The kernel remains valid until the end of the program. Compilation
+ * errors are thrown with the compiler log.
+ */
+JitElementwiseKernel const&
+get_jit_elementwise_kernel(JitElementwiseOp const& op);
+
+}  // namespace gpu
+}  // namespace h2
@@ -27,9 +27,55 @@
  *  void mem_copy(void* dst, void const* src, size_t bytes,
  *                DeviceStream stream);
  *
+ *  void mem_copy_peer(void* dst, int dst_device, void const* src,
+ *                     int src_device, size_t bytes, DeviceStream stream);
+ *
+ *  void mem_copy_2d(void* dst, size_t dpitch, void const* src,
+ *                   size_t spitch, size_t width, size_t height,
+ *                   DeviceStream stream);
+ *  void mem_copy_3d(void* dst, size_t dpitch, size_t dheight,
+ *                   void const* src, size_t spitch, size_t sheight,
+ *                   size_t width, size_t height, size_t depth,
+ *                   DeviceStream stream);
+ *
  *  void mem_zero(void* mem, size_t bytes);
  *  void mem_zero(void* mem, size_t bytes, DeviceStream stream);
  *
+ *  void* mem_alloc_async(size_t bytes, DeviceStream stream);
+ *  void mem_free_async(void* ptr, DeviceStream stream);
+ *
+ *  void* host_alloc_pinned(size_t bytes);
+ *  void host_free_pinned(void* ptr);
+ *  void host_register(void* ptr, size_t bytes, bool read_only);
+ *  void host_unregister(void* ptr);
+ *  bool is_pageable_host_memory(void const* ptr);
+ *  int get_mem_device(void const* ptr);
+ *
+ *  bool can_access_peer(int device, int peer);
+ *  void enable_peer_access(int peer);
+ *
+ *  enum class MemAdvice { ReadMostly, PreferredLocation, AccessedBy };
+ *  void* mem_alloc_managed(size_t bytes);
+ *  void mem_prefetch_async(void const* ptr, size_t bytes, int device,
+ *                          DeviceStream stream);
+ *  void mem_advise(void const* ptr, size_t bytes, MemAdvice advice,
+ *                  int device);
+ *
+ *  void* mem_alloc(size_t bytes);
+ *  void mem_free(void* ptr);
+ *
+ *  enum class AllocatorBackend { CUB, StreamOrdered, SizeClass };
+ *  AllocatorBackend allocator_backend();
+ *  void* stream_ordered_allocate(size_t bytes, DeviceStream stream);
+ *  h2::internal::SizeClassAllocator& size_class_allocator();
+ *
+ *  class MemoryPool;
+ *  MemoryPool& memory_pool();
+ *  MemoryPool& hydrogen_memory_pool();
+ *  bool shares_hydrogen_memory_pool();
+ *  size_t cached_bytes();
+ *  void trim_cache();
+ *
  *  template <typename T>
  *  void mem_copy(T* dst, T const* src, size_t n_elmts);
  *  template <typename T>
@@ -47,6 +93,8 @@
 
 #include "runtime.hpp"
 
+#include <cstdint>
+
 namespace h2
 {
 namespace gpu
@@ -58,6 +106,63 @@ struct MemInfo
   size_t total;
 };
 
+/** @brief Backends H2 may use to allocate GPU memory. */
+enum class AllocatorBackend
+{
+  /** The (HIP)CUB caching allocator (see `default_cub_allocator`). */
+  CUB,
+  /** The device's default stream-ordered ({cuda,hip}MallocAsync) pool. */
+  StreamOrdered,
+  /** H2's size-class caching allocator (see `size_class_allocator`). */
+  SizeClass
+};
+
+/** @brief A pool of device memory.
+ *
+ *  This is the common interface to the allocator backends, so a
+ *  backend can be used (and shared) without knowing which it is.
+ *  Everything applies to the current device.
+ */
+class MemoryPool
+{
+public:
+  virtual ~MemoryPool() = default;
+
+  /** @brief Allocate `bytes` for use on `stream`.
+   *
+   *  Throws if the memory cannot be allocated, even after releasing
+   *  unused memory cached by other pools.
+   */
+  virtual void* allocate(size_t bytes, DeviceStream stream) = 0;
+
+  /** @brief Return memory from `allocate`, ordered after `stream`. */
+  virtual void deallocate(void* ptr, DeviceStream stream) = 0;
+
+  /** @brief Bytes held by the pool but not in use. */
+  virtual size_t cached_bytes() = 0;
+
+  /** @brief Return unused cached memory to the system.
+   *
+   *  The caller must ensure no pending work uses cached memory.
+   */
+  virtual void trim() = 0;
+};
+
+/** @brief Hints for managed (unified) memory.
+ *
+ *  These correspond to the "set" variants of {cuda,hip}MemAdvise. The
+ *  device an advice refers to may be `host_device_id` for the host.
+ */
+enum class MemAdvice
+{
+  /** Data is mostly read, so pages may be duplicated on each reader. */
+  ReadMostly,
+  /** Pages should preferably reside on the given device. */
+  PreferredLocation,
+  /** Data will be accessed by the given device, so keep it mapped. */
+  AccessedBy
+};
+
 }  // namespace gpu
 }  // namespace h2
 
@@ -73,6 +178,14 @@ namespace H2_CUB_NAMESPACE
 class CachingDeviceAllocator;
 }
 
+namespace h2
+{
+namespace internal
+{
+class SizeClassAllocator;
+}
+}  // namespace h2
+
 namespace h2
 {
 namespace gpu
@@ -132,6 +245,90 @@ RawCUBAllocType make_allocator(unsigned int const gf = cub_growth_factor(),
                                size_t const max_cached = cub_max_cached_size(),
                                bool const debug = cub_debug());
 
+/** @brief The backend H2 uses for GPU allocations.
+ *
+ *  This is determined on first call and is fixed thereafter, since
+ *  memory must be returned to the backend it came from.
+ *
+ *  Environment variable: H2_GPU_ALLOCATOR ("cub", "async", or
+ *  "sizeclass")
+ *  Default value: "cub"
+ */
+AllocatorBackend allocator_backend();
+
+/** @brief The release threshold for stream-ordered memory pools.
+ *
+ *  This is the number of bytes a pool may hold onto before returning
+ *  memory to the system at synchronization points.
+ *
+ *  Environment variable: H2_GPU_MEMPOOL_RELEASE_THRESHOLD
+ *  Default value: no limit (memory is never released early)
+ */
+uint64_t mem_pool_release_threshold();
+
+/** @brief Allocate memory from the current device's stream-ordered pool.
+ *
+ *  The memory is usable on `stream` immediately, and by other streams
+ *  once they have synchronized with `stream`. It should be freed with
+ *  `mem_free_async` on a stream that is ordered after all its uses,
+ *  which avoids any host synchronization.
+ *
+ *  On first use on a device, this configures the device's pool with
+ *  `mem_pool_release_threshold()`.
+ */
+void* stream_ordered_allocate(size_t bytes, DeviceStream stream);
+
+/** @brief The current device's size-class caching allocator.
+ *
+ *  Each device has its own allocator, created on first use, which
+ *  caches blocks per stream. Its rounding policy is set by:
+ *
+ *  Environment variable: H2_GPU_CACHE_MIN_BLOCK
+ *  Default value: 512 bytes
+ *
+ *  Environment variable: H2_GPU_CACHE_LINEAR_THRESHOLD
+ *  Default value: 1 MiB (smaller requests round to a power of two)
+ *
+ *  Environment variable: H2_GPU_CACHE_LINEAR_STEP
+ *  Default value: 128 KiB (larger requests round to a multiple of this)
+ */
+h2::internal::SizeClassAllocator& size_class_allocator();
+
+/** @brief The pool H2 allocates GPU memory from.
+ *
+ *  This is the pool for `allocator_backend()`. With the CUB backend,
+ *  it is the pool of `default_cub_allocator()`, and so is Hydrogen's
+ *  pool unless H2_INTERNAL_CUB_POOL=1.
+ */
+MemoryPool& memory_pool();
+
+/** @brief Hydrogen's (HIP)CUB pool, as an H2 memory pool.
+ *
+ *  Code that wants to share memory with Hydrogen can allocate from
+ *  this rather than keeping a cache of its own.
+ */
+MemoryPool& hydrogen_memory_pool();
+
+/** @brief Return true if `memory_pool()` is Hydrogen's pool. */
+bool shares_hydrogen_memory_pool();
+
+/** @brief Bytes cached but unused by the GPU memory pools.
+ *
+ *  This is for the current device, and includes Hydrogen's pool when
+ *  H2 does not share it, so it accounts for all memory cached by
+ *  either library.
+ */
+size_t cached_bytes();
+
+/** @brief Return unused cached memory on the current device.
+ *
+ *  This synchronizes the device first, so no pending work can still be
+ *  using cached memory. Hydrogen's pool is trimmed too when H2 does
+ *  not share it. Trimming is a no-op for the stream-ordered backend,
+ *  whose pool is trimmed by its release threshold.
+ */
+void trim_cache();
+
 template <typename T>
 inline void mem_copy(T* dst, T const* src)
 {
@@ -9,8 +9,9 @@
 
 /** @file
  *
- *  Thin wrappers around hipMem{cpy,set} functions. These are here so
- *  they can be inlined if possible.
+ *  Thin wrappers around hipMem{cpy,set}, stream-ordered and managed
+ *  allocation functions. These are here so they can be inlined if
+ *  possible.
  */
 #include "h2_config.hpp"
 
@@ -20,11 +21,16 @@
 #include <hip/hip_runtime.h>
 #include <hydrogen/PoolAllocator.hpp>
 
+#include <cstdint>
+
 namespace h2
 {
 namespace gpu
 {
 
+/** Device ID that refers to the host in prefetches and advice. */
+inline constexpr int host_device_id = hipCpuDeviceId;
+
 using RawCUBAllocType = hydrogen::PooledDeviceAllocator;
 
 inline MemInfo mem_info()
@@ -57,6 +63,69 @@ inline void mem_copy(void* const dst,
   H2_CHECK_HIP(hipMemcpyAsync(dst, src, bytes, hipMemcpyDefault, stream));
 }
 
+/**
+ * Copy `height` rows of `width` bytes, where consecutive rows start
+ * `dpitch` and `spitch` bytes apart in `dst` and `src`.
+ */
+inline void mem_copy_2d(void* dst,
+                        size_t dpitch,
+                        void const* src,
+                        size_t spitch,
+                        size_t width,
+                        size_t height,
+                        DeviceStream stream)
+{
+  H2_GPU_TRACE("hipMemcpy2DAsync(dst={}, dpitch={}, src={}, spitch={}, "
+               "width={}, height={}, kind=hipMemcpyDefault, stream={})",
+               dst,
+               dpitch,
+               src,
+               spitch,
+               width,
+               height,
+               (void*) stream);
+  H2_CHECK_HIP(hipMemcpy2DAsync(
+    dst, dpitch, src, spitch, width, height, hipMemcpyDefault, stream));
+}
+
+/**
+ * Copy `depth` slices of `height` rows of `width` bytes. Rows start
+ * `dpitch` and `spitch` bytes apart, and slices `dheight` and
+ * `sheight` rows apart, in `dst` and `src`.
+ */
+inline void mem_copy_3d(void* dst,
+                        size_t dpitch,
+                        size_t dheight,
+                        void const* src,
+                        size_t spitch,
+                        size_t sheight,
+                        size_t width,
+                        size_t height,
+                        size_t depth,
+                        DeviceStream stream)
+{
+  H2_GPU_TRACE("hipMemcpy3DAsync(dst={}, dpitch={}, dheight={}, src={}, "
+               "spitch={}, sheight={}, width={}, height={}, depth={}, "
+               "kind=hipMemcpyDefault, stream={})",
+               dst,
+               dpitch,
+               dheight,
+               src,
+               spitch,
+               sheight,
+               width,
+               height,
+               depth,
+               (void*) stream);
+  hipMemcpy3DParms params = {};
+  params.dstPtr = make_hipPitchedPtr(dst, dpitch, width, dheight);
+  params.srcPtr =
+    make_hipPitchedPtr(const_cast<void*>(src), spitch, width, sheight);
+  params.extent = make_hipExtent(width, height, depth);
+  params.kind = hipMemcpyDefault;
+  H2_CHECK_HIP(hipMemcpy3DAsync(&params, stream));
+}
+
 inline void mem_zero(void* mem, size_t bytes)
 {
   H2_GPU_TRACE("hipMemset(mem={}, value=0x0, bytes={})", mem, bytes);
@@ -72,5 +141,212 @@ inline void mem_zero(void* mem, size_t bytes, DeviceStream stream)
   H2_CHECK_HIP(hipMemsetAsync(mem, 0x0, bytes, stream));
 }
 
+/** Allocate device memory, returning null if out of memory. */
+inline void* mem_alloc(size_t bytes)
+{
+  void* ptr = nullptr;
+  auto const status = hipMalloc(&ptr, bytes);
+  if (status == hipErrorOutOfMemory)
+  {
+    // Clear the error so it is not reported by later calls.
+    static_cast<void>(hipGetLastError());
+    H2_GPU_TRACE("hipMalloc(bytes={}) out of memory", bytes);
+    return nullptr;
+  }
+  H2_CHECK_HIP(status);
+  H2_GPU_TRACE("hipMalloc(ptr={}, bytes={})", ptr, bytes);
+  return ptr;
+}
+
+inline void mem_free(void* ptr)
+{
+  H2_GPU_TRACE("hipFree(ptr={})", ptr);
+  H2_CHECK_HIP(hipFree(ptr));
+}
+
+inline void* mem_alloc_managed(size_t bytes)
+{
+  void* ptr = nullptr;
+  H2_CHECK_HIP(hipMallocManaged(&ptr, bytes, hipMemAttachGlobal));
+  H2_GPU_TRACE("hipMallocManaged(ptr={}, bytes={})", ptr, bytes);
+  return ptr;
+}
+
+inline void mem_prefetch_async(void const* ptr,
+                               size_t bytes,
+                               int device,
+                               DeviceStream stream)
+{
+  H2_GPU_TRACE("hipMemPrefetchAsync(ptr={}, bytes={}, device={}, stream={})",
+               ptr,
+               bytes,
+               device,
+               (void*) stream);
+  H2_CHECK_HIP(hipMemPrefetchAsync(ptr, bytes, device, stream));
+}
+
+inline void
+mem_advise(void const* ptr, size_t bytes, MemAdvice advice, int device)
+{
+  hipMemoryAdvise hip_advice = hipMemAdviseSetReadMostly;
+  switch (advice)
+  {
+  case MemAdvice::ReadMostly: hip_advice = hipMemAdviseSetReadMostly; break;
+  case MemAdvice::PreferredLocation:
+    hip_advice = hipMemAdviseSetPreferredLocation;
+    break;
+  case MemAdvice::AccessedBy: hip_advice = hipMemAdviseSetAccessedBy; break;
+  }
+  H2_GPU_TRACE("hipMemAdvise(ptr={}, bytes={}, advice={}, device={})",
+               ptr,
+               bytes,
+               static_cast<int>(hip_advice),
+               device);
+  H2_CHECK_HIP(hipMemAdvise(ptr, bytes, hip_advice, device));
+}
+
+inline void* mem_alloc_async(size_t bytes, DeviceStream stream)
+{
+  void* ptr = nullptr;
+  H2_CHECK_HIP(hipMallocAsync(&ptr, bytes, stream));
+  H2_GPU_TRACE("hipMallocAsync(ptr={}, bytes={}, stream={})",
+               ptr,
+               bytes,
+               (void*) stream);
+  return ptr;
+}
+
+inline void mem_free_async(void* ptr, DeviceStream stream)
+{
+  H2_GPU_TRACE("hipFreeAsync(ptr={}, stream={})", ptr, (void*) stream);
+  H2_CHECK_HIP(hipFreeAsync(ptr, stream));
+}
+
+inline void* host_alloc_pinned(size_t bytes)
+{
+  void* ptr = nullptr;
+  H2_CHECK_HIP(hipHostMalloc(&ptr, bytes, hipHostMallocDefault));
+  H2_GPU_TRACE("hipHostMalloc(ptr={}, bytes={})", ptr, bytes);
+  return ptr;
+}
+
+inline void host_free_pinned(void* ptr)
+{
+  H2_GPU_TRACE("hipHostFree(ptr={})", ptr);
+  H2_CHECK_HIP(hipHostFree(ptr));
+}
+
+inline void host_register(void* ptr, size_t bytes, bool read_only)
+{
+  unsigned int const flags =
+    read_only ? hipHostRegisterReadOnly : hipHostRegisterDefault;
+  H2_GPU_TRACE("hipHostRegister(ptr={}, bytes={}, flags={})",
+               ptr,
+               bytes,
+               flags);
+  H2_CHECK_HIP(hipHostRegister(ptr, bytes, flags));
+}
+
+inline void host_unregister(void* ptr)
+{
+  H2_GPU_TRACE("hipHostUnregister(ptr={})", ptr);
+  H2_CHECK_HIP(hipHostUnregister(ptr));
+}
+
+/**
+ * Return true if `ptr` is ordinary (pageable) host memory, i.e., not
+ * pinned, registered, managed, or device memory.
+ */
+inline bool is_pageable_host_memory(void const* ptr)
+{
+  hipPointerAttribute_t attr;
+  hipError_t const status = hipPointerGetAttributes(&attr, ptr);
+  if (status == hipErrorInvalidValue)
+  {
+    // Older runtimes report pageable memory as an invalid pointer.
+    (void) hipGetLastError();
+    return true;
+  }
+  H2_CHECK_HIP(status);
+  return attr.type == hipMemoryTypeUnregistered;
+}
+
+/** Return the ID of the GPU that owns the device memory at `ptr`. */
+inline int get_mem_device(void const* ptr)
+{
+  hipPointerAttribute_t attr;
+  H2_CHECK_HIP(hipPointerGetAttributes(&attr, ptr));
+  return attr.device;
+}
+
+/** Return true if GPU `device` can directly access memory on `peer`. */
+inline bool can_access_peer(int device, int peer)
+{
+  int can_access = 0;
+  H2_CHECK_HIP(hipDeviceCanAccessPeer(&can_access, device, peer));
+  return can_access != 0;
+}
+
+/**
+ * Enable direct access from the current GPU to memory on `peer`.
+ *
+ * It is not an error if access is already enabled.
+ */
+inline void enable_peer_access(int peer)
+{
+  H2_GPU_TRACE("hipDeviceEnablePeerAccess(peer={})", peer);
+  hipError_t const status = hipDeviceEnablePeerAccess(peer, 0);
+  if (status == hipErrorPeerAccessAlreadyEnabled)
+  {
+    (void) hipGetLastError();
+    return;
+  }
+  H2_CHECK_HIP(status);
+}
+
+inline void mem_copy_peer(void* dst,
+                          int dst_device,
+                          void const* src,
+                          int src_device,
+                          size_t bytes,
+                          DeviceStream stream)
+{
+  H2_GPU_TRACE("hipMemcpyPeerAsync(dst={}, dst_device={}, src={}, "
+               "src_device={}, bytes={}, stream={})",
+               dst,
+               dst_device,
+               src,
+               src_device,
+               bytes,
+               (void*) stream);
+  H2_CHECK_HIP(
+    hipMemcpyPeerAsync(dst, dst_device, src, src_device, bytes, stream));
+}
+
+inline void set_mem_pool_release_threshold(int device, uint64_t threshold)
+{
+  hipMemPool_t pool;
+  H2_CHECK_HIP(hipDeviceGetDefaultMemPool(&pool, device));
+  H2_GPU_TRACE("setting release threshold of memory pool {} on device {} to {}",
+               (void*) pool,
+               device,
+               threshold);
+  H2_CHECK_HIP(
+    hipMemPoolSetAttribute(pool, hipMemPoolAttrReleaseThreshold, &threshold));
+}
+
+inline uint64_t mem_pool_cached_bytes(int device)
+{
+  hipMemPool_t pool;
+  H2_CHECK_HIP(hipDeviceGetDefaultMemPool(&pool, device));
+  uint64_t reserved = 0;
+  uint64_t used = 0;
+  H2_CHECK_HIP(hipMemPoolGetAttribute(
+    pool, hipMemPoolAttrReservedMemCurrent, &reserved));
+  H2_CHECK_HIP(
+    hipMemPoolGetAttribute(pool, hipMemPoolAttrUsedMemCurrent, &used));
+  return reserved - used;
+}
+
 }  // namespace gpu
 }  // namespace h2
@@ -34,6 +34,8 @@ namespace gpu
 typedef hipStream_t DeviceStream;
 typedef hipEvent_t DeviceEvent;
 typedef hipError_t DeviceError;
+typedef hipGraph_t DeviceGraph;
+typedef hipGraphExec_t DeviceGraphExec;
 
 constexpr unsigned int max_grid_x = 2147483647;
 constexpr unsigned int max_grid_y = 65536;
@@ -83,5 +85,23 @@ void launch_kernel_internal(void (*kernel)(KernelArgs...),
   H2_CHECK_HIP(hipGetLastError());
 }
 
+/**
+ * Return the maximum number of blocks of `kernel` that may be resident
+ * on one compute unit when launched with the given block size.
+ */
+template <typename... KernelArgs>
+unsigned int max_active_blocks_per_sm(void (*kernel)(KernelArgs...),
+                                      unsigned int block_size,
+                                      std::size_t shared_mem = 0)
+{
+  int num_blocks = 0;
+  H2_CHECK_HIP(hipOccupancyMaxActiveBlocksPerMultiprocessor(
+    &num_blocks,
+    reinterpret_cast<void const*>(kernel),
+    static_cast<int>(block_size),
+    shared_mem));
+  return static_cast<unsigned int>(num_blocks);
+}
+
 }  // namespace gpu
 }  // namespace h2
@@ -15,21 +15,33 @@
  *
  *  typedef {cuda,hip}Stream_t DeviceStream;
  *  typedef {cuda,hip}Event_t DeviceEvent;
+ *  typedef {cuda,hip}Graph_t DeviceGraph;
+ *  typedef {cuda,hip}GraphExec_t DeviceGraphExec;
  *
  *  int num_gpus();
  *  int current_gpu();
  *  void set_gpu(int id);
+ *  int selected_gpu();
+ *  class CurrentGPUGuard;
  *
  *  void init_runtime();
  *  void finalize_runtime();
  *  bool runtime_is_initialized();
  *  bool runtime_is_finalized();
+ *  void ensure_runtime_active();
+ *  RuntimeInitTimes get_runtime_init_times();
  *  bool is_integrated();
+ *  int num_sms();
+ *  std::string device_name();
+ *  DeviceProperties const& device_properties(int id);
+ *  DeviceProperties const& device_properties();
  *
  *  bool ok(DeviceError) noexcept;
  *
  *  DeviceStream make_stream();
  *  DeviceStream make_stream_nonblocking();
+ *  DeviceStream make_stream_with_priority(int);
+ *  std::pair<int, int> stream_priority_range();
  *  void destroy(DeviceStream);
  *  void record_event(DeviceEvent, DeviceStream);
  *
@@ -40,8 +52,21 @@
  *  void sync();             // Device Sync
  *  void sync(DeviceEvent);  // Sync on event.
  *  void sync(DeviceStream); // Sync on stream.
+ *  bool query(DeviceEvent); // Whether an event completed.
+ *  float elapsed_time(DeviceEvent, DeviceEvent);
+ *
+ *  void begin_capture(DeviceStream);
+ *  DeviceGraph end_capture(DeviceStream);
+ *  bool is_capturing(DeviceStream);
+ *  DeviceGraphExec instantiate(DeviceGraph);
+ *  void launch_graph(DeviceGraphExec, DeviceStream);
+ *  void destroy(DeviceGraph);
+ *  void destroy(DeviceGraphExec);
  *
  *  void launch_kernel(...)
+ *  unsigned int max_resident_blocks(kernel, block_size, shared_mem);
+ *  unsigned int occupancy_num_blocks(kernel, num_work_blocks, ...);
+ *  void launch_occupancy_kernel(...)
  *
  *  Constants that may be useful:
  *  unsigned int max_grid_x, max_grid_y, max_grid_z
@@ -55,7 +80,11 @@
 #include "h2/gpu/logger.hpp"
 #include "h2/meta/TypeList.hpp"
 
+#include <algorithm>
+#include <cstddef>
+#include <string>
 #include <type_traits>
+#include <utility>
 
 // This adds the runtime-specific stuff.
 #if H2_HAS_CUDA
@@ -74,16 +103,175 @@ int num_gpus();
 int current_gpu();
 void set_gpu(int id);
 
+/**
+ * Return the GPU selected for this process by `init_runtime`, or -1 if
+ * the runtime is not initialized.
+ *
+ * Hydrogen's default stream and event belong to this GPU. Threads may
+ * make other GPUs current (see `CurrentGPUGuard`) to drive several
+ * GPUs from one process.
+ */
+int selected_gpu();
+
+/**
+ * Make a GPU current for the lifetime of the guard, then restore the
+ * GPU that was current before.
+ *
+ * The current GPU is per host thread. Nothing is set when the GPU is
+ * already current, so guards are cheap when a process uses one GPU.
+ */
+class CurrentGPUGuard
+{
+public:
+  /** Only restore the current GPU when leaving scope. */
+  CurrentGPUGuard() : prev_id(current_gpu()) {}
+
+  /** Make GPU `id` current; negative ids leave the current GPU as is. */
+  explicit CurrentGPUGuard(int id) : CurrentGPUGuard()
+  {
+    if (id >= 0 && id != prev_id)
+    {
+      set_gpu(id);
+    }
+  }
+
+  ~CurrentGPUGuard()
+  {
+    if (current_gpu() != prev_id)
+    {
+      set_gpu(prev_id);
+    }
+  }
+
+  CurrentGPUGuard(CurrentGPUGuard const&) = delete;
+  CurrentGPUGuard& operator=(CurrentGPUGuard const&) = delete;
+
+private:
+  int prev_id;
+};
+
+/**
+ * Initialize the GPU runtime and select this process's GPU.
+ *
+ * Unless `H2_GPU_LAZY_INIT` is set, this also activates the runtime
+ * (see `ensure_runtime_active`).
+ */
 void init_runtime();
 void finalize_runtime();
 bool runtime_is_initialized();
 bool runtime_is_finalized();
 
+/**
+ * Set the GPU selected by `init_runtime`, creating its context, and
+ * pre-warm the memory pool with `H2_GPU_POOL_RESERVE` bytes, if this
+ * has not been done yet.
+ *
+ * With `H2_GPU_LAZY_INIT`, this is deferred until first device use:
+ * creating an H2 stream or allocating from `memory_pool` calls this.
+ * Call it directly before using the GPU by other means. This is a
+ * no-op if the runtime is not initialized.
+ */
+void ensure_runtime_active();
+
+/** Time, in seconds, spent in phases of GPU runtime initialization. */
+struct RuntimeInitTimes
+{
+  /** Initializing the runtime and selecting a GPU. */
+  double select_gpu = 0.0;
+  /** Setting the GPU and creating its context. */
+  double create_context = 0.0;
+  /** Pre-warming the memory pool. */
+  double reserve_pool = 0.0;
+  /** Whether the context was created lazily, on first use. */
+  bool lazy = false;
+};
+
+/**
+ * Return the times spent initializing the GPU runtime.
+ *
+ * Context and pool times are zero until the runtime is active.
+ */
+RuntimeInitTimes get_runtime_init_times();
+
+namespace internal
+{
+
+/**
+ * Record that the runtime selected `gpu_id` in `select_time` seconds,
+ * and activate it unless initialization is lazy.
+ */
+void start_runtime(int gpu_id, double select_time);
+
+/** Record that the runtime was finalized. */
+void stop_runtime();
+
+}  // namespace internal
+
 /** True if the CPU and GPU are one integrated platform (like an APU) */
 bool is_integrated();
 
+/** Number of multiprocessors (SMs or CUs) on the current GPU. */
+int num_sms();
+
+/** Name of the current GPU. */
+std::string device_name();
+
+/** Properties of a GPU that launch heuristics and tuning depend on. */
+struct DeviceProperties
+{
+  /** Name of the GPU. */
+  std::string name;
+  /** Number of multiprocessors (SMs or CUs). */
+  int num_sms = 0;
+  /** Number of threads in a warp (or wavefront). */
+  int warp_size = 0;
+  /** Size of the L2 cache in bytes. */
+  std::size_t l2_cache_size = 0;
+  /** Maximum shared memory (LDS) one block may use, in bytes. */
+  std::size_t shared_mem_per_block = 0;
+  /** Total global memory in bytes. */
+  std::size_t total_mem = 0;
+  /** Theoretical peak memory bandwidth in bytes per second. */
+  double peak_bandwidth = 0.0;
+  /** True if the GPU shares memory with the CPU (like an APU). */
+  bool integrated = false;
+  /** PCI address of the GPU, as "domain:bus:device.function". */
+  std::string pci_bus_id;
+};
+
+/**
+ * Return the properties of GPU `gpu_id`.
+ *
+ * Properties of all GPUs are queried once, when the runtime is
+ * initialized, and cached, so this is cheap.
+ */
+DeviceProperties const& device_properties(int gpu_id);
+
+/** Return the properties of the current GPU. */
+DeviceProperties const& device_properties();
+
+namespace internal
+{
+
+/** Query the properties of GPU `gpu_id` from the runtime. */
+DeviceProperties query_device_properties(int gpu_id);
+
+}  // namespace internal
+
 DeviceStream make_stream();
 DeviceStream make_stream_nonblocking();
+/**
+ * Create a non-blocking stream with the given priority, which should be
+ * in `stream_priority_range`.
+ */
+DeviceStream make_stream_with_priority(int priority);
+/**
+ * Return the least and greatest stream priorities of the current GPU.
+ *
+ * Lower numbers are higher priorities, so the greatest priority is the
+ * second (lower) value.
+ */
+std::pair<int, int> stream_priority_range();
 void destroy(DeviceStream);
 
 DeviceEvent make_event();
@@ -96,6 +284,34 @@ void sync(DeviceEvent);                // Sync on event.
 void sync(DeviceStream);               // Sync on stream.
 void sync(DeviceStream, DeviceEvent);  // Sync stream on event.
 
+/** Return whether all work recorded in `event` completed, without blocking. */
+bool query(DeviceEvent event);
+
+/**
+ * Return the time in milliseconds between two completed events.
+ *
+ * Both events must have been created with timing enabled.
+ */
+float elapsed_time(DeviceEvent start, DeviceEvent end);
+
+/**
+ * Begin capturing work submitted to `stream` into a graph.
+ *
+ * Capture is in relaxed mode, so other threads may continue to use the
+ * runtime (including allocating memory) while it is in progress.
+ */
+void begin_capture(DeviceStream stream);
+/** End capturing work on `stream` and return the captured graph. */
+DeviceGraph end_capture(DeviceStream stream);
+/** Return whether work on `stream` is currently being captured. */
+bool is_capturing(DeviceStream stream);
+/** Create an executable graph from a captured graph. */
+DeviceGraphExec instantiate(DeviceGraph graph);
+/** Launch an executable graph on `stream`. */
+void launch_graph(DeviceGraphExec graph, DeviceStream stream);
+void destroy(DeviceGraph);
+void destroy(DeviceGraphExec);
+
 namespace internal
 {
 
@@ -152,8 +368,51 @@ void const* convert_for_fmt(T const* const v) noexcept
   return reinterpret_cast<void const*>(v);
 }
 
+/**
+ * Return the cached number of blocks of `kernel` that may be resident
+ * on the current GPU with the given launch parameters, or 0 if it has
+ * not been cached.
+ */
+unsigned int get_cached_max_resident_blocks(void const* kernel,
+                                            unsigned int block_size,
+                                            std::size_t shared_mem);
+
+/** Cache the result of `max_resident_blocks` for the current GPU. */
+void set_cached_max_resident_blocks(void const* kernel,
+                                    unsigned int block_size,
+                                    std::size_t shared_mem,
+                                    unsigned int num_blocks);
+
+// These are implemented by the tracer (see `h2/core/tracer.hpp`).
+
+/** Return true if kernel launches are traced. */
+bool tracing_kernel_launches();
+
+/**
+ * Start tracing a launch of `kernel` on `stream`.
+ *
+ * Returns an opaque record to finish it with, which is null if the
+ * launch is not recorded.
+ */
+void* trace_kernel_launch_begin(void const* kernel,
+                                dim3 const& grid_dim,
+                                dim3 const& block_dim,
+                                std::size_t shared_mem,
+                                DeviceStream stream);
+
+/** Finish tracing a launch started with `trace_kernel_launch_begin`. */
+void trace_kernel_launch_end(void* record, DeviceStream stream);
+
 }  // namespace internal
 
+/**
+ * Launch `kernel` on `stream` with the given grid and block dimensions
+ * and dynamic shared memory.
+ *
+ * When tracing is enabled, the launch is recorded with its dimensions
+ * and GPU execution time. If the launch fails, the kernel and its
+ * launch parameters are logged before the error is rethrown.
+ */
 template <typename... KernelArgs, typename... Args>
 inline void launch_kernel(void (*kernel)(KernelArgs...),
                           dim3 const& grid_dim,
@@ -246,12 +505,114 @@ inline void launch_kernel(void (*kernel)(KernelArgs...),
                shared_mem,
                (void*) stream,
                internal::convert_for_fmt(std::forward<Args>(args))...);
-  launch_kernel_internal(kernel,
-                         grid_dim,
-                         block_dim,
-                         shared_mem,
-                         stream,
-                         std::forward<Args>(args)...);
+  void* const trace_record =
+    internal::tracing_kernel_launches()
+      ? internal::trace_kernel_launch_begin(
+          (void const*) kernel, grid_dim, block_dim, shared_mem, stream)
+      : nullptr;
+  try
+  {
+    launch_kernel_internal(kernel,
+                           grid_dim,
+                           block_dim,
+                           shared_mem,
+                           stream,
+                           std::forward<Args>(args)...);
+  }
+  catch (...)
+  {
+    H2_GPU_ERROR("failed to launch kernel {} ("
+                   + meta::tlist::print(meta::TL<KernelArgs...>{})
+                   + ") with grid_dim=({}, {}, {}), block_dim=({}, {}, "
+                     "{}), shared_mem={}, stream={}",
+                 (void*) kernel,
+                 grid_dim.x,
+                 grid_dim.y,
+                 grid_dim.z,
+                 block_dim.x,
+                 block_dim.y,
+                 block_dim.z,
+                 shared_mem,
+                 (void*) stream);
+    if (trace_record)
+    {
+      internal::trace_kernel_launch_end(trace_record, stream);
+    }
+    throw;
+  }
+  if (trace_record)
+  {
+    internal::trace_kernel_launch_end(trace_record, stream);
+  }
+}
+
+/**
+ * Return the number of blocks of `kernel` that may be resident on the
+ * current GPU at once when launched with the given block size and
+ * dynamic shared memory.
+ *
+ * This is always at least 1. Occupancy queries are not cheap, so the
+ * result is cached for each kernel, launch configuration, and GPU.
+ */
+template <typename... KernelArgs>
+unsigned int max_resident_blocks(void (*kernel)(KernelArgs...),
+                                 unsigned int block_size,
+                                 std::size_t shared_mem = 0)
+{
+  void const* const key = reinterpret_cast<void const*>(kernel);
+  unsigned int num_blocks =
+    internal::get_cached_max_resident_blocks(key, block_size, shared_mem);
+  if (num_blocks == 0)
+  {
+    num_blocks =
+      std::max(max_active_blocks_per_sm(kernel, block_size, shared_mem)
+                 * static_cast<unsigned int>(num_sms()),
+               1u);
+    internal::set_cached_max_resident_blocks(
+      key, block_size, shared_mem, num_blocks);
+  }
+  return num_blocks;
+}
+
+/**
+ * Return the number of blocks to launch `kernel` with to cover
+ * `num_work_blocks` blocks of work: that many, but no more than can be
+ * resident at once (see `max_resident_blocks`).
+ *
+ * This is the grid size for kernels that loop over their work with a
+ * grid stride, since extra blocks would only wait for others to finish.
+ */
+template <typename... KernelArgs>
+unsigned int occupancy_num_blocks(void (*kernel)(KernelArgs...),
+                                  std::size_t num_work_blocks,
+                                  unsigned int block_size,
+                                  std::size_t shared_mem = 0)
+{
+  std::size_t const max_blocks =
+    max_resident_blocks(kernel, block_size, shared_mem);
+  return static_cast<unsigned int>(
+    std::max(std::min(num_work_blocks, max_blocks), std::size_t{1}));
+}
+
+/**
+ * Launch a grid-stride `kernel` with 1D blocks of `block_size` threads
+ * on `occupancy_num_blocks` blocks to cover `num_work_blocks`.
+ */
+template <typename... KernelArgs, typename... Args>
+inline void launch_occupancy_kernel(void (*kernel)(KernelArgs...),
+                                    std::size_t num_work_blocks,
+                                    unsigned int block_size,
+                                    std::size_t shared_mem,
+                                    DeviceStream stream,
+                                    Args&&... args)
+{
+  launch_kernel(
+    kernel,
+    occupancy_num_blocks(kernel, num_work_blocks, block_size, shared_mem),
+    block_size,
+    shared_mem,
+    stream,
+    std::forward<Args>(args)...);
 }
 
 }  // namespace gpu
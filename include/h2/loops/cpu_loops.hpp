@@ -16,10 +16,18 @@
 
 #include <h2_config.hpp>
 
+#include "h2/core/profiling.hpp"
+#include "h2/core/thread_pool.hpp"
+#include "h2/loops/cpu_vec_helpers.hpp"
+#include "h2/loops/strided_loop_helpers.hpp"
 #include "h2/utils/const_for.hpp"
+#include "h2/utils/environment_vars.hpp"
 #include "h2/utils/function_traits.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <tuple>
 #include <type_traits>
 
 namespace h2
@@ -27,33 +35,21 @@ namespace h2
 namespace cpu
 {
 
-/**
- * Naive n-ary element-wise loop.
- *
- * If func returns a value, the first pointer in args is required to be
- * an output buffer of a type which func's return type is convertible
- * to. (The return value may not be discarded.)
- */
+namespace internal
+{
+
+/** Run an element-wise loop over the indices [start, end). */
 template <typename FuncT, typename... Args>
-void elementwise_loop(FuncT&& func, std::size_t size, Args... args)
+void elementwise_loop_range(FuncT& func,
+                            std::size_t start,
+                            std::size_t end,
+                            std::tuple<Args...> const& args_ptrs)
 {
   using traits = FunctionTraits<FuncT>;
   constexpr std::size_t arg_offset = traits::has_return ? 1 : 0;
-  static_assert(traits::arity + arg_offset == sizeof...(args),
-                "Argument number mismatch");
-  // TODO: Check args is convertible to function args.
-
-  std::tuple<Args...> args_ptrs{args...};
   meta::tlist::ToTuple<typename traits::ArgsList> loaded_args;
 
-  static_assert(
-    !traits::has_return
-      || std::is_convertible_v<
-        typename traits::RetT,
-        std::remove_pointer_t<std::tuple_element_t<0, decltype(args_ptrs)>>>,
-    "Cannt convert return value to output");
-
-  for (std::size_t i = 0; i < size; ++i)
+  for (std::size_t i = start; i < end; ++i)
   {
     const_for<arg_offset, sizeof...(Args), std::size_t{1}>([&](auto arg_i) {
       std::get<arg_i.value - arg_offset>(loaded_args) =
@@ -70,5 +66,286 @@ void elementwise_loop(FuncT&& func, std::size_t size, Args... args)
   }
 }
 
+/**
+ * Run a vectorized element-wise loop over the indices [start, end),
+ * storing results to out.
+ *
+ * Elements are peeled until out is aligned to a full vector, then
+ * processed in blocks of a fixed number of lanes, with a scalar loop
+ * for the remainder.
+ */
+template <typename FuncT, typename OutT, typename... InTs>
+void vectorized_elementwise_loop_range_with_output(FuncT& func,
+                                                   std::size_t start,
+                                                   std::size_t end,
+                                                   OutT* out,
+                                                   InTs*... in)
+{
+  constexpr std::size_t lanes = vector_lanes_v<OutT, InTs...>;
+  std::size_t const peel_end =
+    start
+    + std::min(end - start, elements_to_vector_alignment<lanes>(out + start));
+  std::size_t i = start;
+  for (; i < peel_end; ++i)
+  {
+    out[i] = func(in[i]...);
+  }
+  for (; i + lanes <= end; i += lanes)
+  {
+    H2_CPU_SIMD_LOOP
+    for (std::size_t lane = 0; lane < lanes; ++lane)
+    {
+      out[i + lane] = func(in[i + lane]...);
+    }
+  }
+  for (; i < end; ++i)
+  {
+    out[i] = func(in[i]...);
+  }
+}
+
+/** Like `vectorized_elementwise_loop_range_with_output` with no output. */
+template <typename FuncT, typename... InTs>
+void vectorized_elementwise_loop_range_no_output(FuncT& func,
+                                                 std::size_t start,
+                                                 std::size_t end,
+                                                 InTs*... in)
+{
+  constexpr std::size_t lanes = vector_lanes_v<InTs...>;
+  std::size_t i = start;
+  for (; i + lanes <= end; i += lanes)
+  {
+    H2_CPU_SIMD_LOOP
+    for (std::size_t lane = 0; lane < lanes; ++lane)
+    {
+      func(in[i + lane]...);
+    }
+  }
+  for (; i < end; ++i)
+  {
+    func(in[i]...);
+  }
+}
+
+/** Run a vectorized element-wise loop over the indices [start, end). */
+template <typename FuncT, typename... Args>
+void vectorized_elementwise_loop_range(FuncT& func,
+                                       std::size_t start,
+                                       std::size_t end,
+                                       std::tuple<Args...> const& args_ptrs)
+{
+  std::apply(
+    [&](auto... ptrs) {
+      if constexpr (FunctionTraits<FuncT>::has_return)
+      {
+        vectorized_elementwise_loop_range_with_output(
+          func, start, end, ptrs...);
+      }
+      else
+      {
+        vectorized_elementwise_loop_range_no_output(func, start, end, ptrs...);
+      }
+    },
+    args_ptrs);
+}
+
+template <typename FuncT, typename... Args>
+constexpr void check_elementwise_loop_args()
+{
+  using traits = FunctionTraits<FuncT>;
+  constexpr std::size_t arg_offset = traits::has_return ? 1 : 0;
+  static_assert(traits::arity + arg_offset == sizeof...(Args),
+                "Argument number mismatch");
+  // TODO: Check args is convertible to function args.
+  if constexpr (traits::has_return)
+  {
+    static_assert(
+      std::is_convertible_v<
+        typename traits::RetT,
+        std::remove_pointer_t<std::tuple_element_t<0, std::tuple<Args...>>>>,
+      "Cannt convert return value to output");
+  }
+}
+
+}  // namespace internal
+
+/**
+ * Naive n-ary element-wise loop.
+ *
+ * If func returns a value, the first pointer in args is required to be
+ * an output buffer of a type which func's return type is convertible
+ * to. (The return value may not be discarded.)
+ */
+template <typename FuncT, typename... Args>
+void elementwise_loop(FuncT&& func, std::size_t size, Args... args)
+{
+  internal::check_elementwise_loop_args<FuncT, Args...>();
+  internal::elementwise_loop_range(func, 0, size, std::tuple<Args...>{args...});
+}
+
+/**
+ * Vectorized n-ary element-wise loop.
+ *
+ * This has the same semantics as `elementwise_loop`, but is structured
+ * so the compiler can vectorize it: arguments are passed to func
+ * directly and the loop is processed in aligned blocks sized to the
+ * target's vector registers (see `cpu_vec_helpers.hpp`).
+ *
+ * Iterations are assumed to be independent, so each buffer must
+ * either be the same as or not overlap with every other buffer.
+ */
+template <typename FuncT, typename... Args>
+void vectorized_elementwise_loop(FuncT&& func, std::size_t size, Args... args)
+{
+  internal::check_elementwise_loop_args<FuncT, Args...>();
+  internal::vectorized_elementwise_loop_range(
+    func, 0, size, std::tuple<Args...>{args...});
+}
+
+/**
+ * Return the minimum number of elements each thread handles in
+ * `parallel_elementwise_loop`.
+ *
+ * This is set by the `H2_CPU_LOOP_GRAIN_SIZE` environment variable and
+ * read once.
+ */
+inline std::size_t get_parallel_loop_grain_size()
+{
+  static std::size_t const grain_size = std::max(
+    env::get<std::size_t>("CPU_LOOP_GRAIN_SIZE"), std::size_t{1});
+  return grain_size;
+}
+
+/**
+ * Multithreaded n-ary element-wise loop.
+ *
+ * This is the same as `vectorized_elementwise_loop` (with the same
+ * restrictions on buffers), but splits the index range into
+ * contiguous blocks run on H2's CPU thread pool (see `parallel_for`).
+ * Each block has at least `get_parallel_loop_grain_size()` elements,
+ * so small loops stay serial. `func` may be invoked concurrently and
+ * must be safe to call from multiple threads.
+ */
+template <typename FuncT, typename... Args>
+void parallel_elementwise_loop(FuncT&& func, std::size_t size, Args... args)
+{
+  H2_PROFILE_RANGE("h2::parallel_elementwise_loop", Compute);
+  internal::check_elementwise_loop_args<FuncT, Args...>();
+  std::tuple<Args...> const args_ptrs{args...};
+  std::size_t const num_blocks =
+    std::min(get_num_threads(), size / get_parallel_loop_grain_size());
+  if (num_blocks > 1)
+  {
+    std::size_t const block_size = (size + num_blocks - 1) / num_blocks;
+    parallel_for(num_blocks, [&](std::size_t block) {
+      std::size_t const start = block * block_size;
+      internal::vectorized_elementwise_loop_range(
+        func, start, std::min(start + block_size, size), args_ptrs);
+    });
+    return;
+  }
+  internal::vectorized_elementwise_loop_range(func, 0, size, args_ptrs);
+}
+
+namespace internal
+{
+
+/**
+ * Run a strided loop over `layout`, which has `NDim` dimensions (or a
+ * runtime number if 0), as `outer_size` runs of `inner_size` elements
+ * along its innermost dimension.
+ */
+template <int NDim, typename FuncT, typename... Args>
+void strided_elementwise_loop_outer(
+  FuncT& func,
+  StridedLoopLayout<sizeof...(Args)> const& layout,
+  DataIndexType inner_size,
+  DataIndexType outer_size,
+  Args... args)
+{
+  constexpr std::size_t num_bufs = sizeof...(Args);
+  auto run_outer_range = [&](DataIndexType outer_start,
+                             DataIndexType outer_end) {
+    for (DataIndexType outer = outer_start; outer < outer_end; ++outer)
+    {
+      DataIndexType offsets[num_bufs];
+      get_loop_offsets<NDim>(layout, outer * inner_size, offsets);
+      for (DataIndexType i = 0; i < inner_size; ++i)
+      {
+        ::h2::internal::apply_at_offsets(func, offsets, args...);
+        for (std::size_t b = 0; b < num_bufs; ++b)
+        {
+          offsets[b] += layout.strides[b][0];
+        }
+      }
+    }
+  };
+  std::size_t const num_blocks = std::min(
+    {get_num_threads(),
+     static_cast<std::size_t>(outer_size * inner_size)
+       / get_parallel_loop_grain_size(),
+     static_cast<std::size_t>(outer_size)});
+  if (num_blocks > 1)
+  {
+    DataIndexType const block_size =
+      (outer_size + static_cast<DataIndexType>(num_blocks) - 1)
+      / static_cast<DataIndexType>(num_blocks);
+    parallel_for(num_blocks, [&](std::size_t block) {
+      DataIndexType const start =
+        static_cast<DataIndexType>(block) * block_size;
+      run_outer_range(start, std::min(start + block_size, outer_size));
+    });
+    return;
+  }
+  run_outer_range(0, outer_size);
+}
+
+}  // namespace internal
+
+/**
+ * Strided n-ary element-wise loop.
+ *
+ * This is like `elementwise_loop`, but each buffer in args is accessed
+ * with its own strides (in order, in `strides`) over an iteration
+ * space of the given shape. A stride of 0 broadcasts an input buffer
+ * along that dimension; the output buffer, if any, must not have 0
+ * strides for dimensions of extent greater than 1.
+ *
+ * Contiguous dimensions are collapsed first, and if all buffers turn
+ * out to be contiguous, this is the same as
+ * `parallel_elementwise_loop`.
+ */
+template <typename FuncT, typename... Args>
+void strided_elementwise_loop(
+  FuncT&& func,
+  ShapeTuple const& shape,
+  std::array<StrideTuple, sizeof...(Args)> const& strides,
+  Args... args)
+{
+  internal::check_elementwise_loop_args<FuncT, Args...>();
+  constexpr std::size_t num_bufs = sizeof...(Args);
+  static_assert(num_bufs > 0, "Strided loops need at least one buffer");
+  StridedLoopLayout<num_bufs> const layout =
+    make_strided_loop_layout(shape, strides);
+  DataIndexType const size = layout.numel();
+  if (size == 0)
+  {
+    return;
+  }
+  if (layout.is_contiguous())
+  {
+    parallel_elementwise_loop(func, static_cast<std::size_t>(size), args...);
+    return;
+  }
+
+  // Run the innermost (fastest-varying) dimension in the inner loop.
+  DataIndexType const inner_size = layout.shape[0];
+  DataIndexType const outer_size = size / inner_size;
+  dispatch_loop_rank(layout.ndim, [&](auto ndim) {
+    internal::strided_elementwise_loop_outer<ndim.value>(
+      func, layout, inner_size, outer_size, args...);
+  });
+}
+
 }  // namespace cpu
 }  // namespace h2
@@ -0,0 +1,244 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+// This file is meant to be included only in source files.
+
+#pragma once
+
+/** @file
+ *
+ * Reduction loop routines for CPUs.
+ *
+ * See `reduction_helpers.hpp` for the reduction operators.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/loops/cpu_loops.hpp"
+#include "h2/loops/cpu_vec_helpers.hpp"
+#include "h2/loops/reduction_helpers.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace h2
+{
+namespace cpu
+{
+
+namespace internal
+{
+
+/**
+ * Reduce the contiguous elements [start, end) of `in`.
+ *
+ * This keeps one partial result per vector lane, so the lanes reduce
+ * independently and may be vectorized.
+ */
+template <typename OpT, typename T>
+typename OpT::ValueT reduction_loop_range(OpT const& op,
+                                          std::size_t start,
+                                          std::size_t end,
+                                          T const* in)
+{
+  using ValueT = typename OpT::ValueT;
+  constexpr std::size_t lanes = vector_lanes_v<T>;
+
+  ValueT partials[lanes];
+  for (std::size_t l = 0; l < lanes; ++l)
+  {
+    partials[l] = op.identity();
+  }
+  std::size_t i = start;
+  for (; i + lanes <= end; i += lanes)
+  {
+    H2_CPU_SIMD_LOOP
+    for (std::size_t l = 0; l < lanes; ++l)
+    {
+      partials[l] = op.combine(
+        partials[l], op.init(in[i + l], static_cast<DataIndexType>(i + l)));
+    }
+  }
+  ValueT result = op.identity();
+  for (; i < end; ++i)
+  {
+    result = op.combine(result, op.init(in[i], static_cast<DataIndexType>(i)));
+  }
+  for (std::size_t l = 0; l < lanes; ++l)
+  {
+    result = op.combine(result, partials[l]);
+  }
+  return result;
+}
+
+/** Reduce the elements of `in` in the iteration space `inner`. */
+template <typename OpT, typename T>
+typename OpT::ValueT strided_reduction_range(OpT const& op,
+                                             StridedLoopLayout<1> const& inner,
+                                             T const* in)
+{
+  if (inner.is_contiguous())
+  {
+    return reduction_loop_range(
+      op, 0, static_cast<std::size_t>(inner.numel()), in);
+  }
+  typename OpT::ValueT result = op.identity();
+  DataIndexType const inner_size = inner.shape[0];
+  DataIndexType const stride = inner.strides[0][0];
+  DataIndexType const outer_size = inner.numel() / inner_size;
+  for (DataIndexType outer = 0; outer < outer_size; ++outer)
+  {
+    DataIndexType offsets[1];
+    inner.get_offsets(outer * inner_size, offsets);
+    for (DataIndexType i = 0; i < inner_size; ++i)
+    {
+      result = op.combine(
+        result, op.init(in[offsets[0] + i * stride], outer * inner_size + i));
+    }
+  }
+  return result;
+}
+
+}  // namespace internal
+
+/**
+ * Reduce the `size` contiguous elements of `in` with the reduction
+ * operator `op`, storing the result to `*out`.
+ *
+ * Large reductions are split among H2's CPU threads, as in
+ * `parallel_elementwise_loop`.
+ */
+template <typename OpT, typename T>
+void reduction_loop(OpT const& op,
+                    std::size_t size,
+                    typename OpT::ValueT* out,
+                    T const* in)
+{
+  using ValueT = typename OpT::ValueT;
+  std::size_t const num_blocks =
+    std::min(get_num_threads(), size / get_parallel_loop_grain_size());
+  if (num_blocks > 1)
+  {
+    std::size_t const block_size = (size + num_blocks - 1) / num_blocks;
+    std::vector<ValueT> partials(num_blocks);
+    parallel_for(num_blocks, [&](std::size_t block) {
+      std::size_t const start = block * block_size;
+      partials[block] = internal::reduction_loop_range(
+        op, start, std::min(start + block_size, size), in);
+    });
+    ValueT result = op.identity();
+    for (auto const& partial : partials)
+    {
+      result = op.combine(result, partial);
+    }
+    *out = result;
+    return;
+  }
+  *out = internal::reduction_loop_range(op, 0, size, in);
+}
+
+/**
+ * Reduce some dimensions of a strided buffer with the reduction
+ * operator `op`.
+ *
+ * `in` has the given shape and strides. Dimensions where `out_strides`
+ * is 0 are reduced, and each result is stored to `out` with
+ * `out_strides` in the remaining dimensions. Each output is the
+ * identity of `op` if no elements are reduced into it.
+ */
+template <typename OpT, typename T>
+void strided_reduction_loop(OpT const& op,
+                            ShapeTuple const& shape,
+                            StrideTuple const& in_strides,
+                            StrideTuple const& out_strides,
+                            typename OpT::ValueT* out,
+                            T const* in)
+{
+  ReductionLoopLayout const layout =
+    make_reduction_loop_layout(shape, in_strides, out_strides);
+  DataIndexType const num_outputs = layout.num_outputs();
+  if (num_outputs == 0)
+  {
+    return;
+  }
+  if (num_outputs == 1 && layout.inner.is_contiguous())
+  {
+    reduction_loop(
+      op, static_cast<std::size_t>(layout.reduction_size()), out, in);
+    return;
+  }
+
+  auto run_output_range = [&](DataIndexType start, DataIndexType end) {
+    for (DataIndexType i = start; i < end; ++i)
+    {
+      DataIndexType offsets[2];
+      layout.outer.get_offsets(i, offsets);
+      out[offsets[0]] =
+        internal::strided_reduction_range(op, layout.inner, in + offsets[1]);
+    }
+  };
+  std::size_t const num_blocks = std::min(
+    {get_num_threads(),
+     static_cast<std::size_t>(num_outputs * layout.reduction_size())
+       / get_parallel_loop_grain_size(),
+     static_cast<std::size_t>(num_outputs)});
+  if (num_blocks > 1)
+  {
+    DataIndexType const block_size =
+      (num_outputs + static_cast<DataIndexType>(num_blocks) - 1)
+      / static_cast<DataIndexType>(num_blocks);
+    parallel_for(num_blocks, [&](std::size_t block) {
+      DataIndexType const start =
+        static_cast<DataIndexType>(block) * block_size;
+      run_output_range(start, std::min(start + block_size, num_outputs));
+    });
+    return;
+  }
+  run_output_range(0, num_outputs);
+}
+
+/**
+ * Apply `func` to each of the `size` contiguous elements of `in` and
+ * reduce the results with `op`, storing the result to `*out`.
+ *
+ * This is a `reduction_loop` with a `TransformReduction`, so no
+ * temporary buffer of transformed values is needed.
+ */
+template <typename FuncT, typename OpT, typename T>
+void transform_reduction_loop(FuncT const& func,
+                              OpT const& op,
+                              std::size_t size,
+                              typename OpT::ValueT* out,
+                              T const* in)
+{
+  reduction_loop(TransformReduction<FuncT, OpT>{func, op}, size, out, in);
+}
+
+/**
+ * Like `strided_reduction_loop`, but apply `func` to each element
+ * before it is reduced.
+ */
+template <typename FuncT, typename OpT, typename T>
+void strided_transform_reduction_loop(FuncT const& func,
+                                      OpT const& op,
+                                      ShapeTuple const& shape,
+                                      StrideTuple const& in_strides,
+                                      StrideTuple const& out_strides,
+                                      typename OpT::ValueT* out,
+                                      T const* in)
+{
+  strided_reduction_loop(TransformReduction<FuncT, OpT>{func, op},
+                         shape,
+                         in_strides,
+                         out_strides,
+                         out,
+                         in);
+}
+
+}  // namespace cpu
+}  // namespace h2
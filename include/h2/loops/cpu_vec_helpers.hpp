@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+// This file is meant to be included only in source files.
+
+#pragma once
+
+/** @file
+ *
+ * Helper utilities for CPU vectorization.
+ */
+
+#include <h2_config.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Annotate the following loop as safe to vectorize.
+ *
+ * This asserts that iterations of the loop have no dependencies on
+ * each other.
+ */
+#if H2_HAS_OPENMP
+#define H2_CPU_SIMD_LOOP _Pragma("omp simd")
+#elif defined(__clang__)
+#define H2_CPU_SIMD_LOOP _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define H2_CPU_SIMD_LOOP _Pragma("GCC ivdep")
+#else
+#define H2_CPU_SIMD_LOOP
+#endif
+
+namespace h2
+{
+namespace cpu
+{
+
+/** Width in bytes of the widest vector registers targeted. */
+#if defined(__AVX512F__)
+inline constexpr std::size_t vector_bytes = 64;
+#elif defined(__AVX__)
+inline constexpr std::size_t vector_bytes = 32;
+#else
+inline constexpr std::size_t vector_bytes = 16;
+#endif
+
+/**
+ * Number of lanes to process at once in a vectorized loop over
+ * buffers of the given types.
+ *
+ * This is determined by the largest type, so every buffer fits in one
+ * vector register per block.
+ */
+template <typename... Ts>
+inline constexpr std::size_t vector_lanes_v =
+  std::max(std::size_t{1},
+           vector_bytes / std::max({sizeof(Ts)..., std::size_t{1}}));
+
+/**
+ * Return the number of elements of ptr before an address aligned to
+ * a full vector of `lanes` elements.
+ */
+template <std::size_t lanes, typename T>
+inline std::size_t elements_to_vector_alignment(T const* ptr)
+{
+  constexpr std::size_t alignment = lanes * sizeof(T);
+  std::uintptr_t const addr = reinterpret_cast<std::uintptr_t>(ptr);
+  std::size_t const misalignment = addr % alignment;
+  if (misalignment == 0 || misalignment % sizeof(T) != 0)
+  {
+    // Already aligned, or can never be aligned.
+    return 0;
+  }
+  return (alignment - misalignment) / sizeof(T);
+}
+
+}  // namespace cpu
+}  // namespace h2
@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Compile-time fusion of element-wise operations.
+ *
+ * Several element-wise functions can be composed into a single
+ * function with `fuse`, which can then be passed to any of the CPU or
+ * GPU element-wise loops, so a chain of operations (e.g., cast, then
+ * scale, then clamp) is done in one pass over memory rather than one
+ * pass per operation:
+ *
+ * ```
+ * auto f = fuse([](float v) { return static_cast<double>(v); },
+ *               [=](double v) { return v * scale; },
+ *               [](double v) { return v < 0.0 ? 0.0 : v; });
+ * cpu::vectorized_elementwise_loop(f, size, out, in);
+ * ```
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/gpu/macros.hpp"
+#include "h2/meta/TypeList.hpp"
+#include "h2/utils/function_traits.hpp"
+
+#include <type_traits>
+#include <utility>
+
+namespace h2
+{
+
+/**
+ * A function computing `second(first(args...))`.
+ *
+ * The arguments are those of `FirstT`, which are given in `ArgsList`
+ * so that `operator()` has a concrete signature and this works with
+ * `FunctionTraits` (and hence the element-wise loops).
+ *
+ * Use `fuse` rather than constructing this directly.
+ */
+template <typename ArgsList, typename FirstT, typename SecondT>
+struct FusedFunction;
+
+template <typename... Args, typename FirstT, typename SecondT>
+struct FusedFunction<meta::TypeList<Args...>, FirstT, SecondT>
+{
+  using FirstTraits = FunctionTraits<FirstT>;
+  using SecondTraits = FunctionTraits<SecondT>;
+
+  static_assert(FirstTraits::has_return,
+                "Only the last function in a fused chain may return void");
+  static_assert(SecondTraits::arity == 1,
+                "Functions after the first in a fused chain must take "
+                "exactly one argument");
+  static_assert(std::is_convertible_v<typename FirstTraits::RetT,
+                                      typename SecondTraits::template arg<0>>,
+                "Result of a fused function is not convertible to the "
+                "argument of the next");
+
+  using RetT = typename SecondTraits::RetT;
+
+  FirstT first;
+  SecondT second;
+
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE RetT operator()(Args... args) const
+  {
+    return second(first(args...));
+  }
+};
+
+/** Return `f` unchanged; a chain of one function is already fused. */
+template <typename FuncT>
+H2_GPU_HOST_DEVICE auto fuse(FuncT f)
+{
+  return f;
+}
+
+/**
+ * Fuse a chain of element-wise functions into a single function.
+ *
+ * The result takes the arguments of the first function and applies
+ * each subsequent function to the result of the previous one,
+ * returning the result of the last. Every function but the first must
+ * be unary and every function but the last must return a value.
+ *
+ * The functions must have a non-overloaded, non-templated
+ * `operator()` (i.e., no generic lambdas) and are stored by value.
+ */
+template <typename FirstT, typename SecondT, typename... RestTs>
+H2_GPU_HOST_DEVICE auto fuse(FirstT first, SecondT second, RestTs... rest)
+{
+  using FusedT = FusedFunction<typename FunctionTraits<FirstT>::ArgsList,
+                               FirstT,
+                               SecondT>;
+  return fuse(FusedT{std::move(first), std::move(second)}, std::move(rest)...);
+}
+
+}  // namespace h2
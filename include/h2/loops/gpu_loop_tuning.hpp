@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Autotuning of launch configurations for GPU element-wise loops.
+ *
+ * By default, GPU element-wise loops use a fixed block size and
+ * unroll factor and the widest vector width the buffers allow. When
+ * autotuning is on, the first launch of a loop (identified by its
+ * function and argument types) over a given size bucket instead
+ * benchmarks a small set of candidate configurations and caches the
+ * fastest, which subsequent launches in the same bucket reuse.
+ *
+ * Autotuning is enabled for all loops by the `H2_GPU_LOOP_AUTOTUNE`
+ * environment variable, or for individual call sites by using the
+ * `launch_autotuned_*` loops. If `H2_GPU_LOOP_AUTOTUNE_CACHE` names a
+ * file, tuned configurations are additionally loaded from and saved
+ * to it, so they persist across runs. Entries are keyed by GPU name
+ * and the (implementation-specific) mangled loop type, so a cache is
+ * only reused by the same build.
+ */
+
+#include <h2_config.hpp>
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace h2
+{
+namespace gpu
+{
+
+/** Launch configuration for a vectorized GPU element-wise loop. */
+struct ElementwiseLaunchConfig
+{
+  /** Threads per block. */
+  unsigned int block_size;
+  /** Maximum vector width (buffer alignment may reduce it further). */
+  unsigned int vec_width;
+  /** Number of vectors each thread handles per loop iteration. */
+  unsigned int unroll;
+  /**
+   * Maximum number of blocks to launch, from the number that may be
+   * resident on the GPU at once; the loops are grid-strided, so more
+   * are not useful.
+   */
+  unsigned int max_blocks;
+};
+
+inline bool operator==(ElementwiseLaunchConfig const& a,
+                       ElementwiseLaunchConfig const& b)
+{
+  return a.block_size == b.block_size && a.vec_width == b.vec_width
+         && a.unroll == b.unroll && a.max_blocks == b.max_blocks;
+}
+
+inline bool operator!=(ElementwiseLaunchConfig const& a,
+                       ElementwiseLaunchConfig const& b)
+{
+  return !(a == b);
+}
+
+/**
+ * Return whether all GPU element-wise loops are autotuned.
+ *
+ * This is set by the `H2_GPU_LOOP_AUTOTUNE` environment variable and
+ * read once.
+ */
+bool elementwise_autotune_enabled();
+
+/**
+ * Return the key under which the tuned configuration of a loop is
+ * cached.
+ *
+ * `loop_type` identifies the loop (e.g., by its function and argument
+ * types) and `size` is bucketed by powers of two. The key also
+ * includes the current GPU.
+ */
+std::string get_elementwise_tuning_key(std::type_info const& loop_type,
+                                       std::size_t size);
+
+/**
+ * Return the tuned configuration for `key`, if there is one.
+ *
+ * The first call loads the on-disk cache, if any.
+ */
+std::optional<ElementwiseLaunchConfig>
+get_tuned_elementwise_config(std::string const& key);
+
+/**
+ * Cache the tuned configuration for `key`, replacing any existing one.
+ *
+ * This is also appended to the on-disk cache, if any.
+ */
+void set_tuned_elementwise_config(std::string const& key,
+                                  ElementwiseLaunchConfig const& config);
+
+/**
+ * Clear the in-process cache of tuned configurations.
+ *
+ * This does not modify the on-disk cache, and it is not reloaded.
+ */
+void clear_tuned_elementwise_configs();
+
+/**
+ * Return the configurations an autotuned loop tries, given the widest
+ * vector width its buffers allow.
+ *
+ * `max_blocks` is left 0, as it depends on the kernel.
+ */
+std::vector<ElementwiseLaunchConfig>
+get_elementwise_tuning_candidates(std::size_t max_vec_width);
+
+}  // namespace gpu
+}  // namespace h2
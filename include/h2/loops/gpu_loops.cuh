@@ -20,15 +20,30 @@
 
 #include <h2_config.hpp>
 
+#include "h2/core/allocator.hpp"
+#include "h2/core/profiling.hpp"
 #include "h2/core/sync.hpp"
+#include "h2/core/tracer.hpp"
 #include "h2/gpu/macros.hpp"
+#include "h2/gpu/memory_utils.hpp"
 #include "h2/gpu/runtime.hpp"
+#include "h2/loops/gpu_loop_tuning.hpp"
 #include "h2/loops/gpu_vec_helpers.cuh"
+#include "h2/loops/strided_loop_helpers.hpp"
 #include "h2/utils/const_for.hpp"
 #include "h2/utils/function_traits.hpp"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <tuple>
 #include <type_traits>
+#include <typeinfo>
+#include <vector>
 
 namespace h2
 {
@@ -357,14 +372,314 @@ H2_GPU_GLOBAL void elementwise_loop_with_immediate(FuncT f,
   }
 }
 
+/**
+ * Strided n-ary element-wise loop.
+ *
+ * See `elementwise_loop` for basic details. Each buffer is accessed
+ * with its own strides, as given by `layout`, which has `NDim`
+ * dimensions (or a runtime number if 0).
+ */
+template <int NDim, typename SizeT, typename FuncT, typename... Args>
+H2_GPU_GLOBAL void
+strided_elementwise_loop(FuncT const func,
+                         StridedLoopLayout<sizeof...(Args)> const layout,
+                         SizeT size,
+                         Args... args)
+{
+  SizeT const tid = blockIdx.x * blockDim.x + threadIdx.x;
+  SizeT const stride = blockDim.x * gridDim.x;
+
+  for (SizeT i = tid; i < size; i += stride)
+  {
+    DataIndexType offsets[sizeof...(Args)];
+    get_loop_offsets<NDim>(layout, static_cast<DataIndexType>(i), offsets);
+    ::h2::internal::apply_at_offsets(func, offsets, args...);
+  }
+}
+
+/** A contiguous range of one item of a batched element-wise loop. */
+struct BatchedElementwiseTile
+{
+  /** Index of the work item. */
+  unsigned int item;
+  /** Range of elements of the item, [begin, end). */
+  unsigned int begin;
+  unsigned int end;
+};
+
+/**
+ * Batched n-ary element-wise loop.
+ *
+ * See `elementwise_loop` for basic details. Each block processes tiles
+ * from the work list `tiles`, applying func to the buffers of the
+ * tile's item; `item_args` are one array per argument, giving the
+ * buffer of each item.
+ */
+template <typename FuncT, typename... Args>
+H2_GPU_GLOBAL void batched_elementwise_loop(FuncT const func,
+                                            unsigned int num_tiles,
+                                            BatchedElementwiseTile const* tiles,
+                                            Args const*... item_args)
+{
+  for (unsigned int t = blockIdx.x; t < num_tiles; t += gridDim.x)
+  {
+    BatchedElementwiseTile const tile = tiles[t];
+    for (unsigned int i = tile.begin + threadIdx.x; i < tile.end;
+         i += blockDim.x)
+    {
+      DataIndexType const offsets[sizeof...(Args)] = {
+        ((void) item_args, static_cast<DataIndexType>(i))...};
+      ::h2::internal::apply_at_offsets(
+        func, offsets, item_args[tile.item]...);
+    }
+  }
+}
+
 }  // namespace kernels
 
+namespace internal
+{
+
+/** Identifies a loop for autotuning. */
+template <bool with_immediate, typename FuncT, typename... Args>
+struct ElementwiseTuningTag
+{};
+
+/**
+ * Call `f(vec, unroll)` with the given vector width and unroll factor
+ * as `std::integral_constant`s.
+ */
+template <typename FuncT>
+void dispatch_vec_width_and_unroll(std::size_t vec_width,
+                                   unsigned int unroll,
+                                   FuncT&& f)
+{
+  auto const with_unroll = [&](auto vec) {
+    switch (unroll)
+    {
+    case 1: f(vec, std::integral_constant<std::size_t, 1>{}); break;
+    case 2: f(vec, std::integral_constant<std::size_t, 2>{}); break;
+    case 4: f(vec, std::integral_constant<std::size_t, 4>{}); break;
+    default: throw H2FatalException("Unexpected unroll factor, ", unroll);
+    }
+  };
+  switch (vec_width)
+  {
+  case 4: with_unroll(std::integral_constant<std::size_t, 4>{}); break;
+  case 2: with_unroll(std::integral_constant<std::size_t, 2>{}); break;
+  case 1: with_unroll(std::integral_constant<std::size_t, 1>{}); break;
+  default:
+    throw H2FatalException("Unexpected vectorization size, ", vec_width);
+  }
+}
+
+/**
+ * Return the number of blocks to launch for a loop over `size`
+ * elements, with at most one full iteration per thread.
+ */
+inline unsigned int get_tuned_num_blocks(ElementwiseLaunchConfig const& config,
+                                         std::size_t vec_width,
+                                         std::size_t size)
+{
+  std::size_t const ele_per_block =
+    std::size_t{config.block_size} * vec_width * config.unroll;
+  std::size_t const num_blocks = (size + ele_per_block - 1) / ele_per_block;
+  return static_cast<unsigned int>(std::clamp<std::size_t>(
+    num_blocks, 1, std::max(config.max_blocks, 1u)));
+}
+
+/**
+ * Launch an element-wise loop with an autotuned configuration,
+ * tuning it first if needed.
+ *
+ * `launch(config, out)` must run the loop with `config` and output
+ * buffer `out`, and `get_max_blocks(config)` must return the number
+ * of blocks of the corresponding kernel that may be resident at once.
+ *
+ * Candidates are benchmarked writing to a scratch output, so user
+ * data is unchanged even if the loop runs in-place. This synchronizes
+ * the stream.
+ */
+template <typename TagT, typename OutT, typename LaunchT, typename MaxBlocksT>
+void launch_autotuned_elementwise_kernel(ComputeStream const& stream,
+                                         std::size_t size,
+                                         std::size_t vec_width,
+                                         OutT* out,
+                                         LaunchT&& launch,
+                                         MaxBlocksT&& get_max_blocks)
+{
+  std::string const key = get_elementwise_tuning_key(typeid(TagT), size);
+  if (auto config = get_tuned_elementwise_config(key))
+  {
+    launch(*config, out);
+    return;
+  }
+
+  constexpr int num_reps = 5;
+  using ScratchAllocator =
+    ::h2::internal::Allocator<std::remove_const_t<OutT>, Device::GPU>;
+  OutT* scratch = ScratchAllocator::allocate(size, stream);
+  DeviceStream const dev_stream = stream.template get_stream<Device::GPU>();
+  DeviceEvent const start = make_event();
+  DeviceEvent const end = make_event();
+
+  std::optional<ElementwiseLaunchConfig> best;
+  float best_time = std::numeric_limits<float>::max();
+  for (auto config : get_elementwise_tuning_candidates(vec_width))
+  {
+    config.max_blocks = get_max_blocks(config);
+    if (config.max_blocks == 0)
+    {
+      continue;  // E.g., too many registers for this block size.
+    }
+    launch(config, scratch);  // Warm up.
+    record_event(start, dev_stream);
+    for (int rep = 0; rep < num_reps; ++rep)
+    {
+      launch(config, scratch);
+    }
+    record_event(end, dev_stream);
+    sync(end);
+    float const time = elapsed_time(start, end);
+    if (time < best_time)
+    {
+      best = config;
+      best_time = time;
+    }
+  }
+
+  destroy(start);
+  destroy(end);
+  ScratchAllocator::deallocate(scratch, stream);
+  H2_ASSERT_ALWAYS(best.has_value(),
+                   "No candidate launch configuration is usable for ",
+                   key);
+  set_tuned_elementwise_config(key, *best);
+  launch(*best, out);
+}
+
+template <typename FuncT, typename OutT, typename... Args>
+void launch_tuned_elementwise_loop(FuncT const& func,
+                                   ComputeStream const& stream,
+                                   std::size_t size,
+                                   std::size_t vec_width,
+                                   OutT* out,
+                                   Args... args)
+{
+  auto const for_config = [&](ElementwiseLaunchConfig const& config,
+                              auto&& f) {
+    dispatch_vec_width_and_unroll(
+      std::min<std::size_t>(vec_width, config.vec_width),
+      config.unroll,
+      [&](auto vec, auto unroll) {
+        f(vec,
+          kernels::vectorized_elementwise_loop<unsigned int,
+                                               decltype(vec)::value,
+                                               decltype(unroll)::value,
+                                               FuncT,
+                                               OutT*,
+                                               Args...>);
+      });
+  };
+  launch_autotuned_elementwise_kernel<
+    ElementwiseTuningTag<false, FuncT, OutT*, Args...>>(
+    stream,
+    size,
+    vec_width,
+    out,
+    [&](ElementwiseLaunchConfig const& config, OutT* out_buf) {
+      for_config(config, [&](auto vec, auto kernel) {
+        gpu::launch_kernel(kernel,
+                           get_tuned_num_blocks(config, vec, size),
+                           config.block_size,
+                           0,
+                           stream.template get_stream<Device::GPU>(),
+                           func,
+                           static_cast<unsigned int>(size),
+                           out_buf,
+                           args...);
+      });
+    },
+    [&](ElementwiseLaunchConfig const& config) {
+      unsigned int max_blocks = 0;
+      for_config(config, [&](auto, auto kernel) {
+        max_blocks = max_resident_blocks(kernel, config.block_size);
+      });
+      return max_blocks;
+    });
+}
+
+template <typename FuncT, typename ImmediateT, typename OutT, typename... Args>
+void launch_tuned_elementwise_loop_with_immediate(FuncT const& func,
+                                                  ComputeStream const& stream,
+                                                  std::size_t size,
+                                                  std::size_t vec_width,
+                                                  ImmediateT imm,
+                                                  OutT* out,
+                                                  Args... args)
+{
+  auto const for_config = [&](ElementwiseLaunchConfig const& config,
+                              auto&& f) {
+    dispatch_vec_width_and_unroll(
+      std::min<std::size_t>(vec_width, config.vec_width),
+      config.unroll,
+      [&](auto vec, auto unroll) {
+        f(vec,
+          kernels::vectorized_elementwise_loop_with_immediate<
+            unsigned int,
+            decltype(vec)::value,
+            decltype(unroll)::value,
+            FuncT,
+            ImmediateT,
+            OutT*,
+            Args...>);
+      });
+  };
+  launch_autotuned_elementwise_kernel<
+    ElementwiseTuningTag<true, FuncT, ImmediateT, OutT*, Args...>>(
+    stream,
+    size,
+    vec_width,
+    out,
+    [&](ElementwiseLaunchConfig const& config, OutT* out_buf) {
+      for_config(config, [&](auto vec, auto kernel) {
+        gpu::launch_kernel(kernel,
+                           get_tuned_num_blocks(config, vec, size),
+                           config.block_size,
+                           0,
+                           stream.template get_stream<Device::GPU>(),
+                           func,
+                           static_cast<unsigned int>(size),
+                           imm,
+                           out_buf,
+                           args...);
+      });
+    },
+    [&](ElementwiseLaunchConfig const& config) {
+      unsigned int max_blocks = 0;
+      for_config(config, [&](auto, auto kernel) {
+        max_blocks = max_resident_blocks(kernel, config.block_size);
+      });
+      return max_blocks;
+    });
+}
+
+/** Return the bytes of the buffers `Args` a loop of `size` touches. */
+template <typename... Args>
+constexpr std::size_t elementwise_loop_bytes(std::size_t size)
+{
+  return size * (std::size_t{0} + ... + sizeof(std::remove_pointer_t<Args>));
+}
+
+}  // namespace internal
+
 template <typename FuncT, typename... Args>
 void launch_elementwise_loop(FuncT const& func,
                              ComputeStream const& stream,
                              std::size_t size,
                              Args... args)
 {
+  H2_PROFILE_RANGE("h2::launch_elementwise_loop", Compute);
   unsigned int const block_size = gpu::num_threads_per_block;
   unsigned int const num_blocks = (size + block_size - 1) / block_size;
 
@@ -373,6 +688,10 @@ void launch_elementwise_loop(FuncT const& func,
   {
     return;
   }
+  H2_TRACE_SCOPE("h2::launch_elementwise_loop",
+                 Compute,
+                 stream,
+                 internal::elementwise_loop_bytes<Args...>(size));
 
 #define DO_LAUNCH(st, vec)                                                     \
   gpu::launch_kernel(                                                          \
@@ -392,6 +711,18 @@ void launch_elementwise_loop(FuncT const& func,
   const std::size_t vec_width = std::min({max_vectorization_amount(args)...});
   bool const needs_size_t = size > std::numeric_limits<unsigned int>::max();
 
+  // Autotuning needs an output to benchmark into and only covers the
+  // common case of 32-bit sizes.
+  if constexpr (FunctionTraits<FuncT>::has_return)
+  {
+    if (!needs_size_t && elementwise_autotune_enabled())
+    {
+      internal::launch_tuned_elementwise_loop(
+        func, stream, size, vec_width, args...);
+      return;
+    }
+  }
+
   if (needs_size_t)
   {
     switch (vec_width)
@@ -425,6 +756,7 @@ void launch_elementwise_loop_with_immediate(FuncT const& func,
                                             ImmediateT imm,
                                             Args... args)
 {
+  H2_PROFILE_RANGE("h2::launch_elementwise_loop", Compute);
   unsigned int const block_size = gpu::num_threads_per_block;
   unsigned int const num_blocks = (size + block_size - 1) / block_size;
 
@@ -433,6 +765,10 @@ void launch_elementwise_loop_with_immediate(FuncT const& func,
   {
     return;
   }
+  H2_TRACE_SCOPE("h2::launch_elementwise_loop",
+                 Compute,
+                 stream,
+                 internal::elementwise_loop_bytes<Args...>(size));
 
 #define DO_LAUNCH(st, vec)                                                     \
   gpu::launch_kernel(                                                          \
@@ -454,6 +790,18 @@ void launch_elementwise_loop_with_immediate(FuncT const& func,
   const std::size_t vec_width = std::min({max_vectorization_amount(args)...});
   bool const needs_size_t = size > std::numeric_limits<unsigned int>::max();
 
+  // Autotuning needs an output to benchmark into and only covers the
+  // common case of 32-bit sizes.
+  if constexpr (FunctionTraits<FuncT>::has_return)
+  {
+    if (!needs_size_t && elementwise_autotune_enabled())
+    {
+      internal::launch_tuned_elementwise_loop_with_immediate(
+        func, stream, size, vec_width, imm, args...);
+      return;
+    }
+  }
+
   if (needs_size_t)
   {
     switch (vec_width)
@@ -480,5 +828,349 @@ void launch_elementwise_loop_with_immediate(FuncT const& func,
 #undef DO_LAUNCH
 }
 
+/**
+ * Like `launch_elementwise_loop`, but always autotune the launch
+ * configuration, regardless of `H2_GPU_LOOP_AUTOTUNE`.
+ *
+ * See `gpu_loop_tuning.hpp` for details. Loops without an output and
+ * loops over more than 2^32 - 1 elements are not tuned.
+ */
+template <typename FuncT, typename... Args>
+void launch_autotuned_elementwise_loop(FuncT const& func,
+                                       ComputeStream const& stream,
+                                       std::size_t size,
+                                       Args... args)
+{
+  if constexpr (FunctionTraits<FuncT>::has_return)
+  {
+    if (size > 0 && size <= std::numeric_limits<unsigned int>::max())
+    {
+      internal::launch_tuned_elementwise_loop(
+        func,
+        stream,
+        size,
+        std::min({max_vectorization_amount(args)...}),
+        args...);
+      return;
+    }
+  }
+  launch_elementwise_loop(func, stream, size, args...);
+}
+
+/**
+ * Like `launch_elementwise_loop_with_immediate`, but always autotune
+ * the launch configuration, regardless of `H2_GPU_LOOP_AUTOTUNE`.
+ */
+template <typename FuncT, typename ImmediateT, typename... Args>
+void launch_autotuned_elementwise_loop_with_immediate(
+  FuncT const& func,
+  ComputeStream const& stream,
+  std::size_t size,
+  ImmediateT imm,
+  Args... args)
+{
+  if constexpr (FunctionTraits<FuncT>::has_return)
+  {
+    if (size > 0 && size <= std::numeric_limits<unsigned int>::max())
+    {
+      internal::launch_tuned_elementwise_loop_with_immediate(
+        func,
+        stream,
+        size,
+        std::min({max_vectorization_amount(args)...}),
+        imm,
+        args...);
+      return;
+    }
+  }
+  launch_elementwise_loop_with_immediate(func, stream, size, imm, args...);
+}
+
+/**
+ * Launch a strided n-ary element-wise loop.
+ *
+ * This is like `launch_elementwise_loop`, but each buffer in args is
+ * accessed with its own strides (in order, in `strides`) over an
+ * iteration space of the given shape. A stride of 0 broadcasts an
+ * input buffer along that dimension; the output buffer, if any, must
+ * not have 0 strides for dimensions of extent greater than 1.
+ *
+ * Contiguous dimensions are collapsed first, and if all buffers turn
+ * out to be contiguous, this launches the vectorized contiguous loop.
+ */
+template <typename FuncT, typename... Args>
+void launch_strided_elementwise_loop(
+  FuncT const& func,
+  ComputeStream const& stream,
+  ShapeTuple const& shape,
+  std::array<StrideTuple, sizeof...(Args)> const& strides,
+  Args... args)
+{
+  static_assert(sizeof...(Args) > 0, "Strided loops need at least one buffer");
+  H2_PROFILE_RANGE("h2::launch_strided_elementwise_loop", Compute);
+  StridedLoopLayout<sizeof...(Args)> const layout =
+    make_strided_loop_layout(shape, strides);
+  std::size_t const size = static_cast<std::size_t>(layout.numel());
+
+  // Check if there is no work.
+  if (size == 0)
+  {
+    return;
+  }
+  if (layout.is_contiguous())
+  {
+    launch_elementwise_loop(func, stream, size, args...);
+    return;
+  }
+  H2_TRACE_SCOPE("h2::launch_strided_elementwise_loop",
+                 Compute,
+                 stream,
+                 internal::elementwise_loop_bytes<Args...>(size));
+
+  unsigned int const block_size = gpu::num_threads_per_block;
+  unsigned int const num_blocks = (size + block_size - 1) / block_size;
+
+  // Specializing for the number of dimensions lets the compiler fold
+  // the index math.
+  dispatch_loop_rank(layout.ndim, [&](auto ndim) {
+#define DO_LAUNCH(st)                                                          \
+  gpu::launch_kernel(                                                          \
+    kernels::strided_elementwise_loop<ndim.value, st, FuncT, Args...>,         \
+    num_blocks,                                                                \
+    block_size,                                                                \
+    0,                                                                         \
+    stream.template get_stream<Device::GPU>(),                                 \
+    func,                                                                      \
+    layout,                                                                    \
+    static_cast<st>(size),                                                     \
+    args...)
+
+    if (size > std::numeric_limits<unsigned int>::max())
+    {
+      DO_LAUNCH(std::size_t);
+    }
+    else
+    {
+      DO_LAUNCH(unsigned int);
+    }
+
+#undef DO_LAUNCH
+  });
+}
+
+/** One work item of a batched element-wise loop. */
+template <typename... Args>
+struct ElementwiseWorkItem
+{
+  /** Number of elements in each buffer. */
+  std::size_t size;
+  /** Buffers, as for `launch_elementwise_loop`. */
+  std::tuple<Args...> args;
+};
+
+/** Construct an element-wise work item over `size` elements of `args`. */
+template <typename... Args>
+ElementwiseWorkItem<Args...> make_elementwise_work_item(std::size_t size,
+                                                        Args... args)
+{
+  return {size, std::tuple<Args...>{args...}};
+}
+
+/**
+ * A device-side list of element-wise work items, which may be launched
+ * repeatedly with `launch_batched_elementwise_loop`.
+ *
+ * Items are split into tiles of up to `gpu::work_per_block` elements,
+ * so each tile is about a block's worth of work however the sizes of
+ * items vary. The list is uploaded once at construction, so reusing it
+ * (e.g., for the same parameters every training step) avoids host to
+ * device copies, and launching it may be captured by a `ComputeGraph`.
+ *
+ * Each item must have fewer than 2^32 elements. The list is released on
+ * the stream it was constructed with, so it must outlive any launches
+ * on other streams.
+ */
+template <typename... Args>
+class ElementwiseWorkList
+{
+public:
+  ElementwiseWorkList(std::vector<ElementwiseWorkItem<Args...>> const& items,
+                      ComputeStream const& stream_)
+    : stream(stream_), num_items(items.size())
+  {
+    std::vector<kernels::BatchedElementwiseTile> tiles;
+    for (std::size_t item = 0; item < num_items; ++item)
+    {
+      H2_ASSERT_ALWAYS(items[item].size
+                         <= std::numeric_limits<unsigned int>::max(),
+                       "Batched element-wise work item ",
+                       item,
+                       " is too large (",
+                       items[item].size,
+                       " elements)");
+      unsigned int const size = static_cast<unsigned int>(items[item].size);
+      for (unsigned int begin = 0; begin < size; begin += work_per_block)
+      {
+        tiles.push_back({static_cast<unsigned int>(item),
+                         begin,
+                         begin + std::min(size - begin, work_per_block)});
+      }
+    }
+    num_tiles = static_cast<unsigned int>(tiles.size());
+    if (num_tiles == 0)
+    {
+      return;
+    }
+
+    // Pack the buffers for each argument, then the tiles, into a single
+    // allocation and upload it.
+    tiles_offset = (sizeof(Args) + ... + 0) * num_items;
+    tiles_offset = (tiles_offset + alignof(kernels::BatchedElementwiseTile) - 1)
+                   / alignof(kernels::BatchedElementwiseTile)
+                   * alignof(kernels::BatchedElementwiseTile);
+    std::size_t const num_bytes =
+      tiles_offset + tiles.size() * sizeof(kernels::BatchedElementwiseTile);
+    std::vector<unsigned char> host_buf(num_bytes);
+    std::size_t offset = 0;
+    const_for<std::size_t{0}, sizeof...(Args), std::size_t{1}>([&](auto i) {
+      for (std::size_t item = 0; item < num_items; ++item)
+      {
+        auto const arg = std::get<i.value>(items[item].args);
+        std::memcpy(host_buf.data() + offset, &arg, sizeof(arg));
+        offset += sizeof(arg);
+      }
+    });
+    std::memcpy(host_buf.data() + tiles_offset,
+                tiles.data(),
+                tiles.size() * sizeof(kernels::BatchedElementwiseTile));
+    buf = ::h2::internal::Allocator<unsigned char, Device::GPU>::allocate(
+      num_bytes, stream);
+    mem_copy(buf,
+             host_buf.data(),
+             num_bytes,
+             stream.template get_stream<Device::GPU>());
+    // Wait so the list is ready for use on any stream.
+    stream.wait_for_this();
+  }
+
+  ~ElementwiseWorkList()
+  {
+    if (buf)
+    {
+      H2_TERMINATE_ON_THROW_DEBUG(
+        (::h2::internal::Allocator<unsigned char, Device::GPU>::deallocate(
+          buf, stream)));
+    }
+  }
+
+  ElementwiseWorkList(ElementwiseWorkList const&) = delete;
+  ElementwiseWorkList& operator=(ElementwiseWorkList const&) = delete;
+
+  /** Return the number of work items. */
+  std::size_t get_num_items() const H2_NOEXCEPT { return num_items; }
+
+  /** Return the number of tiles the items were split into. */
+  unsigned int get_num_tiles() const H2_NOEXCEPT { return num_tiles; }
+
+  /** Return the device-side tiles. */
+  kernels::BatchedElementwiseTile const* get_tiles() const H2_NOEXCEPT
+  {
+    return reinterpret_cast<kernels::BatchedElementwiseTile const*>(
+      buf + tiles_offset);
+  }
+
+  /** Return the device-side array of buffers for argument `i`. */
+  template <std::size_t i>
+  auto get_item_args() const H2_NOEXCEPT
+  {
+    using ArgT = std::tuple_element_t<i, std::tuple<Args...>>;
+    std::size_t offset = 0;
+    const_for<std::size_t{0}, i, std::size_t{1}>([&](auto j) {
+      offset += sizeof(std::tuple_element_t<j.value, std::tuple<Args...>>);
+    });
+    return reinterpret_cast<ArgT const*>(buf + offset * num_items);
+  }
+
+private:
+  ComputeStream stream;
+  std::size_t num_items;
+  unsigned int num_tiles = 0;
+  /** Offset of the tiles in `buf`, after the buffers of each argument. */
+  std::size_t tiles_offset = 0;
+  unsigned char* buf = nullptr;
+};
+
+namespace internal
+{
+
+template <typename FuncT, typename... Args, std::size_t... Is>
+void launch_batched_elementwise_loop_impl(
+  FuncT const& func,
+  ComputeStream const& stream,
+  ElementwiseWorkList<Args...> const& work_list,
+  std::index_sequence<Is...>)
+{
+  auto kernel = kernels::batched_elementwise_loop<FuncT, Args...>;
+  unsigned int const block_size = num_threads_per_block;
+  // Launch at most as many blocks as can be resident at once; each
+  // block then loops over the tiles.
+  launch_occupancy_kernel(kernel,
+                          work_list.get_num_tiles(),
+                          block_size,
+                          0,
+                          stream.template get_stream<Device::GPU>(),
+                          func,
+                          work_list.get_num_tiles(),
+                          work_list.get_tiles(),
+                          work_list.template get_item_args<Is>()...);
+}
+
+}  // namespace internal
+
+/**
+ * Launch an n-ary element-wise loop over every item of `work_list` in
+ * a single kernel.
+ *
+ * This is equivalent to calling `launch_elementwise_loop` on each item,
+ * but avoids launching many mostly idle grids when items are small
+ * (e.g., a few thousand elements or fewer). Items are independent, so
+ * no buffer written by one item may be accessed by another. Large items
+ * are better served by `launch_elementwise_loop`, which vectorizes.
+ */
+template <typename FuncT, typename... Args>
+void launch_batched_elementwise_loop(
+  FuncT const& func,
+  ComputeStream const& stream,
+  ElementwiseWorkList<Args...> const& work_list)
+{
+  static_assert(sizeof...(Args) > 0,
+                "Batched loops need at least one buffer");
+  // Check if there is no work.
+  if (work_list.get_num_tiles() == 0)
+  {
+    return;
+  }
+  internal::launch_batched_elementwise_loop_impl(
+    func, stream, work_list, std::index_sequence_for<Args...>{});
+}
+
+/**
+ * Launch an n-ary element-wise loop over each of `items` in a single
+ * kernel.
+ *
+ * This builds and uploads a temporary `ElementwiseWorkList`, which waits
+ * for `stream`; construct the list once and reuse it when launching the
+ * same items repeatedly.
+ */
+template <typename FuncT, typename... Args>
+void launch_batched_elementwise_loop(
+  FuncT const& func,
+  ComputeStream const& stream,
+  std::vector<ElementwiseWorkItem<Args...>> const& items)
+{
+  ElementwiseWorkList<Args...> const work_list(items, stream);
+  launch_batched_elementwise_loop(func, stream, work_list);
+}
+
 }  // namespace gpu
 }  // namespace h2
@@ -0,0 +1,520 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+// This file is meant to be included only in source files.
+
+#if !defined(__CUDACC__) && !defined(__HIPCC__)
+#error "This file is to only be included in GPU code"
+#endif
+
+#pragma once
+
+/** @file
+ *
+ * Reduction loop routines for GPUs.
+ *
+ * See `reduction_helpers.hpp` for the reduction operators.
+ *
+ * Each block reduces in registers with warp shuffles, then across its
+ * warps through shared memory. Full reductions that need more than one
+ * block write a partial result per block, which a second kernel
+ * reduces.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/core/tracer.hpp"
+#include "h2/gpu/macros.hpp"
+#include "h2/gpu/runtime.hpp"
+#include "h2/loops/gpu_vec_helpers.cuh"
+#include "h2/loops/reduction_helpers.hpp"
+#include "h2/utils/const_for.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace h2
+{
+namespace gpu
+{
+
+namespace internal
+{
+
+/**
+ * Return `val` from the lane `delta` above this one in the warp.
+ *
+ * This works for any trivially copyable type by shuffling it a word at
+ * a time. Every lane in the warp must participate.
+ */
+template <typename T>
+H2_GPU_DEVICE H2_GPU_FORCE_INLINE T shuffle_down(T val, unsigned int delta)
+{
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Shuffled types must be trivially copyable");
+  constexpr std::size_t num_words = (sizeof(T) + sizeof(int) - 1) / sizeof(int);
+  int words[num_words] = {};
+  memcpy(words, &val, sizeof(T));
+#pragma unroll
+  for (std::size_t w = 0; w < num_words; ++w)
+  {
+#if H2_HAS_CUDA
+    words[w] = __shfl_down_sync(0xffffffff, words[w], delta);
+#else
+    words[w] = __shfl_down(words[w], delta);
+#endif
+  }
+  memcpy(&val, words, sizeof(T));
+  return val;
+}
+
+/** Reduce `val` across a warp. The result is valid in lane 0. */
+template <typename OpT>
+H2_GPU_DEVICE H2_GPU_FORCE_INLINE typename OpT::ValueT
+warp_reduce(OpT const& op, typename OpT::ValueT val)
+{
+#pragma unroll
+  for (unsigned int delta = warp_size / 2; delta > 0; delta /= 2)
+  {
+    val = op.combine(val, shuffle_down(val, delta));
+  }
+  return val;
+}
+
+/**
+ * Reduce `val` across a block of `block_size` threads. The result is
+ * valid in thread 0.
+ *
+ * Every thread in the block must participate. This synchronizes the
+ * block, so it may be called repeatedly.
+ */
+template <unsigned int block_size, typename OpT>
+H2_GPU_DEVICE H2_GPU_FORCE_INLINE typename OpT::ValueT
+block_reduce(OpT const& op, typename OpT::ValueT val)
+{
+  using ValueT = typename OpT::ValueT;
+  static_assert(block_size % warp_size == 0,
+                "Block size must be a multiple of the warp size");
+  constexpr unsigned int num_warps = block_size / warp_size;
+  static_assert(num_warps <= warp_size, "Block size is too large");
+
+  alignas(ValueT) __shared__ unsigned char warp_storage[num_warps
+                                                        * sizeof(ValueT)];
+  ValueT* warp_results = reinterpret_cast<ValueT*>(warp_storage);
+  unsigned int const lane = threadIdx.x % warp_size;
+  unsigned int const warp = threadIdx.x / warp_size;
+
+  val = warp_reduce(op, val);
+  if constexpr (num_warps > 1)
+  {
+    if (lane == 0)
+    {
+      warp_results[warp] = val;
+    }
+    __syncthreads();
+    if (warp == 0)
+    {
+      val = warp_reduce(op, (lane < num_warps) ? warp_results[lane]
+                                               : op.identity());
+    }
+    __syncthreads();
+  }
+  return val;
+}
+
+}  // namespace internal
+
+namespace kernels
+{
+
+/**
+ * Reduce `size` contiguous elements, storing one partial result per
+ * block to `out[blockIdx.x]`.
+ *
+ * Elements are loaded `vec_width` at a time, which assumes `in` is
+ * appropriately aligned.
+ */
+template <unsigned int block_size,
+          std::size_t vec_width,
+          typename SizeT,
+          typename OpT,
+          typename T>
+H2_GPU_GLOBAL void __launch_bounds__(block_size)
+  reduction_loop(OpT op, SizeT size, typename OpT::ValueT* out, T const* in)
+{
+  using ValueT = typename OpT::ValueT;
+  using VecT = VectorType_t<T, vec_width>;
+  SizeT const tid = blockIdx.x * block_size + threadIdx.x;
+  SizeT const grid_stride = SizeT{block_size} * gridDim.x;
+  SizeT const num_vecs = size / vec_width;
+
+  ValueT result = op.identity();
+  VecT const* vec_in = reinterpret_cast<VecT const*>(in);
+  for (SizeT v = tid; v < num_vecs; v += grid_stride)
+  {
+    VecT loaded = vec_in[v];
+    const_for<std::size_t{0}, vec_width, std::size_t{1}>([&](auto l) {
+      result = op.combine(
+        result,
+        op.init(index_vector<l, vec_width, T>(loaded),
+                static_cast<DataIndexType>(v * vec_width + l)));
+    });
+  }
+  // Remainder.
+  for (SizeT i = num_vecs * vec_width + tid; i < size; i += grid_stride)
+  {
+    result =
+      op.combine(result, op.init(in[i], static_cast<DataIndexType>(i)));
+  }
+
+  result = internal::block_reduce<block_size>(op, result);
+  if (threadIdx.x == 0)
+  {
+    out[blockIdx.x] = result;
+  }
+}
+
+/** Combine `size` partial results into `*out` with a single block. */
+template <unsigned int block_size, typename OpT>
+H2_GPU_GLOBAL void __launch_bounds__(block_size)
+  combine_partials(OpT op,
+                   unsigned int size,
+                   typename OpT::ValueT* out,
+                   typename OpT::ValueT const* partials)
+{
+  typename OpT::ValueT result = op.identity();
+  for (unsigned int i = threadIdx.x; i < size; i += block_size)
+  {
+    result = op.combine(result, partials[i]);
+  }
+  result = internal::block_reduce<block_size>(op, result);
+  if (threadIdx.x == 0)
+  {
+    *out = result;
+  }
+}
+
+/**
+ * Reduce some dimensions of a strided buffer, with one block per
+ * output.
+ *
+ * This suits outputs that each reduce many elements.
+ */
+template <unsigned int block_size, typename OpT, typename T>
+H2_GPU_GLOBAL void __launch_bounds__(block_size)
+  block_per_output_reduction_loop(OpT op,
+                                  ReductionLoopLayout layout,
+                                  typename OpT::ValueT* out,
+                                  T const* in)
+{
+  using ValueT = typename OpT::ValueT;
+  DataIndexType const num_outputs = layout.outer.numel();
+  DataIndexType const reduction_size = layout.inner.numel();
+  bool const inner_is_1d = layout.inner.ndim == 1;
+
+  for (DataIndexType o = blockIdx.x; o < num_outputs; o += gridDim.x)
+  {
+    DataIndexType outer_offsets[2];
+    layout.outer.get_offsets(o, outer_offsets);
+    T const* in_o = in + outer_offsets[1];
+
+    ValueT result = op.identity();
+    for (DataIndexType i = threadIdx.x; i < reduction_size; i += block_size)
+    {
+      DataIndexType inner_offset[1];
+      if (inner_is_1d)
+      {
+        inner_offset[0] = i * layout.inner.strides[0][0];
+      }
+      else
+      {
+        layout.inner.get_offsets(i, inner_offset);
+      }
+      result = op.combine(result, op.init(in_o[inner_offset[0]], i));
+    }
+    result = internal::block_reduce<block_size>(op, result);
+    if (threadIdx.x == 0)
+    {
+      out[outer_offsets[0]] = result;
+    }
+  }
+}
+
+/**
+ * Reduce some dimensions of a strided buffer, with one thread per
+ * output.
+ *
+ * This suits many outputs that each reduce few elements.
+ */
+template <typename OpT, typename T>
+H2_GPU_GLOBAL void
+thread_per_output_reduction_loop(OpT op,
+                                 ReductionLoopLayout layout,
+                                 typename OpT::ValueT* out,
+                                 T const* in)
+{
+  using ValueT = typename OpT::ValueT;
+  DataIndexType const num_outputs = layout.outer.numel();
+  DataIndexType const reduction_size = layout.inner.numel();
+  DataIndexType const tid = blockIdx.x * blockDim.x + threadIdx.x;
+  DataIndexType const stride = DataIndexType{blockDim.x} * gridDim.x;
+
+  for (DataIndexType o = tid; o < num_outputs; o += stride)
+  {
+    DataIndexType outer_offsets[2];
+    layout.outer.get_offsets(o, outer_offsets);
+    T const* in_o = in + outer_offsets[1];
+
+    ValueT result = op.identity();
+    for (DataIndexType i = 0; i < reduction_size; ++i)
+    {
+      DataIndexType inner_offset[1];
+      layout.inner.get_offsets(i, inner_offset);
+      result = op.combine(result, op.init(in_o[inner_offset[0]], i));
+    }
+    out[outer_offsets[0]] = result;
+  }
+}
+
+}  // namespace kernels
+
+/**
+ * Launch a reduction of the `size` contiguous elements of `in` with
+ * the reduction operator `op`, storing the result to `*out` (in GPU
+ * memory).
+ *
+ * Reductions that fit in one block are done in a single pass.
+ * Otherwise, as many blocks as may be resident on the GPU each reduce
+ * part of the input, and a second pass combines their results.
+ */
+template <typename OpT, typename T>
+void launch_reduction_loop(OpT const& op,
+                           ComputeStream const& stream,
+                           std::size_t size,
+                           typename OpT::ValueT* out,
+                           T const* in)
+{
+  using ValueT = typename OpT::ValueT;
+  constexpr unsigned int block_size = num_threads_per_block;
+  DeviceStream const dev_stream = stream.template get_stream<Device::GPU>();
+  // Count one application of the operator per element.
+  H2_TRACE_SCOPE_WITH_FLOPS("h2::launch_reduction_loop",
+                            Compute,
+                            stream,
+                            size * sizeof(T) + sizeof(ValueT),
+                            size);
+
+  if (size == 0)
+  {
+    // Write the identity.
+    launch_kernel(kernels::combine_partials<block_size, OpT>,
+                  1,
+                  block_size,
+                  0,
+                  dev_stream,
+                  op,
+                  0u,
+                  out,
+                  static_cast<ValueT const*>(nullptr));
+    return;
+  }
+
+  std::size_t const vec_width = max_vectorization_amount(in);
+  bool const needs_size_t = size > std::numeric_limits<unsigned int>::max();
+
+  // Each thread should have a few vectors of work.
+  std::size_t const work_per_block = std::size_t{block_size} * work_per_thread;
+  std::size_t const wanted_blocks =
+    (size + vec_width * work_per_block - 1) / (vec_width * work_per_block);
+  unsigned int const num_blocks = occupancy_num_blocks(
+    kernels::reduction_loop<block_size, 1, std::size_t, OpT, T>,
+    wanted_blocks,
+    block_size);
+
+  ValueT* partials = out;
+  if (num_blocks > 1)
+  {
+    partials = ::h2::internal::Allocator<ValueT, Device::GPU>::allocate(
+      num_blocks, stream);
+  }
+
+#define DO_LAUNCH(st, vec)                                                     \
+  launch_kernel(kernels::reduction_loop<block_size, vec, st, OpT, T>,         \
+                num_blocks,                                                    \
+                block_size,                                                    \
+                0,                                                             \
+                dev_stream,                                                    \
+                op,                                                            \
+                static_cast<st>(size),                                         \
+                partials,                                                      \
+                in)
+
+  if (needs_size_t)
+  {
+    switch (vec_width)
+    {
+    case 4: DO_LAUNCH(std::size_t, 4); break;
+    case 2: DO_LAUNCH(std::size_t, 2); break;
+    case 1: DO_LAUNCH(std::size_t, 1); break;
+    default:
+      throw H2FatalException("Unexpected vectorization size, ", vec_width);
+    }
+  }
+  else
+  {
+    switch (vec_width)
+    {
+    case 4: DO_LAUNCH(unsigned int, 4); break;
+    case 2: DO_LAUNCH(unsigned int, 2); break;
+    case 1: DO_LAUNCH(unsigned int, 1); break;
+    default:
+      throw H2FatalException("Unexpected vectorization size, ", vec_width);
+    }
+  }
+
+#undef DO_LAUNCH
+
+  if (num_blocks > 1)
+  {
+    launch_kernel(kernels::combine_partials<block_size, OpT>,
+                  1,
+                  block_size,
+                  0,
+                  dev_stream,
+                  op,
+                  num_blocks,
+                  out,
+                  static_cast<ValueT const*>(partials));
+    ::h2::internal::Allocator<ValueT, Device::GPU>::deallocate(partials,
+                                                               stream);
+  }
+}
+
+/**
+ * Launch a reduction of some dimensions of a strided buffer with the
+ * reduction operator `op`.
+ *
+ * This is the GPU version of `cpu::strided_reduction_loop`: dimensions
+ * where `out_strides` is 0 are reduced, and each result is stored to
+ * `out` (in GPU memory) with `out_strides`.
+ */
+template <typename OpT, typename T>
+void launch_strided_reduction_loop(OpT const& op,
+                                   ComputeStream const& stream,
+                                   ShapeTuple const& shape,
+                                   StrideTuple const& in_strides,
+                                   StrideTuple const& out_strides,
+                                   typename OpT::ValueT* out,
+                                   T const* in)
+{
+  constexpr unsigned int block_size = num_threads_per_block;
+  ReductionLoopLayout const layout =
+    make_reduction_loop_layout(shape, in_strides, out_strides);
+  DataIndexType const num_outputs = layout.num_outputs();
+  if (num_outputs == 0)
+  {
+    return;
+  }
+  if (num_outputs == 1 && layout.inner.is_contiguous())
+  {
+    launch_reduction_loop(
+      op, stream, static_cast<std::size_t>(layout.reduction_size()), out, in);
+    return;
+  }
+
+  DeviceStream const dev_stream = stream.template get_stream<Device::GPU>();
+  std::size_t const num_reduced =
+    static_cast<std::size_t>(num_outputs * layout.reduction_size());
+  H2_TRACE_SCOPE_WITH_FLOPS(
+    "h2::launch_strided_reduction_loop",
+    Compute,
+    stream,
+    num_reduced * sizeof(T)
+      + static_cast<std::size_t>(num_outputs) * sizeof(typename OpT::ValueT),
+    num_reduced);
+  if (layout.reduction_size() < static_cast<DataIndexType>(warp_size))
+  {
+    unsigned int const num_blocks = static_cast<unsigned int>(std::min(
+      (num_outputs + block_size - 1) / block_size,
+      static_cast<DataIndexType>(max_grid_x)));
+    launch_kernel(kernels::thread_per_output_reduction_loop<OpT, T>,
+                  num_blocks,
+                  block_size,
+                  0,
+                  dev_stream,
+                  op,
+                  layout,
+                  out,
+                  in);
+  }
+  else
+  {
+    unsigned int const num_blocks = static_cast<unsigned int>(
+      std::min(num_outputs, static_cast<DataIndexType>(max_grid_x)));
+    launch_kernel(
+      kernels::block_per_output_reduction_loop<block_size, OpT, T>,
+      num_blocks,
+      block_size,
+      0,
+      dev_stream,
+      op,
+      layout,
+      out,
+      in);
+  }
+}
+
+/**
+ * Launch a reduction applying `func` to each of the `size` contiguous
+ * elements of `in` and reducing the results with `op`, storing the
+ * result to `*out` (in GPU memory).
+ *
+ * Transformed values are only held in registers, so this needs no
+ * temporary buffer and makes a single pass over `in`.
+ */
+template <typename FuncT, typename OpT, typename T>
+void launch_transform_reduction_loop(FuncT const& func,
+                                     OpT const& op,
+                                     ComputeStream const& stream,
+                                     std::size_t size,
+                                     typename OpT::ValueT* out,
+                                     T const* in)
+{
+  launch_reduction_loop(
+    TransformReduction<FuncT, OpT>{func, op}, stream, size, out, in);
+}
+
+/**
+ * Like `launch_strided_reduction_loop`, but apply `func` to each
+ * element before it is reduced.
+ */
+template <typename FuncT, typename OpT, typename T>
+void launch_strided_transform_reduction_loop(FuncT const& func,
+                                             OpT const& op,
+                                             ComputeStream const& stream,
+                                             ShapeTuple const& shape,
+                                             StrideTuple const& in_strides,
+                                             StrideTuple const& out_strides,
+                                             typename OpT::ValueT* out,
+                                             T const* in)
+{
+  launch_strided_reduction_loop(TransformReduction<FuncT, OpT>{func, op},
+                                stream,
+                                shape,
+                                in_strides,
+                                out_strides,
+                                out,
+                                in);
+}
+
+}  // namespace gpu
+}  // namespace h2
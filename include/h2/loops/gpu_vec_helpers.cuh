@@ -19,6 +19,7 @@
 
 #include <h2_config.hpp>
 
+#include "h2/core/low_precision.hpp"
 #include "h2/gpu/macros.hpp"
 #include "h2/gpu/runtime.hpp"
 #include "h2/utils/const_for.hpp"
@@ -59,6 +60,16 @@ struct VectorTypeForT<char, 4>
   using type = char4;
 };
 template <>
+struct VectorTypeForT<signed char, 2>
+{
+  using type = char2;
+};
+template <>
+struct VectorTypeForT<signed char, 4>
+{
+  using type = char4;
+};
+template <>
 struct VectorTypeForT<unsigned char, 2>
 {
   using type = uchar2;
@@ -169,6 +180,50 @@ struct VectorTypeForT<double, 4>
   using type = double4;
 };
 
+#if H2_HAS_GPU_LOW_PRECISION
+
+/**
+ * A vector of `width` low-precision values.
+ *
+ * The runtimes' packed types (e.g., `__half2`) are not used, as their
+ * members are not always of the scalar type.
+ */
+template <typename T, std::size_t width>
+struct LowPrecisionVector;
+template <typename T>
+struct alignas(sizeof(T) * 2) LowPrecisionVector<T, 2>
+{
+  T x, y;
+};
+template <typename T>
+struct alignas(sizeof(T) * 4) LowPrecisionVector<T, 4>
+{
+  T x, y, z, w;
+};
+
+template <>
+struct VectorTypeForT<Half, 2>
+{
+  using type = LowPrecisionVector<Half, 2>;
+};
+template <>
+struct VectorTypeForT<Half, 4>
+{
+  using type = LowPrecisionVector<Half, 4>;
+};
+template <>
+struct VectorTypeForT<BFloat16, 2>
+{
+  using type = LowPrecisionVector<BFloat16, 2>;
+};
+template <>
+struct VectorTypeForT<BFloat16, 4>
+{
+  using type = LowPrecisionVector<BFloat16, 4>;
+};
+
+#endif  // H2_HAS_GPU_LOW_PRECISION
+
 template <typename T>
 struct VectorTypeForT<T const, 2>
 {
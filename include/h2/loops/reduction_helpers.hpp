@@ -0,0 +1,314 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+// This file is meant to be included only in source files.
+
+#pragma once
+
+/** @file
+ *
+ * Reduction operators and helpers shared by the CPU and GPU reduction
+ * loops.
+ *
+ * A reduction operator `OpT` for input elements of type `T` provides:
+ *
+ * - `ValueT`: The type of partial and final results.
+ * - `ValueT identity() const`: The identity of the reduction.
+ * - `ValueT init(T x, DataIndexType i) const`: The partial result for
+ *   the single element `x` at index `i` of the reduction.
+ * - `ValueT combine(ValueT a, ValueT b) const`: Combine two partial
+ *   results. This must be associative and commutative, as partial
+ *   results are combined in an unspecified order.
+ *
+ * All of these must be callable on both host and device to be used in
+ * GPU reductions. `ValueT` must be trivially copyable.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/gpu/macros.hpp"
+#include "h2/loops/strided_loop_helpers.hpp"
+#include "h2/tensor/tensor_types.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <limits>
+#include <type_traits>
+
+namespace h2
+{
+
+/** Sum of elements. */
+template <typename T>
+struct SumReduction
+{
+  using ValueT = T;
+
+  H2_GPU_HOST_DEVICE ValueT identity() const { return ValueT{0}; }
+  H2_GPU_HOST_DEVICE ValueT init(T x, DataIndexType) const { return x; }
+  H2_GPU_HOST_DEVICE ValueT combine(ValueT a, ValueT b) const
+  {
+    return a + b;
+  }
+};
+
+/** Product of elements. */
+template <typename T>
+struct ProdReduction
+{
+  using ValueT = T;
+
+  H2_GPU_HOST_DEVICE ValueT identity() const { return ValueT{1}; }
+  H2_GPU_HOST_DEVICE ValueT init(T x, DataIndexType) const { return x; }
+  H2_GPU_HOST_DEVICE ValueT combine(ValueT a, ValueT b) const
+  {
+    return a * b;
+  }
+};
+
+/** Maximum element. */
+template <typename T>
+struct MaxReduction
+{
+  using ValueT = T;
+
+  H2_GPU_HOST_DEVICE ValueT identity() const
+  {
+    return std::numeric_limits<T>::lowest();
+  }
+  H2_GPU_HOST_DEVICE ValueT init(T x, DataIndexType) const { return x; }
+  H2_GPU_HOST_DEVICE ValueT combine(ValueT a, ValueT b) const
+  {
+    return (b > a) ? b : a;
+  }
+};
+
+/** Minimum element. */
+template <typename T>
+struct MinReduction
+{
+  using ValueT = T;
+
+  H2_GPU_HOST_DEVICE ValueT identity() const
+  {
+    return std::numeric_limits<T>::max();
+  }
+  H2_GPU_HOST_DEVICE ValueT init(T x, DataIndexType) const { return x; }
+  H2_GPU_HOST_DEVICE ValueT combine(ValueT a, ValueT b) const
+  {
+    return (b < a) ? b : a;
+  }
+};
+
+/** A value and its index, the result of arg-reductions. */
+template <typename T>
+struct ValueIndexPair
+{
+  T value;
+  DataIndexType index;
+};
+
+/**
+ * Index of the maximum element.
+ *
+ * Ties go to the smallest index. Reducing no elements gives the index
+ * `std::numeric_limits<DataIndexType>::max()`.
+ */
+template <typename T>
+struct ArgMaxReduction
+{
+  using ValueT = ValueIndexPair<T>;
+
+  H2_GPU_HOST_DEVICE ValueT identity() const
+  {
+    return {std::numeric_limits<T>::lowest(),
+            std::numeric_limits<DataIndexType>::max()};
+  }
+  H2_GPU_HOST_DEVICE ValueT init(T x, DataIndexType i) const
+  {
+    return {x, i};
+  }
+  H2_GPU_HOST_DEVICE ValueT combine(ValueT a, ValueT b) const
+  {
+    if (b.value > a.value || (b.value == a.value && b.index < a.index))
+    {
+      return b;
+    }
+    return a;
+  }
+};
+
+/**
+ * Index of the minimum element.
+ *
+ * Ties go to the smallest index. Reducing no elements gives the index
+ * `std::numeric_limits<DataIndexType>::max()`.
+ */
+template <typename T>
+struct ArgMinReduction
+{
+  using ValueT = ValueIndexPair<T>;
+
+  H2_GPU_HOST_DEVICE ValueT identity() const
+  {
+    return {std::numeric_limits<T>::max(),
+            std::numeric_limits<DataIndexType>::max()};
+  }
+  H2_GPU_HOST_DEVICE ValueT init(T x, DataIndexType i) const
+  {
+    return {x, i};
+  }
+  H2_GPU_HOST_DEVICE ValueT combine(ValueT a, ValueT b) const
+  {
+    if (b.value < a.value || (b.value == a.value && b.index < a.index))
+    {
+      return b;
+    }
+    return a;
+  }
+};
+
+/**
+ * A reduction operator that applies a function to each element before
+ * reducing it with another reduction operator.
+ *
+ * This fuses an element-wise operation with a reduction, so the
+ * transformed values only ever live in registers. E.g.,
+ * `TransformReduction{square, SumReduction<float>{}}` computes a sum
+ * of squares.
+ *
+ * `FuncT` must be unary and its result convertible to the input type
+ * of `OpT`.
+ */
+template <typename FuncT, typename OpT>
+struct TransformReduction
+{
+  using ValueT = typename OpT::ValueT;
+
+  FuncT func;
+  OpT op;
+
+  H2_GPU_HOST_DEVICE ValueT identity() const { return op.identity(); }
+  template <typename T>
+  H2_GPU_HOST_DEVICE ValueT init(T x, DataIndexType i) const
+  {
+    return op.init(func(x), i);
+  }
+  H2_GPU_HOST_DEVICE ValueT combine(ValueT a, ValueT b) const
+  {
+    return op.combine(a, b);
+  }
+};
+
+template <typename FuncT, typename OpT>
+TransformReduction(FuncT, OpT) -> TransformReduction<FuncT, OpT>;
+
+/**
+ * Call `f` with the reduction operator for elements of type `T`
+ * corresponding to `op`.
+ *
+ * `ReductionOp::Mean` gives a `SumReduction`; callers divide by the
+ * number of elements reduced.
+ */
+template <typename T, typename FuncT>
+void dispatch_reduction_op(ReductionOp op, FuncT&& f)
+{
+  switch (op)
+  {
+  case ReductionOp::Sum:
+  case ReductionOp::Mean: f(SumReduction<T>{}); break;
+  case ReductionOp::Prod: f(ProdReduction<T>{}); break;
+  case ReductionOp::Min: f(MinReduction<T>{}); break;
+  case ReductionOp::Max: f(MaxReduction<T>{}); break;
+  default: throw H2Exception("Unknown reduction op ", op);
+  }
+}
+
+/**
+ * Iteration spaces of a reduction over some dimensions of a strided
+ * buffer.
+ *
+ * `outer` iterates over the outputs, with strides for the output and
+ * then the input buffer; `inner` iterates over the elements reduced
+ * into each output, relative to its offset in the input. Indices
+ * passed to `init` are linear indices in `inner` (i.e., in
+ * generalized column-major order over the reduced dimensions).
+ *
+ * This is trivially copyable so it may be passed to GPU kernels.
+ */
+struct ReductionLoopLayout
+{
+  StridedLoopLayout<2> outer;
+  StridedLoopLayout<1> inner;
+
+  /** Number of outputs. */
+  DataIndexType num_outputs() const { return outer.numel(); }
+
+  /** Number of elements reduced into each output. */
+  DataIndexType reduction_size() const { return inner.numel(); }
+};
+
+/**
+ * Construct the iteration spaces for reducing a buffer of the given
+ * shape and strides.
+ *
+ * Dimensions with an output stride of 0 are reduced; the output is
+ * indexed with `out_strides` in the remaining dimensions.
+ */
+inline ReductionLoopLayout
+make_reduction_loop_layout(ShapeTuple const& shape,
+                           StrideTuple const& in_strides,
+                           StrideTuple const& out_strides)
+{
+  H2_ASSERT_ALWAYS(in_strides.size() == shape.size()
+                     && out_strides.size() == shape.size(),
+                   "Strides ",
+                   in_strides,
+                   " and ",
+                   out_strides,
+                   " do not match shape ",
+                   shape);
+  ReductionLoopLayout layout;
+  if (shape.is_empty())
+  {
+    return layout;
+  }
+  ShapeTuple outer_shape, inner_shape;
+  StrideTuple outer_out_strides, outer_in_strides, inner_strides;
+  for (typename ShapeTuple::size_type d = 0; d < shape.size(); ++d)
+  {
+    if (out_strides[d] == 0 && shape[d] != 1)
+    {
+      inner_shape.append(shape[d]);
+      inner_strides.append(in_strides[d]);
+    }
+    else
+    {
+      outer_shape.append(shape[d]);
+      outer_out_strides.append(out_strides[d]);
+      outer_in_strides.append(in_strides[d]);
+    }
+  }
+  // A missing set of dimensions is a single element.
+  if (outer_shape.is_empty())
+  {
+    outer_shape.append(1);
+    outer_out_strides.append(0);
+    outer_in_strides.append(0);
+  }
+  if (inner_shape.is_empty())
+  {
+    inner_shape.append(1);
+    inner_strides.append(0);
+  }
+  layout.outer =
+    make_strided_loop_layout<2>(outer_shape,
+                                {outer_out_strides, outer_in_strides});
+  layout.inner = make_strided_loop_layout<1>(inner_shape, {inner_strides});
+  return layout;
+}
+
+}  // namespace h2
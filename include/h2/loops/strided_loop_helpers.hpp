@@ -0,0 +1,265 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+// This file is meant to be included only in source files.
+
+#pragma once
+
+/** @file
+ *
+ * Helpers for element-wise loops over strided buffers, shared by the
+ * CPU and GPU loops.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/gpu/macros.hpp"
+#include "h2/tensor/strided_memory.hpp"
+#include "h2/tensor/tensor_types.hpp"
+#include "h2/utils/Error.hpp"
+#include "h2/utils/const_for.hpp"
+#include "h2/utils/function_traits.hpp"
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace h2
+{
+
+/**
+ * Largest number of collapsed dimensions loops have index math
+ * specialized for (see `StridedLoopLayout::get_ranked_offsets`).
+ */
+constexpr int max_ranked_loop_dims = 5;
+
+/**
+ * Iteration space of an element-wise loop over `NumBufs` strided
+ * buffers of the same shape.
+ *
+ * Data is iterated in generalized column-major order over the layout
+ * collapsed by `collapse_strided_layout`, so e.g. a view that is only
+ * strided in its outermost dimension becomes a 2D loop.
+ *
+ * This is trivially copyable so it may be passed to GPU kernels.
+ */
+template <std::size_t NumBufs>
+struct StridedLoopLayout
+{
+  /** Number of dimensions after collapsing. */
+  int ndim = 0;
+  /** Extent of each collapsed dimension. */
+  DataIndexType shape[MAX_TENSOR_DIMS] = {};
+  /** Stride of each collapsed dimension for each buffer. */
+  DataIndexType strides[NumBufs][MAX_TENSOR_DIMS] = {};
+
+  /** Return the number of elements iterated over. */
+  H2_GPU_HOST_DEVICE DataIndexType numel() const
+  {
+    if (ndim == 0)
+    {
+      return 0;
+    }
+    DataIndexType n = 1;
+    for (int d = 0; d < ndim; ++d)
+    {
+      n *= shape[d];
+    }
+    return n;
+  }
+
+  /**
+   * Return true if every buffer is contiguous (so a flat loop over
+   * `numel()` elements suffices).
+   */
+  bool is_contiguous() const
+  {
+    if (ndim > 1)
+    {
+      return false;
+    }
+    for (std::size_t b = 0; b < NumBufs; ++b)
+    {
+      if (ndim == 1 && strides[b][0] != 1)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** Compute the offset in each buffer of the linear index `i`. */
+  H2_GPU_HOST_DEVICE void get_offsets(DataIndexType i,
+                                      DataIndexType (&offsets)[NumBufs]) const
+  {
+    for (std::size_t b = 0; b < NumBufs; ++b)
+    {
+      offsets[b] = 0;
+    }
+    for (int d = 0; d < ndim; ++d)
+    {
+      DataIndexType const coord = i % shape[d];
+      i /= shape[d];
+      for (std::size_t b = 0; b < NumBufs; ++b)
+      {
+        offsets[b] += coord * strides[b][d];
+      }
+    }
+  }
+
+  /**
+   * Like `get_offsets`, but for a layout known to have `NDim`
+   * dimensions, so the loop over them is unrolled and the compiler
+   * can fold the index math.
+   */
+  template <int NDim>
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE void
+  get_ranked_offsets(DataIndexType i, DataIndexType (&offsets)[NumBufs]) const
+  {
+    static_assert(NDim > 0 && NDim <= MAX_TENSOR_DIMS,
+                  "Invalid number of dimensions");
+    for (std::size_t b = 0; b < NumBufs; ++b)
+    {
+      offsets[b] = 0;
+    }
+    const_for<0, NDim, 1>([&](auto d) {
+      // What remains of the index is the coordinate in the last
+      // dimension.
+      DataIndexType coord = i;
+      if constexpr (d.value < NDim - 1)
+      {
+        coord = i % shape[d.value];
+        i /= shape[d.value];
+      }
+      for (std::size_t b = 0; b < NumBufs; ++b)
+      {
+        offsets[b] += coord * strides[b][d.value];
+      }
+    });
+  }
+};
+
+/**
+ * Call `func` with `std::integral_constant<int, N>` where `N` is
+ * `ndim` if it is in [1, `max_ranked_loop_dims`], and 0 (meaning the
+ * rank is only known at runtime) otherwise.
+ *
+ * This selects loops specialized for the number of dimensions of a
+ * `StridedLoopLayout`.
+ */
+template <typename FuncT>
+decltype(auto) dispatch_loop_rank(int ndim, FuncT&& func)
+{
+  static_assert(max_ranked_loop_dims == 5,
+                "Update the cases for the new maximum rank");
+  switch (ndim)
+  {
+  case 1: return func(std::integral_constant<int, 1>{});
+  case 2: return func(std::integral_constant<int, 2>{});
+  case 3: return func(std::integral_constant<int, 3>{});
+  case 4: return func(std::integral_constant<int, 4>{});
+  case 5: return func(std::integral_constant<int, 5>{});
+  default: return func(std::integral_constant<int, 0>{});
+  }
+}
+
+/**
+ * Compute the offsets of the linear index `i` in `layout`, which has
+ * `NDim` dimensions if `NDim` is positive.
+ */
+template <int NDim, std::size_t NumBufs>
+H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE void
+get_loop_offsets(StridedLoopLayout<NumBufs> const& layout,
+                 DataIndexType i,
+                 DataIndexType (&offsets)[NumBufs])
+{
+  if constexpr (NDim > 0)
+  {
+    layout.template get_ranked_offsets<NDim>(i, offsets);
+  }
+  else
+  {
+    layout.get_offsets(i, offsets);
+  }
+}
+
+/**
+ * Construct the iteration space for buffers of the given shape, each
+ * with its own strides.
+ *
+ * Strides of 0 broadcast a buffer along that dimension.
+ */
+template <std::size_t NumBufs>
+StridedLoopLayout<NumBufs>
+make_strided_loop_layout(ShapeTuple const& shape,
+                         std::array<StrideTuple, NumBufs> const& strides)
+{
+  CollapsedStridedLayout<NumBufs> const collapsed =
+    collapse_strided_layout(shape, strides);
+  StridedLoopLayout<NumBufs> layout;
+  if (collapsed.shape.is_empty() || collapsed.shape[0] == 0)
+  {
+    return layout;
+  }
+  layout.ndim = static_cast<int>(collapsed.shape.size());
+  for (int d = 0; d < layout.ndim; ++d)
+  {
+    layout.shape[d] = collapsed.shape[d];
+    for (std::size_t b = 0; b < NumBufs; ++b)
+    {
+      layout.strides[b][d] = collapsed.strides[b][d];
+    }
+  }
+  return layout;
+}
+
+namespace internal
+{
+
+template <typename FuncT, typename... Args, std::size_t... Is>
+H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE void
+apply_at_offsets_impl(FuncT const& func,
+                      DataIndexType const (&offsets)[sizeof...(Args)],
+                      std::index_sequence<Is...>,
+                      Args... args)
+{
+  std::tuple<Args...> const ptrs{args...};
+  if constexpr (FunctionTraits<FuncT>::has_return)
+  {
+    std::get<0>(ptrs)[offsets[0]] =
+      func(std::get<Is + 1>(ptrs)[offsets[Is + 1]]...);
+  }
+  else
+  {
+    func(std::get<Is>(ptrs)[offsets[Is]]...);
+  }
+}
+
+/**
+ * Call func on the elements at `offsets` in each buffer, storing the
+ * result to the first buffer if func returns a value.
+ */
+template <typename FuncT, typename... Args>
+H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE void
+apply_at_offsets(FuncT const& func,
+                 DataIndexType const (&offsets)[sizeof...(Args)],
+                 Args... args)
+{
+  constexpr std::size_t arg_offset =
+    FunctionTraits<FuncT>::has_return ? 1 : 0;
+  apply_at_offsets_impl(
+    func,
+    offsets,
+    std::make_index_sequence<sizeof...(Args) - arg_offset>{},
+    args...);
+}
+
+}  // namespace internal
+
+}  // namespace h2
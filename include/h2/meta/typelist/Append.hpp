@@ -40,12 +40,28 @@ struct AppendT<TypeList<ListOneTs...>, TypeList<ListTwoTs...>>
   using type = TL<ListOneTs..., ListTwoTs...>;
 };
 
-// Many lists
-template <typename FirstList, typename... OtherLists>
-struct AppendT<FirstList, OtherLists...>
-  : AppendT<FirstList, Append<OtherLists...>>
+// Four or more lists: join four at a time, so joining N lists takes
+// about N/4 steps rather than N.
+template <typename... L1Ts,
+          typename... L2Ts,
+          typename... L3Ts,
+          typename... L4Ts,
+          typename... OtherLists>
+struct AppendT<TL<L1Ts...>,
+               TL<L2Ts...>,
+               TL<L3Ts...>,
+               TL<L4Ts...>,
+               OtherLists...>
+  : AppendT<TL<L1Ts..., L2Ts..., L3Ts..., L4Ts...>, OtherLists...>
 {};
 
+// Three lists
+template <typename... L1Ts, typename... L2Ts, typename... L3Ts>
+struct AppendT<TL<L1Ts...>, TL<L2Ts...>, TL<L3Ts...>>
+{
+  using type = TL<L1Ts..., L2Ts..., L3Ts...>;
+};
+
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
 }  // namespace tlist
 }  // namespace meta
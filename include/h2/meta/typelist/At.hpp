@@ -11,6 +11,9 @@
 #include "TypeList.hpp"
 #include "h2/meta/core/Lazy.hpp"
 
+#include <cstddef>
+#include <utility>
+
 namespace h2
 {
 namespace meta
@@ -27,14 +30,40 @@ using At = Force<AtT<List, Idx>>;
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 
-// Base case
-template <typename List>
-struct AtT<List, 0UL> : CarT<List>
+// Rather than peeling one type off the list per index (which
+// instantiates a class per element and is quadratic over all indices
+// of a list), derive from a base per element tagged with its index and
+// let overload resolution pick the one at the index.
+
+template <std::size_t Idx, typename T>
+struct IndexedType
+{
+  using type = T;
+};
+
+template <typename Seq, typename... Ts>
+struct IndexedTypes;
+
+template <std::size_t... Is, typename... Ts>
+struct IndexedTypes<std::index_sequence<Is...>, Ts...> : IndexedType<Is, Ts>...
 {};
 
-// Recursive case
-template <typename List, unsigned long Idx>
-struct AtT : AtT<Cdr<List>, Idx - 1>
+template <std::size_t Idx, typename T>
+IndexedType<Idx, T> select_indexed(IndexedType<Idx, T> const&);
+
+// Out of bounds
+template <typename List, unsigned long Idx, bool InBounds>
+struct AtImplT : CarT<Empty>
+{};
+
+template <typename... Ts, unsigned long Idx>
+struct AtImplT<TL<Ts...>, Idx, true>
+  : decltype(select_indexed<Idx>(
+      std::declval<IndexedTypes<std::index_sequence_for<Ts...>, Ts...>>()))
+{};
+
+template <typename... Ts, unsigned long Idx>
+struct AtT<TL<Ts...>, Idx> : AtImplT<TL<Ts...>, Idx, (Idx < sizeof...(Ts))>
 {};
 
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
@@ -30,19 +30,26 @@ using CartProdTL = Force<CartProdTLT<L1, L2>>;
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 
-// Case with one empty list:
-template <typename... List2Ts>
-struct CartProdTLT<Empty, TL<List2Ts...>>
+namespace details
 {
-  using type = Empty;
+/** @brief The pairs of T with each type in the list. */
+template <typename T, typename List>
+struct CartProdRowT;
+
+template <typename T, typename... Ts>
+struct CartProdRowT<T, TL<Ts...>>
+{
+  using type = TL<TL<T, Ts>...>;
 };
+}  // namespace details
 
-// Two lists:
-template <typename T, typename... List1Ts, typename... List2Ts>
-struct CartProdTLT<TL<T, List1Ts...>, TL<List2Ts...>>
+// Build every row in one pack expansion and join them at once, rather
+// than recursing over the first list. (The leading Empty handles an
+// empty first list.)
+template <typename... List1Ts, typename List2>
+struct CartProdTLT<TL<List1Ts...>, List2>
 {
-  using type = Append<TL<TL<T, List2Ts>...>,
-                      Force<CartProdTLT<TL<List1Ts...>, TL<List2Ts...>>>>;
+  using type = Append<Empty, Force<details::CartProdRowT<List1Ts, List2>>...>;
 };
 
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
@@ -8,9 +8,10 @@
 #pragma once
 
 #include "TypeList.hpp"
-#include "h2/meta/core/IfThenElse.hpp"
 #include "h2/meta/core/ValueAsType.hpp"
 
+#include <type_traits>
+
 namespace h2
 {
 namespace meta
@@ -50,44 +51,33 @@ inline constexpr unsigned long FindIf = FindIfV<Pred, List>();
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 
-template <typename List, typename T, unsigned long N>
-struct FindVTImpl;
-
-template <typename T, unsigned long N>
-struct FindVTImpl<Empty, T, N> : ValueAsType<unsigned long, InvalidIdx>
-{};
-
-template <typename... Ts, typename T, unsigned long N>
-struct FindVTImpl<TL<T, Ts...>, T, N> : ValueAsType<unsigned long, N>
-{};
-
-template <typename... Ts, typename S, typename T, unsigned long N>
-struct FindVTImpl<TL<S, Ts...>, T, N> : FindVTImpl<TL<Ts...>, T, N + 1>
-{};
+// These evaluate whether each type matches in one pack expansion
+// rather than recursing over the list, so each lookup instantiates a
+// constant number of classes regardless of the length of the list.
 
-template <typename List, typename T>
-struct FindVT : FindVTImpl<List, T, 0UL>
-{};
-
-template <template <typename> class Pred, typename List, unsigned long N>
-struct FindIfVTImpl;
-
-template <template <typename> class Pred, unsigned long N>
-struct FindIfVTImpl<Pred, Empty, N> : ValueAsType<unsigned long, InvalidIdx>
-{};
+/** @brief Get the index of the first true value, or InvalidIdx. */
+template <bool... Matches>
+constexpr unsigned long FirstMatchIdx()
+{
+  constexpr bool matches[] = {Matches..., false};
+  for (unsigned long i = 0; i < sizeof...(Matches); ++i)
+  {
+    if (matches[i])
+    {
+      return i;
+    }
+  }
+  return InvalidIdx;
+}
 
-template <template <typename> class Pred,
-          typename T,
-          typename... Ts,
-          unsigned long N>
-struct FindIfVTImpl<Pred, TL<T, Ts...>, N>
-  : IfThenElse<Pred<T>::value,
-               ValueAsType<unsigned long, N>,
-               FindIfVTImpl<Pred, TL<Ts...>, N + 1>>
+template <typename... Ts, typename T>
+struct FindVT<TL<Ts...>, T>
+  : ValueAsType<unsigned long, FirstMatchIdx<std::is_same_v<T, Ts>...>()>
 {};
 
-template <template <typename> class Pred, typename List>
-struct FindIfVT : FindIfVTImpl<Pred, List, 0UL>
+template <template <typename> class Pred, typename... Ts>
+struct FindIfVT<Pred, TL<Ts...>>
+  : ValueAsType<unsigned long, FirstMatchIdx<Pred<Ts>::value...>()>
 {};
 
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
@@ -10,6 +10,8 @@
 #include "TypeList.hpp"
 #include "h2/meta/core/ValueAsType.hpp"
 
+#include <type_traits>
+
 namespace h2
 {
 namespace meta
@@ -32,19 +34,11 @@ inline constexpr bool Member = MemberV<T, List>();
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 
-// Base case
-template <typename T>
-struct MemberVT<T, Empty> : FalseType
-{};
-
-// Match case
+// A fold rather than recursion over the list, so the depth of
+// instantiation does not grow with its length.
 template <typename T, typename... Ts>
-struct MemberVT<T, TL<T, Ts...>> : TrueType
-{};
-
-// Recursive case
-template <typename T, typename Head, typename... Tail>
-struct MemberVT<T, TL<Head, Tail...>> : MemberVT<T, TL<Tail...>>
+struct MemberVT<T, TL<Ts...>>
+  : ValueAsType<bool, (std::is_same_v<T, Ts> || ...)>
 {};
 
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
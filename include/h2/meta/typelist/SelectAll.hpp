@@ -7,8 +7,10 @@
 
 #pragma once
 
+#include "Append.hpp"
 #include "LispAccessors.hpp"
 #include "TypeList.hpp"
+#include "h2/meta/core/IfThenElse.hpp"
 #include "h2/meta/core/Lazy.hpp"
 
 namespace h2
@@ -30,21 +32,13 @@ using SelectAll = Force<SelectAllT<List, Predicate>>;
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
 
-template <template <typename> class Predicate>
-struct SelectAllT<Empty, Predicate>
+// Wrap each type that matches in a list and join them all at once,
+// rather than recursing over the list.
+template <typename... Ts, template <typename> class Predicate>
+struct SelectAllT<TL<Ts...>, Predicate>
 {
-  using type = Empty;
-};
-
-template <typename T, typename... Ts, template <typename> class Predicate>
-struct SelectAllT<TL<T, Ts...>, Predicate>
-{
-private:
-  static constexpr auto Value_ = Predicate<T>::value;
-  using Rest_ = SelectAll<TL<Ts...>, Predicate>;
-
-public:
-  using type = IfThenElse<Value_, Cons<T, Rest_>, Rest_>;
+  using type =
+    Append<Empty, IfThenElse<Predicate<Ts>::value, TL<Ts>, Empty>...>;
 };
 
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
@@ -52,14 +52,23 @@ struct InsertIntoSortedT<T, Empty, Compare>
   using type = TL<T>;
 };
 
+/** @brief Prepend T to the list computed by the metafunction Lazy. */
+template <typename T, typename Lazy>
+struct ConsLazyT
+{
+  using type = Cons<T, Force<Lazy>>;
+};
+
+// Only the selected branch is forced, so insertion stops at the
+// position T belongs in instead of walking the rest of the list.
 template <typename T,
           typename Head,
           typename... Tail,
           template <typename, typename> class Compare>
 struct InsertIntoSortedT<T, TL<Head, Tail...>, Compare>
-  : IfThenElseT<Compare<T, Head>::value,
-                TL<T, Head, Tail...>,
-                Cons<Head, InsertIntoSorted<T, TL<Tail...>, Compare>>>
+  : IfThenElse<Compare<T, Head>::value,
+               ConsT<T, TL<Head, Tail...>>,
+               ConsLazyT<Head, InsertIntoSortedT<T, TL<Tail...>, Compare>>>
 {};
 
 }  // namespace details
@@ -96,6 +96,10 @@ class MapDispatcher;
  *  @tparam CasterT  The casting policy to use to convert base-class
  *                   arguments to their concrete type.
  *
+ *  @note This is not thread-safe. When the concrete types of each
+ *        argument are known up front, MatrixDispatcher is faster and
+ *        thread-safe.
+ *
  *  @todo Treat inheritance properly?
  *  @todo Allow extra arguments?
  */
@@ -0,0 +1,264 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "h2/meta/Core.hpp"
+#include "h2/meta/TypeList.hpp"
+#include "h2/patterns/multimethods/MapDispatcher.hpp"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <tuple>
+#include <typeinfo>
+#include <type_traits>
+#include <vector>
+
+namespace h2
+{
+namespace multimethods
+{
+
+namespace internal
+{
+
+/** @brief Map the dynamic type of an object to its index in a list.
+ *
+ *  The list is checked in order, so more frequently used types should
+ *  come first. Returns the length of the list if the type is not
+ *  present.
+ */
+template <typename List>
+struct DynamicTypeIndexer;
+
+template <typename... Ts>
+struct DynamicTypeIndexer<meta::TL<Ts...>>
+{
+  template <typename BaseT>
+  static std::size_t index(BaseT& x)
+  {
+    std::type_info const& type = typeid(x);
+    std::size_t idx = 0;
+    // Stops at the first match, leaving idx at that match.
+    (void) ((type == typeid(Ts) ? true : (++idx, false)) || ...);
+    return idx;
+  }
+};
+
+}  // namespace internal
+
+template <typename ReturnT,
+          typename BaseArgsTL,
+          typename ConcreteTypesTL,
+          template <class, class> class CasterT = DynamicDownCaster>
+class MatrixDispatcher;
+
+/** @brief Constant-time, thread-safe multimethod
+ *
+ *  This is a variant of MapDispatcher for when the set of concrete
+ *  types each argument may have is known up front. Entries are stored
+ *  in a dense (row-major) matrix indexed by the position of each
+ *  argument's dynamic type in its list of concrete types, so dispatch
+ *  is one `typeid` comparison chain per argument plus an array index,
+ *  rather than a map lookup.
+ *
+ *  Registration and dispatch may happen concurrently from any number
+ *  of threads: calls share a reader lock, and registration takes it
+ *  exclusively. Consequently, a registered function must not call
+ *  add() on the dispatcher it was called from, and functors that are
+ *  called concurrently must be safe to call concurrently. Use
+ *  call_batch() to dispatch many argument tuples under one lock.
+ *
+ *  @tparam ReturnT         The type returned by the functions being
+ *                          registered.
+ *  @tparam BaseArgs        The base class types used to generate the
+ *                          polymorphic interface. As in
+ *                          MapDispatcher, these should be
+ *                          cv-qualified, but NOT references.
+ *  @tparam ConcreteTypeTLs One typelist per argument giving the
+ *                          concrete types it may have. Arguments with
+ *                          other dynamic types have no dispatch.
+ *  @tparam CasterT         The casting policy to use to convert
+ *                          base-class arguments to their concrete
+ *                          type.
+ */
+template <typename ReturnT,
+          typename... BaseArgs,
+          typename... ConcreteTypeTLs,
+          template <class, class> class CasterT>
+class MatrixDispatcher<ReturnT,
+                       meta::TL<BaseArgs...>,
+                       meta::TL<ConcreteTypeTLs...>,
+                       CasterT>
+{
+  static_assert(sizeof...(BaseArgs) == sizeof...(ConcreteTypeTLs),
+                "Must give a list of concrete types for each argument.");
+
+  /** @brief The number of dispatched arguments. */
+  static constexpr std::size_t NumArgs = sizeof...(BaseArgs);
+
+  /** @brief The number of concrete types of each argument. */
+  static constexpr std::array<std::size_t, NumArgs> dims = {
+    meta::tlist::Length<ConcreteTypeTLs>...};
+
+  /** @brief The total number of entries in the dispatch matrix. */
+  static constexpr std::size_t num_entries = (std::size_t{1} * ... *
+                                              meta::tlist::Length<
+                                                ConcreteTypeTLs>);
+
+  /** @brief The type of function being held. */
+  using FunctionT = std::function<ReturnT(BaseArgs&...)>;
+
+public:
+  /** @brief The type of one set of arguments to call_batch(). */
+  using ArgsT = std::tuple<BaseArgs&...>;
+
+  /** @brief The result of call_batch(). */
+  using BatchResultT = meta::
+    IfThenElse<std::is_void_v<ReturnT>, void, std::vector<ReturnT>>;
+
+  MatrixDispatcher() : m_dispatch(num_entries) {}
+
+  /** @brief Register a new entry in the dispatch matrix.
+   *
+   *  @tparam Ts (User-provided) The (concrete) types for which to
+   *             register this entry. Each must be in the list of
+   *             concrete types for its argument.
+   *  @tparam F (Inferred) The type of the functor being registered.
+   *
+   *  @param[in] f The functor to register for the types given in Ts.
+   */
+  template <typename... Ts, typename F>
+  void add(F f)
+  {
+    set_entry<Ts...>([f = std::move(f)](BaseArgs&... args) mutable {
+      return f(CasterT<Ts, BaseArgs>::cast(args)...);
+    });
+  }
+
+  /** @brief Register an explicit function pointer in the dispatch
+   *         matrix.
+   *
+   *  See MapDispatcher::add() for details.
+   *
+   *  @tparam Fn (User-provided) The type of the function being
+   *             registered.
+   *  @tparam f  (User-provided) The address of the function being
+   *             registered.
+   *  @tparam Ts (User-provided) The (concrete) types for which to
+   *             register this entry.
+   */
+  template <typename Fn, Fn f, typename... Ts>
+  void add()
+  {
+    set_entry<Ts...>([](BaseArgs&... args) {
+      return f(CasterT<Ts, BaseArgs>::cast(args)...);
+    });
+  }
+
+  /** @brief Call the held function using the given arguments.
+   *
+   *  @param args The arguments on which to dispatch.
+   *
+   *  @throws NoDispatchAdded if the combination of dynamic types
+   *          doesn't have an entry in the dispatch matrix.
+   */
+  ReturnT call(BaseArgs&... args) const
+  {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return get_entry(args...)(args...);
+  }
+
+  /** @brief Call the held functions for each set of arguments.
+   *
+   *  This is equivalent to calling call() on each element of `args`
+   *  in order, but only acquires the dispatcher's lock once.
+   *
+   *  @returns The result of each call, in order (unless ReturnT is
+   *           void).
+   *
+   *  @throws NoDispatchAdded if any combination of dynamic types
+   *          doesn't have an entry in the dispatch matrix. Calls for
+   *          earlier arguments will have completed.
+   */
+  BatchResultT call_batch(std::vector<ArgsT> const& args) const
+  {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    if constexpr (std::is_void_v<ReturnT>)
+    {
+      for (auto const& a : args)
+      {
+        std::apply([this](BaseArgs&... xs) { get_entry(xs...)(xs...); }, a);
+      }
+    }
+    else
+    {
+      std::vector<ReturnT> results;
+      results.reserve(args.size());
+      for (auto const& a : args)
+      {
+        results.push_back(std::apply(
+          [this](BaseArgs&... xs) { return get_entry(xs...)(xs...); }, a));
+      }
+      return results;
+    }
+  }
+
+private:
+  /** @brief The dispatch matrix; empty functions have no dispatch. */
+  std::vector<FunctionT> m_dispatch;
+
+  /** @brief Protects the dispatch matrix. */
+  mutable std::shared_mutex m_mutex;
+
+  /** @brief Return the flat index of the given per-argument indices. */
+  static constexpr std::size_t
+  flat_index(std::array<std::size_t, NumArgs> const& idxs)
+  {
+    std::size_t idx = 0;
+    for (std::size_t i = 0; i < NumArgs; ++i)
+    {
+      idx = idx * dims[i] + idxs[i];
+    }
+    return idx;
+  }
+
+  template <typename... Ts, typename F>
+  void set_entry(F&& f)
+  {
+    static_assert(sizeof...(Ts) == NumArgs, "Number of arguments must match.");
+    static_assert((meta::tlist::Member<Ts, ConcreteTypeTLs> && ...),
+                  "Types must be in the concrete types of their argument.");
+    constexpr std::size_t idx =
+      flat_index({meta::tlist::Find<ConcreteTypeTLs, Ts>...});
+    std::lock_guard<std::shared_mutex> lock(m_mutex);
+    m_dispatch[idx] = std::forward<F>(f);
+  }
+
+  /** @brief Return the entry for the arguments. Requires the lock. */
+  FunctionT const& get_entry(BaseArgs&... args) const
+  {
+    std::array<std::size_t, NumArgs> const idxs = {
+      internal::DynamicTypeIndexer<ConcreteTypeTLs>::index(args)...};
+    for (std::size_t i = 0; i < NumArgs; ++i)
+    {
+      if (idxs[i] == dims[i])
+        throw NoDispatchAdded{};
+    }
+    FunctionT const& f = m_dispatch[flat_index(idxs)];
+    if (!f)
+      throw NoDispatchAdded{};
+    return f;
+  }
+
+};  // class MatrixDispatcher
+
+}  // namespace multimethods
+}  // namespace h2
@@ -0,0 +1,219 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Allreduces of many small distributed tensors fused into buckets.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/tensor/collectives.hpp"
+#include "h2/tensor/copy_buffer.hpp"
+#include "h2/tensor/dist_tensor.hpp"
+#include "h2/tensor/proc_grid.hpp"
+#include "h2/tensor/tensor_types.hpp"
+#include "h2/tensor/tensor_utils.hpp"
+#include "h2/utils/Error.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace h2
+{
+
+/**
+ * Allreduce many distributed tensors by packing them into fused
+ * buffers ("buckets") and reducing each bucket with one collective.
+ *
+ * This amortizes the latency of reducing many small tensors, such as
+ * the gradients of a model's parameters. Tensors are added with `add`,
+ * which packs the local data into the current bucket; once a bucket
+ * would exceed the size threshold, it is reduced and its tensors are
+ * unpacked with the reduced data. `flush` reduces a partially filled
+ * bucket. Tensors larger than the threshold get a bucket of their own.
+ *
+ * All work is ordered on the bucketer's compute stream, which waits
+ * for each tensor's stream when it is added, and each tensor's stream
+ * waits for the bucketer's stream once its data is unpacked, so
+ * communication can overlap with other work on a separate stream.
+ * Packing reads the tensor's data at `add`, so tensors must not be
+ * modified until their bucket is flushed, and must outlive it.
+ *
+ * Every process in the grid must add the same sequence of tensors
+ * with the same shapes, as with any collective, and call `flush` after
+ * the last one; tensors still in a bucket when the bucketer is
+ * destroyed are not reduced.
+ */
+template <typename T>
+class BucketedAllreduce
+{
+public:
+  /**
+   * Set up bucketed allreduces over processor grid dimensions `dims`
+   * of `grid`, on `device`.
+   *
+   * @param[in] bucket_bytes_ Maximum bytes per bucket, defaulting to
+   * the `H2_ALLREDUCE_BUCKET_SIZE` environment variable.
+   */
+  BucketedAllreduce(ProcessorGrid const& grid_,
+                    DimensionOrderTuple const& dims_,
+                    Device device_,
+                    std::optional<ComputeStream> const stream_ = std::nullopt,
+                    ReductionOp op_ = ReductionOp::Sum,
+                    std::optional<std::size_t> const bucket_bytes_ =
+                      std::nullopt)
+    : grid(grid_),
+      dims(dims_),
+      device(device_),
+      stream(stream_.value_or(ComputeStream{device_})),
+      op(op_),
+      bucket_capacity(std::max<std::size_t>(
+        bucket_bytes_.value_or(env::get<std::size_t>("ALLREDUCE_BUCKET_SIZE"))
+          / sizeof(T),
+        1))
+  {}
+
+  BucketedAllreduce(BucketedAllreduce const&) = delete;
+  BucketedAllreduce& operator=(BucketedAllreduce const&) = delete;
+
+  /**
+   * Pack the local data of `tensor` into the current bucket, reducing
+   * the bucket first if it cannot hold it.
+   *
+   * `tensor` must be on the bucketer's device and processor grid, and
+   * be `Replicated` in every reduced dimension.
+   */
+  void add(DistTensor<T>& tensor)
+  {
+    H2_ASSERT_ALWAYS(tensor.get_device() == device,
+                     "Cannot add a tensor on device ",
+                     tensor.get_device(),
+                     " to a bucketed allreduce on ",
+                     device);
+    H2_ASSERT_ALWAYS(tensor.proc_grid().is_congruent_to(grid),
+                     "Cannot add a tensor on a different processor grid "
+                     "to a bucketed allreduce");
+    internal::check_collective_dims(
+      tensor, dims, Distribution::Replicated, "BucketedAllreduce");
+    if (tensor.is_local_empty())
+    {
+      return;
+    }
+    H2_ASSERT_ALWAYS(tensor.const_data() != nullptr,
+                     "Cannot allreduce a tensor with no data");
+
+    std::size_t const count = static_cast<std::size_t>(tensor.local_numel());
+    if (bucket_size + count > bucket_capacity)
+    {
+      flush();
+    }
+    if (!bucket)
+    {
+      bucket = std::make_unique<internal::ManagedBuffer<T>>(
+        std::max(bucket_capacity, count), device, stream);
+    }
+    stream.wait_for(tensor.get_stream());
+    Tensor<T>& local = tensor.local_tensor();
+    copy_strided_buffer(bucket->data() + bucket_size,
+                        get_contiguous_strides(local.shape()),
+                        stream,
+                        local.const_data(),
+                        local.strides(),
+                        stream,
+                        local.shape());
+    bucket_entries.push_back({&tensor, bucket_size});
+    bucket_size += count;
+  }
+
+  /**
+   * Reduce the current bucket, if it has any tensors, and unpack the
+   * results into them.
+   */
+  void flush()
+  {
+    if (bucket_entries.empty())
+    {
+      return;
+    }
+    internal::allreduce_buffer(bucket->data(),
+                               bucket_size,
+                               op,
+                               grid.get_subcomm(dims),
+                               device,
+                               stream);
+    for (auto const& entry : bucket_entries)
+    {
+      Tensor<T>& local = entry.tensor->local_tensor();
+      copy_strided_buffer(local.data(),
+                          local.strides(),
+                          stream,
+                          bucket->const_data() + entry.offset,
+                          get_contiguous_strides(local.shape()),
+                          stream,
+                          local.shape());
+      entry.tensor->get_stream().wait_for(stream);
+    }
+    ++num_flushes;
+    bucket_entries.clear();
+    bucket_size = 0;
+    // Deallocation is ordered on the stream, so the next bucket gets a
+    // fresh buffer while this one may still be in use.
+    bucket.reset();
+  }
+
+  /** Return the compute stream communication is ordered on. */
+  ComputeStream const& get_stream() const H2_NOEXCEPT { return stream; }
+
+  /** Return the maximum number of elements in a bucket. */
+  std::size_t capacity() const H2_NOEXCEPT { return bucket_capacity; }
+
+  /** Return the number of elements in the current bucket. */
+  std::size_t size() const H2_NOEXCEPT { return bucket_size; }
+
+  /** Return the number of buckets reduced so far. */
+  std::size_t get_num_flushes() const H2_NOEXCEPT { return num_flushes; }
+
+private:
+  /** A tensor packed into the current bucket. */
+  struct BucketEntry
+  {
+    DistTensor<T>* tensor;
+    std::size_t offset; /**< Offset in elements in the bucket. */
+  };
+
+  /** Grid the tensors are distributed on. */
+  ProcessorGrid grid;
+  /** Grid dimensions to reduce over. */
+  DimensionOrderTuple dims;
+  /** Device of the tensors. */
+  Device device;
+  /** Stream communication is ordered on. */
+  ComputeStream stream;
+  /** Reduction operation. */
+  ReductionOp op;
+  /** Maximum number of elements in a bucket. */
+  std::size_t bucket_capacity;
+  /** Fused buffer for the current bucket. */
+  std::unique_ptr<internal::ManagedBuffer<T>> bucket;
+  /** Number of elements packed into the current bucket. */
+  std::size_t bucket_size = 0;
+  /** Tensors packed into the current bucket. */
+  std::vector<BucketEntry> bucket_entries;
+  /** Number of buckets reduced. */
+  std::size_t num_flushes = 0;
+};
+
+}  // namespace h2
@@ -0,0 +1,614 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Collective operations on distributed tensors.
+ *
+ * These reduce or gather the local data of a distributed tensor over a
+ * set of processor grid dimensions. Communication goes through
+ * Hydrogen's Aluminum dispatch, which selects the communicator's
+ * backend from the device: NCCL/RCCL for GPU data (when available)
+ * and MPI otherwise. Operations are ordered on the tensors' compute
+ * streams and, with GPU backends, are asynchronous with respect to the
+ * host.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/device.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/core/tracer.hpp"
+#include "h2/tensor/copy_buffer.hpp"
+#include "h2/tensor/dist_tensor.hpp"
+#include "h2/tensor/straggler_monitor.hpp"
+#include "h2/tensor/tensor_types.hpp"
+#include "h2/tensor/tensor_utils.hpp"
+#include "h2/utils/As.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <El.hpp>
+
+#include <cstddef>
+#include <ostream>
+
+namespace h2
+{
+
+/** Precision data is sent at in compressed collectives. */
+enum class CommCompression
+{
+  None,    /**< Send data at full precision. */
+  Half,    /**< Send IEEE half precision data. */
+  BFloat16 /**< Send bfloat16 data. */
+};
+
+/** Support printing CommCompression. */
+inline std::ostream& operator<<(std::ostream& os,
+                                CommCompression const& compression)
+{
+  switch (compression)
+  {
+  case CommCompression::None: os << "None"; break;
+  case CommCompression::Half: os << "Half"; break;
+  case CommCompression::BFloat16: os << "BFloat16"; break;
+  default: os << "Unknown"; break;
+  }
+  return os;
+}
+
+namespace internal
+{
+
+#ifdef H2_HAS_GPU
+/**
+ * Sum `count` floats of GPU buffer `buf` over `comm`, sending data with
+ * `compression`, ordered on `stream`.
+ *
+ * If `error` is not null, it is added to `buf` first and then holds
+ * what compression lost.
+ */
+void allreduce_compressed_gpu(float* buf,
+                              float* error,
+                              std::size_t count,
+                              CommCompression compression,
+                              Comm& comm,
+                              ComputeStream const& stream);
+#endif
+
+/** Return the Hydrogen operation corresponding to `op`. */
+inline El::mpi::Op get_el_op(ReductionOp op)
+{
+  switch (op)
+  {
+  case ReductionOp::Sum: return El::mpi::SUM;
+  case ReductionOp::Prod: return El::mpi::PROD;
+  case ReductionOp::Min: return El::mpi::MIN;
+  case ReductionOp::Max: return El::mpi::MAX;
+  case ReductionOp::Mean:
+    throw H2Exception("Mean reductions are not supported in collectives");
+  default: throw H2Exception("Unknown reduction op ", op);
+  }
+}
+
+/**
+ * Check that every dimension in `dims` is a valid dimension of `grid`
+ * and that `tensor` is distributed with `dist` in it.
+ */
+template <typename T>
+void check_collective_dims(DistTensor<T> const& tensor,
+                           DimensionOrderTuple const& dims,
+                           Distribution dist,
+                           char const* name)
+{
+  for (auto const& dim : dims)
+  {
+    H2_ASSERT_ALWAYS(
+      dim >= 0
+        && static_cast<typename ShapeTuple::size_type>(dim) < tensor.ndim(),
+      "Invalid dimension ",
+      dim,
+      " for ",
+      name,
+      " of a tensor with shape ",
+      tensor.shape());
+    H2_ASSERT_ALWAYS(tensor.distribution(dim) == dist,
+                     name,
+                     " requires dimension ",
+                     dim,
+                     " to be ",
+                     dist,
+                     " (got ",
+                     tensor.distribution(),
+                     ")");
+  }
+}
+
+/**
+ * Check that `dst` and `src` are compatible for a collective that
+ * changes the distribution of the dimensions in `dims` from `src_dist`
+ * to `dst_dist`, and, if `require_even`, that those dimensions divide
+ * evenly.
+ */
+template <typename T>
+void check_redistributing_collective(DistTensor<T> const& dst,
+                                     DistTensor<T> const& src,
+                                     DimensionOrderTuple const& dims,
+                                     Distribution src_dist,
+                                     Distribution dst_dist,
+                                     char const* name,
+                                     bool require_even = true)
+{
+  H2_ASSERT_ALWAYS(dst.shape() == src.shape(),
+                   "Cannot ",
+                   name,
+                   " between tensors of different shapes (",
+                   src.shape(),
+                   " and ",
+                   dst.shape(),
+                   ")");
+  H2_ASSERT_ALWAYS(dst.get_device() == src.get_device(),
+                   "Cannot ",
+                   name,
+                   " between tensors on different devices");
+  H2_ASSERT_ALWAYS(
+    src.proc_grid().is_congruent_to(dst.proc_grid()),
+    "Cannot ",
+    name,
+    " between tensors on different processor grids");
+  check_collective_dims(src, dims, src_dist, name);
+  check_collective_dims(dst, dims, dst_dist, name);
+  for (typename ShapeTuple::size_type i = 0; i < src.ndim(); ++i)
+  {
+    if (any_of(dims, [&](auto const& d) {
+          return static_cast<typename ShapeTuple::size_type>(d) == i;
+        }))
+    {
+      H2_ASSERT_ALWAYS(!require_even
+                         || src.shape(i) % src.proc_grid().shape(i) == 0,
+                       name,
+                       " requires dimension ",
+                       i,
+                       " (",
+                       src.shape(i),
+                       ") to divide evenly over the grid (",
+                       src.proc_grid().shape(),
+                       ")");
+    }
+    else
+    {
+      H2_ASSERT_ALWAYS(src.distribution(i) == dst.distribution(i),
+                       name,
+                       " cannot change the distribution of dimension ",
+                       i,
+                       " (",
+                       src.distribution(),
+                       " and ",
+                       dst.distribution(),
+                       ")");
+    }
+  }
+}
+
+/**
+ * Return the index in a tensor of the block for rank `rank` of the
+ * sub-communicator of `dims` in `grid`, where blocks along those
+ * dimensions have shape `block_shape`.
+ */
+inline ScalarIndexTuple get_collective_block_start(
+  ProcessorGrid const& grid,
+  DimensionOrderTuple const& dims,
+  ShapeTuple const& block_shape,
+  RankType rank)
+{
+  // Sub-communicator ranks order the first dimension fastest.
+  ScalarIndexTuple start(TuplePad<ScalarIndexTuple>(block_shape.size(), 0));
+  for (auto const& dim : dims)
+  {
+    RankType const dim_size = safe_as<RankType>(grid.shape(dim));
+    start[dim] = (rank % dim_size) * block_shape[dim];
+    rank /= dim_size;
+  }
+  return start;
+}
+
+/**
+ * Reduce `count` elements of `buf`, on `device`, in place with `op`
+ * over `comm`, ordered on `stream`.
+ */
+template <typename T>
+void allreduce_buffer(T* buf,
+                      std::size_t count,
+                      ReductionOp op,
+                      Comm& comm,
+                      Device device,
+                      ComputeStream const& stream)
+{
+  if (count == 0 || comm.Size() == 1)
+  {
+    return;
+  }
+  H2_TRACE_SCOPE("h2::allreduce", Comm, stream, count * sizeof(T));
+  H2_STRAGGLER_ARRIVAL("h2::allreduce", comm.GetMPIComm());
+  H2_DEVICE_DISPATCH_SAME(
+    device,
+    (El::mpi::AllReduce(buf,
+                        safe_as<int>(count),
+                        get_el_op(op),
+                        comm,
+                        static_cast<El::SyncInfo<Dev>>(stream))));
+}
+
+/**
+ * Send each process of `comm` its block of `src_local`, which is held
+ * by rank 0 of `comm`, into `dst_local`.
+ *
+ * Blocks have the shape of `dst_local` and are ordered as in
+ * `get_collective_block_start` over `dims` of `grid`. See `scatter`.
+ */
+void scatter_blocks(BaseTensor& dst_local,
+                    BaseTensor const& src_local,
+                    ProcessorGrid const& grid,
+                    DimensionOrderTuple const& dims,
+                    Comm& comm);
+
+/**
+ * Return the bytes per chunk for a pipelined broadcast of `bytes`
+ * bytes of `elem_size`-byte elements over `comm_size` processes.
+ *
+ * A pipelined tree broadcast of `k` chunks takes roughly
+ * `(log2(p) + k - 1) * (latency + bytes / (k * bandwidth))`, which is
+ * minimized with chunks of `sqrt(bytes * latency * bandwidth /
+ * (log2(p) - 1))` bytes. Chunks are whole elements, at least 64 KiB
+ * (unless the message is smaller), and at most 16 MiB. Setting
+ * `H2_BCAST_CHUNK` overrides this with a fixed size.
+ */
+std::size_t get_broadcast_chunk_bytes(std::size_t bytes,
+                                      int comm_size,
+                                      std::size_t elem_size);
+
+/**
+ * Broadcast `src_local`, which is held by rank 0 of `comm`, into
+ * `dst_local` on every process. See `broadcast`.
+ */
+void broadcast_local(BaseTensor& dst_local,
+                     BaseTensor const& src_local,
+                     Comm& comm);
+
+}  // namespace internal
+
+/**
+ * Reduce the local data of `tensor` in place with `op` over the
+ * processor grid dimensions `dims`.
+ *
+ * Each dimension in `dims` must be `Replicated`; every process holds a
+ * partial result (e.g., a gradient contribution) on entry, and the
+ * reduced result on exit. The distribution does not change.
+ *
+ * This is collective over the processes that share all coordinates of
+ * the grid not in `dims`, and the local tensor must be contiguous.
+ */
+template <typename T>
+void allreduce(DistTensor<T>& tensor,
+               DimensionOrderTuple const& dims,
+               ReductionOp op = ReductionOp::Sum)
+{
+  internal::check_collective_dims(
+    tensor, dims, Distribution::Replicated, "allreduce");
+  if (tensor.is_local_empty() || dims.is_empty())
+  {
+    return;
+  }
+  H2_ASSERT_ALWAYS(tensor.data() != nullptr,
+                   "Cannot allreduce a tensor with no data");
+  H2_ASSERT_ALWAYS(tensor.local_tensor().is_contiguous(),
+                   "Cannot allreduce a tensor with non-contiguous local data");
+  internal::allreduce_buffer(tensor.data(),
+                             static_cast<std::size_t>(tensor.local_numel()),
+                             op,
+                             tensor.proc_grid().get_subcomm(dims),
+                             tensor.get_device(),
+                             tensor.get_stream());
+}
+
+/**
+ * Gather the blocks of `src` over the processor grid dimensions `dims`
+ * into `dst`.
+ *
+ * Each dimension in `dims` must be `Block` in `src` and `Replicated`
+ * in `dst`, and must divide evenly over the grid; other dimensions
+ * must be distributed the same way in both. `dst` must have the same
+ * shape as `src` and a congruent processor grid, and is allocated if
+ * needed.
+ *
+ * This is collective over the processes that share all coordinates of
+ * the grid not in `dims`. The local tensor of `src` must be contiguous,
+ * and the communication is ordered on `dst`'s stream.
+ */
+template <typename T>
+void allgather(DistTensor<T>& dst,
+               DistTensor<T> const& src,
+               DimensionOrderTuple const& dims)
+{
+  internal::check_redistributing_collective(dst,
+                                            src,
+                                            dims,
+                                            Distribution::Block,
+                                            Distribution::Replicated,
+                                            "allgather");
+  if (src.is_empty())
+  {
+    return;
+  }
+  dst.ensure();
+  if (src.is_local_empty())
+  {
+    return;
+  }
+  H2_ASSERT_ALWAYS(src.const_data() != nullptr,
+                   "Cannot allgather a tensor with no data");
+  H2_ASSERT_ALWAYS(src.const_local_tensor().is_contiguous(),
+                   "Cannot allgather a tensor with non-contiguous local data");
+
+  Comm& comm = src.proc_grid().get_subcomm(dims);
+  ShapeTuple const block_shape = src.local_shape();
+  std::size_t const block_numel = product<std::size_t>(block_shape);
+  RankType const comm_size = comm.Size();
+  ComputeStream const& stream = dst.get_stream();
+  stream.wait_for(src.get_stream());
+
+  internal::ManagedBuffer<T> gathered(
+    block_numel * comm_size, dst.get_device(), stream);
+  {
+    H2_TRACE_SCOPE(
+      "h2::allgather", Comm, stream, block_numel * comm_size * sizeof(T));
+    H2_STRAGGLER_ARRIVAL("h2::allgather", comm.GetMPIComm());
+    H2_DEVICE_DISPATCH_SAME(
+      dst.get_device(),
+      (El::mpi::AllGather(src.const_data(),
+                          safe_as<int>(block_numel),
+                          gathered.data(),
+                          safe_as<int>(block_numel),
+                          comm,
+                          static_cast<El::SyncInfo<Dev>>(stream))));
+  }
+
+  Tensor<T>& dst_local = dst.local_tensor();
+  StrideTuple const block_strides = get_contiguous_strides(block_shape);
+  for (RankType r = 0; r < comm_size; ++r)
+  {
+    ScalarIndexTuple const start = internal::get_collective_block_start(
+      src.proc_grid(), dims, block_shape, r);
+    copy_strided_buffer(dst_local.get(start),
+                        dst_local.strides(),
+                        stream,
+                        gathered.const_data() + r * block_numel,
+                        block_strides,
+                        stream,
+                        block_shape);
+  }
+}
+
+/**
+ * Reduce the local data of `src` with `op` over the processor grid
+ * dimensions `dims`, leaving each process with its block of the result
+ * in `dst`.
+ *
+ * Each dimension in `dims` must be `Replicated` in `src` (every process
+ * holding a partial result) and `Block` in `dst`, and must divide
+ * evenly over the grid; other dimensions must be distributed the same
+ * way in both. `dst` must have the same shape as `src` and a congruent
+ * processor grid, and is allocated if needed.
+ *
+ * This is collective over the processes that share all coordinates of
+ * the grid not in `dims`. The local tensor of `dst` must be contiguous,
+ * and the communication is ordered on `dst`'s stream.
+ */
+template <typename T>
+void reduce_scatter(DistTensor<T>& dst,
+                    DistTensor<T> const& src,
+                    DimensionOrderTuple const& dims,
+                    ReductionOp op = ReductionOp::Sum)
+{
+  internal::check_redistributing_collective(dst,
+                                            src,
+                                            dims,
+                                            Distribution::Replicated,
+                                            Distribution::Block,
+                                            "reduce_scatter");
+  if (src.is_empty())
+  {
+    return;
+  }
+  dst.ensure();
+  if (dst.is_local_empty())
+  {
+    return;
+  }
+  H2_ASSERT_ALWAYS(src.const_data() != nullptr,
+                   "Cannot reduce_scatter a tensor with no data");
+  H2_ASSERT_ALWAYS(
+    dst.local_tensor().is_contiguous(),
+    "Cannot reduce_scatter into a tensor with non-contiguous local data");
+
+  Comm& comm = src.proc_grid().get_subcomm(dims);
+  ShapeTuple const block_shape = dst.local_shape();
+  std::size_t const block_numel = product<std::size_t>(block_shape);
+  RankType const comm_size = comm.Size();
+  ComputeStream const& stream = dst.get_stream();
+  stream.wait_for(src.get_stream());
+
+  // Pack the block destined for each rank contiguously, in rank order.
+  Tensor<T> const& src_local = src.const_local_tensor();
+  internal::ManagedBuffer<T> packed(
+    block_numel * comm_size, dst.get_device(), stream);
+  StrideTuple const block_strides = get_contiguous_strides(block_shape);
+  for (RankType r = 0; r < comm_size; ++r)
+  {
+    ScalarIndexTuple const start = internal::get_collective_block_start(
+      src.proc_grid(), dims, block_shape, r);
+    copy_strided_buffer(packed.data() + r * block_numel,
+                        block_strides,
+                        stream,
+                        src_local.const_get(start),
+                        src_local.strides(),
+                        src.get_stream(),
+                        block_shape);
+  }
+
+  H2_TRACE_SCOPE(
+    "h2::reduce_scatter", Comm, stream, block_numel * comm_size * sizeof(T));
+  H2_STRAGGLER_ARRIVAL("h2::reduce_scatter", comm.GetMPIComm());
+  H2_DEVICE_DISPATCH_SAME(
+    dst.get_device(),
+    (El::mpi::ReduceScatter(packed.const_data(),
+                            dst.data(),
+                            safe_as<int>(block_numel),
+                            internal::get_el_op(op),
+                            comm,
+                            static_cast<El::SyncInfo<Dev>>(stream))));
+}
+
+/**
+ * Scatter `src`, held by one process, over the processor grid
+ * dimensions `dims` into the blocks of `dst`.
+ *
+ * Each dimension in `dims` must be `Single` in `src` and `Block` in
+ * `dst`, and must divide evenly over the grid; other dimensions must
+ * be distributed the same way in both. `dst` must have the same shape
+ * as `src` and a congruent processor grid, and is allocated if needed.
+ * This is the usual data ingest pattern, where one process reads a
+ * sample and it is then distributed spatially.
+ *
+ * Unlike a general `redistribute`, the root packs one block at a time
+ * into a (pinned, for GPU data) host buffer and sends it in chunks of
+ * `H2_SCATTER_CHUNK` bytes while packing the next. Other processes
+ * copy each chunk to their local tensor as it arrives, so transfers to
+ * the GPU overlap with the rest of the communication. This uses MPI
+ * directly rather than Aluminum.
+ *
+ * This is collective over the processes that share all coordinates of
+ * the grid not in `dims`. The local tensor of `dst` must be contiguous.
+ * The root synchronizes with `src`'s stream, and every process with
+ * `dst`'s stream before returning.
+ */
+template <typename T>
+void scatter(DistTensor<T>& dst,
+             DistTensor<T> const& src,
+             DimensionOrderTuple const& dims)
+{
+  internal::check_redistributing_collective(
+    dst, src, dims, Distribution::Single, Distribution::Block, "scatter");
+  if (src.is_empty())
+  {
+    return;
+  }
+  dst.ensure();
+  if (dst.is_local_empty())
+  {
+    return;
+  }
+  H2_ASSERT_ALWAYS(
+    dst.local_tensor().is_contiguous(),
+    "Cannot scatter into a tensor with non-contiguous local data");
+  Comm& comm = src.proc_grid().get_subcomm(dims);
+  H2_ASSERT_ALWAYS(comm.Rank() != 0 || src.const_data() != nullptr,
+                   "Cannot scatter a tensor with no data");
+  internal::scatter_blocks(dst.local_tensor(),
+                           src.const_local_tensor(),
+                           src.proc_grid(),
+                           dims,
+                           comm);
+}
+
+/**
+ * Broadcast `src`, held by one process, over the processor grid
+ * dimensions `dims` into `dst`.
+ *
+ * Each dimension in `dims` must be `Single` in `src` and `Replicated`
+ * in `dst`; other dimensions must be distributed the same way in both.
+ * `dst` must have the same shape as `src` and a congruent processor
+ * grid, and is allocated if needed. This is, e.g., how weights read on
+ * one process are distributed at startup.
+ *
+ * Rather than one large broadcast, data is sent as a sequence of
+ * chunked broadcasts (see `internal::get_broadcast_chunk_bytes`), a
+ * bounded number of which are in flight at once, so each process
+ * forwards a chunk down the broadcast tree while receiving the next.
+ * GPU data is staged through pinned host memory, and each chunk is
+ * copied to the GPU once it arrives. This uses MPI directly rather
+ * than Aluminum.
+ *
+ * This is collective over the processes that share all coordinates of
+ * the grid not in `dims`. The local tensor of `dst` must be contiguous.
+ * The root synchronizes with `src`'s stream, and every process with
+ * `dst`'s stream before returning.
+ */
+template <typename T>
+void broadcast(DistTensor<T>& dst,
+               DistTensor<T> const& src,
+               DimensionOrderTuple const& dims)
+{
+  internal::check_redistributing_collective(dst,
+                                            src,
+                                            dims,
+                                            Distribution::Single,
+                                            Distribution::Replicated,
+                                            "broadcast",
+                                            false);
+  if (src.is_empty())
+  {
+    return;
+  }
+  dst.ensure();
+  if (dst.is_local_empty())
+  {
+    return;
+  }
+  H2_ASSERT_ALWAYS(
+    dst.local_tensor().is_contiguous(),
+    "Cannot broadcast into a tensor with non-contiguous local data");
+  Comm& comm = src.proc_grid().get_subcomm(dims);
+  H2_ASSERT_ALWAYS(comm.Rank() != 0 || src.const_data() != nullptr,
+                   "Cannot broadcast a tensor with no data");
+  internal::broadcast_local(dst.local_tensor(), src.const_local_tensor(), comm);
+}
+
+/**
+ * Sum the local data of `tensor` in place over the processor grid
+ * dimensions `dims`, sending data at reduced precision.
+ *
+ * This trades accuracy for bandwidth, e.g., for gradient allreduces.
+ * Each process converts its data to the `compression` type, and each
+ * of the `p` processes sums one `1/p` of the data from all processes
+ * in `float` (via an all-to-all), converts the sum, and the sums are
+ * then allgathered and converted back. So only rounding to the
+ * compressed type loses accuracy, never the accumulation.
+ *
+ * If `error_feedback` is given, it is added to `tensor` before the
+ * reduction and is then set to the error compression introduced on
+ * this process, so it is compensated in the next reduction. It must
+ * have the same shape, distribution, and processor grid as `tensor`,
+ * and be zero initially.
+ *
+ * Compression needs the GPU low-precision types (see
+ * `H2_ENABLE_GPU_LOW_PRECISION`). On the CPU, which has no
+ * low-precision compute types, data is sent at full precision and any
+ * `error_feedback` is added to `tensor` and reset to zero.
+ *
+ * The requirements on `tensor` are as for `allreduce`, and
+ * `error_feedback` must also be contiguous.
+ */
+void allreduce_compressed(DistTensor<float>& tensor,
+                          DimensionOrderTuple const& dims,
+                          CommCompression compression,
+                          DistTensor<float>* error_feedback = nullptr);
+
+}  // namespace h2
@@ -0,0 +1,182 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Caches for communication plans of distributed tensors.
+ */
+
+#include "h2/tensor/dist_types.hpp"
+#include "h2/tensor/proc_grid.hpp"
+#include "h2/tensor/tensor_types.hpp"
+#include "h2/utils/environment_vars.hpp"
+#include "h2/utils/lru_cache.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+namespace h2
+{
+namespace internal
+{
+
+/**
+ * Identifies a communication pattern between two layouts of a
+ * distributed tensor, from the perspective of one rank.
+ *
+ * Plans depend on the processor grids only through their shapes,
+ * dimension orders, and the rank, since peers are identified by their
+ * rank in the grid's communicator; grids of different communicators
+ * with the same shape can share plans.
+ */
+struct CommPlanKey
+{
+  ShapeTuple global_shape;
+  ShapeTuple src_grid_shape;
+  ShapeTuple dst_grid_shape;
+  RankType rank;
+  DistributionTypeTuple src_dist;
+  DistributionTypeTuple dst_dist;
+  std::size_t elem_size;
+  DimensionOrderTuple src_grid_order;
+  DimensionOrderTuple dst_grid_order;
+  BlockSizesTuple src_block_sizes;
+  BlockSizesTuple dst_block_sizes;
+};
+
+/** Return the key for a plan moving data from one layout to another. */
+inline CommPlanKey make_comm_plan_key(ShapeTuple const& global_shape,
+                                      ProcessorGrid const& src_grid,
+                                      DistributionTypeTuple const& src_dist,
+                                      ProcessorGrid const& dst_grid,
+                                      DistributionTypeTuple const& dst_dist,
+                                      std::size_t elem_size,
+                                      BlockSizesTuple const& src_block_sizes = {},
+                                      BlockSizesTuple const& dst_block_sizes = {})
+{
+  return CommPlanKey{global_shape,
+                     src_grid.shape(),
+                     dst_grid.shape(),
+                     dst_grid.rank(),
+                     src_dist,
+                     dst_dist,
+                     elem_size,
+                     src_grid.dim_order(),
+                     dst_grid.dim_order(),
+                     src_block_sizes,
+                     dst_block_sizes};
+}
+
+/** Lexicographically compare two tuples. */
+template <typename TupleT>
+inline bool tuple_less(TupleT const& a, TupleT const& b)
+{
+  return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+}
+
+/** Order `CommPlanKey`s for use as map keys. */
+struct CommPlanKeyLess
+{
+  bool operator()(CommPlanKey const& a, CommPlanKey const& b) const
+  {
+    if (a.rank != b.rank || a.elem_size != b.elem_size)
+    {
+      return std::tie(a.rank, a.elem_size) < std::tie(b.rank, b.elem_size);
+    }
+    if (a.global_shape != b.global_shape)
+    {
+      return tuple_less(a.global_shape, b.global_shape);
+    }
+    if (a.src_grid_shape != b.src_grid_shape)
+    {
+      return tuple_less(a.src_grid_shape, b.src_grid_shape);
+    }
+    if (a.dst_grid_shape != b.dst_grid_shape)
+    {
+      return tuple_less(a.dst_grid_shape, b.dst_grid_shape);
+    }
+    if (a.src_dist != b.src_dist)
+    {
+      return tuple_less(a.src_dist, b.src_dist);
+    }
+    if (a.dst_dist != b.dst_dist)
+    {
+      return tuple_less(a.dst_dist, b.dst_dist);
+    }
+    if (a.src_grid_order != b.src_grid_order)
+    {
+      return tuple_less(a.src_grid_order, b.src_grid_order);
+    }
+    if (a.dst_grid_order != b.dst_grid_order)
+    {
+      return tuple_less(a.dst_grid_order, b.dst_grid_order);
+    }
+    return std::tie(a.src_block_sizes, a.dst_block_sizes)
+           < std::tie(b.src_block_sizes, b.dst_block_sizes);
+  }
+};
+
+/**
+ * A thread-safe, bounded cache of communication plans of type `PlanT`.
+ *
+ * Each kind of plan (redistribution, halo exchange, etc.) should have
+ * its own cache. The capacity is set by the `H2_COMM_PLAN_CACHE_SIZE`
+ * environment variable; least recently used plans are evicted first.
+ * Plans are shared, so evicting one does not affect users of it.
+ */
+template <typename PlanT>
+class CommPlanCache
+{
+public:
+  CommPlanCache()
+    : cache(env::get<std::size_t>("COMM_PLAN_CACHE_SIZE"))
+  {}
+
+  /**
+   * Return the plan for `key`, calling `make_plan` to compute it if it
+   * is not cached.
+   */
+  template <typename MakePlanT>
+  std::shared_ptr<PlanT const> get(CommPlanKey const& key,
+                                   MakePlanT&& make_plan)
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (auto* plan = cache.get(key))
+    {
+      return *plan;
+    }
+    auto plan = std::make_shared<PlanT const>(make_plan());
+    cache.insert(key, plan);
+    return plan;
+  }
+
+  /** Return the number of cached plans. */
+  std::size_t size()
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return cache.size();
+  }
+
+  /** Remove all cached plans. */
+  void clear()
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.clear();
+  }
+
+private:
+  std::mutex cache_mutex;
+  LRUCache<CommPlanKey, std::shared_ptr<PlanT const>, CommPlanKeyLess> cache;
+};
+
+}  // namespace internal
+}  // namespace h2
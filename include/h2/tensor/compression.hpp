@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Lossless compression of tensor data for files and transfers.
+ *
+ * Activations are often mostly zeros (e.g., after a ReLU), so
+ * checkpoints and redistributions of them spend most of their
+ * bandwidth on zeros. Zero suppression stores each group of 32 4-byte
+ * words as a bitmask of which words are nonzero followed by only those
+ * words. It is cheap enough to run on host staging buffers at memory
+ * bandwidth, in parallel on the CPU thread pool.
+ *
+ * Compressed data is a sequence of independent frames, each covering
+ * up to `compression_block_bytes` of the input and either compressed
+ * or stored as-is. A probe samples the input first, and if compression
+ * is unlikely to save at least `H2_COMPRESSION_MAX_RATIO` of its size,
+ * it is stored without trying, so incompressible data costs little
+ * more than a copy.
+ *
+ * Whether to compress is set by `H2_COMPRESSION` ("none" or "zeros"),
+ * and only data of at least `H2_COMPRESSION_THRESHOLD` bytes is
+ * compressed (see `use_compression`).
+ */
+
+#include <h2_config.hpp>
+
+#include <cstddef>
+#include <ostream>
+
+namespace h2
+{
+
+/** Lossless compression methods for tensor data. */
+enum class DataCompression
+{
+  /** Data is stored as-is. */
+  None,
+  /** Zero words are suppressed with a bitmask. */
+  Zeros
+};
+
+inline std::ostream& operator<<(std::ostream& os, DataCompression compression)
+{
+  switch (compression)
+  {
+  case DataCompression::None: os << "None"; break;
+  case DataCompression::Zeros: os << "Zeros"; break;
+  default: os << "Unknown"; break;
+  }
+  return os;
+}
+
+/**
+ * Return the compression used for large tensor files and transfers.
+ *
+ * Environment variable: H2_COMPRESSION ("none" or "zeros")
+ */
+DataCompression get_data_compression();
+
+/**
+ * Return whether `bytes` of data should be compressed when written to
+ * a file or transferred.
+ *
+ * This is true if `get_data_compression()` is not `None` and `bytes`
+ * is at least `H2_COMPRESSION_THRESHOLD`.
+ */
+bool use_compression(std::size_t bytes);
+
+namespace internal
+{
+
+/** Largest input covered by one compressed frame. */
+inline constexpr std::size_t compression_block_bytes = std::size_t{1} << 20;
+
+/**
+ * Return the estimated ratio of compressed to original size for the
+ * `bytes` at `buf`, from a sample of it.
+ */
+double estimate_compression_ratio(void const* buf, std::size_t bytes);
+
+/** Return the most bytes `compress` may produce for `bytes` of input. */
+std::size_t get_max_compressed_size(std::size_t bytes);
+
+/**
+ * Compress the `bytes` at `src` into `dst`, which must have room for
+ * `get_max_compressed_size(bytes)` bytes, and return the size of the
+ * compressed data.
+ */
+std::size_t compress(void* dst, void const* src, std::size_t bytes);
+
+/**
+ * Decompress the `compressed_bytes` at `src`, which came from
+ * `compress`, into the `bytes` at `dst`.
+ *
+ * It is an error if the data does not decompress to exactly `bytes`.
+ */
+void decompress(void* dst,
+                std::size_t bytes,
+                void const* src,
+                std::size_t compressed_bytes);
+
+}  // namespace internal
+
+}  // namespace h2
@@ -14,11 +14,13 @@
 
 #include <h2_config.hpp>
 
+#include "h2/core/dispatch.hpp"
 #include "h2/tensor/copy_buffer.hpp"
 #include "h2/tensor/dist_tensor.hpp"
 #include "h2/tensor/tensor.hpp"
 #include "h2/tensor/tensor_types.hpp"
 
+#include <cstdint>
 #include <memory>
 #include <type_traits>
 
@@ -29,15 +31,81 @@
 namespace h2
 {
 
+namespace impl
+{
+
+template <typename DstT, typename SrcT>
+void cast_impl(CPUDev_t, Tensor<DstT>& dst, Tensor<SrcT> const& src);
+#ifdef H2_HAS_GPU
+template <typename DstT, typename SrcT>
+void cast_impl(GPUDev_t, Tensor<DstT>& dst, const Tensor<SrcT>& src);
+#endif
+
+template <typename DstT, typename SrcT>
+void cast_scale_bias_impl(CPUDev_t,
+                          Tensor<DstT>& dst,
+                          Tensor<SrcT> const& src,
+                          DstT scale,
+                          DstT bias);
+#ifdef H2_HAS_GPU
+template <typename DstT, typename SrcT>
+void cast_scale_bias_impl(GPUDev_t,
+                          Tensor<DstT>& dst,
+                          Tensor<SrcT> const& src,
+                          DstT scale,
+                          DstT bias);
+#endif
+
+/** Scale and bias passed to `cast_scale_bias` kernels as an immediate. */
+template <typename T>
+struct ScaleBias
+{
+  T scale;
+  T bias;
+};
+
+#define H2_INSTANTIATE_CAST_SCALE_BIAS_DST_(device, t1)                        \
+  PROTO(device, t1, float);                                                    \
+  PROTO(device, t1, double);                                                   \
+  PROTO(device, t1, std::int8_t);                                              \
+  PROTO(device, t1, std::uint8_t);                                             \
+  PROTO(device, t1, std::int16_t);                                             \
+  PROTO(device, t1, std::uint16_t);                                            \
+  PROTO(device, t1, std::int32_t);                                             \
+  PROTO(device, t1, std::uint32_t)
+
+/**
+ * Instantiate `PROTO(device, DstT, SrcT)` for every pair of types
+ * supported by `cast_scale_bias`.
+ */
+#define H2_INSTANTIATE_CAST_SCALE_BIAS(device)                                 \
+  H2_INSTANTIATE_CAST_SCALE_BIAS_DST_(device, float);                          \
+  H2_INSTANTIATE_CAST_SCALE_BIAS_DST_(device, double)
+
+}  // namespace impl
+
 namespace internal
 {
 
 void copy_same_type(BaseTensor& dst, BaseTensor const& src);
 
+/**
+ * Copy and convert `src` into `dst` (of a different compute type),
+ * resizing `dst` as in `copy_same_type`.
+ */
+void copy_convert(BaseTensor& dst, BaseTensor const& src);
+
+/**
+ * Copy and convert `src` into `dst`, which must already have the same
+ * shape.
+ */
+void convert_data(BaseTensor& dst, BaseTensor const& src);
+
 template <typename T>
 void copy_same_type(DistTensor<T>& dst, DistTensor<T> const& src)
 {
-  dst.resize(src.shape(), src.dim_types(), src.distribution());
+  dst.resize(
+    src.shape(), src.dim_types(), src.distribution(), src.block_sizes());
   dst.ensure();
   if (src.is_local_empty())
   {
@@ -55,10 +123,95 @@ void copy_same_type(DistTensor<T>& dst, DistTensor<T> const& src)
   }
   else
   {
-    // TODO: This requires support for resizing while specifying the
-    // strides of the local tensor, which we don't currently have.
-    throw H2Exception("Copying distributed tensors with non-contiguous local "
-                      "data is not supported");
+    // We cannot yet resize with the strides of the local tensor, so
+    // gather into the contiguous local tensor instead.
+    copy_strided_buffer<T>(dst_local.data(),
+                           dst_local.strides(),
+                           dst_local.get_stream(),
+                           src_local.const_data(),
+                           src_local.strides(),
+                           src_local.get_stream(),
+                           src_local.shape());
+  }
+}
+
+/**
+ * Copy the local part of a distributed tensor, `src_local`, which is
+ * distributed with `src_dist` over `src_grid`, into `dst_local`, the
+ * local part of the same global tensor distributed with `dst_dist`
+ * over `dst_grid`.
+ *
+ * Each process sends the parts of its (canonical) block that other
+ * processes need directly to them, and only those, in one
+ * `MPI_Alltoallv`. The plan of what to exchange is cached. Both local
+ * tensors must have the same type and the right local shape, and may
+ * have arbitrary strides. The grids must be similar.
+ *
+ * Variable dimensions are described by `dst_block_sizes` and
+ * `src_block_sizes`.
+ *
+ * This is collective over the grid and synchronizes with the streams
+ * of both local tensors.
+ */
+void redistribute(BaseTensor& dst_local,
+                  ProcessorGrid const& dst_grid,
+                  DistributionTypeTuple const& dst_dist,
+                  BaseTensor const& src_local,
+                  ProcessorGrid const& src_grid,
+                  DistributionTypeTuple const& src_dist,
+                  ShapeTuple const& global_shape,
+                  BlockSizesTuple const& dst_block_sizes = {},
+                  BlockSizesTuple const& src_block_sizes = {});
+
+/**
+ * Resize `dst` to `src`'s shape with distribution `dist` (and block
+ * sizes `block_sizes`) and copy the data of `src` into it,
+ * redistributing as needed.
+ */
+template <typename DstT, typename SrcT>
+void redistribute_copy(DistTensor<DstT>& dst,
+                       DistTensor<SrcT> const& src,
+                       DistributionTypeTuple const& dist,
+                       BlockSizesTuple const& block_sizes = {})
+{
+  dst.resize(src.shape(), src.dim_types(), dist, block_sizes);
+  dst.ensure();
+  if constexpr (std::is_same_v<SrcT, DstT>)
+  {
+    redistribute(dst.local_tensor(),
+                 dst.proc_grid(),
+                 dist,
+                 src.local_tensor(),
+                 src.proc_grid(),
+                 src.distribution(),
+                 src.shape(),
+                 block_sizes,
+                 src.block_sizes());
+  }
+  else
+  {
+    // Redistribute first, then convert locally.
+    DistTensor<SrcT> tmp(dst.get_device(),
+                         src.shape(),
+                         src.dim_types(),
+                         dst.proc_grid(),
+                         dist,
+                         block_sizes,
+                         StrictAlloc,
+                         dst.get_stream());
+    redistribute(tmp.local_tensor(),
+                 tmp.proc_grid(),
+                 dist,
+                 src.local_tensor(),
+                 src.proc_grid(),
+                 src.distribution(),
+                 src.shape(),
+                 block_sizes,
+                 src.block_sizes());
+    if (!tmp.is_local_empty())
+    {
+      convert_data(dst.local_tensor(), tmp.local_tensor());
+    }
   }
 }
 
@@ -72,10 +225,24 @@ void copy_same_type(DistTensor<T>& dst, DistTensor<T> const& src)
  * possible. This will preserve strides, i.e., if `src` is not
  * contiguous, then `dst` will be too.
  *
- * If GPU buffers are involved, this will be asynchronous.
+ * If `dst` is a view, it cannot be resized, so it must have the same
+ * shape as `src`, and the data is copied into the viewed elements
+ * (with `dst`'s strides, which may differ from `src`'s). This may be
+ * used, e.g., to fill a halo region or sub-volume of a larger tensor.
+ * Non-contiguous data is copied with `copy_strided_buffer`.
+ *
+ * On one device, conversion is fused with the copy: each element is
+ * converted as it is copied. Between devices, data is converted into a
+ * contiguous temporary on whichever side makes the transferred data
+ * narrower (on the GPU, if the types are the same size), e.g., double
+ * host data is converted to float on the host before it is sent to a
+ * float GPU tensor. Converting data from the GPU on the host
+ * synchronizes with `src`'s stream.
  *
- * Conversion will only be performed if `SrcT` and `DstT` are
- * dynamically dispatchable.
+ * Otherwise, if GPU buffers are involved, this will be asynchronous.
+ *
+ * Conversion requires both types to be compute types, and uses the
+ * same implementations as `cast`.
  */
 template <typename DstT, typename SrcT>
 void copy(Tensor<DstT>& dst, Tensor<SrcT> const& src)
@@ -95,7 +262,7 @@ void copy(Tensor<DstT>& dst, Tensor<SrcT> const& src)
   }
   else
   {
-    throw H2Exception("Data type conversion in copy not currently supported");
+    internal::copy_convert(dst, src);
   }
 }
 
@@ -114,39 +281,38 @@ inline void copy(BaseTensor& dst, BaseTensor const& src)
   }
   else
   {
-    throw H2Exception("Data type conversion in copy not currently supported");
+    internal::copy_convert(dst, src);
   }
 }
 
 /**
  * Copy the contents of distributed tensor `src` to `dst`.
  *
- * `dst` will be resized and have its distribution and dimension types
- * changed to match `src`. If `SrcT` and `DstT` differ, data will be
- * converted, if possible. This will preserve strides in local tensors,
- * similar to `copy` for `Tensor`s.
- *
- * If GPU buffers are involved, this will be asynchronous.
+ * `dst` will be resized and have its dimension types changed to match
+ * `src`. If `SrcT` and `DstT` differ, data will be converted, if
+ * possible.
  *
- * Note this is a purely local operation, since it cannot change the
- * distribution of data; any contents in `dst` are simply discarded.
- * However, it should still be considered collective: every process in
- * `src`'s processor grid must call this with the same `src` and `dst`
- * tensors or things will become inconsistent. Further, `src` and `dst`
- * must have congruent processor grids (if they do not, the previous
- * requirement will not be satisfied).
+ * If `dst` already has the same global shape as `src`, it keeps its
+ * distribution; otherwise (including when it is empty) it takes
+ * `src`'s distribution. `dst` always keeps its processor grid. When
+ * this leaves both tensors with the same distribution over congruent
+ * grids, this is a purely local copy, which preserves strides in local
+ * tensors similar to `copy` for `Tensor`s and, if GPU buffers are
+ * involved, is asynchronous. Otherwise, the data is redistributed (see
+ * `redistribute`); local tensors may be strided in either case.
  *
- * This will not change the processor grid of `dst`.
+ * In either case this should be considered collective: every process
+ * in `src`'s processor grid must call this with the same `src` and
+ * `dst` tensors or things will become inconsistent. Further, `src` and
+ * `dst` must have similar processor grids (the same processes in the
+ * same order, but the shapes may differ).
  */
 template <typename DstT, typename SrcT>
 void copy(DistTensor<DstT>& dst, DistTensor<SrcT> const& src)
 {
-  // One could support copying between "similar" grids (same underlying
-  // processes, different shape), but I don't see a use for that right
-  // now.
   H2_ASSERT_DEBUG(
-    src.proc_grid().is_congruent_to(dst.proc_grid()),
-    "Cannot copy between DistTensors on non-congruent processor grids");
+    src.proc_grid().is_similar_to(dst.proc_grid()),
+    "Cannot copy between DistTensors on grids of different processes");
   // Copying an empty tensor simply clears it.
   if (src.is_empty())
   {
@@ -155,17 +321,79 @@ void copy(DistTensor<DstT>& dst, DistTensor<SrcT> const& src)
   }
   H2_ASSERT_ALWAYS(src.is_local_empty() || src.const_data() != nullptr,
                    "Cannot copy a non-empty distributed tensor with no data");
-  if constexpr (std::is_same_v<SrcT, DstT>)
+  bool const keep_dist = !dst.is_empty() && dst.shape() == src.shape();
+  DistributionTypeTuple const dist =
+    keep_dist ? dst.distribution() : src.distribution();
+  BlockSizesTuple const block_sizes =
+    keep_dist ? dst.block_sizes() : src.block_sizes();
+  if (dist != src.distribution() || block_sizes != src.block_sizes()
+      || !src.proc_grid().is_congruent_to(dst.proc_grid()))
+  {
+    internal::redistribute_copy(dst, src, dist, block_sizes);
+  }
+  else if constexpr (std::is_same_v<SrcT, DstT>)
   {
     internal::copy_same_type<DstT>(dst, src);
   }
   else
   {
-    throw H2Exception(
-      "Data type conversion is copy is not currently supported");
+    dst.resize(
+      src.shape(), src.dim_types(), src.distribution(), src.block_sizes());
+    dst.ensure();
+    if (!src.is_local_empty())
+    {
+      internal::convert_data(dst.local_tensor(), src.local_tensor());
+    }
   }
 }
 
+/**
+ * Redistribute the data of distributed tensor `src` into `dst`.
+ *
+ * `dst` must have the same global shape as `src`, but may have any
+ * distribution and its processor grid may have any shape. Unlike
+ * `copy`, `dst` is never resized and always keeps its distribution,
+ * so this is the way to move data from one layout to another.
+ *
+ * Each process computes which parts of its local data other processes
+ * need from the overlaps of the global index ranges of every pair of
+ * processes, packs them with `copy_strided_buffer`, and exchanges them
+ * with a single all-to-all. This communication plan is computed once
+ * and cached for later redistributions with the same shapes, grids,
+ * distributions, and type (in a bounded cache; see
+ * `internal::CommPlanCache`). Local tensors may be strided.
+ *
+ * This is collective over the processor grid, which must be similar
+ * for both tensors, and synchronizes with both tensors' streams.
+ */
+template <typename T>
+void redistribute(DistTensor<T>& dst, DistTensor<T> const& src)
+{
+  H2_ASSERT_ALWAYS(
+    dst.shape() == src.shape(),
+    "Cannot redistribute between tensors of different shapes (",
+    src.shape(),
+    " and ",
+    dst.shape(),
+    ")");
+  if (src.is_empty())
+  {
+    return;
+  }
+  H2_ASSERT_ALWAYS(src.is_local_empty() || src.const_data() != nullptr,
+                   "Cannot redistribute a distributed tensor with no data");
+  dst.ensure();
+  internal::redistribute(dst.local_tensor(),
+                         dst.proc_grid(),
+                         dst.distribution(),
+                         src.local_tensor(),
+                         src.proc_grid(),
+                         src.distribution(),
+                         src.shape(),
+                         dst.block_sizes(),
+                         src.block_sizes());
+}
+
 /**
  * Return a version of tensor src that is accessible from a device.
  *
@@ -183,6 +411,14 @@ void copy(DistTensor<DstT>& dst, DistTensor<SrcT> const& src)
  * will be as follows:
  * - If `src` is already on `dev`, `src`'s stream will be used.
  * - Otherwise, `dev`'s default stream will be used.
+ *
+ * If a copy is made while a `ScratchArenaScope` is active for `dev`,
+ * its memory comes from the scope's arena.
+ *
+ * If `src` has its mirror cache enabled (see `Tensor::set_mirror_cache`),
+ * the copy is of `src`'s entire underlying buffer and is kept, and
+ * later calls return a view of it without copying until either `src`
+ * or the copy is modified.
  */
 template <typename T>
 std::unique_ptr<Tensor<T>> make_accessible_on_device(
@@ -207,6 +443,11 @@ std::unique_ptr<Tensor<T>> make_accessible_on_device(
     // Return a view with the device changed.
     return std::make_unique<Tensor<T>>(src, dev, real_stream);
   }
+  else if (src.is_mirror_cache_enabled() && src.const_data() != nullptr)
+  {
+    // Return the cached copy, copying only if it is stale.
+    return src.mirror(dev, real_stream);
+  }
   else
   {
     // Return a copy.
@@ -246,6 +487,10 @@ std::unique_ptr<Tensor<T>> make_accessible_on_device(
   {
     return std::make_unique<Tensor<T>>(src, dev, real_stream);
   }
+  else if (src.is_mirror_cache_enabled() && src.const_data() != nullptr)
+  {
+    return src.mirror(dev, real_stream);
+  }
   else
   {
     auto dst = std::make_unique<Tensor<T>>(
@@ -258,17 +503,9 @@ std::unique_ptr<Tensor<T>> make_accessible_on_device(
 #endif  // H2_HAS_GPU
 }
 
-namespace impl
-{
-
-template <typename DstT, typename SrcT>
-void cast_impl(CPUDev_t, Tensor<DstT>& dst, Tensor<SrcT> const& src);
-#ifdef H2_HAS_GPU
-template <typename DstT, typename SrcT>
-void cast_impl(GPUDev_t, Tensor<DstT>& dst, const Tensor<SrcT>& src);
-#endif
-
-}  // namespace impl
+/** Version of `cast` for `BaseTensor`s. */
+template <typename DstT>
+std::unique_ptr<Tensor<DstT>> cast(BaseTensor& src);
 
 /**
  * Return a version of tensor `src` with its type converted to `DstT`.
@@ -278,7 +515,11 @@ void cast_impl(GPUDev_t, Tensor<DstT>& dst, const Tensor<SrcT>& src);
  * except for its type, and each element of `src` will be converted to
  * an element of `DstT`.
  *
- * This requires `SrcT` and `DstT` to be compute types.
+ * This requires `SrcT` and `DstT` to be compute types. If they are not
+ * in `NativeDispatchPairs`, the conversion uses registered dispatch.
+ *
+ * If a `ScratchArenaScope` is active for `src`'s device, the new
+ * tensor's memory comes from the scope's arena.
  */
 template <typename DstT, typename SrcT>
 std::unique_ptr<Tensor<DstT>> cast(Tensor<SrcT>& src)
@@ -287,16 +528,23 @@ std::unique_ptr<Tensor<DstT>> cast(Tensor<SrcT>& src)
   {
     return src.view();
   }
-
-  auto dst = std::make_unique<Tensor<DstT>>(src.get_device(),
-                                            src.shape(),
-                                            src.dim_types(),
-                                            src.strides(),
-                                            StrictAlloc,
-                                            src.get_stream());
-  H2_DEVICE_DISPATCH_SAME(src.get_device(),
-                          impl::cast_impl(DeviceT_v<Dev>, *dst, src));
-  return dst;
+  else if constexpr (!IsNativeDispatchPair_v<DstT, SrcT>)
+  {
+    // There is no native implementation, use registered dispatch.
+    return cast<DstT>(static_cast<BaseTensor&>(src));
+  }
+  else
+  {
+    auto dst = std::make_unique<Tensor<DstT>>(src.get_device(),
+                                              src.shape(),
+                                              src.dim_types(),
+                                              src.strides(),
+                                              StrictAlloc,
+                                              src.get_stream());
+    H2_DEVICE_DISPATCH_SAME(src.get_device(),
+                            impl::cast_impl(DeviceT_v<Dev>, *dst, src));
+    return dst;
+  }
 }
 
 /** Version of `cast` for const tensors. */
@@ -307,23 +555,75 @@ std::unique_ptr<Tensor<DstT>> cast(Tensor<SrcT> const& src)
   {
     return src.const_view();
   }
-
-  auto dst = std::make_unique<Tensor<DstT>>(src.get_device(),
-                                            src.shape(),
-                                            src.dim_types(),
-                                            src.strides(),
-                                            StrictAlloc,
-                                            src.get_stream());
-  H2_DEVICE_DISPATCH_SAME(src.get_device(),
-                          impl::cast_impl(DeviceT_v<Dev>, *dst, src));
-  return dst;
+  else if constexpr (!IsNativeDispatchPair_v<DstT, SrcT>)
+  {
+    // There is no native implementation, use registered dispatch.
+    return cast<DstT>(static_cast<BaseTensor&>(const_cast<Tensor<SrcT>&>(src)));
+  }
+  else
+  {
+    auto dst = std::make_unique<Tensor<DstT>>(src.get_device(),
+                                              src.shape(),
+                                              src.dim_types(),
+                                              src.strides(),
+                                              StrictAlloc,
+                                              src.get_stream());
+    H2_DEVICE_DISPATCH_SAME(src.get_device(),
+                            impl::cast_impl(DeviceT_v<Dev>, *dst, src));
+    return dst;
+  }
 }
 
-/** Version of `cast` for `BaseTensor`s. */
-template <typename DstT>
-std::unique_ptr<Tensor<DstT>> cast(BaseTensor& src);
-
 /** Fully runtime version of `cast`. */
 std::unique_ptr<BaseTensor> cast(TypeInfo const& type, BaseTensor& src);
 
+/**
+ * Convert each element of `src` to `DstT` and store `scale * x + bias`
+ * in `dst`.
+ *
+ * This fuses the conversion of ingested data with its normalization,
+ * e.g., of 16-bit integer volumes into normalized floats. `DstT` must
+ * be `float` or `double`, and `SrcT` may also be an 8-, 16- or 32-bit
+ * integer type.
+ *
+ * `dst` is resized like in `copy`, and must be on the same device as
+ * `src`. On GPUs, this is asynchronous.
+ */
+template <typename DstT, typename SrcT>
+void cast_scale_bias(Tensor<DstT>& dst,
+                     Tensor<SrcT> const& src,
+                     DstT scale,
+                     DstT bias)
+{
+  static_assert(std::is_floating_point_v<DstT>,
+                "cast_scale_bias needs a floating point destination");
+  H2_ASSERT_ALWAYS(dst.get_device() == src.get_device(),
+                   "Cannot cast_scale_bias from ",
+                   src.get_device(),
+                   " to ",
+                   dst.get_device());
+  if (src.is_empty())
+  {
+    dst.empty();
+    return;
+  }
+  if (dst.is_view())
+  {
+    H2_ASSERT_ALWAYS(!dst.is_const_view(), "Cannot write into a const view");
+    H2_ASSERT_ALWAYS(dst.shape() == src.shape(),
+                     "Cannot cast_scale_bias a tensor of shape ",
+                     src.shape(),
+                     " into a view of shape ",
+                     dst.shape());
+  }
+  else
+  {
+    dst.resize(src.shape(), src.dim_types(), src.strides());
+    dst.ensure();
+  }
+  H2_DEVICE_DISPATCH_SAME(
+    src.get_device(),
+    impl::cast_scale_bias_impl(DeviceT_v<Dev>, dst, src, scale, bias));
+}
+
 }  // namespace h2
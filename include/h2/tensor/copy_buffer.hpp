@@ -14,8 +14,11 @@
 
 #include <h2_config.hpp>
 
+#include "h2/core/profiling.hpp"
 #include "h2/core/sync.hpp"
+#include "h2/core/tracer.hpp"
 #include "h2/core/types.hpp"
+#include "h2/tensor/tensor_types.hpp"
 
 #include <cstring>
 #include <type_traits>
@@ -27,10 +30,68 @@
 namespace h2
 {
 
+#ifdef H2_HAS_GPU
+namespace internal
+{
+
+/**
+ * Return true if a copy of `bytes` between the GPU and the host memory
+ * at `host_ptr` should use `copy_buffer_pipelined`.
+ *
+ * This is the case for pageable host memory when `bytes` exceeds
+ * `H2_COPY_PIPELINE_THRESHOLD`.
+ */
+bool use_pipelined_copy(void const* host_ptr, std::size_t bytes);
+
+/**
+ * Copy `bytes` between pageable host memory and the GPU in chunks of
+ * `H2_COPY_PIPELINE_CHUNK` bytes, staged through two pinned buffers.
+ *
+ * Each staging buffer is used by its own stream, so the host `memcpy`
+ * of one chunk into (or out of) a staging buffer overlaps with the DMA
+ * of the previous chunk from (or into) the other. The pool stream is
+ * ordered after prior work on the GPU stream and before later work on
+ * it. This returns once the copy is complete.
+ */
+void copy_buffer_pipelined(void* dst,
+                           ComputeStream const& dst_stream,
+                           void const* src,
+                           ComputeStream const& src_stream,
+                           std::size_t bytes);
+
+/**
+ * Copy `bytes` from `src` to `dst` with a peer-to-peer copy if they
+ * are on different GPUs, returning false (and doing nothing) if they
+ * are on the same GPU.
+ *
+ * The streams must be on the GPUs of their buffers. The copy runs on
+ * `dst_stream` after prior work on `src_stream`, and later work on
+ * `src_stream` waits for it. Peer access between the GPUs is enabled
+ * the first time they copy to each other, if the system supports it;
+ * otherwise the runtime stages the copy through the host.
+ */
+bool copy_buffer_peer(void* dst,
+                      ComputeStream const& dst_stream,
+                      void const* src,
+                      ComputeStream const& src_stream,
+                      std::size_t bytes);
+
+}  // namespace internal
+#endif  // H2_HAS_GPU
+
 /**
  * Copy count elements from src to dst.
  *
- * If GPU buffers are involved, this will be asynchronous.
+ * If GPU buffers are involved, this will be asynchronous. Large copies
+ * between the GPU and pageable host memory are pipelined through
+ * pinned staging buffers (see `internal::copy_buffer_pipelined`),
+ * which synchronizes the host with the copy; smaller ones may be
+ * staged through a driver buffer. Use `MemoryKind::Pinned` host memory
+ * to avoid both.
+ *
+ * Buffers on different GPUs are copied peer-to-peer (see
+ * `internal::copy_buffer_peer`); each stream must be on the GPU of its
+ * buffer.
  */
 template <typename T>
 void copy_buffer(T* dst,
@@ -39,6 +100,7 @@ void copy_buffer(T* dst,
                  ComputeStream const& src_stream,
                  std::size_t count)
 {
+  H2_PROFILE_RANGE("h2::copy_buffer", Copy);
   H2_ASSERT_DEBUG(count == 0 || (dst != nullptr && src != nullptr),
                   "Null buffers");
   // TODO: Debug check: Assert buffers do not overlap.
@@ -46,20 +108,27 @@ void copy_buffer(T* dst,
                 "Attempt to copy a buffer with a non-storage type");
   Device const src_dev = src_stream.get_device();
   Device const dst_dev = dst_stream.get_device();
+  std::size_t bytes = count;
+  if constexpr (!std::is_same_v<T*, void*>)
+  {
+    bytes *= sizeof(T);
+  }
+  // Trace on the stream the copy is enqueued on.
+  H2_TRACE_SCOPE("h2::copy_buffer",
+                 Copy,
+                 (dst_dev != Device::CPU) ? dst_stream : src_stream,
+                 bytes);
   if (src_dev == Device::CPU && dst_dev == Device::CPU)
   {
-    if constexpr (std::is_same_v<T*, void*>)
-    {
-      std::memcpy(dst, src, count);
-    }
-    else
-    {
-      std::memcpy(dst, src, count * sizeof(T));
-    }
+    std::memcpy(dst, src, bytes);
   }
 #ifdef H2_HAS_GPU
   else if (src_dev == Device::GPU && dst_dev == Device::GPU)
   {
+    if (internal::copy_buffer_peer(dst, dst_stream, src, src_stream, bytes))
+    {
+      return;
+    }
     auto stream = create_multi_sync(dst_stream, src_stream);
     gpu::mem_copy(dst, src, count, stream.get_stream<Device::GPU>());
   }
@@ -67,11 +136,21 @@ void copy_buffer(T* dst,
   {
     // No sync needed in this case: The CPU is always synchronized and
     // the copy will be enqueued on the destination GPU stream.
+    if (internal::use_pipelined_copy(src, bytes))
+    {
+      internal::copy_buffer_pipelined(dst, dst_stream, src, src_stream, bytes);
+      return;
+    }
     gpu::mem_copy(dst, src, count, dst_stream.get_stream<Device::GPU>());
   }
   else if (src_dev == Device::GPU && dst_dev == Device::CPU)
   {
     // No sync needed: Ditto.
+    if (internal::use_pipelined_copy(dst, bytes))
+    {
+      internal::copy_buffer_pipelined(dst, dst_stream, src, src_stream, bytes);
+      return;
+    }
     gpu::mem_copy(dst, src, count, src_stream.get_stream<Device::GPU>());
   }
 #endif
@@ -81,4 +160,82 @@ void copy_buffer(T* dst,
   }
 }
 
+/**
+ * Copy a strided buffer of the given shape from `src` to `dst`.
+ *
+ * Each buffer is accessed with its own strides (counted in elements of
+ * `elem_size` bytes), so this may, e.g., gather a view into a
+ * contiguous buffer, scatter a contiguous buffer into a view, or
+ * transpose. `dst` must not have 0 strides in dimensions of extent
+ * greater than 1.
+ *
+ * Contiguous dimensions are collapsed first, so if both buffers turn
+ * out to be contiguous, this is the same as `copy_buffer`. Otherwise:
+ * - On the CPU, contiguous rows are copied with `memcpy` and other
+ *   layouts are copied in cache-sized tiles, multithreaded.
+ * - When GPU buffers are involved and the layout is (at most) 3D with
+ *   contiguous rows, a pitched 2D/3D copy is used, which also works
+ *   between devices.
+ * - On the GPU, layouts where `dst` and `src` are contiguous in
+ *   different dimensions (i.e., transposes) use a kernel that
+ *   transposes tiles in shared memory, and other layouts use a strided
+ *   element-wise kernel.
+ * - Other copies between devices are staged through contiguous
+ *   temporary buffers. Those from the GPU to the CPU then synchronize
+ *   with `src_stream`.
+ *
+ * Otherwise, this is asynchronous when GPU buffers are involved, as
+ * in `copy_buffer`.
+ */
+void copy_strided_buffer(void* dst,
+                         StrideTuple const& dst_strides,
+                         ComputeStream const& dst_stream,
+                         void const* src,
+                         StrideTuple const& src_strides,
+                         ComputeStream const& src_stream,
+                         ShapeTuple const& shape,
+                         std::size_t elem_size);
+
+/** Typed version of `copy_strided_buffer`. */
+template <typename T>
+void copy_strided_buffer(T* dst,
+                         StrideTuple const& dst_strides,
+                         ComputeStream const& dst_stream,
+                         T const* src,
+                         StrideTuple const& src_strides,
+                         ComputeStream const& src_stream,
+                         ShapeTuple const& shape)
+{
+  static_assert(IsH2StorageType_v<T>,
+                "Attempt to copy a buffer with a non-storage type");
+  copy_strided_buffer(static_cast<void*>(dst),
+                      dst_strides,
+                      dst_stream,
+                      static_cast<void const*>(src),
+                      src_strides,
+                      src_stream,
+                      shape,
+                      sizeof(T));
+}
+
+#ifdef H2_HAS_GPU
+namespace internal
+{
+
+/**
+ * Copy between strided GPU buffers with a tiled transpose or
+ * element-wise kernel, treating elements as unsigned integers of
+ * `word_size` bytes.
+ */
+void copy_strided_buffer_gpu(void* dst,
+                             StrideTuple const& dst_strides,
+                             void const* src,
+                             StrideTuple const& src_strides,
+                             ShapeTuple const& shape,
+                             std::size_t word_size,
+                             ComputeStream const& stream);
+
+}  // namespace internal
+#endif  // H2_HAS_GPU
+
 }  // namespace h2
@@ -0,0 +1,264 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Batched mapping between global indices of a distributed tensor and
+ * owning ranks and local offsets.
+ *
+ * These are bulk versions of `internal::global2rank`,
+ * `internal::global2local_index`, and `internal::local2global_index`
+ * for, e.g., scattering sparse samples into a distributed tensor. They
+ * run on the CPU (multithreaded, with loops simple enough to be
+ * vectorized) or as GPU kernels.
+ *
+ * Batches of global indices are stored dimension by dimension: The
+ * index of point `i` in dimension `d` of a batch of `count` points is
+ * at `global_indices[d * count + i]`.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/gpu/macros.hpp"
+#include "h2/tensor/dist_types.hpp"
+#include "h2/tensor/proc_grid.hpp"
+#include "h2/tensor/tensor_types.hpp"
+
+#include <cstddef>
+
+namespace h2
+{
+
+namespace internal
+{
+
+/** How to map global indices of one dimension to their owner. */
+struct DimGlobal2OwnerMap
+{
+  Distribution dist;
+  DimType dim_size;
+  DimType grid_dim_size;
+  /** Rank owning Replicated or Single dimensions. */
+  RankType fixed_rank;
+  /** Stride of the dimension in the processor grid. */
+  RankType grid_stride;
+};
+
+/** How to map global indices to their owners. */
+struct Global2OwnerMap
+{
+  DimGlobal2OwnerMap dims[MAX_TENSOR_DIMS];
+  NDimType ndim;
+};
+
+/** How to map local indices of one dimension of a rank to global. */
+struct DimLocal2GlobalMap
+{
+  DimType local_size;
+  /** Global index of local index 0. */
+  DimType start;
+  /** Distance between global indices of consecutive local indices. */
+  DimType step;
+};
+
+/** How to map local offsets of a rank to global indices. */
+struct Local2GlobalMap
+{
+  DimLocal2GlobalMap dims[MAX_TENSOR_DIMS];
+  NDimType ndim;
+};
+
+/**
+ * Set up mapping global indices of a tensor with the given global
+ * shape and distribution on a grid of shape `grid_shape` and strides
+ * `grid_strides` to their owners.
+ *
+ * Replicated dimensions are owned by the process at `coords` in them.
+ */
+Global2OwnerMap make_global2owner_map(ShapeTuple const& global_shape,
+                                      ShapeTuple const& grid_shape,
+                                      NDimTuple<RankType> const& grid_strides,
+                                      ScalarIndexTuple const& coords,
+                                      DistributionTypeTuple const& dist);
+
+/**
+ * Set up mapping local offsets of the process at grid coordinates
+ * `coords` to global indices.
+ */
+Local2GlobalMap make_local2global_map(ShapeTuple const& global_shape,
+                                      ShapeTuple const& grid_shape,
+                                      ScalarIndexTuple const& coords,
+                                      DistributionTypeTuple const& dist);
+
+/**
+ * Return the dimension rank owning `global_index` and set
+ * `local_index` and `local_size` to its index in, and the size of,
+ * that rank's local dimension.
+ */
+H2_GPU_HOST_DEVICE inline RankType
+dim_global2owner(DimGlobal2OwnerMap const& map,
+                 DimType global_index,
+                 DimType& local_index,
+                 DimType& local_size)
+{
+  switch (map.dist)
+  {
+  case Distribution::Block:
+  {
+    DimType const block_size = map.dim_size / map.grid_dim_size;
+    DimType const remainder = map.dim_size % map.grid_dim_size;
+    DimType const split = (block_size + 1) * remainder;
+    if (global_index < split)
+    {
+      local_index = global_index % (block_size + 1);
+      local_size = block_size + 1;
+      return global_index / (block_size + 1);
+    }
+    local_index = (global_index - split) % block_size;
+    local_size = block_size;
+    return (global_index - split) / block_size + remainder;
+  }
+  case Distribution::Cyclic:
+  {
+    RankType const rank = global_index % map.grid_dim_size;
+    local_index = global_index / map.grid_dim_size;
+    local_size = (map.dim_size - rank + map.grid_dim_size - 1)
+                 / map.grid_dim_size;
+    return rank;
+  }
+  default:  // Replicated and Single.
+    local_index = global_index;
+    local_size = map.dim_size;
+    return map.fixed_rank;
+  }
+}
+
+/**
+ * Map the global index of point `i` in a batch of `count` to its owner
+ * rank and the offset in the owner's (contiguous) local tensor.
+ */
+H2_GPU_HOST_DEVICE inline void
+global2owner_index(Global2OwnerMap const& map,
+                   std::size_t count,
+                   std::size_t i,
+                   DimType const* global_indices,
+                   RankType& rank,
+                   DataIndexType& local_offset)
+{
+  rank = 0;
+  local_offset = 0;
+  DataIndexType stride = 1;
+  for (NDimType d = 0; d < map.ndim; ++d)
+  {
+    DimType local_index = 0;
+    DimType local_size = 0;
+    RankType const dim_rank = dim_global2owner(
+      map.dims[d], global_indices[d * count + i], local_index, local_size);
+    rank += dim_rank * map.dims[d].grid_stride;
+    local_offset += local_index * stride;
+    stride *= local_size;
+  }
+}
+
+/**
+ * Map the local offset of point `i` to its global index, stored in a
+ * batch of `count`.
+ */
+H2_GPU_HOST_DEVICE inline void
+local2global_index(Local2GlobalMap const& map,
+                   std::size_t count,
+                   std::size_t i,
+                   DataIndexType local_offset,
+                   DimType* global_indices)
+{
+  for (NDimType d = 0; d < map.ndim; ++d)
+  {
+    DimLocal2GlobalMap const& dim_map = map.dims[d];
+    DimType const local_index = local_offset % dim_map.local_size;
+    local_offset /= dim_map.local_size;
+    global_indices[d * count + i] = dim_map.start + local_index * dim_map.step;
+  }
+}
+
+void global2owner_indices_impl(CPUDev_t,
+                               Global2OwnerMap const& map,
+                               std::size_t count,
+                               DimType const* global_indices,
+                               RankType* ranks,
+                               DataIndexType* local_offsets,
+                               ComputeStream const& stream);
+void local2global_indices_impl(CPUDev_t,
+                               Local2GlobalMap const& map,
+                               std::size_t count,
+                               DataIndexType const* local_offsets,
+                               DimType* global_indices,
+                               ComputeStream const& stream);
+#ifdef H2_HAS_GPU
+void global2owner_indices_impl(GPUDev_t,
+                               Global2OwnerMap const& map,
+                               std::size_t count,
+                               DimType const* global_indices,
+                               RankType* ranks,
+                               DataIndexType* local_offsets,
+                               ComputeStream const& stream);
+void local2global_indices_impl(GPUDev_t,
+                               Local2GlobalMap const& map,
+                               std::size_t count,
+                               DataIndexType const* local_offsets,
+                               DimType* global_indices,
+                               ComputeStream const& stream);
+#endif
+
+}  // namespace internal
+
+/**
+ * Map a batch of `count` global indices of a distributed tensor to the
+ * ranks in `grid` owning them and their offsets in those ranks' local
+ * tensors (assuming these are contiguous).
+ *
+ * `global_indices` is stored dimension by dimension (see above), and
+ * all indices must be in the tensor. Index `i` is owned by `ranks[i]`
+ * at `local_offsets[i]`. Replicated dimensions are owned by the
+ * calling process's coordinate in them and Single dimensions by the
+ * first one.
+ *
+ * All buffers must be on `device`. This is asynchronous on the GPU.
+ */
+void global2owner_indices(Device device,
+                          ShapeTuple const& global_shape,
+                          ProcessorGrid const& grid,
+                          DistributionTypeTuple const& dist,
+                          std::size_t count,
+                          DimType const* global_indices,
+                          RankType* ranks,
+                          DataIndexType* local_offsets,
+                          ComputeStream const& stream);
+
+/**
+ * Map a batch of `count` offsets in the local tensor of grid rank
+ * `rank` to global indices of the distributed tensor.
+ *
+ * This is the inverse of `global2owner_indices` (for indices owned by
+ * `rank`). `global_indices` is stored dimension by dimension.
+ *
+ * All buffers must be on `device`. This is asynchronous on the GPU.
+ */
+void local2global_indices(Device device,
+                          ShapeTuple const& global_shape,
+                          ProcessorGrid const& grid,
+                          DistributionTypeTuple const& dist,
+                          RankType rank,
+                          std::size_t count,
+                          DataIndexType const* local_offsets,
+                          DimType* global_indices,
+                          ComputeStream const& stream);
+
+}  // namespace h2
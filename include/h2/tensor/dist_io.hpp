@@ -0,0 +1,330 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Binary serialization for distributed tensors.
+ *
+ * See `io.hpp` for the format. This is separate so that `io.hpp` does
+ * not require the distributed tensor machinery.
+ *
+ * This also provides collective checkpointing of a distributed tensor
+ * to a single shared file using MPI-IO.
+ */
+
+#include "h2/core/allocator.hpp"
+#include "h2/tensor/copy_buffer.hpp"
+#include "h2/tensor/dist_tensor.hpp"
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/io.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <utility>
+
+namespace h2
+{
+
+/**
+ * Write this process's part of a distributed tensor to `os`.
+ *
+ * This writes the global metadata and processor grid along with the
+ * local tensor, so each process should write to its own stream (e.g.,
+ * a per-rank file). This is a purely local operation.
+ */
+template <typename T>
+void serialize(std::ostream& os,
+               DistTensor<T> const& tensor,
+               std::size_t chunk_bytes = default_io_chunk_bytes)
+{
+  Tensor<T> const& local = tensor.const_local_tensor();
+  H2_ASSERT_ALWAYS(local.is_empty() || local.const_data() != nullptr,
+                   "Cannot serialize a non-empty distributed tensor with no "
+                   "data");
+  internal::TensorFileHeader header = internal::make_header(local);
+  header.distributed = true;
+  header.global_shape = tensor.shape();
+  header.dim_types = tensor.dim_types();
+  header.distribution = tensor.distribution();
+  header.grid_shape = tensor.proc_grid().shape();
+  header.grid_rank = tensor.proc_grid().rank();
+  internal::write_header(os, header);
+  internal::write_data(os,
+                       local.const_data(),
+                       header.data_bytes,
+                       local.get_device(),
+                       local.get_stream(),
+                       chunk_bytes,
+                       header.compression);
+}
+
+/**
+ * Read this process's part of a distributed tensor written by
+ * `serialize` from `is` into `tensor`.
+ *
+ * `tensor` is resized to the stored global shape, dimension types, and
+ * distribution. Its processor grid must have the same shape as the one
+ * the data was written from, and this process must have the same rank
+ * in it.
+ */
+template <typename T>
+void deserialize(std::istream& is,
+                 DistTensor<T>& tensor,
+                 std::size_t chunk_bytes = default_io_chunk_bytes)
+{
+  internal::TensorFileHeader const header = internal::read_header(is);
+  internal::check_header_type<T>(header);
+  H2_ASSERT_ALWAYS(header.distributed,
+                   "Cannot read a local tensor into a distributed tensor");
+  H2_ASSERT_ALWAYS(header.grid_shape == tensor.proc_grid().shape()
+                     && header.grid_rank == tensor.proc_grid().rank(),
+                   "Serialized tensor was written from rank ",
+                   header.grid_rank,
+                   " of a ",
+                   header.grid_shape,
+                   " grid, cannot read it on rank ",
+                   tensor.proc_grid().rank(),
+                   " of a ",
+                   tensor.proc_grid().shape(),
+                   " grid");
+  tensor.resize(header.global_shape, header.dim_types, header.distribution);
+  Tensor<T>& local = tensor.local_tensor();
+  if (header.shape.is_empty())
+  {
+    H2_ASSERT_ALWAYS(tensor.is_local_empty(),
+                     "Serialized tensor has no local data, but the local "
+                     "tensor is not empty");
+    return;
+  }
+  H2_ASSERT_ALWAYS(header.shape == local.shape()
+                     && header.strides == local.strides(),
+                   "Serialized local tensor (shape ",
+                   header.shape,
+                   ", strides ",
+                   header.strides,
+                   ") does not match local tensor (shape ",
+                   local.shape(),
+                   ", strides ",
+                   local.strides(),
+                   ")");
+  internal::read_local_data(is, header, local, chunk_bytes);
+}
+
+namespace internal
+{
+
+/**
+ * Collectively write a checkpoint file at `path` over `grid`.
+ *
+ * The calling rank writes the `type_size`-byte elements at `buf` on
+ * `dev` to the block of the global tensor given by `indices` if
+ * `write_block` is true. `header` describes the global tensor and is
+ * written by rank 0.
+ *
+ * GPU blocks that are contiguous in the file are written directly
+ * with GPUDirect Storage when it is available (see `gds_enabled`);
+ * other GPU blocks are staged through pinned host memory.
+ */
+void write_checkpoint_blocks(std::string const& path,
+                             TensorFileHeader const& header,
+                             ProcessorGrid const& grid,
+                             IndexRangeTuple const& indices,
+                             bool write_block,
+                             void const* buf,
+                             std::size_t type_size,
+                             Device dev,
+                             ComputeStream const& stream);
+
+/**
+ * Collectively read the header of the checkpoint file at `path` over
+ * `grid`.
+ *
+ * Returns the header and the offset of the data in the file.
+ */
+std::pair<TensorFileHeader, std::uint64_t>
+read_checkpoint_header(std::string const& path, ProcessorGrid const& grid);
+
+/**
+ * Collectively read the block given by `indices` of the checkpoint at
+ * `path`, with data starting at `data_offset`, into `buf` on `dev`.
+ *
+ * Ranks with empty `indices` read nothing. GPU blocks are read like
+ * `write_checkpoint_blocks` writes them.
+ */
+void read_checkpoint_blocks(std::string const& path,
+                            std::uint64_t data_offset,
+                            ShapeTuple const& global_shape,
+                            ProcessorGrid const& grid,
+                            IndexRangeTuple const& indices,
+                            void* buf,
+                            std::size_t type_size,
+                            Device dev,
+                            ComputeStream const& stream);
+
+/**
+ * Return true if the calling rank holds the canonical copy of its
+ * block of a tensor distributed with `dist` over `grid`.
+ *
+ * When a dimension is replicated, only the ranks at index 0 in that
+ * dimension of the grid hold the canonical copy.
+ */
+inline bool holds_canonical_block(ProcessorGrid const& grid,
+                                  DistributionTypeTuple const& dist)
+{
+  for (typename DistributionTypeTuple::size_type i = 0; i < dist.size(); ++i)
+  {
+    if (dist[i] == Distribution::Replicated && grid.get_dimension_rank(i) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace internal
+
+/**
+ * Collectively write a checkpoint of a distributed tensor to a single
+ * shared file at `path`.
+ *
+ * Every rank in the tensor's processor grid must call this. Each rank
+ * writes its local block directly to its place in the file with
+ * collective MPI-IO, so data is never gathered to one rank. Replicated
+ * data is written once.
+ *
+ * The file is in the same format as `serialize` writes for a local
+ * tensor of the global shape (with contiguous strides), so it can be
+ * read back either with `read_checkpoint` (under any distribution) or
+ * into an ordinary `Tensor` with `deserialize`.
+ *
+ * GPU data is written directly from device memory with GPUDirect
+ * Storage when it is available and the rank's block is contiguous in
+ * the file (e.g., when only the last dimension is distributed), and is
+ * otherwise staged through pinned host memory.
+ */
+template <typename T>
+void write_checkpoint(std::string const& path, DistTensor<T> const& tensor)
+{
+  Tensor<T> const& local = tensor.const_local_tensor();
+  H2_ASSERT_ALWAYS(local.is_empty() || local.is_contiguous(),
+                   "Cannot checkpoint a distributed tensor with a "
+                   "non-contiguous local tensor");
+  H2_ASSERT_ALWAYS(local.is_empty() || local.const_data() != nullptr,
+                   "Cannot checkpoint a non-empty distributed tensor with "
+                   "no data");
+  H2_ASSERT_ALWAYS(!internal::has_cyclic_dist(tensor.distribution()),
+                   "Cannot checkpoint a distributed tensor with a Cyclic "
+                   "distribution (redistribute it to Block first)");
+
+  internal::TensorFileHeader header;
+  header.type_token = get_h2_type<T>().get_token();
+  header.type_size = sizeof(T);
+  if (!tensor.is_empty())
+  {
+    header.shape = tensor.shape();
+    header.strides = get_contiguous_strides(tensor.shape());
+    header.dim_types = tensor.dim_types();
+    header.data_bytes = product<std::uint64_t>(tensor.shape()) * sizeof(T);
+  }
+
+  IndexRangeTuple const indices =
+    internal::get_global_indices(tensor.shape(),
+                                 tensor.proc_grid(),
+                                 tensor.distribution(),
+                                 tensor.proc_grid().rank(),
+                                 tensor.block_sizes());
+  bool const write_block =
+    !tensor.is_local_empty()
+    && internal::holds_canonical_block(tensor.proc_grid(),
+                                       tensor.distribution());
+
+  internal::write_checkpoint_blocks(path,
+                                    header,
+                                    tensor.proc_grid(),
+                                    indices,
+                                    write_block,
+                                    local.const_data(),
+                                    sizeof(T),
+                                    local.get_device(),
+                                    local.get_stream());
+}
+
+/**
+ * Collectively read a checkpoint written by `write_checkpoint` from
+ * `path` into `tensor`.
+ *
+ * Every rank in the tensor's processor grid must call this. `tensor`
+ * is resized to the global shape and dimension types of the
+ * checkpoint, keeping its processor grid and distribution, which need
+ * not match what the checkpoint was written with. (If `tensor` is empty
+ * and has no distribution, a block distribution is used.) Each rank
+ * reads only its local block, directly into GPU memory when possible
+ * (as in `write_checkpoint`).
+ */
+template <typename T>
+void read_checkpoint(std::string const& path, DistTensor<T>& tensor)
+{
+  auto const [header, data_offset] =
+    internal::read_checkpoint_header(path, tensor.proc_grid());
+  internal::check_header_type<T>(header);
+  H2_ASSERT_ALWAYS(!header.distributed
+                     && header.strides == get_contiguous_strides(header.shape)
+                     && header.compression == DataCompression::None,
+                   "File at ",
+                   path,
+                   " is not a distributed tensor checkpoint");
+  if (header.shape.is_empty())
+  {
+    tensor.empty();
+  }
+  else
+  {
+    DistributionTypeTuple dist = tensor.distribution();
+    if (dist.is_empty())
+    {
+      dist = DistributionTypeTuple(TuplePad<DistributionTypeTuple>(
+        header.shape.size(), Distribution::Block));
+    }
+    tensor.resize(header.shape, header.dim_types, dist);
+  }
+  H2_ASSERT_ALWAYS(!internal::has_cyclic_dist(tensor.distribution()),
+                   "Cannot read a checkpoint into a distributed tensor with "
+                   "a Cyclic distribution");
+
+  Tensor<T>& local = tensor.local_tensor();
+  IndexRangeTuple const indices =
+    internal::get_global_indices(tensor.shape(),
+                                 tensor.proc_grid(),
+                                 tensor.distribution(),
+                                 tensor.proc_grid().rank(),
+                                 tensor.block_sizes());
+  bool const read_block = !tensor.is_local_empty();
+  if (read_block)
+  {
+    local.ensure();
+    H2_ASSERT_ALWAYS(local.is_contiguous(),
+                     "Cannot read a checkpoint into a non-contiguous local "
+                     "tensor");
+  }
+
+  internal::read_checkpoint_blocks(path,
+                                   data_offset,
+                                   tensor.shape(),
+                                   tensor.proc_grid(),
+                                   read_block ? indices : IndexRangeTuple{},
+                                   read_block ? local.data() : nullptr,
+                                   sizeof(T),
+                                   local.get_device(),
+                                   local.get_stream());
+}
+
+}  // namespace h2
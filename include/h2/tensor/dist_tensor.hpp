@@ -12,7 +12,9 @@
  * Distributed tensors that live on a device.
  */
 
+#include "h2/core/object_pool.hpp"
 #include "h2/core/types.hpp"
+#include "h2/tensor/copy_buffer.hpp"
 #include "h2/tensor/dist_tensor_base.hpp"
 #include "h2/tensor/dist_types.hpp"
 #include "h2/tensor/proc_grid.hpp"
@@ -20,6 +22,7 @@
 #include "h2/tensor/tensor_types.hpp"
 #include "h2/utils/passkey.hpp"
 
+#include <cstddef>
 #include <memory>
 #include <optional>
 
@@ -37,6 +40,18 @@ public:
   static_assert(IsH2StorageType_v<T>,
                 "Cannot create a tensor with a non-storage type");
 
+  // Tensors are frequently allocated for views and conversions, so
+  // they come from the object pool.
+  static void* operator new(std::size_t bytes)
+  {
+    return internal::pool_allocate(bytes);
+  }
+
+  static void operator delete(void* ptr, std::size_t bytes) noexcept
+  {
+    internal::pool_deallocate(ptr, bytes);
+  }
+
   DistTensor(Device device,
              ShapeTuple const& shape_,
              DimensionTypeTuple const& dim_types_,
@@ -44,7 +59,29 @@ public:
              DistributionTypeTuple const& dist_types_,
              TensorAllocationStrategy alloc_type = StrictAlloc,
              std::optional<ComputeStream> const stream = std::nullopt)
-    : BaseDistTensor(shape_, dim_types_, grid_, dist_types_),
+    : DistTensor(device,
+                 shape_,
+                 dim_types_,
+                 grid_,
+                 dist_types_,
+                 BlockSizesTuple{},
+                 alloc_type,
+                 stream)
+  {}
+
+  /**
+   * Construct a tensor with Variable dimensions, whose blocks have the
+   * sizes given in `block_sizes_`.
+   */
+  DistTensor(Device device,
+             ShapeTuple const& shape_,
+             DimensionTypeTuple const& dim_types_,
+             ProcessorGrid grid_,
+             DistributionTypeTuple const& dist_types_,
+             BlockSizesTuple const& block_sizes_,
+             TensorAllocationStrategy alloc_type = StrictAlloc,
+             std::optional<ComputeStream> const stream = std::nullopt)
+    : BaseDistTensor(shape_, dim_types_, grid_, dist_types_, block_sizes_),
       tensor_local(device,
                    this->tensor_local_shape,
                    init_n(dim_types_, this->tensor_local_shape.size()),
@@ -73,13 +110,15 @@ public:
              DistributionTypeTuple const& dist_types_,
              ShapeTuple const& local_shape_,
              StrideTuple const& local_strides_,
-             ComputeStream const& stream)
+             ComputeStream const& stream,
+             BlockSizesTuple const& block_sizes_ = {})
     : BaseDistTensor(ViewType::Mutable,
                      global_shape_,
                      dim_types_,
                      grid_,
                      dist_types_,
-                     local_shape_),
+                     local_shape_,
+                     block_sizes_),
       tensor_local(
         device, buffer, local_shape_, dim_types_, local_strides_, stream)
   {}
@@ -92,13 +131,15 @@ public:
              DistributionTypeTuple const& dist_types_,
              ShapeTuple const& local_shape_,
              StrideTuple const& local_strides_,
-             ComputeStream const& stream)
+             ComputeStream const& stream,
+             BlockSizesTuple const& block_sizes_ = {})
     : BaseDistTensor(ViewType::Const,
                      global_shape_,
                      dim_types_,
                      grid_,
                      dist_types_,
-                     local_shape_),
+                     local_shape_,
+                     block_sizes_),
       tensor_local(
         device, buffer, local_shape_, dim_types_, local_strides_, stream)
   {}
@@ -112,9 +153,15 @@ public:
              DimensionTypeTuple const& dim_types_,
              ProcessorGrid grid_,
              DistributionTypeTuple const& dist_types_,
+             BlockSizesTuple const& block_sizes_,
              Passkey<DistTensor<T>>)
-    : BaseDistTensor(
-        view_type_, shape_, dim_types_, grid_, dist_types_, local_shape_),
+    : BaseDistTensor(view_type_,
+                     shape_,
+                     dim_types_,
+                     grid_,
+                     dist_types_,
+                     local_shape_,
+                     block_sizes_),
       tensor_local(view_type_,
                    orig_tensor_local_.tensor_memory,
                    local_shape_,
@@ -131,13 +178,15 @@ public:
              DimensionTypeTuple const& dim_types_,
              ProcessorGrid grid_,
              DistributionTypeTuple const& dist_types_,
+             BlockSizesTuple const& block_sizes_,
              Passkey<DistTensor<T>>)
     : BaseDistTensor(ViewType::None,
                      shape_,
                      dim_types_,
                      grid_,
                      dist_types_,
-                     local_tensor_clone.shape()),
+                     local_tensor_clone.shape(),
+                     block_sizes_),
       tensor_local(std::move(local_tensor_clone))
   {}
 
@@ -168,7 +217,7 @@ public:
   /**
    * Return an exact copy of this tensor.
    *
-   *
+   * The copy does not have a halo.
    */
   std::unique_ptr<DistTensor<T>> clone() const
   {
@@ -178,6 +227,7 @@ public:
                                            dim_types(),
                                            proc_grid(),
                                            distribution(),
+                                           block_sizes(),
                                            Passkey<DistTensor<T>>{});
   }
 
@@ -219,10 +269,13 @@ public:
    */
   void empty()
   {
+    tensor_halo = ShapeTuple();
+    tensor_padded.reset();
     this->tensor_local.empty();
     this->tensor_shape = ShapeTuple();
     this->tensor_dim_types = DimensionTypeTuple();
     this->tensor_dist_types = DistributionTypeTuple();
+    this->tensor_block_sizes.clear();
     this->tensor_local_shape = ShapeTuple();
     if (this->is_view())
     {
@@ -261,6 +314,9 @@ public:
    * Resize the tensor to a new shape and change its dimension types
    * and distribution.
    *
+   * Variable dimensions keep their block sizes if they were already
+   * Variable and their size does not change.
+   *
    * The number of dimensions must be the same as the existing tensor,
    * or the existing tensor must be empty.
    *
@@ -269,6 +325,37 @@ public:
   void resize(ShapeTuple const& new_shape,
               DimensionTypeTuple const& new_dim_types,
               DistributionTypeTuple const& new_dist_types)
+  {
+    BlockSizesTuple new_block_sizes;
+    for (typename ShapeTuple::size_type i = 0; i < new_dist_types.size(); ++i)
+    {
+      if (new_dist_types[i] == Distribution::Variable)
+      {
+        new_block_sizes.resize(new_dist_types.size());
+        if (i < this->tensor_shape.size()
+            && this->tensor_dist_types[i] == Distribution::Variable
+            && this->tensor_shape[i] == new_shape[i])
+        {
+          new_block_sizes[i] = this->block_sizes(i);
+        }
+      }
+    }
+    resize(new_shape, new_dim_types, new_dist_types, new_block_sizes);
+  }
+
+  /**
+   * Resize the tensor to a new shape and change its dimension types,
+   * distribution, and the block sizes of Variable dimensions.
+   *
+   * The number of dimensions must be the same as the existing tensor,
+   * or the existing tensor must be empty.
+   *
+   * It is an error to call this on a view.
+   */
+  void resize(ShapeTuple const& new_shape,
+              DimensionTypeTuple const& new_dim_types,
+              DistributionTypeTuple const& new_dist_types,
+              BlockSizesTuple const& new_block_sizes)
   {
     H2_ASSERT_ALWAYS(!this->is_view(), "Cannot resize a view");
     H2_ASSERT_ALWAYS(new_shape.size() == this->tensor_grid.ndim(),
@@ -286,13 +373,29 @@ public:
                      ") and distribution types (",
                      new_dist_types,
                      ") must be the same size");
+    internal::check_block_sizes(
+      new_shape, this->tensor_grid, new_dist_types, new_block_sizes);
     this->tensor_shape = new_shape;
     this->tensor_local_shape =
-      internal::get_local_shape(new_shape, this->tensor_grid, new_dist_types);
+      internal::get_local_shape(new_shape,
+                                this->tensor_grid,
+                                new_dist_types,
+                                this->tensor_grid.rank(),
+                                new_block_sizes);
     this->tensor_dim_types = new_dim_types;
     this->tensor_dist_types = new_dist_types;
-    tensor_local.resize(this->tensor_local_shape,
-                        init_n(new_dim_types, this->tensor_local_shape.size()));
+    this->tensor_block_sizes = new_block_sizes;
+    if (has_halo())
+    {
+      check_halo(tensor_halo);
+      allocate_with_halo();
+    }
+    else
+    {
+      tensor_local.resize(
+        this->tensor_local_shape,
+        init_n(new_dim_types, this->tensor_local_shape.size()));
+    }
   }
 
   /**
@@ -333,7 +436,15 @@ public:
    * This does not attempt to reuse existing memory from still-extant
    * views of this tensor.
    */
-  void ensure(tensor_no_recovery_t) { tensor_local.ensure(TensorNoRecovery); }
+  void ensure(tensor_no_recovery_t)
+  {
+    if (has_halo())
+    {
+      ensure_halo();
+      return;
+    }
+    tensor_local.ensure(TensorNoRecovery);
+  }
 
   /**
    * Ensure memory is backing this tensor, allocating if necessary.
@@ -343,16 +454,42 @@ public:
    */
   void ensure(tensor_attempt_recovery_t)
   {
+    if (has_halo())
+    {
+      ensure_halo();
+      return;
+    }
     tensor_local.ensure(TensorAttemptRecovery);
   }
 
+  /**
+   * Ensure memory is backing this tensor, ordering any allocation on
+   * `alloc_stream` (see `Tensor::ensure_async`).
+   */
+  void ensure_async(ComputeStream const& alloc_stream)
+  {
+    if (has_halo())
+    {
+      ensure_halo();
+      return;
+    }
+    tensor_local.ensure_async(alloc_stream);
+  }
+
   /**
    * Release memory associated with this tensor.
    *
    * Note that if there are views, memory may not be deallocated
    * immediately.
    */
-  void release() { tensor_local.release(); }
+  void release()
+  {
+    tensor_local.release();
+    if (tensor_padded)
+    {
+      tensor_padded->release();
+    }
+  }
 
   /**
    * Return a view of this tensor.
@@ -460,9 +597,185 @@ public:
 
   bool is_lazy() const H2_NOEXCEPT { return tensor_local.is_lazy(); }
 
+  /**
+   * Add ghost regions (a halo) around the local tensor.
+   *
+   * The local tensor is padded with `halo[i]` ghost entries on each
+   * side of dimension `i`, which `exchange_halo` fills with the
+   * neighboring ranks' boundary entries. `local_tensor` remains the
+   * interior (and hence is no longer contiguous), so existing code
+   * operating on it is unaffected; `local_tensor_with_halo` includes
+   * the ghost regions.
+   *
+   * Halos are only supported in Block-distributed dimensions, and every
+   * rank's block must be at least as large as the halo, so ghost
+   * regions only come from immediate neighbors. Any existing local data
+   * is preserved. A halo of all zeros removes the halo.
+   *
+   * It is an error to call this on a view.
+   */
+  void set_halo(ShapeTuple const& halo_)
+  {
+    H2_ASSERT_ALWAYS(!this->is_view(), "Cannot add a halo to a view");
+    check_halo(halo_);
+    Tensor<T> old_local = std::move(tensor_local);
+    tensor_halo =
+      any_of(halo_, [](ShapeTuple::type h) { return h > 0; }) ? halo_
+                                                              : ShapeTuple();
+    if (has_halo())
+    {
+      allocate_with_halo(old_local);
+    }
+    else
+    {
+      tensor_padded.reset();
+      tensor_local = Tensor<T>(
+        old_local.get_device(),
+        this->tensor_local_shape,
+        init_n(this->tensor_dim_types, this->tensor_local_shape.size()),
+        StrictAlloc,
+        old_local.get_stream());
+      copy_local(old_local);
+    }
+  }
+
+  /**
+   * Return the width of the halo in each dimension, or an empty tuple
+   * if there is no halo.
+   */
+  ShapeTuple const& halo() const H2_NOEXCEPT { return tensor_halo; }
+
+  /** Return true if this tensor has a halo. */
+  bool has_halo() const H2_NOEXCEPT { return !tensor_halo.is_empty(); }
+
+  /**
+   * Return the local tensor including its ghost regions.
+   *
+   * If there is no halo, this is the same as `local_tensor`.
+   */
+  Tensor<T>& local_tensor_with_halo()
+  {
+    return tensor_padded ? *tensor_padded : tensor_local;
+  }
+
+  /** Return the local tensor including its ghost regions. */
+  Tensor<T> const& local_tensor_with_halo() const
+  {
+    return tensor_padded ? *tensor_padded : tensor_local;
+  }
+
 private:
   /** Local tensor used for storage. */
   Tensor<T> tensor_local;
+  /** Width of the halo in each dimension (empty if no halo). */
+  ShapeTuple tensor_halo;
+  /**
+   * Local tensor including ghost regions, if there is a halo.
+   *
+   * `tensor_local` is then a view of its interior.
+   */
+  std::unique_ptr<Tensor<T>> tensor_padded;
+
+  /** Check that `halo_` is a valid halo for this tensor. */
+  void check_halo(ShapeTuple const& halo_) const
+  {
+    H2_ASSERT_ALWAYS(halo_.size() == this->tensor_shape.size(),
+                     "Halo (",
+                     halo_,
+                     ") must have one entry per dimension of the tensor "
+                     "shape (",
+                     this->tensor_shape,
+                     ")");
+    for (typename ShapeTuple::size_type i = 0; i < halo_.size(); ++i)
+    {
+      if (halo_[i] == 0)
+      {
+        continue;
+      }
+      H2_ASSERT_ALWAYS(this->tensor_dist_types[i] == Distribution::Block,
+                       "Halos are only supported in Block-distributed "
+                       "dimensions, but dimension ",
+                       i,
+                       " is ",
+                       this->tensor_dist_types[i]);
+      H2_ASSERT_ALWAYS(this->tensor_shape[i] / this->tensor_grid.shape(i)
+                         >= halo_[i],
+                       "Halo of ",
+                       halo_[i],
+                       " in dimension ",
+                       i,
+                       " is larger than the smallest local block");
+    }
+  }
+
+  /**
+   * Allocate a padded local tensor and make the local tensor a view of
+   * its interior, copying data from `old_local` if it has any.
+   */
+  void allocate_with_halo(Tensor<T> const& old_local)
+  {
+    tensor_padded.reset();
+    if (this->tensor_local_shape.is_empty())
+    {
+      // No local data, hence no ghost regions.
+      tensor_local = Tensor<T>(old_local.get_device(),
+                               ShapeTuple(),
+                               DimensionTypeTuple(),
+                               StrictAlloc,
+                               old_local.get_stream());
+      return;
+    }
+    ShapeTuple padded_shape = this->tensor_local_shape;
+    IndexRangeTuple interior(TuplePad<IndexRangeTuple>(padded_shape.size()));
+    for (typename ShapeTuple::size_type i = 0; i < padded_shape.size(); ++i)
+    {
+      padded_shape[i] += 2 * tensor_halo[i];
+      interior[i] =
+        IRng(tensor_halo[i], tensor_halo[i] + this->tensor_local_shape[i]);
+    }
+    tensor_padded = std::make_unique<Tensor<T>>(old_local.get_device(),
+                                                padded_shape,
+                                                this->tensor_dim_types,
+                                                StrictAlloc,
+                                                old_local.get_stream());
+    tensor_local = std::move(*tensor_padded->view(interior));
+    copy_local(old_local);
+  }
+
+  /** Reallocate the padded local tensor, discarding any data. */
+  void allocate_with_halo()
+  {
+    Tensor<T> old_local = std::move(tensor_local);
+    // Do not preserve data, whose shape may no longer match.
+    old_local.empty();
+    allocate_with_halo(old_local);
+  }
+
+  /** Ensure memory backs a tensor with a halo. */
+  void ensure_halo()
+  {
+    if (tensor_padded && tensor_padded->const_data() == nullptr)
+    {
+      allocate_with_halo();
+    }
+  }
+
+  /** Copy the data of `old_local`, if any, to the local tensor. */
+  void copy_local(Tensor<T> const& old_local)
+  {
+    if (old_local.is_empty() || old_local.const_data() == nullptr
+        || old_local.shape() != tensor_local.shape())
+    {
+      return;
+    }
+    copy_strided_buffer(tensor_local.data(),
+                        tensor_local.strides(),
+                        tensor_local.get_stream(),
+                        old_local.const_data(),
+                        old_local.strides(),
+                        old_local.get_stream(),
+                        tensor_local.shape());
+  }
 
   /** Helper for constructing views. */
   std::unique_ptr<DistTensor<T>> make_view(IndexRangeTuple index_range,
@@ -479,6 +792,26 @@ private:
       "Scalar indices (",
       index_range,
       ") are not permitted in global views");
+    // A subrange of a Cyclic dimension would no longer start on grid
+    // rank 0, so it is not Cyclic. Likewise, a subrange of a Variable
+    // dimension would not have the same block sizes.
+    for (typename IndexRangeTuple::size_type i = 0; i < index_range.size();
+         ++i)
+    {
+      H2_ASSERT_ALWAYS(
+        (this->tensor_dist_types[i] != Distribution::Cyclic
+         && this->tensor_dist_types[i] != Distribution::Variable)
+          || index_range[i] == ALL
+          || (index_range[i].start() == 0
+              && index_range[i].end() == this->tensor_shape[i]),
+        "Cannot take a view of part of ",
+        this->tensor_dist_types[i],
+        " dimension ",
+        i,
+        " (",
+        index_range,
+        ")");
+    }
 
     // We have three cases:
     // 1. The indices are empty, so we have a globally empty view.
@@ -498,6 +831,7 @@ private:
                                              DimensionTypeTuple{},
                                              this->tensor_grid,
                                              DistributionTypeTuple{},
+                                             BlockSizesTuple{},
                                              Passkey<DistTensor<T>>{});
     }
 
@@ -518,8 +852,12 @@ private:
       get_index_range_shape(index_range, this->tensor_shape);
     // Get the global indices of the original tensor that this rank
     // owns (i.e., that are present locally).
-    IndexRangeTuple global_indices = internal::get_global_indices(
-      this->tensor_shape, this->tensor_grid, this->tensor_dist_types);
+    IndexRangeTuple global_indices =
+      internal::get_global_indices(this->tensor_shape,
+                                   this->tensor_grid,
+                                   this->tensor_dist_types,
+                                   this->tensor_grid.rank(),
+                                   this->tensor_block_sizes);
 
     if (!do_index_ranges_intersect(index_range, global_indices))
     {
@@ -532,6 +870,7 @@ private:
                                              this->tensor_dim_types,
                                              this->tensor_grid,
                                              this->tensor_dist_types,
+                                             this->tensor_block_sizes,
                                              Passkey<DistTensor<T>>{});
     }
 
@@ -544,7 +883,8 @@ private:
       internal::global2local_indices(this->tensor_shape,
                                      this->tensor_grid,
                                      this->tensor_dist_types,
-                                     present_global_indices);
+                                     present_global_indices,
+                                     this->tensor_block_sizes);
     ShapeTuple view_local_shape =
       get_index_range_shape(local_indices, this->tensor_local_shape);
     return std::make_unique<DistTensor<T>>(view_type,
@@ -555,6 +895,7 @@ private:
                                            this->tensor_dim_types,
                                            this->tensor_grid,
                                            this->tensor_dist_types,
+                                           this->tensor_block_sizes,
                                            Passkey<DistTensor<T>>{});
   }
 };
@@ -35,7 +35,9 @@ namespace h2
  * dimension independently, according to that dimension's assigned
  * distribution. If any dimension is assigned zero indices for a rank,
  * that rank will not be assigned any data (and will have an empty
- * local tensor).
+ * local tensor). Variable dimensions are partitioned into blocks of
+ * given sizes (see `BlockSizesTuple`), e.g., to balance work between
+ * ranks of different speeds.
  *
  * Distributed tensors generally follow the same semantics as
  * `BaseTensor`s and `Tensor`s.
@@ -49,15 +51,19 @@ public:
   /**
    * Construct a tensor with the given shape and dimension types,
    * distributed over the given processor grid.
+   *
+   * `block_sizes_` gives the block sizes of any Variable dimensions.
    */
   BaseDistTensor(ShapeTuple const& shape_,
                  DimensionTypeTuple const& dim_types_,
                  ProcessorGrid grid_,
-                 DistributionTypeTuple const& dist_types_)
+                 DistributionTypeTuple const& dist_types_,
+                 BlockSizesTuple const& block_sizes_ = {})
     : tensor_shape(shape_),
       tensor_dim_types(dim_types_),
       tensor_grid(grid_),
       tensor_dist_types(dist_types_),
+      tensor_block_sizes(block_sizes_),
       tensor_view_type(ViewType::None)
   {
     H2_ASSERT_DEBUG(tensor_shape.size() == tensor_dim_types.size(),
@@ -79,8 +85,13 @@ public:
                     ") and processor grid (",
                     tensor_grid.shape(),
                     ") must be the same rank");
-    tensor_local_shape =
-      internal::get_local_shape(tensor_shape, tensor_grid, tensor_dist_types);
+    internal::check_block_sizes(
+      tensor_shape, tensor_grid, tensor_dist_types, tensor_block_sizes);
+    tensor_local_shape = internal::get_local_shape(tensor_shape,
+                                                   tensor_grid,
+                                                   tensor_dist_types,
+                                                   tensor_grid.rank(),
+                                                   tensor_block_sizes);
   }
 
   /** Construct an empty tensor on a null grid. */
@@ -142,6 +153,26 @@ public:
     return tensor_dist_types[i];
   }
 
+  /**
+   * Return the block sizes of the tensor's Variable dimensions.
+   *
+   * This is empty if no dimension is Variable.
+   */
+  BlockSizesTuple const& block_sizes() const H2_NOEXCEPT
+  {
+    return tensor_block_sizes;
+  }
+
+  /**
+   * Return the block sizes of a particular dimension, which are empty
+   * unless it is Variable.
+   */
+  BlockSizes const&
+  block_sizes(typename ShapeTuple::size_type i) const H2_NOEXCEPT
+  {
+    return internal::get_dim_block_sizes(tensor_block_sizes, i);
+  }
+
   /** Return the number of dimensions (i.e., the rank) of the tensor. */
   typename ShapeTuple::size_type ndim() const H2_NOEXCEPT
   {
@@ -205,6 +236,8 @@ protected:
   ProcessorGrid tensor_grid; /**< Grid the tensor is distributed over. */
   /** How each dimension of the tensor is distributed. */
   DistributionTypeTuple tensor_dist_types;
+  /** Block sizes of Variable dimensions (see `BlockSizesTuple`). */
+  BlockSizesTuple tensor_block_sizes;
   ViewType tensor_view_type; /**< What type of view (if any) this tensor is. */
 
   // Implementation note:
@@ -221,11 +254,13 @@ protected:
                  DimensionTypeTuple const& dim_types_,
                  ProcessorGrid grid_,
                  DistributionTypeTuple const& dist_types_,
-                 ShapeTuple const& local_shape_)
+                 ShapeTuple const& local_shape_,
+                 BlockSizesTuple const& block_sizes_ = {})
     : tensor_shape(shape_),
       tensor_dim_types(dim_types_),
       tensor_grid(grid_),
       tensor_dist_types(dist_types_),
+      tensor_block_sizes(block_sizes_),
       tensor_view_type(view_type_),
       tensor_local_shape(local_shape_)
   {}
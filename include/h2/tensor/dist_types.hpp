@@ -16,6 +16,8 @@
 
 #include "tensor_types.hpp"
 
+#include <vector>
+
 namespace h2
 {
 
@@ -36,7 +38,9 @@ enum class Distribution
   Undefined,  /**< No defined distribution. */
   Block,      /**< A block distribution with same-sized blocks. */
   Replicated, /**< Data is replicated. */
-  Single      /**< Data resides on a single processor. */
+  Single,     /**< Data resides on a single processor. */
+  Cyclic,     /**< Index i is on processor i mod p (as in Elemental). */
+  Variable    /**< A block distribution with given sizes for each block. */
 };
 
 /** Support printing Distribution. */
@@ -48,6 +52,8 @@ inline std::ostream& operator<<(std::ostream& os, Distribution const& dist)
   case Distribution::Block: os << "Block"; break;
   case Distribution::Replicated: os << "Replicated"; break;
   case Distribution::Single: os << "Single"; break;
+  case Distribution::Cyclic: os << "Cyclic"; break;
+  case Distribution::Variable: os << "Variable"; break;
   default: os << "Unknown"; break;
   }
   return os;
@@ -61,4 +67,18 @@ using DistTTuple = DistributionTypeTuple;  // Alias to save some typing.
 /** Type used for representing ranks in communicators/grids. */
 using RankType = std::int32_t;
 
+/**
+ * Size of the block on each rank of a processor grid dimension, for
+ * dimensions with a Variable distribution.
+ */
+using BlockSizes = std::vector<DimType>;
+
+/**
+ * Block sizes for each dimension of a tensor.
+ *
+ * Entries for dimensions that are not Variable are empty, and a tuple
+ * with no Variable dimensions may be empty.
+ */
+using BlockSizesTuple = std::vector<BlockSizes>;
+
 }  // namespace h2
@@ -18,6 +18,7 @@
 #include "h2/tensor/tensor_utils.hpp"
 
 #include <algorithm>
+#include <numeric>
 
 #include "tensor_types.hpp"
 
@@ -33,6 +34,108 @@ namespace internal
 // composed: Single distributions may result in some ranks having no
 // data, despite their other distributions.
 
+// Variable distributions are described by their block sizes (see
+// `BlockSizes`), which the versions operating on a grid take as an
+// extra argument, so they have no per-distribution templates.
+
+/**
+ * Return the block sizes for dimension `dim` from `block_sizes`, or an
+ * empty list if there are none.
+ */
+inline BlockSizes const&
+get_dim_block_sizes(BlockSizesTuple const& block_sizes,
+                    typename ShapeTuple::size_type dim)
+{
+  static BlockSizes const no_sizes;
+  return (dim < block_sizes.size()) ? block_sizes[dim] : no_sizes;
+}
+
+/** Check that a Variable dimension has a block size for each rank. */
+inline void check_variable_block_sizes(BlockSizes const& block_sizes,
+                                       typename ShapeTuple::type grid_dim_size)
+{
+  H2_ASSERT_ALWAYS(block_sizes.size()
+                     == static_cast<std::size_t>(grid_dim_size),
+                   "Variable distributions need a block size for each of ",
+                   grid_dim_size,
+                   " ranks, got ",
+                   block_sizes.size());
+}
+
+/** Return the first global index of a block of a Variable dimension. */
+inline DimType get_variable_block_start(BlockSizes const& block_sizes,
+                                        RankType grid_dim_rank)
+{
+  return std::accumulate(block_sizes.begin(),
+                         block_sizes.begin() + grid_dim_rank,
+                         DimType{0});
+}
+
+/** Return the grid dimension rank whose Variable block has an index. */
+inline RankType get_variable_block_rank(BlockSizes const& block_sizes,
+                                        DimType global_index)
+{
+  RankType rank = 0;
+  DimType end = block_sizes[0];
+  while (global_index >= end)
+  {
+    ++rank;
+    end += block_sizes[rank];
+  }
+  return rank;
+}
+
+/**
+ * Check that `block_sizes` are valid for a tensor of shape `shape`
+ * distributed over `proc_grid` with `dist`.
+ *
+ * Each Variable dimension needs one non-negative size per rank of its
+ * grid dimension, summing to the dimension's size. Other dimensions
+ * have no sizes.
+ */
+inline void check_block_sizes(ShapeTuple const& shape,
+                              ProcessorGrid const& proc_grid,
+                              DistributionTypeTuple const& dist,
+                              BlockSizesTuple const& block_sizes)
+{
+  H2_ASSERT_ALWAYS(block_sizes.empty() || block_sizes.size() == shape.size(),
+                   "Block sizes must be given for all ",
+                   shape.size(),
+                   " dimensions or none, got ",
+                   block_sizes.size());
+  for (typename ShapeTuple::size_type dim = 0; dim < shape.size(); ++dim)
+  {
+    BlockSizes const& sizes = get_dim_block_sizes(block_sizes, dim);
+    if (dist[dim] != Distribution::Variable)
+    {
+      H2_ASSERT_ALWAYS(sizes.empty(),
+                       "Block sizes given for dimension ",
+                       dim,
+                       ", which is ",
+                       dist[dim],
+                       ", not Variable");
+      continue;
+    }
+    H2_ASSERT_ALWAYS(sizes.size()
+                       == static_cast<std::size_t>(proc_grid.shape(dim)),
+                     "Variable dimension ",
+                     dim,
+                     " needs ",
+                     proc_grid.shape(dim),
+                     " block sizes, got ",
+                     sizes.size());
+    H2_ASSERT_ALWAYS(
+      std::all_of(sizes.begin(), sizes.end(), [](DimType s) { return s >= 0; })
+        && std::accumulate(sizes.begin(), sizes.end(), DimType{0})
+             == shape[dim],
+      "Block sizes of Variable dimension ",
+      dim,
+      " must be non-negative and sum to its size (",
+      shape[dim],
+      ")");
+  }
+}
+
 /**
  * Get the local size of a dimension.
  *
@@ -78,6 +181,19 @@ inline typename ShapeTuple::type get_dim_local_size<Distribution::Single>(
   return is_root ? dim_size : ShapeTuple::type{0};
 }
 
+template <>
+inline typename ShapeTuple::type get_dim_local_size<Distribution::Cyclic>(
+  typename ShapeTuple::type dim_size,
+  typename ShapeTuple::type grid_dim_size,
+  RankType grid_dim_rank,
+  bool /*is_root*/)
+{
+  // Every rank gets one index from each round of grid_dim_size
+  // indices, so the local sizes are the same as with Block.
+  return get_dim_local_size<Distribution::Block>(
+    dim_size, grid_dim_size, grid_dim_rank, false);
+}
+
 /**
  * Return the local size of a dimension based on the processor grid
  * and distribution.
@@ -87,7 +203,8 @@ get_dim_local_size(typename ShapeTuple::type dim_size,
                    typename ShapeTuple::size_type dim,
                    ProcessorGrid const& proc_grid,
                    Distribution dist,
-                   RankType grid_rank)
+                   RankType grid_rank,
+                   BlockSizes const& block_sizes = BlockSizes{})
 {
   H2_ASSERT_DEBUG(grid_rank < proc_grid.size(),
                   "Invalid grid rank ",
@@ -108,6 +225,12 @@ get_dim_local_size(typename ShapeTuple::type dim_size,
   case Distribution::Single:
     return get_dim_local_size<Distribution::Single>(
       dim_size, grid_dim_size, grid_dim_rank, grid_dim_rank == 0);
+  case Distribution::Cyclic:
+    return get_dim_local_size<Distribution::Cyclic>(
+      dim_size, grid_dim_size, grid_dim_rank, false);
+  case Distribution::Variable:
+    check_variable_block_sizes(block_sizes, grid_dim_size);
+    return block_sizes[grid_dim_rank];
   default: H2_ASSERT_ALWAYS(false, "Invalid distribution ", dist);
   }
 }
@@ -123,7 +246,7 @@ get_dim_local_size(typename ShapeTuple::type dim_size,
 
 /**
  * Get the local shape given a global shape, processor grid, and
- * distributions.
+ * distributions (and block sizes for any Variable dimensions).
  *
  * @note This is only correct for tensors that are not views (or for
  * which their local data is entirely present in the view).
@@ -131,13 +254,19 @@ get_dim_local_size(typename ShapeTuple::type dim_size,
 inline ShapeTuple get_local_shape(ShapeTuple shape,
                                   ProcessorGrid const& proc_grid,
                                   DistributionTypeTuple dist,
-                                  RankType grid_rank)
+                                  RankType grid_rank,
+                                  BlockSizesTuple const& block_sizes = {})
 {
   ShapeTuple local_shape(TuplePad<ShapeTuple>(shape.size(), 0));
   for (typename ShapeTuple::size_type dim = 0; dim < shape.size(); ++dim)
   {
     local_shape[dim] =
-      get_dim_local_size(shape[dim], dim, proc_grid, dist[dim], grid_rank);
+      get_dim_local_size(shape[dim],
+                         dim,
+                         proc_grid,
+                         dist[dim],
+                         grid_rank,
+                         get_dim_block_sizes(block_sizes, dim));
     if (local_shape[dim] == 0)
     {
       // No data, shape is empty.
@@ -157,6 +286,10 @@ inline ShapeTuple get_local_shape(ShapeTuple shape,
 /**
  * Get the indices of a dimension that are present on a given rank.
  *
+ * For Cyclic distributions, the indices are not contiguous: This is
+ * the smallest range containing them, and only every
+ * `get_dim_global_index_stride`-th index in it is present.
+ *
  * @warning This treats a dimension in isolation.
  */
 template <Distribution Dist>
@@ -207,11 +340,28 @@ inline IndexRange get_dim_global_indices<Distribution::Single>(
   return is_root ? IndexRange(0, dim_size) : IndexRange();
 }
 
-inline IndexRange get_dim_global_indices(typename ShapeTuple::type dim_size,
-                                         typename ShapeTuple::size_type dim,
-                                         ProcessorGrid const& proc_grid,
-                                         Distribution dist,
-                                         RankType grid_rank)
+template <>
+inline IndexRange get_dim_global_indices<Distribution::Cyclic>(
+  typename ShapeTuple::type dim_size,
+  typename ShapeTuple::type grid_dim_size,
+  RankType grid_dim_rank,
+  bool /*is_root*/)
+{
+  ShapeTuple::type const local_size = get_dim_local_size<Distribution::Cyclic>(
+    dim_size, grid_dim_size, grid_dim_rank, false);
+  ShapeTuple::type const start = static_cast<ShapeTuple::type>(grid_dim_rank);
+  return (local_size == 0)
+           ? IndexRange()
+           : IndexRange(start, start + (local_size - 1) * grid_dim_size + 1);
+}
+
+inline IndexRange
+get_dim_global_indices(typename ShapeTuple::type dim_size,
+                       typename ShapeTuple::size_type dim,
+                       ProcessorGrid const& proc_grid,
+                       Distribution dist,
+                       RankType grid_rank,
+                       BlockSizes const& block_sizes = BlockSizes{})
 {
   H2_ASSERT_DEBUG(grid_rank < proc_grid.size(),
                   "Invalid grid rank ",
@@ -232,6 +382,19 @@ inline IndexRange get_dim_global_indices(typename ShapeTuple::type dim_size,
   case Distribution::Single:
     return get_dim_global_indices<Distribution::Single>(
       dim_size, grid_dim_size, grid_dim_rank, grid_dim_rank == 0);
+  case Distribution::Cyclic:
+    return get_dim_global_indices<Distribution::Cyclic>(
+      dim_size, grid_dim_size, grid_dim_rank, false);
+  case Distribution::Variable:
+  {
+    check_variable_block_sizes(block_sizes, grid_dim_size);
+    if (block_sizes[grid_dim_rank] == 0)
+    {
+      return IndexRange();
+    }
+    DimType const start = get_variable_block_start(block_sizes, grid_dim_rank);
+    return IndexRange(start, start + block_sizes[grid_dim_rank]);
+  }
   default: H2_ASSERT_ALWAYS(false, "Invalid distribution ", dist);
   }
 }
@@ -248,17 +411,27 @@ inline IndexRange get_dim_global_indices(typename ShapeTuple::type dim_size,
 /**
  * Get the indices present on a rank given a global shape,
  * processor grid, and distributions.
+ *
+ * With Cyclic distributions, only some of these are present; see
+ * `get_global_index_strides`.
  */
-inline IndexRangeTuple get_global_indices(ShapeTuple global_shape,
-                                          ProcessorGrid const& proc_grid,
-                                          DistributionTypeTuple dist,
-                                          RankType grid_rank)
+inline IndexRangeTuple
+get_global_indices(ShapeTuple global_shape,
+                   ProcessorGrid const& proc_grid,
+                   DistributionTypeTuple dist,
+                   RankType grid_rank,
+                   BlockSizesTuple const& block_sizes = {})
 {
   IndexRangeTuple indices(TuplePad<IndexRangeTuple>(global_shape.size()));
   for (typename ShapeTuple::size_type dim = 0; dim < global_shape.size(); ++dim)
   {
-    indices[dim] = get_dim_global_indices(
-      global_shape[dim], dim, proc_grid, dist[dim], grid_rank);
+    indices[dim] =
+      get_dim_global_indices(global_shape[dim],
+                             dim,
+                             proc_grid,
+                             dist[dim],
+                             grid_rank,
+                             get_dim_block_sizes(block_sizes, dim));
     if (indices[dim].is_empty())
     {
       // No data, set all dimension indices to 0.
@@ -275,6 +448,45 @@ inline IndexRangeTuple get_global_indices(ShapeTuple global_shape,
   return get_global_indices(global_shape, proc_grid, dist, proc_grid.rank());
 }
 
+/**
+ * Return the distance between consecutive global indices of a
+ * dimension that are on the same rank.
+ *
+ * This is 1 except for Cyclic distributions.
+ */
+inline typename ShapeTuple::type
+get_dim_global_index_stride(typename ShapeTuple::size_type dim,
+                            ProcessorGrid const& proc_grid,
+                            Distribution dist)
+{
+  return (dist == Distribution::Cyclic) ? proc_grid.shape(dim)
+                                        : ShapeTuple::type{1};
+}
+
+/**
+ * Return the distance between consecutive global indices on the same
+ * rank in each dimension.
+ *
+ * Local index `i` corresponds to the global index
+ * `start + i * stride` in each dimension, where `start` is the start
+ * of `get_global_indices`.
+ */
+inline StrideTuple get_global_index_strides(ProcessorGrid const& proc_grid,
+                                            DistributionTypeTuple dist)
+{
+  return map_index(dist, [&](DistributionTypeTuple::size_type dim) {
+    return static_cast<StrideTuple::type>(
+      get_dim_global_index_stride(dim, proc_grid, dist[dim]));
+  });
+}
+
+/** Return true if any dimension of `dist` is Cyclic. */
+inline bool has_cyclic_dist(DistributionTypeTuple const& dist)
+{
+  return any_of(dist,
+                [](Distribution d) { return d == Distribution::Cyclic; });
+}
+
 /**
  * Convert a global index to a local index for a dimension.
  *
@@ -322,11 +534,22 @@ inline DimType dim_global2local_index<Distribution::Single>(
   return global_index;
 }
 
-inline DimType dim_global2local_index(typename ShapeTuple::type dim_size,
-                                      typename ShapeTuple::size_type dim,
-                                      ProcessorGrid const& proc_grid,
-                                      Distribution dist,
-                                      DimType global_index)
+template <>
+inline DimType dim_global2local_index<Distribution::Cyclic>(
+  typename ShapeTuple::type /*dim_size*/,
+  typename ShapeTuple::type grid_dim_size,
+  DimType global_index)
+{
+  return global_index / grid_dim_size;
+}
+
+inline DimType
+dim_global2local_index(typename ShapeTuple::type dim_size,
+                       typename ShapeTuple::size_type dim,
+                       ProcessorGrid const& proc_grid,
+                       Distribution dist,
+                       DimType global_index,
+                       BlockSizes const& block_sizes = BlockSizes{})
 {
   H2_ASSERT_DEBUG(global_index < dim_size,
                   "Invalid global index ",
@@ -346,25 +569,41 @@ inline DimType dim_global2local_index(typename ShapeTuple::type dim_size,
   case Distribution::Single:
     return dim_global2local_index<Distribution::Single>(
       dim_size, grid_dim_size, global_index);
+  case Distribution::Cyclic:
+    return dim_global2local_index<Distribution::Cyclic>(
+      dim_size, grid_dim_size, global_index);
+  case Distribution::Variable:
+    check_variable_block_sizes(block_sizes, grid_dim_size);
+    return global_index
+           - get_variable_block_start(
+             block_sizes, get_variable_block_rank(block_sizes, global_index));
   default: H2_ASSERT_ALWAYS(false, "Invalid distribution ", dist);
   }
 }
 
-inline ScalarIndexTuple global2local_index(ShapeTuple global_shape,
-                                           ProcessorGrid const& proc_grid,
-                                           DistributionTypeTuple dist,
-                                           ScalarIndexTuple global_index)
+inline ScalarIndexTuple
+global2local_index(ShapeTuple global_shape,
+                   ProcessorGrid const& proc_grid,
+                   DistributionTypeTuple dist,
+                   ScalarIndexTuple global_index,
+                   BlockSizesTuple const& block_sizes = {})
 {
   return map_index(global_index, [&](ScalarIndexTuple::size_type dim) {
-    return dim_global2local_index(
-      global_shape[dim], dim, proc_grid, dist[dim], global_index[dim]);
+    return dim_global2local_index(global_shape[dim],
+                                  dim,
+                                  proc_grid,
+                                  dist[dim],
+                                  global_index[dim],
+                                  get_dim_block_sizes(block_sizes, dim));
   });
 }
 
-inline IndexRangeTuple global2local_indices(ShapeTuple global_shape,
-                                            ProcessorGrid const& proc_grid,
-                                            DistributionTypeTuple dist,
-                                            IndexRangeTuple global_indices)
+inline IndexRangeTuple
+global2local_indices(ShapeTuple global_shape,
+                     ProcessorGrid const& proc_grid,
+                     DistributionTypeTuple dist,
+                     IndexRangeTuple global_indices,
+                     BlockSizesTuple const& block_sizes = {})
 {
   H2_ASSERT_DEBUG(!any_of(global_indices,
                           [](typename IndexRangeTuple::type const& c) {
@@ -375,28 +614,33 @@ inline IndexRangeTuple global2local_indices(ShapeTuple global_shape,
   return map_index(global_indices, [&](IndexRangeTuple::size_type dim) {
     if (global_indices[dim].is_scalar())
     {
-      return IndexRange(dim_global2local_index(global_shape[dim],
-                                               dim,
-                                               proc_grid,
-                                               dist[dim],
-                                               global_indices[dim].start()));
+      return IndexRange(
+        dim_global2local_index(global_shape[dim],
+                               dim,
+                               proc_grid,
+                               dist[dim],
+                               global_indices[dim].start(),
+                               get_dim_block_sizes(block_sizes, dim)));
     }
     else
     {
       // This is a half-open range, hence the end index may not be one
       // that exists in the shape. We subtract one to work with a valid
       // index, and then add 1 to restore the original half-open range.
-      return IndexRange(dim_global2local_index(global_shape[dim],
-                                               dim,
-                                               proc_grid,
-                                               dist[dim],
-                                               global_indices[dim].start()),
-                        dim_global2local_index(global_shape[dim],
-                                               dim,
-                                               proc_grid,
-                                               dist[dim],
-                                               global_indices[dim].end() - 1)
-                          + 1);
+      return IndexRange(
+        dim_global2local_index(global_shape[dim],
+                               dim,
+                               proc_grid,
+                               dist[dim],
+                               global_indices[dim].start(),
+                               get_dim_block_sizes(block_sizes, dim)),
+        dim_global2local_index(global_shape[dim],
+                               dim,
+                               proc_grid,
+                               dist[dim],
+                               global_indices[dim].end() - 1,
+                               get_dim_block_sizes(block_sizes, dim))
+          + 1);
     }
   });
 }
@@ -444,11 +688,21 @@ inline RankType dim_global2rank<Distribution::Single>(
   return 0;  // Data is always present on the root.
 }
 
+template <>
+inline RankType
+dim_global2rank<Distribution::Cyclic>(typename ShapeTuple::type /*dim_size*/,
+                                      typename ShapeTuple::type grid_dim_size,
+                                      DimType global_index)
+{
+  return global_index % grid_dim_size;
+}
+
 inline RankType dim_global2rank(typename ShapeTuple::type dim_size,
                                 typename ShapeTuple::size_type dim,
                                 ProcessorGrid const& proc_grid,
                                 Distribution dist,
-                                DimType global_index)
+                                DimType global_index,
+                                BlockSizes const& block_sizes = BlockSizes{})
 {
   H2_ASSERT_DEBUG(global_index < dim_size,
                   "Invalid global index ",
@@ -469,6 +723,12 @@ inline RankType dim_global2rank(typename ShapeTuple::type dim_size,
   case Distribution::Single:
     return dim_global2rank<Distribution::Single>(
       dim_size, grid_dim_size, global_index);
+  case Distribution::Cyclic:
+    return dim_global2rank<Distribution::Cyclic>(
+      dim_size, grid_dim_size, global_index);
+  case Distribution::Variable:
+    check_variable_block_sizes(block_sizes, grid_dim_size);
+    return get_variable_block_rank(block_sizes, global_index);
   default: H2_ASSERT_ALWAYS(false, "Invalid distribution ", dist);
   }
 }
@@ -476,12 +736,17 @@ inline RankType dim_global2rank(typename ShapeTuple::type dim_size,
 inline RankType global2rank(ShapeTuple global_shape,
                             ProcessorGrid const& proc_grid,
                             DistributionTypeTuple dist,
-                            ScalarIndexTuple global_index)
+                            ScalarIndexTuple global_index,
+                            BlockSizesTuple const& block_sizes = {})
 {
   ScalarIndexTuple grid_index =
     map_index(global_index, [&](ScalarIndexTuple::size_type dim) {
-      return dim_global2rank(
-        global_shape[dim], dim, proc_grid, dist[dim], global_index[dim]);
+      return dim_global2rank(global_shape[dim],
+                             dim,
+                             proc_grid,
+                             dist[dim],
+                             global_index[dim],
+                             get_dim_block_sizes(block_sizes, dim));
     });
   return proc_grid.rank(grid_index);
 }
@@ -536,12 +801,24 @@ inline DimType dim_local2global_index<Distribution::Single>(
   return local_index;
 }
 
-inline DimType dim_local2global_index(typename ShapeTuple::type dim_size,
-                                      typename ShapeTuple::size_type dim,
-                                      ProcessorGrid const& proc_grid,
-                                      Distribution dist,
-                                      RankType grid_dim_rank,
-                                      DimType local_index)
+template <>
+inline DimType dim_local2global_index<Distribution::Cyclic>(
+  typename ShapeTuple::type /*dim_size*/,
+  typename ShapeTuple::type grid_dim_size,
+  RankType grid_dim_rank,
+  DimType local_index)
+{
+  return grid_dim_rank + local_index * grid_dim_size;
+}
+
+inline DimType
+dim_local2global_index(typename ShapeTuple::type dim_size,
+                       typename ShapeTuple::size_type dim,
+                       ProcessorGrid const& proc_grid,
+                       Distribution dist,
+                       RankType grid_dim_rank,
+                       DimType local_index,
+                       BlockSizes const& block_sizes = BlockSizes{})
 {
   H2_ASSERT_DEBUG(grid_dim_rank < proc_grid.shape(dim),
                   "Invalid grid dimension rank ",
@@ -568,19 +845,32 @@ inline DimType dim_local2global_index(typename ShapeTuple::type dim_size,
   case Distribution::Single:
     return dim_local2global_index<Distribution::Single>(
       dim_size, grid_dim_size, grid_dim_rank, local_index);
+  case Distribution::Cyclic:
+    return dim_local2global_index<Distribution::Cyclic>(
+      dim_size, grid_dim_size, grid_dim_rank, local_index);
+  case Distribution::Variable:
+    check_variable_block_sizes(block_sizes, grid_dim_size);
+    return get_variable_block_start(block_sizes, grid_dim_rank) + local_index;
   default: H2_ASSERT_ALWAYS(false, "Invalid distribution ", dist);
   }
 }
 
-inline ScalarIndexTuple local2global_index(ShapeTuple global_shape,
-                                           ProcessorGrid const& proc_grid,
-                                           DistributionTypeTuple dist,
-                                           RankType grid_rank,
-                                           ScalarIndexTuple local_index)
+inline ScalarIndexTuple
+local2global_index(ShapeTuple global_shape,
+                   ProcessorGrid const& proc_grid,
+                   DistributionTypeTuple dist,
+                   RankType grid_rank,
+                   ScalarIndexTuple local_index,
+                   BlockSizesTuple const& block_sizes = {})
 {
   return map_index(local_index, [&](ScalarIndexTuple::size_type dim) {
-    H2_ASSERT_DEBUG(local_index[dim] < get_dim_local_size(
-                      global_shape[dim], dim, proc_grid, dist[dim], grid_rank),
+    BlockSizes const& dim_block_sizes = get_dim_block_sizes(block_sizes, dim);
+    H2_ASSERT_DEBUG(local_index[dim] < get_dim_local_size(global_shape[dim],
+                                                          dim,
+                                                          proc_grid,
+                                                          dist[dim],
+                                                          grid_rank,
+                                                          dim_block_sizes),
                     "Invalid local index ",
                     local_index);
     return dim_local2global_index(global_shape[dim],
@@ -588,7 +878,8 @@ inline ScalarIndexTuple local2global_index(ShapeTuple global_shape,
                                   proc_grid,
                                   dist[dim],
                                   proc_grid.get_dimension_rank(dim, grid_rank),
-                                  local_index[dim]);
+                                  local_index[dim],
+                                  dim_block_sizes);
   });
 }
 
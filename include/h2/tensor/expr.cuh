@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * GPU evaluation of lazy element-wise tensor expressions.
+ *
+ * Include this in a GPU translation unit to evaluate expressions from
+ * `h2/tensor/expr.hpp` on GPU tensors there.
+ */
+
+#include "h2/loops/gpu_loops.cuh"
+#include "h2/tensor/expr.hpp"
+
+namespace h2
+{
+namespace lazy
+{
+namespace impl
+{
+
+template <typename T, typename ExprT>
+void assign_impl(GPUDev_t, Tensor<T>& dst, ExprT const& expr)
+{
+  ExprFunctionT<T, ExprT> const func{expr};
+  std::apply(
+    [&](auto const*... srcs) {
+      auto stream =
+        create_multi_sync(dst.get_stream(), srcs->get_stream()...);
+      h2::gpu::launch_strided_elementwise_loop(
+        func,
+        stream,
+        dst.shape(),
+        {dst.strides(), srcs->strides()...},
+        dst.data(),
+        srcs->const_data()...);
+    },
+    expr.leaves());
+}
+
+}  // namespace impl
+}  // namespace lazy
+}  // namespace h2
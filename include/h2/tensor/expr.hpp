@@ -0,0 +1,483 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Lazy element-wise tensor expressions.
+ *
+ * Wrapping tensors with `lazy::ref` opts in to building expression
+ * trees with the usual arithmetic and comparison operators instead of
+ * evaluating each operation on its own. Nothing is computed until the
+ * expression is assigned to a tensor with `lazy::assign`, which
+ * evaluates the whole tree in a single strided element-wise loop, with
+ * no temporaries:
+ *
+ * ```
+ * lazy::assign(out, lazy::ref(a) * lazy::ref(b) + 2.0f);
+ * lazy::assign(mask, lazy::cast<float>(lazy::ref(a) > 0.0f));
+ * ```
+ *
+ * Scalars in an expression are stored by value in the fused function,
+ * so they are passed to GPU kernels as arguments rather than loaded
+ * from memory. Every tensor referenced by an expression must have the
+ * same shape and be on the same device; there is no broadcasting
+ * other than for scalars. Tensors are referenced, not copied, and must
+ * outlive the expression.
+ *
+ * CPU evaluation is available everywhere. GPU evaluation needs the
+ * kernel for the expression, which is instantiated by including
+ * `h2/tensor/expr.cuh` in a GPU translation unit.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+#include "h2/core/dispatch.hpp"
+#include "h2/core/profiling.hpp"
+#include "h2/gpu/macros.hpp"
+#include "h2/loops/cpu_loops.hpp"
+#include "h2/meta/TypeList.hpp"
+#include "h2/tensor/tensor.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace h2
+{
+namespace lazy
+{
+
+/** Leaf of an expression referencing a tensor. */
+template <typename T>
+struct TensorRef
+{
+  using value_type = T;
+  /** Types of the values of the tensors in this expression, in order. */
+  using LeafTypes = meta::TL<T>;
+  /** Number of tensors referenced by this expression. */
+  static constexpr std::size_t num_leaves = 1;
+
+  Tensor<T> const* tensor;
+
+  /**
+   * Evaluate the expression given the values of all leaves of the
+   * enclosing expression, where this expression's leaves start at
+   * `Offset`.
+   */
+  template <std::size_t Offset, typename TupleT>
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE T eval(TupleT const& vals) const
+  {
+    return std::get<Offset>(vals);
+  }
+
+  /** Return a tuple of the tensors referenced by this expression. */
+  std::tuple<Tensor<T> const*> leaves() const { return {tensor}; }
+};
+
+/** Leaf of an expression holding a scalar. */
+template <typename T>
+struct Scalar
+{
+  using value_type = T;
+  using LeafTypes = meta::TL<>;
+  static constexpr std::size_t num_leaves = 0;
+
+  T value;
+
+  template <std::size_t Offset, typename TupleT>
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE T eval(TupleT const&) const
+  {
+    return value;
+  }
+
+  std::tuple<> leaves() const { return {}; }
+};
+
+namespace internal
+{
+
+/** Return the number of leaves in the expressions before the `I`th. */
+template <std::size_t I, typename... ExprTs>
+constexpr std::size_t leaf_offset()
+{
+  constexpr std::size_t counts[] = {ExprTs::num_leaves..., 0};
+  std::size_t offset = 0;
+  for (std::size_t i = 0; i < I; ++i)
+  {
+    offset += counts[i];
+  }
+  return offset;
+}
+
+}  // namespace internal
+
+/** Expression applying `OpT` element-wise to its child expressions. */
+template <typename OpT, typename... ExprTs>
+struct MapExpr
+{
+  static_assert(sizeof...(ExprTs) > 0,
+                "Mapped expressions need at least one argument");
+
+  using value_type = decltype(std::declval<OpT const&>()(
+    std::declval<typename ExprTs::value_type>()...));
+  using LeafTypes = meta::tlist::Append<typename ExprTs::LeafTypes...>;
+  static constexpr std::size_t num_leaves = (ExprTs::num_leaves + ...);
+
+  OpT op;
+  std::tuple<ExprTs...> children;
+
+  template <std::size_t Offset, typename TupleT>
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE value_type
+  eval(TupleT const& vals) const
+  {
+    return eval_children<Offset>(vals,
+                                 std::index_sequence_for<ExprTs...>{});
+  }
+
+  auto leaves() const
+  {
+    return std::apply(
+      [](auto const&... child) { return std::tuple_cat(child.leaves()...); },
+      children);
+  }
+
+private:
+  template <std::size_t Offset, typename TupleT, std::size_t... Is>
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE value_type
+  eval_children(TupleT const& vals, std::index_sequence<Is...>) const
+  {
+    return op(std::get<Is>(children)
+                .template eval<Offset
+                               + internal::leaf_offset<Is, ExprTs...>()>(
+                  vals)...);
+  }
+};
+
+/** True if `T` is a lazy expression. */
+template <typename T>
+struct IsExpr : std::false_type
+{};
+template <typename T>
+struct IsExpr<TensorRef<T>> : std::true_type
+{};
+template <typename T>
+struct IsExpr<Scalar<T>> : std::true_type
+{};
+template <typename OpT, typename... ExprTs>
+struct IsExpr<MapExpr<OpT, ExprTs...>> : std::true_type
+{};
+template <typename T>
+inline constexpr bool IsExpr_v = IsExpr<std::decay_t<T>>::value;
+
+/** True if `T` may be an operand of an expression operator. */
+template <typename T>
+inline constexpr bool IsOperand_v =
+  IsExpr_v<T> || std::is_arithmetic_v<std::decay_t<T>>;
+
+/** True if at least one of `Ts` is an expression and all are operands. */
+template <typename... Ts>
+inline constexpr bool IsExprOperands_v =
+  (IsExpr_v<Ts> || ...) && (IsOperand_v<Ts> && ...);
+
+/** Begin a lazy expression with the tensor `tensor`. */
+template <typename T>
+TensorRef<T> ref(Tensor<T> const& tensor)
+{
+  return TensorRef<T>{&tensor};
+}
+
+/** Return `val` as an expression, wrapping scalars. */
+template <typename T>
+auto as_expr(T const& val)
+{
+  if constexpr (IsExpr_v<T>)
+  {
+    return val;
+  }
+  else
+  {
+    return Scalar<T>{val};
+  }
+}
+
+/**
+ * Return an expression applying `op` element-wise to `args`.
+ *
+ * `op` must be callable with the value types of `args`, and from
+ * device code when evaluated on GPUs (e.g., a `H2_GPU_LAMBDA`).
+ */
+template <typename OpT, typename... ArgTs>
+auto map(OpT op, ArgTs const&... args)
+{
+  return MapExpr<OpT, decltype(as_expr(args))...>{
+    op, std::make_tuple(as_expr(args)...)};
+}
+
+namespace ops
+{
+
+#define H2_LAZY_DEFINE_BINARY_OP(name, op)                                     \
+  struct name                                                                  \
+  {                                                                            \
+    template <typename A, typename B>                                          \
+    H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE auto operator()(A a, B b) const     \
+    {                                                                          \
+      return a op b;                                                           \
+    }                                                                          \
+  }
+
+H2_LAZY_DEFINE_BINARY_OP(Add, +);
+H2_LAZY_DEFINE_BINARY_OP(Sub, -);
+H2_LAZY_DEFINE_BINARY_OP(Mul, *);
+H2_LAZY_DEFINE_BINARY_OP(Div, /);
+H2_LAZY_DEFINE_BINARY_OP(Less, <);
+H2_LAZY_DEFINE_BINARY_OP(LessEqual, <=);
+H2_LAZY_DEFINE_BINARY_OP(Greater, >);
+H2_LAZY_DEFINE_BINARY_OP(GreaterEqual, >=);
+H2_LAZY_DEFINE_BINARY_OP(Equal, ==);
+H2_LAZY_DEFINE_BINARY_OP(NotEqual, !=);
+
+#undef H2_LAZY_DEFINE_BINARY_OP
+
+struct Negate
+{
+  template <typename A>
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE auto operator()(A a) const
+  {
+    return -a;
+  }
+};
+
+struct Minimum
+{
+  template <typename A, typename B>
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE auto operator()(A a, B b) const
+  {
+    return b < a ? b : a;
+  }
+};
+
+struct Maximum
+{
+  template <typename A, typename B>
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE auto operator()(A a, B b) const
+  {
+    return a < b ? b : a;
+  }
+};
+
+struct Where
+{
+  template <typename C, typename A, typename B>
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE std::common_type_t<A, B>
+  operator()(C cond, A a, B b) const
+  {
+    return cond ? a : b;
+  }
+};
+
+template <typename T>
+struct Cast
+{
+  template <typename A>
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE T operator()(A a) const
+  {
+    return static_cast<T>(a);
+  }
+};
+
+}  // namespace ops
+
+#define H2_LAZY_DEFINE_BINARY_OPERATOR(op, name)                               \
+  template <typename A,                                                        \
+            typename B,                                                        \
+            std::enable_if_t<IsExprOperands_v<A, B>, bool> = true>             \
+  auto operator op(A const& a, B const& b)                                     \
+  {                                                                            \
+    return map(ops::name{}, a, b);                                             \
+  }
+
+H2_LAZY_DEFINE_BINARY_OPERATOR(+, Add)
+H2_LAZY_DEFINE_BINARY_OPERATOR(-, Sub)
+H2_LAZY_DEFINE_BINARY_OPERATOR(*, Mul)
+H2_LAZY_DEFINE_BINARY_OPERATOR(/, Div)
+H2_LAZY_DEFINE_BINARY_OPERATOR(<, Less)
+H2_LAZY_DEFINE_BINARY_OPERATOR(<=, LessEqual)
+H2_LAZY_DEFINE_BINARY_OPERATOR(>, Greater)
+H2_LAZY_DEFINE_BINARY_OPERATOR(>=, GreaterEqual)
+H2_LAZY_DEFINE_BINARY_OPERATOR(==, Equal)
+H2_LAZY_DEFINE_BINARY_OPERATOR(!=, NotEqual)
+
+#undef H2_LAZY_DEFINE_BINARY_OPERATOR
+
+template <typename A, std::enable_if_t<IsExpr_v<A>, bool> = true>
+auto operator-(A const& a)
+{
+  return map(ops::Negate{}, a);
+}
+
+/** Element-wise minimum of `a` and `b`. */
+template <typename A,
+          typename B,
+          std::enable_if_t<IsExprOperands_v<A, B>, bool> = true>
+auto minimum(A const& a, B const& b)
+{
+  return map(ops::Minimum{}, a, b);
+}
+
+/** Element-wise maximum of `a` and `b`. */
+template <typename A,
+          typename B,
+          std::enable_if_t<IsExprOperands_v<A, B>, bool> = true>
+auto maximum(A const& a, B const& b)
+{
+  return map(ops::Maximum{}, a, b);
+}
+
+/** Element-wise `cond ? a : b`. */
+template <typename C,
+          typename A,
+          typename B,
+          std::enable_if_t<IsExprOperands_v<C, A, B>, bool> = true>
+auto where(C const& cond, A const& a, B const& b)
+{
+  return map(ops::Where{}, cond, a, b);
+}
+
+/** Element-wise cast of `a` to `T`. */
+template <typename T, typename A, std::enable_if_t<IsExpr_v<A>, bool> = true>
+auto cast(A const& a)
+{
+  return map(ops::Cast<T>{}, a);
+}
+
+/**
+ * The fused function for `ExprT`, which takes the values of its leaves
+ * (as listed in `LeafList`) and returns the value of the expression as
+ * an `OutT`.
+ *
+ * This has a concrete signature so it can be used with the
+ * element-wise loops.
+ */
+template <typename ExprT, typename OutT, typename LeafList>
+struct ExprFunction;
+
+template <typename ExprT, typename OutT, typename... LeafTs>
+struct ExprFunction<ExprT, OutT, meta::TL<LeafTs...>>
+{
+  ExprT expr;
+
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE OutT operator()(LeafTs... vals) const
+  {
+    return static_cast<OutT>(
+      expr.template eval<0>(std::tuple<LeafTs...>{vals...}));
+  }
+};
+
+template <typename OutT, typename ExprT>
+using ExprFunctionT = ExprFunction<ExprT, OutT, typename ExprT::LeafTypes>;
+
+namespace impl
+{
+
+template <typename T, typename ExprT>
+void assign_impl(CPUDev_t, Tensor<T>& dst, ExprT const& expr)
+{
+  ExprFunctionT<T, ExprT> const func{expr};
+  std::apply(
+    [&](auto const*... srcs) {
+      h2::cpu::strided_elementwise_loop(func,
+                                        dst.shape(),
+                                        {dst.strides(), srcs->strides()...},
+                                        dst.data(),
+                                        srcs->const_data()...);
+    },
+    expr.leaves());
+}
+
+#ifdef H2_HAS_GPU
+// Defined in expr.cuh.
+template <typename T, typename ExprT>
+void assign_impl(GPUDev_t, Tensor<T>& dst, ExprT const& expr);
+#endif
+
+}  // namespace impl
+
+/**
+ * Evaluate `expr` into `dst` in one fused element-wise loop.
+ *
+ * `dst` is resized to the shape of the tensors in `expr` if it is not a
+ * view; an expression of only scalars fills `dst` as it is. `dst` must
+ * be on the same device as those tensors, and may itself appear in
+ * `expr` (e.g., `assign(a, ref(a) * 2)`), but must not otherwise
+ * overlap them. On GPUs, this is asynchronous and needs `expr.cuh` (see
+ * above).
+ */
+template <typename T,
+          typename ExprT,
+          std::enable_if_t<IsExpr_v<ExprT>, bool> = true>
+void assign(Tensor<T>& dst, ExprT const& expr)
+{
+  H2_PROFILE_RANGE("h2::lazy::assign", Compute);
+  H2_ASSERT_ALWAYS(!dst.is_const_view(), "Cannot assign to a const view");
+  BaseTensor const* first = nullptr;
+  auto const check_src = [&](BaseTensor const* src) {
+    if (first == nullptr)
+    {
+      first = src;
+      return;
+    }
+    H2_ASSERT_ALWAYS(src->shape() == first->shape(),
+                     "Tensors in an expression must have the same shape, got ",
+                     src->shape(),
+                     " and ",
+                     first->shape());
+    H2_ASSERT_ALWAYS(src->get_device() == first->get_device(),
+                     "Tensors in an expression must be on the same device, "
+                     "got ",
+                     src->get_device(),
+                     " and ",
+                     first->get_device());
+  };
+  std::apply([&](auto const*... srcs) { (check_src(srcs), ...); },
+             expr.leaves());
+  if (first != nullptr)
+  {
+    H2_ASSERT_ALWAYS(dst.get_device() == first->get_device(),
+                     "Cannot assign an expression on ",
+                     first->get_device(),
+                     " to a tensor on ",
+                     dst.get_device());
+    if (dst.is_view())
+    {
+      H2_ASSERT_ALWAYS(dst.shape() == first->shape(),
+                       "Cannot assign an expression of shape ",
+                       first->shape(),
+                       " to a view of shape ",
+                       dst.shape());
+    }
+    else if (dst.shape() != first->shape())
+    {
+      dst.resize(first->shape(), first->dim_types());
+    }
+  }
+  if (dst.is_empty())
+  {
+    return;
+  }
+  dst.ensure();
+  H2_DEVICE_DISPATCH_SAME(dst.get_device(),
+                          impl::assign_impl(DeviceT_v<Dev>, dst, expr));
+}
+
+}  // namespace lazy
+}  // namespace h2
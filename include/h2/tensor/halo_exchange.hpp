@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Halo (ghost region) exchanges for distributed tensors.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/dist_tensor.hpp"
+#include "h2/tensor/proc_grid.hpp"
+#include "h2/tensor/tensor_base.hpp"
+#include "h2/tensor/tensor_types.hpp"
+#include "h2/utils/Error.hpp"
+
+namespace h2
+{
+
+namespace internal
+{
+
+/**
+ * Fill the ghost regions of `padded_local`, which is a local tensor
+ * with `halo` ghost entries on each side of each dimension, from
+ * neighboring ranks in `grid`.
+ */
+void exchange_halo(BaseTensor& padded_local,
+                   ShapeTuple const& halo,
+                   ProcessorGrid const& grid);
+
+}  // namespace internal
+
+/**
+ * Fill the ghost regions of `tensor` (see `DistTensor::set_halo`) with
+ * the boundary entries of the neighboring ranks.
+ *
+ * Every rank in the tensor's processor grid must call this. Dimensions
+ * are exchanged in order, each including the ghost regions of the
+ * others, so corner regions are filled too. Ghost regions on the
+ * boundary of the global tensor (which have no neighbor) are left
+ * unchanged.
+ *
+ * Communication is ordered after prior work on the tensor's compute
+ * stream, and the ghost regions are written on that stream. The
+ * exchange itself uses host-staged MPI on the grid's per-dimension
+ * sub-communicators, so this returns once the messages have arrived.
+ */
+template <typename T>
+void exchange_halo(DistTensor<T>& tensor)
+{
+  if (!tensor.has_halo() || tensor.is_local_empty())
+  {
+    return;
+  }
+  H2_ASSERT_ALWAYS(tensor.const_data() != nullptr,
+                   "Cannot exchange the halo of a tensor with no data");
+  internal::exchange_halo(
+    tensor.local_tensor_with_halo(), tensor.halo(), tensor.proc_grid());
+}
+
+}  // namespace h2
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "h2/tensor/copy.hpp"
 #include "h2/tensor/dist_tensor.hpp"
 #include "h2/tensor/proc_grid.hpp"
 #include "h2/tensor/tensor_types.hpp"
@@ -17,6 +18,7 @@
 #include <type_traits>
 
 #include "interop_utils.hpp"
+#include "local_tensor_interop.hpp"
 
 namespace h2
 {
@@ -52,6 +54,23 @@ inline constexpr Distribution to_h2_dist(El::Dist d) noexcept
   }
 }
 
+/**
+ * Return true if a dimension distributed with `dist` can be viewed as
+ * one distributed with the Hydrogen distribution `d`.
+ *
+ * Cyclic is exactly Hydrogen's element-cyclic distribution (with zero
+ * alignment), while Block has the same local sizes.
+ */
+inline constexpr bool is_compatible_dist(Distribution dist,
+                                         El::Dist d) noexcept
+{
+  if (dist == Distribution::Cyclic)
+  {
+    return to_h2_dist(d) == Distribution::Block;
+  }
+  return dist == to_h2_dist(d);
+}
+
 inline El::mpi::Comm const&
 logical_1d_comm(El::Grid const& g, El::Dist coldist, El::Dist rowdist) noexcept
 {
@@ -320,8 +339,8 @@ void assert_valid_conversion_to_h(DistTensor<T> const& tensor,
             "Tensor must be 2D to zero-copy-convert to Hydrogen");
 
   H2_ASSERT(
-    (tensor.distribution()
-     == DistributionTypeTuple{to_h2_dist(coldist), to_h2_dist(rowdist)}),
+    (is_compatible_dist(tensor.distribution(0), coldist)
+     && is_compatible_dist(tensor.distribution(1), rowdist)),
     std::logic_error,
     "Tensor distribution must be compatible with desired Hydrogen "
     "distribution.");
@@ -351,6 +370,9 @@ void assert_valid_conversion_to_h(DistTensor<T> const& tensor,
                == make_canonical_grid_shape(grid, coldist, rowdist)),
               std::logic_error,
               "Grid and process grid must be same shape.");
+    H2_ASSERT((tensor.proc_grid().dim_order() == DimensionOrderTuple{0, 1}),
+              std::logic_error,
+              "Process grid must use the default dimension order.");
   }
 }
 
@@ -430,18 +452,13 @@ void as_h_matrix_impl(T* buffer,
 
 // Sets up the synchronization mechanics for the matrix.
 template <typename T>
-void set_sync(El::AbstractDistMatrix<T>& mat, ComputeStream stream)
+void set_sync(El::AbstractDistMatrix<T>& mat, ComputeStream const& stream)
 {
-  // Hydrogen doesn't have "real" sync objects for CPU, so we only
-  // care about the GPU case.
 #ifdef H2_HAS_GPU
   if (mat.GetLocalDevice() == El::Device::GPU)
   {
     constexpr auto D = El::Device::GPU;
-    auto& loc = static_cast<El::Matrix<T, D>&>(mat.Matrix());
-    El::SetSyncInfo(loc,
-                    El::SyncInfo<D>{stream.get_stream<D>(),
-                                    internal::get_default_event<D>()});
+    set_sync(static_cast<El::Matrix<T, D>&>(mat.Matrix()), stream);
   }
 #endif
 }
@@ -468,7 +485,9 @@ void set_sync(El::AbstractDistMatrix<T>& mat, ComputeStream stream)
  *
  *  The next requirement is that the requested Elemental distribution
  *  must be compatible with the H2 distribution of the tensor. This is
- *  to ensure consistency with zero copy.
+ *  to ensure consistency with zero copy. Block and Cyclic dimensions
+ *  may both be viewed as MC, MR, VC, or VR, but only Cyclic places
+ *  each global index where Hydrogen's element-cyclic layout does.
  *
  *  To further ensure consistency of the parallel distributions, the
  *  respective communicator objects must be congruent. Currently this
@@ -538,4 +557,245 @@ auto as_h_matrix(DistTensor<T> const& tensor,
 
 ///@}
 
+// The conversions above are all zero-copy, so they only work for
+// layouts both libraries can describe. The ones below copy instead:
+// the Hydrogen matrix is viewed as a distributed tensor whose elements
+// are placed exactly as in Hydrogen (element-wise distributions are
+// Cyclic), and the data is moved between that view and the other
+// tensor with `redistribute`, which caches its communication plans.
+
+namespace internal
+{
+
+/**
+ * Return the distribution that places global indices exactly where
+ * the Hydrogen distribution `d` (with zero alignment and root) does.
+ */
+inline constexpr Distribution to_h2_element_dist(El::Dist d) noexcept
+{
+  switch (d)
+  {
+  case El::MC:
+  case El::MR:
+  case El::VC:
+  case El::VR: return Distribution::Cyclic;
+  case El::STAR: return Distribution::Replicated;
+  case El::CIRC: return Distribution::Single;
+  default: return Distribution::Undefined;
+  }
+}
+
+/**
+ * Return a processor grid on which a matrix distributed with
+ * `coldist` and `rowdist` over `g` can be viewed with
+ * `to_h2_element_dist`.
+ *
+ * Row-major 2D distributions are laid out over `VCComm` with the
+ * second grid dimension fastest, which orders ranks the same as
+ * `VRComm`, so that these grids are similar to ones over `VCComm`.
+ */
+inline ProcessorGrid
+make_element_grid(El::Grid const& g, El::Dist coldist, El::Dist rowdist)
+{
+  ShapeTuple const shape = make_canonical_grid_shape(g, coldist, rowdist);
+  if (is_2d_dist(coldist, rowdist)
+      && (coldist == El::MR || rowdist == El::MC))
+  {
+    return ProcessorGrid{g.VCComm(), shape, DimensionOrderTuple{1, 0}};
+  }
+  return ProcessorGrid{logical_1d_comm(g, coldist, rowdist), shape};
+}
+
+/** Return true if `mat` can be viewed with `to_h2_element_dist`. */
+template <typename T>
+bool is_element_viewable(El::AbstractDistMatrix<T> const& mat)
+{
+  return mat.ColAlign() == 0 && mat.RowAlign() == 0 && mat.Root() == 0;
+}
+
+template <El::Device D, typename T, typename U>
+auto make_element_view_impl(T* const buffer,
+                            El::AbstractDistMatrix<U> const& mat,
+                            ProcessorGrid&& g)
+{
+  static_assert(meta::Eq<std::decay_t<T>, U>);
+  return DistTensor<U>{
+    H2Device<D>,
+    buffer,
+    ShapeTuple{safe_as<DimType>(mat.Height()), safe_as<DimType>(mat.Width())},
+    DimensionTypeTuple{DimensionType::Any, DimensionType::Any},
+    std::move(g),
+    DistributionTypeTuple{to_h2_element_dist(mat.ColDist()),
+                          to_h2_element_dist(mat.RowDist())},
+    ShapeTuple{safe_as<DimType>(mat.LocalHeight()),
+               safe_as<DimType>(mat.LocalWidth())},
+    StrideTuple{1, mat.LDim()},
+    ComputeStream{El::SyncInfoFromMatrix(
+      static_cast<El::Matrix<U, D> const&>(mat.LockedMatrix()))}};
+}
+
+/**
+ * View the local data of `mat` (at `buffer`) as a distributed tensor
+ * with the same global element placement.
+ */
+template <typename T, typename U>
+auto make_element_view(T* const buffer,
+                       El::AbstractDistMatrix<U> const& mat) -> DistTensor<U>
+{
+  H2_ASSERT(is_element_viewable(mat),
+            std::logic_error,
+            "Matrix must have zero alignment and root to be viewed");
+  ProcessorGrid g =
+    make_element_grid(mat.Grid(), mat.ColDist(), mat.RowDist());
+  switch (mat.GetLocalDevice())
+  {
+  case El::Device::CPU:
+    return make_element_view_impl<El::Device::CPU>(buffer, mat, std::move(g));
+#ifdef H2_HAS_GPU
+  case El::Device::GPU:
+    return make_element_view_impl<El::Device::GPU>(buffer, mat, std::move(g));
+#endif
+  default: throw std::logic_error("Unknown device.");
+  }
+}
+
+/**
+ * Return a copy of `mat` with zero alignment and root, or null if
+ * `mat` already has them.
+ */
+template <typename T>
+auto make_element_viewable(El::AbstractDistMatrix<T> const& mat)
+  -> std::unique_ptr<El::AbstractDistMatrix<T>>
+{
+  if (is_element_viewable(mat))
+  {
+    return nullptr;
+  }
+  std::unique_ptr<El::AbstractDistMatrix<T>> aligned =
+    make_distmat<T>(
+      mat.GetLocalDevice(), mat.Grid(), mat.ColDist(), mat.RowDist());
+  aligned->Align(0, 0);
+  El::Copy(mat, *aligned);
+  return aligned;
+}
+
+}  // namespace internal
+
+/** @name Hydrogen/DiHydrogen Copying Conversion */
+///@{
+
+/** @brief Copy a Hydrogen distributed matrix into a DiHydrogen
+ *         distributed tensor.
+ *
+ *  Unlike `as_h2_tensor`, this works for any distribution, alignment,
+ *  and leading dimension of `mat` and any distribution and processor
+ *  grid of `tensor`, which must be 2D with `mat`'s shape. The data is
+ *  redistributed directly between the processes that have it and the
+ *  ones that need it. Matrices with nonzero alignment or root are
+ *  first realigned by Hydrogen.
+ *
+ *  `tensor`'s processor grid must be similar to `mat.Grid().VCComm()`
+ *  (or `VRComm()` for (VR, STAR) and (STAR, VR)). This is collective
+ *  and synchronizes with both the tensor's and the matrix's streams.
+ */
+template <typename T>
+void copy_to_h2_tensor(DistTensor<T>& tensor,
+                       El::AbstractDistMatrix<T> const& mat)
+{
+  H2_ASSERT(tensor.ndim() == 2,
+            std::logic_error,
+            "Tensor must be 2D to copy from Hydrogen");
+  H2_ASSERT((tensor.shape()
+             == ShapeTuple{safe_as<DimType>(mat.Height()),
+                           safe_as<DimType>(mat.Width())}),
+            std::logic_error,
+            "Tensor and matrix must have the same shape.");
+  auto const aligned = internal::make_element_viewable(mat);
+  El::AbstractDistMatrix<T> const& src = aligned ? *aligned : mat;
+  DistTensor<T> const view =
+    internal::make_element_view(src.LockedBuffer(), src);
+  redistribute(tensor, view);
+}
+
+/** @brief Copy a Hydrogen distributed matrix into a new DiHydrogen
+ *         distributed tensor.
+ *
+ *  The tensor is distributed with `dist` over `g` and uses the
+ *  matrix's device and stream. See `copy_to_h2_tensor`.
+ */
+template <typename T>
+auto to_h2_tensor(El::AbstractDistMatrix<T> const& mat,
+                  ProcessorGrid g,
+                  DistributionTypeTuple const& dist) -> DistTensor<T>
+{
+  auto const aligned = internal::make_element_viewable(mat);
+  El::AbstractDistMatrix<T> const& src = aligned ? *aligned : mat;
+  DistTensor<T> const view =
+    internal::make_element_view(src.LockedBuffer(), src);
+  DistTensor<T> tensor{view.get_device(),
+                       view.shape(),
+                       view.dim_types(),
+                       std::move(g),
+                       dist,
+                       StrictAlloc,
+                       view.get_stream()};
+  redistribute(tensor, view);
+  return tensor;
+}
+
+/** @brief Copy a DiHydrogen distributed tensor into a Hydrogen
+ *         distributed matrix.
+ *
+ *  Unlike `as_h_matrix`, this works for any 2D `tensor`, including
+ *  non-packed local data and distributions with no zero-copy
+ *  equivalent, and any distribution of `mat`, which is resized to the
+ *  tensor's shape (so views must already have it). Matrices with
+ *  nonzero alignment or root are filled through a realigned temporary.
+ *
+ *  The same requirements on grids as for `copy_to_h2_tensor` apply.
+ */
+template <typename T>
+void copy_to_h_matrix(El::AbstractDistMatrix<T>& mat,
+                      DistTensor<T> const& tensor)
+{
+  H2_ASSERT(tensor.ndim() == 2,
+            std::logic_error,
+            "Tensor must be 2D to copy to Hydrogen");
+  El::Int const height = safe_as<El::Int>(tensor.shape(0));
+  El::Int const width = safe_as<El::Int>(tensor.shape(1));
+  if (mat.Height() != height || mat.Width() != width)
+  {
+    mat.Resize(height, width);
+  }
+  auto const aligned = internal::make_element_viewable(mat);
+  El::AbstractDistMatrix<T>& dst = aligned ? *aligned : mat;
+  DistTensor<T> view = internal::make_element_view(dst.Buffer(), dst);
+  redistribute(view, tensor);
+  if (aligned)
+  {
+    El::Copy(*aligned, mat);
+  }
+}
+
+/** @brief Copy a DiHydrogen distributed tensor into a new Hydrogen
+ *         distributed matrix.
+ *
+ *  The matrix is distributed with `coldist` and `rowdist` over `g`
+ *  and uses the tensor's device and stream. See `copy_to_h_matrix`.
+ */
+template <typename T>
+auto to_h_matrix(DistTensor<T> const& tensor,
+                 El::Grid const& g,
+                 El::Dist coldist,
+                 El::Dist rowdist) -> std::unique_ptr<El::AbstractDistMatrix<T>>
+{
+  std::unique_ptr<El::AbstractDistMatrix<T>> out =
+    internal::make_distmat<T>(tensor.get_device(), g, coldist, rowdist);
+  internal::set_sync(*out, tensor.get_stream());
+  copy_to_h_matrix(*out, tensor);
+  return out;
+}
+
+///@}
+
 }  // namespace h2
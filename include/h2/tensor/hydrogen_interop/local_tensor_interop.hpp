@@ -15,6 +15,7 @@
 #include <cstdint>
 #include <stdexcept>
 #include <type_traits>
+#include <vector>
 
 #include "interop_utils.hpp"
 
@@ -23,16 +24,45 @@ namespace h2
 namespace internal
 {
 
-template <Device D, typename BufferT, typename T>
-auto as_h_mat_impl(BufferT buf,
-                   Tensor<T> const& tensor) -> El::Matrix<T, HydrogenDevice<D>>
+/**
+ * Make `matrix` use `stream`, unless it already does.
+ *
+ * Hydrogen only skips synchronizing matrices whose SyncInfos match
+ * exactly, so this leaves the matrix alone if it already has the
+ * stream's SyncInfo, which for streams from Hydrogen SyncInfos keeps
+ * their event (see `ComputeStream`). Converting a matrix back and
+ * forth on one stream therefore never adds waits.
+ */
+template <typename T, hydrogen::Device D>
+void set_sync(El::Matrix<T, D>& matrix, ComputeStream const& stream)
 {
-  // Enforce usage constraint
-  static_assert(std::is_same_v<std::decay_t<std::remove_pointer_t<BufferT>>, T>,
-                "BufferT must be T* or T const*");
+  // Hydrogen doesn't have "real" sync objects for CPU, so we only
+  // care about the GPU case.
+#ifdef H2_HAS_GPU
+  if constexpr (D == hydrogen::Device::GPU)
+  {
+    auto const sync_info = static_cast<El::SyncInfo<D>>(stream);
+    auto const& current = El::SyncInfoFromMatrix(matrix);
+    if (current.Stream() != sync_info.Stream()
+        || current.Event() != sync_info.Event())
+    {
+      El::SetSyncInfo(matrix, sync_info);
+    }
+  }
+#endif
+}
 
-  using MatrixType = El::Matrix<T, HydrogenDevice<D>>;
-  using h_size_type = typename MatrixType::size_type;
+/** Size and leading dimension of the matrix viewing a tensor. */
+struct HMatLayout
+{
+  El::Int height;
+  El::Int width;
+  El::Int ldim;
+};
+
+template <typename T>
+HMatLayout get_h_mat_layout(Tensor<T> const& tensor)
+{
   if (tensor.is_empty())
     throw std::runtime_error("Cannot convert empty tensor to El::Matrix");
   if (tensor.ndim() > 1 && !is_chw_packed(tensor))
@@ -40,30 +70,68 @@ auto as_h_mat_impl(BufferT buf,
                              "fully-packed or chw-packed tensors");
   if (tensor.ndim() == 1)
   {
-    auto constexpr h_one = h_size_type{1};
-    auto const nelems = safe_as<h_size_type>(tensor.numel());
-    auto const elem_stride = safe_as<h_size_type>(tensor.stride(0));
+    auto constexpr h_one = El::Int{1};
+    auto const nelems = safe_as<El::Int>(tensor.numel());
+    auto const elem_stride = safe_as<El::Int>(tensor.stride(0));
     if (elem_stride == h_one)
-      return MatrixType{nelems, h_one, buf, nelems};
+      return {nelems, h_one, nelems};
     else
-      return MatrixType{h_one, nelems, buf, elem_stride};
+      return {h_one, nelems, elem_stride};
   }
   auto const& shape = tensor.shape();
   auto const& strides = tensor.strides();
-  auto const width = safe_as<h_size_type>(shape.back());
-  auto const height = safe_as<h_size_type>(product<std::uint64_t>(init(shape)));
-  auto const ldim = safe_as<h_size_type>(strides.back());
-  return MatrixType{height, width, buf, ldim};
+  auto const width = safe_as<El::Int>(shape.back());
+  auto const height = safe_as<El::Int>(product<std::uint64_t>(init(shape)));
+  auto const ldim = safe_as<El::Int>(strides.back());
+  return {height, width, ldim};
 }
 
-template <typename BufferT, typename T, hydrogen::Device D>
-auto as_h2_tensor_impl(BufferT buf, El::Matrix<T, D> const& matrix)
+template <Device D, typename BufferT, typename T>
+auto as_h_mat_impl(BufferT buf,
+                   Tensor<T> const& tensor) -> El::Matrix<T, HydrogenDevice<D>>
 {
   // Enforce usage constraint
   static_assert(std::is_same_v<std::decay_t<std::remove_pointer_t<BufferT>>, T>,
                 "BufferT must be T* or T const*");
 
-  using TensorType = Tensor<T>;
+  using MatrixType = El::Matrix<T, HydrogenDevice<D>>;
+  auto const layout = get_h_mat_layout(tensor);
+  MatrixType matrix{layout.height, layout.width, buf, layout.ldim};
+  set_sync(matrix, tensor.get_stream());
+  return matrix;
+}
+
+template <Device D, typename TensorT, typename T>
+void as_h_mats_impl(std::vector<TensorT*> const& tensors,
+                    std::vector<El::Matrix<T, HydrogenDevice<D>>>& matrices)
+{
+  matrices.resize(tensors.size());
+  for (std::size_t i = 0; i < tensors.size(); ++i)
+  {
+    TensorT& tensor = *tensors[i];
+    auto const layout = get_h_mat_layout(tensor);
+    // Attaching only changes what the matrix points to.
+    if constexpr (std::is_const_v<TensorT>)
+      matrices[i].LockedAttach(
+        layout.height, layout.width, tensor.const_data(), layout.ldim);
+    else
+      matrices[i].Attach(
+        layout.height, layout.width, tensor.data(), layout.ldim);
+    set_sync(matrices[i], tensor.get_stream());
+  }
+}
+
+/** Shape, dimension types, and strides of the tensor viewing a matrix. */
+struct H2TensorLayout
+{
+  ShapeTuple shape;
+  DimensionTypeTuple dim_types;
+  StrideTuple strides;
+};
+
+template <typename T, hydrogen::Device D>
+H2TensorLayout get_h2_tensor_layout(El::Matrix<T, D> const& matrix)
+{
   if (matrix.IsEmpty())
     throw std::runtime_error("Cannot convert empty matrix to Tensor");
 
@@ -71,29 +139,54 @@ auto as_h2_tensor_impl(BufferT buf, El::Matrix<T, D> const& matrix)
   auto const n = safe_as<DimType>(matrix.Width());
   auto const ldim = safe_as<DataIndexType>(matrix.LDim());
   if (n == DimType{1})  // Column vector
-  {
-    return TensorType{H2Device<D>,
-                      buf,
-                      {m},
-                      {DT::Any},
-                      {as<DataIndexType>(1)},
-                      ComputeStream(get_sync_info(matrix))};
-  }
+    return {{m}, {DT::Any}, {as<DataIndexType>(1)}};
   else if (m == DimType{1})  // Row vector
+    return {{n}, {DT::Any}, {ldim}};
+  return {{m, n}, {DT::Any, DT::Any}, {as<DataIndexType>(1), ldim}};
+}
+
+template <typename BufferT, typename T, hydrogen::Device D>
+auto as_h2_tensor_impl(BufferT buf, El::Matrix<T, D> const& matrix)
+{
+  // Enforce usage constraint
+  static_assert(std::is_same_v<std::decay_t<std::remove_pointer_t<BufferT>>, T>,
+                "BufferT must be T* or T const*");
+
+  auto const layout = get_h2_tensor_layout(matrix);
+  return Tensor<T>{H2Device<D>,
+                   buf,
+                   layout.shape,
+                   layout.dim_types,
+                   layout.strides,
+                   ComputeStream(get_sync_info(matrix))};
+}
+
+template <typename MatrixT, typename T>
+void as_h2_tensors_impl(std::vector<MatrixT*> const& matrices,
+                        std::vector<Tensor<T>>& tensors)
+{
+  if (tensors.size() > matrices.size())
+    tensors.erase(tensors.begin() + matrices.size(), tensors.end());
+  tensors.reserve(matrices.size());
+  for (std::size_t i = 0; i < matrices.size(); ++i)
   {
-    return TensorType{H2Device<D>,
-                      buf,
-                      {n},
-                      {DT::Any},
-                      {ldim},
-                      ComputeStream(get_sync_info(matrix))};
+    MatrixT& matrix = *matrices[i];
+    auto const layout = get_h2_tensor_layout(matrix);
+    auto const buf = [&]() {
+      if constexpr (std::is_const_v<MatrixT>)
+        return matrix.LockedBuffer();
+      else
+        return matrix.Buffer();
+    }();
+    Device const device = matrix.GetDevice();
+    ComputeStream const stream(get_sync_info(matrix));
+    if (i < tensors.size())
+      tensors[i].wrap(
+        device, buf, layout.shape, layout.dim_types, layout.strides, stream);
+    else
+      tensors.emplace_back(
+        device, buf, layout.shape, layout.dim_types, layout.strides, stream);
   }
-  return TensorType{H2Device<D>,
-                    buf,
-                    {m, n},
-                    {DT::Any, DT::Any},
-                    {as<DataIndexType>(1), ldim},
-                    ComputeStream(get_sync_info(matrix))};
 }
 }  // namespace internal
 
@@ -247,4 +340,87 @@ auto as_h2_tensor(El::Matrix<T, D>& matrix) -> Tensor<T>
   return internal::as_h2_tensor_impl(matrix.Buffer(), matrix);
 }
 
+
+/** @brief View many H2 Tensors as Hydrogen matrices.
+ *
+ *  This is `as_h_mat` applied to each tensor, with the views written
+ *  into `matrices`, which is resized to match. Matrices already in
+ *  `matrices` are re-attached in place rather than reconstructed, so
+ *  repeatedly viewing a set of tensors (e.g., every parameter of a
+ *  model at every step) does not create new wrappers.
+ *
+ *  The same restrictions as `as_h_mat` apply to each tensor.
+ *
+ *  @param[in] tensors The tensors to view in Hydrogen format.
+ *  @param[out] matrices "Locked" views of the tensors.
+ *
+ *  @throws std::runtime_error Thrown when a tensor cannot be viewed
+ *                             in Hydrogen format.
+ */
+template <Device D, typename T>
+void as_h_mats(std::vector<Tensor<T> const*> const& tensors,
+               std::vector<El::Matrix<T, HydrogenDevice<D>>>& matrices)
+{
+  internal::as_h_mats_impl<D>(tensors, matrices);
+}
+
+/** @brief View many H2 Tensors as Hydrogen matrices.
+ *
+ *  This is `as_h_mat` applied to each tensor, with the views written
+ *  into `matrices`, which is resized to match. Matrices already in
+ *  `matrices` are re-attached in place rather than reconstructed.
+ *
+ *  @param[in] tensors The tensors to view in Hydrogen format.
+ *  @param[out] matrices Mutable views of the tensors.
+ *
+ *  @throws std::runtime_error Thrown when a tensor cannot be viewed
+ *                             in Hydrogen format.
+ */
+template <Device D, typename T>
+void as_h_mats(std::vector<Tensor<T>*> const& tensors,
+               std::vector<El::Matrix<T, HydrogenDevice<D>>>& matrices)
+{
+  internal::as_h_mats_impl<D>(tensors, matrices);
+}
+
+/** @brief View many Hydrogen matrices as H2 Tensors.
+ *
+ *  This is `as_h2_tensor` applied to each matrix, with the views
+ *  written into `tensors`, which is resized to match. Tensors already
+ *  in `tensors` are re-pointed at the new matrix data in place, so
+ *  repeatedly viewing a set of matrices does not allocate new
+ *  wrappers.
+ *
+ *  @param[in] matrices The matrices to view in H2 tensor format.
+ *  @param[out] tensors "Const" views of the matrices.
+ *
+ *  @throws std::runtime_error Thrown when a matrix cannot be viewed
+ *                             in H2 tensor format.
+ */
+template <typename T, hydrogen::Device D>
+void as_h2_tensors(std::vector<El::Matrix<T, D> const*> const& matrices,
+                   std::vector<Tensor<T>>& tensors)
+{
+  internal::as_h2_tensors_impl(matrices, tensors);
+}
+
+/** @brief View many Hydrogen matrices as H2 Tensors.
+ *
+ *  This is `as_h2_tensor` applied to each matrix, with the views
+ *  written into `tensors`, which is resized to match. Tensors already
+ *  in `tensors` are re-pointed at the new matrix data in place.
+ *
+ *  @param[in] matrices The matrices to view in H2 tensor format.
+ *  @param[out] tensors "Mutable" views of the matrices.
+ *
+ *  @throws std::runtime_error Thrown when a matrix cannot be viewed
+ *                             in H2 tensor format.
+ */
+template <typename T, hydrogen::Device D>
+void as_h2_tensors(std::vector<El::Matrix<T, D>*> const& matrices,
+                   std::vector<Tensor<T>>& tensors)
+{
+  internal::as_h2_tensors_impl(matrices, tensors);
+}
+
 }  // namespace h2
@@ -19,6 +19,8 @@
 #include "h2/tensor/tensor.hpp"
 
 #include <cstring>
+#include <utility>
+#include <vector>
 
 #ifdef H2_HAS_GPU
 #include "h2/gpu/memory_utils.hpp"
@@ -76,14 +78,77 @@ void zero(Tensor<T>& tensor)
  */
 void zero(BaseTensor& tensor);
 
+/**
+ * Fill several tensors with zeros.
+ *
+ * This is usable on any storage type: It just writes 0 bytes. The
+ * tensors may have different types, sizes, and devices.
+ *
+ * Contiguous GPU tensors that are not large and share a stream are
+ * zeroed with a single batched kernel launch, rather than one launch
+ * per tensor. (Building the batch waits for the stream.)
+ *
+ * If any tensor is on a GPU, this will be asynchronous.
+ */
+void zero(std::vector<BaseTensor*> const& tensors);
+
+/** Typed version of `zero` for several tensors. */
+template <typename T>
+void zero(std::vector<Tensor<T>*> const& tensors)
+{
+  zero(std::vector<BaseTensor*>(tensors.begin(), tensors.end()));
+}
+
 namespace impl
 {
 
+/**
+ * Group tensors by their compute stream, preserving the order of
+ * tensors within each group.
+ */
+template <typename TensorT>
+std::vector<std::pair<ComputeStream, std::vector<TensorT*>>>
+group_by_stream(std::vector<TensorT*> const& tensors)
+{
+  std::vector<std::pair<ComputeStream, std::vector<TensorT*>>> groups;
+  for (TensorT* tensor : tensors)
+  {
+    H2_ASSERT_DEBUG(tensor != nullptr, "Null tensor");
+    ComputeStream const stream = tensor->get_stream();
+    auto group = groups.begin();
+    while (group != groups.end() && !(group->first == stream))
+    {
+      ++group;
+    }
+    if (group == groups.end())
+    {
+      groups.emplace_back(stream, std::vector<TensorT*>{tensor});
+    }
+    else
+    {
+      group->second.push_back(tensor);
+    }
+  }
+  return groups;
+}
+
 template <typename T>
 void fill_impl(CPUDev_t, Tensor<T>& tensor, T const& val);
 #ifdef H2_HAS_GPU
 template <typename T>
 void fill_impl(GPUDev_t, Tensor<T>& tensor, const T& val);
+
+/** Zero GPU tensors that are all on `stream` in a batched launch. */
+void zero_batched_impl(GPUDev_t,
+                       std::vector<BaseTensor*> const& tensors,
+                       ComputeStream const& stream);
+
+/** Fill GPU tensors that are all on `stream` in a batched launch. */
+template <typename T>
+void fill_batched_impl(GPUDev_t,
+                       std::vector<Tensor<T>*> const& tensors,
+                       ComputeStream const& stream,
+                       T const& val);
 #endif
 
 }  // namespace impl
@@ -114,4 +179,39 @@ void fill(Tensor<T>& tensor, T const& val)
 template <typename T>
 void fill(BaseTensor& tensor, T const& val);
 
+/**
+ * Fill several tensors with a given value.
+ *
+ * This is usable only for compute types. The tensors may have
+ * different sizes and devices.
+ *
+ * Contiguous GPU tensors that are not large and share a stream are
+ * filled with a single batched kernel launch, rather than one launch
+ * per tensor. (Building the batch waits for the stream.)
+ *
+ * If any tensor is on a GPU, this will be asynchronous. `val` does
+ * not need to be on the GPU.
+ */
+template <typename T>
+void fill(std::vector<Tensor<T>*> const& tensors, T const& val)
+{
+  for (auto const& [stream, group] : impl::group_by_stream(tensors))
+  {
+    if (stream.get_device() == Device::CPU)
+    {
+      // There is no launch overhead to save.
+      for (Tensor<T>* tensor : group)
+      {
+        impl::fill_impl(CPUDev_t{}, *tensor, val);
+      }
+    }
+#ifdef H2_HAS_GPU
+    else
+    {
+      impl::fill_batched_impl(GPUDev_t{}, group, stream, val);
+    }
+#endif
+  }
+}
+
 }  // namespace h2
@@ -0,0 +1,274 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Routines for filling tensors with random values.
+ *
+ * Values are generated on the tensor's device with the counter-based
+ * Philox4x32-10 generator, using the (global) linear index of each
+ * element as its counter. Hence the values depend only on the seed,
+ * the tensor's shape, and the element's index: They do not depend on
+ * the device, the strides, or, for distributed tensors, the processor
+ * grid or distribution. A distributed tensor gets exactly the values
+ * of a local tensor of the same shape and seed, and replicas agree.
+ *
+ * These are usable for `float` and `double`.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/types.hpp"
+#include "h2/gpu/macros.hpp"
+#include "h2/tensor/dist_tensor.hpp"
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/tensor.hpp"
+#include "h2/utils/philox.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace h2
+{
+
+namespace impl
+{
+
+/**
+ * Generates the value of each element of a random fill from its
+ * index.
+ */
+template <typename T>
+struct RandomFill
+{
+  static_assert(std::is_floating_point_v<T>,
+                "Random fills are only supported for float and double");
+
+  /** Normal distribution if true, otherwise uniform. */
+  bool normal;
+  /** Lower bound (uniform) or mean (normal). */
+  T a;
+  /** Upper bound (uniform) or standard deviation (normal). */
+  T b;
+  /** Key for the generator. */
+  std::uint64_t seed;
+
+  /** Number of 32-bit words of random bits used for one value. */
+  static constexpr unsigned int words_per_value = sizeof(T) <= 4 ? 1 : 2;
+  /** Number of values generated from one counter. */
+  static constexpr unsigned int values_per_counter = 4 / words_per_value;
+
+  /** Return a uniform value in (0, 1) from the bits at `word`. */
+  H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE static T
+  to_unit(Philox4x32Block const& bits, unsigned int word)
+  {
+    if constexpr (words_per_value == 1)
+    {
+      // Use the top 24 bits, which a float holds exactly.
+      return (static_cast<T>(bits.v[word] >> 8) + T(0.5)) * T(0x1p-24);
+    }
+    else
+    {
+      std::uint64_t const x =
+        (static_cast<std::uint64_t>(bits.v[word]) << 32) | bits.v[word + 1];
+      return (static_cast<T>(x >> 11) + T(0.5)) * T(0x1p-53);
+    }
+  }
+
+  /** Return the value of the element with index `index`. */
+  H2_GPU_HOST_DEVICE T operator()(std::uint64_t index) const
+  {
+    Philox4x32Block const bits =
+      philox4x32_10(index / values_per_counter, seed);
+    unsigned int const lane =
+      static_cast<unsigned int>(index % values_per_counter);
+    if (!normal)
+    {
+      return a + (b - a) * to_unit(bits, lane * words_per_value);
+    }
+    // Box-Muller transform, which gives two values from each pair of
+    // uniform values.
+    unsigned int const pair = lane & ~1u;
+    T const u1 = to_unit(bits, pair * words_per_value);
+    T const u2 = to_unit(bits, (pair + 1) * words_per_value);
+    T const radius = std::sqrt(T(-2) * std::log(u1));
+    T const theta = T(6.283185307179586476925286766559) * u2;
+    T const z = radius * ((lane == pair) ? std::cos(theta) : std::sin(theta));
+    return a + b * z;
+  }
+};
+
+/**
+ * Fill `tensor` with the values of `gen`, where the element at local
+ * coordinates `idx` has index `index_base` plus the inner product of
+ * `idx` and `index_strides`.
+ */
+template <typename T>
+void fill_random_impl(CPUDev_t,
+                      Tensor<T>& tensor,
+                      RandomFill<T> const& gen,
+                      std::uint64_t index_base,
+                      StrideTuple const& index_strides);
+#ifdef H2_HAS_GPU
+template <typename T>
+void fill_random_impl(GPUDev_t,
+                      Tensor<T>& tensor,
+                      RandomFill<T> const& gen,
+                      std::uint64_t index_base,
+                      StrideTuple const& index_strides);
+#endif
+
+template <typename T>
+void fill_random(Tensor<T>& tensor, RandomFill<T> const& gen)
+{
+  H2_DEVICE_DISPATCH_SAME(
+    tensor.get_device(),
+    fill_random_impl(DeviceT_v<Dev>,
+                     tensor,
+                     gen,
+                     0,
+                     get_contiguous_strides(tensor.shape())));
+}
+
+template <typename T>
+void fill_random(DistTensor<T>& tensor, RandomFill<T> const& gen)
+{
+  if (tensor.is_local_empty())
+  {
+    return;
+  }
+  // Local indices are offset from global indices by the start of the
+  // local block in every distribution, and scaled by the grid size in
+  // Cyclic dimensions.
+  StrideTuple const global_strides = get_contiguous_strides(tensor.shape());
+  ScalarIndexTuple const start =
+    get_index_range_start(internal::get_global_indices(tensor.shape(),
+                                                       tensor.proc_grid(),
+                                                       tensor.distribution(),
+                                                       tensor.proc_grid().rank(),
+                                                       tensor.block_sizes()));
+  std::uint64_t const index_base =
+    inner_product<std::uint64_t>(start, global_strides);
+  StrideTuple const index_strides = map_index(
+    global_strides, [&](typename StrideTuple::size_type i) {
+      return global_strides[i]
+             * static_cast<typename StrideTuple::type>(
+               internal::get_dim_global_index_stride(
+                 i, tensor.proc_grid(), tensor.distribution(i)));
+    });
+  H2_DEVICE_DISPATCH_SAME(tensor.get_device(),
+                          fill_random_impl(DeviceT_v<Dev>,
+                                           tensor.local_tensor(),
+                                           gen,
+                                           index_base,
+                                           index_strides));
+}
+
+}  // namespace impl
+
+/**
+ * Fill a tensor with values uniformly distributed between `low` and
+ * `high`.
+ *
+ * `tensor` may be a `Tensor` or a `DistTensor`. If it is on a GPU,
+ * this will be asynchronous.
+ */
+template <typename TensorT>
+void fill_uniform(TensorT& tensor,
+                  typename TensorT::value_type low,
+                  typename TensorT::value_type high,
+                  std::uint64_t seed)
+{
+  using T = typename TensorT::value_type;
+  impl::fill_random(tensor, impl::RandomFill<T>{false, low, high, seed});
+}
+
+/**
+ * Fill a tensor with normally distributed values with the given mean
+ * and standard deviation.
+ *
+ * `tensor` may be a `Tensor` or a `DistTensor`. If it is on a GPU,
+ * this will be asynchronous.
+ */
+template <typename TensorT>
+void fill_normal(TensorT& tensor,
+                 typename TensorT::value_type mean,
+                 typename TensorT::value_type stddev,
+                 std::uint64_t seed)
+{
+  using T = typename TensorT::value_type;
+  impl::fill_random(tensor, impl::RandomFill<T>{true, mean, stddev, seed});
+}
+
+/**
+ * Fill a tensor with the Xavier (Glorot) uniform initialization: Values
+ * are uniform in (-a, a), with a = sqrt(6 / (fan_in + fan_out)).
+ */
+template <typename TensorT>
+void fill_xavier_uniform(TensorT& tensor,
+                         std::size_t fan_in,
+                         std::size_t fan_out,
+                         std::uint64_t seed)
+{
+  using T = typename TensorT::value_type;
+  H2_ASSERT_ALWAYS(fan_in + fan_out > 0, "Fans must not both be 0");
+  T const bound = static_cast<T>(
+    std::sqrt(6.0 / static_cast<double>(fan_in + fan_out)));
+  fill_uniform(tensor, -bound, bound, seed);
+}
+
+/**
+ * Fill a tensor with the Xavier (Glorot) normal initialization: Values
+ * are normal with mean 0 and standard deviation
+ * sqrt(2 / (fan_in + fan_out)).
+ */
+template <typename TensorT>
+void fill_xavier_normal(TensorT& tensor,
+                        std::size_t fan_in,
+                        std::size_t fan_out,
+                        std::uint64_t seed)
+{
+  using T = typename TensorT::value_type;
+  H2_ASSERT_ALWAYS(fan_in + fan_out > 0, "Fans must not both be 0");
+  T const stddev = static_cast<T>(
+    std::sqrt(2.0 / static_cast<double>(fan_in + fan_out)));
+  fill_normal(tensor, T(0), stddev, seed);
+}
+
+/**
+ * Fill a tensor with the He (Kaiming) uniform initialization: Values
+ * are uniform in (-a, a), with a = sqrt(6 / fan_in).
+ */
+template <typename TensorT>
+void fill_he_uniform(TensorT& tensor, std::size_t fan_in, std::uint64_t seed)
+{
+  using T = typename TensorT::value_type;
+  H2_ASSERT_ALWAYS(fan_in > 0, "Fan-in must not be 0");
+  T const bound =
+    static_cast<T>(std::sqrt(6.0 / static_cast<double>(fan_in)));
+  fill_uniform(tensor, -bound, bound, seed);
+}
+
+/**
+ * Fill a tensor with the He (Kaiming) normal initialization: Values
+ * are normal with mean 0 and standard deviation sqrt(2 / fan_in).
+ */
+template <typename TensorT>
+void fill_he_normal(TensorT& tensor, std::size_t fan_in, std::uint64_t seed)
+{
+  using T = typename TensorT::value_type;
+  H2_ASSERT_ALWAYS(fan_in > 0, "Fan-in must not be 0");
+  T const stddev =
+    static_cast<T>(std::sqrt(2.0 / static_cast<double>(fan_in)));
+  fill_normal(tensor, T(0), stddev, seed);
+}
+
+}  // namespace h2
@@ -12,17 +12,36 @@
  * Printing and file I/O for tensors and distributed tensors.
  */
 
+#include "h2/tensor/compression.hpp"
 #include "h2/tensor/copy.hpp"
+#include "h2/tensor/dist_types.hpp"
+#include "h2/tensor/stats.hpp"
 #include "h2/tensor/tensor.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <istream>
 #include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef H2_HAS_GPU
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/gpu/runtime.hpp"
+#endif
 
 #include "tensor_types.hpp"
 
 namespace h2
 {
 
-/** Write tensor to the given stream. */
+/**
+ * Write tensor to the given stream.
+ *
+ * This copies the whole tensor to the host and formats every element,
+ * so prefer `print_summary` for large tensors.
+ */
 template <typename T>
 inline std::ostream& print(std::ostream& os, Tensor<T> const& tensor)
 {
@@ -97,4 +116,445 @@ inline std::ostream& print(std::ostream& os, Tensor<T> const& tensor)
   return os;
 }
 
+namespace internal
+{
+
+/**
+ * Return the coordinate of the `index`th element of a tensor of shape
+ * `shape` in row-major order (the order `print` uses).
+ */
+inline ScalarIndexTuple get_row_major_coord(ShapeTuple const& shape,
+                                            DataIndexType index)
+{
+  ScalarIndexTuple coord{TuplePad<ScalarIndexTuple>(shape.size(), 0)};
+  for (typename ShapeTuple::size_type dim = shape.size() - 1; dim >= 0; --dim)
+  {
+    coord[dim] = static_cast<DimType>(index % shape[dim]);
+    index /= shape[dim];
+  }
+  return coord;
+}
+
+/**
+ * Return the elements of `tensor` at `coords`, copying only those
+ * elements to the host.
+ */
+template <typename T>
+std::vector<T> read_elements(Tensor<T> const& tensor,
+                             std::vector<ScalarIndexTuple> const& coords)
+{
+  std::vector<T> vals(coords.size());
+#ifdef H2_HAS_GPU
+  if (tensor.get_device() == Device::GPU && !gpu::is_integrated())
+  {
+    for (std::size_t i = 0; i < coords.size(); ++i)
+    {
+      gpu::mem_copy(vals.data() + i,
+                    tensor.const_get(coords[i]),
+                    1,
+                    tensor.get_stream().template get_stream<Device::GPU>());
+    }
+    tensor.get_stream().wait_for_this();
+    return vals;
+  }
+#endif
+  tensor.get_stream().wait_for_this();
+  for (std::size_t i = 0; i < coords.size(); ++i)
+  {
+    vals[i] = *tensor.const_get(coords[i]);
+  }
+  return vals;
+}
+
+}  // namespace internal
+
+/**
+ * Write a summary of `tensor` to the given stream.
+ *
+ * This gives the shape, the statistics from `get_stats`, and the
+ * first and last `edge_items` elements in the order `print` uses:
+ *
+ * ```
+ * shape {1024, 1024}, min: -3.2, max: 3.1, mean: 0.001, NaNs: 0
+ * [0.3, -1.2, 0.8, ..., 1.5, -0.1, 0.2]
+ * ```
+ *
+ * Statistics are computed on the tensor's device and only the printed
+ * elements are copied to the host, so this is fast for any size.
+ */
+template <typename T>
+inline std::ostream& print_summary(std::ostream& os,
+                                   Tensor<T> const& tensor,
+                                   DataIndexType edge_items = 3)
+{
+  if (tensor.is_empty())
+  {
+    os << "[]";
+    return os;
+  }
+  os << "shape " << tensor.shape() << ", " << get_stats(tensor) << "\n";
+
+  DataIndexType const numel = tensor.numel();
+  bool const elide = numel > 2 * edge_items;
+  std::vector<ScalarIndexTuple> coords;
+  for (DataIndexType i = 0; i < numel; ++i)
+  {
+    if (elide && i == edge_items)
+    {
+      i = numel - edge_items;
+    }
+    coords.push_back(internal::get_row_major_coord(tensor.shape(), i));
+  }
+  std::vector<T> const vals = internal::read_elements(tensor, coords);
+  os << "[";
+  for (std::size_t i = 0; i < vals.size(); ++i)
+  {
+    if (i > 0)
+    {
+      os << ", ";
+    }
+    if (elide && i == static_cast<std::size_t>(edge_items))
+    {
+      os << "..., ";
+    }
+    os << vals[i];
+  }
+  os << "]";
+  return os;
+}
+
+/** Default chunk size for streaming tensor data through host memory. */
+inline constexpr std::size_t default_io_chunk_bytes = std::size_t{64} << 20;
+
+namespace internal
+{
+
+/**
+ * Metadata preceding tensor data in H2's binary tensor format.
+ *
+ * The on-disk layout (all values in host byte order) is:
+ * - The magic bytes "H2TS" and a `uint32` format version.
+ * - The type token (`uint8`) and type size (`uint32`).
+ * - The number of dimensions `n` (`uint32`), then `n` `int64` extents
+ *   and `n` `int64` strides.
+ * - The number of dimension types `k` (`uint32`) and `k` `uint8`
+ *   dimension types. For distributed tensors these are the global
+ *   dimension types (the local tensor may be empty), otherwise `k` is
+ *   `n`.
+ * - A `uint8` flag for whether this is part of a distributed tensor.
+ *   If set, this is followed by `n` `int64` global extents, `n`
+ *   `uint8` distribution types, the grid's number of dimensions `m`
+ *   (`uint32`), `m` `int64` grid extents, and the rank (`int32`).
+ * - The data compression (`uint8`, a `DataCompression`; version 2 and
+ *   later, and None for version 1).
+ * - The number of data bytes (`uint64`), then the data.
+ *
+ * Data is the buffer spanned by the strides, so non-contiguous tensors
+ * round-trip with their strides. Compressed data is a sequence of
+ * chunks, each the number of data bytes it holds (`uint64`), its
+ * compressed size (`uint64`), and the output of `compress`.
+ */
+struct TensorFileHeader
+{
+  static constexpr std::uint32_t version = 2;
+
+  TypeInfo::TokenType type_token = 0;
+  std::uint32_t type_size = 0;
+  ShapeTuple shape;
+  StrideTuple strides;
+  DimensionTypeTuple dim_types;
+  bool distributed = false;
+  ShapeTuple global_shape;
+  DistributionTypeTuple distribution;
+  ShapeTuple grid_shape;
+  RankType grid_rank = 0;
+  DataCompression compression = DataCompression::None;
+  std::uint64_t data_bytes = 0;
+};
+
+void write_header(std::ostream& os, TensorFileHeader const& header);
+TensorFileHeader read_header(std::istream& is);
+
+/**
+ * Write `bytes` of data at `buf` on `dev` to `os`.
+ *
+ * GPU data is streamed in chunks of at most `chunk_bytes` through two
+ * pinned staging buffers, so the device-to-host copy of one chunk
+ * overlaps writing the previous one. With `compression`, each chunk
+ * is compressed on the host before it is written.
+ */
+void write_data(std::ostream& os,
+                void const* buf,
+                std::size_t bytes,
+                Device dev,
+                ComputeStream const& stream,
+                std::size_t chunk_bytes,
+                DataCompression compression = DataCompression::None);
+
+/**
+ * Read `bytes` of data into `buf` on `dev` from `is`.
+ *
+ * `compression` must match what the data was written with.
+ */
+void read_data(std::istream& is,
+               void* buf,
+               std::size_t bytes,
+               Device dev,
+               ComputeStream const& stream,
+               std::size_t chunk_bytes,
+               DataCompression compression = DataCompression::None);
+
+/**
+ * Return whether GPU data may be read from and written to files
+ * directly with GPUDirect Storage (cuFile), without staging it in host
+ * memory.
+ *
+ * This requires H2 to be built with cuFile support, `H2_GDS` to be
+ * set (it is by default), and the cuFile driver to open.
+ */
+bool gds_enabled();
+
+/**
+ * Write `bytes` of data at `buf` on `dev` to the existing file at
+ * `path`, starting at byte `offset`.
+ *
+ * GPU data is written with GPUDirect Storage if `gds_enabled()` and
+ * the file system supports it, and is otherwise streamed through
+ * pinned memory as in `write_data`. This returns once all data has
+ * been written.
+ */
+void write_file_data(std::string const& path,
+                     std::uint64_t offset,
+                     void const* buf,
+                     std::size_t bytes,
+                     Device dev,
+                     ComputeStream const& stream,
+                     std::size_t chunk_bytes);
+
+/**
+ * Read `bytes` of data into `buf` on `dev` from the file at `path`,
+ * starting at byte `offset`.
+ *
+ * This uses GPUDirect Storage when possible, like `write_file_data`.
+ */
+void read_file_data(std::string const& path,
+                    std::uint64_t offset,
+                    void* buf,
+                    std::size_t bytes,
+                    Device dev,
+                    ComputeStream const& stream,
+                    std::size_t chunk_bytes);
+
+template <typename T>
+TensorFileHeader make_header(Tensor<T> const& tensor)
+{
+  TensorFileHeader header;
+  header.type_token = get_h2_type<T>().get_token();
+  header.type_size = sizeof(T);
+  if (!tensor.is_empty())
+  {
+    header.shape = tensor.shape();
+    header.strides = tensor.strides();
+    header.dim_types = tensor.dim_types();
+    header.data_bytes =
+      get_extent_from_strides(tensor.shape(), tensor.strides()) * sizeof(T);
+  }
+  if (use_compression(header.data_bytes))
+  {
+    header.compression = get_data_compression();
+  }
+  return header;
+}
+
+template <typename T>
+void check_header_type(TensorFileHeader const& header)
+{
+  H2_ASSERT_ALWAYS(header.type_token == get_h2_type<T>().get_token()
+                     && header.type_size == sizeof(T),
+                   "Serialized tensor has type token ",
+                   static_cast<int>(header.type_token),
+                   " and size ",
+                   header.type_size,
+                   ", cannot read it as ",
+                   TypeName<T>());
+}
+
+template <typename T>
+void check_header_data_bytes(TensorFileHeader const& header)
+{
+  std::size_t const expected_bytes =
+    header.shape.is_empty()
+      ? 0
+      : get_extent_from_strides(header.shape, header.strides) * sizeof(T);
+  H2_ASSERT_ALWAYS(header.data_bytes == expected_bytes,
+                   "Serialized tensor has ",
+                   header.data_bytes,
+                   " data bytes, expected ",
+                   expected_bytes);
+}
+
+template <typename T>
+void read_local_data(std::istream& is,
+                     TensorFileHeader const& header,
+                     Tensor<T>& tensor,
+                     std::size_t chunk_bytes)
+{
+  check_header_data_bytes<T>(header);
+  if (header.data_bytes)
+  {
+    tensor.ensure();
+    read_data(is,
+              tensor.data(),
+              header.data_bytes,
+              tensor.get_device(),
+              tensor.get_stream(),
+              chunk_bytes,
+              header.compression);
+  }
+}
+
+}  // namespace internal
+
+/**
+ * Write tensor to `os` in H2's binary tensor format.
+ *
+ * This records the tensor's type, shape, strides, and dimension types
+ * along with its data. GPU data is streamed through pinned memory in
+ * chunks of `chunk_bytes`. Large data is compressed if requested (see
+ * `use_compression`). This returns once all data has been written.
+ */
+template <typename T>
+void serialize(std::ostream& os,
+               Tensor<T> const& tensor,
+               std::size_t chunk_bytes = default_io_chunk_bytes)
+{
+  H2_ASSERT_ALWAYS(tensor.is_empty() || tensor.const_data() != nullptr,
+                   "Cannot serialize a non-empty tensor with no data");
+  internal::TensorFileHeader const header = internal::make_header(tensor);
+  internal::write_header(os, header);
+  internal::write_data(os,
+                       tensor.const_data(),
+                       header.data_bytes,
+                       tensor.get_device(),
+                       tensor.get_stream(),
+                       chunk_bytes,
+                       header.compression);
+}
+
+/**
+ * Read a tensor written by `serialize` from `is` into `tensor`.
+ *
+ * `tensor` is resized to the stored shape, strides, and dimension
+ * types and keeps its device and stream. Reading into a tensor of a
+ * different type than was written is an error.
+ */
+template <typename T>
+void deserialize(std::istream& is,
+                 Tensor<T>& tensor,
+                 std::size_t chunk_bytes = default_io_chunk_bytes)
+{
+  internal::TensorFileHeader const header = internal::read_header(is);
+  internal::check_header_type<T>(header);
+  H2_ASSERT_ALWAYS(!header.distributed,
+                   "Cannot read a distributed tensor into a local tensor");
+  if (header.shape.is_empty())
+  {
+    tensor.empty();
+    return;
+  }
+  tensor.resize(header.shape, header.dim_types, header.strides);
+  internal::read_local_data(is, header, tensor, chunk_bytes);
+}
+
+/**
+ * Write tensor to the file at `path` in H2's binary tensor format.
+ *
+ * This is `serialize` to a file, for checkpoints and for debug dumps
+ * of tensors too large to print. GPU data is written directly from
+ * device memory with GPUDirect Storage when available (see
+ * `internal::gds_enabled`), and otherwise streamed in chunks of
+ * `chunk_bytes`, so host memory use does not grow with the tensor's
+ * size. Compressed data (see `use_compression`) is always streamed,
+ * since it is compressed on the host.
+ */
+template <typename T>
+void serialize(std::string const& path,
+               Tensor<T> const& tensor,
+               std::size_t chunk_bytes = default_io_chunk_bytes)
+{
+  H2_ASSERT_ALWAYS(tensor.is_empty() || tensor.const_data() != nullptr,
+                   "Cannot serialize a non-empty tensor with no data");
+  internal::TensorFileHeader const header = internal::make_header(tensor);
+  std::ofstream os(path, std::ios::binary | std::ios::trunc);
+  H2_ASSERT_ALWAYS(os, "Could not open ", path, " for writing");
+  internal::write_header(os, header);
+  if (header.compression != DataCompression::None)
+  {
+    internal::write_data(os,
+                         tensor.const_data(),
+                         header.data_bytes,
+                         tensor.get_device(),
+                         tensor.get_stream(),
+                         chunk_bytes,
+                         header.compression);
+    os.close();
+    H2_ASSERT_ALWAYS(os, "Could not write tensor to ", path);
+    return;
+  }
+  std::uint64_t const data_offset = static_cast<std::uint64_t>(os.tellp());
+  os.close();
+  H2_ASSERT_ALWAYS(os, "Could not write tensor to ", path);
+  internal::write_file_data(path,
+                            data_offset,
+                            tensor.const_data(),
+                            header.data_bytes,
+                            tensor.get_device(),
+                            tensor.get_stream(),
+                            chunk_bytes);
+}
+
+/**
+ * Read a tensor written by `serialize` from the file at `path`.
+ *
+ * Like `serialize`, GPU data is read directly into device memory with
+ * GPUDirect Storage when available.
+ */
+template <typename T>
+void deserialize(std::string const& path,
+                 Tensor<T>& tensor,
+                 std::size_t chunk_bytes = default_io_chunk_bytes)
+{
+  std::ifstream is(path, std::ios::binary);
+  H2_ASSERT_ALWAYS(is, "Could not open ", path, " for reading");
+  internal::TensorFileHeader const header = internal::read_header(is);
+  internal::check_header_type<T>(header);
+  H2_ASSERT_ALWAYS(!header.distributed,
+                   "Cannot read a distributed tensor into a local tensor");
+  internal::check_header_data_bytes<T>(header);
+  if (header.shape.is_empty())
+  {
+    tensor.empty();
+    return;
+  }
+  tensor.resize(header.shape, header.dim_types, header.strides);
+  if (header.compression != DataCompression::None)
+  {
+    internal::read_local_data(is, header, tensor, chunk_bytes);
+    return;
+  }
+  std::uint64_t const data_offset = static_cast<std::uint64_t>(is.tellg());
+  is.close();
+  if (header.data_bytes)
+  {
+    tensor.ensure();
+    internal::read_file_data(path,
+                             data_offset,
+                             tensor.data(),
+                             header.data_bytes,
+                             tensor.get_device(),
+                             tensor.get_stream(),
+                             chunk_bytes);
+  }
+}
+
 }  // namespace h2
@@ -0,0 +1,150 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Tensors backed by memory-mapped files.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/tensor.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+
+namespace h2
+{
+
+/** How a file is mapped. */
+enum class MmapMode
+{
+  /** Pages may only be read. */
+  ReadOnly,
+  /**
+   * Pages may be written, but writes are private to this process and
+   * never reach the file.
+   */
+  CopyOnWrite
+};
+
+inline std::ostream& operator<<(std::ostream& os, MmapMode mode)
+{
+  switch (mode)
+  {
+  case MmapMode::ReadOnly: os << "ReadOnly"; break;
+  case MmapMode::CopyOnWrite: os << "CopyOnWrite"; break;
+  default: os << "Unknown"; break;
+  }
+  return os;
+}
+
+/**
+ * A region of a file mapped into memory.
+ *
+ * The mapping is removed when this is destroyed.
+ *
+ * With GPU support, the region may additionally be registered
+ * (page-locked) with the GPU runtime, so copies between it and GPU
+ * memory are DMA'd directly, without staging.
+ */
+class MappedFile
+{
+public:
+  /**
+   * Map `length` bytes of the file at `path` starting at `offset`.
+   *
+   * If `length` is not given, this maps to the end of the file.
+   * `offset` need not be page-aligned.
+   */
+  MappedFile(std::string const& path,
+             MmapMode mode,
+             std::size_t offset = 0,
+             std::optional<std::size_t> length = std::nullopt,
+             bool register_with_gpu = false);
+  ~MappedFile();
+
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+
+  /** Return a pointer to the start of the requested region. */
+  void* data() const H2_NOEXCEPT { return region; }
+
+  /** Return the size of the requested region in bytes. */
+  std::size_t size() const H2_NOEXCEPT { return region_size; }
+
+  MmapMode get_mode() const H2_NOEXCEPT { return mode; }
+
+  /** Whether the mapping is registered with the GPU runtime. */
+  bool is_gpu_registered() const H2_NOEXCEPT { return gpu_registered; }
+
+private:
+  void* mapping;            /**< Start of the page-aligned mapping. */
+  std::size_t mapping_size; /**< Size of the whole mapping. */
+  void* region;             /**< Start of the requested region. */
+  std::size_t region_size;  /**< Size of the requested region. */
+  MmapMode mode;            /**< How the file is mapped. */
+  bool gpu_registered;      /**< Whether the mapping is GPU registered. */
+};
+
+/**
+ * Create a CPU tensor directly over a memory-mapped file, without
+ * copying.
+ *
+ * The tensor is contiguous with the given shape and holds elements
+ * starting `offset` bytes into the file, which must be suitably
+ * aligned for `T`. The mapping lives as long as the tensor or any view
+ * of it.
+ *
+ * With `MmapMode::ReadOnly`, the returned tensor is a constant view.
+ *
+ * If `register_with_gpu` is true (and GPU support is present), the
+ * mapping is registered with the GPU runtime so it may be copied to
+ * the GPU without staging.
+ */
+template <typename T>
+std::unique_ptr<Tensor<T>>
+make_mmap_tensor(std::string const& path,
+                 ShapeTuple const& shape,
+                 DimensionTypeTuple const& dim_types,
+                 MmapMode mode = MmapMode::ReadOnly,
+                 std::size_t offset = 0,
+                 bool register_with_gpu = false)
+{
+  H2_ASSERT_ALWAYS(offset % alignof(T) == 0,
+                   "Offset ",
+                   offset,
+                   " is not aligned for ",
+                   TypeName<T>());
+  std::size_t const bytes =
+    shape.is_empty() ? 0 : product<std::size_t>(shape) * sizeof(T);
+  auto file = std::make_shared<MappedFile>(
+    path, mode, offset, bytes, register_with_gpu);
+  T* buffer = static_cast<T*>(file->data());
+  StrideTuple const strides = get_contiguous_strides(shape);
+  ComputeStream const stream{Device::CPU};
+  if (mode == MmapMode::ReadOnly)
+  {
+    return std::make_unique<Tensor<T>>(Device::CPU,
+                                       const_cast<T const*>(buffer),
+                                       shape,
+                                       dim_types,
+                                       strides,
+                                       stream,
+                                       std::move(file));
+  }
+  return std::make_unique<Tensor<T>>(
+    Device::CPU, buffer, shape, dim_types, strides, stream, std::move(file));
+}
+
+}  // namespace h2
@@ -0,0 +1,241 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Detect NaNs and infinities in tensors on their device.
+ *
+ * Each tensor is reduced to a single flag on its device, so checking
+ * only copies a few bytes to the host. `NonfiniteCheck` makes that copy
+ * asynchronous, so a training loop can check every step (e.g., for
+ * loss scaling) and only wait for the result when it needs it.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/device.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/gpu/macros.hpp"
+#include "h2/tensor/copy_buffer.hpp"
+#include "h2/tensor/tensor.hpp"
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace h2
+{
+
+namespace internal
+{
+
+/**
+ * Reduction operator (see `reduction_helpers.hpp`) that is 1 if any
+ * element is NaN or infinite and 0 otherwise.
+ */
+template <typename T>
+struct NonfiniteReduction
+{
+  using ValueT = std::int32_t;
+
+  H2_GPU_HOST_DEVICE ValueT identity() const { return 0; }
+  H2_GPU_HOST_DEVICE ValueT init(T x, DataIndexType) const
+  {
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      // x - x is 0 for finite x and NaN otherwise.
+      return (x - x) != T{0};
+    }
+    else
+    {
+      return 0;
+    }
+  }
+  H2_GPU_HOST_DEVICE ValueT combine(ValueT a, ValueT b) const
+  {
+    return a | b;
+  }
+};
+
+}  // namespace internal
+
+namespace impl
+{
+
+template <typename T>
+void nonfinite_impl(CPUDev_t,
+                    Tensor<T> const& tensor,
+                    std::int32_t* flag,
+                    ComputeStream const& stream);
+#ifdef H2_HAS_GPU
+template <typename T>
+void nonfinite_impl(GPUDev_t,
+                    Tensor<T> const& tensor,
+                    std::int32_t* flag,
+                    ComputeStream const& stream);
+#endif
+
+}  // namespace impl
+
+/**
+ * Asynchronously check tensors for NaNs and infinities.
+ *
+ * `start` enqueues one reduction per tensor on the check's stream,
+ * each writing a flag in device memory, followed by a copy of the
+ * flags to pinned host memory. `get` waits for that copy and returns
+ * the result. Neither blocks the caller until `get`:
+ *
+ * ```
+ * NonfiniteCheck check(stream);
+ * check.start(grads);
+ * // ... other work ...
+ * if (check.get()) { // skip the step and reduce the loss scale }
+ * ```
+ *
+ * The check's stream waits for each tensor's stream, and each tensor's
+ * stream waits for the check's stream, so tensors may be modified
+ * after `start` returns. Checks may be reused; calling `start` again
+ * replaces the previous result.
+ */
+class NonfiniteCheck
+{
+public:
+  NonfiniteCheck(ComputeStream const& stream_)
+    : stream(stream_),
+      flags(stream_.get_device(), stream_),
+      host_flags(Device::CPU),
+      event(stream_.get_device())
+  {}
+
+  /** Return the stream checks are run on. */
+  ComputeStream const& get_stream() const H2_NOEXCEPT { return stream; }
+
+  /** Start checking whether any of `tensors` has non-finite elements. */
+  template <typename T>
+  void start(std::vector<Tensor<T> const*> const& tensors)
+  {
+    std::vector<Tensor<T> const*> to_check;
+    for (auto const* tensor : tensors)
+    {
+      H2_ASSERT_ALWAYS(tensor->get_device() == stream.get_device(),
+                       "Cannot check a tensor on ",
+                       tensor->get_device(),
+                       " with a check on ",
+                       stream.get_device());
+      if (!tensor->is_empty())
+      {
+        H2_ASSERT_ALWAYS(tensor->const_data() != nullptr,
+                         "Cannot check a tensor with no data");
+        to_check.push_back(tensor);
+      }
+    }
+    ensure_flags(to_check.size());
+    num_flags = to_check.size();
+    for (std::size_t i = 0; i < to_check.size(); ++i)
+    {
+      H2_DEVICE_DISPATCH_SAME(stream.get_device(),
+                              impl::nonfinite_impl(DeviceT_v<Dev>,
+                                                   *to_check[i],
+                                                   flags.data() + i,
+                                                   stream));
+    }
+    if (num_flags > 0)
+    {
+      copy_buffer(host_flags.data(),
+                  host_flags.get_stream(),
+                  flags.const_data(),
+                  stream,
+                  num_flags);
+      stream.add_sync_point(event);
+    }
+  }
+
+  /** Start checking whether `tensor` has non-finite elements. */
+  template <typename T>
+  void start(Tensor<T> const& tensor)
+  {
+    start(std::vector<Tensor<T> const*>{&tensor});
+  }
+
+  /**
+   * Wait for the last `start` to complete and return whether any
+   * tensor it checked had non-finite elements.
+   */
+  bool get() const
+  {
+    if (num_flags == 0)
+    {
+      return false;
+    }
+    event.event.wait_for_this();
+    std::int32_t result = 0;
+    for (std::size_t i = 0; i < num_flags; ++i)
+    {
+      result |= host_flags.const_data()[i];
+    }
+    return result != 0;
+  }
+
+private:
+  ComputeStream stream;
+  /** One flag per checked tensor on the check's device. */
+  internal::ManagedBuffer<std::int32_t> flags;
+  /** Pinned host copy of `flags`. */
+  internal::ManagedBuffer<std::int32_t> host_flags;
+  /** Recorded after the copy to `host_flags`. */
+  SyncEventRAII event;
+  /** Number of flags written by the last `start`. */
+  std::size_t num_flags = 0;
+
+  void ensure_flags(std::size_t count)
+  {
+    if (flags.size() >= count)
+    {
+      return;
+    }
+    // A previous copy may still be writing the old host buffer.
+    if (num_flags > 0)
+    {
+      event.event.wait_for_this();
+    }
+    flags = internal::ManagedBuffer<std::int32_t>(
+      count, stream.get_device(), stream);
+    host_flags = internal::ManagedBuffer<std::int32_t>(
+      count, Device::CPU, ComputeStream{Device::CPU}, MemoryKind::Pinned);
+  }
+};
+
+/**
+ * Return true if any of `tensors` has a NaN or infinite element.
+ *
+ * All tensors must be on the same device. The check runs on the first
+ * tensor's stream and waits only for a flag per tensor to be copied to
+ * the host; use `NonfiniteCheck` to avoid waiting.
+ */
+template <typename T>
+bool has_nonfinite(std::vector<Tensor<T> const*> const& tensors)
+{
+  if (tensors.empty())
+  {
+    return false;
+  }
+  NonfiniteCheck check(tensors.front()->get_stream());
+  check.start(tensors);
+  return check.get();
+}
+
+/** Return true if `tensor` has a NaN or infinite element. */
+template <typename T>
+bool has_nonfinite(Tensor<T> const& tensor)
+{
+  return has_nonfinite(std::vector<Tensor<T> const*>{&tensor});
+}
+
+}  // namespace h2
@@ -0,0 +1,410 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Pipeline-parallel execution of micro-batches over model stages.
+ *
+ * A model is split into `num_stages * num_chunks` consecutive virtual
+ * stages. Rank `s` of a pipeline communicator runs virtual stages
+ * `s`, `s + num_stages`, ..., one per chunk, so with more than one
+ * chunk the schedule is interleaved. Activations flow forward from
+ * each virtual stage to the next and gradients flow back, using the
+ * point-to-point tensor transfers in `send_recv.hpp`.
+ *
+ * When each stage runs on a processor grid, all stages use congruent
+ * grids, and the pipeline communicator of a rank connects the ranks
+ * with the same grid rank in every stage (e.g., made by splitting the
+ * world communicator with the grid rank as color). Activations are
+ * then the local tensors of the stages' distributed tensors.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/sync.hpp"
+#include "h2/tensor/dist_types.hpp"
+#include "h2/tensor/send_recv.hpp"
+#include "h2/tensor/tensor.hpp"
+#include "h2/tensor/tensor_types.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+namespace h2
+{
+
+/** Operations of a pipeline schedule. */
+enum class PipelineOpType
+{
+  Forward,
+  Backward
+};
+
+/** Support printing PipelineOpType. */
+inline std::ostream& operator<<(std::ostream& os, PipelineOpType const& type)
+{
+  switch (type)
+  {
+  case PipelineOpType::Forward: os << "Forward"; break;
+  case PipelineOpType::Backward: os << "Backward"; break;
+  default: os << "Unknown"; break;
+  }
+  return os;
+}
+
+/** One step of a pipeline schedule on a rank. */
+struct PipelineOp
+{
+  PipelineOpType type;
+  int micro_batch;
+  int chunk; /**< Which of the rank's virtual stages this runs. */
+};
+
+inline bool operator==(PipelineOp const& a, PipelineOp const& b) H2_NOEXCEPT
+{
+  return a.type == b.type && a.micro_batch == b.micro_batch
+         && a.chunk == b.chunk;
+}
+
+/**
+ * Return the order in which `stage` of `num_stages` runs the forward
+ * and backward passes of `num_micro_batches` micro-batches.
+ *
+ * With one chunk, this is the 1F1B schedule: after a warm-up of
+ * forward passes, forward and backward passes alternate, so at most
+ * `num_stages - stage` micro-batches are in flight on a stage. With
+ * more chunks, this is the interleaved schedule, which shrinks the
+ * pipeline bubble by the number of chunks, at the cost of more
+ * communication; `num_micro_batches` must then be a multiple of
+ * `num_stages`.
+ */
+std::vector<PipelineOp> make_pipeline_schedule(int num_stages,
+                                               int stage,
+                                               int num_micro_batches,
+                                               int num_chunks = 1);
+
+/**
+ * The computation of a rank's virtual stages, run by a
+ * `PipelineExecutor`.
+ *
+ * Implementations keep whatever they need for the backward pass of a
+ * micro-batch (beyond its input) themselves.
+ */
+template <typename T>
+class PipelineStage
+{
+public:
+  virtual ~PipelineStage() = default;
+
+  /**
+   * Compute `output` for `micro_batch` on `chunk` from `input`.
+   *
+   * `input` is null on the first virtual stage, which produces its own
+   * input. The output of the last virtual stage is not sent anywhere.
+   */
+  virtual void forward(int chunk,
+                       int micro_batch,
+                       Tensor<T> const* input,
+                       Tensor<T>& output) = 0;
+
+  /**
+   * Compute `grad_input` for `micro_batch` on `chunk` from
+   * `grad_output`.
+   *
+   * `input` is the input the forward pass got. `grad_output` is null on
+   * the last virtual stage (which computes the loss gradient itself)
+   * and `grad_input` is null on the first.
+   */
+  virtual void backward(int chunk,
+                        int micro_batch,
+                        Tensor<T> const* input,
+                        Tensor<T> const* grad_output,
+                        Tensor<T>* grad_input) = 0;
+};
+
+/**
+ * Run a pipeline schedule on this rank, transferring activations and
+ * gradients between stages.
+ *
+ * Activations and gradients (all with one shape) are lazy tensors that
+ * are allocated when a transfer or pass needs them and released as
+ * soon as they are not: a received input when its backward pass
+ * finishes, and an output or input gradient when it has been sent.
+ * Memory thus scales with the micro-batches in flight, which the
+ * schedule bounds. The receive for each step is posted before the
+ * previous step runs, so transfers overlap with computation, and
+ * sends complete in the background.
+ *
+ * Received data is written on the executor's stream, which stage
+ * passes should use.
+ */
+template <typename T>
+class PipelineExecutor
+{
+public:
+  /**
+   * Set up running `stage_impl_` on this rank of `comm_`, whose ranks
+   * are the pipeline stages in order.
+   */
+  PipelineExecutor(PipelineStage<T>& stage_impl_,
+                   Comm const& comm_,
+                   int num_chunks_,
+                   Device device_,
+                   ShapeTuple const& shape_,
+                   DimensionTypeTuple const& dim_types_,
+                   std::optional<ComputeStream> const stream_ = std::nullopt)
+    : stage_impl(stage_impl_),
+      comm(comm_),
+      num_stages(comm_.Size()),
+      stage(comm_.Rank()),
+      num_chunks(num_chunks_),
+      device(device_),
+      shape(shape_),
+      dim_types(dim_types_),
+      stream(stream_.value_or(ComputeStream{device_}))
+  {
+    H2_ASSERT_ALWAYS(num_chunks > 0,
+                     "Pipelines need at least one chunk per stage, got ",
+                     num_chunks);
+  }
+
+  /** Run forward and backward passes of `num_micro_batches`. */
+  void run(int num_micro_batches)
+  {
+    std::vector<PipelineOp> const ops = make_pipeline_schedule(
+      num_stages, stage, num_micro_batches, num_chunks);
+    slots.clear();
+    slots.resize(static_cast<std::size_t>(num_micro_batches) * num_chunks);
+    num_in_flight = 0;
+    max_in_flight = 0;
+
+    if (!ops.empty())
+    {
+      post_recv(ops.front());
+    }
+    for (std::size_t i = 0; i < ops.size(); ++i)
+    {
+      if (i + 1 < ops.size())
+      {
+        post_recv(ops[i + 1]);
+      }
+      if (ops[i].type == PipelineOpType::Forward)
+      {
+        run_forward(ops[i]);
+      }
+      else
+      {
+        run_backward(ops[i]);
+      }
+      test_sends();
+    }
+    for (auto& slot : slots)
+    {
+      if (slot && slot->sent != nullptr)
+      {
+        slot->send_req.wait();
+        slot->sent->release();
+      }
+    }
+    slots.clear();
+  }
+
+  /**
+   * Return the most micro-batches that had run a forward but not a
+   * backward pass on this rank at once in the last `run`.
+   */
+  int get_max_in_flight() const H2_NOEXCEPT { return max_in_flight; }
+
+private:
+  /** Buffers and transfers of one micro-batch on one chunk. */
+  struct Slot
+  {
+    Slot(Device device,
+         ShapeTuple const& shape,
+         DimensionTypeTuple const& dim_types,
+         ComputeStream const& stream)
+      : input(device, shape, dim_types, LazyAlloc, stream),
+        output(device, shape, dim_types, LazyAlloc, stream),
+        grad_output(device, shape, dim_types, LazyAlloc, stream),
+        grad_input(device, shape, dim_types, LazyAlloc, stream)
+    {}
+
+    Tensor<T> input;
+    Tensor<T> output;
+    Tensor<T> grad_output;
+    Tensor<T> grad_input;
+    TensorCommRequest input_req;
+    TensorCommRequest grad_output_req;
+    TensorCommRequest send_req;
+    Tensor<T>* sent = nullptr; /**< Buffer `send_req` reads. */
+  };
+
+  PipelineStage<T>& stage_impl;
+  Comm const& comm;
+  int num_stages;
+  int stage;
+  int num_chunks;
+  Device device;
+  ShapeTuple shape;
+  DimensionTypeTuple dim_types;
+  ComputeStream stream;
+  std::vector<std::unique_ptr<Slot>> slots;
+  int num_in_flight = 0;
+  int max_in_flight = 0;
+
+  Slot& get_slot(PipelineOp const& op)
+  {
+    auto& slot = slots[static_cast<std::size_t>(op.micro_batch) * num_chunks
+                       + op.chunk];
+    if (!slot)
+    {
+      slot = std::make_unique<Slot>(device, shape, dim_types, stream);
+    }
+    return *slot;
+  }
+
+  int get_virtual_stage(int chunk) const H2_NOEXCEPT
+  {
+    return chunk * num_stages + stage;
+  }
+
+  bool is_first(int chunk) const H2_NOEXCEPT
+  {
+    return get_virtual_stage(chunk) == 0;
+  }
+
+  bool is_last(int chunk) const H2_NOEXCEPT
+  {
+    return get_virtual_stage(chunk) == num_stages * num_chunks - 1;
+  }
+
+  int get_next_rank() const H2_NOEXCEPT { return (stage + 1) % num_stages; }
+
+  int get_prev_rank() const H2_NOEXCEPT
+  {
+    return (stage + num_stages - 1) % num_stages;
+  }
+
+  /**
+   * Return the tag of a transfer for `micro_batch` to `chunk` on the
+   * receiving rank, in direction `type`.
+   */
+  int get_tag(PipelineOpType type, int micro_batch, int chunk) const
+  {
+    int const tag = (micro_batch * num_chunks + chunk) * 2
+                    + (type == PipelineOpType::Forward ? 0 : 1);
+    // MPI guarantees tags up to at least this.
+    H2_ASSERT_ALWAYS(tag <= 32767,
+                     "Too many micro-batches and chunks for pipeline tags");
+    return tag;
+  }
+
+  void post_recv(PipelineOp const& op)
+  {
+    Slot& slot = get_slot(op);
+    if (op.type == PipelineOpType::Forward && !is_first(op.chunk))
+    {
+      slot.input.ensure();
+      slot.input_req = irecv(slot.input,
+                            get_prev_rank(),
+                            comm,
+                            get_tag(op.type, op.micro_batch, op.chunk));
+    }
+    else if (op.type == PipelineOpType::Backward && !is_last(op.chunk))
+    {
+      slot.grad_output.ensure();
+      slot.grad_output_req = irecv(slot.grad_output,
+                            get_next_rank(),
+                            comm,
+                            get_tag(op.type, op.micro_batch, op.chunk));
+    }
+  }
+
+  void run_forward(PipelineOp const& op)
+  {
+    Slot& slot = get_slot(op);
+    slot.input_req.wait();
+    slot.output.ensure();
+    stage_impl.forward(op.chunk,
+                       op.micro_batch,
+                       is_first(op.chunk) ? nullptr : &slot.input,
+                       slot.output);
+    num_in_flight += 1;
+    max_in_flight = std::max(max_in_flight, num_in_flight);
+    if (is_last(op.chunk))
+    {
+      slot.output.release();
+      return;
+    }
+    // The next virtual stage is on the next rank, in the next chunk
+    // after wrapping around.
+    int const next_chunk = op.chunk + (stage == num_stages - 1 ? 1 : 0);
+    slot.send_req = isend(slot.output,
+                          get_next_rank(),
+                          comm,
+                          get_tag(op.type, op.micro_batch, next_chunk));
+    slot.sent = &slot.output;
+  }
+
+  void run_backward(PipelineOp const& op)
+  {
+    Slot& slot = get_slot(op);
+    slot.grad_output_req.wait();
+    // Complete the forward's send before its buffer is reused.
+    slot.send_req.wait();
+    if (slot.sent != nullptr)
+    {
+      slot.sent->release();
+      slot.sent = nullptr;
+    }
+    bool const first = is_first(op.chunk);
+    if (!first)
+    {
+      slot.grad_input.ensure();
+    }
+    stage_impl.backward(op.chunk,
+                        op.micro_batch,
+                        first ? nullptr : &slot.input,
+                        is_last(op.chunk) ? nullptr : &slot.grad_output,
+                        first ? nullptr : &slot.grad_input);
+    num_in_flight -= 1;
+    slot.input.release();
+    slot.grad_output.release();
+    if (first)
+    {
+      return;
+    }
+    int const prev_chunk = op.chunk - (stage == 0 ? 1 : 0);
+    slot.send_req = isend(slot.grad_input,
+                          get_prev_rank(),
+                          comm,
+                          get_tag(op.type, op.micro_batch, prev_chunk));
+    slot.sent = &slot.grad_input;
+  }
+
+  /** Release the buffers of sends that have completed. */
+  void test_sends()
+  {
+    for (auto& slot : slots)
+    {
+      if (slot && slot->sent != nullptr && slot->send_req.test())
+      {
+        slot->sent->release();
+        slot->sent = nullptr;
+      }
+    }
+  }
+};
+
+}  // namespace h2
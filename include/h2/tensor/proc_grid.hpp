@@ -14,13 +14,17 @@
 
 #include "h2/tensor/dist_types.hpp"
 #include "h2/tensor/tensor_types.hpp"
+#include "h2/tensor/tensor_utils.hpp"
 #include "h2/utils/As.hpp"
 #include "h2/utils/Describable.hpp"
 #include "h2/utils/Error.hpp"
 
 #include <El.hpp>
 
+#include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace h2
 {
@@ -33,16 +37,17 @@ namespace h2
  * process grid. It is an error if the size of the communicator does
  * not exactly match the number of processors required for the grid.
  *
- * Currently processors are mapped to the grid in a generalized column-
- * major order. (This may be configurable in the future.)
+ * By default, processors are mapped to the grid in a generalized
+ * column-major order, where consecutive ranks are adjacent in the
+ * first dimension. A different dimension order may be given, listing
+ * the dimensions from fastest- to slowest-varying.
  *
  * Grids also provide a notion of a rank in each dimension.
  *
  * The underlying communicator will be duplicated.
  *
- * \note There is no attempt at "topology-aware" mapping here (e.g.,
- * `MPI_Cart_create`). Users should manually manage this on the input
- * communicator if desired.
+ * \note The constructors make no attempt at "topology-aware" mapping.
+ * See `make_topology_aware_grid` for that.
  */
 class ProcessorGrid final : public Describable
 {
@@ -55,6 +60,17 @@ public:
    * Construct a processor grid of the given shape over the communicator.
    */
   ProcessorGrid(Comm const& comm_, ShapeTuple shape_)
+    : ProcessorGrid(comm_, shape_, get_default_dim_order(shape_.size()))
+  {}
+
+  /**
+   * Construct a processor grid of the given shape over the
+   * communicator, with ranks mapped to the grid in the given dimension
+   * order (fastest-varying first).
+   */
+  ProcessorGrid(Comm const& comm_,
+                ShapeTuple shape_,
+                DimensionOrderTuple dim_order_)
   {
     H2_ASSERT_ALWAYS(comm_.Size() == product<RankType>(shape_),
                      "Grid size (",
@@ -62,14 +78,30 @@ public:
                      ") must match communicator size (",
                      comm_.Size(),
                      ")");
+    H2_ASSERT_ALWAYS(is_dimension_order(dim_order_, shape_.size()),
+                     "Invalid dimension order ",
+                     dim_order_,
+                     " for grid of shape ",
+                     shape_);
     grid_comm = std::make_shared<Comm>(comm_.GetMPIComm());
+    subcomms = std::make_shared<SubcommCache>();
     grid_shape = shape_;
-    // Currently fix a column-major ordering.
-    grid_strides = prefix_product<typename GridStrideTuple::type>(shape_);
+    grid_dim_order = dim_order_;
+    grid_strides = GridStrideTuple(TuplePad<GridStrideTuple>(shape_.size()));
+    RankType stride = 1;
+    for (auto const& dim : dim_order_)
+    {
+      grid_strides[dim] = stride;
+      stride *= safe_as<RankType>(shape_[dim]);
+    }
   }
 
   /** Construct a null processor grid. */
-  ProcessorGrid() { grid_comm = std::make_shared<Comm>(); }
+  ProcessorGrid()
+  {
+    grid_comm = std::make_shared<Comm>();
+    subcomms = std::make_shared<SubcommCache>();
+  }
 
   /** Get a reference to the underlying communicator. */
   Comm& comm() H2_NOEXCEPT { return *grid_comm; }
@@ -77,6 +109,32 @@ public:
   /** Get a constant reference to the underlying communicator. */
   Comm const& comm() const H2_NOEXCEPT { return *grid_comm; }
 
+  /**
+   * Return a communicator over the processes whose grid coordinates
+   * differ from the caller's only in the dimensions `dims`.
+   *
+   * For example, on a 2D grid, `get_subcomm({0})` spans the caller's
+   * column and `get_subcomm({1})` its row. Ranks in the communicator
+   * are the processes' coordinates in `dims`, with the first dimension
+   * varying fastest. The communicator's Aluminum backends (e.g., NCCL)
+   * are created by Hydrogen on first use.
+   *
+   * Communicators are created on the first request for a given `dims`
+   * and cached: later calls, including through copies of this grid
+   * (and hence by every `DistTensor` on it), return the same one.
+   * Creating one is collective over the grid, so all processes must
+   * request the same `dims` in the same order; later calls are not
+   * collective.
+   */
+  Comm& get_subcomm(DimensionOrderTuple const& dims) const;
+
+  /** Return the number of cached sub-communicators. */
+  std::size_t get_num_cached_subcomms() const
+  {
+    std::lock_guard<std::mutex> lock(subcomms->mutex);
+    return subcomms->comms.size();
+  }
+
   /** Return the shape of the grid. */
   ShapeTuple shape() const H2_NOEXCEPT { return grid_shape; }
 
@@ -87,6 +145,18 @@ public:
     return grid_shape[i];
   }
 
+  /**
+   * Return the order in which ranks are mapped to grid dimensions,
+   * from fastest- to slowest-varying.
+   */
+  DimensionOrderTuple dim_order() const H2_NOEXCEPT { return grid_dim_order; }
+
+  /**
+   * Return the stride of each grid dimension, i.e., how much a rank
+   * changes per index of the dimension.
+   */
+  GridStrideTuple strides() const H2_NOEXCEPT { return grid_strides; }
+
   /** Return the number of dimensions (i.e., the rank) of the grid. */
   typename ShapeTuple::size_type ndim() const H2_NOEXCEPT
   {
@@ -180,25 +250,27 @@ public:
   /**
    * Return true if this grid is identical to the other grid.
    *
-   * Two grids are identical if they have the same shape and use the
-   * same underlying communicator.
+   * Two grids are identical if they have the same shape and dimension
+   * order and use the same underlying communicator.
    */
   bool is_identical_to(ProcessorGrid const& other) const H2_NOEXCEPT
   {
     return (grid_shape == other.grid_shape)
+           && (grid_dim_order == other.grid_dim_order)
            && (grid_comm->GetMPIComm() == other.grid_comm->GetMPIComm());
   }
 
   /**
    * Return true if this grid is congruent to the other grid.
    *
-   * Two grids are congruent if they have the same shape and the
-   * underlying communicators consist of the same processes in the same
-   * order (i.e., they are `MPI_CONGRUENT`).
+   * Two grids are congruent if they have the same shape and dimension
+   * order and the underlying communicators consist of the same
+   * processes in the same order (i.e., they are `MPI_CONGRUENT`).
    */
   bool is_congruent_to(ProcessorGrid const& other) const H2_NOEXCEPT
   {
-    if (grid_shape != other.grid_shape)
+    if (grid_shape != other.grid_shape
+        || grid_dim_order != other.grid_dim_order)
     {
       return false;
     }
@@ -214,11 +286,53 @@ public:
     return result == MPI_IDENT || result == MPI_CONGRUENT;
   }
 
+  /**
+   * Return true if this grid is similar to the other grid.
+   *
+   * Two grids are similar if their underlying communicators consist
+   * of the same processes in the same order, but the grids may have
+   * different shapes. A process has the same rank in similar grids.
+   */
+  bool is_similar_to(ProcessorGrid const& other) const H2_NOEXCEPT
+  {
+    if (grid_comm->GetMPIComm() == MPI_COMM_NULL
+        || other.grid_comm->GetMPIComm() == MPI_COMM_NULL)
+    {
+      return grid_comm->GetMPIComm() == other.grid_comm->GetMPIComm();
+    }
+    int result;
+    MPI_Comm_compare(
+      grid_comm->GetMPIComm(), other.grid_comm->GetMPIComm(), &result);
+    return result == MPI_IDENT || result == MPI_CONGRUENT;
+  }
+
 private:
+  /** Cache of communicators over subsets of grid dimensions. */
+  struct SubcommCache
+  {
+    std::mutex mutex;
+    std::map<std::vector<NDimType>, std::unique_ptr<Comm>> comms;
+  };
+
   /** Underlying communicator for the grid. */
   std::shared_ptr<Comm> grid_comm;
-  ShapeTuple grid_shape;        /**< Shape of the grid. */
-  GridStrideTuple grid_strides; /**< Strides for computing indices. */
+  /** Sub-communicators, shared by copies of the grid. */
+  std::shared_ptr<SubcommCache> subcomms;
+  ShapeTuple grid_shape;              /**< Shape of the grid. */
+  DimensionOrderTuple grid_dim_order; /**< Order ranks are mapped in. */
+  GridStrideTuple grid_strides;       /**< Strides for computing indices. */
+
+  /** Return the column-major dimension order for `ndim` dimensions. */
+  static DimensionOrderTuple
+  get_default_dim_order(typename ShapeTuple::size_type ndim)
+  {
+    DimensionOrderTuple order(TuplePad<DimensionOrderTuple>(ndim));
+    for (typename ShapeTuple::size_type i = 0; i < ndim; ++i)
+    {
+      order[i] = static_cast<typename DimensionOrderTuple::type>(i);
+    }
+    return order;
+  }
 };
 
 /**
@@ -238,4 +352,28 @@ inline bool operator!=(ProcessorGrid const& grid1, ProcessorGrid const& grid2)
   return !grid1.is_identical_to(grid2);
 }
 
+/**
+ * Construct a processor grid of the given shape over `comm` that keeps
+ * communication in the dimensions `comm_dims` within nodes, as far as
+ * possible.
+ *
+ * `comm_dims` lists grid dimensions from the most to the least heavily
+ * communicating (e.g., a halo exchange dimension first); dimensions
+ * not listed follow in order. Processes are grouped by node (using
+ * `MPI_Comm_split_type` with `MPI_COMM_TYPE_SHARED`), and the grid's
+ * dimension order maps the first dimensions of `comm_dims` onto
+ * consecutive processes of a node. When a node's processes cover
+ * whole lines of the first dimension (e.g., a dimension of size 4 on
+ * nodes of 4 or 8 GPUs), its communication never leaves the node.
+ *
+ * The process order within a node is that of `comm`, and nodes are
+ * ordered by their lowest rank in `comm`, so if `comm` is already
+ * ordered by node, so is the grid's communicator.
+ *
+ * This is collective over `comm`.
+ */
+ProcessorGrid make_topology_aware_grid(Comm const& comm,
+                                       ShapeTuple shape,
+                                       DimensionOrderTuple comm_dims);
+
 }  // namespace h2
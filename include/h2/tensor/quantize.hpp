@@ -0,0 +1,269 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Tensors of 8-bit integers quantized with per-tensor or per-channel
+ * scales and zero points.
+ *
+ * A quantized value `q` represents the real value
+ * `(q - zero_point) * scale`. Quantized data is stored in an ordinary
+ * `Tensor<std::int8_t>` (`std::int8_t` is a storage type), so it may be
+ * viewed, copied, and communicated like any other tensor, at a quarter
+ * of the bytes of `float`.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+#include "h2/gpu/macros.hpp"
+#include "h2/tensor/tensor.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace h2
+{
+
+/**
+ * Return the 8-bit quantization of `val` with the given scale and zero
+ * point, rounded to nearest (ties away from zero) and saturated.
+ *
+ * This may be called in GPU kernels to fuse quantization into them.
+ */
+template <typename T>
+H2_GPU_HOST_DEVICE inline std::int8_t
+quantize_value(T val, float scale, std::int32_t zero_point)
+{
+  T q = val / static_cast<T>(scale) + static_cast<T>(zero_point);
+  // Written so NaNs saturate to the minimum.
+  if (!(q > static_cast<T>(-128)))
+  {
+    q = static_cast<T>(-128);
+  }
+  if (q > static_cast<T>(127))
+  {
+    q = static_cast<T>(127);
+  }
+  return static_cast<std::int8_t>(q + static_cast<T>(q >= 0 ? 0.5 : -0.5));
+}
+
+/**
+ * Return the real value of the quantized value `q` with the given scale
+ * and zero point.
+ *
+ * This may be called in GPU kernels to dequantize data as it is loaded.
+ */
+template <typename T>
+H2_GPU_HOST_DEVICE inline T
+dequantize_value(std::int8_t q, float scale, std::int32_t zero_point)
+{
+  return static_cast<T>(static_cast<std::int32_t>(q) - zero_point)
+         * static_cast<T>(scale);
+}
+
+/**
+ * A tensor of 8-bit quantized values with either one scale and zero
+ * point for the whole tensor or one for each index of a channel
+ * dimension.
+ *
+ * Per-channel scales and zero points are kept in tensors on the same
+ * device as the data, so kernels broadcast them along the other
+ * dimensions with 0 strides (see `get_param_strides`) instead of
+ * computing channel indices.
+ */
+class QuantizedTensor
+{
+public:
+  /** Construct a tensor quantized with one scale and zero point. */
+  QuantizedTensor(Device device,
+                  ShapeTuple const& shape,
+                  DimensionTypeTuple const& dim_types,
+                  float scale,
+                  std::int32_t zero_point,
+                  std::optional<ComputeStream> const stream = std::nullopt);
+
+  /**
+   * Construct a tensor quantized with a scale and zero point for each
+   * index of dimension `channel_dim`.
+   */
+  QuantizedTensor(Device device,
+                  ShapeTuple const& shape,
+                  DimensionTypeTuple const& dim_types,
+                  typename ShapeTuple::size_type channel_dim,
+                  std::vector<float> const& scales,
+                  std::vector<std::int32_t> const& zero_points,
+                  std::optional<ComputeStream> const stream = std::nullopt);
+
+  /** Return the quantized values. */
+  Tensor<std::int8_t>& data() noexcept { return *qdata; }
+  /** Return the quantized values. */
+  Tensor<std::int8_t> const& data() const noexcept { return *qdata; }
+
+  ShapeTuple shape() const { return qdata->shape(); }
+  DimensionTypeTuple dim_types() const { return qdata->dim_types(); }
+  Device get_device() const { return qdata->get_device(); }
+  ComputeStream get_stream() const { return qdata->get_stream(); }
+
+  /** Return true if there is a scale and zero point per channel. */
+  bool is_per_channel() const noexcept { return per_channel; }
+
+  /** Return the channel dimension of a per-channel tensor. */
+  typename ShapeTuple::size_type get_channel_dim() const
+  {
+    H2_ASSERT_DEBUG(per_channel, "Tensor is not quantized per channel");
+    return channel_dim;
+  }
+
+  /** Return the scales (one for a per-tensor quantized tensor). */
+  std::vector<float> const& get_scales() const noexcept { return scales; }
+  /** Return the zero points (one for a per-tensor quantized tensor). */
+  std::vector<std::int32_t> const& get_zero_points() const noexcept
+  {
+    return zero_points;
+  }
+
+  /** Return the scales on the device of the data. */
+  Tensor<float> const& get_scales_tensor() const noexcept
+  {
+    return *scales_tensor;
+  }
+  /** Return the zero points on the device of the data. */
+  Tensor<std::int32_t> const& get_zero_points_tensor() const noexcept
+  {
+    return *zero_points_tensor;
+  }
+
+  /**
+   * Return strides for the scale and zero point tensors that broadcast
+   * them over the shape of the data.
+   */
+  StrideTuple get_param_strides() const;
+
+private:
+  void init_params(ComputeStream const& stream);
+
+  std::unique_ptr<Tensor<std::int8_t>> qdata;
+  bool per_channel;
+  typename ShapeTuple::size_type channel_dim;
+  std::vector<float> scales;
+  std::vector<std::int32_t> zero_points;
+  std::unique_ptr<Tensor<float>> scales_tensor;
+  std::unique_ptr<Tensor<std::int32_t>> zero_points_tensor;
+};
+
+namespace impl
+{
+
+template <typename T>
+void quantize_impl(CPUDev_t, QuantizedTensor& dst, Tensor<T> const& src);
+template <typename T>
+void dequantize_impl(CPUDev_t, Tensor<T>& dst, QuantizedTensor const& src);
+#ifdef H2_HAS_GPU
+template <typename T>
+void quantize_impl(GPUDev_t, QuantizedTensor& dst, Tensor<T> const& src);
+template <typename T>
+void dequantize_impl(GPUDev_t, Tensor<T>& dst, QuantizedTensor const& src);
+#endif
+
+}  // namespace impl
+
+/**
+ * Quantize `src` into `dst`, which must have the same shape and be on
+ * the same device.
+ *
+ * `T` must be `float` or `double`. On GPUs, this is asynchronous.
+ */
+template <typename T>
+void quantize(QuantizedTensor& dst, Tensor<T> const& src)
+{
+  static_assert(std::is_floating_point_v<T>,
+                "Can only quantize floating point tensors");
+  H2_ASSERT_ALWAYS(dst.get_device() == src.get_device(),
+                   "Cannot quantize from ",
+                   src.get_device(),
+                   " to ",
+                   dst.get_device());
+  H2_ASSERT_ALWAYS(dst.shape() == src.shape(),
+                   "Cannot quantize a tensor of shape ",
+                   src.shape(),
+                   " into a quantized tensor of shape ",
+                   dst.shape());
+  if (src.is_empty())
+  {
+    return;
+  }
+  H2_DEVICE_DISPATCH_SAME(src.get_device(),
+                          impl::quantize_impl(DeviceT_v<Dev>, dst, src));
+}
+
+/**
+ * Dequantize `src` into `dst`, fusing the conversion into a single
+ * pass over the data.
+ *
+ * `dst` is resized like in `copy`, and must be on the same device as
+ * `src`. `T` must be `float` or `double`. On GPUs, this is
+ * asynchronous.
+ */
+template <typename T>
+void dequantize(Tensor<T>& dst, QuantizedTensor const& src)
+{
+  static_assert(std::is_floating_point_v<T>,
+                "Can only dequantize into floating point tensors");
+  H2_ASSERT_ALWAYS(dst.get_device() == src.get_device(),
+                   "Cannot dequantize from ",
+                   src.get_device(),
+                   " to ",
+                   dst.get_device());
+  Tensor<std::int8_t> const& qdata = src.data();
+  if (qdata.is_empty())
+  {
+    dst.empty();
+    return;
+  }
+  if (dst.is_view())
+  {
+    H2_ASSERT_ALWAYS(!dst.is_const_view(), "Cannot write into a const view");
+    H2_ASSERT_ALWAYS(dst.shape() == qdata.shape(),
+                     "Cannot dequantize a tensor of shape ",
+                     qdata.shape(),
+                     " into a view of shape ",
+                     dst.shape());
+  }
+  else
+  {
+    dst.resize(qdata.shape(), qdata.dim_types(), qdata.strides());
+    dst.ensure();
+  }
+  H2_DEVICE_DISPATCH_SAME(src.get_device(),
+                          impl::dequantize_impl(DeviceT_v<Dev>, dst, src));
+}
+
+/**
+ * Return a new tensor with the dequantized values of `src`, with the
+ * same shape and strides, on the same device.
+ */
+template <typename DstT>
+std::unique_ptr<Tensor<DstT>> cast(QuantizedTensor const& src)
+{
+  Tensor<std::int8_t> const& qdata = src.data();
+  auto dst = std::make_unique<Tensor<DstT>>(src.get_device(),
+                                            qdata.shape(),
+                                            qdata.dim_types(),
+                                            qdata.strides(),
+                                            StrictAlloc,
+                                            src.get_stream());
+  dequantize(*dst, src);
+  return dst;
+}
+
+}  // namespace h2
@@ -14,13 +14,16 @@
 
 #include "h2/core/allocator.hpp"
 #include "h2/core/device.hpp"
+#include "h2/core/scratch_arena.hpp"
 #include "h2/core/sync.hpp"
 #include "h2/tensor/tensor_types.hpp"
 #include "h2/utils/typename.hpp"
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <ostream>
 #include <unordered_map>
 
@@ -45,40 +48,138 @@ public:
   RawBuffer(Device dev,
             std::size_t size,
             bool defer_alloc,
-            ComputeStream const& stream_)
+            ComputeStream const& stream_,
+            MemoryKind mem_kind = MemoryKind::Default)
     : buffer(nullptr),
       buffer_size(size),
+      buffer_capacity(0),
       unowned_buffer(false),
       buffer_device(dev),
-      stream(stream_)
+      stream(stream_),
+      memory_kind(mem_kind),
+      arena(nullptr)
   {
+    H2_ASSERT_DEBUG(memory_kind != MemoryKind::Pinned || dev == Device::CPU,
+                    "Pinned memory is only supported for CPU buffers");
+    H2_ASSERT_DEBUG(memory_kind != MemoryKind::Managed || dev != Device::CPU,
+                    "Managed memory is only supported for GPU buffers");
     if (!defer_alloc)
     {
       ensure();
     }
   }
 
+  /**
+   * Wrap an external buffer.
+   *
+   * If `owner_` is given, it is kept alive until the buffer is
+   * released, e.g., to tie the lifetime of a memory mapping to the
+   * buffer and everything viewing it.
+   */
   RawBuffer(Device dev,
             T* external_buffer,
             std::size_t size,
-            ComputeStream const& stream_)
+            ComputeStream const& stream_,
+            std::shared_ptr<void> owner_ = nullptr)
     : buffer(external_buffer),
       buffer_size(size),
+      buffer_capacity(size),
       unowned_buffer(true),
       buffer_device(dev),
-      stream(stream_)
+      stream(stream_),
+      memory_kind(MemoryKind::Default),
+      arena(nullptr),
+      external_owner(std::move(owner_))
   {}
 
   ~RawBuffer() { H2_TERMINATE_ON_THROW_ALWAYS(release()); }
 
-  /** Allocate memory if the buffer is not present. */
-  void ensure()
+  /**
+   * Release the current buffer and wrap an external buffer instead, as
+   * if newly constructed to wrap it.
+   *
+   * This lets a wrapper be pointed at different external memory
+   * without allocating a new `RawBuffer`.
+   */
+  void wrap(Device dev,
+            T* external_buffer,
+            std::size_t size,
+            ComputeStream const& stream_)
+  {
+    release();
+    buffer = external_buffer;
+    buffer_size = size;
+    buffer_capacity = size;
+    unowned_buffer = true;
+    buffer_device = dev;
+    stream = stream_;
+    memory_kind = MemoryKind::Default;
+    ++version;
+  }
+
+  /**
+   * Allocate memory if the buffer is not present.
+   *
+   * If a `ScratchArenaScope` is active for the buffer's device, memory
+   * is drawn from its arena when possible, unless `use_arena` is false
+   * (e.g., because the buffer may outlive the scope).
+   */
+  void ensure(bool use_arena = true)
   {
     if (buffer_size && !buffer && !unowned_buffer)
     {
+      if (ScratchArena* cur_arena = internal::get_current_arena(buffer_device);
+          use_arena && cur_arena && memory_kind == MemoryKind::Default)
+      {
+        buffer = static_cast<T*>(cur_arena->allocate(buffer_size * sizeof(T)));
+        if (buffer)
+        {
+          arena = cur_arena;
+          buffer_capacity = buffer_size;
+          return;
+        }
+      }
       H2_DEVICE_DISPATCH_SAME(
         buffer_device,
-        (buffer = internal::Allocator<T, Dev>::allocate(buffer_size, stream)));
+        (buffer =
+           internal::allocate<T, Dev>(buffer_size, stream, memory_kind)));
+      buffer_capacity = buffer_size;
+    }
+  }
+
+  /**
+   * Allocate memory if the buffer is not present, ordering the
+   * allocation on `alloc_stream` rather than the buffer's stream.
+   *
+   * The buffer's stream is made to wait for the allocation, so this
+   * can be issued ahead of the buffer's first use without stalling it.
+   * When the buffer is released, memory is returned on `alloc_stream`
+   * after it has waited for the buffer's stream.
+   *
+   * Scratch arenas are not used, since their memory is ordered on the
+   * arena's stream.
+   */
+  void ensure_async(ComputeStream const& alloc_stream)
+  {
+    if (alloc_stream == stream)
+    {
+      ensure();
+      return;
+    }
+    H2_ASSERT_DEBUG(alloc_stream.get_device() == buffer_device,
+                    "Cannot allocate a buffer on device ",
+                    buffer_device,
+                    " on a stream for device ",
+                    alloc_stream.get_device());
+    if (buffer_size && !buffer && !unowned_buffer)
+    {
+      H2_DEVICE_DISPATCH_SAME(
+        buffer_device,
+        (buffer = internal::allocate<T, Dev>(
+           buffer_size, alloc_stream, memory_kind)));
+      buffer_capacity = buffer_size;
+      async_alloc_stream = alloc_stream;
+      stream.wait_for(alloc_stream);
     }
   }
 
@@ -100,32 +201,95 @@ public:
         stream.wait_for(event);
       }
 
-      if (!unowned_buffer)
+      if (arena)
       {
+        arena->deallocate(buffer, stream);
+        arena = nullptr;
+      }
+      else if (!unowned_buffer)
+      {
+        if (async_alloc_stream.has_value())
+        {
+          // Return the memory on the stream it came from.
+          async_alloc_stream->wait_for(stream);
+        }
         H2_DEVICE_DISPATCH_SAME(
           buffer_device,
-          (internal::Allocator<T, Dev>::deallocate(buffer, stream)));
+          (internal::deallocate<T, Dev>(buffer,
+                                        buffer_capacity,
+                                        async_alloc_stream.value_or(stream),
+                                        memory_kind)));
       }
       buffer = nullptr;
+      buffer_capacity = 0;
       unowned_buffer = false;
+      async_alloc_stream.reset();
+      external_owner.reset();
+      mirror.reset();
     }
     // Clear all sync registrations.
     pending_streams.clear();
 #else   // H2_HAS_GPU
     if (buffer)
     {
-      if (!unowned_buffer)
+      if (arena)
+      {
+        arena->deallocate(buffer, stream);
+        arena = nullptr;
+      }
+      else if (!unowned_buffer)
       {
-        internal::Allocator<T, Device::CPU>::deallocate(buffer, stream);
+        // CPU streams are ordered, so the allocation stream is moot.
+        internal::deallocate<T, Device::CPU>(
+          buffer, buffer_capacity, stream, memory_kind);
       }
       buffer = nullptr;
+      buffer_capacity = 0;
       unowned_buffer = false;
+      async_alloc_stream.reset();
+      external_owner.reset();
+      mirror.reset();
     }
 #endif  // H2_HAS_GPU
   }
 
   Device get_device() const H2_NOEXCEPT { return buffer_device; }
 
+  MemoryKind get_memory_kind() const H2_NOEXCEPT { return memory_kind; }
+
+  /** Return true if this wraps an externally managed buffer. */
+  bool is_external() const H2_NOEXCEPT { return buffer && unowned_buffer; }
+
+  /**
+   * Asynchronously migrate the buffer to `dev` on `on_stream`.
+   *
+   * If `on_stream` is not the buffer's stream, the caller must
+   * `register_release` it before the buffer is released.
+   *
+   * This only has an effect for managed memory that has been allocated.
+   */
+  void prefetch(Device dev, ComputeStream const& on_stream)
+  {
+    if (buffer && memory_kind == MemoryKind::Managed)
+    {
+      internal::managed_prefetch(
+        buffer, buffer_size * sizeof(T), dev, on_stream);
+    }
+  }
+
+  /**
+   * Set a placement hint for the buffer with respect to `dev`.
+   *
+   * This only has an effect for managed memory that has been allocated.
+   */
+  void advise(ManagedAdvice advice, Device dev)
+  {
+    if (buffer && memory_kind == MemoryKind::Managed)
+    {
+      internal::managed_advise(buffer, buffer_size * sizeof(T), advice, dev);
+    }
+  }
+
   T* data() H2_NOEXCEPT { return buffer; }
 
   T const* data() const H2_NOEXCEPT { return buffer; }
@@ -134,10 +298,87 @@ public:
 
   std::size_t size() const H2_NOEXCEPT { return buffer_size; }
 
+  /**
+   * Return the number of elements allocated, which may exceed `size`
+   * after `resize_in_place`. This is 0 if nothing is allocated.
+   */
+  std::size_t capacity() const H2_NOEXCEPT
+  {
+    return buffer ? buffer_capacity : 0;
+  }
+
+  /**
+   * Change the number of elements in the buffer without reallocating,
+   * returning whether this was possible.
+   *
+   * This succeeds if no memory is allocated yet (the new size is
+   * allocated by `ensure`) or if the allocation holds at least
+   * `new_size` elements, in which case the allocation is kept as is
+   * and its contents are unchanged. External buffers cannot be
+   * resized.
+   */
+  bool resize_in_place(std::size_t new_size)
+  {
+    if (unowned_buffer)
+    {
+      return false;
+    }
+    if (buffer && new_size > buffer_capacity)
+    {
+      return false;
+    }
+    buffer_size = new_size;
+    mark_modified();
+    return true;
+  }
+
   ComputeStream const& get_stream() const H2_NOEXCEPT { return stream; }
 
   void set_stream(ComputeStream const& stream_) { stream = stream_; }
 
+  /**
+   * Return the buffer's version, which changes whenever it may have
+   * been modified (see `mark_modified`).
+   */
+  std::uint64_t get_version() const H2_NOEXCEPT { return version; }
+
+  /**
+   * Record that the buffer's contents may have changed.
+   *
+   * This invalidates any mirror of the buffer.
+   */
+  void mark_modified() H2_NOEXCEPT { ++version; }
+
+  /**
+   * Return a copy of this buffer on `dev` that was cached with
+   * `set_mirror`, or null if there is none or it is stale.
+   *
+   * A mirror is stale once either it or this buffer has been modified
+   * since it was cached.
+   */
+  std::shared_ptr<RawBuffer<T>> get_mirror(Device dev) const H2_NOEXCEPT
+  {
+    if (mirror && mirror->get_device() == dev && mirror_base_version == version
+        && mirror->get_version() == mirror_version)
+    {
+      return mirror;
+    }
+    return nullptr;
+  }
+
+  /**
+   * Cache `mirror_` as an up-to-date copy of this buffer on another
+   * device.
+   *
+   * Only one mirror is kept; this replaces any existing one.
+   */
+  void set_mirror(std::shared_ptr<RawBuffer<T>> mirror_) H2_NOEXCEPT
+  {
+    mirror = std::move(mirror_);
+    mirror_base_version = version;
+    mirror_version = mirror ? mirror->get_version() : 0;
+  }
+
   /**
    * Inform the RawBuffer that a stream is no longer using the
    * RawBuffer, but may have pending operations, and therefore needs to
@@ -174,11 +415,26 @@ public:
   }
 
 private:
-  T* buffer;               /**< Internal buffer. */
-  std::size_t buffer_size; /**< Number of elements in buffer. */
-  bool unowned_buffer;     /**< Whether buffer is externally managed. */
-  Device buffer_device;    /**< Device on which buffer was allocated. */
-  ComputeStream stream;    /**< Device stream for synchronization. */
+  T* buffer;                   /**< Internal buffer. */
+  std::size_t buffer_size;     /**< Number of elements in buffer. */
+  std::size_t buffer_capacity; /**< Number of elements allocated. */
+  bool unowned_buffer;         /**< Whether buffer is externally managed. */
+  Device buffer_device;        /**< Device on which buffer was allocated. */
+  ComputeStream stream;        /**< Device stream for synchronization. */
+  MemoryKind memory_kind;      /**< Kind of memory backing buffer. */
+  ScratchArena* arena;         /**< Arena buffer came from, if any. */
+  /** Stream the buffer was allocated on, if not `stream`. */
+  std::optional<ComputeStream> async_alloc_stream;
+  /** Keeps an external buffer's memory alive, if set. */
+  std::shared_ptr<void> external_owner;
+  /** Counter bumped whenever the buffer may have been modified. */
+  std::uint64_t version = 0;
+  /** Cached copy of the buffer on another device, if any. */
+  std::shared_ptr<RawBuffer<T>> mirror;
+  /** `version` when `mirror` was cached. */
+  std::uint64_t mirror_base_version = 0;
+  /** Version of `mirror` when it was cached. */
+  std::uint64_t mirror_version = 0;
 
 #ifdef H2_HAS_GPU
   /**
@@ -0,0 +1,150 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Load balancing of distributed tensors.
+ *
+ * Uniform Block distributions assume every rank processes its block at
+ * the same speed. When some are consistently slower (heterogeneous
+ * nodes, or blocks with more boundary work), everyone waits for them
+ * at each synchronization. Rebalancing switches a dimension to a
+ * Variable distribution whose block sizes are proportional to the
+ * speed each rank achieved on its current block, as measured by the
+ * caller or by the straggler monitor (see `straggler_monitor.hpp`),
+ * and redistributes the tensor to match.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/copy.hpp"
+#include "h2/tensor/dist_tensor.hpp"
+#include "h2/tensor/dist_types.hpp"
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/proc_grid.hpp"
+#include "h2/tensor/tensor_types.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <vector>
+
+namespace h2
+{
+
+/**
+ * Return block sizes that balance the work of a dimension.
+ *
+ * `block_sizes` are the current sizes of each rank's block and
+ * `work_times` the time each rank took to process it. New sizes are
+ * proportional to each rank's speed (size over time), sum to the same
+ * total, and are at least `min_size` (or as close as the total
+ * allows). Ranks with no block or no time are assumed to have the
+ * mean speed of the others.
+ */
+BlockSizes compute_balanced_block_sizes(BlockSizes const& block_sizes,
+                                        std::vector<double> const& work_times,
+                                        DimType min_size = 1);
+
+/**
+ * Return the work time of each rank of dimension `dim` of `grid`,
+ * given the time `rank_times` of each rank of the grid.
+ *
+ * Ranks that share a coordinate in `dim` hold blocks of the same size
+ * in that dimension, so each coordinate takes the slowest time of its
+ * ranks.
+ */
+std::vector<double> get_dim_work_times(ProcessorGrid const& grid,
+                                       typename ShapeTuple::size_type dim,
+                                       std::vector<double> const& rank_times);
+
+/**
+ * Return the mean work time of each rank of `grid` as measured by the
+ * straggler monitor on the grid's communicator (see
+ * `StragglerStats::mean_work`), or an empty list if there is no
+ * complete window of measurements.
+ *
+ * The result is the same on every rank of the grid.
+ */
+std::vector<double> get_straggler_work_times(ProcessorGrid const& grid);
+
+namespace internal
+{
+
+/** Return the current block sizes of Block or Variable dimension `dim`. */
+BlockSizes get_block_sizes(BaseDistTensor const& tensor,
+                           typename ShapeTuple::size_type dim);
+
+}  // namespace internal
+
+/**
+ * Rebalance dimension `dim` of `tensor` given the work time of each
+ * rank of its processor grid, `rank_times`.
+ *
+ * `dim` must be Block or Variable. If the balanced block sizes (see
+ * `compute_balanced_block_sizes`) differ from the current ones, the
+ * dimension becomes Variable with the new sizes and the data is
+ * redistributed. Returns true if the tensor changed.
+ *
+ * This is collective over the tensor's processor grid, and
+ * `rank_times` must be the same on every rank (as, e.g., from
+ * `get_straggler_work_times`). It is an error to call this on a view
+ * or a tensor with a halo.
+ */
+template <typename T>
+bool rebalance(DistTensor<T>& tensor,
+               typename ShapeTuple::size_type dim,
+               std::vector<double> const& rank_times,
+               DimType min_size = 1)
+{
+  H2_ASSERT_ALWAYS(!tensor.is_view(), "Cannot rebalance a view");
+  H2_ASSERT_ALWAYS(!tensor.has_halo(), "Cannot rebalance a tensor with a halo");
+  H2_ASSERT_ALWAYS(dim < tensor.ndim(),
+                   "Cannot rebalance dimension ",
+                   dim,
+                   " of a ",
+                   tensor.ndim(),
+                   "-dimensional tensor");
+  H2_ASSERT_ALWAYS(rank_times.size()
+                     == static_cast<std::size_t>(tensor.proc_grid().size()),
+                   "Need a work time for each of the ",
+                   tensor.proc_grid().size(),
+                   " ranks of the grid, got ",
+                   rank_times.size());
+  if (tensor.is_empty())
+  {
+    return false;
+  }
+  BlockSizes const old_sizes = internal::get_block_sizes(tensor, dim);
+  BlockSizes const new_sizes = compute_balanced_block_sizes(
+    old_sizes,
+    get_dim_work_times(tensor.proc_grid(), dim, rank_times),
+    min_size);
+  if (new_sizes == old_sizes)
+  {
+    return false;
+  }
+
+  DistributionTypeTuple dist = tensor.distribution();
+  dist[dim] = Distribution::Variable;
+  BlockSizesTuple block_sizes = tensor.block_sizes();
+  block_sizes.resize(tensor.ndim());
+  block_sizes[dim] = new_sizes;
+  DistTensor<T> balanced(tensor.get_device(),
+                         tensor.shape(),
+                         tensor.dim_types(),
+                         tensor.proc_grid(),
+                         dist,
+                         block_sizes,
+                         StrictAlloc,
+                         tensor.get_stream());
+  redistribute(balanced, tensor);
+  tensor = std::move(balanced);
+  return true;
+}
+
+}  // namespace h2
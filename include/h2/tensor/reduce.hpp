@@ -0,0 +1,339 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Reductions of tensors along dimensions.
+ *
+ * These wrap the strided reduction loops (`cpu::strided_reduction_loop`
+ * and `gpu::launch_strided_reduction_loop`), so inputs may have any
+ * strides (e.g., views) and reduce in a single pass. Distributed
+ * tensors reduce their local data and then combine the partial results
+ * over the processor grid dimensions the reduced dimensions are
+ * distributed on.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+#include "h2/tensor/collectives.hpp"
+#include "h2/tensor/dist_tensor.hpp"
+#include "h2/tensor/tensor.hpp"
+#include "h2/tensor/tensor_types.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <algorithm>
+#include <memory>
+
+namespace h2
+{
+
+namespace internal
+{
+
+/** Return whether dimension `d` is in `dims`. */
+inline bool is_reduced_dim(DimensionOrderTuple const& dims,
+                           typename ShapeTuple::size_type d)
+{
+  return std::find(dims.begin(), dims.end(), d) != dims.end();
+}
+
+/** Check that `dims` are distinct dimensions of a tensor of `ndim`. */
+inline void check_reduce_dims(DimensionOrderTuple const& dims,
+                              typename ShapeTuple::size_type ndim)
+{
+  for (typename DimensionOrderTuple::size_type i = 0; i < dims.size(); ++i)
+  {
+    H2_ASSERT_ALWAYS(dims[i] >= 0 && dims[i] < ndim,
+                     "Cannot reduce dimension ",
+                     dims[i],
+                     " of a tensor with ",
+                     ndim,
+                     " dimensions");
+    H2_ASSERT_ALWAYS(std::find(dims.begin() + i + 1, dims.end(), dims[i])
+                       == dims.end(),
+                     "Dimension ",
+                     dims[i],
+                     " is reduced more than once");
+  }
+}
+
+/**
+ * Return the shape of reducing a tensor of shape `shape` over `dims`.
+ *
+ * With `keep_dims`, reduced dimensions have size 1; otherwise they are
+ * removed, and reducing every dimension gives a shape of 1.
+ */
+inline ShapeTuple get_reduced_shape(ShapeTuple const& shape,
+                                    DimensionOrderTuple const& dims,
+                                    bool keep_dims)
+{
+  if (keep_dims)
+  {
+    return map_index(shape, [&](typename ShapeTuple::size_type d) {
+      return is_reduced_dim(dims, d) ? DimType{1} : shape[d];
+    });
+  }
+  ShapeTuple reduced_shape = filter_index(
+    shape,
+    [&](typename ShapeTuple::size_type d) { return !is_reduced_dim(dims, d); });
+  return reduced_shape.is_empty() ? ShapeTuple(1) : reduced_shape;
+}
+
+/**
+ * Return the dimension types matching `get_reduced_shape`.
+ *
+ * Reducing every dimension without `keep_dims` gives a `Scalar`
+ * dimension, as for views that eliminate every dimension.
+ */
+inline DimensionTypeTuple
+get_reduced_dim_types(DimensionTypeTuple const& dim_types,
+                      DimensionOrderTuple const& dims,
+                      bool keep_dims)
+{
+  if (keep_dims)
+  {
+    return dim_types;
+  }
+  DimensionTypeTuple reduced_dim_types = filter_index(
+    dim_types,
+    [&](typename ShapeTuple::size_type d) { return !is_reduced_dim(dims, d); });
+  return reduced_dim_types.is_empty() ? DimensionTypeTuple(DT::Scalar)
+                                      : reduced_dim_types;
+}
+
+/**
+ * Return strides that map each index of a tensor of `ndim` dimensions
+ * to its output in a reduction over `dims` into a tensor with strides
+ * `dst_strides` (as from `get_reduced_shape`).
+ *
+ * Reduced dimensions have stride 0.
+ */
+inline StrideTuple
+get_reduction_out_strides(typename ShapeTuple::size_type ndim,
+                          DimensionOrderTuple const& dims,
+                          StrideTuple const& dst_strides,
+                          bool keep_dims)
+{
+  StrideTuple out_strides(TuplePad<StrideTuple>(ndim, 0));
+  typename StrideTuple::size_type dst_dim = 0;
+  for (typename ShapeTuple::size_type d = 0; d < ndim; ++d)
+  {
+    if (!is_reduced_dim(dims, d))
+    {
+      out_strides[d] = dst_strides[dst_dim];
+    }
+    if (keep_dims || !is_reduced_dim(dims, d))
+    {
+      ++dst_dim;
+    }
+  }
+  return out_strides;
+}
+
+}  // namespace internal
+
+namespace impl
+{
+
+template <typename T>
+void reduce_impl(CPUDev_t,
+                 Tensor<T>& dst,
+                 Tensor<T> const& src,
+                 StrideTuple const& out_strides,
+                 ReductionOp op);
+template <typename T>
+void divide_impl(CPUDev_t, Tensor<T>& dst, DataIndexType count);
+#ifdef H2_HAS_GPU
+template <typename T>
+void reduce_impl(GPUDev_t,
+                 Tensor<T>& dst,
+                 Tensor<T> const& src,
+                 StrideTuple const& out_strides,
+                 ReductionOp op);
+template <typename T>
+void divide_impl(GPUDev_t, Tensor<T>& dst, DataIndexType count);
+#endif
+
+}  // namespace impl
+
+/**
+ * Reduce `src` over the dimensions `dims` with `op`, storing the
+ * result to `dst`.
+ *
+ * `dst` has the shape from reducing each dimension in `dims` to size 1
+ * if `keep_dims` is true, or from removing them otherwise (reducing
+ * every dimension then gives a single element). It is resized like in
+ * `copy` and must be on the same device as `src`. `ReductionOp::Mean`
+ * truncates for integer types.
+ *
+ * On GPUs, this is asynchronous.
+ */
+template <typename T>
+void reduce(Tensor<T>& dst,
+            Tensor<T> const& src,
+            DimensionOrderTuple const& dims,
+            ReductionOp op,
+            bool keep_dims = false)
+{
+  H2_ASSERT_ALWAYS(dst.get_device() == src.get_device(),
+                   "Cannot reduce from ",
+                   src.get_device(),
+                   " to ",
+                   dst.get_device());
+  if (src.is_empty())
+  {
+    dst.empty();
+    return;
+  }
+  internal::check_reduce_dims(dims, src.ndim());
+  ShapeTuple const dst_shape =
+    internal::get_reduced_shape(src.shape(), dims, keep_dims);
+  if (dst.is_view())
+  {
+    H2_ASSERT_ALWAYS(!dst.is_const_view(), "Cannot write into a const view");
+    H2_ASSERT_ALWAYS(dst.shape() == dst_shape,
+                     "Cannot reduce a tensor of shape ",
+                     src.shape(),
+                     " into a view of shape ",
+                     dst.shape(),
+                     " (expected ",
+                     dst_shape,
+                     ")");
+  }
+  else
+  {
+    dst.resize(
+      dst_shape,
+      internal::get_reduced_dim_types(src.dim_types(), dims, keep_dims));
+    dst.ensure();
+  }
+  StrideTuple const out_strides = internal::get_reduction_out_strides(
+    src.ndim(), dims, dst.strides(), keep_dims);
+  H2_DEVICE_DISPATCH_SAME(
+    src.get_device(),
+    impl::reduce_impl(DeviceT_v<Dev>, dst, src, out_strides, op));
+  if (op == ReductionOp::Mean)
+  {
+    DataIndexType count = 1;
+    for (auto d : dims)
+    {
+      count *= src.shape(d);
+    }
+    H2_DEVICE_DISPATCH_SAME(src.get_device(),
+                            impl::divide_impl(DeviceT_v<Dev>, dst, count));
+  }
+}
+
+/**
+ * Return a new tensor with the reduction of `src` over the dimensions
+ * `dims` with `op`, on the same device and stream as `src`.
+ *
+ * See `reduce(Tensor<T>&, Tensor<T> const&, ...)` for details.
+ */
+template <typename T>
+std::unique_ptr<Tensor<T>> reduce(Tensor<T> const& src,
+                                  DimensionOrderTuple const& dims,
+                                  ReductionOp op,
+                                  bool keep_dims = false)
+{
+  auto dst = std::make_unique<Tensor<T>>(src.get_device(),
+                                         ShapeTuple(),
+                                         DimensionTypeTuple(),
+                                         StrictAlloc,
+                                         src.get_stream());
+  reduce(*dst, src, dims, op, keep_dims);
+  return dst;
+}
+
+/**
+ * Return a new distributed tensor with the reduction of `src` over the
+ * dimensions `dims` with `op`.
+ *
+ * Distributed tensors always keep the reduced dimensions: the result
+ * has the same processor grid, size 1 and a `Replicated` distribution
+ * in each reduced dimension, and the distribution of `src` in the
+ * others. Each process reduces its local data, and the partial
+ * results are then combined over the grid dimensions of reduced
+ * dimensions that are not already replicated.
+ *
+ * This is collective over the processes that share all grid
+ * coordinates of the dimensions not in `dims`.
+ */
+template <typename T>
+std::unique_ptr<DistTensor<T>> reduce(DistTensor<T> const& src,
+                                      DimensionOrderTuple const& dims,
+                                      ReductionOp op)
+{
+  internal::check_reduce_dims(dims, src.ndim());
+  ShapeTuple const dst_shape =
+    internal::get_reduced_shape(src.shape(), dims, true);
+  DistributionTypeTuple const dst_dists =
+    map_index(src.distribution(), [&](typename ShapeTuple::size_type d) {
+      return internal::is_reduced_dim(dims, d) ? Distribution::Replicated
+                                               : src.distribution()[d];
+    });
+  auto dst = std::make_unique<DistTensor<T>>(src.get_device(),
+                                             dst_shape,
+                                             src.dim_types(),
+                                             src.proc_grid(),
+                                             dst_dists,
+                                             StrictAlloc,
+                                             src.get_stream());
+  if (dst->is_local_empty())
+  {
+    // So is everything else in the reduction's communicator.
+    return dst;
+  }
+
+  Tensor<T>& dst_local = dst->local_tensor();
+  Tensor<T> const& src_local = src.const_local_tensor();
+  // Processes with no local data contribute the identity.
+  StrideTuple const out_strides =
+    src_local.is_empty() ? StrideTuple{}
+                         : internal::get_reduction_out_strides(
+                             src.ndim(), dims, dst_local.strides(), true);
+  H2_DEVICE_DISPATCH_SAME(
+    src.get_device(),
+    impl::reduce_impl(DeviceT_v<Dev>, dst_local, src_local, out_strides, op));
+
+  DimensionOrderTuple comm_dims;
+  for (auto d : dims)
+  {
+    if (src.distribution()[d] != Distribution::Replicated
+        && src.proc_grid().shape(d) > 1)
+    {
+      comm_dims.append(d);
+    }
+  }
+  if (!comm_dims.is_empty())
+  {
+    internal::allreduce_buffer(
+      dst_local.data(),
+      static_cast<std::size_t>(dst_local.numel()),
+      (op == ReductionOp::Mean) ? ReductionOp::Sum : op,
+      src.proc_grid().get_subcomm(comm_dims),
+      src.get_device(),
+      dst_local.get_stream());
+  }
+
+  if (op == ReductionOp::Mean)
+  {
+    DataIndexType count = 1;
+    for (auto d : dims)
+    {
+      count *= src.shape(d);
+    }
+    H2_DEVICE_DISPATCH_SAME(
+      src.get_device(), impl::divide_impl(DeviceT_v<Dev>, dst_local, count));
+  }
+  return dst;
+}
+
+}  // namespace h2
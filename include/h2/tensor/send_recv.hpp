@@ -0,0 +1,126 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Point-to-point transfers of tensors between ranks.
+ *
+ * These send the data of a (possibly strided) tensor on any device to
+ * a peer rank, e.g., between the stages of a pipeline. Sends are
+ * ordered after prior work on the tensor's compute stream, and
+ * received data is written on the receiving tensor's compute stream.
+ * Non-contiguous and GPU tensors are staged through a contiguous host
+ * buffer; transfers use MPI on the communicator's underlying MPI
+ * communicator.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/dist_tensor.hpp"
+#include "h2/tensor/dist_types.hpp"
+#include "h2/tensor/tensor.hpp"
+#include "h2/tensor/tensor_base.hpp"
+
+#include <memory>
+
+namespace h2
+{
+
+/**
+ * A pending send or receive of a tensor.
+ *
+ * Completing the request (with `wait` or a successful `test`) makes a
+ * send's buffer reusable, or makes a receive's data available on the
+ * tensor's compute stream. Destroying an incomplete request waits for
+ * it. A default-constructed request is complete.
+ */
+class TensorCommRequest
+{
+public:
+  struct State;
+
+  TensorCommRequest();
+  explicit TensorCommRequest(std::unique_ptr<State> state_);
+  ~TensorCommRequest();
+
+  TensorCommRequest(TensorCommRequest const&) = delete;
+  TensorCommRequest& operator=(TensorCommRequest const&) = delete;
+  TensorCommRequest(TensorCommRequest&&);
+  TensorCommRequest& operator=(TensorCommRequest&&);
+
+  /** Return true if the request has completed, completing it if so. */
+  bool test();
+
+  /** Block until the request completes. */
+  void wait();
+
+  /** Return true if the request has completed. */
+  bool is_complete() const H2_NOEXCEPT { return state == nullptr; }
+
+private:
+  std::unique_ptr<State> state;
+};
+
+/**
+ * Begin sending the data of `tensor` to rank `peer` of `comm`.
+ *
+ * The receiver must post a matching receive with the same tag into a
+ * tensor with the same number of elements of the same type (its shape
+ * and strides may differ). A contiguous CPU tensor is sent without
+ * staging, so it must not be modified until the request completes.
+ */
+TensorCommRequest
+isend(BaseTensor const& tensor, int peer, Comm const& comm, int tag = 0);
+
+/**
+ * Begin receiving data from rank `peer` of `comm` into `tensor`.
+ *
+ * Receiving fewer bytes than `tensor` holds throws when the request
+ * completes; receiving more is an MPI truncation error.
+ */
+TensorCommRequest
+irecv(BaseTensor& tensor, int peer, Comm const& comm, int tag = 0);
+
+/** Send `tensor` to rank `peer` of `comm` and wait for completion. */
+inline void
+send(BaseTensor const& tensor, int peer, Comm const& comm, int tag = 0)
+{
+  isend(tensor, peer, comm, tag).wait();
+}
+
+/** Receive into `tensor` from rank `peer` of `comm` and wait. */
+inline void recv(BaseTensor& tensor, int peer, Comm const& comm, int tag = 0)
+{
+  irecv(tensor, peer, comm, tag).wait();
+}
+
+/**
+ * Begin sending the local data of `tensor` to rank `peer` of `comm`.
+ *
+ * This is meant for moving a distributed tensor between processor
+ * grids (e.g., pipeline stages): each rank sends its local tensor to
+ * the rank that holds the corresponding block on the other grid.
+ */
+template <typename T>
+TensorCommRequest
+isend(DistTensor<T> const& tensor, int peer, Comm const& comm, int tag = 0)
+{
+  return isend(tensor.const_local_tensor(), peer, comm, tag);
+}
+
+/** Begin receiving the local data of `tensor` from rank `peer`. */
+template <typename T>
+TensorCommRequest
+irecv(DistTensor<T>& tensor, int peer, Comm const& comm, int tag = 0)
+{
+  tensor.ensure();
+  return irecv(tensor.local_tensor(), peer, comm, tag);
+}
+
+}  // namespace h2
@@ -0,0 +1,293 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Sparse tensors in coordinate (COO) format.
+ *
+ * The nonzeros of a sparse tensor are stored as the linear index of
+ * each nonzero in the dense tensor, in generalized column-major order
+ * (i.e., its offset in a contiguous dense tensor), and its value.
+ * Nonzeros are sorted by index and indices are unique. A single index
+ * per nonzero takes less memory than a coordinate per dimension, and
+ * makes scattering to and gathering from contiguous dense tensors a
+ * plain indexed access.
+ *
+ * Since the outermost dimension varies slowest, the sorted indices are
+ * also the compressed (CSR) layout over that dimension given the
+ * offsets of each of its entries (see `get_compressed_offsets`).
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/core/types.hpp"
+#include "h2/tensor/dist_types.hpp"
+#include "h2/tensor/proc_grid.hpp"
+#include "h2/tensor/tensor.hpp"
+#include "h2/tensor/tensor_types.hpp"
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace h2
+{
+
+/** Sparse tensor class for compute types, stored in COO format. */
+template <typename T>
+class SparseTensor
+{
+public:
+  using value_type = T;
+
+  static_assert(IsH2ComputeType_v<T>,
+                "Cannot create a sparse tensor with a non-compute type");
+
+  /** Construct a sparse tensor with no nonzeros. */
+  SparseTensor(Device device,
+               ShapeTuple const& shape_,
+               DimensionTypeTuple const& dim_types_,
+               std::optional<ComputeStream> const stream = std::nullopt)
+    : tensor_shape(shape_),
+      tensor_dim_types(dim_types_),
+      tensor_stream(stream.value_or(ComputeStream{device})),
+      nz_indices(make_nnz_tensor<DataIndexType>(0)),
+      nz_values(make_nnz_tensor<T>(0))
+  {
+    H2_ASSERT_ALWAYS(shape_.size() == dim_types_.size(),
+                     "Shape ",
+                     shape_,
+                     " and dimension types ",
+                     dim_types_,
+                     " must be the same size");
+  }
+
+  /**
+   * Construct a sparse tensor from host arrays of the linear indices
+   * and values of its nonzeros.
+   *
+   * Indices must be in range and unique, but need not be sorted.
+   */
+  SparseTensor(Device device,
+               ShapeTuple const& shape_,
+               DimensionTypeTuple const& dim_types_,
+               std::vector<DataIndexType> const& indices_,
+               std::vector<T> const& values_,
+               std::optional<ComputeStream> const stream = std::nullopt)
+    : SparseTensor(device, shape_, dim_types_, stream)
+  {
+    set_nonzeros(indices_, values_);
+  }
+
+  ShapeTuple shape() const H2_NOEXCEPT { return tensor_shape; }
+  DimensionTypeTuple dim_types() const H2_NOEXCEPT { return tensor_dim_types; }
+  typename ShapeTuple::size_type ndim() const H2_NOEXCEPT
+  {
+    return tensor_shape.size();
+  }
+  Device get_device() const H2_NOEXCEPT { return tensor_stream.get_device(); }
+  ComputeStream const& get_stream() const H2_NOEXCEPT { return tensor_stream; }
+
+  /** Return the number of elements of the dense tensor. */
+  DataIndexType numel() const H2_NOEXCEPT
+  {
+    return tensor_shape.is_empty() ? 0 : product<DataIndexType>(tensor_shape);
+  }
+
+  /** Return the number of nonzeros. */
+  DataIndexType nnz() const H2_NOEXCEPT { return nz_indices->numel(); }
+
+  /** Return the sorted linear indices of the nonzeros. */
+  Tensor<DataIndexType> const& indices() const H2_NOEXCEPT
+  {
+    return *nz_indices;
+  }
+
+  /** Return the values of the nonzeros. */
+  Tensor<T>& values() H2_NOEXCEPT { return *nz_values; }
+  /** Return the values of the nonzeros. */
+  Tensor<T> const& values() const H2_NOEXCEPT { return *nz_values; }
+
+  /**
+   * Replace the nonzeros with those in host arrays of linear indices
+   * and values.
+   *
+   * Indices must be in range and unique, but need not be sorted.
+   */
+  void set_nonzeros(std::vector<DataIndexType> const& indices_,
+                    std::vector<T> const& values_);
+
+  /**
+   * Copy the linear indices and values of the nonzeros to the host.
+   *
+   * This synchronizes with the tensor's stream.
+   */
+  void get_nonzeros(std::vector<DataIndexType>& indices_,
+                    std::vector<T>& values_) const;
+
+  /**
+   * Return the offsets of the nonzeros of each entry of the outermost
+   * dimension, with a final entry of `nnz()`.
+   *
+   * Together with the indices modulo the product of the other
+   * dimensions, this is the CSR layout of the tensor viewed as a
+   * matrix with the outermost dimension as rows. This is computed on
+   * the host.
+   */
+  std::vector<DataIndexType> get_compressed_offsets() const;
+
+  /** Return the coordinate of the nonzero at linear index `index`. */
+  ScalarIndexTuple get_coord(DataIndexType index) const
+  {
+    ScalarIndexTuple coord(TuplePad<ScalarIndexTuple>(tensor_shape.size(), 0));
+    for (typename ShapeTuple::size_type i = 0; i < tensor_shape.size(); ++i)
+    {
+      coord[i] = static_cast<DimType>(index % tensor_shape[i]);
+      index /= tensor_shape[i];
+    }
+    return coord;
+  }
+
+  /** Return the linear index of the coordinate `coord`. */
+  DataIndexType get_index(ScalarIndexTuple const& coord) const
+  {
+    H2_ASSERT_DEBUG(coord.size() == tensor_shape.size(),
+                    "Coordinate ",
+                    coord,
+                    " does not match shape ",
+                    tensor_shape);
+    DataIndexType index = 0;
+    for (typename ShapeTuple::size_type i = coord.size(); i > 0; --i)
+    {
+      index = index * tensor_shape[i - 1] + coord[i - 1];
+    }
+    return index;
+  }
+
+private:
+  template <typename U>
+  std::unique_ptr<Tensor<U>> make_nnz_tensor(DataIndexType nnz_) const
+  {
+    if (nnz_ == 0)
+    {
+      return std::make_unique<Tensor<U>>(
+        tensor_stream.get_device(), StrictAlloc, tensor_stream);
+    }
+    return std::make_unique<Tensor<U>>(tensor_stream.get_device(),
+                                       ShapeTuple{static_cast<DimType>(nnz_)},
+                                       DTTuple{DT::Any},
+                                       StrictAlloc,
+                                       tensor_stream);
+  }
+
+  ShapeTuple tensor_shape;
+  DimensionTypeTuple tensor_dim_types;
+  ComputeStream tensor_stream;
+  std::unique_ptr<Tensor<DataIndexType>> nz_indices;
+  std::unique_ptr<Tensor<T>> nz_values;
+};
+
+namespace impl
+{
+
+template <typename T>
+void to_dense_impl(CPUDev_t, Tensor<T>& dst, SparseTensor<T> const& src);
+template <typename T>
+void sparse_dense_multiply_impl(CPUDev_t,
+                                Tensor<T>& dst_values,
+                                SparseTensor<T> const& sparse,
+                                Tensor<T> const& dense);
+template <typename T>
+void sparse_dense_add_impl(CPUDev_t,
+                           Tensor<T>& dense,
+                           SparseTensor<T> const& sparse);
+#ifdef H2_HAS_GPU
+template <typename T>
+void to_dense_impl(GPUDev_t, Tensor<T>& dst, SparseTensor<T> const& src);
+template <typename T>
+void sparse_dense_multiply_impl(GPUDev_t,
+                                Tensor<T>& dst_values,
+                                SparseTensor<T> const& sparse,
+                                Tensor<T> const& dense);
+template <typename T>
+void sparse_dense_add_impl(GPUDev_t,
+                           Tensor<T>& dense,
+                           SparseTensor<T> const& sparse);
+#endif
+
+}  // namespace impl
+
+/**
+ * Write the dense form of `src` into `dst`.
+ *
+ * `dst` is resized to the shape of `src` if it is not a view, and must
+ * be contiguous and on the same device as `src`. On GPUs, this is
+ * asynchronous.
+ */
+template <typename T>
+void to_dense(Tensor<T>& dst, SparseTensor<T> const& src);
+
+/**
+ * Return a sparse tensor with the nonzeros of `src`, which must be
+ * contiguous, on the same device.
+ *
+ * On GPUs, the nonzeros are found on the host, so this synchronizes.
+ */
+template <typename T>
+std::unique_ptr<SparseTensor<T>> to_sparse(Tensor<T> const& src);
+
+/**
+ * Multiply the nonzeros of `sparse` by the corresponding entries of
+ * `dense`, storing the result in `dst`, which gets the same nonzero
+ * indices as `sparse` (an element-wise product with the sparsity of
+ * `sparse`). `dst` may be `sparse`.
+ *
+ * Only the entries of `dense` at nonzeros are read. `dense` must be
+ * contiguous, with the same shape as `sparse`, on the same device. On
+ * GPUs, this is asynchronous.
+ */
+template <typename T>
+void sparse_dense_multiply(SparseTensor<T>& dst,
+                           SparseTensor<T> const& sparse,
+                           Tensor<T> const& dense);
+
+/**
+ * Add the nonzeros of `sparse` to the corresponding entries of
+ * `dense`.
+ *
+ * Only the entries of `dense` at nonzeros are written. `dense` must be
+ * contiguous, with the same shape as `sparse`, on the same device. On
+ * GPUs, this is asynchronous.
+ */
+template <typename T>
+void sparse_dense_add(Tensor<T>& dense, SparseTensor<T> const& sparse);
+
+/**
+ * Distribute nonzeros of a global tensor to the ranks of `grid` that
+ * own them under the distribution `dist`, returning the local sparse
+ * tensor of this rank in local coordinates.
+ *
+ * `src` has the global shape and holds any subset of the nonzeros of
+ * the global tensor (e.g., those read by this rank), each nonzero held
+ * by exactly one rank. This is collective over
+ * `grid`. Replicated distributions are not supported, as each nonzero
+ * has a single owner.
+ *
+ * The nonzeros are exchanged from the host, so this synchronizes with
+ * the stream of `src`.
+ */
+template <typename T>
+std::unique_ptr<SparseTensor<T>>
+distribute_sparse(SparseTensor<T> const& src,
+                  ProcessorGrid const& grid,
+                  DistributionTypeTuple const& dist);
+
+}  // namespace h2
@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Summary statistics of tensors, for debugging and printing.
+ *
+ * Statistics are computed on the tensor's device in a single pass, so
+ * only a few values are copied to the host regardless of the tensor's
+ * size.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+#include "h2/gpu/macros.hpp"
+#include "h2/tensor/tensor.hpp"
+#include "h2/tensor/tensor_types.hpp"
+
+#include <limits>
+#include <ostream>
+#include <type_traits>
+
+namespace h2
+{
+
+/** Summary statistics of the elements of a tensor. */
+template <typename T>
+struct TensorStats
+{
+  /** Number of elements. */
+  DataIndexType count = 0;
+  /** Number of NaN elements (always 0 for integer types). */
+  DataIndexType nan_count = 0;
+  /** Smallest element that is not NaN. */
+  T min = T{0};
+  /** Largest element that is not NaN. */
+  T max = T{0};
+  /** Mean of the elements that are not NaN. */
+  double mean = 0.0;
+};
+
+/** Support printing TensorStats. */
+template <typename T>
+inline std::ostream& operator<<(std::ostream& os, TensorStats<T> const& stats)
+{
+  os << "min: " << stats.min << ", max: " << stats.max
+     << ", mean: " << stats.mean << ", NaNs: " << stats.nan_count;
+  return os;
+}
+
+namespace internal
+{
+
+/** Partial results of `StatsReduction`. */
+template <typename T>
+struct StatsValue
+{
+  T min;
+  T max;
+  double sum;
+  DataIndexType nan_count;
+};
+
+/**
+ * Reduction operator (see `reduction_helpers.hpp`) computing
+ * `TensorStats` in a single pass.
+ */
+template <typename T>
+struct StatsReduction
+{
+  using ValueT = StatsValue<T>;
+
+  H2_GPU_HOST_DEVICE ValueT identity() const
+  {
+    return {std::numeric_limits<T>::max(),
+            std::numeric_limits<T>::lowest(),
+            0.0,
+            0};
+  }
+  H2_GPU_HOST_DEVICE ValueT init(T x, DataIndexType) const
+  {
+    if constexpr (std::is_floating_point_v<T>)
+    {
+      // x != x only for NaNs, and works on host and device.
+      if (x != x)
+      {
+        ValueT val = identity();
+        val.nan_count = 1;
+        return val;
+      }
+    }
+    return {x, x, static_cast<double>(x), 0};
+  }
+  H2_GPU_HOST_DEVICE ValueT combine(ValueT a, ValueT b) const
+  {
+    return {(b.min < a.min) ? b.min : a.min,
+            (b.max > a.max) ? b.max : a.max,
+            a.sum + b.sum,
+            a.nan_count + b.nan_count};
+  }
+};
+
+}  // namespace internal
+
+namespace impl
+{
+
+template <typename T>
+internal::StatsValue<T> stats_impl(CPUDev_t, Tensor<T> const& tensor);
+#ifdef H2_HAS_GPU
+template <typename T>
+internal::StatsValue<T> stats_impl(GPUDev_t, Tensor<T> const& tensor);
+#endif
+
+}  // namespace impl
+
+/**
+ * Return summary statistics of the elements of `tensor`.
+ *
+ * This reduces `tensor` on its device (it may be strided) and waits
+ * for the result.
+ */
+template <typename T>
+TensorStats<T> get_stats(Tensor<T> const& tensor)
+{
+  TensorStats<T> stats;
+  if (tensor.is_empty())
+  {
+    return stats;
+  }
+  H2_ASSERT_ALWAYS(tensor.const_data() != nullptr,
+                   "Cannot get statistics of a tensor with no data");
+  internal::StatsValue<T> val;
+  H2_DEVICE_DISPATCH_SAME(tensor.get_device(),
+                          val = impl::stats_impl(DeviceT_v<Dev>, tensor));
+  stats.count = tensor.numel();
+  stats.nan_count = val.nan_count;
+  if (stats.nan_count < stats.count)
+  {
+    stats.min = val.min;
+    stats.max = val.max;
+    stats.mean = val.sum / static_cast<double>(stats.count - stats.nan_count);
+  }
+  else
+  {
+    stats.min = stats.max = std::numeric_limits<T>::quiet_NaN();
+    stats.mean = std::numeric_limits<double>::quiet_NaN();
+  }
+  return stats;
+}
+
+}  // namespace h2
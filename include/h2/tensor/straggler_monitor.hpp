@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Detection of ranks that are consistently late to synchronize.
+ *
+ * A single slow GPU, NIC, or node stalls every collective it takes
+ * part in. When the `H2_STRAGGLER_MONITOR` environment variable is
+ * set, collectives and halo exchanges record the host time each rank
+ * arrives at them, next to their trace scopes. Every
+ * `H2_STRAGGLER_WINDOW` synchronization points on a communicator, its
+ * ranks gather their arrival times and compute how much later than
+ * the median rank each arrived. A rank whose mean lateness exceeds
+ * `H2_STRAGGLER_THRESHOLD` milliseconds in `H2_STRAGGLER_MIN_WINDOWS`
+ * consecutive windows logs a warning to the `h2_straggler` logger,
+ * whose prefix gives its hostname and rank, and the first rank of the
+ * communicator logs which ranks were late.
+ *
+ * Clocks are aligned by a barrier at each gather, so lateness is
+ * accurate to the skew of leaving the barrier (usually microseconds).
+ * Arrival times are host times, so a slow GPU shows up once its host
+ * waits for it.
+ */
+
+#include <h2_config.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include <mpi.h>
+
+namespace h2
+{
+
+/** Lateness of one rank over a window of synchronization points. */
+struct StragglerStats
+{
+  /** Mean time, in seconds, by which the rank arrived after the median. */
+  double mean_lateness = 0.0;
+  /** Number of points the rank arrived at last. */
+  std::size_t num_last = 0;
+  /** Index of the point the rank was latest at, relative to the median. */
+  std::size_t worst_point = 0;
+  /** Time, in seconds, by which the rank was late at `worst_point`. */
+  double worst_lateness = 0.0;
+  /**
+   * Mean time, in seconds, from the last rank arriving at a point to
+   * this rank arriving at the next one.
+   *
+   * Every rank leaves a point once the last arrives, so this is
+   * roughly the rank's time working between points (including any
+   * synchronization on other communicators).
+   */
+  double mean_work = 0.0;
+};
+
+/**
+ * Return the lateness of each of `num_ranks` ranks, given the arrival
+ * times of each rank at `num_points` synchronization points, in
+ * seconds, stored rank by rank in `arrivals`.
+ */
+std::vector<StragglerStats>
+compute_straggler_stats(std::vector<double> const& arrivals,
+                        std::size_t num_ranks,
+                        std::size_t num_points);
+
+/**
+ * Return the lateness of each rank of `comm` in the last complete
+ * window of synchronization points on it.
+ *
+ * This is empty if monitoring is disabled or no window on `comm` has
+ * completed yet. Otherwise, it is the same on every rank of `comm`.
+ */
+std::vector<StragglerStats> get_straggler_stats(MPI_Comm comm);
+
+namespace internal
+{
+
+/** Return true if `H2_STRAGGLER_MONITOR` is set. */
+bool check_straggler_monitor_enabled();
+
+/**
+ * Record this rank's arrival at the synchronization point `name` on
+ * `comm`, and check for stragglers if this completes a window.
+ *
+ * Every rank of `comm` must record the same points in the same order,
+ * as checking is collective over `comm`. `name` must be a string
+ * literal or otherwise outlive the window.
+ */
+void record_sync_arrival(char const* name, MPI_Comm comm);
+
+}  // namespace internal
+
+/** Return true if arrivals at synchronization points are monitored. */
+inline bool straggler_monitor_enabled()
+{
+  static bool const enabled = internal::check_straggler_monitor_enabled();
+  return enabled;
+}
+
+}  // namespace h2
+
+/**
+ * Record this rank's arrival at the synchronization point `name` on
+ * the MPI communicator `comm` when straggler monitoring is enabled.
+ */
+#define H2_STRAGGLER_ARRIVAL(name, comm)                                       \
+  do                                                                           \
+  {                                                                            \
+    if (::h2::straggler_monitor_enabled())                                     \
+    {                                                                          \
+      ::h2::internal::record_sync_arrival(name, comm);                         \
+    }                                                                          \
+  } while (0)
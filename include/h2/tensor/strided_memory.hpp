@@ -12,13 +12,16 @@
  * Manages memory and an associated stride.
  */
 
+#include "h2/core/object_pool.hpp"
 #include "h2/tensor/copy_buffer.hpp"
 #include "h2/tensor/raw_buffer.hpp"
 #include "h2/tensor/tensor_types.hpp"
 #include "h2/tensor/tensor_utils.hpp"
 #include "h2/utils/typename.hpp"
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <utility>
 
@@ -69,6 +72,98 @@ are_strides_contiguous(ShapeTuple const& shape,
   return (strides.size() == 0) || (prod == strides[i - 1]);
 }
 
+/**
+ * A shape with strides for each of `NumBufs` buffers of that shape,
+ * in canonical form (see `collapse_strided_layout`).
+ */
+template <std::size_t NumBufs>
+struct CollapsedStridedLayout
+{
+  ShapeTuple shape;
+  std::array<StrideTuple, NumBufs> strides;
+};
+
+/**
+ * Return the canonical form of buffers of the given shape, each with
+ * its own strides, with the fewest dimensions that iterate the same
+ * elements in the same (generalized column-major) order.
+ *
+ * Dimensions of extent 1 are dropped and each dimension is merged into
+ * the previous one when it is contiguous with it in every buffer. The
+ * buffers are collapsed jointly, so a dimension is only merged if it
+ * can be in all of them. A shape with no elements collapses to `{0}`
+ * and a single element to `{1}` with unit strides; an empty shape
+ * stays empty.
+ *
+ * Strided kernels should iterate the collapsed layout, which has the
+ * simplest index math and makes contiguity checks exact.
+ */
+template <std::size_t NumBufs>
+CollapsedStridedLayout<NumBufs>
+collapse_strided_layout(ShapeTuple const& shape,
+                        std::array<StrideTuple, NumBufs> const& strides)
+{
+  for (std::size_t b = 0; b < NumBufs; ++b)
+  {
+    H2_ASSERT_ALWAYS(strides[b].size() == shape.size(),
+                     "Strides ",
+                     strides[b],
+                     " for buffer ",
+                     b,
+                     " do not match shape ",
+                     shape);
+  }
+  CollapsedStridedLayout<NumBufs> layout;
+  if (shape.is_empty())
+  {
+    return layout;
+  }
+  if (product<DataIndexType>(shape) == 0)
+  {
+    layout.shape.append(0);
+    for (std::size_t b = 0; b < NumBufs; ++b)
+    {
+      layout.strides[b].append(1);
+    }
+    return layout;
+  }
+  for (typename ShapeTuple::size_type d = 0; d < shape.size(); ++d)
+  {
+    if (shape[d] == 1)
+    {
+      continue;
+    }
+    bool collapse = !layout.shape.is_empty();
+    for (std::size_t b = 0; collapse && b < NumBufs; ++b)
+    {
+      collapse =
+        strides[b][d] == layout.strides[b].back() * layout.shape.back();
+    }
+    if (collapse)
+    {
+      layout.shape.back() *= shape[d];
+    }
+    else
+    {
+      layout.shape.append(shape[d]);
+      for (std::size_t b = 0; b < NumBufs; ++b)
+      {
+        layout.strides[b].append(strides[b][d]);
+      }
+    }
+  }
+  if (layout.shape.is_empty())
+  {
+    // A single element.
+    layout.shape.append(1);
+    for (std::size_t b = 0; b < NumBufs; ++b)
+    {
+      layout.strides[b].append(1);
+    }
+  }
+  return layout;
+}
+
 /**
  * Return the extent of a buffer implied by a shape and strides.
  *
@@ -101,22 +196,28 @@ private:
 
 public:
   /** Allocate empty memory. */
-  StridedMemory(Device device, bool lazy, ComputeStream const& stream_)
+  StridedMemory(Device device,
+                bool lazy,
+                ComputeStream const& stream_,
+                MemoryKind mem_kind_ = MemoryKind::Default)
     : raw_buffer(nullptr),
       mem_offset(INVALID_OFFSET),
       mem_strides{},
       mem_shape{},
       mem_device{device},
       stream(stream_),
-      is_mem_lazy(lazy)
+      is_mem_lazy(lazy),
+      mem_kind(mem_kind_)
   {}
 
   /** Allocate memory for shape, with unit strides. */
   StridedMemory(Device device,
                 ShapeTuple const& shape,
                 bool lazy,
-                ComputeStream const& stream_)
-    : StridedMemory(device, shape, get_contiguous_strides(shape), lazy, stream_)
+                ComputeStream const& stream_,
+                MemoryKind mem_kind_ = MemoryKind::Default)
+    : StridedMemory(
+        device, shape, get_contiguous_strides(shape), lazy, stream_, mem_kind_)
   {}
 
   /** Allocate memory for shape with the given strides. */
@@ -124,8 +225,9 @@ public:
                 ShapeTuple const& shape,
                 StrideTuple const& strides,
                 bool lazy,
-                ComputeStream const& stream_)
-    : StridedMemory(device, lazy, stream_)
+                ComputeStream const& stream_,
+                MemoryKind mem_kind_ = MemoryKind::Default)
+    : StridedMemory(device, lazy, stream_, mem_kind_)
   {
     H2_ASSERT_DEBUG(shape.size() == strides.size(),
                     "Shape (",
@@ -154,7 +256,8 @@ public:
       mem_device(base.mem_device),
       // mem_shape and mem_strides are set below.
       stream(base.stream),
-      is_mem_lazy(base.is_lazy())
+      is_mem_lazy(base.is_lazy()),
+      mem_kind(base.mem_kind)
   {
     H2_ASSERT_DEBUG(coords.size() <= base.mem_strides.size(),
                     "coords size not compatible with strides");
@@ -210,22 +313,30 @@ public:
       mem_shape(base.mem_shape),
       mem_device(device),
       stream(stream_),
-      is_mem_lazy(base.is_lazy())
+      is_mem_lazy(base.is_lazy()),
+      mem_kind(base.mem_kind)
   {}
 
-  /** Wrap an existing memory buffer. */
+  /**
+   * Wrap an existing memory buffer.
+   *
+   * If `buffer_owner` is given, it is kept alive as long as this or
+   * any view of it references `buffer`.
+   */
   StridedMemory(Device device,
                 T* buffer,
                 ShapeTuple const& shape,
                 StrideTuple const& strides,
-                ComputeStream const& stream_)
+                ComputeStream const& stream_,
+                std::shared_ptr<void> buffer_owner = nullptr)
     : raw_buffer(nullptr),
       mem_offset(0),
       mem_strides(strides),
       mem_shape(shape),
       mem_device(device),
       stream(stream_),
-      is_mem_lazy(false)
+      is_mem_lazy(false),
+      mem_kind(MemoryKind::Default)
   {
     H2_ASSERT_DEBUG(
       buffer || shape.is_empty()
@@ -238,7 +349,44 @@ public:
                     strides,
                     ") are not sane");
     std::size_t size = get_extent_from_strides(shape, strides);
-    raw_buffer = std::make_shared<RawBuffer<T>>(device, buffer, size, stream);
+    raw_buffer = std::allocate_shared<RawBuffer<T>>(
+      internal::PoolAllocator<RawBuffer<T>>{},
+      device, buffer, size, stream, std::move(buffer_owner));
+  }
+
+  /**
+   * Wrap a different external buffer, as if newly constructed to wrap
+   * it.
+   *
+   * If this is the only user of its current raw buffer and that wraps
+   * external memory, it is reused rather than reallocated.
+   */
+  void wrap(Device device,
+            T* buffer,
+            ShapeTuple const& shape,
+            StrideTuple const& strides,
+            ComputeStream const& stream_)
+  {
+    if (raw_buffer)
+    {
+      raw_buffer->register_release(stream);
+    }
+    if (!raw_buffer || raw_buffer.use_count() != 1
+        || !raw_buffer->is_external())
+    {
+      *this = StridedMemory<T>(device, buffer, shape, strides, stream_);
+      return;
+    }
+    raw_buffer->wrap(
+      device, buffer, get_extent_from_strides(shape, strides), stream_);
+    old_raw_buffer.reset();
+    mem_offset = 0;
+    mem_strides = strides;
+    mem_shape = shape;
+    mem_device = device;
+    stream = stream_;
+    is_mem_lazy = false;
+    mem_kind = MemoryKind::Default;
   }
 
   ~StridedMemory()
@@ -249,6 +397,19 @@ public:
     }
   }
 
+  /**
+   * Return a view of this memory region with its dimensions permuted.
+   *
+   * Dimension `i` of the view is dimension `order[i]` of this region.
+   */
+  StridedMemory<T> permute(DimensionOrderTuple const& order) const
+  {
+    StridedMemory<T> permuted = *this;
+    permuted.mem_strides = permute_tuple(mem_strides, order);
+    permuted.mem_shape = permute_tuple(mem_shape, order);
+    return permuted;
+  }
+
   /**
    * Return a clone of this memory.
    *
@@ -260,7 +421,7 @@ public:
   StridedMemory<T> clone() const
   {
     StridedMemory<T> new_sm(
-      mem_device, mem_shape, mem_strides, is_mem_lazy, stream);
+      mem_device, mem_shape, mem_strides, is_mem_lazy, stream, mem_kind);
     // Only copy if we have already ensure'd memory.
     if (const_data() != nullptr)
     {
@@ -275,6 +436,50 @@ public:
     return new_sm;
   }
 
+  /**
+   * Return a view of a copy of this memory on `device`, whose
+   * operations are on `stream_`.
+   *
+   * The copy is of the entire underlying buffer and is cached with it,
+   * so subsequent calls (from this or any other view of the buffer)
+   * reuse it, without copying, until either the buffer or the copy is
+   * modified. A cached copy made on a different stream is synchronized
+   * with `stream_`.
+   *
+   * The memory must have been allocated.
+   */
+  StridedMemory<T> mirror(Device device, ComputeStream const& stream_) const
+  {
+    H2_ASSERT_DEBUG(const_data() != nullptr,
+                    "Cannot mirror unallocated memory");
+    std::shared_ptr<RawBuffer<T>> mirror_buffer =
+      raw_buffer->get_mirror(device);
+    if (mirror_buffer)
+    {
+      stream_.wait_for(mirror_buffer->get_stream());
+    }
+    else
+    {
+      // The mirror is cached, so it must not come from a scratch arena.
+      mirror_buffer = std::allocate_shared<RawBuffer<T>>(
+        internal::PoolAllocator<RawBuffer<T>>{},
+        device, raw_buffer->size(), true, stream_);
+      mirror_buffer->ensure(false);
+      copy_buffer(mirror_buffer->data(),
+                  stream_,
+                  raw_buffer->const_data(),
+                  stream,
+                  raw_buffer->size());
+      raw_buffer->set_mirror(mirror_buffer);
+    }
+    StridedMemory<T> mirrored(device, false, stream_);
+    mirrored.raw_buffer = std::move(mirror_buffer);
+    mirrored.mem_offset = mem_offset;
+    mirrored.mem_strides = mem_strides;
+    mirrored.mem_shape = mem_shape;
+    return mirrored;
+  }
+
   void ensure(bool attempt_recover = true)
   {
     if (raw_buffer)
@@ -298,6 +503,33 @@ public:
     old_raw_buffer.reset();  // Drop reference to old raw buffer.
   }
 
+  /**
+   * Like `ensure`, but order any allocation on `alloc_stream`.
+   *
+   * This memory's stream waits for the allocation (see
+   * `RawBuffer::ensure_async`). Recovered memory is not reallocated.
+   */
+  void ensure_async(ComputeStream const& alloc_stream,
+                    bool attempt_recover = true)
+  {
+    if (!raw_buffer)
+    {
+      if (attempt_recover)
+      {
+        raw_buffer = old_raw_buffer.lock();
+      }
+      if (!raw_buffer)
+      {
+        make_raw_buffer(true);
+      }
+      old_raw_buffer.reset();
+    }
+    if (raw_buffer)
+    {
+      raw_buffer->ensure_async(alloc_stream);
+    }
+  }
+
   void release()
   {
     if (raw_buffer)
@@ -325,7 +557,61 @@ public:
     return 0;
   }
 
-  T* data() H2_NOEXCEPT { return const_cast<T*>(std::as_const(*this).data()); }
+  /**
+   * Return the number of elements allocated for the underlying buffer,
+   * which may exceed `size` after `resize_in_place`.
+   */
+  std::size_t capacity() const H2_NOEXCEPT
+  {
+    if (raw_buffer)
+    {
+      return raw_buffer->capacity();
+    }
+    return 0;
+  }
+
+  /**
+   * Change this memory to hold `shape` with `strides`, reusing the
+   * underlying buffer, and return whether this was possible.
+   *
+   * This requires that this memory is the only user of its buffer
+   * (e.g., there are no views) and starts at its beginning, and that
+   * the buffer is not external and has enough capacity. If the buffer
+   * is not yet allocated (lazy memory), it has enough capacity. On
+   * failure, this is unchanged. Contents are not preserved in any
+   * meaningful layout.
+   */
+  bool resize_in_place(ShapeTuple const& shape, StrideTuple const& strides)
+  {
+    if (shape.is_empty() || shape.size() != strides.size() || !raw_buffer
+        || raw_buffer.use_count() != 1 || mem_offset != 0)
+    {
+      return false;
+    }
+    std::size_t const new_size = get_extent_from_strides(shape, strides);
+    if (new_size == 0 || !raw_buffer->resize_in_place(new_size))
+    {
+      return false;
+    }
+    mem_shape = shape;
+    mem_strides = strides;
+    return true;
+  }
+
+  /**
+   * Return a pointer to the memory.
+   *
+   * As the memory may then be written, this marks the underlying buffer
+   * as modified, invalidating any cached mirror (see `mirror`).
+   */
+  T* data() H2_NOEXCEPT
+  {
+    if (raw_buffer)
+    {
+      raw_buffer->mark_modified();
+    }
+    return const_cast<T*>(std::as_const(*this).data());
+  }
 
   T const* data() const H2_NOEXCEPT { return const_data(); }
 
@@ -409,6 +695,33 @@ public:
 
   Device get_device() const H2_NOEXCEPT { return mem_device; }
 
+  /** Return the kind of memory this allocates. */
+  MemoryKind get_memory_kind() const H2_NOEXCEPT { return mem_kind; }
+
+  /**
+   * Prefetch managed memory to `dev` on this memory's stream.
+   *
+   * This applies to the entire underlying buffer, which may be shared
+   * with views.
+   */
+  void prefetch(Device dev)
+  {
+    // Releasing this memory already synchronizes with our stream.
+    if (raw_buffer)
+    {
+      raw_buffer->prefetch(dev, stream);
+    }
+  }
+
+  /** Set a placement hint for managed memory with respect to `dev`. */
+  void advise(ManagedAdvice advice, Device dev)
+  {
+    if (raw_buffer)
+    {
+      raw_buffer->advise(advice, dev);
+    }
+  }
+
 private:
   /**
    * Raw underlying memory buffer.
@@ -435,6 +748,7 @@ private:
   Device mem_device;       /**< Device the memory is on. */
   ComputeStream stream;    /**< Compute stream for operations. */
   bool is_mem_lazy;        /**< Whether allocation is lazy. */
+  MemoryKind mem_kind;     /**< Kind of memory to allocate. */
 
   /** Helper to create a raw buffer if size is non-empty. */
   void make_raw_buffer(bool lazy)
@@ -445,8 +759,9 @@ private:
       std::size_t const size = get_extent_from_strides(mem_shape, mem_strides);
       if (size)
       {
-        raw_buffer =
-          std::make_shared<RawBuffer<T>>(mem_device, size, lazy, stream);
+        raw_buffer = std::allocate_shared<RawBuffer<T>>(
+          internal::PoolAllocator<RawBuffer<T>>{},
+          mem_device, size, lazy, stream, mem_kind);
       }
     }
   }
@@ -516,4 +831,10 @@ inline std::ostream& strided_memory_contents(std::ostream& os,
   return os;
 }
 
+// Instantiated in the library (see tensor.cpp).
+extern template class StridedMemory<float>;
+extern template class StridedMemory<double>;
+extern template class StridedMemory<std::int32_t>;
+extern template class StridedMemory<std::uint32_t>;
+
 }  // namespace h2
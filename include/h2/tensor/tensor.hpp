@@ -12,15 +12,20 @@
  * Local tensors that live on a device.
  */
 
+#include "h2/core/object_pool.hpp"
 #include "h2/core/types.hpp"
+#include "h2/tensor/copy_buffer.hpp"
 #include "h2/tensor/strided_memory.hpp"
 #include "h2/tensor/tensor_base.hpp"
 #include "h2/tensor/tensor_types.hpp"
 #include "h2/tensor/tensor_utils.hpp"
 #include "h2/utils/passkey.hpp"
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <utility>
 
 namespace h2
 {
@@ -39,22 +44,42 @@ public:
   static_assert(IsH2StorageType_v<T>,
                 "Cannot create a tensor with a non-storage type");
 
+  // Tensors are frequently allocated for views and conversions, so
+  // they come from the object pool.
+  static void* operator new(std::size_t bytes)
+  {
+    return internal::pool_allocate(bytes);
+  }
+
+  static void operator delete(void* ptr, std::size_t bytes) noexcept
+  {
+    internal::pool_deallocate(ptr, bytes);
+  }
+
   Tensor(Device device,
          ShapeTuple const& shape_,
          DimensionTypeTuple const& dim_types_,
          TensorAllocationStrategy alloc_type = StrictAlloc,
-         std::optional<ComputeStream> const stream = std::nullopt)
+         std::optional<ComputeStream> const stream = std::nullopt,
+         MemoryKind mem_kind = MemoryKind::Default)
     : BaseTensor(shape_, dim_types_),
       tensor_memory(device,
                     shape_,
                     alloc_type == LazyAlloc,
-                    stream.value_or(ComputeStream{device}))
+                    stream.value_or(ComputeStream{device}),
+                    mem_kind)
   {}
 
   Tensor(Device device,
          TensorAllocationStrategy alloc_type = StrictAlloc,
-         std::optional<ComputeStream> const stream = std::nullopt)
-    : Tensor(device, ShapeTuple(), DimensionTypeTuple(), alloc_type, stream)
+         std::optional<ComputeStream> const stream = std::nullopt,
+         MemoryKind mem_kind = MemoryKind::Default)
+    : Tensor(device,
+             ShapeTuple(),
+             DimensionTypeTuple(),
+             alloc_type,
+             stream,
+             mem_kind)
   {}
 
   Tensor(Device device,
@@ -62,23 +87,33 @@ public:
          DimensionTypeTuple const& dim_types_,
          StrideTuple const& strides_,
          TensorAllocationStrategy alloc_type = StrictAlloc,
-         std::optional<ComputeStream> const stream = std::nullopt)
+         std::optional<ComputeStream> const stream = std::nullopt,
+         MemoryKind mem_kind = MemoryKind::Default)
     : BaseTensor(shape_, dim_types_),
       tensor_memory(device,
                     shape_,
                     strides_,
                     alloc_type == LazyAlloc,
-                    stream.value_or(ComputeStream{device}))
+                    stream.value_or(ComputeStream{device}),
+                    mem_kind)
   {}
 
+  /**
+   * Wrap an external buffer.
+   *
+   * If `buffer_owner` is given, it is kept alive as long as this
+   * tensor or any view of it references `buffer`.
+   */
   Tensor(Device device,
          T* buffer,
          ShapeTuple const& shape_,
          DimensionTypeTuple const& dim_types_,
          StrideTuple const& strides_,
-         ComputeStream const& stream)
+         ComputeStream const& stream,
+         std::shared_ptr<void> buffer_owner = nullptr)
     : BaseTensor(ViewType::Mutable, shape_, dim_types_),
-      tensor_memory(device, buffer, shape_, strides_, stream)
+      tensor_memory(
+        device, buffer, shape_, strides_, stream, std::move(buffer_owner))
   {}
 
   Tensor(Device device,
@@ -86,9 +121,15 @@ public:
          ShapeTuple const& shape_,
          DimensionTypeTuple const& dim_types_,
          StrideTuple const& strides_,
-         ComputeStream const& stream)
+         ComputeStream const& stream,
+         std::shared_ptr<void> buffer_owner = nullptr)
     : BaseTensor(ViewType::Const, shape_, dim_types_),
-      tensor_memory(device, const_cast<T*>(buffer), shape_, strides_, stream)
+      tensor_memory(device,
+                    const_cast<T*>(buffer),
+                    shape_,
+                    strides_,
+                    stream,
+                    std::move(buffer_owner))
   {}
 
   /** Internal constructor for views. */
@@ -101,6 +142,15 @@ public:
     : BaseTensor(view_type_, shape_, dim_types_), tensor_memory(mem_, coords)
   {}
 
+  /** Internal constructor for views of an entire memory region. */
+  Tensor(ViewType view_type_,
+         StridedMemory<T> const& mem_,
+         ShapeTuple const& shape_,
+         DimensionTypeTuple const& dim_types_,
+         Passkey2<Tensor<T>, DistTensor<T>>)
+    : BaseTensor(view_type_, shape_, dim_types_), tensor_memory(mem_)
+  {}
+
   /**
    * Internal constructor for views from different devices.
    *
@@ -214,11 +264,76 @@ public:
     return tensor_memory.get_device();
   }
 
+  /** Return the kind of memory backing this tensor. */
+  MemoryKind get_memory_kind() const H2_NOEXCEPT
+  {
+    return tensor_memory.get_memory_kind();
+  }
+
+  /**
+   * Asynchronously migrate a tensor's managed memory to `dev`.
+   *
+   * This is ordered on the tensor's stream. It does nothing if the
+   * tensor is not backed by allocated managed memory (e.g., it is
+   * lazy and has not been ensure'd).
+   */
+  void prefetch(Device dev) { tensor_memory.prefetch(dev); }
+
+  /**
+   * Set a placement hint for a tensor's managed memory with respect to
+   * `dev`.
+   *
+   * This does nothing if the tensor is not backed by allocated managed
+   * memory.
+   */
+  void advise(ManagedAdvice advice, Device dev)
+  {
+    tensor_memory.advise(advice, dev);
+  }
+
+  /**
+   * Make this tensor wrap a different external buffer, as if newly
+   * constructed to wrap it.
+   *
+   * Unlike constructing a new tensor, this reuses the tensor's memory
+   * bookkeeping when nothing else (e.g., a view) shares it, so
+   * re-wrapping buffers does not allocate.
+   */
+  void wrap(Device device,
+            T* buffer,
+            ShapeTuple const& shape_,
+            DimensionTypeTuple const& dim_types_,
+            StrideTuple const& strides_,
+            ComputeStream const& stream)
+  {
+    tensor_memory.wrap(device, buffer, shape_, strides_, stream);
+    this->tensor_shape = shape_;
+    this->tensor_dim_types = dim_types_;
+    this->tensor_view_type = ViewType::Mutable;
+  }
+
+  /** Version of `wrap` for constant buffers. */
+  void wrap(Device device,
+            T const* buffer,
+            ShapeTuple const& shape_,
+            DimensionTypeTuple const& dim_types_,
+            StrideTuple const& strides_,
+            ComputeStream const& stream)
+  {
+    tensor_memory.wrap(
+      device, const_cast<T*>(buffer), shape_, strides_, stream);
+    this->tensor_shape = shape_;
+    this->tensor_dim_types = dim_types_;
+    this->tensor_view_type = ViewType::Const;
+  }
+
   void empty() override
   {
     auto stream = tensor_memory.get_stream();
-    tensor_memory =
-      StridedMemory<T>(get_device(), tensor_memory.is_lazy(), stream);
+    tensor_memory = StridedMemory<T>(get_device(),
+                                     tensor_memory.is_lazy(),
+                                     stream,
+                                     tensor_memory.get_memory_kind());
     this->tensor_shape = ShapeTuple();
     this->tensor_dim_types = DimensionTypeTuple();
     if (this->is_view())
@@ -253,9 +368,17 @@ public:
       this->tensor_dim_types = new_dim_types;
       return;
     }
-    auto stream = tensor_memory.get_stream();
-    tensor_memory = StridedMemory<T>(
-      get_device(), new_shape, tensor_memory.is_lazy(), stream);
+    // Reuse the existing allocation if it is large enough.
+    if (!tensor_memory.resize_in_place(new_shape,
+                                       get_contiguous_strides(new_shape)))
+    {
+      auto stream = tensor_memory.get_stream();
+      tensor_memory = StridedMemory<T>(get_device(),
+                                       new_shape,
+                                       tensor_memory.is_lazy(),
+                                       stream,
+                                       tensor_memory.get_memory_kind());
+    }
     this->tensor_shape = new_shape;
     this->tensor_dim_types = new_dim_types;
   }
@@ -285,13 +408,56 @@ public:
       this->tensor_dim_types = new_dim_types;
       return;
     }
-    auto stream = tensor_memory.get_stream();
-    tensor_memory = StridedMemory<T>(
-      get_device(), new_shape, new_strides, tensor_memory.is_lazy(), stream);
+    if (!tensor_memory.resize_in_place(new_shape, new_strides))
+    {
+      auto stream = tensor_memory.get_stream();
+      tensor_memory = StridedMemory<T>(get_device(),
+                                       new_shape,
+                                       new_strides,
+                                       tensor_memory.is_lazy(),
+                                       stream,
+                                       tensor_memory.get_memory_kind());
+    }
     this->tensor_shape = new_shape;
     this->tensor_dim_types = new_dim_types;
   }
 
+  /**
+   * Return the number of elements allocated for this tensor's memory.
+   *
+   * This may exceed what the tensor needs after `resize` reused a
+   * larger allocation, and is 0 if nothing is allocated.
+   */
+  std::size_t capacity() const H2_NOEXCEPT { return tensor_memory.capacity(); }
+
+  /**
+   * Reallocate the tensor's memory to exactly what it needs, if it has
+   * excess capacity from `resize`, copying its contents.
+   *
+   * Views of the tensor keep the old memory.
+   */
+  void shrink_to_fit()
+  {
+    H2_ASSERT_ALWAYS(!this->is_view(), "Cannot shrink a view");
+    if (tensor_memory.capacity() <= tensor_memory.size())
+    {
+      return;
+    }
+    auto stream = tensor_memory.get_stream();
+    StridedMemory<T> new_memory(get_device(),
+                                shape(),
+                                strides(),
+                                false,
+                                stream,
+                                tensor_memory.get_memory_kind());
+    copy_buffer(new_memory.data(),
+                stream,
+                tensor_memory.const_data(),
+                stream,
+                tensor_memory.size());
+    tensor_memory = std::move(new_memory);
+  }
+
   /**
    * Return a raw pointer to the underlying storage.
    *
@@ -334,6 +500,11 @@ public:
     tensor_memory.ensure(true);
   }
 
+  void ensure_async(ComputeStream const& alloc_stream) override
+  {
+    tensor_memory.ensure_async(alloc_stream, true);
+  }
+
   void release() override { tensor_memory.release(); }
 
   /**
@@ -345,6 +516,9 @@ public:
    * If this tensor is a view, the returned tensor will be distinct
    * from the viewed tensor. Any views of this tensor will still be
    * viewing the original tensor, not the contiguous tensor.
+   *
+   * The new tensor is on this tensor's stream, and the data is copied
+   * with `copy_strided_buffer`, so this is asynchronous on GPUs.
    */
   std::unique_ptr<Tensor<T>> contiguous()
   {
@@ -352,7 +526,74 @@ public:
     {
       return view();
     }
-    throw H2Exception("contiguous() not implemented");
+    auto contig = std::make_unique<Tensor<T>>(get_device(),
+                                              this->tensor_shape,
+                                              this->tensor_dim_types,
+                                              StrictAlloc,
+                                              get_stream());
+    copy_strided_buffer(contig->data(),
+                        contig->strides(),
+                        contig->get_stream(),
+                        const_data(),
+                        strides(),
+                        get_stream(),
+                        this->tensor_shape);
+    return contig;
+  }
+
+  /**
+   * Return a contiguous copy of this tensor with its dimensions
+   * permuted.
+   *
+   * Dimension `i` of the new tensor is dimension `order[i]` of this
+   * tensor, e.g., `{2, 0, 1}` converts a tensor with shape (C, W, H)
+   * to one with shape (H, C, W).
+   *
+   * The new tensor is on this tensor's stream, and the data is copied
+   * with `copy_strided_buffer`, which transposes in tiles, so this is
+   * asynchronous on GPUs. Use `permute_view` to avoid the copy.
+   */
+  std::unique_ptr<Tensor<T>> permute(DimensionOrderTuple const& order) const
+  {
+    H2_ASSERT_ALWAYS(is_dimension_order(order, this->tensor_shape.size()),
+                     "Order ",
+                     order,
+                     " is not a permutation of the dimensions of a tensor "
+                     "with shape ",
+                     this->tensor_shape);
+    auto permuted =
+      std::make_unique<Tensor<T>>(get_device(),
+                                  permute_tuple(this->tensor_shape, order),
+                                  permute_tuple(this->tensor_dim_types, order),
+                                  StrictAlloc,
+                                  get_stream());
+    copy_strided_buffer(permuted->data(),
+                        permuted->strides(),
+                        permuted->get_stream(),
+                        const_data(),
+                        permute_tuple(strides(), order),
+                        get_stream(),
+                        permuted->shape());
+    return permuted;
+  }
+
+  /**
+   * Return a view of this tensor with its dimensions permuted.
+   *
+   * This is the same as `permute`, but the view shares memory with
+   * this tensor and has permuted strides, so it is generally not
+   * contiguous.
+   */
+  std::unique_ptr<Tensor<T>> permute_view(DimensionOrderTuple const& order)
+  {
+    return make_permuted_view(order, ViewType::Mutable);
+  }
+
+  /** Return a constant view of this tensor with its dimensions permuted. */
+  std::unique_ptr<Tensor<T>>
+  permute_view(DimensionOrderTuple const& order) const
+  {
+    return make_permuted_view(order, ViewType::Const);
   }
 
   /**
@@ -510,9 +751,61 @@ public:
 
   bool is_lazy() const H2_NOEXCEPT { return tensor_memory.is_lazy(); }
 
+  /**
+   * Enable or disable caching copies of this tensor on other devices.
+   *
+   * When enabled, `make_accessible_on_device` reuses the copy it made
+   * for a prior call until either this tensor's memory or the copy is
+   * modified (i.e., a mutable pointer to it is taken). This is off by
+   * default and does not carry over to views.
+   */
+  void set_mirror_cache(bool enable) H2_NOEXCEPT
+  {
+    use_mirror_cache = enable;
+  }
+
+  /** Return true if copies on other devices are cached. */
+  bool is_mirror_cache_enabled() const H2_NOEXCEPT
+  {
+    return use_mirror_cache;
+  }
+
+  /**
+   * Return a view of a cached copy of this tensor on `dev`, making
+   * the copy if it is not cached or is stale.
+   *
+   * This is mainly for internal use; see `make_accessible_on_device`.
+   * The tensor must not be empty or unallocated.
+   */
+  std::unique_ptr<Tensor<T>> mirror(Device dev, ComputeStream const& stream)
+  {
+    if (this->tensor_view_type == ViewType::Const)
+    {
+      return std::as_const(*this).mirror(dev, stream);
+    }
+    return std::make_unique<Tensor<T>>(ViewType::Mutable,
+                                       tensor_memory.mirror(dev, stream),
+                                       this->tensor_shape,
+                                       this->tensor_dim_types,
+                                       Passkey<Tensor<T>>{});
+  }
+
+  /** Return a constant view of a cached copy of this tensor on `dev`. */
+  std::unique_ptr<Tensor<T>> mirror(Device dev,
+                                    ComputeStream const& stream) const
+  {
+    return std::make_unique<Tensor<T>>(ViewType::Const,
+                                       tensor_memory.mirror(dev, stream),
+                                       this->tensor_shape,
+                                       this->tensor_dim_types,
+                                       Passkey<Tensor<T>>{});
+  }
+
 private:
   /** Underlying memory buffer for the tensor. */
   StridedMemory<T> tensor_memory;
+  /** Whether `make_accessible_on_device` caches copies. */
+  bool use_mirror_cache = false;
 
   /** Helper for constructing views. */
   std::unique_ptr<Tensor<T>> make_view(IndexRangeTuple const& coords,
@@ -563,8 +856,33 @@ private:
                                        Passkey<Tensor<T>>{});
   }
 
+  /** Helper for constructing permuted views. */
+  std::unique_ptr<Tensor<T>>
+  make_permuted_view(DimensionOrderTuple const& order, ViewType view_type) const
+  {
+    H2_ASSERT_ALWAYS(is_dimension_order(order, this->tensor_shape.size()),
+                     "Order ",
+                     order,
+                     " is not a permutation of the dimensions of a tensor "
+                     "with shape ",
+                     this->tensor_shape);
+    return std::make_unique<Tensor<T>>(
+      view_type,
+      tensor_memory.permute(order),
+      permute_tuple(this->tensor_shape, order),
+      permute_tuple(this->tensor_dim_types, order),
+      Passkey<Tensor<T>>{});
+  }
+
   // DistTensor needs to poke in here for some view stuff.
   friend class DistTensor<T>;
 };
 
+// Tensors of the common compute types are instantiated once in the
+// library rather than in every translation unit that uses them.
+extern template class Tensor<float>;
+extern template class Tensor<double>;
+extern template class Tensor<std::int32_t>;
+extern template class Tensor<std::uint32_t>;
+
 }  // namespace h2
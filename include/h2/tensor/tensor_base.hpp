@@ -143,6 +143,12 @@ public:
   /** Get the compute stream associated with this tensor. */
   virtual ComputeStream get_stream() const H2_NOEXCEPT = 0;
 
+  /**
+   * Return the ordinal of the GPU this tensor's stream is on, or -1
+   * for CPU tensors.
+   */
+  int get_device_id() const H2_NOEXCEPT { return get_stream().get_device_id(); }
+
   /** Set the compute stream associated with this tensor. */
   virtual void set_stream(ComputeStream const& stream) = 0;
 
@@ -190,6 +196,18 @@ public:
    */
   virtual void ensure(tensor_attempt_recovery_t) = 0;
 
+  /**
+   * Ensure memory is backing this tensor, ordering any allocation on
+   * `alloc_stream` instead of the tensor's stream.
+   *
+   * The tensor's stream waits for the allocation to complete, so this
+   * may be used to materialize lazy tensors ahead of their first use
+   * (e.g., on a side stream) and take allocation off the critical
+   * path. This attempts to reuse existing memory from still-extant
+   * views of this tensor.
+   */
+  virtual void ensure_async(ComputeStream const& alloc_stream) = 0;
+
   /**
    * Release memory associated with this tensor.
    *
@@ -208,6 +226,11 @@ public:
   /**
    * Resize the tensor to a new shape, keeping dimension types the same.
    *
+   * If no view shares the tensor's memory and it is large enough
+   * (e.g., when shrinking, or regrowing after shrinking), the memory is
+   * reused rather than reallocated, so the data pointer is unchanged.
+   * The contents are not preserved in any meaningful layout.
+   *
    * It is an error to call this on a view.
    */
   virtual void resize(ShapeTuple const& new_shape) = 0;
@@ -215,6 +238,8 @@ public:
   /**
    * Resize the tensor to a new shape, also changing dimension types.
    *
+   * Memory is reused as in the other `resize`.
+   *
    * It is an error to call this on a view.
    */
   virtual void resize(ShapeTuple const& new_shape,
@@ -224,6 +249,8 @@ public:
    * Resize the tensor to a new shape, also changing dimension types
    * and specifying new strides.
    *
+   * Memory is reused as in the other `resize`.
+   *
    * It is an error to call this on a view.
    */
   virtual void resize(ShapeTuple const& new_shape,
@@ -113,6 +113,12 @@ using DTTuple = DimensionTypeTuple;  // Alias to save you some typing.
  */
 using StrideTuple = NDimTuple<DataIndexType>;
 
+/**
+ * An order of the dimensions of a tensor, where entry `i` gives the
+ * dimension that becomes dimension `i`.
+ */
+using DimensionOrderTuple = NDimTuple<NDimType>;
+
 /**
  * Represents a range of indices.
  *
@@ -234,6 +240,31 @@ inline std::ostream& operator<<(std::ostream& os, ViewType const& vt)
   return os;
 }
 
+/** Reduction operations for tensor reductions and collectives. */
+enum class ReductionOp
+{
+  Sum,
+  Prod,
+  Min,
+  Max,
+  Mean /**< Only for tensor reductions (see `reduce`). */
+};
+
+/** Support printing ReductionOp. */
+inline std::ostream& operator<<(std::ostream& os, ReductionOp const& op)
+{
+  switch (op)
+  {
+  case ReductionOp::Sum: os << "Sum"; break;
+  case ReductionOp::Prod: os << "Prod"; break;
+  case ReductionOp::Min: os << "Min"; break;
+  case ReductionOp::Max: os << "Max"; break;
+  case ReductionOp::Mean: os << "Mean"; break;
+  default: os << "Unknown"; break;
+  }
+  return os;
+}
+
 // These are used by local and distributed tensors for memory recovery.
 /** Do not attempt recovery in `BaseTensor::ensure`. */
 static constexpr struct tensor_no_recovery_t
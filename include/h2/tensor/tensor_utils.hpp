@@ -279,6 +279,57 @@ next_scalar_index(ScalarIndexTuple const& idx,
   return next_idx;
 }
 
+/**
+ * Return true if `order` is a permutation of the dimensions of a
+ * tensor with `ndim` dimensions.
+ */
+constexpr inline bool is_dimension_order(DimensionOrderTuple const& order,
+                                         NDimType ndim) H2_NOEXCEPT
+{
+  if (order.size() != ndim)
+  {
+    return false;
+  }
+  for (typename DimensionOrderTuple::size_type i = 0; i < order.size(); ++i)
+  {
+    if (order[i] < 0 || order[i] >= ndim)
+    {
+      return false;
+    }
+    for (typename DimensionOrderTuple::size_type j = 0; j < i; ++j)
+    {
+      if (order[i] == order[j])
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * Return `tuple` with its entries reordered so that entry `i` is
+ * `tuple[order[i]]`.
+ */
+template <typename TupleT>
+constexpr inline TupleT permute_tuple(TupleT const& tuple,
+                                      DimensionOrderTuple const& order)
+  H2_NOEXCEPT
+{
+  H2_ASSERT_DEBUG(is_dimension_order(order, tuple.size()),
+                  "Order ",
+                  order,
+                  " is not a permutation of ",
+                  tuple.size(),
+                  " dimensions");
+  TupleT permuted;
+  for (typename DimensionOrderTuple::size_type i = 0; i < order.size(); ++i)
+  {
+    permuted.append(tuple[order[i]]);
+  }
+  return permuted;
+}
+
 /**
  * Iterate over an n-dimensional region.
  *
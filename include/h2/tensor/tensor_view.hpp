@@ -0,0 +1,504 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Lightweight, non-owning views of tensor data.
+ *
+ * Views are dynamically ranked (`TensorView<T>`) by default. Views
+ * with a rank fixed at compile time (e.g., `TensorView<T, 4>`) hold
+ * their shape and strides in fixed-size arrays, so their index math
+ * is unrolled; `dispatch_ranked_view` selects one from a dynamically
+ * ranked view.
+ */
+
+#include <h2_config.hpp>
+
+#include "h2/core/device.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/core/types.hpp"
+#include "h2/tensor/strided_memory.hpp"
+#include "h2/tensor/tensor.hpp"
+#include "h2/tensor/tensor_types.hpp"
+#include "h2/tensor/tensor_utils.hpp"
+#include "h2/utils/const_for.hpp"
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace h2
+{
+
+/** Rank of views whose number of dimensions is only known at runtime. */
+inline constexpr std::size_t dynamic_rank = static_cast<std::size_t>(-1);
+
+/** Largest rank `dispatch_ranked_view` specializes views for. */
+inline constexpr std::size_t max_ranked_view_dims = 5;
+
+template <typename T, std::size_t Rank = dynamic_rank>
+class TensorView;
+
+/**
+ * A non-owning view of strided tensor data.
+ *
+ * This is a small value type holding only a pointer, shape, strides,
+ * device, and compute stream. Unlike `Tensor::view`, slicing a
+ * `TensorView` does not allocate and does not touch any reference
+ * counts, so views can be created repeatedly (e.g., per sample in a
+ * loop) on the stack and passed by value to loops and kernels.
+ *
+ * A `TensorView` does not keep its memory alive: the tensor (or
+ * buffer) it was created from must outlive it. It also does not track
+ * dimension types or lazy allocation; creating a view of a lazy
+ * `Tensor` allocates its memory.
+ *
+ * `T` may be const-qualified for a read-only view.
+ *
+ * Slicing follows the same rules as `Tensor::view`. For performance,
+ * coordinates are only checked in debug builds.
+ */
+template <typename T>
+class TensorView<T, dynamic_rank>
+{
+public:
+  using value_type = T;
+  using non_const_value_type = std::remove_const_t<T>;
+
+  /** Construct an empty view. */
+  TensorView() = default;
+
+  /** View existing memory with the given shape and strides. */
+  TensorView(T* data_,
+             ShapeTuple const& shape_,
+             StrideTuple const& strides_,
+             Device device_,
+             ComputeStream const& stream_) H2_NOEXCEPT
+    : view_data(data_),
+      view_shape(shape_),
+      view_strides(strides_),
+      view_device(device_),
+      view_stream(stream_)
+  {
+    H2_ASSERT_DEBUG(view_shape.size() == view_strides.size(),
+                    "Shape (",
+                    view_shape,
+                    ") and strides (",
+                    view_strides,
+                    ") must be the same size");
+  }
+
+  /** View the entirety of a tensor. */
+  TensorView(Tensor<non_const_value_type>& tensor)
+    : TensorView(tensor.data(),
+                 tensor.shape(),
+                 tensor.strides(),
+                 tensor.get_device(),
+                 tensor.get_stream())
+  {}
+
+  /** View the entirety of a constant tensor. */
+  template <typename U = T,
+            std::enable_if_t<std::is_const_v<U>, bool> = true>
+  TensorView(Tensor<non_const_value_type> const& tensor)
+    : TensorView(tensor.const_data(),
+                 tensor.shape(),
+                 tensor.strides(),
+                 tensor.get_device(),
+                 tensor.get_stream())
+  {}
+
+  /** Allow converting a mutable view to a constant one. */
+  template <typename U = T,
+            std::enable_if_t<std::is_const_v<U>, bool> = true>
+  TensorView(TensorView<non_const_value_type> const& other) H2_NOEXCEPT
+    : TensorView(other.data(),
+                 other.shape(),
+                 other.strides(),
+                 other.get_device(),
+                 other.get_stream())
+  {}
+
+  /** Return the shape of the view. */
+  ShapeTuple const& shape() const H2_NOEXCEPT { return view_shape; }
+
+  /** Return the size of dimension `i`. */
+  typename ShapeTuple::type
+  shape(typename ShapeTuple::size_type i) const H2_NOEXCEPT
+  {
+    return view_shape[i];
+  }
+
+  /** Return the strides of the view. */
+  StrideTuple const& strides() const H2_NOEXCEPT { return view_strides; }
+
+  /** Return the stride of dimension `i`. */
+  typename StrideTuple::type
+  stride(typename StrideTuple::size_type i) const H2_NOEXCEPT
+  {
+    return view_strides[i];
+  }
+
+  /** Return the number of dimensions of the view. */
+  typename ShapeTuple::size_type ndim() const H2_NOEXCEPT
+  {
+    return view_shape.size();
+  }
+
+  /** Return the number of elements in the view. */
+  DataIndexType numel() const H2_NOEXCEPT
+  {
+    if (view_shape.is_empty())
+    {
+      return 0;
+    }
+    return product<DataIndexType>(view_shape);
+  }
+
+  /** Return true if the view is empty. */
+  bool is_empty() const H2_NOEXCEPT { return numel() == 0; }
+
+  /** Return true if the viewed memory is contiguous. */
+  bool is_contiguous() const H2_NOEXCEPT
+  {
+    return are_strides_contiguous(view_shape, view_strides);
+  }
+
+  /** Return a pointer to the first element of the view. */
+  T* data() const H2_NOEXCEPT { return view_data; }
+
+  /** Return a pointer to the element at `coords`. */
+  T* get(ScalarIndexTuple const& coords) const H2_NOEXCEPT
+  {
+    H2_ASSERT_DEBUG(view_data, "No memory");
+    return view_data + inner_product<DataIndexType>(coords, view_strides);
+  }
+
+  /** Return the device of the viewed memory. */
+  Device get_device() const H2_NOEXCEPT { return view_device; }
+
+  /** Return the compute stream associated with the view. */
+  ComputeStream const& get_stream() const H2_NOEXCEPT { return view_stream; }
+
+  /** Return a view of a subset of this view. */
+  TensorView<T> view(IndexRangeTuple const& coords) const H2_NOEXCEPT
+  {
+    H2_ASSERT_DEBUG(is_index_range_contained(coords, view_shape),
+                    "View coordinates ",
+                    coords,
+                    " are not in ",
+                    view_shape);
+    if (is_index_range_empty(coords))
+    {
+      return TensorView<T>(
+        nullptr, ShapeTuple{}, StrideTuple{}, view_device, view_stream);
+    }
+    TensorView<T> sub(
+      view_data, ShapeTuple{}, StrideTuple{}, view_device, view_stream);
+    for (typename ShapeTuple::size_type i = 0; i < view_shape.size(); ++i)
+    {
+      if (i < coords.size())
+      {
+        sub.view_data += coords[i].start() * view_strides[i];
+        if (coords[i].is_scalar())
+        {
+          continue;
+        }
+      }
+      sub.view_shape.append((i >= coords.size() || coords[i] == ALL)
+                              ? view_shape[i]
+                              : coords[i].end() - coords[i].start());
+      sub.view_strides.append(view_strides[i]);
+    }
+    if (sub.view_shape.is_empty())
+    {
+      // All coordinates were scalars: Decay to a shape of 1.
+      sub.view_shape = ShapeTuple(1);
+      sub.view_strides = StrideTuple(1);
+    }
+    else if (all_of(sub.view_shape, [](ShapeTuple::type x) { return x == 1; }))
+    {
+      // Every coordinate was a range of length 1, so this is
+      // essentially a scalar: Make the strides look contiguous.
+      sub.view_strides =
+        StrideTuple(TuplePad<StrideTuple>(sub.view_shape.size(), 1));
+    }
+    return sub;
+  }
+
+  /** Return a view of a subset of this view. */
+  TensorView<T> operator()(IndexRangeTuple const& coords) const H2_NOEXCEPT
+  {
+    return view(coords);
+  }
+
+  /**
+   * Return a view of this view with its dimensions permuted by
+   * `order`.
+   *
+   * Dimension `i` of the result is dimension `order[i]` of this view.
+   */
+  TensorView<T> permute(DimensionOrderTuple const& order) const H2_NOEXCEPT
+  {
+    H2_ASSERT_DEBUG(is_dimension_order(order, view_shape.size()),
+                    "Order ",
+                    order,
+                    " is not a permutation of the dimensions of a view "
+                    "with shape ",
+                    view_shape);
+    return TensorView<T>(view_data,
+                         permute_tuple(view_shape, order),
+                         permute_tuple(view_strides, order),
+                         view_device,
+                         view_stream);
+  }
+
+private:
+  /** Pointer to the first element of the view. */
+  T* view_data = nullptr;
+  /** Shape of the view. */
+  ShapeTuple view_shape;
+  /** Strides of the view. */
+  StrideTuple view_strides;
+  /** Device of the viewed memory. */
+  Device view_device = Device::CPU;
+  /** Compute stream for the view. */
+  ComputeStream view_stream{Device::CPU};
+};
+
+/**
+ * A non-owning view of strided tensor data with `Rank` dimensions.
+ *
+ * This is like the dynamically ranked `TensorView<T>`, but the rank
+ * is a compile-time constant and the shape and strides are fixed-size
+ * arrays, so loops over dimensions (e.g., in `numel` and `get`) are
+ * unrolled and index math can be folded by the compiler. This matters
+ * most for small tensors, where index math is a large part of the
+ * work.
+ *
+ * Ranked views are usually obtained with `dispatch_ranked_view`, and
+ * may be converted back with `as_dynamic`.
+ */
+template <typename T, std::size_t Rank>
+class TensorView
+{
+  static_assert(Rank > 0 && Rank <= MAX_TENSOR_DIMS,
+                "Invalid rank for a ranked TensorView");
+
+public:
+  using value_type = T;
+  using non_const_value_type = std::remove_const_t<T>;
+  using shape_type = std::array<typename ShapeTuple::type, Rank>;
+  using strides_type = std::array<typename StrideTuple::type, Rank>;
+
+  /** Construct an empty view. */
+  TensorView() = default;
+
+  /** View existing memory with the given shape and strides. */
+  TensorView(T* data_,
+             shape_type const& shape_,
+             strides_type const& strides_,
+             Device device_,
+             ComputeStream const& stream_) H2_NOEXCEPT
+    : view_data(data_),
+      view_shape(shape_),
+      view_strides(strides_),
+      view_device(device_),
+      view_stream(stream_)
+  {}
+
+  /** View the same data as a dynamically ranked view of rank `Rank`. */
+  explicit TensorView(TensorView<T> const& other) H2_NOEXCEPT
+    : view_data(other.data()),
+      view_device(other.get_device()),
+      view_stream(other.get_stream())
+  {
+    H2_ASSERT_DEBUG(other.ndim() == Rank,
+                    "Cannot view a tensor with ",
+                    other.ndim(),
+                    " dimensions with rank ",
+                    Rank);
+    for (std::size_t i = 0; i < Rank; ++i)
+    {
+      view_shape[i] = other.shape(i);
+      view_strides[i] = other.stride(i);
+    }
+  }
+
+  /** Allow converting a mutable view to a constant one. */
+  template <typename U = T,
+            std::enable_if_t<std::is_const_v<U>, bool> = true>
+  TensorView(TensorView<non_const_value_type, Rank> const& other) H2_NOEXCEPT
+    : TensorView(other.data(),
+                 other.shape(),
+                 other.strides(),
+                 other.get_device(),
+                 other.get_stream())
+  {}
+
+  /** Return the shape of the view. */
+  shape_type const& shape() const H2_NOEXCEPT { return view_shape; }
+
+  /** Return the size of dimension `i`. */
+  typename ShapeTuple::type shape(std::size_t i) const H2_NOEXCEPT
+  {
+    return view_shape[i];
+  }
+
+  /** Return the strides of the view. */
+  strides_type const& strides() const H2_NOEXCEPT { return view_strides; }
+
+  /** Return the stride of dimension `i`. */
+  typename StrideTuple::type stride(std::size_t i) const H2_NOEXCEPT
+  {
+    return view_strides[i];
+  }
+
+  /** Return the number of dimensions of the view. */
+  static constexpr std::size_t ndim() H2_NOEXCEPT { return Rank; }
+
+  /** Return the number of elements in the view. */
+  DataIndexType numel() const H2_NOEXCEPT
+  {
+    DataIndexType n = 1;
+    const_for<std::size_t{0}, Rank, std::size_t{1}>(
+      [&](auto i) { n *= view_shape[i.value]; });
+    return n;
+  }
+
+  /** Return true if the view is empty. */
+  bool is_empty() const H2_NOEXCEPT { return numel() == 0; }
+
+  /** Return true if the viewed memory is contiguous. */
+  bool is_contiguous() const H2_NOEXCEPT
+  {
+    bool contiguous = true;
+    DataIndexType prod = 1;
+    const_for<std::size_t{0}, Rank, std::size_t{1}>([&](auto i) {
+      contiguous = contiguous && view_strides[i.value] == prod;
+      prod *= view_shape[i.value];
+    });
+    return contiguous;
+  }
+
+  /** Return a pointer to the first element of the view. */
+  T* data() const H2_NOEXCEPT { return view_data; }
+
+  /** Return a pointer to the element at `coords`. */
+  T* get(shape_type const& coords) const H2_NOEXCEPT
+  {
+    H2_ASSERT_DEBUG(view_data, "No memory");
+    DataIndexType offset = 0;
+    const_for<std::size_t{0}, Rank, std::size_t{1}>([&](auto i) {
+      offset += coords[i.value] * view_strides[i.value];
+    });
+    return view_data + offset;
+  }
+
+  /** Return a pointer to the element at the coordinates `coords...`. */
+  template <typename... Coords,
+            std::enable_if_t<sizeof...(Coords) == Rank, bool> = true>
+  T* get(Coords... coords) const H2_NOEXCEPT
+  {
+    return get(shape_type{static_cast<typename ShapeTuple::type>(coords)...});
+  }
+
+  /**
+   * Return a pointer to the element at linear index `i`, counting in
+   * generalized column-major order (the first dimension fastest).
+   */
+  T* get_linear(DataIndexType i) const H2_NOEXCEPT
+  {
+    H2_ASSERT_DEBUG(view_data, "No memory");
+    DataIndexType offset = 0;
+    const_for<std::size_t{0}, Rank, std::size_t{1}>([&](auto d) {
+      // What remains of the index is the coordinate in the last
+      // dimension.
+      DataIndexType coord = i;
+      if constexpr (d.value + 1 < Rank)
+      {
+        coord = i % view_shape[d.value];
+        i /= view_shape[d.value];
+      }
+      offset += coord * view_strides[d.value];
+    });
+    return view_data + offset;
+  }
+
+  /** Return the device of the viewed memory. */
+  Device get_device() const H2_NOEXCEPT { return view_device; }
+
+  /** Return the compute stream associated with the view. */
+  ComputeStream const& get_stream() const H2_NOEXCEPT { return view_stream; }
+
+  /** Return a dynamically ranked view of the same data. */
+  TensorView<T> as_dynamic() const H2_NOEXCEPT
+  {
+    ShapeTuple shape;
+    StrideTuple strides;
+    for (std::size_t i = 0; i < Rank; ++i)
+    {
+      shape.append(view_shape[i]);
+      strides.append(view_strides[i]);
+    }
+    return TensorView<T>(view_data, shape, strides, view_device, view_stream);
+  }
+
+private:
+  /** Pointer to the first element of the view. */
+  T* view_data = nullptr;
+  /** Shape of the view. */
+  shape_type view_shape = {};
+  /** Strides of the view. */
+  strides_type view_strides = {};
+  /** Device of the viewed memory. */
+  Device view_device = Device::CPU;
+  /** Compute stream for the view. */
+  ComputeStream view_stream{Device::CPU};
+};
+
+/**
+ * Call `func` with a ranked view of the same data as `view` if its
+ * rank is in [1, `max_ranked_view_dims`], and with `view` otherwise.
+ *
+ * `func` must accept any `TensorView<T, Rank>`, e.g., as a generic
+ * lambda, and is instantiated for each rank.
+ */
+template <typename T, typename FuncT>
+decltype(auto) dispatch_ranked_view(TensorView<T> const& view, FuncT&& func)
+{
+  static_assert(max_ranked_view_dims == 5,
+                "Update the cases for the new maximum rank");
+  switch (view.ndim())
+  {
+  case 1: return func(TensorView<T, 1>(view));
+  case 2: return func(TensorView<T, 2>(view));
+  case 3: return func(TensorView<T, 3>(view));
+  case 4: return func(TensorView<T, 4>(view));
+  case 5: return func(TensorView<T, 5>(view));
+  default: return func(view);
+  }
+}
+
+/** Return a mutable `TensorView` of all of `tensor`. */
+template <typename T>
+TensorView<T> make_tensor_view(Tensor<T>& tensor)
+{
+  return TensorView<T>(tensor);
+}
+
+/** Return a constant `TensorView` of all of `tensor`. */
+template <typename T>
+TensorView<T const> make_tensor_view(Tensor<T> const& tensor)
+{
+  return TensorView<T const>(tensor);
+}
+
+}  // namespace h2
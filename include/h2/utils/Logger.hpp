@@ -15,6 +15,12 @@ namespace h2
 
 /** @brief Logger class to wrap spdlog logger implementation. For spdlog usage
  *  see https://github.com/gabime/spdlog/wiki/1.-QuickStart.
+ *
+ *  Loggers are configured for use at scale by environment variables:
+ *  `H2_LOG_ASYNC` moves formatting and output to a background thread
+ *  (with a bounded queue, see `make_spdlog_logger`), `H2_LOG_RANKS`
+ *  limits which ranks log at all, and `H2_LOG_RATE_LIMIT` caps the
+ *  messages per second written to each output.
  */
 class Logger
 {
@@ -96,4 +102,39 @@ void setup_masks(std::vector<Logger*>& loggers,
  **/
 spdlog::level::level_enum to_spdlog_level(Logger::LogLevelType level);
 
+/** @brief Expand the hostname and rank flags of logger patterns.
+ *
+ *  As in log message patterns, `%h` becomes the hostname, `%w` the
+ *  MPI rank, and `%W` the number of ranks; `%%` becomes `%`. This is
+ *  for, e.g., naming per-rank output files.
+ *  @param pattern String to expand.
+ **/
+std::string expand_rank_pattern(std::string const& pattern);
+
+/** @brief Return whether this rank is selected to log by `H2_LOG_RANKS`.
+ *
+ *  Loggers on other ranks are turned off, so their messages are not
+ *  even formatted.
+ **/
+bool is_logging_rank();
+
+/** @brief Limit a sink to `H2_LOG_RATE_LIMIT` messages per second.
+ *  @param sink Sink to wrap. It is returned as-is without a limit.
+ **/
+::spdlog::sink_ptr make_rate_limited_sink(::spdlog::sink_ptr sink);
+
+/** @brief Create and register an spdlog logger writing to `sink`.
+ *
+ *  With `H2_LOG_ASYNC`, this is an asynchronous logger sharing one
+ *  background thread with a queue of `H2_LOG_ASYNC_QUEUE_SIZE`
+ *  messages; when the queue is full, `H2_LOG_ASYNC_OVERFLOW` selects
+ *  whether to block or to discard the oldest message. The logger's
+ *  level is "trace" on ranks selected by `is_logging_rank` and "off"
+ *  on others.
+ *  @param name Name of logger.
+ *  @param sink Output sink.
+ **/
+std::shared_ptr<::spdlog::logger> make_spdlog_logger(std::string name,
+                                                     ::spdlog::sink_ptr sink);
+
 }  // namespace h2
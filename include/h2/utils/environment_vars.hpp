@@ -30,11 +30,14 @@ namespace h2
  * accessing H2-specific environment variables. The names of these
  * variables are always in uppercase and are prefixed with "H2_" (this
  * is done automatically). The value of these variables is cached after
- * the first access.
+ * the first access: later accesses do not lock or call `getenv` (which
+ * takes a libc lock), and all accesses are thread-safe. `reload`
+ * discards cached values so they are read from the environment again.
  *
  * These variables must be registered at compile-time in the
  * `environment_vars.cpp` file. This is to ensure all environment
- * variables are centralized and documented.
+ * variables are centralized and documented. Accessing a variable that
+ * is not registered throws.
  *
  * This also provides a "raw" interface (in the `env::raw` namespace)
  * that is a direct wrapper around standard calls to access environment
@@ -60,7 +63,21 @@ bool exists(std::string const& name);
  *
  * @note This may be the default value.
  */
-std::string get_raw(std::string const& name);
+std::string const& get_raw(std::string const& name);
+
+/** Return true if name is a registered H2 environment variable. */
+bool is_registered(std::string const& name);
+
+/**
+ * Discard the cached values of all H2 environment variables, so the
+ * next access to each reads it from the environment.
+ *
+ * This is for when the environment is changed deliberately (e.g., in
+ * tests). Values already returned by `get_raw` remain valid, but code
+ * that read a variable once (e.g., to configure an allocator) does not
+ * see the new value.
+ */
+void reload();
 
 /**
  * Return the value of the H2 environment variable name coerced to the
@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * A bounded cache with least-recently-used eviction.
+ */
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <utility>
+
+namespace h2
+{
+
+/**
+ * A map holding at most a fixed number of entries.
+ *
+ * When a new entry would exceed the capacity, the least recently used
+ * entry (by `get` or `insert`) is evicted. A capacity of 0 disables
+ * caching entirely.
+ *
+ * This is not thread-safe.
+ */
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class LRUCache
+{
+public:
+  explicit LRUCache(std::size_t capacity_) : cache_capacity(capacity_) {}
+
+  /**
+   * Return a pointer to the value for `key`, marking it most recently
+   * used, or null if it is not present.
+   *
+   * The pointer is valid until the entry is evicted.
+   */
+  Value* get(Key const& key)
+  {
+    auto it = lookup.find(key);
+    if (it == lookup.end())
+    {
+      return nullptr;
+    }
+    // Move the entry to the front without invalidating iterators.
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->second;
+  }
+
+  /**
+   * Add or replace the value for `key`, marking it most recently used,
+   * and return a pointer to it (or null if the capacity is 0).
+   */
+  Value* insert(Key const& key, Value value)
+  {
+    if (cache_capacity == 0)
+    {
+      return nullptr;
+    }
+    if (Value* existing = get(key))
+    {
+      *existing = std::move(value);
+      return existing;
+    }
+    evict(cache_capacity - 1);
+    entries.emplace_front(key, std::move(value));
+    lookup.emplace(key, entries.begin());
+    return &entries.front().second;
+  }
+
+  /** Remove all entries. */
+  void clear()
+  {
+    lookup.clear();
+    entries.clear();
+  }
+
+  /** Return the number of entries. */
+  std::size_t size() const noexcept { return entries.size(); }
+
+  /** Return the maximum number of entries. */
+  std::size_t capacity() const noexcept { return cache_capacity; }
+
+  /** Change the capacity, evicting entries as needed. */
+  void set_capacity(std::size_t capacity_)
+  {
+    cache_capacity = capacity_;
+    evict(cache_capacity);
+  }
+
+private:
+  using EntryList = std::list<std::pair<Key, Value>>;
+
+  /** Maximum number of entries. */
+  std::size_t cache_capacity;
+  /** Entries, from most to least recently used. */
+  EntryList entries;
+  /** Map from keys to their entry. */
+  std::map<Key, typename EntryList::iterator, Compare> lookup;
+
+  /** Evict least recently used entries until at most `max_size` remain. */
+  void evict(std::size_t max_size)
+  {
+    while (entries.size() > max_size)
+    {
+      lookup.erase(entries.back().first);
+      entries.pop_back();
+    }
+  }
+};
+
+}  // namespace h2
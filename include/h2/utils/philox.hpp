@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * The Philox4x32-10 counter-based random number generator.
+ *
+ * See Salmon et al., "Parallel random numbers: as easy as 1, 2, 3",
+ * SC'11. A counter-based generator is a keyed bijection: each counter
+ * value gives independent random bits, so any element of a random
+ * sequence can be generated directly, in any order, on any device.
+ */
+
+#include "h2/gpu/macros.hpp"
+
+#include <cstdint>
+
+namespace h2
+{
+
+/** Four 32-bit words, the counter and output of `philox4x32_10`. */
+struct Philox4x32Block
+{
+  std::uint32_t v[4];
+};
+
+namespace internal
+{
+
+/** Return the high 32 bits of `a * b`. */
+H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE std::uint32_t
+mulhi32(std::uint32_t a, std::uint32_t b)
+{
+  return static_cast<std::uint32_t>(
+    (static_cast<std::uint64_t>(a) * static_cast<std::uint64_t>(b)) >> 32);
+}
+
+}  // namespace internal
+
+/** Return the Philox4x32-10 random bits for counter `ctr` and `key`. */
+H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE Philox4x32Block
+philox4x32_10(Philox4x32Block ctr, std::uint64_t key)
+{
+  constexpr std::uint32_t M0 = 0xD2511F53;
+  constexpr std::uint32_t M1 = 0xCD9E8D57;
+  constexpr std::uint32_t W0 = 0x9E3779B9;
+  constexpr std::uint32_t W1 = 0xBB67AE85;
+  std::uint32_t k0 = static_cast<std::uint32_t>(key);
+  std::uint32_t k1 = static_cast<std::uint32_t>(key >> 32);
+  for (int round = 0; round < 10; ++round)
+  {
+    if (round > 0)
+    {
+      k0 += W0;
+      k1 += W1;
+    }
+    std::uint32_t const hi0 = internal::mulhi32(M0, ctr.v[0]);
+    std::uint32_t const lo0 = M0 * ctr.v[0];
+    std::uint32_t const hi1 = internal::mulhi32(M1, ctr.v[2]);
+    std::uint32_t const lo1 = M1 * ctr.v[2];
+    ctr = {{hi1 ^ ctr.v[1] ^ k0, lo1, hi0 ^ ctr.v[3] ^ k1, lo0}};
+  }
+  return ctr;
+}
+
+/**
+ * Return the Philox4x32-10 random bits for the 64-bit counter `ctr`,
+ * in stream `subsequence`.
+ */
+H2_GPU_HOST_DEVICE H2_GPU_FORCE_INLINE Philox4x32Block philox4x32_10(
+  std::uint64_t ctr, std::uint64_t key, std::uint64_t subsequence = 0)
+{
+  return philox4x32_10(
+    Philox4x32Block{{static_cast<std::uint32_t>(ctr),
+                     static_cast<std::uint32_t>(ctr >> 32),
+                     static_cast<std::uint32_t>(subsequence),
+                     static_cast<std::uint32_t>(subsequence >> 32)}},
+    key);
+}
+
+}  // namespace h2
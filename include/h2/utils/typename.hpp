@@ -12,6 +12,10 @@
  * Utilities for getting string representations of types.
  */
 
+#include <h2_config.hpp>
+
+#include "h2/core/low_precision.hpp"
+
 #include <string>
 #include <typeinfo>
 
@@ -58,8 +62,20 @@ H2_ADD_TYPENAME(unsigned long long)
 H2_ADD_TYPENAME(float)
 H2_ADD_TYPENAME(double)
 H2_ADD_TYPENAME(long double)
-// TODO: fp16, bf16, etc. when we have them.
 
 #undef H2_ADD_TYPENAME
 
+#if H2_HAS_GPU_LOW_PRECISION
+template <>
+inline std::string TypeName<gpu::Half>()
+{
+  return "fp16";
+}
+template <>
+inline std::string TypeName<gpu::BFloat16>()
+{
+  return "bf16";
+}
+#endif
+
 }  // namespace h2
@@ -0,0 +1,551 @@
+#include "benchmark_common.hpp"
+#include "distconv/runtime_gpu.hpp"
+#include "distconv/tensor/allreduce.hpp"
+#include "distconv/tensor/allreduce_al.hpp"
+#include "distconv/tensor/allreduce_al_hierarchical.hpp"
+#include "distconv/tensor/allreduce_mpi.hpp"
+#include "distconv/tensor/allreduce_mpi_cuda.hpp"
+#include "distconv/tensor/channel_exchange.hpp"
+#include "distconv/tensor/tensor.hpp"
+#include "distconv/tensor/tensor_mpi_cuda.hpp"
+#include "distconv/util/util_gpu.hpp"
+#include "distconv_benchmark_common.hpp"
+#include <distconv_config.hpp>
+#ifdef DISTCONV_HAS_NVSHMEM
+#include "distconv/tensor/allreduce_nvshmem.hpp"
+#include "distconv/util/nvshmem.hpp"
+#endif // DISTCONV_HAS_NVSHMEM
+#include "distconv/util/cxxopts.hpp"
+
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/gpu/runtime.hpp"
+
+#include <Al.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+// Measures the Allreduce implementations and the ChannelExchange
+// reduce-scatter and allgather in isolation, in the style of
+// nccl-tests. The processes are split into groups of each given size,
+// either contiguous or strided ranks, that run the collective
+// concurrently, and every message size from the minimum to the
+// maximum, growing by the step factor, is timed on each. The root
+// prints the time of the slowest process with the algorithm and bus
+// bandwidths, and writes them to <output>.csv and <output>.json.
+//
+// As in nccl-tests, the message size is the size of the buffer of an
+// allreduce, and the size of the gathered buffer (the input of a
+// reduce-scatter and the output of an allgather). The bus bandwidth
+// scales the algorithm bandwidth by 2(n-1)/n for an allreduce and
+// (n-1)/n for the others, so that it is comparable with the link
+// bandwidth independent of the number of processes.
+
+using DataType = float;
+using namespace distconv;
+using AlBackend = Al::NCCLBackend;
+
+namespace distconv_benchmark {
+
+using Tensor = tensor::Tensor<DataType, tensor::LocaleMPI,
+                              tensor::CUDAAllocator>;
+
+struct AllreduceBenchmarkConfig {
+  size_t min_bytes;
+  size_t max_bytes;
+  int step_factor;
+  std::vector<std::string> methods;
+  std::vector<int> comm_sizes;
+  bool strided;
+  int samples;
+  int run_count;
+  int warming_up_count;
+  std::string output_file;
+  RegressionOptions regression;
+};
+
+// Result of one measured configuration.
+struct CollectiveProfile {
+  std::string method;
+  int comm_size;
+  size_t bytes;
+  size_t count;
+  // Times of the slowest process of each run
+  std::vector<float> time;
+};
+
+inline std::vector<std::string> get_all_methods() {
+  return {
+    "AllreduceMPI",
+    "AllreduceMPICUDA",
+    "AllreduceAlNCCL",
+    "AllreduceAlHierarchical",
+#ifdef DISTCONV_HAS_NVSHMEM
+    "AllreduceNVSHMEM",
+    "AllreduceNVSHMEMNATIVE",
+    "AllreduceNVSHMEMRecursiveDoublingHost",
+    "AllreduceNVSHMEMRecursiveDoubling",
+    "AllreduceNVSHMEMRecursiveDoublingBuffered",
+    "AllreduceNVSHMEMRecursiveDoublingBlock",
+    "AllreduceNVSHMEMRing",
+    "AllreduceNVSHMEMTwoTree",
+    "AllreduceNVSHMEMAuto",
+#endif // DISTCONV_HAS_NVSHMEM
+    "ChannelExchangeReduceScatter",
+    "ChannelExchangeAllgather",
+  };
+}
+
+inline bool is_nvshmem_method(const std::string &method) {
+  return method.find("AllreduceNVSHMEM") == 0;
+}
+
+inline bool is_channel_exchange_method(const std::string &method) {
+  return method.find("ChannelExchange") == 0;
+}
+
+// Returns the factor of the bus bandwidth to the algorithm bandwidth.
+inline double get_bus_factor(const std::string &method, int np) {
+  const double f = static_cast<double>(np - 1) / np;
+  return is_channel_exchange_method(method) ? f : 2 * f;
+}
+
+// Parses a size in bytes with an optional K, M, or G suffix.
+inline size_t parse_bytes(const std::string &s) {
+  size_t pos = 0;
+  size_t bytes = std::stoul(s, &pos);
+  if (pos < s.size()) {
+    switch (std::toupper(static_cast<unsigned char>(s[pos]))) {
+      case 'G': bytes <<= 10; // fall through
+      case 'M': bytes <<= 10; // fall through
+      case 'K': bytes <<= 10; break;
+      default:
+        util::MPIRootPrintStreamError() << "Invalid size: " << s;
+        std::abort();
+    }
+  }
+  return bytes;
+}
+
+inline AllreduceBenchmarkConfig process_allreduce_opt(int argc, char *argv[],
+                                                      int pid) {
+  cxxopts::Options cmd_opts(argv[0], "Collective Communication Benchmark");
+  cmd_opts.add_options()
+      ("b,min-bytes", "Minimum message size (with an optional K, M, or G "
+       "suffix)", cxxopts::value<std::string>()->default_value("1K"))
+      ("e,max-bytes", "Maximum message size",
+       cxxopts::value<std::string>()->default_value("64M"))
+      ("f,step-factor", "Multiplication factor between message sizes",
+       cxxopts::value<int>()->default_value("2"))
+      ("methods", "Comma-separated methods. AllreduceMPI requires an MPI "
+       "with GPU support and the AllreduceNVSHMEM methods run only on "
+       "all of the processes",
+       cxxopts::value<std::string>()->default_value(
+           util::join_array(get_all_methods(), ",")))
+      ("comm-sizes", "Comma-separated numbers of processes in each "
+       "communicator (default: all of the processes)",
+       cxxopts::value<std::string>()->default_value(""))
+      ("strided", "Group strided ranks instead of contiguous ones")
+      ("n,num-samples", "Number of local samples of the ChannelExchange "
+       "tensors, which pack their channels when larger than one",
+       cxxopts::value<int>()->default_value("1"))
+      ("r,num-runs", "Number of runs",
+       cxxopts::value<int>()->default_value("20"))
+      ("num-warmup-runs", "Number of warming-up runs",
+       cxxopts::value<int>()->default_value("5"))
+      ("o,output-file", "Prefix of the result files",
+       cxxopts::value<std::string>()->default_value("allreduce"))
+      ("help", "Print help")
+      ;
+  add_regression_options(cmd_opts);
+  auto result = cmd_opts.parse(argc, argv);
+  if (result.count("help")) {
+    if (pid == 0) {
+      std::cout << cmd_opts.help() << "\n";
+    }
+    DISTCONV_CHECK_MPI(MPI_Finalize());
+    exit(0);
+  }
+
+  AllreduceBenchmarkConfig cfg;
+  cfg.min_bytes = parse_bytes(result["min-bytes"].as<std::string>());
+  cfg.max_bytes = parse_bytes(result["max-bytes"].as<std::string>());
+  cfg.step_factor = result["step-factor"].as<int>();
+  assert_always(cfg.min_bytes > 0 && cfg.min_bytes <= cfg.max_bytes);
+  assert_always(cfg.step_factor > 1);
+  cfg.methods = util::split(result["methods"].as<std::string>(), ',');
+  for (const auto &m: cfg.methods) {
+    const auto all_methods = get_all_methods();
+    if (std::find(all_methods.begin(), all_methods.end(), m) ==
+        all_methods.end()) {
+      util::MPIRootPrintStreamError() << "Unknown method: " << m;
+      std::abort();
+    }
+  }
+  const auto comm_sizes = result["comm-sizes"].as<std::string>();
+  if (!comm_sizes.empty()) {
+    cfg.comm_sizes = util::split_spaced_array<int>(comm_sizes);
+  }
+  cfg.strided = result.count("strided") > 0;
+  cfg.samples = result["num-samples"].as<int>();
+  cfg.run_count = result["num-runs"].as<int>();
+  cfg.warming_up_count = result["num-warmup-runs"].as<int>();
+  cfg.output_file = result["output-file"].as<std::string>();
+  cfg.regression = parse_regression_options(result);
+  return cfg;
+}
+
+std::unique_ptr<tensor::Allreduce<DataType>>
+make_allreducer(const std::string &name, MPI_Comm comm,
+                const std::shared_ptr<AlBackend::comm_type> &al_comm,
+                h2::gpu::DeviceStream stream) {
+#ifdef DISTCONV_HAS_NVSHMEM
+  using AllreduceNVSHMEM = tensor::AllreduceNVSHMEM<DataType>;
+#endif // DISTCONV_HAS_NVSHMEM
+  if (name == "AllreduceMPI") {
+    return std::make_unique<tensor::AllreduceMPI<DataType>>(comm);
+  } else if (name == "AllreduceMPICUDA") {
+    return std::make_unique<tensor::AllreduceMPICUDA<DataType>>(comm,
+                                                                stream);
+  } else if (name == "AllreduceAlNCCL") {
+    return std::make_unique<tensor::AllreduceAlNCCL<DataType>>(al_comm);
+  } else if (name == "AllreduceAlHierarchical") {
+    return std::make_unique<tensor::AllreduceAlHierarchical<DataType>>(
+        comm, stream);
+#ifdef DISTCONV_HAS_NVSHMEM
+  } else if (name == "AllreduceNVSHMEM") {
+    return std::make_unique<AllreduceNVSHMEM>(stream,
+                                              AllreduceNVSHMEM::NAIVE);
+  } else if (name == "AllreduceNVSHMEMNATIVE") {
+    return std::make_unique<AllreduceNVSHMEM>(stream,
+                                              AllreduceNVSHMEM::NATIVE);
+  } else if (name == "AllreduceNVSHMEMRecursiveDoublingHost") {
+    return std::make_unique<AllreduceNVSHMEM>(
+        stream, AllreduceNVSHMEM::RECURSIVE_DOUBLING_HOST);
+  } else if (name == "AllreduceNVSHMEMRecursiveDoubling") {
+    return std::make_unique<AllreduceNVSHMEM>(
+        stream, AllreduceNVSHMEM::RECURSIVE_DOUBLING);
+  } else if (name == "AllreduceNVSHMEMRecursiveDoublingBuffered") {
+    return std::make_unique<AllreduceNVSHMEM>(
+        stream, AllreduceNVSHMEM::RECURSIVE_DOUBLING_BUFFERED);
+  } else if (name == "AllreduceNVSHMEMRecursiveDoublingBlock") {
+    return std::make_unique<AllreduceNVSHMEM>(
+        stream, AllreduceNVSHMEM::RECURSIVE_DOUBLING_BLOCK);
+  } else if (name == "AllreduceNVSHMEMRing") {
+    return std::make_unique<AllreduceNVSHMEM>(stream,
+                                              AllreduceNVSHMEM::RING);
+  } else if (name == "AllreduceNVSHMEMTwoTree") {
+    return std::make_unique<AllreduceNVSHMEM>(stream,
+                                              AllreduceNVSHMEM::TWO_TREE);
+  } else if (name == "AllreduceNVSHMEMAuto") {
+    return std::make_unique<AllreduceNVSHMEM>(stream,
+                                              AllreduceNVSHMEM::AUTO);
+#endif // DISTCONV_HAS_NVSHMEM
+  }
+  util::MPIRootPrintStreamError() << "Unknown allreduce method: " << name;
+  std::abort();
+}
+
+// Device buffers of the allreduces, which the NVSHMEM algorithms
+// require to be symmetric.
+struct AllreduceBuffers {
+  bool nvshmem;
+  DataType *send = nullptr;
+  DataType *recv = nullptr;
+
+  AllreduceBuffers(bool nvshmem, size_t count): nvshmem(nvshmem) {
+    const size_t bytes = sizeof(DataType) * count;
+    if (nvshmem) {
+#ifdef DISTCONV_HAS_NVSHMEM
+      util::nvshmem::barrier();
+      send = static_cast<DataType*>(nvshmem_malloc(bytes));
+      recv = static_cast<DataType*>(nvshmem_malloc(bytes));
+      util::nvshmem::barrier();
+#endif // DISTCONV_HAS_NVSHMEM
+    } else {
+      DISTCONV_CHECK_GPU(GPU_MALLOC(&send, bytes));
+      DISTCONV_CHECK_GPU(GPU_MALLOC(&recv, bytes));
+    }
+    h2::gpu::mem_zero(send, count);
+  }
+
+  ~AllreduceBuffers() {
+    if (nvshmem) {
+#ifdef DISTCONV_HAS_NVSHMEM
+      util::nvshmem::barrier();
+      nvshmem_free(send);
+      nvshmem_free(recv);
+      util::nvshmem::barrier();
+#endif // DISTCONV_HAS_NVSHMEM
+    } else {
+      DISTCONV_CHECK_GPU(GPU_FREE(send));
+      DISTCONV_CHECK_GPU(GPU_FREE(recv));
+    }
+  }
+};
+
+// Times run on the stream and returns the time of the slowest
+// process of comm in each run.
+template <typename Run>
+std::vector<float> time_runs(const AllreduceBenchmarkConfig &cfg, Run &&run,
+                             h2::gpu::DeviceStream stream, MPI_Comm comm) {
+  for (int i = 0; i < cfg.warming_up_count; ++i) {
+    run();
+  }
+  std::vector<util::Clock> clks(cfg.run_count, stream);
+  for (int i = 0; i < cfg.run_count; ++i) {
+    h2::gpu::sync();
+    DISTCONV_CHECK_MPI(MPI_Barrier(comm));
+    clks[i].start();
+    run();
+    clks[i].stop();
+  }
+  h2::gpu::sync();
+  std::vector<float> times(cfg.run_count);
+  for (int i = 0; i < cfg.run_count; ++i) {
+    times[i] = clks[i].get_time();
+  }
+  DISTCONV_CHECK_MPI(MPI_Allreduce(MPI_IN_PLACE, times.data(), times.size(),
+                                   MPI_FLOAT, MPI_MAX, comm));
+  return times;
+}
+
+void measure_allreduce(const AllreduceBenchmarkConfig &cfg,
+                       const std::string &method,
+                       const tensor::LocaleMPI &locale,
+                       const std::shared_ptr<AlBackend::comm_type> &al_comm,
+                       h2::gpu::DeviceStream stream,
+                       std::vector<CollectiveProfile> &profs) {
+  auto allreducer = make_allreducer(method, locale.get_comm(), al_comm,
+                                    stream);
+  const size_t max_count = cfg.max_bytes / sizeof(DataType);
+  AllreduceBuffers bufs(is_nvshmem_method(method), max_count);
+  for (size_t bytes = cfg.min_bytes; bytes <= cfg.max_bytes;
+       bytes *= cfg.step_factor) {
+    const size_t count = std::max(bytes / sizeof(DataType), (size_t)1);
+    CollectiveProfile prof{method, locale.get_size(),
+                           count * sizeof(DataType), count, {}};
+    prof.time = time_runs(
+        cfg, [&]() { allreducer->allreduce(bufs.send, bufs.recv, count); },
+        stream, MPI_COMM_WORLD);
+    profs.push_back(prof);
+  }
+}
+
+void measure_channel_exchange(const AllreduceBenchmarkConfig &cfg,
+                              const std::string &method,
+                              const tensor::LocaleMPI &locale,
+                              AlBackend::comm_type &al_comm,
+                              h2::gpu::DeviceStream stream,
+                              std::vector<CollectiveProfile> &profs) {
+  const int np = locale.get_size();
+  const bool allgather = method == "ChannelExchangeAllgather";
+  tensor::ChannelExchange<DataType> xch;
+  // Tensors of one channel per process and samples that are not
+  // split, with the width set by the message size. The gathered
+  // tensor has all of the channels on every process.
+  tensor::Shape proc_shape(4, 1);
+  proc_shape[-2] = np;
+  const size_t unit = sizeof(DataType) * np * cfg.samples;
+  for (size_t bytes = cfg.min_bytes; bytes <= cfg.max_bytes;
+       bytes *= cfg.step_factor) {
+    tensor::Shape shape(4, 1);
+    shape[0] = std::max(bytes / unit, (size_t)1);
+    shape[-2] = np;
+    shape[-1] = cfg.samples;
+    Tensor split(shape, locale,
+                 tensor::Distribution::make_distribution(proc_shape));
+    auto gathered_local_shape = split.get_local_shape();
+    gathered_local_shape[-2] = np;
+    Tensor gathered(shape, locale,
+                    tensor::Distribution::make_shared_distribution(
+                        proc_shape),
+                    gathered_local_shape, tensor::Shape(4, 0));
+    assert0(split.allocate());
+    assert0(gathered.allocate());
+    split.zero(stream);
+    gathered.zero(stream);
+    CollectiveProfile prof{method, np, gathered.get_local_size() *
+                           sizeof(DataType), gathered.get_local_size(), {}};
+    prof.time = time_runs(
+        cfg,
+        [&]() {
+          if (allgather) {
+            xch.allgather(split, gathered, al_comm, stream);
+          } else {
+            xch.reduce_scatter(gathered, split, al_comm, stream);
+          }
+        },
+        stream, MPI_COMM_WORLD);
+    profs.push_back(prof);
+  }
+}
+
+// Times the methods on communicators of comm_size processes.
+void measure(const AllreduceBenchmarkConfig &cfg, int comm_size, int pid,
+             int np, std::vector<CollectiveProfile> &profs) {
+  const int num_groups = np / comm_size;
+  const int color = cfg.strided ? pid % num_groups : pid / comm_size;
+  MPI_Comm comm;
+  DISTCONV_CHECK_MPI(MPI_Comm_split(MPI_COMM_WORLD, color, pid, &comm));
+  // The locale frees comm.
+  tensor::LocaleMPI locale(comm);
+  auto stream = h2::gpu::make_stream();
+  auto al_comm = std::make_shared<AlBackend::comm_type>(comm, stream);
+
+  for (const auto &method: cfg.methods) {
+    if (is_nvshmem_method(method) && comm_size != np) {
+      util::MPIRootPrintStreamInfo()
+          << "Skipping " << method << " with " << comm_size
+          << " processes as it only runs on all of the processes";
+      continue;
+    }
+    util::MPIRootPrintStreamInfo()
+        << "Measuring " << method << " on " << num_groups << " "
+        << (cfg.strided ? "strided" : "contiguous") << " groups of "
+        << comm_size << " processes";
+    if (is_channel_exchange_method(method)) {
+      measure_channel_exchange(cfg, method, locale, *al_comm, stream, profs);
+    } else {
+      measure_allreduce(cfg, method, locale, al_comm, stream, profs);
+    }
+  }
+
+  al_comm.reset();
+  h2::gpu::destroy(stream);
+  DISTCONV_CHECK_MPI(MPI_Barrier(MPI_COMM_WORLD));
+}
+
+// Bandwidth in GB/s of moving `bytes` in `ms` milliseconds.
+inline double get_bandwidth(size_t bytes, float ms) {
+  return ms > 0 ? bytes / (ms * 1e6) : 0;
+}
+
+void dump_profs(const std::vector<CollectiveProfile> &profs,
+                const AllreduceBenchmarkConfig &cfg, int pid) {
+  if (pid != 0) return;
+  std::ofstream csv(cfg.output_file + ".csv");
+  csv << "method,comm_size,grouping,bytes,count,min,mean,max,algbw,busbw\n";
+  std::ofstream json(cfg.output_file + ".json");
+  json << "[\n";
+  const char *grouping = cfg.strided ? "strided" : "contiguous";
+  const std::string *last_method = nullptr;
+  int last_comm_size = 0;
+  for (size_t i = 0; i < profs.size(); ++i) {
+    const auto &p = profs[i];
+    const float mean = get_mean(p.time);
+    const double algbw = get_bandwidth(p.bytes, mean);
+    const double busbw = algbw * get_bus_factor(p.method, p.comm_size);
+    csv << p.method << "," << p.comm_size << "," << grouping << ","
+        << p.bytes << "," << p.count << "," << get_min(p.time) << ","
+        << mean << "," << get_max(p.time) << "," << algbw << "," << busbw
+        << "\n";
+    json << "  {\"method\": \"" << p.method << "\""
+         << ", \"comm_size\": " << p.comm_size
+         << ", \"grouping\": \"" << grouping << "\""
+         << ", \"bytes\": " << p.bytes
+         << ", \"count\": " << p.count
+         << ", \"time_ms\": {\"min\": " << get_min(p.time)
+         << ", \"mean\": " << mean
+         << ", \"max\": " << get_max(p.time) << "}"
+         << ", \"algbw_gbps\": " << algbw
+         << ", \"busbw_gbps\": " << busbw << "}"
+         << (i + 1 < profs.size() ? "," : "") << "\n";
+    if (last_method == nullptr || *last_method != p.method ||
+        last_comm_size != p.comm_size) {
+      std::cout << "\n# " << p.method << ", " << p.comm_size
+                << " processes per communicator\n"
+                << "#" << std::setw(13) << "size" << std::setw(13)
+                << "count" << std::setw(11) << "time" << std::setw(9)
+                << "algbw" << std::setw(9) << "busbw" << "\n"
+                << "#" << std::setw(13) << "(B)" << std::setw(13)
+                << "(elements)" << std::setw(11) << "(us)" << std::setw(9)
+                << "(GB/s)" << std::setw(9) << "(GB/s)" << "\n";
+      last_method = &p.method;
+      last_comm_size = p.comm_size;
+    }
+    std::cout << std::setw(14) << p.bytes << std::setw(13) << p.count
+              << std::fixed << std::setw(11) << std::setprecision(1)
+              << mean * 1e3 << std::setw(9) << std::setprecision(2) << algbw
+              << std::setw(9) << busbw << std::defaultfloat
+              << std::setprecision(6) << "\n";
+  }
+  json << "]\n";
+  std::cout << std::endl;
+}
+
+// Compares the results with the baseline and returns the number of
+// regressions.
+int track_profs(const std::vector<CollectiveProfile> &profs,
+                const AllreduceBenchmarkConfig &cfg, MPI_Comm comm) {
+  RegressionTracker tracker(cfg.regression, comm);
+  for (const auto &p: profs) {
+    std::stringstream ss;
+    ss << "collective " << p.method << " comm " << p.comm_size
+       << (cfg.strided ? " strided" : " contiguous") << " bytes "
+       << p.bytes;
+    tracker.add(ss.str(), p.time);
+  }
+  return tracker.finish();
+}
+
+int run(int argc, char *argv[], int pid, int np) {
+  auto cfg = process_allreduce_opt(argc, argv, pid);
+  if (cfg.comm_sizes.empty()) {
+    cfg.comm_sizes.push_back(np);
+  }
+
+#ifdef DISTCONV_HAS_NVSHMEM
+  const bool use_nvshmem = std::any_of(
+      cfg.methods.begin(), cfg.methods.end(), is_nvshmem_method);
+  if (use_nvshmem) {
+    util::nvshmem::initialize(MPI_COMM_WORLD);
+  }
+#endif // DISTCONV_HAS_NVSHMEM
+
+  std::vector<CollectiveProfile> profs;
+  for (auto comm_size: cfg.comm_sizes) {
+    if (comm_size < 1 || np % comm_size) {
+      util::MPIRootPrintStreamInfo()
+          << "Skipping communicator size " << comm_size
+          << " that does not divide " << np;
+      continue;
+    }
+    measure(cfg, comm_size, pid, np, profs);
+  }
+
+  dump_profs(profs, cfg, pid);
+  const int num_regressions = cfg.regression.enabled() ?
+      track_profs(profs, cfg, MPI_COMM_WORLD) : 0;
+
+#ifdef DISTCONV_HAS_NVSHMEM
+  if (use_nvshmem) {
+    util::nvshmem::finalize();
+  }
+#endif // DISTCONV_HAS_NVSHMEM
+
+  util::MPIRootPrintStreamInfo() << "Completed";
+  return num_regressions;
+}
+
+} // namespace distconv_benchmark
+
+int main(int argc, char *argv[]) {
+  distconv_benchmark::set_device();
+  int pid;
+  int np;
+  Al::Initialize(argc, argv);
+  DISTCONV_CHECK_MPI(MPI_Comm_rank(MPI_COMM_WORLD, &pid));
+  DISTCONV_CHECK_MPI(MPI_Comm_size(MPI_COMM_WORLD, &np));
+
+  const int num_regressions = distconv_benchmark::run(argc, argv, pid, np);
+
+  Al::Finalize();
+  return num_regressions > 0 ? 1 : 0;
+}
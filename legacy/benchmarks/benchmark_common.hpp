@@ -1,10 +1,12 @@
 #pragma once
 
+#include "benchmark_regression.hpp"
 #include "distconv/base.hpp"
 #include "distconv/ref/backend.hpp"
 #include "distconv/tensor/tensor_base.hpp"
 #include "distconv/util/cxxopts.hpp"
 #include "distconv/vector.hpp"
+#include "h2/core/low_precision.hpp"
 
 #include <algorithm>
 #include <cstdlib>
@@ -18,7 +20,13 @@ using distconv::IndexVector;
 using distconv::tensor::Shape;
 using distconv::int_vector;
 
-enum class BenchmarkDataType {FLOAT, DOUBLE, HALF};
+enum class BenchmarkDataType {FLOAT, DOUBLE, HALF, BFLOAT16};
+
+// 16-bit types are only supported by the GPU backends
+inline bool is_low_precision(BenchmarkDataType type) {
+  return type == BenchmarkDataType::HALF ||
+      type == BenchmarkDataType::BFLOAT16;
+}
 
 template <BenchmarkDataType type>
 struct GetType;
@@ -33,12 +41,17 @@ struct GetType<BenchmarkDataType::DOUBLE> {
   using type = double;
 };
 
-#if H2_HAS_HALF
+#if H2_HAS_GPU_LOW_PRECISION
 template <>
 struct GetType<BenchmarkDataType::HALF> {
-  using type = half;
+  using type = h2::gpu::Half;
 };
-#endif // H2_HAS_HALF
+
+template <>
+struct GetType<BenchmarkDataType::BFLOAT16> {
+  using type = h2::gpu::BFloat16;
+};
+#endif // H2_HAS_GPU_LOW_PRECISION
 
 const unsigned input_tensor_seed = 0;
 const unsigned filter_tensor_seed = 1;
@@ -183,6 +196,8 @@ class BenchmarkConfig {
 
   bool deconv;
 
+  RegressionOptions regression;
+
   // Some initial values are intended to be rewritten by corresponding
   // default/user-given arguments in `cxxopts::ParseResult`.
   BenchmarkConfig(): i_n(-1), i_c(-1), i_s({}),
@@ -331,6 +346,8 @@ class BenchmarkConfig {
         data_type = BenchmarkDataType::DOUBLE;
       } else if (type_name == "half") {
         data_type = BenchmarkDataType::HALF;
+      } else if (type_name == "bfloat16") {
+        data_type = BenchmarkDataType::BFLOAT16;
       } else {
         std::cerr << "Unknown data type\n";
         abort();
@@ -339,6 +356,10 @@ class BenchmarkConfig {
     if (pr.count("profile") > 0) {
       profiling = pr["profile"].as<bool>();
     }
+    // The backends enable profiling with the environment variable too
+    if (std::getenv("DISTCONV_ENABLE_PROFILING")) {
+      profiling = true;
+    }
     if (pr.count("nvtx") > 0) {
       nvtx_marking = pr["nvtx"].as<bool>();
     }
@@ -354,7 +375,7 @@ class BenchmarkConfig {
       pads = int_vector(NSD, 0);
     }
     if (backend == "Ref") {
-      assert_always(data_type != BenchmarkDataType::HALF);
+      assert_always(!is_low_precision(data_type));
     }
     if (pr.count("overlap") > 0) {
       overlap_halo_exchange = pr["overlap"].as<bool>();
@@ -389,6 +410,7 @@ class BenchmarkConfig {
     if (pr.count("deconv") > 0) {
       deconv = true;
     }
+    regression = parse_regression_options(pr);
 
     assert_num_spatial_dims();
   }
@@ -543,7 +565,7 @@ inline BenchmarkConfig<NSD> process_opt(int argc, char *argv[], int pid,
       ("k,conv-bwd-filter-algo", "Convolution bwd filter algorithm", cxxopts::value<std::string>()->default_value("DEFAULT"))
       ("pooling-mode", "Pooling mode", cxxopts::value<std::string>()->default_value("MAX"))
       ("b,backend", "Convolution backend", cxxopts::value<std::string>()->default_value("CUDNN"))
-      ("data-type", "Data type", cxxopts::value<std::string>()->default_value("float"))
+      ("data-type", "Data type (float, double, half, or bfloat16)", cxxopts::value<std::string>()->default_value("float"))
       ("mode", "Test mode", cxxopts::value<std::string>()->default_value("NORMAL"))
       ("halo-exchange-method", "Halo exchange method", cxxopts::value<std::string>()->default_value("AL"))
       ("shuffle-method", "Shuffle method", cxxopts::value<std::string>()->default_value("AL"))
@@ -555,7 +577,8 @@ inline BenchmarkConfig<NSD> process_opt(int argc, char *argv[], int pid,
       ("d,dump-output", "Dump output tensors")
       ("dump", "Dump input and output tensors")
       ("dump-binary", "Dump tensor in a binary format")
-      ("profile", "Enable detailed profiling")
+      ("profile", "Enable detailed profiling, writing the times of the "
+       "convolution phases to <output-file>_phases.json")
       ("nvtx", "Enable NVTX-based region marking")
       ("overlap", "Overlap halo exchanges")
       ("deterministic", "Use deterministic algoirthms")
@@ -571,6 +594,7 @@ inline BenchmarkConfig<NSD> process_opt(int argc, char *argv[], int pid,
       ("deconv", "Runs deconvolutions instead of normal convolutions")
       ("help", "Print help")
       ;
+  add_regression_options(cmd_opts);
   auto result = cmd_opts.parse(argc, argv);
   if (result.count("help")) {
     if (pid == 0) {
@@ -0,0 +1,277 @@
+#pragma once
+
+#include "distconv/util/cxxopts.hpp"
+#include "distconv/util/util.hpp"
+#include "distconv/util/util_mpi.hpp"
+
+#include <mpi.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Performance regression tracking against a baseline file.
+//
+// Each benchmark adds its time samples (one per measured run, the
+// slowest rank's time of each run) under a name that identifies the
+// configuration. Their mean and standard deviation are compared with
+// those stored in the baseline for the same machine and number of
+// processes, and a result is a regression when it is both slower than
+// the baseline by more than a threshold and significantly so by a
+// one-sided Welch's t-test. Benchmarks exit with a nonzero status if
+// there are regressions.
+//
+// The baseline is a text file with one tab-separated line per result:
+//   <machine>/<np>  <name>  <num samples>  <mean>  <standard deviation>
+// Results of other machines are kept when it is updated.
+
+namespace distconv_benchmark {
+
+struct RegressionOptions {
+  // Baseline to compare with; regression tracking is disabled if empty.
+  std::string baseline_file;
+  // Write the results to the baseline (replacing the results of the
+  // same machine and names) instead of only comparing.
+  bool update_baseline = false;
+  // Key of the machine in the baseline file.
+  std::string machine;
+  // Minimum relative slowdown reported as a regression.
+  double threshold = 0.05;
+  // Confidence level of the t-tests and intervals.
+  double confidence = 0.95;
+
+  bool enabled() const { return !baseline_file.empty(); }
+};
+
+// Returns the name of the machine from DISTCONV_BENCHMARK_MACHINE if
+// set, and otherwise the host name without trailing digits, so that
+// nodes of a cluster (e.g., "lassen12" and "lassen7") share baselines.
+inline std::string get_machine_name() {
+  if (const char *env = std::getenv("DISTCONV_BENCHMARK_MACHINE")) {
+    return env;
+  }
+  char hostname[256] = {0};
+  if (gethostname(hostname, sizeof(hostname) - 1) != 0) {
+    return "unknown";
+  }
+  std::string name(hostname);
+  name = name.substr(0, name.find('.'));
+  while (!name.empty() &&
+         std::isdigit(static_cast<unsigned char>(name.back()))) {
+    name.pop_back();
+  }
+  return name.empty() ? "unknown" : name;
+}
+
+inline void add_regression_options(cxxopts::Options &cmd_opts) {
+  cmd_opts.add_options("Regression tracking")
+      ("baseline-file", "Compare the results with this baseline and exit "
+       "with a nonzero status if there are regressions",
+       cxxopts::value<std::string>()->default_value(""))
+      ("update-baseline", "Store the results in the baseline file")
+      ("machine", "Machine name in the baseline file (default: "
+       "DISTCONV_BENCHMARK_MACHINE or the host name without digits)",
+       cxxopts::value<std::string>()->default_value(""))
+      ("regression-threshold", "Minimum relative slowdown to report",
+       cxxopts::value<double>()->default_value("0.05"))
+      ("confidence", "Confidence level of the regression tests",
+       cxxopts::value<double>()->default_value("0.95"))
+      ;
+}
+
+inline RegressionOptions parse_regression_options(
+    const cxxopts::ParseResult &pr) {
+  RegressionOptions opts;
+  opts.baseline_file = pr["baseline-file"].as<std::string>();
+  opts.update_baseline = pr.count("update-baseline") > 0;
+  opts.machine = pr["machine"].as<std::string>();
+  if (opts.machine.empty()) {
+    opts.machine = get_machine_name();
+  }
+  opts.threshold = pr["regression-threshold"].as<double>();
+  opts.confidence = pr["confidence"].as<double>();
+  assert_always(opts.confidence > 0.5 && opts.confidence < 1);
+  return opts;
+}
+
+struct SampleStats {
+  int n = 0;
+  double mean = 0;
+  double stddev = 0;
+};
+
+template <typename T>
+inline SampleStats get_sample_stats(const std::vector<T> &v) {
+  SampleStats s;
+  s.n = v.size();
+  if (s.n == 0) return s;
+  for (auto x: v) s.mean += x;
+  s.mean /= s.n;
+  if (s.n > 1) {
+    double ss = 0;
+    for (auto x: v) ss += (x - s.mean) * (x - s.mean);
+    s.stddev = std::sqrt(ss / (s.n - 1));
+  }
+  return s;
+}
+
+// Returns the p-quantile of the standard normal distribution (p in
+// [0.5, 1)), with the approximation of Abramowitz and Stegun 26.2.23
+// (absolute error below 4.5e-4).
+inline double get_normal_quantile(double p) {
+  const double t = std::sqrt(-2 * std::log(1 - p));
+  return t - (2.515517 + 0.802853 * t + 0.010328 * t * t) /
+      (1 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t);
+}
+
+// Returns the p-quantile of Student's t-distribution with dof degrees
+// of freedom (p in [0.5, 1)), with the Cornish-Fisher expansion around
+// the normal quantile, which is accurate to about 1% for dof >= 3.
+inline double get_t_quantile(double p, double dof) {
+  const double z = get_normal_quantile(p);
+  const double z3 = z * z * z;
+  const double z5 = z3 * z * z;
+  const double z7 = z5 * z * z;
+  return z + (z3 + z) / (4 * dof) +
+      (5 * z5 + 16 * z3 + 3 * z) / (96 * dof * dof) +
+      (3 * z7 + 19 * z5 + 17 * z3 - 15 * z) / (384 * dof * dof * dof);
+}
+
+class RegressionTracker {
+ public:
+  RegressionTracker(const RegressionOptions &opts, MPI_Comm comm):
+      m_opts(opts), m_comm(comm) {
+    int np;
+    DISTCONV_CHECK_MPI(MPI_Comm_rank(m_comm, &m_pid));
+    DISTCONV_CHECK_MPI(MPI_Comm_size(m_comm, &np));
+    m_machine = m_opts.machine + "/" + std::to_string(np);
+  }
+
+  // Adds the times of the runs of a benchmark on this rank. This is
+  // collective over the communicator, and every rank must have the
+  // same number of runs.
+  void add(const std::string &name, const std::vector<float> &times) {
+    std::vector<float> max_times(times.size());
+    DISTCONV_CHECK_MPI(MPI_Allreduce(times.data(), max_times.data(),
+                                     times.size(), MPI_FLOAT, MPI_MAX,
+                                     m_comm));
+    m_results.emplace_back(name, get_sample_stats(max_times));
+  }
+
+  // Compares the results with the baseline and updates it if
+  // requested. Returns the number of regressions on every rank.
+  int finish() {
+    int num_regressions = 0;
+    if (m_pid == 0) {
+      auto baseline = read_baseline();
+      num_regressions = compare(baseline);
+      if (m_opts.update_baseline) {
+        for (const auto &r: m_results) {
+          baseline[{m_machine, r.first}] = r.second;
+        }
+        write_baseline(baseline);
+      }
+    }
+    DISTCONV_CHECK_MPI(MPI_Bcast(&num_regressions, 1, MPI_INT, 0, m_comm));
+    return num_regressions;
+  }
+
+ private:
+  using Baseline = std::map<std::pair<std::string, std::string>, SampleStats>;
+
+  RegressionOptions m_opts;
+  MPI_Comm m_comm;
+  int m_pid;
+  std::string m_machine;
+  std::vector<std::pair<std::string, SampleStats>> m_results;
+
+  Baseline read_baseline() const {
+    Baseline baseline;
+    std::ifstream ifs(m_opts.baseline_file);
+    std::string line;
+    while (std::getline(ifs, line)) {
+      std::istringstream iss(line);
+      std::string machine, name;
+      SampleStats s;
+      if (std::getline(iss, machine, '\t') && std::getline(iss, name, '\t') &&
+          iss >> s.n >> s.mean >> s.stddev) {
+        baseline[{machine, name}] = s;
+      }
+    }
+    return baseline;
+  }
+
+  void write_baseline(const Baseline &baseline) const {
+    std::ofstream ofs(m_opts.baseline_file);
+    ofs << std::setprecision(9);
+    for (const auto &b: baseline) {
+      ofs << b.first.first << "\t" << b.first.second << "\t" << b.second.n
+          << "\t" << b.second.mean << "\t" << b.second.stddev << "\n";
+    }
+    assert_always(ofs.good());
+    std::cout << "Updated " << baseline.size() << " results in "
+              << m_opts.baseline_file << " for " << m_machine << "\n";
+  }
+
+  int compare(const Baseline &baseline) const {
+    int num_regressions = 0;
+    int num_compared = 0;
+    std::cout << "Comparing with " << m_opts.baseline_file << " for "
+              << m_machine << " (threshold " << m_opts.threshold * 100
+              << "%, confidence " << m_opts.confidence * 100 << "%)\n";
+    for (const auto &r: m_results) {
+      const auto &name = r.first;
+      const auto &cur = r.second;
+      auto it = baseline.find({m_machine, name});
+      if (it == baseline.end()) {
+        std::cout << "  NEW        " << name << ": " << cur.mean << " ms\n";
+        continue;
+      }
+      const auto &base = it->second;
+      ++num_compared;
+      const double diff = cur.mean - base.mean;
+      // Welch's t-test of the difference of the means.
+      const double v_cur = cur.n > 0 ? cur.stddev * cur.stddev / cur.n : 0;
+      const double v_base =
+          base.n > 0 ? base.stddev * base.stddev / base.n : 0;
+      const double se = std::sqrt(v_cur + v_base);
+      double dof = 1;
+      if (cur.n > 1 && base.n > 1 && se > 0) {
+        dof = (v_cur + v_base) * (v_cur + v_base) /
+            (v_cur * v_cur / (cur.n - 1) + v_base * v_base / (base.n - 1));
+      }
+      const double t = get_t_quantile(m_opts.confidence, std::max(dof, 1.0));
+      // Two-sided interval of the difference at the confidence level.
+      const double half_width =
+          se * get_t_quantile((1 + m_opts.confidence) / 2, std::max(dof, 1.0));
+      const bool significant = se > 0 ? diff / se > t : diff > 0;
+      const bool regressed =
+          significant && diff > m_opts.threshold * base.mean;
+      const bool improved = se > 0 ? -diff / se > t : diff < 0;
+      const char *status = regressed ? "REGRESSION" :
+          (improved && -diff > m_opts.threshold * base.mean) ? "IMPROVED  " :
+          "OK        ";
+      std::cout << "  " << status << " " << name << ": " << cur.mean
+                << " ms vs. " << base.mean << " ms ("
+                << std::showpos << diff / base.mean * 100 << std::noshowpos
+                << "%, difference " << diff << " +/- " << half_width
+                << " ms)\n";
+      if (regressed) ++num_regressions;
+    }
+    std::cout << num_regressions << " regressions in " << num_compared
+              << " results compared with the baseline\n";
+    return num_regressions;
+  }
+};
+
+} // namespace distconv_benchmark
@@ -205,6 +205,8 @@ class Opts {
         data_type = BenchmarkDataType::DOUBLE;
       } else if (type_name == "half") {
         data_type = BenchmarkDataType::HALF;
+      } else if (type_name == "bfloat16") {
+        data_type = BenchmarkDataType::BFLOAT16;
       } else {
         std::cerr << "Unknown data type\n";
         abort();
@@ -455,7 +457,8 @@ Opts process_opt(int argc, char *argv[]) {
       ("dump-output", "Dump output tensors")
       ("dump", "Dump input and output tensors")
       ("dump-binary", "Dump binary tensors")
-      ("data-type", "Data type", cxxopts::value<std::string>())
+      ("data-type", "Data type (float, double, half, or bfloat16)",
+       cxxopts::value<std::string>())
       ("help", "Print help")
       ;
   auto result = cmd_opts.parse(argc, argv);
@@ -994,11 +997,15 @@ void run(int argc, char *argv[]) {
     run<NSD, float>(cfg);
   } else if (cfg.data_type == BenchmarkDataType::DOUBLE) {
     run<NSD, double>(cfg);
-  } else if (cfg.data_type == BenchmarkDataType::HALF) {
-#ifdef DISTCONV_ENABLE_FP16
-    run<NSD, half>(cfg);
+  } else if (distconv_benchmark::is_low_precision(cfg.data_type)) {
+#if H2_HAS_GPU_LOW_PRECISION
+    if (cfg.data_type == BenchmarkDataType::HALF) {
+      run<NSD, h2::gpu::Half>(cfg);
+    } else {
+      run<NSD, h2::gpu::BFloat16>(cfg);
+    }
 #else
-    std::cerr << "Error: half precision not supported\n";
+    std::cerr << "Error: half and bfloat16 precision not supported\n";
     abort();
 #endif
   } else {
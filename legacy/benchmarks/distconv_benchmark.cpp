@@ -69,6 +69,14 @@ class Profile {
     return os;
   }
 
+  void track(RegressionTracker &tracker, const std::string &prefix) const {
+    tracker.add(prefix + " conv fwd", conv_fwd_time);
+    tracker.add(prefix + " conv bwd data", conv_bwd_data_time);
+    tracker.add(prefix + " conv bwd filter", conv_bwd_filter_time);
+    tracker.add(prefix + " conv bwd bias", conv_bwd_bias_time);
+    tracker.add(prefix + " conv bwd combined", conv_bwd_combined_all_time);
+  }
+
   void print_summary(std::ostream &os) {
     std::cout << "Forward mean: " << get_mean(conv_fwd_time)
               << ", median: " << get_median(conv_fwd_time)
@@ -319,7 +327,7 @@ int test_convolution_forward(Data<NSD, Backend, DataType> &d,
     clk.start();
     conv.forward(DataType(1.0), d.input, d.filter, DataType(0.0),
                  d.output, cfg.skip_halo_exchange, cfg.skip_chanfilt_comm,
-                 false);
+                 cfg.profiling);
     if (cfg.use_bias) {
       conv.apply_bias(DataType(1.0), d.bias, DataType(1.0), d.output);
     }
@@ -573,18 +581,20 @@ int test_convolution_backward(Data<NSD, Backend, DataType> &d,
     clk_filter.start();
     conv.backward_filter(DataType(1.0), d.input, d.d_output,
                          DataType(0.0), d.d_filter,
-                         !cfg.skip_weight_allreduce, cfg.skip_chanfilt_comm);
+                         !cfg.skip_weight_allreduce, cfg.skip_chanfilt_comm,
+                         cfg.profiling);
     clk_filter.stop();
     if (cfg.use_bias) {
       clk_bias.start();
       conv.backward_bias(DataType(1.0), d.d_output, DataType(0.0),
-                         d.d_bias, !cfg.skip_weight_allreduce);
+                         d.d_bias, !cfg.skip_weight_allreduce, cfg.profiling);
       clk_bias.stop();
     }
     clk_data.start();
     conv.backward_data(DataType(1.0), d.filter, d.d_output,
                        DataType(0.0), d.d_input,
-                       cfg.skip_halo_exchange, cfg.skip_chanfilt_comm);
+                       cfg.skip_halo_exchange, cfg.skip_chanfilt_comm,
+                       cfg.profiling);
     clk_data.stop();
     clk.stop();
     if (!cfg.testing) {
@@ -654,6 +664,21 @@ struct ConvolutionTester<NSD, ref::Backend, DataType> {
 };
 
 #ifdef DISTCONV_HAS_CUDNN
+// Writes the phase times of the profiled passes, aggregated over the
+// processes, to <output>_phases.json.
+template <int NSD, typename DataType>
+void write_phase_profile(
+    const Convolution<cudnn::BackendCUDNN, DataType> &conv,
+    const BenchmarkConfig<NSD> &cfg, MPI_Comm comm) {
+  int pid;
+  DISTCONV_CHECK_MPI(MPI_Comm_rank(comm, &pid));
+  std::ofstream ofs;
+  if (pid == 0) {
+    ofs.open(cfg.output_file + "_phases.json");
+  }
+  conv.get_phase_profile().write_json(ofs, comm);
+}
+
 template <int NSD, typename DataType>
 struct ConvolutionTester<NSD, cudnn::BackendCUDNN, DataType> {
   ConvolutionTester() {}
@@ -722,6 +747,9 @@ struct ConvolutionTester<NSD, cudnn::BackendCUDNN, DataType> {
 #endif
     test_convolution_backward<NSD, cudnn::BackendCUDNN, DataType>(
       d, cfg, comm, be, conv, prof);
+    if (cfg.profiling) {
+      write_phase_profile(conv, cfg, comm);
+    }
     // This seems necessary to avoid hang using NVSHMEM v0.3.3
     DISTCONV_CHECK_CUDA(cudaDeviceSynchronize());
     return 0;
@@ -730,7 +758,7 @@ struct ConvolutionTester<NSD, cudnn::BackendCUDNN, DataType> {
 #endif
 
 template <int NSD>
-void run(int argc, char *argv[], int pid, int np) {
+int run(int argc, char *argv[], int pid, int np) {
   auto cfg = process_opt<NSD>(argc, argv, pid, true);
   if (pid == 0) {
     std::cout << cfg << std::endl;
@@ -753,7 +781,8 @@ void run(int argc, char *argv[], int pid, int np) {
   }
 #endif // DISTCONV_HAS_NVSHMEM
 
-  run_test<NSD, Data, Profile, ConvolutionTester>(cfg, MPI_COMM_WORLD);
+  const int num_regressions =
+      run_test<NSD, Data, Profile, ConvolutionTester>(cfg, MPI_COMM_WORLD);
 
   util::MPIRootPrintStreamInfo() << "Finishing";
 
@@ -762,6 +791,8 @@ void run(int argc, char *argv[], int pid, int np) {
     util::nvshmem::finalize();
   }
 #endif // DISTCONV_HAS_NVSHMEM
+
+  return num_regressions;
 }
 
 } // namespace distconv_benchmark
@@ -776,10 +807,11 @@ int main(int argc, char *argv[]) {
 
   const int nsd = distconv_benchmark::parse_num_dims(argc, argv);
 
+  int num_regressions = 0;
   if(nsd == 2) {
-    distconv_benchmark::run<2>(argc, argv, pid, np);
+    num_regressions = distconv_benchmark::run<2>(argc, argv, pid, np);
   } else if(nsd == 3) {
-    distconv_benchmark::run<3>(argc, argv, pid, np);
+    num_regressions = distconv_benchmark::run<3>(argc, argv, pid, np);
   } else {
     util::MPIRootPrintStreamError() << "Invalid --num-dims: " << nsd;
     DISTCONV_CHECK_MPI(MPI_Finalize());
@@ -787,5 +819,5 @@ int main(int argc, char *argv[]) {
   }
 
   Al::Finalize();
-  return 0;
+  return num_regressions > 0 ? 1 : 0;
 }
@@ -55,6 +55,13 @@ class Profile {
     return os;
   }
 
+  void track(RegressionTracker &tracker, const std::string &prefix) const {
+    tracker.add(prefix + " bn fwd", fwd_time);
+    tracker.add(prefix + " bn fwd allreduce", fwd_allreduce_time);
+    tracker.add(prefix + " bn bwd", bwd_time);
+    tracker.add(prefix + " bn bwd allreduce", bwd_allreduce_time);
+  }
+
   void print_summary(std::ostream &os) {
     std::cout << "Forward mean: " << get_mean(fwd_time)
               << ", median: " << get_median(fwd_time)
@@ -464,7 +471,7 @@ struct BNTester<NSD, cudnn::BackendCUDNN, DataType> {
 #endif
 
 template <int NSD>
-void run(int argc, char *argv[], int pid, int np) {
+int run(int argc, char *argv[], int pid, int np) {
   auto cfg = process_opt<NSD>(argc, argv, pid, true);
   if (pid == 0) {
     std::cout << cfg << std::endl;
@@ -487,7 +494,8 @@ void run(int argc, char *argv[], int pid, int np) {
   }
 #endif // DISTCONV_HAS_NVSHMEM
 
-  run_test<NSD, Data, Profile, BNTester>(cfg, MPI_COMM_WORLD);
+  const int num_regressions =
+      run_test<NSD, Data, Profile, BNTester>(cfg, MPI_COMM_WORLD);
 
   util::MPIRootPrintStreamInfo() << "Finishing";
 
@@ -496,6 +504,8 @@ void run(int argc, char *argv[], int pid, int np) {
     util::nvshmem::finalize();
   }
 #endif // DISTCONV_HAS_NVSHMEM
+
+  return num_regressions;
 }
 
 } // namespace distconv_benchmark
@@ -510,10 +520,11 @@ int main(int argc, char *argv[]) {
 
   const int nsd = distconv_benchmark::parse_num_dims(argc, argv);
 
+  int num_regressions = 0;
   if(nsd == 2) {
-    distconv_benchmark::run<2>(argc, argv, pid, np);
+    num_regressions = distconv_benchmark::run<2>(argc, argv, pid, np);
   } else if(nsd == 3) {
-    distconv_benchmark::run<3>(argc, argv, pid, np);
+    num_regressions = distconv_benchmark::run<3>(argc, argv, pid, np);
   } else {
     distconv::util::MPIRootPrintStreamError() << "Invalid --num-dims: " << nsd;
     DISTCONV_CHECK_MPI(MPI_Finalize());
@@ -521,5 +532,5 @@ int main(int argc, char *argv[]) {
   }
 
   Al::Finalize();
-  return 0;
+  return num_regressions > 0 ? 1 : 0;
 }
@@ -186,7 +186,11 @@ inline int dump_shared_tensor(const tensor::Tensor<DataType,
       out.open(file_path + ".txt", std::ios::out | std::ios::trunc);
       for (size_t i = 0; i < t.get_size(); ++i) {
         auto x = buf[i];
-        out << x << std::endl;
+        if constexpr (h2::IsLowPrecisionFloat_v<DataType>) {
+          out << static_cast<float>(x) << std::endl;
+        } else {
+          out << x << std::endl;
+        }
       }
     }
     out.close();
@@ -314,12 +318,22 @@ inline int run_test_with_type(const BenchmarkConfig<NSD> &cfg, MPI_Comm comm) {
   ofs.open(ss.str(), std::fstream::app);
   prof.print_as_row(ofs);
 
+  // Compare with the baseline, naming the results by the configuration
+  int num_regressions = 0;
+  if (cfg.regression.enabled()) {
+    RegressionTracker tracker(cfg.regression, comm);
+    std::stringstream prefix;
+    cfg.print_as_row(prefix);
+    prof.track(tracker, prefix.str());
+    num_regressions = tracker.finish();
+  }
+
   // Dump result
   if (cfg.dump_output) {
     d.dump_output(cfg.dump_binary);
   }
 
-  return 0;
+  return num_regressions;
 }
 
 
@@ -335,12 +349,23 @@ inline int run_test_with_backend(const BenchmarkConfig<NSD> &cfg, MPI_Comm comm)
   } else if (cfg.data_type == BenchmarkDataType::DOUBLE) {
     return run_test_with_type<NSD, Backend, double, Data<NSD, Backend, double>,
                               Profile<NSD>, Tester<NSD, Backend, double>>(cfg, comm);
-#ifdef DISTCONV_ENABLE_FP16
-  } else if (cfg.backend == "CUDNN" &&
-             cfg.data_type == BenchmarkDataType::HALF) {
-    return run_test_with_type<NSD, Backend, half, Data<NSD, Backend, half>,
-                              Profile<NSD>, Tester<NSD, Backend, half>>(cfg, comm);
-#endif
+#if H2_HAS_GPU_LOW_PRECISION
+  } else if (is_low_precision(cfg.data_type)) {
+    // The reference backend does not support 16-bit types
+    if constexpr (std::is_same_v<Backend, ref::Backend>) {
+      util::MPIPrintStreamError()
+          << "Half and bfloat16 are not supported by the Ref backend\n";
+      abort();
+    } else if (cfg.data_type == BenchmarkDataType::HALF) {
+      using T = h2::gpu::Half;
+      return run_test_with_type<NSD, Backend, T, Data<NSD, Backend, T>,
+                                Profile<NSD>, Tester<NSD, Backend, T>>(cfg, comm);
+    } else {
+      using T = h2::gpu::BFloat16;
+      return run_test_with_type<NSD, Backend, T, Data<NSD, Backend, T>,
+                                Profile<NSD>, Tester<NSD, Backend, T>>(cfg, comm);
+    }
+#endif // H2_HAS_GPU_LOW_PRECISION
   } else {
     util::MPIPrintStreamError() << "Unknown data type name\n";
     abort();
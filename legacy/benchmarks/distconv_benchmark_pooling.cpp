@@ -24,6 +24,11 @@ class Profile {
     return os;
   }
 
+  void track(RegressionTracker &tracker, const std::string &prefix) const {
+    tracker.add(prefix + " pooling fwd", fwd_time);
+    tracker.add(prefix + " pooling bwd", bwd_time);
+  }
+
   void print_summary(std::ostream &os) {
     std::stringstream ss;
     ss << "Forward mean: " << get_mean(fwd_time)
@@ -291,15 +296,18 @@ struct PoolingTester<NSD, cudnn::BackendCUDNN, DataType> {
 #endif
 
 template <int NSD>
-void run(int argc, char *argv[], int pid) {
+int run(int argc, char *argv[], int pid) {
   auto cfg = process_opt<NSD>(argc, argv, pid, false);
   if (pid == 0) {
     std::cout << cfg << std::endl;
   }
 
-  run_test<NSD, Data, Profile, PoolingTester>(cfg, MPI_COMM_WORLD);
+  const int num_regressions =
+      run_test<NSD, Data, Profile, PoolingTester>(cfg, MPI_COMM_WORLD);
 
   util::MPIRootPrintStreamInfo() << "Finishing";
+
+  return num_regressions;
 }
 
 } // namespace distconv_benchmark
@@ -312,10 +320,11 @@ int main(int argc, char *argv[]) {
 
   const int nsd = distconv_benchmark::parse_num_dims(argc, argv);
 
+  int num_regressions = 0;
   if(nsd == 2) {
-    distconv_benchmark::run<2>(argc, argv, pid);
+    num_regressions = distconv_benchmark::run<2>(argc, argv, pid);
   } else if(nsd == 3) {
-    distconv_benchmark::run<3>(argc, argv, pid);
+    num_regressions = distconv_benchmark::run<3>(argc, argv, pid);
   } else {
     util::MPIRootPrintStreamError() << "Invalid --num-dims: " << nsd;
     DISTCONV_CHECK_MPI(MPI_Finalize());
@@ -323,5 +332,5 @@ int main(int argc, char *argv[]) {
   }
 
   DISTCONV_CHECK_MPI(MPI_Finalize());
-  return 0;
+  return num_regressions > 0 ? 1 : 0;
 }
@@ -0,0 +1,436 @@
+#include "benchmark_common.hpp"
+#include "distconv/dnn_backend/halo_exchange_factory.hpp"
+#include "distconv/runtime_gpu.hpp"
+#include "distconv/tensor/tensor.hpp"
+#include "distconv/tensor/tensor_cuda.hpp"
+#include "distconv/tensor/tensor_mpi_cuda.hpp"
+#include "distconv/util/util_gpu.hpp"
+#include "distconv_benchmark_common.hpp"
+#include <distconv_config.hpp>
+#ifdef DISTCONV_HAS_NVSHMEM
+#include "distconv/util/nvshmem.hpp"
+#endif // DISTCONV_HAS_NVSHMEM
+#include "distconv/distconv.hpp"
+#include "distconv/util/cxxopts.hpp"
+
+#include "h2/gpu/runtime.hpp"
+
+#include <Al.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <vector>
+
+// Measures halo exchanges in isolation. Each rank times every
+// combination of method, grid shape, local size, and halo width given
+// on the command line, in both the forward (copy) and reverse
+// (accumulate) directions, and writes latency and bandwidth
+// percentiles to <output>.<rank>.csv and <output>.<rank>.json.
+
+using DataType = float;
+using namespace distconv;
+using AlBackend = Al::NCCLBackend;
+
+namespace distconv_benchmark {
+
+using Tensor = tensor::Tensor<DataType, tensor::LocaleMPI,
+                              tensor::CUDAAllocator>;
+
+struct HaloBenchmarkConfig {
+  int num_dims;
+  std::vector<int> sizes;
+  std::vector<int> widths;
+  std::vector<int_vector> grids;
+  std::vector<HaloExchangeMethod> methods;
+  int channels;
+  int samples;
+  int run_count;
+  int warming_up_count;
+  bool skip_reverse;
+  std::string output_file;
+  RegressionOptions regression;
+};
+
+// Result of one measured configuration.
+struct HaloProfile {
+  HaloExchangeMethod method;
+  int_vector grid;
+  int size;
+  int width;
+  bool reverse;
+  size_t bytes;
+  std::vector<float> time;
+};
+
+inline std::vector<HaloExchangeMethod> get_all_methods() {
+  return {
+    HaloExchangeMethod::MPI,
+    HaloExchangeMethod::AL,
+    HaloExchangeMethod::AUTO,
+    HaloExchangeMethod::MPI_MULTIDIM,
+#ifdef DISTCONV_HAS_P2P
+    HaloExchangeMethod::P2P,
+    HaloExchangeMethod::HYBRID,
+#endif // DISTCONV_HAS_P2P
+#ifdef DISTCONV_HAS_NVSHMEM
+    HaloExchangeMethod::NVSHMEM,
+#ifdef DISTCONV_HAS_CUDA_GRAPH
+    HaloExchangeMethod::NVSHMEM_GRAPH,
+#endif // DISTCONV_HAS_CUDA_GRAPH
+    HaloExchangeMethod::NVSHMEM_DIRECT,
+    HaloExchangeMethod::NVSHMEM_FUSED_NOTIFY,
+#endif // DISTCONV_HAS_NVSHMEM
+  };
+}
+
+inline bool is_nvshmem_method(HaloExchangeMethod method) {
+#ifdef DISTCONV_HAS_NVSHMEM
+  return method == HaloExchangeMethod::NVSHMEM ||
+      method == HaloExchangeMethod::NVSHMEM_GRAPH ||
+      method == HaloExchangeMethod::NVSHMEM_DIRECT ||
+      method == HaloExchangeMethod::NVSHMEM_FUSED_NOTIFY;
+#else
+  return false;
+#endif // DISTCONV_HAS_NVSHMEM
+}
+
+// Returns the value at the p-th percentile with the nearest-rank
+// method.
+inline float get_percentile(const std::vector<float> &v, double p) {
+  std::vector<float> tmp = v;
+  std::sort(tmp.begin(), tmp.end());
+  int idx = static_cast<int>(std::ceil(p / 100.0 * tmp.size())) - 1;
+  idx = std::min(std::max(idx, 0), static_cast<int>(tmp.size()) - 1);
+  return tmp[idx];
+}
+
+inline HaloBenchmarkConfig process_halo_opt(int argc, char *argv[],
+                                            int pid) {
+  std::vector<std::string> all_methods;
+  for (auto m: get_all_methods()) {
+    std::stringstream ss;
+    ss << m;
+    all_methods.push_back(ss.str());
+  }
+  cxxopts::Options cmd_opts(argv[0], "Halo Exchange Benchmark");
+  cmd_opts.add_options()
+      ("num-dims", "Number of spatial dimensions",
+       cxxopts::value<int>()->default_value("2"))
+      ("sizes", "Comma-separated local spatial extents",
+       cxxopts::value<std::string>()->default_value("16,32,64,128"))
+      ("widths", "Comma-separated halo widths",
+       cxxopts::value<std::string>()->default_value("1,2,3"))
+      ("grids", "Comma-separated spatial process grids, e.g., 2x2,4x1. "
+       "The remaining ranks partition the sample dimension",
+       cxxopts::value<std::string>()->default_value(""))
+      ("methods", "Comma-separated halo exchange methods",
+       cxxopts::value<std::string>()->default_value(
+           util::join_array(all_methods, ",")))
+      ("c,num-channels", "Number of channels",
+       cxxopts::value<int>()->default_value("16"))
+      ("n,num-samples", "Number of local samples",
+       cxxopts::value<int>()->default_value("1"))
+      ("r,num-runs", "Number of runs",
+       cxxopts::value<int>()->default_value("20"))
+      ("num-warmup-runs", "Number of warming-up runs",
+       cxxopts::value<int>()->default_value("5"))
+      ("skip-reverse", "Do not measure reverse (accumulating) exchanges")
+      ("o,output-file", "Prefix of the per-rank result files",
+       cxxopts::value<std::string>()->default_value("halo_exchange"))
+      ("help", "Print help")
+      ;
+  add_regression_options(cmd_opts);
+  auto result = cmd_opts.parse(argc, argv);
+  if (result.count("help")) {
+    if (pid == 0) {
+      std::cout << cmd_opts.help() << "\n";
+    }
+    DISTCONV_CHECK_MPI(MPI_Finalize());
+    exit(0);
+  }
+
+  HaloBenchmarkConfig cfg;
+  cfg.num_dims = result["num-dims"].as<int>();
+  cfg.sizes = util::split_spaced_array<int>(result["sizes"].as<std::string>());
+  cfg.widths = util::split_spaced_array<int>(
+      result["widths"].as<std::string>());
+  for (const auto &g: util::split(result["grids"].as<std::string>(), ',')) {
+    int_vector grid;
+    for (const auto &s: util::split(g, 'x')) {
+      grid.push_back(std::stoi(s));
+    }
+    // Grids are given in the H,W order, while the tensor dimensions
+    // start with W.
+    cfg.grids.push_back(util::reverse(grid));
+  }
+  for (const auto &m: util::split(result["methods"].as<std::string>(), ',')) {
+    cfg.methods.push_back(GetHaloExchangeMethod(m));
+  }
+  cfg.channels = result["num-channels"].as<int>();
+  cfg.samples = result["num-samples"].as<int>();
+  cfg.run_count = result["num-runs"].as<int>();
+  cfg.warming_up_count = result["num-warmup-runs"].as<int>();
+  cfg.skip_reverse = result.count("skip-reverse") > 0;
+  cfg.output_file = result["output-file"].as<std::string>();
+  cfg.regression = parse_regression_options(result);
+  return cfg;
+}
+
+// Returns the number of bytes this rank sends in one exchange.
+inline size_t get_halo_bytes(const Tensor &t, int num_spatial_dims) {
+  const auto local_shape = t.get_local_shape();
+  const auto split_idx = t.get_split_index();
+  const auto &split_shape = t.get_distribution().get_split_shape();
+  size_t bytes = 0;
+  for (int i = 0; i < num_spatial_dims; ++i) {
+    const auto width = t.get_halo_width(i);
+    if (width == 0) continue;
+    size_t face = width * sizeof(DataType);
+    for (int j = 0; j < t.get_num_dims(); ++j) {
+      if (j != i) face *= local_shape[j];
+    }
+    if (split_idx[i] > 0) bytes += face;
+    if (split_idx[i] < split_shape[i] - 1) bytes += face;
+  }
+  return bytes;
+}
+
+int measure(const HaloBenchmarkConfig &cfg, const int_vector &grid,
+            int size, int width, HaloExchangeMethod method,
+#ifdef DISTCONV_HAS_P2P
+            p2p::P2P &p2p,
+#endif // DISTCONV_HAS_P2P
+            MPI_Comm comm, std::vector<HaloProfile> &profs) {
+  int np;
+  DISTCONV_CHECK_MPI(MPI_Comm_size(comm, &np));
+  const int nsd = cfg.num_dims;
+  const int num_spatial_procs = std::accumulate(
+      grid.begin(), grid.end(), 1, std::multiplies<int>());
+
+  tensor::Shape shape(nsd + 2, 0);
+  tensor::Shape proc_shape(nsd + 2, 1);
+  IntVector overlap(nsd + 2, 0);
+  for (int i = 0; i < nsd; ++i) {
+    shape[i] = size * grid[i];
+    proc_shape[i] = grid[i];
+    overlap[i] = width;
+  }
+  proc_shape[-1] = np / num_spatial_procs;
+  shape[-2] = cfg.channels;
+  shape[-1] = cfg.samples * proc_shape[-1];
+
+  Tensor t(shape, tensor::LocaleMPI(comm),
+           tensor::Distribution::make_overlapped_distribution(
+               proc_shape, overlap));
+  assert0(t.allocate());
+  t.zero();
+
+  auto stream = h2::gpu::make_stream();
+  std::vector<h2::gpu::DeviceStream> boundary_streams;
+  BoundaryAttributesV<std::shared_ptr<AlBackend::comm_type>> comms;
+  apply_to_spatial_sides(shape.num_dims(), [&](int i, Side side) {
+    boundary_streams.push_back(h2::gpu::make_stream_nonblocking());
+    comms(i, side) = std::make_shared<AlBackend::comm_type>(
+        t.get_locale().get_comm(), boundary_streams.back());
+  });
+  for (int i = 0; i < nsd; ++i) {
+    if (t.get_split_index()[i] % 2) {
+      std::swap(comms(i, LHS), comms(i, RHS));
+    }
+  }
+
+  auto halo_exc = make_halo_exchange(t,
+#ifdef DISTCONV_HAS_P2P
+                                     p2p,
+#endif // DISTCONV_HAS_P2P
+                                     method);
+  const size_t bytes = get_halo_bytes(t, nsd);
+
+  for (int reverse = 0; reverse < (cfg.skip_reverse ? 1 : 2); ++reverse) {
+    const auto op = reverse ? tensor::HaloExchangeAccumOp::SUM
+                            : tensor::HaloExchangeAccumOp::ID;
+    auto run = [&]() {
+      halo_exc->exchange(comms, stream, false, true, reverse, false, op);
+    };
+    for (int i = 0; i < cfg.warming_up_count; ++i) {
+      run();
+    }
+    std::vector<util::Clock> clks(cfg.run_count, stream);
+    for (int i = 0; i < cfg.run_count; ++i) {
+      h2::gpu::sync();
+      DISTCONV_CHECK_MPI(MPI_Barrier(comm));
+      clks[i].start();
+      run();
+      clks[i].stop();
+    }
+    h2::gpu::sync();
+    HaloProfile prof{method, grid, size, width, reverse != 0, bytes, {}};
+    for (int i = 0; i < cfg.run_count; ++i) {
+      prof.time.push_back(clks[i].get_time());
+    }
+    profs.push_back(prof);
+  }
+
+  halo_exc.reset();
+  comms = BoundaryAttributesV<std::shared_ptr<AlBackend::comm_type>>();
+  for (auto s: boundary_streams) {
+    h2::gpu::destroy(s);
+  }
+  h2::gpu::destroy(stream);
+  DISTCONV_CHECK_MPI(MPI_Barrier(comm));
+  return 0;
+}
+
+// Bandwidth in GB/s of sending `bytes` in `ms` milliseconds.
+inline double get_bandwidth(size_t bytes, float ms) {
+  return ms > 0 ? bytes / (ms * 1e6) : 0;
+}
+
+void dump_profs(const std::vector<HaloProfile> &profs,
+                const HaloBenchmarkConfig &cfg, int pid) {
+  const double percentiles[] = {50, 90, 99};
+  const std::string prefix = cfg.output_file + "." + std::to_string(pid);
+
+  std::ofstream csv(prefix + ".csv");
+  csv << "method,grid,size,width,direction,bytes,min,p50,p90,p99,max,mean,"
+      << "bw_p50,bw_max\n";
+  std::ofstream json(prefix + ".json");
+  json << "[\n";
+  for (size_t i = 0; i < profs.size(); ++i) {
+    const auto &p = profs[i];
+    const auto grid = util::join_xd_array(util::reverse(p.grid));
+    const char *dir = p.reverse ? "reverse" : "forward";
+    const float p50 = get_percentile(p.time, percentiles[0]);
+    const float min = get_min(p.time);
+    csv << p.method << "," << grid << "," << p.size << "," << p.width << ","
+        << dir << "," << p.bytes << "," << min << "," << p50 << ","
+        << get_percentile(p.time, percentiles[1]) << ","
+        << get_percentile(p.time, percentiles[2]) << ","
+        << get_max(p.time) << "," << get_mean(p.time) << ","
+        << get_bandwidth(p.bytes, p50) << ","
+        << get_bandwidth(p.bytes, min) << "\n";
+    json << "  {\"rank\": " << pid
+         << ", \"method\": \"" << p.method << "\""
+         << ", \"grid\": \"" << grid << "\""
+         << ", \"size\": " << p.size
+         << ", \"width\": " << p.width
+         << ", \"direction\": \"" << dir << "\""
+         << ", \"bytes\": " << p.bytes
+         << ", \"time_ms\": {\"min\": " << min
+         << ", \"p50\": " << p50
+         << ", \"p90\": " << get_percentile(p.time, percentiles[1])
+         << ", \"p99\": " << get_percentile(p.time, percentiles[2])
+         << ", \"max\": " << get_max(p.time)
+         << ", \"mean\": " << get_mean(p.time) << "}"
+         << ", \"bandwidth_gbps\": {\"p50\": " << get_bandwidth(p.bytes, p50)
+         << ", \"max\": " << get_bandwidth(p.bytes, min) << "}}"
+         << (i + 1 < profs.size() ? "," : "") << "\n";
+    if (pid == 0) {
+      std::cout << p.method << " " << grid << " " << p.size << " "
+                << p.width << " " << dir << " median: " << p50
+                << " (ms), " << get_bandwidth(p.bytes, p50) << " (GB/s)\n";
+    }
+  }
+  json << "]\n";
+}
+
+// Compares the results with the baseline and returns the number of
+// regressions.
+int track_profs(const std::vector<HaloProfile> &profs,
+                const HaloBenchmarkConfig &cfg, MPI_Comm comm) {
+  RegressionTracker tracker(cfg.regression, comm);
+  for (const auto &p: profs) {
+    std::stringstream ss;
+    ss << "halo " << p.method << " "
+       << util::join_xd_array(util::reverse(p.grid)) << " size " << p.size
+       << " width " << p.width << (p.reverse ? " reverse" : " forward");
+    tracker.add(ss.str(), p.time);
+  }
+  return tracker.finish();
+}
+
+int run(int argc, char *argv[], int pid, int np) {
+  auto cfg = process_halo_opt(argc, argv, pid);
+  if (cfg.grids.empty()) {
+    // Partition only the outermost spatial dimension by default.
+    int_vector grid(cfg.num_dims, 1);
+    grid.back() = np;
+    cfg.grids.push_back(grid);
+  }
+
+#ifdef DISTCONV_HAS_NVSHMEM
+  const bool use_nvshmem = std::any_of(
+      cfg.methods.begin(), cfg.methods.end(), is_nvshmem_method);
+  if (use_nvshmem) {
+    util::nvshmem::initialize(MPI_COMM_WORLD);
+  }
+#endif // DISTCONV_HAS_NVSHMEM
+#ifdef DISTCONV_HAS_P2P
+  p2p::P2P p2p(MPI_COMM_WORLD);
+#endif // DISTCONV_HAS_P2P
+
+  std::vector<HaloProfile> profs;
+  for (const auto &grid: cfg.grids) {
+    const int num_spatial_procs = std::accumulate(
+        grid.begin(), grid.end(), 1, std::multiplies<int>());
+    if ((int)grid.size() != cfg.num_dims || np % num_spatial_procs) {
+      util::MPIRootPrintStreamInfo()
+          << "Skipping invalid grid "
+          << util::join_xd_array(util::reverse(grid));
+      continue;
+    }
+    for (auto size: cfg.sizes) {
+      for (auto width: cfg.widths) {
+        if (width > size) {
+          util::MPIRootPrintStreamInfo()
+              << "Skipping width " << width << " larger than size " << size;
+          continue;
+        }
+        for (auto method: cfg.methods) {
+          util::MPIRootPrintStreamInfo()
+              << "Measuring " << method << " with grid "
+              << util::join_xd_array(util::reverse(grid)) << ", size "
+              << size << ", width " << width;
+          measure(cfg, grid, size, width, method,
+#ifdef DISTCONV_HAS_P2P
+                  p2p,
+#endif // DISTCONV_HAS_P2P
+                  MPI_COMM_WORLD, profs);
+        }
+      }
+    }
+  }
+
+  dump_profs(profs, cfg, pid);
+  const int num_regressions = cfg.regression.enabled() ?
+      track_profs(profs, cfg, MPI_COMM_WORLD) : 0;
+
+#ifdef DISTCONV_HAS_NVSHMEM
+  if (use_nvshmem) {
+    util::nvshmem::finalize();
+  }
+#endif // DISTCONV_HAS_NVSHMEM
+
+  util::MPIRootPrintStreamInfo() << "Completed";
+  return num_regressions;
+}
+
+} // namespace distconv_benchmark
+
+int main(int argc, char *argv[]) {
+  distconv_benchmark::set_device();
+  int pid;
+  int np;
+  Al::Initialize(argc, argv);
+  DISTCONV_CHECK_MPI(MPI_Comm_rank(MPI_COMM_WORLD, &pid));
+  DISTCONV_CHECK_MPI(MPI_Comm_size(MPI_COMM_WORLD, &np));
+
+  const int num_regressions = distconv_benchmark::run(argc, argv, pid, np);
+
+  Al::Finalize();
+  return num_regressions > 0 ? 1 : 0;
+}
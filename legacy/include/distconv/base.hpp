@@ -175,6 +175,10 @@ class BoundaryAttributesV {
 
 enum class HaloExchangeMethod {
   MPI, AL,
+  // Select the fastest of the other methods for each dimension.
+  AUTO,
+  // Exchange faces, edges, and corners with MPI in a single round.
+  MPI_MULTIDIM,
 #ifdef DISTCONV_HAS_P2P
   P2P, HYBRID,
 #endif // DISTCONV_HAS_P2P
@@ -188,6 +192,10 @@ inline std::ostream& operator<<(std::ostream &os, const HaloExchangeMethod &m) {
     return os << "MPI";
   } else if (m == HaloExchangeMethod::AL) {
     return os << "AL";
+  } else if (m == HaloExchangeMethod::AUTO) {
+    return os << "AUTO";
+  } else if (m == HaloExchangeMethod::MPI_MULTIDIM) {
+    return os << "MPI_MULTIDIM";
 #ifdef DISTCONV_HAS_P2P
   } else if (m == HaloExchangeMethod::P2P) {
     return os << "P2P";
@@ -215,6 +223,10 @@ inline HaloExchangeMethod GetHaloExchangeMethod(const std::string &method) {
     return HaloExchangeMethod::MPI;
   } else if (method == "AL") {
     return HaloExchangeMethod::AL;
+  } else if (method == "AUTO") {
+    return HaloExchangeMethod::AUTO;
+  } else if (method == "MPI_MULTIDIM") {
+    return HaloExchangeMethod::MPI_MULTIDIM;
 #ifdef DISTCONV_HAS_P2P
   } else if (method == "P2P") {
     return HaloExchangeMethod::P2P;
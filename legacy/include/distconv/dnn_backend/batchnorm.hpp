@@ -10,9 +10,13 @@
 #ifdef DISTCONV_HAS_NVSHMEM
 #include "distconv/tensor/allreduce_nvshmem.hpp"
 #endif // DISTCONV_HAS_NVSHMEM
+#include "h2/core/low_precision.hpp"
 
+#include <algorithm>
+#include <cstdlib>
 #include <memory>
 #include <numeric>
+#include <vector>
 
 namespace distconv
 {
@@ -36,6 +40,55 @@ void sums_to_statistics(index_t num_per_sum,
                         TensorType& running_var,
                         h2::gpu::DeviceStream stream);
 
+// Computes the per-channel sums and sums of squared differences from
+// the local channel means (M2) in a single pass with Welford's
+// algorithm. The sums are divided by num_per_sum, the number of
+// elements per channel of the statistics, and the M2s by num_per_sum -
+// 1, so that they stay in the range of the 16-bit types and are the
+// mean and variance when all elements are local. The local means are
+// also stored to local_means if it is not null. Only channels in
+// [channel_begin, channel_end) are computed.
+template <typename TensorType>
+void channel_welford(int num_dims,
+                     int num_samples,
+                     index_t num_per_sum,
+                     const TensorType& input,
+                     TensorType& sums,
+                     TensorType& m2s,
+                     typename TensorType::data_type* local_means,
+                     int channel_begin,
+                     int channel_end,
+                     h2::gpu::DeviceStream stream);
+
+// Turns the scaled M2s of the local elements into their contribution
+// to the variance of all elements, so that the latter is the sum of
+// the former (Chan et al.'s merge of two sets of statistics). The
+// global sums are the means of all elements.
+template <typename TensorType>
+void merge_m2s(index_t num_per_sum,
+               index_t local_num_per_sum,
+               const TensorType& global_sums,
+               const typename TensorType::data_type* local_means,
+               TensorType& m2s,
+               int channel_begin,
+               int channel_end,
+               h2::gpu::DeviceStream stream);
+
+// Updates the running statistics with the means and variances from the
+// scaled sums and M2s.
+template <typename TensorType>
+void m2s_to_statistics(index_t num_per_sum,
+                       typename TensorType::data_type decay,
+                       TensorType& global_mean,
+                       TensorType& global_var,
+                       TensorType& running_mean,
+                       TensorType& running_var,
+                       int channel_begin,
+                       int channel_end,
+                       h2::gpu::DeviceStream stream);
+
+// Normalizes the channels in [channel_begin, channel_end), where a
+// negative channel_end means the number of local channels.
 template <typename TensorType>
 void batch_normalization(int num_dims,
                          int num_samples,
@@ -46,7 +99,9 @@ void batch_normalization(int num_dims,
                          const TensorType& bias,
                          TensorType& output,
                          typename TensorType::data_type epsilon,
-                         h2::gpu::DeviceStream stream);
+                         h2::gpu::DeviceStream stream,
+                         int channel_begin = 0,
+                         int channel_end = -1);
 
 #ifdef DISTCONV_HAS_NVSHMEM
 template <typename TensorType>
@@ -114,9 +169,37 @@ public:
           m_epsilon(epsilon),
           m_allreducer(nullptr),
           m_impl(impl),
-          m_global_stats(global_stats)
+          m_global_stats(global_stats),
+          m_welford(true),
+          m_local_num_per_sum(0),
+          m_num_per_sum(0),
+          m_local_means(nullptr),
+          m_num_pipeline_groups(1)
     {
-        if (m_impl == BatchnormImpl::MPI)
+        if (std::getenv("DISTCONV_DISABLE_BN_WELFORD"))
+        {
+            util::MPIRootPrintStreamInfo()
+                << "Disable Welford's algorithm for BN statistics";
+            m_welford = false;
+        }
+        if constexpr (h2::IsLowPrecisionFloat_v<DataType>)
+        {
+            // The statistics of the 16-bit types are accumulated in
+            // float but stored and reduced in the data type, so only
+            // the scaled Welford statistics stay in its range. MPI and
+            // NVSHMEM have no reductions of these types.
+            if (m_impl != BatchnormImpl::AL_NCCL)
+            {
+                util::MPIRootPrintStreamError()
+                    << "Only the AL_NCCL batchnorm implementation supports "
+                       "16-bit data types";
+                std::abort();
+            }
+            m_welford = true;
+            m_allreducer = std::make_unique<tensor::AllreduceAlNCCL<DataType>>(
+                backend.get_al_nccl_comm());
+        }
+        else if (m_impl == BatchnormImpl::MPI)
         {
             m_allreducer = std::make_unique<tensor::AllreduceMPICUDA<DataType>>(
                 backend.get_comm(), m_stream);
@@ -164,9 +247,27 @@ public:
                 tensor::AllreduceNVSHMEM<DataType>::RECURSIVE_DOUBLING_BLOCK);
 #endif // DISTCONV_HAS_NVSHMEM
         }
+
+        // Channel groups are allreduced on the internal communicators,
+        // each of which runs on its own priority stream.
+        const int num_groups = get_pipeline_groups();
+        if (m_impl == BatchnormImpl::AL_NCCL && num_groups > 1)
+        {
+            const size_t num_lanes = std::min<size_t>(
+                num_groups, backend.get_num_internal_comms());
+            for (size_t i = 0; i < num_lanes; ++i)
+            {
+                m_pipeline_streams.push_back(
+                    backend.get_internal_priority_stream(i));
+                m_pipeline_allreducers.push_back(
+                    std::make_unique<tensor::AllreduceAlNCCL<DataType>>(
+                        backend.get_internal_comm(i)));
+            }
+            m_num_pipeline_groups = num_groups;
+        }
     }
 
-    ~BatchNormalization() = default;
+    ~BatchNormalization() { release_local_means(); }
 
     template <typename Tensor>
     int forward_stage1(const Tensor& input,
@@ -177,7 +278,10 @@ public:
         set_num_samples(input.get_local_shape()[-1]);
         if (is_training)
         {
-            channel_sums_and_sqsums(input, mean, var);
+            if (m_welford)
+                channel_welford(input, mean, var);
+            else
+                channel_sums_and_sqsums(input, mean, var);
         }
         return 0;
     }
@@ -193,6 +297,24 @@ public:
         auto count = mean.get_local_pitched_size();
         assert_eq(count, var.get_local_pitched_size());
 
+        if (m_welford)
+        {
+            // The M2s can only be summed once they are relative to the
+            // global means
+            m_allreducer->allreduce(mean_ptr, count);
+            batchnorm::merge_m2s<Tensor>(m_num_per_sum,
+                                         m_local_num_per_sum,
+                                         mean,
+                                         m_local_means,
+                                         var,
+                                         0,
+                                         (int) mean.get_local_size(),
+                                         m_stream);
+            release_local_means();
+            m_allreducer->allreduce(var_ptr, count);
+            return 0;
+        }
+
         // Combine allreduces of mean and var if possible
         if (mean_ptr + count == var_ptr)
         {
@@ -235,9 +357,25 @@ public:
             // dimension is assumed to be at the second to last dimension.
             index_t num_per_sum = stat_shape.get_size() / stat_shape[-2];
 
-            // Sums to statistics
-            sums_to_statistics(
-                num_per_sum, mean, var, running_mean, running_var);
+            if (m_welford)
+            {
+                const int num_channels = mean.get_local_size();
+                batchnorm::m2s_to_statistics<Tensor>(num_per_sum,
+                                                     m_decay,
+                                                     mean,
+                                                     var,
+                                                     running_mean,
+                                                     running_var,
+                                                     0,
+                                                     num_channels,
+                                                     m_stream);
+            }
+            else
+            {
+                // Sums to statistics
+                sums_to_statistics(
+                    num_per_sum, mean, var, running_mean, running_var);
+            }
             batch_normalization(input, mean, var, scale, bias, output);
         }
         else
@@ -304,20 +442,35 @@ public:
         util::MPIPrintStreamDebug()
             << "BatchNormalization: " << input << ", " << output;
 #ifdef DISTCONV_HAS_NVSHMEM
-        if (m_impl == BatchnormImpl::FUSED_NVSHMEM_RECURSIVE_DOUBLING)
+        if constexpr (!h2::IsLowPrecisionFloat_v<DataType>)
         {
-            forward_all(input,
-                        mean,
-                        var,
-                        running_mean,
-                        running_var,
-                        scale,
-                        bias,
-                        output,
-                        is_training);
-            return 0;
+            if (m_impl == BatchnormImpl::FUSED_NVSHMEM_RECURSIVE_DOUBLING)
+            {
+                forward_all(input,
+                            mean,
+                            var,
+                            running_mean,
+                            running_var,
+                            scale,
+                            bias,
+                            output,
+                            is_training);
+                return 0;
+            }
         }
 #endif // DISTCONV_HAS_NVSHMEM
+        if (is_training && m_global_stats && m_welford
+            && m_num_pipeline_groups > 1)
+        {
+            return forward_pipelined(input,
+                                     mean,
+                                     var,
+                                     running_mean,
+                                     running_var,
+                                     scale,
+                                     bias,
+                                     output);
+        }
         forward_stage1(input, mean, var, is_training);
         forward_allreduce(mean, var, is_training);
         forward_stage2(input,
@@ -332,6 +485,82 @@ public:
         return 0;
     }
 
+    // Same as forward in training with global statistics, but the
+    // channels are split into groups whose allreduces run on the
+    // pipeline streams. The statistics of a group are computed on the
+    // main stream as soon as those of the previous group are, so they
+    // overlap with the allreduces and normalization of earlier groups.
+    template <typename Tensor>
+    int forward_pipelined(const Tensor& input,
+                          Tensor& mean,
+                          Tensor& var,
+                          Tensor& running_mean,
+                          Tensor& running_var,
+                          Tensor& scale,
+                          Tensor& bias,
+                          Tensor& output)
+    {
+        set_num_samples(input.get_local_shape()[-1]);
+        prepare_welford(input, mean);
+        const int num_channels = mean.get_local_size();
+        const int num_groups = std::min(m_num_pipeline_groups, num_channels);
+        const auto num_lanes = m_pipeline_streams.size();
+        for (int g = 0; g < num_groups; ++g)
+        {
+            const int begin = num_channels * g / num_groups;
+            const int end = num_channels * (g + 1) / num_groups;
+            batchnorm::channel_welford<Tensor>(m_num_dims,
+                                               m_num_current_samples,
+                                               m_num_per_sum,
+                                               input,
+                                               mean,
+                                               var,
+                                               m_local_means,
+                                               begin,
+                                               end,
+                                               m_stream);
+            auto const lane = g % num_lanes;
+            auto const stream = m_pipeline_streams[lane];
+            auto& allreducer = *m_pipeline_allreducers[lane];
+            util::wait_stream(m_stream, stream);
+            allreducer.allreduce(mean.get_base_ptr() + begin, end - begin);
+            batchnorm::merge_m2s<Tensor>(m_num_per_sum,
+                                         m_local_num_per_sum,
+                                         mean,
+                                         m_local_means,
+                                         var,
+                                         begin,
+                                         end,
+                                         stream);
+            allreducer.allreduce(var.get_base_ptr() + begin, end - begin);
+            batchnorm::m2s_to_statistics<Tensor>(m_num_per_sum,
+                                                 m_decay,
+                                                 mean,
+                                                 var,
+                                                 running_mean,
+                                                 running_var,
+                                                 begin,
+                                                 end,
+                                                 stream);
+            batchnorm::batch_normalization<Tensor>(m_num_dims,
+                                                   m_num_current_samples,
+                                                   input,
+                                                   mean,
+                                                   var,
+                                                   scale,
+                                                   bias,
+                                                   output,
+                                                   m_epsilon,
+                                                   stream,
+                                                   begin,
+                                                   end);
+        }
+        for (size_t i = 0; i < num_lanes && i < (size_t) num_groups; ++i)
+            util::wait_stream(m_pipeline_streams[i], m_stream);
+        release_local_means();
+        return 0;
+    }
+
     template <typename Tensor>
     int backward_stage1(const Tensor& input,
                         const Tensor& d_output,
@@ -483,6 +712,74 @@ private:
     std::unique_ptr<tensor::Allreduce<DataType>> m_allreducer;
     BatchnormImpl m_impl;
     bool m_global_stats;
+    // Use Welford's algorithm for the statistics instead of sums of
+    // squares, which lose precision when the variance is small relative
+    // to the mean.
+    bool m_welford;
+    // Local number of elements per channel of the last forward pass,
+    // and the number of elements per channel of its statistics
+    index_t m_local_num_per_sum;
+    index_t m_num_per_sum;
+    // Local channel means kept from forward_stage1 to
+    // forward_allreduce
+    DataType* m_local_means;
+    // Number of channel groups of forward_pipelined, and the streams
+    // and allreducers the groups are distributed over
+    int m_num_pipeline_groups;
+    std::vector<h2::gpu::DeviceStream> m_pipeline_streams;
+    std::vector<std::unique_ptr<tensor::Allreduce<DataType>>>
+        m_pipeline_allreducers;
+
+    static int get_pipeline_groups()
+    {
+        auto env = std::getenv("DISTCONV_BN_PIPELINE_GROUPS");
+        int groups = env ? std::atoi(env) : 1;
+        return groups > 1 ? groups : 1;
+    }
+
+    template <typename Tensor>
+    void channel_welford(const Tensor& input, Tensor& sums, Tensor& m2s)
+    {
+        prepare_welford(input, sums);
+        batchnorm::channel_welford<Tensor>(m_num_dims,
+                                           m_num_current_samples,
+                                           m_num_per_sum,
+                                           input,
+                                           sums,
+                                           m2s,
+                                           m_local_means,
+                                           0,
+                                           (int) sums.get_local_size(),
+                                           m_stream);
+    }
+
+    template <typename Tensor>
+    void prepare_welford(const Tensor& input, const Tensor& sums)
+    {
+        const auto& local_shape = input.get_local_shape();
+        m_local_num_per_sum =
+            (input.get_local_size() == 0 || !input.is_split_root())
+                ? 0
+                : local_shape.get_size() / local_shape[-2];
+        const auto stat_shape =
+            m_global_stats ? input.get_shape() : local_shape;
+        m_num_per_sum = stat_shape.get_size() / stat_shape[-2];
+        release_local_means();
+        if (m_global_stats)
+        {
+            m_local_means = static_cast<DataType*>(
+                internal::RuntimeGPU::get_device_memory_pool().get(
+                    sums.get_local_size() * sizeof(DataType), m_stream));
+        }
+    }
+
+    void release_local_means()
+    {
+        if (m_local_means == nullptr)
+            return;
+        internal::RuntimeGPU::get_device_memory_pool().release(m_local_means);
+        m_local_means = nullptr;
+    }
 
     template <typename Tensor>
     void channel_sums_and_sqsums(const Tensor& input, Tensor& mean, Tensor& var)
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "distconv/base.hpp"
+
+#include <Al.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace distconv
+{
+
+// Alpha-beta model of a ring allgather or reduce-scatter of a buffer
+// of `bytes` bytes (the gathered size) among q processes:
+//   (q - 1) * latency + (q - 1) / q * bytes * time_per_byte.
+struct CollectiveCost
+{
+    // Seconds per step
+    double latency = 0;
+    // Seconds per byte
+    double time_per_byte = 0;
+
+    double operator()(double bytes, int q) const
+    {
+        if (q <= 1)
+            return 0;
+        return (q - 1) * latency + (q - 1) * bytes * time_per_byte / q;
+    }
+};
+
+struct ChanfiltCostModel
+{
+    CollectiveCost allgather;
+    CollectiveCost reduce_scatter;
+};
+
+// Measures the allgather and reduce-scatter costs on comm, on its
+// stream, with a small and a large message, taking the slowest rank.
+// The result is cached per communicator. All processes of comm must
+// call this.
+const ChanfiltCostModel&
+get_chanfilt_cost_model(Al::NCCLBackend::comm_type& comm);
+
+// A convolution with channel/filter parallelism, as the local sizes
+// of its tensors with all of their channels or filters.
+struct ChanfiltProblem
+{
+    // Bytes of the local input (and of its gradient)
+    double input_bytes;
+    // Bytes of the local output (and of its gradient)
+    double output_bytes;
+    // Number of processes the channels of the input are split among
+    int num_segments;
+    // For W, the splits of the filter channels and filters
+    int filter_channel_split = 1;
+    int filter_filter_split = 1;
+};
+
+// Estimates the time, in seconds, of the channel/filter communication
+// of a training iteration (forward, backward data and backward filter)
+// with algo:
+// - X reduce-scatters the output and allgathers its gradient.
+// - Y allgathers the input and reduce-scatters its gradient.
+// - W does both among the subgroups of its 2-D filter split.
+// The convolutions take the same number of operations with all of the
+// algorithms, so the time compute_time[algo] (e.g., measured by
+// autotuning) is added if given.
+double estimate_chanfilt_time(ChannelParallelismAlgorithm algo,
+                              const ChanfiltProblem& problem,
+                              const ChanfiltCostModel& model,
+                              double compute_time = 0);
+
+// Returns the candidate with the lowest estimated time.
+ChannelParallelismAlgorithm select_chanfilt_algorithm_by_cost(
+    const std::vector<ChannelParallelismAlgorithm>& candidates,
+    const ChanfiltProblem& problem,
+    const ChanfiltCostModel& model);
+
+} // namespace distconv
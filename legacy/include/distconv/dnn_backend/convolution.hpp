@@ -2,8 +2,11 @@
 
 #include "distconv/distconv.hpp"
 #include "distconv/dnn_backend/backend.hpp"
+#include "distconv/dnn_backend/chanfilt_cost.hpp"
+#include "distconv/dnn_backend/depthwise_convolution.hpp"
 #include "distconv/dnn_backend/dnn_backend.hpp"
 #include "distconv/dnn_backend/halo_exchange_factory.hpp"
+#include "distconv/dnn_backend/phase_profile.hpp"
 #include "distconv/layers.hpp"
 #include "distconv/runtime_gpu.hpp"
 #include "distconv/util/util_gpu.hpp"
@@ -11,7 +14,14 @@
 
 #include <Al.hpp>
 
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <initializer_list>
+#include <limits>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace distconv
 {
@@ -110,6 +120,11 @@ public:
         GPUDNNBackend::destroy_tensor_descriptor(m_d_output_gathered_d);
         GPUDNNBackend::destroy_tensor_descriptor(m_d_input_all_channels_d);
         destroy_profiling_events();
+        if (m_overlap_tune_active)
+        {
+            h2::gpu::destroy(m_event_tune_start);
+            h2::gpu::destroy(m_event_tune_end);
+        }
     }
 
     // Just don't copy these!
@@ -139,6 +154,10 @@ public:
         // empty.
         setup_halo_xch(input, d_output);
 
+        m_skip_bp_data = skip_bp_data;
+        m_deconv = deconv;
+        setup_groups(input, filter, output, num_groups);
+
         if (input.get_local_size() == 0 || output.get_local_size() == 0)
         {
             util::MPIPrintStreamInfo() << "Empty tensor detected";
@@ -149,9 +168,6 @@ public:
 
         select_chanfilt_algorithm(input, filter, output);
 
-        m_skip_bp_data = skip_bp_data;
-        m_deconv = deconv;
-
         std::vector<int> stencil_dims(m_num_spatial_dims, 0);
         for (int i = 0; i < m_num_spatial_dims; ++i)
         {
@@ -191,14 +207,39 @@ public:
         util::MPIPrintStreamDebug() << "halo size: " << m_halo_fwd_recv[1]
                                     << ", " << m_halo_bwd_recv[1];
 
+        // When autotuning, whether to overlap is decided by timing both
+        // variants, or by an earlier decision for the same geometry.
+        bool const autotune_overlap =
+            m_overlap_halo_exchange_fwd && get_overlap_autotune_iters() > 0;
+        bool tune_overlap = autotune_overlap;
+        if (autotune_overlap)
+        {
+            m_overlap_tune_key =
+                get_overlap_tune_key(input, filter, strides, dilations);
+            auto const& decisions = get_overlap_decisions();
+            auto const decision = decisions.find(m_overlap_tune_key);
+            if (decision != decisions.end())
+            {
+                m_overlap_halo_exchange_fwd = decision->second;
+                tune_overlap = false;
+                util::MPIRootPrintStreamDebug()
+                    << "Reusing the tuned forward halo exchange overlap ("
+                    << m_overlap_halo_exchange_fwd << ") for "
+                    << m_overlap_tune_key;
+            }
+        }
+
         if (m_overlap_halo_exchange_fwd)
         {
             // Disables fwd overlapping for tensors with small spatial domains
-            // as it would be unlikely to be profitable.
+            // as it would be unlikely to be profitable. With autotuning,
+            // only domains too small to split into an interior and
+            // boundaries are excluded.
+            index_t const min_domain_factor = autotune_overlap ? 2 : 3;
             for (int i = 0; i < m_num_spatial_dims; ++i)
             {
-                // TODO: Parameterize the constant "3"?
-                if (input.get_local_shape()[i] < (index_t) stencil_dims[i] * 3)
+                if (input.get_local_shape()[i]
+                    < (index_t) stencil_dims[i] * min_domain_factor)
                 {
                     util::MPIRootPrintStreamInfo()
                         << "Overlapped halo exchange in forward convolution "
@@ -250,6 +291,22 @@ public:
             m_overlap_halo_exchange_bwd = false;
         }
 
+        if (tune_overlap)
+        {
+            // All ranks must time the layer, as the timings are reduced.
+            int tune = m_overlap_halo_exchange_fwd;
+            DISTCONV_CHECK_MPI(MPI_Allreduce(MPI_IN_PLACE,
+                                             &tune,
+                                             1,
+                                             MPI_INT,
+                                             MPI_LAND,
+                                             input.get_locale().get_comm()));
+            if (tune)
+            {
+                start_overlap_tuning();
+            }
+        }
+
         if (m_overlap_halo_exchange_fwd)
         {
             util::MPIRootPrintStreamDebug() << "Overlapping of halo exchanges "
@@ -270,13 +327,16 @@ public:
                                  d_output,
                                  strides,
                                  dilations);
+        // Smaller minibatches, e.g., the last one of an epoch, reuse
+        // the descriptors, algorithms and buffers set up for this one.
+        m_max_num_samples = GPUDNNBackend::get_tensor_num_samples(m_input_d);
 
         setup_convolution_descriptor(input.get_overlap(),
                                      filter.get_shape(),
                                      pads,
                                      strides,
                                      dilations,
-                                     num_groups,
+                                     m_local_num_groups,
                                      m_conv_fwd_d,
                                      m_conv_bwd_d,
                                      m_conv_bwd_filter_d);
@@ -284,6 +344,18 @@ public:
                                     << "\n bwd data: " << m_conv_bwd_d
                                     << "\n bwd filter: " << m_conv_bwd_filter_d;
 
+        m_use_depthwise_kernel =
+            !m_deconv && m_chanfilt_algo == ChannelParallelismAlgorithm::NONE
+            && get_depthwise_kernel()
+            && depthwise_convolution::is_supported(
+                m_input_d, m_filter_d, m_conv_fwd_d, m_output_d);
+        if (m_use_depthwise_kernel)
+        {
+            util::MPIRootPrintStreamDebug()
+                << "Using the depthwise convolution kernel in forward "
+                   "convolution";
+        }
+
         m_fwd_find_algo = fwd_algo;
         m_bwd_data_find_algo = bwd_data_algo;
         m_bwd_filter_find_algo = bwd_filter_algo;
@@ -358,11 +430,46 @@ public:
             return 0;
         }
 
+        if (!dump_profile
+            && can_graph_pass(skip_halo_exchange, m_overlap_halo_exchange_fwd))
+        {
+            return run_graphed("forward",
+                               LayerGraphCache::make_signature(
+                                   alpha,
+                                   beta,
+                                   skip_halo_exchange,
+                                   inference,
+                                   input.get_buffer(),
+                                   input.get_local_shape(),
+                                   filter.get_const_buffer(),
+                                   output.get_buffer(),
+                                   output.get_local_shape()),
+                               [&]() {
+                                   return forward(alpha,
+                                                  input,
+                                                  filter,
+                                                  beta,
+                                                  output,
+                                                  skip_halo_exchange,
+                                                  skip_chanfilt_comm,
+                                                  dump_profile,
+                                                  inference);
+                               });
+        }
+
         if (m_be.profiling())
         {
             GPU_PROFILE_RANGE_PUSH("conv/forward");
         }
 
+        // The halo exchange is part of the timed region, so calls that
+        // skip it are not timed.
+        bool const time_overlap = m_overlap_tune_active && !skip_halo_exchange;
+        if (time_overlap)
+        {
+            GPUDNNBackend::record_event(m_event_tune_start, m_be.get_stream());
+        }
+
         set_num_samples(input.get_local_shape()[-1]);
 
         if (m_chanfilt_algo == ChannelParallelismAlgorithm::X
@@ -391,27 +498,14 @@ public:
         setup_workspace_size_fwd();
         setup_workspace_size_fwd_boundaries();
 
-        void* ws = internal::RuntimeGPU::get_device_memory_pool().get(
-            m_ws_size_fwd, m_be.get_stream());
+        void* ws =
+            WorkspaceArena::instance().get(m_ws_size_fwd, m_be.get_stream());
 
         if (ws == nullptr)
             return -1;
 
         if (!skip_halo_exchange)
-        {
-            // Zero-clear the halo region of the input
-            for (int dim = 0; dim < m_num_spatial_dims; ++dim)
-            {
-                const auto& dist = input.get_distribution();
-                if (dist.is_distributed(dim) && dist.get_locale_shape()[dim] > 1
-                    && dist.get_overlap(dim) > 0)
-                {
-                    input.clear_halo(dim, m_be.get_stream());
-                }
-            }
-
-            forward_exchange_halo(input);
-        }
+            clear_and_exchange_halo_fwd(input);
 
         const void* input_ptr =
             input.get_const_base_ptr()
@@ -422,7 +516,49 @@ public:
             GPU_PROFILE_RANGE_PUSH("conv/forward/forward");
         }
 
-        if (!m_overlap_halo_exchange_fwd)
+        // Whether the reduce-scatter of the partial outputs is
+        // overlapped with the convolution.
+        bool const overlap_chanfilt =
+            !skip_chanfilt_comm && m_chanfilt_overlap_chunks > 1
+            && (m_chanfilt_algo == ChannelParallelismAlgorithm::X
+                || m_chanfilt_algo == ChannelParallelismAlgorithm::W);
+
+        if (overlap_chanfilt)
+        {
+            record_start_comp();
+            bool const x = m_chanfilt_algo == ChannelParallelismAlgorithm::X;
+            auto& x_d = x ? m_input_d : m_input_gathered_d;
+            const DataType* x_ptr =
+                x ? static_cast<const DataType*>(input_ptr)
+                  : m_input_gathered_t.get_const_base_ptr();
+            index_t const x_stride =
+                x ? get_sample_stride(input)
+                  : get_sample_stride(m_input_gathered_t);
+            index_t const y_stride = get_sample_stride(m_output_all_filters_t);
+            overlap_reduce_scatter_chanfilt(
+                m_output_all_filters_t,
+                output,
+                false,
+                {&x_d, &m_output_all_filters_d},
+                [&](index_t offset) {
+                    m_be.convolution_forward(
+                        alpha,
+                        x_d,
+                        x_ptr + offset * x_stride,
+                        m_filter_d,
+                        filter.get_const_base_ptr(),
+                        m_conv_fwd_d,
+                        m_fwd_algo,
+                        ws,
+                        m_ws_size_fwd,
+                        beta,
+                        m_output_all_filters_d,
+                        m_output_all_filters_t.get_base_ptr()
+                            + offset * y_stride);
+                });
+            record_end_comp();
+        }
+        else if (!m_overlap_halo_exchange_fwd)
         {
             record_start_comp();
             if (m_chanfilt_algo == ChannelParallelismAlgorithm::X)
@@ -504,18 +640,17 @@ public:
                     ensure_tensors_conform(input, output, filter, "forward");
                     ensure_tensor_descriptors_conform(
                         m_input_d, m_output_d, m_filter_d, "forward");
-                    m_be.convolution_forward(alpha,
-                                             m_input_d,
-                                             input_ptr,
-                                             m_filter_d,
-                                             filter.get_const_base_ptr(),
-                                             m_conv_fwd_d,
-                                             m_fwd_algo,
-                                             ws,
-                                             m_ws_size_fwd,
-                                             beta,
-                                             m_output_d,
-                                             output.get_base_ptr());
+                    convolution_forward_local(alpha,
+                                              m_input_d,
+                                              input_ptr,
+                                              filter.get_const_base_ptr(),
+                                              m_fwd_algo,
+                                              ws,
+                                              m_ws_size_fwd,
+                                              beta,
+                                              m_output_d,
+                                              output.get_base_ptr(),
+                                              m_be.get_stream());
                 }
                 else
                 {
@@ -546,23 +681,30 @@ public:
                 void* output_interior_ptr =
                     output.get_buffer() + m_output_interior_offset;
 
-                m_be.convolution_forward(alpha,
-                                         m_input_interior_d,
-                                         input_interior_ptr,
-                                         m_filter_d,
-                                         filter.get_const_base_ptr(),
-                                         m_conv_fwd_d,
-                                         m_fwd_algo,
-                                         ws,
-                                         m_ws_size_fwd,
-                                         beta,
-                                         m_output_interior_d,
-                                         output_interior_ptr);
+                convolution_forward_local(alpha,
+                                          m_input_interior_d,
+                                          input_interior_ptr,
+                                          filter.get_const_base_ptr(),
+                                          m_fwd_algo,
+                                          ws,
+                                          m_ws_size_fwd,
+                                          beta,
+                                          m_output_interior_d,
+                                          output_interior_ptr,
+                                          m_be.get_stream());
             }
             record_end_comp();
             apply_to_spatial_sides(m_num_dims, [&](int i, Side side) {
                 if (!m_boundary_req(i, side))
                     return;
+                if (side == RHS && m_boundary_batched(i, LHS))
+                {
+                    // Computed with the LHS once the RHS halo is ready;
+                    // it is timed as part of the LHS.
+                    record_start_boundary(i, side);
+                    record_end_boundary(i, side);
+                    return;
+                }
                 const void* boundary_input_ptr =
                     input.get_const_buffer()
                     + m_input_boundary_offsets(i, side);
@@ -570,35 +712,36 @@ public:
                     output.get_buffer() + m_output_boundary_offsets(i, side);
                 h2::gpu::DeviceStream st_boundary =
                     get_boundary_stream(i, side);
-                void* ws_boundary =
-                    internal::RuntimeGPU::get_device_memory_pool().get(
-                        m_ws_size_fwd_boundaries(i, side), st_boundary);
+                if (m_boundary_batched(i, side))
+                {
+                    util::wait_stream(get_boundary_stream(i, RHS),
+                                      st_boundary);
+                }
+                void* ws_boundary = WorkspaceArena::instance().get(
+                    m_ws_size_fwd_boundaries(i, side), st_boundary);
                 util::MPIPrintStreamDebug()
                     << "Launching convolution of boundary at dimension " << i
                     << ", side: " << side;
                 record_start_boundary(i, side);
 
-                m_be.convolution_forward(alpha,
-                                         m_input_boundaries_d(i, side),
-                                         boundary_input_ptr,
-                                         m_filter_d,
-                                         filter.get_const_base_ptr(),
-                                         m_conv_fwd_d,
-                                         m_fwd_boundary_algos(i, side),
-                                         ws_boundary,
-                                         m_ws_size_fwd_boundaries(i, side),
-                                         beta,
-                                         m_output_boundaries_d(i, side),
-                                         boundary_output_ptr,
-                                         st_boundary);
+                convolution_forward_local(alpha,
+                                          m_input_boundaries_d(i, side),
+                                          boundary_input_ptr,
+                                          filter.get_const_base_ptr(),
+                                          m_fwd_boundary_algos(i, side),
+                                          ws_boundary,
+                                          m_ws_size_fwd_boundaries(i, side),
+                                          beta,
+                                          m_output_boundaries_d(i, side),
+                                          boundary_output_ptr,
+                                          st_boundary);
                 record_end_boundary(i, side);
-                internal::RuntimeGPU::get_device_memory_pool().release(
-                    ws_boundary);
                 util::wait_stream(st_boundary, m_be.get_stream());
             });
+            record_end_boundary_wait();
         }
 
-        if (!skip_chanfilt_comm
+        if (!skip_chanfilt_comm && !overlap_chanfilt
             && (m_chanfilt_algo == ChannelParallelismAlgorithm::X
                 || m_chanfilt_algo == ChannelParallelismAlgorithm::W))
         {
@@ -619,7 +762,11 @@ public:
             release_tmp_tensor_buffer(m_input_gathered_t);
         }
 
-        internal::RuntimeGPU::get_device_memory_pool().release(ws);
+        if (time_overlap)
+        {
+            GPUDNNBackend::record_event(m_event_tune_end, m_be.get_stream());
+            record_overlap_timing(input.get_locale().get_comm());
+        }
 
         if (m_be.profiling())
         {
@@ -633,11 +780,116 @@ public:
         }
 
         if (dump_profile)
-            dump_profile_statistics(true, true, true);
+            dump_profile_statistics(
+                ConvPass::FORWARD, !skip_halo_exchange, true);
 
         return 0;
     }
 
+    // Computes output = act(alpha * conv(input) + beta * output + bias)
+    // with one fused kernel if the vendor library can fuse them for
+    // this layer (e.g., cuDNN fuses ReLU), which saves two passes over
+    // the output. Otherwise, this falls back to forward, apply_bias and
+    // an in-place activation. setup_bias must have been called.
+    template <typename Allocator>
+    int forward_bias_activation(
+        DataType alpha,
+        tensor::Tensor<DataType, LocaleMPI, Allocator>& input,
+        const tensor::Tensor<DataType, LocaleMPI, Allocator>& filter,
+        const tensor::Tensor<DataType, LocaleMPI, Allocator>& bias,
+        const GPUDNNBackend::ActivationDescriptor_t& act_desc,
+        DataType beta,
+        tensor::Tensor<DataType, LocaleMPI, Allocator>& output,
+        bool skip_halo_exchange = false,
+        bool inference = false)
+    {
+        if (input.get_local_size() == 0 || filter.get_local_size() == 0
+            || output.get_local_size() == 0)
+        {
+            util::MPIPrintStreamDebug()
+                << "Skipping forward convolution with an empty tensor";
+            return 0;
+        }
+
+        // Only the plain convolution is fused; the halo exchange is done
+        // before it.
+        bool const fusable = m_fuse_bias_activation
+                             && m_chanfilt_algo
+                                    == ChannelParallelismAlgorithm::NONE
+                             && !m_deconv && !m_overlap_halo_exchange_fwd
+                             && !m_overlap_tune_active
+                             && !m_use_depthwise_kernel;
+        if (fusable)
+        {
+            set_num_samples(input.get_local_shape()[-1]);
+            setup_algorithms_fwd(
+                input.get_buffer(), filter.get_buffer(), output.get_buffer());
+            setup_workspace_size_fwd();
+            void* ws = WorkspaceArena::instance().get(m_ws_size_fwd,
+                                                      m_be.get_stream());
+            if (ws == nullptr)
+                return -1;
+
+            if (!skip_halo_exchange)
+                clear_and_exchange_halo_fwd(input);
+            skip_halo_exchange = true;
+
+            const void* input_ptr =
+                input.get_const_base_ptr()
+                - input.get_local_offset(IndexVector(m_halo_bwd_recv), true);
+            ensure_tensors_conform(input, output, filter, "fused forward");
+            ensure_tensor_descriptors_conform(
+                m_input_d, m_output_d, m_filter_d, "fused forward");
+            record_start_comp();
+            bool const fused = m_be.convolution_bias_activation_forward(
+                alpha,
+                m_input_d,
+                input_ptr,
+                m_filter_d,
+                filter.get_const_base_ptr(),
+                m_conv_fwd_d,
+                m_fwd_algo,
+                ws,
+                m_ws_size_fwd,
+                beta,
+                m_bias_d,
+                bias.get_const_base_ptr(),
+                act_desc,
+                m_output_d,
+                output.get_base_ptr());
+            record_end_comp();
+            if (fused)
+                return 0;
+            // The result depends on the descriptors only, so do not try
+            // again.
+            util::MPIRootPrintStreamInfo()
+                << "Fused convolution, bias and activation not supported; "
+                   "falling back to separate operations";
+            m_fuse_bias_activation = false;
+        }
+
+        int const ret = forward(alpha,
+                                input,
+                                filter,
+                                beta,
+                                output,
+                                skip_halo_exchange,
+                                false,
+                                false,
+                                inference);
+        if (ret != 0)
+            return ret;
+        apply_bias(DataType(1), bias, DataType(1), output);
+        m_be.activation_forward(act_desc,
+                                1.,
+                                m_output_d,
+                                output.get_const_base_ptr(),
+                                0.,
+                                m_output_d,
+                                output.get_base_ptr());
+        return 0;
+    }
+
     template <typename TensorType>
     int apply_bias(typename TensorType::data_type alpha,
                    const TensorType& bias,
@@ -703,6 +955,31 @@ public:
             return 0;
         }
 
+        if (!dump_profile
+            && can_graph_pass(skip_halo_exchange, m_overlap_halo_exchange_bwd))
+        {
+            return run_graphed("backward_data",
+                               LayerGraphCache::make_signature(
+                                   alpha,
+                                   beta,
+                                   skip_halo_exchange,
+                                   filter.get_const_buffer(),
+                                   d_output.get_buffer(),
+                                   d_output.get_local_shape(),
+                                   d_input.get_buffer(),
+                                   d_input.get_local_shape()),
+                               [&]() {
+                                   return backward_data(alpha,
+                                                        filter,
+                                                        d_output,
+                                                        beta,
+                                                        d_input,
+                                                        skip_halo_exchange,
+                                                        skip_chanfilt_comm,
+                                                        dump_profile);
+                               });
+        }
+
         // Handle case where backward_filter was not called.
         if ((m_chanfilt_algo == ChannelParallelismAlgorithm::X
              || m_chanfilt_algo == ChannelParallelismAlgorithm::W)
@@ -725,8 +1002,8 @@ public:
             d_input.get_buffer(), filter.get_buffer(), d_output.get_buffer());
         setup_workspace_size_bwd_data();
 
-        void* ws = internal::RuntimeGPU::get_device_memory_pool().get(
-            m_ws_size_bwd_data, m_be.get_stream());
+        void* ws = WorkspaceArena::instance().get(m_ws_size_bwd_data,
+                                                  m_be.get_stream());
         if (ws == nullptr)
             return -1;
 
@@ -738,8 +1015,49 @@ public:
             unpack_halo(d_output, m_halo_xch_d_output);
         }
 
+        // Whether the reduce-scatter of the partial input gradients is
+        // overlapped with the convolution.
+        bool const overlap_chanfilt =
+            !skip_chanfilt_comm && m_chanfilt_overlap_chunks > 1
+            && (m_chanfilt_algo == ChannelParallelismAlgorithm::Y
+                || m_chanfilt_algo == ChannelParallelismAlgorithm::W);
+
         record_start_comp();
-        if (m_chanfilt_algo == ChannelParallelismAlgorithm::X)
+        if (overlap_chanfilt)
+        {
+            bool const y = m_chanfilt_algo == ChannelParallelismAlgorithm::Y;
+            auto& dy_d = y ? m_d_output_d : m_d_output_gathered_d;
+            const DataType* dy_ptr =
+                y ? d_output.get_const_buffer()
+                  : m_d_output_gathered_t.get_const_buffer();
+            index_t const dy_stride =
+                y ? get_sample_stride(d_output)
+                  : get_sample_stride(m_d_output_gathered_t);
+            index_t const dx_stride =
+                get_sample_stride(m_d_input_all_channels_t);
+            overlap_reduce_scatter_chanfilt(
+                m_d_input_all_channels_t,
+                d_input,
+                true,
+                {&dy_d, &m_d_input_all_channels_d},
+                [&](index_t offset) {
+                    m_be.convolution_bwd_data(
+                        alpha,
+                        m_filter_d,
+                        filter.get_const_base_ptr(),
+                        dy_d,
+                        dy_ptr + offset * dy_stride,
+                        m_conv_bwd_d,
+                        m_bwd_data_algo,
+                        ws,
+                        m_ws_size_bwd_data,
+                        beta,
+                        m_d_input_all_channels_d,
+                        m_d_input_all_channels_t.get_base_ptr()
+                            + offset * dx_stride);
+                });
+        }
+        else if (m_chanfilt_algo == ChannelParallelismAlgorithm::X)
         {
             ensure_tensors_conform(d_input,
                                    m_d_output_gathered_t,
@@ -850,7 +1168,7 @@ public:
                                          d_input_ptr);
             }
         }
-        if (!skip_chanfilt_comm
+        if (!skip_chanfilt_comm && !overlap_chanfilt
             && (m_chanfilt_algo == ChannelParallelismAlgorithm::Y
                 || m_chanfilt_algo == ChannelParallelismAlgorithm::W))
         {
@@ -868,10 +1186,10 @@ public:
         {
             release_tmp_tensor_buffer(m_d_input_all_channels_t);
         }
-        internal::RuntimeGPU::get_device_memory_pool().release(ws);
 
         if (dump_profile)
-            dump_profile_statistics(true, false, false);
+            dump_profile_statistics(
+                ConvPass::BACKWARD_DATA, !skip_halo_exchange, false);
         return 0;
     }
 
@@ -895,6 +1213,30 @@ public:
             return 0;
         }
 
+        // The gradient allreduce is not captured.
+        if (!reduce && !dump_profile && can_graph_pass(true, false))
+        {
+            return run_graphed("backward_filter",
+                               LayerGraphCache::make_signature(
+                                   alpha,
+                                   beta,
+                                   input.get_const_buffer(),
+                                   input.get_local_shape(),
+                                   d_output.get_buffer(),
+                                   d_output.get_local_shape(),
+                                   d_filter.get_buffer()),
+                               [&]() {
+                                   return backward_filter(alpha,
+                                                          input,
+                                                          d_output,
+                                                          beta,
+                                                          d_filter,
+                                                          reduce,
+                                                          skip_chanfilt_comm,
+                                                          dump_profile);
+                               });
+        }
+
         set_num_samples(input.get_local_shape()[-1]);
 
         if (m_chanfilt_algo == ChannelParallelismAlgorithm::X
@@ -941,8 +1283,8 @@ public:
         }
         else
         {
-            void* ws = internal::RuntimeGPU::get_device_memory_pool().get(
-                m_ws_size_bwd_filter, m_be.get_stream());
+            void* ws = WorkspaceArena::instance().get(m_ws_size_bwd_filter,
+                                                      m_be.get_stream());
             if (ws == nullptr)
                 return -1;
 
@@ -1084,8 +1426,6 @@ public:
                 }
             }
 
-            internal::RuntimeGPU::get_device_memory_pool().release(ws);
-
             util::MPIPrintStreamDebug() << "Bp filter done";
         }
 
@@ -1101,7 +1441,7 @@ public:
             allreduce_gradients(d_filter);
 
         if (dump_profile)
-            dump_profile_statistics(false, false, false);
+            dump_profile_statistics(ConvPass::BACKWARD_FILTER, false, false);
 
         return 0;
     }
@@ -1137,13 +1477,16 @@ public:
             allreduce_gradients(bias_gradient);
 
         if (dump_profile)
-            dump_profile_statistics(false, false, false);
+            dump_profile_statistics(ConvPass::BACKWARD_BIAS, false, false);
         return 0;
     }
 
     // Wait for asynchronous tasks
     void wait() { m_be.wait(); }
 
+    // Only the sample count of the tensor descriptors changes. Up to
+    // the number of samples given at setup, the algorithms, workspaces
+    // and halo buffers of the setup-time minibatch are reused.
     void set_num_samples(int n)
     {
         assert_ne(n, 0);
@@ -1189,6 +1532,26 @@ public:
         return m_overlap_halo_exchange_bwd;
     }
 
+    // Phase times of the passes called with dump_profile when
+    // profiling is enabled.
+    const ConvPhaseProfile& get_phase_profile() const
+    {
+        return m_phase_profile;
+    }
+
+    void clear_phase_profile() { m_phase_profile.clear(); }
+
+    // Overrides DISTCONV_HALO_TRANSFER_PRECISION for this layer, e.g.,
+    // to keep the native precision for layers sensitive to rounding.
+    // Must be called after setup with the same value on all ranks.
+    void
+    set_halo_transfer_precision(tensor::HaloTransferPrecision precision)
+    {
+        assert_always(m_halo_xch_input != nullptr);
+        m_halo_xch_input->set_transfer_precision(precision);
+        m_halo_xch_d_output->set_transfer_precision(precision);
+    }
+
     GPUDNNBackend::ConvFwdAlgo_t get_fwd_algo() const { return m_fwd_algo; }
 
     GPUDNNBackend::ConvBwdDataAlgo_t get_bwd_data_algo() const
@@ -1240,8 +1603,11 @@ protected:
     using AlgoCache = std::unordered_map<int, AlgoTuple>;
 
     AlgoCache m_fwd_algo_cache;
+    AlgoCache m_fwd_overlap_algo_cache;
     AlgoCache m_bwd_data_algo_cache;
     AlgoCache m_bwd_filter_algo_cache;
+    // Number of local samples the layer was set up with
+    int m_max_num_samples = 0;
     std::string m_fwd_find_algo;
     std::string m_bwd_data_find_algo;
     std::string m_bwd_filter_find_algo;
@@ -1254,6 +1620,19 @@ protected:
 
     bool m_overlap_halo_exchange_fwd;
     bool m_overlap_halo_exchange_bwd;
+
+    // Cleared once the vendor library turns down fusing this layer's
+    // convolution with the bias and activation.
+    bool m_fuse_bias_activation = true;
+
+    // State of the forward overlap autotuning (DISTCONV_OVERLAP_AUTOTUNE).
+    bool m_overlap_tune_active = false;
+    int m_overlap_tune_step = 0;
+    int m_overlap_tune_iters = 0;
+    float m_overlap_tune_times[2] = {0.0f, 0.0f};
+    std::string m_overlap_tune_key;
+    GPUDNNBackend::Event_t m_event_tune_start;
+    GPUDNNBackend::Event_t m_event_tune_end;
     GPUDNNBackend::TensorDescriptor_t m_input_interior_d;
     GPUDNNBackend::TensorDescriptor_t m_output_interior_d;
     bool m_interior_req;
@@ -1269,6 +1648,21 @@ protected:
     BoundaryAttributesV<h2::gpu::DeviceStream> m_boundary_streams;
     BoundaryAttributesV<std::shared_ptr<Al::NCCLBackend::comm_type>>
         m_boundary_comms;
+    // Set at (dim, LHS) when both boundaries of dim are computed by
+    // one convolution described by the LHS descriptors.
+    BoundaryAttributesV<bool> m_boundary_batched = false;
+    // Whether a pass is running through run_graphed.
+    bool m_graphing = false;
+
+    // Number of groups of a grouped convolution, and of the groups
+    // held by this process.
+    int m_num_groups = 1;
+    int m_local_num_groups = 1;
+    // Set when the channels are partitioned with whole groups per
+    // process, so no channel/filter communication is needed.
+    bool m_group_partitioned = false;
+    // Whether forward convolutions use the depthwise kernel.
+    bool m_use_depthwise_kernel = false;
 
     bool m_enable_profiling;
     GPUDNNBackend::Event_t m_event_comp_start;
@@ -1277,6 +1671,9 @@ protected:
     GPUDNNBackend::Event_t m_event_exchange_end;
     BoundaryAttributesV<GPUDNNBackend::Event_t> m_event_start_boundaries;
     BoundaryAttributesV<GPUDNNBackend::Event_t> m_event_end_boundaries;
+    // Recorded on the main stream once it has waited for the boundaries
+    GPUDNNBackend::Event_t m_event_boundary_wait_end;
+    ConvPhaseProfile m_phase_profile;
 
     ChannelParallelismAlgorithm m_chanfilt_algo;
     // TODO: Maybe don't hardcode the allocator...
@@ -1294,6 +1691,136 @@ protected:
     GPUDNNBackend::TensorDescriptor_t m_d_input_all_channels_d;
     index_t m_chanfilt_segments = 1;
     tensor::ChannelExchange<DataType> m_channel_exchange;
+    // Number of sample chunks the reduce-scatters of chanfilt
+    // convolutions are pipelined over; 1 disables the overlap.
+    int m_chanfilt_overlap_chunks = get_chanfilt_overlap_chunks();
+    h2::gpu::DeviceStream m_chanfilt_stream = nullptr;
+    // Filter and channel communicators on m_chanfilt_stream.
+    std::unique_ptr<Al::NCCLBackend::comm_type> m_chanfilt_overlap_comms[2];
+
+    static int get_chanfilt_overlap_chunks()
+    {
+        auto env = std::getenv("DISTCONV_CHANFILT_OVERLAP_CHUNKS");
+        int chunks = env ? std::atoi(env) : 1;
+        return chunks > 1 ? chunks : 1;
+    }
+
+    // The depthwise kernel replaces the vendor library in forward
+    // depthwise convolutions unless DISTCONV_DEPTHWISE_KERNEL=0.
+    static bool get_depthwise_kernel()
+    {
+        auto env = std::getenv("DISTCONV_DEPTHWISE_KERNEL");
+        return env ? std::atoi(env) != 0 : true;
+    }
+
+    static bool get_batch_boundaries()
+    {
+        auto env = std::getenv("DISTCONV_BATCH_BOUNDARY_CONV");
+        return env ? std::atoi(env) != 0 : true;
+    }
+
+    // Number of timed forward calls per variant when autotuning the
+    // forward halo exchange overlap; 0 disables autotuning.
+    static int get_overlap_autotune_iters()
+    {
+        auto env = std::getenv("DISTCONV_OVERLAP_AUTOTUNE");
+        int iters = env ? std::atoi(env) : 0;
+        return iters > 0 ? iters : 0;
+    }
+
+    // Tuned overlap decisions, keyed by layer geometry. Shared by all
+    // layers so that repeated layers are only tuned once.
+    static std::unordered_map<std::string, bool>& get_overlap_decisions()
+    {
+        static std::unordered_map<std::string, bool> decisions;
+        return decisions;
+    }
+
+    // Global shapes are used so that all ranks agree on the key.
+    template <typename Allocator>
+    std::string get_overlap_tune_key(
+        const tensor::Tensor<DataType, LocaleMPI, Allocator>& input,
+        const tensor::Tensor<DataType, LocaleMPI, Allocator>& filter,
+        const int_vector& strides,
+        const int_vector& dilations) const
+    {
+        const auto input_shape = input.get_shape();
+        const auto filter_shape = filter.get_shape();
+        const auto locale_shape = input.get_distribution().get_locale_shape();
+        std::ostringstream ss;
+        ss << "input=" << util::tostring(input_shape.begin(), input_shape.end())
+           << " filter="
+           << util::tostring(filter_shape.begin(), filter_shape.end())
+           << " strides=" << util::tostring(strides.begin(), strides.end())
+           << " dilations="
+           << util::tostring(dilations.begin(), dilations.end())
+           << " halo="
+           << util::tostring(m_halo_fwd_recv.begin(), m_halo_fwd_recv.end())
+           << util::tostring(m_halo_bwd_recv.begin(), m_halo_bwd_recv.end())
+           << " locale="
+           << util::tostring(locale_shape.begin(), locale_shape.end())
+           << " method=" << m_halo_xch_method << " deconv=" << m_deconv;
+        return ss.str();
+    }
+
+    // Forward calls alternate between the overlapped (even steps) and
+    // non-overlapped (odd steps) variants. The first call of each
+    // variant also finds its algorithms, so it is not timed.
+    void start_overlap_tuning()
+    {
+        if (!m_overlap_tune_active)
+        {
+            m_event_tune_start = h2::gpu::make_event();
+            m_event_tune_end = h2::gpu::make_event();
+        }
+        m_overlap_tune_active = true;
+        m_overlap_tune_step = 0;
+        m_overlap_tune_iters = get_overlap_autotune_iters();
+        m_overlap_tune_times[0] = 0.0f;
+        m_overlap_tune_times[1] = 0.0f;
+        util::MPIRootPrintStreamDebug()
+            << "Autotuning forward halo exchange overlap for "
+            << m_overlap_tune_key;
+    }
+
+    void record_overlap_timing(MPI_Comm comm)
+    {
+        bool const is_overlap = m_overlap_tune_step % 2 == 0;
+        if (m_overlap_tune_step >= 2)
+        {
+            h2::gpu::sync(m_event_tune_end);
+            m_overlap_tune_times[is_overlap ? 0 : 1] +=
+                GPUDNNBackend::elapsed_time(m_event_tune_start,
+                                            m_event_tune_end);
+        }
+        ++m_overlap_tune_step;
+        if (m_overlap_tune_step < 2 * (m_overlap_tune_iters + 1))
+        {
+            m_overlap_halo_exchange_fwd = m_overlap_tune_step % 2 == 0;
+            return;
+        }
+
+        // The slowest rank determines the time of a layer.
+        DISTCONV_CHECK_MPI(MPI_Allreduce(MPI_IN_PLACE,
+                                         m_overlap_tune_times,
+                                         2,
+                                         MPI_FLOAT,
+                                         MPI_MAX,
+                                         comm));
+        m_overlap_halo_exchange_fwd =
+            m_overlap_tune_times[0] < m_overlap_tune_times[1];
+        get_overlap_decisions()[m_overlap_tune_key] =
+            m_overlap_halo_exchange_fwd;
+        util::MPIRootPrintStreamInfo()
+            << "Overlapped halo exchange in forward convolution "
+            << (m_overlap_halo_exchange_fwd ? "enabled" : "disabled")
+            << " by autotuning (" << m_overlap_tune_times[0] << " ms vs "
+            << m_overlap_tune_times[1] << " ms without overlap) for "
+            << m_overlap_tune_key;
+        h2::gpu::destroy(m_event_tune_start);
+        h2::gpu::destroy(m_event_tune_end);
+        m_overlap_tune_active = false;
+    }
 
     void setup_profiling_events()
     {
@@ -1303,6 +1830,7 @@ protected:
         m_event_comp_end = h2::gpu::make_event();
         m_event_exchange_start = h2::gpu::make_event();
         m_event_exchange_end = h2::gpu::make_event();
+        m_event_boundary_wait_end = h2::gpu::make_event();
         apply_to_spatial_sides(m_num_dims, [this](int i, Side side) {
             m_event_start_boundaries(i, side) = h2::gpu::make_event();
             m_event_end_boundaries(i, side) = h2::gpu::make_event();
@@ -1325,6 +1853,46 @@ protected:
         }
     }
 
+    // Whether a pass can be replayed from a graph (see
+    // DNNBackend::run_graphed). Host-side halo exchanges, channel and
+    // filter parallelism collectives, and timing events are not
+    // captured, so passes that use them always run directly.
+    bool can_graph_pass(bool skip_halo_exchange,
+                        bool overlap_halo_exchange) const
+    {
+        auto const is_zero = [](int v) { return v == 0; };
+        bool const no_halo =
+            std::all_of(m_halo_fwd_recv.begin(), m_halo_fwd_recv.end(), is_zero)
+            && std::all_of(
+                m_halo_bwd_recv.begin(), m_halo_bwd_recv.end(), is_zero);
+        return m_be.graph_capture() && !m_graphing && !m_be.profiling()
+               && !m_enable_profiling && !m_overlap_tune_active
+               && m_chanfilt_algo == ChannelParallelismAlgorithm::NONE
+               && !overlap_halo_exchange && (skip_halo_exchange || no_halo);
+    }
+
+    // Runs f, which calls the pass again, through the backend's graph
+    // cache.
+    template <typename F>
+    int run_graphed(char const* pass, std::string const& signature, F&& f)
+    {
+        int ret = 0;
+        m_graphing = true;
+        try
+        {
+            m_be.run_graphed(LayerGraphCache::make_signature(this, pass),
+                             signature,
+                             [&]() { ret = f(); });
+        }
+        catch (...)
+        {
+            m_graphing = false;
+            throw;
+        }
+        m_graphing = false;
+        return ret;
+    }
+
     void record_start_exchange()
     {
         if (m_enable_profiling)
@@ -1343,6 +1911,15 @@ protected:
         }
     }
 
+    void record_end_boundary_wait()
+    {
+        if (m_enable_profiling)
+        {
+            GPUDNNBackend::record_event(m_event_boundary_wait_end,
+                                        m_be.get_stream());
+        }
+    }
+
     void record_start_boundary(int i, Side side)
     {
         if (m_enable_profiling)
@@ -1361,16 +1938,22 @@ protected:
         }
     }
 
-    void dump_profile_statistics(bool halo_exchange,
-                                 bool has_boundary,
-                                 bool is_forward)
+    // Prints the times of the phases of the last call of pass and adds
+    // them to the phase profile.
+    void dump_profile_statistics(ConvPass pass,
+                                 bool halo_exchange,
+                                 bool has_boundary)
     {
         if (!m_enable_profiling)
             return;
         // DISTCONV_CHECK_GPU(h2::gpu::DeviceStream_SYNC(m_be.get_stream()));
         h2::gpu::sync();
+        bool const is_forward = pass == ConvPass::FORWARD;
+        m_phase_profile.add_call(pass);
         float main_elapsed =
             GPUDNNBackend::elapsed_time(m_event_comp_start, m_event_comp_end);
+        m_phase_profile.add_time(
+            pass, ConvPhase::INTERIOR_COMPUTE, main_elapsed);
         std::ostringstream ss;
         ss << "Convolution main: " << main_elapsed;
         if (halo_exchange)
@@ -1378,22 +1961,52 @@ protected:
             main_elapsed = GPUDNNBackend::elapsed_time(m_event_exchange_start,
                                                        m_event_exchange_end);
             ss << ", halo exhange: " << main_elapsed;
+            m_phase_profile.add_time(
+                pass, ConvPhase::HALO_EXCHANGE, main_elapsed);
+            auto& xch = is_forward ? m_halo_xch_input : m_halo_xch_d_output;
+            if (xch)
+            {
+                auto const t = xch->get_phase_times();
+                ss << " (pack: " << t.pack << ", transfer: " << t.transfer
+                   << ", unpack: " << t.unpack << ")";
+                m_phase_profile.add_time(pass, ConvPhase::HALO_PACK, t.pack);
+                m_phase_profile.add_time(
+                    pass, ConvPhase::HALO_TRANSFER, t.transfer);
+                m_phase_profile.add_time(
+                    pass, ConvPhase::HALO_UNPACK, t.unpack);
+            }
         }
         if (has_boundary)
         {
             if ((is_forward && m_overlap_halo_exchange_fwd)
                 || (!is_forward && m_overlap_halo_exchange_bwd))
             {
-                apply_to_spatial_sides(
-                    m_num_dims, [&ss, this](int i, Side side) {
+                // Sides run concurrently, so the slower one of each
+                // dimension is counted.
+                float boundary_elapsed = 0;
+                for (int i = 0; i < m_num_spatial_dims; ++i)
+                {
+                    float dim_elapsed = 0;
+                    for (Side side : SIDES)
+                    {
                         if (!m_boundary_req(i, side))
-                            return;
+                            continue;
                         float const elapsed = GPUDNNBackend::elapsed_time(
                             m_event_start_boundaries(i, side),
                             m_event_end_boundaries(i, side));
                         ss << ", boundary (" << i << ", " << side
                            << "): " << elapsed;
-                    });
+                        dim_elapsed = std::max(dim_elapsed, elapsed);
+                    }
+                    boundary_elapsed += dim_elapsed;
+                }
+                float const wait_elapsed = GPUDNNBackend::elapsed_time(
+                    m_event_comp_end, m_event_boundary_wait_end);
+                ss << ", boundary wait: " << wait_elapsed;
+                m_phase_profile.add_time(
+                    pass, ConvPhase::BOUNDARY_COMPUTE, boundary_elapsed);
+                m_phase_profile.add_time(
+                    pass, ConvPhase::BOUNDARY_WAIT, wait_elapsed);
             }
         }
         util::MPIPrintStreamInfo() << ss.str();
@@ -1407,6 +2020,7 @@ protected:
         h2::gpu::destroy(m_event_comp_end);
         h2::gpu::destroy(m_event_exchange_start);
         h2::gpu::destroy(m_event_exchange_end);
+        h2::gpu::destroy(m_event_boundary_wait_end);
         apply_to_spatial_sides(m_num_dims, [this](int i, Side side) {
             h2::gpu::destroy(m_event_start_boundaries(i, side));
             h2::gpu::destroy(m_event_end_boundaries(i, side));
@@ -1492,6 +2106,10 @@ protected:
                 input, filter, output, d_input, d_filter, d_output);
             setup_chanfilt_comms(input, filter);
         }
+        else if (m_group_partitioned)
+        {
+            setup_chanfilt_comms(input, filter);
+        }
     }
 
     template <typename Allocator>
@@ -1565,6 +2183,10 @@ protected:
                                    input_boundary_dim,
                                    output_boundary_dim);
         });
+        for (int dim = 0; dim < m_num_spatial_dims; ++dim)
+        {
+            setup_batched_boundaries(dim);
+        }
         if (input_shape.is_empty() || output_shape.is_empty())
         {
             m_interior_req = false;
@@ -1583,6 +2205,66 @@ protected:
         }
     }
 
+    // Returns true if the boundary described by rhs can be appended to
+    // lhs as a second sample at delta elements from it.
+    static bool
+    can_batch_boundaries(GPUDNNBackend::TensorDescriptor_t const& lhs,
+                         GPUDNNBackend::TensorDescriptor_t const& rhs,
+                         index_t delta)
+    {
+        GPUDNNBackend::DataType_t dt;
+        std::vector<int> dims, strides, rhs_dims, rhs_strides;
+        GPUDNNBackend::get_tensor_descriptor(lhs, dt, dims, strides);
+        GPUDNNBackend::get_tensor_descriptor(rhs, dt, rhs_dims, rhs_strides);
+        // The sample dimension comes first in descriptors.
+        if (dims != rhs_dims || strides != rhs_strides || dims[0] != 1)
+            return false;
+        // The two samples must not overlap.
+        index_t extent = 1;
+        for (size_t i = 1; i < dims.size(); ++i)
+            extent += static_cast<index_t>(dims[i] - 1) * strides[i];
+        return delta >= extent && delta <= std::numeric_limits<int>::max();
+    }
+
+    static void batch_boundaries(GPUDNNBackend::TensorDescriptor_t& lhs,
+                                 index_t delta)
+    {
+        GPUDNNBackend::DataType_t dt;
+        std::vector<int> dims, strides;
+        GPUDNNBackend::get_tensor_descriptor(lhs, dt, dims, strides);
+        dims[0] = 2;
+        strides[0] = static_cast<int>(delta);
+        GPUDNNBackend::set_tensor_descriptor(lhs, dt, dims, strides);
+    }
+
+    // With a single local sample, the two boundaries of a dimension
+    // typically have the same shape and differ only in offsets, so
+    // they are computed by one convolution over two "samples" instead
+    // of two tiny ones.
+    void setup_batched_boundaries(int dim)
+    {
+        m_boundary_batched(dim, LHS) = false;
+        if (!get_batch_boundaries() || !m_boundary_req(dim, LHS)
+            || !m_boundary_req(dim, RHS))
+            return;
+        index_t const input_delta = m_input_boundary_offsets(dim, RHS)
+                                    - m_input_boundary_offsets(dim, LHS);
+        index_t const output_delta = m_output_boundary_offsets(dim, RHS)
+                                     - m_output_boundary_offsets(dim, LHS);
+        if (!can_batch_boundaries(m_input_boundaries_d(dim, LHS),
+                                  m_input_boundaries_d(dim, RHS),
+                                  input_delta)
+            || !can_batch_boundaries(m_output_boundaries_d(dim, LHS),
+                                     m_output_boundaries_d(dim, RHS),
+                                     output_delta))
+            return;
+        batch_boundaries(m_input_boundaries_d(dim, LHS), input_delta);
+        batch_boundaries(m_output_boundaries_d(dim, LHS), output_delta);
+        m_boundary_batched(dim, LHS) = true;
+        util::MPIPrintStreamDebug()
+            << "Batching the boundary convolutions of dimension " << dim;
+    }
+
     template <typename Allocator>
     void setup_chanfilt_tensors(
         const tensor::Tensor<DataType, LocaleMPI, Allocator>& input,
@@ -1798,7 +2480,8 @@ protected:
         const tensor::Tensor<DataType, LocaleMPI, Allocator>& input,
         const tensor::Tensor<DataType, LocaleMPI, Allocator>& filter)
     {
-        if (m_chanfilt_algo == ChannelParallelismAlgorithm::NONE)
+        if (m_chanfilt_algo == ChannelParallelismAlgorithm::NONE
+            && !m_group_partitioned)
         {
             return;
         }
@@ -1855,7 +2538,12 @@ protected:
                               void* output,
                               size_t ws_size = 0)
     {
-        if (check_cache_and_restore_algos(m_fwd_algo_cache))
+        // The overlapped variant uses different algorithms, and both
+        // variants are alternated while autotuning.
+        AlgoCache& algo_cache = m_overlap_halo_exchange_fwd
+                                    ? m_fwd_overlap_algo_cache
+                                    : m_fwd_algo_cache;
+        if (check_cache_and_restore_algos(algo_cache))
             return;
 
         set_find_workspace_size(ws_size);
@@ -2005,7 +2693,7 @@ protected:
             });
         }
 
-        cache_algos(m_fwd_algo_cache);
+        cache_algos(algo_cache);
     }
 
     void setup_algorithms_bwd_data(void* input,
@@ -2550,7 +3238,7 @@ protected:
         GPUDNNBackend::ConvolutionDescriptor_t& desc_bp_filter)
     {
         auto const mode = GPUDNNBackend::default_conv_mode;
-        auto const dt = util::get_dnnlib_type<DataType>();
+        auto const dt = util::get_dnnlib_compute_type<DataType>();
 
         for (int i = 0; i < m_num_spatial_dims; ++i)
         {
@@ -2683,6 +3371,71 @@ protected:
         m_halo_xch_input = make_halo_exchange(input, m_halo_xch_method);
         m_halo_xch_d_output = make_halo_exchange(input, m_halo_xch_method);
 #endif
+        m_halo_xch_input->set_profiling(m_enable_profiling);
+        m_halo_xch_d_output->set_profiling(m_enable_profiling);
+    }
+
+    template <typename Allocator>
+    void clear_and_exchange_halo_fwd(
+        tensor::Tensor<DataType, LocaleMPI, Allocator>& input)
+    {
+        // Zero-clear the halo region of the input
+        for (int dim = 0; dim < m_num_spatial_dims; ++dim)
+        {
+            const auto& dist = input.get_distribution();
+            if (dist.is_distributed(dim) && dist.get_locale_shape()[dim] > 1
+                && dist.get_overlap(dim) > 0)
+            {
+                input.clear_halo(dim, m_be.get_stream());
+            }
+        }
+
+        forward_exchange_halo(input);
+    }
+
+    // Forward convolution of local tensors (or their interiors or
+    // boundaries) with m_filter_d and m_conv_fwd_d on stream, by the
+    // depthwise kernel if it is used.
+    void convolution_forward_local(DataType alpha,
+                                   const TensorDescriptor_t& x_desc,
+                                   const void* x,
+                                   const void* filter,
+                                   GPUDNNBackend::ConvFwdAlgo_t algo,
+                                   void* ws,
+                                   size_t ws_size,
+                                   DataType beta,
+                                   const TensorDescriptor_t& y_desc,
+                                   void* y,
+                                   h2::gpu::DeviceStream stream)
+    {
+        if (m_use_depthwise_kernel)
+        {
+            depthwise_convolution::forward(
+                alpha,
+                x_desc,
+                static_cast<const DataType*>(x),
+                m_filter_d,
+                static_cast<const DataType*>(filter),
+                m_conv_fwd_d,
+                beta,
+                y_desc,
+                static_cast<DataType*>(y),
+                stream);
+            return;
+        }
+        m_be.convolution_forward(alpha,
+                                 x_desc,
+                                 x,
+                                 m_filter_d,
+                                 filter,
+                                 m_conv_fwd_d,
+                                 algo,
+                                 ws,
+                                 ws_size,
+                                 beta,
+                                 y_desc,
+                                 y,
+                                 stream);
     }
 
     template <typename Allocator>
@@ -2797,7 +3550,8 @@ protected:
     void allreduce_gradients(
         tensor::Tensor<DataType, LocaleMPI, Allocator>& gradients)
     {
-        if (m_chanfilt_algo == ChannelParallelismAlgorithm::NONE)
+        if (m_chanfilt_algo == ChannelParallelismAlgorithm::NONE
+            && !m_group_partitioned)
         {
             Al::Allreduce<Al::NCCLBackend, DataType>(gradients.get_base_ptr(),
                                                      gradients.get_size(),
@@ -2814,6 +3568,61 @@ protected:
         }
     }
 
+    // Validates the number of groups and detects channels partitioned
+    // with whole groups per process. Such a convolution needs no
+    // channel/filter communication: each process convolves its own
+    // groups, and only filter gradients are reduced among processes
+    // with the same groups.
+    template <typename Allocator>
+    void setup_groups(
+        const tensor::Tensor<DataType, LocaleMPI, Allocator>& input,
+        const tensor::Tensor<DataType, LocaleMPI, Allocator>& filter,
+        const tensor::Tensor<DataType, LocaleMPI, Allocator>& output,
+        int num_groups)
+    {
+        m_num_groups = num_groups;
+        m_local_num_groups = num_groups;
+        m_group_partitioned = false;
+        const index_t num_channels = input.get_shape()[-2];
+        const index_t num_filters = output.get_shape()[-2];
+        if (num_groups < 1 || num_channels % num_groups
+            || num_filters % num_groups)
+        {
+            util::MPIPrintStreamError()
+                << "Invalid number of groups: " << num_groups << " for "
+                << num_channels << " channels and " << num_filters
+                << " filters";
+            std::abort();
+        }
+        if (!m_deconv
+            && filter.get_shape()[-2] != num_channels / num_groups)
+        {
+            util::MPIPrintStreamError()
+                << "Filter shape " << filter.get_shape()
+                << " does not match " << num_groups << " groups of "
+                << num_channels << " channels";
+            std::abort();
+        }
+        const int num_segments =
+            input.get_distribution().get_split_shape()[-2];
+        if (num_groups == 1 || num_segments == 1)
+        {
+            return;
+        }
+        const auto filter_split = filter.get_distribution().get_split_shape();
+        if (num_groups % num_segments == 0 && filter_split[-2] == 1
+            && (int) filter_split[-1] == num_segments
+            && (int) output.get_distribution().get_split_shape()[-2]
+                   == num_segments)
+        {
+            m_group_partitioned = true;
+            m_local_num_groups = num_groups / num_segments;
+            util::MPIRootPrintStreamDebug()
+                << "Channels partitioned into " << num_segments
+                << " segments of " << m_local_num_groups << " groups";
+        }
+    }
+
     template <typename Allocator>
     void select_chanfilt_algorithm(
         const tensor::Tensor<DataType, LocaleMPI, Allocator>& input,
@@ -2826,6 +3635,19 @@ protected:
             m_chanfilt_algo = ChannelParallelismAlgorithm::NONE;
             return;
         }
+        if (m_group_partitioned)
+        {
+            // Each process convolves its own groups.
+            m_chanfilt_algo = ChannelParallelismAlgorithm::NONE;
+            return;
+        }
+        if (m_num_groups > 1)
+        {
+            util::MPIPrintStreamError()
+                << "Grouped convolutions can only partition channels "
+                   "and filters with whole groups per process";
+            std::abort();
+        }
         if (m_chanfilt_algo == ChannelParallelismAlgorithm::NONE)
         {
             std::cerr << "Channel/filter parallelism algorithm is NONE, but "
@@ -2834,11 +3656,78 @@ protected:
         }
         if (m_chanfilt_algo == ChannelParallelismAlgorithm::AUTO)
         {
-            // Force this for now.
-            m_chanfilt_algo = ChannelParallelismAlgorithm::X;
+            // The filter is distributed for one of the algorithms, so
+            // pick that one. Callers can choose the distribution with
+            // select_chanfilt_algorithm_by_cost.
+            const auto filter_split =
+                filter.get_distribution().get_split_shape();
+            if (filter_split[-2] > 1 && filter_split[-1] > 1)
+                m_chanfilt_algo = ChannelParallelismAlgorithm::W;
+            else if (filter_split[-1] > 1)
+                m_chanfilt_algo = ChannelParallelismAlgorithm::Y;
+            else
+                m_chanfilt_algo = ChannelParallelismAlgorithm::X;
+            util::MPIRootPrintStreamDebug()
+                << "Channel/filter parallelism algorithm " << m_chanfilt_algo
+                << " selected by the filter distribution";
         }
     }
 
+public:
+    /** Select X or Y for input and output with the lowest estimated
+     *  channel/filter communication time.
+     *
+     *  The time is estimated with collective costs measured on the
+     *  channel communicator of the input (see ChanfiltCostModel), so
+     *  all processes of the input must call this. The filter is then
+     *  to be partitioned by channels for X and by filters for Y.
+     *  compute_times optionally adds the convolution times of X and Y,
+     *  e.g., measured by autotuning them.
+     */
+    template <typename Allocator>
+    static ChannelParallelismAlgorithm select_chanfilt_algorithm_by_cost(
+        BackendDNNLib& be,
+        const tensor::Tensor<DataType, LocaleMPI, Allocator>& input,
+        const tensor::Tensor<DataType, LocaleMPI, Allocator>& output,
+        const std::array<double, 2>& compute_times = {0, 0})
+    {
+        const index_t segments =
+            input.get_distribution().get_split_shape()[-2];
+        if (segments == 1)
+            return ChannelParallelismAlgorithm::NONE;
+        if (be.get_chanfilt_channel_comm(segments) == nullptr)
+        {
+            be.init_chanfilt_channel_comm(segments,
+                                          input.get_sub_locale(-2).get_comm());
+        }
+        const auto& model =
+            get_chanfilt_cost_model(*be.get_chanfilt_channel_comm(segments));
+        // Local sizes with all of the channels or filters; the largest
+        // local size is used so that all processes agree.
+        auto all_channels = [](const auto& t) {
+            auto shape = t.get_max_local_shape();
+            shape[-2] = t.get_shape()[-2];
+            return static_cast<double>(shape.get_size() * sizeof(DataType));
+        };
+        ChanfiltProblem problem;
+        problem.input_bytes = all_channels(input);
+        problem.output_bytes = all_channels(output);
+        problem.num_segments = static_cast<int>(segments);
+        const double x_time = estimate_chanfilt_time(
+            ChannelParallelismAlgorithm::X, problem, model, compute_times[0]);
+        const double y_time = estimate_chanfilt_time(
+            ChannelParallelismAlgorithm::Y, problem, model, compute_times[1]);
+        const auto algo = x_time <= y_time ? ChannelParallelismAlgorithm::X
+                                           : ChannelParallelismAlgorithm::Y;
+        util::MPIRootPrintStreamInfo()
+            << "Channel/filter parallelism algorithm " << algo
+            << " selected by cost (X: " << x_time * 1e3
+            << " ms, Y: " << y_time * 1e3 << " ms)";
+        return algo;
+    }
+
+protected:
+
     /** Assemble the channel/filter dimension of src into dst. */
     template <typename Allocator>
     void allgather_chanfilt(tensor::Tensor<DataType, LocaleMPI, Allocator>& src,
@@ -2868,6 +3757,79 @@ protected:
             m_be.get_stream());
     }
 
+    /** Reduce-scatter src into dst in chunks of samples.
+     *
+     *  conv(offset) computes the samples of src starting at offset
+     *  on the main stream with the descriptors in descs set to the
+     *  size of the chunk. Each computed chunk is reduce-scattered on
+     *  the chanfilt stream while the next one is computed.
+     */
+    template <typename Allocator, typename ConvChunk>
+    void overlap_reduce_scatter_chanfilt(
+        tensor::Tensor<DataType, LocaleMPI, Allocator>& src,
+        tensor::Tensor<DataType, LocaleMPI, Allocator>& dst,
+        bool channel,
+        std::initializer_list<GPUDNNBackend::TensorDescriptor_t*> descs,
+        ConvChunk conv)
+    {
+        index_t const num_samples = src.get_local_shape()[-1];
+        index_t const num_chunks =
+            std::min<index_t>(m_chanfilt_overlap_chunks, num_samples);
+        index_t const chunk_size = (num_samples + num_chunks - 1) / num_chunks;
+        auto& comm = get_chanfilt_overlap_comm(channel);
+        for (index_t offset = 0; offset < num_samples; offset += chunk_size)
+        {
+            index_t const n = std::min(chunk_size, num_samples - offset);
+            for (auto d : descs)
+            {
+                GPUDNNBackend::set_tensor_num_samples(*d, n);
+            }
+            conv(offset);
+            util::wait_stream(m_be.get_stream(), m_chanfilt_stream);
+            m_channel_exchange.reduce_scatter(
+                src, dst, offset, n, comm, m_chanfilt_stream);
+        }
+        for (auto d : descs)
+        {
+            GPUDNNBackend::set_tensor_num_samples(*d, num_samples);
+        }
+        // src is released and dst is consumed on the main stream.
+        util::wait_stream(m_chanfilt_stream, m_be.get_stream());
+    }
+
+    /** Get the communicator for overlapped chanfilt reduce-scatters.
+     *
+     *  This spans the same ranks as the backend's chanfilt
+     *  communicator but runs on the chanfilt stream.
+     */
+    Al::NCCLBackend::comm_type& get_chanfilt_overlap_comm(bool channel)
+    {
+        auto& comm = m_chanfilt_overlap_comms[channel ? 1 : 0];
+        if (comm == nullptr)
+        {
+            if (m_chanfilt_stream == nullptr)
+            {
+                m_chanfilt_stream = m_be.get_internal_priority_stream(0);
+            }
+            auto be_comm =
+                channel ? m_be.get_chanfilt_channel_comm(m_chanfilt_segments)
+                        : m_be.get_chanfilt_filter_comm(m_chanfilt_segments);
+            comm = std::make_unique<Al::NCCLBackend::comm_type>(
+                be_comm->get_comm(), m_chanfilt_stream);
+        }
+        return *comm;
+    }
+
+    /** Distance between consecutive samples in the buffer of t. */
+    template <typename Allocator>
+    static index_t get_sample_stride(
+        const tensor::Tensor<DataType, LocaleMPI, Allocator>& t)
+    {
+        IndexVector idx(t.get_num_dims(), 0);
+        idx[-1] = 1;
+        return t.get_local_offset(idx, true);
+    }
+
     /** Get a temporary buffer and set t to view it. */
     template <typename Allocator>
     void
@@ -2954,6 +3916,12 @@ protected:
         int num_samples = GPUDNNBackend::get_tensor_num_samples(m_input_d);
 
         auto cached_algos = cache.find(num_samples);
+        // Algorithms found for the setup-time minibatch also support
+        // fewer samples, so partial minibatches do not search again.
+        if (cached_algos == cache.end() && num_samples < m_max_num_samples)
+        {
+            cached_algos = cache.find(m_max_num_samples);
+        }
         if (cached_algos != cache.end())
         {
             AlgoTuple algos = cached_algos->second;
@@ -2981,8 +3949,19 @@ protected:
     {
         if (ws_size == 0)
         {
-            size_t const available = GPUDNNBackend::get_available_memory();
-            ws_size = available * 0.8;
+            // All layers share one workspace (see WorkspaceArena), so
+            // choosing the fastest algorithm that fits the budget for
+            // each layer is optimal across layers. Without a budget,
+            // the memory the shared workspace already holds can be
+            // reused in addition to the free memory.
+            ws_size = m_be.ws_budget();
+            if (ws_size == 0)
+            {
+                size_t const available =
+                    GPUDNNBackend::get_available_memory()
+                    + WorkspaceArena::instance().capacity(m_be.get_stream());
+                ws_size = available * 0.8;
+            }
         }
 
         auto& mempool = internal::RuntimeGPU::get_device_memory_pool();
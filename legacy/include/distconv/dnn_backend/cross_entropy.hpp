@@ -85,6 +85,23 @@ public:
                  Tensor& dx_pred,
                  Tensor& dx_truth);
 
+    // Computes the cross entropy of softmax(x_logits) over channels
+    // without materializing the probabilities. x_logits must not be
+    // partitioned in the channel dimension. setup is called with
+    // x_logits as x_pred.
+    template <typename Tensor>
+    int forward_with_logits(const Tensor& x_logits,
+                            const Tensor& x_truth,
+                            Tensor& y);
+
+    // Computes the gradient with respect to x_logits, which is softmax
+    // minus truth for normalized truths, scaled by dy.
+    template <typename Tensor>
+    int backward_with_logits(const Tensor& x_logits,
+                             const Tensor& x_truth,
+                             Tensor& dy,
+                             Tensor& dx_logits);
+
 private:
     h2::gpu::DeviceStream m_stream;
     std::unique_ptr<Al::NCCLBackend::comm_type> m_al;
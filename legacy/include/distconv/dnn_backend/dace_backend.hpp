@@ -8,7 +8,9 @@
 #pragma once
 
 #include <map>
+#include <string>
 #include <tuple>
+#include <vector>
 
 #include "dnn_backend.hpp"
 
@@ -234,6 +236,36 @@ public:
         FilterDescriptor_t const& dw_desc,
         ConvBwdFilterAlgo_t const& algo) const override;
 
+    /**
+     * @brief A convolution whose JIT-compiled library is prewarmed.
+     *
+     * The descriptors are those of the corresponding convolution call:
+     * x_desc is the gradient of the input for BACKWARD_DATA, and y_desc
+     * the gradient of the output for backward convolutions.
+     **/
+    struct JITProblem
+    {
+        ConvType type;
+        TensorDescriptor_t x_desc;
+        FilterDescriptor_t w_desc;
+        ConvolutionDescriptor_t conv_desc;
+        TensorDescriptor_t y_desc;
+    };
+
+    /**
+     * @brief Compiles and loads the JIT-compiled libraries of problems.
+     *
+     * Libraries missing from the cache on any rank of comm are
+     * compiled by running the jit_compiler command with the library
+     * hash and the cache path, split evenly across the ranks, with up
+     * to jit_compile_workers compiler processes per rank. The libraries
+     * of problems are then loaded, so that the first convolution calls
+     * do not stall. Collective over comm; the cache path must be shared
+     * by its ranks.
+     **/
+    void prewarm(std::vector<JITProblem> const& problems, MPI_Comm comm) const;
+    void prewarm(std::vector<JITProblem> const& problems) const;
+
 protected:
     // JIT-compiled libraries
     mutable std::map<ConvDescriptor, dace_state> m_dace_libraries;
@@ -252,6 +284,8 @@ protected:
     bool load_library_or_fallback(const ConvDescriptor& desc,
                                   dace_state& library) const;
 
+    bool library_exists(const ConvDescriptor& desc) const;
+
     bool invoke(const ConvDescriptor& desc,
                 void const*,
                 void const*,
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "distconv/dnn_backend/dnn_backend.hpp"
+#include "distconv/runtime_gpu.hpp"
+
+namespace distconv
+{
+namespace depthwise_convolution
+{
+
+// Returns whether the convolution described by the descriptors is a
+// depthwise convolution supported by forward: a 2-D or 3-D
+// cross-correlation with one group per input channel, where each
+// group may have several filters.
+bool is_supported(GPUDNNBackend::TensorDescriptor_t const& x_desc,
+                  GPUDNNBackend::FilterDescriptor_t const& w_desc,
+                  GPUDNNBackend::ConvolutionDescriptor_t const& conv_desc,
+                  GPUDNNBackend::TensorDescriptor_t const& y_desc);
+
+// Computes y = alpha * conv(x, w) + beta * y like
+// GPUDNNBackend::convolution_forward, but with a direct kernel, which
+// needs no workspace. Depthwise convolutions are memory-bound, and
+// this reads each input element once per tap straight from the
+// (possibly halo-extended) tensors. Output points whose windows lie
+// inside x skip all bounds checks, so only points next to the padding
+// pay for them.
+template <typename DataType>
+void forward(DataType alpha,
+             GPUDNNBackend::TensorDescriptor_t const& x_desc,
+             DataType const* x,
+             GPUDNNBackend::FilterDescriptor_t const& w_desc,
+             DataType const* w,
+             GPUDNNBackend::ConvolutionDescriptor_t const& conv_desc,
+             DataType beta,
+             GPUDNNBackend::TensorDescriptor_t const& y_desc,
+             DataType* y,
+             h2::gpu::DeviceStream stream);
+
+} // namespace depthwise_convolution
+} // namespace distconv
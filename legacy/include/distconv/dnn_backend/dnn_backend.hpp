@@ -9,6 +9,7 @@
 
 #include "distconv_config.hpp"
 
+#include "h2/core/graph.hpp"
 #include "h2/gpu/runtime.hpp"
 
 #ifdef DISTCONV_HAS_P2P
@@ -18,6 +19,15 @@
 #include <Al.hpp>
 #include <mpi.h>
 
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #if H2_HAS_CUDA
 
 #define GPU_PROFILE_RANGE_POP nvtxRangePop
@@ -49,17 +59,43 @@ struct Options
     bool m_deterministic; // FIXME trb: LBANN compile hack
     bool enable_profiling;
     float ws_capacity_factor;
+    // Limit of the convolution workspace shared by all layers (see
+    // WorkspaceArena); derived from the free device memory if zero.
+    size_t ws_budget;
 
     // JIT compilation options
     bool jit_verbose;
     std::string jit_cache_path;
+    // Command that compiles missing JIT libraries when prewarming the
+    // cache (none if empty), and the number of concurrent compiler
+    // processes per rank.
+    std::string jit_compiler;
+    int jit_compile_workers;
+
+    // File persisting convolution autotuning results across jobs
+    // (none if empty).
+    std::string autotune_cache_path;
+
+    // Whether layers capture their passes into graphs and replay them
+    // (see DNNBackend::run_graphed).
+    bool graph_capture;
+
+    // Whether layers release their forward outputs and recompute them
+    // for backward (see Recompute).
+    bool recompute;
 
     Options(bool overlap_halo_exchange = false,
             bool deterministic = false,
             bool enable_profiling = false,
             float ws_capacity_factor = 1.0f,
             bool jit_verbose = false,
-            const std::string& jit_cache_path = ".jitcache");
+            const std::string& jit_cache_path = ".jitcache",
+            const std::string& autotune_cache_path = "",
+            size_t ws_budget = 0,
+            const std::string& jit_compiler = "",
+            int jit_compile_workers = 1,
+            bool graph_capture = false,
+            bool recompute = false);
 }; // struct Options
 
 // Manage the collection of streams.
@@ -190,6 +226,56 @@ private:
 
 }; // class CommunicatorManager
 
+// Process-wide cache of convolution algorithms selected by
+// autotuning, so that layers with the same descriptors tune once.
+// Results can be persisted to a file, which holds one "<algo> <key>"
+// line per result.
+class AutotuneCache
+{
+public:
+    static AutotuneCache& instance();
+
+    /** @brief Load the results persisted in a file.
+     *  @details Rank 0 of `comm` reads the file and broadcasts its
+     *           contents, so this is collective over `comm`. Results
+     *           inserted afterwards are appended to the file. Loading
+     *           the same file again does nothing.
+     */
+    void load(std::string const& path, MPI_Comm comm);
+
+    /** @brief Find the algorithm cached for `key`. */
+    bool find(std::string const& key, int& algo) const;
+
+    /** @brief Cache (and persist) the algorithm selected for `key`. */
+    void insert(std::string const& key, int algo);
+
+    /** @brief Returns the algorithm selected by tuning a problem. */
+    using Tuner = std::function<int()>;
+
+    /** @brief Tune problems missing from the cache, splitting the
+     *         work across the ranks of `comm`.
+     *  @details Collective over `comm`. Ranks may pass different
+     *           problems, identified by their keys. Each unique
+     *           missing problem is tuned by one of the ranks that
+     *           passed it, balancing the number of problems tuned by
+     *           each rank, and the results are gathered into the
+     *           caches of all ranks.
+     */
+    void tune_distributed(
+        std::vector<std::pair<std::string, Tuner>> const& problems,
+        MPI_Comm comm);
+
+private:
+    AutotuneCache() = default;
+
+    // Requires m_mutex to be held.
+    void insert_locked(std::string const& key, int algo, bool persist);
+
+    mutable std::mutex m_mutex;
+    std::string m_path;
+    std::unordered_map<std::string, int> m_algos;
+}; // class AutotuneCache
+
 // This is essentially just a namespace on steroids (since you cannot
 // template on a namespace or pass one around as an object).
 /** @brief Type-ified repository for vendor-erased DNN ops.
@@ -395,6 +481,30 @@ public:
                                TensorDescriptor_t const& db_desc,
                                void* db_data);
 
+    /** @brief Fused out = act(alpha1 * conv(in) + alpha2 * z + bias).
+     *  @returns false, without launching anything, if the library
+     *           cannot fuse this combination (e.g., the activation).
+     */
+    static bool convolution_bias_activation_forward(
+        Handle_t handle,
+        void const* alpha1,
+        TensorDescriptor_t const& in_desc,
+        void const* in_data,
+        FilterDescriptor_t const& filter_desc,
+        void const* filter_data,
+        ConvolutionDescriptor_t const& conv_desc,
+        ConvFwdAlgo_t const& conv_algo,
+        void* work_data,
+        size_t work_data_size,
+        void const* alpha2,
+        TensorDescriptor_t const& z_desc,
+        void const* z_data,
+        TensorDescriptor_t const& bias_desc,
+        void const* bias_data,
+        ActivationDescriptor_t const& act_desc,
+        TensorDescriptor_t const& out_desc,
+        void* out_data);
+
     static ConvFwdAlgo_t get_fwd_algorithm_by_name(std::string const& name);
     static ConvFwdAlgo_t
     get_fwd_algorithm_by_heuristics(Handle_t handle,
@@ -608,23 +718,117 @@ public:
     /// @}
 }; // class MIOpenBackend
 
+// Device memory from the memory pool, used on a stream.
 class Workspace
 {
     size_t m_capacity;
     size_t m_size;
     void* m_ptr;
+    h2::gpu::DeviceStream m_stream;
 
 public:
-    Workspace(size_t size) { realloc(size); }
+    Workspace(size_t size, h2::gpu::DeviceStream stream);
+    ~Workspace();
+    Workspace(Workspace const&) = delete;
+    Workspace& operator=(Workspace const&) = delete;
     size_t capacity() const noexcept { return m_capacity; }
     size_t size() const noexcept { return m_size; }
     void* ptr() const noexcept { return m_ptr; }
     /** @brief Reallocate to a pointer of at least size bytes.
      *  @details Unlike C23, setting a size of zero will deallocate.
+     *           The contents are not preserved when growing.
      */
     void* realloc(size_t size);
 };
 
+/** @brief Workspace shared by the DNN operations on each stream.
+ *  @details Operations on a stream run one after the other, so they
+ *           can all use one buffer per stream, which grows to the
+ *           largest requirement seen so far instead of each layer
+ *           holding its own.
+ */
+class WorkspaceArena
+{
+public:
+    static WorkspaceArena& instance();
+
+    /** @brief Get a buffer of at least size bytes for use on stream.
+     *  @details The buffer may be reused by the next operation
+     *           enqueued on the same stream, so it must not be used
+     *           on other streams.
+     */
+    void* get(size_t size, h2::gpu::DeviceStream stream);
+
+    /** @brief The total size of the buffers of all streams. */
+    size_t capacity() const;
+
+    /** @brief The size of the buffer of stream. */
+    size_t capacity(h2::gpu::DeviceStream stream) const;
+
+    /** @brief Free the buffers of all streams. */
+    void clear();
+
+private:
+    WorkspaceArena() = default;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<h2::gpu::DeviceStream, std::unique_ptr<Workspace>>
+        m_workspaces;
+}; // class WorkspaceArena
+
+/** @brief Graphs of the passes of layers on one stream.
+ *  @details Each pass, identified by a key, has at most one graph,
+ *           which is valid for one signature of the pass. The
+ *           signature must capture everything the enqueued work
+ *           depends on that may change between calls (buffer
+ *           addresses, shapes, scaling factors).
+ */
+class LayerGraphCache
+{
+public:
+    /** @brief Number of signatures of a pass that are captured before
+     *         it is run without graphs for good.
+     */
+    static constexpr int max_signatures = 4;
+
+    /** @brief Enqueue the work of a pass on stream.
+     *  @details The first call with a signature runs f directly, so
+     *           that algorithm selection and allocations happen
+     *           before capture. The second captures the work f
+     *           enqueues into a graph, which that and later calls
+     *           with the same signature replay instead of calling f.
+     *           The graph is also recaptured if the workspace of
+     *           stream (see WorkspaceArena) was reallocated.
+     */
+    void run(std::string const& key,
+             std::string const& signature,
+             h2::gpu::DeviceStream stream,
+             std::function<void()> const& f);
+
+    /** @brief Destroy all graphs. */
+    void clear();
+
+    /** @brief Make a signature from the values of args. */
+    template <typename... Args>
+    static std::string make_signature(Args const&... args)
+    {
+        std::ostringstream ss;
+        ((ss << args << ' '), ...);
+        return ss.str();
+    }
+
+private:
+    struct Pass
+    {
+        std::string signature;
+        int num_runs = 0;
+        int num_signatures = 0;
+        size_t ws_capacity = 0;
+        h2::ComputeGraph graph;
+    };
+    std::unordered_map<std::string, Pass> m_passes;
+}; // class LayerGraphCache
+
 // The rest of the stuff.
 //
 // This interface will be defined in terms of types available via the
@@ -678,6 +882,29 @@ public:
     {
         return m_opts.ws_capacity_factor;
     };
+    size_t ws_budget() const noexcept { return m_opts.ws_budget; }
+    bool graph_capture() const noexcept { return m_opts.graph_capture; }
+    bool recompute() const noexcept { return m_opts.recompute; }
+
+    ///@}
+    /** @name Graph capture */
+    ///@{
+
+    /** @brief Enqueue the work of a layer pass, replaying it from a
+     *         graph if graph capture is enabled.
+     *  @details See LayerGraphCache::run. f must enqueue its work on
+     *           the backend stream, or on streams that fork from and
+     *           join it, and must not synchronize with the host (e.g.,
+     *           through host-side communication). Temporaries must
+     *           come from the device memory pool or the workspace
+     *           arena rather than allocations outside stream order,
+     *           so that their addresses stay valid across replays.
+     *  @param key Identifies the pass, e.g., by layer and direction.
+     *  @param signature See LayerGraphCache::make_signature.
+     */
+    void run_graphed(std::string const& key,
+                     std::string const& signature,
+                     std::function<void()> const& f);
 
     ///@}
     /** @name Communicator accessors. */
@@ -828,6 +1055,45 @@ public:
                              void* d_filter,
                              size_t ws_size) const;
 
+    /** @brief A convolution pass to autotune ahead of its setup.
+     *  @details `x` is the input of the forward convolution (or its
+     *           gradient), `w` the filter (or its gradient) and `y`
+     *           the output (or its gradient). The buffers are
+     *           overwritten by the pass being tuned.
+     */
+    struct ConvAutotuneProblem
+    {
+        enum class Pass
+        {
+            FWD,
+            BWD_DATA,
+            BWD_FILTER
+        };
+        Pass pass;
+        TensorDescriptor_t x_desc;
+        void* x;
+        FilterDescriptor_t w_desc;
+        void* w;
+        ConvolutionDescriptor_t conv_desc;
+        TensorDescriptor_t y_desc;
+        void* y;
+        size_t ws_size;
+    };
+
+    /** @brief Autotune convolution passes with the work split across
+     *         the ranks of `comm`.
+     *  @details Collective over `comm` (e.g., the ranks of a node or
+     *           of the whole job). Each rank passes the problems of
+     *           the layers it will set up; identical problems of
+     *           different ranks or layers are tuned once. The results
+     *           go into the AutotuneCache, so that setting up the
+     *           convolutions with "AUTOTUNE" does not tune them again.
+     */
+    void autotune_distributed(std::vector<ConvAutotuneProblem> const& problems,
+                              MPI_Comm comm) const;
+    void autotune_distributed(
+        std::vector<ConvAutotuneProblem> const& problems) const;
+
     void convolution_forward(double alpha,
                              TensorDescriptor_t const& xdesc,
                              void const* x,
@@ -924,6 +1190,32 @@ public:
                                 TensorDescriptor_t const& db_desc,
                                 void* db_data);
 
+    /** @brief Fused convolution, bias addition and activation.
+     *  @details Computes y = act(alpha * conv(x) + beta * y + bias),
+     *           which is the same as convolution_forward followed by
+     *           apply_fwd_bias(1, ..., 1, ...) and an in-place
+     *           activation_forward.
+     *  @returns false if the vendor library cannot fuse these
+     *           operations. y is then unchanged if beta is nonzero, and
+     *           undefined otherwise.
+     */
+    bool convolution_bias_activation_forward(
+        double alpha,
+        TensorDescriptor_t const& xdesc,
+        void const* x,
+        FilterDescriptor_t const& filter_desc,
+        void const* filter_data,
+        ConvolutionDescriptor_t const& conv_desc,
+        ConvFwdAlgo_t const& conv_algo,
+        void* workspace,
+        size_t workspace_bytes,
+        double beta,
+        TensorDescriptor_t const& bias_desc,
+        void const* bias,
+        ActivationDescriptor_t const& act_desc,
+        TensorDescriptor_t const& ydesc,
+        void* y) const;
+
     ///@}
     /** @name Pooling Operation */
     ///@{
@@ -977,6 +1269,7 @@ protected:
     Options m_opts;
     StreamManager m_stream_mgr;
     CommunicatorManager m_comms;
+    LayerGraphCache m_graphs;
 }; // class DNNBackend
 
 } // namespace distconv
@@ -9,7 +9,9 @@
 
 #include "distconv/tensor/halo_exchange_cuda.hpp"
 #include "distconv/tensor/halo_exchange_cuda_al.hpp"
+#include "distconv/tensor/halo_exchange_cuda_auto.hpp"
 #include "distconv/tensor/halo_exchange_cuda_mpi.hpp"
+#include "distconv/tensor/halo_exchange_cuda_mpi_multidim.hpp"
 #ifdef DISTCONV_HAS_P2P
 #include "distconv/tensor/halo_exchange_cuda_hybrid.hpp"
 #include "distconv/tensor/halo_exchange_cuda_p2p.hpp"
@@ -37,6 +39,10 @@ auto make_halo_exchange(
     using HaloExchangeMPI =
         tensor::HaloExchangeMPI<DataT, Allocator, AlBackend>;
     using HaloExchangeAL = tensor::HaloExchangeAL<DataT, Allocator, AlBackend>;
+    using HaloExchangeAuto =
+        tensor::HaloExchangeAuto<DataT, Allocator, AlBackend>;
+    using HaloExchangeMPIMultiDim =
+        tensor::HaloExchangeMPIMultiDim<DataT, Allocator, AlBackend>;
 #ifdef DISTCONV_HAS_P2P
     using HaloExchangeP2P =
         tensor::HaloExchangeP2P<DataT, Allocator, AlBackend>;
@@ -67,6 +73,16 @@ auto make_halo_exchange(
     case HaloExchangeMethod::AL:
         out = std::make_unique<HaloExchangeAL>(tensor);
         break;
+    case HaloExchangeMethod::AUTO:
+#ifdef DISTCONV_HAS_P2P
+        out = std::make_unique<HaloExchangeAuto>(tensor, p2p);
+#else
+        out = std::make_unique<HaloExchangeAuto>(tensor);
+#endif // DISTCONV_HAS_P2P
+        break;
+    case HaloExchangeMethod::MPI_MULTIDIM:
+        out = std::make_unique<HaloExchangeMPIMultiDim>(tensor);
+        break;
 #ifdef DISTCONV_HAS_P2P
     case HaloExchangeMethod::P2P:
         out = std::make_unique<HaloExchangeP2P>(tensor, p2p);
@@ -9,18 +9,24 @@ namespace distconv
 namespace leaky_relu
 {
 
+// Computes output = leaky_relu(input). input and output may be the
+// same tensor.
 template <typename Tensor>
 void forward(Tensor& input,
              typename Tensor::data_type negative_slope,
              Tensor& output,
              h2::gpu::DeviceStream stream);
 
+// Computes output = leaky_relu'(input) * d_output + beta * output, so
+// that a non-zero beta accumulates into an existing gradient. output
+// may be the same tensor as d_output.
 template <typename Tensor>
 void backward(Tensor& input,
               Tensor& d_output,
               typename Tensor::data_type negative_slope,
               Tensor& output,
-              h2::gpu::DeviceStream stream);
+              h2::gpu::DeviceStream stream,
+              typename Tensor::data_type beta = 0);
 
 } // namespace leaky_relu
 
@@ -57,7 +63,8 @@ public:
     int backward(Tensor& input,
                  Tensor& d_output,
                  typename Tensor::data_type negative_slope,
-                 Tensor& d_input)
+                 Tensor& d_input,
+                 typename Tensor::data_type beta = 0)
     {
         util::MPIPrintStreamDebug() << "Leaky Relu BP: " << d_output << ", "
                                     << input << ", " << d_input;
@@ -66,7 +73,7 @@ public:
             return 0;
         }
         leaky_relu::backward(
-            input, d_output, negative_slope, d_input, m_stream);
+            input, d_output, negative_slope, d_input, m_stream, beta);
         return 0;
     }
 
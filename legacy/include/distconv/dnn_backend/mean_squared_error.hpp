@@ -44,7 +44,7 @@ public:
         assert_eq(y.get_locale_shape()[-1], y.get_split_shape()[-1]);
 
         auto loc_shape = x_pred.get_locale_shape();
-        m_num_procs_per_sample = loc_shape.reduce_sum() / loc_shape[-1];
+        m_num_procs_per_sample = loc_shape.reduce_prod() / loc_shape[-1];
         if (m_num_procs_per_sample > 1)
         {
             auto sample_loc = x_pred.get_sub_locale_except_dim(-1);
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "distconv/util/util.hpp"
+#include "h2/gpu/runtime.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace distconv
+{
+
+// Moves activations to pinned host memory after the forward pass and
+// back to the device before the backward pass, so that their device
+// memory is free in between (out-of-core execution).
+//
+// Copies run on a dedicated stream and overlap with the work of the
+// compute stream, which only waits for a copy when it needs the data:
+// - offload(id) enqueues a device-to-host copy. The device buffer is
+//   released once lookahead more activations are being offloaded, so
+//   that the compute stream does not wait for the copy right away.
+// - fetch(id) makes the activation available on the compute stream,
+//   and prefetches the lookahead activations registered before it,
+//   which are the next ones to be fetched in a backward pass.
+//
+// Device buffers come from the device memory pool, and every ordering
+// between the streams is done with events, so the host never waits.
+//
+// Example:
+//   OffloadManager offload(be.get_stream());
+//   const int id = offload.add(y);
+//   ...
+//   offload.allocate(id); // Before y is written in a forward pass
+//   conv.forward(1, x, w, 0, y);
+//   relu.forward(1, y, 0, z);
+//   offload.offload(id); // After the last forward use of y
+//   ...
+//   offload.fetch(id); // Before the first backward use of y
+//   ...
+//   offload.discard(id); // After the last backward use of y
+class OffloadManager
+{
+public:
+    OffloadManager(h2::gpu::DeviceStream stream, int lookahead = 2);
+    ~OffloadManager();
+
+    OffloadManager(OffloadManager const&) = delete;
+    OffloadManager& operator=(OffloadManager const&) = delete;
+
+    // Registers tensor, which must not be allocated, and allocates its
+    // local buffer. The tensor must outlive this object. Activations
+    // must be registered in the order of their forward passes.
+    template <typename Tensor>
+    int add(Tensor& tensor)
+    {
+        assert_always(tensor.is_null());
+        Tensor* const t = &tensor;
+        const size_t size =
+            tensor.get_local_real_size() * sizeof(typename Tensor::data_type);
+        return add(size, [t](void* buffer) {
+            if (buffer == nullptr)
+                t->nullify();
+            else
+                t->set_view(buffer);
+        });
+    }
+
+    // Begins copying activation id to the host. The forward passes
+    // that use it must have been enqueued.
+    void offload(int id);
+
+    // Makes activation id available on the compute stream, and
+    // prefetches the activations registered before it.
+    void fetch(int id);
+
+    // Allocates activation id on the device without copying its host
+    // data, e.g., before a forward pass overwrites it.
+    void allocate(int id);
+
+    // Releases the device buffer of activation id without copying it,
+    // e.g., after its last backward use.
+    void discard(int id);
+
+    size_t get_num_activations() const { return m_entries.size(); }
+
+private:
+    enum class State
+    {
+        DEVICE,
+        OFFLOADING,
+        HOST,
+        PREFETCHING,
+    };
+
+    struct Entry
+    {
+        size_t size;
+        std::function<void(void*)> set_buffer;
+        void* device = nullptr;
+        void* host = nullptr;
+        // Records the completion of the last copy
+        h2::gpu::DeviceEvent event;
+        State state = State::DEVICE;
+    };
+
+    h2::gpu::DeviceStream m_stream;
+    h2::gpu::DeviceStream m_copy_stream;
+    h2::gpu::DeviceEvent m_ready;
+    int m_lookahead;
+    std::vector<Entry> m_entries;
+    // Activations being offloaded, oldest first
+    std::deque<int> m_offloading;
+
+    int add(size_t size, std::function<void(void*)> set_buffer);
+    Entry& get_entry(int id);
+    void copy_after_compute(void* dst, const void* src, Entry& e);
+    void cancel_offload(int id);
+    void release_device(int id);
+    void prefetch(int id);
+};
+
+} // namespace distconv
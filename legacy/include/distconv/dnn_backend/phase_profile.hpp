@@ -0,0 +1,74 @@
+#pragma once
+
+#include <mpi.h>
+
+#include <array>
+#include <ostream>
+
+namespace distconv
+{
+
+// Passes of a convolution layer.
+enum class ConvPass
+{
+    FORWARD,
+    BACKWARD_DATA,
+    BACKWARD_FILTER,
+    BACKWARD_BIAS,
+    NUM_PASSES
+};
+
+// Phases of a convolution pass timed with events when profiling is
+// enabled (DISTCONV_ENABLE_PROFILING).
+enum class ConvPhase
+{
+    // Packing halos into the send buffers
+    HALO_PACK,
+    // From packing to unpacking, including waits for the peers
+    HALO_TRANSFER,
+    // Unpacking the received halos
+    HALO_UNPACK,
+    // The whole halo exchange on the main stream
+    HALO_EXCHANGE,
+    // The convolution on the main stream, which is only the interior
+    // when the halo exchange is overlapped
+    INTERIOR_COMPUTE,
+    // The convolutions of the boundaries
+    BOUNDARY_COMPUTE,
+    // The main stream waiting for the boundaries after the interior
+    BOUNDARY_WAIT,
+    NUM_PHASES
+};
+
+std::ostream& operator<<(std::ostream& os, ConvPass pass);
+std::ostream& operator<<(std::ostream& os, ConvPhase phase);
+
+// Times of the phases of the passes of a layer on this process,
+// accumulated over the profiled calls.
+class ConvPhaseProfile
+{
+public:
+    // Counts a profiled call of pass.
+    void add_call(ConvPass pass);
+    // Adds ms milliseconds to phase of the current call of pass.
+    void add_time(ConvPass pass, ConvPhase phase, double ms);
+    void clear();
+
+    int get_num_calls(ConvPass pass) const;
+    // Returns the mean time per call of phase in pass.
+    double get_mean_time(ConvPass pass, ConvPhase phase) const;
+
+    // Writes the minimum, mean, and maximum over the processes of comm
+    // of the mean times per call as JSON to os on the root. This is
+    // collective over comm.
+    void write_json(std::ostream& os, MPI_Comm comm) const;
+
+private:
+    static constexpr int num_passes = static_cast<int>(ConvPass::NUM_PASSES);
+    static constexpr int num_phases = static_cast<int>(ConvPhase::NUM_PHASES);
+
+    std::array<std::array<double, num_phases>, num_passes> m_times = {};
+    std::array<int, num_passes> m_num_calls = {};
+};
+
+} // namespace distconv
@@ -8,7 +8,9 @@
 #include "distconv/runtime_gpu.hpp"
 #include "distconv/tensor/halo_exchange_cuda.hpp"
 #include "distconv/tensor/halo_exchange_cuda_al.hpp"
+#include "distconv/tensor/halo_exchange_cuda_auto.hpp"
 #include "distconv/tensor/halo_exchange_cuda_mpi.hpp"
+#include "distconv/tensor/halo_exchange_cuda_mpi_multidim.hpp"
 #include "distconv/util/util.hpp"
 #ifdef DISTCONV_HAS_P2P
 #include "distconv/tensor/halo_exchange_cuda_hybrid.hpp"
@@ -18,6 +20,8 @@
 #include "distconv/tensor/halo_exchange_cuda_nvshmem.hpp"
 #endif // DISTCONV_HAS_NVSHMEM
 
+#include <cstdlib>
+
 namespace distconv
 {
 
@@ -76,7 +80,8 @@ class Pooling<BackendDNNLib, DataType>
 public:
     Pooling(BackendDNNLib& backend,
             int num_dims,
-            HaloExchangeMethod method)
+            HaloExchangeMethod method,
+            bool enable_overlap)
         : m_be(backend),
           m_num_dims(num_dims),
           m_num_spatial_dims(num_dims - 2),
@@ -85,11 +90,17 @@ public:
           m_d_input_d{GPUDNNBackend::make_tensor_descriptor()},
           m_d_output_d{GPUDNNBackend::make_tensor_descriptor()},
           m_pooling_d{GPUDNNBackend::make_pooling_descriptor()},
-          m_halo_xch_method(method)
+          m_halo_xch_method(method),
+          m_overlap_halo_exchange(enable_overlap)
+    {}
+
+    Pooling(BackendDNNLib& backend, int num_dims, HaloExchangeMethod method)
+        : Pooling(backend, num_dims, method, backend.overlap_halo_exchange())
     {}
 
     ~Pooling()
     {
+        destroy_overlap_regions();
         GPUDNNBackend::destroy_pooling_descriptor(m_pooling_d);
         GPUDNNBackend::destroy_tensor_descriptor(m_d_output_d);
         GPUDNNBackend::destroy_tensor_descriptor(m_d_input_d);
@@ -196,6 +207,17 @@ public:
         util::MPIPrintStreamDebug()
             << "pooling pads: " << util::join_array(pads, ", ");
 
+        m_windows = IntVector(windows);
+        m_pads = IntVector(pads);
+        m_strides = IntVector(strides);
+        m_gather_bp = get_gather_backward(m_be.deterministic())
+                      && (m_num_dims == 4 || m_num_dims == 5);
+        if (m_gather_bp)
+        {
+            util::MPIRootPrintStreamDebug()
+                << "Gathering gradients in backward pooling";
+        }
+
         // pooling descriptor
         setup_pooling_descriptor(
             input, output, windows, pads, strides, m_pooling_d);
@@ -203,6 +225,17 @@ public:
         setup_halo_xch(input, d_input);
 
         setup_boundary_streams(input.get_split_index());
+
+        if (m_overlap_halo_exchange)
+        {
+            m_overlap_halo_exchange =
+                setup_overlap_regions(input, output, windows, strides);
+        }
+        if (m_overlap_halo_exchange)
+        {
+            util::MPIRootPrintStreamDebug()
+                << "Overlapping of halo exchanges in pooling enabled";
+        }
         return;
     }
 
@@ -215,6 +248,12 @@ public:
                 Tensor& output,
                 bool const training = true)
     {
+        if (m_overlap_halo_exchange && output.get_local_size() > 0)
+        {
+            forward_overlap(alpha, input, beta, output, training);
+            return 0;
+        }
+
         exchange_halo_input(input, m_halo_xch_input);
 
         // Note that even when the local output is empty, halo exchange
@@ -256,6 +295,25 @@ public:
         }
         set_num_samples(d_input.get_local_shape()[-1]);
 
+        // Each point of d_input, including the halos sent back, is
+        // written once, so the overlapped backward, which clears
+        // d_input and accumulates regions into it, is not needed.
+        if (m_gather_bp)
+        {
+            if (d_output.get_local_size() > 0)
+                backward_gather(alpha, output, d_output, input, beta, d_input);
+            exchange_halo_reverse(d_input, m_halo_xch_d_input);
+            return 0;
+        }
+
+        // Accumulating the regions requires overwriting d_input first
+        if (m_overlap_halo_exchange && d_output.get_local_size() > 0
+            && beta == 0)
+        {
+            backward_overlap(alpha, output, d_output, input, d_input);
+            return 0;
+        }
+
         if (d_output.get_local_size() > 0)
         {
             const void* input_ptr =
@@ -292,6 +350,13 @@ public:
             GPUDNNBackend::set_tensor_num_samples(m_output_d, n);
             GPUDNNBackend::set_tensor_num_samples(m_d_input_d, n);
             GPUDNNBackend::set_tensor_num_samples(m_d_output_d, n);
+            if (m_overlap_halo_exchange)
+            {
+                for_each_overlap_region([n](Region& r) {
+                    GPUDNNBackend::set_tensor_num_samples(r.input_d, n);
+                    GPUDNNBackend::set_tensor_num_samples(r.output_d, n);
+                });
+            }
         }
     }
 
@@ -312,6 +377,10 @@ private:
     GPUDNNBackend::TensorDescriptor_t m_d_output_d;
     GPUDNNBackend::PoolingDescriptor_t m_pooling_d;
     GPUDNNBackend::PoolingMode_t m_mode;
+    IntVector m_windows;
+    IntVector m_pads;
+    IntVector m_strides;
+    bool m_gather_bp = false;
 
     HaloExchangeMethod m_halo_xch_method;
     using HaloExchange =
@@ -320,6 +389,12 @@ private:
         HaloExchangeMPI<DataType, tensor::CUDAAllocator, Al::NCCLBackend>;
     using HaloExchangeAL = tensor::
         HaloExchangeAL<DataType, tensor::CUDAAllocator, Al::NCCLBackend>;
+    using HaloExchangeAuto = tensor::
+        HaloExchangeAuto<DataType, tensor::CUDAAllocator, Al::NCCLBackend>;
+    using HaloExchangeMPIMultiDim =
+        tensor::HaloExchangeMPIMultiDim<DataType,
+                                        tensor::CUDAAllocator,
+                                        Al::NCCLBackend>;
 #ifdef DISTCONV_HAS_P2P
     using HaloExchangeP2P = tensor::
         HaloExchangeP2P<DataType, tensor::CUDAAllocator, Al::NCCLBackend>;
@@ -348,6 +423,261 @@ private:
     std::unique_ptr<HaloExchange> m_halo_xch_d_input;
     BoundaryAttributesV<std::shared_ptr<Al::NCCLBackend::comm_type>>
         m_boundary_comms;
+    BoundaryAttributesV<h2::gpu::DeviceStream> m_boundary_streams;
+
+    // A part of the output that is computed separately when halo
+    // exchanges are overlapped, and the part of the input it reads.
+    // The descriptors are also used for d_output and d_input, which
+    // have the same distributions.
+    struct Region
+    {
+        GPUDNNBackend::TensorDescriptor_t input_d;
+        GPUDNNBackend::TensorDescriptor_t output_d;
+        index_t input_offset = 0;
+        index_t output_offset = 0;
+    };
+    bool m_overlap_halo_exchange;
+    // The interior reads no halo points, so it can be computed while
+    // halos are exchanged. The boundaries partition the rest of the
+    // output without overlapping each other.
+    Region m_interior;
+    std::vector<Region> m_boundaries;
+    bool m_overlap_regions_set = false;
+    h2::gpu::DeviceStream m_interior_stream;
+
+    template <typename Func>
+    void for_each_overlap_region(Func f)
+    {
+        if (!m_overlap_regions_set)
+            return;
+        f(m_interior);
+        for (auto& r : m_boundaries)
+            f(r);
+    }
+
+    void destroy_overlap_regions()
+    {
+        for_each_overlap_region([](Region& r) {
+            GPUDNNBackend::destroy_tensor_descriptor(r.output_d);
+            GPUDNNBackend::destroy_tensor_descriptor(r.input_d);
+        });
+        m_boundaries.clear();
+        m_overlap_regions_set = false;
+    }
+
+    // Splits the output into an interior that does not depend on
+    // halos and non-overlapping boundary slabs. Returns false if
+    // overlapping is not possible or not needed.
+    template <typename Tensor>
+    bool setup_overlap_regions(const Tensor& input,
+                               const Tensor& output,
+                               const int_vector& windows,
+                               const int_vector& strides)
+    {
+        destroy_overlap_regions();
+        const auto overlap = input.get_overlap();
+        const auto input_shape = input.get_local_shape();
+        const auto output_shape = output.get_local_shape();
+        if (output_shape.get_size() == 0)
+            return false;
+
+        // Spatial dimensions with halos are split
+        std::vector<bool> split(m_num_dims, false);
+        bool any_split = false;
+        for (int i = 0; i < m_num_spatial_dims; ++i)
+        {
+            split[i] = m_halo_fwd_recv[i] > 0 || m_halo_bwd_recv[i] > 0;
+            any_split |= split[i];
+        }
+        if (!any_split)
+        {
+            util::MPIPrintStreamDebug()
+                << "Halo exchange not required in pooling";
+            return false;
+        }
+
+        auto make_region = [&](const IndexVector& output_idx,
+                               const tensor::Shape& shape) {
+            IndexVector input_idx(m_num_dims, 0);
+            tensor::Shape region_input_shape(m_num_dims, 0);
+            for (int i = 0; i < m_num_dims; ++i)
+            {
+                // Index of the first point of m_input_d
+                input_idx[i] = overlap[i] - m_halo_bwd_recv[i];
+                if (split[i])
+                {
+                    // Padding is disabled in split dimensions
+                    input_idx[i] += output_idx[i] * strides[i];
+                    region_input_shape[i] =
+                        (shape[i] - 1) * strides[i] + windows[i];
+                }
+                else
+                {
+                    region_input_shape[i] = input_shape[i]
+                                            + m_halo_bwd_recv[i]
+                                            + m_halo_fwd_recv[i];
+                }
+            }
+            Region r;
+            r.input_d = GPUDNNBackend::make_tensor_descriptor();
+            r.output_d = GPUDNNBackend::make_tensor_descriptor();
+            GPUDNNBackend::setup_tensor_descriptor(
+                r.input_d, input, region_input_shape);
+            GPUDNNBackend::setup_tensor_descriptor(r.output_d, output, shape);
+            r.input_offset = input.get_local_offset(input_idx, true);
+            r.output_offset = output.get_local_offset(output_idx, false);
+            util::MPIPrintStreamDebug()
+                << "pooling region: output " << output_idx << ", " << shape
+                << "; input " << input_idx << ", " << region_input_shape;
+            return r;
+        };
+
+        // Range of output points of each split dimension whose windows
+        // do not reach halos
+        IndexVector interior_begin(m_num_dims, 0);
+        tensor::Shape interior_shape = output_shape;
+        for (int i = 0; i < m_num_spatial_dims; ++i)
+        {
+            if (!split[i])
+                continue;
+            const int st = strides[i];
+            const int lhs = m_halo_bwd_recv[i];
+            const int begin = util::ceil(lhs, st);
+            const int reach = (int) input_shape[i] + lhs - windows[i];
+            const int end = reach < 0 ? 0
+                                      : std::min(reach / st + 1,
+                                                 (int) output_shape[i]);
+            if (begin >= end)
+            {
+                util::MPIRootPrintStreamInfo()
+                    << "Overlapped halo exchange in pooling disabled as the "
+                       "spatial domain is small ("
+                    << input_shape << ")";
+                m_boundaries.clear();
+                return false;
+            }
+            // Slabs at each side over the interior of the dimensions
+            // already split
+            if (begin > 0)
+            {
+                auto shape = interior_shape;
+                shape[i] = begin;
+                auto idx = interior_begin;
+                idx[i] = 0;
+                m_boundaries.push_back(make_region(idx, shape));
+            }
+            if (end < (int) output_shape[i])
+            {
+                auto shape = interior_shape;
+                shape[i] = output_shape[i] - end;
+                auto idx = interior_begin;
+                idx[i] = end;
+                m_boundaries.push_back(make_region(idx, shape));
+            }
+            interior_begin[i] = begin;
+            interior_shape[i] = end - begin;
+        }
+        m_interior = make_region(interior_begin, interior_shape);
+        m_overlap_regions_set = true;
+        return true;
+    }
+
+    template <typename Tensor>
+    void forward_overlap(typename Tensor::data_type alpha,
+                         Tensor& input,
+                         typename Tensor::data_type beta,
+                         Tensor& output,
+                         bool const training)
+    {
+        set_num_samples(output.get_local_shape()[-1]);
+        // The interior does not read halos, so it runs while they are
+        // exchanged
+        util::wait_stream(m_be.get_stream(), m_interior_stream);
+        m_be.pooling_forward(m_pooling_d,
+                             alpha,
+                             m_interior.input_d,
+                             input.get_const_buffer() + m_interior.input_offset,
+                             beta,
+                             m_interior.output_d,
+                             output.get_buffer() + m_interior.output_offset,
+                             training,
+                             m_interior_stream);
+
+        exchange_halo_input(input, m_halo_xch_input);
+
+        for (auto& r : m_boundaries)
+        {
+            m_be.pooling_forward(m_pooling_d,
+                                 alpha,
+                                 r.input_d,
+                                 input.get_const_buffer() + r.input_offset,
+                                 beta,
+                                 r.output_d,
+                                 output.get_buffer() + r.output_offset,
+                                 training);
+        }
+        util::wait_stream(m_interior_stream, m_be.get_stream());
+    }
+
+    // The regions write overlapping parts of d_input, so d_input is
+    // cleared and each region accumulates into it.
+    template <typename Tensor>
+    void backward_overlap(typename Tensor::data_type alpha,
+                          const Tensor& output,
+                          const Tensor& d_output,
+                          const Tensor& input,
+                          Tensor& d_input)
+    {
+        d_input.zero(m_be.get_stream());
+        auto run_region = [&](Region& r, h2::gpu::DeviceStream s) {
+            m_be.pooling_backward(
+                m_pooling_d,
+                alpha,
+                r.output_d,
+                output.get_const_buffer() + r.output_offset,
+                r.output_d,
+                d_output.get_const_buffer() + r.output_offset,
+                r.input_d,
+                input.get_const_buffer() + r.input_offset,
+                1,
+                r.input_d,
+                d_input.get_buffer() + r.input_offset,
+                s);
+        };
+        // The boundaries produce all of the halo points to send back
+        for (auto& r : m_boundaries)
+            run_region(r, m_be.get_stream());
+
+        // The interior writes no halo points, so it runs while the
+        // halos are sent, but must be done before they are accumulated
+        util::wait_stream(m_be.get_stream(), m_interior_stream);
+        run_region(m_interior, m_interior_stream);
+
+        if (m_be.profiling())
+            GPU_PROFILE_RANGE_PUSH("pooling/exchange_halo_rev");
+        assert_always(m_halo_xch_d_input != nullptr);
+        m_halo_xch_d_input->exchange(m_halo_fwd_recv,
+                                     m_halo_fwd_send,
+                                     m_halo_bwd_recv,
+                                     m_halo_bwd_send,
+                                     m_boundary_comms,
+                                     m_be.get_stream(),
+                                     true,
+                                     true,
+                                     true,
+                                     true,
+                                     tensor::HaloExchangeAccumOp::SUM);
+        util::wait_stream(m_interior_stream, m_be.get_stream());
+        m_halo_xch_d_input->unpack(m_halo_fwd_send,
+                                   m_halo_bwd_send,
+                                   m_boundary_streams,
+                                   m_be.get_stream(),
+                                   true,
+                                   true,
+                                   tensor::HaloExchangeAccumOp::SUM);
+        if (m_be.profiling())
+            GPU_PROFILE_RANGE_POP();
+    }
 
     template <typename Tensor>
     void setup_pooling_descriptor(const Tensor& input,
@@ -365,12 +695,26 @@ private:
                                                 util::reverse(strides).data());
     }
 
-    void bp_accumulate_sum(
-        tensor::Tensor<DataType, tensor::LocaleMPI, tensor::CUDAAllocator>&
-            tensor,
-        IndexVector const& dst,
-        IndexVector const& src,
-        tensor::Shape const& shape);
+    // Whether the backward pass uses backward_gather, which is the
+    // default with deterministic execution.
+    static bool get_gather_backward(bool deterministic)
+    {
+        auto env = std::getenv("DISTCONV_POOLING_GATHER_BACKWARD");
+        return env ? std::atoi(env) : deterministic;
+    }
+
+    // Computes each point of d_input (and its halos) from the windows
+    // covering it instead of scattering the gradients of windows, so
+    // no point is accumulated into and the result is deterministic.
+    // Max pooling passes a gradient to the first maximum of a window.
+    using GPUTensor =
+        tensor::Tensor<DataType, tensor::LocaleMPI, tensor::CUDAAllocator>;
+    void backward_gather(DataType alpha,
+                         const GPUTensor& output,
+                         const GPUTensor& d_output,
+                         const GPUTensor& input,
+                         DataType beta,
+                         GPUTensor& d_input);
 
     template <typename Allocator>
     void setup_halo_xch(tensor::Tensor<DataType, LocaleMPI, Allocator>& input,
@@ -388,6 +732,25 @@ private:
             m_halo_xch_input.reset(new HaloExchangeAL(input));
             m_halo_xch_d_input.reset(new HaloExchangeAL(d_input));
             break;
+        case HaloExchangeMethod::AUTO:
+            util::MPIRootPrintStreamDebug()
+                << "Selecting the halo exchange method automatically";
+#ifdef DISTCONV_HAS_P2P
+            m_halo_xch_input.reset(
+                new HaloExchangeAuto(input, m_be.get_p2p()));
+            m_halo_xch_d_input.reset(
+                new HaloExchangeAuto(d_input, m_be.get_p2p()));
+#else
+            m_halo_xch_input.reset(new HaloExchangeAuto(input));
+            m_halo_xch_d_input.reset(new HaloExchangeAuto(d_input));
+#endif // DISTCONV_HAS_P2P
+            break;
+        case HaloExchangeMethod::MPI_MULTIDIM:
+            util::MPIRootPrintStreamDebug()
+                << "Using single-round MPI in halo exchange";
+            m_halo_xch_input.reset(new HaloExchangeMPIMultiDim(input));
+            m_halo_xch_d_input.reset(new HaloExchangeMPIMultiDim(d_input));
+            break;
 #ifdef DISTCONV_HAS_P2P
         case HaloExchangeMethod::P2P:
             util::MPIRootPrintStreamDebug() << "Using P2P in halo exchange";
@@ -480,6 +843,13 @@ private:
             if (split_idx[i] % 2)
                 std::swap(m_boundary_comms(i, LHS), m_boundary_comms(i, RHS));
         }
+        apply_to_spatial_sides(m_num_dims, [this](int i, Side side) {
+            m_boundary_streams(i, side) =
+                m_boundary_comms(i, side)->get_stream();
+        });
+        // After the streams of all boundaries
+        m_interior_stream =
+            m_be.get_internal_priority_stream(2 * m_num_spatial_dims);
     }
 
     int get_boundary_stream_index(int dim, Side side)
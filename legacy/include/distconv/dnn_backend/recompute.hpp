@@ -0,0 +1,134 @@
+#pragma once
+
+#include "distconv/util/util.hpp"
+#include "distconv/util/util_mpi.hpp"
+
+#include <functional>
+#include <utility>
+
+namespace distconv
+{
+
+// Opt-in recomputation of the forward output of a layer, i.e.,
+// activation checkpointing (see Options::recompute).
+//
+// After the forward pass of the layer, release() frees the local
+// buffer of the output tensor, keeping its distribution. Before a
+// backward pass needs the output, recompute() allocates it again and
+// reruns the forward pass. When the input of the layer is the output of
+// another Recompute (see set_input), that output is recomputed first if
+// it has been released.
+//
+// The forward function is passed whether the halo exchange of the
+// input can be skipped, e.g., as the skip_halo_exchange argument of
+// Convolution::forward. The halo received by the last forward pass is
+// still valid unless the input has been recomputed since, which is the
+// case when its producer is recomputed as part of a chain. Layers
+// without halos (BatchNormalization, ReLU) ignore it.
+//
+// Example:
+//   Recompute conv_rc(be.recompute(), y, [&](bool skip_halo_exchange) {
+//       conv.forward(1, x, w, 0, y, skip_halo_exchange);
+//   });
+//   Recompute relu_rc(be.recompute(), z, [&](bool) {
+//       relu.forward_with_mask(y, z);
+//   });
+//   relu_rc.set_input(conv_rc);
+//   conv_rc.forward();
+//   relu_rc.forward();
+//   conv_rc.release();
+//   ...
+//   conv_rc.recompute();
+//   relu.backward_with_mask(dz, 0, dy);
+class Recompute
+{
+public:
+    using ForwardFunc = std::function<void(bool skip_halo_exchange)>;
+
+    template <typename Tensor>
+    Recompute(bool enabled, Tensor& output, ForwardFunc forward)
+        : m_enabled(enabled),
+          m_release([&output]() { output.nullify(); }),
+          m_allocate([&output]() { assert0(output.allocate()); }),
+          m_forward(std::move(forward))
+    {}
+
+    Recompute(Recompute const&) = delete;
+    Recompute& operator=(Recompute const&) = delete;
+
+    // Declares that the input of this layer is the output of producer,
+    // which must outlive this object.
+    void set_input(Recompute& producer) { m_producer = &producer; }
+
+    bool is_enabled() const noexcept { return m_enabled; }
+    bool is_released() const noexcept { return m_released; }
+
+    // Runs the forward pass with a halo exchange.
+    void forward()
+    {
+        ensure_input();
+        if (m_released)
+        {
+            m_allocate();
+            m_released = false;
+        }
+        m_forward(false);
+        computed();
+    }
+
+    // Frees the output if recomputation is enabled.
+    void release()
+    {
+        if (!m_enabled || m_released)
+            return;
+        util::MPIPrintStreamDebug() << "Releasing a forward output";
+        m_release();
+        m_released = true;
+    }
+
+    // Recomputes the output if it has been released.
+    void recompute()
+    {
+        if (!m_released)
+            return;
+        ensure_input();
+        const bool skip_halo_exchange =
+            m_producer == nullptr
+            || m_producer->m_generation == m_input_generation;
+        util::MPIPrintStreamDebug()
+            << "Recomputing a forward output"
+            << (skip_halo_exchange ? " without halo exchange" : "");
+        m_allocate();
+        m_released = false;
+        m_forward(skip_halo_exchange);
+        computed();
+    }
+
+private:
+    bool m_enabled;
+    std::function<void()> m_release;
+    std::function<void()> m_allocate;
+    ForwardFunc m_forward;
+    Recompute* m_producer = nullptr;
+    bool m_released = false;
+    // Incremented whenever the output is computed, so that consumers
+    // can tell whether their input has changed since their last pass.
+    unsigned long m_generation = 0;
+    // Generation of the producer's output at the last forward pass.
+    unsigned long m_input_generation = 0;
+
+    void ensure_input()
+    {
+        if (m_producer != nullptr)
+            m_producer->recompute();
+    }
+
+    void computed()
+    {
+        ++m_generation;
+        if (m_producer != nullptr)
+            m_input_generation = m_producer->m_generation;
+    }
+};
+
+} // namespace distconv
@@ -4,8 +4,41 @@
 #include "distconv/layers.hpp"
 #include "distconv/runtime_gpu.hpp"
 
+#include <cstddef>
+#include <cstdint>
+
 namespace distconv
 {
+namespace relu
+{
+
+// Returns the number of 32-bit words of the mask of a tensor with
+// num_elements local elements, one bit per element.
+inline size_t get_mask_num_words(size_t num_elements)
+{
+    return (num_elements + 31) / 32;
+}
+
+// Computes output = relu(input) and sets bit i % 32 of mask[i / 32]
+// iff element i of input is positive. input and output may be the
+// same tensor. Both must be locally dense (no halo or padding).
+template <typename Tensor>
+void forward_with_mask(const Tensor& input,
+                       Tensor& output,
+                       std::uint32_t* mask,
+                       h2::gpu::DeviceStream stream);
+
+// Computes d_input = relu'(input) * d_output + beta * d_input from the
+// mask saved by forward_with_mask. d_input may be the same tensor as
+// d_output.
+template <typename Tensor>
+void backward_with_mask(const std::uint32_t* mask,
+                        const Tensor& d_output,
+                        typename Tensor::data_type beta,
+                        Tensor& d_input,
+                        h2::gpu::DeviceStream stream);
+
+} // namespace relu
 
 template <>
 class ReLU<BackendDNNLib>
@@ -22,6 +55,7 @@ public:
 
     ~ReLU()
     {
+        release_mask();
         GPUDNNBackend::destroy_tensor_descriptor(m_d_output_d);
         GPUDNNBackend::destroy_tensor_descriptor(m_d_input_d);
         GPUDNNBackend::destroy_tensor_descriptor(m_output_d);
@@ -97,6 +131,45 @@ public:
         return 0;
     }
 
+    // Like forward with alpha = 1 and beta = 0, but saves a bit mask of
+    // the positive elements of input for backward_with_mask instead of
+    // requiring input or output to be kept. This takes 1/32 of the
+    // memory of a float tensor. output may be the same tensor as input.
+    template <typename Tensor>
+    int forward_with_mask(const Tensor& input, Tensor& output)
+    {
+        util::MPIPrintStreamDebug()
+            << "Relu FP with mask: " << input << ", " << output;
+        ensure_mask(input.get_local_size());
+        if (input.get_local_size() == 0)
+        {
+            return 0;
+        }
+        relu::forward_with_mask(input, output, m_mask, m_be.get_stream());
+        return 0;
+    }
+
+    // Computes d_input = relu'(input) * d_output + beta * d_input with
+    // the mask saved by the last forward_with_mask.
+    template <typename Tensor>
+    int backward_with_mask(const Tensor& d_output,
+                           typename Tensor::data_type beta,
+                           Tensor& d_input)
+    {
+        util::MPIPrintStreamDebug()
+            << "Relu BP with mask: " << d_output << ", " << d_input;
+        if (d_input.get_local_size() == 0)
+        {
+            return 0;
+        }
+        assert_always(m_mask != nullptr
+                      && relu::get_mask_num_words(d_input.get_local_size())
+                             == m_mask_num_words);
+        relu::backward_with_mask(
+            m_mask, d_output, beta, d_input, m_be.get_stream());
+        return 0;
+    }
+
     void set_num_samples(int n)
     {
         if (n != GPUDNNBackend::get_tensor_num_samples(m_input_d))
@@ -110,11 +183,38 @@ public:
 
 private:
     BackendDNNLib& m_be;
+    std::uint32_t* m_mask = nullptr;
+    size_t m_mask_num_words = 0;
     GPUDNNBackend::ActivationDescriptor_t m_activation_d;
     GPUDNNBackend::TensorDescriptor_t m_input_d;
     GPUDNNBackend::TensorDescriptor_t m_output_d;
     GPUDNNBackend::TensorDescriptor_t m_d_input_d;
     GPUDNNBackend::TensorDescriptor_t m_d_output_d;
+
+    void ensure_mask(size_t num_elements)
+    {
+        const auto num_words = relu::get_mask_num_words(num_elements);
+        if (num_words == m_mask_num_words)
+            return;
+        release_mask();
+        if (num_words > 0)
+        {
+            m_mask = static_cast<std::uint32_t*>(
+                internal::RuntimeGPU::get_device_memory_pool().get(
+                    num_words * sizeof(std::uint32_t), m_be.get_stream()));
+        }
+        m_mask_num_words = num_words;
+    }
+
+    void release_mask()
+    {
+        if (m_mask != nullptr)
+        {
+            internal::RuntimeGPU::get_device_memory_pool().release(m_mask);
+            m_mask = nullptr;
+        }
+        m_mask_num_words = 0;
+    }
 };
 
 } // namespace distconv
@@ -60,6 +60,14 @@ private:
         Al::Allreduce<Al::NCCLBackend, DataType>(
             sample_values, num_samples, op, *m_sample_al.get());
     }
+
+    template <typename DataType>
+    void
+    allgather(const DataType* send_values, DataType* recv_values, int count)
+    {
+        Al::Allgather<Al::NCCLBackend, DataType>(
+            send_values, recv_values, count, *m_sample_al.get());
+    }
 };
 
 } // namespace distconv
@@ -1,11 +1,14 @@
 #pragma once
 
+#include "distconv/runtime_gpu.hpp"
 #include "distconv/tensor/algorithms/common_cuda.hpp"
 #include "distconv/tensor/memory_gpu.hpp"
 #include "distconv/tensor/tensor.hpp"
 #include "distconv/util/util_gpu.hpp"
 #include "distconv/util/util_mpi.hpp"
 
+#include <algorithm>
+#include <cstdlib>
 #include <type_traits>
 #if __has_include(<nvfunctional>)
 #define DISTCONV_HAS_NVFUNCTIONAL_HEADER
@@ -110,6 +113,172 @@ __global__ static void reduce_kernel(
   }
 }
 
+// Two-stage implementation without atomics. Block (d, c) sums chunk
+// c of the points reduced into output d, and the partial sums of each
+// output are then added in order, so the result does not depend on
+// the scheduling of blocks.
+//
+// Output d ranges over dst_region, which is the reduction region with
+// the reduced dimensions set to 1, and the points of an output range
+// over reduced_shape, which is the reduction region with the other
+// dimensions set to 1.
+template <int ND, typename DataType,
+          typename UnaryFunction, int BLOCK_SIZE>
+__global__ static void reduce_partials_kernel(
+    const DataType *src,
+    Array<ND> src_strides,
+    Array<ND> dst_region,
+    Array<ND> reduced_shape,
+    int chunk_size,
+    DataType *partials,
+    DataType *dst,
+    Array<ND> dst_strides,
+    UnaryFunction op) {
+  const int tid = threadIdx.x;
+  int idx = blockIdx.x;
+  int dst_offset = 0;
+  for (int i = 0; i < ND; ++i) {
+    const int x = idx % dst_region[i];
+    idx /= dst_region[i];
+    src += x * src_strides[i];
+    dst_offset += x * dst_strides[i];
+  }
+
+#ifdef DISTCONV_HAS_NVFUNCTIONAL_HEADER
+  nvstd::function<DataType(DataType&)> op_func = op;
+  auto const use_op = (op != nullptr);
+#else
+  UnaryFunctionWrapper<UnaryFunction> op_func(op);
+#endif
+
+  const int reduced_size = reduced_shape.get_size();
+  const int begin = blockIdx.y * chunk_size;
+  const int end = min(begin + chunk_size, reduced_size);
+  DataType sum = DataType(0);
+  for (int r = begin + tid; r < end; r += BLOCK_SIZE) {
+    int j = r;
+    int offset = 0;
+    for (int i = 0; i < ND; ++i) {
+      offset += (j % reduced_shape[i]) * src_strides[i];
+      j /= reduced_shape[i];
+    }
+    DataType x = src[offset];
+#ifdef DISTCONV_HAS_NVFUNCTIONAL_HEADER
+    if (use_op)
+        x = op_func(x);
+#else
+    if constexpr (op_func.valid())
+        x = op_func(x);
+#endif
+    sum += x;
+  }
+
+  __shared__ DataType shm[BLOCK_SIZE];
+  shm[tid] = sum;
+  __syncthreads();
+  for (int stride = BLOCK_SIZE / 2; stride > 0; stride /= 2) {
+    if (tid < stride) {
+      shm[tid] += shm[tid + stride];
+    }
+    __syncthreads();
+  }
+  if (tid == 0) {
+    // A single chunk needs no second stage
+    if (gridDim.y == 1) {
+      dst[dst_offset] += shm[0];
+    } else {
+      partials[blockIdx.x * gridDim.y + blockIdx.y] = shm[0];
+    }
+  }
+}
+
+template <int ND, typename DataType>
+__global__ static void reduce_partials_final_kernel(
+    const DataType *partials,
+    int num_chunks,
+    DataType *dst,
+    Array<ND> dst_region,
+    Array<ND> dst_strides) {
+  int idx = threadIdx.x + blockIdx.x * blockDim.x;
+  if (idx >= dst_region.get_size()) return;
+  const DataType *p = partials + idx * num_chunks;
+  DataType sum = DataType(0);
+  for (int c = 0; c < num_chunks; ++c) {
+    sum += p[c];
+  }
+  int dst_offset = 0;
+  for (int i = 0; i < ND; ++i) {
+    dst_offset += (idx % dst_region[i]) * dst_strides[i];
+    idx /= dst_region[i];
+  }
+  dst[dst_offset] += sum;
+}
+
+// Largest number of outputs for which the two-stage reduction is used
+// instead of atomics; with few outputs, atomics contend heavily.
+constexpr int TWO_STAGE_REDUCTION_MAX_OUTPUTS = 4096;
+
+// Whether to use the two-stage reduction, which is always the case
+// with DISTCONV_DETERMINISTIC as it is deterministic.
+inline bool use_two_stage_reduction(index_t num_outputs) {
+  static const bool deterministic =
+      std::getenv("DISTCONV_DETERMINISTIC") != nullptr;
+  return deterministic || num_outputs <= TWO_STAGE_REDUCTION_MAX_OUTPUTS;
+}
+
+template <int ND, typename DataType, typename UnaryFunction>
+void reduce_sum_two_stage(const DataType *src,
+                          const Array<ND> &src_strides,
+                          const Shape &local_reduction_shape,
+                          DataType *dst,
+                          const Array<ND> &dst_shape,
+                          const Array<ND> &dst_strides,
+                          const UnaryFunction &op,
+                          h2::gpu::DeviceStream stream) {
+  constexpr int block_size = DEFAULT_BLOCK_SIZE;
+  constexpr int chunk_work_size = block_size * DEFAULT_MAX_THREAD_WORK_SIZE;
+  Array<ND> dst_region;
+  Array<ND> reduced_shape;
+  for (int i = 0; i < ND; ++i) {
+    const bool reduced = dst_shape[i] == 1;
+    dst_region[i] = reduced ? 1 : local_reduction_shape[i];
+    reduced_shape[i] = reduced ? local_reduction_shape[i] : 1;
+  }
+  const int num_outputs = dst_region.get_size();
+  const int reduced_size = reduced_shape.get_size();
+  if (num_outputs == 0 || reduced_size == 0) return;
+  const int num_chunks = std::min<int>(
+      (reduced_size + chunk_work_size - 1) / chunk_work_size, 65535);
+  const int chunk_size = (reduced_size + num_chunks - 1) / num_chunks;
+
+  DataType *partials = nullptr;
+  auto &mempool = internal::RuntimeGPU::get_device_memory_pool();
+  if (num_chunks > 1) {
+    partials = static_cast<DataType *>(mempool.get(
+        sizeof(DataType) * num_outputs * num_chunks, stream));
+  }
+  dim3 grid_dims(num_outputs, num_chunks);
+  reduce_partials_kernel<ND, DataType, UnaryFunction, block_size>
+      <<<grid_dims, block_size, 0, stream>>>(src,
+                                             src_strides,
+                                             dst_region,
+                                             reduced_shape,
+                                             chunk_size,
+                                             partials,
+                                             dst,
+                                             dst_strides,
+                                             op);
+  if (num_chunks > 1) {
+    reduce_partials_final_kernel<ND, DataType>
+        <<<(num_outputs + block_size - 1) / block_size,
+           block_size,
+           0,
+           stream>>>(partials, num_chunks, dst, dst_region, dst_strides);
+    // The pool orders the reuse of the partials after the stream
+    mempool.release(partials);
+  }
+}
+
 inline std::vector<int> find_reduce_dims(const Distribution &src_dist,
                                          const Distribution &dst_dist) {
   std::vector<int> reduction_dims;
@@ -134,6 +303,19 @@ inline std::vector<int> find_reduce_dims(const Distribution &src_dist,
   return reduction_dims;
 }
 
+// Number of outputs a reduction of region into dst updates.
+template <typename Tensor>
+index_t get_num_outputs(const Shape &region, const Tensor &dst) {
+  const auto dst_shape = dst.get_local_shape();
+  index_t n = 1;
+  for (int i = 0; i < region.num_dims(); ++i) {
+    if (dst_shape[i] != 1) {
+      n *= region[i];
+    }
+  }
+  return n;
+}
+
 template <int ND, typename Tensor, typename UnaryFunction>
 struct ReduceSumFunctor {
     int operator()(Tensor& src,
@@ -143,7 +325,22 @@ struct ReduceSumFunctor {
                    h2::gpu::DeviceStream stream)
     {
         using DataType = typename Tensor::data_type;
-        if (local_reduction_shape.size() > 0)
+        if (local_reduction_shape.size() > 0
+            && use_two_stage_reduction(
+                get_num_outputs(local_reduction_shape, dst)))
+        {
+            const auto src_strides = get_strides<ND>(
+                local_reduction_shape, src.get_overlap(), src.get_pitch());
+            reduce_sum_two_stage<ND>(src.get_const_base_ptr(),
+                                     src_strides,
+                                     local_reduction_shape,
+                                     dst.get_base_ptr(),
+                                     Array<ND>(dst.get_local_shape()),
+                                     Array<ND>(dst.get_strides()),
+                                     op,
+                                     stream);
+        }
+        else if (local_reduction_shape.size() > 0)
         {
             constexpr int block_size = DEFAULT_BLOCK_SIZE;
             constexpr int max_thread_work_size = DEFAULT_MAX_THREAD_WORK_SIZE;
@@ -177,7 +374,6 @@ struct ReduceSumFunctor {
                     dst_strides,
                     op,
                     thread_work_size);
-            h2::gpu::sync(stream);
         }
 
         // Finds the dimensions to reduce. Note that a dimension is not
@@ -185,7 +381,7 @@ struct ReduceSumFunctor {
         // != locale_shape.
         std::vector<int> reduction_dims =
             find_reduce_dims(src.get_distribution(), dst.get_distribution());
-        dst.allreduce(reduction_dims);
+        dst.allreduce(reduction_dims, stream);
 
         return 0;
     }
@@ -288,7 +484,32 @@ struct ReduceSumFunctor2 {
                    const UnaryFunction2& op2,
                    h2::gpu::DeviceStream stream)
     {
-        if (local_reduction_shape.size() > 0)
+        if (local_reduction_shape.size() > 0
+            && use_two_stage_reduction(
+                std::min(get_num_outputs(local_reduction_shape, dst1),
+                         get_num_outputs(local_reduction_shape, dst2))))
+        {
+            // Each output is reduced separately, reading src twice.
+            const auto src_strides = get_strides<ND>(
+                local_reduction_shape, src.get_overlap(), src.get_pitch());
+            reduce_sum_two_stage<ND>(src.get_const_base_ptr(),
+                                     src_strides,
+                                     local_reduction_shape,
+                                     dst1.get_base_ptr(),
+                                     Array<ND>(dst1.get_local_shape()),
+                                     Array<ND>(dst1.get_strides()),
+                                     op1,
+                                     stream);
+            reduce_sum_two_stage<ND>(src.get_const_base_ptr(),
+                                     src_strides,
+                                     local_reduction_shape,
+                                     dst2.get_base_ptr(),
+                                     Array<ND>(dst2.get_local_shape()),
+                                     Array<ND>(dst2.get_strides()),
+                                     op2,
+                                     stream);
+        }
+        else if (local_reduction_shape.size() > 0)
         {
             constexpr int block_size = DEFAULT_BLOCK_SIZE;
             constexpr int max_thread_work_size = DEFAULT_MAX_THREAD_WORK_SIZE;
@@ -322,15 +543,14 @@ struct ReduceSumFunctor2 {
                 dst2_strides,
                 op2,
                 thread_work_size);
-            h2::gpu::sync(stream);
         }
 
         std::vector<int> reduction_dims =
             find_reduce_dims(src.get_distribution(), dst1.get_distribution());
-        dst1.allreduce(reduction_dims);
+        dst1.allreduce(reduction_dims, stream);
         reduction_dims =
             find_reduce_dims(src.get_distribution(), dst2.get_distribution());
-        dst2.allreduce(reduction_dims);
+        dst2.allreduce(reduction_dims, stream);
         return 0;
     }
 };
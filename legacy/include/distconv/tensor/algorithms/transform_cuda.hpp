@@ -5,353 +5,246 @@
 #include "distconv/tensor/memory_gpu.hpp"
 #include "distconv/tensor/tensor.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <type_traits>
+#include <vector>
 
 namespace distconv {
 namespace tensor {
 namespace algorithms_cuda {
 
-template <int ND, typename DataType, int BLOCK_SIZE,
-          int INNER_DIM,
-          typename TransformFunc>
-__global__ void transform_kernel(
-    Array<ND> shape,
-    Array<ND> strides,
-    DataType *data,
-    TransformFunc op,
-    int thread_work_size,
-    int num_inner_blocks) {
-  const int tid = threadIdx.x;
-  int bid = blockIdx.x;
-  int inner_bid = bid % num_inner_blocks;
-  bid /= num_inner_blocks;
-  int inner_idx = tid + inner_bid * BLOCK_SIZE * thread_work_size;
-  int inner_size = 1;
-#pragma unroll
-  for (int i = 0; i <= INNER_DIM; ++i) {
-    inner_size *= shape[i];
-  }
-#pragma unroll
-  for (int i = INNER_DIM + 1; i < ND; ++i) {
-    data += strides[i] * (bid % shape[i]);
-    bid /= shape[i];
-  }
-
-  for (int i = 0; i < thread_work_size; ++i) {
-    int tensor_offset = 0;
-    int inner_idx_i = inner_idx;
-#pragma unroll
-    for (int j = 0; j <= INNER_DIM; ++j) {
-      int idx_j = inner_idx_i % shape[j];
-      tensor_offset += strides[j] * idx_j;
-      inner_idx_i /= shape[j];
+// Maximum number of blocks of a transform. Larger tensors are
+// traversed by grid-stride loops.
+constexpr int TRANSFORM_MAX_GRID_SIZE = 1 << 16;
+
+// Elements of a tensor loaded by a single access.
+template <typename DataType, int VEC>
+struct alignas(sizeof(DataType) * VEC) TransformVector {
+  DataType v[VEC];
+};
+
+// VEC consecutive elements of a tensor held in registers. Only
+// non-const tensors are written back.
+template <typename DataType, int VEC>
+struct TransformVectorRef {
+  using value_type = typename std::remove_const<DataType>::type;
+  using vector_type = TransformVector<value_type, VEC>;
+
+  __device__ explicit TransformVectorRef(DataType *p):
+      ptr(p), val(*reinterpret_cast<const vector_type *>(p)) {}
+
+  __device__ void store() const {
+    if constexpr (!std::is_const<DataType>::value) {
+      *reinterpret_cast<vector_type *>(ptr) = val;
     }
-    if (inner_idx < inner_size) {
-      op(data[tensor_offset]);
-    }
-    inner_idx += BLOCK_SIZE;
   }
-}
 
-template <int BLOCK_SIZE,
-          int INNER_DIM,
-          typename DataType,
-          typename TransformFunc>
-void transform(Shape shape,
-               IndexVector strides,
-               DataType* data,
-               TransformFunc op,
-               int thread_work_size,
-               int num_inner_blocks,
-               const dim3& grid_dims,
-               const dim3& block_dims,
-               h2::gpu::DeviceStream stream)
-{
-    const int nd = shape.num_dims();
-
-#define CALL_KERNEL(ND)                                                 \
-  transform_kernel<ND, DataType, BLOCK_SIZE, INNER_DIM, TransformFunc>  \
-      <<<grid_dims, block_dims, 0, stream>>>(                           \
-          Array<ND>(shape), Array<ND>(strides),                         \
-          data, op, thread_work_size, num_inner_blocks)
+  DataType *ptr;
+  vector_type val;
+};
 
-  switch (nd) {
-    case 3:
-      CALL_KERNEL(3);
-      break;
-    case 4:
-      CALL_KERNEL(4);
-      break;
-    case 5:
-      CALL_KERNEL(5);
-      break;
-    default:
-      throw std::exception();
+template <int VEC, typename TransformFunc, typename... Refs>
+__device__ __forceinline__ void transform_vectors(TransformFunc &op,
+                                                  Refs... refs) {
+#pragma unroll
+  for (int i = 0; i < VEC; ++i) {
+    op(refs.val.v[i]...);
   }
-#undef CALL_KERNEL
+  (refs.store(), ...);
 }
 
-template <int ND, typename DataType1, typename DataType2,
-          int BLOCK_SIZE, int INNER_DIM,
-          typename TransformFunc>
-__global__ void transform_kernel(Array<ND> shape, Array<ND> strides,
-                                 DataType1 *data1, DataType2 *data2,
+// Applies op to the elements at the same offsets of all tensors. The
+// tensors are traversed as ND dimensions of vectors of VEC elements,
+// whose strides are strides, with Index offsets.
+template <int ND, typename Index, int VEC, int BLOCK_SIZE,
+          typename TransformFunc, typename... DataTypes>
+__global__ void transform_kernel(Array<ND, Index> shape,
+                                 Array<ND, Index> strides,
+                                 Index num_vectors,
                                  TransformFunc op,
-                                 int thread_work_size, int num_inner_blocks) {
-  const int tid = threadIdx.x;
-  int bid = blockIdx.x;
-  int inner_bid = bid % num_inner_blocks;
-  bid /= num_inner_blocks;
-  int inner_idx = tid + inner_bid * BLOCK_SIZE * thread_work_size;
-  int inner_size = 1;
+                                 DataTypes *... data) {
+  const Index num_threads = static_cast<Index>(gridDim.x) * BLOCK_SIZE;
+  for (Index i = static_cast<Index>(blockIdx.x) * BLOCK_SIZE + threadIdx.x;
+       i < num_vectors; i += num_threads) {
+    Index offset = 0;
+    Index idx = i;
 #pragma unroll
-  for (int i = 0; i <= INNER_DIM; ++i) {
-    inner_size *= shape[i];
-  }
-#pragma unroll
-  for (int i = INNER_DIM + 1; i < ND; ++i) {
-    index_t offset = strides[i] * (bid % shape[i]);
-    data1 += offset;
-    data2 += offset;
-    bid /= shape[i];
+    for (int d = 0; d < ND - 1; ++d) {
+      offset += (idx % shape[d]) * strides[d];
+      idx /= shape[d];
+    }
+    offset += idx * strides[ND - 1];
+    if constexpr (VEC == 1) {
+      op(data[offset]...);
+    } else {
+      transform_vectors<VEC>(
+          op, TransformVectorRef<DataTypes, VEC>(data + offset)...);
+    }
   }
+}
 
-  for (int i = 0; i < thread_work_size; ++i) {
-    int tensor_offset = 0;
-    int inner_idx_i = inner_idx;
-#pragma unroll
-    for (int j = 0; j <= INNER_DIM; ++j) {
-      int idx_j = inner_idx_i % shape[j];
-      tensor_offset += strides[j] * idx_j;
-      inner_idx_i /= shape[j];
+// Merges each dimension into the next outer one when the two are
+// contiguous, and drops dimensions of size one, so that, e.g., a
+// tensor without halos is traversed as a single dimension.
+inline void collapse_dims(const Shape &shape, const IndexVector &strides,
+                          IndexVector &collapsed_shape,
+                          IndexVector &collapsed_strides) {
+  collapsed_shape = IndexVector();
+  collapsed_strides = IndexVector();
+  for (int i = 0; i < shape.num_dims(); ++i) {
+    if (shape[i] == 1) {
+      continue;
     }
-    if (inner_idx < inner_size) {
-      op(data1[tensor_offset],
-         data2[tensor_offset]);
+    const int last = collapsed_shape.length() - 1;
+    if (last >= 0 &&
+        strides[i] == collapsed_strides[last] * collapsed_shape[last]) {
+      collapsed_shape[last] *= shape[i];
+    } else {
+      collapsed_shape.push_back(shape[i]);
+      collapsed_strides.push_back(strides[i]);
     }
-    inner_idx += BLOCK_SIZE;
+  }
+  if (collapsed_shape.length() == 0) {
+    collapsed_shape.push_back(1);
+    collapsed_strides.push_back(1);
   }
 }
 
-template <int BLOCK_SIZE,
-          int INNER_DIM,
-          typename DataType1,
-          typename DataType2,
-          typename TransformFunc>
-void transform(Shape shape,
-               IndexVector strides,
-               DataType1* data1,
-               DataType2* data2,
-               TransformFunc op,
-               int thread_work_size,
-               int num_inner_blocks,
-               const dim3& grid_dims,
-               const dim3& block_dims,
-               h2::gpu::DeviceStream stream)
-{
-    const int nd = shape.num_dims();
-
-#define CALL_KERNEL(ND)                                                 \
-  transform_kernel<ND, DataType1, DataType2, BLOCK_SIZE, INNER_DIM,     \
-                   TransformFunc>                                       \
-      <<<grid_dims, block_dims, 0, stream>>>(                           \
-          Array<ND>(shape), Array<ND>(strides),                         \
-          data1, data2,                                                 \
-          op, thread_work_size, num_inner_blocks)
-
-  switch (nd) {
-    case 3:
-      CALL_KERNEL(3);
-      break;
-    case 4:
-      CALL_KERNEL(4);
-      break;
-    case 5:
-      CALL_KERNEL(5);
-      break;
-    default:
-      throw std::exception();
-  }
-#undef CALL_KERNEL
+// Number of elements of each tensor accessed at once, so that the
+// largest type is loaded with 16-byte accesses.
+template <typename... DataTypes>
+constexpr int get_transform_vector_width() {
+  constexpr size_t max_size = std::max({sizeof(DataTypes)...});
+  return max_size >= 16 ? 1 : std::min<int>(16 / max_size, 4);
 }
 
-template <int ND, typename DataType1, typename DataType2, typename DataType3,
-          int BLOCK_SIZE, int INNER_DIM, typename TransformFunc>
-__global__ void transform_kernel(Array<ND> shape, Array<ND> strides,
-                                 DataType1 *data1, DataType2 *data2,
-                                 DataType3 *data3,
-                                 TransformFunc op,
-                                 int thread_work_size, int num_inner_blocks) {
-  const int tid = threadIdx.x;
-  int bid = blockIdx.x;
-  int inner_bid = bid % num_inner_blocks;
-  bid /= num_inner_blocks;
-  int inner_idx = tid + inner_bid * BLOCK_SIZE * thread_work_size;
-  int inner_size = 1;
-#pragma unroll
-  for (int i = 0; i <= INNER_DIM; ++i) {
-    inner_size *= shape[i];
-  }
-#pragma unroll
-  for (int i = INNER_DIM + 1; i < ND; ++i) {
-    index_t offset = strides[i] * (bid % shape[i]);
-    data1 += offset;
-    data2 += offset;
-    data3 += offset;
-    bid /= shape[i];
+// Returns true if the innermost dimension can be accessed as vectors
+// of vec elements. The tensors must be distinct, as the vectors of
+// all tensors are written back after op is applied.
+template <typename... DataTypes>
+bool can_vectorize_transform(const IndexVector &shape,
+                             const IndexVector &strides, int vec,
+                             DataTypes *... data) {
+  if (vec == 1 || strides[0] != 1 || shape[0] % vec != 0) {
+    return false;
   }
-
-  for (int i = 0; i < thread_work_size; ++i) {
-    int tensor_offset = 0;
-    int inner_idx_i = inner_idx;
-#pragma unroll
-    for (int j = 0; j <= INNER_DIM; ++j) {
-      int idx_j = inner_idx_i % shape[j];
-      tensor_offset += strides[j] * idx_j;
-      inner_idx_i /= shape[j];
+  for (int i = 1; i < shape.length(); ++i) {
+    if (strides[i] % vec != 0) {
+      return false;
     }
-    if (inner_idx < inner_size) {
-      op(data1[tensor_offset],
-         data2[tensor_offset],
-         data3[tensor_offset]);
+  }
+  const bool aligned =
+      ((reinterpret_cast<uintptr_t>(data) % (sizeof(DataTypes) * vec) == 0)
+       && ...);
+  const std::vector<const void *> ptrs = {data...};
+  for (size_t i = 0; i < ptrs.size(); ++i) {
+    for (size_t j = i + 1; j < ptrs.size(); ++j) {
+      if (ptrs[i] == ptrs[j]) {
+        return false;
+      }
     }
-    inner_idx += BLOCK_SIZE;
   }
+  return aligned;
 }
 
-template <int BLOCK_SIZE,
-          int INNER_DIM,
-          typename DataType1,
-          typename DataType2,
-          typename DataType3,
-          typename TransformFunc>
-void transform(Shape shape,
-               IndexVector strides,
-               DataType1* data1,
-               DataType2* data2,
-               DataType3* data3,
-               TransformFunc op,
-               int thread_work_size,
-               int num_inner_blocks,
-               const dim3& grid_dims,
-               const dim3& block_dims,
-               h2::gpu::DeviceStream stream)
-{
-    const int nd = shape.num_dims();
-
-#define CALL_KERNEL(ND)                                                 \
-  transform_kernel<ND, DataType1, DataType2, DataType3, BLOCK_SIZE,     \
-                   INNER_DIM, TransformFunc>                            \
-      <<<grid_dims, block_dims, 0, stream>>>(                           \
-          Array<ND>(shape), Array<ND>(strides),                         \
-          data1, data2, data3,                                          \
-          op, thread_work_size, num_inner_blocks)
-
-  switch (nd) {
-    case 3:
-      CALL_KERNEL(3);
-      break;
-    case 4:
-      CALL_KERNEL(4);
-      break;
-    case 5:
-      CALL_KERNEL(5);
-      break;
-    default:
-      throw std::exception();
-  }
-#undef CALL_KERNEL
+template <int ND, typename Index, int VEC, typename TransformFunc,
+          typename... DataTypes>
+void transform(const IndexVector &shape, const IndexVector &strides,
+               index_t num_vectors, TransformFunc op,
+               h2::gpu::DeviceStream stream, DataTypes *... data) {
+  constexpr int block_size = DEFAULT_BLOCK_SIZE;
+  const dim3 block_dims(block_size);
+  const dim3 grid_dims(static_cast<unsigned int>(
+      std::min<index_t>((num_vectors + block_size - 1) / block_size,
+                        TRANSFORM_MAX_GRID_SIZE)));
+  transform_kernel<ND, Index, VEC, block_size, TransformFunc, DataTypes...>
+      <<<grid_dims, block_dims, 0, stream>>>(
+          Array<ND, Index>(shape), Array<ND, Index>(strides),
+          static_cast<Index>(num_vectors), op, data...);
 }
 
-template <int ND, typename DataType1, typename DataType2, typename DataType3,
-          typename DataType4, int BLOCK_SIZE, int INNER_DIM,
-          typename TransformFunc>
-__global__ void transform_kernel(Array<ND> shape, Array<ND> strides,
-                                 DataType1 *data1, DataType2 *data2,
-                                 DataType3 *data3, DataType4 *data4,
-                                 TransformFunc op,
-                                 int thread_work_size, int num_inner_blocks) {
-  const int tid = threadIdx.x;
-  int bid = blockIdx.x;
-  int inner_bid = bid % num_inner_blocks;
-  bid /= num_inner_blocks;
-  int inner_idx = tid + inner_bid * BLOCK_SIZE * thread_work_size;
-  int inner_size = 1;
-#pragma unroll
-  for (int i = 0; i <= INNER_DIM; ++i) {
-    inner_size *= shape[i];
+template <int ND, int VEC, typename TransformFunc, typename... DataTypes>
+void transform(const IndexVector &shape, const IndexVector &strides,
+               TransformFunc op, h2::gpu::DeviceStream stream,
+               DataTypes *... data) {
+  index_t num_vectors = 1;
+  index_t max_offset = 0;
+  for (int i = 0; i < ND; ++i) {
+    num_vectors *= shape[i];
+    max_offset += (shape[i] - 1) * strides[i];
   }
-#pragma unroll
-  for (int i = INNER_DIM + 1; i < ND; ++i) {
-    index_t offset = strides[i] * (bid % shape[i]);
-    data1 += offset;
-    data2 += offset;
-    data3 += offset;
-    data4 += offset;
-    bid /= shape[i];
-  }
-
-  for (int i = 0; i < thread_work_size; ++i) {
-    int tensor_offset = 0;
-    int inner_idx_i = inner_idx;
-#pragma unroll
-    for (int j = 0; j <= INNER_DIM; ++j) {
-      int idx_j = inner_idx_i % shape[j];
-      tensor_offset += strides[j] * idx_j;
-      inner_idx_i /= shape[j];
-    }
-    if (inner_idx < inner_size) {
-      op(data1[tensor_offset],
-         data2[tensor_offset],
-         data3[tensor_offset],
-         data4[tensor_offset]);
-    }
-    inner_idx += BLOCK_SIZE;
+  // 32-bit offsets are used unless an offset, or the index of a
+  // thread in the grid-stride loop, may not fit.
+  constexpr index_t max_index32 = std::numeric_limits<int>::max();
+  if (num_vectors <= max_index32 && max_offset + VEC <= max_index32) {
+    transform<ND, unsigned int, VEC>(shape, strides, num_vectors, op,
+                                     stream, data...);
+  } else {
+    transform<ND, index_t, VEC>(shape, strides, num_vectors, op, stream,
+                                data...);
   }
 }
 
-template <int BLOCK_SIZE,
-          int INNER_DIM,
-          typename DataType1,
-          typename DataType2,
-          typename DataType3,
-          typename DataType4,
-          typename TransformFunc>
-void transform(Shape shape,
-               IndexVector strides,
-               DataType1* data1,
-               DataType2* data2,
-               DataType3* data3,
-               DataType4* data4,
-               TransformFunc op,
-               int thread_work_size,
-               int num_inner_blocks,
-               const dim3& grid_dims,
-               const dim3& block_dims,
-               h2::gpu::DeviceStream stream)
-{
-    const int nd = shape.num_dims();
-#define CALL_KERNEL(ND)                                                 \
-  transform_kernel<ND, DataType1, DataType2, DataType3, DataType4,      \
-                   BLOCK_SIZE, INNER_DIM, TransformFunc>                \
-      <<<grid_dims, block_dims, 0, stream>>>(                           \
-          Array<ND>(shape), Array<ND>(strides),                         \
-          data1, data2, data3, data4,                                   \
-          op, thread_work_size, num_inner_blocks)
-  switch (nd) {
+template <int VEC, typename TransformFunc, typename... DataTypes>
+void transform(const IndexVector &shape, const IndexVector &strides,
+               TransformFunc op, h2::gpu::DeviceStream stream,
+               DataTypes *... data) {
+  switch (shape.length()) {
+    case 1:
+      transform<1, VEC>(shape, strides, op, stream, data...);
+      break;
+    case 2:
+      transform<2, VEC>(shape, strides, op, stream, data...);
+      break;
     case 3:
-      CALL_KERNEL(3);
+      transform<3, VEC>(shape, strides, op, stream, data...);
       break;
     case 4:
-      CALL_KERNEL(4);
+      transform<4, VEC>(shape, strides, op, stream, data...);
       break;
     case 5:
-      CALL_KERNEL(5);
+      transform<5, VEC>(shape, strides, op, stream, data...);
       break;
     default:
+      util::MPIPrintStreamError()
+          << "Tensors with 6 or larger number of non-contiguous dimensions "
+          << "not supported.";
       throw std::exception();
   }
-#undef CALL_KERNEL
+}
+
+// Applies op to the elements at the same indices of tensors of shape
+// with strides. Contiguous dimensions are collapsed, and the
+// innermost dimension is accessed as vectors when the tensors are
+// aligned.
+template <typename TransformFunc, typename... DataTypes>
+void transform(const Shape &shape, const IndexVector &strides,
+               TransformFunc op, h2::gpu::DeviceStream stream,
+               DataTypes *... data) {
+  IndexVector collapsed_shape;
+  IndexVector collapsed_strides;
+  collapse_dims(shape, strides, collapsed_shape, collapsed_strides);
+  constexpr int vec = get_transform_vector_width<DataTypes...>();
+  const bool vectorize = can_vectorize_transform(
+      collapsed_shape, collapsed_strides, vec, data...);
+
+  util::MPIPrintStreamDebug()
+      << "transform shape: " << collapsed_shape
+      << ", strides: " << collapsed_strides
+      << ", vector width: " << (vectorize ? vec : 1);
+
+  if constexpr (vec > 1) {
+    if (vectorize) {
+      collapsed_shape[0] /= vec;
+      collapsed_strides[0] = vec;
+      transform<vec>(collapsed_shape, collapsed_strides, op, stream,
+                     data...);
+      return;
+    }
+  }
+  transform<1>(collapsed_shape, collapsed_strides, op, stream, data...);
 }
 
 } // namespace algorithms_cuda
@@ -366,64 +259,15 @@ Transform(Tensor& tensor, TransformFunc op, h2::gpu::DeviceStream stream = 0)
     if (tensor.get_local_size() == 0)
         return 0;
 
-    constexpr int block_size = algo::DEFAULT_BLOCK_SIZE;
-    constexpr int max_thread_work_size = algo::DEFAULT_MAX_THREAD_WORK_SIZE;
-    dim3 block_dims(block_size);
-    int thread_work_size;
-    dim3 grid_dims(0);
-    int inner_dim;
-    int num_inner_blocks;
-    algo::get_grid_dims2<block_size, max_thread_work_size>(
-        tensor.get_local_shape(),
-        grid_dims,
-        thread_work_size,
-        inner_dim,
-        num_inner_blocks);
-
     const auto shape = tensor.get_local_shape();
     const auto strides =
         get_strides(shape, tensor.get_overlap(), tensor.get_pitch());
-
-    util::MPIPrintStreamDebug()
-        << "grid_dim: " << grid_dims.x << ", inner dim: " << inner_dim
-        << ", num_inner_blocks: " << num_inner_blocks;
-
-    if (tensor.get_num_dims() > 5)
-    {
-        // The below switch block assumes ND <= 5. Otherwise, inner_dim
-        // can be >= 5, and the default case would hit. Simply repeating
-        // the case block would work.
-        util::MPIPrintStreamError()
-            << "Tensors with 6 or larger number of dimensions not supported.";
-        throw std::exception();
-    }
-
-#define CALL_TRANFORM(INNER_DIM)                                        \
-  algo::transform<block_size, INNER_DIM>(                               \
-      shape, strides, tensor.get_base_ptr(), op,                        \
-      thread_work_size, num_inner_blocks, grid_dims, block_dims, stream)
-
-  switch (inner_dim) {
-    case 0:
-      CALL_TRANFORM(0);
-      break;
-    case 1:
-      CALL_TRANFORM(1);
-      break;
-    case 2:
-      CALL_TRANFORM(2);
-      break;
-    case 3:
-      CALL_TRANFORM(3);
-      break;
-    case 4:
-      CALL_TRANFORM(4);
-      break;
-    default:
-      throw std::exception();
-  }
-#undef CALL_TRANFORM
-  return 0;
+    algo::transform(shape,
+                    strides,
+                    op,
+                    stream,
+                    tensor.get_base_ptr());
+    return 0;
 }
 
 template <typename Tensor1, typename Tensor2, typename TransformFunc>
@@ -449,64 +293,16 @@ Transform(Tensor1& tensor1,
     if (tensor1.get_local_size() == 0)
         return 0;
 
-    constexpr int block_size = algo::DEFAULT_BLOCK_SIZE;
-    constexpr int max_thread_work_size = algo::DEFAULT_MAX_THREAD_WORK_SIZE;
-    dim3 block_dims(block_size);
-    int thread_work_size;
-    dim3 grid_dims(0);
-    int inner_dim;
-    int num_inner_blocks;
-    algo::get_grid_dims2<block_size, max_thread_work_size>(
-        tensor1.get_local_shape(),
-        grid_dims,
-        thread_work_size,
-        inner_dim,
-        num_inner_blocks);
-
     const auto shape = tensor1.get_local_shape();
     const auto strides =
         get_strides(shape, tensor1.get_overlap(), tensor1.get_pitch());
-
-    util::MPIPrintStreamDebug()
-        << "grid_dim: " << grid_dims.x << ", inner dim: " << inner_dim
-        << ", num_inner_blocks: " << num_inner_blocks << ", shape: " << shape
-        << ", strides: " << strides;
-
-    if (tensor1.get_num_dims() > 5)
-    {
-        // The below switch block assumes ND <= 5. Otherwise, inner_dim
-        // can be >= 5, and the default case would hit. Simply repeating
-        // the case block would work.
-        util::MPIPrintStreamError()
-            << "Tensors with 6 or larger number of dimensions not supported.";
-        throw std::exception();
-    }
-
-#define CALL_TRANFORM(INNER_DIM) \
-  algo::transform<block_size, INNER_DIM>( \
-      shape, strides, tensor1.get_base_ptr(), tensor2.get_base_ptr(),   \
-      op, thread_work_size, num_inner_blocks, grid_dims, block_dims, stream);
-  switch (inner_dim) {
-    case 0:
-      CALL_TRANFORM(0);
-      break;
-    case 1:
-      CALL_TRANFORM(1);
-      break;
-    case 2:
-      CALL_TRANFORM(2);
-      break;
-    case 3:
-      CALL_TRANFORM(3);
-      break;
-    case 4:
-      CALL_TRANFORM(4);
-      break;
-    default:
-      throw std::exception();
-  }
-#undef CALL_TRANFORM
-  return 0;
+    algo::transform(shape,
+                    strides,
+                    op,
+                    stream,
+                    tensor1.get_base_ptr(),
+                    tensor2.get_base_ptr());
+    return 0;
 }
 
 template <typename Tensor1,
@@ -538,64 +334,17 @@ Transform(Tensor1& tensor1,
     if (tensor1.get_local_size() == 0)
         return 0;
 
-    constexpr int block_size = algo::DEFAULT_BLOCK_SIZE;
-    constexpr int max_thread_work_size = algo::DEFAULT_MAX_THREAD_WORK_SIZE;
-    dim3 block_dims(block_size);
-    int thread_work_size;
-    dim3 grid_dims(0);
-    int inner_dim;
-    int num_inner_blocks;
-    algo::get_grid_dims2<block_size, max_thread_work_size>(
-        tensor1.get_local_shape(),
-        grid_dims,
-        thread_work_size,
-        inner_dim,
-        num_inner_blocks);
-
     const auto shape = tensor1.get_local_shape();
     const auto strides =
         get_strides(shape, tensor1.get_overlap(), tensor1.get_pitch());
-
-    util::MPIPrintStreamDebug()
-        << "grid_dim: " << grid_dims.x << ", inner dim: " << inner_dim
-        << ", num_inner_blocks: " << num_inner_blocks;
-
-    if (tensor1.get_num_dims() > 5)
-    {
-        // The below switch block assumes ND <= 5. Otherwise, inner_dim
-        // can be >= 5, and the default case would hit. Simply repeating
-        // the case block would work.
-        util::MPIPrintStreamError()
-            << "Tensors with 6 or larger number of dimensions not supported.";
-        throw std::exception();
-    }
-#define CALL_TRANFORM(INNER_DIM)                                        \
-  algo::transform<block_size, INNER_DIM>(                               \
-      shape, strides, tensor1.get_base_ptr(), tensor2.get_base_ptr(),   \
-      tensor3.get_base_ptr(), op, thread_work_size, num_inner_blocks,   \
-      grid_dims, block_dims, stream)
-
-  switch (inner_dim) {
-    case 0:
-      CALL_TRANFORM(0);
-      break;
-    case 1:
-      CALL_TRANFORM(1);
-      break;
-    case 2:
-      CALL_TRANFORM(2);
-      break;
-    case 3:
-      CALL_TRANFORM(3);
-      break;
-    case 4:
-      CALL_TRANFORM(4);
-      break;
-    default:
-      throw std::exception();
-  }
-#undef CALL_TRANFORM
-  return 0;
+    algo::transform(shape,
+                    strides,
+                    op,
+                    stream,
+                    tensor1.get_base_ptr(),
+                    tensor2.get_base_ptr(),
+                    tensor3.get_base_ptr());
+    return 0;
 }
 
 template <typename Tensor1,
@@ -632,64 +381,18 @@ Transform(Tensor1& tensor1,
     if (tensor1.get_local_size() == 0)
         return 0;
 
-    constexpr int block_size = algo::DEFAULT_BLOCK_SIZE;
-    constexpr int max_thread_work_size = algo::DEFAULT_MAX_THREAD_WORK_SIZE;
-    dim3 block_dims(block_size);
-    int thread_work_size;
-    dim3 grid_dims(0);
-    int inner_dim;
-    int num_inner_blocks;
-    algo::get_grid_dims2<block_size, max_thread_work_size>(
-        tensor1.get_local_shape(),
-        grid_dims,
-        thread_work_size,
-        inner_dim,
-        num_inner_blocks);
-
     const auto shape = tensor1.get_local_shape();
     const auto strides =
         get_strides(shape, tensor1.get_overlap(), tensor1.get_pitch());
-
-    util::MPIPrintStreamDebug()
-        << "grid_dim: " << grid_dims.x << ", inner dim: " << inner_dim
-        << ", num_inner_blocks: " << num_inner_blocks << "\n";
-
-    if (tensor1.get_num_dims() > 5)
-    {
-        // The below switch block assumes ND <= 5. Otherwise, inner_dim
-        // can be >= 5, and the default case would hit. Simply repeating
-        // the case block would work.
-        util::MPIPrintStreamError()
-            << "Tensors with 6 or larger number of dimensions not supported.";
-        throw std::exception();
-    }
-#define CALL_TRANFORM(INNER_DIM)                                        \
-  algo::transform<block_size, INNER_DIM>(                               \
-      shape, strides, tensor1.get_base_ptr(), tensor2.get_base_ptr(),   \
-      tensor3.get_base_ptr(), tensor4.get_base_ptr(),                   \
-      op, thread_work_size, num_inner_blocks, grid_dims, block_dims, stream);
-
-  switch (inner_dim) {
-    case 0:
-      CALL_TRANFORM(0);
-      break;
-    case 1:
-      CALL_TRANFORM(1);
-      break;
-    case 2:
-      CALL_TRANFORM(2);
-      break;
-    case 3:
-      CALL_TRANFORM(3);
-      break;
-    case 4:
-      CALL_TRANFORM(4);
-      break;
-    default:
-      throw std::exception();
-  }
-#undef CALL_TRANFORM
-  return 0;
+    algo::transform(shape,
+                    strides,
+                    op,
+                    stream,
+                    tensor1.get_base_ptr(),
+                    tensor2.get_base_ptr(),
+                    tensor3.get_base_ptr(),
+                    tensor4.get_base_ptr());
+    return 0;
 }
 
 } // namespace tensor
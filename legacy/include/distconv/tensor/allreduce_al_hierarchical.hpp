@@ -0,0 +1,106 @@
+#pragma once
+
+#include "distconv/tensor/allreduce.hpp"
+#include "distconv/util/util_mpi.hpp"
+
+#include "h2/gpu/runtime.hpp"
+
+#include <Al.hpp>
+
+#include <memory>
+
+namespace distconv {
+namespace tensor {
+
+/*
+  Allreduce in two levels of the node topology.
+
+  The buffer is reduce-scattered among the ranks of each node, the
+  shards are allreduced among the ranks with the same local rank on
+  every node, and the reduced shards are allgathered within each
+  node. Only 1/L of the buffer crosses the network per rank with L
+  ranks per node, and the intra-node steps run over NVLink through
+  NCCL.
+
+  Elements left over when the count is not a multiple of L, and
+  communicators whose nodes have different numbers of ranks, are
+  allreduced over the whole communicator.
+*/
+template <typename DataType>
+class AllreduceAlHierarchical: public Allreduce<DataType> {
+  using AlComm = Al::NCCLBackend::comm_type;
+ public:
+  AllreduceAlHierarchical(MPI_Comm comm, h2::gpu::DeviceStream stream):
+      Allreduce<DataType>() {
+    int rank;
+    DISTCONV_CHECK_MPI(MPI_Comm_rank(comm, &rank));
+    m_local_mpi_comm = util::get_mpi_local_comm(comm);
+    DISTCONV_CHECK_MPI(MPI_Comm_rank(m_local_mpi_comm, &m_local_rank));
+    DISTCONV_CHECK_MPI(MPI_Comm_size(m_local_mpi_comm, &m_local_size));
+    DISTCONV_CHECK_MPI(MPI_Comm_split(comm, m_local_rank, rank,
+                                      &m_inter_mpi_comm));
+    int sizes[2] = {m_local_size, -m_local_size};
+    DISTCONV_CHECK_MPI(MPI_Allreduce(MPI_IN_PLACE, sizes, 2, MPI_INT,
+                                     MPI_MAX, comm));
+    m_uniform = sizes[0] == -sizes[1];
+    if (!m_uniform) {
+      util::MPIRootPrintStreamInfo()
+          << "Nodes have different numbers of ranks; hierarchical "
+          << "allreduce uses a flat allreduce";
+    }
+    m_comm = std::make_unique<AlComm>(comm, stream);
+    m_local_comm = std::make_unique<AlComm>(m_local_mpi_comm, stream);
+    m_inter_comm = std::make_unique<AlComm>(m_inter_mpi_comm, stream);
+  }
+
+  virtual ~AllreduceAlHierarchical() {
+    m_comm.reset();
+    m_local_comm.reset();
+    m_inter_comm.reset();
+    MPI_Comm_free(&m_local_mpi_comm);
+    MPI_Comm_free(&m_inter_mpi_comm);
+  }
+
+  using Allreduce<DataType>::allreduce;
+
+  virtual void allreduce(const DataType *send_buf, DataType *recv_buf,
+                         size_t count) override {
+    const size_t shard_count = m_uniform ? count / m_local_size : 0;
+    if (shard_count == 0 || m_local_size == 1 ||
+        m_inter_comm->size() == 1) {
+      Al::Allreduce<Al::NCCLBackend, DataType>(
+          send_buf, recv_buf, count, Al::ReductionOperator::sum, *m_comm);
+      return;
+    }
+    // In-place for NCCL: each rank's shard is at its offset in the
+    // gathered buffer.
+    DataType *shard = recv_buf + m_local_rank * shard_count;
+    Al::Reduce_scatter<Al::NCCLBackend, DataType>(
+        send_buf, shard, shard_count, Al::ReductionOperator::sum,
+        *m_local_comm);
+    Al::Allreduce<Al::NCCLBackend, DataType>(
+        shard, shard_count, Al::ReductionOperator::sum, *m_inter_comm);
+    Al::Allgather<Al::NCCLBackend, DataType>(
+        shard, recv_buf, shard_count, *m_local_comm);
+    const size_t sharded_count = shard_count * m_local_size;
+    if (sharded_count < count) {
+      Al::Allreduce<Al::NCCLBackend, DataType>(
+          send_buf + sharded_count, recv_buf + sharded_count,
+          count - sharded_count, Al::ReductionOperator::sum, *m_comm);
+    }
+  }
+
+ protected:
+  MPI_Comm m_local_mpi_comm;
+  MPI_Comm m_inter_mpi_comm;
+  int m_local_rank;
+  int m_local_size;
+  // Whether all nodes have the same number of ranks
+  bool m_uniform;
+  std::unique_ptr<AlComm> m_comm;
+  std::unique_ptr<AlComm> m_local_comm;
+  std::unique_ptr<AlComm> m_inter_comm;
+};
+
+} // namespace tensor
+} // namespace distconv
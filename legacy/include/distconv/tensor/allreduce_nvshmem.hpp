@@ -10,7 +10,11 @@
 #include "distconv/util/util_cuda.hpp"
 #include "distconv/util/nvshmem.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <utility>
+#include <vector>
 
 namespace distconv {
 namespace tensor {
@@ -70,11 +74,15 @@ struct AllreduceNVSHMEMDevice {
 template <typename DataType>
 class AllreduceNVSHMEM: public Allreduce<DataType> {
  public:
+  // RING is bandwidth optimal and TWO_TREE sits between it and the
+  // latency-optimal recursive doubling. AUTO picks the fastest of
+  // them for each message size as measured by calibrate.
   enum Algo {NAIVE, NATIVE, RECURSIVE_DOUBLING_HOST, RECURSIVE_DOUBLING,
-             RECURSIVE_DOUBLING_BUFFERED, RECURSIVE_DOUBLING_BLOCK};
+             RECURSIVE_DOUBLING_BUFFERED, RECURSIVE_DOUBLING_BLOCK,
+             RING, TWO_TREE, AUTO};
   AllreduceNVSHMEM(cudaStream_t stream, Algo algo=NAIVE):
       m_stream(stream), m_algo(algo), m_pid(nvshmem_my_pe()), m_np(nvshmem_n_pes()),
-      m_sync(0) {
+      m_sync(0), m_ring_sync(0), m_tree_sync(0) {
   }
 
   virtual ~AllreduceNVSHMEM() = default;
@@ -87,7 +95,12 @@ class AllreduceNVSHMEM: public Allreduce<DataType> {
       copy(send_buf, recv_buf, count);
       return;
     }
-    switch (m_algo) {
+    allreduce(send_buf, recv_buf, count, m_algo);
+  }
+
+  void allreduce(const DataType *send_buf, DataType *recv_buf,
+                 size_t count, Algo algo) {
+    switch (algo) {
       case NAIVE:
         allreduce_naive(send_buf, recv_buf, count);
         break;
@@ -106,6 +119,15 @@ class AllreduceNVSHMEM: public Allreduce<DataType> {
       case RECURSIVE_DOUBLING_BLOCK:
         recursive_doubling_block(send_buf, recv_buf, count);
         break;
+      case RING:
+        ring(send_buf, recv_buf, count);
+        break;
+      case TWO_TREE:
+        two_tree(send_buf, recv_buf, count);
+        break;
+      case AUTO:
+        allreduce(send_buf, recv_buf, count, select_algo(count));
+        break;
       default:
         util::MPIRootPrintStreamError() << "Unknown allreduce algorithm";
         std::abort();
@@ -121,6 +143,85 @@ class AllreduceNVSHMEM: public Allreduce<DataType> {
     m_sync.ensure_size(num_steps * count);
   }
 
+  // Times the algorithms AUTO chooses from at message sizes from 64
+  // up to max_count elements and records the fastest at each
+  // size. Done at the first AUTO allreduce if not called
+  // before. Collective.
+  void calibrate(size_t max_count=get_calibration_max_count()) {
+    std::vector<Algo> algos = {RING, TWO_TREE};
+    if (is_power_of_two(m_np)) {
+      algos.insert(algos.begin(), RECURSIVE_DOUBLING);
+    }
+    constexpr int num_reps = 4;
+    DataType *buf = nullptr;
+    DataType *times_d = nullptr;
+    DISTCONV_CHECK_CUDA(cudaMalloc(&buf, sizeof(DataType) * max_count));
+    DISTCONV_CHECK_CUDA(cudaMemset(buf, 0, sizeof(DataType) * max_count));
+    DISTCONV_CHECK_CUDA(cudaMalloc(&times_d,
+                                   sizeof(DataType) * algos.size()));
+    cudaEvent_t start, stop;
+    DISTCONV_CHECK_CUDA(cudaEventCreate(&start));
+    DISTCONV_CHECK_CUDA(cudaEventCreate(&stop));
+    m_calibration.clear();
+    for (size_t count = std::min((size_t)64, max_count); ;
+         count = std::min(count * 4, max_count)) {
+      std::vector<DataType> times(algos.size());
+      for (size_t i = 0; i < algos.size(); ++i) {
+        // Warm up, which also allocates buffers
+        allreduce(buf, buf, count, algos[i]);
+        DISTCONV_CHECK_CUDA(cudaEventRecord(start, m_stream));
+        for (int r = 0; r < num_reps; ++r) {
+          allreduce(buf, buf, count, algos[i]);
+        }
+        DISTCONV_CHECK_CUDA(cudaEventRecord(stop, m_stream));
+        DISTCONV_CHECK_CUDA(cudaEventSynchronize(stop));
+        float elapsed;
+        DISTCONV_CHECK_CUDA(cudaEventElapsedTime(&elapsed, start, stop));
+        // Microseconds, so that integer types work
+        times[i] = static_cast<DataType>(elapsed * 1000 / num_reps);
+      }
+      // Sum the times of all PEs so they make the same choice
+      DISTCONV_CHECK_CUDA(cudaMemcpyAsync(
+          times_d, times.data(), sizeof(DataType) * times.size(),
+          cudaMemcpyHostToDevice, m_stream));
+      allreduce_native(times_d, times_d, times.size());
+      DISTCONV_CHECK_CUDA(cudaMemcpyAsync(
+          times.data(), times_d, sizeof(DataType) * times.size(),
+          cudaMemcpyDeviceToHost, m_stream));
+      DISTCONV_CHECK_CUDA(cudaStreamSynchronize(m_stream));
+      const size_t best = std::min_element(times.begin(), times.end())
+          - times.begin();
+      m_calibration.emplace_back(count, algos[best]);
+      util::MPIRootPrintStreamDebug()
+          << "NVSHMEM allreduce of " << count << " elements: algorithm "
+          << algos[best] << " in " << times[best] / m_np << " us";
+      if (count == max_count) break;
+    }
+    DISTCONV_CHECK_CUDA(cudaEventDestroy(start));
+    DISTCONV_CHECK_CUDA(cudaEventDestroy(stop));
+    DISTCONV_CHECK_CUDA(cudaFree(times_d));
+    DISTCONV_CHECK_CUDA(cudaFree(buf));
+  }
+
+  // Returns the largest message size calibrated by default, set with
+  // DISTCONV_NVSHMEM_ALLREDUCE_CALIBRATION_MAX_COUNT.
+  static size_t get_calibration_max_count() {
+    const char *env =
+        std::getenv("DISTCONV_NVSHMEM_ALLREDUCE_CALIBRATION_MAX_COUNT");
+    return env ? std::max(std::atol(env), 1l) : (size_t)1 << 22;
+  }
+
+  // Returns the algorithm calibrated fastest for count elements.
+  Algo select_algo(size_t count) {
+    if (m_calibration.empty()) {
+      calibrate();
+    }
+    for (const auto &c: m_calibration) {
+      if (count <= c.first) return c.second;
+    }
+    return m_calibration.back().second;
+  }
+
   //template <typename T=DataType>
   template <typename T>
   AllreduceNVSHMEMDevice<T> get_for_device() {
@@ -136,16 +237,33 @@ class AllreduceNVSHMEM: public Allreduce<DataType> {
   Memory<NVSHMEMAllocator> m_buf;
   util::nvshmem::SyncArray m_sync;
   Memory<NVSHMEMAllocator> m_native_sync;
+  // Buffers and sync objects of the ring and two-tree algorithms,
+  // separate from those of the others so that switching algorithms
+  // between allreduces does not overwrite data still being read.
+  Memory<NVSHMEMAllocator> m_ring_buf;
+  Memory<NVSHMEMAllocator> m_tree_buf;
+  util::nvshmem::SyncArray m_ring_sync;
+  util::nvshmem::SyncArray m_tree_sync;
+  // Fastest algorithm up to each calibrated message size
+  std::vector<std::pair<size_t, Algo>> m_calibration;
+
+  static bool is_power_of_two(int n) {
+    return (n & (n - 1)) == 0;
+  }
 
   void ensure_buffer(size_t count) {
-    size_t cur_size = m_buf.get_size() / sizeof(DataType);
+    ensure_buffer(m_buf, count);
+  }
+
+  void ensure_buffer(Memory<NVSHMEMAllocator> &buf, size_t count) {
+    size_t cur_size = buf.get_size() / sizeof(DataType);
     if (cur_size >= count) {
       // the buffer is large enough
       return;
     }
     util::MPIPrintStreamInfo() << "Allocating NVSHMEM buffer of count " << count;
-    m_buf.allocate(count * sizeof(DataType));
-    m_buf.memset(0);
+    buf.allocate(count * sizeof(DataType));
+    buf.memset(0);
   }
 
   void allreduce_naive(const DataType *send_buf, DataType *recv_buf,
@@ -252,6 +370,112 @@ class AllreduceNVSHMEM: public Allreduce<DataType> {
     }
   }
 
+  // Reduce-scatter and allgather around the ring of PEs. At each of
+  // the 2(np-1) steps, a PE sends one of np chunks to the next PE and
+  // receives one from the previous PE, after the next PE has
+  // signaled its buffer is free.
+  void ring(const DataType *send_buf, DataType *recv_buf, size_t count) {
+    copy(send_buf, recv_buf, count);
+    ensure_buffer(m_ring_buf, (count + m_np - 1) / m_np);
+    // Slot 0 signals a free buffer to the previous PE, slot 1 data to
+    // the next PE.
+    m_ring_sync.ensure_size(2);
+    constexpr auto st = util::nvshmem::SyncType::FENCE;
+    const int next = (m_pid + 1) % m_np;
+    const int prev = (m_pid + m_np - 1) % m_np;
+    DataType *ring_buf = static_cast<DataType*>(m_ring_buf.get());
+    auto chunk_offset = [&](int i) { return count * i / m_np; };
+    for (int s = 0; s < 2 * (m_np - 1); ++s) {
+      // Chunk (pid - s) is sent in the reduce-scatter and allgather
+      // steps alike.
+      const int send_chunk = ((m_pid - s) % m_np + m_np) % m_np;
+      const int recv_chunk = (send_chunk + m_np - 1) % m_np;
+      const size_t send_offset = chunk_offset(send_chunk);
+      const size_t send_len = chunk_offset(send_chunk + 1) - send_offset;
+      const size_t recv_offset = chunk_offset(recv_chunk);
+      const size_t recv_len = chunk_offset(recv_chunk + 1) - recv_offset;
+      m_ring_sync.sync(prev, true, true,
+                       util::nvshmem::SyncType::NONE, 0, m_stream);
+      if (send_len > 0) {
+        nvshmemx_putmem_on_stream((void*)ring_buf, recv_buf + send_offset,
+                                  send_len * sizeof(DataType),
+                                  next, m_stream);
+      }
+      m_ring_sync.sync(next, true, true, st, 1, m_stream);
+      if (recv_len > 0) {
+        if (s < m_np - 1) {
+          reduce(ring_buf, recv_buf + recv_offset, recv_len);
+        } else {
+          copy(ring_buf, recv_buf + recv_offset, recv_len);
+        }
+      }
+    }
+  }
+
+  // Reduce and broadcast over two binary trees, each taking half of
+  // the buffer. The second tree numbers the PEs in reverse, so the
+  // leaves of one tree are the inner nodes of the other and all PEs
+  // send and receive about the same amount.
+  void two_tree(const DataType *send_buf, DataType *recv_buf,
+                size_t count) {
+    copy(send_buf, recv_buf, count);
+    const size_t half = count - count / 2;
+    // Each tree has a region for each child and one for the parent.
+    constexpr int num_regions = 3;
+    ensure_buffer(m_tree_buf, half * num_regions * 2);
+    m_tree_sync.ensure_size(num_regions * 2);
+    constexpr auto st = util::nvshmem::SyncType::FENCE;
+    DataType *tree_buf = static_cast<DataType*>(m_tree_buf.get());
+    auto pe = [&](int t, int v) { return t == 0 ? v : m_np - 1 - v; };
+    auto region = [&](int t, int r) {
+      return tree_buf + (t * num_regions + r) * half;
+    };
+    const size_t offsets[2] = {0, count / 2};
+    const size_t lens[2] = {count / 2, half};
+    // Reduce toward the roots
+    for (int t = 0; t < 2; ++t) {
+      if (lens[t] == 0) continue;
+      const int v = pe(t, m_pid);
+      for (int c = 0; c < 2; ++c) {
+        if (2 * v + 1 + c >= m_np) break;
+        m_tree_sync.wait(t * num_regions + c, m_stream);
+        reduce(region(t, c), recv_buf + offsets[t], lens[t]);
+      }
+      if (v > 0) {
+        const int parent = pe(t, (v - 1) / 2);
+        const int c = (v - 1) % 2;
+        nvshmemx_putmem_on_stream((void*)region(t, c),
+                                  recv_buf + offsets[t],
+                                  lens[t] * sizeof(DataType),
+                                  parent, m_stream);
+        m_tree_sync.notify(parent, st, t * num_regions + c, m_stream);
+      }
+    }
+    // Broadcast from the roots
+    for (int t = 0; t < 2; ++t) {
+      if (lens[t] == 0) continue;
+      const int v = pe(t, m_pid);
+      if (v > 0) {
+        m_tree_sync.wait(t * num_regions + 2, m_stream);
+        copy(region(t, 2), recv_buf + offsets[t], lens[t]);
+      }
+      for (int c = 0; c < 2; ++c) {
+        if (2 * v + 1 + c >= m_np) break;
+        const int child = pe(t, 2 * v + 1 + c);
+        nvshmemx_putmem_on_stream((void*)region(t, 2),
+                                  recv_buf + offsets[t],
+                                  lens[t] * sizeof(DataType),
+                                  child, m_stream);
+        m_tree_sync.notify(child, st, t * num_regions + 2, m_stream);
+      }
+    }
+    // Every PE advances all counters once, whether or not it used
+    // them, so they stay equal across PEs.
+    for (int i = 0; i < num_regions * 2; ++i) {
+      m_tree_sync.inc_counter(i, m_stream);
+    }
+  }
+
   void set_blocking_params(size_t count, size_t &work_per_block, int &block_size,
                            int &grid_size) {
     // default work size
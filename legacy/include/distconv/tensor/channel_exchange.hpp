@@ -8,6 +8,9 @@
 
 #include <Al.hpp>
 
+#include <cstdlib>
+#include <vector>
+
 namespace distconv {
 namespace tensor {
 
@@ -39,26 +42,50 @@ class ChannelExchange {
                               Al::NCCLBackend::comm_type& comm,
                               h2::gpu::DeviceStream stream)
   {
+      reduce_scatter(src, dst, 0, src.get_local_shape()[-1], comm, stream);
+  }
+
+  /**
+   * Reduce-scatter samples [sample_offset, sample_offset + num_samples)
+   * of src by channels into the same samples of dst.
+   *
+   * The remaining samples are not accessed, so they may still be being
+   * computed on another stream.
+   */
+  virtual void reduce_scatter(TensorType& src,
+                              TensorType& dst,
+                              index_t sample_offset,
+                              index_t num_samples,
+                              Al::NCCLBackend::comm_type& comm,
+                              h2::gpu::DeviceStream stream)
+  {
+      DataType* src_ptr =
+          src.get_base_ptr() + sample_offset * get_sample_size(src);
+      DataType* dst_ptr =
+          dst.get_base_ptr() + sample_offset * get_sample_size(dst);
       // If there is only one sample, we can do this directly.
-      if (src.get_local_shape()[-1] == 1)
+      if (num_samples == 1)
       {
           Al::Reduce_scatter<Al::NCCLBackend, DataType>(
-              src.get_base_ptr(),
-              dst.get_base_ptr(),
+              src_ptr,
+              dst_ptr,
               get_sample_size(dst),
               Al::ReductionOperator::sum,
               comm);
           return;
       }
 
+      const size_t src_size = num_samples * get_sample_size(src);
       DataType* src_buf =
           (DataType*) distconv::internal::RuntimeGPU::get_device_memory_pool()
-              .get(src.get_local_size() * sizeof(DataType), stream);
+              .get(src_size * sizeof(DataType), stream);
       // Pack src such that we can reduce-scatter directly into dst.
-      pack_for_rs(src, dst, src_buf, comm.size(), stream);
+      pack_for_rs(src, dst, src_ptr, src_buf, num_samples, comm.size(),
+                  stream);
       Al::Reduce_scatter<Al::NCCLBackend, DataType>(src_buf,
-                                                    dst.get_base_ptr(),
-                                                    dst.get_local_size(),
+                                                    dst_ptr,
+                                                    num_samples
+                                                    * get_sample_size(dst),
                                                     Al::ReductionOperator::sum,
                                                     comm);
       distconv::internal::RuntimeGPU::get_device_memory_pool().release(src_buf);
@@ -79,6 +106,12 @@ class ChannelExchange {
           return;
       }
 
+      if (m_direct_allgather)
+      {
+          allgather_direct(src, dst, comm);
+          return;
+      }
+
       DataType* dst_buf =
           (DataType*) distconv::internal::RuntimeGPU::get_device_memory_pool()
               .get(dst.get_local_size() * sizeof(DataType), stream);
@@ -91,6 +124,49 @@ class ChannelExchange {
 
  protected:
 
+  // Whether multi-sample allgathers receive directly into dst rather
+  // than gathering into a buffer and unpacking it.
+  bool m_direct_allgather =
+      std::getenv("DISTCONV_CHANNEL_EXCHANGE_UNPACK") == nullptr;
+
+  /**
+   * Allgather src by channels into dst with point-to-point transfers.
+   *
+   * Each sample of each rank is received at its place in dst, which
+   * removes the copy through a gathered buffer.
+   */
+  void allgather_direct(TensorType& src,
+                        TensorType& dst,
+                        Al::NCCLBackend::comm_type& comm)
+  {
+      const index_t num_samples = src.get_local_shape()[-1];
+      const size_t src_sample_size = get_sample_size(src);
+      const size_t dst_sample_size = get_sample_size(dst);
+      const size_t num_transfers = comm.size() * num_samples;
+      std::vector<const DataType*> send_bufs;
+      std::vector<DataType*> recv_bufs;
+      std::vector<int> peers;
+      send_bufs.reserve(num_transfers);
+      recv_bufs.reserve(num_transfers);
+      peers.reserve(num_transfers);
+      // Transfers between a pair of ranks are matched in order, so
+      // each peer's samples arrive in sample order.
+      for (int peer = 0; peer < comm.size(); ++peer)
+      {
+          for (index_t s = 0; s < num_samples; ++s)
+          {
+              send_bufs.push_back(src.get_const_base_ptr()
+                                  + s * src_sample_size);
+              recv_bufs.push_back(dst.get_base_ptr() + s * dst_sample_size
+                                  + peer * src_sample_size);
+              peers.push_back(peer);
+          }
+      }
+      std::vector<size_t> counts(num_transfers, src_sample_size);
+      Al::MultiSendRecv<Al::NCCLBackend, DataType>(
+          send_bufs, counts, peers, recv_bufs, counts, peers, comm);
+  }
+
   index_t get_sample_size(const TensorType &t) const {
     IndexVector idx = IndexVector(t.get_num_dims(), 0);
     idx[-1] = 1;
@@ -105,7 +181,9 @@ class ChannelExchange {
 
   void pack_for_rs(TensorType& src,
                    TensorType& dst,
+                   const DataType* src_ptr,
                    DataType* dst_buf,
+                   index_t num_samples,
                    size_t comm_size,
                    h2::gpu::DeviceStream stream);
 
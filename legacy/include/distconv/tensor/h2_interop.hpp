@@ -0,0 +1,336 @@
+#pragma once
+
+#include "distconv/tensor/tensor_mpi_cuda.hpp"
+#include "distconv/util/util.hpp"
+
+#include "h2/core/sync.hpp"
+#include "h2/tensor/dist_tensor.hpp"
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/proc_grid.hpp"
+#include "h2/utils/As.hpp"
+
+#include <mpi.h>
+
+namespace distconv {
+namespace tensor {
+
+/*
+  Zero-copy views between distconv tensors and h2::DistTensor.
+
+  Both stacks lay out local data with dimension 0 fastest and map
+  ranks to their grids in column-major order, so a distconv tensor
+  whose distribution has an h2 equivalent can be viewed as a
+  DistTensor over the same buffer, and vice versa. For each dimension:
+
+  - split == locale (including a locale of 1) is Block, or Variable
+    if the local sizes differ from Block's (e.g., with a requested
+    local shape).
+  - split == 1 with locale > 1 is Replicated.
+
+  Other splits, overlap (halos), and cyclic block sizes have no h2
+  equivalent, and Single and Cyclic h2 distributions have no distconv
+  one unless the grid dimension has one rank. The is_*_viewable
+  functions check this; conversions of anything else are errors.
+
+  Views do not own their data: the viewed tensor must outlive them,
+  and must not be reallocated while they are in use.
+*/
+
+namespace internal {
+
+inline bool is_same_comm(MPI_Comm a, MPI_Comm b) {
+  int result;
+  MPI_Comm_compare(a, b, &result);
+  return result == MPI_IDENT || result == MPI_CONGRUENT;
+}
+
+// Whether ranks are mapped to the grid in column-major order.
+inline bool has_default_dim_order(const h2::ProcessorGrid &grid) {
+  const auto order = grid.dim_order();
+  for (typename h2::DimensionOrderTuple::size_type i = 0; i < order.size();
+       ++i) {
+    if (order[i] != static_cast<typename h2::DimensionOrderTuple::type>(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Sizes of the blocks of dimension dim on each rank of the locale.
+template <typename DataType>
+h2::BlockSizes get_block_sizes(
+    const Tensor<DataType, LocaleMPI, CUDAAllocator> &t, int dim) {
+  h2::BlockSizes sizes;
+  const auto num_ranks = t.get_locale_shape()[dim];
+  for (index_t i = 0; i < num_ranks; ++i) {
+    sizes.push_back(h2::safe_as<h2::DimType>(t.get_remote_dimension(dim, i)));
+  }
+  return sizes;
+}
+
+template <typename DataType, typename BufferType>
+h2::DistTensor<DataType> make_h2_view(
+    BufferType buffer,
+    const Tensor<DataType, LocaleMPI, CUDAAllocator> &t,
+    const h2::ProcessorGrid &grid,
+    const h2::ComputeStream &stream,
+    const h2::DimensionTypeTuple &dim_types);
+
+template <typename DataType, typename BufferType>
+Tensor<DataType, LocaleMPI, CUDAAllocator> make_distconv_view(
+    BufferType buffer,
+    const h2::DistTensor<DataType> &t,
+    const LocaleMPI &locale);
+
+} // namespace internal
+
+// Returns whether t can be viewed as an h2::DistTensor.
+template <typename DataType>
+bool is_h2_viewable(const Tensor<DataType, LocaleMPI, CUDAAllocator> &t) {
+  const auto &dist = t.get_distribution();
+  if (t.get_num_dims() > static_cast<int>(h2::MAX_TENSOR_DIMS)) {
+    return false;
+  }
+  for (int i = 0; i < t.get_num_dims(); ++i) {
+    const auto locale = dist.get_locale_shape(i);
+    const auto split = dist.get_split_shape()[i];
+    if (dist.get_overlap(i) != 0 || dist.get_block_size(i) != 0) {
+      return false;
+    }
+    if (split != locale && split != 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the dimension types of a distconv tensor with num_dims
+// dimensions, which are ordered spatial (fastest), channel, sample.
+inline h2::DimensionTypeTuple get_h2_dim_types(int num_dims) {
+  h2::DimensionTypeTuple dim_types(
+      h2::TuplePad<h2::DimensionTypeTuple>(num_dims, h2::DT::Any));
+  if (num_dims >= 3) {
+    for (int i = 0; i < num_dims - 2; ++i) {
+      dim_types[i] = h2::DT::Spatial;
+    }
+    dim_types[num_dims - 2] = h2::DT::Channel;
+    dim_types[num_dims - 1] = h2::DT::Sample;
+  }
+  return dim_types;
+}
+
+// Returns a processor grid matching the locale and distribution of t.
+//
+// Grids may duplicate their communicator, so create one once and
+// reuse it for all tensors with the same locale shape.
+template <typename DataType>
+h2::ProcessorGrid make_h2_proc_grid(
+    const Tensor<DataType, LocaleMPI, CUDAAllocator> &t) {
+  const auto &locale_shape = t.get_locale_shape();
+  h2::ShapeTuple grid_shape(
+      h2::TuplePad<h2::ShapeTuple>(locale_shape.num_dims()));
+  for (int i = 0; i < locale_shape.num_dims(); ++i) {
+    grid_shape[i] = h2::safe_as<h2::DimType>(locale_shape[i]);
+  }
+  return h2::ProcessorGrid(h2::Comm(t.get_locale().get_comm()), grid_shape);
+}
+
+// Returns a DistTensor viewing the data of t, which must be
+// h2-viewable and allocated. grid must be over the same ranks as t's
+// locale, in the same order, with its shape (see make_h2_proc_grid).
+template <typename DataType>
+h2::DistTensor<DataType> as_h2_tensor(
+    Tensor<DataType, LocaleMPI, CUDAAllocator> &t,
+    const h2::ProcessorGrid &grid,
+    const h2::ComputeStream &stream,
+    const h2::DimensionTypeTuple &dim_types) {
+  return internal::make_h2_view(t.get_buffer(), t, grid, stream, dim_types);
+}
+
+template <typename DataType>
+h2::DistTensor<DataType> as_h2_tensor(
+    Tensor<DataType, LocaleMPI, CUDAAllocator> &t,
+    const h2::ProcessorGrid &grid,
+    const h2::ComputeStream &stream) {
+  return as_h2_tensor(t, grid, stream, get_h2_dim_types(t.get_num_dims()));
+}
+
+// Const version; the returned tensor is a const view.
+template <typename DataType>
+h2::DistTensor<DataType> as_h2_tensor(
+    const Tensor<DataType, LocaleMPI, CUDAAllocator> &t,
+    const h2::ProcessorGrid &grid,
+    const h2::ComputeStream &stream,
+    const h2::DimensionTypeTuple &dim_types) {
+  return internal::make_h2_view(t.get_const_buffer(), t, grid, stream,
+                                dim_types);
+}
+
+template <typename DataType>
+h2::DistTensor<DataType> as_h2_tensor(
+    const Tensor<DataType, LocaleMPI, CUDAAllocator> &t,
+    const h2::ProcessorGrid &grid,
+    const h2::ComputeStream &stream) {
+  return as_h2_tensor(t, grid, stream, get_h2_dim_types(t.get_num_dims()));
+}
+
+// Returns whether t can be viewed as a distconv tensor.
+template <typename DataType>
+bool is_distconv_viewable(const h2::DistTensor<DataType> &t) {
+  const auto grid = t.proc_grid();
+  if (t.get_device() != h2::Device::GPU
+      || !internal::has_default_dim_order(grid)) {
+    return false;
+  }
+  if (!t.is_local_empty() && !t.const_local_tensor().is_contiguous()) {
+    return false;
+  }
+  for (typename h2::ShapeTuple::size_type i = 0; i < t.ndim(); ++i) {
+    if (grid.shape(i) == 1) {
+      continue;
+    }
+    switch (t.distribution(i)) {
+      case h2::Distribution::Block:
+      case h2::Distribution::Replicated:
+        break;
+      case h2::Distribution::Variable:
+        // distconv treats a requested local size of 0 as no request.
+        for (const auto size : t.block_sizes(i)) {
+          if (size == 0) return false;
+        }
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+// Returns a distconv tensor viewing the local data of t, which must
+// be distconv-viewable. locale must be over the same ranks as t's
+// grid, in the same order.
+template <typename DataType>
+Tensor<DataType, LocaleMPI, CUDAAllocator> as_distconv_tensor(
+    h2::DistTensor<DataType> &t, const LocaleMPI &locale) {
+  return internal::make_distconv_view(
+      t.is_local_empty() ? nullptr : t.local_tensor().data(), t, locale);
+}
+
+// Const version. distconv has no const tensors, so the caller must not
+// write to the returned tensor.
+template <typename DataType>
+Tensor<DataType, LocaleMPI, CUDAAllocator> as_distconv_tensor(
+    const h2::DistTensor<DataType> &t, const LocaleMPI &locale) {
+  return internal::make_distconv_view(
+      t.is_local_empty() ? nullptr : t.const_local_tensor().const_data(), t,
+      locale);
+}
+
+namespace internal {
+
+template <typename DataType, typename BufferType>
+h2::DistTensor<DataType> make_h2_view(
+    BufferType buffer,
+    const Tensor<DataType, LocaleMPI, CUDAAllocator> &t,
+    const h2::ProcessorGrid &grid,
+    const h2::ComputeStream &stream,
+    const h2::DimensionTypeTuple &dim_types) {
+  assert_always(is_h2_viewable(t));
+  const int nd = t.get_num_dims();
+  const auto &dist = t.get_distribution();
+  assert_always(is_same_comm(grid.comm().GetMPIComm(),
+                             t.get_locale().get_comm()));
+  assert_always(has_default_dim_order(grid));
+  assert_always(grid.ndim() == static_cast<size_t>(nd));
+  assert_always(dim_types.size() == static_cast<size_t>(nd));
+
+  // Strides account for pitched allocations.
+  const auto strides = t.get_strides();
+  h2::ShapeTuple shape(h2::TuplePad<h2::ShapeTuple>(nd));
+  h2::ShapeTuple local_shape(h2::TuplePad<h2::ShapeTuple>(nd));
+  h2::StrideTuple local_strides(h2::TuplePad<h2::StrideTuple>(nd));
+  h2::DistributionTypeTuple dist_types(
+      h2::TuplePad<h2::DistributionTypeTuple>(nd));
+  h2::BlockSizesTuple block_sizes(nd);
+  bool has_variable = false;
+  for (int i = 0; i < nd; ++i) {
+    assert_always(grid.shape(i)
+                  == h2::safe_as<h2::DimType>(dist.get_locale_shape(i)));
+    shape[i] = h2::safe_as<h2::DimType>(t.get_shape()[i]);
+    local_shape[i] = h2::safe_as<h2::DimType>(t.get_local_shape()[i]);
+    local_strides[i] = h2::safe_as<h2::DataIndexType>(strides[i]);
+    if (dist.get_split_shape()[i] == 1 && dist.get_locale_shape(i) > 1) {
+      dist_types[i] = h2::Distribution::Replicated;
+      continue;
+    }
+    dist_types[i] = h2::Distribution::Block;
+    // Local sizes differ from Block's with requested local shapes or
+    // blocks.
+    auto sizes = get_block_sizes(t, i);
+    for (size_t r = 0; r < sizes.size(); ++r) {
+      if (sizes[r] != h2::internal::get_dim_local_size<
+              h2::Distribution::Block>(shape[i], grid.shape(i), r, false)) {
+        dist_types[i] = h2::Distribution::Variable;
+        block_sizes[i] = std::move(sizes);
+        has_variable = true;
+        break;
+      }
+    }
+  }
+  if (!has_variable) {
+    block_sizes.clear();
+  }
+
+  return h2::DistTensor<DataType>(
+      h2::Device::GPU, buffer, shape, dim_types, grid, dist_types,
+      local_shape, local_strides, stream, block_sizes);
+}
+
+template <typename DataType, typename BufferType>
+Tensor<DataType, LocaleMPI, CUDAAllocator> make_distconv_view(
+    BufferType buffer,
+    const h2::DistTensor<DataType> &t,
+    const LocaleMPI &locale) {
+  assert_always(is_distconv_viewable(t));
+  const auto grid = t.proc_grid();
+  assert_always(is_same_comm(grid.comm().GetMPIComm(), locale.get_comm()));
+  const int nd = static_cast<int>(t.ndim());
+
+  Shape shape(nd, 0);
+  Shape locale_shape(nd, 0);
+  Shape split_shape(nd, 0);
+  Shape requested_local_shape(nd, 0);
+  for (int i = 0; i < nd; ++i) {
+    shape[i] = t.shape(i);
+    locale_shape[i] = grid.shape(i);
+    switch (grid.shape(i) == 1 ? h2::Distribution::Block
+                               : t.distribution(i)) {
+      case h2::Distribution::Replicated:
+        split_shape[i] = 1;
+        break;
+      case h2::Distribution::Variable:
+        split_shape[i] = grid.shape(i);
+        requested_local_shape[i] =
+            t.block_sizes(i)[grid.get_dimension_rank(i)];
+        break;
+      default:
+        split_shape[i] = grid.shape(i);
+        break;
+    }
+  }
+  const Distribution dist(locale_shape, split_shape, IntVector(nd, 0),
+                          Shape(nd, 0));
+  Tensor<DataType, LocaleMPI, CUDAAllocator> view(
+      shape, locale, dist, requested_local_shape);
+  if (!t.is_local_empty()) {
+    assert_always(view.get_local_size()
+                  == static_cast<size_t>(t.local_numel()));
+  }
+  assert0(View(view, buffer));
+  return view;
+}
+
+} // namespace internal
+
+} // namespace tensor
+} // namespace distconv
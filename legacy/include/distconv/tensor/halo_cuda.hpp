@@ -2,6 +2,7 @@
 
 #include "distconv/base.hpp"
 #include "distconv/runtime_gpu.hpp"
+#include "distconv/tensor/halo_exchange.hpp"
 #include <distconv_config.hpp>
 
 #if H2_HAS_CUDA
@@ -140,6 +141,139 @@ void traverse_halo_generic(DataType* tensor,
 #undef CALL_KERNEL
 }
 
+// Traverse the box of region_shape points at region_offset.
+template <int ND, typename DataType, typename OpType>
+__global__
+    typename std::enable_if<OpType::group == HaloTraversalOpGroup::THREAD,
+                            void>::type
+    traverse_region_kernel(DataType* tensor,
+                           Array<ND> shape,
+                           Array<ND> region_offset,
+                           Array<ND> region_shape,
+                           size_t num_region_points,
+                           OpType op)
+{
+    const size_t num_threads = blockDim.x * gridDim.x;
+    for (size_t packed_offset = threadIdx.x + blockIdx.x * blockDim.x;
+         packed_offset < num_region_points;
+         packed_offset += num_threads)
+    {
+        size_t tensor_offset = 0;
+        size_t dim_offset = 1;
+        size_t offset = packed_offset;
+#pragma unroll
+        for (int i = 0; i < ND; ++i)
+        {
+            int idx = offset % region_shape[i] + region_offset[i];
+            tensor_offset += idx * dim_offset;
+            offset /= region_shape[i];
+            dim_offset *= shape[i];
+        }
+        op(tensor[tensor_offset], packed_offset);
+    }
+}
+
+template <typename DataType, typename OpType>
+void traverse_region(DataType* tensor,
+                     const Shape& shape,
+                     const IndexVector& region_offset,
+                     const Shape& region_shape,
+                     OpType op,
+                     const int nd,
+                     h2::gpu::DeviceStream s)
+{
+    const size_t num_region_points = region_shape.get_size();
+    if (num_region_points == 0)
+        return;
+    const int block_size = 256;
+    const int grid_size = (num_region_points + block_size - 1) / block_size;
+#define CALL_KERNEL(ND)                                                        \
+    traverse_region_kernel<ND, DataType, OpType>                               \
+        <<<grid_size, block_size, 0, s>>>(tensor,                              \
+                                          Array<ND>(shape),                    \
+                                          Array<ND>(region_offset),            \
+                                          Array<ND>(region_shape),             \
+                                          num_region_points,                   \
+                                          op)
+
+    switch (nd)
+    {
+    case 1: CALL_KERNEL(1); break;
+    case 2: CALL_KERNEL(2); break;
+    case 3: CALL_KERNEL(3); break;
+    case 4: CALL_KERNEL(4); break;
+    case 5: CALL_KERNEL(5); break;
+    case 6: CALL_KERNEL(6); break;
+    default: throw std::exception();
+    }
+#undef CALL_KERNEL
+}
+
+// Traverse many boxes at once. Each row of blocks (blockIdx.y) handles
+// one region.
+template <int ND, typename DataType, typename OpType>
+__global__
+    typename std::enable_if<OpType::group == HaloTraversalOpGroup::THREAD,
+                            void>::type
+    traverse_regions_kernel(DataType* tensor,
+                            Array<ND> shape,
+                            const HaloRegion* regions,
+                            OpType op)
+{
+    const HaloRegion& region = regions[blockIdx.y];
+    const size_t num_threads = blockDim.x * gridDim.x;
+    for (size_t packed_offset = threadIdx.x + blockIdx.x * blockDim.x;
+         packed_offset < region.num_points;
+         packed_offset += num_threads)
+    {
+        size_t tensor_offset = 0;
+        size_t dim_offset = 1;
+        size_t offset = packed_offset;
+#pragma unroll
+        for (int i = 0; i < ND; ++i)
+        {
+            int idx = offset % region.shape[i] + region.offset[i];
+            tensor_offset += idx * dim_offset;
+            offset /= region.shape[i];
+            dim_offset *= shape[i];
+        }
+        op(tensor[tensor_offset], region.buf_offset + packed_offset);
+    }
+}
+
+template <typename DataType, typename OpType>
+void traverse_regions(DataType* tensor,
+                      const Shape& shape,
+                      const HaloRegion* regions,
+                      int num_regions,
+                      size_t max_region_points,
+                      OpType op,
+                      const int nd,
+                      h2::gpu::DeviceStream s)
+{
+    if (num_regions == 0 || max_region_points == 0)
+        return;
+    const int block_size = 256;
+    const dim3 grid_dims((max_region_points + block_size - 1) / block_size,
+                         num_regions);
+#define CALL_KERNEL(ND)                                                        \
+    traverse_regions_kernel<ND, DataType, OpType>                              \
+        <<<grid_dims, block_size, 0, s>>>(                                     \
+            tensor, Array<ND>(shape), regions, op)
+
+    switch (nd)
+    {
+    case 1: CALL_KERNEL(1); break;
+    case 2: CALL_KERNEL(2); break;
+    case 3: CALL_KERNEL(3); break;
+    case 4: CALL_KERNEL(4); break;
+    case 5: CALL_KERNEL(5); break;
+    case 6: CALL_KERNEL(6); break;
+    default: throw std::exception();
+    }
+#undef CALL_KERNEL
+}
+
 // ND: 4, 5
 // Traverse halo at dimension 0
 template <typename DataType, typename OpType>
@@ -968,6 +1102,65 @@ void TraverseHalo(Tensor& tensor,
     }
 }
 
+/*
+  Apply op to each point of the box of region_shape points starting at
+  region_offset in the local real (halo-including) index space of the
+  tensor. op gets the index of the point within the packed box.
+ */
+template <typename Tensor, typename OpType>
+void TraverseRegion(Tensor& tensor,
+                    const IndexVector& region_offset,
+                    const Shape& region_shape,
+                    OpType op,
+                    h2::gpu::DeviceStream s)
+{
+    using ConstDataType = std::conditional_t<OpType::modifies_tensor,
+                                             typename Tensor::data_type,
+                                             typename Tensor::const_data_type>;
+    // Block-based operation not supported
+    assert_always(OpType::group == HaloTraversalOpGroup::THREAD);
+    internal::traverse_region<ConstDataType, OpType>(
+        static_cast<ConstDataType*>(tensor.get_buffer()),
+        tensor.get_local_real_shape(),
+        region_offset,
+        region_shape,
+        op,
+        tensor.get_num_dims(),
+        s);
+}
+
+/*
+  Apply op to each point of num_regions boxes in a single kernel
+  launch. regions must be in device memory. op gets the index of the
+  point within the packed box plus the buf_offset of the region, so
+  all regions can be packed into one buffer. max_region_points is the
+  largest num_points of the regions.
+ */
+template <typename Tensor, typename OpType>
+void TraverseRegions(Tensor& tensor,
+                     const HaloRegion* regions,
+                     int num_regions,
+                     size_t max_region_points,
+                     OpType op,
+                     h2::gpu::DeviceStream s)
+{
+    using ConstDataType = std::conditional_t<OpType::modifies_tensor,
+                                             typename Tensor::data_type,
+                                             typename Tensor::const_data_type>;
+    // Block-based operation not supported
+    assert_always(OpType::group == HaloTraversalOpGroup::THREAD);
+    assert_always(tensor.get_num_dims() <= max_halo_region_dims);
+    internal::traverse_regions<ConstDataType, OpType>(
+        static_cast<ConstDataType*>(tensor.get_buffer()),
+        tensor.get_local_real_shape(),
+        regions,
+        num_regions,
+        max_region_points,
+        op,
+        tensor.get_num_dims(),
+        s);
+}
+
 template <typename Tensor, typename OpType>
 void TraverseHalo(Tensor& tensor,
                   int dim,
@@ -1,13 +1,86 @@
 #pragma once
 
+#include "distconv/base.hpp"
 #include "distconv/tensor/stream.hpp"
 
+#include <cstddef>
+#include <cstdlib>
+#include <ostream>
+#include <string>
+
 namespace distconv {
 namespace tensor {
 
 enum class HaloExchangeAccumOp {
   ID, SUM, MAX, MIN};
 
+// Precision of packed halos while they are transferred. Halos of fp32
+// tensors can be converted to 16-bit types when packed and back when
+// unpacked, halving the bytes transferred at the cost of rounding the
+// halo points.
+enum class HaloTransferPrecision {
+  NATIVE, FP16, BF16};
+
+inline std::ostream& operator<<(std::ostream &os,
+                                const HaloTransferPrecision &p) {
+  switch (p) {
+    case HaloTransferPrecision::NATIVE:
+      return os << "NATIVE";
+    case HaloTransferPrecision::FP16:
+      return os << "FP16";
+    case HaloTransferPrecision::BF16:
+      return os << "BF16";
+  }
+  util::PrintStreamError() << "Unknown halo transfer precision";
+  std::abort();
+}
+
+inline HaloTransferPrecision GetHaloTransferPrecision(
+    const std::string &precision) {
+  if (precision == "NATIVE") {
+    return HaloTransferPrecision::NATIVE;
+  } else if (precision == "FP16") {
+    return HaloTransferPrecision::FP16;
+  } else if (precision == "BF16") {
+    return HaloTransferPrecision::BF16;
+  } else {
+    util::PrintStreamError() << "Unknown halo transfer precision: "
+                             << precision;
+    std::abort();
+  }
+}
+
+// Returns the precision set with DISTCONV_HALO_TRANSFER_PRECISION, or
+// NATIVE if it is not set.
+inline HaloTransferPrecision GetDefaultHaloTransferPrecision() {
+  const char *env = std::getenv("DISTCONV_HALO_TRANSFER_PRECISION");
+  return env ? GetHaloTransferPrecision(env) : HaloTransferPrecision::NATIVE;
+}
+
+// Maximum number of dimensions of regions traversed by TraverseRegions.
+constexpr int max_halo_region_dims = 6;
+
+// A box of the local real index space of a tensor, and where its points
+// start in a buffer shared with other regions.
+struct HaloRegion {
+  index_t offset[max_halo_region_dims];
+  index_t shape[max_halo_region_dims];
+  size_t num_points;
+  size_t buf_offset;
+};
+
+// Times, in milliseconds, of the phases of halo exchanges recorded
+// with HaloExchange::set_profiling. The sides of a dimension are
+// exchanged concurrently, so each phase takes the slower side, and
+// dimensions are added up.
+struct HaloExchangePhaseTimes {
+  float pack = 0;
+  // From the end of packing to the start of unpacking, which includes
+  // waiting for the peer.
+  float transfer = 0;
+  float unpack = 0;
+};
+
 template <typename DataType, typename Allocator, typename AlBackend>
 class HaloExchange;
 
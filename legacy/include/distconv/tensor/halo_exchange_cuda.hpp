@@ -10,13 +10,23 @@
 
 #include <Al.hpp>
 
+#include <algorithm>
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 namespace distconv {
 namespace tensor {
 
+template <typename DataType, typename Allocator, typename AlBackend>
+class HaloExchangeAuto;
+
 template <typename DataType, typename AlBackend>
 class HaloExchange<DataType, CUDAAllocator, AlBackend> {
+  // Delegates unpacking to the methods it selects.
+  template <typename, typename, typename>
+  friend class HaloExchangeAuto;
+
  public:
   using TensorType = Tensor<DataType, LocaleMPI, CUDAAllocator>;
   using CommType = std::shared_ptr<typename AlBackend::comm_type>;
@@ -36,17 +46,30 @@ class HaloExchange<DataType, CUDAAllocator, AlBackend> {
   HaloExchange(const HaloExchange<DataType, CUDAAllocator, AlBackend> &x):
       HaloExchange(x.m_tensor) {
     m_peers = x.m_peers;
+    m_transfer_precision = x.m_transfer_precision;
   }
 
   HaloExchange &operator=(const HaloExchange &x) {
     m_tensor = x.m_tensor;
     m_peers = x.m_peers;
+    m_transfer_precision = x.m_transfer_precision;
     m_halo_send.clear();
     m_halo_recv.clear();
     return *this;
   }
 
-  virtual ~HaloExchange() {}
+  virtual ~HaloExchange() {
+    for (auto &events: m_phase_events) {
+      for (auto side: SIDES) {
+        auto &e = events(side);
+        if (e.pack_start == nullptr) continue;
+        h2::gpu::destroy(e.pack_start);
+        h2::gpu::destroy(e.pack_end);
+        h2::gpu::destroy(e.unpack_start);
+        h2::gpu::destroy(e.unpack_end);
+      }
+    }
+  }
 
   /*
     rendezvous: synchronize before exchanging halos. Implicitly done
@@ -201,6 +224,71 @@ class HaloExchange<DataType, CUDAAllocator, AlBackend> {
              op);
   }
 
+  /*
+    Sets the precision packed halos are transferred in. Reduced
+    precisions are only supported for fp32 tensors and by methods that
+    transfer the packed buffers (see
+    supports_reduced_transfer_precision). All ranks exchanging halos of
+    a tensor must use the same precision.
+   */
+  void set_transfer_precision(HaloTransferPrecision precision) {
+    assert_always(precision == HaloTransferPrecision::NATIVE ||
+                  (std::is_same<DataType, float>::value &&
+                   supports_reduced_transfer_precision()));
+    m_transfer_precision = precision;
+  }
+
+  HaloTransferPrecision get_transfer_precision() const {
+    return m_transfer_precision;
+  }
+
+  /*
+    Enables recording events around packing and unpacking, whose
+    times are returned by get_phase_times. This is meant for profiling
+    as it adds events to the exchange streams. Methods that pack
+    without pack_dim (e.g., MPI_MULTIDIM) record nothing.
+   */
+  virtual void set_profiling(bool enable) {
+    m_profiling = enable;
+  }
+
+  /*
+    Returns the times of the phases of the last exchange of each
+    dimension and side since the previous call. This waits for the
+    recorded events.
+   */
+  virtual HaloExchangePhaseTimes get_phase_times() {
+    HaloExchangePhaseTimes times;
+    for (int dim = 0; dim < (int)m_phase_events.size(); ++dim) {
+      HaloExchangePhaseTimes dim_times;
+      for (auto side: SIDES) {
+        auto &e = m_phase_events[dim](side);
+        if (e.packed) {
+          h2::gpu::sync(e.pack_end);
+          dim_times.pack = std::max(
+              dim_times.pack, h2::gpu::elapsed_time(e.pack_start, e.pack_end));
+        }
+        if (e.unpacked) {
+          h2::gpu::sync(e.unpack_end);
+          dim_times.unpack = std::max(
+              dim_times.unpack,
+              h2::gpu::elapsed_time(e.unpack_start, e.unpack_end));
+          if (e.packed) {
+            dim_times.transfer = std::max(
+                dim_times.transfer,
+                h2::gpu::elapsed_time(e.pack_end, e.unpack_start));
+          }
+        }
+        e.packed = false;
+        e.unpacked = false;
+      }
+      times.pack += dim_times.pack;
+      times.transfer += dim_times.transfer;
+      times.unpack += dim_times.unpack;
+    }
+    return times;
+  }
+
   void dump_packed_halo(int dim) {
     int rank = m_tensor.get_locale().get_rank();
     DataType *h = new DataType[get_halo_size(dim)];
@@ -255,15 +343,70 @@ class HaloExchange<DataType, CUDAAllocator, AlBackend> {
   }
 
  protected:
+  // Events around the packing and unpacking of a side
+  struct PhaseEvents {
+    h2::gpu::DeviceEvent pack_start = nullptr;
+    h2::gpu::DeviceEvent pack_end = nullptr;
+    h2::gpu::DeviceEvent unpack_start = nullptr;
+    h2::gpu::DeviceEvent unpack_end = nullptr;
+    bool packed = false;
+    bool unpacked = false;
+  };
+
   TensorType &m_tensor;
   BoundaryAttributesV<Memory<CUDAAllocator>> m_halo_send;
   BoundaryAttributesV<Memory<CUDAAllocator>> m_halo_recv;
   BoundaryAttributesV<int> m_peers;
+  HaloTransferPrecision m_transfer_precision = HaloTransferPrecision::NATIVE;
+  bool m_profiling = false;
+  std::vector<BoundaryAttributes<PhaseEvents>> m_phase_events;
+
+  PhaseEvents &get_phase_events(int dim, Side side) {
+    if ((int)m_phase_events.size() <= dim) {
+      m_phase_events.resize(dim + 1);
+    }
+    auto &e = m_phase_events[dim](side);
+    if (e.pack_start == nullptr) {
+      e.pack_start = h2::gpu::make_event();
+      e.pack_end = h2::gpu::make_event();
+      e.unpack_start = h2::gpu::make_event();
+      e.unpack_end = h2::gpu::make_event();
+    }
+    return e;
+  }
 
   int &get_peer(int dim, Side side) {
     return m_peers(dim, side);
   }
 
+  virtual bool supports_reduced_transfer_precision() const {
+    return false;
+  }
+
+  // Applies DISTCONV_HALO_TRANSFER_PRECISION to fp32 tensors. Methods
+  // supporting reduced precisions call this when constructed.
+  void set_default_transfer_precision() {
+    if (std::is_same<DataType, float>::value) {
+      set_transfer_precision(GetDefaultHaloTransferPrecision());
+    }
+  }
+
+  size_t get_transfer_element_size() const {
+    return m_transfer_precision == HaloTransferPrecision::NATIVE ?
+        sizeof(DataType) : 2;
+  }
+
+  // Bytes of a packed halo as transferred
+  size_t get_transfer_bytes(int dim, int width) const {
+    return get_halo_size(dim, width) * get_transfer_element_size();
+  }
+
+  // Number of DataType elements a packed halo occupies as transferred
+  size_t get_transfer_count(int dim, int width) const {
+    return (get_transfer_bytes(dim, width) + sizeof(DataType) - 1)
+        / sizeof(DataType);
+  }
+
   virtual size_t get_halo_size(int dim, int width) const {
     auto local_real_shape = m_tensor.get_local_real_shape();
     local_real_shape[dim] = width;
@@ -282,8 +425,18 @@ class HaloExchange<DataType, CUDAAllocator, AlBackend> {
     return m_halo_recv(dim, side).get();
   }
 
+  // Number of elements a halo buffer of dimension dim holds. Buffers
+  // are sized for the largest local tensor of the distribution, so
+  // they remain valid when the number of samples shrinks (e.g., with
+  // Tensor::set_outermost_dimension for a partial minibatch).
+  size_t get_halo_buffer_size(int dim) const {
+    auto local_real_shape = m_tensor.get_max_local_real_shape();
+    local_real_shape[dim] = m_tensor.get_distribution().get_overlap(dim);
+    return local_real_shape.get_size();
+  }
+
   virtual void ensure_halo_buffers(int dim) {
-    size_t s = get_halo_size(dim) * sizeof(DataType);
+    size_t s = get_halo_buffer_size(dim) * sizeof(DataType);
     assert_always(s > 0);
     for (auto side: SIDES) {
       if (get_peer(dim, side) == MPI_PROC_NULL) continue;
@@ -369,7 +522,16 @@ class HaloExchange<DataType, CUDAAllocator, AlBackend> {
                 void* buf,
                 bool is_reverse)
   {
+      if (!m_profiling)
+      {
+          pack_or_unpack(dim, side, width, stream, buf, true, is_reverse);
+          return;
+      }
+      auto& e = get_phase_events(dim, side);
+      h2::gpu::record_event(e.pack_start, stream);
       pack_or_unpack(dim, side, width, stream, buf, true, is_reverse);
+      h2::gpu::record_event(e.pack_end, stream);
+      e.packed = true;
   }
 
   void unpack_dim(int dim,
@@ -380,7 +542,16 @@ class HaloExchange<DataType, CUDAAllocator, AlBackend> {
                   bool is_reverse,
                   HaloExchangeAccumOp op = HaloExchangeAccumOp::ID)
   {
+      if (!m_profiling)
+      {
+          pack_or_unpack(dim, side, width, stream, buf, false, is_reverse, op);
+          return;
+      }
+      auto& e = get_phase_events(dim, side);
+      h2::gpu::record_event(e.unpack_start, stream);
       pack_or_unpack(dim, side, width, stream, buf, false, is_reverse, op);
+      h2::gpu::record_event(e.unpack_end, stream);
+      e.unpacked = true;
   }
 
   void pack_or_unpack(int dim,
@@ -392,6 +563,25 @@ class HaloExchange<DataType, CUDAAllocator, AlBackend> {
                       bool is_reverse,
                       HaloExchangeAccumOp op = HaloExchangeAccumOp::ID);
 
+  // Packs or unpacks an arbitrary box of the local real index space
+  // (e.g., a face, edge, or corner of the halo).
+  void pack_or_unpack_region(const IndexVector& region_offset,
+                             const Shape& region_shape,
+                             h2::gpu::DeviceStream stream,
+                             void* buf,
+                             bool is_pack,
+                             HaloExchangeAccumOp op = HaloExchangeAccumOp::ID);
+
+  // Packs or unpacks many regions (in device memory) into or from
+  // one buffer with a single kernel launch.
+  void pack_or_unpack_regions(const HaloRegion* regions,
+                              int num_regions,
+                              size_t max_region_points,
+                              h2::gpu::DeviceStream stream,
+                              void* buf,
+                              bool is_pack,
+                              HaloExchangeAccumOp op = HaloExchangeAccumOp::ID);
+
   virtual bool unpack(int dim,
                       int width_rhs_recv,
                       int width_lhs_recv,
@@ -16,7 +16,9 @@ class HaloExchangeAL:
     DataType, Allocator, AlBackend>::CommType;
  public:
   HaloExchangeAL(TensorType &tensor):
-      HaloExchange<DataType, Allocator, AlBackend>(tensor) {}
+      HaloExchange<DataType, Allocator, AlBackend>(tensor) {
+    this->set_default_transfer_precision();
+  }
   HaloExchangeAL(const HaloExchangeAL &x):
       HaloExchange<DataType, Allocator, AlBackend>(x) {}
 
@@ -48,8 +50,8 @@ class HaloExchangeAL:
       const int width_recv = side == Side::RHS ? width_rhs_recv : width_lhs_recv;
       auto send_buf = this->get_send_buffer(dim, side);
       auto recv_buf = this->get_recv_buffer(dim, side);
-      size_t send_count = this->get_halo_size(dim, width_send);
-      size_t recv_count = this->get_halo_size(dim, width_recv);
+      size_t send_count = this->get_transfer_count(dim, width_send);
+      size_t recv_count = this->get_transfer_count(dim, width_recv);
       if (width_send > 0) {
         // pack the local halo
         this->pack_dim(dim, side, width_send, stream, send_buf, is_reverse);
@@ -68,6 +70,11 @@ class HaloExchangeAL:
     }
     return;
   }
+
+ protected:
+  bool supports_reduced_transfer_precision() const override {
+    return true;
+  }
 };
 
 } // namespace tensor
@@ -0,0 +1,346 @@
+#pragma once
+
+#include "distconv/tensor/halo_exchange_cuda.hpp"
+#include "distconv/tensor/halo_exchange_cuda_al.hpp"
+#include "distconv/tensor/halo_exchange_cuda_mpi.hpp"
+#ifdef DISTCONV_HAS_P2P
+#include "distconv/tensor/halo_exchange_cuda_hybrid.hpp"
+#include "distconv/tensor/halo_exchange_cuda_p2p.hpp"
+#endif // DISTCONV_HAS_P2P
+#include "distconv/util/util_mpi.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace distconv {
+namespace tensor {
+
+/*
+  Halo exchange that selects the fastest available method for each
+  dimension.
+
+  The first time halos of the whole tensor are exchanged, each method
+  is timed exchanging the halos of each dimension (without unpacking,
+  so the tensor is not modified), and the one with the lowest time
+  over all ranks is used for that dimension from then on. Dimensions
+  can thus use different methods, e.g., P2P for neighbors on the same
+  node and AL for neighbors across nodes. Both ends of a link must use
+  the same method, so methods are selected per dimension rather than
+  per side.
+
+  Selections are cached by the geometry of the halos (dimension, halo
+  sizes, and whether the neighbors are on the same node), so layers
+  with identical halos skip the timing. Selecting is collective over
+  the tensor's communicator.
+
+  The number of timed exchanges per method can be set with
+  DISTCONV_HALO_AUTO_TUNE_ITERS (default 5). NVSHMEM methods are not
+  considered, as they require NVSHMEM to be set up for the tensor.
+ */
+template <typename DataType, typename Allocator, typename AlBackend>
+class HaloExchangeAuto:
+      public HaloExchange<DataType, Allocator, AlBackend> {
+  using Base = HaloExchange<DataType, Allocator, AlBackend>;
+  using TensorType = typename Base::TensorType;
+  using CommType = typename Base::CommType;
+
+ public:
+#ifdef DISTCONV_HAS_P2P
+  HaloExchangeAuto(TensorType &tensor, p2p::P2P &p2p): Base(tensor) {
+    add_candidates();
+    m_candidates.emplace_back(
+        HaloExchangeMethod::P2P,
+        std::make_unique<HaloExchangeP2P<DataType, Allocator, AlBackend>>(
+            tensor, p2p));
+    m_candidates.emplace_back(
+        HaloExchangeMethod::HYBRID,
+        std::make_unique<HaloExchangeHybrid<DataType, Allocator, AlBackend>>(
+            tensor, p2p));
+  }
+#else
+  HaloExchangeAuto(TensorType &tensor): Base(tensor) {
+    add_candidates();
+  }
+#endif // DISTCONV_HAS_P2P
+
+  HaloExchangeAuto(const HaloExchangeAuto &x) = delete;
+  HaloExchangeAuto &operator=(const HaloExchangeAuto &x) = delete;
+
+  virtual ~HaloExchangeAuto() {}
+
+  using Base::exchange;
+  using Base::unpack;
+
+  void exchange(const IntVector& widths_rhs_send,
+                const IntVector& widths_rhs_recv,
+                const IntVector& widths_lhs_send,
+                const IntVector& widths_lhs_recv,
+                BoundaryAttributesV<CommType>& comms,
+                h2::gpu::DeviceStream stream_main,
+                bool rendezvous,
+                bool sync_back,
+                bool is_reverse,
+                bool skip_unpack,
+                HaloExchangeAccumOp op = HaloExchangeAccumOp::ID) override {
+    ensure_selected(widths_rhs_send, widths_rhs_recv,
+                    widths_lhs_send, widths_lhs_recv, comms);
+    Base::exchange(widths_rhs_send, widths_rhs_recv,
+                   widths_lhs_send, widths_lhs_recv,
+                   comms, stream_main, rendezvous, sync_back,
+                   is_reverse, skip_unpack, op);
+  }
+
+  void exchange(int dim,
+                int width_rhs_send, int width_rhs_recv,
+                int width_lhs_send, int width_lhs_recv,
+                CommType &comm_rhs,
+                CommType &comm_lhs,
+                bool rendezvous,
+                bool is_reverse,
+                bool skip_unpack,
+                HaloExchangeAccumOp op=HaloExchangeAccumOp::ID) override {
+    get_method(dim).exchange(dim, width_rhs_send, width_rhs_recv,
+                             width_lhs_send, width_lhs_recv,
+                             comm_rhs, comm_lhs, rendezvous, is_reverse,
+                             skip_unpack, op);
+  }
+
+  void set_profiling(bool enable) override {
+    Base::set_profiling(enable);
+    for (auto &c: m_candidates) {
+      if (c.second) c.second->set_profiling(enable);
+    }
+  }
+
+  // Adds up the phases of the methods, which pack and unpack.
+  HaloExchangePhaseTimes get_phase_times() override {
+    HaloExchangePhaseTimes times;
+    for (auto &c: m_candidates) {
+      if (!c.second) continue;
+      const auto t = c.second->get_phase_times();
+      times.pack += t.pack;
+      times.transfer += t.transfer;
+      times.unpack += t.unpack;
+    }
+    return times;
+  }
+
+  /*
+    Return the method used for dim. Before methods are selected, this
+    is MPI.
+   */
+  HaloExchangeMethod get_selected_method(int dim) const {
+    return m_selected.empty() ? HaloExchangeMethod::MPI
+        : m_candidates.at(m_selected.at(dim)).first;
+  }
+
+ protected:
+  /*
+    Key of cached selections: dimension, locality of the RHS and LHS
+    neighbors, and bytes sent and received on each side.
+   */
+  using GeometryKey = std::tuple<int, int, int,
+                                 size_t, size_t, size_t, size_t>;
+
+  // Locality of a neighbor.
+  static constexpr int no_peer = 0;
+  static constexpr int local_peer = 1;
+  static constexpr int remote_peer = 2;
+
+  std::vector<std::pair<HaloExchangeMethod, std::unique_ptr<Base>>>
+  m_candidates;
+  // Index of the candidate used for each dimension
+  std::vector<size_t> m_selected;
+
+  static std::map<GeometryKey, HaloExchangeMethod> &get_selection_cache() {
+    static std::map<GeometryKey, HaloExchangeMethod> cache;
+    return cache;
+  }
+
+  void add_candidates() {
+    m_candidates.emplace_back(
+        HaloExchangeMethod::MPI,
+        std::make_unique<HaloExchangeMPI<DataType, Allocator, AlBackend>>(
+            this->m_tensor));
+    m_candidates.emplace_back(
+        HaloExchangeMethod::AL,
+        std::make_unique<HaloExchangeAL<DataType, Allocator, AlBackend>>(
+            this->m_tensor));
+  }
+
+  Base &get_method(int dim) {
+    return *m_candidates.at(m_selected.empty() ? 0 : m_selected.at(dim))
+        .second;
+  }
+
+  bool unpack(int dim,
+              int width_rhs_recv,
+              int width_lhs_recv,
+              h2::gpu::DeviceStream stream_rhs,
+              h2::gpu::DeviceStream stream_lhs,
+              bool is_reverse,
+              HaloExchangeAccumOp op = HaloExchangeAccumOp::ID) override {
+    // Halos were received into the buffers of the selected method.
+    return get_method(dim).unpack(dim, width_rhs_recv, width_lhs_recv,
+                                  stream_rhs, stream_lhs, is_reverse, op);
+  }
+
+  static int get_num_tune_iters() {
+    auto env = std::getenv("DISTCONV_HALO_AUTO_TUNE_ITERS");
+    int iters = env ? std::atoi(env) : 5;
+    return iters > 0 ? iters : 1;
+  }
+
+  // Whether halos of dim may be exchanged on any rank.
+  bool may_exchange(int dim,
+                    int width_rhs_send, int width_rhs_recv,
+                    int width_lhs_send, int width_lhs_recv) const {
+    const auto &dist = this->m_tensor.get_distribution();
+    return dist.is_distributed(dim) && dist.get_split_shape()[dim] > 1 &&
+        (width_rhs_send > 0 || width_rhs_recv > 0 ||
+         width_lhs_send > 0 || width_lhs_recv > 0);
+  }
+
+  int get_peer_locality(int dim, Side side, MPI_Comm comm,
+                        MPI_Comm local_comm) {
+    int peer = this->get_peer(dim, side);
+    // Peers are not set (negative) if this rank exchanges no halos.
+    if (peer == MPI_PROC_NULL || peer < 0) return no_peer;
+    MPI_Group group, local_group;
+    DISTCONV_CHECK_MPI(MPI_Comm_group(comm, &group));
+    DISTCONV_CHECK_MPI(MPI_Comm_group(local_comm, &local_group));
+    int local_peer_rank;
+    DISTCONV_CHECK_MPI(MPI_Group_translate_ranks(
+        group, 1, &peer, local_group, &local_peer_rank));
+    DISTCONV_CHECK_MPI(MPI_Group_free(&group));
+    DISTCONV_CHECK_MPI(MPI_Group_free(&local_group));
+    return local_peer_rank == MPI_UNDEFINED ? remote_peer : local_peer;
+  }
+
+  // Time the candidate exchanging the halos of dim. Collective.
+  double time_candidate(Base &candidate, int dim,
+                        int width_rhs_send, int width_rhs_recv,
+                        int width_lhs_send, int width_lhs_recv,
+                        BoundaryAttributesV<CommType>& comms,
+                        int num_iters, MPI_Comm comm) {
+    double elapsed = 0.0;
+    // The first exchange sets up buffers and connections, so it is not
+    // timed.
+    for (int i = 0; i < num_iters + 1; ++i) {
+      DISTCONV_CHECK_MPI(MPI_Barrier(comm));
+      auto start = std::chrono::steady_clock::now();
+      candidate.exchange(dim, width_rhs_send, width_rhs_recv,
+                         width_lhs_send, width_lhs_recv,
+                         comms(dim, RHS), comms(dim, LHS),
+                         true, false, true);
+      h2::gpu::sync(comms(dim, RHS)->get_stream());
+      h2::gpu::sync(comms(dim, LHS)->get_stream());
+      if (i > 0) {
+        elapsed += std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+      }
+    }
+    return elapsed / num_iters;
+  }
+
+  // Select the method for each dimension, if not done yet. Collective.
+  void ensure_selected(const IntVector& widths_rhs_send,
+                       const IntVector& widths_rhs_recv,
+                       const IntVector& widths_lhs_send,
+                       const IntVector& widths_lhs_recv,
+                       BoundaryAttributesV<CommType>& comms) {
+    if (!m_selected.empty()) return;
+
+    MPI_Comm comm = this->m_tensor.get_locale().get_comm();
+    MPI_Comm local_comm = util::get_mpi_local_comm(comm);
+    const int num_iters = get_num_tune_iters();
+    auto &cache = get_selection_cache();
+    std::vector<size_t> selected(this->m_tensor.get_num_dims(), 0);
+
+    for (int dim = 0; dim < this->m_tensor.get_num_dims(); ++dim) {
+      if (!may_exchange(dim, widths_rhs_send[dim], widths_rhs_recv[dim],
+                        widths_lhs_send[dim], widths_lhs_recv[dim])) {
+        continue;
+      }
+      const int loc_rhs = get_peer_locality(dim, RHS, comm, local_comm);
+      const int loc_lhs = get_peer_locality(dim, LHS, comm, local_comm);
+      const GeometryKey key{
+        dim, loc_rhs, loc_lhs,
+        this->get_halo_size(dim, widths_rhs_send[dim]) * sizeof(DataType),
+        this->get_halo_size(dim, widths_rhs_recv[dim]) * sizeof(DataType),
+        this->get_halo_size(dim, widths_lhs_send[dim]) * sizeof(DataType),
+        this->get_halo_size(dim, widths_lhs_recv[dim]) * sizeof(DataType)};
+
+      // Use a cached selection only if all ranks have the same one.
+      int cached[2] = {-1, 1};
+      auto cache_i = cache.find(key);
+      if (cache_i != cache.end()) {
+        for (size_t c = 0; c < m_candidates.size(); ++c) {
+          if (m_candidates[c].first == cache_i->second) {
+            cached[0] = static_cast<int>(c);
+            cached[1] = -static_cast<int>(c);
+          }
+        }
+      }
+      DISTCONV_CHECK_MPI(MPI_Allreduce(
+          MPI_IN_PLACE, cached, 2, MPI_INT, MPI_MIN, comm));
+      if (cached[0] >= 0 && cached[0] == -cached[1]) {
+        selected[dim] = static_cast<size_t>(cached[0]);
+        continue;
+      }
+
+      // P2P requires all neighbors to be on the same node.
+      int all_local = loc_rhs != remote_peer && loc_lhs != remote_peer;
+      DISTCONV_CHECK_MPI(MPI_Allreduce(
+          MPI_IN_PLACE, &all_local, 1, MPI_INT, MPI_LAND, comm));
+      std::vector<double> times(m_candidates.size(),
+                                std::numeric_limits<double>::max());
+      for (size_t c = 0; c < m_candidates.size(); ++c) {
+#ifdef DISTCONV_HAS_P2P
+        if (m_candidates[c].first == HaloExchangeMethod::P2P && !all_local) {
+          continue;
+        }
+#endif // DISTCONV_HAS_P2P
+        times[c] = time_candidate(
+            *m_candidates[c].second, dim,
+            widths_rhs_send[dim], widths_rhs_recv[dim],
+            widths_lhs_send[dim], widths_lhs_recv[dim],
+            comms, num_iters, comm);
+      }
+      // The slowest rank determines the time of the exchange.
+      DISTCONV_CHECK_MPI(MPI_Allreduce(
+          MPI_IN_PLACE, times.data(), static_cast<int>(times.size()),
+          MPI_DOUBLE, MPI_MAX, comm));
+      size_t best = 0;
+      for (size_t c = 1; c < times.size(); ++c) {
+        if (times[c] < times[best]) best = c;
+      }
+      selected[dim] = best;
+      cache[key] = m_candidates[best].first;
+      util::MPIRootPrintStreamInfo()
+          << "Selected " << m_candidates[best].first
+          << " for halo exchange in dimension " << dim << " ("
+          << times[best] * 1e6 << " us)";
+    }
+    DISTCONV_CHECK_MPI(MPI_Comm_free(&local_comm));
+
+    // Release unselected methods. Selections are the same on all
+    // ranks, so this is collective as the destructors require. MPI is
+    // kept for dimensions without halos.
+    for (size_t c = 1; c < m_candidates.size(); ++c) {
+      bool used = false;
+      for (size_t s : selected) used |= s == c;
+      if (!used) m_candidates[c].second.reset();
+    }
+    m_selected = std::move(selected);
+  }
+};
+
+} // namespace tensor
+} // namespace distconv
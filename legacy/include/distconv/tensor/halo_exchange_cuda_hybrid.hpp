@@ -53,13 +53,13 @@ class HaloExchangeHybrid:
     }
     this->ensure_halo_buffers(dim);
     ensure_connection(dim);
-    BoundaryAttributes<cudaStream_t> streams(
+    BoundaryAttributes<h2::gpu::DeviceStream> streams(
         comm_lhs->get_stream(), comm_rhs->get_stream());
     if (rendezvous) m_p2p.barrier(get_conns(dim), streams.data(), 2);
     for (auto side: SIDES) {
       if (this->get_peer(dim, side) == MPI_PROC_NULL) continue;
       CommType &comm = side == Side::RHS ? comm_rhs : comm_lhs;
-      const cudaStream_t stream = comm->get_stream();
+      const h2::gpu::DeviceStream stream = comm->get_stream();
       const int width_send = side == Side::RHS ? width_rhs_send : width_lhs_send;
       const int width_recv = side == Side::RHS ? width_rhs_recv : width_lhs_recv;
       auto send_buf = this->get_send_buffer(dim, side);
@@ -1,10 +1,41 @@
 #pragma once
 
 #include "distconv/tensor/halo_exchange_cuda.hpp"
+#include "distconv/util/util_mpi.hpp"
+
+#include <cstdlib>
+#include <map>
+#include <tuple>
+#include <vector>
 
 namespace distconv {
 namespace tensor {
 
+/*
+  Halo exchange with (CUDA-aware) MPI point-to-point messages.
+
+  By default, halos are packed into temporary buffers before sending
+  and unpacked after receiving. When DISTCONV_HALO_EXCHANGE_MPI_ZERO_COPY
+  is set to a non-zero value, halos are instead sent from and received
+  into the tensor buffer directly: contiguous halos (e.g., those of the
+  outermost dimension) as plain byte ranges, and strided ones as MPI
+  subarray datatypes, which the MPI library can transfer without
+  separate pack and unpack passes. Exchanges that accumulate (other
+  than HaloExchangeAccumOp::ID) or that skip unpacking still go
+  through the buffers, as they must not write the tensor as data
+  arrives.
+
+  The same halos are exchanged over and over (e.g., once per layer and
+  iteration), so the messages are set up once as persistent requests
+  (MPI_Send_init/MPI_Recv_init) and only started and waited for in
+  each exchange. Requests and datatypes are kept per number of local
+  samples, so a smaller last minibatch of an epoch reuses its own set
+  instead of replacing the one of the full minibatches.
+
+  Packed halos can be transferred in a reduced precision (see
+  set_transfer_precision). Zero-copy transfers are not used then, as
+  the halos must be converted.
+ */
 template <typename DataType, typename Allocator, typename AlBackend>
 class HaloExchangeMPI:
       public HaloExchange<DataType, Allocator, AlBackend> {
@@ -14,11 +45,23 @@ class HaloExchangeMPI:
     DataType, Allocator, AlBackend>::CommType;
  public:
   HaloExchangeMPI(TensorType &tensor):
-      HaloExchange<DataType, Allocator, AlBackend>(tensor) {}
+      HaloExchange<DataType, Allocator, AlBackend>(tensor),
+      m_zero_copy(is_zero_copy_enabled()) {
+    this->set_default_transfer_precision();
+  }
   HaloExchangeMPI(const HaloExchangeMPI &x):
-      HaloExchange<DataType, Allocator, AlBackend>(x) {}
+      HaloExchange<DataType, Allocator, AlBackend>(x),
+      m_zero_copy(x.m_zero_copy) {}
 
-  virtual ~HaloExchangeMPI() {}
+  virtual ~HaloExchangeMPI() {
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (finalized) return;
+    free_persistent_requests();
+    for (auto &x: m_halo_types) {
+      MPI_Type_free(&x.second);
+    }
+  }
 
   using HaloExchange<DataType, Allocator, AlBackend>::exchange;
 
@@ -31,19 +74,30 @@ class HaloExchangeMPI:
                 bool is_reverse,
                 bool skip_unpack,
                 HaloExchangeAccumOp op=HaloExchangeAccumOp::ID) override {
-    const int tag = 0;
-
     if (!this->is_exchange_required(dim, width_rhs_send, width_rhs_recv,
                                     width_lhs_send, width_lhs_recv)) {
       return;
     }
 
-    MPI_Comm comm = this->m_tensor.get_locale().get_comm();
     MPI_Request send_req[2];
     MPI_Request recv_req[2];
     int num_send_requests = 0;
     int num_recv_requests = 0;
+
+    if (m_zero_copy && !skip_unpack && op == HaloExchangeAccumOp::ID &&
+        this->get_transfer_precision() == HaloTransferPrecision::NATIVE) {
+      exchange_zero_copy(dim, width_rhs_send, width_rhs_recv,
+                         width_lhs_send, width_lhs_recv,
+                         comm_rhs, comm_lhs, is_reverse);
+      return;
+    }
+
     this->ensure_halo_buffers(dim);
+    // Requests on the packed buffers are sized for one precision
+    if (m_persistent_precision != this->get_transfer_precision()) {
+      free_persistent_requests();
+      m_persistent_precision = this->get_transfer_precision();
+    }
 
     for (auto side: SIDES) {
       if (this->get_peer(dim, side) == MPI_PROC_NULL) continue;
@@ -56,11 +110,11 @@ class HaloExchangeMPI:
       auto send_buf = this->get_send_buffer(dim, side);
       auto recv_buf = this->get_recv_buffer(dim, side);
       if (width_recv > 0) {
-        size_t halo_bytes = this->get_halo_size(dim, width_recv)
-            * sizeof(DataType);
-        DISTCONV_CHECK_MPI(MPI_Irecv(
-            recv_buf, halo_bytes, MPI_BYTE,
-            this->get_peer(dim, side), tag, comm, &recv_req[num_recv_requests]));
+        size_t halo_bytes = this->get_transfer_bytes(dim, width_recv);
+        recv_req[num_recv_requests] = get_persistent_request(
+            dim, side, width_recv, HaloRegionKind::PACKED, false,
+            recv_buf, halo_bytes, MPI_BYTE);
+        DISTCONV_CHECK_MPI(MPI_Start(&recv_req[num_recv_requests]));
         ++num_recv_requests;
       }
       util::MPIPrintStreamDebug()
@@ -71,11 +125,11 @@ class HaloExchangeMPI:
         util::MPIPrintStreamDebug() << "Sending packed halo";
         // send
         h2::gpu::sync(stream);
-        size_t halo_bytes = this->get_halo_size(dim, width_send)
-            * sizeof(DataType);
-        DISTCONV_CHECK_MPI(MPI_Isend(
-            send_buf, halo_bytes, MPI_BYTE,
-            this->get_peer(dim, side), tag, comm, &send_req[num_send_requests]));
+        size_t halo_bytes = this->get_transfer_bytes(dim, width_send);
+        send_req[num_send_requests] = get_persistent_request(
+            dim, side, width_send, HaloRegionKind::PACKED, true,
+            send_buf, halo_bytes, MPI_BYTE);
+        DISTCONV_CHECK_MPI(MPI_Start(&send_req[num_send_requests]));
         ++num_send_requests;
       }
     }
@@ -98,6 +152,192 @@ class HaloExchangeMPI:
 
     return;
   }
+
+ protected:
+  bool m_zero_copy;
+  // Datatypes of halo regions by dimension, side, width, whether the
+  // region is inside the local domain, and number of local samples
+  std::map<std::tuple<int, Side, int, bool, index_t>, MPI_Datatype>
+      m_halo_types;
+
+  // Where messages are sent from or received into
+  enum class HaloRegionKind {PACKED, INNER, OUTER};
+  // Persistent requests by dimension, side, width, region, whether it
+  // is a send, and number of local samples
+  using PersistentRequestKey = std::tuple<int, Side, int, HaloRegionKind,
+                                          bool, index_t>;
+  std::map<PersistentRequestKey, MPI_Request> m_persistent_requests;
+  // Tensor buffer the INNER and OUTER requests refer to
+  const void *m_persistent_tensor_buf = nullptr;
+  // Transfer precision the PACKED requests are sized for
+  HaloTransferPrecision m_persistent_precision =
+      HaloTransferPrecision::NATIVE;
+
+  bool supports_reduced_transfer_precision() const override {
+    return true;
+  }
+
+  // Returns the persistent request for a message, setting it up the
+  // first time it is used. The request is inactive and copies of it
+  // can be started and waited for.
+  MPI_Request get_persistent_request(int dim, Side side, int width,
+                                     HaloRegionKind kind, bool is_send,
+                                     void *buf, int count,
+                                     MPI_Datatype type) {
+    const auto key = std::make_tuple(dim, side, width, kind, is_send,
+                                     get_num_local_samples());
+    auto it = m_persistent_requests.find(key);
+    if (it != m_persistent_requests.end()) {
+      return it->second;
+    }
+    MPI_Comm comm = this->m_tensor.get_locale().get_comm();
+    const int tag = 0;
+    const int peer = this->get_peer(dim, side);
+    MPI_Request req;
+    if (is_send) {
+      DISTCONV_CHECK_MPI(MPI_Send_init(buf, count, type, peer, tag,
+                                       comm, &req));
+    } else {
+      DISTCONV_CHECK_MPI(MPI_Recv_init(buf, count, type, peer, tag,
+                                       comm, &req));
+    }
+    m_persistent_requests.emplace(key, req);
+    return req;
+  }
+
+  void free_persistent_requests(bool tensor_only = false) {
+    for (auto it = m_persistent_requests.begin();
+         it != m_persistent_requests.end();) {
+      if (tensor_only && std::get<3>(it->first) == HaloRegionKind::PACKED) {
+        ++it;
+        continue;
+      }
+      MPI_Request_free(&it->second);
+      it = m_persistent_requests.erase(it);
+    }
+  }
+
+  static bool is_zero_copy_enabled() {
+    const char *env = std::getenv("DISTCONV_HALO_EXCHANGE_MPI_ZERO_COPY");
+    return env && std::atoi(env) != 0;
+  }
+
+  // Returns the offset (in elements) of the first point of dimension
+  // dim in the halo region, matching the regions of TraverseHalo.
+  index_t get_halo_start(int dim, Side side, int width, bool inner) {
+    const auto shape = this->m_tensor.get_local_real_shape();
+    if (side == Side::RHS) {
+      return inner ? shape[dim] - width * 2 : shape[dim] - width;
+    } else {
+      return inner ? width : 0;
+    }
+  }
+
+  index_t get_num_local_samples() const {
+    return this->m_tensor.get_local_shape()[-1];
+  }
+
+  // Returns true if the halo region is a contiguous range of the
+  // tensor buffer, i.e., all outer dimensions have size 1.
+  bool is_halo_contiguous(int dim) {
+    const auto shape = this->m_tensor.get_local_real_shape();
+    for (int i = dim + 1; i < this->m_tensor.get_num_dims(); ++i) {
+      if (shape[i] != 1) return false;
+    }
+    return true;
+  }
+
+  MPI_Datatype get_halo_type(int dim, Side side, int width, bool inner) {
+    const auto key = std::make_tuple(dim, side, width, inner,
+                                     get_num_local_samples());
+    auto it = m_halo_types.find(key);
+    if (it != m_halo_types.end()) {
+      return it->second;
+    }
+    const int nd = this->m_tensor.get_num_dims();
+    const auto shape = this->m_tensor.get_local_real_shape();
+    std::vector<int> sizes(nd), subsizes(nd), starts(nd, 0);
+    for (int i = 0; i < nd; ++i) {
+      sizes[i] = shape[i];
+      subsizes[i] = shape[i];
+    }
+    subsizes[dim] = width;
+    starts[dim] = get_halo_start(dim, side, width, inner);
+    // Dimension 0 is the fastest changing one
+    MPI_Datatype type;
+    DISTCONV_CHECK_MPI(MPI_Type_create_subarray(
+        nd, sizes.data(), subsizes.data(), starts.data(), MPI_ORDER_FORTRAN,
+        util::get_mpi_data_type<DataType>(), &type));
+    DISTCONV_CHECK_MPI(MPI_Type_commit(&type));
+    m_halo_types.emplace(key, type);
+    return type;
+  }
+
+  // Starts a send or receive of a halo region directly from or into
+  // the tensor buffer.
+  void post_zero_copy(int dim, Side side, int width, bool inner,
+                      bool is_send, MPI_Request *req) {
+    DataType *buf = this->m_tensor.get_buffer();
+    void *ptr;
+    int count;
+    MPI_Datatype type;
+    if (is_halo_contiguous(dim)) {
+      const auto shape = this->m_tensor.get_local_real_shape();
+      size_t stride = 1;
+      for (int i = 0; i < dim; ++i) stride *= shape[i];
+      ptr = buf + get_halo_start(dim, side, width, inner) * stride;
+      count = this->get_halo_size(dim, width);
+      type = util::get_mpi_data_type<DataType>();
+    } else {
+      ptr = buf;
+      count = 1;
+      type = get_halo_type(dim, side, width, inner);
+    }
+    *req = get_persistent_request(
+        dim, side, width,
+        inner ? HaloRegionKind::INNER : HaloRegionKind::OUTER,
+        is_send, ptr, count, type);
+    DISTCONV_CHECK_MPI(MPI_Start(req));
+  }
+
+  void exchange_zero_copy(int dim,
+                          int width_rhs_send, int width_rhs_recv,
+                          int width_lhs_send, int width_lhs_recv,
+                          CommType &comm_rhs,
+                          CommType &comm_lhs,
+                          bool is_reverse) {
+    MPI_Request reqs[4];
+    int num_requests = 0;
+    // Requests on the tensor are stale if its buffer has changed
+    if (m_persistent_tensor_buf != this->m_tensor.get_const_buffer()) {
+      free_persistent_requests(true);
+      m_persistent_tensor_buf = this->m_tensor.get_const_buffer();
+    }
+    // Sends read the tensor, so pending kernels on it must be done
+    h2::gpu::sync(comm_rhs->get_stream());
+    h2::gpu::sync(comm_lhs->get_stream());
+    for (auto side: SIDES) {
+      if (this->get_peer(dim, side) == MPI_PROC_NULL) continue;
+      const int width_send = side == Side::RHS
+          ? width_rhs_send : width_lhs_send;
+      const int width_recv = side == Side::RHS
+          ? width_rhs_recv : width_lhs_recv;
+      // In reverse mode, the outer halo is sent to update the inner
+      // halo of the peer
+      if (width_recv > 0) {
+        post_zero_copy(dim, side, width_recv, is_reverse, false,
+                       &reqs[num_requests++]);
+      }
+      if (width_send > 0) {
+        post_zero_copy(dim, side, width_send, !is_reverse, true,
+                       &reqs[num_requests++]);
+      }
+    }
+    if (num_requests > 0) {
+      DISTCONV_CHECK_MPI(MPI_Waitall(
+          num_requests, reqs, MPI_STATUSES_IGNORE));
+    }
+  }
 };
 
 } // namespace tensor
@@ -0,0 +1,369 @@
+#pragma once
+
+#include "distconv/tensor/halo_exchange_cuda.hpp"
+#include "distconv/tensor/halo_exchange_cuda_mpi.hpp"
+#include "distconv/tensor/memory.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace distconv {
+namespace tensor {
+
+/*
+  Halo exchange that exchanges the faces, edges, and corners of the
+  halo with all neighbors, including diagonal ones, in a single round.
+
+  The per-dimension methods exchange the dimensions one after another,
+  and corners reach diagonal neighbors by being forwarded through the
+  face neighbors in later rounds. Here, each rank instead sends each of
+  its up to 3^N-1 neighbors (8 in 2D, 26 in 3D) exactly the box it
+  needs, and all transfers are in flight at the same time. This
+  removes the dependence between rounds.
+
+  The boxes of all neighbors are packed into one contiguous send arena
+  (and unpacked from one receive arena) by a single kernel launch
+  driven by an array of region descriptors, so the number of launches
+  per exchange does not grow with the number of dimensions.
+
+  Only exchanges of the full halo widths of the tensor are done this
+  way. Others (e.g., asymmetric widths) fall back to the per-dimension
+  MPI exchange.
+
+  The region arenas are always transferred in the native precision.
+
+  When the number of local samples changes (e.g., for the last
+  minibatch of an epoch), only the regions and messages are set up
+  again. The arenas are kept as long as they are large enough.
+ */
+template <typename DataType, typename Allocator, typename AlBackend>
+class HaloExchangeMPIMultiDim:
+      public HaloExchangeMPI<DataType, Allocator, AlBackend> {
+  using Base = HaloExchange<DataType, Allocator, AlBackend>;
+  using MPIBase = HaloExchangeMPI<DataType, Allocator, AlBackend>;
+  using TensorType = typename Base::TensorType;
+  using CommType = typename Base::CommType;
+
+ public:
+  HaloExchangeMPIMultiDim(TensorType &tensor): MPIBase(tensor) {
+    this->set_transfer_precision(HaloTransferPrecision::NATIVE);
+  }
+
+  HaloExchangeMPIMultiDim(const HaloExchangeMPIMultiDim &x) = delete;
+  HaloExchangeMPIMultiDim &operator=(
+      const HaloExchangeMPIMultiDim &x) = delete;
+
+  virtual ~HaloExchangeMPIMultiDim() {
+    int finalized;
+    MPI_Finalized(&finalized);
+    if (finalized) return;
+    free_requests();
+  }
+
+  using MPIBase::exchange;
+  using Base::unpack;
+
+  void exchange(const IntVector& widths_rhs_send,
+                const IntVector& widths_rhs_recv,
+                const IntVector& widths_lhs_send,
+                const IntVector& widths_lhs_recv,
+                BoundaryAttributesV<CommType>& comms,
+                h2::gpu::DeviceStream stream_main,
+                bool rendezvous,
+                bool sync_back,
+                bool is_reverse,
+                bool skip_unpack,
+                HaloExchangeAccumOp op = HaloExchangeAccumOp::ID) override {
+    const IntVector &halo = this->m_tensor.get_halo_width();
+    if (widths_rhs_send != halo || widths_rhs_recv != halo ||
+        widths_lhs_send != halo || widths_lhs_recv != halo) {
+      MPIBase::exchange(widths_rhs_send, widths_rhs_recv,
+                        widths_lhs_send, widths_lhs_recv,
+                        comms, stream_main, rendezvous, sync_back,
+                        is_reverse, skip_unpack, op);
+      return;
+    }
+
+    ensure_neighbors();
+    if (m_neighbors.empty()) return;
+
+    // Start all receives first, so no send has to wait for one
+    DISTCONV_CHECK_MPI(MPI_Startall(m_recv_requests.size(),
+                                    m_recv_requests.data()));
+
+    // In reverse mode, the outer halo is sent back to the owners
+    this->pack_or_unpack_regions(
+        is_reverse ? get_outer_regions() : get_inner_regions(),
+        m_neighbors.size(), m_max_region_points, stream_main,
+        m_send_arena.get(), true);
+    h2::gpu::sync(stream_main);
+
+    DISTCONV_CHECK_MPI(MPI_Startall(m_send_requests.size(),
+                                    m_send_requests.data()));
+
+    DISTCONV_CHECK_MPI(MPI_Waitall(
+        m_recv_requests.size(), m_recv_requests.data(), MPI_STATUSES_IGNORE));
+
+    if (skip_unpack) {
+      m_unpack_pending = true;
+    } else {
+      unpack_neighbors(0, m_neighbors.size(), stream_main, is_reverse, op);
+    }
+
+    // Everything is done on stream_main, so sync_back needs no waits
+    DISTCONV_CHECK_MPI(MPI_Waitall(
+        m_send_requests.size(), m_send_requests.data(), MPI_STATUSES_IGNORE));
+  }
+
+ protected:
+  bool supports_reduced_transfer_precision() const override {
+    return false;
+  }
+
+  struct Neighbor {
+    int rank;
+    int send_tag;
+    int recv_tag;
+    // First dimension in which the neighbor is offset
+    int first_dim;
+    // Box sent to the neighbor in forward mode
+    IndexVector inner_offset;
+    // Box received from the neighbor in forward mode
+    IndexVector outer_offset;
+    Shape region_shape;
+    size_t num_bytes;
+    // Offset of the box in the arenas, in elements
+    size_t buf_offset;
+  };
+
+  // Sorted by first_dim
+  std::vector<Neighbor> m_neighbors;
+  bool m_neighbors_set = false;
+  // Number of local samples the neighbors are set up for
+  index_t m_neighbors_num_samples = 0;
+  bool m_unpack_pending = false;
+  Memory<Allocator> m_send_arena;
+  Memory<Allocator> m_recv_arena;
+  // Device arrays of HaloRegion, one per neighbor
+  Memory<Allocator> m_inner_regions;
+  Memory<Allocator> m_outer_regions;
+  size_t m_max_region_points = 0;
+  // Persistent requests of the messages, one per neighbor
+  std::vector<MPI_Request> m_send_requests;
+  std::vector<MPI_Request> m_recv_requests;
+
+  const HaloRegion *get_inner_regions() {
+    return static_cast<const HaloRegion*>(m_inner_regions.get());
+  }
+  const HaloRegion *get_outer_regions() {
+    return static_cast<const HaloRegion*>(m_outer_regions.get());
+  }
+
+  // Unpacks the neighbors of a single-round exchange done with
+  // skip_unpack, grouped by the first dimension they are offset in.
+  bool unpack(int dim,
+              int width_rhs_recv,
+              int width_lhs_recv,
+              h2::gpu::DeviceStream stream_rhs,
+              h2::gpu::DeviceStream stream_lhs,
+              bool is_reverse,
+              HaloExchangeAccumOp op = HaloExchangeAccumOp::ID) override {
+    if (!m_unpack_pending) {
+      return Base::unpack(dim, width_rhs_recv, width_lhs_recv,
+                          stream_rhs, stream_lhs, is_reverse, op);
+    }
+    size_t begin = 0;
+    while (begin < m_neighbors.size() && m_neighbors[begin].first_dim < dim) {
+      ++begin;
+    }
+    size_t end = begin;
+    while (end < m_neighbors.size() && m_neighbors[end].first_dim == dim) {
+      ++end;
+    }
+    unpack_neighbors(begin, end, stream_rhs, is_reverse, op);
+    if (end == m_neighbors.size()) {
+      m_unpack_pending = false;
+    }
+    return end > begin;
+  }
+
+  void unpack_neighbors(size_t begin, size_t end,
+                        h2::gpu::DeviceStream stream,
+                        bool is_reverse, HaloExchangeAccumOp op) {
+    if (begin == end) return;
+    this->pack_or_unpack_regions(
+        (is_reverse ? get_inner_regions() : get_outer_regions()) + begin,
+        end - begin, m_max_region_points, stream,
+        m_recv_arena.get(), false, op);
+  }
+
+  // Tag for messages sent towards the neighbor at sign * offset, so
+  // messages between the same pair of ranks (e.g., a face and a corner
+  // neighbor when there are only two processes in a dimension) are
+  // told apart.
+  static int offset_tag(const IntVector &offset, int sign) {
+    int tag = 0;
+    for (int i = offset.length() - 1; i >= 0; --i) {
+      tag = tag * 3 + (sign * offset[i] + 1);
+    }
+    return tag;
+  }
+
+  void free_requests() {
+    for (auto &req: m_send_requests) MPI_Request_free(&req);
+    for (auto &req: m_recv_requests) MPI_Request_free(&req);
+    m_send_requests.clear();
+    m_recv_requests.clear();
+  }
+
+  // Allocates m unless it already holds at least size bytes
+  static void ensure_capacity(Memory<Allocator> &m, size_t size) {
+    if (m.is_null() || m.get_size() < size) m.allocate(size);
+  }
+
+  void ensure_neighbors() {
+    auto &t = this->m_tensor;
+    const index_t num_samples = t.get_local_shape()[-1];
+    if (m_neighbors_set) {
+      if (num_samples == m_neighbors_num_samples) return;
+      free_requests();
+      m_neighbors.clear();
+      m_max_region_points = 0;
+    }
+    m_neighbors_set = true;
+    m_neighbors_num_samples = num_samples;
+    const int nd = t.get_num_dims();
+
+    std::vector<int> dims;
+    for (int i = 0; i < nd; ++i) {
+      if (this->is_exchange_required(i)) dims.push_back(i);
+    }
+    if (dims.empty() || t.get_local_size() == 0) return;
+
+    const auto &locale_shape = t.get_distribution().get_locale_shape();
+    const auto proc_idx = t.get_proc_index();
+    const auto &real_shape = t.get_local_real_shape();
+    const auto &local_shape = t.get_local_shape();
+
+    // Enumerate {-1, 0, 1}^dims, skipping the all-zero offset
+    int num_offsets = 1;
+    for (size_t i = 0; i < dims.size(); ++i) num_offsets *= 3;
+    for (int k = 0; k < num_offsets; ++k) {
+      IntVector offset(nd, 0);
+      int code = k;
+      bool is_self = true;
+      for (int d: dims) {
+        offset[d] = code % 3 - 1;
+        code /= 3;
+        is_self &= offset[d] == 0;
+      }
+      if (is_self) continue;
+
+      auto peer_idx = proc_idx;
+      bool valid = true;
+      Neighbor n;
+      n.first_dim = -1;
+      n.inner_offset = IndexVector(nd, 0);
+      n.outer_offset = IndexVector(nd, 0);
+      n.region_shape = real_shape;
+      for (int i = 0; i < nd; ++i) {
+        const int o = offset[i];
+        if (o == 0) {
+          // Dimensions without exchanges are taken in full, as with
+          // the per-dimension methods
+          if (std::find(dims.begin(), dims.end(), i) != dims.end()) {
+            const int halo = t.get_halo_width(i);
+            n.inner_offset[i] = halo;
+            n.outer_offset[i] = halo;
+            n.region_shape[i] = local_shape[i];
+          }
+          continue;
+        }
+        if (n.first_dim < 0) n.first_dim = i;
+        const int peer_dim_idx = peer_idx[i] + o;
+        // processes located at either edge, or empty neighbors
+        if (peer_dim_idx < 0 || peer_dim_idx >= (int)locale_shape[i] ||
+            t.get_dimension_rank_offset(i, peer_dim_idx) == t.get_shape()[i]) {
+          valid = false;
+          break;
+        }
+        peer_idx[i] = peer_dim_idx;
+        const int halo = t.get_halo_width(i);
+        n.region_shape[i] = halo;
+        if (o > 0) {
+          n.inner_offset[i] = local_shape[i];
+          n.outer_offset[i] = halo + local_shape[i];
+        } else {
+          n.inner_offset[i] = halo;
+          n.outer_offset[i] = 0;
+        }
+      }
+      if (!valid) continue;
+
+      n.rank = get_offset(peer_idx, locale_shape);
+      n.send_tag = offset_tag(offset, 1);
+      n.recv_tag = offset_tag(offset, -1);
+      n.num_bytes = n.region_shape.size() * sizeof(DataType);
+      util::MPIPrintStreamDebug()
+          << "Multi-dimensional halo neighbor " << offset
+          << ": rank " << n.rank << ", " << n.num_bytes << " bytes";
+      m_neighbors.push_back(std::move(n));
+    }
+    if (m_neighbors.empty()) return;
+
+    std::stable_sort(m_neighbors.begin(), m_neighbors.end(),
+                     [](const Neighbor &x, const Neighbor &y) {
+                       return x.first_dim < y.first_dim;
+                     });
+    setup_arenas();
+  }
+
+  void setup_arenas() {
+    const int nd = this->m_tensor.get_num_dims();
+    std::vector<HaloRegion> inner(m_neighbors.size());
+    std::vector<HaloRegion> outer(m_neighbors.size());
+    size_t arena_size = 0;
+    for (size_t i = 0; i < m_neighbors.size(); ++i) {
+      auto &n = m_neighbors[i];
+      n.buf_offset = arena_size;
+      const size_t num_points = n.region_shape.size();
+      arena_size += num_points;
+      m_max_region_points = std::max(m_max_region_points, num_points);
+      for (int d = 0; d < nd; ++d) {
+        inner[i].offset[d] = n.inner_offset[d];
+        outer[i].offset[d] = n.outer_offset[d];
+        inner[i].shape[d] = outer[i].shape[d] = n.region_shape[d];
+      }
+      inner[i].num_points = outer[i].num_points = num_points;
+      inner[i].buf_offset = outer[i].buf_offset = n.buf_offset;
+    }
+    ensure_capacity(m_send_arena, arena_size * sizeof(DataType));
+    ensure_capacity(m_recv_arena, arena_size * sizeof(DataType));
+    const size_t regions_bytes = m_neighbors.size() * sizeof(HaloRegion);
+    ensure_capacity(m_inner_regions, regions_bytes);
+    ensure_capacity(m_outer_regions, regions_bytes);
+    h2::gpu::mem_copy(m_inner_regions.get(), inner.data(), regions_bytes);
+    h2::gpu::mem_copy(m_outer_regions.get(), outer.data(), regions_bytes);
+
+    // The messages are the same in every exchange
+    MPI_Comm comm = this->m_tensor.get_locale().get_comm();
+    char *send_arena = static_cast<char*>(m_send_arena.get());
+    char *recv_arena = static_cast<char*>(m_recv_arena.get());
+    m_send_requests.resize(m_neighbors.size());
+    m_recv_requests.resize(m_neighbors.size());
+    for (size_t i = 0; i < m_neighbors.size(); ++i) {
+      const auto &n = m_neighbors[i];
+      const size_t offset = n.buf_offset * sizeof(DataType);
+      DISTCONV_CHECK_MPI(MPI_Send_init(
+          send_arena + offset, n.num_bytes, MPI_BYTE, n.rank, n.send_tag,
+          comm, &m_send_requests[i]));
+      DISTCONV_CHECK_MPI(MPI_Recv_init(
+          recv_arena + offset, n.num_bytes, MPI_BYTE, n.rank, n.recv_tag,
+          comm, &m_recv_requests[i]));
+    }
+  }
+};
+
+} // namespace tensor
+} // namespace distconv
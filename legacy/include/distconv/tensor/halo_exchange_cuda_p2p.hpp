@@ -2,11 +2,38 @@
 
 #include "distconv/tensor/halo_exchange_cuda.hpp"
 
+#include "p2p/connection_ipc.hpp"
 #include "p2p/p2p.hpp"
 
+#include <cstdint>
+#include <cstdlib>
+
 namespace distconv {
 namespace tensor {
 
+/*
+  Halo exchange by putting packed halos into the receive buffers of
+  the peers with the P2P library.
+
+  When DISTCONV_HALO_EXCHANGE_P2P_FUSED_ACCUM is set to a non-zero
+  value and the peers of a dimension are connected with CUDA IPC,
+  halos are instead accumulated (with the exchange op) directly into
+  the tensors of the peers, which are mapped into the local address
+  space. This saves writing and reading the receive buffers, e.g.,
+  when accumulating halos of error signals in backprop. The tensor
+  buffers must be allocated with cudaMalloc so that they can be
+  mapped. Since they may change between exchanges, their addresses
+  are exchanged with the peers (with small MPI messages) in each
+  exchange, and mapped again when changed. Exchanges that skip
+  unpacking still go through the receive buffers.
+
+  When the peers of a dimension are connected with CUDA IPC and
+  notify with stream memory operations, halos are packed directly
+  into the receive buffers of the peers, and the packing kernel
+  notifies the peers after its last write instead of a separate put
+  and notification. This is disabled by setting
+  DISTCONV_HALO_EXCHANGE_P2P_FUSED_PUT to 0.
+ */
 template <typename DataType, typename Allocator, typename AlBackend>
 class HaloExchangeP2P:
       public HaloExchange<DataType, Allocator, AlBackend> {
@@ -19,11 +46,21 @@ class HaloExchangeP2P:
   HaloExchangeP2P(TensorType &tensor,
                   p2p::P2P &p2p)
       : HaloExchange<DataType, Allocator, AlBackend>(tensor),
-        m_p2p(p2p), m_halo_peer(nullptr) {}
+        m_p2p(p2p), m_halo_peer(nullptr),
+        m_fused_accum(is_fused_accum_enabled()),
+        m_fused_put(is_fused_put_enabled()),
+        m_tensor_peer(nullptr), m_tensor_peer_mapped(nullptr),
+        m_tensor_peer_base(nullptr), m_tensor_self_base(nullptr),
+        m_tensor_peer_extent(0) {}
 
   HaloExchangeP2P(const HaloExchangeP2P &x)
       : HaloExchange<DataType, Allocator, AlBackend>(x.m_tensor),
-        m_p2p(x.m_p2p), m_halo_peer(nullptr) {}
+        m_p2p(x.m_p2p), m_halo_peer(nullptr),
+        m_fused_accum(x.m_fused_accum),
+        m_fused_put(x.m_fused_put),
+        m_tensor_peer(nullptr), m_tensor_peer_mapped(nullptr),
+        m_tensor_peer_base(nullptr), m_tensor_self_base(nullptr),
+        m_tensor_peer_extent(0) {}
 
 
   HaloExchangeP2P &operator=(const HaloExchangeP2P &x) = delete;
@@ -51,12 +88,27 @@ class HaloExchangeP2P:
     }
     this->ensure_halo_buffers(dim);
     ensure_connection(dim);
-    BoundaryAttributes<cudaStream_t> streams(
+    BoundaryAttributes<h2::gpu::DeviceStream> streams(
         comm_lhs->get_stream(), comm_rhs->get_stream());
+    if (m_fused_accum && !skip_unpack && is_ipc_connected(dim)) {
+      exchange_fused_accum(dim, width_rhs_send, width_lhs_send,
+                           comm_rhs, comm_lhs, streams, is_reverse, op);
+      return;
+    }
     if (rendezvous) m_p2p.barrier(get_conns(dim), streams.data(), 2);
+    if (m_fused_put && can_fuse_put(dim)) {
+      exchange_fused_put(dim, width_rhs_send, width_lhs_send,
+                         comm_rhs, comm_lhs, is_reverse);
+      if (!skip_unpack) {
+        this->unpack(dim, width_rhs_recv, width_lhs_recv,
+                     comm_rhs->get_stream(), comm_lhs->get_stream(),
+                     is_reverse, op);
+      }
+      return;
+    }
     for (auto side: SIDES) {
       if (this->get_peer(dim, side) == MPI_PROC_NULL) continue;
-      const cudaStream_t stream = side == Side::RHS
+      const h2::gpu::DeviceStream stream = side == Side::RHS
           ? comm_rhs->get_stream() : comm_lhs->get_stream();
       const int width_send = side == Side::RHS
           ? width_rhs_send : width_lhs_send;
@@ -92,6 +144,204 @@ class HaloExchangeP2P:
   BoundaryAttributesV<p2p::P2P::connection_type> m_conns;
   BoundaryAttributesV<void*> m_halo_peer;
 
+  bool m_fused_accum;
+  bool m_fused_put;
+  // Tensor buffers of the peers as mapped locally
+  BoundaryAttributesV<void*> m_tensor_peer;
+  // Mapped allocations holding the tensor buffers of the peers
+  BoundaryAttributesV<void*> m_tensor_peer_mapped;
+  // Allocations of the peer and local tensor buffers (in the address
+  // spaces of their owners) when last mapped
+  BoundaryAttributesV<void*> m_tensor_peer_base;
+  BoundaryAttributesV<void*> m_tensor_self_base;
+  // Real extents of the peer tensors in each dimension
+  BoundaryAttributesV<index_t> m_tensor_peer_extent;
+
+  // Where a tensor buffer is within its allocation
+  struct TensorBufferInfo {
+    void *base;
+    size_t offset;
+    index_t extent;
+  };
+
+  static bool is_fused_accum_enabled() {
+    const char *env = std::getenv("DISTCONV_HALO_EXCHANGE_P2P_FUSED_ACCUM");
+    return env && std::atoi(env) != 0;
+  }
+
+  static bool is_fused_put_enabled() {
+    const char *env = std::getenv("DISTCONV_HALO_EXCHANGE_P2P_FUSED_PUT");
+    return !env || std::atoi(env) != 0;
+  }
+
+  // Whether all peers of dim can map the local memory. The connection
+  // kinds are the same on both sides of a connection.
+  bool is_ipc_connected(int dim) {
+    for (auto side: SIDES) {
+      if (this->get_peer(dim, side) == MPI_PROC_NULL) continue;
+      if (dynamic_cast<p2p::ConnectionIPC*>(get_conn(dim, side).get())
+          == nullptr) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Whether halos of dim can be packed into the peers with fused
+  // notifications. The packing kernel notifies in its grid-wide
+  // epilogue, which only the optimized traversal runs.
+  bool can_fuse_put(int dim) {
+    const int num_dims = this->m_tensor.get_num_dims();
+    if (!((num_dims == 4 && dim < 2) || (num_dims == 5 && dim < 3))) {
+      return false;
+    }
+    for (auto side: SIDES) {
+      if (this->get_peer(dim, side) == MPI_PROC_NULL) continue;
+      auto *conn = dynamic_cast<p2p::ConnectionIPC*>(
+          get_conn(dim, side).get());
+      if (conn == nullptr || !conn->supports_device_notification()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Exchanges the tensor buffer addresses with the peers of dim, and
+  // maps the tensors of the peers if they (or the local one) have
+  // changed since last mapped.
+  void ensure_tensor_mapping(int dim) {
+    TensorBufferInfo self;
+    std::uintptr_t base;
+    size_t size;
+    const void *buf_ptr = this->m_tensor.get_const_buffer();
+    const auto buf = reinterpret_cast<std::uintptr_t>(buf_ptr);
+    P2P_CHECK_GPU_DRV_ALWAYS(
+        p2p::gpu::get_address_range(buf_ptr, &base, &size));
+    self.base = reinterpret_cast<void*>(base);
+    self.offset = buf - base;
+    self.extent = this->m_tensor.get_local_real_shape()[dim];
+
+    TensorBufferInfo peers[2];
+    MPI_Request reqs[4];
+    int num_reqs = 0;
+    MPI_Comm comm = this->m_tensor.get_locale().get_comm();
+    const int tag = 0;
+    for (auto side: SIDES) {
+      const int peer = this->get_peer(dim, side);
+      if (peer == MPI_PROC_NULL) continue;
+      DISTCONV_CHECK_MPI(MPI_Irecv(&peers[side], sizeof(TensorBufferInfo),
+                                   MPI_BYTE, peer, tag, comm,
+                                   &reqs[num_reqs++]));
+      DISTCONV_CHECK_MPI(MPI_Isend(&self, sizeof(TensorBufferInfo),
+                                   MPI_BYTE, peer, tag, comm,
+                                   &reqs[num_reqs++]));
+    }
+    DISTCONV_CHECK_MPI(MPI_Waitall(num_reqs, reqs, MPI_STATUSES_IGNORE));
+
+    // Both sides of a connection see the same change, so they map
+    // together. Alternating the order of the sides pairs the
+    // (blocking) mappings of neighbors.
+    const bool rhs_first = this->m_tensor.get_split_index()[dim] % 2 == 0;
+    for (auto side: {rhs_first ? RHS : LHS, rhs_first ? LHS : RHS}) {
+      if (this->get_peer(dim, side) == MPI_PROC_NULL) continue;
+      const TensorBufferInfo &peer = peers[side];
+      if (self.base != m_tensor_self_base(dim, side) ||
+          peer.base != m_tensor_peer_base(dim, side)) {
+        auto &conn = get_conn(dim, side);
+        if (m_tensor_peer_mapped(dim, side) != nullptr) {
+          conn->deregister_addr(m_tensor_peer_mapped(dim, side));
+        }
+        void *mapped = peer.base;
+        m_p2p.exchange_addrs(&conn, &self.base, &mapped, 1);
+        m_tensor_peer_mapped(dim, side) = mapped;
+        m_tensor_self_base(dim, side) = self.base;
+        m_tensor_peer_base(dim, side) = peer.base;
+      }
+      m_tensor_peer(dim, side) =
+          static_cast<char*>(m_tensor_peer_mapped(dim, side)) + peer.offset;
+      m_tensor_peer_extent(dim, side) = peer.extent;
+    }
+  }
+
+  void exchange_fused_accum(int dim, int width_rhs_send, int width_lhs_send,
+                            CommType &comm_rhs, CommType &comm_lhs,
+                            BoundaryAttributes<h2::gpu::DeviceStream>
+                            &streams,
+                            bool is_reverse, HaloExchangeAccumOp op) {
+    ensure_tensor_mapping(dim);
+    // The peers must be done with their tensors before they are
+    // updated
+    m_p2p.barrier(get_conns(dim), streams.data(), 2);
+    for (auto side: SIDES) {
+      if (this->get_peer(dim, side) == MPI_PROC_NULL) continue;
+      const int width = side == Side::RHS ? width_rhs_send : width_lhs_send;
+      if (width == 0) continue;
+      const h2::gpu::DeviceStream stream = side == Side::RHS
+          ? comm_rhs->get_stream() : comm_lhs->get_stream();
+      // The peer receives into the halo of its opposite side, which
+      // is the inner one in reverse mode
+      const index_t extent = m_tensor_peer_extent(dim, side);
+      index_t start;
+      if (~side == Side::RHS) {
+        start = is_reverse ? extent - width * 2 : extent - width;
+      } else {
+        start = is_reverse ? width : 0;
+      }
+      util::MPIPrintStreamDebug()
+          << "Accumulating halo to the peer tensor for dimension " << dim
+          << ", " << side;
+      accumulate_to_peer(dim, side, width, stream, is_reverse, op,
+                         m_tensor_peer(dim, side), extent, start);
+    }
+    // make sure the peers wait for the completion of the updates
+    m_p2p.barrier(get_conns(dim), streams.data(), 2);
+  }
+
+  void exchange_fused_put(int dim, int width_rhs_send, int width_lhs_send,
+                          CommType &comm_rhs, CommType &comm_lhs,
+                          bool is_reverse) {
+    for (auto side: SIDES) {
+      if (this->get_peer(dim, side) == MPI_PROC_NULL) continue;
+      const h2::gpu::DeviceStream stream = side == Side::RHS
+          ? comm_rhs->get_stream() : comm_lhs->get_stream();
+      const int width_send = side == Side::RHS
+          ? width_rhs_send : width_lhs_send;
+      auto *conn = static_cast<p2p::ConnectionIPC*>(
+          get_conn(dim, side).get());
+      if (width_send > 0) {
+        util::MPIPrintStreamDebug()
+            << "Packing halo to the peer for dimension " << dim
+            << ", " << side;
+        p2p::WaitValue *peer_flag;
+        p2p::WaitValue value;
+        conn->get_device_notification(&peer_flag, &value);
+        pack_put_notify_peer(dim, side, width_send, stream,
+                             get_halo_peer(dim, side), is_reverse,
+                             peer_flag, value);
+      } else {
+        // The peer still waits for a notification
+        conn->notify(stream);
+      }
+    }
+    // make sure the local device waits for the halos of the peers
+    for (auto side: SIDES) {
+      if (this->get_peer(dim, side) == MPI_PROC_NULL) continue;
+      const h2::gpu::DeviceStream stream = side == Side::RHS
+          ? comm_rhs->get_stream() : comm_lhs->get_stream();
+      get_conn(dim, side)->wait(stream);
+    }
+  }
+
+  void pack_put_notify_peer(int dim, Side side, int width,
+                            h2::gpu::DeviceStream stream, void *peer_buf,
+                            bool is_reverse, p2p::WaitValue *peer_flag,
+                            p2p::WaitValue value);
+
+  void accumulate_to_peer(int dim, Side side, int width,
+                          h2::gpu::DeviceStream stream, bool is_reverse,
+                          HaloExchangeAccumOp op, void *peer_tensor,
+                          size_t peer_extent, size_t peer_start);
+
   p2p::P2P::connection_type &get_conn(int dim, Side side) {
     return m_conns(dim, side);
   }
@@ -132,6 +382,9 @@ class HaloExchangeP2P:
       // exist.
       if (get_conn(i, RHS)) {
         m_p2p.close_addrs(get_conns(i), get_halo_peers(i), 2);
+        if (m_fused_accum) {
+          m_p2p.close_addrs(get_conns(i), m_tensor_peer_mapped(i), 2);
+        }
       }
     }
   }
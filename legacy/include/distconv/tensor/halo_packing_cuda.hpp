@@ -1,5 +1,7 @@
 #pragma once
 
+#include "h2_config.hpp"
+
 #include "distconv/base.hpp"
 #include "distconv/tensor/halo_exchange_cuda.hpp"
 #include "distconv/tensor/halo_cuda.hpp"
@@ -8,6 +10,16 @@
 #include "distconv/util/nvshmem.hpp"
 #endif // DISTCONV_HAS_NVSHMEM
 
+#include <cstdint>
+
+#if H2_HAS_CUDA
+#include <cuda_bf16.h>
+#include <cuda_fp16.h>
+#elif H2_HAS_ROCM
+#include <hip/hip_bf16.h>
+#include <hip/hip_fp16.h>
+#endif
+
 #define HALO_EXCHANGE_ACCUME_OP_SWITCH(x)                       \
   switch(x) {                                                   \
     CASE_BLOCK(HaloExchangeAccumOp::ID);                        \
@@ -36,8 +48,10 @@ struct HaloExchangeAccumCUDAFunctor<DataType,
 template <typename DataType>
 struct HaloExchangeAccumCUDAFunctor<DataType,
                                     HaloExchangeAccumOp::SUM> {
+  // 16-bit points are added in float
   __device__ void operator()(DataType &x, const DataType y) {
-    x += y;
+    x = util::from_accumulation<DataType>(util::to_accumulation(x) +
+                                          util::to_accumulation(y));
   }
 };
 
@@ -82,6 +96,80 @@ struct PackFunctor {
   }
 };
 
+// Conversion of halo points to and from a reduced transfer precision
+template <HaloTransferPrecision precision>
+struct HaloTransferConverter;
+
+template <>
+struct HaloTransferConverter<HaloTransferPrecision::FP16> {
+  using type = __half;
+  __device__ static type to(float x) { return __float2half(x); }
+  __device__ static float from(type x) { return __half2float(x); }
+};
+
+template <>
+struct HaloTransferConverter<HaloTransferPrecision::BF16> {
+#if H2_HAS_ROCM
+  using type = __hip_bfloat16;
+#else
+  using type = __nv_bfloat16;
+#endif
+  __device__ static type to(float x) { return __float2bfloat16(x); }
+  __device__ static float from(type x) { return __bfloat162float(x); }
+};
+
+// Packs halo points converted to a reduced precision, and converts
+// them back when unpacking. Vectorized accesses are converted point by
+// point, so the buffer has the same layout as with PackFunctor.
+template <typename DataType, HaloTransferPrecision precision, bool pack,
+          HaloExchangeAccumOp op>
+struct ReducedPackFunctor {
+  using Vec2 = typename util::GetVectorType<DataType, 2>::type;
+  using Vec4 = typename util::GetVectorType<DataType, 4>::type;
+  using Converter = HaloTransferConverter<precision>;
+  using PackType = typename Converter::type;
+  static constexpr HaloTraversalOpGroup group = HaloTraversalOpGroup::THREAD;
+  static constexpr bool has_pre_grid = false;
+  static constexpr bool has_post_grid = false;
+  static constexpr bool modifies_tensor = true;
+
+  PackType *m_buf;
+  ReducedPackFunctor(DataType *buf): m_buf(reinterpret_cast<PackType*>(buf)) {}
+
+  __device__ void apply(DataType &x, size_t offset) {
+    if (pack) {
+      m_buf[offset] = Converter::to(x);
+    } else {
+      HaloExchangeAccumCUDAFunctor<DataType, op>()(
+          x, Converter::from(m_buf[offset]));
+    }
+  }
+
+  __device__ void operator()(DataType &x, size_t offset) {
+    apply(x, offset);
+  }
+
+  __device__ void operator()(Vec2 &x, size_t offset) {
+    apply(x.x, offset * 2);
+    apply(x.y, offset * 2 + 1);
+  }
+
+  __device__ void operator()(Vec4 &x, size_t offset) {
+    apply(x.x, offset * 4);
+    apply(x.y, offset * 4 + 1);
+    apply(x.z, offset * 4 + 2);
+    apply(x.w, offset * 4 + 3);
+  }
+};
+
+template <typename DataType, bool pack, HaloExchangeAccumOp op>
+using FP16PackFunctor = ReducedPackFunctor<
+  DataType, HaloTransferPrecision::FP16, pack, op>;
+
+template <typename DataType, bool pack, HaloExchangeAccumOp op>
+using BF16PackFunctor = ReducedPackFunctor<
+  DataType, HaloTransferPrecision::BF16, pack, op>;
+
 template <typename DataType, bool is_pack, typename PackFunctor>
 void pack_or_unpack(Tensor<DataType, LocaleMPI, CUDAAllocator>& tensor,
                     int dim,
@@ -140,6 +228,35 @@ void pack_or_unpack(Tensor<DataType, LocaleMPI, CUDAAllocator>& tensor,
         tensor, dim, side, width, stream, buf, is_reverse, op);
 }
 
+template <typename DataType, bool is_pack>
+void pack_or_unpack(Tensor<DataType, LocaleMPI, CUDAAllocator>& tensor,
+                    int dim,
+                    Side side,
+                    int width,
+                    h2::gpu::DeviceStream stream,
+                    void* buf,
+                    bool is_reverse,
+                    HaloExchangeAccumOp op,
+                    HaloTransferPrecision precision)
+{
+    switch (precision)
+    {
+    case HaloTransferPrecision::NATIVE:
+        pack_or_unpack<DataType, is_pack, PackFunctor>(
+            tensor, dim, side, width, stream, buf, is_reverse, op);
+        break;
+    case HaloTransferPrecision::FP16:
+        pack_or_unpack<DataType, is_pack, FP16PackFunctor>(
+            tensor, dim, side, width, stream, buf, is_reverse, op);
+        break;
+    case HaloTransferPrecision::BF16:
+        pack_or_unpack<DataType, is_pack, BF16PackFunctor>(
+            tensor, dim, side, width, stream, buf, is_reverse, op);
+        break;
+    default: assert_always(0 && "Unknown halo transfer precision");
+    }
+}
+
 template <typename DataType>
 void pack_or_unpack(Tensor<DataType, LocaleMPI, CUDAAllocator>& tensor,
                     int dim,
@@ -166,6 +283,256 @@ void pack_or_unpack(Tensor<DataType, LocaleMPI, CUDAAllocator>& tensor,
     return;
 }
 
+// Packs or unpacks with halo points converted to a reduced transfer
+// precision. Only float tensors are supported.
+template <typename DataType>
+void pack_or_unpack(Tensor<DataType, LocaleMPI, CUDAAllocator>& tensor,
+                    int dim,
+                    Side side,
+                    int width,
+                    h2::gpu::DeviceStream stream,
+                    void* buf,
+                    bool is_pack,
+                    bool is_reverse,
+                    HaloExchangeAccumOp op,
+                    HaloTransferPrecision precision)
+{
+    if (width == 0)
+        return;
+    if (is_pack)
+    {
+        pack_or_unpack<DataType, true>(
+            tensor, dim, side, width, stream, buf, is_reverse, op, precision);
+    }
+    else
+    {
+        pack_or_unpack<DataType, false>(
+            tensor, dim, side, width, stream, buf, is_reverse, op, precision);
+    }
+}
+
+template <typename DataType>
+void pack_or_unpack_region(Tensor<DataType, LocaleMPI, CUDAAllocator>& tensor,
+                           const IndexVector& region_offset,
+                           const Shape& region_shape,
+                           h2::gpu::DeviceStream stream,
+                           void* buf,
+                           bool is_pack,
+                           HaloExchangeAccumOp op)
+{
+    using TensorType = Tensor<DataType, LocaleMPI, CUDAAllocator>;
+    if (is_pack)
+    {
+        TraverseRegion<TensorType,
+                       PackFunctor<DataType, true, HaloExchangeAccumOp::ID>>(
+            tensor,
+            region_offset,
+            region_shape,
+            PackFunctor<DataType, true, HaloExchangeAccumOp::ID>(
+                static_cast<DataType*>(buf)),
+            stream);
+        return;
+    }
+#define CASE_BLOCK(OP)                                                  \
+  case OP:                                                              \
+    TraverseRegion<TensorType, PackFunctor<DataType, false, OP>>(       \
+        tensor, region_offset, region_shape,                            \
+        PackFunctor<DataType, false, OP>(static_cast<DataType*>(buf)),  \
+        stream);                                                        \
+    break;
+
+  HALO_EXCHANGE_ACCUME_OP_SWITCH(op);
+#undef CASE_BLOCK
+}
+
+template <typename DataType>
+void pack_or_unpack_regions(Tensor<DataType, LocaleMPI, CUDAAllocator>& tensor,
+                            const HaloRegion* regions,
+                            int num_regions,
+                            size_t max_region_points,
+                            h2::gpu::DeviceStream stream,
+                            void* buf,
+                            bool is_pack,
+                            HaloExchangeAccumOp op)
+{
+    using TensorType = Tensor<DataType, LocaleMPI, CUDAAllocator>;
+    if (is_pack)
+    {
+        TraverseRegions<TensorType,
+                        PackFunctor<DataType, true, HaloExchangeAccumOp::ID>>(
+            tensor,
+            regions,
+            num_regions,
+            max_region_points,
+            PackFunctor<DataType, true, HaloExchangeAccumOp::ID>(
+                static_cast<DataType*>(buf)),
+            stream);
+        return;
+    }
+#define CASE_BLOCK(OP)                                                  \
+  case OP:                                                              \
+    TraverseRegions<TensorType, PackFunctor<DataType, false, OP>>(      \
+        tensor, regions, num_regions, max_region_points,                \
+        PackFunctor<DataType, false, OP>(static_cast<DataType*>(buf)),  \
+        stream);                                                        \
+    break;
+
+  HALO_EXCHANGE_ACCUME_OP_SWITCH(op);
+#undef CASE_BLOCK
+}
+
+// Accumulates points of a local halo directly into the halo of a peer
+// tensor mapped into the local address space (e.g., with CUDA IPC),
+// instead of packing them for the peer to unpack. The peer halo has
+// the same shape as the local one, but the real extent of the peer
+// tensor in the exchanged dimension may differ. Each peer point is
+// updated by one thread only, so no atomics are needed.
+template <typename DataType, HaloExchangeAccumOp op>
+struct PeerAccumFunctor {
+  using Vec2 = typename util::GetVectorType<DataType, 2>::type;
+  using Vec4 = typename util::GetVectorType<DataType, 4>::type;
+  static constexpr HaloTraversalOpGroup group = HaloTraversalOpGroup::THREAD;
+  static constexpr bool has_pre_grid = false;
+  static constexpr bool has_post_grid = false;
+  static constexpr bool modifies_tensor = false;
+
+  DataType *m_peer;
+  // Number of points of the dimensions below the exchanged one
+  size_t m_inner;
+  size_t m_width;
+  // Real extent of the peer tensor and first index of its halo in the
+  // exchanged dimension
+  size_t m_peer_extent;
+  size_t m_peer_start;
+  PeerAccumFunctor(DataType *peer, size_t inner, size_t width,
+                   size_t peer_extent, size_t peer_start):
+      m_peer(peer), m_inner(inner), m_width(width),
+      m_peer_extent(peer_extent), m_peer_start(peer_start) {}
+
+  // offset is the index of the point in the packed halo
+  __device__ void apply(const DataType &x, size_t offset) {
+    const size_t inner_idx = offset % m_inner;
+    const size_t rest = offset / m_inner;
+    const size_t dim_idx = rest % m_width;
+    const size_t outer_idx = rest / m_width;
+    const size_t peer_offset =
+        (outer_idx * m_peer_extent + m_peer_start + dim_idx) * m_inner
+        + inner_idx;
+    HaloExchangeAccumCUDAFunctor<DataType, op>()(m_peer[peer_offset], x);
+  }
+
+  __device__ void operator()(const DataType &x, size_t offset) {
+    apply(x, offset);
+  }
+
+  __device__ void operator()(const Vec2 &x, size_t offset) {
+    apply(x.x, offset * 2);
+    apply(x.y, offset * 2 + 1);
+  }
+
+  __device__ void operator()(const Vec4 &x, size_t offset) {
+    apply(x.x, offset * 4);
+    apply(x.y, offset * 4 + 1);
+    apply(x.z, offset * 4 + 2);
+    apply(x.w, offset * 4 + 3);
+  }
+};
+
+template <typename DataType>
+void accumulate_to_peer(Tensor<DataType, LocaleMPI, CUDAAllocator>& tensor,
+                        int dim,
+                        Side side,
+                        int width,
+                        h2::gpu::DeviceStream stream,
+                        bool is_reverse,
+                        HaloExchangeAccumOp op,
+                        void* peer_tensor,
+                        size_t peer_extent,
+                        size_t peer_start)
+{
+    using TensorType = Tensor<DataType, LocaleMPI, CUDAAllocator>;
+    if (width == 0)
+        return;
+    const auto shape = tensor.get_local_real_shape();
+    size_t inner = 1;
+    for (int i = 0; i < dim; ++i)
+    {
+        inner *= shape[i];
+    }
+#define CASE_BLOCK(OP)                                                  \
+  case OP:                                                              \
+    TraverseHalo<TensorType, PeerAccumFunctor<DataType, OP>>(           \
+        tensor, dim, side, width, !is_reverse,                          \
+        PeerAccumFunctor<DataType, OP>(static_cast<DataType*>(peer_tensor), \
+                                       inner, width, peer_extent,       \
+                                       peer_start),                     \
+        stream);                                                        \
+    break;
+
+  HALO_EXCHANGE_ACCUME_OP_SWITCH(op);
+#undef CASE_BLOCK
+}
+
+// Packs a halo directly into the receive buffer of a peer mapped into
+// the local address space (e.g., with CUDA IPC), and then notifies the
+// peer by writing value to its flag, which is also mapped. The flag is
+// written by one thread after the whole grid is done, so the peer sees
+// all of the halo once it sees the value.
+template <typename DataType>
+struct PackPutNotifyPeerFunctor {
+  using Vec2 = typename util::GetVectorType<DataType, 2>::type;
+  using Vec4 = typename util::GetVectorType<DataType, 4>::type;
+  static constexpr HaloTraversalOpGroup group = HaloTraversalOpGroup::THREAD;
+  static constexpr bool has_pre_grid = false;
+  static constexpr bool has_post_grid = true;
+  static constexpr bool modifies_tensor = false;
+
+  DataType *m_dst;
+  std::uint32_t *m_flag;
+  std::uint32_t m_value;
+  PackPutNotifyPeerFunctor(DataType *dst, std::uint32_t *flag,
+                           std::uint32_t value):
+      m_dst(dst), m_flag(flag), m_value(value) {}
+
+  template <typename T> __device__
+  typename std::enable_if<std::is_same<T, DataType>::value ||
+                          std::is_same<T, Vec2>::value ||
+                          std::is_same<T, Vec4>::value, void>::type
+  operator()(const T &x, size_t offset) {
+    ((T*)m_dst)[offset] = x;
+  }
+
+  __device__ void post() {
+    // The grid synchronization orders the writes of all threads
+    // before this, and the fence makes them visible to the peer first.
+    __threadfence_system();
+    *static_cast<volatile std::uint32_t*>(m_flag) = m_value;
+  }
+};
+
+template <typename DataType>
+void pack_put_notify_peer(Tensor<DataType, LocaleMPI, CUDAAllocator>& tensor,
+                          int dim,
+                          Side side,
+                          int width,
+                          h2::gpu::DeviceStream stream,
+                          void* peer_buf,
+                          bool is_reverse,
+                          std::uint32_t* peer_flag,
+                          std::uint32_t value)
+{
+    using TensorType = Tensor<DataType, LocaleMPI, CUDAAllocator>;
+    TraverseHalo<TensorType, PackPutNotifyPeerFunctor<DataType>>(
+        tensor,
+        dim,
+        side,
+        width,
+        !is_reverse,
+        PackPutNotifyPeerFunctor<DataType>(
+            static_cast<DataType*>(peer_buf), peer_flag, value),
+        stream);
+}
+
 #ifdef DISTCONV_HAS_NVSHMEM
 
 template <typename DataType>
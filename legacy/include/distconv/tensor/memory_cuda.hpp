@@ -8,6 +8,7 @@
 #include "distconv/util/util_cuda.hpp"
 #ifdef DISTCONV_HAS_NVSHMEM
 #include "distconv/util/nvshmem.hpp"
+#include "distconv/util/shmem.hpp"
 #endif
 
 #include <cuda_runtime.h>
@@ -190,24 +191,18 @@ struct Stream<CUDAHostPooledAllocator> {
 struct NVSHMEMAllocator: CUDAAllocator {
   static void allocate(void *&p, size_t &pitch,
                        size_t size, size_t ldim)  {
-    //nvshmem_barrier_all();
-    p = nvshmem_malloc(size);
-    nvshmem_barrier_all();
-    if (p == nullptr) {
-      util::PrintStreamError() << "NVSHMEM allocation of " << size << " bytes ("
-                               << size / 1024.0 / 1024.0 / 1024.0 << " GiB) failed. ";
-      TENSOR_CHECK_CUDA(cudaGetLastError());
-    }
+    // Collective; blocks come from the shared symmetric heap
+    p = util::shmem::SymmetricHeap::get_instance().allocate(size);
     pitch = ldim;
   }
   static void deallocate(void *p)  {
     assert_always(p != nullptr);
-    nvshmem_barrier_all();
-    nvshmem_free(p);
-    nvshmem_barrier_all();
+    util::shmem::SymmetricHeap::get_instance().release(p);
   }
 };
 
+using SHMEMAllocator = NVSHMEMAllocator;
+
 template <>
 struct Stream<NVSHMEMAllocator> {
   using type = cudaStream_t;
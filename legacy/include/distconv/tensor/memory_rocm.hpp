@@ -14,7 +14,7 @@
 #include "distconv/util/util_rocm.hpp"
 #include "h2/gpu/memory_utils.hpp"
 #ifdef DISTCONV_HAS_NVSHMEM
-#include "distconv/util/nvshmem.hpp"
+#include "distconv/util/shmem.hpp"
 #endif
 
 #include <hip/hip_runtime.h>
@@ -212,37 +212,26 @@ struct Stream<CUDAHostPooledAllocator>
     static constexpr type default_value = 0;
 };
 
-// This won't ever be enabled in ROCm-land. However, one of these
-// years we might get HIP-SHMEM up and running. So I'll leave it in
-// case it's ever useful.
-#ifdef DISTCONV_HAS_NVSHMEM
-struct NVSHMEMAllocator : HIPAllocator
+#ifdef DISTCONV_HAS_ROCSHMEM
+struct ROCSHMEMAllocator : HIPAllocator
 {
+    // Collective; blocks come from the shared symmetric heap
     static void allocate(void*& p, size_t& pitch, size_t size, size_t ldim)
     {
-        // nvshmem_barrier_all();
-        p = nvshmem_malloc(size);
-        nvshmem_barrier_all();
-        if (p == nullptr)
-        {
-            util::PrintStreamError()
-                << "NVSHMEM allocation of " << size << " bytes ("
-                << size / 1024.0 / 1024.0 / 1024.0 << " GiB) failed. ";
-            TENSOR_CHECK_HIP(hipGetLastError());
-        }
+        p = util::shmem::SymmetricHeap::get_instance().allocate(size);
         pitch = ldim;
     }
     static void deallocate(void* p)
     {
         assert_always(p != nullptr);
-        nvshmem_barrier_all();
-        nvshmem_free(p);
-        nvshmem_barrier_all();
+        util::shmem::SymmetricHeap::get_instance().release(p);
     }
 };
 
+using SHMEMAllocator = ROCSHMEMAllocator;
+
 template <>
-struct Stream<NVSHMEMAllocator>
+struct Stream<ROCSHMEMAllocator>
 {
     using type = hipStream_t;
     static constexpr type default_value = 0;
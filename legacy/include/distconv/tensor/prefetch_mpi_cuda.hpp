@@ -0,0 +1,302 @@
+#pragma once
+
+#include "distconv/tensor/shuffle_mpi_cuda.hpp"
+#include "distconv/tensor/tensor_mpi_cuda.hpp"
+#include "distconv/util/util.hpp"
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/gpu/runtime.hpp"
+#include "h2/tensor/copy.hpp"
+#include "h2/tensor/tensor.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace distconv {
+namespace tensor {
+
+/*
+  Prepares the input tensors of upcoming minibatches while the current
+  one trains.
+
+  Each minibatch goes through four stages:
+  1. The loader reads the local samples into a pinned host buffer, on
+     a background thread.
+  2. The host buffer is copied to a sample-distributed tensor on the
+     GPU, on a copy stream.
+  3. TensorMPICUDAShuffler shuffles it to the spatial distribution,
+     on the copy stream.
+  4. cast_scale_bias converts it to DstType and normalizes it, on the
+     copy stream.
+
+  Up to `depth` minibatches after the one being trained are in flight,
+  each in its own set of buffers, which are reused round-robin. next()
+  returns the next minibatch's tensor after making the compute stream
+  wait for it, so the host only blocks when reading falls behind.
+
+  Stages 2-4 are issued from the calling thread in minibatch order, a
+  fixed `depth` minibatches ahead, so all ranks issue shuffles in the
+  same order and at the same points regardless of how fast each reads.
+
+  The loader is called with the minibatch index, a buffer with room
+  for the local elements of the sample-distributed tensor in its local
+  order, and that tensor, to find which samples are local. It is only
+  called on ranks with local elements. SrcType must be a type the
+  shuffler supports (e.g., float, int, or short), and DstType float or
+  double.
+*/
+template <typename SrcType, typename DstType>
+class TensorMPICUDAPrefetcher {
+ public:
+  using SrcTensorType = Tensor<SrcType, LocaleMPI, CUDAAllocator>;
+  using DstTensorType = Tensor<DstType, LocaleMPI, CUDAAllocator>;
+  using LoaderType =
+      std::function<void(int, SrcType *, const SrcTensorType &)>;
+
+  // sample_tensor and spatial_tensor give the shape, locale, and
+  // distribution of the loaded and prefetched tensors; their data is
+  // not used.
+  template <typename SampleTensorType, typename SpatialTensorType>
+  TensorMPICUDAPrefetcher(const SampleTensorType &sample_tensor,
+                          const SpatialTensorType &spatial_tensor,
+                          LoaderType loader,
+                          int num_minibatches,
+                          int depth,
+                          DstType scale = DstType(1),
+                          DstType bias = DstType(0)):
+      m_loader(std::move(loader)),
+      m_num_minibatches(num_minibatches),
+      m_depth(depth),
+      m_scale(scale),
+      m_bias(bias),
+      m_copy_stream(h2::gpu::make_stream_nonblocking()),
+      m_gpu(h2::gpu::current_gpu()) {
+    static_assert(std::is_floating_point<DstType>::value,
+                  "Prefetched tensors must be floating point");
+    assert_always(m_depth >= 0);
+    assert_always(m_num_minibatches >= 0);
+    // The slot of the minibatch being trained is not reused until the
+    // next call to next().
+    const int num_slots = m_depth + 1;
+    for (int i = 0; i < num_slots; ++i) {
+      m_slots.push_back(std::make_unique<Slot>(sample_tensor,
+                                               spatial_tensor));
+    }
+    // Shuffles only depend on the shapes and distributions, so one
+    // shuffler serves every slot.
+    m_shuffler = std::make_unique<TensorMPICUDAShuffler<SrcType>>(
+        m_slots[0]->sample, m_slots[0]->spatial);
+    m_loader_thread = std::thread([this]() { load(); });
+  }
+
+  TensorMPICUDAPrefetcher(const TensorMPICUDAPrefetcher &) = delete;
+  TensorMPICUDAPrefetcher &operator=(const TensorMPICUDAPrefetcher &) =
+      delete;
+
+  ~TensorMPICUDAPrefetcher() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_cv.notify_all();
+    m_loader_thread.join();
+    // Slots must not be freed while prefetches are in flight.
+    h2::gpu::sync(m_copy_stream);
+    m_shuffler.reset();
+    m_slots.clear();
+    h2::gpu::destroy(m_copy_stream);
+  }
+
+  int get_depth() const {
+    return m_depth;
+  }
+
+  int get_num_minibatches() const {
+    return m_num_minibatches;
+  }
+
+  bool has_next() const {
+    return m_next < m_num_minibatches;
+  }
+
+  // Returns the next minibatch's tensor, with work subsequently
+  // enqueued on `stream` ordered after it is ready. The tensor is
+  // valid until the following call to next(), which must be made
+  // after all work on it has been enqueued on `stream`.
+  const DstTensorType &next(h2::gpu::DeviceStream stream) {
+    assert_always(has_next());
+    if (m_next > 0) {
+      // Release the previous minibatch's slot once `stream` is done
+      // with it.
+      h2::gpu::record_event(get_slot(m_next - 1).consumed, stream);
+    }
+    const int last = std::min(m_next + m_depth, m_num_minibatches - 1);
+    while (m_issued <= last) {
+      issue(m_issued++);
+    }
+    Slot &slot = get_slot(m_next++);
+    h2::gpu::sync(stream, slot.ready);
+    return slot.output;
+  }
+
+ private:
+  // Buffers and events for one minibatch in flight.
+  struct Slot {
+    template <typename SampleTensorType, typename SpatialTensorType>
+    Slot(const SampleTensorType &sample_tensor,
+         const SpatialTensorType &spatial_tensor):
+        sample(sample_tensor.get_shape(), sample_tensor.get_locale(),
+               sample_tensor.get_distribution()),
+        spatial(spatial_tensor.get_shape(), spatial_tensor.get_locale(),
+                spatial_tensor.get_distribution()),
+        output(spatial_tensor.get_shape(), spatial_tensor.get_locale(),
+               spatial_tensor.get_distribution()),
+        host(sample.get_local_size(), h2::Device::CPU, std::nullopt,
+             h2::MemoryKind::Pinned),
+        copied(h2::gpu::make_event_notiming()),
+        ready(h2::gpu::make_event_notiming()),
+        consumed(h2::gpu::make_event_notiming()) {
+      // Loaded data is copied to the sample tensor as is.
+      assert_always(sample.get_local_real_size() == sample.get_local_size());
+      assert0(sample.allocate());
+      assert0(spatial.allocate());
+      assert0(output.allocate());
+    }
+
+    ~Slot() {
+      h2::gpu::destroy(copied);
+      h2::gpu::destroy(ready);
+      h2::gpu::destroy(consumed);
+    }
+
+    SrcTensorType sample;
+    SrcTensorType spatial;
+    DstTensorType output;
+    h2::ManagedBuffer<SrcType> host;
+    // Recorded on the copy stream after the copy from `host`, after
+    // `output` is written, and on the compute stream when the
+    // minibatch is released, respectively.
+    h2::gpu::DeviceEvent copied;
+    h2::gpu::DeviceEvent ready;
+    h2::gpu::DeviceEvent consumed;
+    // Minibatch whose data is in `host`, or -1.
+    int loaded = -1;
+    // Whether `host` may be loaded once `copied` completes.
+    bool host_free = true;
+  };
+
+  LoaderType m_loader;
+  const int m_num_minibatches;
+  const int m_depth;
+  const DstType m_scale;
+  const DstType m_bias;
+  h2::gpu::DeviceStream m_copy_stream;
+  const int m_gpu;
+  std::vector<std::unique_ptr<Slot>> m_slots;
+  std::unique_ptr<TensorMPICUDAShuffler<SrcType>> m_shuffler;
+
+  // Next minibatch next() returns, and next one to issue stages 2-4
+  // for.
+  int m_next = 0;
+  int m_issued = 0;
+
+  // Protects the loading state of the slots.
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_stop = false;
+  std::exception_ptr m_error;
+  std::thread m_loader_thread;
+
+  Slot &get_slot(int minibatch) {
+    return *m_slots[minibatch % m_slots.size()];
+  }
+
+  // Reads minibatches into the host buffers as they become free.
+  void load() {
+    h2::gpu::set_gpu(m_gpu);
+    for (int mb = 0; mb < m_num_minibatches; ++mb) {
+      Slot &slot = get_slot(mb);
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&]() { return m_stop || slot.host_free; });
+        if (m_stop) return;
+        slot.host_free = false;
+      }
+      try {
+        h2::gpu::sync(slot.copied);
+        if (slot.sample.get_local_size() > 0) {
+          m_loader(mb, slot.host.data(), slot.sample);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = std::current_exception();
+        m_cv.notify_all();
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        slot.loaded = mb;
+      }
+      m_cv.notify_all();
+    }
+  }
+
+  // Issues the copy, shuffle, and cast of a minibatch once it has
+  // been read.
+  void issue(int mb) {
+    Slot &slot = get_slot(mb);
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [&]() { return m_error || slot.loaded == mb; });
+      if (m_error) std::rethrow_exception(m_error);
+    }
+    // The slot's tensors may still be used by an earlier minibatch.
+    h2::gpu::sync(m_copy_stream, slot.consumed);
+    const size_t local_size = slot.sample.get_local_size();
+    if (local_size > 0) {
+      h2::gpu::mem_copy(slot.sample.get_buffer(), slot.host.const_data(),
+                        local_size, m_copy_stream);
+    }
+    h2::gpu::record_event(slot.copied, m_copy_stream);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      slot.loaded = -1;
+      slot.host_free = true;
+    }
+    m_cv.notify_all();
+
+    m_shuffler->shuffle_forward(slot.sample.get_const_base_ptr(),
+                                slot.spatial.get_base_ptr(),
+                                m_copy_stream);
+    // Halo regions are converted too; they are overwritten by halo
+    // exchanges before being read.
+    const size_t real_size = slot.spatial.get_local_real_size();
+    if (real_size > 0) {
+      assert_always(real_size <= static_cast<size_t>(
+          std::numeric_limits<h2::DimType>::max()));
+      const h2::ComputeStream stream(m_copy_stream, m_gpu);
+      const h2::ShapeTuple shape(static_cast<h2::DimType>(real_size));
+      const h2::Tensor<SrcType> src(h2::Device::GPU,
+                                    slot.spatial.get_const_buffer(), shape,
+                                    {h2::DT::Any}, {1}, stream);
+      h2::Tensor<DstType> dst(h2::Device::GPU, slot.output.get_buffer(),
+                              shape, {h2::DT::Any}, {1}, stream);
+      h2::cast_scale_bias(dst, src, m_scale, m_bias);
+    }
+    h2::gpu::record_event(slot.ready, m_copy_stream);
+  }
+};
+
+} // namespace tensor
+} // namespace distconv
@@ -7,6 +7,12 @@
 
 #include <algorithm>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #define CALC_OFFSET4(i0, i1, i2, i3, strides)                           \
   ((i0) * strides[0] + (i1) * strides[1] + (i2) * strides[2] +          \
@@ -20,6 +26,69 @@ namespace distconv {
 namespace tensor {
 namespace internal {
 
+// Mapping between the source and destination distributions of a
+// shuffle. It only depends on the shapes and distributions of the
+// two tensors and the rank of this process, so shufflers between
+// tensors with identical geometry share one plan.
+struct TensorMPIShufflePlan {
+  // Offsets in src tensor for each dst locale. Used in
+  // packing. Linearized to a 1D array.
+  std::vector<int> rank_limits_fwd;
+  // Offsets in dst tensor for each src locale. Used in
+  // packing. Linearized to a 1D array.
+  std::vector<int> rank_limits_bwd;
+  std::vector<int> send_counts;
+  std::vector<int> recv_counts;
+  std::vector<int> send_displs;
+  std::vector<int> recv_displs;
+  // Ranks with non-zero send or receive counts
+  std::vector<int> peers;
+};
+
+// Plans of live shufflers. A plan is released when the last shuffler
+// using it is destroyed.
+inline std::map<std::string, std::weak_ptr<const TensorMPIShufflePlan>> &
+get_shuffle_plan_registry() {
+  static std::map<std::string, std::weak_ptr<const TensorMPIShufflePlan>>
+      registry;
+  return registry;
+}
+
+inline std::mutex &get_shuffle_plan_registry_mutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Host staging buffers shared by all shufflers. Each slot only grows,
+// so after the first pass through a network no more allocations take
+// place and the footprint is that of the largest shuffle rather than
+// the sum over all of them. Shuffles are blocking and not run
+// concurrently, so a slot is never used by two shuffles at a time.
+class TensorMPIShuffleBufferPool {
+ public:
+  enum Slot {SEND = 0, RECV = 1, NUM_SLOTS = 2};
+
+  static void *get(Slot slot, size_t bytes) {
+    auto &buf = get_slots()[slot];
+    if (buf.size < bytes) {
+      buf.ptr.reset(new char[bytes]);
+      buf.size = bytes;
+    }
+    return buf.ptr.get();
+  }
+
+ private:
+  struct Buffer {
+    std::unique_ptr<char[]> ptr;
+    size_t size = 0;
+  };
+
+  static Buffer *get_slots() {
+    static Buffer slots[NUM_SLOTS];
+    return slots;
+  }
+};
+
 template <typename DataType, typename Allocator>
 class TensorMPIShuffleHelper {
   using TensorType = Tensor<DataType, LocaleMPI, Allocator>;
@@ -43,20 +112,34 @@ class TensorMPIShuffleHelper {
       m_src_buf(src_buf), m_dst_buf(dst_buf),
       m_src_buf_passed(src_buf != nullptr),
       m_dst_buf_passed(dst_buf != nullptr) {
-    setup_rank_limits(src_tensor, dst_tensor, m_rank_limits_fwd);
-    setup_rank_limits(dst_tensor, src_tensor, m_rank_limits_bwd);
-    setup_displs(src_tensor, dst_tensor);
+    const auto key = get_plan_key(src_tensor, dst_tensor);
+    std::lock_guard<std::mutex> lock(get_shuffle_plan_registry_mutex());
+    auto &registry = get_shuffle_plan_registry();
+    auto it = registry.find(key);
+    if (it != registry.end()) {
+      m_plan = it->second.lock();
+    }
+    if (m_plan) {
+      util::MPIPrintStreamDebug() << "Reusing shuffle plan for " << key;
+      return;
+    }
+    auto plan = std::make_shared<TensorMPIShufflePlan>();
+    setup_rank_limits(src_tensor, dst_tensor, plan->rank_limits_fwd);
+    setup_rank_limits(dst_tensor, src_tensor, plan->rank_limits_bwd);
+    setup_displs(src_tensor, dst_tensor, *plan);
 
     int num_ranks = m_loc.get_size();
     for (int pid = 0; pid < num_ranks; ++pid) {
-      if (m_send_counts[pid] != 0 || m_recv_counts[pid] != 0) {
+      if (plan->send_counts[pid] != 0 || plan->recv_counts[pid] != 0) {
         util::MPIPrintStreamDebug()
             << "Send/recv counts for "
-            << pid << ": " << m_send_counts[pid] << ", "
-            << m_recv_counts[pid];
-        m_peers.push_back(pid);
+            << pid << ": " << plan->send_counts[pid] << ", "
+            << plan->recv_counts[pid];
+        plan->peers.push_back(pid);
       }
     }
+    m_plan = plan;
+    registry[key] = m_plan;
   }
 
   virtual ~TensorMPIShuffleHelper() = default;
@@ -81,26 +164,40 @@ class TensorMPIShuffleHelper {
   const bool m_src_split_root;
   const bool m_dst_split_root;
 
-  // Offsets in src tensor for each dst locale. Used in
-  // packing. Linearized to a 1D array.
-  std::vector<int> m_rank_limits_fwd;
-  // Offsets in dst tensor for each src locale. Used in
-  // packing. Linearized to a 1D array.
-  std::vector<int> m_rank_limits_bwd;
-  std::vector<int> m_send_counts;
-  std::vector<int> m_recv_counts;
-  std::vector<int> m_send_displs;
-  std::vector<int> m_recv_displs;
+  std::shared_ptr<const TensorMPIShufflePlan> m_plan;
 
   DataType *m_src_buf;
   DataType *m_dst_buf;
   bool m_src_buf_passed;
   bool m_dst_buf_passed;
 
-  std::vector<int> m_peers;
+  const std::vector<int> &get_peers() const {
+    return m_plan->peers;
+  }
 
   int get_num_peers() const {
-    return m_peers.size();
+    return get_peers().size();
+  }
+
+  // Whether to exchange with point-to-point messages to the peers
+  // rather than an all-to-all over the whole communicator. Each
+  // rank usually overlaps with only a few others, so this avoids
+  // the cost of the dense collective at large scale.
+  bool use_sparse_transfer() const {
+    return get_num_peers() * 2 <= m_loc.get_size();
+  }
+
+  // Identifies the geometry of a shuffle between the two tensors as
+  // seen from this rank.
+  std::string get_plan_key(const TensorType &src_tensor,
+                           const TensorType &dst_tensor) const {
+    std::stringstream ss;
+    ss << m_loc.get_rank() << "/" << m_loc.get_size()
+       << " " << src_tensor.get_shape()
+       << src_tensor.get_distribution()
+       << " -> " << dst_tensor.get_shape()
+       << dst_tensor.get_distribution();
+    return ss.str();
   }
 
   void setup_rank_limits(const TensorType &src_tensor,
@@ -181,13 +278,18 @@ class TensorMPIShuffleHelper {
   }
 
   void setup_displs(const TensorType &src_tensor,
-                    const TensorType &dst_tensor) {
+                    const TensorType &dst_tensor,
+                    TensorMPIShufflePlan &plan) {
     int num_ranks = m_loc.get_size();
 
-    m_send_counts = std::vector<int>(num_ranks);
-    m_recv_counts = std::vector<int>(num_ranks);
-    m_send_displs = std::vector<int>(num_ranks);
-    m_recv_displs = std::vector<int>(num_ranks);
+    auto &send_counts = plan.send_counts;
+    auto &recv_counts = plan.recv_counts;
+    auto &send_displs = plan.send_displs;
+    auto &recv_displs = plan.recv_displs;
+    send_counts = std::vector<int>(num_ranks);
+    recv_counts = std::vector<int>(num_ranks);
+    send_displs = std::vector<int>(num_ranks);
+    recv_displs = std::vector<int>(num_ranks);
 
     const Region src_local_region(src_tensor.get_global_index(),
                                   m_src_local_shape);
@@ -209,8 +311,8 @@ class TensorMPIShuffleHelper {
 
     // transfers only between split root ranks
     for (int pid = 0; pid < num_ranks; ++pid) {
-      m_send_displs[pid] = cur_send_displs;
-      m_recv_displs[pid] = cur_recv_displs;
+      send_displs[pid] = cur_send_displs;
+      recv_displs[pid] = cur_recv_displs;
       // send_counts & send_displs
       const auto &dst_pid_idx = loc_shape_dst.get_index(pid);
       if (src_split_root &&
@@ -220,7 +322,7 @@ class TensorMPIShuffleHelper {
             dst_tensor.get_remote_shape(dst_pid_idx));
         auto &&send_intersection =
             src_local_region.intersect(dst_remote_region);
-        m_send_counts[pid] = send_intersection.get_size();
+        send_counts[pid] = send_intersection.get_size();
         util::MPIPrintStreamDebug()
             << "send_intersection for " << pid << ": "
             << send_intersection
@@ -229,9 +331,9 @@ class TensorMPIShuffleHelper {
         // do not send anything if the destination is not a split root
         util::MPIPrintStreamDebug() << "destination "
                                     << pid << " is not a split root";
-        m_send_counts[pid] = 0;
+        send_counts[pid] = 0;
       }
-      cur_send_displs += m_send_counts[pid];
+      cur_send_displs += send_counts[pid];
       // recv_counts & recv_displs
       const auto src_pid_idx = loc_shape_src.get_index(pid);
       if (dst_split_root &&
@@ -241,20 +343,20 @@ class TensorMPIShuffleHelper {
             src_tensor.get_remote_shape(src_pid_idx));
         auto &&recv_intersection =
             dst_local_region.intersect(src_remote_region);
-        m_recv_counts[pid] = recv_intersection.get_size();
+        recv_counts[pid] = recv_intersection.get_size();
       } else {
         // similarly, if the remote source is not a split root, do not
         // receive anything from it
         util::MPIPrintStreamDebug() << "source is not a split root";
-        m_recv_counts[pid] = 0;
+        recv_counts[pid] = 0;
       }
-      cur_recv_displs += m_recv_counts[pid];
+      cur_recv_displs += recv_counts[pid];
 
       util::MPIPrintStreamDebug()
-          << "send displs for rank " << pid << ": " << m_send_displs[pid]
-          << ", recv displs: " << m_recv_displs[pid]
-          << ", send count: " << m_send_counts[pid]
-          << ", recv count: " << m_recv_counts[pid];
+          << "send displs for rank " << pid << ": " << send_displs[pid]
+          << ", recv displs: " << recv_displs[pid]
+          << ", send count: " << send_counts[pid]
+          << ", recv count: " << recv_counts[pid];
     }
   }
 
@@ -368,24 +470,26 @@ class TensorMPIShuffleHelper {
   }
 
   const int *get_rank_limits_fwd(bool is_forward) const {
-    return is_forward ? m_rank_limits_fwd.data() : m_rank_limits_bwd.data();
+    return is_forward ? m_plan->rank_limits_fwd.data() :
+        m_plan->rank_limits_bwd.data();
   }
   const int *get_rank_limits_bwd(bool is_forward) const {
-    return is_forward ? m_rank_limits_bwd.data() : m_rank_limits_fwd.data();
+    return is_forward ? m_plan->rank_limits_bwd.data() :
+        m_plan->rank_limits_fwd.data();
   }
 
   const int *get_send_counts(bool is_forward) const {
-    return is_forward ? m_send_counts.data() : m_recv_counts.data();
+    return is_forward ? m_plan->send_counts.data() : m_plan->recv_counts.data();
   }
   const int *get_recv_counts(bool is_forward) const {
-    return is_forward ? m_recv_counts.data() : m_send_counts.data();
+    return is_forward ? m_plan->recv_counts.data() : m_plan->send_counts.data();
   }
 
   const int *get_send_displs(bool is_forward) const {
-    return is_forward ? m_send_displs.data() : m_recv_displs.data();
+    return is_forward ? m_plan->send_displs.data() : m_plan->recv_displs.data();
   }
   const int *get_recv_displs(bool is_forward) const {
-    return is_forward ? m_recv_displs.data() : m_send_displs.data();
+    return is_forward ? m_plan->recv_displs.data() : m_plan->send_displs.data();
   }
 
 };
@@ -493,14 +597,22 @@ class TensorMPIShuffler<DataType, BaseAllocator> {
     const int *send_displs = m_helper.get_send_displs(is_forward);
     const int *recv_displs = m_helper.get_recv_displs(is_forward);
 
+    // Staging buffers come from the pool shared by all shufflers
+    using BufferPool = internal::TensorMPIShuffleBufferPool;
     auto send_buf = m_helper.get_src_buf(
         is_forward, stream,
-        [](size_t c, StreamType s) { return new DataType[c]; },
-        [](DataType *p) { delete[] p; });
+        [](size_t c, StreamType s) {
+          return static_cast<DataType*>(
+              BufferPool::get(BufferPool::SEND, c * sizeof(DataType)));
+        },
+        [](DataType *p) {});
     auto recv_buf = m_helper.get_dst_buf(
         is_forward, stream,
-        [](size_t c, StreamType s) { return new DataType[c]; },
-        [](DataType *p) { delete[] p; });
+        [](size_t c, StreamType s) {
+          return static_cast<DataType*>(
+              BufferPool::get(BufferPool::RECV, c * sizeof(DataType)));
+        },
+        [](DataType *p) {});
 
     int nd = m_helper.get_num_dims();
 
@@ -595,6 +707,10 @@ class TensorMPIShuffler<DataType, BaseAllocator> {
   virtual void transfer(const std::shared_ptr<DataType> &send_buf,
                         std::shared_ptr<DataType> &recv_buf,
                         bool is_forward) {
+    if (m_helper.use_sparse_transfer()) {
+      transfer_sparse(send_buf, recv_buf, is_forward);
+      return;
+    }
     MPI_Alltoallv(send_buf.get(),
                   m_helper.get_send_counts(is_forward),
                   m_helper.get_send_displs(is_forward),
@@ -607,6 +723,43 @@ class TensorMPIShuffler<DataType, BaseAllocator> {
     util::MPIPrintStreamDebug() << "Transfer done";
   }
 
+  // Exchanges with only the ranks that have non-zero counts.
+  void transfer_sparse(const std::shared_ptr<DataType> &send_buf,
+                       std::shared_ptr<DataType> &recv_buf,
+                       bool is_forward) {
+    const int *send_counts = m_helper.get_send_counts(is_forward);
+    const int *send_displs = m_helper.get_send_displs(is_forward);
+    const int *recv_counts = m_helper.get_recv_counts(is_forward);
+    const int *recv_displs = m_helper.get_recv_displs(is_forward);
+    const int self = m_helper.m_loc.get_rank();
+    MPI_Comm comm = m_helper.m_loc.get_comm();
+    auto type = util::get_mpi_data_type<DataType>();
+    std::vector<MPI_Request> requests;
+    requests.reserve(m_helper.get_num_peers() * 2);
+    for (int peer: m_helper.get_peers()) {
+      if (peer == self || recv_counts[peer] == 0) continue;
+      requests.push_back(MPI_REQUEST_NULL);
+      DISTCONV_CHECK_MPI(MPI_Irecv(recv_buf.get() + recv_displs[peer],
+                                   recv_counts[peer], type, peer, 0, comm,
+                                   &requests.back()));
+    }
+    for (int peer: m_helper.get_peers()) {
+      if (peer == self || send_counts[peer] == 0) continue;
+      requests.push_back(MPI_REQUEST_NULL);
+      DISTCONV_CHECK_MPI(MPI_Isend(send_buf.get() + send_displs[peer],
+                                   send_counts[peer], type, peer, 0, comm,
+                                   &requests.back()));
+    }
+    if (send_counts[self] > 0) {
+      std::memcpy(recv_buf.get() + recv_displs[self],
+                  send_buf.get() + send_displs[self],
+                  send_counts[self] * sizeof(DataType));
+    }
+    DISTCONV_CHECK_MPI(MPI_Waitall(requests.size(), requests.data(),
+                                   MPI_STATUSES_IGNORE));
+    util::MPIPrintStreamDebug() << "Transfer done";
+  }
+
 #if 0
   virtual void transfer_sample_to_spatial(
       const std::shared_ptr<DataType> &send_buf,
@@ -8,17 +8,74 @@
 #include "distconv/util/util_gpu.hpp"
 #include "distconv/util/util_mpi.hpp"
 
+#include <Al.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 namespace distconv {
 namespace tensor {
 
+// Types shuffled with Aluminum's NCCL backend. Other types are
+// shuffled with MPI.
+template <typename DataType>
+struct IsShuffleALTypeSupported: std::false_type {};
+template <>
+struct IsShuffleALTypeSupported<float>: std::true_type {};
+template <>
+struct IsShuffleALTypeSupported<double>: std::true_type {};
+template <>
+struct IsShuffleALTypeSupported<int>: std::true_type {};
+template <>
+struct IsShuffleALTypeSupported<unsigned>: std::true_type {};
+
+// Where a local index in one dimension of a tensor goes in the other
+// tensor of a shuffle: the index of the remote rank along the
+// dimension times the stride of the dimension in the remote locale
+// shape, and the offset and length of the remote block along the
+// dimension. The packing offset of a point is then
+// offset_0 + dim_0 * (offset_1 + dim_1 * (offset_2 + ...)).
+struct ShuffleDestEntry {
+  int rank;
+  int offset;
+  int dim;
+};
+
+/*
+  Shuffles tensors between distributions by packing, exchanging with
+  all-to-all, and unpacking.
+
+  The all-to-all is done with Aluminum's NCCL backend on the stream
+  passed to shuffle_forward/shuffle_backward, so a shuffle does not
+  block the host or drain the stream. A communicator is created for
+  each stream at its first shuffle, which is collective. Setting
+  DISTCONV_SHUFFLE_USE_MPI uses MPI_Alltoallv instead, which
+  synchronizes the stream first.
+
+  Setting DISTCONV_SHUFFLE_PIPELINE_CHUNKS to N > 1 pipelines the
+  Aluminum shuffle: the outermost dimension is split into N chunks, and
+  packing a chunk, transferring the previous one, and unpacking the one
+  before that run concurrently on separate streams. Chunks split the
+  rows each rank holds in the tensor partitioned more finely in that
+  dimension (e.g., the sample-distributed one), so all ranks have work
+  in every chunk.
+
+  The tensors may have data types other than DataType, e.g., in
+  TensorMPICUDAShufflerCast, which transfers DataType.
+*/
 template <typename DataType>
 class TensorMPICUDAShuffler {
  protected:
   using TensorType = Tensor<DataType, LocaleMPI, CUDAAllocator>;
  public:
 
-  TensorMPICUDAShuffler(const TensorType &src_tensor,
-                        const TensorType &dst_tensor,
+  template <typename SrcTensorType, typename DstTensorType>
+  TensorMPICUDAShuffler(const SrcTensorType &src_tensor,
+                        const DstTensorType &dst_tensor,
                         DataType *src_buf=nullptr,
                         DataType *dst_buf=nullptr):
       m_src_local_shape(src_tensor.get_local_shape()),
@@ -34,14 +91,24 @@ class TensorMPICUDAShuffler {
       m_dst_split_root(dst_tensor.is_split_root()),
       m_rank_limits_fwd(nullptr),
       m_rank_limits_bwd(nullptr),
+      m_dest_table_fwd(nullptr),
+      m_dest_table_bwd(nullptr),
       m_send_counts(nullptr), m_recv_counts(nullptr),
       m_send_displs_h(nullptr), m_recv_displs_h(nullptr),
       m_send_displs_d(nullptr), m_recv_displs_d(nullptr),
       m_src_buf(src_buf), m_dst_buf(dst_buf),
-      m_src_buf_passed(src_buf != nullptr), m_dst_buf_passed(dst_buf != nullptr) {
-    setup_rank_limits(src_tensor, dst_tensor, m_rank_limits_fwd);
-    setup_rank_limits(dst_tensor, src_tensor, m_rank_limits_bwd);
+      m_src_buf_passed(src_buf != nullptr), m_dst_buf_passed(dst_buf != nullptr),
+      m_use_al(IsShuffleALTypeSupported<DataType>::value &&
+               std::getenv("DISTCONV_SHUFFLE_USE_MPI") == nullptr),
+      m_num_chunks(m_use_al ? get_default_num_pipeline_chunks() : 1) {
+    setup_rank_limits(src_tensor, dst_tensor, m_rank_limits_fwd,
+                      m_dest_table_fwd);
+    setup_rank_limits(dst_tensor, src_tensor, m_rank_limits_bwd,
+                      m_dest_table_bwd);
     setup_displs(src_tensor, dst_tensor);
+    if (m_num_chunks > 1) {
+      setup_pipeline(src_tensor, dst_tensor);
+    }
 
     int num_ranks = m_loc.get_size();
     for (int pid = 0; pid < num_ranks; ++pid) {
@@ -60,6 +127,10 @@ class TensorMPICUDAShuffler {
         DISTCONV_CHECK_GPU(GPU_FREE(m_rank_limits_fwd));
     if (m_rank_limits_bwd)
         DISTCONV_CHECK_GPU(GPU_FREE(m_rank_limits_bwd));
+    if (m_dest_table_fwd)
+        DISTCONV_CHECK_GPU(GPU_FREE(m_dest_table_fwd));
+    if (m_dest_table_bwd)
+        DISTCONV_CHECK_GPU(GPU_FREE(m_dest_table_bwd));
     if (m_send_counts)
       delete[] m_send_counts;
     if (m_recv_counts)
@@ -72,6 +143,13 @@ class TensorMPICUDAShuffler {
         DISTCONV_CHECK_GPU(GPU_FREE(m_send_displs_d));
     if (m_recv_displs_d)
         DISTCONV_CHECK_GPU(GPU_FREE(m_recv_displs_d));
+    for (auto rows: m_src_chunk_rows_d)
+        DISTCONV_CHECK_GPU(GPU_FREE(rows));
+    for (auto rows: m_dst_chunk_rows_d)
+        DISTCONV_CHECK_GPU(GPU_FREE(rows));
+    for (auto s: m_pipeline_streams) {
+      if (s) h2::gpu::destroy(s);
+    }
   }
 
   void shuffle_forward(const DataType* src,
@@ -89,6 +167,17 @@ class TensorMPICUDAShuffler {
     return tensor_local_shape.get_size() * sizeof(DataType);
   }
 
+  // Returns the number of chunks set with
+  // DISTCONV_SHUFFLE_PIPELINE_CHUNKS, or 1.
+  static int get_default_num_pipeline_chunks() {
+    const char *env = std::getenv("DISTCONV_SHUFFLE_PIPELINE_CHUNKS");
+    return env ? std::max(std::atoi(env), 1) : 1;
+  }
+
+  int get_num_pipeline_chunks() const {
+    return m_num_chunks;
+  }
+
  protected:
   const Shape m_src_local_shape;
   const Shape m_dst_local_shape;
@@ -108,6 +197,13 @@ class TensorMPICUDAShuffler {
   // Offsets in dst tensor for each src locale. Used in
   // packing. Linearized to a 1D array.
   int *m_rank_limits_bwd;
+  // Destination of each local index of each dimension of the src
+  // tensor in the dst tensor (fwd), and of the dst tensor in the src
+  // tensor (bwd), indexed by the sum of the lower dimensions plus the
+  // local index. Computed from the rank limits so that packing and
+  // unpacking do no searches or divisions.
+  ShuffleDestEntry *m_dest_table_fwd;
+  ShuffleDestEntry *m_dest_table_bwd;
   int *m_send_counts;
   int *m_recv_counts;
   int *m_send_displs_h;
@@ -122,13 +218,44 @@ class TensorMPICUDAShuffler {
 
   std::vector<int> m_peers;
 
+  // Whether the default transfer uses Aluminum instead of MPI.
+  const bool m_use_al;
+  // Counts and displacements in the form Aluminum takes.
+  std::vector<size_t> m_al_send_counts;
+  std::vector<size_t> m_al_recv_counts;
+  std::vector<size_t> m_al_send_displs;
+  std::vector<size_t> m_al_recv_displs;
+  // Communicators of the streams used with the Aluminum transfer.
+  std::vector<std::pair<h2::gpu::DeviceStream,
+                        std::unique_ptr<Al::NCCLBackend::comm_type>>>
+  m_al_comms;
+
+  // Number of chunks pipelined shuffles are split into.
+  int m_num_chunks;
+  // Local indices in the outermost dimension of the rows of each
+  // chunk in the source and destination tensors.
+  std::vector<int*> m_src_chunk_rows_d;
+  std::vector<int*> m_dst_chunk_rows_d;
+  std::vector<int> m_src_chunk_num_rows;
+  std::vector<int> m_dst_chunk_num_rows;
+  // Counts and displacements of each chunk from the source to the
+  // destination tensor.
+  std::vector<std::vector<size_t>> m_chunk_send_counts;
+  std::vector<std::vector<size_t>> m_chunk_send_displs;
+  std::vector<std::vector<size_t>> m_chunk_recv_counts;
+  std::vector<std::vector<size_t>> m_chunk_recv_displs;
+  // Streams to transfer and unpack chunks on.
+  h2::gpu::DeviceStream m_pipeline_streams[2] = {};
+
   int get_num_peers() const {
     return m_peers.size();
   }
 
-  void setup_rank_limits(const TensorType &src_tensor,
-                         const TensorType &dst_tensor,
-                         int *&rank_limits) {
+  template <typename SrcTensorType, typename DstTensorType>
+  void setup_rank_limits(const SrcTensorType &src_tensor,
+                         const DstTensorType &dst_tensor,
+                         int *&rank_limits,
+                         ShuffleDestEntry *&dest_table) {
     std::vector<int> host_buf;
     const int num_dims = src_tensor.get_num_dims();
     for (int i = 0; i < num_dims; ++i) {
@@ -163,10 +290,63 @@ class TensorMPICUDAShuffler {
 #endif
     DISTCONV_GPU_MALLOC(&rank_limits, sizeof(int) * host_buf.size());
     h2::gpu::mem_copy(rank_limits, host_buf.data(), host_buf.size());
+    setup_dest_table(src_tensor.get_local_shape(),
+                     dst_tensor.get_locale_shape(), host_buf, dest_table);
   }
 
-  void optimize_find_destination(const TensorType &src_tensor,
-                                 const TensorType &dst_tensor,
+  // Evaluates the rank limits of each dimension for each local index,
+  // as find_destination did for each point while packing.
+  void setup_dest_table(const Shape &src_local_shape,
+                        const Shape &dst_locale_shape,
+                        const std::vector<int> &rank_limits,
+                        ShuffleDestEntry *&dest_table) {
+    std::vector<ShuffleDestEntry> host_buf;
+    host_buf.reserve(src_local_shape.reduce_sum());
+    int rank_limits_idx = 0;
+    int rank_dim_offset = 1;
+    for (int i = 0; i < src_local_shape.num_dims(); ++i) {
+      const int *lims = rank_limits.data() + rank_limits_idx;
+      const int locale_dim = dst_locale_shape[i];
+      for (int x = 0; x < (int)src_local_shape[i]; ++x) {
+        int rank_idx = 0;
+        int offset;
+        int dim;
+        if (lims[0] == -1) {
+          // Evenly partitioned dimension (see optimize_find_destination)
+          const int global_index = x + lims[1];
+          const int dst_local_dim = lims[2];
+          rank_idx = global_index / dst_local_dim;
+          offset = std::min(global_index % dst_local_dim, x);
+          dim = std::min((int)src_local_shape[i] - (x - offset),
+                         dst_local_dim);
+        } else {
+          for (int j = 0; j < locale_dim; ++j) {
+            if (x < lims[j]) {
+              rank_idx = j;
+              break;
+            }
+          }
+          const int base = rank_idx == 0 ? 0 : lims[rank_idx - 1];
+          offset = x - base;
+          dim = lims[rank_idx] - base;
+        }
+        host_buf.push_back({rank_idx * rank_dim_offset, offset, dim});
+      }
+      rank_limits_idx += locale_dim;
+      rank_dim_offset *= locale_dim;
+    }
+    if (host_buf.empty()) {
+      dest_table = nullptr;
+      return;
+    }
+    DISTCONV_GPU_MALLOC(&dest_table,
+                        sizeof(ShuffleDestEntry) * host_buf.size());
+    h2::gpu::mem_copy(dest_table, host_buf.data(), host_buf.size());
+  }
+
+  template <typename SrcTensorType, typename DstTensorType>
+  void optimize_find_destination(const SrcTensorType &src_tensor,
+                                 const DstTensorType &dst_tensor,
                                  std::vector<int> &rank_limits) {
     const int num_dims = src_tensor.get_num_dims();
     int rank_limits_idx = 0;
@@ -204,8 +384,9 @@ class TensorMPICUDAShuffler {
     }
   }
 
-  void setup_displs(const TensorType &src_tensor,
-                    const TensorType &dst_tensor) {
+  template <typename SrcTensorType, typename DstTensorType>
+  void setup_displs(const SrcTensorType &src_tensor,
+                    const DstTensorType &dst_tensor) {
     int num_ranks = m_loc.get_size();
 
     m_send_counts = new int[num_ranks];
@@ -284,6 +465,167 @@ class TensorMPICUDAShuffler {
     }
     h2::gpu::mem_copy(m_send_displs_d, m_send_displs_h, num_ranks);
     h2::gpu::mem_copy(m_recv_displs_d, m_recv_displs_h, num_ranks);
+    m_al_send_counts.assign(m_send_counts, m_send_counts + num_ranks);
+    m_al_recv_counts.assign(m_recv_counts, m_recv_counts + num_ranks);
+    m_al_send_displs.assign(m_send_displs_h, m_send_displs_h + num_ranks);
+    m_al_recv_displs.assign(m_recv_displs_h, m_recv_displs_h + num_ranks);
+  }
+
+  template <typename SrcTensorType, typename DstTensorType>
+  void setup_pipeline(const SrcTensorType &src_tensor,
+                      const DstTensorType &dst_tensor) {
+    const int dim = src_tensor.get_num_dims() - 1;
+    const int num_ranks = m_loc.get_size();
+
+    // Ranges in the outermost dimension of the splits of the tensor
+    // partitioned more finely in it.
+    std::vector<std::pair<index_t, index_t>> splits;
+    auto collect_splits = [&](const auto &t) {
+      for (int j = 0; j < (int)t.get_locale_shape()[dim]; ++j) {
+        if (t.get_distribution().is_split_root(dim, j)) {
+          const index_t offset = t.get_dimension_rank_offset(dim, j);
+          splits.emplace_back(offset,
+                              offset + t.get_remote_dimension(dim, j));
+        }
+      }
+    };
+    if (src_tensor.get_distribution().get_split_shape()[dim] >=
+        dst_tensor.get_distribution().get_split_shape()[dim]) {
+      collect_splits(src_tensor);
+    } else {
+      collect_splits(dst_tensor);
+    }
+    // Global range of chunk c in split k.
+    auto get_chunk = [&](size_t k, int c) {
+      const index_t len = splits[k].second - splits[k].first;
+      return std::make_pair(splits[k].first + len * c / m_num_chunks,
+                            splits[k].first + len * (c + 1) / m_num_chunks);
+    };
+    // Sets the rows of each chunk in a local tensor.
+    auto setup_rows = [&](index_t offset, index_t extent,
+                          std::vector<int*> &rows_d,
+                          std::vector<int> &num_rows) {
+      for (int c = 0; c < m_num_chunks; ++c) {
+        std::vector<int> rows;
+        for (size_t k = 0; k < splits.size(); ++k) {
+          const auto chunk = get_chunk(k, c);
+          for (index_t g = std::max(chunk.first, offset);
+               g < std::min(chunk.second, offset + extent); ++g) {
+            rows.push_back(g - offset);
+          }
+        }
+        int *buf = nullptr;
+        if (!rows.empty()) {
+          DISTCONV_GPU_MALLOC(&buf, sizeof(int) * rows.size());
+          h2::gpu::mem_copy(buf, rows.data(), rows.size());
+        }
+        rows_d.push_back(buf);
+        num_rows.push_back(rows.size());
+      }
+    };
+    setup_rows(src_tensor.get_global_index()[dim], m_src_local_shape[dim],
+               m_src_chunk_rows_d, m_src_chunk_num_rows);
+    setup_rows(dst_tensor.get_global_index()[dim], m_dst_local_shape[dim],
+               m_dst_chunk_rows_d, m_dst_chunk_num_rows);
+
+    // A block exchanged with a peer is packed with the outermost
+    // dimension slowest and lies within one split, so the rows of a
+    // chunk are a contiguous part of it.
+    auto setup_counts = [&](const Region &block, size_t count, size_t displ,
+                            int c, size_t &chunk_count,
+                            size_t &chunk_displ) {
+      chunk_count = 0;
+      chunk_displ = displ;
+      if (count == 0) return;
+      const index_t begin = block.get_offset()[dim];
+      const index_t end = begin + block.get_extent()[dim];
+      const size_t inner = count / (end - begin);
+      for (size_t k = 0; k < splits.size(); ++k) {
+        const auto chunk = get_chunk(k, c);
+        const index_t lo = std::max(chunk.first, begin);
+        const index_t hi = std::min(chunk.second, end);
+        if (lo < hi) {
+          chunk_count = (hi - lo) * inner;
+          chunk_displ = displ + (lo - begin) * inner;
+          return;
+        }
+      }
+    };
+    const Region src_local_region(src_tensor.get_global_index(),
+                                  m_src_local_shape);
+    const Region dst_local_region(dst_tensor.get_global_index(),
+                                  m_dst_local_shape);
+    m_chunk_send_counts.assign(m_num_chunks, std::vector<size_t>(num_ranks));
+    m_chunk_send_displs.assign(m_num_chunks, std::vector<size_t>(num_ranks));
+    m_chunk_recv_counts.assign(m_num_chunks, std::vector<size_t>(num_ranks));
+    m_chunk_recv_displs.assign(m_num_chunks, std::vector<size_t>(num_ranks));
+    for (int pid = 0; pid < num_ranks; ++pid) {
+      Region send_block;
+      if (m_send_counts[pid] > 0) {
+        const auto idx = m_dst_locale_shape.get_index(pid);
+        send_block = src_local_region.intersect(
+            Region(dst_tensor.get_remote_index(idx),
+                   dst_tensor.get_remote_shape(idx)));
+      }
+      Region recv_block;
+      if (m_recv_counts[pid] > 0) {
+        const auto idx = m_src_locale_shape.get_index(pid);
+        recv_block = dst_local_region.intersect(
+            Region(src_tensor.get_remote_index(idx),
+                   src_tensor.get_remote_shape(idx)));
+      }
+      for (int c = 0; c < m_num_chunks; ++c) {
+        setup_counts(send_block, m_send_counts[pid], m_send_displs_h[pid], c,
+                     m_chunk_send_counts[c][pid],
+                     m_chunk_send_displs[c][pid]);
+        setup_counts(recv_block, m_recv_counts[pid], m_recv_displs_h[pid], c,
+                     m_chunk_recv_counts[c][pid],
+                     m_chunk_recv_displs[c][pid]);
+      }
+    }
+  }
+
+  // Whether shuffles are pipelined. Derived shufflers with their own
+  // transfers are not.
+  virtual bool is_pipelined() const {
+    return m_use_al && m_num_chunks > 1;
+  }
+
+  h2::gpu::DeviceStream get_pipeline_stream(int i) {
+    if (!m_pipeline_streams[i]) {
+      m_pipeline_streams[i] = h2::gpu::make_stream_nonblocking();
+    }
+    return m_pipeline_streams[i];
+  }
+
+  Al::NCCLBackend::comm_type &get_al_comm(h2::gpu::DeviceStream stream) {
+    for (auto &c: m_al_comms) {
+      if (c.first == stream) {
+        return *c.second;
+      }
+    }
+    util::MPIPrintStreamDebug() << "Creating a shuffle communicator";
+    m_al_comms.emplace_back(
+        stream, std::make_unique<Al::NCCLBackend::comm_type>(
+            m_loc.get_comm(), stream));
+    return *m_al_comms.back().second;
+  }
+
+  // Enqueues the all-to-all on stream without synchronizing it.
+  void transfer_al(const DataType* send_buf,
+                   DataType* recv_buf,
+                   bool is_forward,
+                   h2::gpu::DeviceStream stream) {
+    if constexpr (IsShuffleALTypeSupported<DataType>::value) {
+      Al::Alltoallv<Al::NCCLBackend, DataType>(
+          send_buf,
+          is_forward ? m_al_send_counts : m_al_recv_counts,
+          is_forward ? m_al_send_displs : m_al_recv_displs,
+          recv_buf,
+          is_forward ? m_al_recv_counts : m_al_send_counts,
+          is_forward ? m_al_recv_displs : m_al_send_displs,
+          get_al_comm(stream));
+    }
   }
 
   void shuffle(const DataType* src,
@@ -291,6 +633,11 @@ class TensorMPICUDAShuffler {
                h2::gpu::DeviceStream stream,
                bool is_forward);
 
+  void shuffle_pipelined(const DataType* src,
+                         DataType* dst,
+                         h2::gpu::DeviceStream stream,
+                         bool is_forward);
+
   virtual DataType* get_src_buf(bool is_forward, h2::gpu::DeviceStream s)
   {
       if (is_forward && m_src_buf_passed)
@@ -346,6 +693,12 @@ class TensorMPICUDAShuffler {
                         bool is_forward,
                         h2::gpu::DeviceStream stream)
   {
+      if (m_use_al)
+      {
+          transfer_al(send_buf, recv_buf, is_forward, stream);
+          util::MPIPrintStreamDebug() << "Transfer enqueued\n";
+          return;
+      }
 #ifdef DISTCONV_SHFL_USE_CUDA_AWARE
       DISTCONV_CHECK_GPU(cudaStreamSynchronize(stream));
       MPI_Alltoallv(send_buf,
@@ -486,6 +839,13 @@ class TensorMPICUDAShuffler {
     return is_forward ? m_rank_limits_bwd : m_rank_limits_fwd;
   }
 
+  const ShuffleDestEntry *get_dest_table_fwd(bool is_forward) const {
+    return is_forward ? m_dest_table_fwd : m_dest_table_bwd;
+  }
+  const ShuffleDestEntry *get_dest_table_bwd(bool is_forward) const {
+    return is_forward ? m_dest_table_bwd : m_dest_table_fwd;
+  }
+
   const int *get_send_counts(bool is_forward) const {
     return is_forward ? m_send_counts : m_recv_counts;
   }
@@ -500,6 +860,36 @@ class TensorMPICUDAShuffler {
     return is_forward ? m_recv_displs_h : m_send_displs_h;
   }
 
+  const int *get_src_chunk_rows(bool is_forward, int c) const {
+    return is_forward ? m_src_chunk_rows_d[c] : m_dst_chunk_rows_d[c];
+  }
+  const int *get_dst_chunk_rows(bool is_forward, int c) const {
+    return is_forward ? m_dst_chunk_rows_d[c] : m_src_chunk_rows_d[c];
+  }
+  int get_src_chunk_num_rows(bool is_forward, int c) const {
+    return is_forward ? m_src_chunk_num_rows[c] : m_dst_chunk_num_rows[c];
+  }
+  int get_dst_chunk_num_rows(bool is_forward, int c) const {
+    return is_forward ? m_dst_chunk_num_rows[c] : m_src_chunk_num_rows[c];
+  }
+
+  const std::vector<size_t> &get_chunk_send_counts(bool is_forward,
+                                                   int c) const {
+    return is_forward ? m_chunk_send_counts[c] : m_chunk_recv_counts[c];
+  }
+  const std::vector<size_t> &get_chunk_recv_counts(bool is_forward,
+                                                   int c) const {
+    return is_forward ? m_chunk_recv_counts[c] : m_chunk_send_counts[c];
+  }
+  const std::vector<size_t> &get_chunk_send_displs(bool is_forward,
+                                                   int c) const {
+    return is_forward ? m_chunk_send_displs[c] : m_chunk_recv_displs[c];
+  }
+  const std::vector<size_t> &get_chunk_recv_displs(bool is_forward,
+                                                   int c) const {
+    return is_forward ? m_chunk_recv_displs[c] : m_chunk_send_displs[c];
+  }
+
   const int *get_send_displs_d(bool is_forward) const {
     return is_forward ? m_send_displs_d : m_recv_displs_d;
   }
@@ -28,6 +28,11 @@ class TensorMPICUDAShufflerAL:
  protected:
   Al::NCCLBackend::comm_type &m_al_comm;
 
+  // Chunks are not pipelined with this transfer.
+  bool is_pipelined() const override {
+    return false;
+  }
+
   void transfer(const DataType* send_buf,
                 size_t send_buffer_size,
                 DataType* recv_buf,
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "distconv/tensor/shuffle_mpi_cuda.hpp"
+#include <distconv_config.hpp>
+
+#include "h2_config.hpp"
+
+#if H2_HAS_CUDA
+#include <cuda_bf16.h>
+#include <cuda_fp16.h>
+#elif H2_HAS_ROCM
+#include <hip/hip_bf16.h>
+#include <hip/hip_fp16.h>
+#endif
+
+#include <Al.hpp>
+
+#include <cstdlib>
+#include <type_traits>
+
+namespace distconv {
+namespace tensor {
+
+#if H2_HAS_CUDA
+using ShuffleBF16 = __nv_bfloat16;
+#elif H2_HAS_ROCM
+using ShuffleBF16 = __hip_bfloat16;
+#endif
+
+// Type packed points are stored in while shuffled between SrcType and
+// DstType tensors: the smaller of the two.
+template <typename SrcType, typename DstType>
+using ShuffleWireType = std::conditional_t<
+  (sizeof(DstType) < sizeof(SrcType)), DstType, SrcType>;
+
+// Type TensorMPICUDAShuffler transfers a wire type as. 16-bit
+// floating-point types are moved as their bits.
+template <typename WireType>
+using ShuffleWireStorageType = std::conditional_t<
+  sizeof(WireType) == 2, unsigned short, WireType>;
+
+/*
+  Shuffles SrcType tensors to DstType tensors and back, converting
+  types while packing and unpacking.
+
+  Converting to the smaller type at packing (or from it at unpacking)
+  avoids a separate cast pass, and the all-to-all only moves the
+  smaller type, e.g., half the bytes when shuffling an fp32 tensor to
+  a bf16 one. Supported pairs are float with __half, float with
+  bfloat16, and float with double, in either order.
+*/
+template <typename SrcType, typename DstType>
+class TensorMPICUDAShufflerCast:
+      public TensorMPICUDAShuffler<
+        ShuffleWireStorageType<ShuffleWireType<SrcType, DstType>>> {
+  using WireType = ShuffleWireType<SrcType, DstType>;
+  using WireStorageType = ShuffleWireStorageType<WireType>;
+  using ShufflerType = TensorMPICUDAShuffler<WireStorageType>;
+  // Type the wire is passed to Aluminum as.
+  using AlWireType = std::conditional_t<sizeof(WireType) == 2,
+                                        __half, WireType>;
+ public:
+  using SrcTensorType = Tensor<SrcType, LocaleMPI, CUDAAllocator>;
+  using DstTensorType = Tensor<DstType, LocaleMPI, CUDAAllocator>;
+
+  TensorMPICUDAShufflerCast(const SrcTensorType &src_tensor,
+                            const DstTensorType &dst_tensor):
+      ShufflerType(src_tensor, dst_tensor),
+      m_use_al_wire(std::getenv("DISTCONV_SHUFFLE_USE_MPI") == nullptr) {}
+
+  virtual ~TensorMPICUDAShufflerCast() = default;
+
+  void shuffle_forward(const SrcType* src,
+                       DstType* dst,
+                       h2::gpu::DeviceStream stream = 0);
+  void shuffle_backward(const DstType* src,
+                        SrcType* dst,
+                        h2::gpu::DeviceStream stream = 0);
+
+ protected:
+  const bool m_use_al_wire;
+
+  template <typename FromType, typename ToType>
+  void shuffle_cast(const FromType* src,
+                    ToType* dst,
+                    h2::gpu::DeviceStream stream,
+                    bool is_forward);
+
+  void transfer(const WireStorageType* send_buf,
+                size_t send_buffer_size,
+                WireStorageType* recv_buf,
+                size_t recv_buffer_size,
+                bool is_forward,
+                h2::gpu::DeviceStream stream) override
+  {
+      if (!m_use_al_wire)
+      {
+          ShufflerType::transfer(send_buf, send_buffer_size,
+                                 recv_buf, recv_buffer_size,
+                                 is_forward, stream);
+          return;
+      }
+      Al::Alltoallv<Al::NCCLBackend, AlWireType>(
+          reinterpret_cast<const AlWireType*>(send_buf),
+          is_forward ? this->m_al_send_counts : this->m_al_recv_counts,
+          is_forward ? this->m_al_send_displs : this->m_al_recv_displs,
+          reinterpret_cast<AlWireType*>(recv_buf),
+          is_forward ? this->m_al_recv_counts : this->m_al_send_counts,
+          is_forward ? this->m_al_recv_displs : this->m_al_send_displs,
+          this->get_al_comm(stream));
+  }
+};
+
+} // namespace tensor
+} // namespace distconv
@@ -31,17 +31,17 @@ class TensorMPICUDAShufflerHybrid:
     m_p2p.close_addrs(m_conns, get_peer_addrs(false), this->get_num_peers());
     delete[] m_conns;
     if (this->m_src_buf_passed) {
-      DISTCONV_CHECK_CUDA(cudaFree(this->m_src_buf));
+      DISTCONV_CHECK_GPU(GPU_FREE(this->m_src_buf));
     }
     if (this->m_dst_buf_passed) {
-      DISTCONV_CHECK_CUDA(cudaFree(this->m_dst_buf));
+      DISTCONV_CHECK_GPU(GPU_FREE(this->m_dst_buf));
     }
     for (int i = 0; i < 2; ++i) {
       delete[] m_peer_addrs[i];
       delete[] m_peer_offsets[i];
     }
     for (int i = 0; i < num_peers; ++i) {
-      DISTCONV_CHECK_CUDA(cudaStreamDestroy(m_streams[i]));
+      h2::gpu::destroy(m_streams[i]);
     }
     delete[] m_streams;
   }
@@ -52,7 +52,7 @@ class TensorMPICUDAShufflerHybrid:
   p2p::P2P::connection_type *m_conns;
   void **m_peer_addrs[2];
   size_t *m_peer_offsets[2];
-  cudaStream_t *m_streams;
+  h2::gpu::DeviceStream *m_streams;
   std::vector<bool> m_p2p_enabled;
 
   void **&get_peer_addrs(bool is_forward) {
@@ -140,25 +140,30 @@ class TensorMPICUDAShufflerHybrid:
     setup_peer_addresses(true);
     setup_peer_addresses(false);
 
-    m_streams = new cudaStream_t[num_peers];
+    m_streams = new h2::gpu::DeviceStream[num_peers];
     for (int i = 0; i < num_peers; ++i) {
-      DISTCONV_CHECK_CUDA(cudaStreamCreate(&m_streams[i]));
+      m_streams[i] = h2::gpu::make_stream();
     }
   }
 
-  DataType *get_src_buf(bool is_forward, cudaStream_t=0) override {
+  DataType *get_src_buf(bool is_forward, h2::gpu::DeviceStream=0) override {
     return static_cast<DataType*>(is_forward ? this->m_src_buf : this->m_dst_buf);
   }
 
-  DataType *get_dst_buf(bool is_forward, cudaStream_t=0) override {
+  DataType *get_dst_buf(bool is_forward, h2::gpu::DeviceStream=0) override {
     return static_cast<DataType*>(is_forward ? this->m_dst_buf : this->m_src_buf);
   }
 
+  // Chunks are not pipelined with this transfer.
+  bool is_pipelined() const override {
+    return false;
+  }
+
   void transfer(const DataType *send_buf,
                 size_t send_buffer_size,
                 DataType *recv_buf,
                 size_t recv_buffer_size,
-                bool is_forward, cudaStream_t stream) override {
+                bool is_forward, h2::gpu::DeviceStream stream) override {
     std::vector<Al::NCCLBackend::req_type> requests;
     int num_peers = this->get_num_peers();
     for (int i = 0; i < num_peers; ++i) {
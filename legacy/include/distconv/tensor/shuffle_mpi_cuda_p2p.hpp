@@ -28,20 +28,20 @@ class TensorMPICUDAShufflerP2P:
     m_p2p.close_addrs(m_conns, get_peer_addrs(false), this->get_num_peers());
     delete[] m_conns;
     if (this->m_src_buf_passed) {
-      DISTCONV_CHECK_CUDA(cudaFree(this->m_src_buf));
+      DISTCONV_CHECK_GPU(GPU_FREE(this->m_src_buf));
     }
     if (this->m_dst_buf_passed) {
-      DISTCONV_CHECK_CUDA(cudaFree(this->m_dst_buf));
+      DISTCONV_CHECK_GPU(GPU_FREE(this->m_dst_buf));
     }
     for (int i = 0; i < 2; ++i) {
       delete[] m_peer_addrs[i];
       delete[] m_peer_offsets[i];
     }
     for (int i = 0; i < this->get_num_peers(); ++i) {
-      DISTCONV_CHECK_CUDA(cudaStreamDestroy(m_streams[i]));
+      h2::gpu::destroy(m_streams[i]);
     }
     delete[] m_streams;
-    DISTCONV_CHECK_CUDA(cudaEventDestroy(m_ev));
+    h2::gpu::destroy(m_ev);
   }
 
  protected:
@@ -49,8 +49,8 @@ class TensorMPICUDAShufflerP2P:
   p2p::P2P::connection_type *m_conns;
   void **m_peer_addrs[2];
   size_t *m_peer_offsets[2];
-  cudaStream_t *m_streams;
-  cudaEvent_t m_ev;
+  h2::gpu::DeviceStream *m_streams;
+  h2::gpu::DeviceEvent m_ev;
 
   void **&get_peer_addrs(bool is_forward) {
     return m_peer_addrs[is_forward ? 0 : 1];
@@ -122,29 +122,33 @@ class TensorMPICUDAShufflerP2P:
     setup_peer_addresses(true);
     setup_peer_addresses(false);
 
-    m_streams = new cudaStream_t[num_peers];
+    m_streams = new h2::gpu::DeviceStream[num_peers];
     for (int i = 0; i < num_peers; ++i) {
-      DISTCONV_CHECK_CUDA(cudaStreamCreate(&m_streams[i]));
+      m_streams[i] = h2::gpu::make_stream();
     }
 
-    DISTCONV_CHECK_CUDA(cudaEventCreateWithFlags(
-        &m_ev, cudaEventDisableTiming));
+    m_ev = h2::gpu::make_event_notiming();
   }
 
-  DataType *get_src_buf(bool is_forward, cudaStream_t=0) override {
+  DataType *get_src_buf(bool is_forward, h2::gpu::DeviceStream=0) override {
     return static_cast<DataType*>(is_forward ? this->m_src_buf : this->m_dst_buf);
   }
 
-  DataType *get_dst_buf(bool is_forward, cudaStream_t=0) override {
+  DataType *get_dst_buf(bool is_forward, h2::gpu::DeviceStream=0) override {
     return static_cast<DataType*>(is_forward ? this->m_dst_buf : this->m_src_buf);
   }
 
+  // Chunks are not pipelined with this transfer.
+  bool is_pipelined() const override {
+    return false;
+  }
+
   void transfer(const DataType *send_buf,
                 size_t send_buffer_size,
                 DataType *recv_buf,
                 size_t recv_buffer_size,
-                bool is_forward, cudaStream_t stream) override {
-    DISTCONV_CHECK_CUDA(cudaEventRecord(m_ev, stream));
+                bool is_forward, h2::gpu::DeviceStream stream) override {
+    h2::gpu::record_event(m_ev, stream);
     int num_peers = this->get_num_peers();
 #if 1
     for (int i = 0; i < num_peers; ++i) {
@@ -153,7 +157,7 @@ class TensorMPICUDAShufflerP2P:
       if (this->get_send_counts(is_forward)[this->m_peers[i]] == 0) {
         continue;
       }
-      DISTCONV_CHECK_CUDA(cudaStreamWaitEvent(m_streams[i], m_ev, 0));
+      h2::gpu::sync(m_streams[i], m_ev);
       conn->put(send_buf +
                 this->get_send_displs_h(is_forward)[conn->get_peer()],
                 static_cast<DataType*>(get_peer_addrs(is_forward)[i])
@@ -172,7 +176,7 @@ class TensorMPICUDAShufflerP2P:
       if (this->get_send_counts(is_forward)[this->m_peers[i]] == 0) {
         continue;
       }
-      DISTCONV_CHECK_CUDA(cudaStreamWaitEvent(m_streams[i], m_ev, 0));
+      h2::gpu::sync(m_streams[i], m_ev);
       // Issues intra-numa copies as they won't conflict or conflicts
       // are still fast enough to ignore
       if (conn->get_peer() == my_rank ||
@@ -223,8 +227,8 @@ class TensorMPICUDAShufflerP2P:
     m_p2p.barrier(m_conns, m_streams, num_peers);
     for (int i = 0; i < num_peers; ++i) {
       if (this->get_recv_counts(is_forward)[this->m_peers[i]] != 0) {
-        DISTCONV_CHECK_CUDA(cudaEventRecord(m_ev, m_streams[i]));
-        DISTCONV_CHECK_CUDA(cudaStreamWaitEvent(stream, m_ev, 0));
+        h2::gpu::record_event(m_ev, m_streams[i]);
+        h2::gpu::sync(stream, m_ev);
       }
     }
   }
@@ -639,16 +639,21 @@ class Tensor: public AbstractTensor {
 
     Shared regions are splits that have multiple locales.
   */
-  void allreduce_shared_regions() {
-    this->m_impl.allreduce_shared_regions();
+  void allreduce_shared_regions(typename Stream<Allocator>::type stream=
+                                Stream<Allocator>::default_value) {
+    this->m_impl.allreduce_shared_regions(stream);
     return;
   }
 
   /*
     Allreduces along dims.
+
+    Both reductions are ordered on stream and do not block the host.
   */
-  void allreduce(const std::vector<int> &dims) {
-    this->m_impl.allreduce(dims);
+  void allreduce(const std::vector<int> &dims,
+                 typename Stream<Allocator>::type stream=
+                 Stream<Allocator>::default_value) {
+    this->m_impl.allreduce(dims, stream);
   }
 };
 
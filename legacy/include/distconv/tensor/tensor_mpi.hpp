@@ -1,6 +1,10 @@
 #pragma once
 
 #include <cassert>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
 #include <type_traits>
 #include <vector>
 #include <cstring>
@@ -18,14 +22,16 @@ namespace tensor {
 class LocaleMPI {
  public:
   LocaleMPI(MPI_Comm comm=MPI_COMM_WORLD):
-      m_comm(new MPI_Comm, LocaleMPI::delete_comm) {
+      m_comm(new MPI_Comm, LocaleMPI::delete_comm),
+      m_cache(std::make_shared<Cache>()) {
     *m_comm = comm;
     MPI_Comm_rank(comm, &m_rank);
     MPI_Comm_size(comm, &m_num_procs);
   }
 
   LocaleMPI(MPI_Comm comm, bool release_ownership):
-      m_comm(new MPI_Comm, LocaleMPI::delete_comm) {
+      m_comm(new MPI_Comm, LocaleMPI::delete_comm),
+      m_cache(std::make_shared<Cache>()) {
     if (!release_ownership) {
       MPI_Comm comm2;
       MPI_Comm_dup(comm, &comm2);
@@ -77,6 +83,31 @@ class LocaleMPI {
     return *m_comm;
   }
 
+  // Returns the communicator of the ranks with the same color, which
+  // is split from this locale on the first request with key and kept
+  // with it. All ranks must request the same keys in the same order.
+  MPI_Comm get_sub_comm(const std::string &key, int color) const {
+    auto &sub_comm = m_cache->sub_comms[key];
+    if (!sub_comm) {
+      sub_comm.reset(new MPI_Comm(MPI_COMM_NULL), LocaleMPI::delete_comm);
+      DISTCONV_CHECK_MPI(MPI_Comm_split(*m_comm, color, m_rank,
+                                        sub_comm.get()));
+    }
+    return *sub_comm;
+  }
+
+  // Returns an object kept with this locale (e.g., an Aluminum
+  // communicator of a sub-communicator), which make creates as a
+  // std::shared_ptr<T> on the first request with key.
+  template <typename T, typename Make>
+  T &get_cached(const std::string &key, Make make) const {
+    auto &obj = m_cache->objects[key];
+    if (!obj) {
+      obj = make();
+    }
+    return *static_cast<T *>(obj.get());
+  }
+
  protected:
   static void delete_comm(MPI_Comm *p) {
     if (*p != MPI_COMM_WORLD && *p != MPI_COMM_NULL) {
@@ -88,6 +119,13 @@ class LocaleMPI {
 #else
   std::shared_ptr<MPI_Comm> m_comm;
 #endif
+  // Shared by copies, and destroyed before m_comm. Cached objects may
+  // use sub-communicators, so they are destroyed first.
+  struct Cache {
+    std::map<std::string, std::shared_ptr<MPI_Comm>> sub_comms;
+    std::map<std::string, std::shared_ptr<void>> objects;
+  };
+  std::shared_ptr<Cache> m_cache;
   int m_rank;
   int m_num_procs;
 };
@@ -362,33 +400,29 @@ class TensorImpl<Tensor<DataType, LocaleMPI, Allocator>> {
     return m_offset_all[dim][rank];
   }
 
-  void allreduce_shared_regions() {
-    auto subloc = m_tensor->get_split_sub_locale();
-    DISTCONV_CHECK_MPI(
-        MPI_Allreduce(MPI_IN_PLACE, m_tensor->get_buffer(),
-                      m_tensor->get_local_pitched_size(),
-                      util::get_mpi_data_type<DataType>(),
-                      MPI_SUM, subloc.get_comm()));
+  // The reductions are enqueued on stream, over sub-communicators
+  // cached with the locale of the tensor.
+  void allreduce_shared_regions(typename Stream<Allocator>::type stream) {
+    const auto &dist = m_tensor->get_distribution();
+    std::ostringstream key;
+    key << "split " << dist.get_locale_shape() << " "
+        << dist.get_split_shape();
+    int color = get_offset(m_split_idx, dist.get_split_shape());
+    HelperType(*this).allreduce(key.str(), color, stream);
   }
 
-  void allreduce(const std::vector<int> &dims) {
-    MPI_Comm comm = m_tensor->get_locale().get_comm();
+  void allreduce(const std::vector<int> &dims,
+                 typename Stream<Allocator>::type stream) {
     const auto &dist = m_tensor->get_distribution();
     auto sub_comm_idx = get_proc_index();
+    std::ostringstream key;
+    key << "dims " << dist.get_locale_shape();
     for (auto d: dims) {
       sub_comm_idx[d] = 0;
+      key << " " << d;
     }
-    int sub_comm_key = get_offset(sub_comm_idx, dist.get_locale_shape());
-    MPI_Comm sub_comm;
-    DISTCONV_CHECK_MPI(MPI_Comm_split(comm, sub_comm_key,
-                                      m_tensor->get_locale().get_rank(),
-                                      &sub_comm));
-    DISTCONV_CHECK_MPI(
-        MPI_Allreduce(MPI_IN_PLACE, m_tensor->get_buffer(),
-                      m_tensor->get_local_pitched_size(),
-                      util::get_mpi_data_type<DataType>(),
-                      MPI_SUM, sub_comm));
-    MPI_Comm_free(&sub_comm);
+    int color = get_offset(sub_comm_idx, dist.get_locale_shape());
+    HelperType(*this).allreduce(key.str(), color, stream);
   }
 
   void scale(DataType v, typename Stream<Allocator>::type stream) {
@@ -9,6 +9,12 @@
 #include "distconv/util/util_mpi.hpp"
 #include <distconv_config.hpp>
 
+#include <Al.hpp>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
 #if H2_HAS_CUDA
 #define GPU_MEMCPY_3D_PARAMS cudaMemcpy3DParms
 #elif H2_HAS_ROCM
@@ -155,6 +161,30 @@ class TensorImplHelper<DataType, CUDAAllocator> {
   void clear_halo(int dim, h2::gpu::DeviceStream s);
   void scale(DataType v, h2::gpu::DeviceStream s);
 
+  // Sums the local buffer across the ranks with the same color with
+  // Aluminum on s, using a sub-communicator cached under key.
+  void allreduce(const std::string &key, int color, h2::gpu::DeviceStream s) {
+    const auto &loc = m_impl.m_tensor->get_locale();
+    MPI_Comm comm = loc.get_sub_comm(key, color);
+    int comm_size;
+    DISTCONV_CHECK_MPI(MPI_Comm_size(comm, &comm_size));
+    if (comm_size == 1) {
+      return;
+    }
+    // Aluminum communicators are bound to a stream
+    using AlComm = Al::NCCLBackend::comm_type;
+    std::ostringstream al_key;
+    al_key << key << " color " << color << " stream " << s;
+    auto &al_comm = loc.template get_cached<AlComm>(al_key.str(), [&]() {
+      util::MPIPrintStreamDebug() << "Creating an allreduce communicator";
+      return std::make_shared<AlComm>(comm, s);
+    });
+    Al::Allreduce<Al::NCCLBackend, DataType>(
+        m_impl.m_tensor->get_buffer(),
+        m_impl.m_tensor->get_local_pitched_size(),
+        Al::ReductionOperator::sum, al_comm);
+  }
+
   protected:
   TensorImplType &m_impl;
 };
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "distconv_config.hpp"
+#include "distconv/util/util_mpi.hpp"
+
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#if defined(DISTCONV_HAS_NVSHMEM) || defined(DISTCONV_HAS_ROCSHMEM)
+#define DISTCONV_HAS_SHMEM
+#endif
+
+namespace distconv {
+namespace util {
+namespace shmem {
+
+#ifdef DISTCONV_HAS_SHMEM
+
+/*
+  Symmetric heap shared by all users of NVSHMEM or ROC_SHMEM.
+
+  Symmetric allocations are collective and expensive, so released
+  blocks are kept and handed out again to later allocations of a
+  similar size. Blocks stay symmetric as long as all PEs allocate and
+  release the same sizes in the same order, which the collective
+  allocation already requires. Reusing a block synchronizes all PEs
+  like a new allocation does.
+
+  Setting DISTCONV_SHMEM_POOL=0 frees blocks when they are released.
+*/
+class SymmetricHeap {
+ public:
+  static SymmetricHeap &get_instance();
+
+  // Collective over all PEs
+  void *allocate(size_t size);
+  void release(void *p);
+  // Frees all pooled blocks. Collective over all PEs.
+  void clear();
+
+  size_t get_allocated_bytes() const { return m_allocated_bytes; }
+  size_t get_pooled_bytes() const { return m_pooled_bytes; }
+
+ private:
+  SymmetricHeap();
+  ~SymmetricHeap() = default;
+
+  bool m_pool_enabled;
+  // Released blocks by size
+  std::multimap<size_t, void*> m_free_blocks;
+  // Sizes of the blocks in use
+  std::unordered_map<void*, size_t> m_block_sizes;
+  size_t m_allocated_bytes = 0;
+  size_t m_pooled_bytes = 0;
+};
+
+// Backend-neutral wrappers of the SHMEM library. finalize frees the
+// pooled blocks first.
+void initialize(MPI_Comm comm);
+void finalize();
+void barrier();
+int my_pe();
+int n_pes();
+
+#endif // DISTCONV_HAS_SHMEM
+
+} // namespace shmem
+} // namespace util
+} // namespace distconv
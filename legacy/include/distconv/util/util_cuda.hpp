@@ -4,6 +4,7 @@
 #include "distconv/util/util_mpi.hpp"
 #include "distconv/runtime.hpp"
 #include "distconv/runtime_cuda.hpp"
+#include "h2/core/low_precision.hpp"
 
 #include <cstdlib>
 #include <cassert>
@@ -46,27 +47,49 @@ __device__ __forceinline__ T atomic_add(T* address, T value)
   return atomicAdd(address, value);
 }
 
-// Handle fp16
-#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ < 700 && __CUDA_ARCH__ >= 530
-#include <cuda_fp16.h>
-__device__ __forceinline__ __half atomic_add(__half* address, __half val)
+// Adds val to the 16-bit value at address with a compare-and-swap of
+// the aligned 32-bit word containing it.
+template <typename T>
+__device__ __forceinline__ T atomic_add_16bit(T* address, T val)
 {
-  unsigned int* address_as_uint = (unsigned int*) address;
+  const size_t addr = reinterpret_cast<size_t>(address);
+  unsigned int* address_as_uint = reinterpret_cast<unsigned int*>(
+      addr & ~size_t(3));
+  const unsigned int shift = (addr & 2) ? 16 : 0;
   unsigned int old = *address_as_uint;
-  __half* old_as_half = (__half*) &old;
   unsigned int assumed;
-  unsigned int updated;
-  __half* updated_as_half = (__half*) &updated;
+  T old_val;
   do {
     assumed = old;
-    updated = old;
-    *updated_as_half += val;
+    unsigned short bits = (assumed >> shift) & 0xffff;
+    old_val = *reinterpret_cast<T*>(&bits);
+    T updated_val = T(float(old_val) + float(val));
+    bits = *reinterpret_cast<unsigned short*>(&updated_val);
+    const unsigned int updated =
+        (assumed & ~(0xffffu << shift)) | (unsigned int(bits) << shift);
     old = atomicCAS(address_as_uint, assumed, updated);
   } while (assumed != old);
-  return *old_as_half;
+  return old_val;
+}
+
+// Handle fp16
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ < 700 && __CUDA_ARCH__ >= 530
+#include <cuda_fp16.h>
+__device__ __forceinline__ __half atomic_add(__half* address, __half val)
+{
+  return atomic_add_16bit(address, val);
 }
 #endif // defined(__CUDA_ARCH__) && __CUDA_ARCH__ < 700 && __CUDA_ARCH__ >= 530
 
+// Handle bf16, which has native atomics only on sm_80 and later
+#if H2_HAS_GPU_LOW_PRECISION && defined(__CUDA_ARCH__) && __CUDA_ARCH__ < 800
+__device__ __forceinline__ __nv_bfloat16 atomic_add(__nv_bfloat16* address,
+                                                    __nv_bfloat16 val)
+{
+  return atomic_add_16bit(address, val);
+}
+#endif // H2_HAS_GPU_LOW_PRECISION && defined(__CUDA_ARCH__) && __CUDA_ARCH__ < 800
+
 #if defined(__CUDA_ARCH__) && __CUDA_ARCH__ < 600
 __device__ __forceinline__ double atomic_add(double* address, double val)
 {
@@ -84,6 +107,48 @@ __device__ __forceinline__ double atomic_add(double* address, double val)
 #endif // defined(__CUDA_ARCH__) && __CUDA_ARCH__ < 600
 #endif // __CUDACC__
 
+#if H2_HAS_GPU_LOW_PRECISION
+namespace distconv {
+
+// Vectors of the 16-bit floating-point types, which the runtime does
+// not provide with the layout and members of float2 and float4.
+struct alignas(4) halfx2 {
+  h2::gpu::Half x, y;
+};
+struct alignas(8) halfx4 {
+  h2::gpu::Half x, y, z, w;
+};
+struct alignas(4) bfloat16x2 {
+  h2::gpu::BFloat16 x, y;
+};
+struct alignas(8) bfloat16x4 {
+  h2::gpu::BFloat16 x, y, z, w;
+};
+
+__host__ __device__ inline halfx2 make_halfx2(h2::gpu::Half x,
+                                              h2::gpu::Half y) {
+  return {x, y};
+}
+__host__ __device__ inline halfx4 make_halfx4(h2::gpu::Half x,
+                                              h2::gpu::Half y,
+                                              h2::gpu::Half z,
+                                              h2::gpu::Half w) {
+  return {x, y, z, w};
+}
+__host__ __device__ inline bfloat16x2 make_bfloat16x2(h2::gpu::BFloat16 x,
+                                                      h2::gpu::BFloat16 y) {
+  return {x, y};
+}
+__host__ __device__ inline bfloat16x4 make_bfloat16x4(h2::gpu::BFloat16 x,
+                                                      h2::gpu::BFloat16 y,
+                                                      h2::gpu::BFloat16 z,
+                                                      h2::gpu::BFloat16 w) {
+  return {x, y, z, w};
+}
+
+} // namespace distconv
+#endif // H2_HAS_GPU_LOW_PRECISION
+
 namespace distconv {
 namespace util {
 
@@ -155,23 +220,42 @@ inline void profile_pop()
     }
 }
 
+#if H2_HAS_GPU_LOW_PRECISION
+#define LIST_OF_LOW_PRECISION_ELEMENT_TYPES             \
+  ELEMENT_TYPE_OP(h2::gpu::Half)                        \
+  ELEMENT_TYPE_OP(h2::gpu::BFloat16)
+#define LIST_OF_LOW_PRECISION_VECTOR2_TYPES             \
+  VECTOR_TYPE_OP(h2::gpu::Half, halfx2, 2)              \
+  VECTOR_TYPE_OP(h2::gpu::BFloat16, bfloat16x2, 2)
+#define LIST_OF_LOW_PRECISION_VECTOR4_TYPES             \
+  VECTOR_TYPE_OP(h2::gpu::Half, halfx4, 4)              \
+  VECTOR_TYPE_OP(h2::gpu::BFloat16, bfloat16x4, 4)
+#else
+#define LIST_OF_LOW_PRECISION_ELEMENT_TYPES
+#define LIST_OF_LOW_PRECISION_VECTOR2_TYPES
+#define LIST_OF_LOW_PRECISION_VECTOR4_TYPES
+#endif // H2_HAS_GPU_LOW_PRECISION
+
 #define LIST_OF_ELEMENT_TYPES                   \
   ELEMENT_TYPE_OP(int)                          \
   ELEMENT_TYPE_OP(long)                         \
   ELEMENT_TYPE_OP(float)                        \
-  ELEMENT_TYPE_OP(double)
+  ELEMENT_TYPE_OP(double)                       \
+  LIST_OF_LOW_PRECISION_ELEMENT_TYPES
 
 #define LIST_OF_VECTOR2_TYPES                   \
   VECTOR_TYPE_OP(int, int2, 2)                  \
   VECTOR_TYPE_OP(long, long2, 2)                \
   VECTOR_TYPE_OP(float, float2, 2)              \
-  VECTOR_TYPE_OP(double, double2, 2)
+  VECTOR_TYPE_OP(double, double2, 2)            \
+  LIST_OF_LOW_PRECISION_VECTOR2_TYPES
 
 #define LIST_OF_VECTOR4_TYPES                   \
   VECTOR_TYPE_OP(int, int4, 4)                  \
   VECTOR_TYPE_OP(long, long4, 4)                \
   VECTOR_TYPE_OP(float, float4, 4)              \
-  VECTOR_TYPE_OP(double, double4, 4)
+  VECTOR_TYPE_OP(double, double4, 4)            \
+  LIST_OF_LOW_PRECISION_VECTOR4_TYPES
 
 #define LIST_OF_VECTOR_TYPES                    \
   LIST_OF_VECTOR2_TYPES                         \
@@ -220,7 +304,14 @@ struct IsVectorType {
       std::is_same<NonConstT, int4>::value ||
       std::is_same<NonConstT, long4>::value ||
       std::is_same<NonConstT, float4>::value ||
-      std::is_same<NonConstT, double4>::value;
+      std::is_same<NonConstT, double4>::value
+#if H2_HAS_GPU_LOW_PRECISION
+      || std::is_same<NonConstT, halfx2>::value ||
+      std::is_same<NonConstT, halfx4>::value ||
+      std::is_same<NonConstT, bfloat16x2>::value ||
+      std::is_same<NonConstT, bfloat16x4>::value
+#endif // H2_HAS_GPU_LOW_PRECISION
+      ;
 };
 
 template <typename T>
@@ -238,6 +329,32 @@ LIST_OF_VECTOR_TYPES
 
 #undef VECTOR_TYPE_OP
 
+// Type in which values of DataType, which may be a vector, are
+// accumulated. The 16-bit floating-point types are accumulated in
+// float.
+template <typename DataType>
+struct GetAccumulationType {
+  using type = DataType;
+};
+
+#if H2_HAS_GPU_LOW_PRECISION
+#define LOW_PRECISION_TYPE_OP(B, A)             \
+  template <>                                   \
+  struct GetAccumulationType<B> {               \
+    using type = A;                             \
+  };
+LOW_PRECISION_TYPE_OP(h2::gpu::Half, float)
+LOW_PRECISION_TYPE_OP(h2::gpu::BFloat16, float)
+LOW_PRECISION_TYPE_OP(halfx2, float2)
+LOW_PRECISION_TYPE_OP(halfx4, float4)
+LOW_PRECISION_TYPE_OP(bfloat16x2, float2)
+LOW_PRECISION_TYPE_OP(bfloat16x4, float4)
+#undef LOW_PRECISION_TYPE_OP
+#endif // H2_HAS_GPU_LOW_PRECISION
+
+template <typename DataType>
+using AccumulationType = typename GetAccumulationType<DataType>::type;
+
 #ifdef __NVCC__
 
 template<typename B, typename V>
@@ -358,6 +475,60 @@ LIST_OF_VECTOR2_TYPES
 LIST_OF_VECTOR4_TYPES
 #undef VECTOR_TYPE_OP
 
+// Conversions between values and their accumulation type
+template <typename T>
+__device__ __forceinline__ AccumulationType<T> to_accumulation(T x) {
+  return x;
+}
+template <typename T>
+__device__ __forceinline__ T from_accumulation(AccumulationType<T> x) {
+  return x;
+}
+
+#if H2_HAS_GPU_LOW_PRECISION
+#define LOW_PRECISION_TYPE_OP(B, TO_FLOAT, FROM_FLOAT)                  \
+  template <>                                                           \
+  __device__ __forceinline__ float to_accumulation<B>(B x) {            \
+    return TO_FLOAT(x);                                                 \
+  }                                                                     \
+  template <>                                                           \
+  __device__ __forceinline__ B from_accumulation<B>(float x) {          \
+    return FROM_FLOAT(x);                                               \
+  }
+LOW_PRECISION_TYPE_OP(h2::gpu::Half, __half2float, __float2half)
+LOW_PRECISION_TYPE_OP(h2::gpu::BFloat16, __bfloat162float, __float2bfloat16)
+#undef LOW_PRECISION_TYPE_OP
+
+#define VECTOR_TYPE_OP(B, V, W)                                         \
+  template <>                                                           \
+  __device__ __forceinline__ float2 to_accumulation<V>(V x) {           \
+    return make_float2(to_accumulation(x.x), to_accumulation(x.y));     \
+  }                                                                     \
+  template <>                                                           \
+  __device__ __forceinline__ V from_accumulation<V>(float2 x) {         \
+    return make_vector<B, V>(from_accumulation<B>(x.x),                 \
+                             from_accumulation<B>(x.y));                \
+  }
+LIST_OF_LOW_PRECISION_VECTOR2_TYPES
+#undef VECTOR_TYPE_OP
+
+#define VECTOR_TYPE_OP(B, V, W)                                         \
+  template <>                                                           \
+  __device__ __forceinline__ float4 to_accumulation<V>(V x) {           \
+    return make_float4(to_accumulation(x.x), to_accumulation(x.y),      \
+                       to_accumulation(x.z), to_accumulation(x.w));     \
+  }                                                                     \
+  template <>                                                           \
+  __device__ __forceinline__ V from_accumulation<V>(float4 x) {         \
+    return make_vector<B, V>(from_accumulation<B>(x.x),                 \
+                             from_accumulation<B>(x.y),                 \
+                             from_accumulation<B>(x.z),                 \
+                             from_accumulation<B>(x.w));                \
+  }
+LIST_OF_LOW_PRECISION_VECTOR4_TYPES
+#undef VECTOR_TYPE_OP
+#endif // H2_HAS_GPU_LOW_PRECISION
+
 #endif // __NVCC__
 
 } // namespace util
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <type_traits>
 #include <utility>
 #include <iostream>
 #include <sstream>
@@ -32,6 +33,7 @@ inline std::ostream &operator<<(std::ostream &os, cudnnDataType_t &dt) {
     case CUDNN_DATA_FLOAT: s = "float"; break;
     case CUDNN_DATA_DOUBLE: s = "double"; break;
     case CUDNN_DATA_HALF: s = "half"; break;
+    case CUDNN_DATA_BFLOAT16: s = "bfloat16"; break;
     default: s = "UNKNOWN"; break;
   }
   return os << s;
@@ -353,12 +355,35 @@ inline cudnnDataType_t get_cudnn_type<const half>() {
   return CUDNN_DATA_HALF;
 }
 
+#if H2_HAS_GPU_LOW_PRECISION
+template <>
+inline cudnnDataType_t get_cudnn_type<__nv_bfloat16>() {
+  return CUDNN_DATA_BFLOAT16;
+}
+
+template <>
+inline cudnnDataType_t get_cudnn_type<const __nv_bfloat16>() {
+  return CUDNN_DATA_BFLOAT16;
+}
+#endif // H2_HAS_GPU_LOW_PRECISION
+
 template <typename T>
 inline cudnnDataType_t get_dnnlib_type()
 {
     return get_cudnn_type<T>();
 }
 
+// Type in which convolutions of T are computed. 16-bit convolutions
+// accumulate in float, which is also required for tensor cores.
+template <typename T>
+inline cudnnDataType_t get_dnnlib_compute_type()
+{
+    if constexpr (h2::IsLowPrecisionFloat_v<std::remove_const_t<T>>)
+        return CUDNN_DATA_FLOAT;
+    else
+        return get_cudnn_type<T>();
+}
+
 inline std::string get_cudnn_version_number_string() {
   int version[3];
   cudnnGetProperty(MAJOR_VERSION, &version[0]);
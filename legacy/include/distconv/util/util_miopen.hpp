@@ -12,6 +12,8 @@
 
 #include <miopen/miopen.h>
 
+#include "h2/core/low_precision.hpp"
+
 namespace distconv
 {
 namespace util
@@ -86,12 +88,19 @@ struct miopenTypeTraits<double>
     static constexpr auto value = miopenDouble;
 };
 
-// FIXME (trb 07/25/2022): FP16 support.
-// template <>
-// struct miopenTypeTraits<__half>
-// {
-//     static constexpr value = miopenHalf;
-// };
+#if H2_HAS_GPU_LOW_PRECISION
+template <>
+struct miopenTypeTraits<h2::gpu::Half>
+{
+    static constexpr auto value = miopenHalf;
+};
+
+template <>
+struct miopenTypeTraits<h2::gpu::BFloat16>
+{
+    static constexpr auto value = miopenBFloat16;
+};
+#endif // H2_HAS_GPU_LOW_PRECISION
 
 template <typename T>
 inline constexpr miopenDataType_t get_miopen_type()
@@ -108,6 +117,14 @@ inline constexpr miopenDataType_t get_dnnlib_type()
     return get_miopen_type<T>();
 }
 
+// MIOpen ignores the type of convolution descriptors, so this is only
+// for symmetry with cuDNN.
+template <typename T>
+inline constexpr miopenDataType_t get_dnnlib_compute_type()
+{
+    return get_miopen_type<T>();
+}
+
 /** @brief Get the loaded MIOpen version.
  *  @details This is a dynamic check that queries the library at runtime.
  */
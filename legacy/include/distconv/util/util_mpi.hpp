@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <ostream>
+#include <string>
+#include <vector>
 
 #include "distconv/util/util.hpp"
 
@@ -88,6 +90,29 @@ inline int get_mpi_comm_local_size(MPI_Comm comm) {
   return local_comm_size;
 }
 
+// Gathers the strings of all ranks of comm.
+inline std::vector<std::string> allgather_strings(const std::string &str,
+                                                  MPI_Comm comm) {
+  int num_ranks;
+  DISTCONV_CHECK_MPI(MPI_Comm_size(comm, &num_ranks));
+  const int size = static_cast<int>(str.size());
+  std::vector<int> sizes(num_ranks);
+  DISTCONV_CHECK_MPI(
+      MPI_Allgather(&size, 1, MPI_INT, sizes.data(), 1, MPI_INT, comm));
+  std::vector<int> displs(num_ranks, 0);
+  for (int i = 1; i < num_ranks; ++i)
+    displs[i] = displs[i - 1] + sizes[i - 1];
+  std::string all(displs.back() + sizes.back(), '\0');
+  DISTCONV_CHECK_MPI(MPI_Allgatherv(str.data(), size, MPI_CHAR, &all[0],
+                                    sizes.data(), displs.data(), MPI_CHAR,
+                                    comm));
+  std::vector<std::string> strs;
+  strs.reserve(num_ranks);
+  for (int i = 0; i < num_ranks; ++i)
+    strs.push_back(all.substr(displs[i], sizes[i]));
+  return strs;
+}
+
 #ifdef DISTCONV_DEBUG
 class MPIPrintStreamDebug: public PrintStreamDebug {
  public:
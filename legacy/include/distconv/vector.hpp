@@ -3,27 +3,84 @@
 #include "distconv/base.hpp"
 #include "distconv/util/util.hpp"
 
-#include <vector>
-#include <initializer_list>
+#include <algorithm>
 #include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <vector>
 
 namespace distconv {
 
+/**
+   A vector of shapes, indices, and similar per-dimension metadata.
+
+   Elements are stored inline up to inline_capacity, which covers
+   tensors of any supported rank, so temporaries from shape arithmetic
+   do not allocate. Longer vectors (e.g., per-rank offsets) move to the
+   heap.
+ */
 template <typename DataType>
 class Vector {
+ public:
+  /**
+     Number of elements stored without allocating. This matches the
+     maximum tensor rank of h2 (h2::MAX_TENSOR_DIMS).
+   */
+  static constexpr int inline_capacity = 8;
+
  private:
-  using container_type = std::vector<DataType>;
-  container_type m_data;
+  static_assert(std::is_trivially_copyable<DataType>::value,
+                "Vector elements must be trivially copyable");
+
+  DataType m_inline[inline_capacity];
+  // Storage when the vector outgrows m_inline, or null.
+  std::unique_ptr<DataType[]> m_heap;
+  int m_length = 0;
+  int m_capacity = inline_capacity;
+
+  DataType *storage() {
+    return m_heap ? m_heap.get() : m_inline;
+  }
+
+  const DataType *storage() const {
+    return m_heap ? m_heap.get() : m_inline;
+  }
+
+  // Ensures there is room for at least capacity elements.
+  void reserve(int capacity) {
+    if (capacity <= m_capacity) return;
+    const int new_capacity = std::max(capacity, m_capacity * 2);
+    std::unique_ptr<DataType[]> heap(new DataType[new_capacity]);
+    std::copy(storage(), storage() + m_length, heap.get());
+    m_heap = std::move(heap);
+    m_capacity = new_capacity;
+  }
+
+  void assign(const DataType *first, int length) {
+    if (length > inline_capacity) {
+      if (length > m_capacity || !m_heap) {
+        m_heap.reset(new DataType[length]);
+        m_capacity = length;
+      }
+    } else {
+      m_heap.reset();
+      m_capacity = inline_capacity;
+    }
+    std::copy(first, first + length, storage());
+    m_length = length;
+  }
 
  public:
   using data_type = DataType;
   using value_type = data_type; // for compatibility with std::vector
-  using iterator = typename container_type::iterator;
-  using const_iterator = typename container_type::const_iterator;
-  using reverse_iterator = typename container_type::reverse_iterator;
-  using const_reverse_iterator = typename container_type::const_reverse_iterator;
-  using reference = typename container_type::reference;
-  using const_reference = typename container_type::const_reference;
+  using iterator = DataType *;
+  using const_iterator = const DataType *;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using reference = DataType &;
+  using const_reference = const DataType &;
 
   /**
      Constructs an empty vector.
@@ -36,7 +93,7 @@ class Vector {
      @param dim The vector dimension.
    */
   explicit Vector(int dim):
-      m_data(dim) {}
+      Vector(dim, DataType()) {}
 
   /**
      Constructs a vector of a given dimension with all elements
@@ -45,8 +102,30 @@ class Vector {
      @param dim The vector dimension.
      @param x The initial value of all elements.
    */
-  explicit Vector(int dim, const DataType &x):
-      m_data(dim, x) {}
+  explicit Vector(int dim, const DataType &x) {
+    assert_always(dim >= 0);
+    reserve(dim);
+    std::fill(storage(), storage() + dim, x);
+    m_length = dim;
+  }
+
+  /**
+     Copy constructor.
+
+     @param v A vector to copy.
+   */
+  Vector(const Vector &v) {
+    assign(v.storage(), v.m_length);
+  }
+
+  /**
+     Move constructor. v is left empty.
+
+     @param v A vector to move from.
+   */
+  Vector(Vector &&v) noexcept {
+    *this = std::move(v);
+  }
 
   /**
      Constructs a vector by copying another vector of possibly
@@ -58,8 +137,9 @@ class Vector {
    */
   template <typename T>
   Vector(const Vector<T> &v) {
+    reserve(v.length());
     for (const auto &x: v) {
-      m_data.push_back(x);
+      push_back(x);
     }
   }
 
@@ -72,8 +152,9 @@ class Vector {
    */
   template <typename T>
   explicit Vector(const std::vector<T> &v) {
+    reserve(static_cast<int>(v.size()));
     for (const auto &x: v) {
-      m_data.push_back(x);
+      push_back(x);
     }
   }
 
@@ -86,20 +167,29 @@ class Vector {
    */
   template <typename T>
   explicit Vector(std::initializer_list<T> l) {
+    reserve(static_cast<int>(l.size()));
     for (const auto &x: l) {
-      m_data.push_back(x);
+      push_back(x);
     }
   }
 
   /**
-     Constructs a vector by copying the contents of a range.
+     Constructs a vector by copying the contents of a range. As with
+     std::vector, two integers are taken as a dimension and a value.
 
      @param first An iterator to the beginning of a range.
      @param last An iterator to the end of a range.
    */
   template <typename InputIt>
-  explicit Vector(InputIt first, InputIt last):
-      m_data(first, last) {}
+  explicit Vector(InputIt first, InputIt last) {
+    if constexpr (std::is_integral<InputIt>::value) {
+      *this = Vector(static_cast<int>(first), static_cast<DataType>(last));
+    } else {
+      for (; first != last; ++first) {
+        push_back(*first);
+      }
+    }
+  }
 
   virtual ~Vector() = default;
 
@@ -116,7 +206,7 @@ class Vector {
     assert_always(idx >= 0);
     assert_always(length() > 0);
     assert_always(idx < length());
-    return m_data.at(idx);
+    return storage()[idx];
   }
 
   /**
@@ -132,7 +222,7 @@ class Vector {
     assert_always(idx >= 0);
     assert_always(length() > 0);
     assert_always(idx < length());
-    return m_data.at(idx);
+    return storage()[idx];
   }
 
   /**
@@ -141,8 +231,32 @@ class Vector {
      @param x A vector to copy.
      @return *this.
    */
-  Vector operator=(const Vector &v) {
-    m_data = v.m_data;
+  Vector &operator=(const Vector &v) {
+    if (this != &v) {
+      assign(v.storage(), v.m_length);
+    }
+    return *this;
+  }
+
+  /**
+     Moves another vector to this vector. v is left empty.
+
+     @param x A vector to move from.
+     @return *this.
+   */
+  Vector &operator=(Vector &&v) noexcept {
+    if (this == &v) return *this;
+    if (v.m_heap) {
+      m_heap = std::move(v.m_heap);
+      m_capacity = v.m_capacity;
+    } else {
+      m_heap.reset();
+      m_capacity = inline_capacity;
+      std::copy(v.m_inline, v.m_inline + v.m_length, m_inline);
+    }
+    m_length = v.m_length;
+    v.m_length = 0;
+    v.m_capacity = inline_capacity;
     return *this;
   }
 
@@ -152,10 +266,8 @@ class Vector {
      @param x A scalar value to assign.
      @return *this.
    */
-  Vector operator=(const DataType &x) {
-    for (auto &i: m_data) {
-      i = x;
-    }
+  Vector &operator=(const DataType &x) {
+    std::fill(begin(), end(), x);
     return *this;
   }
 
@@ -165,7 +277,14 @@ class Vector {
      @param x Value to append.
    */
   void push_back(const DataType &x) {
-    m_data.push_back(x);
+    if (m_length == m_capacity) {
+      // x may be an element of this vector.
+      const DataType y = x;
+      reserve(m_length + 1);
+      storage()[m_length++] = y;
+    } else {
+      storage()[m_length++] = x;
+    }
   }
 
   /**
@@ -179,7 +298,7 @@ class Vector {
      @return The dimension of the vector.
    */
   int length() const {
-    return m_data.size();
+    return m_length;
   }
 
   /**
@@ -204,21 +323,19 @@ class Vector {
      @return A pointer to the underlying element storage.
    */
   DataType *data() {
-    return m_data.data();
+    return storage();
   }
 
   /**
      @return A pointer to the underlying element storage.
    */
   const DataType *data() const {
-    return m_data.data();
+    return storage();
   }
 
   template <typename T>
   std::vector<T> get_vector() const {
-    std::vector<T> v;
-    std::copy(begin(), end(), std::back_inserter(v));
-    return v;
+    return std::vector<T>(begin(), end());
   }
 
   /**
@@ -478,8 +595,12 @@ class Vector {
      @param v A vector to add.
      @return *this.
    */
-  Vector operator+=(const Vector &v) {
-    return (*this) = map(std::plus<DataType>(), v);
+  Vector &operator+=(const Vector &v) {
+    assert_eq(length(), v.length());
+    for (int i = 0; i < length(); ++i) {
+      storage()[i] += v.storage()[i];
+    }
+    return *this;
   }
 
   /**
@@ -526,91 +647,91 @@ class Vector {
      @return An iterator to the first element.
    */
   iterator begin() {
-    return m_data.begin();
+    return storage();
   }
 
   /**
      @return An iterator to the end of the vector.
    */
   iterator end() {
-    return m_data.end();
+    return storage() + m_length;
   }
 
   /**
      @return A const iterator to the first element.
    */
   const_iterator begin() const {
-    return m_data.begin();
+    return storage();
   }
 
   /**
      @return A const iterator to the end of the vector.
    */
   const_iterator end() const {
-    return m_data.end();
+    return storage() + m_length;
   }
 
   /**
      @return A reverse iterator to the first element.
    */
   reverse_iterator rbegin() {
-    return m_data.rbegin();
+    return reverse_iterator(end());
   }
 
   /**
      @return A reverse iterator to the end of the vector.
    */
   reverse_iterator rend() {
-    return m_data.rend();
+    return reverse_iterator(begin());
   }
 
   /**
      @return A reverse const iterator to the first element.
    */
   const_reverse_iterator rbegin() const {
-    return m_data.rbegin();
+    return const_reverse_iterator(end());
   }
 
   /**
      @return A reverse const iterator to the end of the vector.
    */
   const_reverse_iterator rend() const {
-    return m_data.rend();
+    return const_reverse_iterator(begin());
   }
 
   /**
      @return A reference to the first element.
    */
   reference front() {
-    return m_data.front();
+    return storage()[0];
   }
 
   /**
      @return A const reference to the first element.
   */
   const_reference front() const {
-    return m_data.front();
+    return storage()[0];
   }
 
   /**
      @return A reference to the last element.
   */
   reference back() {
-    return m_data.back();
+    return storage()[m_length - 1];
   }
 
   /**
      @return A const reference to the last element.
   */
   const_reference back() const {
-    return m_data.back();
+    return storage()[m_length - 1];
   }
 
   /**
      @return A string representation of the vector contents.
    */
   std::string tostring() const {
-    return util::join_array(m_data, ", ");
+    return util::join_array(*this, ", ");
   }
 };
 
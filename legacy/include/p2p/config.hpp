@@ -5,6 +5,19 @@ namespace internal {
 
 struct Config {
   bool insert_nvtx_mark = false;
+  // Keep IPC mappings of peer allocations open after their last
+  // registration is closed, so re-registering buffers in the same
+  // allocations does not reopen them.
+  bool cache_ipc_mappings = true;
+  // Connect devices with MPI instead of IPC when the performance rank
+  // of their link is higher than this (e.g., across sockets, where
+  // IPC can be slower than staging through the host). No limit if
+  // negative. Set with P2P_IPC_MAX_PERF_RANK.
+  int ipc_max_perf_rank = -1;
+  // Use IPC between devices without peer access, in which case the
+  // driver stages copies through the host, instead of MPI. Set with
+  // P2P_STAGED_IPC.
+  bool use_staged_ipc = true;
 };
 
 extern Config cfg;
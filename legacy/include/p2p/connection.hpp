@@ -2,13 +2,27 @@
 
 #include "p2p/mpi.hpp"
 #include "p2p/request.hpp"
-#include "p2p/util_cuda.hpp"
+#include "p2p/util_gpu.hpp"
 
 #include <map>
-#include <cuda_runtime.h>
+#include <vector>
 
 namespace p2p {
 
+// One buffer of a batched put
+struct PutDesc {
+  const void *src;
+  void *dst;
+  size_t size;
+};
+
+// One buffer of a batched transfer
+struct TransferDesc {
+  void *local_buf;
+  void *peer_buf;
+  size_t size;
+};
+
 class Connection {
   friend class Request;
  public:
@@ -22,23 +36,32 @@ class Connection {
   virtual Request register_addr_nb(void *self, void *peer) = 0;
   virtual int deregister_addr(void *mapped_addr);
   virtual int send(const void *buf, size_t size,
-                   cudaStream_t stream) = 0;
+                   DeviceStream stream) = 0;
   virtual int recv(void *buf, size_t size,
-                   cudaStream_t stream) = 0;
+                   DeviceStream stream) = 0;
   virtual int sendrecv(const void *send_buf, size_t send_size,
                        void *recv_buf, size_t recv_size,
-                       cudaStream_t stream) = 0;
+                       DeviceStream stream) = 0;
 
   virtual int put(const void *src, void *dst, size_t size,
-                  cudaStream_t stream) = 0;
+                  DeviceStream stream) = 0;
 
   virtual int transfer(void *local_buf, void *peer_buf, size_t size,
-                       cudaStream_t stream, bool is_src) = 0;
+                       DeviceStream stream, bool is_src) = 0;
+
+  // Batched versions of put and transfer, which connections that can
+  // copy directly to the peer do in a single kernel launch. The
+  // defaults issue the buffers one by one.
+  virtual int put_batch(const PutDesc *puts, int num_puts,
+                        DeviceStream stream);
+  virtual int transfer_batch(const TransferDesc *transfers,
+                             int num_transfers, DeviceStream stream,
+                             bool is_src);
 
-  virtual int notify(cudaStream_t stream);
-  virtual int wait(cudaStream_t stream);
-  virtual Request notify_nb(cudaStream_t stream) = 0;
-  virtual Request wait_nb(cudaStream_t stream) = 0;  
+  virtual int notify(DeviceStream stream);
+  virtual int wait(DeviceStream stream);
+  virtual Request notify_nb(DeviceStream stream) = 0;
+  virtual Request wait_nb(DeviceStream stream) = 0;  
   
   virtual int disconnect() = 0;
   virtual int close_remote_resources() { return 0; }
@@ -59,8 +82,12 @@ class Connection {
   
   virtual int connect_post();
   virtual int register_addr_post(void *data);
-  virtual int notify_post(cudaStream_t stream);
-  virtual int wait_post(cudaStream_t stream);
+  virtual int notify_post(DeviceStream stream);
+  virtual int wait_post(DeviceStream stream);
+  // Puts the local buffers of transfers to the peer buffers as a
+  // batch.
+  int put_transfers(const TransferDesc *transfers, int num_transfers,
+                    DeviceStream stream);
 
   void add_or_replace_mapped_peer_memory(const void *peer,
                                          void *mapped_addr);
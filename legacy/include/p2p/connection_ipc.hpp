@@ -2,6 +2,7 @@
 
 #include "p2p/connection.hpp"
 
+#include <cstdint>
 #include <map>
 #include <set>
 
@@ -25,44 +26,99 @@ class ConnectionIPC: public Connection {
   int deregister_addr(void *mapped_addr) override;
   
   int send(const void *src, size_t size,
-           cudaStream_t stream) override;
+           DeviceStream stream) override;
   int recv(void *dst, size_t size,
-           cudaStream_t stream) override;
+           DeviceStream stream) override;
   int sendrecv(const void *send_src, size_t send_size,
                void *recv_dst, size_t recv_size,
-               cudaStream_t stream) override;
+               DeviceStream stream) override;
 
   int put(const void *src, void *dst, size_t size,
-          cudaStream_t stream) override;
+          DeviceStream stream) override;
 
   int transfer(void *local_buf, void *peer_buf, size_t size,
-               cudaStream_t stream, bool is_src) override;
+               DeviceStream stream, bool is_src) override;
 
-  Request notify_nb(cudaStream_t stream) override;
-  Request wait_nb(cudaStream_t stream) override;
+  int put_batch(const PutDesc *puts, int num_puts,
+                DeviceStream stream) override;
+  int transfer_batch(const TransferDesc *transfers, int num_transfers,
+                     DeviceStream stream, bool is_src) override;
+
+  Request notify_nb(DeviceStream stream) override;
+  Request wait_nb(DeviceStream stream) override;
+
+  // Whether kernels can notify the peer, which needs notifications
+  // with stream memory operations.
+  bool supports_device_notification() const { return m_use_stream_mem_ops; }
+  // Takes the next notification for a kernel to deliver instead of
+  // notify: the kernel writes *value to *peer_flag (mapped from the
+  // peer) after its writes to the peer, and the peer waits as usual.
+  void get_device_notification(WaitValue **peer_flag, WaitValue *value);
   
   int disconnect() override;
   int close_remote_resources() override;
   
  private:
+  // Exchanged with the peer at connection
+  struct ConnectInfo {
+    IpcEventHandle ev_handle;
+    IpcMemHandle flag_handle;
+    int use_stream_mem_ops;
+  };
   int m_dev_peer;
-  cudaEvent_t m_ev;
-  cudaIpcEventHandle_t m_peer_ev_handle;
-  cudaEvent_t m_ev_peer;
+  DeviceEvent m_ev;
+  ConnectInfo m_self_info;
+  ConnectInfo m_peer_info;
+  DeviceEvent m_ev_peer;
   bool m_peer_event_opened;
   bool m_peer_enabled;
+  // Notification with stream memory operations: notify writes the
+  // number of notifications so far to the peer's flag, and wait
+  // blocks the stream until the local flag reaches the number of
+  // waits so far. Used when both sides support it.
+  bool m_use_stream_mem_ops;
+  WaitValue *m_flag;
+  WaitValue *m_peer_flag;
+  WaitValue m_notify_counter;
+  WaitValue m_wait_counter;
   std::set<void *> m_opened_local_mem;
   
   void enable_peer_access_if_possible();
   int register_peer_memory(const void *peer,
-                           cudaIpcMemHandle_t peer_handle);
+                           IpcMemHandle peer_handle);
 
 
-  using register_addr_data = std::pair<const void*, cudaIpcMemHandle_t>;
+  // Allocation a registered address is in
+  struct RegisterInfo {
+    IpcMemHandle handle;
+    std::uintptr_t base;
+    size_t size;
+    size_t offset;
+  };
+  struct RegisterData {
+    const void *peer;
+    RegisterInfo self_info;
+    RegisterInfo peer_info;
+  };
   int register_addr_post(void *data) override;
 
-  bool notify_handler(cudaStream_t stream, void *data, Request *req);
-  bool wait_handler(cudaStream_t stream, void *data, Request *req);
+  // Peer allocations opened in this process, keyed by their base
+  // address in the peer. Registrations of addresses in an opened
+  // allocation resolve to offsets into its mapping.
+  struct MappedBlock {
+    IpcMemHandle handle;
+    size_t size;
+    char *mapped_base;
+    int num_refs;
+  };
+  using MappedBlockMap = std::map<std::uintptr_t, MappedBlock>;
+  MappedBlockMap m_mapped_blocks;
+
+  MappedBlockMap::iterator find_peer_block(const void *mapped_addr);
+  void close_peer_block(MappedBlockMap::iterator block);
+
+  bool notify_handler(DeviceStream stream, void *data, Request *req);
+  bool wait_handler(DeviceStream stream, void *data, Request *req);
 };
 
 } // namespace p2p
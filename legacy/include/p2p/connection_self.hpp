@@ -12,28 +12,33 @@ class ConnectionSelf: public Connection {
   ~ConnectionSelf() override;
 
   int send(const void *src, size_t size,
-           cudaStream_t stream) override;
+           DeviceStream stream) override;
   int recv(void *dst, size_t size,
-           cudaStream_t stream) override;
+           DeviceStream stream) override;
   int sendrecv(const void *send_src, size_t send_size,
                void *recv_dst, size_t recv_size,
-               cudaStream_t stream) override;
+               DeviceStream stream) override;
 
   int put(const void *src, void *dst, size_t size,
-          cudaStream_t stream) override;
+          DeviceStream stream) override;
 
   int transfer(void *local_buf, void *peer_buf, size_t size,
-               cudaStream_t stream, bool is_src) override;
+               DeviceStream stream, bool is_src) override;
+
+  int put_batch(const PutDesc *puts, int num_puts,
+                DeviceStream stream) override;
+  int transfer_batch(const TransferDesc *transfers, int num_transfers,
+                     DeviceStream stream, bool is_src) override;
 
   Request connect_nb() override;
   Request register_addr_nb(void *self, void *peer) override;  
-  Request notify_nb(cudaStream_t stream) override;
-  Request wait_nb(cudaStream_t stream) override;
+  Request notify_nb(DeviceStream stream) override;
+  Request wait_nb(DeviceStream stream) override;
   
   int disconnect() override;
   
  private:
-  std::list<std::pair<cudaEvent_t, cudaStream_t>> m_notifications;
+  std::list<std::pair<DeviceEvent, DeviceStream>> m_notifications;
 };
 
 } // namespace p2p
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "p2p/connection.hpp"
+#include "p2p/util_gpu.hpp"
+
+namespace p2p {
+namespace internal {
+
+// Copies the buffers of puts on stream with one kernel launch per
+// COPY_BATCH_MAX_COPIES buffers. All of the buffers must be
+// accessible from the current device.
+constexpr int COPY_BATCH_MAX_COPIES = 32;
+void copy_batch(const PutDesc *puts, int num_puts, DeviceStream stream);
+
+} // namespace internal
+} // namespace p2p
@@ -1,21 +1,35 @@
 #pragma once
 
 #include "p2p/config.hpp"
+#include "distconv_config.hpp"
+
+#if H2_HAS_CUDA
 #include "nvToolsExt.h"
+#elif H2_HAS_ROCM
+#include <roctracer/roctx.h>
+#endif
 
 namespace p2p {
 namespace internal {
 
 inline void nvtx_start(const char *id) {
   if (cfg.insert_nvtx_mark) {
+#if H2_HAS_CUDA
     nvtxRangePushA(id);
+#elif H2_HAS_ROCM
+    roctxRangePushA(id);
+#endif
   }
   return;
 }
 
 inline void nvtx_end() {
   if (cfg.insert_nvtx_mark) {
+#if H2_HAS_CUDA
     nvtxRangePop();
+#elif H2_HAS_ROCM
+    roctxRangePop();
+#endif
   }
   return;
 }
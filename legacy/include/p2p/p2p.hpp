@@ -5,16 +5,28 @@
 #include "p2p/config.hpp"
 #include "p2p/mpi.hpp"
 #include "p2p/connection.hpp"
-#include "p2p/util_cuda.hpp"
+#include "p2p/util_gpu.hpp"
 
 #include <map>
 #include <vector>
 #include <string>
 #include <memory>
-#include <cuda_runtime.h>
+#include <ostream>
 
 namespace p2p {
 
+// How a connection reaches its peer
+enum class ConnectionPath {
+  NONE, // No connection
+  NULL_PEER, // Connection to MPI_PROC_NULL
+  SELF,
+  IPC, // Direct access to the peer device
+  IPC_STAGED, // IPC copies staged through the host by the driver
+  MPI // MPI through host buffers
+};
+
+std::ostream &operator<<(std::ostream &os, ConnectionPath path);
+
 class P2P {
  public:
   using connection_type = std::shared_ptr<Connection>;
@@ -33,10 +45,14 @@ class P2P {
   int disconnect_all();
   int disconnect(connection_type *conns, int num_conns);
 
+  // Returns the path of the connection to peer, or NONE if not
+  // connected.
+  ConnectionPath get_connection_path(int peer) const;
+
   int barrier(std::vector<connection_type> &connections,
-              std::vector<cudaStream_t> &streams);
+              std::vector<DeviceStream> &streams);
   int barrier(std::shared_ptr<Connection> *connections,
-              cudaStream_t *streams,
+              DeviceStream *streams,
               int num_conns);
 
   int exchange_addrs(std::vector<connection_type> &connections,
@@ -74,7 +90,7 @@ class P2P {
                void **peer_dst_bufs,
                size_t *local_sizes,
                size_t *peer_sizes,
-               cudaStream_t *streams,
+               DeviceStream *streams,
                int num_conns);
 
  private:
@@ -82,12 +98,16 @@ class P2P {
   int m_dev;
   internal::MPI m_mpi;
   std::map<int, std::shared_ptr<Connection>> m_conn_map;
+  std::map<int, ConnectionPath> m_path_map;
   bool m_stream_mem_enabled;
   char m_proc_name[MPI_MAX_PROCESSOR_NAME];
   util::EventPool m_event_pool;
   
   std::shared_ptr<Connection> connect(int peer, char *peer_name,
                                       int peer_dev);
+  ConnectionPath select_path(int peer, const char *peer_name,
+                             int peer_dev);
+  int get_perf_rank(int peer_dev);
   int init_driver_api();
 
   int get_peer_host_names(const int *peers,
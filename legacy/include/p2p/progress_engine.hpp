@@ -0,0 +1,92 @@
+#pragma once
+
+#include "mpi.h"
+#include "p2p/util_gpu.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace p2p {
+namespace internal {
+
+/*
+  A single per-process thread that progresses the MPI transfers of
+  all MPI-backed connections.
+
+  Connections submit tasks through a lock-free queue. Tasks with the
+  same key post their MPI requests in submission order, and all
+  posted requests are tested together with MPI_Testsome. The thread
+  sleeps while there is no work and is pinned to the core given by
+  P2P_PROGRESS_CORE when that is set.
+*/
+class ProgressEngine {
+ public:
+  class Task {
+    friend class ProgressEngine;
+   public:
+    explicit Task(const void *key): m_key(key) {}
+    virtual ~Task() = default;
+    // Whether the MPI requests of this task can be posted.
+    virtual bool ready() { return true; }
+    // Posts up to two MPI requests into reqs.
+    virtual void start(MPI_Request *reqs) = 0;
+    // Called after the requests complete until it returns true; the
+    // task is then deleted.
+    virtual bool finish() = 0;
+   private:
+    const void *m_key;
+    Task *m_next = nullptr;
+    MPI_Request m_reqs[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+  };
+
+  static ProgressEngine &get_instance();
+
+  // Starts the thread on the first attach for device dev; the last
+  // detach stops it after all submitted tasks finish.
+  void attach(int dev);
+  void detach();
+
+  // Takes ownership of task.
+  void submit(Task *task);
+
+  // Stream used by the engine thread for stream memory operations.
+  DeviceStream get_stream() const { return m_stream; }
+
+ private:
+  ProgressEngine() = default;
+  ~ProgressEngine();
+
+  std::atomic<Task*> m_submissions{nullptr};
+  std::atomic<bool> m_sleeping{false};
+  std::atomic<bool> m_stop{false};
+  std::mutex m_mtx;
+  std::condition_variable m_cv;
+  int m_num_attached = 0;
+  int m_dev = 0;
+  DeviceStream m_stream = nullptr;
+  std::thread m_thread;
+
+  // Accessed only by the engine thread.
+  std::unordered_map<const void*, std::deque<Task*>> m_waiting;
+  std::vector<Task*> m_active;
+  std::vector<Task*> m_finishing;
+  std::vector<MPI_Request> m_reqs;
+  std::vector<int> m_indices;
+
+  void run();
+  void pin_thread();
+  bool take_submissions();
+  bool start_tasks();
+  bool test_tasks();
+  bool finish_tasks();
+  bool idle() const;
+  void sleep();
+};
+
+} // namespace internal
+} // namespace p2p
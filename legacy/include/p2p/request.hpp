@@ -1,28 +1,17 @@
 #pragma once
 
 #include "p2p/mpi.hpp"
-
-#if H2_HAS_ROCM
-#include <hip/hip_runtime.h>
-#else
-#include <cuda_runtime.h>
-#endif
+#include "p2p/util_gpu.hpp"
 
 namespace p2p {
 
 class Connection;
 
 class Request {
-#if H2_HAS_ROCM
-    using DeviceStream = hipStream_t;
-#else
-    using DeviceStream = cudaStream_t;
-#endif
-
     constexpr static int MAX_MPI_REQUESTS = 2;
 
 public:
-    using handler_type = bool (Connection::*)(cudaStream_t, void*, Request*);
+    using handler_type = bool (Connection::*)(DeviceStream, void*, Request*);
 
     enum class Kind
     {
@@ -3,10 +3,7 @@
 #include "distconv_config.hpp"
 
 #include <iostream>
-#include <list>
-#include <vector>
-#include <map>
-#include <mutex>
+#include <cstdint>
 #include <cstdlib>
 #include <cuda.h>
 #include <cuda_runtime_api.h>
@@ -50,6 +47,159 @@
 #endif
 
 namespace p2p {
+
+using DeviceStream = cudaStream_t;
+using DeviceEvent = cudaEvent_t;
+using DeviceError = cudaError_t;
+using DriverError = CUresult;
+using IpcMemHandle = cudaIpcMemHandle_t;
+using IpcEventHandle = cudaIpcEventHandle_t;
+// Value type of stream memory operations
+using WaitValue = cuuint32_t;
+
+// Thin wrappers of the runtime and driver calls used by the library,
+// with the same names as in util_rocm.hpp.
+namespace gpu {
+
+inline DeviceError get_device(int *dev) { return cudaGetDevice(dev); }
+inline DeviceError set_device(int dev) { return cudaSetDevice(dev); }
+
+inline DeviceError can_access_peer(int *can, int dev, int peer) {
+  return cudaDeviceCanAccessPeer(can, dev, peer);
+}
+
+// Relative performance of the link between dev and peer, the lower
+// the faster (e.g., NVLink ranks below PCIe)
+inline DeviceError get_p2p_perf_rank(int *rank, int dev, int peer) {
+  return cudaDeviceGetP2PAttribute(rank, cudaDevP2PAttrPerformanceRank,
+                                   dev, peer);
+}
+
+inline bool is_compute_mode_default(int dev) {
+  cudaDeviceProp prop;
+  P2P_CHECK_CUDA_ALWAYS(cudaGetDeviceProperties(&prop, dev));
+  return prop.computeMode == cudaComputeModeDefault;
+}
+
+// Returns false if the access could not be enabled; enabling it
+// again is not an error.
+inline bool enable_peer_access(int peer) {
+  const cudaError_t e = cudaDeviceEnablePeerAccess(peer, 0);
+  // clear the error status
+  cudaGetLastError();
+  return e == cudaSuccess || e == cudaErrorPeerAccessAlreadyEnabled;
+}
+
+template <typename T>
+inline DeviceError malloc(T **p, size_t size) {
+  return cudaMalloc(reinterpret_cast<void**>(p), size);
+}
+inline DeviceError free(void *p) { return cudaFree(p); }
+inline DeviceError memset(void *p, int v, size_t size) {
+  return cudaMemset(p, v, size);
+}
+
+inline DeviceError malloc_host(void **p, size_t size) {
+  return cudaMallocHost(p, size);
+}
+// Pinned host memory mapped to the device, written by the host only
+template <typename T>
+inline DeviceError malloc_host_mapped(T **p, size_t size) {
+  return cudaHostAlloc(reinterpret_cast<void**>(p), size,
+                       cudaHostAllocMapped | cudaHostAllocWriteCombined);
+}
+inline DeviceError free_host(void *p) { return cudaFreeHost(p); }
+
+inline DeviceError mem_get_info(size_t *available, size_t *total) {
+  return cudaMemGetInfo(available, total);
+}
+
+// Copies between any of host and device memory
+inline DeviceError memcpy_async(void *dst, const void *src, size_t size,
+                                DeviceStream stream) {
+  return cudaMemcpyAsync(dst, src, size, cudaMemcpyDefault, stream);
+}
+inline DeviceError memcpy_peer_async(void *dst, int dst_dev,
+                                     const void *src, int src_dev,
+                                     size_t size, DeviceStream stream) {
+  return cudaMemcpyPeerAsync(dst, dst_dev, src, src_dev, size, stream);
+}
+
+inline DeviceError stream_create(DeviceStream *stream) {
+  return cudaStreamCreate(stream);
+}
+inline DeviceError stream_destroy(DeviceStream stream) {
+  return cudaStreamDestroy(stream);
+}
+inline DeviceError stream_wait_event(DeviceStream stream,
+                                     DeviceEvent ev) {
+  return cudaStreamWaitEvent(stream, ev, 0);
+}
+
+inline DeviceError event_create(DeviceEvent *ev) {
+  return cudaEventCreateWithFlags(ev, cudaEventDisableTiming);
+}
+inline DeviceError event_create_ipc(DeviceEvent *ev) {
+  return cudaEventCreateWithFlags(
+      ev, cudaEventInterprocess | cudaEventDisableTiming);
+}
+inline DeviceError event_destroy(DeviceEvent ev) {
+  return cudaEventDestroy(ev);
+}
+inline DeviceError event_record(DeviceEvent ev, DeviceStream stream) {
+  return cudaEventRecord(ev, stream);
+}
+inline DeviceError event_query(DeviceEvent ev) {
+  return cudaEventQuery(ev);
+}
+inline bool is_not_ready(DeviceError e) { return e == cudaErrorNotReady; }
+
+inline DeviceError ipc_get_event_handle(IpcEventHandle *handle,
+                                        DeviceEvent ev) {
+  return cudaIpcGetEventHandle(handle, ev);
+}
+inline DeviceError ipc_open_event_handle(DeviceEvent *ev,
+                                         IpcEventHandle handle) {
+  return cudaIpcOpenEventHandle(ev, handle);
+}
+inline DeviceError ipc_get_mem_handle(IpcMemHandle *handle, void *p) {
+  return cudaIpcGetMemHandle(handle, p);
+}
+inline DeviceError ipc_open_mem_handle(void **p, IpcMemHandle handle) {
+  return cudaIpcOpenMemHandle(p, handle, cudaIpcMemLazyEnablePeerAccess);
+}
+inline DeviceError ipc_close_mem_handle(void *p) {
+  return cudaIpcCloseMemHandle(p);
+}
+
+// Base address and size of the allocation p is in
+inline DriverError get_address_range(const void *p, std::uintptr_t *base,
+                                     size_t *size) {
+  CUdeviceptr b;
+  const CUresult r = cuMemGetAddressRange(
+      &b, size, reinterpret_cast<CUdeviceptr>(p));
+  *base = static_cast<std::uintptr_t>(b);
+  return r;
+}
+
+inline DriverError stream_write_value(DeviceStream stream, WaitValue *addr,
+                                      WaitValue v) {
+  return cuStreamWriteValue32(stream, reinterpret_cast<CUdeviceptr>(addr),
+                              v, CU_STREAM_WRITE_VALUE_DEFAULT);
+}
+inline DriverError stream_wait_value_eq(DeviceStream stream,
+                                        WaitValue *addr, WaitValue v) {
+  return cuStreamWaitValue32(stream, reinterpret_cast<CUdeviceptr>(addr),
+                             v, CU_STREAM_WAIT_VALUE_EQ);
+}
+inline DriverError stream_wait_value_geq(DeviceStream stream,
+                                         WaitValue *addr, WaitValue v) {
+  return cuStreamWaitValue32(stream, reinterpret_cast<CUdeviceptr>(addr),
+                             v, CU_STREAM_WAIT_VALUE_GEQ);
+}
+
+} // namespace gpu
+
 namespace util {
 
 inline bool is_stream_mem_enabled() {
@@ -70,47 +220,5 @@ inline bool is_stream_mem_enabled() {
   return attr;
 }
 
-class PinnedMemoryPool {
- public:
-  PinnedMemoryPool();
-  ~PinnedMemoryPool();
-
-  void *get(size_t size);
-  void release(void *p);
-
- private:
-  int m_bin_growth;
-  int m_min_bin;
-  int m_max_bin;
-  std::vector<std::list<void*>> m_bins;
-  std::map<void *, size_t> m_mem_map;
-  std::mutex m_mutex;
-  void setup_bins();
-  int find_bin(size_t size);
-  void *get_from_bin(int bin_idx);
-  void deallocate_all_chunks();
-};
-
-class EventPool {
- public:
-  EventPool(int num_events=10, int expansion=10);
-  ~EventPool();
-
-  cudaEvent_t get();
-  void release(cudaEvent_t e);
-  void expand();
-
- private:
-  int m_expansion;
-  std::list<cudaEvent_t> m_events;
-  std::mutex m_mutex;
-
-  static void expand_list(std::list<cudaEvent_t> &list,
-                          int num_events);
-};
-
-size_t get_total_memory();
-size_t get_available_memory();
-
 } // namespace util
 } // namespace p2p
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "distconv_config.hpp"
+
+#if H2_HAS_CUDA
+
+#include "p2p/util_cuda.hpp"
+#define P2P_CHECK_GPU_ALWAYS(...) P2P_CHECK_CUDA_ALWAYS(__VA_ARGS__)
+#define P2P_CHECK_GPU(...) P2P_CHECK_CUDA(__VA_ARGS__)
+#define P2P_CHECK_GPU_DRV_ALWAYS(...) P2P_CHECK_CUDA_DRV_ALWAYS(__VA_ARGS__)
+#define P2P_CHECK_GPU_DRV(...) P2P_CHECK_CUDA_DRV(__VA_ARGS__)
+
+#elif H2_HAS_ROCM
+
+#include "p2p/util_rocm.hpp"
+#define P2P_CHECK_GPU_ALWAYS(...) P2P_CHECK_HIP_ALWAYS(__VA_ARGS__)
+#define P2P_CHECK_GPU(...) P2P_CHECK_HIP(__VA_ARGS__)
+#define P2P_CHECK_GPU_DRV_ALWAYS(...) P2P_CHECK_HIP_ALWAYS(__VA_ARGS__)
+#define P2P_CHECK_GPU_DRV(...) P2P_CHECK_HIP(__VA_ARGS__)
+
+#endif
+
+#include <list>
+#include <vector>
+#include <map>
+#include <mutex>
+
+namespace p2p {
+namespace util {
+
+class PinnedMemoryPool {
+ public:
+  PinnedMemoryPool();
+  ~PinnedMemoryPool();
+
+  void *get(size_t size);
+  void release(void *p);
+
+ private:
+  int m_bin_growth;
+  int m_min_bin;
+  int m_max_bin;
+  std::vector<std::list<void*>> m_bins;
+  std::map<void *, size_t> m_mem_map;
+  std::mutex m_mutex;
+  void setup_bins();
+  int find_bin(size_t size);
+  void *get_from_bin(int bin_idx);
+  void deallocate_all_chunks();
+};
+
+class EventPool {
+ public:
+  EventPool(int num_events=10, int expansion=10);
+  ~EventPool();
+
+  DeviceEvent get();
+  void release(DeviceEvent e);
+  void expand();
+
+ private:
+  int m_expansion;
+  std::list<DeviceEvent> m_events;
+  std::mutex m_mutex;
+
+  static void expand_list(std::list<DeviceEvent> &list,
+                          int num_events);
+};
+
+size_t get_total_memory();
+size_t get_available_memory();
+
+} // namespace util
+} // namespace p2p
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "distconv_config.hpp"
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <hip/hip_runtime.h>
+
+
+#define P2P_CHECK_HIP_ALWAYS(hip_call)                                  \
+  do {                                                                  \
+    const hipError_t hip_status = hip_call;                             \
+    if (hip_status != hipSuccess) {                                     \
+      std::cerr << "HIP error: " << hipGetErrorString(hip_status) << "\n"; \
+      std::cerr << "Error at " << __FILE__ << ":" << __LINE__ << "\n";  \
+      static_cast<void>(hipDeviceReset());                              \
+      abort();                                                          \
+    }                                                                   \
+  } while (0)
+
+#ifdef P2P_DEBUG
+#define P2P_CHECK_HIP(hip_call) P2P_CHECK_HIP_ALWAYS(hip_call)
+#else
+#define P2P_CHECK_HIP(hip_call) hip_call
+#endif
+
+namespace p2p {
+
+using DeviceStream = hipStream_t;
+using DeviceEvent = hipEvent_t;
+using DeviceError = hipError_t;
+// HIP has no separate driver API
+using DriverError = hipError_t;
+using IpcMemHandle = hipIpcMemHandle_t;
+using IpcEventHandle = hipIpcEventHandle_t;
+// Value type of stream memory operations
+using WaitValue = uint32_t;
+
+// Thin wrappers of the runtime calls used by the library, with the
+// same names as in util_cuda.hpp.
+namespace gpu {
+
+inline DeviceError get_device(int *dev) { return hipGetDevice(dev); }
+inline DeviceError set_device(int dev) { return hipSetDevice(dev); }
+
+// Peers are accessible over XGMI or PCIe.
+inline DeviceError can_access_peer(int *can, int dev, int peer) {
+  return hipDeviceCanAccessPeer(can, dev, peer);
+}
+
+// Relative performance of the link between dev and peer, the lower
+// the faster (e.g., XGMI ranks below PCIe)
+inline DeviceError get_p2p_perf_rank(int *rank, int dev, int peer) {
+  return hipDeviceGetP2PAttribute(rank, hipDevP2PAttrPerformanceRank,
+                                  dev, peer);
+}
+
+inline bool is_compute_mode_default(int dev) {
+  hipDeviceProp_t prop;
+  P2P_CHECK_HIP_ALWAYS(hipGetDeviceProperties(&prop, dev));
+  return prop.computeMode == hipComputeModeDefault;
+}
+
+// Returns false if the access could not be enabled; enabling it
+// again is not an error.
+inline bool enable_peer_access(int peer) {
+  const hipError_t e = hipDeviceEnablePeerAccess(peer, 0);
+  // clear the error status
+  static_cast<void>(hipGetLastError());
+  return e == hipSuccess || e == hipErrorPeerAccessAlreadyEnabled;
+}
+
+template <typename T>
+inline DeviceError malloc(T **p, size_t size) {
+  return hipMalloc(reinterpret_cast<void**>(p), size);
+}
+inline DeviceError free(void *p) { return hipFree(p); }
+inline DeviceError memset(void *p, int v, size_t size) {
+  return hipMemset(p, v, size);
+}
+
+inline DeviceError malloc_host(void **p, size_t size) {
+  return hipHostMalloc(p, size, hipHostMallocDefault);
+}
+// Pinned host memory mapped to the device, written by the host only
+template <typename T>
+inline DeviceError malloc_host_mapped(T **p, size_t size) {
+  return hipHostMalloc(reinterpret_cast<void**>(p), size,
+                       hipHostMallocMapped | hipHostMallocWriteCombined);
+}
+inline DeviceError free_host(void *p) { return hipHostFree(p); }
+
+inline DeviceError mem_get_info(size_t *available, size_t *total) {
+  return hipMemGetInfo(available, total);
+}
+
+// Copies between any of host and device memory
+inline DeviceError memcpy_async(void *dst, const void *src, size_t size,
+                                DeviceStream stream) {
+  return hipMemcpyAsync(dst, src, size, hipMemcpyDefault, stream);
+}
+inline DeviceError memcpy_peer_async(void *dst, int dst_dev,
+                                     const void *src, int src_dev,
+                                     size_t size, DeviceStream stream) {
+  return hipMemcpyPeerAsync(dst, dst_dev, src, src_dev, size, stream);
+}
+
+inline DeviceError stream_create(DeviceStream *stream) {
+  return hipStreamCreate(stream);
+}
+inline DeviceError stream_destroy(DeviceStream stream) {
+  return hipStreamDestroy(stream);
+}
+inline DeviceError stream_wait_event(DeviceStream stream,
+                                     DeviceEvent ev) {
+  return hipStreamWaitEvent(stream, ev, 0);
+}
+
+inline DeviceError event_create(DeviceEvent *ev) {
+  return hipEventCreateWithFlags(ev, hipEventDisableTiming);
+}
+inline DeviceError event_create_ipc(DeviceEvent *ev) {
+  return hipEventCreateWithFlags(
+      ev, hipEventInterprocess | hipEventDisableTiming);
+}
+inline DeviceError event_destroy(DeviceEvent ev) {
+  return hipEventDestroy(ev);
+}
+inline DeviceError event_record(DeviceEvent ev, DeviceStream stream) {
+  return hipEventRecord(ev, stream);
+}
+inline DeviceError event_query(DeviceEvent ev) {
+  return hipEventQuery(ev);
+}
+inline bool is_not_ready(DeviceError e) { return e == hipErrorNotReady; }
+
+inline DeviceError ipc_get_event_handle(IpcEventHandle *handle,
+                                        DeviceEvent ev) {
+  return hipIpcGetEventHandle(handle, ev);
+}
+inline DeviceError ipc_open_event_handle(DeviceEvent *ev,
+                                         IpcEventHandle handle) {
+  return hipIpcOpenEventHandle(ev, handle);
+}
+inline DeviceError ipc_get_mem_handle(IpcMemHandle *handle, void *p) {
+  return hipIpcGetMemHandle(handle, p);
+}
+inline DeviceError ipc_open_mem_handle(void **p, IpcMemHandle handle) {
+  return hipIpcOpenMemHandle(p, handle, hipIpcMemLazyEnablePeerAccess);
+}
+inline DeviceError ipc_close_mem_handle(void *p) {
+  return hipIpcCloseMemHandle(p);
+}
+
+// Base address and size of the allocation p is in
+inline DriverError get_address_range(const void *p, std::uintptr_t *base,
+                                     size_t *size) {
+  hipDeviceptr_t b;
+  const hipError_t r = hipMemGetAddressRange(
+      &b, size, const_cast<void*>(p));
+  *base = reinterpret_cast<std::uintptr_t>(b);
+  return r;
+}
+
+inline DriverError stream_write_value(DeviceStream stream, WaitValue *addr,
+                                      WaitValue v) {
+  return hipStreamWriteValue32(stream, addr, v, 0);
+}
+inline DriverError stream_wait_value_eq(DeviceStream stream,
+                                        WaitValue *addr, WaitValue v) {
+  return hipStreamWaitValue32(stream, addr, v, hipStreamWaitValueEq);
+}
+inline DriverError stream_wait_value_geq(DeviceStream stream,
+                                         WaitValue *addr, WaitValue v) {
+  return hipStreamWaitValue32(stream, addr, v, hipStreamWaitValueGte);
+}
+
+} // namespace gpu
+
+namespace util {
+
+inline bool is_stream_mem_enabled() {
+  int dev;
+  P2P_CHECK_HIP_ALWAYS(hipGetDevice(&dev));
+  int attr;
+  P2P_CHECK_HIP_ALWAYS(
+      hipDeviceGetAttribute(&attr,
+                            hipDeviceAttributeCanUseStreamWaitValue,
+                            dev));
+  return attr;
+}
+
+} // namespace util
+} // namespace p2p
@@ -0,0 +1,190 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "distconv/dnn_backend/dnn_backend.hpp"
+#include "distconv/util/util_mpi.hpp"
+
+#include <fstream>   // std::ifstream, std::ofstream
+#include <iterator>  // std::istreambuf_iterator
+#include <map>       // std::map
+#include <sstream>   // std::istringstream
+#include <stdexcept> // std::logic_error
+#include <string>    // std::string, std::getline
+#include <vector>    // std::vector
+
+namespace distconv
+{
+namespace
+{
+
+// Calls f(key, algo) for each "<algo> <key>" line of results and
+// returns the number of results. Lines that are cut off (e.g., by
+// concurrent appends to a file) are skipped.
+template <typename F>
+int parse_results(std::string const& results, F&& f)
+{
+    std::istringstream lines(results);
+    std::string line;
+    int num_results = 0;
+    while (std::getline(lines, line))
+    {
+        auto const sep = line.find(' ');
+        if (sep == std::string::npos || sep == 0 || sep + 1 == line.size())
+            continue;
+        try
+        {
+            size_t len;
+            int const algo = std::stoi(line.substr(0, sep), &len);
+            if (len != sep)
+                continue;
+            f(line.substr(sep + 1), algo);
+            ++num_results;
+        }
+        catch (std::logic_error const&)
+        {
+            continue;
+        }
+    }
+    return num_results;
+}
+
+} // namespace
+
+AutotuneCache& AutotuneCache::instance()
+{
+    static AutotuneCache cache;
+    return cache;
+}
+
+void AutotuneCache::load(std::string const& path, MPI_Comm comm)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (path == m_path)
+        return;
+
+    int rank;
+    DISTCONV_CHECK_MPI(MPI_Comm_rank(comm, &rank));
+    std::string contents;
+    unsigned long long size = 0;
+    if (rank == 0)
+    {
+        std::ifstream in(path);
+        if (in)
+            contents.assign(std::istreambuf_iterator<char>(in),
+                            std::istreambuf_iterator<char>());
+        size = contents.size();
+    }
+    DISTCONV_CHECK_MPI(MPI_Bcast(&size, 1, MPI_UNSIGNED_LONG_LONG, 0, comm));
+    contents.resize(size);
+    if (size > 0)
+        DISTCONV_CHECK_MPI(
+            MPI_Bcast(&contents[0], static_cast<int>(size), MPI_CHAR, 0, comm));
+
+    int const num_loaded =
+        parse_results(contents, [&](std::string const& key, int algo) {
+            m_algos[key] = algo;
+        });
+    m_path = path;
+    util::MPIRootPrintStreamDebug() << "Loaded " << num_loaded
+                                    << " autotuning results from " << path;
+}
+
+bool AutotuneCache::find(std::string const& key, int& algo) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto const it = m_algos.find(key);
+    if (it == m_algos.end())
+        return false;
+    algo = it->second;
+    return true;
+}
+
+void AutotuneCache::insert(std::string const& key, int algo)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    insert_locked(key, algo, true);
+}
+
+void AutotuneCache::insert_locked(std::string const& key,
+                                  int algo,
+                                  bool persist)
+{
+    m_algos[key] = algo;
+    if (!persist || m_path.empty())
+        return;
+    // Write each line at once so that lines of ranks do not interleave.
+    std::ofstream out(m_path, std::ios::app);
+    std::string const line = std::to_string(algo) + " " + key + "\n";
+    out.write(line.data(), line.size());
+    if (!out)
+    {
+        util::MPIPrintStreamWarning()
+            << "Failed to write an autotuning result to " << m_path;
+    }
+}
+
+void AutotuneCache::tune_distributed(
+    std::vector<std::pair<std::string, Tuner>> const& problems,
+    MPI_Comm comm)
+{
+    // Keys are newline-separated, so they cannot contain newlines.
+    std::map<std::string, Tuner const*> missing;
+    for (auto const& p : problems)
+    {
+        int algo;
+        if (!find(p.first, algo))
+            missing.emplace(p.first, &p.second);
+    }
+    std::string keys;
+    for (auto const& m : missing)
+        keys += m.first + "\n";
+    auto const all_keys = util::allgather_strings(keys, comm);
+
+    // Every rank makes the same assignment: each problem goes to the
+    // least loaded of the ranks that have it, in the order of keys.
+    std::map<std::string, std::vector<int>> holders;
+    for (size_t r = 0; r < all_keys.size(); ++r)
+    {
+        std::istringstream lines(all_keys[r]);
+        std::string key;
+        while (std::getline(lines, key))
+            holders[key].push_back(static_cast<int>(r));
+    }
+    int rank;
+    DISTCONV_CHECK_MPI(MPI_Comm_rank(comm, &rank));
+    std::vector<int> loads(all_keys.size(), 0);
+    std::string results;
+    for (auto const& h : holders)
+    {
+        int owner = h.second.front();
+        for (int r : h.second)
+            if (loads[r] < loads[owner])
+                owner = r;
+        ++loads[owner];
+        if (owner == rank)
+        {
+            int const algo = (*missing.at(h.first))();
+            results += std::to_string(algo) + " " + h.first + "\n";
+        }
+    }
+    util::MPIPrintStreamDebug()
+        << "Tuned " << loads[rank] << " of " << holders.size()
+        << " convolution problems missing from the autotune cache";
+
+    auto const all_results = util::allgather_strings(results, comm);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t r = 0; r < all_results.size(); ++r)
+    {
+        // Each result is persisted by its owner only.
+        bool const persist = static_cast<int>(r) == rank;
+        parse_results(all_results[r], [&](std::string const& key, int algo) {
+            insert_locked(key, algo, persist);
+        });
+    }
+}
+
+} // namespace distconv
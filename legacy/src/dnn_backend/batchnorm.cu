@@ -4,6 +4,8 @@
 #include "distconv/tensor/algorithms_cuda.hpp"
 #include "distconv/util/util_gpu.hpp"
 #include "distconv/util/util_mpi.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/core/tracer.hpp"
 
 #include <type_traits>
 
@@ -29,6 +31,33 @@ using distconv::get_sample_dim;
 template <typename DataType>
 using Tensor = distconv::tensor::Tensor<DataType, LocaleMPI, CUDAAllocator>;
 
+namespace
+{
+
+// Bytes of the local elements of tensor, for tracing the kernels.
+template <typename TensorType>
+size_t get_local_bytes(const TensorType& tensor)
+{
+    return static_cast<size_t>(tensor.get_local_size())
+           * sizeof(typename TensorType::data_type);
+}
+
+// Bytes of the local elements of tensor in channels [channel_begin,
+// channel_end).
+template <typename TensorType>
+size_t get_local_bytes(const TensorType& tensor,
+                       int channel_begin,
+                       int channel_end)
+{
+    auto const num_channels = tensor.get_local_shape()[get_channel_dim()];
+    if (num_channels == 0)
+        return 0;
+    return get_local_bytes(tensor) / num_channels
+           * (channel_end - channel_begin);
+}
+
+} // namespace
+
 namespace distconv
 {
 namespace batchnorm
@@ -50,8 +79,9 @@ channel_sums_and_sqsums_kernel(const DataType* __restrict__ input,
     const int num_channels = shape[get_channel_dim()];
     const int num_samples = shape[get_sample_dim()];
 
-    DataType sum = DataType(0);
-    DataType sqsum = DataType(0);
+    using AccType = util::AccumulationType<DataType>;
+    AccType sum = AccType(0);
+    AccType sqsum = AccType(0);
 
     const index_t channel_size = shape.get_size() / num_channels / num_samples;
 
@@ -68,7 +98,7 @@ channel_sums_and_sqsums_kernel(const DataType* __restrict__ input,
         input_offset += ch_idx * input_strides[-2];
         for (int s = 0; s < num_samples; ++s)
         {
-            const DataType x = input[input_offset];
+            const AccType x = util::to_accumulation(input[input_offset]);
             sum += x;
             sqsum += x * x;
 
@@ -76,7 +106,7 @@ channel_sums_and_sqsums_kernel(const DataType* __restrict__ input,
         }
     }
 
-    using BlockReduce = cubns::BlockReduce<DataType, BLOCK_SIZE>;
+    using BlockReduce = cubns::BlockReduce<AccType, BLOCK_SIZE>;
     __shared__ typename BlockReduce::TempStorage temp_storage_sum;
     __shared__ typename BlockReduce::TempStorage temp_storage_sqsum;
     sum = BlockReduce(temp_storage_sum).Sum(sum);
@@ -84,8 +114,8 @@ channel_sums_and_sqsums_kernel(const DataType* __restrict__ input,
     // Output channel sum to global memory
     if (tid == 0)
     {
-        atomic_add(&sums[ch_idx], sum);
-        atomic_add(&sqsums[ch_idx], sqsum);
+        atomic_add(&sums[ch_idx], util::from_accumulation<DataType>(sum));
+        atomic_add(&sqsums[ch_idx], util::from_accumulation<DataType>(sqsum));
     }
 }
 
@@ -104,21 +134,22 @@ channel_sums_and_sqsums_opt_kernel(const DataTypeV* __restrict__ input,
     const int ch_idx = blockIdx.y;
     const auto sample_offset = spatial_real_size * num_channels;
 
-    auto sum = DataType(0);
-    auto sqsum = DataType(0);
+    using AccType = util::AccumulationType<DataType>;
+    auto sum = AccType(0);
+    auto sqsum = AccType(0);
     index_t offset = spatial_real_size * ch_idx;
     for (int s = 0; s < num_samples; ++s)
     {
         for (int i = idx; i < spatial_size; i += BLOCK_SIZE * gridDim.x)
         {
-            const auto x = input[offset + i];
+            const auto x = util::to_accumulation(input[offset + i]);
             sum += util::sum(x);
             sqsum += util::sum(x * x);
         }
         offset += sample_offset;
     }
 
-    using BlockReduce = cubns::BlockReduce<DataType, BLOCK_SIZE>;
+    using BlockReduce = cubns::BlockReduce<AccType, BLOCK_SIZE>;
     __shared__ typename BlockReduce::TempStorage temp_storage_sum;
     __shared__ typename BlockReduce::TempStorage temp_storage_sqsum;
     sum = BlockReduce(temp_storage_sum).Sum(sum);
@@ -126,8 +157,8 @@ channel_sums_and_sqsums_opt_kernel(const DataTypeV* __restrict__ input,
     // Output channel sum to global memory
     if (tid == 0)
     {
-        atomic_add(&sums[ch_idx], sum);
-        atomic_add(&sqsums[ch_idx], sqsum);
+        atomic_add(&sums[ch_idx], util::from_accumulation<DataType>(sum));
+        atomic_add(&sqsums[ch_idx], util::from_accumulation<DataType>(sqsum));
     }
 }
 
@@ -257,6 +288,14 @@ void channel_sums_and_sqsums(int num_dims,
                              Tensor& sqsums,
                              h2::gpu::DeviceStream stream)
 {
+    // Each element is added to the sum and squared and added to the
+    // sum of squares.
+    h2::ComputeStream const compute_stream(stream);
+    H2_TRACE_SCOPE_WITH_FLOPS("distconv::batchnorm::channel_sums_and_sqsums",
+                              Compute,
+                              compute_stream,
+                              get_local_bytes(input),
+                              3 * static_cast<size_t>(input.get_local_size()));
     switch (num_dims)
     {
     case 4:
@@ -280,6 +319,10 @@ void channel_sums_and_sqsums(int num_dims,
         h2::gpu::DeviceStream stream);
 INSTANTIATE_CHANNEL_SUMS_AND_SQSUMS(float)
 INSTANTIATE_CHANNEL_SUMS_AND_SQSUMS(double)
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_CHANNEL_SUMS_AND_SQSUMS(h2::gpu::Half)
+INSTANTIATE_CHANNEL_SUMS_AND_SQSUMS(h2::gpu::BFloat16)
+#endif // H2_HAS_GPU_LOW_PRECISION
 #undef INSTANTIATE_CHANNEL_SUMS_AND_SQSUMS
 
 namespace
@@ -288,10 +331,11 @@ namespace
 template <typename DataType>
 struct sums_to_statistics_functor
 {
+    using AccType = util::AccumulationType<DataType>;
     index_t m_num_per_sum;
-    DataType m_decay;
+    AccType m_decay;
     sums_to_statistics_functor(index_t num_per_sum, DataType decay)
-        : m_num_per_sum(num_per_sum), m_decay(decay)
+        : m_num_per_sum(num_per_sum), m_decay(static_cast<AccType>(decay))
     {}
 
     __device__ void operator()(DataType& global_mean,
@@ -299,16 +343,20 @@ struct sums_to_statistics_functor
                                DataType& running_mean,
                                DataType& running_var)
     {
-        const DataType mean = global_mean / m_num_per_sum;
-        const DataType sqmean = global_var / m_num_per_sum;
-        DataType var = sqmean - mean * mean;
-        var = var > DataType(0) ? var : DataType(0);
-        var *= m_num_per_sum / (m_num_per_sum - DataType(1));
-        global_mean = mean;
-        global_var = var;
-
-        running_mean = m_decay * running_mean + (DataType(1) - m_decay) * mean;
-        running_var = m_decay * running_var + (DataType(1) - m_decay) * var;
+        const AccType mean = util::to_accumulation(global_mean) / m_num_per_sum;
+        const AccType sqmean = util::to_accumulation(global_var) / m_num_per_sum;
+        AccType var = sqmean - mean * mean;
+        var = var > AccType(0) ? var : AccType(0);
+        var *= m_num_per_sum / (m_num_per_sum - AccType(1));
+        global_mean = util::from_accumulation<DataType>(mean);
+        global_var = util::from_accumulation<DataType>(var);
+
+        running_mean = util::from_accumulation<DataType>(
+            m_decay * util::to_accumulation(running_mean)
+            + (AccType(1) - m_decay) * mean);
+        running_var = util::from_accumulation<DataType>(
+            m_decay * util::to_accumulation(running_var)
+            + (AccType(1) - m_decay) * var);
     }
 };
 
@@ -340,7 +388,9 @@ void sums_to_statistics(index_t num_per_sum,
         // code.
         tensor::Transform(
             global_var,
-            [] __device__(DataType & global_var) { global_var = DataType(1); },
+            [] __device__(DataType & global_var) {
+                global_var = util::from_accumulation<DataType>(1);
+            },
             stream);
     }
 }
@@ -356,11 +406,542 @@ void sums_to_statistics(index_t num_per_sum,
         h2::gpu::DeviceStream stream);
 INSTANTIATE_SUMS_TO_STATISTICS(float)
 INSTANTIATE_SUMS_TO_STATISTICS(double)
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_SUMS_TO_STATISTICS(h2::gpu::Half)
+INSTANTIATE_SUMS_TO_STATISTICS(h2::gpu::BFloat16)
+#endif // H2_HAS_GPU_LOW_PRECISION
 #undef INSTANTIATE_SUMS_TO_STATISTICS
 
 namespace
 {
 
+// Running statistics of a set of values: their count, mean, and sum of
+// squared differences from the mean (M2).
+template <typename DataType>
+struct WelfordStats
+{
+    index_t count;
+    DataType mean;
+    DataType m2;
+};
+
+template <typename DataType>
+__device__ __forceinline__ WelfordStats<DataType>
+welford_merge(const WelfordStats<DataType>& a, const WelfordStats<DataType>& b)
+{
+    const index_t count = a.count + b.count;
+    if (count == 0)
+        return a;
+    const DataType delta = b.mean - a.mean;
+    const DataType ratio = DataType(b.count) / DataType(count);
+    return {count,
+            a.mean + delta * ratio,
+            a.m2 + b.m2 + delta * delta * DataType(a.count) * ratio};
+}
+
+struct WelfordMerge
+{
+    template <typename DataType>
+    __device__ __forceinline__ WelfordStats<DataType>
+    operator()(const WelfordStats<DataType>& a,
+               const WelfordStats<DataType>& b) const
+    {
+        return welford_merge(a, b);
+    }
+};
+
+// Adds a vector of values to the statistics by merging the statistics
+// of the vector, which costs one division per vector.
+template <typename DataType, typename DataTypeV>
+__device__ __forceinline__ void welford_update(WelfordStats<DataType>& stats,
+                                               const DataTypeV& x)
+{
+    constexpr int width = sizeof(DataTypeV) / sizeof(DataType);
+    const DataType mean = util::sum(x) / DataType(width);
+    const DataTypeV d = x - util::make_vector<DataType, DataTypeV>(mean);
+    stats = welford_merge(stats, {width, mean, util::sum(d * d)});
+}
+
+template <typename DataType>
+__device__ __forceinline__ void welford_update(WelfordStats<DataType>& stats,
+                                               const DataType& x)
+{
+    ++stats.count;
+    const DataType delta = x - stats.mean;
+    stats.mean += delta / DataType(stats.count);
+    stats.m2 += delta * (x - stats.mean);
+}
+
+template <int ND, typename DataType, int BLOCK_SIZE>
+__global__ void
+channel_welford_kernel(
+    const DataType* __restrict__ input,
+    WelfordStats<util::AccumulationType<DataType>>* __restrict__ partials,
+    tensor::Array<ND> shape,
+    tensor::Array<ND> input_strides,
+    const int channel_begin)
+{
+    const index_t gidx = threadIdx.x + blockIdx.x * blockDim.x;
+    const int ch_idx = channel_begin + blockIdx.y;
+    const int num_channels = shape[get_channel_dim()];
+    const int num_samples = shape[get_sample_dim()];
+
+    using AccType = util::AccumulationType<DataType>;
+    WelfordStats<AccType> stats = {0, AccType(0), AccType(0)};
+
+    const index_t channel_size = shape.get_size() / num_channels / num_samples;
+
+    if (gidx < channel_size)
+    {
+        index_t offset = gidx;
+        index_t input_offset = 0;
+        for (int d = 0; d < ND - 2; ++d)
+        {
+            int idx = offset % shape[d];
+            input_offset += idx * input_strides[d];
+            offset /= shape[d];
+        }
+        input_offset += ch_idx * input_strides[-2];
+        for (int s = 0; s < num_samples; ++s)
+        {
+            welford_update(stats, util::to_accumulation(input[input_offset]));
+            input_offset += input_strides[-1];
+        }
+    }
+
+    using BlockReduce = cubns::BlockReduce<WelfordStats<AccType>, BLOCK_SIZE>;
+    __shared__ typename BlockReduce::TempStorage temp_storage;
+    stats = BlockReduce(temp_storage).Reduce(stats, WelfordMerge());
+    if (threadIdx.x == 0)
+        partials[blockIdx.y * gridDim.x + blockIdx.x] = stats;
+}
+
+template <int ND, typename DataType, int BLOCK_SIZE, typename DataTypeV>
+__global__ void
+channel_welford_opt_kernel(
+    const DataTypeV* __restrict__ input,
+    WelfordStats<util::AccumulationType<DataType>>* __restrict__ partials,
+    const int num_channels,
+    const int num_samples,
+    const index_t spatial_size,
+    const index_t spatial_real_size,
+    const int channel_begin)
+{
+    const int idx = threadIdx.x + blockIdx.x * blockDim.x;
+    const int ch_idx = channel_begin + blockIdx.y;
+    const auto sample_offset = spatial_real_size * num_channels;
+
+    using AccType = util::AccumulationType<DataType>;
+    WelfordStats<AccType> stats = {0, AccType(0), AccType(0)};
+    index_t offset = spatial_real_size * ch_idx;
+    for (int s = 0; s < num_samples; ++s)
+    {
+        for (int i = idx; i < spatial_size; i += BLOCK_SIZE * gridDim.x)
+            welford_update(stats, util::to_accumulation(input[offset + i]));
+        offset += sample_offset;
+    }
+
+    using BlockReduce = cubns::BlockReduce<WelfordStats<AccType>, BLOCK_SIZE>;
+    __shared__ typename BlockReduce::TempStorage temp_storage;
+    stats = BlockReduce(temp_storage).Reduce(stats, WelfordMerge());
+    if (threadIdx.x == 0)
+        partials[blockIdx.y * gridDim.x + blockIdx.x] = stats;
+}
+
+// Merges the partial statistics of the blocks of each channel. One
+// block per channel, starting from channel_begin. The sums and M2s are
+// scaled by the number of elements per channel so that they stay in
+// the range of the 16-bit types.
+template <typename DataType, int BLOCK_SIZE>
+__global__ void channel_welford_merge_kernel(
+    const WelfordStats<util::AccumulationType<DataType>>* __restrict__ partials,
+    const int num_partials,
+    DataType* __restrict__ sums,
+    DataType* __restrict__ m2s,
+    DataType* __restrict__ local_means,
+    const int channel_begin,
+    const index_t num_per_sum)
+{
+    using AccType = util::AccumulationType<DataType>;
+    const int ch_idx = channel_begin + blockIdx.x;
+    WelfordStats<AccType> stats = {0, AccType(0), AccType(0)};
+    for (int i = threadIdx.x; i < num_partials; i += BLOCK_SIZE)
+        stats = welford_merge(stats, partials[blockIdx.x * num_partials + i]);
+
+    using BlockReduce = cubns::BlockReduce<WelfordStats<AccType>, BLOCK_SIZE>;
+    __shared__ typename BlockReduce::TempStorage temp_storage;
+    stats = BlockReduce(temp_storage).Reduce(stats, WelfordMerge());
+    if (threadIdx.x == 0)
+    {
+        sums[ch_idx] = util::from_accumulation<DataType>(
+            AccType(stats.count) / AccType(num_per_sum) * stats.mean);
+        m2s[ch_idx] = util::from_accumulation<DataType>(
+            stats.m2 / AccType(num_per_sum - 1));
+        if (local_means != nullptr)
+            local_means[ch_idx] = util::from_accumulation<DataType>(stats.mean);
+    }
+}
+
+template <int ND, typename Tensor>
+void channel_welford(int num_samples,
+                     index_t num_per_sum,
+                     const Tensor& input,
+                     Tensor& sums,
+                     Tensor& m2s,
+                     typename Tensor::data_type* local_means,
+                     int channel_begin,
+                     int channel_end,
+                     h2::gpu::DeviceStream stream)
+{
+    using DataType = typename Tensor::data_type;
+    using Stats = WelfordStats<util::AccumulationType<DataType>>;
+    const int num_group_channels = channel_end - channel_begin;
+    // Clear GPU memory
+    if (num_group_channels == (int) sums.get_local_size())
+    {
+        h2::gpu::mem_zero(
+            sums.get_buffer(), sums.get_local_pitched_size(), stream);
+        h2::gpu::mem_zero(
+            m2s.get_buffer(), m2s.get_local_pitched_size(), stream);
+    }
+    else
+    {
+        h2::gpu::mem_zero(
+            sums.get_base_ptr() + channel_begin, num_group_channels, stream);
+        h2::gpu::mem_zero(
+            m2s.get_base_ptr() + channel_begin, num_group_channels, stream);
+    }
+    if (local_means != nullptr)
+    {
+        h2::gpu::mem_zero(
+            local_means + channel_begin, num_group_channels, stream);
+    }
+
+    // Do not contribute to the accumulation if the local tensor is not
+    // a split root.
+    if (input.get_local_size() == 0 || !input.is_split_root()
+        || num_group_channels == 0)
+        return;
+
+    auto overlap = input.get_overlap();
+    bool opt_eligible = true;
+    for (int i = 0; i < ND - 3; ++i)
+    {
+        if (overlap[i] != 0)
+        {
+            opt_eligible = false;
+            break;
+        }
+    }
+    if (std::getenv("DISTCONV_DISABLE_BN_OPT"))
+    {
+        util::MPIRootPrintStreamInfo() << "Disable BN optimization";
+        opt_eligible = false;
+    }
+
+    const int num_channels = input.get_local_shape()[get_channel_dim()];
+    constexpr int block_size = 256;
+    dim3 block_dim(block_size);
+    // CUDA grid dimension limitation
+    assert_always(num_channels < 65535);
+    auto& mempool = internal::RuntimeGPU::get_device_memory_pool();
+    Stats* partials = nullptr;
+    dim3 grid_dim;
+
+    if (opt_eligible)
+    {
+        constexpr index_t thread_work_size = 8;
+        constexpr auto block_work_size = block_size * thread_work_size;
+        index_t spatial_size =
+            input.get_local_size() / num_channels / num_samples;
+        index_t spatial_real_size =
+            input.get_local_real_size() / num_channels / num_samples;
+        // halo size must be also divisible by a vector width for an
+        // alignment requirement
+        const bool vectorize =
+            spatial_size % 4 == 0
+            && ((spatial_real_size - spatial_size) / 2) % 4 == 0;
+        if (vectorize)
+        {
+            spatial_size /= 4;
+            spatial_real_size /= 4;
+        }
+        auto num_blocks_per_channel = util::ceil(spatial_size, block_work_size);
+        grid_dim = dim3(num_blocks_per_channel, num_group_channels);
+        partials = static_cast<Stats*>(mempool.get(
+            sizeof(Stats) * grid_dim.x * grid_dim.y, stream));
+        if (vectorize)
+        {
+            using DataTypeV = typename util::GetVectorType<DataType, 4>::type;
+            channel_welford_opt_kernel<ND, DataType, block_size, DataTypeV>
+                <<<grid_dim, block_dim, 0, stream>>>(
+                    reinterpret_cast<const DataTypeV*>(
+                        input.get_const_base_ptr()),
+                    partials,
+                    num_channels,
+                    num_samples,
+                    spatial_size,
+                    spatial_real_size,
+                    channel_begin);
+        }
+        else
+        {
+            channel_welford_opt_kernel<ND, DataType, block_size, DataType>
+                <<<grid_dim, block_dim, 0, stream>>>(input.get_const_base_ptr(),
+                                                     partials,
+                                                     num_channels,
+                                                     num_samples,
+                                                     spatial_size,
+                                                     spatial_real_size,
+                                                     channel_begin);
+        }
+    }
+    else
+    {
+        index_t channel_size =
+            input.get_local_size() / num_channels / num_samples;
+        grid_dim = dim3((channel_size + block_size - 1) / block_size,
+                        num_group_channels);
+        auto input_strides = input.get_strides();
+        auto shape = input.get_local_shape();
+        shape[get_sample_dim()] = num_samples;
+        partials = static_cast<Stats*>(mempool.get(
+            sizeof(Stats) * grid_dim.x * grid_dim.y, stream));
+        channel_welford_kernel<ND, DataType, block_size>
+            <<<grid_dim, block_dim, 0, stream>>>(input.get_const_base_ptr(),
+                                                 partials,
+                                                 shape,
+                                                 input_strides,
+                                                 channel_begin);
+    }
+
+    channel_welford_merge_kernel<DataType, block_size>
+        <<<num_group_channels, block_dim, 0, stream>>>(partials,
+                                                       grid_dim.x,
+                                                       sums.get_base_ptr(),
+                                                       m2s.get_base_ptr(),
+                                                       local_means,
+                                                       channel_begin,
+                                                       num_per_sum);
+    mempool.release(partials);
+}
+
+} // namespace
+
+template <typename Tensor>
+void channel_welford(int num_dims,
+                     int num_samples,
+                     index_t num_per_sum,
+                     const Tensor& input,
+                     Tensor& sums,
+                     Tensor& m2s,
+                     typename Tensor::data_type* local_means,
+                     int channel_begin,
+                     int channel_end,
+                     h2::gpu::DeviceStream stream)
+{
+    switch (num_dims)
+    {
+    case 4:
+        channel_welford<4, Tensor>(num_samples,
+                                   num_per_sum,
+                                   input,
+                                   sums,
+                                   m2s,
+                                   local_means,
+                                   channel_begin,
+                                   channel_end,
+                                   stream);
+        break;
+    case 5:
+        channel_welford<5, Tensor>(num_samples,
+                                   num_per_sum,
+                                   input,
+                                   sums,
+                                   m2s,
+                                   local_means,
+                                   channel_begin,
+                                   channel_end,
+                                   stream);
+        break;
+    }
+}
+
+#define INSTANTIATE_CHANNEL_WELFORD(TYPE)                                      \
+    template void channel_welford<Tensor<TYPE>>(int num_dims,                  \
+                                                int num_samples,               \
+                                                index_t num_per_sum,           \
+                                                const Tensor<TYPE>& input,     \
+                                                Tensor<TYPE>& sums,            \
+                                                Tensor<TYPE>& m2s,             \
+                                                TYPE* local_means,             \
+                                                int channel_begin,             \
+                                                int channel_end,               \
+                                                h2::gpu::DeviceStream stream);
+INSTANTIATE_CHANNEL_WELFORD(float)
+INSTANTIATE_CHANNEL_WELFORD(double)
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_CHANNEL_WELFORD(h2::gpu::Half)
+INSTANTIATE_CHANNEL_WELFORD(h2::gpu::BFloat16)
+#endif // H2_HAS_GPU_LOW_PRECISION
+#undef INSTANTIATE_CHANNEL_WELFORD
+
+namespace
+{
+
+template <typename DataType>
+__global__ void
+merge_m2s_kernel(const DataType* __restrict__ global_sums,
+                 const DataType* __restrict__ local_means,
+                 DataType* __restrict__ m2s,
+                 const int channel_begin,
+                 const int channel_end,
+                 const util::AccumulationType<DataType> local_weight)
+{
+    using AccType = util::AccumulationType<DataType>;
+    const int ch_idx = channel_begin + threadIdx.x + blockIdx.x * blockDim.x;
+    if (ch_idx < channel_end)
+    {
+        const AccType delta = util::to_accumulation(local_means[ch_idx])
+                              - util::to_accumulation(global_sums[ch_idx]);
+        m2s[ch_idx] = util::from_accumulation<DataType>(
+            util::to_accumulation(m2s[ch_idx]) + local_weight * delta * delta);
+    }
+}
+
+} // namespace
+
+template <typename TensorType>
+void merge_m2s(index_t num_per_sum,
+               index_t local_num_per_sum,
+               const TensorType& global_sums,
+               const typename TensorType::data_type* local_means,
+               TensorType& m2s,
+               int channel_begin,
+               int channel_end,
+               h2::gpu::DeviceStream stream)
+{
+    using DataType = typename TensorType::data_type;
+    using AccType = util::AccumulationType<DataType>;
+    const int num_group_channels = channel_end - channel_begin;
+    if (num_per_sum == 0 || local_num_per_sum == 0 || num_group_channels == 0)
+        return;
+    constexpr int block_size = 256;
+    merge_m2s_kernel<DataType>
+        <<<util::ceil(num_group_channels, block_size), block_size, 0, stream>>>(
+            global_sums.get_const_base_ptr(),
+            local_means,
+            m2s.get_base_ptr(),
+            channel_begin,
+            channel_end,
+            AccType(local_num_per_sum) / AccType(num_per_sum - 1));
+}
+
+#define INSTANTIATE_MERGE_M2S(TYPE)                                            \
+    template void merge_m2s<Tensor<TYPE>>(index_t num_per_sum,                 \
+                                          index_t local_num_per_sum,           \
+                                          const Tensor<TYPE>& global_sums,     \
+                                          const TYPE* local_means,             \
+                                          Tensor<TYPE>& m2s,                   \
+                                          int channel_begin,                   \
+                                          int channel_end,                     \
+                                          h2::gpu::DeviceStream stream);
+INSTANTIATE_MERGE_M2S(float)
+INSTANTIATE_MERGE_M2S(double)
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_MERGE_M2S(h2::gpu::Half)
+INSTANTIATE_MERGE_M2S(h2::gpu::BFloat16)
+#endif // H2_HAS_GPU_LOW_PRECISION
+#undef INSTANTIATE_MERGE_M2S
+
+namespace
+{
+
+template <typename DataType>
+__global__ void m2s_to_statistics_kernel(DataType* __restrict__ global_mean,
+                                         DataType* __restrict__ global_var,
+                                         DataType* __restrict__ running_mean,
+                                         DataType* __restrict__ running_var,
+                                         const int channel_begin,
+                                         const int channel_end,
+                                         const index_t num_per_sum,
+                                         const DataType decay)
+{
+    using AccType = util::AccumulationType<DataType>;
+    const int ch_idx = channel_begin + threadIdx.x + blockIdx.x * blockDim.x;
+    if (ch_idx >= channel_end)
+        return;
+    if (num_per_sum == 0)
+    {
+        // Fill global_var with 1 as sums_to_statistics does.
+        global_var[ch_idx] = util::from_accumulation<DataType>(1);
+        return;
+    }
+    // The scaled sums and M2s are already the mean and variance.
+    const AccType mean = util::to_accumulation(global_mean[ch_idx]);
+    const AccType var = util::to_accumulation(global_var[ch_idx]);
+    const AccType acc_decay = util::to_accumulation(decay);
+
+    running_mean[ch_idx] = util::from_accumulation<DataType>(
+        acc_decay * util::to_accumulation(running_mean[ch_idx])
+        + (AccType(1) - acc_decay) * mean);
+    running_var[ch_idx] = util::from_accumulation<DataType>(
+        acc_decay * util::to_accumulation(running_var[ch_idx])
+        + (AccType(1) - acc_decay) * var);
+}
+
+} // namespace
+
+template <typename TensorType>
+void m2s_to_statistics(index_t num_per_sum,
+                       typename TensorType::data_type decay,
+                       TensorType& global_mean,
+                       TensorType& global_var,
+                       TensorType& running_mean,
+                       TensorType& running_var,
+                       int channel_begin,
+                       int channel_end,
+                       h2::gpu::DeviceStream stream)
+{
+    using DataType = typename TensorType::data_type;
+    const int num_group_channels = channel_end - channel_begin;
+    if (num_group_channels == 0)
+        return;
+    constexpr int block_size = 256;
+    m2s_to_statistics_kernel<DataType>
+        <<<util::ceil(num_group_channels, block_size), block_size, 0, stream>>>(
+            global_mean.get_base_ptr(),
+            global_var.get_base_ptr(),
+            running_mean.get_base_ptr(),
+            running_var.get_base_ptr(),
+            channel_begin,
+            channel_end,
+            num_per_sum,
+            decay);
+}
+
+#define INSTANTIATE_M2S_TO_STATISTICS(TYPE)                                    \
+    template void m2s_to_statistics<Tensor<TYPE>>(                             \
+        index_t num_per_sum,                                                   \
+        TYPE decay,                                                            \
+        Tensor<TYPE> & global_mean,                                            \
+        Tensor<TYPE> & global_var,                                             \
+        Tensor<TYPE> & running_mean,                                           \
+        Tensor<TYPE> & running_var,                                            \
+        int channel_begin,                                                     \
+        int channel_end,                                                       \
+        h2::gpu::DeviceStream stream);
+INSTANTIATE_M2S_TO_STATISTICS(float)
+INSTANTIATE_M2S_TO_STATISTICS(double)
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_M2S_TO_STATISTICS(h2::gpu::Half)
+INSTANTIATE_M2S_TO_STATISTICS(h2::gpu::BFloat16)
+#endif // H2_HAS_GPU_LOW_PRECISION
+#undef INSTANTIATE_M2S_TO_STATISTICS
+
+namespace
+{
+
 __device__ inline float rsqrt(float x)
 {
     return rsqrtf(x);
@@ -377,16 +958,18 @@ batch_normalization_kernel(const DataType* __restrict__ input,
                            DataType epsilon,
                            tensor::Array<ND> shape,
                            tensor::Array<ND> input_strides,
-                           tensor::Array<ND> output_strides)
+                           tensor::Array<ND> output_strides,
+                           const int channel_begin)
 {
-    const int ch_idx = blockIdx.y;
+    using AccType = util::AccumulationType<DataType>;
+    const int ch_idx = channel_begin + blockIdx.y;
     const int num_channels = shape[get_channel_dim()];
     const int num_samples = shape[get_sample_dim()];
-    const DataType mean = global_mean[ch_idx];
-    const DataType var = global_var[ch_idx];
-    const DataType scale = global_scale[ch_idx];
-    const DataType bias = global_bias[ch_idx];
-    const DataType inv_stdev = rsqrt(var + epsilon);
+    const AccType mean = util::to_accumulation(global_mean[ch_idx]);
+    const AccType var = util::to_accumulation(global_var[ch_idx]);
+    const AccType scale = util::to_accumulation(global_scale[ch_idx]);
+    const AccType bias = util::to_accumulation(global_bias[ch_idx]);
+    const AccType inv_stdev = rsqrt(var + util::to_accumulation(epsilon));
 
     const index_t gidx = threadIdx.x + blockIdx.x * blockDim.x;
     const index_t channel_size = shape.get_size() / num_channels / num_samples;
@@ -406,10 +989,10 @@ batch_normalization_kernel(const DataType* __restrict__ input,
         output_offset += ch_idx * output_strides[-2];
         for (int s = 0; s < num_samples; ++s)
         {
-            const DataType x = input[input_offset];
-            DataType xhat = (x - mean) * inv_stdev;
-            DataType y = scale * xhat + bias;
-            output[output_offset] = y;
+            const AccType x = util::to_accumulation(input[input_offset]);
+            AccType xhat = (x - mean) * inv_stdev;
+            AccType y = scale * xhat + bias;
+            output[output_offset] = util::from_accumulation<DataType>(y);
 
             input_offset += input_strides[-1];
             output_offset += output_strides[-1];
@@ -427,15 +1010,16 @@ batch_normalization_opt_kernel(const DataTypeV* __restrict__ input,
                                DataTypeV* __restrict__ output,
                                DataType epsilon,
                                index_t spatial_size,
-                               int num_channels)
+                               int num_channels,
+                               int channel_begin)
 {
-    const auto ch_idx = blockIdx.y;
+    const auto ch_idx = channel_begin + blockIdx.y;
     const auto sample_idx = blockIdx.z;
-    const auto mean = global_mean[ch_idx];
-    const auto var = global_var[ch_idx];
-    const auto scale = global_scale[ch_idx];
-    const auto bias = global_bias[ch_idx];
-    const auto inv_stdev = rsqrt(var + epsilon);
+    const auto mean = util::to_accumulation(global_mean[ch_idx]);
+    const auto var = util::to_accumulation(global_var[ch_idx]);
+    const auto scale = util::to_accumulation(global_scale[ch_idx]);
+    const auto bias = util::to_accumulation(global_bias[ch_idx]);
+    const auto inv_stdev = rsqrt(var + util::to_accumulation(epsilon));
 
     const auto num_threads_per_channel = blockDim.x * gridDim.x;
 
@@ -447,10 +1031,10 @@ batch_normalization_opt_kernel(const DataTypeV* __restrict__ input,
          idx < spatial_size;
          idx += num_threads_per_channel)
     {
-        auto x = input[idx];
+        auto x = util::to_accumulation(input[idx]);
         auto xhat = (x - mean) * inv_stdev;
         auto y = xhat * scale + bias;
-        output[idx] = y;
+        output[idx] = util::from_accumulation<DataTypeV>(y);
     }
 }
 
@@ -463,11 +1047,13 @@ void batch_normalization_opt(int num_samples,
                              const TensorType& bias,
                              TensorType& output,
                              typename TensorType::data_type epsilon,
+                             int channel_begin,
+                             int channel_end,
                              h2::gpu::DeviceStream stream)
 {
     using DataType = typename TensorType::data_type;
     // local tensors can be empty
-    if (output.get_local_size() == 0)
+    if (output.get_local_size() == 0 || channel_begin == channel_end)
         return;
     assert_eq(num_samples, (int) input.get_local_shape()[get_sample_dim()]);
     const int num_channels = input.get_local_shape()[get_channel_dim()];
@@ -480,7 +1066,8 @@ void batch_normalization_opt(int num_samples,
     {
         channel_size /= 4;
         auto num_blocks_per_channel = util::ceil(channel_size, block_work_size);
-        dim3 grid_dim(num_blocks_per_channel, num_channels, num_samples);
+        dim3 grid_dim(
+            num_blocks_per_channel, channel_end - channel_begin, num_samples);
         using DataTypeV = typename util::GetVectorType<DataType, 4>::type;
         batch_normalization_opt_kernel<ND, DataType, DataTypeV>
             <<<grid_dim, block_dim, 0, stream>>>(
@@ -492,12 +1079,14 @@ void batch_normalization_opt(int num_samples,
                 reinterpret_cast<DataTypeV*>(output.get_buffer()),
                 epsilon,
                 channel_size,
-                num_channels);
+                num_channels,
+                channel_begin);
     }
     else
     {
         auto num_blocks_per_channel = util::ceil(channel_size, block_work_size);
-        dim3 grid_dim(num_blocks_per_channel, num_channels, num_samples);
+        dim3 grid_dim(
+            num_blocks_per_channel, channel_end - channel_begin, num_samples);
         batch_normalization_opt_kernel<ND, DataType, DataType>
             <<<grid_dim, block_dim, 0, stream>>>(input.get_const_buffer(),
                                                  mean.get_const_base_ptr(),
@@ -507,7 +1096,8 @@ void batch_normalization_opt(int num_samples,
                                                  output.get_buffer(),
                                                  epsilon,
                                                  channel_size,
-                                                 num_channels);
+                                                 num_channels,
+                                                 channel_begin);
     }
 }
 
@@ -520,6 +1110,8 @@ void batch_normalization(int num_samples,
                          const TensorType& bias,
                          TensorType& output,
                          typename TensorType::data_type epsilon,
+                         int channel_begin,
+                         int channel_end,
                          h2::gpu::DeviceStream stream)
 {
     using DataType = typename TensorType::data_type;
@@ -540,20 +1132,23 @@ void batch_normalization(int num_samples,
                                                     bias,
                                                     output,
                                                     epsilon,
+                                                    channel_begin,
+                                                    channel_end,
                                                     stream);
             return;
         }
     }
 
     // local tensors can be empty
-    if (output.get_local_size() == 0)
+    if (output.get_local_size() == 0 || channel_begin == channel_end)
         return;
     assert_eq(num_samples, (int) input.get_local_shape()[get_sample_dim()]);
     const int num_channels = input.get_local_shape()[get_channel_dim()];
     constexpr int block_size = 256;
     dim3 block_dim(block_size);
     index_t channel_size = input.get_local_size() / num_channels / num_samples;
-    dim3 grid_dim((channel_size + block_size - 1) / block_size, num_channels);
+    dim3 grid_dim((channel_size + block_size - 1) / block_size,
+                  channel_end - channel_begin);
     tensor::Array<ND> input_strides = input.get_strides();
     tensor::Array<ND> output_strides = output.get_strides();
     // CUDA grid dimension limitation
@@ -569,7 +1164,8 @@ void batch_normalization(int num_samples,
         epsilon,
         shape,
         input_strides,
-        output_strides);
+        output_strides,
+        channel_begin);
 }
 
 } // namespace
@@ -584,8 +1180,21 @@ void batch_normalization(int num_dims,
                          const TensorType& bias,
                          TensorType& output,
                          typename TensorType::data_type epsilon,
-                         h2::gpu::DeviceStream stream)
+                         h2::gpu::DeviceStream stream,
+                         int channel_begin,
+                         int channel_end)
 {
+    if (channel_end < 0)
+        channel_end = input.get_local_shape()[get_channel_dim()];
+    // Each element is normalized, scaled, and shifted.
+    size_t const bytes = get_local_bytes(input, channel_begin, channel_end);
+    h2::ComputeStream const compute_stream(stream);
+    H2_TRACE_SCOPE_WITH_FLOPS("distconv::batchnorm::batch_normalization",
+                              Compute,
+                              compute_stream,
+                              2 * bytes,
+                              3 * bytes
+                                  / sizeof(typename TensorType::data_type));
     switch (num_dims)
     {
     case 4:
@@ -597,6 +1206,8 @@ void batch_normalization(int num_dims,
                                            bias,
                                            output,
                                            epsilon,
+                                           channel_begin,
+                                           channel_end,
                                            stream);
         break;
     case 5:
@@ -608,6 +1219,8 @@ void batch_normalization(int num_dims,
                                            bias,
                                            output,
                                            epsilon,
+                                           channel_begin,
+                                           channel_end,
                                            stream);
         break;
     }
@@ -624,9 +1237,15 @@ void batch_normalization(int num_dims,
         const Tensor<TYPE>& bias,                                              \
         Tensor<TYPE>& output,                                                  \
         TYPE epsilon,                                                          \
-        h2::gpu::DeviceStream stream);
+        h2::gpu::DeviceStream stream,                                          \
+        int channel_begin,                                                     \
+        int channel_end);
 INSTANTIATE_BATCH_NORMALIZATION(float)
 INSTANTIATE_BATCH_NORMALIZATION(double)
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_BATCH_NORMALIZATION(h2::gpu::Half)
+INSTANTIATE_BATCH_NORMALIZATION(h2::gpu::BFloat16)
+#endif // H2_HAS_GPU_LOW_PRECISION
 #undef INSTANTIATE_BATCH_NORMALIZATION
 
 #ifdef DISTCONV_HAS_NVSHMEM
@@ -917,16 +1536,17 @@ __global__ void backprop1_kernel(const DataType* __restrict__ input,
     const int num_channels = shape[get_channel_dim()];
     const int num_samples = shape[get_sample_dim()];
 
-    const DataType mean = global_mean[ch_idx];
-    const DataType var = global_var[ch_idx];
-    const DataType scale = global_scale[ch_idx];
-    const DataType inv_stdev = rsqrt(var + epsilon);
-    const DataType dvar_factor = inv_stdev * inv_stdev * inv_stdev / 2;
+    using AccType = util::AccumulationType<DataType>;
+    const AccType mean = util::to_accumulation(global_mean[ch_idx]);
+    const AccType var = util::to_accumulation(global_var[ch_idx]);
+    const AccType scale = util::to_accumulation(global_scale[ch_idx]);
+    const AccType inv_stdev = rsqrt(var + util::to_accumulation(epsilon));
+    const AccType dvar_factor = inv_stdev * inv_stdev * inv_stdev / 2;
 
-    DataType dscale = DataType(0);
-    DataType dbias = DataType(0);
-    DataType dmean = DataType(0);
-    DataType dvar = DataType(0);
+    AccType dscale = AccType(0);
+    AccType dbias = AccType(0);
+    AccType dmean = AccType(0);
+    AccType dvar = AccType(0);
 
     const index_t channel_size = shape.get_size() / num_channels / num_samples;
 
@@ -945,12 +1565,12 @@ __global__ void backprop1_kernel(const DataType* __restrict__ input,
         d_output_offset += ch_idx * d_output_strides[-2];
         for (int sample_idx = 0; sample_idx < num_samples; ++sample_idx)
         {
-            const DataType x = input[input_offset];
-            const DataType xhat = (x - mean) * inv_stdev;
-            const DataType dy = d_output[d_output_offset];
+            const AccType x = util::to_accumulation(input[input_offset]);
+            const AccType xhat = (x - mean) * inv_stdev;
+            const AccType dy = util::to_accumulation(d_output[d_output_offset]);
             dscale += dy * xhat;
             dbias += dy;
-            const DataType dxhat = dy * scale;
+            const AccType dxhat = dy * scale;
             dmean += -dxhat * inv_stdev;
             dvar += -dxhat * (x - mean) * dvar_factor;
 
@@ -959,7 +1579,7 @@ __global__ void backprop1_kernel(const DataType* __restrict__ input,
         }
     }
 
-    using BlockReduce = cubns::BlockReduce<DataType, BLOCK_SIZE>;
+    using BlockReduce = cubns::BlockReduce<AccType, BLOCK_SIZE>;
     __shared__ typename BlockReduce::TempStorage temp_storage_scale;
     __shared__ typename BlockReduce::TempStorage temp_storage_bias;
     __shared__ typename BlockReduce::TempStorage temp_storage_mean;
@@ -972,10 +1592,14 @@ __global__ void backprop1_kernel(const DataType* __restrict__ input,
     // Output channel sum to global memory
     if (tid == 0)
     {
-        atomic_add(&global_dscale[ch_idx], dscale);
-        atomic_add(&global_dbias[ch_idx], dbias);
-        atomic_add(&global_dmean[ch_idx], dmean);
-        atomic_add(&global_dvar[ch_idx], dvar);
+        atomic_add(&global_dscale[ch_idx],
+                   util::from_accumulation<DataType>(dscale));
+        atomic_add(&global_dbias[ch_idx],
+                   util::from_accumulation<DataType>(dbias));
+        atomic_add(&global_dmean[ch_idx],
+                   util::from_accumulation<DataType>(dmean));
+        atomic_add(&global_dvar[ch_idx],
+                   util::from_accumulation<DataType>(dvar));
     }
 }
 
@@ -1002,16 +1626,17 @@ __global__ void backprop1_opt_kernel(const DataTypeV* __restrict__ input,
     const auto i_sample_offset = input_spatial_real_size * num_channels;
     const auto o_sample_offset = output_spatial_real_size * num_channels;
 
-    const auto mean = global_mean[ch_idx];
-    const auto var = global_var[ch_idx];
-    const auto scale = global_scale[ch_idx];
-    const auto inv_stdev = rsqrt(var + epsilon);
+    using AccType = util::AccumulationType<DataType>;
+    const auto mean = util::to_accumulation(global_mean[ch_idx]);
+    const auto var = util::to_accumulation(global_var[ch_idx]);
+    const auto scale = util::to_accumulation(global_scale[ch_idx]);
+    const auto inv_stdev = rsqrt(var + util::to_accumulation(epsilon));
     const auto dvar_factor = inv_stdev * inv_stdev * inv_stdev / 2;
 
-    DataType dscale = DataType(0);
-    DataType dbias = DataType(0);
-    DataType dmean = DataType(0);
-    DataType dvar = DataType(0);
+    AccType dscale = AccType(0);
+    AccType dbias = AccType(0);
+    AccType dmean = AccType(0);
+    AccType dvar = AccType(0);
 
     index_t i_offset = input_spatial_real_size * ch_idx;
     index_t o_offset = output_spatial_real_size * ch_idx;
@@ -1020,9 +1645,9 @@ __global__ void backprop1_opt_kernel(const DataTypeV* __restrict__ input,
     {
         for (auto i = idx; i < spatial_size; i += BLOCK_SIZE * gridDim.x)
         {
-            const auto x = input[i_offset + i];
+            const auto x = util::to_accumulation(input[i_offset + i]);
             const auto xhat = (x - mean) * inv_stdev;
-            const auto dy = d_output[o_offset + i];
+            const auto dy = util::to_accumulation(d_output[o_offset + i]);
             dscale += util::sum(dy * xhat);
             dbias += util::sum(dy);
             const auto dxhat = dy * scale;
@@ -1033,7 +1658,7 @@ __global__ void backprop1_opt_kernel(const DataTypeV* __restrict__ input,
         o_offset += o_sample_offset;
     }
 
-    using BlockReduce = cubns::BlockReduce<DataType, BLOCK_SIZE>;
+    using BlockReduce = cubns::BlockReduce<AccType, BLOCK_SIZE>;
     __shared__ typename BlockReduce::TempStorage temp_storage_scale;
     __shared__ typename BlockReduce::TempStorage temp_storage_bias;
     __shared__ typename BlockReduce::TempStorage temp_storage_mean;
@@ -1046,10 +1671,14 @@ __global__ void backprop1_opt_kernel(const DataTypeV* __restrict__ input,
     // Output channel sum to global memory
     if (tid == 0)
     {
-        atomic_add(&global_dscale[ch_idx], dscale);
-        atomic_add(&global_dbias[ch_idx], dbias);
-        atomic_add(&global_dmean[ch_idx], dmean);
-        atomic_add(&global_dvar[ch_idx], dvar);
+        atomic_add(&global_dscale[ch_idx],
+                   util::from_accumulation<DataType>(dscale));
+        atomic_add(&global_dbias[ch_idx],
+                   util::from_accumulation<DataType>(dbias));
+        atomic_add(&global_dmean[ch_idx],
+                   util::from_accumulation<DataType>(dmean));
+        atomic_add(&global_dvar[ch_idx],
+                   util::from_accumulation<DataType>(dvar));
     }
 }
 
@@ -1246,6 +1875,14 @@ void backprop1(int num_dims,
                typename TensorType::data_type epsilon,
                h2::gpu::DeviceStream stream)
 {
+    // Each element contributes to the scale, bias, mean, and variance
+    // gradients.
+    h2::ComputeStream const compute_stream(stream);
+    H2_TRACE_SCOPE_WITH_FLOPS("distconv::batchnorm::backprop1",
+                              Compute,
+                              compute_stream,
+                              2 * get_local_bytes(input),
+                              8 * static_cast<size_t>(input.get_local_size()));
     switch (num_dims)
     {
     case 4:
@@ -1295,6 +1932,10 @@ void backprop1(int num_dims,
                                           h2::gpu::DeviceStream stream);
 INSTANTIATE_BACKPROP1(float)
 INSTANTIATE_BACKPROP1(double)
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_BACKPROP1(h2::gpu::Half)
+INSTANTIATE_BACKPROP1(h2::gpu::BFloat16)
+#endif // H2_HAS_GPU_LOW_PRECISION
 #undef INSTANTIATE_BACKPROP1
 
 namespace
@@ -1324,15 +1965,16 @@ __global__ void backprop2_kernel(
     const int num_channels = shape[get_channel_dim()];
     const int num_samples = shape[-1];
 
-    const DataType mean = global_mean[ch_idx];
-    const DataType var = global_var[ch_idx];
-    const DataType scale = global_scale[ch_idx];
-    const DataType dmean = global_dmean[ch_idx];
-    const DataType dvar = global_dvar[ch_idx];
+    using AccType = util::AccumulationType<DataType>;
+    const AccType mean = util::to_accumulation(global_mean[ch_idx]);
+    const AccType var = util::to_accumulation(global_var[ch_idx]);
+    const AccType scale = util::to_accumulation(global_scale[ch_idx]);
+    const AccType dmean = util::to_accumulation(global_dmean[ch_idx]);
+    const AccType dvar = util::to_accumulation(global_dvar[ch_idx]);
 
-    const DataType inv_stdev = rsqrt(var + epsilon);
-    const DataType dmean_term = dmean / num_per_sum;
-    const DataType dvar_term = dvar * 2 / (num_per_sum - 1);
+    const AccType inv_stdev = rsqrt(var + util::to_accumulation(epsilon));
+    const AccType dmean_term = dmean / num_per_sum;
+    const AccType dvar_term = dvar * 2 / (num_per_sum - 1);
 
     const index_t channel_size = shape.get_size() / num_channels / num_samples;
 
@@ -1353,13 +1995,13 @@ __global__ void backprop2_kernel(
         d_input_offset += ch_idx * d_input_strides[-2];
         for (int s = 0; s < num_samples; ++s)
         {
-            const DataType x = input[input_offset];
-            const DataType dy = d_output[d_output_offset];
-            const DataType dxhat = dy * scale;
-            DataType dx = dxhat * inv_stdev;
+            const AccType x = util::to_accumulation(input[input_offset]);
+            const AccType dy = util::to_accumulation(d_output[d_output_offset]);
+            const AccType dxhat = dy * scale;
+            AccType dx = dxhat * inv_stdev;
             dx += dmean_term;
             dx += dvar_term * (x - mean);
-            d_input[d_input_offset] = dx;
+            d_input[d_input_offset] = util::from_accumulation<DataType>(dx);
 
             input_offset += input_strides[-1];
             d_output_offset += d_output_strides[-1];
@@ -1387,12 +2029,12 @@ __global__ void backprop2_opt_kernel(
 {
     const auto ch_idx = blockIdx.y;
     const auto sample_idx = blockIdx.z;
-    const auto mean = global_mean[ch_idx];
-    const auto var = global_var[ch_idx];
-    const auto scale = global_scale[ch_idx];
-    const auto dmean = global_dmean[ch_idx];
-    const auto dvar = global_dvar[ch_idx];
-    const auto inv_stdev = rsqrt(var + epsilon);
+    const auto mean = util::to_accumulation(global_mean[ch_idx]);
+    const auto var = util::to_accumulation(global_var[ch_idx]);
+    const auto scale = util::to_accumulation(global_scale[ch_idx]);
+    const auto dmean = util::to_accumulation(global_dmean[ch_idx]);
+    const auto dvar = util::to_accumulation(global_dvar[ch_idx]);
+    const auto inv_stdev = rsqrt(var + util::to_accumulation(epsilon));
     const auto dmean_term = dmean / num_per_sum;
     const auto dvar_term = dvar * 2 / (num_per_sum - 1);
 
@@ -1407,13 +2049,13 @@ __global__ void backprop2_opt_kernel(
          idx < spatial_size;
          idx += num_threads_per_channel)
     {
-        const auto x = input[idx];
-        const auto dy = d_output[idx];
+        const auto x = util::to_accumulation(input[idx]);
+        const auto dy = util::to_accumulation(d_output[idx]);
         const auto dxhat = dy * scale;
         auto dx = dxhat * inv_stdev;
         dx = dx + dmean_term;
         dx = dx + (x - mean) * dvar_term;
-        d_input[idx] = dx;
+        d_input[idx] = util::from_accumulation<DataTypeV>(dx);
     }
 }
 
@@ -1575,6 +2217,14 @@ void backprop2(int num_dims,
                typename TensorType::data_type epsilon,
                h2::gpu::DeviceStream stream)
 {
+    // Each input gradient combines the output gradient with the mean
+    // and variance gradients.
+    h2::ComputeStream const compute_stream(stream);
+    H2_TRACE_SCOPE_WITH_FLOPS("distconv::batchnorm::backprop2",
+                              Compute,
+                              compute_stream,
+                              3 * get_local_bytes(input),
+                              6 * static_cast<size_t>(input.get_local_size()));
     switch (num_dims)
     {
     case 4:
@@ -1624,6 +2274,10 @@ void backprop2(int num_dims,
                                           h2::gpu::DeviceStream stream);
 INSTANTIATE_BACKPROP2(float)
 INSTANTIATE_BACKPROP2(double)
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_BACKPROP2(h2::gpu::Half)
+INSTANTIATE_BACKPROP2(h2::gpu::BFloat16)
+#endif // H2_HAS_GPU_LOW_PRECISION
 #undef INSTANTIATE_BACKPROP2
 
 } // namespace batchnorm
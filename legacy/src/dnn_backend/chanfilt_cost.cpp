@@ -0,0 +1,170 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "distconv_config.hpp"
+
+#include "distconv/dnn_backend/chanfilt_cost.hpp"
+#include "distconv/dnn_backend/dnn_backend.hpp"
+#include "distconv/runtime_gpu.hpp"
+#include "distconv/util/util_mpi.hpp"
+
+#include <algorithm> // std::max
+#include <limits>    // std::numeric_limits
+#include <map>       // std::map
+
+namespace distconv
+{
+namespace
+{
+
+// Message sizes, in floats per process, used for calibration. The
+// small one measures the latency and the large one the bandwidth.
+constexpr size_t small_count = 256;
+constexpr size_t large_count = 4 * 1024 * 1024;
+constexpr int num_warmup_iters = 2;
+constexpr int num_iters = 5;
+
+// Returns the average time, in seconds, of collective(count) on the
+// slowest process of comm.
+template <typename Collective>
+double time_collective(Collective&& collective,
+                       size_t count,
+                       Al::NCCLBackend::comm_type& comm)
+{
+    auto const stream = comm.get_stream();
+    auto const start = h2::gpu::make_event();
+    auto const end = h2::gpu::make_event();
+    for (int i = 0; i < num_warmup_iters; ++i)
+        collective(count);
+    GPUDNNBackend::record_event(start, stream);
+    for (int i = 0; i < num_iters; ++i)
+        collective(count);
+    GPUDNNBackend::record_event(end, stream);
+    h2::gpu::sync(end);
+    float elapsed = GPUDNNBackend::elapsed_time(start, end) / num_iters;
+    h2::gpu::destroy(start);
+    h2::gpu::destroy(end);
+    DISTCONV_CHECK_MPI(MPI_Allreduce(
+        MPI_IN_PLACE, &elapsed, 1, MPI_FLOAT, MPI_MAX, comm.get_comm()));
+    return elapsed * 1e-3;
+}
+
+// Fits the model to the times of a small and a large message.
+template <typename Collective>
+CollectiveCost calibrate(Collective&& collective,
+                         Al::NCCLBackend::comm_type& comm)
+{
+    int const q = comm.size();
+    CollectiveCost cost;
+    if (q <= 1)
+        return cost;
+    double const small_bytes = small_count * q * sizeof(float);
+    double const large_bytes = large_count * q * sizeof(float);
+    double const small_time = time_collective(collective, small_count, comm);
+    double const large_time = time_collective(collective, large_count, comm);
+    double const factor = double(q - 1) / q;
+    cost.time_per_byte = std::max(
+        (large_time - small_time) / (factor * (large_bytes - small_bytes)),
+        0.0);
+    cost.latency = std::max(
+        (small_time - factor * small_bytes * cost.time_per_byte) / (q - 1),
+        0.0);
+    return cost;
+}
+
+} // namespace
+
+const ChanfiltCostModel&
+get_chanfilt_cost_model(Al::NCCLBackend::comm_type& comm)
+{
+    static std::map<Al::NCCLBackend::comm_type*, ChanfiltCostModel> models;
+    auto const it = models.find(&comm);
+    if (it != models.end())
+        return it->second;
+
+    int const q = comm.size();
+    auto& mempool = internal::RuntimeGPU::get_device_memory_pool();
+    auto* const buf = static_cast<float*>(
+        mempool.get(sizeof(float) * large_count * q, comm.get_stream()));
+    ChanfiltCostModel model;
+    model.allgather = calibrate(
+        [&](size_t count) {
+            Al::Allgather<Al::NCCLBackend, float>(buf, count, comm);
+        },
+        comm);
+    model.reduce_scatter = calibrate(
+        [&](size_t count) {
+            Al::Reduce_scatter<Al::NCCLBackend, float>(
+                buf, count, Al::ReductionOperator::sum, comm);
+        },
+        comm);
+    mempool.release(buf);
+
+    util::MPIRootPrintStreamInfo()
+        << "Channel/filter collective costs among " << q
+        << " processes: allgather " << model.allgather.latency * 1e6
+        << " us + " << 1e-9 / model.allgather.time_per_byte
+        << " GB/s, reduce-scatter " << model.reduce_scatter.latency * 1e6
+        << " us + " << 1e-9 / model.reduce_scatter.time_per_byte << " GB/s";
+    return models.emplace(&comm, model).first->second;
+}
+
+double estimate_chanfilt_time(ChannelParallelismAlgorithm algo,
+                              const ChanfiltProblem& problem,
+                              const ChanfiltCostModel& model,
+                              double compute_time)
+{
+    int const p = problem.num_segments;
+    // Sizes of the groups that gather the input channels and the
+    // output filters, and the sizes of the gathered data.
+    int channel_group = 1;
+    int filter_group = 1;
+    double input_bytes = problem.input_bytes;
+    double output_bytes = problem.output_bytes;
+    switch (algo)
+    {
+    case ChannelParallelismAlgorithm::X: filter_group = p; break;
+    case ChannelParallelismAlgorithm::Y: channel_group = p; break;
+    case ChannelParallelismAlgorithm::W:
+        channel_group = p / problem.filter_channel_split;
+        filter_group = p / problem.filter_filter_split;
+        input_bytes /= problem.filter_channel_split;
+        output_bytes /= problem.filter_filter_split;
+        break;
+    default: return 0;
+    }
+    // Forward and backward data each do one collective of each
+    // tensor; backward filter reuses the gathered tensors.
+    return model.allgather(input_bytes, channel_group)
+           + model.reduce_scatter(input_bytes, channel_group)
+           + model.reduce_scatter(output_bytes, filter_group)
+           + model.allgather(output_bytes, filter_group) + compute_time;
+}
+
+ChannelParallelismAlgorithm select_chanfilt_algorithm_by_cost(
+    const std::vector<ChannelParallelismAlgorithm>& candidates,
+    const ChanfiltProblem& problem,
+    const ChanfiltCostModel& model)
+{
+    auto best = ChannelParallelismAlgorithm::X;
+    double best_time = std::numeric_limits<double>::max();
+    for (auto const algo : candidates)
+    {
+        double const t = estimate_chanfilt_time(algo, problem, model);
+        util::MPIRootPrintStreamDebug()
+            << "Estimated channel/filter communication time of " << algo
+            << ": " << t * 1e3 << " ms";
+        if (t < best_time)
+        {
+            best = algo;
+            best_time = t;
+        }
+    }
+    return best;
+}
+
+} // namespace distconv
@@ -145,6 +145,150 @@ __global__ void bp_local(const DataType* __restrict__ x_pred,
     }
 }
 
+// Returns the truth of channel at spatial of a sample, which is a
+// one-hot encoding of the label with use_labels.
+template <typename DataType>
+__device__ __forceinline__ DataType
+get_truth(const DataType* __restrict__ x_truth,
+          const index_t spatial,
+          const index_t channel,
+          const index_t spatial_size,
+          const bool use_labels)
+{
+    if (use_labels)
+    {
+        const int truth_label = x_truth[spatial];
+        return DataType(truth_label == channel ? 1. : 0.);
+    }
+    return x_truth[spatial + channel * spatial_size];
+}
+
+// Computes the max and the sum of exp(z - max) over the channels of
+// the logits at spatial in a single pass.
+template <typename DataType>
+__device__ __forceinline__ void
+channel_max_and_sum(const DataType* __restrict__ logits,
+                    const index_t spatial,
+                    const index_t spatial_size,
+                    const index_t channel_size,
+                    DataType& ch_max,
+                    DataType& ch_sum)
+{
+    ch_max = logits[spatial];
+    ch_sum = DataType(1.);
+    for (index_t c = 1; c < channel_size; ++c)
+    {
+        const auto z = logits[spatial + c * spatial_size];
+        if (z > ch_max)
+        {
+            ch_sum = ch_sum * exp(ch_max - z) + DataType(1.);
+            ch_max = z;
+        }
+        else
+        {
+            ch_sum += exp(z - ch_max);
+        }
+    }
+}
+
+/*
+  Cross entropy of softmax over the channels of logits, i.e.,
+  -sum_c t_c * log(softmax(z)_c) = sum_c t_c * (log(sum(exp(z))) - z_c),
+  without computing the probabilities.
+  - gridDim.y == number of samples
+  - Each thread takes care of one spatial position
+ */
+template <typename DataType, int BLOCK_SIZE>
+__global__ void fp_logits_local(const DataType* __restrict__ logits,
+                                const DataType* __restrict__ x_truth,
+                                DataType* __restrict__ y,
+                                const index_t spatial_size,
+                                const index_t channel_size,
+                                const bool use_labels)
+{
+    const int tid = threadIdx.x;
+    const int sample_idx = blockIdx.y;
+    const index_t spatial = tid + blockIdx.x * BLOCK_SIZE;
+
+    logits += sample_idx * spatial_size * channel_size;
+    x_truth += sample_idx * spatial_size * (use_labels ? 1 : channel_size);
+
+    auto psum = DataType(0.);
+    if (spatial < spatial_size)
+    {
+        DataType ch_max, ch_sum;
+        channel_max_and_sum(
+            logits, spatial, spatial_size, channel_size, ch_max, ch_sum);
+        const auto log_sum = ch_max + log(ch_sum);
+        for (index_t c = 0; c < channel_size; ++c)
+        {
+            const auto xhat =
+                get_truth(x_truth, spatial, c, spatial_size, use_labels);
+            if (xhat > DataType(0.))
+            {
+                const auto z = logits[spatial + c * spatial_size];
+                psum += xhat * (log_sum - z);
+            }
+        }
+    }
+
+    using BlockReduce = cubns::BlockReduce<DataType, BLOCK_SIZE>;
+    __shared__ typename BlockReduce::TempStorage temp_storage;
+    psum = BlockReduce(temp_storage).Sum(psum);
+
+    if (tid == 0)
+    {
+        atomic_add(&y[sample_idx], psum);
+    }
+}
+
+/*
+  The gradient of fp_logits_local, which is
+  dy * (softmax(z)_c * sum_c t_c - t_c), i.e., softmax - truth for
+  normalized truths.
+  - gridDim.y == number of samples
+  - Each thread takes care of one spatial position
+ */
+template <typename DataType, int BLOCK_SIZE>
+__global__ void bp_logits_local(const DataType* __restrict__ logits,
+                                const DataType* __restrict__ x_truth,
+                                const DataType* __restrict__ dy,
+                                DataType* __restrict__ dx_logits,
+                                const index_t spatial_size,
+                                const index_t channel_size,
+                                const bool use_labels)
+{
+    const int sample_idx = blockIdx.y;
+    const index_t spatial = threadIdx.x + blockIdx.x * BLOCK_SIZE;
+    if (spatial >= spatial_size)
+        return;
+
+    logits += sample_idx * spatial_size * channel_size;
+    dx_logits += sample_idx * spatial_size * channel_size;
+    x_truth += sample_idx * spatial_size * (use_labels ? 1 : channel_size);
+
+    const auto dy_sample = dy[sample_idx];
+    DataType ch_max, ch_sum;
+    channel_max_and_sum(
+        logits, spatial, spatial_size, channel_size, ch_max, ch_sum);
+    auto truth_sum = DataType(1.);
+    if (!use_labels)
+    {
+        truth_sum = DataType(0.);
+        for (index_t c = 0; c < channel_size; ++c)
+            truth_sum += x_truth[spatial + c * spatial_size];
+    }
+    const auto scale = dy_sample * truth_sum / ch_sum;
+    for (index_t c = 0; c < channel_size; ++c)
+    {
+        const auto offset = spatial + c * spatial_size;
+        const auto xhat =
+            get_truth(x_truth, spatial, c, spatial_size, use_labels);
+        dx_logits[offset] =
+            scale * exp(logits[offset] - ch_max) - dy_sample * xhat;
+    }
+}
+
 } // namespace
 
 template <typename Tensor>
@@ -261,6 +405,106 @@ int CrossEntropy<BackendDNNLib>::backward(const Tensor& x_pred,
     return 0;
 }
 
+template <typename Tensor>
+int CrossEntropy<BackendDNNLib>::forward_with_logits(const Tensor& x_logits,
+                                                     const Tensor& x_truth,
+                                                     Tensor& y)
+{
+    using DataType = typename Tensor::data_type;
+    util::MPIPrintStreamDebug() << "Cross entropy with logits FP: "
+                                << x_logits << ", " << x_truth << ", " << y;
+
+    constexpr int block_size = 256;
+
+    // Assumes no halo for simplicity
+    assert_eq(x_logits.get_local_size(), x_logits.get_local_real_size());
+    assert_eq(x_truth.get_local_size(), x_truth.get_local_real_size());
+    // Softmax needs all channels
+    const int channel_dim = x_logits.get_num_spatial_dims();
+    assert_eq(x_logits.get_local_shape()[channel_dim],
+              x_logits.get_shape()[channel_dim]);
+
+    const auto num_samples = x_logits.get_local_shape()[-1];
+
+    if (num_samples == 0)
+        return 0;
+
+    y.zero(m_stream);
+
+    if (x_logits.get_local_size() > 0)
+    {
+        const auto sample_size = x_logits.get_local_size() / num_samples;
+        const auto channel_size = x_logits.get_local_shape()[channel_dim];
+        const auto spatial_size = sample_size / channel_size;
+
+        dim3 bdim(block_size);
+        dim3 gdim(util::ceil(spatial_size, (index_t) block_size), num_samples);
+
+        fp_logits_local<DataType, block_size>
+            <<<gdim, bdim, 0, m_stream>>>(x_logits.get_const_buffer(),
+                                          x_truth.get_const_buffer(),
+                                          y.get_buffer(),
+                                          spatial_size,
+                                          channel_size,
+                                          m_use_labels);
+    }
+
+    if (m_num_procs_per_sample > 1)
+    {
+        Al::Allreduce<Al::NCCLBackend, DataType>(y.get_buffer(),
+                                                 num_samples,
+                                                 Al::ReductionOperator::sum,
+                                                 *m_al.get());
+    }
+
+    return 0;
+}
+
+template <typename Tensor>
+int CrossEntropy<BackendDNNLib>::backward_with_logits(const Tensor& x_logits,
+                                                      const Tensor& x_truth,
+                                                      Tensor& dy,
+                                                      Tensor& dx_logits)
+{
+    using DataType = typename Tensor::data_type;
+    util::MPIPrintStreamDebug()
+        << "Cross entropy with logits BP: " << dy << ", " << dx_logits;
+
+    if (m_num_procs_per_sample > 1)
+    {
+        const auto num_samples = x_logits.get_local_shape()[-1];
+        Al::Bcast<Al::NCCLBackend, DataType>(
+            dy.get_buffer(), num_samples, 0, *m_al.get());
+    }
+
+    constexpr int block_size = 256;
+
+    // Assumes no halo for simplicity
+    assert_eq(dx_logits.get_local_size(), dx_logits.get_local_real_size());
+
+    if (x_logits.get_local_size() == 0)
+        return 0;
+
+    const int channel_dim = x_logits.get_num_spatial_dims();
+    const auto num_samples = x_logits.get_local_shape()[-1];
+    const auto sample_size = x_logits.get_local_size() / num_samples;
+    const auto channel_size = x_logits.get_local_shape()[channel_dim];
+    const auto spatial_size = sample_size / channel_size;
+
+    dim3 bdim(block_size);
+    dim3 gdim(util::ceil(spatial_size, (index_t) block_size), num_samples);
+
+    bp_logits_local<DataType, block_size>
+        <<<gdim, bdim, 0, m_stream>>>(x_logits.get_const_buffer(),
+                                      x_truth.get_const_buffer(),
+                                      dy.get_const_buffer(),
+                                      dx_logits.get_buffer(),
+                                      spatial_size,
+                                      channel_size,
+                                      m_use_labels);
+    return 0;
+}
+
 #define PROTO(T)                                                               \
     template int                                                               \
     CrossEntropy<BackendDNNLib>::forward<TensorCUDA<T>>(           \
@@ -273,7 +517,18 @@ int CrossEntropy<BackendDNNLib>::backward(const Tensor& x_pred,
         const TensorCUDA<T>& x_truth,                                          \
         TensorCUDA<T>& dy,                                                     \
         TensorCUDA<T>& dx_pred,                                                \
-        TensorCUDA<T>& dx_truth);
+        TensorCUDA<T>& dx_truth);                                              \
+    template int                                                               \
+    CrossEntropy<BackendDNNLib>::forward_with_logits<TensorCUDA<T>>(           \
+        const TensorCUDA<T>& x_logits,                                         \
+        const TensorCUDA<T>& x_truth,                                          \
+        TensorCUDA<T>& y);                                                     \
+    template int                                                               \
+    CrossEntropy<BackendDNNLib>::backward_with_logits<TensorCUDA<T>>(          \
+        const TensorCUDA<T>& x_logits,                                         \
+        const TensorCUDA<T>& x_truth,                                          \
+        TensorCUDA<T>& dy,                                                     \
+        TensorCUDA<T>& dx_logits);
 
 PROTO(float)
 PROTO(double)
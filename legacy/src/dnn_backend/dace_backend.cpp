@@ -10,12 +10,82 @@
 #include "distconv/util/util_mpi.hpp" // For printouts
 
 #include <dlfcn.h>
-
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <set>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
+
+extern char** environ;
 
 namespace distconv
 {
+namespace
+{
+
+// Runs "compiler <hash> <path>" for each of hashes with at most
+// num_workers processes at a time, and returns the number of failed
+// compilations.
+int run_jit_compilers(std::string const& compiler,
+                      std::vector<std::string> const& hashes,
+                      std::string const& path,
+                      int num_workers)
+{
+    // The arguments are passed as positional parameters so that they
+    // need no quoting.
+    std::string const script = compiler + " \"$1\" \"$2\"";
+    std::deque<std::pair<pid_t, std::string>> running;
+    int num_failed = 0;
+    auto const wait_oldest = [&]() {
+        auto const job = running.front();
+        running.pop_front();
+        int status;
+        if (waitpid(job.first, &status, 0) != job.first || !WIFEXITED(status)
+            || WEXITSTATUS(status) != 0)
+        {
+            util::MPIPrintStreamWarning()
+                << "Failed to JIT-compile convolution " << job.second;
+            ++num_failed;
+        }
+    };
+    for (auto const& hash : hashes)
+    {
+        if (static_cast<int>(running.size()) >= std::max(num_workers, 1))
+            wait_oldest();
+        char const* argv[] = {
+            "/bin/sh", "-c", script.c_str(), "sh", hash.c_str(), path.c_str(),
+            nullptr};
+        pid_t pid;
+        int const err = posix_spawn(&pid,
+                                    "/bin/sh",
+                                    nullptr,
+                                    nullptr,
+                                    const_cast<char* const*>(argv),
+                                    environ);
+        if (err != 0)
+        {
+            util::MPIPrintStreamWarning()
+                << "Unable to run the JIT compiler for " << hash << ": "
+                << std::strerror(err);
+            ++num_failed;
+            continue;
+        }
+        running.emplace_back(pid, hash);
+    }
+    while (!running.empty())
+        wait_oldest();
+    return num_failed;
+}
+
+} // namespace
+
 ///////////////////////////////////////////////////////////////////////////
 // Descriptor functionality
 
@@ -663,6 +733,107 @@ bool DaCeDNNBackend<VendorBackendT>::load_library_or_fallback(
     return true;
 }
 
+template <typename VendorBackendT>
+bool DaCeDNNBackend<VendorBackendT>::library_exists(
+    const ConvDescriptor& desc) const
+{
+    const std::string& path = this->m_opts.jit_cache_path;
+    for (bool dynamic_minibatch_size : {false, true})
+    {
+        std::string const fname =
+            path + "/lib" + desc.hash(dynamic_minibatch_size) + ".so";
+        if (access(fname.c_str(), R_OK) == 0)
+            return true;
+    }
+    return false;
+}
+
+template <typename VendorBackendT>
+void DaCeDNNBackend<VendorBackendT>::prewarm(
+    std::vector<JITProblem> const& problems, MPI_Comm comm) const
+{
+    std::vector<ConvDescriptor> descs;
+    std::string missing;
+    for (auto const& p : problems)
+    {
+        ConvDescriptor desc;
+        desc.type = p.type;
+        if (!descriptor_from_tensors(
+                p.x_desc, p.w_desc, p.conv_desc, p.y_desc, desc))
+            continue;
+        descs.push_back(desc);
+        if (!library_exists(desc))
+            missing += desc.hash() + "\n";
+    }
+
+    // Every rank makes the same round-robin assignment of the
+    // libraries missing on any rank. Hashes contain no newlines.
+    std::set<std::string> all_missing;
+    for (auto const& keys : util::allgather_strings(missing, comm))
+    {
+        std::istringstream lines(keys);
+        std::string hash;
+        while (std::getline(lines, hash))
+            all_missing.insert(hash);
+    }
+    int rank, num_ranks;
+    DISTCONV_CHECK_MPI(MPI_Comm_rank(comm, &rank));
+    DISTCONV_CHECK_MPI(MPI_Comm_size(comm, &num_ranks));
+    std::vector<std::string> hashes;
+    int i = 0;
+    for (auto const& hash : all_missing)
+    {
+        if (i++ % num_ranks == rank)
+            hashes.push_back(hash);
+    }
+
+    if (!all_missing.empty())
+    {
+        if (this->m_opts.jit_compiler.empty())
+        {
+            util::MPIRootPrintStreamInfo()
+                << all_missing.size() << " JIT-compiled convolutions are "
+                << "missing, but no compiler is set "
+                << "(DISTCONV_JIT_COMPILER)";
+        }
+        else
+        {
+            util::MPIRootPrintStreamInfo()
+                << "JIT-compiling " << all_missing.size()
+                << " convolutions on " << num_ranks << " ranks";
+            int const num_failed =
+                run_jit_compilers(this->m_opts.jit_compiler,
+                                  hashes,
+                                  this->m_opts.jit_cache_path,
+                                  this->m_opts.jit_compile_workers);
+            if (num_failed > 0)
+            {
+                util::MPIPrintStreamWarning()
+                    << num_failed << " of " << hashes.size()
+                    << " JIT compilations failed";
+            }
+        }
+    }
+    DISTCONV_CHECK_MPI(MPI_Barrier(comm));
+
+    // Forget earlier misses, which may have been compiled now.
+    for (auto const& desc : descs)
+    {
+        auto const iter = m_dace_libraries.find(desc);
+        if (iter != m_dace_libraries.end() && !iter->second.library)
+            m_dace_libraries.erase(iter);
+        dace_state library;
+        load_library_or_fallback(desc, library);
+    }
+}
+
+template <typename VendorBackendT>
+void DaCeDNNBackend<VendorBackendT>::prewarm(
+    std::vector<JITProblem> const& problems) const
+{
+    prewarm(problems, this->get_comm());
+}
+
 ///////////////////////////////////////////////////////////////////////////
 
 // Instantiate class with GPU backend
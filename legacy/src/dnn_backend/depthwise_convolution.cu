@@ -0,0 +1,337 @@
+#include "distconv/dnn_backend/depthwise_convolution.hpp"
+#include "distconv/runtime_gpu.hpp"
+#include "distconv/util/util.hpp"
+#include "distconv/util/util_gpu.hpp"
+#include "h2/core/low_precision.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using distconv::GPUDNNBackend;
+using h2::convert_compute_type;
+
+namespace
+{
+
+namespace util = distconv::util;
+
+// The 16-bit types are computed in float.
+template <typename DataType>
+using AccType = util::AccumulationType<DataType>;
+
+constexpr int block_size = 256;
+
+// Geometry of a depthwise convolution. Spatial arrays are in D, H, W
+// order, and 2-D convolutions have a depth of 1. Strides of x and y
+// are in N, C, D, H, W order.
+struct Params
+{
+    int num_samples;
+    int num_channels;
+    // Number of filters (output channels) per input channel.
+    int multiplier;
+    int x_dims[3];
+    int y_dims[3];
+    int w_dims[3];
+    int pads[3];
+    int strides[3];
+    int dilations[3];
+    int64_t x_strides[5];
+    int64_t y_strides[5];
+};
+
+// Filter sizes FD x FH x FW are compile-time constants so that the
+// taps are unrolled; 0 means they are read from p.
+template <int FD, int FH, int FW, typename DataType>
+__global__ void forward_kernel(Params const p,
+                               AccType<DataType> const alpha,
+                               AccType<DataType> const beta,
+                               DataType const* __restrict__ x,
+                               DataType const* __restrict__ w,
+                               DataType* __restrict__ y,
+                               int64_t const num_outputs)
+{
+    using Acc = AccType<DataType>;
+    int const fd = FD > 0 ? FD : p.w_dims[0];
+    int const fh = FH > 0 ? FH : p.w_dims[1];
+    int const fw = FW > 0 ? FW : p.w_dims[2];
+    int const num_filters = p.num_channels * p.multiplier;
+
+    for (int64_t i = blockIdx.x * (int64_t) blockDim.x + threadIdx.x;
+         i < num_outputs;
+         i += (int64_t) blockDim.x * gridDim.x)
+    {
+        // Consecutive threads compute consecutive output points along
+        // W, so loads of x are coalesced.
+        int64_t r = i;
+        int const ow = r % p.y_dims[2];
+        r /= p.y_dims[2];
+        int const oh = r % p.y_dims[1];
+        r /= p.y_dims[1];
+        int const od = r % p.y_dims[0];
+        r /= p.y_dims[0];
+        int const k = r % num_filters;
+        int const n = r / num_filters;
+        int const c = k / p.multiplier;
+
+        int const d0 = od * p.strides[0] - p.pads[0];
+        int const h0 = oh * p.strides[1] - p.pads[1];
+        int const w0 = ow * p.strides[2] - p.pads[2];
+        DataType const* const xp = x + n * p.x_strides[0] + c * p.x_strides[1];
+        DataType const* const wp = w + (int64_t) k * fd * fh * fw;
+
+        Acc acc = Acc(0);
+        bool const interior =
+            d0 >= 0 && d0 + (fd - 1) * p.dilations[0] < p.x_dims[0] && h0 >= 0
+            && h0 + (fh - 1) * p.dilations[1] < p.x_dims[1] && w0 >= 0
+            && w0 + (fw - 1) * p.dilations[2] < p.x_dims[2];
+        if (interior)
+        {
+            // The whole window is inside x (including any halo).
+#pragma unroll
+            for (int kd = 0; kd < fd; ++kd)
+            {
+                int64_t const xd =
+                    (d0 + kd * p.dilations[0]) * p.x_strides[2];
+#pragma unroll
+                for (int kh = 0; kh < fh; ++kh)
+                {
+                    int64_t const xh =
+                        xd + (h0 + kh * p.dilations[1]) * p.x_strides[3];
+#pragma unroll
+                    for (int kw = 0; kw < fw; ++kw)
+                    {
+                        int64_t const xw =
+                            xh + (w0 + kw * p.dilations[2]) * p.x_strides[4];
+                        acc += convert_compute_type<Acc>(xp[xw])
+                               * convert_compute_type<Acc>(
+                                   wp[(kd * fh + kh) * fw + kw]);
+                    }
+                }
+            }
+        }
+        else
+        {
+            // Taps in the padding contribute zero.
+            for (int kd = 0; kd < fd; ++kd)
+            {
+                int const id = d0 + kd * p.dilations[0];
+                if (id < 0 || id >= p.x_dims[0])
+                    continue;
+                for (int kh = 0; kh < fh; ++kh)
+                {
+                    int const ih = h0 + kh * p.dilations[1];
+                    if (ih < 0 || ih >= p.x_dims[1])
+                        continue;
+                    for (int kw = 0; kw < fw; ++kw)
+                    {
+                        int const iw = w0 + kw * p.dilations[2];
+                        if (iw < 0 || iw >= p.x_dims[2])
+                            continue;
+                        acc += convert_compute_type<Acc>(
+                                   xp[id * p.x_strides[2] + ih * p.x_strides[3]
+                                      + iw * p.x_strides[4]])
+                               * convert_compute_type<Acc>(
+                                   wp[(kd * fh + kh) * fw + kw]);
+                    }
+                }
+            }
+        }
+
+        DataType* const yp = y + n * p.y_strides[0] + k * p.y_strides[1]
+                             + od * p.y_strides[2] + oh * p.y_strides[3]
+                             + ow * p.y_strides[4];
+        Acc v = alpha * acc;
+        if (beta != Acc(0))
+            v += beta * convert_compute_type<Acc>(*yp);
+        *yp = convert_compute_type<DataType>(v);
+    }
+}
+
+template <int FD, int FH, int FW, typename DataType>
+void launch_forward(Params const& p,
+                    DataType alpha,
+                    DataType beta,
+                    DataType const* x,
+                    DataType const* w,
+                    DataType* y,
+                    int64_t num_outputs,
+                    h2::gpu::DeviceStream stream)
+{
+    // Grid-stride loops cover the rest of large outputs.
+    int64_t const max_blocks = int64_t{1} << 20;
+    int64_t const num_blocks =
+        std::min(util::ceil<int64_t>(num_outputs, block_size), max_blocks);
+    forward_kernel<FD, FH, FW, DataType>
+        <<<num_blocks, block_size, 0, stream>>>(
+            p,
+            convert_compute_type<AccType<DataType>>(alpha),
+            convert_compute_type<AccType<DataType>>(beta),
+            x,
+            w,
+            y,
+            num_outputs);
+    DISTCONV_CHECK_GPU(GPU_GET_LAST_ERROR());
+}
+
+// Geometry of a convolution as given by its descriptors (in N, C, D,
+// H, W order).
+struct Geometry
+{
+    std::vector<int> x_dims, x_strides, y_dims, y_strides, w_dims;
+    std::vector<int> pads, strides, dilations;
+    int num_groups;
+    GPUDNNBackend::ConvolutionMode_t mode;
+};
+
+// Returns false if the convolution is not 2-D or 3-D.
+bool get_geometry(GPUDNNBackend::TensorDescriptor_t const& x_desc,
+                  GPUDNNBackend::FilterDescriptor_t const& w_desc,
+                  GPUDNNBackend::ConvolutionDescriptor_t const& conv_desc,
+                  GPUDNNBackend::TensorDescriptor_t const& y_desc,
+                  Geometry& g)
+{
+    GPUDNNBackend::DataType_t dt;
+    GPUDNNBackend::get_tensor_descriptor(x_desc, dt, g.x_dims, g.x_strides);
+    int const nd = g.x_dims.size();
+    if (nd != 4 && nd != 5)
+        return false;
+    GPUDNNBackend::get_tensor_descriptor(y_desc, dt, g.y_dims, g.y_strides);
+    if ((int) g.y_dims.size() != nd)
+        return false;
+    g.w_dims.resize(nd);
+    GPUDNNBackend::get_filter_descriptor(w_desc, dt, nd, g.w_dims.data());
+    g.pads.resize(nd - 2);
+    g.strides.resize(nd - 2);
+    g.dilations.resize(nd - 2);
+    GPUDNNBackend::get_convolution_descriptor(conv_desc,
+                                              nd - 2,
+                                              g.pads.data(),
+                                              g.strides.data(),
+                                              g.dilations.data(),
+                                              g.num_groups,
+                                              g.mode,
+                                              dt);
+    return true;
+}
+
+} // namespace
+
+namespace distconv
+{
+namespace depthwise_convolution
+{
+
+bool is_supported(GPUDNNBackend::TensorDescriptor_t const& x_desc,
+                  GPUDNNBackend::FilterDescriptor_t const& w_desc,
+                  GPUDNNBackend::ConvolutionDescriptor_t const& conv_desc,
+                  GPUDNNBackend::TensorDescriptor_t const& y_desc)
+{
+    Geometry g;
+    if (!get_geometry(x_desc, w_desc, conv_desc, y_desc, g))
+        return false;
+    int const num_channels = g.x_dims[1];
+    int const num_filters = g.y_dims[1];
+    return g.mode == GPUDNNBackend::default_conv_mode
+           && g.num_groups == num_channels && g.w_dims[1] == 1
+           && g.w_dims[0] == num_filters && num_filters % num_channels == 0
+           && g.x_dims[0] == g.y_dims[0];
+}
+
+template <typename DataType>
+void forward(DataType alpha,
+             GPUDNNBackend::TensorDescriptor_t const& x_desc,
+             DataType const* x,
+             GPUDNNBackend::FilterDescriptor_t const& w_desc,
+             DataType const* w,
+             GPUDNNBackend::ConvolutionDescriptor_t const& conv_desc,
+             DataType beta,
+             GPUDNNBackend::TensorDescriptor_t const& y_desc,
+             DataType* y,
+             h2::gpu::DeviceStream stream)
+{
+    Geometry g;
+    assert_always(get_geometry(x_desc, w_desc, conv_desc, y_desc, g));
+    int const nd = g.x_dims.size();
+    // 2-D convolutions are computed as 3-D ones with a depth of 1.
+    int const spatial_offset = 5 - nd;
+
+    Params p;
+    p.num_samples = g.x_dims[0];
+    p.num_channels = g.x_dims[1];
+    p.multiplier = g.y_dims[1] / g.x_dims[1];
+    for (int i = 0; i < 3; ++i)
+    {
+        p.x_dims[i] = 1;
+        p.y_dims[i] = 1;
+        p.w_dims[i] = 1;
+        p.pads[i] = 0;
+        p.strides[i] = 1;
+        p.dilations[i] = 1;
+    }
+    for (int i = 0; i < nd - 2; ++i)
+    {
+        int const j = i + spatial_offset;
+        p.x_dims[j] = g.x_dims[i + 2];
+        p.y_dims[j] = g.y_dims[i + 2];
+        p.w_dims[j] = g.w_dims[i + 2];
+        p.pads[j] = g.pads[i];
+        p.strides[j] = g.strides[i];
+        p.dilations[j] = g.dilations[i];
+    }
+    p.x_strides[0] = g.x_strides[0];
+    p.x_strides[1] = g.x_strides[1];
+    p.y_strides[0] = g.y_strides[0];
+    p.y_strides[1] = g.y_strides[1];
+    // The unused depth stride of 2-D convolutions is never scaled by a
+    // non-zero index.
+    p.x_strides[2] = nd == 5 ? g.x_strides[2] : 0;
+    p.y_strides[2] = nd == 5 ? g.y_strides[2] : 0;
+    for (int i = 3; i < 5; ++i)
+    {
+        p.x_strides[i] = g.x_strides[i - spatial_offset];
+        p.y_strides[i] = g.y_strides[i - spatial_offset];
+    }
+
+    int64_t const num_outputs = (int64_t) p.num_samples * p.num_channels
+                                * p.multiplier * p.y_dims[0] * p.y_dims[1]
+                                * p.y_dims[2];
+    if (num_outputs == 0)
+        return;
+
+    int const fd = p.w_dims[0], fh = p.w_dims[1], fw = p.w_dims[2];
+    if (fd == 1 && fh == 3 && fw == 3)
+        launch_forward<1, 3, 3>(p, alpha, beta, x, w, y, num_outputs, stream);
+    else if (fd == 1 && fh == 5 && fw == 5)
+        launch_forward<1, 5, 5>(p, alpha, beta, x, w, y, num_outputs, stream);
+    else if (fd == 1 && fh == 7 && fw == 7)
+        launch_forward<1, 7, 7>(p, alpha, beta, x, w, y, num_outputs, stream);
+    else if (fd == 3 && fh == 3 && fw == 3)
+        launch_forward<3, 3, 3>(p, alpha, beta, x, w, y, num_outputs, stream);
+    else
+        launch_forward<0, 0, 0>(p, alpha, beta, x, w, y, num_outputs, stream);
+}
+
+#define INSTANTIATE_TEMPLATES(TYPE)                                            \
+    template void forward<TYPE>(                                               \
+        TYPE alpha,                                                            \
+        GPUDNNBackend::TensorDescriptor_t const& x_desc,                       \
+        TYPE const* x,                                                         \
+        GPUDNNBackend::FilterDescriptor_t const& w_desc,                       \
+        TYPE const* w,                                                         \
+        GPUDNNBackend::ConvolutionDescriptor_t const& conv_desc,               \
+        TYPE beta,                                                             \
+        GPUDNNBackend::TensorDescriptor_t const& y_desc,                       \
+        TYPE* y,                                                               \
+        h2::gpu::DeviceStream stream)
+INSTANTIATE_TEMPLATES(float);
+INSTANTIATE_TEMPLATES(double);
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_TEMPLATES(h2::gpu::Half);
+INSTANTIATE_TEMPLATES(h2::gpu::BFloat16);
+#endif // H2_HAS_GPU_LOW_PRECISION
+#undef INSTANTIATE_TEMPLATES
+
+} // namespace depthwise_convolution
+} // namespace distconv
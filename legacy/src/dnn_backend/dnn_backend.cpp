@@ -11,7 +11,7 @@
 #include "distconv/dnn_backend/pack_unpack.hpp"
 #include "h2/gpu/runtime.hpp"
 
-#include <functional> // std::multiplies
+#include <functional> // std::function, std::multiplies
 #include <memory>     // std::make_shared
 #include <numeric>    // std::exclusive_scan
 #include <ostream>    // std::ostream
@@ -60,6 +60,74 @@ size_t getenv_num_streams(size_t default_nstreams = 8)
         nstreams = std::stoul(env);
     return std::max(nstreams, static_cast<size_t>(0UL));
 }
+
+std::string get_dnn_library_version()
+{
+#if H2_HAS_ROCM
+    return util::get_miopen_version_number_string();
+#elif H2_HAS_CUDA
+    return util::get_cudnn_version_number_string();
+#endif
+}
+
+void append_ints(std::ostream& os, int const* vals, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        os << (i ? "," : "") << vals[i];
+}
+
+// Key of the autotuning results of a convolution pass, with x the
+// input of the forward pass and y its output.
+template <typename VendorBackendT>
+std::string make_autotune_key(
+    char const* pass,
+    typename VendorBackendT::TensorDescriptor_t const& x_desc,
+    typename VendorBackendT::FilterDescriptor_t const& w_desc,
+    typename VendorBackendT::ConvolutionDescriptor_t const& conv_desc,
+    typename VendorBackendT::TensorDescriptor_t const& y_desc,
+    size_t ws_size)
+{
+    std::ostringstream key;
+    key << pass << "|" << h2::gpu::device_name() << "|"
+        << get_dnn_library_version();
+    for (auto const* desc : {&x_desc, &y_desc})
+    {
+        typename VendorBackendT::DataType_t dt;
+        std::vector<int> dims, strides;
+        VendorBackendT::get_tensor_descriptor(*desc, dt, dims, strides);
+        key << "|" << static_cast<int>(dt) << ":";
+        append_ints(key, dims.data(), dims.size());
+        key << ":";
+        append_ints(key, strides.data(), strides.size());
+    }
+    int const nd = VendorBackendT::get_tensor_num_dimensions(x_desc);
+    std::vector<int> dims(nd);
+    typename VendorBackendT::DataType_t dt;
+    VendorBackendT::get_filter_descriptor(w_desc, dt, nd, dims.data());
+    key << "|" << static_cast<int>(dt) << ":";
+    append_ints(key, dims.data(), dims.size());
+
+    std::vector<int> pads(nd - 2), strides(nd - 2), dilations(nd - 2);
+    int ngrps;
+    typename VendorBackendT::ConvolutionMode_t mode;
+    VendorBackendT::get_convolution_descriptor(conv_desc,
+                                               nd - 2,
+                                               pads.data(),
+                                               strides.data(),
+                                               dilations.data(),
+                                               ngrps,
+                                               mode,
+                                               dt);
+    key << "|";
+    append_ints(key, pads.data(), pads.size());
+    key << ":";
+    append_ints(key, strides.data(), strides.size());
+    key << ":";
+    append_ints(key, dilations.data(), dilations.size());
+    key << ":" << ngrps << ":" << static_cast<int>(mode) << "|" << ws_size;
+    return key.str();
+}
+
 } // namespace
 
 template <typename VendorBackendT>
@@ -70,7 +138,10 @@ DNNBackend<VendorBackendT>::DNNBackend(MPI_Comm comm,
       m_handle{handle},
       m_stream_mgr{getenv_num_streams(/*default_nstreams=*/8UL)},
       m_comms{comm, m_stream_mgr}
-{}
+{
+    if (!m_opts.autotune_cache_path.empty())
+        AutotuneCache::instance().load(m_opts.autotune_cache_path, comm);
+}
 
 template <typename VendorBackendT>
 DNNBackend<VendorBackendT>::DNNBackend(MPI_Comm comm,
@@ -81,7 +152,10 @@ DNNBackend<VendorBackendT>::DNNBackend(MPI_Comm comm,
       m_handle{handle},
       m_stream_mgr{getenv_num_streams(/*default_nstreams=*/8UL), stream},
       m_comms{comm, m_stream_mgr}
-{}
+{
+    if (!m_opts.autotune_cache_path.empty())
+        AutotuneCache::instance().load(m_opts.autotune_cache_path, comm);
+}
 
 template <typename VendorBackendT>
 DNNBackend<VendorBackendT>::~DNNBackend()
@@ -179,6 +253,16 @@ void DNNBackend<VendorBackendT>::wait() const
     h2::gpu::sync(this->get_stream());
 }
 
+template <typename VendorBackendT>
+void DNNBackend<VendorBackendT>::run_graphed(std::string const& key,
+                                             std::string const& signature,
+                                             std::function<void()> const& f)
+{
+    if (!graph_capture())
+        return f();
+    m_graphs.run(key, signature, this->get_stream(), f);
+}
+
 template <typename VendorBackendT>
 void DNNBackend<VendorBackendT>::activation_forward(
     ActivationDescriptor_t const& act_desc,
@@ -401,15 +485,23 @@ auto DNNBackend<VendorBackendT>::get_fwd_algorithm(
     }
     else if (name == "AUTOTUNE")
     {
-        return GPUDNNBackend::get_fwd_algorithm_by_autotune(this->get_handle(),
-                                                            input_desc,
-                                                            input,
-                                                            filter_desc,
-                                                            filter,
-                                                            conv_desc,
-                                                            output_desc,
-                                                            output,
-                                                            ws_size);
+        auto const key = make_autotune_key<VendorBackendT>(
+            "fwd", input_desc, filter_desc, conv_desc, output_desc, ws_size);
+        int cached;
+        if (AutotuneCache::instance().find(key, cached))
+            return static_cast<ConvFwdAlgo_t>(cached);
+        auto const algo =
+            GPUDNNBackend::get_fwd_algorithm_by_autotune(this->get_handle(),
+                                                         input_desc,
+                                                         input,
+                                                         filter_desc,
+                                                         filter,
+                                                         conv_desc,
+                                                         output_desc,
+                                                         output,
+                                                         ws_size);
+        AutotuneCache::instance().insert(key, static_cast<int>(algo));
+        return algo;
     }
     // Handles "DETERMINISTIC"
     return GPUDNNBackend::get_fwd_algorithm_by_name(name);
@@ -441,7 +533,16 @@ auto DNNBackend<VendorBackendT>::get_bwd_data_algorithm(
     }
     else if (name == "AUTOTUNE")
     {
-        return GPUDNNBackend::get_bwd_data_algorithm_by_autotune(
+        auto const key = make_autotune_key<VendorBackendT>("bwd_data",
+                                                           d_input_desc,
+                                                           filter_desc,
+                                                           conv_desc,
+                                                           d_output_desc,
+                                                           ws_size);
+        int cached;
+        if (AutotuneCache::instance().find(key, cached))
+            return static_cast<ConvBwdDataAlgo_t>(cached);
+        auto const algo = GPUDNNBackend::get_bwd_data_algorithm_by_autotune(
             this->get_handle(),
             filter_desc,
             filter,
@@ -451,6 +552,8 @@ auto DNNBackend<VendorBackendT>::get_bwd_data_algorithm(
             d_input_desc,
             d_input,
             ws_size);
+        AutotuneCache::instance().insert(key, static_cast<int>(algo));
+        return algo;
     }
     return GPUDNNBackend::get_bwd_data_algorithm_by_name(name);
 }
@@ -480,7 +583,16 @@ auto DNNBackend<VendorBackendT>::get_bwd_filter_algorithm(
     }
     else if (name == "AUTOTUNE")
     {
-        return GPUDNNBackend::get_bwd_filter_algorithm_by_autotune(
+        auto const key = make_autotune_key<VendorBackendT>("bwd_filter",
+                                                           input_desc,
+                                                           d_filter_desc,
+                                                           conv_desc,
+                                                           d_output_desc,
+                                                           ws_size);
+        int cached;
+        if (AutotuneCache::instance().find(key, cached))
+            return static_cast<ConvBwdFilterAlgo_t>(cached);
+        auto const algo = GPUDNNBackend::get_bwd_filter_algorithm_by_autotune(
             this->get_handle(),
             input_desc,
             input,
@@ -490,10 +602,78 @@ auto DNNBackend<VendorBackendT>::get_bwd_filter_algorithm(
             d_filter_desc,
             d_filter,
             ws_size);
+        AutotuneCache::instance().insert(key, static_cast<int>(algo));
+        return algo;
     }
     return GPUDNNBackend::get_bwd_filter_algorithm_by_name(name);
 }
 
+template <typename VendorBackendT>
+void DNNBackend<VendorBackendT>::autotune_distributed(
+    std::vector<ConvAutotuneProblem> const& problems, MPI_Comm comm) const
+{
+    using Pass = typename ConvAutotuneProblem::Pass;
+    std::vector<std::pair<std::string, AutotuneCache::Tuner>> tuners;
+    tuners.reserve(problems.size());
+    for (auto const& p : problems)
+    {
+        char const* const pass =
+            p.pass == Pass::FWD
+                ? "fwd"
+                : (p.pass == Pass::BWD_DATA ? "bwd_data" : "bwd_filter");
+        auto key = make_autotune_key<VendorBackendT>(
+            pass, p.x_desc, p.w_desc, p.conv_desc, p.y_desc, p.ws_size);
+        tuners.emplace_back(std::move(key), [this, &p]() -> int {
+            auto const handle = this->get_handle();
+            switch (p.pass)
+            {
+            case Pass::FWD:
+                return GPUDNNBackend::get_fwd_algorithm_by_autotune(
+                    handle,
+                    p.x_desc,
+                    p.x,
+                    p.w_desc,
+                    p.w,
+                    p.conv_desc,
+                    p.y_desc,
+                    p.y,
+                    p.ws_size);
+            case Pass::BWD_DATA:
+                return GPUDNNBackend::get_bwd_data_algorithm_by_autotune(
+                    handle,
+                    p.w_desc,
+                    p.w,
+                    p.y_desc,
+                    p.y,
+                    p.conv_desc,
+                    p.x_desc,
+                    p.x,
+                    p.ws_size);
+            case Pass::BWD_FILTER:
+            default:
+                return GPUDNNBackend::get_bwd_filter_algorithm_by_autotune(
+                    handle,
+                    p.x_desc,
+                    p.x,
+                    p.y_desc,
+                    p.y,
+                    p.conv_desc,
+                    p.w_desc,
+                    p.w,
+                    p.ws_size);
+            }
+        });
+    }
+    AutotuneCache::instance().tune_distributed(tuners, comm);
+}
+
+template <typename VendorBackendT>
+void DNNBackend<VendorBackendT>::autotune_distributed(
+    std::vector<ConvAutotuneProblem> const& problems) const
+{
+    autotune_distributed(problems, this->get_comm());
+}
+
 template <typename VendorBackendT>
 void DNNBackend<VendorBackendT>::convolution_forward(
     double const alpha,
@@ -764,6 +944,55 @@ void DNNBackend<VendorBackendT>::apply_bwd_bias(
                                    db_proxy.ptr());
 }
 
+template <typename VendorBackendT>
+bool DNNBackend<VendorBackendT>::convolution_bias_activation_forward(
+    double const alpha,
+    TensorDescriptor_t const& xdesc,
+    void const* const x,
+    FilterDescriptor_t const& filter_desc,
+    void const* const filter_data,
+    ConvolutionDescriptor_t const& conv_desc,
+    ConvFwdAlgo_t const& conv_algo,
+    void* const workspace,
+    size_t const workspace_bytes,
+    double const beta,
+    TensorDescriptor_t const& bias_desc,
+    void const* const bias,
+    ActivationDescriptor_t const& act_desc,
+    TensorDescriptor_t const& ydesc,
+    void* const y) const
+{
+    auto const handle = this->get_handle();
+
+    auto const dt = GPUDNNBackend::get_tensor_datatype(xdesc);
+    auto const a = make_host_scalar(dt, alpha);
+    auto const b = make_host_scalar(dt, beta);
+
+    auto input_proxy = read_proxy(handle, xdesc, x);
+    auto bias_proxy = read_proxy(handle, bias_desc, bias);
+    // y is also the z input, so it is added with a scale of beta.
+    auto output_proxy = write_proxy(handle, ydesc, y, beta);
+    return VendorBackendT::convolution_bias_activation_forward(
+        handle,
+        a.get(),
+        input_proxy.desc(),
+        input_proxy.ptr(),
+        filter_desc,
+        filter_data,
+        conv_desc,
+        conv_algo,
+        workspace,
+        workspace_bytes,
+        b.get(),
+        output_proxy.desc(),
+        output_proxy.ptr(),
+        bias_proxy.desc(),
+        bias_proxy.ptr(),
+        act_desc,
+        output_proxy.desc(),
+        output_proxy.ptr());
+}
+
 template <typename VendorBackendT>
 void DNNBackend<VendorBackendT>::pooling_forward(
     PoolingDescriptor_t const& pooling_desc,
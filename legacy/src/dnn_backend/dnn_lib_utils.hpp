@@ -37,17 +37,22 @@ inline host_scalar make_host_scalar(GPUDNNBackend::DataType_t const dt,
     switch (dt)
     {
     case CUDNN_DATA_HALF: [[fallthrough]];
+    case CUDNN_DATA_BFLOAT16: [[fallthrough]];
     case CUDNN_DATA_FLOAT: return host_scalar{static_cast<float>(v)};
     case CUDNN_DATA_DOUBLE: return host_scalar{v};
     default:
-        throw std::runtime_error("Only float, double, and half are supported.");
+        throw std::runtime_error(
+            "Only float, double, half, and bfloat16 are supported.");
     }
 #elif H2_HAS_ROCM
     switch (dt)
     {
     case miopenHalf: [[fallthrough]];
+    case miopenBFloat16: [[fallthrough]];
     case miopenFloat: return host_scalar{static_cast<float>(v)};
-    default: throw std::runtime_error("Only float and half are supported.");
+    default:
+        throw std::runtime_error(
+            "Only float, half, and bfloat16 are supported.");
     }
 #endif
 }
@@ -71,16 +76,21 @@ inline size_t datatype_size(GPUDNNBackend::DataType_t dt)
     {
     case CUDNN_DATA_FLOAT: return sizeof(float);
     case CUDNN_DATA_DOUBLE: return sizeof(double);
-    case CUDNN_DATA_HALF: return sizeof(short);
+    case CUDNN_DATA_HALF: [[fallthrough]];
+    case CUDNN_DATA_BFLOAT16: return sizeof(short);
     default:
-        throw std::runtime_error("Only float, double, and half are supported.");
+        throw std::runtime_error(
+            "Only float, double, half, and bfloat16 are supported.");
     }
 #elif H2_HAS_ROCM
     switch (dt)
     {
-    case miopenHalf: return sizeof(short);
+    case miopenHalf: [[fallthrough]];
+    case miopenBFloat16: return sizeof(short);
     case miopenFloat: return sizeof(float);
-    default: throw std::runtime_error("Only float and half are supported.");
+    default:
+        throw std::runtime_error(
+            "Only float, half, and bfloat16 are supported.");
     }
 #endif
     return 1UL;
@@ -0,0 +1,69 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "distconv/dnn_backend/dnn_backend.hpp"
+#include "distconv/util/util_mpi.hpp"
+
+#include <exception> // std::exception
+#include <string>    // std::string
+
+namespace distconv
+{
+
+void LayerGraphCache::run(std::string const& key,
+                          std::string const& signature,
+                          h2::gpu::DeviceStream stream,
+                          std::function<void()> const& f)
+{
+    auto& pass = m_passes[key];
+    if (pass.signature != signature)
+    {
+        pass.graph.reset();
+        pass.signature = signature;
+        pass.num_runs = 0;
+        if (++pass.num_signatures == max_signatures + 1)
+        {
+            util::MPIPrintStreamDebug()
+                << "Not capturing " << key << " as its signature keeps "
+                << "changing";
+        }
+    }
+    if (pass.num_signatures > max_signatures || pass.num_runs++ == 0)
+        return f();
+
+    // Graphs use the workspace buffer they were captured with.
+    size_t const ws_capacity = WorkspaceArena::instance().capacity(stream);
+    if (pass.graph.is_captured() && pass.ws_capacity != ws_capacity)
+        pass.graph.reset();
+
+    h2::ComputeStream const compute_stream(stream);
+    if (!pass.graph.is_captured())
+    {
+        try
+        {
+            pass.graph = h2::capture_graph(compute_stream, f);
+        }
+        catch (std::exception const& e)
+        {
+            // Nothing was enqueued, so run the pass without a graph,
+            // now and from then on.
+            util::MPIPrintStreamWarning()
+                << "Failed to capture " << key << ": " << e.what();
+            pass.num_signatures = max_signatures + 1;
+            return f();
+        }
+        pass.ws_capacity = ws_capacity;
+    }
+    pass.graph.replay(compute_stream);
+}
+
+void LayerGraphCache::clear()
+{
+    m_passes.clear();
+}
+
+} // namespace distconv
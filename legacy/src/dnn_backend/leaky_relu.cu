@@ -1,9 +1,16 @@
 #include "distconv/dnn_backend/leaky_relu.hpp"
 #include "distconv/tensor/algorithms_cuda.hpp"
 #include "distconv/tensor/tensor_mpi.hpp"
+#include "distconv/util/util_gpu.hpp"
+#include "h2/core/low_precision.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/loops/gpu_loops.cuh"
+
+#include <utility>
 
 using distconv::tensor::CUDAAllocator;
 using distconv::tensor::LocaleMPI;
+using h2::convert_compute_type;
 
 template <typename DataType>
 using Tensor = distconv::tensor::Tensor<DataType, LocaleMPI, CUDAAllocator>;
@@ -11,38 +18,92 @@ using Tensor = distconv::tensor::Tensor<DataType, LocaleMPI, CUDAAllocator>;
 namespace
 {
 
+// The 16-bit types are computed in float.
+template <typename DataType>
+using AccType = distconv::util::AccumulationType<DataType>;
+
 template <typename DataType>
 struct ForwardFunctor
 {
-    DataType m_negative_slope;
-    ForwardFunctor(DataType negative_slope) : m_negative_slope(negative_slope)
+    AccType<DataType> m_negative_slope;
+    ForwardFunctor(DataType negative_slope)
+        : m_negative_slope(
+              convert_compute_type<AccType<DataType>>(negative_slope))
     {}
     __device__ void operator()(const DataType& x, DataType& y)
     {
-        auto factor = (x > 0) ? (DataType) 1 : m_negative_slope;
-        y = x * factor;
+        auto const x_acc = convert_compute_type<AccType<DataType>>(x);
+        auto factor = (x_acc > 0) ? (AccType<DataType>) 1 : m_negative_slope;
+        y = convert_compute_type<DataType>(x_acc * factor);
     }
 };
 
 template <typename DataType>
 struct BackwardFunctor
 {
-    DataType m_negative_slope;
-    BackwardFunctor(DataType negative_slope) : m_negative_slope(negative_slope)
+    AccType<DataType> m_negative_slope;
+    BackwardFunctor(DataType negative_slope)
+        : m_negative_slope(
+              convert_compute_type<AccType<DataType>>(negative_slope))
     {}
     __device__ void
     operator()(const DataType& x, const DataType& y, DataType& dx)
     {
-        auto factor = (x > 0) ? (DataType) 1 : m_negative_slope;
-        dx = y * factor;
+        auto factor = (convert_compute_type<AccType<DataType>>(x) > 0)
+                          ? (AccType<DataType>) 1
+                          : m_negative_slope;
+        dx = convert_compute_type<DataType>(
+            convert_compute_type<AccType<DataType>>(y) * factor);
     }
 };
 
+template <typename DataType>
+struct BackwardAccumulateFunctor
+{
+    AccType<DataType> m_negative_slope;
+    AccType<DataType> m_beta;
+    BackwardAccumulateFunctor(DataType negative_slope, DataType beta)
+        : m_negative_slope(
+              convert_compute_type<AccType<DataType>>(negative_slope)),
+          m_beta(convert_compute_type<AccType<DataType>>(beta))
+    {}
+    __device__ void
+    operator()(const DataType& x, const DataType& y, DataType& dx)
+    {
+        auto factor = (convert_compute_type<AccType<DataType>>(x) > 0)
+                          ? (AccType<DataType>) 1
+                          : m_negative_slope;
+        dx = convert_compute_type<DataType>(
+            convert_compute_type<AccType<DataType>>(y) * factor
+            + m_beta * convert_compute_type<AccType<DataType>>(dx));
+    }
+};
+
+// Returns true if the local data of tensor is stored densely, i.e.,
+// it has no halo and no row padding, so that it can be processed as a
+// flat, vectorizable buffer.
+template <typename TensorType>
+bool is_local_dense(TensorType const& tensor)
+{
+    auto const real_shape = tensor.get_local_real_shape();
+    return real_shape == tensor.get_local_shape()
+           && tensor.get_pitch() == static_cast<size_t>(real_shape[0]);
+}
+
+template <typename TensorType, typename... Tensors>
+bool are_local_dense(TensorType const& tensor, Tensors const&... tensors)
+{
+    return is_local_dense(tensor)
+           && ((is_local_dense(tensors)
+                && tensors.get_local_shape() == tensor.get_local_shape())
+               && ...);
+}
+
 } // namespace
 
-// input should be const, but Transform is not polymorphic with
-// respect to constness of tensor parameters. All of tensors need to
-// be non-const.
+// input should be const, but is kept non-const for compatibility.
+// Read-only tensors are passed to Transform as const so that they are
+// not written back.
 template <typename TensorType>
 void distconv::leaky_relu::forward(
     TensorType& input,
@@ -51,8 +112,29 @@ void distconv::leaky_relu::forward(
     h2::gpu::DeviceStream stream)
 {
     using DataType = typename TensorType::data_type;
-    tensor::Transform(
-        input, output, ForwardFunctor<DataType>(negative_slope), stream);
+    using ComputeType = AccType<DataType>;
+    // Dense buffers go through the vectorized H2 loop, which also
+    // handles input and output being the same tensor.
+    if (are_local_dense(input, output))
+    {
+        auto const slope = convert_compute_type<ComputeType>(negative_slope);
+        auto const func = [slope] H2_GPU_LAMBDA(DataType const x) -> DataType {
+            auto const x_acc = convert_compute_type<ComputeType>(x);
+            return convert_compute_type<DataType>(
+                x_acc * ((x_acc > 0) ? (ComputeType) 1 : slope));
+        };
+        h2::gpu::launch_elementwise_loop(
+            func,
+            h2::ComputeStream(stream),
+            input.get_local_size(),
+            output.get_buffer(),
+            static_cast<DataType const*>(input.get_buffer()));
+        return;
+    }
+    tensor::Transform(std::as_const(input),
+                      output,
+                      ForwardFunctor<DataType>(negative_slope),
+                      stream);
     return;
 }
 
@@ -62,14 +144,80 @@ void distconv::leaky_relu::backward(
     TensorType& d_output,
     typename TensorType::data_type negative_slope,
     TensorType& d_input,
-    h2::gpu::DeviceStream stream)
+    h2::gpu::DeviceStream stream,
+    typename TensorType::data_type beta)
 {
     using DataType = typename TensorType::data_type;
-    tensor::Transform(input,
-                      d_output,
-                      d_input,
-                      BackwardFunctor<DataType>(negative_slope),
-                      stream);
+    using ComputeType = AccType<DataType>;
+    bool const accumulate = convert_compute_type<ComputeType>(beta) != 0;
+    // With beta != 0, the gradient is accumulated into d_input in the
+    // same pass instead of a separate read-modify-write. d_input may
+    // alias d_output.
+    if (are_local_dense(input, d_output, d_input))
+    {
+        h2::ComputeStream const compute_stream(stream);
+        DataType* const dx = d_input.get_buffer();
+        DataType const* const x = input.get_buffer();
+        DataType const* const dy = d_output.get_buffer();
+        auto const slope = convert_compute_type<ComputeType>(negative_slope);
+        if (!accumulate)
+        {
+            auto const func =
+                [slope] H2_GPU_LAMBDA(DataType const x_i,
+                                      DataType const dy_i) -> DataType {
+                auto const factor =
+                    (convert_compute_type<ComputeType>(x_i) > 0)
+                        ? (ComputeType) 1
+                        : slope;
+                return convert_compute_type<DataType>(
+                    convert_compute_type<ComputeType>(dy_i) * factor);
+            };
+            h2::gpu::launch_elementwise_loop(
+                func, compute_stream, input.get_local_size(), dx, x, dy);
+        }
+        else
+        {
+            auto const acc_beta = convert_compute_type<ComputeType>(beta);
+            auto const func =
+                [slope, acc_beta] H2_GPU_LAMBDA(DataType const x_i,
+                                                DataType const dy_i,
+                                                DataType const dx_i)
+                -> DataType {
+                auto const factor =
+                    (convert_compute_type<ComputeType>(x_i) > 0)
+                        ? (ComputeType) 1
+                        : slope;
+                return convert_compute_type<DataType>(
+                    convert_compute_type<ComputeType>(dy_i) * factor
+                    + acc_beta * convert_compute_type<ComputeType>(dx_i));
+            };
+            h2::gpu::launch_elementwise_loop(func,
+                                             compute_stream,
+                                             input.get_local_size(),
+                                             dx,
+                                             x,
+                                             dy,
+                                             static_cast<DataType const*>(dx));
+        }
+        return;
+    }
+    if (!accumulate)
+    {
+        tensor::Transform(std::as_const(input),
+                          std::as_const(d_output),
+                          d_input,
+                          BackwardFunctor<DataType>(negative_slope),
+                          stream);
+    }
+    else
+    {
+        tensor::Transform(
+            std::as_const(input),
+            std::as_const(d_output),
+            d_input,
+            BackwardAccumulateFunctor<DataType>(negative_slope, beta),
+            stream);
+    }
     return;
 }
 
@@ -84,6 +232,11 @@ void distconv::leaky_relu::backward(
         Tensor<TYPE> & d_output,                                               \
         TYPE negative_slope,                                                   \
         Tensor<TYPE> & output,                                                 \
-        h2::gpu::DeviceStream stream)
+        h2::gpu::DeviceStream stream,                                          \
+        TYPE beta)
 INSTANTIATE_TEMPLATES(float);
 INSTANTIATE_TEMPLATES(double);
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_TEMPLATES(h2::gpu::Half);
+INSTANTIATE_TEMPLATES(h2::gpu::BFloat16);
+#endif // H2_HAS_GPU_LOW_PRECISION
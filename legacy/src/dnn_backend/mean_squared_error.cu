@@ -7,14 +7,6 @@
 
 #include <limits>
 
-#if H2_HAS_CUDA
-#include <cub/block/block_reduce.cuh>
-namespace cubns = cub;
-#elif H2_HAS_ROCM
-#include <hipcub/block/block_reduce.hpp>
-namespace cubns = hipcub;
-#endif
-
 using distconv::tensor::CUDAAllocator;
 using distconv::tensor::LocaleMPI;
 
@@ -29,14 +21,20 @@ namespace
 /*
   - gridDim.y == number of samples
   - Each sample is taken care by gridDim.x blocks
+
+  Block x of sample s sums the squared errors of its chunk of the
+  sample with a fixed-order shared memory tree and, when gridDim.x > 1,
+  writes the scaled sum to partials[s * gridDim.x + x]; a single block
+  writes y[s] directly. The error is never stored, and no atomics are
+  used, so the result does not depend on the scheduling of blocks.
 */
 template <typename DataType, int BLOCK_SIZE>
 __global__ void fp_local(const DataType* __restrict__ prediction,
                          const DataType* __restrict__ ground_truth,
+                         DataType* __restrict__ partials,
                          DataType* __restrict__ y,
                          const index_t sample_size,
-                         const index_t sample_spatial_size,
-                         const index_t sample_channel_size,
+                         const DataType scale,
                          int thread_work_size)
 {
     const int tid = threadIdx.x;
@@ -45,13 +43,13 @@ __global__ void fp_local(const DataType* __restrict__ prediction,
     prediction += sample_idx * sample_size;
     ground_truth += sample_idx * sample_size;
 
-    index_t offset = tid + blockIdx.x * BLOCK_SIZE;
-    const int offset_stride = BLOCK_SIZE * gridDim.x;
+    index_t offset = tid + blockIdx.x * BLOCK_SIZE * thread_work_size;
     const index_t offset_limit =
-        min(sample_size, offset + offset_stride * thread_work_size);
+        min(sample_size,
+            (blockIdx.x + 1) * (index_t) BLOCK_SIZE * thread_work_size);
 
     auto psum = DataType(0.);
-    for (; offset < offset_limit; offset += offset_stride)
+    for (; offset < offset_limit; offset += BLOCK_SIZE)
     {
         const DataType x = prediction[offset];
         const DataType xhat = ground_truth[offset];
@@ -59,16 +57,50 @@ __global__ void fp_local(const DataType* __restrict__ prediction,
         psum += err * err;
     }
 
-    using BlockReduce = cubns::BlockReduce<DataType, BLOCK_SIZE>;
-    __shared__ typename BlockReduce::TempStorage temp_storage;
-    psum = BlockReduce(temp_storage).Sum(psum) / sample_size;
+    __shared__ DataType shm[BLOCK_SIZE];
+    shm[tid] = psum;
+    __syncthreads();
+    for (int stride = BLOCK_SIZE / 2; stride > 0; stride /= 2)
+    {
+        if (tid < stride)
+        {
+            shm[tid] += shm[tid + stride];
+        }
+        __syncthreads();
+    }
 
     if (tid == 0)
     {
-        atomic_add(&y[sample_idx], psum);
+        if (gridDim.x == 1)
+        {
+            y[sample_idx] = shm[0] * scale;
+        }
+        else
+        {
+            partials[sample_idx * gridDim.x + blockIdx.x] = shm[0] * scale;
+        }
     }
 }
 
+// Adds the partial sums of each sample in order.
+template <typename DataType>
+__global__ void fp_final(const DataType* __restrict__ partials,
+                         DataType* __restrict__ y,
+                         const index_t num_samples,
+                         const int num_partials)
+{
+    const index_t sample_idx = threadIdx.x + blockIdx.x * blockDim.x;
+    if (sample_idx >= num_samples)
+        return;
+    partials += sample_idx * num_partials;
+    auto sum = DataType(0.);
+    for (int i = 0; i < num_partials; ++i)
+    {
+        sum += partials[i];
+    }
+    y[sample_idx] = sum;
+}
+
 /*
   - gridDim.y == number of samples
   - Each sample is taken care by gridDim.x blocks
@@ -80,8 +112,7 @@ __global__ void bp_local(const DataType* __restrict__ x_pred,
                          DataType* __restrict__ dx_pred,
                          DataType* __restrict__ dx_truth,
                          const index_t sample_size,
-                         const index_t sample_spatial_size,
-                         const index_t sample_channel_size,
+                         const DataType scale,
                          int thread_work_size)
 {
     const int tid = threadIdx.x;
@@ -98,7 +129,6 @@ __global__ void bp_local(const DataType* __restrict__ x_pred,
         min(sample_size, offset + offset_stride * thread_work_size);
 
     const auto dy_sample = dy[sample_idx];
-    const DataType scale = static_cast<DataType>(DataType(2) / sample_size);
     for (; offset < offset_limit; offset += offset_stride)
     {
         const DataType x = x_pred[offset];
@@ -132,8 +162,6 @@ int MeanSquaredError<BackendDNNLib>::forward(const Tensor& x_pred,
     if (num_samples == 0)
         return 0;
 
-    y.zero(m_stream);
-
     if (x_pred.get_local_size() > 0)
     {
         auto sample_size = x_pred.get_local_size() / num_samples;
@@ -143,21 +171,53 @@ int MeanSquaredError<BackendDNNLib>::forward(const Tensor& x_pred,
         dim3 bdim(block_size);
         dim3 gdim(num_blocks_per_sample, num_samples);
 
-        const auto sample_channel_size =
-            x_pred.get_local_shape()[x_pred.get_num_spatial_dims()];
-        const auto sample_spatial_size = sample_size / sample_channel_size;
-        assert_eq(sample_channel_size * sample_spatial_size, sample_size);
+        // Scale by the global sample size so that the partial errors of
+        // the processes of a sample add up to its mean squared error
+        const auto global_sample_size =
+            x_pred.get_size() / x_pred.get_shape()[-1];
+        const auto scale =
+            static_cast<DataType>(DataType(1) / global_sample_size);
+
+        DataType* partials = nullptr;
+        auto& mempool = internal::RuntimeGPU::get_device_memory_pool();
+        if (num_blocks_per_sample > 1)
+        {
+            partials = static_cast<DataType*>(mempool.get(
+                sizeof(DataType) * num_samples * num_blocks_per_sample,
+                m_stream));
+        }
 
         fp_local<DataType, block_size>
             <<<gdim, bdim, 0, m_stream>>>(x_pred.get_const_buffer(),
                                           x_truth.get_const_buffer(),
+                                          partials,
                                           y.get_buffer(),
                                           sample_size,
-                                          sample_spatial_size,
-                                          sample_channel_size,
+                                          scale,
                                           thread_work_size);
+
+        if (num_blocks_per_sample > 1)
+        {
+            fp_final<DataType>
+                <<<util::ceil(num_samples, (index_t) block_size),
+                   block_size,
+                   0,
+                   m_stream>>>(partials,
+                               y.get_buffer(),
+                               num_samples,
+                               num_blocks_per_sample);
+            // The pool orders the reuse of the partials after the stream
+            mempool.release(partials);
+        }
+    }
+    else
+    {
+        // Still contribute to the reduction across the sample processes
+        y.zero(m_stream);
     }
 
+    // m_al is bound to m_stream, so the reduction is ordered after the
+    // local kernels without synchronizing the host
     if (m_num_procs_per_sample > 1)
     {
         Al::Allreduce<Al::NCCLBackend, DataType>(y.get_buffer(),
@@ -205,10 +265,8 @@ int MeanSquaredError<BackendDNNLib>::backward(const Tensor& x_pred,
     dim3 bdim(block_size);
     dim3 gdim(num_blocks_per_sample, num_samples);
 
-    const auto sample_channel_size =
-        x_pred.get_local_shape()[x_pred.get_num_spatial_dims()];
-    const auto sample_spatial_size = sample_size / sample_channel_size;
-    assert_eq(sample_channel_size * sample_spatial_size, sample_size);
+    const auto global_sample_size = x_pred.get_size() / x_pred.get_shape()[-1];
+    const auto scale = static_cast<DataType>(DataType(2) / global_sample_size);
 
     bp_local<DataType, block_size>
         <<<gdim, bdim, 0, m_stream>>>(x_pred.get_const_buffer(),
@@ -217,8 +275,7 @@ int MeanSquaredError<BackendDNNLib>::backward(const Tensor& x_pred,
                                       dx_pred.get_buffer(),
                                       dx_truth.get_buffer(),
                                       sample_size,
-                                      sample_spatial_size,
-                                      sample_channel_size,
+                                      scale,
                                       thread_work_size);
     return 0;
 }
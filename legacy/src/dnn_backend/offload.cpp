@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "distconv_config.hpp"
+
+#include "distconv/dnn_backend/offload.hpp"
+#include "distconv/runtime_gpu.hpp"
+#include "distconv/tensor/runtime_gpu.hpp"
+#include "distconv/util/util_mpi.hpp"
+#include "h2/gpu/memory_utils.hpp"
+
+#include <algorithm> // std::find
+#include <utility>   // std::move
+
+namespace distconv
+{
+
+OffloadManager::OffloadManager(h2::gpu::DeviceStream stream, int lookahead)
+    : m_stream{stream},
+      m_copy_stream{h2::gpu::make_stream_nonblocking()},
+      m_ready{h2::gpu::make_event_notiming()},
+      m_lookahead{lookahead}
+{
+    assert_always(m_lookahead >= 0);
+}
+
+OffloadManager::~OffloadManager()
+{
+    h2::gpu::sync(m_copy_stream);
+    auto& mempool = internal::RuntimeGPU::get_device_memory_pool();
+    auto& pinned_pool = tensor::internal::RuntimeGPU::get_pinned_memory_pool();
+    for (auto& e : m_entries)
+    {
+        // Prefetched buffers are used by the compute stream only after
+        // it waits for the copies, which are done.
+        if (e.device)
+        {
+            e.set_buffer(nullptr);
+            mempool.release(e.device);
+        }
+        if (e.host)
+            pinned_pool.release(e.host);
+        h2::gpu::destroy(e.event);
+    }
+    h2::gpu::destroy(m_ready);
+    h2::gpu::destroy(m_copy_stream);
+}
+
+int OffloadManager::add(size_t size, std::function<void(void*)> set_buffer)
+{
+    Entry e;
+    e.size = size;
+    e.set_buffer = std::move(set_buffer);
+    e.event = h2::gpu::make_event_notiming();
+    if (size > 0)
+    {
+        e.device =
+            internal::RuntimeGPU::get_device_memory_pool().get(size, m_stream);
+        e.set_buffer(e.device);
+    }
+    m_entries.push_back(std::move(e));
+    return static_cast<int>(m_entries.size()) - 1;
+}
+
+OffloadManager::Entry& OffloadManager::get_entry(int id)
+{
+    assert_always(id >= 0 && id < static_cast<int>(m_entries.size()));
+    return m_entries[id];
+}
+
+void OffloadManager::copy_after_compute(void* dst, const void* src, Entry& e)
+{
+    h2::gpu::record_event(m_ready, m_stream);
+    h2::gpu::sync(m_copy_stream, m_ready);
+    h2::gpu::mem_copy(dst, src, e.size, m_copy_stream);
+    h2::gpu::record_event(e.event, m_copy_stream);
+}
+
+void OffloadManager::offload(int id)
+{
+    auto& e = get_entry(id);
+    assert_always(e.state == State::DEVICE);
+    if (e.size == 0)
+        return;
+    if (e.host == nullptr)
+    {
+        // Kept across iterations
+        e.host =
+            tensor::internal::RuntimeGPU::get_pinned_memory_pool().get(e.size);
+    }
+    util::MPIPrintStreamDebug()
+        << "Offloading activation " << id << " of " << e.size << " bytes";
+    copy_after_compute(e.host, e.device, e);
+    e.state = State::OFFLOADING;
+    m_offloading.push_back(id);
+    while (static_cast<int>(m_offloading.size()) > m_lookahead)
+    {
+        release_device(m_offloading.front());
+    }
+}
+
+void OffloadManager::release_device(int id)
+{
+    auto& e = m_entries[id];
+    if (e.state == State::OFFLOADING)
+    {
+        // Reuse of the buffer is ordered after the compute stream by
+        // the pool, so the compute stream must wait for the copy.
+        h2::gpu::sync(m_stream, e.event);
+        m_offloading.erase(
+            std::find(m_offloading.begin(), m_offloading.end(), id));
+    }
+    internal::RuntimeGPU::get_device_memory_pool().release(e.device);
+    e.device = nullptr;
+    e.set_buffer(nullptr);
+    e.state = State::HOST;
+}
+
+void OffloadManager::cancel_offload(int id)
+{
+    // The device data is still valid
+    m_offloading.erase(std::find(m_offloading.begin(), m_offloading.end(), id));
+    m_entries[id].state = State::DEVICE;
+}
+
+void OffloadManager::prefetch(int id)
+{
+    auto& e = m_entries[id];
+    if (e.state != State::HOST || e.size == 0)
+        return;
+    util::MPIPrintStreamDebug()
+        << "Prefetching activation " << id << " of " << e.size << " bytes";
+    // Allocated on the compute stream, so the copy must come after the
+    // work enqueued on it so far.
+    e.device =
+        internal::RuntimeGPU::get_device_memory_pool().get(e.size, m_stream);
+    copy_after_compute(e.device, e.host, e);
+    e.state = State::PREFETCHING;
+}
+
+void OffloadManager::fetch(int id)
+{
+    auto& e = get_entry(id);
+    switch (e.state)
+    {
+    case State::DEVICE: break;
+    case State::OFFLOADING: cancel_offload(id); break;
+    case State::HOST:
+        prefetch(id);
+        [[fallthrough]];
+    case State::PREFETCHING:
+        if (e.size > 0)
+        {
+            h2::gpu::sync(m_stream, e.event);
+            e.set_buffer(e.device);
+        }
+        e.state = State::DEVICE;
+        break;
+    }
+    for (int i = id - 1; i >= 0 && i >= id - m_lookahead; --i)
+    {
+        prefetch(i);
+    }
+}
+
+void OffloadManager::allocate(int id)
+{
+    auto& e = get_entry(id);
+    switch (e.state)
+    {
+    case State::DEVICE: return;
+    case State::OFFLOADING: cancel_offload(id); return;
+    case State::HOST:
+        if (e.size > 0)
+        {
+            e.device = internal::RuntimeGPU::get_device_memory_pool().get(
+                e.size, m_stream);
+        }
+        break;
+    case State::PREFETCHING:
+        // The compute stream must not overwrite the buffer before the
+        // copy into it is done.
+        h2::gpu::sync(m_stream, e.event);
+        break;
+    }
+    if (e.size > 0)
+        e.set_buffer(e.device);
+    e.state = State::DEVICE;
+}
+
+void OffloadManager::discard(int id)
+{
+    auto& e = get_entry(id);
+    if (e.state == State::HOST)
+        return;
+    if (e.size == 0)
+    {
+        e.state = State::HOST;
+        return;
+    }
+    if (e.state == State::PREFETCHING)
+    {
+        // The buffer may be reused after the compute stream, so it must
+        // wait for the copy into it.
+        h2::gpu::sync(m_stream, e.event);
+    }
+    release_device(id);
+}
+
+} // namespace distconv
@@ -15,13 +15,25 @@ Options::Options(bool overlap_halo_exchange_in,
                  bool enable_profiling_in,
                  float ws_capacity_factor_in,
                  bool jit_verbose_in,
-                 const std::string& jit_cache_path_in)
+                 const std::string& jit_cache_path_in,
+                 const std::string& autotune_cache_path_in,
+                 size_t ws_budget_in,
+                 const std::string& jit_compiler_in,
+                 int jit_compile_workers_in,
+                 bool graph_capture_in,
+                 bool recompute_in)
     : overlap_halo_exchange{overlap_halo_exchange_in},
       m_deterministic{deterministic_in},
       enable_profiling{enable_profiling_in},
       ws_capacity_factor{ws_capacity_factor_in},
+      ws_budget{ws_budget_in},
       jit_verbose{jit_verbose_in},
-      jit_cache_path{jit_cache_path_in}
+      jit_cache_path{jit_cache_path_in},
+      jit_compiler{jit_compiler_in},
+      jit_compile_workers{jit_compile_workers_in},
+      autotune_cache_path{autotune_cache_path_in},
+      graph_capture{graph_capture_in},
+      recompute{recompute_in}
 {
     // FIXME (trb): This carries over the previous logic, which is
     // BAD. `DISTCONV_OVERLAP_HALO_EXCHANGE=0` is still "detected", so
@@ -55,6 +67,14 @@ Options::Options(bool overlap_halo_exchange_in,
                                         << " detected";
         ws_capacity_factor = atof(std::getenv("DISTCONV_WS_CAPACITY_FACTOR"));
     }
+    if (std::getenv("DISTCONV_WS_BUDGET"))
+    {
+        util::MPIRootPrintStreamDebug() << "Environment variable: "
+                                        << "DISTCONV_WS_BUDGET"
+                                        << " detected";
+        ws_budget =
+            std::strtoull(std::getenv("DISTCONV_WS_BUDGET"), nullptr, 10);
+    }
     if (std::getenv("DISTCONV_JIT_VERBOSE"))
     {
         util::MPIRootPrintStreamDebug() << "Environment variable: "
@@ -69,6 +89,42 @@ Options::Options(bool overlap_halo_exchange_in,
                                         << " detected";
         jit_cache_path = std::getenv("DISTCONV_JIT_CACHEPATH");
     }
+    if (std::getenv("DISTCONV_JIT_COMPILER"))
+    {
+        util::MPIRootPrintStreamDebug() << "Environment variable: "
+                                        << "DISTCONV_JIT_COMPILER"
+                                        << " detected";
+        jit_compiler = std::getenv("DISTCONV_JIT_COMPILER");
+    }
+    if (std::getenv("DISTCONV_JIT_COMPILE_WORKERS"))
+    {
+        util::MPIRootPrintStreamDebug() << "Environment variable: "
+                                        << "DISTCONV_JIT_COMPILE_WORKERS"
+                                        << " detected";
+        jit_compile_workers =
+            std::atoi(std::getenv("DISTCONV_JIT_COMPILE_WORKERS"));
+    }
+    if (std::getenv("DISTCONV_AUTOTUNE_CACHEPATH"))
+    {
+        util::MPIRootPrintStreamDebug() << "Environment variable: "
+                                        << "DISTCONV_AUTOTUNE_CACHEPATH"
+                                        << " detected";
+        autotune_cache_path = std::getenv("DISTCONV_AUTOTUNE_CACHEPATH");
+    }
+    if (std::getenv("DISTCONV_GRAPH_CAPTURE"))
+    {
+        util::MPIRootPrintStreamDebug() << "Environment variable: "
+                                        << "DISTCONV_GRAPH_CAPTURE"
+                                        << " detected";
+        graph_capture = std::atoi(std::getenv("DISTCONV_GRAPH_CAPTURE"));
+    }
+    if (std::getenv("DISTCONV_RECOMPUTE"))
+    {
+        util::MPIRootPrintStreamDebug() << "Environment variable: "
+                                        << "DISTCONV_RECOMPUTE"
+                                        << " detected";
+        recompute = std::atoi(std::getenv("DISTCONV_RECOMPUTE"));
+    }
 }
 
 } // namespace distconv
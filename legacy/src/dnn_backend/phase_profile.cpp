@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "distconv/dnn_backend/phase_profile.hpp"
+#include "distconv/util/util_mpi.hpp"
+
+#include <vector>
+
+namespace distconv
+{
+
+std::ostream& operator<<(std::ostream& os, ConvPass pass)
+{
+    switch (pass)
+    {
+    case ConvPass::FORWARD: return os << "forward";
+    case ConvPass::BACKWARD_DATA: return os << "backward_data";
+    case ConvPass::BACKWARD_FILTER: return os << "backward_filter";
+    case ConvPass::BACKWARD_BIAS: return os << "backward_bias";
+    default: return os << "unknown";
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, ConvPhase phase)
+{
+    switch (phase)
+    {
+    case ConvPhase::HALO_PACK: return os << "halo_pack";
+    case ConvPhase::HALO_TRANSFER: return os << "halo_transfer";
+    case ConvPhase::HALO_UNPACK: return os << "halo_unpack";
+    case ConvPhase::HALO_EXCHANGE: return os << "halo_exchange";
+    case ConvPhase::INTERIOR_COMPUTE: return os << "interior_compute";
+    case ConvPhase::BOUNDARY_COMPUTE: return os << "boundary_compute";
+    case ConvPhase::BOUNDARY_WAIT: return os << "boundary_wait";
+    default: return os << "unknown";
+    }
+}
+
+void ConvPhaseProfile::add_call(ConvPass pass)
+{
+    ++m_num_calls[static_cast<int>(pass)];
+}
+
+void ConvPhaseProfile::add_time(ConvPass pass, ConvPhase phase, double ms)
+{
+    m_times[static_cast<int>(pass)][static_cast<int>(phase)] += ms;
+}
+
+void ConvPhaseProfile::clear()
+{
+    m_times = {};
+    m_num_calls = {};
+}
+
+int ConvPhaseProfile::get_num_calls(ConvPass pass) const
+{
+    return m_num_calls[static_cast<int>(pass)];
+}
+
+double ConvPhaseProfile::get_mean_time(ConvPass pass, ConvPhase phase) const
+{
+    int const n = get_num_calls(pass);
+    return n > 0 ? m_times[static_cast<int>(pass)][static_cast<int>(phase)] / n
+                 : 0;
+}
+
+void ConvPhaseProfile::write_json(std::ostream& os, MPI_Comm comm) const
+{
+    int pid;
+    int np;
+    DISTCONV_CHECK_MPI(MPI_Comm_rank(comm, &pid));
+    DISTCONV_CHECK_MPI(MPI_Comm_size(comm, &np));
+
+    int const count = num_passes * num_phases;
+    std::vector<double> mean(count);
+    for (int i = 0; i < num_passes; ++i)
+    {
+        for (int j = 0; j < num_phases; ++j)
+        {
+            mean[i * num_phases + j] = get_mean_time(static_cast<ConvPass>(i),
+                                                     static_cast<ConvPhase>(j));
+        }
+    }
+    std::vector<double> min(count), sum(count), max(count);
+    std::array<int, num_passes> num_calls;
+    DISTCONV_CHECK_MPI(MPI_Reduce(
+        mean.data(), min.data(), count, MPI_DOUBLE, MPI_MIN, 0, comm));
+    DISTCONV_CHECK_MPI(MPI_Reduce(
+        mean.data(), sum.data(), count, MPI_DOUBLE, MPI_SUM, 0, comm));
+    DISTCONV_CHECK_MPI(MPI_Reduce(
+        mean.data(), max.data(), count, MPI_DOUBLE, MPI_MAX, 0, comm));
+    DISTCONV_CHECK_MPI(MPI_Reduce(m_num_calls.data(),
+                                  num_calls.data(),
+                                  num_passes,
+                                  MPI_INT,
+                                  MPI_MAX,
+                                  0,
+                                  comm));
+    if (pid != 0)
+        return;
+
+    os << "{\n  \"num_processes\": " << np << ",\n  \"unit\": \"ms\",\n"
+       << "  \"passes\": {";
+    bool first_pass = true;
+    for (int i = 0; i < num_passes; ++i)
+    {
+        if (num_calls[i] == 0)
+            continue;
+        os << (first_pass ? "\n" : ",\n") << "    \""
+           << static_cast<ConvPass>(i) << "\": {\n"
+           << "      \"num_calls\": " << num_calls[i] << ",\n"
+           << "      \"phases\": {\n";
+        for (int j = 0; j < num_phases; ++j)
+        {
+            int const k = i * num_phases + j;
+            os << "        \"" << static_cast<ConvPhase>(j)
+               << "\": {\"min\": " << min[k] << ", \"mean\": " << sum[k] / np
+               << ", \"max\": " << max[k] << "}"
+               << (j + 1 < num_phases ? ",\n" : "\n");
+        }
+        os << "      }\n    }";
+        first_pass = false;
+    }
+    os << "\n  }\n}\n";
+}
+
+} // namespace distconv
@@ -1,6 +1,8 @@
 #include "distconv/dnn_backend/pooling.hpp"
 #include "distconv/runtime_gpu.hpp"
+#include "distconv/util/util_gpu.hpp"
 #include "distconv/util/util_mpi.hpp"
+#include "h2/core/low_precision.hpp"
 
 namespace
 {
@@ -18,84 +20,271 @@ template <typename DataType>
 using Tensor =
     tensor::Tensor<DataType, tensor::LocaleMPI, tensor::CUDAAllocator>;
 
-template <int ND, typename DataType>
-__global__ void bp_accumulate_sum_kernel(DataType* tensor,
-                                         const Array<ND> tensor_shape,
-                                         const Array<ND> dst_offset,
-                                         const Array<ND> src_offset,
-                                         const Array<ND> region)
+enum class GatherMode
+{
+    MAX,
+    AVERAGE,
+    AVERAGE_NO_PAD
+};
+
+GatherMode get_gather_mode(dc::GPUDNNBackend::PoolingMode_t mode)
+{
+#if H2_HAS_CUDA
+    switch (mode)
+    {
+    case CUDNN_POOLING_MAX:
+    case CUDNN_POOLING_MAX_DETERMINISTIC: return GatherMode::MAX;
+    case CUDNN_POOLING_AVERAGE_COUNT_INCLUDE_PADDING:
+        return GatherMode::AVERAGE;
+    default: return GatherMode::AVERAGE_NO_PAD;
+    }
+#elif H2_HAS_ROCM
+    switch (mode)
+    {
+    case miopenPoolingMax: return GatherMode::MAX;
+    case miopenPoolingAverageInclusive: return GatherMode::AVERAGE;
+    default: return GatherMode::AVERAGE_NO_PAD;
+    }
+#endif
+}
+
+// Shapes and strides of the tensors seen by the vendor pooling, and
+// the windows in all dimensions. The sample and channel dimensions
+// have windows of size and stride 1.
+template <int ND>
+struct PoolingGeometry
+{
+    Array<ND> x_shape;
+    Array<ND> x_strides;
+    Array<ND> y_shape;
+    Array<ND> y_strides;
+    Array<ND> dy_strides;
+    Array<ND> window;
+    Array<ND> pad;
+    Array<ND> stride;
+};
+
+template <int ND>
+__device__ index_t get_strided_offset(const Array<ND>& idx,
+                                      const Array<ND>& strides)
+{
+    index_t offset = 0;
+    for (int i = 0; i < ND; ++i)
+        offset += idx[i] * strides[i];
+    return offset;
+}
+
+// Advances idx to the next point of [begin, end) with the first
+// dimension moving fastest. Returns false after the last point.
+template <int ND>
+__device__ bool next_point(Array<ND>& idx,
+                           const Array<ND>& begin,
+                           const Array<ND>& end)
+{
+    for (int i = 0; i < ND; ++i)
+    {
+        if (++idx[i] < end[i])
+            return true;
+        idx[i] = begin[i];
+    }
+    return false;
+}
+
+// Input points of window o, excluding padding.
+template <int ND>
+__device__ void get_window(const PoolingGeometry<ND>& g,
+                           const Array<ND>& o,
+                           Array<ND>& begin,
+                           Array<ND>& end)
+{
+    for (int i = 0; i < ND; ++i)
+    {
+        // index_t is unsigned
+        index_t const start = o[i] * g.stride[i];
+        index_t const stop = start + g.window[i] - g.pad[i];
+        begin[i] = start < g.pad[i] ? 0 : start - g.pad[i];
+        end[i] = stop < g.x_shape[i] ? stop : g.x_shape[i];
+    }
+}
+
+// Each thread computes one point of d_input (including its halos) as
+// the sum of the gradients of all windows covering it, so no point is
+// written twice. Max pooling passes the gradient of a window to its
+// first maximum in memory order. 16-bit gradients are summed in float.
+template <int ND, GatherMode MODE, typename DataType>
+__global__ void bp_gather_kernel(const DataType* x,
+                                 const DataType* y,
+                                 const DataType* dy,
+                                 DataType* dx,
+                                 const PoolingGeometry<ND> g,
+                                 const DataType alpha,
+                                 const DataType beta)
 {
     index_t idx = threadIdx.x + blockIdx.x * blockDim.x;
-    if (idx >= region.get_size())
+    if (idx >= g.x_shape.get_size())
         return;
-    Array<ND> offset;
+    Array<ND> c;
     for (int i = 0; i < ND; ++i)
     {
-        offset[i] = idx % region[i];
-        idx = idx / region[i];
+        c[i] = idx % g.x_shape[i];
+        idx = idx / g.x_shape[i];
     }
-    DataType src =
-        tensor[tensor::get_offset(src_offset + offset, tensor_shape)];
-    DataType& dst =
-        tensor[tensor::get_offset(dst_offset + offset, tensor_shape)];
-    dst += src;
-#if 0
-  if (blockIdx.x == 0 && threadIdx.x < 32) {
-    printf("DST: %d\n",
-           (int)tensor::get_offset(dst_offset + offset, tensor_shape));
-  }
-#endif
+
+    // Windows o with o * stride - pad <= c < o * stride - pad + window
+    Array<ND> lo;
+    Array<ND> hi;
+    bool covered = true;
+    for (int i = 0; i < ND; ++i)
+    {
+        index_t const p = c[i] + g.pad[i];
+        lo[i] = p < g.window[i] ? 0 : (p - g.window[i]) / g.stride[i] + 1;
+        hi[i] = p / g.stride[i] + 1;
+        if (hi[i] > g.y_shape[i])
+            hi[i] = g.y_shape[i];
+        covered &= lo[i] < hi[i];
+    }
+
+    using AccType = util::AccumulationType<DataType>;
+    AccType sum = AccType(0);
+    if (covered)
+    {
+        Array<ND> o = lo;
+        do
+        {
+            AccType const g_o =
+                util::to_accumulation(dy[get_strided_offset(o, g.dy_strides)]);
+            if (MODE == GatherMode::AVERAGE)
+            {
+                sum += g_o;
+                continue;
+            }
+            Array<ND> begin;
+            Array<ND> end;
+            get_window(g, o, begin, end);
+            if (MODE == GatherMode::AVERAGE_NO_PAD)
+            {
+                index_t count = 1;
+                for (int i = 0; i < ND; ++i)
+                    count *= end[i] - begin[i];
+                sum += g_o / AccType(count);
+                continue;
+            }
+            AccType const m =
+                util::to_accumulation(y[get_strided_offset(o, g.y_strides)]);
+            Array<ND> q = begin;
+            do
+            {
+                if (util::to_accumulation(x[get_strided_offset(q, g.x_strides)])
+                    == m)
+                    break;
+            } while (next_point(q, begin, end));
+            bool is_argmax = true;
+            for (int i = 0; i < ND; ++i)
+                is_argmax &= q[i] == c[i];
+            if (is_argmax)
+                sum += g_o;
+        } while (next_point(o, lo, hi));
+    }
+    if (MODE == GatherMode::AVERAGE)
+        sum /= AccType(g.window.get_size());
+
+    AccType const acc_alpha = util::to_accumulation(alpha);
+    AccType const acc_beta = util::to_accumulation(beta);
+    DataType& d = dx[get_strided_offset(c, g.x_strides)];
+    d = util::from_accumulation<DataType>(
+        acc_beta == AccType(0)
+            ? acc_alpha * sum
+            : acc_alpha * sum + acc_beta * util::to_accumulation(d));
+}
+
+template <int ND>
+Array<ND> get_strides(const dc::tensor::Shape& pitched_shape)
+{
+    Array<ND> strides;
+    index_t s = 1;
+    for (int i = 0; i < ND; ++i)
+    {
+        strides[i] = s;
+        s *= pitched_shape[i];
+    }
+    return strides;
 }
 
 template <int ND, typename DataType>
-void bp_accumulate_sum_nd(Tensor<DataType>& tensor,
-                          const dc::IndexVector& dst,
-                          const dc::IndexVector& src,
-                          const dc::tensor::Shape& shape)
+void bp_gather_nd(GatherMode mode,
+                  const DataType* x,
+                  const DataType* y,
+                  const DataType* dy,
+                  DataType* dx,
+                  const PoolingGeometry<ND>& g,
+                  DataType alpha,
+                  DataType beta,
+                  h2::gpu::DeviceStream stream)
 {
-    auto size = shape.get_size();
+    auto const size = g.x_shape.get_size();
     const int bsize = 256;
     int gsize = (size + bsize - 1) / bsize;
-    util::MPIPrintStreamDebug()
-        << "Accumulating " << src << " to " << dst
-        << " of sub tensor with shape " << shape << " of "
-        << tensor.get_local_pitched_shape() << "\n";
-
-#if 0
-  {
-    DISTCONV_CHECK_CUDA(cudaDeviceSynchronize());
-    DataType *h = nullptr;
-    size_t s = tensor.get_local_real_size() * sizeof(DataType);
-    cudaMallocHost(&h, s);
-    DISTCONV_CHECK_CUDA(cudaMemcpy(h, tensor.get_buffer(), s,
-                                   cudaMemcpyDeviceToHost));
-    std::ofstream out;
-    out.open("before.out",
-             std::ios::out | std::ios::trunc | std::ios::binary);
-    out.write((char *)h, s);
-    out.close();
-    DISTCONV_CHECK_CUDA(cudaFreeHost(h));
-  }
-#endif
+    switch (mode)
+    {
+    case GatherMode::MAX:
+        bp_gather_kernel<ND, GatherMode::MAX><<<gsize, bsize, 0, stream>>>(
+            x, y, dy, dx, g, alpha, beta);
+        break;
+    case GatherMode::AVERAGE:
+        bp_gather_kernel<ND, GatherMode::AVERAGE>
+            <<<gsize, bsize, 0, stream>>>(x, y, dy, dx, g, alpha, beta);
+        break;
+    case GatherMode::AVERAGE_NO_PAD:
+        bp_gather_kernel<ND, GatherMode::AVERAGE_NO_PAD>
+            <<<gsize, bsize, 0, stream>>>(x, y, dy, dx, g, alpha, beta);
+        break;
+    }
+}
 
-    bp_accumulate_sum_kernel<ND><<<gsize, bsize>>>(
-        tensor.get_buffer(), tensor.get_local_pitched_shape(), dst, src, shape);
-#if 0
-  {
-    DataType *h = nullptr;
-    size_t s = tensor.get_local_real_size() * sizeof(DataType);
-    cudaMallocHost(&h, s);
-    DISTCONV_CHECK_CUDA(cudaDeviceSynchronize());
-    DISTCONV_CHECK_CUDA(cudaMemcpy(h, tensor.get_buffer(), s,
-                                   cudaMemcpyDeviceToHost));
-    std::ofstream out;
-    out.open("after.out",
-             std::ios::out | std::ios::trunc | std::ios::binary);
-    out.write((char *)h, s);
-    out.close();
-    DISTCONV_CHECK_CUDA(cudaFreeHost(h));
-  }
-#endif
+template <int ND, typename DataType>
+void bp_gather(GatherMode mode,
+               const Tensor<DataType>& output,
+               const Tensor<DataType>& d_output,
+               const Tensor<DataType>& input,
+               Tensor<DataType>& d_input,
+               const dc::IntVector& halo_fwd,
+               const dc::IntVector& halo_bwd,
+               const dc::IntVector& windows,
+               const dc::IntVector& pads,
+               const dc::IntVector& strides,
+               DataType alpha,
+               DataType beta,
+               h2::gpu::DeviceStream stream)
+{
+    PoolingGeometry<ND> g;
+    auto const x_shape = input.get_local_shape();
+    auto const y_shape = output.get_local_shape();
+    for (int i = 0; i < ND; ++i)
+    {
+        g.x_shape[i] = x_shape[i] + halo_bwd[i] + halo_fwd[i];
+        g.y_shape[i] = y_shape[i];
+        bool const spatial = i < ND - 2;
+        g.window[i] = spatial ? windows[i] : 1;
+        g.pad[i] = spatial ? pads[i] : 0;
+        g.stride[i] = spatial ? strides[i] : 1;
+    }
+    // Assumes d_input has the same distribution as input
+    g.x_strides = get_strides<ND>(input.get_local_pitched_shape());
+    g.y_strides = get_strides<ND>(output.get_local_pitched_shape());
+    g.dy_strides = get_strides<ND>(d_output.get_local_pitched_shape());
+
+    dc::IndexVector const halo_offset(halo_bwd);
+    bp_gather_nd<ND>(mode,
+                     input.get_const_base_ptr()
+                         - input.get_local_offset(halo_offset, true),
+                     output.get_const_base_ptr(),
+                     d_output.get_const_base_ptr(),
+                     d_input.get_base_ptr()
+                         - d_input.get_local_offset(halo_offset, true),
+                     g,
+                     alpha,
+                     beta,
+                     stream);
 }
 
 } // namespace
@@ -104,28 +293,64 @@ namespace distconv
 {
 
 template <typename DataType>
-void Pooling<BackendDNNLib, DataType>::bp_accumulate_sum(
-    Tensor<DataType>& tensor,
-    IndexVector const& dst,
-    IndexVector const& src,
-    tensor::Shape const& shape)
+void Pooling<BackendDNNLib, DataType>::backward_gather(
+    DataType alpha,
+    const Tensor<DataType>& output,
+    const Tensor<DataType>& d_output,
+    const Tensor<DataType>& input,
+    DataType beta,
+    Tensor<DataType>& d_input)
 {
+    auto const mode = get_gather_mode(m_mode);
     switch (m_num_dims)
     {
-    case 4: bp_accumulate_sum_nd<4, DataType>(tensor, dst, src, shape); break;
-    case 5: bp_accumulate_sum_nd<5, DataType>(tensor, dst, src, shape); break;
+    case 4:
+        bp_gather<4>(mode,
+                     output,
+                     d_output,
+                     input,
+                     d_input,
+                     m_halo_fwd_recv,
+                     m_halo_bwd_recv,
+                     m_windows,
+                     m_pads,
+                     m_strides,
+                     alpha,
+                     beta,
+                     m_be.get_stream());
+        break;
+    case 5:
+        bp_gather<5>(mode,
+                     output,
+                     d_output,
+                     input,
+                     d_input,
+                     m_halo_fwd_recv,
+                     m_halo_bwd_recv,
+                     m_windows,
+                     m_pads,
+                     m_strides,
+                     alpha,
+                     beta,
+                     m_be.get_stream());
+        break;
     }
-    return;
 }
 
-#define INSTANTIATE_BP_ACCUMULATE_SUM(TYPE)                                    \
-    template void Pooling<BackendDNNLib, TYPE>::bp_accumulate_sum( \
-        Tensor<TYPE>& tensor,                                                  \
-        const IndexVector& dst,                                                \
-        const IndexVector& src,                                                \
-        const tensor::Shape& shape)
-INSTANTIATE_BP_ACCUMULATE_SUM(float);
-INSTANTIATE_BP_ACCUMULATE_SUM(double);
-#undef INSTANTIATE_BP_ACCUMULATE_SUM
+#define INSTANTIATE_BACKWARD_GATHER(TYPE)                                      \
+    template void Pooling<BackendDNNLib, TYPE>::backward_gather(               \
+        TYPE alpha,                                                            \
+        const Tensor<TYPE>& output,                                            \
+        const Tensor<TYPE>& d_output,                                          \
+        const Tensor<TYPE>& input,                                             \
+        TYPE beta,                                                             \
+        Tensor<TYPE>& d_input)
+INSTANTIATE_BACKWARD_GATHER(float);
+INSTANTIATE_BACKWARD_GATHER(double);
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_BACKWARD_GATHER(h2::gpu::Half);
+INSTANTIATE_BACKWARD_GATHER(h2::gpu::BFloat16);
+#endif // H2_HAS_GPU_LOW_PRECISION
+#undef INSTANTIATE_BACKWARD_GATHER
 
 } // namespace distconv
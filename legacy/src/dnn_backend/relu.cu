@@ -0,0 +1,184 @@
+#include "distconv/dnn_backend/relu.hpp"
+#include "distconv/tensor/tensor_mpi.hpp"
+#include "distconv/util/util.hpp"
+#include "distconv/util/util_gpu.hpp"
+#include "h2/core/low_precision.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+using distconv::tensor::CUDAAllocator;
+using distconv::tensor::LocaleMPI;
+
+template <typename DataType>
+using Tensor = distconv::tensor::Tensor<DataType, LocaleMPI, CUDAAllocator>;
+
+namespace
+{
+
+constexpr int block_size = 256;
+constexpr int max_grid_size = 1 << 16;
+
+// Returns the bits of pred of the 32 lanes of the calling thread's
+// 32-lane group, lane 0 in the least significant bit. All lanes of
+// the warp must call this.
+__device__ __forceinline__ std::uint32_t ballot32(bool pred)
+{
+#if H2_HAS_CUDA
+    return __ballot_sync(0xffffffff, pred);
+#elif H2_HAS_ROCM
+    // Wavefronts may have 64 lanes
+    return static_cast<std::uint32_t>(__ballot(pred)
+                                      >> ((threadIdx.x % warpSize) & 32));
+#endif
+}
+
+// Element i of a thread always has i % 32 equal to its lane within
+// its 32-lane group, as block_size is a multiple of the warp size, so
+// lane 0 of a group writes mask word i / 32. Whole warps iterate
+// together so that the ballot sees all lanes.
+template <typename DataType>
+__global__ void forward_with_mask_kernel(const DataType* x,
+                                         DataType* y,
+                                         std::uint32_t* __restrict__ mask,
+                                         const size_t size)
+{
+    const size_t stride = (size_t) blockDim.x * gridDim.x;
+    size_t i = threadIdx.x + (size_t) blockIdx.x * blockDim.x;
+    const size_t lane32 = i % 32;
+    for (; i - lane32 < size; i += stride)
+    {
+        const bool in_range = i < size;
+        const auto v =
+            in_range ? distconv::util::to_accumulation(x[i]) : 0;
+        const bool positive = v > 0;
+        const auto bits = ballot32(positive);
+        if (in_range)
+        {
+            y[i] = positive ? x[i] : DataType(0);
+            if (lane32 == 0)
+            {
+                mask[i / 32] = bits;
+            }
+        }
+    }
+}
+
+template <typename DataType, bool ACCUMULATE>
+__global__ void
+backward_with_mask_kernel(const std::uint32_t* __restrict__ mask,
+                          const DataType* dy,
+                          DataType* dx,
+                          const DataType beta,
+                          const size_t size)
+{
+    using AccType = distconv::util::AccumulationType<DataType>;
+    const size_t stride = (size_t) blockDim.x * gridDim.x;
+    for (size_t i = threadIdx.x + (size_t) blockIdx.x * blockDim.x; i < size;
+         i += stride)
+    {
+        const bool positive = (mask[i / 32] >> (i % 32)) & 1;
+        if constexpr (ACCUMULATE)
+        {
+            AccType v = positive ? distconv::util::to_accumulation(dy[i]) : 0;
+            v += distconv::util::to_accumulation(beta)
+                 * distconv::util::to_accumulation(dx[i]);
+            dx[i] = distconv::util::from_accumulation<DataType>(v);
+        }
+        else
+        {
+            dx[i] = positive ? dy[i] : DataType(0);
+        }
+    }
+}
+
+// Returns true if the local data of tensor is stored densely, i.e.,
+// it has no halo and no row padding, so that the mask bits map to the
+// elements of the flat buffer.
+template <typename TensorType>
+bool is_local_dense(TensorType const& tensor)
+{
+    auto const real_shape = tensor.get_local_real_shape();
+    return real_shape == tensor.get_local_shape()
+           && tensor.get_pitch() == static_cast<size_t>(real_shape[0]);
+}
+
+int get_grid_size(size_t size)
+{
+    return static_cast<int>(
+        std::min<size_t>(distconv::util::ceil(size, (size_t) block_size),
+                         max_grid_size));
+}
+
+} // namespace
+
+template <typename TensorType>
+void distconv::relu::forward_with_mask(const TensorType& input,
+                                       TensorType& output,
+                                       std::uint32_t* mask,
+                                       h2::gpu::DeviceStream stream)
+{
+    using DataType = typename TensorType::data_type;
+    assert_always(is_local_dense(input) && is_local_dense(output));
+    assert_eq(input.get_local_shape(), output.get_local_shape());
+    const size_t size = input.get_local_size();
+    if (size == 0)
+        return;
+    forward_with_mask_kernel<DataType>
+        <<<get_grid_size(size), block_size, 0, stream>>>(
+            input.get_const_buffer(), output.get_buffer(), mask, size);
+}
+
+template <typename TensorType>
+void distconv::relu::backward_with_mask(
+    const std::uint32_t* mask,
+    const TensorType& d_output,
+    typename TensorType::data_type beta,
+    TensorType& d_input,
+    h2::gpu::DeviceStream stream)
+{
+    using DataType = typename TensorType::data_type;
+    assert_always(is_local_dense(d_output) && is_local_dense(d_input));
+    assert_eq(d_output.get_local_shape(), d_input.get_local_shape());
+    const size_t size = d_input.get_local_size();
+    if (size == 0)
+        return;
+    const int grid_size = get_grid_size(size);
+    if (h2::convert_compute_type<float>(beta) == 0.f)
+    {
+        backward_with_mask_kernel<DataType, false>
+            <<<grid_size, block_size, 0, stream>>>(mask,
+                                                   d_output.get_const_buffer(),
+                                                   d_input.get_buffer(),
+                                                   beta,
+                                                   size);
+    }
+    else
+    {
+        backward_with_mask_kernel<DataType, true>
+            <<<grid_size, block_size, 0, stream>>>(mask,
+                                                   d_output.get_const_buffer(),
+                                                   d_input.get_buffer(),
+                                                   beta,
+                                                   size);
+    }
+}
+
+#define INSTANTIATE_TEMPLATES(TYPE)                                            \
+    template void distconv::relu::forward_with_mask<Tensor<TYPE>>(             \
+        const Tensor<TYPE>& input,                                             \
+        Tensor<TYPE>& output,                                                  \
+        std::uint32_t* mask,                                                   \
+        h2::gpu::DeviceStream stream);                                         \
+    template void distconv::relu::backward_with_mask<Tensor<TYPE>>(            \
+        const std::uint32_t* mask,                                             \
+        const Tensor<TYPE>& d_output,                                          \
+        TYPE beta,                                                             \
+        Tensor<TYPE>& d_input,                                                 \
+        h2::gpu::DeviceStream stream)
+INSTANTIATE_TEMPLATES(float);
+INSTANTIATE_TEMPLATES(double);
+#if H2_HAS_GPU_LOW_PRECISION
+INSTANTIATE_TEMPLATES(h2::gpu::Half);
+INSTANTIATE_TEMPLATES(h2::gpu::BFloat16);
+#endif // H2_HAS_GPU_LOW_PRECISION
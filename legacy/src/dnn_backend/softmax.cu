@@ -4,8 +4,10 @@
 #include "distconv/tensor/tensor_mpi.hpp"
 #include "distconv/util/util_gpu.hpp"
 #include "distconv/util/util_mpi.hpp"
+#include "h2/core/low_precision.hpp"
 
 #include <limits>
+#include <type_traits>
 
 #if H2_HAS_CUDA
 #include <cub/block/block_reduce.cuh>
@@ -28,6 +30,12 @@ namespace
 
 constexpr int block_size = 256;
 
+// Tensors may be 16-bit, but the kernels compute in float, and the
+// per-sample workspaces (maxima, sums and dot products) are stored and
+// communicated in float as well.
+template <typename DataType>
+using AccType = util::AccumulationType<DataType>;
+
 template <typename DataType>
 struct exp;
 
@@ -152,10 +160,22 @@ struct atomic_add_fn
     }
 };
 
+// Returns the smallest output of the softmax, which keeps the
+// gradients away from denormals. For half, whose square root of the
+// smallest normal would be as large as 2^-7, this is the smallest
+// normal itself.
 template <typename DataType>
-DataType get_min()
+AccType<DataType> get_min()
 {
-    return std::sqrt(std::numeric_limits<DataType>::min());
+    if constexpr (std::is_same_v<DataType, float>
+                  || std::is_same_v<DataType, double>)
+        return std::sqrt(std::numeric_limits<DataType>::min());
+#if H2_HAS_GPU_LOW_PRECISION
+    else if constexpr (std::is_same_v<DataType, h2::gpu::BFloat16>)
+        return std::sqrt(std::numeric_limits<float>::min());
+    else
+        return 0x1p-14f;
+#endif
 }
 
 template <typename Tensor>
@@ -186,7 +206,8 @@ __global__ void reduce_per_sample_kernel(const DataType* __restrict__ x,
                                          Map map,
                                          Reduce reduce,
                                          AtomicReduce atomic_reduce,
-                                         DataType* __restrict__ reduction)
+                                         AccType<DataType>* __restrict__
+                                             reduction)
 {
     auto num_blocks_per_sample = gridDim.x;
     size_t work_per_block =
@@ -197,14 +218,14 @@ __global__ void reduce_per_sample_kernel(const DataType* __restrict__ x,
 
     x += sample_idx * sample_size;
 
-    DataType local_sum = reduce.init();
+    AccType<DataType> local_sum = reduce.init();
     for (; sample_offset < block_end; sample_offset += BLOCK_SIZE)
     {
-        auto x_i = x[sample_offset];
+        auto x_i = util::to_accumulation(x[sample_offset]);
         local_sum = reduce(local_sum, map(x_i));
     }
 
-    using BlockReduce = cubns::BlockReduce<DataType, BLOCK_SIZE>;
+    using BlockReduce = cubns::BlockReduce<AccType<DataType>, BLOCK_SIZE>;
     __shared__ typename BlockReduce::TempStorage temp_storage;
     auto block_sum = BlockReduce(temp_storage).Sum(local_sum);
     if (threadIdx.x == 0)
@@ -224,7 +245,8 @@ __global__ void reduce_per_sample_kernel(const DataType* __restrict__ x,
                                          Map map,
                                          Reduce reduce,
                                          AtomicReduce atomic_reduce,
-                                         DataType* __restrict__ reduction)
+                                         AccType<DataType>* __restrict__
+                                             reduction)
 {
     auto num_blocks_per_sample = gridDim.x;
     size_t work_per_block =
@@ -236,15 +258,15 @@ __global__ void reduce_per_sample_kernel(const DataType* __restrict__ x,
     x += sample_idx * sample_size;
     y += sample_idx * sample_size;
 
-    DataType local_sum = reduce.init();
+    AccType<DataType> local_sum = reduce.init();
     for (; sample_offset < block_end; sample_offset += BLOCK_SIZE)
     {
-        auto x_i = x[sample_offset];
-        auto y_i = y[sample_offset];
+        auto x_i = util::to_accumulation(x[sample_offset]);
+        auto y_i = util::to_accumulation(y[sample_offset]);
         local_sum = reduce(local_sum, map(x_i, y_i));
     }
 
-    using BlockReduce = cubns::BlockReduce<DataType, BLOCK_SIZE>;
+    using BlockReduce = cubns::BlockReduce<AccType<DataType>, BLOCK_SIZE>;
     __shared__ typename BlockReduce::TempStorage temp_storage;
     auto block_sum = BlockReduce(temp_storage).Sum(local_sum);
     if (threadIdx.x == 0)
@@ -257,7 +279,7 @@ template <typename DataType, int BLOCK_SIZE, typename Map>
 __global__ void
 map_per_sample_kernel(const DataType* __restrict__ x,
                       const DataType* __restrict__ y,
-                      const DataType* __restrict__ sample_values,
+                      const AccType<DataType>* __restrict__ sample_values,
                       size_t sample_size,
                       DataType* __restrict__ z,
                       Map map)
@@ -277,10 +299,10 @@ map_per_sample_kernel(const DataType* __restrict__ x,
 
     for (; sample_offset < block_end; sample_offset += BLOCK_SIZE)
     {
-        auto x_i = x[sample_offset];
-        auto y_i = y[sample_offset];
+        auto x_i = util::to_accumulation(x[sample_offset]);
+        auto y_i = util::to_accumulation(y[sample_offset]);
         auto z_i = map(x_i, y_i, sample_value);
-        z[sample_offset] = z_i;
+        z[sample_offset] = util::from_accumulation<DataType>(z_i);
     }
 }
 
@@ -292,12 +314,13 @@ template <typename DataType,
 __global__ void
 map_and_reduce_per_sample_kernel(const DataType* __restrict__ x,
                                  size_t sample_size,
-                                 const DataType* __restrict__ sample_values,
+                                 const AccType<DataType>* __restrict__
+                                     sample_values,
                                  Map map,
                                  Reduce reduce,
                                  AtomicReduce atomic_reduce,
                                  DataType* __restrict__ y,
-                                 DataType* __restrict__ reduction)
+                                 AccType<DataType>* __restrict__ reduction)
 {
     auto num_blocks_per_sample = gridDim.x;
     size_t work_per_block =
@@ -311,16 +334,16 @@ map_and_reduce_per_sample_kernel(const DataType* __restrict__ x,
 
     const auto sample_value = sample_values[sample_idx];
 
-    DataType local_sum = reduce.init();
+    AccType<DataType> local_sum = reduce.init();
     for (; sample_offset < block_end; sample_offset += BLOCK_SIZE)
     {
-        auto x_i = x[sample_offset];
+        auto x_i = util::to_accumulation(x[sample_offset]);
         x_i = map(x_i, sample_value);
         local_sum = reduce(local_sum, x_i);
-        y[sample_offset] = x_i;
+        y[sample_offset] = util::from_accumulation<DataType>(x_i);
     }
 
-    using BlockReduce = cubns::BlockReduce<DataType, BLOCK_SIZE>;
+    using BlockReduce = cubns::BlockReduce<AccType<DataType>, BLOCK_SIZE>;
     __shared__ typename BlockReduce::TempStorage temp_storage;
     auto block_sum = BlockReduce(temp_storage).Sum(local_sum);
     if (threadIdx.x == 0)
@@ -332,7 +355,7 @@ map_and_reduce_per_sample_kernel(const DataType* __restrict__ x,
 template <typename DataType, int BLOCK_SIZE, typename Map>
 __global__ void
 update_per_sample_kernel(DataType* __restrict__ x,
-                         const DataType* __restrict__ sample_values,
+                         const AccType<DataType>* __restrict__ sample_values,
                          size_t sample_size,
                          Map map)
 {
@@ -349,16 +372,18 @@ update_per_sample_kernel(DataType* __restrict__ x,
 
     for (; sample_offset < block_end; sample_offset += BLOCK_SIZE)
     {
-        auto x_i = map(x[sample_offset], sample_val);
-        x[sample_offset] = x_i;
+        auto x_i = map(util::to_accumulation(x[sample_offset]), sample_val);
+        x[sample_offset] = util::from_accumulation<DataType>(x_i);
     }
 }
 
-template <typename Tensor, typename DataType>
+template <typename Tensor>
 void compute_max(const Tensor& tensor,
-                 DataType* sample_max,
+                 AccType<typename Tensor::data_type>* sample_max,
                  h2::gpu::DeviceStream stream)
 {
+    using DataType = typename Tensor::data_type;
+    using ComputeType = AccType<DataType>;
     dim3 gdim;
     int num_samples;
     size_t sample_size;
@@ -371,14 +396,14 @@ void compute_max(const Tensor& tensor,
 
     reduce_per_sample_kernel<DataType,
                              block_size,
-                             id<DataType>,
-                             max<DataType>,
-                             atomic_max<DataType>>
+                             id<ComputeType>,
+                             max<ComputeType>,
+                             atomic_max<ComputeType>>
         <<<gdim, block_size, 0, stream>>>(tensor.get_base_ptr(),
                                           sample_size,
-                                          id<DataType>(),
-                                          max<DataType>(),
-                                          atomic_max<DataType>(),
+                                          id<ComputeType>(),
+                                          max<ComputeType>(),
+                                          atomic_max<ComputeType>(),
                                           sample_max);
 }
 
@@ -391,13 +416,15 @@ struct exp_shifted
     }
 };
 
-template <typename Tensor, typename DataType>
+template <typename Tensor>
 void compute_exp(const Tensor& x,
-                 const DataType* sample_max,
+                 const AccType<typename Tensor::data_type>* sample_max,
                  Tensor& y,
-                 DataType* sample_exp,
+                 AccType<typename Tensor::data_type>* sample_exp,
                  h2::gpu::DeviceStream stream)
 {
+    using DataType = typename Tensor::data_type;
+    using ComputeType = AccType<DataType>;
     dim3 gdim;
     int num_samples;
     size_t sample_size;
@@ -410,15 +437,15 @@ void compute_exp(const Tensor& x,
 
     map_and_reduce_per_sample_kernel<DataType,
                                      block_size,
-                                     exp_shifted<DataType>,
-                                     sum<DataType>,
-                                     atomic_add_fn<DataType>>
+                                     exp_shifted<ComputeType>,
+                                     sum<ComputeType>,
+                                     atomic_add_fn<ComputeType>>
         <<<gdim, block_size, 0, stream>>>(x.get_base_ptr(),
                                           sample_size,
                                           sample_max,
-                                          exp_shifted<DataType>(),
-                                          sum<DataType>(),
-                                          atomic_add_fn<DataType>(),
+                                          exp_shifted<ComputeType>(),
+                                          sum<ComputeType>(),
+                                          atomic_add_fn<ComputeType>(),
                                           y.get_base_ptr(),
                                           sample_exp);
 }
@@ -434,11 +461,13 @@ struct SoftmaxOp
     }
 };
 
-template <typename Tensor, typename DataType>
-void compute_softmax(const DataType* sample_exp,
+template <typename Tensor>
+void compute_softmax(const AccType<typename Tensor::data_type>* sample_exp,
                      Tensor& output_tensor,
                      h2::gpu::DeviceStream stream)
 {
+    using DataType = typename Tensor::data_type;
+    using ComputeType = AccType<DataType>;
     dim3 gdim;
     int num_samples;
     size_t sample_size;
@@ -449,20 +478,22 @@ void compute_softmax(const DataType* sample_exp,
         return;
     }
 
-    update_per_sample_kernel<DataType, block_size, SoftmaxOp<DataType>>
+    update_per_sample_kernel<DataType, block_size, SoftmaxOp<ComputeType>>
         <<<gdim, block_size, 0, stream>>>(
             output_tensor.get_base_ptr(),
             sample_exp,
             sample_size,
-            SoftmaxOp<DataType>(get_min<DataType>()));
+            SoftmaxOp<ComputeType>(get_min<DataType>()));
 }
 
-template <typename Tensor, typename DataType>
+template <typename Tensor>
 void bp_dotproduct(const Tensor& y,
                    const Tensor& dy,
-                   DataType* sample_dp,
+                   AccType<typename Tensor::data_type>* sample_dp,
                    h2::gpu::DeviceStream stream)
 {
+    using DataType = typename Tensor::data_type;
+    using ComputeType = AccType<DataType>;
     dim3 gdim;
     int num_samples;
     size_t sample_size;
@@ -475,15 +506,15 @@ void bp_dotproduct(const Tensor& y,
 
     reduce_per_sample_kernel<DataType,
                              block_size,
-                             mul<DataType>,
-                             sum<DataType>,
-                             atomic_add_fn<DataType>>
+                             mul<ComputeType>,
+                             sum<ComputeType>,
+                             atomic_add_fn<ComputeType>>
         <<<gdim, block_size, 0, stream>>>(y.get_base_ptr(),
                                           dy.get_base_ptr(),
                                           sample_size,
-                                          mul<DataType>(),
-                                          sum<DataType>(),
-                                          atomic_add_fn<DataType>(),
+                                          mul<ComputeType>(),
+                                          sum<ComputeType>(),
+                                          atomic_add_fn<ComputeType>(),
                                           sample_dp);
 }
 
@@ -508,13 +539,15 @@ struct bp_compute_func
     }
 };
 
-template <typename Tensor, typename DataType>
+template <typename Tensor>
 void bp_compute_gradient(const Tensor& y,
                          const Tensor& dy,
-                         DataType* sample_dp,
+                         AccType<typename Tensor::data_type>* sample_dp,
                          Tensor& dx,
                          h2::gpu::DeviceStream stream)
 {
+    using DataType = typename Tensor::data_type;
+    using ComputeType = AccType<DataType>;
     dim3 gdim;
     int num_samples;
     size_t sample_size;
@@ -525,14 +558,14 @@ void bp_compute_gradient(const Tensor& y,
         return;
     }
 
-    map_per_sample_kernel<DataType, block_size, bp_compute_func<DataType>>
+    map_per_sample_kernel<DataType, block_size, bp_compute_func<ComputeType>>
         <<<gdim, block_size, 0, stream>>>(
             y.get_base_ptr(),
             dy.get_base_ptr(),
             sample_dp,
             sample_size,
             dx.get_base_ptr(),
-            bp_compute_func<DataType>(get_min<DataType>()));
+            bp_compute_func<ComputeType>(get_min<DataType>()));
 }
 
 template <typename DataType, int BLOCK_SIZE>
@@ -552,9 +585,10 @@ __global__ void fp_channel_kernel(const DataType* __restrict__ x,
     // sufficient for all types we use. Also, this:
     // https://stackoverflow.com/questions/27570552/templated-cuda-kernel-with-dynamic-shared-memory/49224531
     extern __shared__ __align__(sizeof(double)) unsigned char x_cache_char[];
-    DataType* x_cache = reinterpret_cast<DataType*>(x_cache_char);
+    using ComputeType = AccType<DataType>;
+    ComputeType* x_cache = reinterpret_cast<ComputeType*>(x_cache_char);
     const int cache_idx = threadIdx.x;
-    constexpr auto min_output = util::min<DataType>();
+    constexpr auto min_output = util::min<ComputeType>();
 
     if (offset >= spatial_size)
         return;
@@ -563,21 +597,21 @@ __global__ void fp_channel_kernel(const DataType* __restrict__ x,
     y += sample_idx * sample_size;
 
     // Calc max
-    DataType ch_max = util::min<DataType>();
+    ComputeType ch_max = util::min<ComputeType>();
     for (int cid = 0; cid < num_channels; ++cid)
     {
-        auto x_i = x[offset + spatial_size * cid];
+        auto x_i = util::to_accumulation(x[offset + spatial_size * cid]);
         x_cache[cache_idx + BLOCK_SIZE * cid] = x_i;
         ch_max = ::max(ch_max, x_i);
     }
 
     // Calc exp and sum
-    DataType ch_sum = DataType(0);
+    ComputeType ch_sum = ComputeType(0);
     for (int cid = 0; cid < num_channels; ++cid)
     {
         auto ch_off = BLOCK_SIZE * cid;
         auto x_i = x_cache[cache_idx + ch_off];
-        x_i = exp<DataType>()(x_i - ch_max);
+        x_i = exp<ComputeType>()(x_i - ch_max);
         x_cache[cache_idx + ch_off] = x_i;
         ch_sum += x_i;
     }
@@ -588,10 +622,263 @@ __global__ void fp_channel_kernel(const DataType* __restrict__ x,
         auto ch_off = BLOCK_SIZE * cid;
         auto x_i = x_cache[cache_idx + ch_off];
         x_i = ::max(x_i * ch_sum, min_output);
-        y[offset + spatial_size * cid] = x_i;
+        y[offset + spatial_size * cid] = util::from_accumulation<DataType>(x_i);
+    }
+}
+
+// Softmax of samples (or channel vectors) small enough to be held in
+// registers is computed in a single kernel that reads the input once.
+// Partial results of threads are (max, sum of exp(x - max)) pairs,
+// which are merged by rescaling the sums to the larger max.
+
+constexpr int max_sample_items_per_lane = 16;
+constexpr int max_register_channels = 32;
+
+template <typename DataType>
+__device__ __forceinline__ DataType shuffle_xor(DataType value, int mask)
+{
+#if H2_HAS_CUDA
+    return __shfl_xor_sync(0xffffffff, value, mask);
+#else
+    return __shfl_xor(value, mask);
+#endif
+}
+
+template <typename DataType>
+__device__ __forceinline__ void merge_softmax_partial(DataType& max_value,
+                                                      DataType& sum_value,
+                                                      DataType other_max,
+                                                      DataType other_sum)
+{
+    auto const m = ::max(max_value, other_max);
+    sum_value = sum_value * exp<DataType>()(max_value - m)
+                + other_sum * exp<DataType>()(other_max - m);
+    max_value = m;
+}
+
+// Each warp computes the softmax of one sample of at most
+// ITEMS * warp_size elements.
+template <typename DataType, int ITEMS>
+__global__ void fp_sample_warp_kernel(const DataType* __restrict__ x,
+                                      size_t sample_size,
+                                      int num_samples,
+                                      AccType<DataType> min_output,
+                                      DataType* __restrict__ y)
+{
+    using ComputeType = AccType<DataType>;
+    constexpr int warp_size = h2::gpu::warp_size;
+    const int lane = threadIdx.x % warp_size;
+    const int sample_idx = (blockIdx.x * blockDim.x + threadIdx.x) / warp_size;
+    // The whole warp exits together, so shuffles below are complete.
+    if (sample_idx >= num_samples)
+        return;
+
+    x += sample_idx * sample_size;
+    y += sample_idx * sample_size;
+
+    ComputeType x_reg[ITEMS];
+    ComputeType local_max = util::min<ComputeType>();
+#pragma unroll
+    for (int i = 0; i < ITEMS; ++i)
+    {
+        size_t const idx = lane + i * warp_size;
+        x_reg[i] = (idx < sample_size) ? util::to_accumulation(x[idx])
+                                       : util::min<ComputeType>();
+        local_max = ::max(local_max, x_reg[i]);
+    }
+
+    ComputeType local_sum = ComputeType(0);
+#pragma unroll
+    for (int i = 0; i < ITEMS; ++i)
+    {
+        if (static_cast<size_t>(lane + i * warp_size) < sample_size)
+        {
+            x_reg[i] = exp<ComputeType>()(x_reg[i] - local_max);
+            local_sum += x_reg[i];
+        }
+    }
+
+    ComputeType sample_max = local_max;
+    ComputeType sample_sum = local_sum;
+#pragma unroll
+    for (int mask = warp_size / 2; mask > 0; mask /= 2)
+    {
+        auto const other_max = shuffle_xor(sample_max, mask);
+        auto const other_sum = shuffle_xor(sample_sum, mask);
+        merge_softmax_partial(sample_max, sample_sum, other_max, other_sum);
+    }
+
+    auto const scale = exp<ComputeType>()(local_max - sample_max) / sample_sum;
+#pragma unroll
+    for (int i = 0; i < ITEMS; ++i)
+    {
+        size_t const idx = lane + i * warp_size;
+        if (idx < sample_size)
+            y[idx] = util::from_accumulation<DataType>(
+                ::max(x_reg[i] * scale, min_output));
     }
 }
 
+template <int ITEMS, typename Tensor>
+void launch_fp_sample_warp(const Tensor& x,
+                           Tensor& y,
+                           int num_samples,
+                           size_t sample_size,
+                           h2::gpu::DeviceStream stream)
+{
+    using DataType = typename Tensor::data_type;
+    constexpr int samples_per_block = block_size / h2::gpu::warp_size;
+    dim3 gdim(util::ceil(num_samples, samples_per_block));
+    fp_sample_warp_kernel<DataType, ITEMS>
+        <<<gdim, block_size, 0, stream>>>(x.get_base_ptr(),
+                                          sample_size,
+                                          num_samples,
+                                          get_min<DataType>(),
+                                          y.get_base_ptr());
+    DISTCONV_CHECK_GPU(GPU_GET_LAST_ERROR());
+}
+
+// Returns false without doing anything if samples are too large to be
+// held by a warp.
+template <typename Tensor>
+bool fp_sample_warp(const Tensor& x, Tensor& y, h2::gpu::DeviceStream stream)
+{
+    int num_samples;
+    size_t sample_size;
+    dim3 gdim;
+    set_kernel_params(x, num_samples, sample_size, gdim);
+    if (num_samples == 0 || sample_size == 0)
+        return true;
+
+    size_t const num_items =
+        util::ceil(sample_size, (size_t) h2::gpu::warp_size);
+    if (num_items <= 1)
+        launch_fp_sample_warp<1>(x, y, num_samples, sample_size, stream);
+    else if (num_items <= 2)
+        launch_fp_sample_warp<2>(x, y, num_samples, sample_size, stream);
+    else if (num_items <= 4)
+        launch_fp_sample_warp<4>(x, y, num_samples, sample_size, stream);
+    else if (num_items <= 8)
+        launch_fp_sample_warp<8>(x, y, num_samples, sample_size, stream);
+    else if (num_items <= max_sample_items_per_lane)
+        launch_fp_sample_warp<max_sample_items_per_lane>(
+            x, y, num_samples, sample_size, stream);
+    else
+        return false;
+    return true;
+}
+
+// Same as fp_channel_kernel, but the channel vector of each thread is
+// kept in registers, so at most MAX_CHANNELS channels are supported.
+template <typename DataType, int BLOCK_SIZE, int MAX_CHANNELS>
+__global__ void fp_channel_register_kernel(const DataType* __restrict__ x,
+                                           size_t spatial_size,
+                                           int num_channels,
+                                           DataType* __restrict__ y)
+{
+    size_t offset = blockIdx.x * BLOCK_SIZE + threadIdx.x;
+    const size_t sample_size = spatial_size * num_channels;
+    const int sample_idx = blockIdx.y;
+    using ComputeType = AccType<DataType>;
+    constexpr auto min_output = util::min<ComputeType>();
+
+    if (offset >= spatial_size)
+        return;
+
+    x += sample_idx * sample_size + offset;
+    y += sample_idx * sample_size + offset;
+
+    ComputeType x_reg[MAX_CHANNELS];
+    ComputeType ch_max = util::min<ComputeType>();
+#pragma unroll
+    for (int cid = 0; cid < MAX_CHANNELS; ++cid)
+    {
+        if (cid < num_channels)
+        {
+            x_reg[cid] = util::to_accumulation(x[spatial_size * cid]);
+            ch_max = ::max(ch_max, x_reg[cid]);
+        }
+    }
+
+    ComputeType ch_sum = ComputeType(0);
+#pragma unroll
+    for (int cid = 0; cid < MAX_CHANNELS; ++cid)
+    {
+        if (cid < num_channels)
+        {
+            x_reg[cid] = exp<ComputeType>()(x_reg[cid] - ch_max);
+            ch_sum += x_reg[cid];
+        }
+    }
+
+    ch_sum = 1 / ch_sum;
+#pragma unroll
+    for (int cid = 0; cid < MAX_CHANNELS; ++cid)
+    {
+        if (cid < num_channels)
+            y[spatial_size * cid] = util::from_accumulation<DataType>(
+                ::max(x_reg[cid] * ch_sum, min_output));
+    }
+}
+
+template <int MAX_CHANNELS, typename Tensor>
+void launch_fp_channel_register(const Tensor& x,
+                                Tensor& y,
+                                dim3 gdim,
+                                size_t spatial_size,
+                                int num_channels,
+                                h2::gpu::DeviceStream stream)
+{
+    using DataType = typename Tensor::data_type;
+    fp_channel_register_kernel<DataType, block_size, MAX_CHANNELS>
+        <<<gdim, block_size, 0, stream>>>(
+            x.get_base_ptr(), spatial_size, num_channels, y.get_base_ptr());
+}
+
+// partials holds the (max, sum) pairs of num_ranks ranks, each as
+// num_samples maxima followed by num_samples sums. Each sum is of
+// exp(x - max) over the rank's partition. Overwrites sample_exp with
+// the divisor that turns the local exp(x - local_max) into softmax.
+template <typename DataType>
+__global__ void
+merge_softmax_partials_kernel(const DataType* __restrict__ partials,
+                              int num_samples,
+                              int num_ranks,
+                              const DataType* __restrict__ local_max,
+                              DataType* __restrict__ sample_exp)
+{
+    const int sample_idx = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sample_idx >= num_samples)
+        return;
+
+    DataType sample_max = util::min<DataType>();
+    DataType sample_sum = DataType(0);
+    for (int r = 0; r < num_ranks; ++r)
+    {
+        const DataType* rank_partials = partials + r * 2 * num_samples;
+        merge_softmax_partial(sample_max,
+                              sample_sum,
+                              rank_partials[sample_idx],
+                              rank_partials[num_samples + sample_idx]);
+    }
+    sample_exp[sample_idx] =
+        sample_sum * exp<DataType>()(sample_max - local_max[sample_idx]);
+}
+
+template <typename DataType>
+void merge_softmax_partials(const DataType* partials,
+                            int num_samples,
+                            int num_ranks,
+                            const DataType* local_max,
+                            DataType* sample_exp,
+                            h2::gpu::DeviceStream stream)
+{
+    dim3 gdim(util::ceil(num_samples, block_size));
+    merge_softmax_partials_kernel<DataType><<<gdim, block_size, 0, stream>>>(
+        partials, num_samples, num_ranks, local_max, sample_exp);
+    DISTCONV_CHECK_GPU(GPU_GET_LAST_ERROR());
+}
+
 template <typename Tensor>
 int fp_channel(const Tensor& x, Tensor& y, h2::gpu::DeviceStream stream)
 {
@@ -608,7 +895,26 @@ int fp_channel(const Tensor& x, Tensor& y, h2::gpu::DeviceStream stream)
     auto num_blocks_per_sample = util::ceil(spatial_size, (size_t) block_size);
 
     dim3 gdim(num_blocks_per_sample, num_samples);
-    auto shmem_size = num_channels * block_size * sizeof(DataType);
+
+    if (num_channels <= max_register_channels)
+    {
+        if (num_channels <= 4)
+            launch_fp_channel_register<4>(
+                x, y, gdim, spatial_size, num_channels, stream);
+        else if (num_channels <= 8)
+            launch_fp_channel_register<8>(
+                x, y, gdim, spatial_size, num_channels, stream);
+        else if (num_channels <= 16)
+            launch_fp_channel_register<16>(
+                x, y, gdim, spatial_size, num_channels, stream);
+        else
+            launch_fp_channel_register<max_register_channels>(
+                x, y, gdim, spatial_size, num_channels, stream);
+        DISTCONV_CHECK_GPU(GPU_GET_LAST_ERROR());
+        return 0;
+    }
+
+    auto shmem_size = num_channels * block_size * sizeof(AccType<DataType>);
 
     fp_channel_kernel<DataType, block_size>
         <<<gdim, block_size, shmem_size, stream>>>(
@@ -629,9 +935,10 @@ __global__ void bp_channel_kernel(const DataType* __restrict__ y,
     const size_t sample_size = spatial_size * num_channels;
     const int sample_idx = blockIdx.y;
     extern __shared__ __align__(sizeof(double)) unsigned char cache_char[];
-    DataType* cache = reinterpret_cast<DataType*>(cache_char);
+    using ComputeType = AccType<DataType>;
+    ComputeType* cache = reinterpret_cast<ComputeType*>(cache_char);
     const int cache_idx = threadIdx.x;
-    constexpr auto min_output = util::min<DataType>();
+    constexpr auto min_output = util::min<ComputeType>();
 
     if (offset >= spatial_size)
         return;
@@ -641,13 +948,13 @@ __global__ void bp_channel_kernel(const DataType* __restrict__ y,
     dx += sample_idx * sample_size;
 
     // Calc dotproduct
-    DataType dp = DataType(0);
+    ComputeType dp = ComputeType(0);
     auto cache_offset = cache_idx;
     for (int cid = 0; cid < num_channels; ++cid)
     {
         auto off = offset + spatial_size * cid;
-        auto y_i = y[off];
-        auto dy_i = dy[off];
+        auto y_i = util::to_accumulation(y[off]);
+        auto dy_i = util::to_accumulation(dy[off]);
         dp += y_i * dy_i;
         cache[cache_offset] = y_i;
         cache_offset += BLOCK_SIZE;
@@ -663,8 +970,9 @@ __global__ void bp_channel_kernel(const DataType* __restrict__ y,
         cache_offset += BLOCK_SIZE;
         auto dy_i = cache[cache_offset];
         cache_offset += BLOCK_SIZE;
-        auto grad = y_i > min_output ? y_i * (dy_i - dp) : DataType(0);
-        dx[offset + spatial_size * cid] = grad;
+        auto grad = y_i > min_output ? y_i * (dy_i - dp) : ComputeType(0);
+        dx[offset + spatial_size * cid] =
+            util::from_accumulation<DataType>(grad);
     }
 }
 
@@ -687,7 +995,8 @@ int bp_channel(const Tensor& y,
     auto num_blocks_per_sample = util::ceil(spatial_size, (size_t) block_size);
 
     dim3 gdim(num_blocks_per_sample, num_samples);
-    auto shmem_size = num_channels * block_size * 2 * sizeof(DataType);
+    auto shmem_size =
+        num_channels * block_size * 2 * sizeof(AccType<DataType>);
 
     bp_channel_kernel<DataType, block_size>
         <<<gdim, block_size, shmem_size, stream>>>(y.get_base_ptr(),
@@ -720,29 +1029,49 @@ int Softmax<BackendDNNLib>::forward(const Tensor& x, Tensor& y)
         return fp_channel(x, y, m_stream);
     }
 
+    // Samples that are not partitioned and fit in a warp need no
+    // separate reduction passes.
+    if (m_num_procs_per_sample < 2 && fp_sample_warp(x, y, m_stream))
+    {
+        return 0;
+    }
+
+    using ComputeType = AccType<DataType>;
     auto& mempool = internal::RuntimeGPU::get_device_memory_pool();
-    auto ws_size = num_samples * sizeof(DataType);
-    DataType* sample_max =
-        static_cast<DataType*>(mempool.get(ws_size, m_stream));
-    DataType* sample_exp =
-        static_cast<DataType*>(mempool.get(ws_size, m_stream));
+    auto ws_size = num_samples * sizeof(ComputeType);
+    // The local maxima and sums are stored contiguously so that they
+    // can be exchanged at once.
+    ComputeType* partials =
+        static_cast<ComputeType*>(mempool.get(ws_size * 2, m_stream));
+    ComputeType* sample_max = partials;
+    ComputeType* sample_exp = partials + num_samples;
 
-    h2::gpu::mem_zero(sample_max, num_samples, m_stream);
-    h2::gpu::mem_zero(sample_exp, num_samples, m_stream);
+    h2::gpu::mem_zero(partials, num_samples * 2, m_stream);
 
-    // compute sample-wise max
+    // compute sample-wise max of the local partition
     compute_max(x, sample_max, m_stream);
-    allreduce(sample_max, num_samples, true);
 
-    // compute summation of exp
+    // compute summation of exp shifted by the local max
     compute_exp(x, sample_max, y, sample_exp, m_stream);
-    allreduce(sample_exp, num_samples, false);
+
+    // Rather than allreducing the max before computing exp and then
+    // the sum, gather the (max, sum) pairs of all partitions and
+    // rescale each sum to the global max.
+    if (m_num_procs_per_sample > 1)
+    {
+        int const num_ranks = m_sample_al->size();
+        ComputeType* gathered = static_cast<ComputeType*>(
+            mempool.get(ws_size * 2 * num_ranks, m_stream));
+        allgather(partials, gathered, num_samples * 2);
+        merge_softmax_partials(
+            gathered, num_samples, num_ranks, sample_max, sample_exp, m_stream);
+        mempool.release(gathered);
+    }
 
     // update the output
     compute_softmax(sample_exp, y, m_stream);
 
-    mempool.release(sample_max);
-    mempool.release(sample_exp);
+    mempool.release(partials);
     return 0;
 }
 
@@ -767,11 +1096,12 @@ int Softmax<BackendDNNLib>::backward(const Tensor& y,
         return bp_channel(y, dy, dx, m_stream);
     }
 
+    using ComputeType = AccType<DataType>;
     auto& mempool = internal::RuntimeGPU::get_device_memory_pool();
-    auto ws_size = num_samples * sizeof(DataType);
+    auto ws_size = num_samples * sizeof(ComputeType);
 
-    DataType* sample_dp =
-        static_cast<DataType*>(mempool.get(ws_size, m_stream));
+    ComputeType* sample_dp =
+        static_cast<ComputeType*>(mempool.get(ws_size, m_stream));
 
     h2::gpu::mem_zero(sample_dp, num_samples, m_stream);
 
@@ -791,6 +1121,10 @@ int Softmax<BackendDNNLib>::backward(const Tensor& y,
         const TensorCUDA<T>& y, const TensorCUDA<T>& dy, TensorCUDA<T>& dx);
 PROTO(float)
 PROTO(double)
+#if H2_HAS_GPU_LOW_PRECISION
+PROTO(h2::gpu::Half)
+PROTO(h2::gpu::BFloat16)
+#endif // H2_HAS_GPU_LOW_PRECISION
 #undef PROTO
 
 } // namespace distconv
@@ -0,0 +1,101 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2023 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "distconv_config.hpp"
+
+#include "distconv/dnn_backend/dnn_backend.hpp"
+#include "distconv/runtime_gpu.hpp"
+#include "distconv/util/util_mpi.hpp"
+
+#include <algorithm> // std::max
+#include <memory>    // std::make_unique
+
+namespace distconv
+{
+
+Workspace::Workspace(size_t size, h2::gpu::DeviceStream stream)
+    : m_capacity{0}, m_size{0}, m_ptr{nullptr}, m_stream{stream}
+{
+    realloc(size);
+}
+
+Workspace::~Workspace()
+{
+    realloc(0);
+}
+
+void* Workspace::realloc(size_t size)
+{
+    auto& mempool = internal::RuntimeGPU::get_device_memory_pool();
+    if (size == 0 || size > m_capacity)
+    {
+        // The pool orders the reuse of freed memory after the work
+        // enqueued on the stream.
+        if (m_ptr)
+            mempool.release(m_ptr);
+        m_ptr = nullptr;
+        m_capacity = 0;
+        if (size > 0)
+        {
+            m_ptr = mempool.get(size, m_stream);
+            m_capacity = size;
+        }
+    }
+    m_size = size;
+    return m_ptr;
+}
+
+WorkspaceArena& WorkspaceArena::instance()
+{
+    // Never destroyed, as the memory pool may be gone at exit.
+    static WorkspaceArena* arena = new WorkspaceArena();
+    return *arena;
+}
+
+void* WorkspaceArena::get(size_t size, h2::gpu::DeviceStream stream)
+{
+    // Operations without workspace still get a valid pointer.
+    size = std::max<size_t>(size, 1);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& ws = m_workspaces[stream];
+    if (!ws)
+    {
+        ws = std::make_unique<Workspace>(size, stream);
+    }
+    else if (size > ws->capacity())
+    {
+        util::MPIPrintStreamDebug() << "Growing the workspace of stream "
+                                    << stream << " from " << ws->capacity()
+                                    << " to " << size << " bytes";
+        ws->realloc(size);
+    }
+    return ws->ptr();
+}
+
+size_t WorkspaceArena::capacity() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t total = 0;
+    for (auto const& ws : m_workspaces)
+        total += ws.second->capacity();
+    return total;
+}
+
+size_t WorkspaceArena::capacity(h2::gpu::DeviceStream stream) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto const it = m_workspaces.find(stream);
+    return it == m_workspaces.end() ? 0 : it->second->capacity();
+}
+
+void WorkspaceArena::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_workspaces.clear();
+}
+
+} // namespace distconv
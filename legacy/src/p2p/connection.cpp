@@ -1,6 +1,6 @@
 #include "p2p/connection.hpp"
 #include "p2p/util.hpp"
-#include "p2p/util_cuda.hpp"
+#include "p2p/util_gpu.hpp"
 #include "p2p/logging.hpp"
 
 using namespace p2p::logging;
@@ -12,7 +12,7 @@ Connection::Connection(int peer, const internal::MPI &mpi,
     m_peer(peer), m_mpi(mpi), m_ev_pool(ev_pool),
     m_connected(false) {
   // set remote device ID
-  P2P_CHECK_CUDA_ALWAYS(cudaGetDevice(&m_dev));
+  P2P_CHECK_GPU_ALWAYS(gpu::get_device(&m_dev));
   MPIPrintStreamDebug() << "Using device " << m_dev << "\n";
 }
 
@@ -46,21 +46,50 @@ int Connection::exchange_addr(void *local_addr,
   return 0;
 }
 
-int Connection::notify(cudaStream_t stream) {
+int Connection::put_batch(const PutDesc *puts, int num_puts,
+                          DeviceStream stream) {
+  for (int i = 0; i < num_puts; ++i) {
+    put(puts[i].src, puts[i].dst, puts[i].size, stream);
+  }
+  return 0;
+}
+
+int Connection::transfer_batch(const TransferDesc *transfers,
+                               int num_transfers, DeviceStream stream,
+                               bool is_src) {
+  for (int i = 0; i < num_transfers; ++i) {
+    transfer(transfers[i].local_buf, transfers[i].peer_buf,
+             transfers[i].size, stream, is_src);
+  }
+  return 0;
+}
+
+int Connection::put_transfers(const TransferDesc *transfers,
+                              int num_transfers, DeviceStream stream) {
+  std::vector<PutDesc> puts;
+  puts.reserve(num_transfers);
+  for (int i = 0; i < num_transfers; ++i) {
+    puts.push_back({transfers[i].local_buf, transfers[i].peer_buf,
+                    transfers[i].size});
+  }
+  return put_batch(puts.data(), num_transfers, stream);
+}
+
+int Connection::notify(DeviceStream stream) {
   auto req = notify_nb(stream);
   return req.process();
 }
 
-int Connection::wait(cudaStream_t stream) {
+int Connection::wait(DeviceStream stream) {
   auto req = wait_nb(stream);
   return req.process();
 }
 
-int Connection::notify_post(cudaStream_t stream) {
+int Connection::notify_post(DeviceStream stream) {
   return 0;
 }
 
-int Connection::wait_post(cudaStream_t stream) {
+int Connection::wait_post(DeviceStream stream) {
   return 0;
 }
 
@@ -1,10 +1,13 @@
 #include "p2p/connection_ipc.hpp"
+#include "p2p/config.hpp"
+#include "p2p/copy_batch.hpp"
 #include "p2p/util.hpp"
-#include "p2p/util_cuda.hpp"
+#include "p2p/util_gpu.hpp"
 #include "p2p/logging.hpp"
 #include "p2p/mpi.hpp"
 
 #include <cstring>
+#include <memory>
 
 using namespace p2p::logging;
 
@@ -23,33 +26,38 @@ bool ConnectionIPC::is_ipc_capable(int peer, internal::MPI &mpi,
     return false;
   }
   int peer_access;
-  P2P_CHECK_CUDA_ALWAYS(
-      cudaDeviceCanAccessPeer(&peer_access, self_dev, peer_dev));
+  P2P_CHECK_GPU_ALWAYS(
+      gpu::can_access_peer(&peer_access, self_dev, peer_dev));
   if (peer_access != 0) {
     // Peer access possible
     return true;
   }
   // IPC memcpy is still possible if a context can be created
   // at the remote device
-  cudaDeviceProp prop;
-  P2P_CHECK_CUDA_ALWAYS(
-      cudaGetDeviceProperties(&prop, peer_dev));
-  if (prop.computeMode == cudaComputeModeDefault) {
-    return true;
-  }
-  return false;
+  return gpu::is_compute_mode_default(peer_dev);
 }
 
 ConnectionIPC::ConnectionIPC(int peer, int dev,
                              const internal::MPI &mpi,
                              util::EventPool &ev_pool):
     Connection(peer, mpi, ev_pool), m_dev_peer(dev),
-    m_peer_event_opened(false), m_peer_enabled(false) {
+    m_peer_event_opened(false), m_peer_enabled(false),
+    m_use_stream_mem_ops(false), m_flag(nullptr), m_peer_flag(nullptr),
+    m_notify_counter(0), m_wait_counter(0) {
   // enable peer access
   enable_peer_access_if_possible();
   // set up event
-  P2P_CHECK_CUDA_ALWAYS(cudaEventCreateWithFlags(
-      &m_ev, cudaEventInterprocess | cudaEventDisableTiming));
+  P2P_CHECK_GPU_ALWAYS(gpu::event_create_ipc(&m_ev));
+  P2P_CHECK_GPU_ALWAYS(gpu::ipc_get_event_handle(&m_self_info.ev_handle, m_ev));
+  // The peer writes to the flag directly, which needs peer access
+  m_self_info.use_stream_mem_ops =
+      m_peer_enabled && util::is_stream_mem_enabled();
+  if (m_self_info.use_stream_mem_ops) {
+    P2P_CHECK_GPU_ALWAYS(gpu::malloc(&m_flag, sizeof(WaitValue)));
+    P2P_CHECK_GPU_ALWAYS(gpu::memset(m_flag, 0, sizeof(WaitValue)));
+    P2P_CHECK_GPU_ALWAYS(
+        gpu::ipc_get_mem_handle(&m_self_info.flag_handle, m_flag));
+  }
   m_peer_event_opened = false;
   m_connected = false;
 }
@@ -62,22 +70,30 @@ ConnectionIPC::~ConnectionIPC() {
 
 Request ConnectionIPC::connect_nb() {
   logging::MPIPrintStreamDebug() << "ConnectIPC::connect_nb\n";
-  cudaIpcEventHandle_t ipc_handle_self;
-  P2P_CHECK_CUDA_ALWAYS(cudaIpcGetEventHandle(&ipc_handle_self, m_ev));
   MPI_Request isend_req;
-  m_mpi.isend(&ipc_handle_self, sizeof(cudaIpcEventHandle_t),
-              m_peer, &isend_req);
+  m_mpi.isend(&m_self_info, sizeof(ConnectInfo), m_peer, &isend_req);
   MPI_Request irecv_req;
-  m_mpi.irecv(&m_peer_ev_handle, sizeof(cudaIpcEventHandle_t),
-              m_peer, &irecv_req);
+  m_mpi.irecv(&m_peer_info, sizeof(ConnectInfo), m_peer, &irecv_req);
   Request req(Request::Kind::CONNECT, this, isend_req, irecv_req);
   return req;
 }
 
 int ConnectionIPC::connect_post() {
-  P2P_CHECK_CUDA_ALWAYS(
-      cudaIpcOpenEventHandle(&m_ev_peer, m_peer_ev_handle));
+  P2P_CHECK_GPU_ALWAYS(
+      gpu::ipc_open_event_handle(&m_ev_peer, m_peer_info.ev_handle));
   m_peer_event_opened = true;
+  m_use_stream_mem_ops =
+      m_self_info.use_stream_mem_ops && m_peer_info.use_stream_mem_ops;
+  if (m_use_stream_mem_ops) {
+    void *peer_flag = nullptr;
+    P2P_CHECK_GPU_ALWAYS(
+        gpu::ipc_open_mem_handle(&peer_flag, m_peer_info.flag_handle));
+    m_peer_flag = static_cast<WaitValue*>(peer_flag);
+  }
+  MPIPrintStreamDebug() << "IPC notification with "
+                        << (m_use_stream_mem_ops ?
+                            "stream memory operations" : "IPC events")
+                        << "\n";
   m_connected = true;
   return 0;
 }
@@ -85,20 +101,16 @@ int ConnectionIPC::connect_post() {
 void ConnectionIPC::enable_peer_access_if_possible() {
   if (!m_peer_enabled) {
     int peer_access;
-    P2P_CHECK_CUDA_ALWAYS(
-        cudaDeviceCanAccessPeer(&peer_access, m_dev, m_dev_peer));
+    P2P_CHECK_GPU_ALWAYS(
+        gpu::can_access_peer(&peer_access, m_dev, m_dev_peer));
     if (peer_access) {
       MPIPrintStreamDebug() << "Enabling direct access from devices "
                             << m_dev << " to " << m_dev_peer
                             << ", current available memory: "
                             << (util::get_available_memory() / 1024 / 1024)
                             << " MB\n";
-      cudaError_t e = cudaDeviceEnablePeerAccess(m_dev_peer, 0);
-      P2P_ASSERT_ALWAYS(e == cudaSuccess ||
-                        e == cudaErrorPeerAccessAlreadyEnabled);
+      P2P_ASSERT_ALWAYS(gpu::enable_peer_access(m_dev_peer));
       m_peer_enabled = true;
-      // clear the error status
-      cudaGetLastError();
     }
   }
 }
@@ -107,19 +119,28 @@ Request ConnectionIPC::register_addr_nb(void *self, void *peer) {
   MPIPrintStreamDebug()
       << "Registering local addr, " << self << ", and remote addr, "
       << peer << "\n";
-  cudaIpcMemHandle_t self_handle;
-  auto *peer_data = new register_addr_data();
-  peer_data->first = peer;
+  auto *data = new RegisterData();
+  data->peer = peer;
   MPI_Request isend_req, irecv_req;
   if (self) {
-    P2P_CHECK_CUDA(cudaIpcGetMemHandle(&self_handle, self));
-    m_mpi.isend(&self_handle, sizeof(cudaIpcMemHandle_t), m_peer,
+    // The handle refers to the whole allocation self is in, which may
+    // be a block of a memory pool.
+    std::uintptr_t base;
+    size_t size;
+    P2P_CHECK_GPU_DRV(gpu::get_address_range(self, &base, &size));
+    P2P_CHECK_GPU(
+        gpu::ipc_get_mem_handle(&data->self_info.handle, (void*)base));
+    data->self_info.base = base;
+    data->self_info.size = size;
+    data->self_info.offset =
+        reinterpret_cast<std::uintptr_t>(self) - base;
+    m_mpi.isend(&data->self_info, sizeof(RegisterInfo), m_peer,
                 &isend_req);
   } else {
     isend_req = MPI_REQUEST_NULL;
   }
   if (peer) {
-    m_mpi.irecv(&(peer_data->second), sizeof(cudaIpcMemHandle_t), m_peer,
+    m_mpi.irecv(&data->peer_info, sizeof(RegisterInfo), m_peer,
                 &irecv_req);
   } else {
     irecv_req = MPI_REQUEST_NULL;
@@ -132,19 +153,34 @@ Request ConnectionIPC::register_addr_nb(void *self, void *peer) {
   m_opened_local_mem.insert(self);
 
   Request req(Request::Kind::REGISTER, this, isend_req, irecv_req);
-  req.set_data(peer_data);
+  req.set_data(data);
   return req;
 }
 
 int ConnectionIPC::register_addr_post(void *data) {
   P2P_ASSERT_ALWAYS(data != nullptr);
-  auto peer_data = static_cast<register_addr_data*>(data);
-  P2P_ASSERT_ALWAYS(peer_data != nullptr);
-  const void *peer = peer_data->first;
+  std::unique_ptr<RegisterData> reg_data(static_cast<RegisterData*>(data));
+  const void *peer = reg_data->peer;
   // peer may be null when there should be no transfer to the peer
   if (!peer) {
     return 0;
   }
+  const RegisterInfo &info = reg_data->peer_info;
+
+  auto block = m_mapped_blocks.find(info.base);
+  if (block != m_mapped_blocks.end() &&
+      (block->second.size != info.size ||
+       std::memcmp(&block->second.handle, &info.handle,
+                   sizeof(IpcMemHandle)) != 0)) {
+    // The peer has freed the block and allocated another at the same
+    // address, which it may only do once it is no longer registered.
+    MPIPrintStreamDebug()
+        << "Remote block at " << info.base << " from device "
+        << m_dev_peer << " was reallocated\n";
+    P2P_ASSERT_ALWAYS(block->second.num_refs == 0);
+    close_peer_block(block);
+    block = m_mapped_blocks.end();
+  }
 
   void *already_opened = find_mapped_peer_memory(peer);
   if (already_opened) {
@@ -154,80 +190,108 @@ int ConnectionIPC::register_addr_post(void *data) {
     return 0;
   }
 
-  cudaIpcMemHandle_t peer_handle = peer_data->second;
-  if (!m_peer_enabled) {
+  if (block == m_mapped_blocks.end()) {
+    if (!m_peer_enabled) {
+      MPIPrintStreamDebug()
+          << "Changing the current device to the remote device to open remote memmory handle\n";
+      P2P_CHECK_GPU_ALWAYS(gpu::set_device(m_dev_peer));
+    }
     MPIPrintStreamDebug()
-        << "Changing the current device to the remote device to open remote memmory handle\n";
-    P2P_CHECK_CUDA_ALWAYS(cudaSetDevice(m_dev_peer));
+        << "Opening remote block at " << info.base << " of "
+        << info.size << " bytes from device " << m_dev_peer << "\n";
+    void *mapped_mem = nullptr;
+    P2P_CHECK_GPU_ALWAYS(
+        gpu::ipc_open_mem_handle(&mapped_mem, info.handle));
+    P2P_ASSERT_ALWAYS(mapped_mem != nullptr);
+    if (!m_peer_enabled) {
+      P2P_CHECK_GPU_ALWAYS(gpu::set_device(m_dev));
+    }
+    block = m_mapped_blocks.emplace(
+        info.base, MappedBlock{info.handle, info.size,
+                               static_cast<char*>(mapped_mem), 0}).first;
   }
-
-  MPIPrintStreamDebug()
-      << "Opening remote memory, " << peer << ", from device "
-      << m_dev_peer << "\n";
-  void *mapped_mem = nullptr;
-  P2P_CHECK_CUDA_ALWAYS(
-      cudaIpcOpenMemHandle(&mapped_mem, peer_handle,
-                           cudaIpcMemLazyEnablePeerAccess));
-  P2P_ASSERT_ALWAYS(mapped_mem != nullptr);
+  void *mapped_addr = block->second.mapped_base + info.offset;
   MPIPrintStreamDebug()
-      << "Mapped at " << mapped_mem << "\n";
-  if (!m_peer_enabled) {
-    P2P_CHECK_CUDA_ALWAYS(cudaSetDevice(m_dev));
-  }
-  add_or_replace_mapped_peer_memory(peer, mapped_mem);
+      << "Remote memory " << peer << " mapped at " << mapped_addr << "\n";
+  ++block->second.num_refs;
+  add_or_replace_mapped_peer_memory(peer, mapped_addr);
   return 0;
 }
 
-int ConnectionIPC::deregister_addr(void *mapped_addr) {
-  P2P_ASSERT_ALWAYS(mapped_addr);
+ConnectionIPC::MappedBlockMap::iterator
+ConnectionIPC::find_peer_block(const void *mapped_addr) {
+  const char *addr = static_cast<const char*>(mapped_addr);
+  for (auto it = m_mapped_blocks.begin(); it != m_mapped_blocks.end();
+       ++it) {
+    const char *base = it->second.mapped_base;
+    if (base <= addr && addr < base + it->second.size) {
+      return it;
+    }
+  }
+  return m_mapped_blocks.end();
+}
+
+void ConnectionIPC::close_peer_block(MappedBlockMap::iterator block) {
+  char *base = block->second.mapped_base;
   if (!m_peer_enabled) {
-    P2P_CHECK_CUDA_ALWAYS(cudaSetDevice(m_dev_peer));
+    P2P_CHECK_GPU_ALWAYS(gpu::set_device(m_dev_peer));
   }
   MPIPrintStreamDebug()
-      << "Closing remote memory mapped at " << mapped_addr << "\n";
-  P2P_CHECK_CUDA_ALWAYS(cudaIpcCloseMemHandle(mapped_addr));
+      << "Closing remote block mapped at " << (void*)base << "\n";
+  P2P_CHECK_GPU_ALWAYS(gpu::ipc_close_mem_handle(base));
   if (!m_peer_enabled) {
-    P2P_CHECK_CUDA_ALWAYS(cudaSetDevice(m_dev));
+    P2P_CHECK_GPU_ALWAYS(gpu::set_device(m_dev));
   }
+  m_mapped_blocks.erase(block);
+}
+
+int ConnectionIPC::deregister_addr(void *mapped_addr) {
+  P2P_ASSERT_ALWAYS(mapped_addr);
+  auto block = find_peer_block(mapped_addr);
+  P2P_ASSERT_ALWAYS(block != m_mapped_blocks.end());
   delete_mapped_addr(mapped_addr);
+  if (--block->second.num_refs == 0 &&
+      !internal::cfg.cache_ipc_mappings) {
+    close_peer_block(block);
+  }
   return 0;
 }
 
 int ConnectionIPC::send(const void *src, size_t size,
-                        cudaStream_t stream) {
+                        DeviceStream stream) {
   P2P_ASSERT_ALWAYS(0 && "Not implemented");
   return 0;
 }
 
 int ConnectionIPC::recv(void *dst, size_t size,
-                        cudaStream_t stream) {
+                        DeviceStream stream) {
   P2P_ASSERT_ALWAYS(0 && "Not implemented");
   return 0;
 }
 
 int ConnectionIPC::sendrecv(const void *send_src, size_t send_size,
                             void *recv_dst, size_t recv_size,
-                            cudaStream_t stream) {
+                            DeviceStream stream) {
   P2P_ASSERT_ALWAYS(0 && "Not implemented");
   return 0;
 }
 
 int ConnectionIPC::put(const void *src, void *dst, size_t size,
-                       cudaStream_t stream) {
+                       DeviceStream stream) {
   logging::MPIPrintStreamDebug()
       << "Put " << size << " bytes from "
       << src << " on device " << get_dev() << " to rank "
       << get_peer() << " using device " << m_dev_peer
       << " mapped to " << dst << "\n";
   if (size == 0) return 0;
-  P2P_CHECK_CUDA(cudaMemcpyPeerAsync(dst, m_dev_peer,
-                                     src, m_dev, size,
-                                     stream));
+  P2P_CHECK_GPU(gpu::memcpy_peer_async(dst, m_dev_peer,
+                                       src, m_dev, size,
+                                       stream));
   return 0;
 }
 
 int ConnectionIPC::transfer(void *local_buf, void *peer_buf, size_t size,
-                            cudaStream_t stream, bool is_src) {
+                            DeviceStream stream, bool is_src) {
   if (is_src) {
     return put(local_buf, peer_buf, size, stream);
   } else {
@@ -235,30 +299,40 @@ int ConnectionIPC::transfer(void *local_buf, void *peer_buf, size_t size,
   }
 }
 
+int ConnectionIPC::put_batch(const PutDesc *puts, int num_puts,
+                             DeviceStream stream) {
+  // The copy kernel writes to the peer mappings directly, which needs
+  // peer access.
+  if (!m_peer_enabled) {
+    return Connection::put_batch(puts, num_puts, stream);
+  }
+  logging::MPIPrintStreamDebug()
+      << "Put a batch of " << num_puts << " buffers to rank "
+      << get_peer() << " using device " << m_dev_peer << "\n";
+  internal::copy_batch(puts, num_puts, stream);
+  return 0;
+}
+
+int ConnectionIPC::transfer_batch(const TransferDesc *transfers,
+                                  int num_transfers,
+                                  DeviceStream stream, bool is_src) {
+  if (!is_src) return 0;
+  return put_transfers(transfers, num_transfers, stream);
+}
+
 int ConnectionIPC::close_remote_resources() {
   logging::MPIPrintStreamDebug()
       << "IPC: Closing remote resources\n";
-  for (auto &x: m_remote_mem_map) {
-    logging::MPIPrintStreamDebug()
-        << "Remote memory of " << x.second << " mapped to "
-        << x.first << "\n";
-    P2P_ASSERT_ALWAYS(x.first);
-    P2P_ASSERT_ALWAYS(x.second);
-    if (x.second != nullptr) {
-      if (!m_peer_enabled) {
-        P2P_CHECK_CUDA_ALWAYS(cudaSetDevice(m_dev_peer));
-      }
-      logging::MPIPrintStreamDebug()
-          << "Closing remote memory handle: " << x.first << "\n";
-      P2P_CHECK_CUDA_ALWAYS(cudaIpcCloseMemHandle(x.second));
-      if (!m_peer_enabled) {
-        P2P_CHECK_CUDA_ALWAYS(cudaSetDevice(m_dev));
-      }
-    }
+  while (!m_mapped_blocks.empty()) {
+    close_peer_block(m_mapped_blocks.begin());
   }
   m_remote_mem_map.clear();
+  if (m_peer_flag != nullptr) {
+    P2P_CHECK_GPU_ALWAYS(gpu::ipc_close_mem_handle(m_peer_flag));
+    m_peer_flag = nullptr;
+  }
   if (m_peer_event_opened) {
-    P2P_CHECK_CUDA_ALWAYS(cudaEventDestroy(m_ev_peer));
+    P2P_CHECK_GPU_ALWAYS(gpu::event_destroy(m_ev_peer));
     m_peer_event_opened = false;
   }
   return 0;
@@ -266,13 +340,24 @@ int ConnectionIPC::close_remote_resources() {
 
 int ConnectionIPC::disconnect() {
   if (!m_connected) return 0;
-  P2P_CHECK_CUDA_ALWAYS(cudaEventDestroy(m_ev));
+  P2P_CHECK_GPU_ALWAYS(gpu::event_destroy(m_ev));
+  if (m_flag != nullptr) {
+    P2P_CHECK_GPU_ALWAYS(gpu::free(m_flag));
+    m_flag = nullptr;
+  }
   m_connected = false;
   return 0;
 }
 
-Request ConnectionIPC::notify_nb(cudaStream_t stream) {
-  P2P_CHECK_CUDA(cudaEventRecord(m_ev, stream));
+Request ConnectionIPC::notify_nb(DeviceStream stream) {
+  if (m_use_stream_mem_ops) {
+    // The count only increases, so the peer does not need to
+    // acknowledge one notification before the next.
+    P2P_CHECK_GPU_DRV(gpu::stream_write_value(
+        stream, m_peer_flag, ++m_notify_counter));
+    return Request();
+  }
+  P2P_CHECK_GPU(gpu::event_record(m_ev, stream));
   MPI_Request mpi_req;
   m_mpi.inotify(m_peer, &mpi_req);
   Request req(
@@ -281,7 +366,14 @@ Request ConnectionIPC::notify_nb(cudaStream_t stream) {
   return req;
 }
 
-bool ConnectionIPC::notify_handler(cudaStream_t stream,
+void ConnectionIPC::get_device_notification(WaitValue **peer_flag,
+                                            WaitValue *value) {
+  P2P_ASSERT_ALWAYS(m_use_stream_mem_ops);
+  *peer_flag = m_peer_flag;
+  *value = ++m_notify_counter;
+}
+
+bool ConnectionIPC::notify_handler(DeviceStream stream,
                                    void *data,
                                    Request *req) {
   MPI_Request mr;
@@ -290,7 +382,12 @@ bool ConnectionIPC::notify_handler(cudaStream_t stream,
   return false;
 }
 
-Request ConnectionIPC::wait_nb(cudaStream_t stream) {
+Request ConnectionIPC::wait_nb(DeviceStream stream) {
+  if (m_use_stream_mem_ops) {
+    P2P_CHECK_GPU_DRV(gpu::stream_wait_value_geq(
+        stream, m_flag, ++m_wait_counter));
+    return Request();
+  }
   MPI_Request mr;
   m_mpi.iwait_notification(m_peer, &mr);
   Request req(
@@ -299,10 +396,10 @@ Request ConnectionIPC::wait_nb(cudaStream_t stream) {
   return req;
 }
 
-bool ConnectionIPC::wait_handler(cudaStream_t stream,
+bool ConnectionIPC::wait_handler(DeviceStream stream,
                                  void *data,
                                  Request *req) {
-  P2P_CHECK_CUDA(cudaStreamWaitEvent(stream, m_ev_peer, 0));
+  P2P_CHECK_GPU(gpu::stream_wait_event(stream, m_ev_peer));
   MPI_Request mr;
   m_mpi.inotify(m_peer, &mr);
   *req = Request(this, mr);
@@ -21,36 +21,36 @@ Request ConnectionNULL::register_addr_nb(void *self, void *peer) {
 }
 
 int ConnectionNULL::send(const void *src, size_t size,
-                         cudaStream_t stream) {
+                         DeviceStream stream) {
   return 0;
 }
 
 int ConnectionNULL::recv(void *dst, size_t size,
-                         cudaStream_t stream) {
+                         DeviceStream stream) {
   return 0;
 }
 
 int ConnectionNULL::sendrecv(const void *send_src, size_t send_size,
                              void *recv_dst, size_t recv_size,
-                             cudaStream_t stream) {
+                             DeviceStream stream) {
   return 0;
 }
 
 int ConnectionNULL::put(const void *src, void *dst, size_t size,
-                        cudaStream_t stream) {
+                        DeviceStream stream) {
   return 0;
 }
 
 int ConnectionNULL::transfer(void *local_buf, void *peer_buf, size_t size,
-                             cudaStream_t stream, bool is_src) {
+                             DeviceStream stream, bool is_src) {
   return 0;
 }
 
-Request ConnectionNULL::notify_nb(cudaStream_t stream) {
+Request ConnectionNULL::notify_nb(DeviceStream stream) {
   return Request(Request::Kind::NOTIFY, this, MPI_REQUEST_NULL, stream);  
 }
 
-Request ConnectionNULL::wait_nb(cudaStream_t stream) {
+Request ConnectionNULL::wait_nb(DeviceStream stream) {
   return Request(Request::Kind::WAIT, this, MPI_REQUEST_NULL,
                  stream);
 }
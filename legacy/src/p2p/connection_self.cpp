@@ -1,6 +1,7 @@
 #include "p2p/connection_self.hpp"
+#include "p2p/copy_batch.hpp"
 #include "p2p/util.hpp"
-#include "p2p/util_cuda.hpp"
+#include "p2p/util_gpu.hpp"
 #include "p2p/logging.hpp"
 #include "p2p/mpi.hpp"
 
@@ -30,28 +31,28 @@ Request ConnectionSelf::register_addr_nb(void *self, void *peer) {
 }
 
 int ConnectionSelf::send(const void *src, size_t size,
-                        cudaStream_t stream) {
+                        DeviceStream stream) {
   P2P_ASSERT_ALWAYS(0 && "Not implemented");
   return 0;
 }
 
 int ConnectionSelf::recv(void *dst, size_t size,
-                         cudaStream_t stream) {
+                         DeviceStream stream) {
   P2P_ASSERT_ALWAYS(0 && "Not implemented");  
   return 0;
 }
 
 int ConnectionSelf::sendrecv(const void *send_src, size_t send_size,
                             void *recv_dst, size_t recv_size,
-                            cudaStream_t stream) {
+                            DeviceStream stream) {
   P2P_ASSERT_ALWAYS(0 && "Not implemented");
   return 0;
 }
 
 int ConnectionSelf::put(const void *src, void *dst, size_t size,
-                       cudaStream_t stream) {
+                       DeviceStream stream) {
   if (size == 0) return 0;
-  P2P_CHECK_CUDA(cudaMemcpyAsync(dst, src, size, cudaMemcpyDeviceToDevice, stream));
+  P2P_CHECK_GPU(gpu::memcpy_async(dst, src, size, stream));
   return 0;
 }
 
@@ -59,24 +60,24 @@ int ConnectionSelf::disconnect() {
   return 0;
 }
 
-Request ConnectionSelf::notify_nb(cudaStream_t stream) {
-  cudaEvent_t e = m_ev_pool.get();
-  P2P_CHECK_CUDA(cudaEventRecord(e, stream));
+Request ConnectionSelf::notify_nb(DeviceStream stream) {
+  DeviceEvent e = m_ev_pool.get();
+  P2P_CHECK_GPU(gpu::event_record(e, stream));
   m_notifications.push_back(std::make_pair(e, stream));
   return Request();
 }
 
-Request ConnectionSelf::wait_nb(cudaStream_t stream) {
+Request ConnectionSelf::wait_nb(DeviceStream stream) {
   auto n = m_notifications.front();
   if (n.second != stream) {
-    P2P_CHECK_CUDA(cudaStreamWaitEvent(stream, n.first, 0));
+    P2P_CHECK_GPU(gpu::stream_wait_event(stream, n.first));
   }
   m_notifications.pop_front();
   return Request();
 }
 
 int ConnectionSelf::transfer(void *local_buf, void *peer_buf, size_t size,
-                             cudaStream_t stream, bool is_src) {
+                             DeviceStream stream, bool is_src) {
   if (is_src) {
     return put(local_buf, peer_buf, size, stream);
   } else {
@@ -84,4 +85,17 @@ int ConnectionSelf::transfer(void *local_buf, void *peer_buf, size_t size,
   }
 }
 
+int ConnectionSelf::put_batch(const PutDesc *puts, int num_puts,
+                              DeviceStream stream) {
+  internal::copy_batch(puts, num_puts, stream);
+  return 0;
+}
+
+int ConnectionSelf::transfer_batch(const TransferDesc *transfers,
+                                   int num_transfers,
+                                   DeviceStream stream, bool is_src) {
+  if (!is_src) return 0;
+  return put_transfers(transfers, num_transfers, stream);
+}
+
 } // namespace p2p
@@ -0,0 +1,72 @@
+#include "p2p/copy_batch.hpp"
+#include "p2p/logging.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace p2p {
+namespace internal {
+
+namespace {
+
+constexpr int block_size = 256;
+constexpr size_t max_blocks = 64;
+
+// Passed by value so that no descriptors need to be copied to the
+// device before the launch
+struct CopyBatch {
+  PutDesc copies[COPY_BATCH_MAX_COPIES];
+};
+
+template <typename T>
+__device__ void copy_elements(const void *src, void *dst, size_t count) {
+  const T *s = static_cast<const T*>(src);
+  T *d = static_cast<T*>(dst);
+  const size_t stride = gridDim.x * blockDim.x;
+  for (size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < count;
+       i += stride) {
+    d[i] = s[i];
+  }
+}
+
+// Each row of blocks copies one buffer.
+__global__ void copy_batch_kernel(CopyBatch batch) {
+  const PutDesc &c = batch.copies[blockIdx.y];
+  const auto alignment = reinterpret_cast<std::uintptr_t>(c.src) |
+      reinterpret_cast<std::uintptr_t>(c.dst) | c.size;
+  if (alignment % sizeof(int4) == 0) {
+    copy_elements<int4>(c.src, c.dst, c.size / sizeof(int4));
+  } else {
+    copy_elements<char>(c.src, c.dst, c.size);
+  }
+}
+
+} // namespace
+
+void copy_batch(const PutDesc *puts, int num_puts, DeviceStream stream) {
+  CopyBatch batch;
+  int num_copies = 0;
+  size_t max_size = 0;
+  auto launch = [&]() {
+    if (num_copies == 0) return;
+    const size_t work = (max_size / sizeof(int4) + block_size - 1)
+        / block_size;
+    const dim3 grid(std::min(std::max(work, size_t(1)), max_blocks),
+                    num_copies);
+    logging::MPIPrintStreamDebug()
+        << "Copying a batch of " << num_copies << " buffers\n";
+    copy_batch_kernel<<<grid, block_size, 0, stream>>>(batch);
+    num_copies = 0;
+    max_size = 0;
+  };
+  for (int i = 0; i < num_puts; ++i) {
+    if (puts[i].size == 0) continue;
+    batch.copies[num_copies++] = puts[i];
+    max_size = std::max(max_size, puts[i].size);
+    if (num_copies == COPY_BATCH_MAX_COPIES) launch();
+  }
+  launch();
+}
+
+} // namespace internal
+} // namespace p2p
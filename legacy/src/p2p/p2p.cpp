@@ -5,19 +5,33 @@
 #include "p2p/connection_mpi.hpp"
 #include "p2p/logging.hpp"
 #include "p2p/util.hpp"
-#include "p2p/util_cuda.hpp"
+#include "p2p/util_gpu.hpp"
 
+#include <algorithm>
 #include <cstdlib>
+#include <string>
 
 using namespace p2p::internal;
 using namespace p2p::logging;
 
 namespace p2p {
 
+std::ostream &operator<<(std::ostream &os, ConnectionPath path) {
+  switch (path) {
+    case ConnectionPath::NONE: return os << "none";
+    case ConnectionPath::NULL_PEER: return os << "null";
+    case ConnectionPath::SELF: return os << "self";
+    case ConnectionPath::IPC: return os << "IPC";
+    case ConnectionPath::IPC_STAGED: return os << "host-staged IPC";
+    case ConnectionPath::MPI: return os << "MPI";
+  }
+  return os << "unknown";
+}
+
 P2P::P2P(const internal::MPI &mpi): m_mpi(mpi),
                                     m_stream_mem_enabled(false) {
   m_rank = m_mpi.get_rank();
-  P2P_CHECK_CUDA_ALWAYS(cudaGetDevice(&m_dev));
+  P2P_CHECK_GPU_ALWAYS(gpu::get_device(&m_dev));
   m_stream_mem_enabled = util::is_stream_mem_enabled();
   if (!m_stream_mem_enabled) {
     MPIPrintStreamInfo() << "Stream memory operations not permitted\n";
@@ -28,6 +42,13 @@ P2P::P2P(const internal::MPI &mpi): m_mpi(mpi),
 
   int name_len;
   MPI_Get_processor_name(m_proc_name, &name_len);
+
+  if (const char *env = std::getenv("P2P_IPC_MAX_PERF_RANK")) {
+    cfg.ipc_max_perf_rank = std::atoi(env);
+  }
+  if (const char *env = std::getenv("P2P_STAGED_IPC")) {
+    cfg.use_staged_ipc = std::atoi(env) != 0;
+  }
 }
 
 P2P::~P2P() {
@@ -122,26 +143,81 @@ int P2P::get_connections(const int *peers,
 std::shared_ptr<Connection> P2P::connect(int peer,
                                          char *peer_name,
                                          int peer_dev) {
+  const ConnectionPath path = select_path(peer, peer_name, peer_dev);
+  m_path_map[peer] = path;
+  MPIPrintStreamDebug()
+      << "Connecting to rank " << peer << " using device " << peer_dev
+      << " with " << path << "\n";
+  switch (path) {
+    case ConnectionPath::NULL_PEER:
+      return std::make_shared<ConnectionNULL>(peer, m_mpi, m_event_pool);
+    case ConnectionPath::SELF:
+      return std::make_shared<ConnectionSelf>(m_mpi, m_event_pool);
+    case ConnectionPath::IPC:
+    case ConnectionPath::IPC_STAGED:
+      return std::make_shared<ConnectionIPC>(peer, peer_dev, m_mpi,
+                                             m_event_pool);
+    case ConnectionPath::MPI:
+      return std::make_shared<ConnectionMPI>(peer, m_mpi, m_event_pool);
+    case ConnectionPath::NONE:
+      break;
+  }
+  return std::shared_ptr<Connection>(nullptr);
+}
+
+// Both sides of a connection must select the same path, so the
+// selection only depends on properties of the pair.
+ConnectionPath P2P::select_path(int peer, const char *peer_name,
+                                int peer_dev) {
   if (peer == MPI_PROC_NULL) {
-    MPIPrintStreamDebug() << "Creating a null connection\n";
-    return std::make_shared<ConnectionNULL>(peer, m_mpi, m_event_pool);
+    return ConnectionPath::NULL_PEER;
   } else if (peer == m_mpi.get_rank()) {
-    MPIPrintStreamDebug() << "Creating a connection to self\n";
-    return std::make_shared<ConnectionSelf>(m_mpi, m_event_pool);
-  } else if (ConnectionIPC::is_ipc_capable(
+    return ConnectionPath::SELF;
+  } else if (!ConnectionIPC::is_ipc_capable(
       peer, m_mpi, m_proc_name, peer_name, m_dev, peer_dev)) {
+    // MPI connections to other nodes are not used
+    return ConnectionPath::NONE;
+  }
+  int peer_access = 0;
+  int peer_access_rev = 0;
+  if (peer_dev != m_dev) {
+    P2P_CHECK_GPU_ALWAYS(
+        gpu::can_access_peer(&peer_access, m_dev, peer_dev));
+    P2P_CHECK_GPU_ALWAYS(
+        gpu::can_access_peer(&peer_access_rev, peer_dev, m_dev));
+  }
+  if (peer_dev != m_dev && !(peer_access && peer_access_rev)) {
+    return cfg.use_staged_ipc ?
+        ConnectionPath::IPC_STAGED : ConnectionPath::MPI;
+  }
+  if (cfg.ipc_max_perf_rank >= 0) {
+    const int rank = get_perf_rank(peer_dev);
     MPIPrintStreamDebug()
-        << "Connecting to rank " << peer << " using device "
-        << peer_dev << " with IPC\n";
-    return std::make_shared<ConnectionIPC>(peer, peer_dev, m_mpi, m_event_pool);
-#if 0 // Disables MPI connection
-  } else {
-    MPIPrintStreamInfo() <<
-        "Connecting to rank " << peer << " with MPI\n";
-    return std::make_shared<ConnectionMPI>(peer, m_mpi, m_event_pool);
-#endif
+        << "Performance rank of the link to device " << peer_dev
+        << ": " << rank << "\n";
+    if (rank > cfg.ipc_max_perf_rank) {
+      return ConnectionPath::MPI;
+    }
   }
-  return std::shared_ptr<Connection>(nullptr);
+  return ConnectionPath::IPC;
+}
+
+// The larger of the performance ranks in both directions
+int P2P::get_perf_rank(int peer_dev) {
+  if (peer_dev == m_dev) return 0;
+  int rank = 0;
+  int rank_rev = 0;
+  P2P_CHECK_GPU_ALWAYS(gpu::get_p2p_perf_rank(&rank, m_dev, peer_dev));
+  P2P_CHECK_GPU_ALWAYS(gpu::get_p2p_perf_rank(&rank_rev, peer_dev, m_dev));
+  return std::max(rank, rank_rev);
+}
+
+ConnectionPath P2P::get_connection_path(int peer) const {
+  auto it = m_path_map.find(peer);
+  if (it == m_path_map.end() || m_conn_map.count(peer) == 0) {
+    return ConnectionPath::NONE;
+  }
+  return it->second;
 }
 
 
@@ -167,6 +243,7 @@ int P2P::disconnect_all() {
     }
   }
   m_conn_map.clear();
+  m_path_map.clear();
   return 0;
 }
 
@@ -178,6 +255,7 @@ int P2P::disconnect(connection_type *conns, int num_conns) {
       int peer = conn->get_peer();
       MPIPrintStreamDebug() << "Disconnecting from " << peer << "\n";
       m_conn_map.erase(peer);
+      m_path_map.erase(peer);
       conn->close_remote_resources();
     }
   }
@@ -192,6 +270,8 @@ int P2P::disconnect(connection_type *conns, int num_conns) {
 }
 
 int P2P::init_driver_api() {
+  // The HIP runtime needs no separate driver initialization.
+#if H2_HAS_CUDA
   CUcontext current_ctxt;
   P2P_CHECK_CUDA_DRV_ALWAYS(cuCtxGetCurrent(&current_ctxt));
   CUdevice rt_dev;
@@ -206,16 +286,17 @@ int P2P::init_driver_api() {
     P2P_ASSERT_ALWAYS(rt_dev == current_dev);
     P2P_ASSERT_ALWAYS(rt_ctxt == current_ctxt);
   }
+#endif
   return 0;
 }
 
 int P2P::barrier(std::vector<std::shared_ptr<Connection>> &connections,
-                 std::vector<cudaStream_t> &streams) {
+                 std::vector<DeviceStream> &streams) {
   return barrier(connections.data(), streams.data(), connections.size());
 }
 
 int P2P::barrier(std::shared_ptr<Connection> *connections,
-                 cudaStream_t *streams,
+                 DeviceStream *streams,
                  int num_conns) {
   Request *requests = new Request[num_conns*2];
   for (int i = 0; i < num_conns; ++i) {
@@ -316,11 +397,11 @@ int P2P::exchange(connection_type *connections,
                   void **peer_dst_bufs,
                   size_t *local_sizes,
                   size_t *peer_sizes,
-                  cudaStream_t *streams,
+                  DeviceStream *streams,
                   int num_conns) {
   int num_ipc_conns = 0;
   P2P::connection_type *ipc_conns = new P2P::connection_type[num_conns];
-  cudaStream_t *ipc_streams = new cudaStream_t[num_conns];
+  DeviceStream *ipc_streams = new DeviceStream[num_conns];
   for (int i = 0; i < num_conns; ++i) {
     auto conn = connections[i];
     const auto conn_ptr = conn.get();
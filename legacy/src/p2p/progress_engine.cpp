@@ -0,0 +1,177 @@
+#include "p2p/progress_engine.hpp"
+#include "p2p/logging.hpp"
+#include "p2p/util.hpp"
+#include "p2p/util_gpu.hpp"
+
+#include <cstdlib>
+#include <pthread.h>
+#include <sched.h>
+
+namespace p2p {
+namespace internal {
+
+ProgressEngine &ProgressEngine::get_instance() {
+  static ProgressEngine engine;
+  return engine;
+}
+
+ProgressEngine::~ProgressEngine() {
+  P2P_ASSERT_ALWAYS(m_num_attached == 0);
+}
+
+void ProgressEngine::attach(int dev) {
+  std::lock_guard<std::mutex> lock(m_mtx);
+  if (m_num_attached++ > 0) return;
+  m_dev = dev;
+  m_stop = false;
+  P2P_CHECK_GPU_ALWAYS(gpu::stream_create(&m_stream));
+  m_thread = std::thread(&ProgressEngine::run, this);
+}
+
+void ProgressEngine::detach() {
+  std::unique_lock<std::mutex> lock(m_mtx);
+  P2P_ASSERT_ALWAYS(m_num_attached > 0);
+  if (--m_num_attached > 0) return;
+  m_stop = true;
+  lock.unlock();
+  m_cv.notify_one();
+  logging::MPIPrintStreamDebug() << "Joining progress engine\n";
+  m_thread.join();
+  P2P_CHECK_GPU_ALWAYS(gpu::stream_destroy(m_stream));
+  m_stream = nullptr;
+}
+
+void ProgressEngine::submit(Task *task) {
+  Task *head = m_submissions.load(std::memory_order_relaxed);
+  do {
+    task->m_next = head;
+  } while (!m_submissions.compare_exchange_weak(head, task));
+  // The engine sets m_sleeping before checking for submissions, so
+  // either it sees this task or this sees it sleeping.
+  if (m_sleeping) {
+    { std::lock_guard<std::mutex> lock(m_mtx); }
+    m_cv.notify_one();
+  }
+}
+
+void ProgressEngine::run() {
+  P2P_CHECK_GPU_ALWAYS(gpu::set_device(m_dev));
+  pin_thread();
+  while (true) {
+    bool progressed = take_submissions();
+    progressed |= start_tasks();
+    progressed |= test_tasks();
+    progressed |= finish_tasks();
+    if (idle()) {
+      if (m_stop) break;
+      sleep();
+    } else if (!progressed) {
+      std::this_thread::yield();
+    }
+  }
+  logging::MPIPrintStreamDebug() << "Progress engine exiting\n";
+}
+
+void ProgressEngine::pin_thread() {
+  const char *env = std::getenv("P2P_PROGRESS_CORE");
+  if (env == nullptr) return;
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(std::atoi(env), &cpus);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+    logging::MPIPrintStreamInfo()
+        << "Failed to pin the progress engine to core " << env << "\n";
+  }
+}
+
+bool ProgressEngine::take_submissions() {
+  Task *head = m_submissions.exchange(nullptr);
+  if (head == nullptr) return false;
+  // The queue is last-in first-out; reverse it into submission order.
+  Task *prev = nullptr;
+  while (head != nullptr) {
+    Task *next = head->m_next;
+    head->m_next = prev;
+    prev = head;
+    head = next;
+  }
+  for (Task *t = prev; t != nullptr; t = t->m_next) {
+    m_waiting[t->m_key].push_back(t);
+  }
+  return true;
+}
+
+bool ProgressEngine::start_tasks() {
+  bool progressed = false;
+  for (auto it = m_waiting.begin(); it != m_waiting.end();) {
+    auto &tasks = it->second;
+    while (!tasks.empty() && tasks.front()->ready()) {
+      Task *t = tasks.front();
+      tasks.pop_front();
+      t->start(t->m_reqs);
+      m_active.push_back(t);
+      progressed = true;
+    }
+    it = tasks.empty() ? m_waiting.erase(it) : std::next(it);
+  }
+  return progressed;
+}
+
+bool ProgressEngine::test_tasks() {
+  if (m_active.empty()) return false;
+  m_reqs.clear();
+  for (Task *t: m_active) {
+    m_reqs.push_back(t->m_reqs[0]);
+    m_reqs.push_back(t->m_reqs[1]);
+  }
+  m_indices.resize(m_reqs.size());
+  int num_completed = 0;
+  P2P_CHECK_MPI(MPI_Testsome(m_reqs.size(), m_reqs.data(), &num_completed,
+                             m_indices.data(), MPI_STATUSES_IGNORE));
+  // Completed requests are set to MPI_REQUEST_NULL.
+  size_t num_active = 0;
+  for (size_t i = 0; i < m_active.size(); ++i) {
+    Task *t = m_active[i];
+    t->m_reqs[0] = m_reqs[i * 2];
+    t->m_reqs[1] = m_reqs[i * 2 + 1];
+    if (t->m_reqs[0] == MPI_REQUEST_NULL &&
+        t->m_reqs[1] == MPI_REQUEST_NULL) {
+      m_finishing.push_back(t);
+    } else {
+      m_active[num_active++] = t;
+    }
+  }
+  const bool progressed = num_active < m_active.size();
+  m_active.resize(num_active);
+  return progressed;
+}
+
+bool ProgressEngine::finish_tasks() {
+  size_t num_finishing = 0;
+  for (Task *t: m_finishing) {
+    if (t->finish()) {
+      delete t;
+    } else {
+      m_finishing[num_finishing++] = t;
+    }
+  }
+  const bool progressed = num_finishing < m_finishing.size();
+  m_finishing.resize(num_finishing);
+  return progressed;
+}
+
+bool ProgressEngine::idle() const {
+  return m_waiting.empty() && m_active.empty() && m_finishing.empty();
+}
+
+void ProgressEngine::sleep() {
+  std::unique_lock<std::mutex> lock(m_mtx);
+  m_sleeping = true;
+  m_cv.wait(lock, [this]() {
+    return m_submissions.load() != nullptr || m_stop;
+  });
+  m_sleeping = false;
+}
+
+} // namespace internal
+} // namespace p2p
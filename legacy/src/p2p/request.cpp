@@ -1,7 +1,7 @@
 #include "p2p/request.hpp"
 #include "p2p/connection.hpp"
 #include "p2p/util.hpp"
-#include "p2p/util_cuda.hpp"
+#include "p2p/util_gpu.hpp"
 #include "p2p/logging.hpp"
 
 using namespace p2p::logging;
@@ -11,19 +11,19 @@ Request::Request(): Request(Kind::NULL_REQUEST, nullptr,
                             nullptr, 0, 0, nullptr) {}
 
 Request::Request(Connection *conn, MPI_Request req,
-                 cudaStream_t stream):
+                 DeviceStream stream):
     Request(Kind::DEFAULT, conn, req, stream) {}
 
 Request::Request(Kind kind, Connection *conn, MPI_Request req,
-                 cudaStream_t stream):
+                 DeviceStream stream):
     Request(kind, conn, &req, 1, stream, nullptr) {}
 
 Request::Request(Connection *conn, MPI_Request req1,
-                 MPI_Request req2, cudaStream_t stream):
+                 MPI_Request req2, DeviceStream stream):
     Request(Kind::DEFAULT, conn, req1, req2, stream) {}
 
 Request::Request(Kind kind, Connection *conn, MPI_Request req1,
-                 MPI_Request req2, cudaStream_t stream):
+                 MPI_Request req2, DeviceStream stream):
     Request(kind, conn, nullptr, 0, stream, nullptr) {
   m_requests[0] = req1;
   m_requests[1] = req2;
@@ -31,13 +31,13 @@ Request::Request(Kind kind, Connection *conn, MPI_Request req1,
 }
 
 Request::Request(Connection *conn, MPI_Request *mpi_requests,
-                 int num_requests, cudaStream_t stream,
+                 int num_requests, DeviceStream stream,
                  handler_type handler):
     Request(Kind::DEFAULT, conn, mpi_requests, num_requests,
             stream, handler) {}
 
 Request::Request(Kind kind, Connection *conn, MPI_Request *mpi_requests,
-                 int num_requests, cudaStream_t stream,
+                 int num_requests, DeviceStream stream,
                  handler_type handler):
     m_kind(kind), m_conn(conn), m_num_requests(num_requests),
     m_stream(stream), m_handler(handler) {
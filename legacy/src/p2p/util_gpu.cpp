@@ -1,4 +1,4 @@
-#include "p2p/util_cuda.hpp"
+#include "p2p/util_gpu.hpp"
 #include "p2p/util.hpp"
 #include "p2p/logging.hpp"
 
@@ -62,7 +62,7 @@ void *PinnedMemoryPool::get_from_bin(int bin_idx) {
   void *new_mem = nullptr;
   size_t bin_size = pow(m_bin_growth, m_min_bin + bin_idx);
   logging::MPIPrintStreamDebug() << "Allocating new memory of size " << bin_size << "\n";
-  P2P_CHECK_CUDA_ALWAYS(cudaMallocHost(&new_mem, bin_size));
+  P2P_CHECK_GPU_ALWAYS(gpu::malloc_host(&new_mem, bin_size));
   //new_mem = std::malloc(bin_size);
   m_mem_map.insert(std::make_pair(new_mem, bin_size));
   lock.unlock();  
@@ -86,7 +86,7 @@ void PinnedMemoryPool::release(void *p) {
 void PinnedMemoryPool::deallocate_all_chunks() {
   std::unique_lock<std::mutex> lock(m_mutex);   
   for (auto &x: m_mem_map) {
-    cudaFreeHost(x.first);
+    gpu::free_host(x.first);
     //std::free(x.first);
   }
   m_mem_map.clear();
@@ -100,15 +100,15 @@ EventPool::EventPool(int num_events, int expansion):
 
 EventPool::~EventPool() {
   for (auto x: m_events) {
-    P2P_CHECK_CUDA_ALWAYS(cudaEventDestroy(x));
+    P2P_CHECK_GPU_ALWAYS(gpu::event_destroy(x));
   }
   m_events.clear();
 }
 
-void EventPool::expand_list(std::list<cudaEvent_t> &list, int num_events) {
+void EventPool::expand_list(std::list<DeviceEvent> &list, int num_events) {
   for (int i = 0; i < num_events; ++i) {
-    cudaEvent_t e;
-    P2P_CHECK_CUDA_ALWAYS(cudaEventCreateWithFlags(&e, cudaEventDisableTiming));
+    DeviceEvent e;
+    P2P_CHECK_GPU_ALWAYS(gpu::event_create(&e));
     list.push_back(e);
   }
 }
@@ -117,7 +117,7 @@ void EventPool::expand() {
   EventPool::expand_list(m_events, m_expansion);
 }
 
-cudaEvent_t EventPool::get() {
+DeviceEvent EventPool::get() {
   std::unique_lock<std::mutex> lock(m_mutex);  
   if (m_events.empty()) expand();
   auto e = m_events.front();
@@ -126,7 +126,7 @@ cudaEvent_t EventPool::get() {
   return e;
 }
 
-void EventPool::release(cudaEvent_t e) {
+void EventPool::release(DeviceEvent e) {
   std::unique_lock<std::mutex> lock(m_mutex);  
   m_events.push_back(e);
   lock.unlock();
@@ -135,14 +135,14 @@ void EventPool::release(cudaEvent_t e) {
 size_t get_available_memory() {
   size_t available;
   size_t total;
-  P2P_CHECK_CUDA(cudaMemGetInfo(&available, &total));
+  P2P_CHECK_GPU(gpu::mem_get_info(&available, &total));
   return available;
 }
 
 size_t get_total_memory() {
   size_t available;
   size_t total;
-  P2P_CHECK_CUDA(cudaMemGetInfo(&available, &total));
+  P2P_CHECK_GPU(gpu::mem_get_info(&available, &total));
   return total;
 }
 
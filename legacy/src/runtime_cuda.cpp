@@ -2,6 +2,7 @@
 #include "distconv/util/util.hpp"
 #include "distconv/util/util_cuda.hpp"
 
+#include "h2/core/graph.hpp"
 #include "h2/gpu/memory_utils.hpp"
 #include "h2/gpu/runtime.hpp"
 
@@ -17,6 +18,12 @@ CUDADeviceMemoryPool::CUDADeviceMemoryPool()
 CUDADeviceMemoryPool::~CUDADeviceMemoryPool() {}
 
 void *CUDADeviceMemoryPool::get(size_t size, cudaStream_t st) {
+  // The caching allocator cannot be used while capturing a graph;
+  // memory allocated during capture lives as long as the graph.
+  if (h2::internal::graph_capture_in_progress() &&
+      h2::internal::is_graph_capture_stream(st)) {
+    return h2::internal::graph_capture_allocate(size, st);
+  }
   void *p = nullptr;
   cudaError_t err =
       h2::gpu::default_cub_allocator().DeviceAllocate(&p, size, st);
@@ -37,6 +44,9 @@ void *CUDADeviceMemoryPool::get(size_t size, cudaStream_t st) {
 }
 
 void CUDADeviceMemoryPool::release(void *p) {
+  if (h2::internal::release_graph_allocation(p)) {
+    return;
+  }
   DISTCONV_CHECK_CUDA(h2::gpu::default_cub_allocator().DeviceFree(p));
 }
 
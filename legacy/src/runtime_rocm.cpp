@@ -6,6 +6,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "distconv/runtime_rocm.hpp"
 
+#include "h2/core/graph.hpp"
 #include "h2/gpu/memory_utils.hpp"
 #include "h2/gpu/runtime.hpp"
 
@@ -30,6 +31,11 @@ HIPDeviceMemoryPool::~HIPDeviceMemoryPool()
 
 void* HIPDeviceMemoryPool::get(size_t size, hipStream_t st)
 {
+    // The caching allocator cannot be used while capturing a graph;
+    // memory allocated during capture lives as long as the graph.
+    if (h2::internal::graph_capture_in_progress()
+        && h2::internal::is_graph_capture_stream(st))
+        return h2::internal::graph_capture_allocate(size, st);
     void* p = nullptr;
     auto const err =
         h2::gpu::default_cub_allocator().DeviceAllocate(&p, size, st);
@@ -50,6 +56,8 @@ void* HIPDeviceMemoryPool::get(size_t size, hipStream_t st)
 
 void HIPDeviceMemoryPool::release(void* p)
 {
+    if (h2::internal::release_graph_allocation(p))
+        return;
     DISTCONV_CHECK_HIP(h2::gpu::default_cub_allocator().DeviceFree(p));
 }
 
@@ -90,51 +90,57 @@ __global__ void unpack_from_ag_kernel(const DataType * __restrict__ packed_buf,
 template <>
 void ChannelExchange<float>::pack_for_rs(TensorType& src,
                                          TensorType& dst,
+                                         const float* src_ptr,
                                          float* dst_buf,
+                                         index_t num_samples,
                                          size_t comm_size,
                                          h2::gpu::DeviceStream stream)
 {
     constexpr int block_size = 256;
+    const size_t src_size = num_samples * get_sample_size(src);
     dim3 block_dim(block_size);
-    dim3 grid_dim((src.get_local_size() + block_size - 1) / block_size);
+    dim3 grid_dim((src_size + block_size - 1) / block_size);
     auto src_shape = src.get_local_shape();
     internal::pack_for_rs_kernel<<<grid_dim, block_dim, 0, stream>>>(
-        src.get_base_ptr(),
+        src_ptr,
         dst_buf,
-        src_shape[-1],
+        num_samples,
         src_shape[-2],
         comm_size,
-        src.get_local_size(),
+        src_size,
         get_sample_size(src),
         get_channel_size(src),
         dst.get_local_shape()[-2],
         get_sample_size(dst),
-        dst.get_local_size());
+        num_samples * get_sample_size(dst));
 }
 
 template <>
 void ChannelExchange<double>::pack_for_rs(TensorType& src,
                                           TensorType& dst,
+                                          const double* src_ptr,
                                           double* dst_buf,
+                                          index_t num_samples,
                                           size_t comm_size,
                                           h2::gpu::DeviceStream stream)
 {
     constexpr int block_size = 256;
+    const size_t src_size = num_samples * get_sample_size(src);
     dim3 block_dim(block_size);
-    dim3 grid_dim((src.get_local_size() + block_size - 1) / block_size);
+    dim3 grid_dim((src_size + block_size - 1) / block_size);
     auto src_shape = src.get_local_shape();
     internal::pack_for_rs_kernel<<<grid_dim, block_dim, 0, stream>>>(
-        src.get_base_ptr(),
+        src_ptr,
         dst_buf,
-        src_shape[-1],
+        num_samples,
         src_shape[-2],
         comm_size,
-        src.get_local_size(),
+        src_size,
         get_sample_size(src),
         get_channel_size(src),
         dst.get_local_shape()[-2],
         get_sample_size(dst),
-        dst.get_local_size());
+        num_samples * get_sample_size(dst));
 }
 
 template <>
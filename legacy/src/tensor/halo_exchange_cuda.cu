@@ -2,6 +2,7 @@
 #include "distconv/tensor/halo_cuda.hpp"
 #include "distconv/util/util_mpi.hpp"
 #include "distconv/tensor/halo_packing_cuda.hpp"
+#include "h2/core/low_precision.hpp"
 
 #include <limits>
 
@@ -19,8 +20,16 @@ void HaloExchange<float, CUDAAllocator, Al::NCCLBackend>::
                    bool is_reverse,
                    HaloExchangeAccumOp op)
 {
-    halo_exchange_cuda::pack_or_unpack<float>(
-        m_tensor, dim, side, width, stream, buf, is_pack, is_reverse, op);
+    halo_exchange_cuda::pack_or_unpack<float>(m_tensor,
+                                              dim,
+                                              side,
+                                              width,
+                                              stream,
+                                              buf,
+                                              is_pack,
+                                              is_reverse,
+                                              op,
+                                              m_transfer_precision);
 }
 
 template <>
@@ -38,5 +47,125 @@ void HaloExchange<double, CUDAAllocator, Al::NCCLBackend>::
         m_tensor, dim, side, width, stream, buf, is_pack, is_reverse, op);
 }
 
+template <>
+void HaloExchange<float, CUDAAllocator, Al::NCCLBackend>::
+    pack_or_unpack_region(const IndexVector& region_offset,
+                          const Shape& region_shape,
+                          h2::gpu::DeviceStream stream,
+                          void* buf,
+                          bool is_pack,
+                          HaloExchangeAccumOp op)
+{
+    halo_exchange_cuda::pack_or_unpack_region<float>(
+        m_tensor, region_offset, region_shape, stream, buf, is_pack, op);
+}
+
+template <>
+void HaloExchange<double, CUDAAllocator, Al::NCCLBackend>::
+    pack_or_unpack_region(const IndexVector& region_offset,
+                          const Shape& region_shape,
+                          h2::gpu::DeviceStream stream,
+                          void* buf,
+                          bool is_pack,
+                          HaloExchangeAccumOp op)
+{
+    halo_exchange_cuda::pack_or_unpack_region<double>(
+        m_tensor, region_offset, region_shape, stream, buf, is_pack, op);
+}
+
+template <>
+void HaloExchange<float, CUDAAllocator, Al::NCCLBackend>::
+    pack_or_unpack_regions(const HaloRegion* regions,
+                           int num_regions,
+                           size_t max_region_points,
+                           h2::gpu::DeviceStream stream,
+                           void* buf,
+                           bool is_pack,
+                           HaloExchangeAccumOp op)
+{
+    halo_exchange_cuda::pack_or_unpack_regions<float>(m_tensor,
+                                                   regions,
+                                                   num_regions,
+                                                   max_region_points,
+                                                   stream,
+                                                   buf,
+                                                   is_pack,
+                                                   op);
+}
+
+template <>
+void HaloExchange<double, CUDAAllocator, Al::NCCLBackend>::
+    pack_or_unpack_regions(const HaloRegion* regions,
+                           int num_regions,
+                           size_t max_region_points,
+                           h2::gpu::DeviceStream stream,
+                           void* buf,
+                           bool is_pack,
+                           HaloExchangeAccumOp op)
+{
+    halo_exchange_cuda::pack_or_unpack_regions<double>(m_tensor,
+                                                   regions,
+                                                   num_regions,
+                                                   max_region_points,
+                                                   stream,
+                                                   buf,
+                                                   is_pack,
+                                                   op);
+}
+
+#if H2_HAS_GPU_LOW_PRECISION
+// 16-bit tensors are always transferred in their own precision.
+#define DEFINE_LOW_PRECISION_PACK_OR_UNPACK(TYPE)                       \
+  template <>                                                           \
+  void HaloExchange<TYPE, CUDAAllocator, Al::NCCLBackend>::             \
+      pack_or_unpack(int dim,                                           \
+                     Side side,                                         \
+                     int width,                                         \
+                     h2::gpu::DeviceStream stream,                      \
+                     void* buf,                                         \
+                     bool is_pack,                                      \
+                     bool is_reverse,                                   \
+                     HaloExchangeAccumOp op)                            \
+  {                                                                     \
+    halo_exchange_cuda::pack_or_unpack<TYPE>(                           \
+        m_tensor, dim, side, width, stream, buf, is_pack, is_reverse, op); \
+  }                                                                     \
+  template <>                                                           \
+  void HaloExchange<TYPE, CUDAAllocator, Al::NCCLBackend>::             \
+      pack_or_unpack_region(const IndexVector& region_offset,           \
+                            const Shape& region_shape,                  \
+                            h2::gpu::DeviceStream stream,               \
+                            void* buf,                                  \
+                            bool is_pack,                               \
+                            HaloExchangeAccumOp op)                     \
+  {                                                                     \
+    halo_exchange_cuda::pack_or_unpack_region<TYPE>(                    \
+        m_tensor, region_offset, region_shape, stream, buf, is_pack, op); \
+  }                                                                     \
+  template <>                                                           \
+  void HaloExchange<TYPE, CUDAAllocator, Al::NCCLBackend>::             \
+      pack_or_unpack_regions(const HaloRegion* regions,                 \
+                             int num_regions,                           \
+                             size_t max_region_points,                  \
+                             h2::gpu::DeviceStream stream,              \
+                             void* buf,                                 \
+                             bool is_pack,                              \
+                             HaloExchangeAccumOp op)                    \
+  {                                                                     \
+    halo_exchange_cuda::pack_or_unpack_regions<TYPE>(m_tensor,          \
+                                                     regions,           \
+                                                     num_regions,       \
+                                                     max_region_points, \
+                                                     stream,            \
+                                                     buf,               \
+                                                     is_pack,           \
+                                                     op);               \
+  }
+
+DEFINE_LOW_PRECISION_PACK_OR_UNPACK(h2::gpu::Half)
+DEFINE_LOW_PRECISION_PACK_OR_UNPACK(h2::gpu::BFloat16)
+#undef DEFINE_LOW_PRECISION_PACK_OR_UNPACK
+#endif // H2_HAS_GPU_LOW_PRECISION
+
 } // namespace tensor
 } // namespace distconv
@@ -0,0 +1,40 @@
+#include "distconv/tensor/halo_exchange_cuda_p2p.hpp"
+#include "distconv/tensor/halo_packing_cuda.hpp"
+
+// Definitions only for float and double as integer types are unlikely
+// to used.
+#define LIST_OF_TYPES \
+  DEFINE_FUNC(float) \
+  DEFINE_FUNC(double)
+
+static_assert(sizeof(p2p::WaitValue) == sizeof(std::uint32_t),
+              "Notification flags must be 32-bit");
+
+namespace distconv {
+namespace tensor {
+
+#define DEFINE_FUNC(TYPE)                                               \
+  template <>                                                           \
+  void HaloExchangeP2P<TYPE, CUDAAllocator, Al::NCCLBackend>::accumulate_to_peer( \
+      int dim, Side side, int width, h2::gpu::DeviceStream stream,    \
+      bool is_reverse, HaloExchangeAccumOp op, void *peer_tensor,       \
+      size_t peer_extent, size_t peer_start) {                          \
+    halo_exchange_cuda::accumulate_to_peer<TYPE>(                       \
+        m_tensor, dim, side, width, stream, is_reverse, op,             \
+        peer_tensor, peer_extent, peer_start);                          \
+  }                                                                     \
+  template <>                                                           \
+  void HaloExchangeP2P<TYPE, CUDAAllocator, Al::NCCLBackend>::pack_put_notify_peer( \
+      int dim, Side side, int width, h2::gpu::DeviceStream stream,    \
+      void *peer_buf, bool is_reverse, p2p::WaitValue *peer_flag,       \
+      p2p::WaitValue value) {                                           \
+    halo_exchange_cuda::pack_put_notify_peer<TYPE>(                     \
+        m_tensor, dim, side, width, stream, peer_buf, is_reverse,       \
+        reinterpret_cast<std::uint32_t*>(peer_flag), value);            \
+  }
+
+LIST_OF_TYPES
+#undef DEFINE_FUNC
+
+} // namespace tensor
+} // namespace distconv
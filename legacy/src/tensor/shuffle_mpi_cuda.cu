@@ -1,4 +1,5 @@
 #include "distconv/tensor/shuffle_mpi_cuda.hpp"
+#include "distconv/tensor/shuffle_mpi_cuda_cast.hpp"
 #include "distconv/util/util_gpu.hpp"
 #include <distconv_config.hpp>
 
@@ -17,172 +18,201 @@ namespace {
 template <int ND>
 using Array = tensor::Array<ND>;
 using Shape = tensor::Shape;
+using DestEntry = tensor::ShuffleDestEntry;
 
-template <int ND>
-__device__ Array<ND> get_idx(size_t linear_offset,
-                             const Array<ND> &shape) {
-  Array<ND> idx;
-#pragma unroll
-  for (int i = 0; i < ND; ++i) {
-    idx[i] = linear_offset % shape[i];
-    linear_offset /= shape[i];
-  }
-  return idx;
-}
+// Number of consecutive points along the innermost dimension each
+// thread packs or unpacks.
+constexpr int run_length = 4;
 
 /**
-   Find the destination rank and the offset in its packing buffer.
+   Number of runs of points packed or unpacked.
 
-   @param src_local_idx local index in the source tensor.
-   @param dst_locale_shape the locale shape of the destination tensor.
-   @param rank_limits the partitioning limit of each rank.
-   @param dst_rank destination rank.
-   @param dst_offset offset in the packing buffer.
+   Each run is up to run_length consecutive points along dimension
+   0. If rows is not null, only the given rows of the outermost
+   dimension are covered.
+ */
+size_t get_num_runs(const Shape& local_shape, const int* rows, int num_rows)
+{
+    const size_t len0 = local_shape[0];
+    const size_t runs_per_line = (len0 + run_length - 1) / run_length;
+    if (local_shape.num_dims() == 1)
+    {
+        // The rows are the points themselves.
+        return rows ? num_rows : runs_per_line;
+    }
+    const size_t num_lines = local_shape.get_size() / len0;
+    return runs_per_line
+           * (rows ? num_lines / local_shape[-1] * num_rows : num_lines);
+}
+
+/**
+   Locate a run of points.
+
+   Finds the index of the run in dimensions other than 0, the offset
+   of the run start in the tensor (excluding dimension 0), and the
+   destination rank and packing-buffer offset of the run excluding the
+   contributions of dimension 0.
+
+   @param run index of the run.
+   @param local_shape local shape of the tensor.
+   @param strides strides of the tensor.
+   @param packed whether the tensor is packed, in which case strides
+   is ignored.
+   @param dest_table destinations of the local indices of each
+   dimension as set up by TensorMPICUDAShuffler.
+   @param rows rows of the outermost dimension covered, or null.
+   @param x0 index in dimension 0 of the run start.
+   @param tensor_offset offset in the tensor excluding dimension 0.
+   @param rank destination rank excluding dimension 0.
+   @param buf_offset offset in the buffer of the destination rank
+   excluding dimension 0, to be multiplied by the block length of
+   dimension 0.
  */
 template <int ND>
-__device__ void find_destination(const Array<ND> &src_local_idx,
-                                 const Array<ND> &src_local_shape,
-                                 const Array<ND> &dst_locale_shape,
-                                 const int * __restrict__ rank_limits,
-                                 int &dst_rank, size_t &dst_offset) {
-  dst_rank = 0;
-  dst_offset = 0;
-  int rank_dim_offset = 1;
-  size_t local_linear_offset = 1;
-  int rank_limits_idx = 0;
+__device__ void locate_run(size_t run,
+                           const Array<ND>& local_shape,
+                           const Array<ND>& strides,
+                           bool packed,
+                           const DestEntry* __restrict__ dest_table,
+                           const int* __restrict__ rows,
+                           int& x0,
+                           size_t& tensor_offset,
+                           int& rank,
+                           size_t& buf_offset)
+{
+    const int len0 = local_shape[0];
+    tensor_offset = 0;
+    rank = 0;
+    buf_offset = 0;
+    if constexpr (ND == 1)
+    {
+        x0 = rows ? rows[run] : run * run_length;
+        return;
+    }
+    else
+    {
+        const size_t runs_per_line = (len0 + run_length - 1) / run_length;
+        size_t line = run / runs_per_line;
+        x0 = (run - line * runs_per_line) * run_length;
+        if (rows)
+        {
+            const size_t lines_per_row =
+                local_shape.get_size() / len0 / local_shape[ND - 1];
+            const size_t r = line / lines_per_row;
+            line = line - r * lines_per_row + rows[r] * lines_per_row;
+        }
+        Array<ND> idx;
+        size_t packed_stride = len0;
 #pragma unroll
-  for (int i = 0; i < ND; ++i) {
-    // Locate the i-th dim index of the destination rank
-    int dst_rank_idx;
-    int dst_buffer_offset;
-    int dst_buffer_dim;
-#ifdef DISTCONV_OPTIMIZE_FIND_DESTINATION
-    if (rank_limits[rank_limits_idx] == -1) {
-      auto src_global_index = src_local_idx[i] + rank_limits[rank_limits_idx+1];
-      int dst_local_dim = rank_limits[rank_limits_idx+2];
-      dst_rank_idx = src_global_index / dst_local_dim;
-      dst_buffer_offset = min(src_global_index % dst_local_dim,
-                              src_local_idx[i]);
-      dst_buffer_dim = min((int)(src_local_shape[i] -
-                                 (src_local_idx[i] - dst_buffer_offset)),
-                           dst_local_dim);
-    } else {
-#endif
-      // The if-condition below always holds for some j, so dst_rank_idx
-      // is always assigned some value. Initialize just to suppress
-      // compiler warnings.
-      dst_rank_idx = 0;
-      for (int j = 0; j < (int)dst_locale_shape[i]; ++j) {
-        if (src_local_idx[i] < rank_limits[rank_limits_idx+j]) {
-          dst_rank_idx = j;
-          break;
+        for (int i = 1; i < ND; ++i)
+        {
+            idx[i] = line % local_shape[i];
+            line /= local_shape[i];
+            tensor_offset += idx[i] * (packed ? packed_stride : strides[i]);
+            packed_stride *= local_shape[i];
+        }
+        size_t table_offset = local_shape.reduce_sum() - local_shape[ND - 1];
+#pragma unroll
+        for (int i = ND - 1; i > 0; --i)
+        {
+            const DestEntry e = dest_table[table_offset + idx[i]];
+            rank += e.rank;
+            buf_offset = e.offset + e.dim * buf_offset;
+            table_offset -= local_shape[i - 1];
         }
-      }
-      int dst_rank_base = dst_rank_idx == 0 ? 0 :
-          rank_limits[rank_limits_idx+dst_rank_idx-1];
-      dst_buffer_offset = src_local_idx[i] - dst_rank_base;
-      dst_buffer_dim = rank_limits[rank_limits_idx+dst_rank_idx]
-          - dst_rank_base;
-#ifdef DISTCONV_OPTIMIZE_FIND_DESTINATION
     }
-#endif
+}
 
-    dst_rank += dst_rank_idx * rank_dim_offset;
-    rank_dim_offset *= dst_locale_shape[i];
+// Converts a value between the types of tensors and packed buffers.
+template <typename ToType, typename FromType>
+__device__ __forceinline__ ToType shuffle_convert(FromType x) {
+  return static_cast<ToType>(x);
+}
 
-    dst_offset += dst_buffer_offset * local_linear_offset;
-    local_linear_offset *= dst_buffer_dim;
+template <>
+__device__ __forceinline__ __half shuffle_convert<__half, float>(float x) {
+  return __float2half(x);
+}
 
-    rank_limits_idx += dst_locale_shape[i];
-  }
+template <>
+__device__ __forceinline__ float shuffle_convert<float, __half>(__half x) {
+  return __half2float(x);
 }
 
-template <int ND>
-__device__ size_t get_strided_offset(size_t offset,
-                                     const Array<ND> &shape,
-                                     const Array<ND> &strides) {
-  size_t real_offset = 0;
-#pragma unroll
-  for (int i = 0; i < ND; ++i) {
-    auto x = offset % shape[i];
-    real_offset += x * strides[i];
-    offset /= shape[i];
-  }
-  return real_offset;
+template <>
+__device__ __forceinline__ tensor::ShuffleBF16
+shuffle_convert<tensor::ShuffleBF16, float>(float x) {
+  return __float2bfloat16(x);
+}
+
+template <>
+__device__ __forceinline__ float
+shuffle_convert<float, tensor::ShuffleBF16>(tensor::ShuffleBF16 x) {
+  return __bfloat162float(x);
 }
 
 #define PACK_USE_SHMEM
-template <int ND, typename DataType, bool packed>
+template <int ND, typename DataType, typename BufType, bool packed>
 __global__ void pack_kernel(const DataType *src,
                             const Array<ND> src_local_shape,
                             const Array<ND> src_strides,
                             const Array<ND> dst_locale_shape,
-                            const int * __restrict__ rank_limits,
-                            DataType * __restrict__ buf,
-                            const int * __restrict__ displs) {
-  const size_t size = src_local_shape.get_size();
+                            const DestEntry * __restrict__ dest_table,
+                            BufType * __restrict__ buf,
+                            const int * __restrict__ displs,
+                            const int * __restrict__ rows,
+                            const int num_rows,
+                            const size_t num_runs) {
   const size_t gid = threadIdx.x + blockIdx.x * blockDim.x;
   const size_t num_threads = blockDim.x * gridDim.x;
 
 #ifdef PACK_USE_SHMEM
   extern __shared__ int shm[];
-  int rank_limits_size = 0;
   int displs_size = 1;
 #pragma unroll
   for (int i = 0; i < ND; ++i) {
-    rank_limits_size += dst_locale_shape[i];
     displs_size *= dst_locale_shape[i];
   }
-  int *rank_limits_s = shm;
-  int *displs_s = &(shm[rank_limits_size]);
-  for (int i = threadIdx.x; i < rank_limits_size; i += blockDim.x) {
-    rank_limits_s[i] = rank_limits[i];
-  }
+  int *displs_s = shm;
   for (int i = threadIdx.x; i < displs_size; i += blockDim.x) {
     displs_s[i] = displs[i];
   }
   __syncthreads();
+#else
+  const int *displs_s = displs;
 #endif
 
-  for (size_t offset = gid; offset < size; offset += num_threads) {
-    size_t src_offset = packed ? offset :
-        get_strided_offset(offset, src_local_shape, src_strides);
-    DataType v = src[src_offset];
-    const Array<ND> idx = get_idx(offset, src_local_shape);
+  const int len0 = src_local_shape[0];
+  const size_t stride0 = packed ? 1 : src_strides[0];
+  for (size_t run = gid; run < num_runs; run += num_threads) {
+    int x0;
+    size_t src_offset;
     int rank;
-    size_t dst_offset;
-#ifdef PACK_USE_SHMEM
-    find_destination(idx, src_local_shape, dst_locale_shape,
-                     rank_limits_s, rank, dst_offset);
-    buf[displs_s[rank] + dst_offset] = v;
-#else
-    find_destination(idx, src_local_shape, dst_locale_shape,
-                     rank_limits, rank, dst_offset);
-#if 0
-    printf("rank: %d, displs[rank]: %d, dst_offset: %d\n",
-           rank, (int)displs[rank], (int)dst_offset);
-#endif
-    buf[displs[rank] + dst_offset] = v;
-#endif
-#if 0
-    if (offset < 8) {
-      printf("pack at %d (strided: %d) : %f, rank: %d, displs: %d, dst_offset: %d\n",
-             (int)offset,
-             (int)get_strided_offset(offset, src_local_shape, src_strides),
-             v, rank, displs[rank], (int)(dst_offset));
+    size_t buf_offset;
+    locate_run(run, src_local_shape, src_strides, packed, dest_table,
+               rows, x0, src_offset, rank, buf_offset);
+    const int len = (ND == 1 && rows) ? 1 : min(run_length, len0 - x0);
+#pragma unroll
+    for (int k = 0; k < run_length; ++k) {
+      if (k >= len) break;
+      const DestEntry e = dest_table[x0 + k];
+      buf[displs_s[rank + e.rank] + e.offset + e.dim * buf_offset] =
+          shuffle_convert<BufType>(src[src_offset + (x0 + k) * stride0]);
     }
-#endif
   }
 }
 
-template <typename DataType, bool packed>
+template <typename DataType, typename BufType, bool packed>
 void pack_kernel_dispatch(const DataType* src,
                           const Shape& src_local_shape,
                           const IndexVector& src_strides,
                           const Shape& dst_locale_shape,
-                          const int* rank_limits,
-                          DataType* buf,
+                          const DestEntry* dest_table,
+                          BufType* buf,
                           const int* displs,
+                          const int* rows,
+                          int num_rows,
+                          size_t num_runs,
                           dim3 grid_dim,
                           dim3 block_dim,
                           int shm_size,
@@ -191,10 +221,11 @@ void pack_kernel_dispatch(const DataType* src,
     const int num_dims = src_local_shape.num_dims();
 
 #define CALL_KERNEL(ND)                                                 \
-  pack_kernel<ND, DataType, packed><<<                                  \
+  pack_kernel<ND, DataType, BufType, packed><<<                         \
       grid_dim, block_dim, shm_size, stream>>>(                         \
           src, Array<ND>(src_local_shape), Array<ND>(src_strides),      \
-          Array<ND>(dst_locale_shape), rank_limits, buf, displs)
+          Array<ND>(dst_locale_shape), dest_table, buf, displs,         \
+          rows, num_rows, num_runs)
 
   switch (num_dims) {
     case 1:
@@ -222,91 +253,95 @@ void pack_kernel_dispatch(const DataType* src,
 #undef CALL_KERNEL
 }
 
-template <typename DataType, bool packed>
+template <typename DataType, bool packed, typename BufType = DataType>
 void pack(const DataType* src,
           const Shape& src_local_shape,
           const IndexVector& src_strides,
           const Shape& dst_locale_shape,
-          const int* rank_limits,
-          DataType* buf,
+          const DestEntry* dest_table,
+          BufType* buf,
           const int* displs,
-          gpuStream_t stream)
+          gpuStream_t stream,
+          const int* rows = nullptr,
+          int num_rows = 0)
 {
     constexpr int block_size = 256;
     dim3 block_dim(block_size);
-    size_t work_size = src_local_shape.get_size();
-    dim3 grid_dim((work_size + block_size - 1) / block_size);
+    const size_t num_runs = get_num_runs(src_local_shape, rows, num_rows);
+    dim3 grid_dim((num_runs + block_size - 1) / block_size);
 #ifdef PACK_USE_SHMEM
-  int shm_size = dst_locale_shape.reduce_sum() * sizeof(int)
-      + dst_locale_shape.reduce_prod() * sizeof(int);
+  int shm_size = dst_locale_shape.reduce_prod() * sizeof(int);
 #else
   int shm_size = 0;
 #endif
-  pack_kernel_dispatch<DataType, packed>(
+  pack_kernel_dispatch<DataType, BufType, packed>(
       src, src_local_shape, src_strides, dst_locale_shape,
-      rank_limits, buf, displs, grid_dim, block_dim, shm_size, stream);
+      dest_table, buf, displs, rows, num_rows, num_runs, grid_dim,
+      block_dim, shm_size, stream);
 }
 
 #define PACK_USE_SHMEM
-template <int ND, typename DataType, bool packed>
+template <int ND, typename DataType, typename BufType, bool packed>
 __global__ void unpack_kernel2(DataType *tensor,
                                const Array<ND> local_shape,
                                const Array<ND> strides,
                                const Array<ND> locale_shape,
-                               const int * __restrict__ rank_limits,
-                               const DataType * __restrict__ packed_buf,
-                               const int * __restrict__ displs) {
-  const size_t size = local_shape.get_size();
+                               const DestEntry * __restrict__ dest_table,
+                               const BufType * __restrict__ packed_buf,
+                               const int * __restrict__ displs,
+                               const int * __restrict__ rows,
+                               const int num_rows,
+                               const size_t num_runs) {
   const size_t gid = threadIdx.x + blockIdx.x * blockDim.x;
   const size_t num_threads = blockDim.x * gridDim.x;
 
 #ifdef PACK_USE_SHMEM
   extern __shared__ int shm[];
-  int rank_limits_size = 0;
   int displs_size = 1;
 #pragma unroll
   for (int i = 0; i < ND; ++i) {
-    rank_limits_size += locale_shape[i];
     displs_size *= locale_shape[i];
   }
-  int *rank_limits_s = shm;
-  int *displs_s = &(shm[rank_limits_size]);
-  for (int i = threadIdx.x; i < rank_limits_size; i += blockDim.x) {
-    rank_limits_s[i] = rank_limits[i];
-  }
+  int *displs_s = shm;
   for (int i = threadIdx.x; i < displs_size; i += blockDim.x) {
     displs_s[i] = displs[i];
   }
   __syncthreads();
+#else
+  const int *displs_s = displs;
 #endif
 
-  for (size_t offset = gid; offset < size; offset += num_threads) {
-    size_t src_offset = packed ? offset :
-        get_strided_offset(offset, local_shape, strides);
-    const Array<ND> idx = get_idx(offset, local_shape);
+  const int len0 = local_shape[0];
+  const size_t stride0 = packed ? 1 : strides[0];
+  for (size_t run = gid; run < num_runs; run += num_threads) {
+    int x0;
+    size_t tensor_offset;
     int rank;
-    size_t dst_offset;
-#ifdef PACK_USE_SHMEM
-    find_destination(idx, local_shape, locale_shape,
-                     rank_limits_s, rank, dst_offset);
-    DataType v = packed_buf[displs_s[rank] + dst_offset];
-#else
-    find_destination(idx, local_shape, locale_shape,
-                     rank_limits, rank, dst_offset);
-    DataType v = packed_buf[displs_s[rank] + dst_offset];
-#endif
-    tensor[src_offset] = v;
+    size_t buf_offset;
+    locate_run(run, local_shape, strides, packed, dest_table,
+               rows, x0, tensor_offset, rank, buf_offset);
+    const int len = (ND == 1 && rows) ? 1 : min(run_length, len0 - x0);
+#pragma unroll
+    for (int k = 0; k < run_length; ++k) {
+      if (k >= len) break;
+      const DestEntry e = dest_table[x0 + k];
+      tensor[tensor_offset + (x0 + k) * stride0] = shuffle_convert<DataType>(
+          packed_buf[displs_s[rank + e.rank] + e.offset + e.dim * buf_offset]);
+    }
   }
 }
 
-template <typename DataType, bool packed>
+template <typename DataType, typename BufType, bool packed>
 void unpack_kernel_dispatch(DataType* tensor,
                             const Shape& local_shape,
                             const IndexVector& strides,
                             const Shape& locale_shape,
-                            const int* rank_limits,
-                            const DataType* packed_buf,
+                            const DestEntry* dest_table,
+                            const BufType* packed_buf,
                             const int* displs,
+                            const int* rows,
+                            int num_rows,
+                            size_t num_runs,
                             dim3 grid_dim,
                             dim3 block_dim,
                             int shm_size,
@@ -315,10 +350,11 @@ void unpack_kernel_dispatch(DataType* tensor,
     const int num_dims = local_shape.num_dims();
 
 #define CALL_KERNEL(ND)                                                 \
-  unpack_kernel2<ND, DataType, packed><<<                               \
+  unpack_kernel2<ND, DataType, BufType, packed><<<                      \
       grid_dim, block_dim, shm_size, stream>>>(                         \
           tensor, Array<ND>(local_shape), Array<ND>(strides),           \
-          Array<ND>(locale_shape), rank_limits, packed_buf, displs)
+          Array<ND>(locale_shape), dest_table, packed_buf, displs,      \
+          rows, num_rows, num_runs)
 
   switch (num_dims) {
     case 1:
@@ -346,29 +382,30 @@ void unpack_kernel_dispatch(DataType* tensor,
 #undef CALL_KERNEL
 }
 
-template <typename DataType, bool packed>
+template <typename DataType, bool packed, typename BufType = DataType>
 void unpack(DataType* dst,
             const Shape& shape,
             const IndexVector& strides,
             const Shape& locale_shape,
-            const int* rank_limits,
-            const DataType* buf,
+            const DestEntry* dest_table,
+            const BufType* buf,
             const int* displs,
-            gpuStream_t stream)
+            gpuStream_t stream,
+            const int* rows = nullptr,
+            int num_rows = 0)
 {
     constexpr int block_size = 256;
     dim3 block_dim(block_size);
-    size_t work_size = shape.get_size();
-    dim3 grid_dim((work_size + block_size - 1) / block_size);
+    const size_t num_runs = get_num_runs(shape, rows, num_rows);
+    dim3 grid_dim((num_runs + block_size - 1) / block_size);
 #ifdef PACK_USE_SHMEM
-  int shm_size = locale_shape.reduce_sum() * sizeof(int)
-      + locale_shape.reduce_prod() * sizeof(int);
+  int shm_size = locale_shape.reduce_prod() * sizeof(int);
 #else
   int shm_size = 0;
 #endif
-  unpack_kernel_dispatch<DataType, packed>(
-      dst, shape, strides, locale_shape, rank_limits, buf, displs,
-      grid_dim, block_dim, shm_size, stream);
+  unpack_kernel_dispatch<DataType, BufType, packed>(
+      dst, shape, strides, locale_shape, dest_table, buf, displs,
+      rows, num_rows, num_runs, grid_dim, block_dim, shm_size, stream);
 }
 
 } // namespace
@@ -386,8 +423,16 @@ void TensorMPICUDAShuffler<DataType>::shuffle(const DataType* src,
     // assert_always(src != nullptr);
     // assert_always(dst != nullptr);
 
-    const int* rank_limits_fwd = get_rank_limits_fwd(is_forward);
-    const int* rank_limits_bwd = get_rank_limits_bwd(is_forward);
+    if (is_pipelined())
+    {
+        shuffle_pipelined(src, dst, stream, is_forward);
+        return;
+    }
+
+    const ShuffleDestEntry* dest_table_fwd =
+        get_dest_table_fwd(is_forward);
+    const ShuffleDestEntry* dest_table_bwd =
+        get_dest_table_bwd(is_forward);
     const int* send_counts = get_send_counts(is_forward);
     const int* recv_counts = get_recv_counts(is_forward);
     const int* send_displs_h = get_send_displs_h(is_forward);
@@ -411,7 +456,7 @@ void TensorMPICUDAShuffler<DataType>::shuffle(const DataType* src,
                                  get_src_local_shape(is_forward),
                                  get_src_strides(is_forward),
                                  get_dst_locale_shape(is_forward),
-                                 rank_limits_fwd,
+                                 dest_table_fwd,
                                  send_buf,
                                  send_displs_d,
                                  stream);
@@ -422,7 +467,7 @@ void TensorMPICUDAShuffler<DataType>::shuffle(const DataType* src,
                                   get_src_local_shape(is_forward),
                                   get_src_strides(is_forward),
                                   get_dst_locale_shape(is_forward),
-                                  rank_limits_fwd,
+                                  dest_table_fwd,
                                   send_buf,
                                   send_displs_d,
                                   stream);
@@ -461,13 +506,13 @@ void TensorMPICUDAShuffler<DataType>::shuffle(const DataType* src,
           dst, get_dst_local_shape(is_forward),
           get_dst_strides(is_forward),
           get_src_locale_shape(is_forward),
-          rank_limits_bwd, recv_buf, recv_displs_d, stream);
+          dest_table_bwd, recv_buf, recv_displs_d, stream);
     } else {
       unpack<DataType, false>(
           dst, get_dst_local_shape(is_forward),
           get_dst_strides(is_forward),
           get_src_locale_shape(is_forward),
-          rank_limits_bwd, recv_buf, recv_displs_d, stream);
+          dest_table_bwd, recv_buf, recv_displs_d, stream);
     }
   }
 
@@ -475,6 +520,111 @@ void TensorMPICUDAShuffler<DataType>::shuffle(const DataType* src,
   release_buf(recv_buf);
 }
 
+template <typename DataType>
+void TensorMPICUDAShuffler<DataType>::shuffle_pipelined(const DataType* src,
+                                                        DataType* dst,
+                                                        gpuStream_t stream,
+                                                        bool is_forward)
+{
+    if constexpr (IsShuffleALTypeSupported<DataType>::value)
+    {
+        DataType* send_buf = get_src_buf(is_forward, stream);
+        DataType* recv_buf = get_dst_buf(is_forward, stream);
+        const bool pack_chunks = get_src_local_shape(is_forward).get_size()
+                                 && is_src_split_root(is_forward);
+        const bool unpack_chunks = get_dst_local_shape(is_forward).get_size()
+                                   && is_dst_split_root(is_forward);
+        const bool src_packed = get_src_overlap(is_forward).reduce_sum() == 0;
+        const bool dst_packed = get_dst_overlap(is_forward).reduce_sum() == 0;
+        // Chunk c is packed on stream, transferred on transfer_stream,
+        // and unpacked on unpack_stream, so packing chunk c+1 overlaps
+        // them.
+        gpuStream_t transfer_stream = get_pipeline_stream(0);
+        gpuStream_t unpack_stream = get_pipeline_stream(1);
+        auto& comm = get_al_comm(transfer_stream);
+
+        for (int c = 0; c < m_num_chunks; ++c)
+        {
+            const int num_src_rows = get_src_chunk_num_rows(is_forward, c);
+            if (pack_chunks && num_src_rows > 0)
+            {
+                const int* rows = get_src_chunk_rows(is_forward, c);
+                if (src_packed)
+                {
+                    pack<DataType, true>(src,
+                                         get_src_local_shape(is_forward),
+                                         get_src_strides(is_forward),
+                                         get_dst_locale_shape(is_forward),
+                                         get_dest_table_fwd(is_forward),
+                                         send_buf,
+                                         get_send_displs_d(is_forward),
+                                         stream,
+                                         rows,
+                                         num_src_rows);
+                }
+                else
+                {
+                    pack<DataType, false>(src,
+                                          get_src_local_shape(is_forward),
+                                          get_src_strides(is_forward),
+                                          get_dst_locale_shape(is_forward),
+                                          get_dest_table_fwd(is_forward),
+                                          send_buf,
+                                          get_send_displs_d(is_forward),
+                                          stream,
+                                          rows,
+                                          num_src_rows);
+                }
+            }
+            util::wait_stream(stream, transfer_stream);
+            Al::Alltoallv<Al::NCCLBackend, DataType>(
+                send_buf,
+                get_chunk_send_counts(is_forward, c),
+                get_chunk_send_displs(is_forward, c),
+                recv_buf,
+                get_chunk_recv_counts(is_forward, c),
+                get_chunk_recv_displs(is_forward, c),
+                comm);
+            util::wait_stream(transfer_stream, unpack_stream);
+            const int num_dst_rows = get_dst_chunk_num_rows(is_forward, c);
+            if (unpack_chunks && num_dst_rows > 0)
+            {
+                const int* rows = get_dst_chunk_rows(is_forward, c);
+                if (dst_packed)
+                {
+                    unpack<DataType, true>(dst,
+                                           get_dst_local_shape(is_forward),
+                                           get_dst_strides(is_forward),
+                                           get_src_locale_shape(is_forward),
+                                           get_dest_table_bwd(is_forward),
+                                           recv_buf,
+                                           get_recv_displs_d(is_forward),
+                                           unpack_stream,
+                                           rows,
+                                           num_dst_rows);
+                }
+                else
+                {
+                    unpack<DataType, false>(dst,
+                                            get_dst_local_shape(is_forward),
+                                            get_dst_strides(is_forward),
+                                            get_src_locale_shape(is_forward),
+                                            get_dest_table_bwd(is_forward),
+                                            recv_buf,
+                                            get_recv_displs_d(is_forward),
+                                            unpack_stream,
+                                            rows,
+                                            num_dst_rows);
+                }
+            }
+        }
+        util::wait_stream(unpack_stream, stream);
+
+        release_buf(send_buf);
+        release_buf(recv_buf);
+    }
+}
+
 #define INSTANTIATE_SHUFFLE(TYPE)                                              \
     template <>                                                                \
     void TensorMPICUDAShuffler<TYPE>::shuffle_forward(                         \
@@ -498,6 +648,111 @@ INSTANTIATE_SHUFFLE(unsigned short)
 INSTANTIATE_SHUFFLE(long)
 INSTANTIATE_SHUFFLE(unsigned long)
 
+template <typename SrcType, typename DstType>
+template <typename FromType, typename ToType>
+void TensorMPICUDAShufflerCast<SrcType, DstType>::shuffle_cast(
+    const FromType* src, ToType* dst, gpuStream_t stream, bool is_forward)
+{
+    const ShuffleDestEntry* dest_table_fwd =
+        this->get_dest_table_fwd(is_forward);
+    const ShuffleDestEntry* dest_table_bwd =
+        this->get_dest_table_bwd(is_forward);
+    const int* send_displs_d = this->get_send_displs_d(is_forward);
+    const int* recv_displs_d = this->get_recv_displs_d(is_forward);
+
+    const size_t send_buffer_size =
+        this->get_src_local_shape(is_forward).get_size()
+        * sizeof(WireStorageType);
+    WireStorageType* send_buf = this->get_src_buf(is_forward, stream);
+    const size_t recv_buffer_size =
+        this->get_dst_local_shape(is_forward).get_size()
+        * sizeof(WireStorageType);
+    WireStorageType* recv_buf = this->get_dst_buf(is_forward, stream);
+    // The buffers hold WireType values, stored as WireStorageType.
+    WireType* send_wire = reinterpret_cast<WireType*>(send_buf);
+    const WireType* recv_wire = reinterpret_cast<const WireType*>(recv_buf);
+
+    if (send_buffer_size && this->is_src_split_root(is_forward))
+    {
+        if (this->get_src_overlap(is_forward).reduce_sum() == 0)
+        {
+            pack<FromType, true>(src,
+                                 this->get_src_local_shape(is_forward),
+                                 this->get_src_strides(is_forward),
+                                 this->get_dst_locale_shape(is_forward),
+                                 dest_table_fwd,
+                                 send_wire,
+                                 send_displs_d,
+                                 stream);
+        }
+        else
+        {
+            pack<FromType, false>(src,
+                                  this->get_src_local_shape(is_forward),
+                                  this->get_src_strides(is_forward),
+                                  this->get_dst_locale_shape(is_forward),
+                                  dest_table_fwd,
+                                  send_wire,
+                                  send_displs_d,
+                                  stream);
+        }
+    }
+
+    this->transfer(send_buf, send_buffer_size, recv_buf, recv_buffer_size,
+                   is_forward, stream);
+
+    if (recv_buffer_size && this->is_dst_split_root(is_forward))
+    {
+        if (this->get_dst_overlap(is_forward).reduce_sum() == 0)
+        {
+            unpack<ToType, true>(dst,
+                                 this->get_dst_local_shape(is_forward),
+                                 this->get_dst_strides(is_forward),
+                                 this->get_src_locale_shape(is_forward),
+                                 dest_table_bwd,
+                                 recv_wire,
+                                 recv_displs_d,
+                                 stream);
+        }
+        else
+        {
+            unpack<ToType, false>(dst,
+                                  this->get_dst_local_shape(is_forward),
+                                  this->get_dst_strides(is_forward),
+                                  this->get_src_locale_shape(is_forward),
+                                  dest_table_bwd,
+                                  recv_wire,
+                                  recv_displs_d,
+                                  stream);
+        }
+    }
+
+    this->release_buf(send_buf);
+    this->release_buf(recv_buf);
+}
+
+template <typename SrcType, typename DstType>
+void TensorMPICUDAShufflerCast<SrcType, DstType>::shuffle_forward(
+    const SrcType* src, DstType* dst, gpuStream_t stream)
+{
+    shuffle_cast(src, dst, stream, true);
+}
+
+template <typename SrcType, typename DstType>
+void TensorMPICUDAShufflerCast<SrcType, DstType>::shuffle_backward(
+    const DstType* src, SrcType* dst, gpuStream_t stream)
+{
+    shuffle_cast(src, dst, stream, false);
+}
+
+#define INSTANTIATE_SHUFFLE_CAST(SRC_TYPE, DST_TYPE)                           \
+    template class TensorMPICUDAShufflerCast<SRC_TYPE, DST_TYPE>;              \
+    template class TensorMPICUDAShufflerCast<DST_TYPE, SRC_TYPE>;
+
+INSTANTIATE_SHUFFLE_CAST(float, __half)
+INSTANTIATE_SHUFFLE_CAST(float, ShuffleBF16)
+INSTANTIATE_SHUFFLE_CAST(float, double)
+
 } // namespace tensor
 } // namespace distconv
 
@@ -1,3 +1,4 @@
+#include "distconv/runtime_gpu.hpp"
 #include "distconv/tensor/algorithms/transform_cuda.hpp"
 #include "distconv/tensor/halo_cuda.hpp"
 #include "distconv/tensor/tensor_mpi_cuda.hpp"
@@ -5,6 +6,12 @@
 #include "distconv/util/util_gpu.hpp"
 #include "distconv/util/util_mpi.hpp"
 
+#include <Al.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 namespace distconv {
 namespace tensor {
 
@@ -227,6 +234,320 @@ struct AddConstIf<false, T> {
   using type = T;
 };
 
+// Copies a region of the given shape between two strided buffers.
+template <int ND, typename DataType>
+__global__ void copy_region_kernel(DataType *dst, Array<ND> dst_strides,
+                                   const DataType *src, Array<ND> src_strides,
+                                   Array<ND> shape, index_t size) {
+  const index_t num_threads = static_cast<index_t>(gridDim.x) * blockDim.x;
+  for (index_t i = static_cast<index_t>(blockIdx.x) * blockDim.x +
+           threadIdx.x;
+       i < size; i += num_threads) {
+    index_t dst_offset = 0;
+    index_t src_offset = 0;
+    index_t idx = i;
+#pragma unroll
+    for (int j = 0; j < ND; ++j) {
+      const index_t idx_j = idx % shape[j];
+      dst_offset += dst_strides[j] * idx_j;
+      src_offset += src_strides[j] * idx_j;
+      idx /= shape[j];
+    }
+    dst[dst_offset] = src[src_offset];
+  }
+}
+
+template <typename DataType>
+void copy_region(DataType *dst, const IndexVector &dst_strides,
+                 const DataType *src, const IndexVector &src_strides,
+                 const Shape &shape, h2::gpu::DeviceStream s) {
+  const index_t size = shape.get_size();
+  if (size == 0) {
+    return;
+  }
+  constexpr int block_dim = 256;
+  const int grid_dim = static_cast<int>(
+      std::min<index_t>((size + block_dim - 1) / block_dim, 1 << 16));
+#define CALL_KERNEL(ND)                                                 \
+  copy_region_kernel<ND, DataType><<<grid_dim, block_dim, 0, s>>>(      \
+      dst, Array<ND>(dst_strides), src, Array<ND>(src_strides),         \
+      Array<ND>(shape), size)
+  switch (shape.num_dims()) {
+    case 3:
+      CALL_KERNEL(3);
+      break;
+    case 4:
+      CALL_KERNEL(4);
+      break;
+    case 5:
+      CALL_KERNEL(5);
+      break;
+    default:
+      throw std::exception();
+  }
+#undef CALL_KERNEL
+}
+
+// Whether each rank holds the parts of the source tensors that make
+// up its part of the destination tensor, so that concat_or_slice_kernel
+// can be used.
+template <typename TensorType1, typename TensorType2>
+bool is_local_concat_or_slice(const TensorType1 &t_dest,
+                              const TensorType2 &t_src1,
+                              const TensorType2 &t_src2,
+                              int concat_dim) {
+  // concat_or_slice_kernel traverses the two innermost dimensions
+  // in thread blocks.
+  if (concat_dim <= 1) {
+    return false;
+  }
+  const auto &dest_loc_shape = t_dest.get_locale_shape();
+  if (dest_loc_shape[concat_dim] != 1 ||
+      t_src1.get_locale_shape() != dest_loc_shape ||
+      t_src2.get_locale_shape() != dest_loc_shape) {
+    return false;
+  }
+  for (int i = 0; i < t_dest.get_num_dims(); ++i) {
+    if (i == concat_dim) {
+      continue;
+    }
+    if (t_src1.get_local_shape()[i] != t_dest.get_local_shape()[i] ||
+        t_src2.get_local_shape()[i] != t_dest.get_local_shape()[i] ||
+        t_src1.get_global_index()[i] != t_dest.get_global_index()[i] ||
+        t_src2.get_global_index()[i] != t_dest.get_global_index()[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Stream and communicator for the inter-rank transfers of distributed
+// concatenations, kept with the locale so that they can proceed
+// concurrently with the local copies.
+struct ConcatTransferContext {
+  explicit ConcatTransferContext(MPI_Comm comm):
+      stream(h2::gpu::make_stream_nonblocking()),
+      al_comm(std::make_unique<Al::NCCLBackend::comm_type>(comm, stream)) {}
+  ~ConcatTransferContext() {
+    al_comm.reset();
+    h2::gpu::destroy(stream);
+  }
+  h2::gpu::DeviceStream stream;
+  std::unique_ptr<Al::NCCLBackend::comm_type> al_comm;
+};
+
+// A part of a tensor transferred between two ranks. region is in the
+// coordinates of the whole (concatenated) tensor.
+struct ConcatTransfer {
+  int peer;
+  int part;
+  Region region;
+};
+
+// Concatenates or slices tensors with arbitrary distributions. Each
+// rank sends the intersections of its source regions with the
+// destination regions of other ranks, computed as in the shuffle
+// plans, and copies the intersections with its own destination region
+// directly while the transfers are in flight. Everything is ordered
+// on s.
+template <typename DataType, bool IS_CONCAT, typename WholeTensor,
+          typename PartTensor>
+void concat_or_slice_distributed(WholeTensor &t_whole,
+                                 PartTensor &t_part1,
+                                 PartTensor &t_part2,
+                                 int concat_dim,
+                                 h2::gpu::DeviceStream s) {
+  const auto &loc = t_whole.get_locale();
+  const int num_ranks = loc.get_size();
+  const int rank = loc.get_rank();
+  const int nd = t_whole.get_num_dims();
+  assert_eq(t_part1.get_locale().get_size(), num_ranks);
+  assert_eq(t_part2.get_locale().get_size(), num_ranks);
+
+  PartTensor *parts[2] = {&t_part1, &t_part2};
+  const index_t part_offsets[2] = {0, t_part1.get_shape()[concat_dim]};
+
+  // Region held by rank pid of a part, or of the whole tensor with
+  // part < 0, in the coordinates of the whole tensor.
+  auto get_region = [&](int part, int pid) {
+    if (part < 0) {
+      const auto idx = t_whole.get_locale_shape().get_index(pid);
+      return Region(t_whole.get_remote_index(idx),
+                    t_whole.get_remote_shape(idx));
+    }
+    const auto &t = *parts[part];
+    const auto idx = t.get_locale_shape().get_index(pid);
+    auto offset = t.get_remote_index(idx);
+    offset[concat_dim] += part_offsets[part];
+    return Region(offset, t.get_remote_shape(idx));
+  };
+  auto is_split_root = [&](int part, int pid) {
+    if (part < 0) {
+      return t_whole.get_distribution().is_split_root(
+          t_whole.get_locale_shape().get_index(pid));
+    }
+    const auto &t = *parts[part];
+    return t.get_distribution().is_split_root(
+        t.get_locale_shape().get_index(pid));
+  };
+  // Data are sent by the split roots of the source tensors to all
+  // ranks sharing a destination split.
+  auto get_transfer = [&](int part, int src_pid, int dst_pid) {
+    if (!is_split_root(IS_CONCAT ? part : -1, src_pid)) {
+      return Region(IndexVector(nd, 0), Shape(nd, 0));
+    }
+    const auto src_region = get_region(IS_CONCAT ? part : -1, src_pid);
+    const auto dst_region = get_region(IS_CONCAT ? -1 : part, dst_pid);
+    return src_region.intersect(dst_region);
+  };
+
+  // Transfers are ordered by peer and then by part on both sides, so
+  // each message holds the regions of a peer in the same order.
+  std::vector<ConcatTransfer> sends;
+  std::vector<ConcatTransfer> recvs;
+  std::vector<ConcatTransfer> local_copies;
+  std::vector<size_t> send_counts(num_ranks, 0);
+  std::vector<size_t> recv_counts(num_ranks, 0);
+  for (int pid = 0; pid < num_ranks; ++pid) {
+    for (int part = 0; part < 2; ++part) {
+      const auto send_region = get_transfer(part, rank, pid);
+      if (send_region.get_size() > 0) {
+        if (pid == rank) {
+          local_copies.push_back({pid, part, send_region});
+          continue;
+        }
+        sends.push_back({pid, part, send_region});
+        send_counts[pid] += send_region.get_size();
+      }
+      if (pid == rank) {
+        continue;
+      }
+      const auto recv_region = get_transfer(part, pid, rank);
+      if (recv_region.get_size() > 0) {
+        recvs.push_back({pid, part, recv_region});
+        recv_counts[pid] += recv_region.get_size();
+      }
+    }
+  }
+
+  // Returns the address of the first element of region in the local
+  // tensor holding part, or the whole tensor with part < 0.
+  auto get_ptr = [&](auto &t, int part, const Region &region) {
+    auto ptr = t.get_base_ptr();
+    const auto global_idx = t.get_global_index();
+    const auto strides = t.get_strides();
+    for (int i = 0; i < nd; ++i) {
+      index_t idx = region.get_offset()[i] - global_idx[i];
+      if (part >= 0 && i == concat_dim) {
+        idx -= part_offsets[part];
+      }
+      ptr += idx * strides[i];
+    }
+    return ptr;
+  };
+  auto get_src_ptr = [&](int part, const Region &region) {
+    if constexpr (IS_CONCAT) {
+      return get_ptr(*parts[part], part, region);
+    } else {
+      return get_ptr(t_whole, -1, region);
+    }
+  };
+  auto get_dst_ptr = [&](int part, const Region &region) {
+    if constexpr (IS_CONCAT) {
+      return get_ptr(t_whole, -1, region);
+    } else {
+      return get_ptr(*parts[part], part, region);
+    }
+  };
+  auto get_src_strides = [&](int part) {
+    return IS_CONCAT ? parts[part]->get_strides() : t_whole.get_strides();
+  };
+  auto get_dst_strides = [&](int part) {
+    return IS_CONCAT ? t_whole.get_strides() : parts[part]->get_strides();
+  };
+  auto get_packed_strides = [&](const Region &region) {
+    const auto &extent = region.get_extent();
+    return get_strides(extent, IntVector(nd, 0), extent[0]);
+  };
+
+  size_t send_size = 0;
+  for (auto c: send_counts) send_size += c;
+  size_t recv_size = 0;
+  for (auto c: recv_counts) recv_size += c;
+  const bool has_transfers = send_size > 0 || recv_size > 0;
+  util::MPIPrintStreamDebug()
+      << "Distributed " << (IS_CONCAT ? "concatenation" : "slicing")
+      << ": " << sends.size() << " sends, " << recvs.size()
+      << " receives, " << local_copies.size() << " local copies";
+
+  auto &pool = internal::RuntimeGPU::get_device_memory_pool();
+  DataType *send_buf = nullptr;
+  DataType *recv_buf = nullptr;
+  if (has_transfers) {
+    send_buf = static_cast<DataType *>(
+        pool.get(std::max<size_t>(send_size, 1) * sizeof(DataType), s));
+    recv_buf = static_cast<DataType *>(
+        pool.get(std::max<size_t>(recv_size, 1) * sizeof(DataType), s));
+    DataType *p = send_buf;
+    for (const auto &t: sends) {
+      const auto &region = t.region;
+      copy_region(p, get_packed_strides(region),
+                  get_src_ptr(t.part, region), get_src_strides(t.part),
+                  region.get_extent(), s);
+      p += region.get_size();
+    }
+
+    auto &ctx = loc.template get_cached<ConcatTransferContext>(
+        "concat transfer", [&]() {
+          return std::make_shared<ConcatTransferContext>(loc.get_comm());
+        });
+    util::wait_stream(s, ctx.stream);
+    std::vector<Al::NCCLBackend::req_type> requests;
+    size_t send_displ = 0;
+    size_t recv_displ = 0;
+    for (int pid = 0; pid < num_ranks; ++pid) {
+      if (send_counts[pid] == 0 && recv_counts[pid] == 0) {
+        continue;
+      }
+      requests.push_back(Al::NCCLBackend::null_req);
+      Al::NonblockingSendRecv<Al::NCCLBackend, DataType>(
+          send_buf + send_displ, send_counts[pid], pid,
+          recv_buf + recv_displ, recv_counts[pid], pid,
+          *ctx.al_comm, requests.back());
+      send_displ += send_counts[pid];
+      recv_displ += recv_counts[pid];
+    }
+    for (auto &req: requests) {
+      Al::Wait<Al::NCCLBackend>(req);
+    }
+
+    // Overlap the local copies with the transfers
+    for (const auto &t: local_copies) {
+      copy_region(get_dst_ptr(t.part, t.region), get_dst_strides(t.part),
+                  get_src_ptr(t.part, t.region), get_src_strides(t.part),
+                  t.region.get_extent(), s);
+    }
+    util::wait_stream(ctx.stream, s);
+
+    p = recv_buf;
+    for (const auto &t: recvs) {
+      const auto &region = t.region;
+      copy_region(get_dst_ptr(t.part, region), get_dst_strides(t.part),
+                  static_cast<const DataType *>(p),
+                  get_packed_strides(region), region.get_extent(), s);
+      p += region.get_size();
+    }
+    pool.release(send_buf);
+    pool.release(recv_buf);
+  } else {
+    for (const auto &t: local_copies) {
+      copy_region(get_dst_ptr(t.part, t.region), get_dst_strides(t.part),
+                  get_src_ptr(t.part, t.region), get_src_strides(t.part),
+                  t.region.get_extent(), s);
+    }
+  }
+}
+
 template <typename DataType, bool IS_CONCAT>
 int ConcatenateOrSlice(
     typename AddConstIf<!IS_CONCAT,
@@ -259,8 +580,13 @@ int ConcatenateOrSlice(
         break;
     }
 
-    // TODO: only works for U-Net. Concat on channel dim
-    assert_always(concat_dim == nd - 2);
+    assert_always(concat_dim >= 0);
+    if (!is_local_concat_or_slice(t_dest, t_src1, t_src2, concat_dim))
+    {
+        concat_or_slice_distributed<DataType, IS_CONCAT>(
+            t_dest, t_src1, t_src2, concat_dim, s);
+        return 0;
+    }
 
 #define CALL_KERNEL(ND, INNER_DIM)  do {                                \
     assert_always(concat_dim > INNER_DIM);                              \
@@ -1,7 +1,10 @@
 #include "distconv/util/nvshmem.hpp"
+#include "distconv/util/shmem.hpp"
 #include "distconv/util/util_mpi.hpp"
 #include "distconv/util/util_cuda.hpp"
 
+#include <algorithm>
+
 namespace distconv {
 namespace util {
 namespace nvshmem {
@@ -15,6 +18,7 @@ void initialize(MPI_Comm comm) {
 }
 
 void finalize() {
+  shmem::SymmetricHeap::get_instance().clear();
   util::MPIRootPrintStreamInfo() << "Finalizing NVSHMEM";
   nvshmem_finalize();
 }
@@ -79,19 +83,15 @@ void PairwiseSync::alloc_buffers() {
     // already allocated
     return;
   }
+  auto &heap = shmem::SymmetricHeap::get_instance();
   CounterType *shmem_counter = static_cast<CounterType*>(
-      nvshmem_malloc(sizeof(CounterType)));
-  //util::MPIPrintStreamDebug() << "shmem flag: " << p;
-  if (shmem_counter == nullptr) {
-    util::MPIPrintStreamError() << "Allocation of shmem buffer failed";
-    throw std::exception();
-  }
+      heap.allocate(sizeof(CounterType)));
   DISTCONV_CHECK_CUDA(cudaMemset(shmem_counter, 0, sizeof(CounterType)));
   // Make sure the memset is completed
   DISTCONV_CHECK_CUDA(cudaStreamSynchronize(0));
   barrier();
   m_shmem_counter = std::shared_ptr<CounterType>(
-      shmem_counter, [](CounterType *ptr) { nvshmem_free(ptr); });
+      shmem_counter, [&heap](CounterType *ptr) { heap.release(ptr); });
 
   // Setup the device counter variable
   CounterType *local_counter = nullptr;
@@ -163,24 +163,16 @@ void SyncArray::alloc_counters() {
     // nothing to allocate
     return;
   }
+  auto &heap = shmem::SymmetricHeap::get_instance();
   CounterType *shmem_counter = static_cast<CounterType*>(
-      nvshmem_malloc(sizeof(CounterType) * m_size));
-  //util::MPIPrintStreamDebug() << "shmem flag: " << p;
-  if (shmem_counter == nullptr) {
-    util::MPIPrintStreamError() << "Allocation of shmem buffer failed";
-    throw std::exception();
-  }
+      heap.allocate(sizeof(CounterType) * m_size));
   m_shmem_counter = std::shared_ptr<CounterType>(
-      shmem_counter, [](CounterType *ptr) { nvshmem_free(ptr); });
+      shmem_counter, [&heap](CounterType *ptr) { heap.release(ptr); });
   // Setup the device counter variable
   CounterType *local_counter = static_cast<CounterType*>(
-      nvshmem_malloc(sizeof(CounterType) * m_size));
-  if (shmem_counter == nullptr) {
-    util::MPIPrintStreamError() << "Allocation of local buffer failed";
-    throw std::exception();
-  }
+      heap.allocate(sizeof(CounterType) * m_size));
   m_local_counter = std::shared_ptr<CounterType>(
-      local_counter, [](CounterType *ptr) { nvshmem_free(ptr); });
+      local_counter, [&heap](CounterType *ptr) { heap.release(ptr); });
   init_counters();
 }
 
@@ -197,8 +189,14 @@ void SyncArray::init_counters() {
 }
 
 void SyncArray::ensure_size(size_t size) {
-  if (m_size < size) {
-    m_size = size;
+  if (m_size < size || !m_shmem_counter) {
+    m_size = std::max(m_size, size);
+    if (m_shmem_counter) {
+      // Reallocate, after any kernels using the counters are done
+      DISTCONV_CHECK_CUDA(cudaDeviceSynchronize());
+      m_shmem_counter.reset();
+      m_local_counter.reset();
+    }
     alloc_counters();
   }
 }
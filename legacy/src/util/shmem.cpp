@@ -0,0 +1,157 @@
+#include "distconv/util/shmem.hpp"
+#include "distconv/util/util_mpi.hpp"
+
+#include <cstdlib>
+#include <exception>
+
+#if defined(DISTCONV_HAS_NVSHMEM)
+#include "distconv/util/nvshmem.hpp"
+#elif defined(DISTCONV_HAS_ROCSHMEM)
+#include <rocshmem/rocshmem.hpp>
+#endif
+
+namespace distconv {
+namespace util {
+namespace shmem {
+
+namespace {
+
+// Blocks are rounded up to this size so that slightly different
+// requests share blocks.
+constexpr size_t block_alignment = 512;
+
+void *backend_malloc(size_t size) {
+#if defined(DISTCONV_HAS_NVSHMEM)
+  return nvshmem_malloc(size);
+#elif defined(DISTCONV_HAS_ROCSHMEM)
+  return rocshmem::rocshmem_malloc(size);
+#endif
+}
+
+void backend_free(void *p) {
+#if defined(DISTCONV_HAS_NVSHMEM)
+  nvshmem_free(p);
+#elif defined(DISTCONV_HAS_ROCSHMEM)
+  rocshmem::rocshmem_free(p);
+#endif
+}
+
+} // namespace
+
+void initialize(MPI_Comm comm) {
+#if defined(DISTCONV_HAS_NVSHMEM)
+  nvshmem::initialize(comm);
+#elif defined(DISTCONV_HAS_ROCSHMEM)
+  // ROC_SHMEM runs over MPI_COMM_WORLD.
+  int comm_size, world_size;
+  DISTCONV_CHECK_MPI(MPI_Comm_size(comm, &comm_size));
+  DISTCONV_CHECK_MPI(MPI_Comm_size(MPI_COMM_WORLD, &world_size));
+  assert_always(comm_size == world_size);
+  util::MPIRootPrintStreamInfo() << "Initializing ROC_SHMEM";
+  rocshmem::rocshmem_init();
+#endif
+}
+
+void finalize() {
+#if defined(DISTCONV_HAS_NVSHMEM)
+  nvshmem::finalize();
+#elif defined(DISTCONV_HAS_ROCSHMEM)
+  SymmetricHeap::get_instance().clear();
+  util::MPIRootPrintStreamInfo() << "Finalizing ROC_SHMEM";
+  rocshmem::rocshmem_finalize();
+#endif
+}
+
+void barrier() {
+#if defined(DISTCONV_HAS_NVSHMEM)
+  nvshmem_barrier_all();
+#elif defined(DISTCONV_HAS_ROCSHMEM)
+  rocshmem::rocshmem_barrier_all();
+#endif
+}
+
+int my_pe() {
+#if defined(DISTCONV_HAS_NVSHMEM)
+  return nvshmem_my_pe();
+#elif defined(DISTCONV_HAS_ROCSHMEM)
+  return rocshmem::rocshmem_my_pe();
+#endif
+}
+
+int n_pes() {
+#if defined(DISTCONV_HAS_NVSHMEM)
+  return nvshmem_n_pes();
+#elif defined(DISTCONV_HAS_ROCSHMEM)
+  return rocshmem::rocshmem_n_pes();
+#endif
+}
+
+SymmetricHeap &SymmetricHeap::get_instance() {
+  static SymmetricHeap heap;
+  return heap;
+}
+
+SymmetricHeap::SymmetricHeap() {
+  const char *env = std::getenv("DISTCONV_SHMEM_POOL");
+  m_pool_enabled = env == nullptr || std::atoi(env) != 0;
+}
+
+void *SymmetricHeap::allocate(size_t size) {
+  const size_t block_size =
+      (size + block_alignment - 1) / block_alignment * block_alignment;
+  // Reuses the smallest released block that is not more than twice
+  // as large as needed
+  auto it = m_free_blocks.lower_bound(block_size);
+  if (it != m_free_blocks.end() && it->first <= block_size * 2) {
+    void *p = it->second;
+    m_block_sizes.emplace(p, it->first);
+    m_pooled_bytes -= it->first;
+    m_free_blocks.erase(it);
+    barrier();
+    return p;
+  }
+  void *p = backend_malloc(block_size);
+  if (p == nullptr) {
+    util::MPIPrintStreamError()
+        << "Symmetric allocation of " << block_size << " bytes failed; "
+        << m_allocated_bytes << " bytes allocated, "
+        << m_pooled_bytes << " bytes pooled";
+    throw std::exception();
+  }
+  m_allocated_bytes += block_size;
+  m_block_sizes.emplace(p, block_size);
+  barrier();
+  return p;
+}
+
+void SymmetricHeap::release(void *p) {
+  auto it = m_block_sizes.find(p);
+  assert_always(it != m_block_sizes.end());
+  const size_t block_size = it->second;
+  m_block_sizes.erase(it);
+  if (m_pool_enabled) {
+    m_free_blocks.emplace(block_size, p);
+    m_pooled_bytes += block_size;
+    return;
+  }
+  barrier();
+  backend_free(p);
+  m_allocated_bytes -= block_size;
+  barrier();
+}
+
+void SymmetricHeap::clear() {
+  if (m_free_blocks.empty()) return;
+  barrier();
+  for (auto &block: m_free_blocks) {
+    backend_free(block.second);
+    m_allocated_bytes -= block.first;
+  }
+  m_free_blocks.clear();
+  m_pooled_bytes = 0;
+  barrier();
+}
+
+} // namespace shmem
+} // namespace util
+} // namespace distconv
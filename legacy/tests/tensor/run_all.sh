@@ -24,6 +24,8 @@ TEST_CUDA=(test_tensor_cuda)
 TEST_MPI=(test_tensor_mpi test_tensor_mpi_copy)
 TEST_MPI_CUDA=(test_tensor_mpi_cuda test_tensor_mpi_cuda_copy
 			   test_tensor_mpi_cuda_shuffle
+			   test_tensor_mpi_cuda_prefetch
+			   test_tensor_mpi_cuda_h2_interop
 			   test_tensor_mpi_cuda_algorithms
 			   test_halo_exchange_cuda)
 ####################################################
@@ -145,6 +147,7 @@ function run_test_mpi_cuda() {
 		local args=""
 		if [[ $t = test_tensor_mpi_cuda_copy ||
 				  $t = test_tensor_mpi_cuda_shuffle ||
+				  $t = test_tensor_mpi_cuda_prefetch ||
 				  $t = test_halo_exchange_cuda
 			]]; then
 			args+="$PX $PY"
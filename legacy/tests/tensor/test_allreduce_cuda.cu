@@ -3,6 +3,7 @@
 #include "distconv/runtime_gpu.hpp"
 #include "distconv/tensor/allreduce.hpp"
 #include "distconv/tensor/allreduce_al.hpp"
+#include "distconv/tensor/allreduce_al_hierarchical.hpp"
 #include "distconv/tensor/allreduce_mpi.hpp"
 #include "distconv/tensor/allreduce_mpi_cuda.hpp"
 #include "distconv/tensor/memory_gpu.hpp"
@@ -32,6 +33,9 @@ static std::vector<std::string> nvshmem_methods = {
   "AllreduceNVSHMEMRecursiveDoubling",
   "AllreduceNVSHMEMRecursiveDoublingBuffered",
   "AllreduceNVSHMEMRecursiveDoublingBlock",
+  "AllreduceNVSHMEMRing",
+  "AllreduceNVSHMEMTwoTree",
+  "AllreduceNVSHMEMAuto",
 };
 #endif
 
@@ -144,6 +148,11 @@ make_reducer(const std::string name, MPI_Comm comm, DeviceStream stream)
     {
         return std::make_unique<tensor::AllreduceAlNCCL<DataType>>(
             std::make_shared<Al::NCCLBackend::comm_type>(comm, stream));
+    }
+    else if (name == "AllreduceAlHierarchical")
+    {
+        return std::make_unique<tensor::AllreduceAlHierarchical<DataType>>(
+            comm, stream);
 #ifdef DISTCONV_HAS_NVSHMEM
   } else if (name == "AllreduceNVSHMEM") {
     return std::make_unique<tensor::AllreduceNVSHMEM<DataType>>(
@@ -163,6 +172,15 @@ make_reducer(const std::string name, MPI_Comm comm, DeviceStream stream)
   } else if (name == "AllreduceNVSHMEMRecursiveDoublingBlock") {
     return std::make_unique<tensor::AllreduceNVSHMEM<DataType>>(
         stream, tensor::AllreduceNVSHMEM<DataType>::RECURSIVE_DOUBLING_BLOCK);
+  } else if (name == "AllreduceNVSHMEMRing") {
+    return std::make_unique<tensor::AllreduceNVSHMEM<DataType>>(
+        stream, tensor::AllreduceNVSHMEM<DataType>::RING);
+  } else if (name == "AllreduceNVSHMEMTwoTree") {
+    return std::make_unique<tensor::AllreduceNVSHMEM<DataType>>(
+        stream, tensor::AllreduceNVSHMEM<DataType>::TWO_TREE);
+  } else if (name == "AllreduceNVSHMEMAuto") {
+    return std::make_unique<tensor::AllreduceNVSHMEM<DataType>>(
+        stream, tensor::AllreduceNVSHMEM<DataType>::AUTO);
 #endif // DISTCONV_HAS_NVSHMEM
   } else {
     util::MPIRootPrintStreamError() << "Unknown allreducer name: '" << name << "'";
@@ -218,6 +236,7 @@ int main(int argc, char *argv[]) {
     // default test methods
     methods.push_back("AllreduceMPICUDA");
     methods.push_back("AllreduceAlNCCL");
+    methods.push_back("AllreduceAlHierarchical");
     int argi = 1;
 
     if (argi < argc)
@@ -163,6 +163,15 @@ int main(int argc, char *argv[]) {
                                     src1_shape,
                                     src2_shape,
                                     overlapped_dist));
+    // concat tensors partitioned differently, with the destination
+    // partitioned along the concatenated dimension
+    auto channel_dist =
+        Distribution::make_distribution({1, 1, 2, 2, np / 4});
+    assert0(test_concat<TensorType>(dst_shape,
+                                    channel_dist,
+                                    src1_shape,
+                                    src2_shape,
+                                    overlapped_dist));
 
     MPI_Barrier(MPI_COMM_WORLD);
     MPIRootPrintStreamInfo() << "Completed successfully.";
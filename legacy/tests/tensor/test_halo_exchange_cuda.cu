@@ -12,6 +12,8 @@
 #include "distconv/tensor/halo_exchange_cuda.hpp"
 #include "distconv/tensor/halo_exchange_cuda_mpi.hpp"
 #include "distconv/tensor/halo_exchange_cuda_al.hpp"
+#include "distconv/tensor/halo_exchange_cuda_auto.hpp"
+#include "distconv/tensor/halo_exchange_cuda_mpi_multidim.hpp"
 #ifdef DISTCONV_HAS_P2P
 #include "distconv/tensor/halo_exchange_cuda_p2p.hpp"
 #include "distconv/tensor/halo_exchange_cuda_hybrid.hpp"
@@ -537,6 +539,21 @@ int test_halo_exchange(const Array<ND> &shape,
                                     Al::NCCLBackend>(tensor);
       util::MPIRootPrintStreamInfo() << "HaloExchangeAL created";
       break;
+    case HaloExchangeMethod::AUTO:
+#ifdef DISTCONV_HAS_P2P
+      halo_exc = new HaloExchangeAuto<DataType, CUDAAllocator,
+                                      Al::NCCLBackend>(tensor, p2p);
+#else
+      halo_exc = new HaloExchangeAuto<DataType, CUDAAllocator,
+                                      Al::NCCLBackend>(tensor);
+#endif // DISTCONV_HAS_P2P
+      util::MPIRootPrintStreamInfo() << "HaloExchangeAuto created";
+      break;
+    case HaloExchangeMethod::MPI_MULTIDIM:
+      halo_exc = new HaloExchangeMPIMultiDim<DataType, CUDAAllocator,
+                                             Al::NCCLBackend>(tensor);
+      util::MPIRootPrintStreamInfo() << "HaloExchangeMPIMultiDim created";
+      break;
 #ifdef DISTCONV_HAS_P2P
     case HaloExchangeMethod::P2P:
       halo_exc = new HaloExchangeP2P<
@@ -704,6 +721,21 @@ int test_halo_exchange_reverse(const Array<ND> &shape,
                                     Al::NCCLBackend>(tensor);
       util::MPIRootPrintStreamInfo() << "HaloExchangeAL created";
       break;
+    case HaloExchangeMethod::AUTO:
+#ifdef DISTCONV_HAS_P2P
+      halo_exc = new HaloExchangeAuto<DataType, CUDAAllocator,
+                                      Al::NCCLBackend>(tensor, p2p);
+#else
+      halo_exc = new HaloExchangeAuto<DataType, CUDAAllocator,
+                                      Al::NCCLBackend>(tensor);
+#endif // DISTCONV_HAS_P2P
+      util::MPIRootPrintStreamInfo() << "HaloExchangeAuto created";
+      break;
+    case HaloExchangeMethod::MPI_MULTIDIM:
+      halo_exc = new HaloExchangeMPIMultiDim<DataType, CUDAAllocator,
+                                             Al::NCCLBackend>(tensor);
+      util::MPIRootPrintStreamInfo() << "HaloExchangeMPIMultiDim created";
+      break;
 #ifdef DISTCONV_HAS_P2P
     case HaloExchangeMethod::P2P:
       halo_exc = new HaloExchangeP2P<DataType, CUDAAllocator,
@@ -881,6 +913,7 @@ int main(int argc, char *argv[]) {
 
   std::vector<HaloExchangeMethod> methods = {
     HaloExchangeMethod::MPI, HaloExchangeMethod::AL,
+    HaloExchangeMethod::AUTO, HaloExchangeMethod::MPI_MULTIDIM,
 #ifdef DISTCONV_HAS_P2P
     HaloExchangeMethod::P2P, HaloExchangeMethod::HYBRID
 #endif // DISTCONV_HAS_P2P
@@ -0,0 +1,158 @@
+#include "distconv/distconv.hpp"
+#include "distconv/runtime_gpu.hpp"
+#include "distconv/tensor/h2_interop.hpp"
+#include "distconv/tensor/tensor.hpp"
+#include "distconv/tensor/tensor_mpi_cuda.hpp"
+#include "distconv/util/util_gpu.hpp"
+#include "distconv/util/util_mpi.hpp"
+#include "test_tensor.hpp"
+
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/gpu/runtime.hpp"
+
+#include <Al.hpp>
+
+#include <vector>
+
+using DataType = float;
+
+using namespace distconv;
+using namespace distconv::tensor;
+using namespace h2::gpu;
+
+template <>
+inline LocaleMPI get_locale<LocaleMPI>() {
+  return LocaleMPI(MPI_COMM_WORLD);
+}
+
+namespace {
+
+using TensorType = Tensor<DataType, LocaleMPI, CUDAAllocator>;
+
+// Checks that t and u describe the same local data of the same
+// global tensor.
+void check_same(const TensorType &t, const TensorType &u) {
+  assert_eq(t.get_shape(), u.get_shape());
+  assert_eq(t.get_local_shape(), u.get_local_shape());
+  assert_always(t.get_const_buffer() == u.get_const_buffer());
+  for (int i = 0; i < t.get_num_dims(); ++i) {
+    for (index_t r = 0; r < t.get_locale_shape()[i]; ++r) {
+      assert_always(t.get_dimension_rank_offset(i, r)
+                    == u.get_dimension_rank_offset(i, r));
+      assert_always(t.get_remote_dimension(i, r)
+                    == u.get_remote_dimension(i, r));
+    }
+  }
+}
+
+void check_h2_view(const TensorType &t,
+                   const h2::DistTensor<DataType> &v,
+                   const h2::DistTTuple &dist_types) {
+  assert_always(v.ndim() == static_cast<size_t>(t.get_num_dims()));
+  assert_always(v.distribution() == dist_types);
+  for (int i = 0; i < t.get_num_dims(); ++i) {
+    assert_always(v.shape(i) == static_cast<h2::DimType>(t.get_shape()[i]));
+    assert_always(v.local_shape(i)
+                  == static_cast<h2::DimType>(t.get_local_shape()[i]));
+  }
+  if (t.get_local_size() > 0) {
+    assert_always(v.const_local_tensor().const_data()
+                  == t.get_const_buffer());
+  }
+}
+
+// Views t as an h2 tensor and back, and checks both views.
+int test_round_trip(TensorType &t,
+                    const h2::DistTTuple &dist_types,
+                    const h2::ComputeStream &stream) {
+  util::MPIRootPrintStreamInfo()
+      << "Viewing " << t.get_shape() << " " << t.get_distribution();
+  assert0(t.allocate());
+  assert_always(is_h2_viewable(t));
+  const auto grid = make_h2_proc_grid(t);
+  auto v = as_h2_tensor(t, grid, stream);
+  check_h2_view(t, v, dist_types);
+
+  assert_always(is_distconv_viewable(v));
+  auto u = as_distconv_tensor(v, t.get_locale());
+  assert_always(u.is_view());
+  check_same(t, u);
+
+  // The views alias the original data.
+  if (t.get_local_size() > 0) {
+    std::vector<DataType> ref(t.get_local_size(), 3.0f);
+    mem_copy(u.get_buffer(), ref.data(), ref.size());
+    std::vector<DataType> host(t.get_local_size());
+    mem_copy(host.data(), v.const_local_tensor().const_data(), host.size());
+    assert_always(host == ref);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+  return 0;
+}
+
+} // namespace
+
+/*
+  Usage: mpirun -np N ./test_tensor_mpi_cuda_h2_interop
+ */
+int main(int argc, char *argv[]) {
+  set_gpu(util::choose_gpu());
+  Al::Initialize(argc, argv);
+
+  int np;
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+  int rank;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  auto loc = get_locale<LocaleMPI>();
+  DeviceStream device_stream = make_stream();
+  const h2::ComputeStream stream(device_stream, current_gpu());
+
+  constexpr auto Block = h2::Distribution::Block;
+  constexpr auto Replicated = h2::Distribution::Replicated;
+  constexpr auto Variable = h2::Distribution::Variable;
+
+  {
+    // Sample (Block) distribution.
+    auto t = get_tensor<TensorType>(
+        Shape({4, 4, 2, np * 2}), loc,
+        make_sample_distribution(4, np));
+    assert0(test_round_trip(t, h2::DistTTuple{Block, Block, Block, Block},
+                            stream));
+  }
+  {
+    // Spatial distribution with a remainder.
+    auto t = get_tensor<TensorType>(
+        Shape({np * 3 + 1, 4, 2, 2}), loc,
+        Distribution::make_distribution(Shape({np, 1, 1, 1})));
+    assert0(test_round_trip(t, h2::DistTTuple{Block, Block, Block, Block},
+                            stream));
+  }
+  if (np > 1) {
+    // Shared (Replicated) distribution.
+    auto t = get_tensor<TensorType>(
+        Shape({4, 4, 2, 2}), loc,
+        Distribution::make_shared_distribution(Shape({1, 1, 1, np})));
+    assert0(test_round_trip(t, h2::DistTTuple{Block, Block, Block, Replicated},
+                            stream));
+
+    // Requested local shapes (Variable).
+    TensorType u(Shape({np * (np + 1) / 2, 4, 2, 2}), loc,
+                 Distribution::make_distribution(Shape({np, 1, 1, 1})),
+                 Shape({rank + 1, 0, 0, 0}));
+    assert0(test_round_trip(u, h2::DistTTuple{Variable, Block, Block, Block},
+                            stream));
+
+    // Halos have no h2 equivalent.
+    auto w = get_tensor<TensorType>(
+        Shape({np * 4, 4, 2, 2}), loc,
+        Distribution::make_overlapped_distribution(Shape({np, 1, 1, 1}),
+                                                   IntVector({1, 0, 0, 0})));
+    assert_always(!is_h2_viewable(w));
+  }
+
+  destroy(device_stream);
+  util::MPIRootPrintStreamInfo() << "Completed successfully.";
+
+  Al::Finalize();
+  return 0;
+}
@@ -0,0 +1,157 @@
+#include "distconv/distconv.hpp"
+#include "distconv/runtime_gpu.hpp"
+#include "distconv/tensor/prefetch_mpi_cuda.hpp"
+#include "distconv/tensor/tensor.hpp"
+#include "distconv/tensor/tensor_mpi_cuda.hpp"
+#include "distconv/util/util_gpu.hpp"
+#include "distconv/util/util_mpi.hpp"
+#include "test_tensor.hpp"
+
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/gpu/runtime.hpp"
+
+#include <Al.hpp>
+
+#include <string>
+#include <vector>
+
+using SrcType = short;
+using DstType = float;
+
+using namespace distconv;
+using namespace distconv::tensor;
+using namespace h2::gpu;
+
+template <>
+inline LocaleMPI get_locale<LocaleMPI>() {
+  return LocaleMPI(MPI_COMM_WORLD);
+}
+
+namespace {
+
+constexpr DstType scale = 0.5f;
+constexpr DstType bias = -1.0f;
+
+// Value loaded for a point of a minibatch.
+SrcType get_value(int mb, index_t global_offset) {
+  return static_cast<SrcType>((global_offset + mb * 7) % 1000);
+}
+
+// Calls f with each local index of t, in local order.
+template <typename TensorType, typename F>
+void for_each_local_index(const TensorType &t, F f) {
+  const auto local_shape = t.get_local_shape();
+  if (local_shape.get_size() == 0) return;
+  IndexVector idx(t.get_num_dims(), 0);
+  while (true) {
+    f(idx);
+    int d = 0;
+    for (; d < t.get_num_dims(); ++d) {
+      if (++idx[d] < local_shape[d]) break;
+      idx[d] = 0;
+    }
+    if (d == t.get_num_dims()) return;
+  }
+}
+
+template <typename TensorType>
+int check_minibatch(const TensorType &t, int mb) {
+  std::vector<DstType> host(t.get_local_real_size());
+  if (!host.empty()) {
+    mem_copy(host.data(), t.get_const_buffer(), host.size());
+  }
+  int num_errors = 0;
+  if (!t.is_split_root()) return num_errors;
+  for_each_local_index(t, [&](const IndexVector &idx) {
+    const DstType ref = scale * get_value(mb, t.get_global_offset(idx)) + bias;
+    const DstType stored = host[t.get_local_offset(idx)];
+    if (stored != ref) {
+      if (num_errors++ == 0) {
+        util::MPIPrintStreamError()
+            << "Mismatch in minibatch " << mb << " at " << idx
+            << "; ref: " << ref << ", stored: " << stored;
+      }
+    }
+  });
+  return num_errors;
+}
+
+int test_prefetch(const Shape &shape,
+                  const Distribution &sample_dist,
+                  const Distribution &spatial_dist,
+                  int num_minibatches,
+                  int depth) {
+  using SampleTensor = Tensor<SrcType, LocaleMPI, CUDAAllocator>;
+  using SpatialTensor = Tensor<DstType, LocaleMPI, CUDAAllocator>;
+  auto loc = get_locale<LocaleMPI>();
+  auto sample = get_tensor<SampleTensor>(shape, loc, sample_dist);
+  auto spatial = get_tensor<SpatialTensor>(shape, loc, spatial_dist);
+
+  util::MPIRootPrintStreamInfo()
+      << "Prefetching " << num_minibatches << " minibatches from "
+      << sample_dist << " to " << spatial_dist << " with depth " << depth;
+
+  const auto loader = [](int mb, SrcType *buf, const SampleTensor &t) {
+    index_t i = 0;
+    for_each_local_index(t, [&](const IndexVector &idx) {
+      buf[i++] = get_value(mb, t.get_global_offset(idx));
+    });
+  };
+  DeviceStream stream = make_stream();
+  int num_errors = 0;
+  {
+    TensorMPICUDAPrefetcher<SrcType, DstType> prefetcher(
+        sample, spatial, loader, num_minibatches, depth, scale, bias);
+    for (int mb = 0; prefetcher.has_next(); ++mb) {
+      const auto &t = prefetcher.next(stream);
+      sync(stream);
+      num_errors += check_minibatch(t, mb);
+    }
+  }
+  destroy(stream);
+
+  MPI_Allreduce(MPI_IN_PLACE, &num_errors, 1, MPI_INT, MPI_SUM,
+                MPI_COMM_WORLD);
+  assert_always(num_errors == 0);
+  MPI_Barrier(MPI_COMM_WORLD);
+  return 0;
+}
+
+} // namespace
+
+/*
+  Usage: mpirun -np N ./test_tensor_mpi_cuda_prefetch pw ph, where
+  N is divisible by pw * ph.
+ */
+int main(int argc, char *argv[]) {
+  set_gpu(util::choose_gpu());
+  Al::Initialize(argc, argv);
+
+  int np;
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+
+  if (argc < 3) {
+    util::MPIRootPrintStreamError() << "Error! Usage: " << argv[0]
+                                    << " pw ph";
+    Al::Finalize();
+    return 1;
+  }
+  const int pw = std::stoi(argv[1]);
+  const int ph = std::stoi(argv[2]);
+  assert0(np % (pw * ph));
+
+  const Shape shape({8, 8, 2, np});
+  const auto sample_dist = make_sample_distribution(shape.num_dims(), np);
+  const auto spatial_dist = Distribution::make_overlapped_distribution(
+      Shape({pw, ph, 1, np / (pw * ph)}), IntVector({1, 1, 0, 0}));
+
+  for (int depth : {0, 1, 3}) {
+    assert_always(test_prefetch(shape, sample_dist, spatial_dist,
+                                5, depth) == 0);
+  }
+
+  util::MPIRootPrintStreamInfo() << "Completed successfully.";
+
+  Al::Finalize();
+  return 0;
+}
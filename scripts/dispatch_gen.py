@@ -11,6 +11,7 @@ import itertools
 import argparse
 import re
 import os.path
+from typing import Optional
 
 
 
@@ -18,25 +19,76 @@ import os.path
 # The index of each type in this list must match the index in the
 # h2::ComputeTypes type list.
 H2_COMPUTE_TYPES = ['float', 'double', 'std::int32_t', 'std::uint32_t']
-# Number of bits per token.
-H2_BITS_PER_COMPUTE_TYPE = (len(H2_COMPUTE_TYPES) - 1).bit_length()
+# Short names for compute types, as used for H2_NATIVE_DISPATCH_PAIRS.
+H2_COMPUTE_TYPE_IDS = {
+    'float': 'float',
+    'double': 'double',
+    'int32': 'std::int32_t',
+    'uint32': 'std::uint32_t',
+}
+# Low-precision compute types, present when H2 is built with
+# H2_ENABLE_GPU_LOW_PRECISION. These always come last.
+H2_LOW_PRECISION_COMPUTE_TYPES = ['h2::gpu::Half', 'h2::gpu::BFloat16']
+H2_LOW_PRECISION_COMPUTE_TYPE_IDS = {
+    'fp16': 'h2::gpu::Half',
+    'bf16': 'h2::gpu::BFloat16',
+}
+
+
+def enable_low_precision_types() -> None:
+    """Add the low-precision types to the compute types."""
+    H2_COMPUTE_TYPES.extend(H2_LOW_PRECISION_COMPUTE_TYPES)
+    H2_COMPUTE_TYPE_IDS.update(H2_LOW_PRECISION_COMPUTE_TYPE_IDS)
 
 # Regex for matching dispatch arguments.
 # TODO: This will not handle any arguments that are string literals.
 H2_ARG_REGEX = re.compile(r'"([a-zA-Z0-9_\[\]()<>{}&*:\' ]+)"')
 
 
+def get_dispatch_name(name: str, device: str) -> str:
+    """Return the name registered methods are dispatched by."""
+    return name if device == 'none' else f'{name}_{device}'
+
+
 def dispatch_table_str(
         name: str, device: str, entries: list[str], indent: int = 0) -> str:
-    """Generate a dispatch table containing the entries."""
+    """Generate a dispatch table containing the entries, and the
+    dispatch site for its dispatch name."""
     indent_str = ' ' * indent
     table = indent_str + f'static std::array<::h2::internal::DispatchFunctionEntry, {len(entries)}> _dispatch_table_{name}_{device} = {{{{\n'
     for entry in entries:
         table += indent_str + f'{{{entry}}},\n'
     table += indent_str + '}};\n'
+    table += (
+        indent_str
+        + f'static ::h2::internal::DispatchSite _dispatch_site_{name}_{device}'
+        + f'{{"{get_dispatch_name(name, device)}"}};\n'
+    )
     return table
 
 
+def parse_native_pairs(pairs_str: str) -> set[tuple[str, str]]:
+    """Parse a comma-separated list of "T1:T2" native dispatch pairs."""
+    pairs = set()
+    for pair in filter(None, pairs_str.split(',')):
+        ids = pair.split(':')
+        if len(ids) != 2 or any(i not in H2_COMPUTE_TYPE_IDS for i in ids):
+            raise ValueError(f'Invalid native dispatch pair "{pair}"')
+        pairs.add(tuple(H2_COMPUTE_TYPE_IDS[i] for i in ids))
+    return pairs
+
+
+def is_native_dispatch(
+        types: tuple[str, ...],
+        native_pairs: Optional[set[tuple[str, str]]]) -> bool:
+    """Return whether types get a native dispatch entry.
+
+    Only dispatch on two types is restricted to native_pairs (which
+    None leaves unrestricted).
+    """
+    return len(types) != 2 or native_pairs is None or types in native_pairs
+
+
 def dispatch_entry_str(
         impl_name: str, arg_strs: list[str], indent: int = 0) -> str:
     """Generate an entry for a dispatch table."""
@@ -53,7 +105,6 @@ def dispatch_entry_str(
 def do_dispatch_str(
         table_name: str,
         device: str,
-        dispatch_name: str,
         dispatch_on: list[str],
         args: list[str],
         indent: int = 0) -> str:
@@ -64,7 +115,7 @@ def do_dispatch_str(
     indent_str = ' ' * indent
     dispatch_str = (
         f'{indent_str}::h2::do_dispatch(_dispatch_table_{table_name}_{device}, '
-        f'"{dispatch_name}", {dispatch_on_str}, {args_str})'
+        f'_dispatch_site_{table_name}_{device}, {dispatch_on_str}, {args_str})'
     )
     return dispatch_str
 
@@ -72,7 +123,6 @@ def do_dispatch_str(
 def device_dispatch_str(
         get_device_str: str,
         table_name: str,
-        dispatch_name: str,
         dispatch_on: list[str],
         cpu_args: list[str],
         gpu_args: list[str],
@@ -80,10 +130,8 @@ def device_dispatch_str(
     """Generate a H2_DEVICE_DISPATCH dispatch block."""
     indent_str = ' ' * indent
     prefix_padding = ' ' * len('H2_DEVICE_DISPATCH(')
-    cpu_dispatch = do_dispatch_str(
-        table_name, 'cpu', dispatch_name + '_cpu', dispatch_on, cpu_args)
-    gpu_dispatch = do_dispatch_str(
-        table_name, 'gpu', dispatch_name + '_gpu', dispatch_on, gpu_args)
+    cpu_dispatch = do_dispatch_str(table_name, 'cpu', dispatch_on, cpu_args)
+    gpu_dispatch = do_dispatch_str(table_name, 'gpu', dispatch_on, gpu_args)
     dispatch_str = (
         f'{indent_str}H2_DEVICE_DISPATCH({get_device_str},\n'
         f'{indent_str}{prefix_padding}{cpu_dispatch},\n'
@@ -105,12 +153,14 @@ def get_dispatch_token_for_type(type_name: str) -> int:
 
 
 def get_dispatch_token_for_types(types: tuple[str, ...]) -> int:
-    """Return the token used to dispatch on types."""
+    """Return the token used to dispatch on types.
+
+    This matches h2::internal::get_native_dispatch_key.
+    """
     types_token = 0
-    shift_start = len(types) - 1
-    for i, type_name in enumerate(types):
-        t_token = get_dispatch_token_for_type(type_name)
-        types_token |= t_token << H2_BITS_PER_COMPUTE_TYPE*(shift_start-i)
+    for type_name in types:
+        types_token = (types_token * len(H2_COMPUTE_TYPES)
+                       + get_dispatch_token_for_type(type_name))
     return types_token
 
 
@@ -120,25 +170,58 @@ def get_dispatch_tokens_in_order(num_types: int) -> list[int]:
             for types in get_dispatch_types_in_order(num_types)]
 
 
+def native_if_entry_str(entry: str, condition: str, indent: int = 0) -> str:
+    """Wrap a dispatch table entry so it is empty unless condition (a
+    constant expression) holds.
+
+    This relies on if constexpr, so the condition must depend on a
+    template parameter for the discarded implementation not to be
+    instantiated.
+    """
+    indent_str = ' ' * indent
+    return (
+        f'{indent_str}[]() -> ::h2::internal::DispatchFunctionEntry {{\n'
+        f'{indent_str}  if constexpr ({condition}) {{\n'
+        f'{indent_str}    return {{\n{entry}}};\n'
+        f'{indent_str}  }} else {{\n'
+        f'{indent_str}    return {{nullptr, nullptr}};\n'
+        f'{indent_str}  }}\n'
+        f'{indent_str}}}()'
+    )
+
+
 def generate_dispatch_table(
         num_types: int,
         table_name: str,
         impl_name: str,
         device: str,
         arg_strs: list[str],
+        native_pairs: Optional[set[tuple[str, str]]] = None,
+        native_if: Optional[str] = None,
         indent: int = 0) -> str:
     """Generate a complete dispatch table.
 
-    arg_strs and impl_name may contain format keys like '{T1}', ...,
-    which will be replaced with the corresponding dispatch type.
+    arg_strs, impl_name, and native_if may contain format keys like
+    '{T1}', ..., which will be replaced with the corresponding dispatch
+    type.
+
+    Types without native dispatch (per native_pairs or the condition
+    native_if) get an empty entry, which falls back to registered
+    dispatch.
     """
     entries = []
     for types in get_dispatch_types_in_order(num_types):
+        if not is_native_dispatch(types, native_pairs):
+            entries.append('  nullptr, nullptr')
+            continue
         format_dict = {f'T{i+1}': t for i, t in enumerate(types)}
         this_impl_name = impl_name.format(**format_dict)
         entry_args = [arg.format(**format_dict) for arg in arg_strs]
-        entries.append(dispatch_entry_str(
-            this_impl_name, entry_args, indent=2))
+        entry = dispatch_entry_str(this_impl_name, entry_args, indent=2)
+        if native_if is not None:
+            entry = native_if_entry_str(
+                entry, native_if.format(**format_dict), indent=2)
+        entries.append(entry)
     return dispatch_table_str(table_name, device, entries, indent=indent)
 
 
@@ -179,6 +262,13 @@ def parse_init_line(orig_line: str) -> tuple[str, str, list[str]]:
     return name, device, args
 
 
+def parse_native_if_line(line: str) -> str:
+    """Extract the condition for types to have native dispatch."""
+    line = line.strip()
+    line = line[len('// H2_DISPATCH_NATIVE_IF: "'):-1]
+    return line
+
+
 def parse_get_device_line(line: str) -> str:
     """Extract the code to get the device to dispatch on."""
     line = line.strip()
@@ -214,7 +304,10 @@ def parse_dispatch_args_line(orig_line: str) -> dict[str, list[str]]:
     return {device: args}
 
 
-def process_file(infile: str, outfile: str) -> None:
+def process_file(
+        infile: str,
+        outfile: str,
+        native_pairs: Optional[set[tuple[str, str]]] = None) -> None:
     """Generate dispatch code for infile and write to outfile."""
     with open(infile, 'r') as f:
         source_lines = f.readlines()
@@ -222,6 +315,7 @@ def process_file(infile: str, outfile: str) -> None:
     out_lines = []
     name = None
     num_types = None
+    native_if = None
     get_device = None
     dispatch_on_args = None
     dispatch_args = {}
@@ -237,6 +331,8 @@ def process_file(infile: str, outfile: str) -> None:
             name = parse_name_line(line)
         elif start.startswith('// H2_DISPATCH_NUM_TYPES'):
             num_types = parse_num_types_line(line)
+        elif start.startswith('// H2_DISPATCH_NATIVE_IF'):
+            native_if = parse_native_if_line(line)
         elif start.startswith('// H2_DISPATCH_INIT'):
             impl_name, device, args = parse_init_line(line)
             if name is None or num_types is None:
@@ -249,6 +345,8 @@ def process_file(infile: str, outfile: str) -> None:
                 impl_name,
                 device,
                 args,
+                native_pairs=native_pairs,
+                native_if=native_if,
                 indent=indent)
             if device == 'gpu':
                 dispatch_table = ('#ifdef H2_HAS_GPU\n'
@@ -278,7 +376,6 @@ def process_file(infile: str, outfile: str) -> None:
                 dispatch_str = do_dispatch_str(
                     name,
                     device,
-                    name,
                     dispatch_on_args,
                     dispatch_args[device],
                     indent=indent)
@@ -290,7 +387,6 @@ def process_file(infile: str, outfile: str) -> None:
                 dispatch_str = device_dispatch_str(
                     get_device,
                     name,
-                    name,
                     dispatch_on_args,
                     dispatch_args['cpu'],
                     dispatch_args['gpu'],
@@ -305,6 +401,7 @@ def process_file(infile: str, outfile: str) -> None:
             # Clear things out.
             name = None
             num_types = None
+            native_if = None
             get_device = None
             dispatch_on_args = None
             dispatch_args = {}
@@ -323,7 +420,19 @@ if __name__ == '__main__':
         description='Post-process files and generate dispatch code')
     parser.add_argument('--infile', type=str, help='Input file to postprocess')
     parser.add_argument('--outfile', type=str, help='Output file')
+    parser.add_argument(
+        '--native-pairs', type=str, default=None,
+        help='Comma-separated "T1:T2" pairs of types with native dispatch'
+        ' (default: all)')
+    parser.add_argument(
+        '--low-precision', action='store_true',
+        help='Include low-precision compute types')
     args = parser.parse_args()
     if not os.path.isfile(args.infile):
         raise ValueError(f'Input file {args.infile} does not exist')
-    process_file(args.infile, args.outfile)
+    if args.low_precision:
+        enable_low_precision_types()
+    native_pairs = None
+    if args.native_pairs is not None:
+        native_pairs = parse_native_pairs(args.native_pairs)
+    process_file(args.infile, args.outfile, native_pairs)
@@ -0,0 +1,228 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/allocator.hpp"
+#include "h2/utils/Error.hpp"
+#include "h2/utils/IntegerMath.hpp"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef H2_HAS_GPU
+#include "h2/gpu/memory_utils.hpp"
+#endif
+
+namespace
+{
+
+/**
+ * Cache of pinned host memory.
+ *
+ * Pinning memory is expensive (it requires a call into the driver and
+ * often a device synchronization), so blocks are kept on free lists
+ * binned by power-of-two size and reused.
+ */
+class PinnedMemoryPool
+{
+public:
+  /** Smallest block handed out, in bytes. */
+  static constexpr std::size_t min_block_size = 256;
+
+  ~PinnedMemoryPool()
+  {
+    // The runtime may already be torn down at exit, so errors here are
+    // not actionable.
+    try
+    {
+      release_cached();
+    }
+    catch (...)
+    {}
+  }
+
+  void* allocate(std::size_t bytes)
+  {
+    std::size_t const block_size = get_block_size(bytes);
+    std::lock_guard<std::mutex> lock(mutex);
+    void* ptr = nullptr;
+    auto& free_list = free_blocks[block_size];
+    if (free_list.empty())
+    {
+      ptr = raw_allocate(block_size);
+      h2::internal::record_cache_lookup(h2::Device::CPU, false);
+    }
+    else
+    {
+      ptr = free_list.back();
+      free_list.pop_back();
+      cached_bytes -= block_size;
+      h2::internal::record_cache_lookup(h2::Device::CPU, true);
+    }
+    live_blocks.emplace(ptr, block_size);
+    return ptr;
+  }
+
+  void deallocate(void* ptr)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto i = live_blocks.find(ptr);
+    H2_ASSERT_ALWAYS(i != live_blocks.end(),
+                     "Attempt to free pinned memory ",
+                     ptr,
+                     " that was not allocated by H2");
+    free_blocks[i->second].push_back(ptr);
+    cached_bytes += i->second;
+    live_blocks.erase(i);
+  }
+
+  void release_cached()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& [block_size, free_list] : free_blocks)
+    {
+      for (void* ptr : free_list)
+      {
+        raw_deallocate(ptr);
+      }
+      free_list.clear();
+    }
+    cached_bytes = 0;
+  }
+
+  std::size_t get_cached_bytes()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cached_bytes;
+  }
+
+private:
+  std::mutex mutex;
+  /** Map from block size to unused blocks of that size. */
+  std::unordered_map<std::size_t, std::vector<void*>> free_blocks;
+  /** Map from in-use blocks to their size. */
+  std::unordered_map<void*, std::size_t> live_blocks;
+  /** Total size of all blocks on the free lists. */
+  std::size_t cached_bytes = 0;
+
+  static std::size_t get_block_size(std::size_t bytes)
+  {
+    if (bytes <= min_block_size)
+    {
+      return min_block_size;
+    }
+    return std::size_t{1} << h2::ceillog2(bytes);
+  }
+
+  static void* raw_allocate(std::size_t bytes)
+  {
+#ifdef H2_HAS_GPU
+    return h2::gpu::host_alloc_pinned(bytes);
+#else
+    return ::operator new(bytes);
+#endif
+  }
+
+  static void raw_deallocate(void* ptr)
+  {
+#ifdef H2_HAS_GPU
+    h2::gpu::host_free_pinned(ptr);
+#else
+    ::operator delete(ptr);
+#endif
+  }
+};
+
+PinnedMemoryPool& get_pinned_pool()
+{
+  static PinnedMemoryPool pool;
+  return pool;
+}
+
+}  // anonymous namespace
+
+namespace h2
+{
+namespace internal
+{
+
+void* pinned_allocate(std::size_t bytes)
+{
+  return get_pinned_pool().allocate(bytes);
+}
+
+void pinned_deallocate(void* ptr)
+{
+  get_pinned_pool().deallocate(ptr);
+}
+
+void pinned_release_cached()
+{
+  get_pinned_pool().release_cached();
+}
+
+std::size_t pinned_cached_bytes()
+{
+  return get_pinned_pool().get_cached_bytes();
+}
+
+#ifdef H2_HAS_GPU
+
+namespace
+{
+
+int to_gpu_device_id(Device dev)
+{
+  return (dev == Device::CPU) ? gpu::host_device_id : gpu::current_gpu();
+}
+
+gpu::MemAdvice to_gpu_advice(ManagedAdvice advice)
+{
+  switch (advice)
+  {
+  case ManagedAdvice::ReadMostly: return gpu::MemAdvice::ReadMostly;
+  case ManagedAdvice::PreferredLocation:
+    return gpu::MemAdvice::PreferredLocation;
+  case ManagedAdvice::AccessedBy: return gpu::MemAdvice::AccessedBy;
+  }
+  throw H2FatalException("Unknown managed memory advice");
+}
+
+}  // anonymous namespace
+
+void managed_prefetch(void const* ptr,
+                      std::size_t bytes,
+                      Device dev,
+                      ComputeStream const& stream)
+{
+  H2_ASSERT_DEBUG(stream.get_device() == Device::GPU,
+                  "Managed memory must be prefetched on a GPU stream");
+  gpu::mem_prefetch_async(
+    ptr, bytes, to_gpu_device_id(dev), stream.get_stream<Device::GPU>());
+}
+
+void managed_advise(void const* ptr,
+                    std::size_t bytes,
+                    ManagedAdvice advice,
+                    Device dev)
+{
+  gpu::mem_advise(ptr, bytes, to_gpu_advice(advice), to_gpu_device_id(dev));
+}
+
+#else  // H2_HAS_GPU
+
+void managed_prefetch(void const*, std::size_t, Device, ComputeStream const&)
+{}
+
+void managed_advise(void const*, std::size_t, ManagedAdvice, Device) {}
+
+#endif  // H2_HAS_GPU
+
+}  // namespace internal
+}  // namespace h2
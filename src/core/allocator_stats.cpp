@@ -0,0 +1,242 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/allocator_stats.hpp"
+
+#include "h2/core/allocator.hpp"
+#include "h2/utils/Error.hpp"
+#include "h2/utils/Logger.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <sstream>
+
+#ifdef H2_HAS_GPU
+#include "h2/gpu/memory_utils.hpp"
+#endif
+
+namespace
+{
+
+/** Lock-free counters backing `AllocatorStats` for one device type. */
+struct DeviceAllocatorCounters
+{
+  std::atomic<std::size_t> bytes_live{0};
+  std::atomic<std::size_t> peak_bytes_live{0};
+  std::atomic<std::size_t> num_allocations{0};
+  std::atomic<std::size_t> num_deallocations{0};
+  std::atomic<std::size_t> num_cache_hits{0};
+  std::atomic<std::size_t> num_cache_misses{0};
+  std::array<std::atomic<std::size_t>, h2::AllocatorStats::num_latency_buckets>
+    allocation_latency_ns{};
+};
+
+#ifdef H2_HAS_GPU
+constexpr std::size_t num_device_types = 2;
+#else
+constexpr std::size_t num_device_types = 1;
+#endif
+
+DeviceAllocatorCounters& get_counters(h2::Device dev)
+{
+  static DeviceAllocatorCounters counters[num_device_types];
+  auto const idx = static_cast<std::size_t>(dev);
+  H2_ASSERT_DEBUG(idx < num_device_types, "Unknown device ", dev);
+  return counters[idx];
+}
+
+void update_peak(std::atomic<std::size_t>& peak, std::size_t value)
+{
+  std::size_t cur = peak.load(std::memory_order_relaxed);
+  while (value > cur
+         && !peak.compare_exchange_weak(cur, value, std::memory_order_relaxed))
+  {}
+}
+
+std::size_t get_latency_bucket(std::chrono::nanoseconds latency)
+{
+  auto ns = static_cast<std::size_t>(std::max<decltype(latency.count())>(
+    latency.count(), 1));
+  std::size_t bucket = 0;
+  while (ns >>= 1)
+  {
+    ++bucket;
+  }
+  return std::min(bucket, h2::AllocatorStats::num_latency_buckets - 1);
+}
+
+h2::Logger& get_stats_logger()
+{
+  static h2::Logger logger("h2_allocator_stats");
+  return logger;
+}
+
+void log_allocator_stats()
+{
+  for (h2::Device dev : {h2::Device::CPU
+#ifdef H2_HAS_GPU
+                         ,
+                         h2::Device::GPU
+#endif
+       })
+  {
+    std::ostringstream ss;
+    ss << dev << " allocator: " << h2::get_allocator_stats(dev);
+    get_stats_logger().get().info(ss.str());
+  }
+}
+
+bool check_allocator_stats_enabled()
+{
+  bool const enabled = h2::env::get<bool>("ALLOCATOR_STATS");
+  if (enabled)
+  {
+    // Create the logger and counters before registering the exit
+    // handler so they (and spdlog's registry) outlive the handler.
+    get_stats_logger();
+    get_counters(h2::Device::CPU);
+    std::atexit(log_allocator_stats);
+  }
+  return enabled;
+}
+
+}  // anonymous namespace
+
+namespace h2
+{
+
+AllocatorStats get_allocator_stats(Device dev)
+{
+  auto const& counters = get_counters(dev);
+  AllocatorStats stats;
+  stats.bytes_live = counters.bytes_live.load(std::memory_order_relaxed);
+  stats.peak_bytes_live =
+    counters.peak_bytes_live.load(std::memory_order_relaxed);
+  stats.num_allocations =
+    counters.num_allocations.load(std::memory_order_relaxed);
+  stats.num_deallocations =
+    counters.num_deallocations.load(std::memory_order_relaxed);
+  stats.num_cache_hits = counters.num_cache_hits.load(std::memory_order_relaxed);
+  stats.num_cache_misses =
+    counters.num_cache_misses.load(std::memory_order_relaxed);
+  for (std::size_t i = 0; i < AllocatorStats::num_latency_buckets; ++i)
+  {
+    stats.allocation_latency_ns[i] =
+      counters.allocation_latency_ns[i].load(std::memory_order_relaxed);
+  }
+  if (dev == Device::CPU)
+  {
+    stats.bytes_cached = internal::pinned_cached_bytes();
+  }
+#ifdef H2_HAS_GPU
+  else if (dev == Device::GPU)
+  {
+    stats.bytes_cached = gpu::cached_bytes();
+  }
+#endif
+  return stats;
+}
+
+void reset_allocator_stats(Device dev)
+{
+  auto& counters = get_counters(dev);
+  counters.peak_bytes_live.store(
+    counters.bytes_live.load(std::memory_order_relaxed),
+    std::memory_order_relaxed);
+  counters.num_allocations.store(0, std::memory_order_relaxed);
+  counters.num_deallocations.store(0, std::memory_order_relaxed);
+  counters.num_cache_hits.store(0, std::memory_order_relaxed);
+  counters.num_cache_misses.store(0, std::memory_order_relaxed);
+  for (auto& bucket : counters.allocation_latency_ns)
+  {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::ostream& operator<<(std::ostream& os, AllocatorStats const& stats)
+{
+  os << "AllocatorStats(live=" << stats.bytes_live
+     << ", peak=" << stats.peak_bytes_live
+     << ", cached=" << stats.bytes_cached
+     << ", allocs=" << stats.num_allocations
+     << ", deallocs=" << stats.num_deallocations
+     << ", hit rate=" << stats.cache_hit_rate() << ", latency=[";
+  // Only print the populated range of the histogram.
+  std::size_t first = 0;
+  std::size_t last = AllocatorStats::num_latency_buckets;
+  while (first < last && stats.allocation_latency_ns[first] == 0)
+  {
+    ++first;
+  }
+  while (last > first && stats.allocation_latency_ns[last - 1] == 0)
+  {
+    --last;
+  }
+  for (std::size_t i = first; i < last; ++i)
+  {
+    os << (i == first ? "" : ", ") << (std::size_t{1} << i)
+       << "ns: " << stats.allocation_latency_ns[i];
+  }
+  os << "])";
+  return os;
+}
+
+namespace internal
+{
+
+bool allocator_timing_enabled()
+{
+  static bool const enabled = check_allocator_stats_enabled();
+  return enabled;
+}
+
+void record_allocation(Device dev, std::size_t bytes)
+{
+  auto& counters = get_counters(dev);
+  std::size_t const live =
+    counters.bytes_live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  update_peak(counters.peak_bytes_live, live);
+  counters.num_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void record_allocation(Device dev,
+                       std::size_t bytes,
+                       std::chrono::nanoseconds latency)
+{
+  record_allocation(dev, bytes);
+  get_counters(dev)
+    .allocation_latency_ns[get_latency_bucket(latency)]
+    .fetch_add(1, std::memory_order_relaxed);
+}
+
+void record_deallocation(Device dev, std::size_t bytes)
+{
+  auto& counters = get_counters(dev);
+  counters.bytes_live.fetch_sub(bytes, std::memory_order_relaxed);
+  counters.num_deallocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void record_cache_lookup(Device dev, bool hit)
+{
+  auto& counters = get_counters(dev);
+  if (hit)
+  {
+    counters.num_cache_hits.fetch_add(1, std::memory_order_relaxed);
+  }
+  else
+  {
+    counters.num_cache_misses.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace internal
+
+}  // namespace h2
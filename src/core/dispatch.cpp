@@ -7,53 +7,222 @@
 
 #include "h2/core/dispatch.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace h2
 {
 namespace internal
 {
 
+std::atomic<std::uint64_t> dispatch_generation{0};
+
 namespace
 {
 
-using KeyToEntryMap = std::unordered_map<DispatchKeyT, DispatchFunctionEntry>;
-// Dispatch table with dynamic registration.
-// Maps from names to a lookup table of dispatch keys -> dispatch entries.
-std::unordered_map<std::string, KeyToEntryMap> dispatch_table;
+/** Entries registered for one name, sorted by dispatch key. */
+using KeyTable = std::vector<std::pair<DispatchKeyT, DispatchFunctionEntry>>;
+/** Entry tables for each name, indexed by handle (may be null). */
+using NameTables = std::vector<KeyTable const*>;
+
+/**
+ * Dispatch table with dynamic registration.
+ *
+ * Lookups are lock-free: The current tables are an immutable snapshot
+ * published through an atomic pointer. Registration copies the tables
+ * it changes and publishes a new snapshot. Old snapshots may still be
+ * in use by concurrent lookups, so they are retired rather than freed.
+ * Registration is rare, so this memory is negligible.
+ */
+struct DispatchRegistry
+{
+  DispatchRegistry() : tables(snapshots.emplace_back(new NameTables{}).get())
+  {}
+
+  /** Serializes interning and registration. */
+  std::mutex mutex;
+  /** Handles of interned names. */
+  std::unordered_map<std::string, DispatchNameHandle> handles;
+  /** Interned names, indexed by handle. */
+  std::vector<std::string> names;
+  /** Every published snapshot and key table, freed at exit. */
+  std::vector<std::unique_ptr<NameTables const>> snapshots;
+  std::vector<std::unique_ptr<KeyTable const>> key_tables;
+  /** The current snapshot. */
+  std::atomic<NameTables const*> tables;
+
+  /**
+   * Publish a new snapshot with `handle`'s key table replaced by
+   * `key_table`. The lock must be held.
+   */
+  void publish(DispatchNameHandle handle, KeyTable key_table)
+  {
+    NameTables const* old_tables = tables.load(std::memory_order_relaxed);
+    auto new_tables = std::make_unique<NameTables>(*old_tables);
+    if (new_tables->size() <= handle)
+    {
+      new_tables->resize(handle + 1, nullptr);
+    }
+    (*new_tables)[handle] =
+      key_tables.emplace_back(new KeyTable(std::move(key_table))).get();
+    tables.store(snapshots.emplace_back(std::move(new_tables)).get(),
+                 std::memory_order_release);
+    dispatch_generation.fetch_add(1, std::memory_order_release);
+  }
+
+  /** Return a copy of the current key table for `handle`. */
+  KeyTable copy_key_table(DispatchNameHandle handle) const
+  {
+    NameTables const* cur_tables = tables.load(std::memory_order_relaxed);
+    if (handle < cur_tables->size() && (*cur_tables)[handle] != nullptr)
+    {
+      return *(*cur_tables)[handle];
+    }
+    return KeyTable{};
+  }
+};
+
+DispatchRegistry& get_registry()
+{
+  // Function-local so that the registry exists when other static
+  // initializers intern names or register.
+  static DispatchRegistry registry;
+  return registry;
+}
+
+bool key_less(std::pair<DispatchKeyT, DispatchFunctionEntry> const& entry,
+              DispatchKeyT const& key)
+{
+  return entry.first < key;
+}
 
 }  // anonymous namespace
 
+DispatchNameHandle get_dispatch_name_handle(std::string const& name)
+{
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto [i, inserted] = registry.handles.emplace(
+    name, static_cast<DispatchNameHandle>(registry.names.size()));
+  if (inserted)
+  {
+    registry.names.push_back(name);
+  }
+  return i->second;
+}
+
+std::string get_dispatch_name(DispatchNameHandle handle)
+{
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  H2_ASSERT_ALWAYS(handle < registry.names.size(),
+                   "Invalid dispatch name handle ",
+                   handle);
+  return registry.names[handle];
+}
+
+void add_dispatch_entry(DispatchNameHandle handle,
+                        DispatchKeyT const& dispatch_key,
+                        DispatchFunctionEntry const& dispatch_entry)
+{
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  H2_ASSERT_ALWAYS(handle < registry.names.size(),
+                   "Invalid dispatch name handle ",
+                   handle);
+  KeyTable key_table = registry.copy_key_table(handle);
+  auto i = std::lower_bound(
+    key_table.begin(), key_table.end(), dispatch_key, key_less);
+  if (i != key_table.end() && i->first == dispatch_key)
+  {
+    i->second = dispatch_entry;
+  }
+  else
+  {
+    key_table.emplace(i, dispatch_key, dispatch_entry);
+  }
+  registry.publish(handle, std::move(key_table));
+}
+
 void add_dispatch_entry(std::string const& name,
                         DispatchKeyT const& dispatch_key,
                         DispatchFunctionEntry const& dispatch_entry)
 {
-  if (dispatch_table.count(name) == 0)
+  add_dispatch_entry(
+    get_dispatch_name_handle(name), dispatch_key, dispatch_entry);
+}
+
+void remove_dispatch_entry(DispatchNameHandle handle,
+                           DispatchKeyT const& dispatch_key)
+{
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  KeyTable key_table = registry.copy_key_table(handle);
+  auto i = std::lower_bound(
+    key_table.begin(), key_table.end(), dispatch_key, key_less);
+  if (i != key_table.end() && i->first == dispatch_key)
   {
-    dispatch_table.emplace(name, KeyToEntryMap{});
+    key_table.erase(i);
+    registry.publish(handle, std::move(key_table));
   }
-  dispatch_table[name][dispatch_key] = dispatch_entry;
+}
+
+DispatchFunctionEntry const* find_dispatch_entry(
+  DispatchNameHandle handle, DispatchKeyT const& dispatch_key) H2_NOEXCEPT
+{
+  NameTables const* tables =
+    get_registry().tables.load(std::memory_order_acquire);
+  if (handle >= tables->size() || (*tables)[handle] == nullptr)
+  {
+    return nullptr;
+  }
+  KeyTable const& key_table = *(*tables)[handle];
+  auto i = std::lower_bound(
+    key_table.begin(), key_table.end(), dispatch_key, key_less);
+  if (i == key_table.end() || i->first != dispatch_key)
+  {
+    return nullptr;
+  }
+  return &i->second;
+}
+
+bool has_dispatch_entry(DispatchNameHandle handle,
+                        DispatchKeyT const& dispatch_key)
+{
+  return find_dispatch_entry(handle, dispatch_key) != nullptr;
 }
 
 bool has_dispatch_entry(std::string const& name,
                         DispatchKeyT const& dispatch_key)
 {
-  return (dispatch_table.count(name) > 0)
-         && (dispatch_table[name].count(dispatch_key) > 0);
+  return has_dispatch_entry(get_dispatch_name_handle(name), dispatch_key);
 }
 
 DispatchFunctionEntry const&
-get_dispatch_entry(std::string const& name, DispatchKeyT const& dispatch_key)
+get_dispatch_entry(DispatchNameHandle handle, DispatchKeyT const& dispatch_key)
 {
-  if (!has_dispatch_entry(name, dispatch_key))
+  DispatchFunctionEntry const* entry =
+    find_dispatch_entry(handle, dispatch_key);
+  if (entry == nullptr)
   {
     throw H2FatalException("Attempt to look up dispatch for name ",
-                           name,
+                           get_dispatch_name(handle),
                            " and key ",
                            dispatch_key,
                            " which does not exist");
   }
-  return dispatch_table[name][dispatch_key];
+  return *entry;
+}
+
+DispatchFunctionEntry const&
+get_dispatch_entry(std::string const& name, DispatchKeyT const& dispatch_key)
+{
+  return get_dispatch_entry(get_dispatch_name_handle(name), dispatch_key);
 }
 
 }  // namespace internal
@@ -61,10 +230,8 @@ get_dispatch_entry(std::string const& name, DispatchKeyT const& dispatch_key)
 void dispatch_unregister(std::string const& name,
                          internal::DispatchKeyT const& dispatch_key)
 {
-  if (internal::has_dispatch_entry(name, dispatch_key))
-  {
-    internal::dispatch_table[name].erase(dispatch_key);
-  }
+  internal::remove_dispatch_entry(internal::get_dispatch_name_handle(name),
+                                  dispatch_key);
 }
 
 }  // namespace h2
@@ -0,0 +1,272 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/graph.hpp"
+
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace h2
+{
+
+namespace internal
+{
+
+struct GraphResources
+{
+  /** Memory allocated while capturing. */
+  std::vector<void*> allocations;
+  /** Releases deferred until the graph is destroyed. */
+  std::vector<std::function<void()>> deferred_releases;
+};
+
+}  // namespace internal
+
+namespace
+{
+
+struct GraphCaptureRegistry
+{
+  std::mutex mutex;
+  /** Resources of the graph capturing each stream. */
+  std::unordered_map<gpu::DeviceStream,
+                     std::shared_ptr<internal::GraphResources>>
+    captures;
+  /**
+   * Number of owners (the graph and the buffer) still holding each
+   * graph allocation. It is freed when this reaches 0.
+   */
+  std::unordered_map<void*, int> allocation_refs;
+};
+
+GraphCaptureRegistry& get_registry()
+{
+  static GraphCaptureRegistry registry;
+  return registry;
+}
+
+// These let allocators skip the registry in the common case where no
+// graphs are in use.
+std::atomic<int> num_captures{0};
+std::atomic<int> num_graph_allocations{0};
+
+/** Drop one reference to a graph allocation. Requires the lock. */
+void unref_graph_allocation(GraphCaptureRegistry& registry, void* ptr)
+{
+  auto i = registry.allocation_refs.find(ptr);
+  H2_ASSERT_DEBUG(i != registry.allocation_refs.end(),
+                  "Graph allocation ",
+                  ptr,
+                  " is not known");
+  if (--i->second == 0)
+  {
+    registry.allocation_refs.erase(i);
+    --num_graph_allocations;
+    gpu::mem_free(ptr);
+  }
+}
+
+void register_capture(gpu::DeviceStream stream,
+                      std::shared_ptr<internal::GraphResources> resources)
+{
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  bool const inserted =
+    registry.captures.emplace(stream, std::move(resources)).second;
+  H2_ASSERT_ALWAYS(inserted, "Stream ", stream, " is already being captured");
+  ++num_captures;
+}
+
+void unregister_capture(gpu::DeviceStream stream)
+{
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  if (registry.captures.erase(stream))
+  {
+    --num_captures;
+  }
+}
+
+/** Release everything a graph owns, once its work has completed. */
+void release_graph_resources(internal::GraphResources& resources)
+{
+  // Deferred releases may allocate or release other buffers, so run
+  // them without the lock.
+  for (auto& release : resources.deferred_releases)
+  {
+    release();
+  }
+  resources.deferred_releases.clear();
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (void* ptr : resources.allocations)
+  {
+    unref_graph_allocation(registry, ptr);
+  }
+  resources.allocations.clear();
+}
+
+}  // anonymous namespace
+
+namespace internal
+{
+
+bool graph_capture_in_progress() H2_NOEXCEPT
+{
+  return num_captures.load(std::memory_order_relaxed) > 0;
+}
+
+bool is_graph_capture_stream(gpu::DeviceStream stream)
+{
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  return registry.captures.count(stream) > 0;
+}
+
+void* graph_capture_allocate(std::size_t bytes, gpu::DeviceStream stream)
+{
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto i = registry.captures.find(stream);
+  H2_ASSERT_ALWAYS(i != registry.captures.end(),
+                   "Stream ",
+                   stream,
+                   " is not being captured");
+  // This is a plain allocation rather than from a cache, so the memory
+  // is not reused by anything else while the graph may use it.
+  void* ptr = gpu::mem_alloc(bytes);
+  i->second->allocations.push_back(ptr);
+  registry.allocation_refs.emplace(ptr, 2);
+  ++num_graph_allocations;
+  return ptr;
+}
+
+bool release_graph_allocation(void* ptr)
+{
+  if (num_graph_allocations.load(std::memory_order_relaxed) == 0)
+  {
+    return false;
+  }
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  if (registry.allocation_refs.count(ptr) == 0)
+  {
+    return false;
+  }
+  unref_graph_allocation(registry, ptr);
+  return true;
+}
+
+bool defer_graph_release(gpu::DeviceStream stream,
+                         std::function<void()> release)
+{
+  auto& registry = get_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto i = registry.captures.find(stream);
+  if (i == registry.captures.end())
+  {
+    return false;
+  }
+  i->second->deferred_releases.push_back(std::move(release));
+  return true;
+}
+
+}  // namespace internal
+
+ComputeGraph::~ComputeGraph()
+{
+  H2_TERMINATE_ON_THROW_DEBUG(reset());
+}
+
+ComputeGraph& ComputeGraph::operator=(ComputeGraph&& other)
+{
+  if (this != &other)
+  {
+    reset();
+    capture_stream = std::exchange(other.capture_stream, nullptr);
+    graph = std::exchange(other.graph, nullptr);
+    graph_exec = std::exchange(other.graph_exec, nullptr);
+    resources = std::move(other.resources);
+  }
+  return *this;
+}
+
+void ComputeGraph::begin_capture(ComputeStream const& stream)
+{
+  H2_ASSERT_ALWAYS(stream.get_device() == Device::GPU,
+                   "Can only capture GPU streams");
+  reset();
+  gpu::DeviceStream const raw_stream = stream.get_stream<Device::GPU>();
+  H2_ASSERT_ALWAYS(raw_stream != nullptr,
+                   "Cannot capture the legacy default stream");
+  resources = std::make_shared<internal::GraphResources>();
+  register_capture(raw_stream, resources);
+  try
+  {
+    gpu::begin_capture(raw_stream);
+  }
+  catch (...)
+  {
+    unregister_capture(raw_stream);
+    resources.reset();
+    throw;
+  }
+  capture_stream = raw_stream;
+}
+
+void ComputeGraph::end_capture()
+{
+  H2_ASSERT_ALWAYS(is_capturing(), "Graph is not capturing");
+  gpu::DeviceStream const raw_stream = std::exchange(capture_stream, nullptr);
+  unregister_capture(raw_stream);
+  graph = gpu::end_capture(raw_stream);
+  graph_exec = gpu::instantiate(graph);
+}
+
+void ComputeGraph::replay(ComputeStream const& stream) const
+{
+  H2_ASSERT_ALWAYS(is_captured(), "No captured graph to replay");
+  H2_ASSERT_ALWAYS(stream.get_device() == Device::GPU,
+                   "Can only replay graphs on GPU streams");
+  gpu::launch_graph(graph_exec, stream.get_stream<Device::GPU>());
+}
+
+void ComputeGraph::reset()
+{
+  if (is_capturing())
+  {
+    // Abandon the capture.
+    gpu::DeviceStream const raw_stream =
+      std::exchange(capture_stream, nullptr);
+    unregister_capture(raw_stream);
+    graph = gpu::end_capture(raw_stream);
+  }
+  if (graph_exec != nullptr)
+  {
+    // A replay may still be using the graph's memory.
+    gpu::sync();
+    gpu::destroy(std::exchange(graph_exec, nullptr));
+  }
+  if (graph != nullptr)
+  {
+    gpu::destroy(std::exchange(graph, nullptr));
+  }
+  if (resources)
+  {
+    release_graph_resources(*resources);
+    resources.reset();
+  }
+}
+
+}  // namespace h2
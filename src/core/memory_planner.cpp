@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/memory_planner.hpp"
+
+#include "h2/utils/Error.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+namespace h2
+{
+
+namespace
+{
+
+bool lifetimes_overlap(BufferLifetime const& a, BufferLifetime const& b)
+{
+  return a.first_use <= b.last_use && b.first_use <= a.last_use;
+}
+
+}  // anonymous namespace
+
+MemoryPlan plan_memory_reuse(std::vector<BufferLifetime> const& buffers,
+                             std::size_t alignment)
+{
+  H2_ASSERT_ALWAYS(alignment > 0, "Alignment must be positive");
+  auto const align = [&](std::size_t bytes) {
+    return (bytes + alignment - 1) / alignment * alignment;
+  };
+
+  MemoryPlan plan;
+  plan.offsets.assign(buffers.size(), 0);
+
+  // Place the largest buffers first; ties go to the earliest.
+  std::vector<std::size_t> order(buffers.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(
+    order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+      return buffers[a].bytes > buffers[b].bytes;
+    });
+
+  std::vector<std::size_t> placed;
+  std::vector<std::size_t> conflicts;
+  for (std::size_t i : order)
+  {
+    BufferLifetime const& buf = buffers[i];
+    H2_ASSERT_ALWAYS(buf.first_use <= buf.last_use,
+                     "Buffer ",
+                     i,
+                     " ends before it begins");
+    std::size_t const size = align(buf.bytes);
+    if (size == 0)
+    {
+      continue;
+    }
+
+    conflicts.clear();
+    std::copy_if(placed.begin(),
+                 placed.end(),
+                 std::back_inserter(conflicts),
+                 [&](std::size_t j) {
+                   return lifetimes_overlap(buf, buffers[j]);
+                 });
+    std::sort(conflicts.begin(), conflicts.end(), [&](auto a, auto b) {
+      return plan.offsets[a] < plan.offsets[b];
+    });
+
+    // Best fit among the gaps between conflicting buffers.
+    std::size_t best_offset = 0;
+    std::size_t best_gap = std::numeric_limits<std::size_t>::max();
+    std::size_t gap_start = 0;
+    for (std::size_t j : conflicts)
+    {
+      std::size_t const offset = plan.offsets[j];
+      if (offset >= gap_start + size && offset - gap_start < best_gap)
+      {
+        best_offset = gap_start;
+        best_gap = offset - gap_start;
+      }
+      gap_start = std::max(gap_start, offset + align(buffers[j].bytes));
+    }
+    if (best_gap == std::numeric_limits<std::size_t>::max())
+    {
+      best_offset = gap_start;
+    }
+
+    plan.offsets[i] = best_offset;
+    plan.total_bytes = std::max(plan.total_bytes, best_offset + size);
+    placed.push_back(i);
+  }
+  return plan;
+}
+
+std::size_t MemoryPlanRecorder::record_ensure(Key key, std::size_t bytes)
+{
+  H2_ASSERT_ALWAYS(live.count(key) == 0,
+                   "Buffer ",
+                   key,
+                   " ensured again without being released");
+  std::size_t const idx = lifetimes.size();
+  lifetimes.push_back({bytes, clock++, still_live});
+  live.emplace(key, idx);
+  return idx;
+}
+
+void MemoryPlanRecorder::record_release(Key key)
+{
+  auto i = live.find(key);
+  H2_ASSERT_ALWAYS(
+    i != live.end(), "Buffer ", key, " released without being ensured");
+  lifetimes[i->second].last_use = clock++;
+  live.erase(i);
+}
+
+std::vector<BufferLifetime> MemoryPlanRecorder::get_lifetimes() const
+{
+  std::vector<BufferLifetime> result(lifetimes);
+  for (auto& lifetime : result)
+  {
+    if (lifetime.last_use == still_live)
+    {
+      lifetime.last_use = clock;
+    }
+  }
+  return result;
+}
+
+void MemoryPlanRecorder::clear()
+{
+  lifetimes.clear();
+  live.clear();
+  clock = 0;
+}
+
+MemorySlab::MemorySlab(Device dev,
+                       MemoryPlan plan_,
+                       std::optional<ComputeStream> const stream)
+  : plan(std::move(plan_)), slab(plan.total_bytes, dev, stream)
+{}
+
+void* MemorySlab::get(std::size_t i)
+{
+  H2_ASSERT_DEBUG(i < plan.offsets.size(),
+                  "Buffer index ",
+                  i,
+                  " out of range for plan with ",
+                  plan.offsets.size(),
+                  " buffers");
+  return slab.data() + plan.offsets[i];
+}
+
+}  // namespace h2
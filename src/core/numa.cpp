@@ -0,0 +1,361 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/numa.hpp"
+
+#include "h2/core/thread_pool.hpp"
+#include "h2/utils/Error.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef H2_HAS_GPU
+#include "h2/gpu/runtime.hpp"
+#endif
+
+namespace h2
+{
+namespace cpu
+{
+
+namespace
+{
+
+/** NUMA node allocations on this thread are bound to (-1 for local). */
+thread_local int thread_numa_node = -1;
+
+enum class HugePageMode
+{
+  None,
+  Transparent,
+  Explicit
+};
+
+struct NumaSettings
+{
+  /** Bytes at and above which allocations are mapped and bound. */
+  std::size_t threshold;
+  HugePageMode huge_pages;
+  /** Bytes at and above which allocations use huge pages. */
+  std::size_t huge_page_threshold;
+  /** Whether to fault in pages on the thread pool at allocation. */
+  bool first_touch;
+};
+
+NumaSettings const& get_settings()
+{
+  static NumaSettings const settings = []() {
+    NumaSettings s;
+    s.threshold = env::get<std::size_t>("CPU_NUMA_THRESHOLD");
+    std::string const mode = env::get<std::string>("CPU_HUGE_PAGES");
+    if (mode == "none")
+    {
+      s.huge_pages = HugePageMode::None;
+    }
+    else if (mode == "transparent")
+    {
+      s.huge_pages = HugePageMode::Transparent;
+    }
+    else if (mode == "explicit")
+    {
+      s.huge_pages = HugePageMode::Explicit;
+    }
+    else
+    {
+      throw H2FatalException("Unknown CPU huge page mode '", mode, "'");
+    }
+    s.huge_page_threshold = env::get<std::size_t>("CPU_HUGE_PAGE_THRESHOLD");
+    s.first_touch = env::get<bool>("CPU_FIRST_TOUCH");
+    return s;
+  }();
+  return settings;
+}
+
+#ifdef __linux__
+
+/** Default huge page size on the platforms we run on. */
+constexpr std::size_t huge_page_size = std::size_t{2} << 20;
+
+/** Bytes each thread pool block faults in. */
+constexpr std::size_t first_touch_block_size = std::size_t{1} << 20;
+
+std::size_t get_page_size()
+{
+  static std::size_t const page_size =
+    static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  return page_size;
+}
+
+std::size_t round_up(std::size_t bytes, std::size_t multiple)
+{
+  return (bytes + multiple - 1) / multiple * multiple;
+}
+
+/**
+ * Map `len` bytes (a multiple of `huge_page_size`) aligned to a huge
+ * page, so that transparent huge pages can back all of it.
+ */
+void* map_huge_aligned(std::size_t len)
+{
+  std::size_t const map_len = len + huge_page_size;
+  void* const ptr = mmap(nullptr,
+                         map_len,
+                         PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1,
+                         0);
+  if (ptr == MAP_FAILED)
+  {
+    return MAP_FAILED;
+  }
+  auto const addr = reinterpret_cast<std::uintptr_t>(ptr);
+  auto const aligned = round_up(addr, huge_page_size);
+  if (aligned > addr)
+  {
+    munmap(ptr, aligned - addr);
+  }
+  if (aligned + len < addr + map_len)
+  {
+    munmap(reinterpret_cast<void*>(aligned + len),
+           addr + map_len - aligned - len);
+  }
+  return reinterpret_cast<void*>(aligned);
+}
+
+/**
+ * Prefer NUMA node `node` for the pages of [`ptr`, `ptr` + `len`).
+ *
+ * This is best-effort: if the kernel refuses (e.g., the node does not
+ * exist or the call is filtered in a container), pages are placed by
+ * the default policy.
+ */
+void bind_to_node(void* ptr, std::size_t len, int node)
+{
+  constexpr int mpol_preferred = 1;
+  constexpr std::size_t bits = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> mask(node / bits + 1, 0);
+  mask[node / bits] |= 1UL << (node % bits);
+  syscall(SYS_mbind,
+          ptr,
+          len,
+          mpol_preferred,
+          mask.data(),
+          mask.size() * bits + 1,
+          0);
+}
+
+/** Fault in the pages of [`ptr`, `ptr` + `len`) on the thread pool. */
+void first_touch(void* ptr, std::size_t len, std::size_t page_size)
+{
+  std::size_t const block_size = std::max(first_touch_block_size, page_size);
+  std::size_t const num_blocks = (len + block_size - 1) / block_size;
+  parallel_for(num_blocks, [&](std::size_t block) {
+    auto* const bytes = static_cast<volatile unsigned char*>(ptr);
+    std::size_t const end = std::min(len, (block + 1) * block_size);
+    for (std::size_t i = block * block_size; i < end; i += page_size)
+    {
+      // Mapped memory is zeroed, so this only forces the fault.
+      bytes[i] = 0;
+    }
+  });
+}
+
+/**
+ * Allocations from the NUMA backend that were mapped directly, with
+ * their mapped lengths. Anything else came from `operator new`.
+ */
+class NumaMappings
+{
+public:
+  void add(void* ptr, std::size_t len)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    mappings.emplace(ptr, len);
+  }
+
+  /** Remove `ptr` and return its length, or 0 if it was not mapped. */
+  std::size_t remove(void* ptr)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto i = mappings.find(ptr);
+    if (i == mappings.end())
+    {
+      return 0;
+    }
+    std::size_t const len = i->second;
+    mappings.erase(i);
+    return len;
+  }
+
+private:
+  std::mutex mutex;
+  std::unordered_map<void*, std::size_t> mappings;
+};
+
+NumaMappings& get_numa_mappings()
+{
+  static NumaMappings mappings;
+  return mappings;
+}
+
+#endif  // __linux__
+
+}  // anonymous namespace
+
+AllocatorBackend allocator_backend()
+{
+  static AllocatorBackend const backend = []() {
+    std::string const name = env::get<std::string>("CPU_ALLOCATOR");
+    if (name == "default")
+    {
+      return AllocatorBackend::Default;
+    }
+    else if (name == "numa")
+    {
+      return AllocatorBackend::NUMA;
+    }
+    throw H2FatalException("Unknown CPU allocator backend '", name, "'");
+  }();
+  return backend;
+}
+
+int get_current_numa_node() noexcept
+{
+#ifdef __linux__
+  unsigned int cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+  {
+    return static_cast<int>(node);
+  }
+#endif
+  return -1;
+}
+
+#ifdef H2_HAS_GPU
+int get_gpu_numa_node(int gpu_id)
+{
+  std::string bus_id = gpu::device_properties(gpu_id).pci_bus_id;
+  std::transform(bus_id.begin(), bus_id.end(), bus_id.begin(), [](char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  });
+  std::ifstream f("/sys/bus/pci/devices/" + bus_id + "/numa_node");
+  int node = -1;
+  if (!(f >> node))
+  {
+    return -1;
+  }
+  return node;
+}
+#endif
+
+int get_numa_node() noexcept
+{
+  return thread_numa_node;
+}
+
+void set_numa_node(int node) noexcept
+{
+  thread_numa_node = node;
+}
+
+namespace internal
+{
+
+void* numa_allocate(std::size_t bytes)
+{
+  NumaSettings const& settings = get_settings();
+  if (bytes < settings.threshold || bytes == 0)
+  {
+    return ::operator new(bytes);
+  }
+#ifdef __linux__
+  bool const huge = settings.huge_pages != HugePageMode::None
+                    && bytes >= settings.huge_page_threshold;
+  std::size_t const page_size = huge ? huge_page_size : get_page_size();
+  std::size_t const len = round_up(bytes, page_size);
+  void* ptr = MAP_FAILED;
+  if (huge && settings.huge_pages == HugePageMode::Explicit)
+  {
+    // Fails if the reserved huge page pool is exhausted.
+    ptr = mmap(nullptr,
+               len,
+               PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+               -1,
+               0);
+  }
+  if (ptr == MAP_FAILED)
+  {
+    ptr = huge ? map_huge_aligned(len)
+               : mmap(nullptr,
+                      len,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1,
+                      0);
+    if (ptr == MAP_FAILED)
+    {
+      throw std::bad_alloc();
+    }
+    if (huge)
+    {
+      madvise(ptr, len, MADV_HUGEPAGE);
+    }
+  }
+  int const node =
+    (thread_numa_node >= 0) ? thread_numa_node : get_current_numa_node();
+  if (node >= 0)
+  {
+    bind_to_node(ptr, len, node);
+  }
+  if (settings.first_touch)
+  {
+    first_touch(ptr, len, page_size);
+  }
+  get_numa_mappings().add(ptr, len);
+  return ptr;
+#else
+  return ::operator new(bytes);
+#endif
+}
+
+void numa_deallocate(void* ptr)
+{
+  if (ptr == nullptr)
+  {
+    return;
+  }
+#ifdef __linux__
+  if (std::size_t const len = get_numa_mappings().remove(ptr))
+  {
+    munmap(ptr, len);
+    return;
+  }
+#endif
+  ::operator delete(ptr);
+}
+
+}  // namespace internal
+
+}  // namespace cpu
+}  // namespace h2
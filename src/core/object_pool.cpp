@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/object_pool.hpp"
+
+#include "h2/utils/environment_vars.hpp"
+
+#include <array>
+
+namespace h2
+{
+namespace internal
+{
+
+namespace
+{
+
+constexpr std::size_t num_size_classes =
+  max_pooled_object_size / pool_size_class_bytes;
+
+static_assert(max_pooled_object_size % pool_size_class_bytes == 0,
+              "Pooled sizes must be whole size classes");
+
+std::size_t get_max_cached()
+{
+  static std::size_t const max_cached =
+    env::get<std::size_t>("OBJECT_POOL_SIZE");
+  return max_cached;
+}
+
+/** Return the size class of a pooled allocation of `bytes`. */
+std::size_t get_size_class(std::size_t bytes) noexcept
+{
+  return (bytes == 0) ? 0 : (bytes - 1) / pool_size_class_bytes;
+}
+
+/**
+ * Set when the calling thread's freelists are destroyed.
+ *
+ * This is trivially destructible, so it remains valid while other
+ * thread-local objects are destroyed, and objects they free then go to
+ * the global heap.
+ */
+thread_local bool freelists_destroyed = false;
+
+/** Freelists of cached blocks for each size class. */
+class Freelists
+{
+public:
+  Freelists() = default;
+  Freelists(Freelists const&) = delete;
+  Freelists& operator=(Freelists const&) = delete;
+
+  ~Freelists()
+  {
+    freelists_destroyed = true;
+    for (auto& list : lists)
+    {
+      while (list.head != nullptr)
+      {
+        Block* const next = list.head->next;
+        ::operator delete(list.head);
+        list.head = next;
+      }
+    }
+  }
+
+  /** Return a cached block of size class `c`, or null if none are. */
+  void* pop(std::size_t c) noexcept
+  {
+    List& list = lists[c];
+    if (list.head == nullptr)
+    {
+      return nullptr;
+    }
+    Block* const block = list.head;
+    list.head = block->next;
+    --list.count;
+    --num_cached;
+    return block;
+  }
+
+  /** Cache a block of size class `c`, returning false if full. */
+  bool push(void* ptr, std::size_t c, std::size_t max_cached) noexcept
+  {
+    List& list = lists[c];
+    if (list.count >= max_cached)
+    {
+      return false;
+    }
+    Block* const block = static_cast<Block*>(ptr);
+    block->next = list.head;
+    list.head = block;
+    ++list.count;
+    ++num_cached;
+    return true;
+  }
+
+  std::size_t size() const noexcept { return num_cached; }
+
+private:
+  struct Block
+  {
+    Block* next;
+  };
+
+  struct List
+  {
+    Block* head = nullptr;
+    std::size_t count = 0;
+  };
+
+  std::array<List, num_size_classes> lists;
+  std::size_t num_cached = 0;
+};
+
+/** Return the calling thread's freelists, or null after thread exit. */
+Freelists* get_freelists() noexcept
+{
+  if (freelists_destroyed)
+  {
+    return nullptr;
+  }
+  thread_local Freelists freelists;
+  return &freelists;
+}
+
+}  // anonymous namespace
+
+void* pool_allocate(std::size_t bytes)
+{
+  if (bytes > max_pooled_object_size || get_max_cached() == 0)
+  {
+    return ::operator new(bytes);
+  }
+  std::size_t const c = get_size_class(bytes);
+  if (Freelists* const freelists = get_freelists())
+  {
+    if (void* const ptr = freelists->pop(c))
+    {
+      return ptr;
+    }
+  }
+  // Blocks are allocated at their class size so any object of the
+  // class can reuse them.
+  return ::operator new((c + 1) * pool_size_class_bytes);
+}
+
+void pool_deallocate(void* ptr, std::size_t bytes) noexcept
+{
+  if (ptr == nullptr)
+  {
+    return;
+  }
+  if (bytes <= max_pooled_object_size)
+  {
+    Freelists* const freelists = get_freelists();
+    if (freelists != nullptr
+        && freelists->push(ptr, get_size_class(bytes), get_max_cached()))
+    {
+      return;
+    }
+  }
+  ::operator delete(ptr);
+}
+
+std::size_t pool_num_cached() noexcept
+{
+  Freelists const* const freelists = get_freelists();
+  return (freelists != nullptr) ? freelists->size() : 0;
+}
+
+}  // namespace internal
+}  // namespace h2
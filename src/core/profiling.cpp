@@ -0,0 +1,158 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/profiling.hpp"
+
+#include "h2/utils/Error.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <sstream>
+
+#if H2_HAS_PROFILING
+#if H2_HAS_CUDA
+#include <nvToolsExt.h>
+#elif H2_HAS_ROCM
+#include <roctracer/roctx.h>
+#endif
+#endif
+
+namespace h2
+{
+
+char const* get_profile_category_name(ProfileCategory category)
+{
+  switch (category)
+  {
+  case ProfileCategory::Copy: return "copy";
+  case ProfileCategory::Compute: return "compute";
+  case ProfileCategory::Memory: return "memory";
+  case ProfileCategory::Comm: return "comm";
+  case ProfileCategory::Dispatch: return "dispatch";
+  default: return "unknown";
+  }
+}
+
+namespace internal
+{
+
+std::uint32_t parse_profile_categories(std::string const& categories)
+{
+  if (categories.empty() || categories == "none")
+  {
+    return 0;
+  }
+  std::uint32_t mask = 0;
+  std::istringstream ss(categories);
+  std::string name;
+  while (std::getline(ss, name, ','))
+  {
+    if (name == "all")
+    {
+      for (std::uint32_t c = 1; c <= num_profile_categories; ++c)
+      {
+        mask |= std::uint32_t{1} << c;
+      }
+      continue;
+    }
+    bool found = false;
+    for (std::uint32_t c = 1; c <= num_profile_categories; ++c)
+    {
+      if (name == get_profile_category_name(static_cast<ProfileCategory>(c)))
+      {
+        mask |= std::uint32_t{1} << c;
+        found = true;
+        break;
+      }
+    }
+    H2_ASSERT_ALWAYS(found, "Unknown profile category '", name, "'");
+  }
+  return mask;
+}
+
+std::uint32_t get_enabled_profile_categories()
+{
+  return parse_profile_categories(env::get_raw("PROFILING"));
+}
+
+#if H2_HAS_PROFILING
+
+#if H2_HAS_CUDA
+namespace
+{
+
+nvtxDomainHandle_t get_nvtx_domain()
+{
+  static nvtxDomainHandle_t const domain = []() {
+    nvtxDomainHandle_t d = nvtxDomainCreateA("h2");
+    for (std::uint32_t c = 1; c <= num_profile_categories; ++c)
+    {
+      nvtxDomainNameCategoryA(
+        d, c, get_profile_category_name(static_cast<ProfileCategory>(c)));
+    }
+    return d;
+  }();
+  return domain;
+}
+
+/** Colors distinguishing categories in the timeline (ARGB). */
+std::uint32_t get_nvtx_color(ProfileCategory category)
+{
+  switch (category)
+  {
+  case ProfileCategory::Copy: return 0xff1f77b4;
+  case ProfileCategory::Compute: return 0xff2ca02c;
+  case ProfileCategory::Memory: return 0xffff7f0e;
+  case ProfileCategory::Comm: return 0xffd62728;
+  case ProfileCategory::Dispatch: return 0xff9467bd;
+  default: return 0xff7f7f7f;
+  }
+}
+
+}  // anonymous namespace
+#endif  // H2_HAS_CUDA
+
+void profile_range_push(char const* name, ProfileCategory category)
+{
+#if H2_HAS_CUDA
+  nvtxEventAttributes_t attrs = {};
+  attrs.version = NVTX_VERSION;
+  attrs.size = NVTX_EVENT_ATTRIB_STRUCT_SIZE;
+  attrs.category = static_cast<std::uint32_t>(category);
+  attrs.colorType = NVTX_COLOR_ARGB;
+  attrs.color = get_nvtx_color(category);
+  attrs.messageType = NVTX_MESSAGE_TYPE_ASCII;
+  attrs.message.ascii = name;
+  nvtxDomainRangePushEx(get_nvtx_domain(), &attrs);
+#elif H2_HAS_ROCM
+  std::string const full_name =
+    std::string("h2:") + get_profile_category_name(category) + ":" + name;
+  roctxRangePushA(full_name.c_str());
+#endif
+}
+
+void profile_range_pop()
+{
+#if H2_HAS_CUDA
+  nvtxDomainRangePop(get_nvtx_domain());
+#elif H2_HAS_ROCM
+  roctxRangePop();
+#endif
+}
+
+#else  // H2_HAS_PROFILING
+
+void profile_range_push(char const*, ProfileCategory) {}
+
+void profile_range_pop() {}
+
+#endif  // H2_HAS_PROFILING
+
+}  // namespace internal
+
+}  // namespace h2
@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/scalar_readback.hpp"
+
+#include "h2/core/allocator.hpp"
+#include "h2/utils/Error.hpp"
+
+namespace h2
+{
+
+ScalarReadbackRing::ScalarReadbackRing(Device device_, std::size_t num_slots_)
+  : device(device_), host_buf(nullptr)
+{
+  H2_ASSERT_ALWAYS(num_slots_ > 0, "Readback rings need at least one slot");
+  host_buf = internal::allocate<unsigned char, Device::CPU>(
+    num_slots_ * slot_bytes, ComputeStream{Device::CPU}, MemoryKind::Pinned);
+  slots.reserve(num_slots_);
+  for (std::size_t i = 0; i < num_slots_; ++i)
+  {
+    // Async CPU events are needed to track async CPU streams.
+    H2_DEVICE_DISPATCH(
+      device,
+      slots.push_back(Slot{create_new_async_cpu_event(), 0}),
+      slots.push_back(Slot{create_new_sync_event<Device::GPU>(), 0}));
+  }
+}
+
+ScalarReadbackRing::~ScalarReadbackRing()
+{
+  for (auto& slot : slots)
+  {
+    H2_TERMINATE_ON_THROW_DEBUG(slot.event.wait_for_this());
+    destroy_sync_event(slot.event);
+  }
+  H2_TERMINATE_ON_THROW_DEBUG(
+    (internal::deallocate<unsigned char, Device::CPU>(
+      static_cast<unsigned char*>(host_buf),
+      slots.size() * slot_bytes,
+      ComputeStream{Device::CPU},
+      MemoryKind::Pinned)));
+}
+
+std::size_t ScalarReadbackRing::acquire_slot()
+{
+  std::size_t const slot = next_slot;
+  next_slot = (next_slot + 1) % slots.size();
+  // This is normally long complete, but a copy on another stream must
+  // not land after the one about to be enqueued.
+  slots[slot].event.wait_for_this();
+  ++slots[slot].generation;
+  return slot;
+}
+
+}  // namespace h2
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/scratch_arena.hpp"
+
+#include "h2/utils/Error.hpp"
+
+#include <algorithm>
+
+namespace
+{
+
+#ifdef H2_HAS_GPU
+constexpr std::size_t num_device_types = 2;
+#else
+constexpr std::size_t num_device_types = 1;
+#endif
+
+/** Current arena for each device type on this thread. */
+thread_local h2::ScratchArena* current_arenas[num_device_types] = {};
+
+h2::ScratchArena*& current_arena_slot(h2::Device dev)
+{
+  auto const idx = static_cast<std::size_t>(dev);
+  H2_ASSERT_DEBUG(idx < num_device_types, "Unknown device ", dev);
+  return current_arenas[idx];
+}
+
+}  // anonymous namespace
+
+namespace h2
+{
+
+ScratchArena::ScratchArena(Device dev,
+                           std::size_t capacity_,
+                           std::optional<ComputeStream> const stream_)
+  : buf(capacity_, dev, stream_),
+    offset(0),
+    peak_offset(0),
+    live(0),
+    fallbacks(0)
+{}
+
+void* ScratchArena::allocate(std::size_t bytes)
+{
+  std::size_t const aligned_bytes =
+    (bytes + alignment - 1) / alignment * alignment;
+  if (aligned_bytes > capacity() - offset)
+  {
+    ++fallbacks;
+    return nullptr;
+  }
+  void* ptr = buf.data() + offset;
+  offset += aligned_bytes;
+  peak_offset = std::max(peak_offset, offset);
+  ++live;
+  return ptr;
+}
+
+void ScratchArena::deallocate([[maybe_unused]] void* ptr,
+                              ComputeStream const& stream)
+{
+  H2_ASSERT_DEBUG(ptr >= buf.data() && ptr < buf.data() + capacity(),
+                  "Pointer ",
+                  ptr,
+                  " was not allocated from this arena");
+  H2_ASSERT_DEBUG(live > 0, "Deallocating from an arena with no buffers");
+  --live;
+  if (stream != get_stream())
+  {
+    // Order later reuse of this memory after any work on stream.
+    get_stream().wait_for(stream);
+  }
+}
+
+ScratchArenaScope::ScratchArenaScope(ScratchArena& arena_)
+  : arena(arena_),
+    prev_arena(current_arena_slot(arena_.get_device())),
+    start_offset(arena_.offset),
+    start_live(arena_.live)
+{
+  current_arena_slot(arena.get_device()) = &arena;
+}
+
+ScratchArenaScope::~ScratchArenaScope()
+{
+  H2_ASSERT_DEBUG(arena.live == start_live,
+                  "Buffers allocated from a scratch arena outlived its scope");
+  arena.offset = start_offset;
+  current_arena_slot(arena.get_device()) = prev_arena;
+}
+
+namespace internal
+{
+
+ScratchArena* get_current_arena(Device dev) H2_NOEXCEPT
+{
+  return current_arena_slot(dev);
+}
+
+}  // namespace internal
+
+}  // namespace h2
@@ -0,0 +1,273 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/size_class_allocator.hpp"
+
+#include "h2/utils/Error.hpp"
+#include "h2/utils/IntegerMath.hpp"
+
+#include <algorithm>
+
+namespace h2
+{
+namespace internal
+{
+
+std::size_t SizeClassPolicy::round(std::size_t bytes) const
+{
+  if (bytes <= min_block_size)
+  {
+    return min_block_size;
+  }
+  if (bytes < linear_threshold)
+  {
+    return std::min(std::size_t{1} << ceillog2(bytes), linear_threshold);
+  }
+  return (bytes + linear_step - 1) / linear_step * linear_step;
+}
+
+SizeClassAllocator::SizeClassAllocator(RawAllocFn raw_alloc_,
+                                       RawFreeFn raw_free_,
+                                       SizeClassPolicy policy_)
+  : raw_alloc(std::move(raw_alloc_)),
+    raw_free(std::move(raw_free_)),
+    policy(policy_)
+{
+  H2_ASSERT_ALWAYS(policy.min_block_size > 0 && policy.linear_step > 0,
+                   "Size class policy must have non-zero block sizes");
+  H2_ASSERT_ALWAYS(policy.linear_threshold % policy.linear_step == 0,
+                   "Linear threshold (",
+                   policy.linear_threshold,
+                   ") must be a multiple of the linear step (",
+                   policy.linear_step,
+                   ")");
+}
+
+SizeClassAllocator::~SizeClassAllocator()
+{
+  // Memory still in use is leaked, as it may be referenced. The
+  // underlying runtime may also be gone by now, so ignore errors.
+  try
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    trim_unlocked();
+  }
+  catch (...)
+  {}
+  for (Block* block : large_free)
+  {
+    delete block;
+  }
+  for (auto& [ptr, block] : large_in_use)
+  {
+    delete block;
+  }
+}
+
+void* SizeClassAllocator::allocate(std::size_t bytes, StreamKey stream)
+{
+  std::size_t const size = policy.round(bytes);
+  std::lock_guard<std::mutex> lock(mutex);
+  void* ptr = (size < policy.linear_threshold) ? allocate_small(size, stream)
+                                               : allocate_large(size, stream);
+  num_allocated_bytes += size;
+  return ptr;
+}
+
+void SizeClassAllocator::deallocate(void* ptr)
+{
+  if (ptr == nullptr)
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  if (auto i = small_in_use.find(ptr); i != small_in_use.end())
+  {
+    auto const [size, stream] = i->second;
+    small_free[{stream, size}].push_back(ptr);
+    small_in_use.erase(i);
+    num_allocated_bytes -= size;
+    num_cached_bytes += size;
+    return;
+  }
+  auto i = large_in_use.find(ptr);
+  H2_ASSERT_ALWAYS(i != large_in_use.end(),
+                   "Attempt to free memory ",
+                   ptr,
+                   " that was not allocated by this allocator");
+  Block* block = i->second;
+  large_in_use.erase(i);
+  num_allocated_bytes -= block->size;
+  free_large(block);
+}
+
+void SizeClassAllocator::trim()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  trim_unlocked();
+}
+
+std::size_t SizeClassAllocator::cached_bytes() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return num_cached_bytes;
+}
+
+std::size_t SizeClassAllocator::allocated_bytes() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return num_allocated_bytes;
+}
+
+std::size_t SizeClassAllocator::reserved_bytes() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return num_reserved_bytes;
+}
+
+void* SizeClassAllocator::allocate_small(std::size_t size, StreamKey stream)
+{
+  void* ptr = nullptr;
+  auto& free_list = small_free[{stream, size}];
+  if (free_list.empty())
+  {
+    ptr = raw_alloc_with_retry(size);
+  }
+  else
+  {
+    ptr = free_list.back();
+    free_list.pop_back();
+    num_cached_bytes -= size;
+  }
+  small_in_use.emplace(ptr, std::make_pair(size, stream));
+  return ptr;
+}
+
+void* SizeClassAllocator::allocate_large(std::size_t size, StreamKey stream)
+{
+  // Best fit: the smallest free block on this stream that is big enough.
+  Block probe{nullptr, size, stream, false, nullptr, nullptr};
+  auto i = large_free.lower_bound(&probe);
+  Block* block = nullptr;
+  if (i != large_free.end() && (*i)->stream == stream)
+  {
+    block = *i;
+    large_free.erase(i);
+    num_cached_bytes -= block->size;
+    std::size_t const remaining = block->size - size;
+    if (remaining >= policy.linear_step)
+    {
+      // Split off the unused tail, which stays cached.
+      Block* tail = new Block{
+        block->ptr + size, remaining, stream, false, block, block->next};
+      if (block->next)
+      {
+        block->next->prev = tail;
+      }
+      block->next = tail;
+      block->size = size;
+      large_free.insert(tail);
+      num_cached_bytes += remaining;
+    }
+  }
+  else
+  {
+    char* ptr = static_cast<char*>(raw_alloc_with_retry(size));
+    block = new Block{ptr, size, stream, false, nullptr, nullptr};
+  }
+  block->in_use = true;
+  large_in_use.emplace(block->ptr, block);
+  return block->ptr;
+}
+
+void SizeClassAllocator::free_large(Block* block)
+{
+  block->in_use = false;
+  // Coalesce with free neighbors in the same segment.
+  if (block->prev && !block->prev->in_use)
+  {
+    Block* prev = block->prev;
+    large_free.erase(prev);
+    num_cached_bytes -= prev->size;
+    prev->size += block->size;
+    prev->next = block->next;
+    if (block->next)
+    {
+      block->next->prev = prev;
+    }
+    delete block;
+    block = prev;
+  }
+  if (block->next && !block->next->in_use)
+  {
+    Block* next = block->next;
+    large_free.erase(next);
+    num_cached_bytes -= next->size;
+    block->size += next->size;
+    block->next = next->next;
+    if (next->next)
+    {
+      next->next->prev = block;
+    }
+    delete next;
+  }
+  large_free.insert(block);
+  num_cached_bytes += block->size;
+}
+
+void* SizeClassAllocator::raw_alloc_with_retry(std::size_t size)
+{
+  void* ptr = raw_alloc(size);
+  if (ptr == nullptr)
+  {
+    // Return cached memory and try again.
+    trim_unlocked();
+    ptr = raw_alloc(size);
+    if (ptr == nullptr)
+    {
+      throw H2Exception("Out of memory allocating ", size, " bytes");
+    }
+  }
+  num_reserved_bytes += size;
+  return ptr;
+}
+
+void SizeClassAllocator::trim_unlocked()
+{
+  for (auto& [key, free_list] : small_free)
+  {
+    for (void* ptr : free_list)
+    {
+      raw_free(ptr);
+      num_cached_bytes -= key.second;
+      num_reserved_bytes -= key.second;
+    }
+  }
+  small_free.clear();
+  // Only whole segments (blocks with no neighbors) can be returned.
+  for (auto i = large_free.begin(); i != large_free.end();)
+  {
+    Block* block = *i;
+    if (block->prev == nullptr && block->next == nullptr)
+    {
+      raw_free(block->ptr);
+      num_cached_bytes -= block->size;
+      num_reserved_bytes -= block->size;
+      delete block;
+      i = large_free.erase(i);
+    }
+    else
+    {
+      ++i;
+    }
+  }
+}
+
+}  // namespace internal
+}  // namespace h2
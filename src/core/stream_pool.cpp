@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/stream_pool.hpp"
+
+#include "h2/utils/environment_vars.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace h2
+{
+
+std::size_t get_stream_pool_size()
+{
+  static std::size_t const pool_size = [] {
+    auto const size = env::get<std::size_t>("STREAM_POOL_SIZE");
+    H2_ASSERT_ALWAYS(size > 0, "H2_STREAM_POOL_SIZE must be positive");
+    return size;
+  }();
+  return pool_size;
+}
+
+#ifdef H2_HAS_GPU
+
+namespace
+{
+
+constexpr std::size_t num_priorities = 2;
+
+/** Streams of one priority for one GPU. */
+struct PriorityStreams
+{
+  std::vector<gpu::DeviceStream> streams;
+  /** Next stream to hand out. */
+  std::atomic<std::size_t> next{0};
+};
+
+/** All pool streams for one GPU. */
+struct GPUStreamPool
+{
+  std::once_flag init_flag;
+  PriorityStreams priorities[num_priorities];
+
+  void init()
+  {
+    std::size_t const pool_size = get_stream_pool_size();
+    int const greatest_priority = gpu::stream_priority_range().second;
+    for (std::size_t i = 0; i < pool_size; ++i)
+    {
+      gpu::DeviceStream normal = gpu::make_stream_nonblocking();
+      internal::start_tracking_stream(normal);
+      priorities[static_cast<std::size_t>(StreamPriority::Normal)]
+        .streams.push_back(normal);
+      gpu::DeviceStream high =
+        gpu::make_stream_with_priority(greatest_priority);
+      internal::start_tracking_stream(high);
+      priorities[static_cast<std::size_t>(StreamPriority::High)]
+        .streams.push_back(high);
+    }
+  }
+
+  PriorityStreams& get(StreamPriority priority)
+  {
+    std::call_once(init_flag, [this]() { init(); });
+    auto const idx = static_cast<std::size_t>(priority);
+    H2_ASSERT_DEBUG(
+      idx < num_priorities, "Invalid stream priority ", priority);
+    return priorities[idx];
+  }
+};
+
+GPUStreamPool& get_current_pool()
+{
+  static int const num_gpus = gpu::num_gpus();
+  static std::unique_ptr<GPUStreamPool[]> pools =
+    std::make_unique<GPUStreamPool[]>(num_gpus);
+  int const gpu = gpu::current_gpu();
+  H2_ASSERT_DEBUG(gpu >= 0 && gpu < num_gpus, "Invalid GPU ", gpu);
+  return pools[gpu];
+}
+
+}  // anonymous namespace
+
+namespace internal
+{
+
+ComputeStream get_gpu_pool_stream(StreamPriority priority)
+{
+  PriorityStreams& pool = get_current_pool().get(priority);
+  std::size_t const idx = pool.next.fetch_add(1, std::memory_order_relaxed);
+  return ComputeStream{pool.streams[idx % pool.streams.size()]};
+}
+
+ComputeStream get_gpu_pool_stream(StreamPriority priority, std::size_t idx)
+{
+  PriorityStreams& pool = get_current_pool().get(priority);
+  return ComputeStream{pool.streams[idx % pool.streams.size()]};
+}
+
+}  // namespace internal
+
+#endif  // H2_HAS_GPU
+
+}  // namespace h2
@@ -0,0 +1,581 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/sync.hpp"
+
+#ifdef H2_HAS_GPU
+#include "h2/core/graph.hpp"
+#endif
+
+#include "h2/utils/Error.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace h2
+{
+
+namespace
+{
+
+/** Tasks run in order by a worker thread, backing a CPU stream. */
+class CPUStreamQueue
+{
+public:
+  CPUStreamQueue() : worker([this]() { run(); }) {}
+
+  ~CPUStreamQueue()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    task_cv.notify_one();
+    // The last reference to a queue may be dropped by one of its own
+    // tasks; the worker will exit once it finishes.
+    if (worker.get_id() == std::this_thread::get_id())
+    {
+      worker.detach();
+    }
+    else
+    {
+      worker.join();
+    }
+  }
+
+  /** Enqueue a task, returning its ticket (1 for the first task). */
+  std::uint64_t enqueue(std::function<void()> task)
+  {
+    std::uint64_t ticket;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.push_back(std::move(task));
+      ticket = ++num_enqueued;
+    }
+    task_cv.notify_one();
+    return ticket;
+  }
+
+  /** Return the ticket of the most recently enqueued task. */
+  std::uint64_t get_last_ticket()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return num_enqueued;
+  }
+
+  /** Return whether the task with `ticket` (and all before it) completed. */
+  bool is_complete(std::uint64_t ticket)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return num_completed >= ticket;
+  }
+
+  /** Block until the task with `ticket` (and all before it) completes. */
+  void wait_until(std::uint64_t ticket)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [&]() { return num_completed >= ticket; });
+  }
+
+  /** Rethrow the first exception thrown by a task, if any. */
+  void rethrow()
+  {
+    std::exception_ptr e;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      e = std::exchange(error, nullptr);
+    }
+    if (e)
+    {
+      std::rethrow_exception(e);
+    }
+  }
+
+private:
+  std::mutex mutex;
+  std::condition_variable task_cv;
+  std::condition_variable done_cv;
+  std::deque<std::function<void()>> tasks;
+  std::uint64_t num_enqueued = 0;
+  std::uint64_t num_completed = 0;
+  std::exception_ptr error;
+  bool stopping = false;
+  // Last, so everything else is initialized before the worker starts.
+  std::thread worker;
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+      task_cv.wait(lock, [&]() { return stopping || !tasks.empty(); });
+      if (tasks.empty())
+      {
+        return;  // Stopping, and all work is done.
+      }
+      std::function<void()> task = std::move(tasks.front());
+      tasks.pop_front();
+      lock.unlock();
+      try
+      {
+        task();
+      }
+      catch (...)
+      {
+        lock.lock();
+        if (!error)
+        {
+          error = std::current_exception();
+        }
+        lock.unlock();
+      }
+      // Destroy the task (and anything it captured) without the lock.
+      task = nullptr;
+      lock.lock();
+      ++num_completed;
+      done_cv.notify_all();
+    }
+  }
+};
+
+/** The work recorded by an asynchronous CPU event. */
+struct CPUEventState
+{
+  /** Queue the event was recorded on, or null if complete. */
+  std::shared_ptr<CPUStreamQueue> queue;
+  /** Ticket of the last task recorded. */
+  std::uint64_t ticket = 0;
+};
+
+struct CPUSyncRegistry
+{
+  std::mutex mutex;
+  std::unordered_map<int, std::shared_ptr<CPUStreamQueue>> streams;
+  std::unordered_map<int, CPUEventState> events;
+  int next_stream = 1;
+  int next_event = 1;
+};
+
+CPUSyncRegistry& get_cpu_registry()
+{
+  static CPUSyncRegistry registry;
+  return registry;
+}
+
+std::shared_ptr<CPUStreamQueue> get_cpu_queue(int stream)
+{
+  auto& registry = get_cpu_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto i = registry.streams.find(stream);
+  H2_ASSERT_ALWAYS(
+    i != registry.streams.end(), "Unknown asynchronous CPU stream ", stream);
+  return i->second;
+}
+
+CPUEventState get_cpu_event_state(int event)
+{
+  auto& registry = get_cpu_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto i = registry.events.find(event);
+  H2_ASSERT_ALWAYS(
+    i != registry.events.end(), "Unknown asynchronous CPU event ", event);
+  return i->second;
+}
+
+}  // anonymous namespace
+
+namespace internal
+{
+
+int create_async_cpu_stream()
+{
+  auto queue = std::make_shared<CPUStreamQueue>();
+  auto& registry = get_cpu_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  int const stream = registry.next_stream++;
+  registry.streams.emplace(stream, std::move(queue));
+  return stream;
+}
+
+void destroy_async_cpu_stream(int stream)
+{
+  std::shared_ptr<CPUStreamQueue> queue;
+  {
+    auto& registry = get_cpu_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto i = registry.streams.find(stream);
+    H2_ASSERT_ALWAYS(i != registry.streams.end(),
+                     "Unknown asynchronous CPU stream ",
+                     stream);
+    queue = std::move(i->second);
+    registry.streams.erase(i);
+  }
+  // Events recorded on the stream may keep the queue alive afterward.
+  queue->wait_until(queue->get_last_ticket());
+}
+
+int create_async_cpu_event()
+{
+  auto& registry = get_cpu_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  int const event = registry.next_event++;
+  registry.events.emplace(event, CPUEventState{});
+  return event;
+}
+
+void destroy_async_cpu_event(int event)
+{
+  std::shared_ptr<CPUStreamQueue> queue;  // Released without the lock.
+  auto& registry = get_cpu_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto i = registry.events.find(event);
+  H2_ASSERT_ALWAYS(
+    i != registry.events.end(), "Unknown asynchronous CPU event ", event);
+  queue = std::move(i->second.queue);
+  registry.events.erase(i);
+}
+
+void enqueue_cpu_task(int stream, std::function<void()> task)
+{
+  if (stream == 0)
+  {
+    task();
+    return;
+  }
+  get_cpu_queue(stream)->enqueue(std::move(task));
+}
+
+void record_cpu_event(int event, int stream)
+{
+  CPUEventState state;
+  if (stream != 0)
+  {
+    state.queue = get_cpu_queue(stream);
+    state.ticket = state.queue->get_last_ticket();
+  }
+  auto& registry = get_cpu_registry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto i = registry.events.find(event);
+  H2_ASSERT_ALWAYS(
+    i != registry.events.end(), "Unknown asynchronous CPU event ", event);
+  std::swap(i->second, state);
+}
+
+void wait_for_cpu_event(int event)
+{
+  if (event == 0)
+  {
+    return;
+  }
+  CPUEventState state = get_cpu_event_state(event);
+  if (state.queue)
+  {
+    state.queue->wait_until(state.ticket);
+  }
+}
+
+bool query_cpu_event(int event)
+{
+  if (event == 0)
+  {
+    return true;
+  }
+  CPUEventState state = get_cpu_event_state(event);
+  return !state.queue || state.queue->is_complete(state.ticket);
+}
+
+void wait_for_cpu_stream(int stream, bool rethrow)
+{
+  if (stream == 0)
+  {
+    return;
+  }
+  auto queue = get_cpu_queue(stream);
+  queue->wait_until(queue->get_last_ticket());
+  if (rethrow)
+  {
+    queue->rethrow();
+  }
+}
+
+void cpu_stream_wait_for_cpu_event(int stream, int event)
+{
+  if (event == 0)
+  {
+    return;
+  }
+  CPUEventState state = get_cpu_event_state(event);
+  if (!state.queue)
+  {
+    return;
+  }
+  if (stream == 0)
+  {
+    state.queue->wait_until(state.ticket);
+  }
+  else
+  {
+    // Waiting on work before an earlier point in this stream is a
+    // no-op, so this never deadlocks on itself.
+    get_cpu_queue(stream)->enqueue(
+      [queue = std::move(state.queue), ticket = state.ticket]() {
+        queue->wait_until(ticket);
+      });
+  }
+}
+
+void cpu_stream_wait_for_cpu_stream(int stream, int other)
+{
+  if (stream == other || other == 0)
+  {
+    return;
+  }
+  auto other_queue = get_cpu_queue(other);
+  std::uint64_t const ticket = other_queue->get_last_ticket();
+  if (stream == 0)
+  {
+    other_queue->wait_until(ticket);
+  }
+  else
+  {
+    get_cpu_queue(stream)->enqueue(
+      [other_queue = std::move(other_queue), ticket]() {
+        other_queue->wait_until(ticket);
+      });
+  }
+}
+
+#ifdef H2_HAS_GPU
+
+void cpu_stream_wait_for_gpu_event(int stream, gpu::DeviceEvent event)
+{
+  get_cpu_queue(stream)->enqueue([event]() { gpu::sync(event); });
+}
+
+void cpu_stream_wait_for_gpu_stream(int stream,
+                                    gpu::DeviceStream other,
+                                    int device)
+{
+  // Record the state of the other stream now, as it may have more work
+  // by the time the task runs.
+  gpu::CurrentGPUGuard const guard(device);
+  gpu::DeviceEvent event = get_new_device_event();
+  gpu::record_event(event, other);
+  get_cpu_queue(stream)->enqueue([device, event]() {
+    // The pool checks the current device, which is per-thread.
+    gpu::set_gpu(device);
+    gpu::sync(event);
+    release_device_event(event);
+  });
+}
+
+gpu::DeviceStream get_default_gpu_stream(int device)
+{
+  static int const num_gpus = gpu::num_gpus();
+  static std::vector<std::once_flag> created(num_gpus);
+  static std::vector<gpu::DeviceStream> streams(num_gpus, nullptr);
+  H2_ASSERT_DEBUG(device >= 0 && device < num_gpus, "Invalid GPU ", device);
+  std::call_once(created[device], [device]() {
+    int const selected = gpu::selected_gpu();
+    if (selected < 0 || device == selected)
+    {
+      streams[device] = get_default_compute_stream<Device::GPU>();
+    }
+    else
+    {
+      gpu::CurrentGPUGuard const guard(device);
+      streams[device] = gpu::make_stream();
+    }
+  });
+  return streams[device];
+}
+
+namespace
+{
+
+// Trivially destructible, so this remains valid while other
+// thread-local objects are destroyed at thread exit.
+thread_local std::array<ThreadDefaultGPUStream, max_thread_default_gpus>
+  thread_default_gpu_streams{};
+
+}  // anonymous namespace
+
+ThreadDefaultGPUStream get_thread_default_gpu_stream(int device)
+{
+  if (device < max_thread_default_gpus
+      && thread_default_gpu_streams[device].stream != nullptr)
+  {
+    return thread_default_gpu_streams[device];
+  }
+  return {get_default_gpu_stream(device), nullptr};
+}
+
+ThreadDefaultGPUStream
+exchange_thread_default_gpu_stream(int device, ThreadDefaultGPUStream stream)
+{
+  H2_ASSERT_ALWAYS(device >= 0 && device < max_thread_default_gpus,
+                   "Cannot set a thread default stream for GPU ",
+                   device,
+                   " (at most ",
+                   max_thread_default_gpus,
+                   " GPUs are supported)");
+  return std::exchange(thread_default_gpu_streams[device], stream);
+}
+
+#endif  // H2_HAS_GPU
+
+}  // namespace internal
+
+#ifdef H2_HAS_GPU
+
+namespace
+{
+
+struct StreamTrackerRegistry
+{
+  std::shared_mutex mutex;
+  /** Tracker for each tracked stream. */
+  std::unordered_map<gpu::DeviceStream, internal::StreamTracker*> trackers;
+  /**
+   * Trackers not currently in use.
+   *
+   * Trackers are never freed, as copies of a destroyed ComputeStream
+   * may still refer to them.
+   */
+  std::vector<internal::StreamTracker*> free_trackers;
+  /** Owns all trackers. */
+  std::vector<std::unique_ptr<internal::StreamTracker>> all_trackers;
+};
+
+StreamTrackerRegistry& get_registry()
+{
+  static StreamTrackerRegistry registry;
+  return registry;
+}
+
+// Lets wrapping untracked streams skip the registry when there are no
+// tracked streams.
+std::atomic<int> num_tracked_streams{0};
+
+}  // anonymous namespace
+
+namespace internal
+{
+
+void start_tracking_stream(gpu::DeviceStream stream)
+{
+  auto& registry = get_registry();
+  std::lock_guard<std::shared_mutex> lock(registry.mutex);
+  StreamTracker* tracker;
+  if (registry.free_trackers.empty())
+  {
+    registry.all_trackers.push_back(std::make_unique<StreamTracker>());
+    tracker = registry.all_trackers.back().get();
+  }
+  else
+  {
+    tracker = registry.free_trackers.back();
+    registry.free_trackers.pop_back();
+  }
+  {
+    // Forget waits from the tracker's previous stream. The epoch is
+    // bumped, rather than reset, so stale records of waits on the
+    // previous stream never match.
+    std::lock_guard<std::mutex> tracker_lock(tracker->mutex);
+    tracker->waits.fill({});
+    tracker->next_wait = 0;
+    tracker->epoch.fetch_add(1);
+  }
+  bool const inserted = registry.trackers.emplace(stream, tracker).second;
+  H2_ASSERT_ALWAYS(inserted, "Stream ", stream, " is already tracked");
+  ++num_tracked_streams;
+}
+
+void stop_tracking_stream(gpu::DeviceStream stream)
+{
+  auto& registry = get_registry();
+  std::lock_guard<std::shared_mutex> lock(registry.mutex);
+  auto i = registry.trackers.find(stream);
+  if (i != registry.trackers.end())
+  {
+    registry.free_trackers.push_back(i->second);
+    registry.trackers.erase(i);
+    --num_tracked_streams;
+  }
+}
+
+StreamTracker* find_stream_tracker(gpu::DeviceStream stream)
+{
+  if (num_tracked_streams.load(std::memory_order_relaxed) == 0)
+  {
+    return nullptr;
+  }
+  auto& registry = get_registry();
+  std::shared_lock<std::shared_mutex> lock(registry.mutex);
+  auto i = registry.trackers.find(stream);
+  return (i == registry.trackers.end()) ? nullptr : i->second;
+}
+
+bool stream_wait_is_satisfied(StreamTracker* waiter,
+                              StreamTracker const* src,
+                              std::uint64_t src_epoch)
+{
+  // Waits made before a capture are not part of the captured graph, so
+  // they must be repeated during capture.
+  if (graph_capture_in_progress())
+  {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(waiter->mutex);
+  for (auto const& record : waiter->waits)
+  {
+    if (record.stream == src)
+    {
+      return record.epoch == src_epoch;
+    }
+  }
+  return false;
+}
+
+void record_stream_wait(StreamTracker* waiter,
+                        StreamTracker const* src,
+                        std::uint64_t src_epoch)
+{
+  std::lock_guard<std::mutex> lock(waiter->mutex);
+  for (auto& record : waiter->waits)
+  {
+    if (record.stream == src)
+    {
+      // Epochs only increase, so keep the latest wait.
+      record.epoch = std::max(record.epoch, src_epoch);
+      return;
+    }
+  }
+  waiter->waits[waiter->next_wait] = {src, src_epoch};
+  waiter->next_wait = (waiter->next_wait + 1) % waiter->waits.size();
+}
+
+}  // namespace internal
+
+#endif  // H2_HAS_GPU
+
+}  // namespace h2
@@ -0,0 +1,378 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/thread_pool.hpp"
+
+#include "h2/utils/environment_vars.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace h2
+{
+namespace cpu
+{
+
+namespace
+{
+
+/** One call to `parallel_for`. */
+struct Job
+{
+  void (*invoke)(void*, std::size_t);
+  void* func;
+  /** Number of blocks not yet completed. */
+  std::atomic<std::size_t> remaining;
+  std::mutex error_mutex;
+  std::exception_ptr error;
+};
+
+/** A contiguous range of blocks of a job. */
+struct Task
+{
+  Job* job;
+  std::size_t begin;
+  std::size_t end;
+};
+
+/** Tasks owned by one worker. */
+struct WorkQueue
+{
+  std::mutex mutex;
+  std::deque<Task> tasks;
+};
+
+/** How work is taken from a queue. */
+enum class TakeMode
+{
+  /** The owner takes one block from the back. */
+  Owner,
+  /** A worker takes the back half of the front task. */
+  Steal,
+  /** A thread outside the pool takes one block from the front. */
+  Help
+};
+
+thread_local int worker_id = -1;
+
+class ThreadPool
+{
+public:
+  ThreadPool(std::size_t num_workers) : queues(num_workers)
+  {
+    for (auto& queue : queues)
+    {
+      queue = std::make_unique<WorkQueue>();
+    }
+    workers.reserve(num_workers);
+    for (std::size_t i = 0; i < num_workers; ++i)
+    {
+      workers.emplace_back([this, i]() { run_worker(i); });
+    }
+  }
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(sleep_mutex);
+      stopping = true;
+    }
+    sleep_cv.notify_all();
+    for (auto& worker : workers)
+    {
+      worker.join();
+    }
+  }
+
+  std::size_t num_workers() const noexcept { return workers.size(); }
+
+  void run(Job& job, std::size_t num_blocks)
+  {
+    // Hand everything to one worker (the caller's own queue, if it is
+    // a worker); idle threads will steal from it.
+    std::size_t const target =
+      (worker_id >= 0)
+        ? static_cast<std::size_t>(worker_id)
+        : next_target.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    push(target, {&job, 0, num_blocks}, true);
+
+    // Help until the job is done.
+    while (job.remaining.load(std::memory_order_acquire) > 0)
+    {
+      std::optional<Task> task;
+      if (worker_id >= 0)
+      {
+        task = take_from(worker_id, TakeMode::Owner);
+        if (!task)
+        {
+          task = steal(worker_id, TakeMode::Steal);
+        }
+      }
+      else
+      {
+        task = steal(target, TakeMode::Help);
+      }
+      if (task)
+      {
+        run_task(*task);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(done_mutex);
+      done_cv.wait(lock, [&]() {
+        return job.remaining.load(std::memory_order_acquire) == 0
+               || num_queued.load(std::memory_order_acquire) > 0;
+      });
+    }
+  }
+
+private:
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  std::vector<std::thread> workers;
+  std::atomic<std::size_t> next_target{0};
+
+  /** Number of tasks in all queues. */
+  std::atomic<std::size_t> num_queued{0};
+  std::mutex sleep_mutex;
+  std::condition_variable sleep_cv;
+  bool stopping = false;
+
+  /** Signalled when jobs complete or tasks are queued. */
+  std::mutex done_mutex;
+  std::condition_variable done_cv;
+
+  void push(std::size_t queue, Task task, bool front)
+  {
+    {
+      std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+      if (front)
+      {
+        queues[queue]->tasks.push_front(task);
+      }
+      else
+      {
+        queues[queue]->tasks.push_back(task);
+      }
+      num_queued.fetch_add(1, std::memory_order_release);
+    }
+    {
+      // Lock so sleeping threads do not miss the notification.
+      std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    sleep_cv.notify_all();
+    {
+      std::lock_guard<std::mutex> lock(done_mutex);
+    }
+    done_cv.notify_all();
+  }
+
+  /** Take work from a queue. */
+  std::optional<Task> take_from(std::size_t queue, TakeMode mode)
+  {
+    bool const owner = mode == TakeMode::Owner;
+    std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+    auto& tasks = queues[queue]->tasks;
+    if (tasks.empty())
+    {
+      return std::nullopt;
+    }
+    Task& task = owner ? tasks.back() : tasks.front();
+    std::size_t const size = task.end - task.begin;
+    Task taken = task;
+    if (size == 1)
+    {
+      if (owner)
+      {
+        tasks.pop_back();
+      }
+      else
+      {
+        tasks.pop_front();
+      }
+      num_queued.fetch_sub(1, std::memory_order_release);
+    }
+    else if (owner)
+    {
+      taken.begin = --task.end;
+    }
+    else if (mode == TakeMode::Help)
+    {
+      taken.end = ++task.begin;
+    }
+    else
+    {
+      taken.begin = task.end = task.begin + size / 2;
+    }
+    return taken;
+  }
+
+  /** Take work from any queue, starting with the one after `start`. */
+  std::optional<Task> steal(std::size_t start, TakeMode mode)
+  {
+    for (std::size_t i = 1; i <= queues.size(); ++i)
+    {
+      std::size_t const victim = (start + i) % queues.size();
+      if (auto task = take_from(victim, mode))
+      {
+        return task;
+      }
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Run the first block of a task, adding the rest (of a stolen range)
+   * to the caller's queue so other thieves may take it.
+   *
+   * Only workers take more than one block at a time.
+   */
+  void run_task(Task task)
+  {
+    if (task.end - task.begin > 1)
+    {
+      push(worker_id, {task.job, task.begin + 1, task.end}, false);
+    }
+    run_block(*task.job, task.begin);
+  }
+
+  void run_block(Job& job, std::size_t block)
+  {
+    try
+    {
+      job.invoke(job.func, block);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(job.error_mutex);
+      if (!job.error)
+      {
+        job.error = std::current_exception();
+      }
+    }
+    // The job may be destroyed as soon as this reaches 0.
+    if (job.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+      {
+        std::lock_guard<std::mutex> lock(done_mutex);
+      }
+      done_cv.notify_all();
+    }
+  }
+
+  void run_worker(std::size_t id)
+  {
+    worker_id = static_cast<int>(id);
+    while (true)
+    {
+      std::optional<Task> task = take_from(id, TakeMode::Owner);
+      if (!task)
+      {
+        task = steal(id, TakeMode::Steal);
+      }
+      if (task)
+      {
+        run_task(*task);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleep_mutex);
+      sleep_cv.wait(lock, [&]() {
+        return stopping || num_queued.load(std::memory_order_acquire) > 0;
+      });
+      if (stopping)
+      {
+        return;
+      }
+    }
+  }
+};
+
+ThreadPool& get_pool()
+{
+  static ThreadPool pool(get_num_threads() - 1);
+  return pool;
+}
+
+}  // anonymous namespace
+
+std::size_t get_num_threads()
+{
+  static std::size_t const num_threads = []() -> std::size_t {
+    auto const requested = env::get<std::size_t>("CPU_NUM_THREADS");
+    if (requested > 0)
+    {
+      return requested;
+    }
+    return std::max(std::thread::hardware_concurrency(), 1u);
+  }();
+  return num_threads;
+}
+
+bool in_thread_pool() noexcept
+{
+  return worker_id >= 0;
+}
+
+namespace internal
+{
+
+void parallel_for_impl(std::size_t num_blocks,
+                       void (*invoke)(void*, std::size_t),
+                       void* func)
+{
+  if (num_blocks == 0)
+  {
+    return;
+  }
+  if (num_blocks == 1)
+  {
+    invoke(func, 0);
+    return;
+  }
+  std::exception_ptr error;
+  if (get_num_threads() == 1)
+  {
+    // Run the remaining blocks after an error, as the pool would.
+    for (std::size_t block = 0; block < num_blocks; ++block)
+    {
+      try
+      {
+        invoke(func, block);
+      }
+      catch (...)
+      {
+        if (!error)
+        {
+          error = std::current_exception();
+        }
+      }
+    }
+  }
+  else
+  {
+    Job job{invoke, func, {num_blocks}, {}, nullptr};
+    get_pool().run(job, num_blocks);
+    error = job.error;
+  }
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+}
+
+}  // namespace internal
+
+}  // namespace cpu
+}  // namespace h2
@@ -0,0 +1,784 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/tracer.hpp"
+
+#include "h2/utils/Error.hpp"
+#include "h2/utils/Logger.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#ifdef H2_HAS_GPU
+#include "h2/gpu/runtime.hpp"
+#endif
+
+namespace h2
+{
+
+namespace internal
+{
+
+/** One traced operation. */
+struct TraceRecord
+{
+  char const* name = nullptr;
+  ProfileCategory category = ProfileCategory::Compute;
+  Device device = Device::CPU;
+  /** Raw stream the operation ran on (only used to identify it). */
+  void const* stream = nullptr;
+  std::size_t bytes = 0;
+  std::size_t flops = 0;
+  /** Host times relative to the trace epoch, in nanoseconds. */
+  std::int64_t host_start = 0;
+  std::int64_t host_end = 0;
+  /** Set by the producer when the operation finishes. */
+  std::atomic<bool> done{false};
+#ifdef H2_HAS_GPU
+  int gpu_id = -1;
+  /** Timing events, created when first needed and reused by the slot. */
+  gpu::DeviceEvent start_event = nullptr;
+  gpu::DeviceEvent end_event = nullptr;
+  /** Set for kernel launches (see `gpu::launch_kernel`). */
+  void const* kernel = nullptr;
+  dim3 grid_dim;
+  dim3 block_dim;
+  std::size_t shared_mem = 0;
+#endif
+};
+
+}  // namespace internal
+
+namespace
+{
+
+using internal::TraceRecord;
+
+/**
+ * Single-producer/single-consumer ring of records for one thread.
+ *
+ * The owning thread reserves a slot at `head` when an operation
+ * starts and marks it done when it ends; consumers (serialized by
+ * `get_consumer_mutex`) write done records from `tail` and release
+ * them. Nested operations get distinct slots, and consumers stop at
+ * the first unfinished one, so records are written in start order.
+ */
+struct TraceBuffer
+{
+  TraceBuffer(std::size_t capacity_, std::uint32_t tid_)
+    : records(new TraceRecord[capacity_]), capacity(capacity_), tid(tid_)
+  {}
+
+  // GPU events are not destroyed: buffers outlive the threads that own
+  // them and are only freed at exit, when the GPU runtime may be gone.
+
+  std::unique_ptr<TraceRecord[]> records;
+  std::size_t const capacity;
+  std::uint32_t const tid;
+  std::atomic<std::size_t> head{0};
+  std::atomic<std::size_t> tail{0};
+};
+
+std::atomic<std::size_t> num_dropped{0};
+
+std::mutex& get_registry_mutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+/** All buffers ever created, in thread id order. */
+std::vector<std::shared_ptr<TraceBuffer>>& get_registry()
+{
+  static std::vector<std::shared_ptr<TraceBuffer>> registry;
+  return registry;
+}
+
+std::mutex& get_consumer_mutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+TraceBuffer& get_thread_buffer()
+{
+  thread_local std::shared_ptr<TraceBuffer> buffer = []() {
+    std::lock_guard<std::mutex> lock(get_registry_mutex());
+    auto& registry = get_registry();
+    auto buf = std::make_shared<TraceBuffer>(
+      internal::get_trace_buffer_size(),
+      static_cast<std::uint32_t>(registry.size()));
+    registry.push_back(buf);
+    return buf;
+  }();
+  return *buffer;
+}
+
+std::chrono::steady_clock::time_point get_trace_epoch()
+{
+  static auto const epoch = std::chrono::steady_clock::now();
+  return epoch;
+}
+
+std::int64_t host_now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now() - get_trace_epoch())
+    .count();
+}
+
+#ifdef H2_HAS_GPU
+
+/**
+ * Event recorded on a GPU paired with the host time it completed by,
+ * so GPU event times can be placed on the host timeline.
+ */
+struct GPUTimeBase
+{
+  gpu::DeviceEvent event;
+  std::int64_t host_time;
+};
+
+std::mutex& get_gpu_base_mutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::map<int, GPUTimeBase>& get_gpu_bases()
+{
+  static std::map<int, GPUTimeBase> bases;
+  return bases;
+}
+
+void ensure_gpu_base(int gpu_id, gpu::DeviceStream stream)
+{
+  // Threads usually stay on one GPU, so skip the lock after the first
+  // check.
+  thread_local int last_gpu_id = -1;
+  if (gpu_id == last_gpu_id)
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(get_gpu_base_mutex());
+  auto& bases = get_gpu_bases();
+  if (bases.count(gpu_id) == 0)
+  {
+    GPUTimeBase base;
+    base.event = gpu::make_event();
+    gpu::record_event(base.event, stream);
+    gpu::sync(base.event);
+    base.host_time = host_now();
+    bases.emplace(gpu_id, base);
+  }
+  last_gpu_id = gpu_id;
+}
+
+/** Return the time `event` completed at on the host timeline. */
+std::int64_t gpu_event_time(int gpu_id, gpu::DeviceEvent event)
+{
+  GPUTimeBase base;
+  {
+    std::lock_guard<std::mutex> lock(get_gpu_base_mutex());
+    base = get_gpu_bases().at(gpu_id);
+  }
+  float const ms = gpu::elapsed_time(base.event, event);
+  return base.host_time + static_cast<std::int64_t>(ms * 1e6);
+}
+
+#endif  // H2_HAS_GPU
+
+/**
+ * Return the next slot of this thread's buffer, initialized for an
+ * operation, or null if the buffer is full.
+ *
+ * The slot is not published until `publish_record`.
+ */
+TraceRecord* reserve_record(TraceBuffer& buf,
+                            char const* name,
+                            ProfileCategory category,
+                            std::size_t bytes,
+                            std::size_t flops = 0)
+{
+  std::size_t const head = buf.head.load(std::memory_order_relaxed);
+  if (head - buf.tail.load(std::memory_order_acquire) >= buf.capacity)
+  {
+    num_dropped.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  TraceRecord& record = buf.records[head % buf.capacity];
+  record.name = name;
+  record.category = category;
+  record.device = Device::CPU;
+  record.stream = nullptr;
+  record.bytes = bytes;
+  record.flops = flops;
+#ifdef H2_HAS_GPU
+  record.kernel = nullptr;
+#endif
+  return &record;
+}
+
+#ifdef H2_HAS_GPU
+
+/** Set up `record` for an operation on a GPU stream and start it. */
+void start_gpu_record(TraceRecord& record, gpu::DeviceStream stream)
+{
+  record.device = Device::GPU;
+  record.stream = stream;
+  record.gpu_id = gpu::current_gpu();
+  ensure_gpu_base(record.gpu_id, stream);
+  if (record.start_event == nullptr)
+  {
+    record.start_event = gpu::make_event();
+    record.end_event = gpu::make_event();
+  }
+  gpu::record_event(record.start_event, stream);
+}
+
+#endif  // H2_HAS_GPU
+
+/** Publish the slot reserved for `record` and start its host time. */
+void publish_record(TraceBuffer& buf, TraceRecord& record)
+{
+  // Publish the slot so nested operations take the next one.
+  buf.head.store(buf.head.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+  record.host_start = host_now();
+}
+
+/**
+ * Mark `record` done. For GPU operations, its end event must already
+ * be recorded.
+ */
+void finish_record(TraceRecord& record)
+{
+  record.host_end = host_now();
+  record.done.store(true, std::memory_order_release);
+}
+
+/** Write `str` as a JSON string. */
+void write_json_string(std::ostream& os, char const* str)
+{
+  os << '"';
+  for (; *str != '\0'; ++str)
+  {
+    char const c = *str;
+    switch (c)
+    {
+    case '"': os << "\\\""; break;
+    case '\\': os << "\\\\"; break;
+    case '\n': os << "\\n"; break;
+    case '\t': os << "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20)
+      {
+        char buf[8];
+        std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+        os << buf;
+      }
+      else
+      {
+        os << c;
+      }
+      break;
+    }
+  }
+  os << '"';
+}
+
+/** Write a nanosecond time as microseconds, as Chrome traces expect. */
+void write_us(std::ostream& os, std::int64_t ns)
+{
+  os << ns / 1000 << '.';
+  std::int64_t const frac = (ns < 0 ? -ns : ns) % 1000;
+  os << (frac < 100 ? "0" : "") << (frac < 10 ? "0" : "") << frac;
+}
+
+/** Streams of GPU records, which get their own timeline rows. */
+using GPUStreamTids = std::map<std::pair<int, void const*>, std::uint32_t>;
+
+/** First tid used for GPU streams, so they sort after host threads. */
+constexpr std::uint32_t gpu_stream_tid_base = 1000000;
+
+class TraceWriter
+{
+public:
+  TraceWriter(std::ostream& os_, int pid_) : os(os_), pid(pid_) {}
+
+  void write_event(TraceRecord const& record,
+                   std::uint32_t tid,
+                   std::int64_t start,
+                   std::int64_t end)
+  {
+    begin_event();
+    os << "{\"name\":";
+    write_json_string(os, record.name);
+    os << ",\"cat\":\"" << get_profile_category_name(record.category)
+       << "\",\"ph\":\"X\",\"ts\":";
+    write_us(os, start);
+    os << ",\"dur\":";
+    write_us(os, end > start ? end - start : 0);
+    os << ",\"pid\":" << pid << ",\"tid\":" << tid
+       << ",\"args\":{\"bytes\":" << record.bytes << ",\"stream\":\""
+       << record.stream << '"';
+    if (record.flops != 0)
+    {
+      os << ",\"flops\":" << record.flops;
+    }
+#ifdef H2_HAS_GPU
+    if (record.kernel != nullptr)
+    {
+      os << ",\"kernel\":\"" << record.kernel << "\",\"grid\":["
+         << record.grid_dim.x << ',' << record.grid_dim.y << ','
+         << record.grid_dim.z << "],\"block\":[" << record.block_dim.x << ','
+         << record.block_dim.y << ',' << record.block_dim.z
+         << "],\"shared_mem\":" << record.shared_mem;
+    }
+#endif
+    os << "}}";
+  }
+
+  void write_thread_name(std::uint32_t tid, std::string const& name)
+  {
+    begin_event();
+    os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+       << ",\"tid\":" << tid << ",\"args\":{\"name\":";
+    write_json_string(os, name.c_str());
+    os << "}}";
+  }
+
+  void write_process_name(std::string const& name)
+  {
+    begin_event();
+    os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+       << ",\"args\":{\"name\":";
+    write_json_string(os, name.c_str());
+    os << "}}";
+  }
+
+private:
+  void begin_event()
+  {
+    os << (first ? "\n" : ",\n");
+    first = false;
+  }
+
+  std::ostream& os;
+  int pid;
+  bool first = true;
+};
+
+std::atomic<bool> roofline_enabled{false};
+
+std::mutex& get_roofline_mutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+/** Roofline statistics keyed by operation name and device. */
+using RooflineStatsMap =
+  std::map<std::pair<std::string, Device>, KernelRooflineStats>;
+
+RooflineStatsMap& get_roofline_stats_map()
+{
+  static RooflineStatsMap stats;
+  return stats;
+}
+
+/**
+ * Add a written record to `stats`, taking `ns` nanoseconds on its
+ * device.
+ */
+void add_roofline_record(RooflineStatsMap& stats,
+                         TraceRecord const& record,
+                         std::int64_t ns)
+{
+  auto const key = std::make_pair(std::string(record.name), record.device);
+  auto stats_i = stats.find(key);
+  if (stats_i == stats.end())
+  {
+    KernelRooflineStats s;
+    s.name = record.name;
+    s.device = record.device;
+#ifdef H2_HAS_GPU
+    if (record.device == Device::GPU)
+    {
+      s.peak_bandwidth = gpu::device_properties(record.gpu_id).peak_bandwidth;
+    }
+#endif
+    stats_i = stats.emplace(key, std::move(s)).first;
+  }
+  KernelRooflineStats& s = stats_i->second;
+  ++s.num_calls;
+  s.bytes += record.bytes;
+  s.flops += record.flops;
+  s.time += (ns > 0 ? ns : 0) * 1e-9;
+}
+
+/** Flush the trace and log the roofline report; used at exit. */
+void flush_trace_and_report()
+{
+  flush_trace();
+  if (!roofline_enabled.load(std::memory_order_relaxed))
+  {
+    return;
+  }
+  static h2::Logger logger("h2_roofline");
+  std::ostringstream ss;
+  write_roofline_report(ss);
+  logger.get().info(ss.str());
+}
+
+int get_trace_pid()
+{
+  std::string const rank = expand_rank_pattern("%w");
+  return (rank == "?") ? 0 : std::stoi(rank);
+}
+
+/**
+ * Write done records of all buffers and release them.
+ *
+ * Returns the number of records written.
+ */
+std::size_t write_trace_impl(std::ostream& os)
+{
+  std::lock_guard<std::mutex> consumer_lock(get_consumer_mutex());
+  std::vector<std::shared_ptr<TraceBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lock(get_registry_mutex());
+    buffers = get_registry();
+  }
+
+  int const pid = get_trace_pid();
+  TraceWriter writer(os, pid);
+  GPUStreamTids gpu_stream_tids;
+  std::size_t num_written = 0;
+  bool const gather_roofline =
+    roofline_enabled.load(std::memory_order_relaxed);
+  // Gather into a local map so the lock is not held while waiting for
+  // GPU events.
+  RooflineStatsMap roofline_stats;
+
+  os << "{\"traceEvents\":[";
+  writer.write_process_name(
+    "h2 rank " + expand_rank_pattern("%w") + " (" + expand_rank_pattern("%h")
+    + ")");
+  for (auto const& buf : buffers)
+  {
+    std::size_t tail = buf->tail.load(std::memory_order_relaxed);
+    std::size_t const head = buf->head.load(std::memory_order_acquire);
+    bool wrote_thread = false;
+    for (; tail != head; ++tail)
+    {
+      TraceRecord& record = buf->records[tail % buf->capacity];
+      if (!record.done.load(std::memory_order_acquire))
+      {
+        break;
+      }
+      if (!wrote_thread)
+      {
+        writer.write_thread_name(buf->tid,
+                                 "host thread " + std::to_string(buf->tid));
+        wrote_thread = true;
+      }
+      writer.write_event(
+        record, buf->tid, record.host_start, record.host_end);
+      if (gather_roofline && record.device == Device::CPU)
+      {
+        add_roofline_record(
+          roofline_stats, record, record.host_end - record.host_start);
+      }
+#ifdef H2_HAS_GPU
+      if (record.device == Device::GPU)
+      {
+        auto const key = std::make_pair(record.gpu_id, record.stream);
+        auto tid_i = gpu_stream_tids.find(key);
+        if (tid_i == gpu_stream_tids.end())
+        {
+          std::uint32_t const tid =
+            gpu_stream_tid_base
+            + static_cast<std::uint32_t>(gpu_stream_tids.size());
+          tid_i = gpu_stream_tids.emplace(key, tid).first;
+          std::ostringstream ss;
+          ss << "GPU " << record.gpu_id << " stream " << record.stream;
+          writer.write_thread_name(tid, ss.str());
+        }
+        gpu::sync(record.end_event);
+        std::int64_t const start =
+          gpu_event_time(record.gpu_id, record.start_event);
+        std::int64_t const end =
+          gpu_event_time(record.gpu_id, record.end_event);
+        writer.write_event(record, tid_i->second, start, end);
+        if (gather_roofline)
+        {
+          add_roofline_record(roofline_stats, record, end - start);
+        }
+      }
+#endif
+      record.done.store(false, std::memory_order_relaxed);
+      ++num_written;
+    }
+    buf->tail.store(tail, std::memory_order_release);
+  }
+  if (!roofline_stats.empty())
+  {
+    std::lock_guard<std::mutex> lock(get_roofline_mutex());
+    auto& stats = get_roofline_stats_map();
+    for (auto& new_s : roofline_stats)
+    {
+      auto stats_i = stats.find(new_s.first);
+      if (stats_i == stats.end())
+      {
+        stats.emplace(new_s.first, std::move(new_s.second));
+        continue;
+      }
+      stats_i->second.num_calls += new_s.second.num_calls;
+      stats_i->second.bytes += new_s.second.bytes;
+      stats_i->second.flops += new_s.second.flops;
+      stats_i->second.time += new_s.second.time;
+    }
+  }
+  os << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_records\":"
+     << num_dropped.load(std::memory_order_relaxed) << "}}\n";
+  return num_written;
+}
+
+}  // anonymous namespace
+
+namespace internal
+{
+
+bool check_tracing_enabled()
+{
+  bool const enabled = env::get<bool>("TRACE");
+  if (enabled)
+  {
+    // Create the statics the exit handler uses first so they outlive
+    // it.
+    get_trace_epoch();
+    get_registry();
+    get_consumer_mutex();
+#ifdef H2_HAS_GPU
+    get_gpu_bases();
+#endif
+    if (env::get<bool>("TRACE_ROOFLINE"))
+    {
+      roofline_enabled.store(true, std::memory_order_relaxed);
+      get_roofline_stats_map();
+      get_roofline_mutex();
+    }
+    std::atexit(flush_trace_and_report);
+  }
+  return enabled;
+}
+
+std::size_t get_trace_buffer_size()
+{
+  static std::size_t const size = []() {
+    auto const s = env::get<std::size_t>("TRACE_BUFFER_SIZE");
+    H2_ASSERT_ALWAYS(s > 0, "H2_TRACE_BUFFER_SIZE must be positive");
+    return s;
+  }();
+  return size;
+}
+
+TraceRecord* trace_begin(char const* name,
+                         ProfileCategory category,
+                         ComputeStream const& stream,
+                         std::size_t bytes,
+                         std::size_t flops)
+{
+  TraceBuffer& buf = get_thread_buffer();
+  TraceRecord* const record =
+    reserve_record(buf, name, category, bytes, flops);
+  if (record == nullptr)
+  {
+    return nullptr;
+  }
+#ifdef H2_HAS_GPU
+  if (stream.get_device() == Device::GPU)
+  {
+    start_gpu_record(*record, stream.get_stream<Device::GPU>());
+  }
+#endif
+  publish_record(buf, *record);
+  return record;
+}
+
+void trace_end(TraceRecord* record, ComputeStream const& stream)
+{
+#ifdef H2_HAS_GPU
+  if (record->device == Device::GPU)
+  {
+    gpu::record_event(record->end_event, stream.get_stream<Device::GPU>());
+  }
+#else
+  static_cast<void>(stream);
+#endif
+  finish_record(*record);
+}
+
+}  // namespace internal
+
+#ifdef H2_HAS_GPU
+
+bool gpu::internal::tracing_kernel_launches()
+{
+  return tracing_enabled();
+}
+
+void* gpu::internal::trace_kernel_launch_begin(void const* kernel,
+                                               dim3 const& grid_dim,
+                                               dim3 const& block_dim,
+                                               std::size_t shared_mem,
+                                               DeviceStream stream)
+{
+  TraceBuffer& buf = get_thread_buffer();
+  TraceRecord* const record =
+    reserve_record(buf, "launch_kernel", ProfileCategory::Compute, 0);
+  if (record == nullptr)
+  {
+    return nullptr;
+  }
+  start_gpu_record(*record, stream);
+  record->kernel = kernel;
+  record->grid_dim = grid_dim;
+  record->block_dim = block_dim;
+  record->shared_mem = shared_mem;
+  publish_record(buf, *record);
+  return record;
+}
+
+void gpu::internal::trace_kernel_launch_end(void* record, DeviceStream stream)
+{
+  auto* const trace_record = static_cast<TraceRecord*>(record);
+  gpu::record_event(trace_record->end_event, stream);
+  finish_record(*trace_record);
+}
+
+#endif  // H2_HAS_GPU
+
+void write_trace(std::ostream& os)
+{
+  write_trace_impl(os);
+}
+
+void flush_trace()
+{
+  static std::atomic<std::size_t> num_flushes{0};
+  std::ostringstream ss;
+  if (write_trace_impl(ss) == 0)
+  {
+    return;
+  }
+  std::string file_name = expand_rank_pattern(env::get_raw("TRACE_FILE"));
+  std::size_t const flush_num = num_flushes.fetch_add(1);
+  if (flush_num > 0)
+  {
+    // Insert the sequence number before the extension, if any.
+    std::string const seq = "." + std::to_string(flush_num);
+    auto const dot = file_name.rfind('.');
+    auto const slash = file_name.rfind('/');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+    {
+      file_name.insert(dot, seq);
+    }
+    else
+    {
+      file_name += seq;
+    }
+  }
+  std::ofstream file(file_name);
+  H2_ASSERT_ALWAYS(file, "Could not open trace file ", file_name);
+  file << ss.str();
+}
+
+std::size_t get_num_dropped_trace_records()
+{
+  return num_dropped.load(std::memory_order_relaxed);
+}
+
+std::vector<KernelRooflineStats> get_roofline_stats()
+{
+  std::vector<KernelRooflineStats> stats;
+  {
+    std::lock_guard<std::mutex> lock(get_roofline_mutex());
+    for (auto const& s : get_roofline_stats_map())
+    {
+      stats.push_back(s.second);
+    }
+  }
+  std::stable_sort(stats.begin(),
+                   stats.end(),
+                   [](KernelRooflineStats const& a,
+                      KernelRooflineStats const& b) { return a.time > b.time; });
+  return stats;
+}
+
+void write_roofline_report(std::ostream& os)
+{
+  auto const stats = get_roofline_stats();
+  std::ios_base::fmtflags const flags = os.flags();
+  std::streamsize const precision = os.precision();
+  os << "Roofline statistics of " << stats.size() << " operations:\n"
+     << std::left << std::setw(40) << "name" << std::right << std::setw(5)
+     << "dev" << std::setw(10) << "calls" << std::setw(12) << "time (ms)"
+     << std::setw(12) << "GB/s" << std::setw(10) << "% peak"
+     << std::setw(12) << "GFLOP/s" << std::setw(10) << "FLOP/B" << '\n'
+     << std::fixed;
+  for (auto const& s : stats)
+  {
+    os << std::left << std::setw(40) << s.name << std::right << std::setw(5)
+       << s.device << std::setw(10) << s.num_calls << std::setprecision(3)
+       << std::setw(12) << s.time * 1e3 << std::setw(12)
+       << s.achieved_bandwidth() * 1e-9 << std::setprecision(1)
+       << std::setw(10);
+    if (s.peak_bandwidth > 0.0)
+    {
+      os << s.fraction_of_peak() * 100;
+    }
+    else
+    {
+      os << "-";
+    }
+    os << std::setprecision(3) << std::setw(12)
+       << (s.time > 0.0 ? s.flops / s.time * 1e-9 : 0.0) << std::setw(10)
+       << s.arithmetic_intensity() << '\n';
+  }
+  os.flags(flags);
+  os.precision(precision);
+}
+
+void clear_roofline_stats()
+{
+  std::lock_guard<std::mutex> lock(get_roofline_mutex());
+  get_roofline_stats_map().clear();
+}
+
+void enable_roofline_stats()
+{
+  roofline_enabled.store(true, std::memory_order_relaxed);
+}
+
+}  // namespace h2
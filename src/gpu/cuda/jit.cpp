@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../jit_backend.hpp"
+
+#include "h2/gpu/logger.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <string>
+#include <vector>
+
+#include <cuda.h>
+#include <nvrtc.h>
+
+namespace h2
+{
+namespace gpu
+{
+namespace jit_backend
+{
+
+namespace
+{
+
+void check_nvrtc(nvrtcResult status, char const* what)
+{
+  if (status != NVRTC_SUCCESS)
+  {
+    throw H2FatalException(what, " failed: ", nvrtcGetErrorString(status));
+  }
+}
+
+void check_cu(CUresult status, char const* what)
+{
+  if (status != CUDA_SUCCESS)
+  {
+    char const* msg = nullptr;
+    cuGetErrorString(status, &msg);
+    throw H2FatalException(what, " failed: ", msg ? msg : "unknown error");
+  }
+}
+
+/** Destroy an NVRTC program when leaving scope. */
+struct ProgramGuard
+{
+  nvrtcProgram prog;
+  ~ProgramGuard() { nvrtcDestroyProgram(&prog); }
+};
+
+}  // anonymous namespace
+
+std::string get_arch()
+{
+  int major = 0, minor = 0;
+  int const dev = current_gpu();
+  H2_CHECK_CUDA(
+    cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor, dev));
+  H2_CHECK_CUDA(
+    cudaDeviceGetAttribute(&minor, cudaDevAttrComputeCapabilityMinor, dev));
+  return "sm_" + std::to_string(major) + std::to_string(minor);
+}
+
+std::string get_compiler_version()
+{
+  int major = 0, minor = 0;
+  check_nvrtc(nvrtcVersion(&major, &minor), "nvrtcVersion");
+  return "nvrtc" + std::to_string(major) + "." + std::to_string(minor);
+}
+
+std::string compile(std::string const& source, std::string const& name)
+{
+  H2_GPU_DEBUG("Compiling JIT kernel {}", name);
+  ProgramGuard guard;
+  check_nvrtc(nvrtcCreateProgram(&guard.prog,
+                                 source.c_str(),
+                                 (name + ".cu").c_str(),
+                                 0,
+                                 nullptr,
+                                 nullptr),
+              "nvrtcCreateProgram");
+  // Compile to a binary for this GPU rather than PTX, so nothing needs
+  // to be compiled when loading from the cache.
+  std::string const arch_opt = "--gpu-architecture=" + get_arch();
+  std::vector<char const*> const opts = {
+    arch_opt.c_str(), "--std=c++17", "--use_fast_math"};
+  nvrtcResult const status = nvrtcCompileProgram(
+    guard.prog, static_cast<int>(opts.size()), opts.data());
+  if (status != NVRTC_SUCCESS)
+  {
+    std::size_t log_size = 0;
+    nvrtcGetProgramLogSize(guard.prog, &log_size);
+    std::string log(log_size, '\0');
+    nvrtcGetProgramLog(guard.prog, log.data());
+    throw H2FatalException("Compiling JIT kernel ",
+                           name,
+                           " failed: ",
+                           nvrtcGetErrorString(status),
+                           "\n",
+                           log);
+  }
+  std::size_t binary_size = 0;
+  check_nvrtc(nvrtcGetCUBINSize(guard.prog, &binary_size),
+              "nvrtcGetCUBINSize");
+  std::string binary(binary_size, '\0');
+  check_nvrtc(nvrtcGetCUBIN(guard.prog, binary.data()), "nvrtcGetCUBIN");
+  return binary;
+}
+
+void* load_module(std::string const& binary)
+{
+  // Make sure the GPU's primary context is current for the driver API.
+  ensure_runtime_active();
+  H2_CHECK_CUDA(cudaFree(nullptr));
+  CUmodule module;
+  check_cu(cuModuleLoadData(&module, binary.data()), "cuModuleLoadData");
+  return module;
+}
+
+void unload_module(void* module) noexcept
+{
+  cuModuleUnload(static_cast<CUmodule>(module));
+}
+
+void* get_function(void* module, std::string const& name)
+{
+  CUfunction function;
+  check_cu(cuModuleGetFunction(
+             &function, static_cast<CUmodule>(module), name.c_str()),
+           "cuModuleGetFunction");
+  return function;
+}
+
+void launch(void* function,
+            unsigned int num_blocks,
+            unsigned int block_size,
+            DeviceStream stream,
+            void** args)
+{
+  check_cu(cuLaunchKernel(static_cast<CUfunction>(function),
+                          num_blocks,
+                          1,
+                          1,
+                          block_size,
+                          1,
+                          1,
+                          0,
+                          stream,
+                          args,
+                          nullptr),
+           "cuLaunchKernel");
+}
+
+}  // namespace jit_backend
+}  // namespace gpu
+}  // namespace h2
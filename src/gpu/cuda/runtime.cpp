@@ -7,11 +7,15 @@
 
 #include "h2/gpu/runtime.hpp"
 
+#include "h2/gpu/event_pool.hpp"
 #include "h2/gpu/logger.hpp"
 
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>  // FIXME: Eventually, Logger.hpp
+#include <string>
 
 #include <cuda_runtime.h>
 
@@ -183,11 +187,6 @@ static int get_reasonable_default_gpu_id() noexcept
   return -1;
 }
 
-static void set_reasonable_default_gpu()
-{
-  h2::gpu::set_gpu(get_reasonable_default_gpu_id());
-}
-
 }  // namespace
 
 int h2::gpu::num_gpus()
@@ -215,10 +214,15 @@ void h2::gpu::init_runtime()
   if (initialized_)
     return;
 
+  auto const start = std::chrono::steady_clock::now();
   H2_GPU_TRACE("initializing gpu runtime");
   H2_GPU_TRACE("found {} devices", num_gpus());
-  set_reasonable_default_gpu();
+  int const gpu_id = get_reasonable_default_gpu_id();
   initialized_ = true;
+  internal::start_runtime(
+    gpu_id,
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+      .count());
 }
 
 void h2::gpu::finalize_runtime()
@@ -227,6 +231,8 @@ void h2::gpu::finalize_runtime()
     return;
 
   H2_GPU_TRACE("finalizing gpu runtime");
+  clear_event_pools();
+  internal::stop_runtime();
   initialized_ = false;
 }
 
@@ -246,8 +252,42 @@ bool h2::gpu::is_integrated()
   return false;
 }
 
+h2::gpu::DeviceProperties h2::gpu::internal::query_device_properties(int gpu_id)
+{
+  cudaDeviceProp props;
+  H2_CHECK_CUDA(cudaGetDeviceProperties(&props, gpu_id));
+  // The memory clock is not in cudaDeviceProp in newer CUDA versions.
+  int mem_clock_khz = 0, mem_bus_width = 0;
+  H2_CHECK_CUDA(cudaDeviceGetAttribute(
+    &mem_clock_khz, cudaDevAttrMemoryClockRate, gpu_id));
+  H2_CHECK_CUDA(cudaDeviceGetAttribute(
+    &mem_bus_width, cudaDevAttrGlobalMemoryBusWidth, gpu_id));
+
+  DeviceProperties dev_props;
+  dev_props.name = props.name;
+  dev_props.num_sms = props.multiProcessorCount;
+  dev_props.warp_size = props.warpSize;
+  dev_props.l2_cache_size = static_cast<std::size_t>(props.l2CacheSize);
+  dev_props.shared_mem_per_block = props.sharedMemPerBlock;
+  dev_props.total_mem = props.totalGlobalMem;
+  // Double data rate, and the bus width is in bits.
+  dev_props.peak_bandwidth =
+    2.0 * mem_clock_khz * 1000.0 * (mem_bus_width / 8.0);
+  dev_props.integrated = props.integrated != 0;
+  char bus_id[32];
+  std::snprintf(bus_id,
+                sizeof(bus_id),
+                "%04x:%02x:%02x.0",
+                props.pciDomainID,
+                props.pciBusID,
+                props.pciDeviceID);
+  dev_props.pci_bus_id = bus_id;
+  return dev_props;
+}
+
 cudaStream_t h2::gpu::make_stream()
 {
+  ensure_runtime_active();
   cudaStream_t stream;
   H2_CHECK_CUDA(cudaStreamCreate(&stream));
   H2_GPU_TRACE("created stream {}", (void*) stream);
@@ -256,12 +296,30 @@ cudaStream_t h2::gpu::make_stream()
 
 cudaStream_t h2::gpu::make_stream_nonblocking()
 {
+  ensure_runtime_active();
   cudaStream_t stream;
   H2_CHECK_CUDA(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
   H2_GPU_TRACE("created non-blocking stream {}", (void*) stream);
   return stream;
 }
 
+cudaStream_t h2::gpu::make_stream_with_priority(int priority)
+{
+  ensure_runtime_active();
+  cudaStream_t stream;
+  H2_CHECK_CUDA(
+    cudaStreamCreateWithPriority(&stream, cudaStreamNonBlocking, priority));
+  H2_GPU_TRACE("created stream {} with priority {}", (void*) stream, priority);
+  return stream;
+}
+
+std::pair<int, int> h2::gpu::stream_priority_range()
+{
+  int least, greatest;
+  H2_CHECK_CUDA(cudaDeviceGetStreamPriorityRange(&least, &greatest));
+  return {least, greatest};
+}
+
 void h2::gpu::destroy(cudaStream_t const stream)
 {
   H2_GPU_TRACE("destroy stream {}", (void*) stream);
@@ -320,3 +378,71 @@ void h2::gpu::sync(cudaStream_t stream, cudaEvent_t event)
   H2_GPU_TRACE("stream {} waiting for event {}", (void*) stream, (void*) event);
   H2_CHECK_CUDA(cudaStreamWaitEvent(stream, event, 0));
 }
+
+bool h2::gpu::query(cudaEvent_t event)
+{
+  cudaError_t const status = cudaEventQuery(event);
+  if (status == cudaErrorNotReady)
+  {
+    // Clear the sticky "error".
+    (void) cudaGetLastError();
+    return false;
+  }
+  H2_CHECK_CUDA(status);
+  return true;
+}
+
+float h2::gpu::elapsed_time(cudaEvent_t start, cudaEvent_t end)
+{
+  float ms;
+  H2_CHECK_CUDA(cudaEventElapsedTime(&ms, start, end));
+  return ms;
+}
+
+void h2::gpu::begin_capture(cudaStream_t stream)
+{
+  H2_GPU_TRACE("begin capture on stream {}", (void*) stream);
+  H2_CHECK_CUDA(cudaStreamBeginCapture(stream, cudaStreamCaptureModeRelaxed));
+}
+
+cudaGraph_t h2::gpu::end_capture(cudaStream_t stream)
+{
+  H2_GPU_TRACE("end capture on stream {}", (void*) stream);
+  cudaGraph_t graph;
+  H2_CHECK_CUDA(cudaStreamEndCapture(stream, &graph));
+  return graph;
+}
+
+bool h2::gpu::is_capturing(cudaStream_t stream)
+{
+  cudaStreamCaptureStatus status;
+  H2_CHECK_CUDA(cudaStreamIsCapturing(stream, &status));
+  return status != cudaStreamCaptureStatusNone;
+}
+
+cudaGraphExec_t h2::gpu::instantiate(cudaGraph_t graph)
+{
+  cudaGraphExec_t graph_exec;
+  H2_CHECK_CUDA(cudaGraphInstantiateWithFlags(&graph_exec, graph, 0));
+  H2_GPU_TRACE(
+    "instantiated graph {} as {}", (void*) graph, (void*) graph_exec);
+  return graph_exec;
+}
+
+void h2::gpu::launch_graph(cudaGraphExec_t graph, cudaStream_t stream)
+{
+  H2_GPU_TRACE("launch graph {} on stream {}", (void*) graph, (void*) stream);
+  H2_CHECK_CUDA(cudaGraphLaunch(graph, stream));
+}
+
+void h2::gpu::destroy(cudaGraph_t graph)
+{
+  H2_GPU_TRACE("destroy graph {}", (void*) graph);
+  H2_CHECK_CUDA(cudaGraphDestroy(graph));
+}
+
+void h2::gpu::destroy(cudaGraphExec_t graph)
+{
+  H2_GPU_TRACE("destroy executable graph {}", (void*) graph);
+  H2_CHECK_CUDA(cudaGraphExecDestroy(graph));
+}
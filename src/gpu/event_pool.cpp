@@ -0,0 +1,153 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/gpu/event_pool.hpp"
+
+#include "h2_config.hpp"
+
+#include "h2/utils/Error.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+
+/**
+ * Idle events for one GPU.
+ *
+ * Each slot holds either an event or null; slots are claimed and
+ * filled with single atomic operations, so there is no ABA problem.
+ * Searches start from a hint near the last used slot, so they
+ * usually succeed immediately.
+ */
+struct EventPool
+{
+  static constexpr std::size_t capacity = 64;
+
+  std::array<std::atomic<h2::gpu::DeviceEvent>, capacity> slots{};
+  std::atomic<std::size_t> hint{0};
+
+  h2::gpu::DeviceEvent get()
+  {
+    std::size_t const start = hint.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < capacity; ++i)
+    {
+      std::size_t const slot = (start + capacity - i) % capacity;
+      if (slots[slot].load(std::memory_order_relaxed) == nullptr)
+      {
+        continue;
+      }
+      h2::gpu::DeviceEvent event =
+        slots[slot].exchange(nullptr, std::memory_order_acquire);
+      if (event != nullptr)
+      {
+        hint.store((slot + capacity - 1) % capacity,
+                   std::memory_order_relaxed);
+        return event;
+      }
+    }
+    return h2::gpu::make_event_notiming();
+  }
+
+  void release(h2::gpu::DeviceEvent event)
+  {
+    std::size_t const start = hint.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < capacity; ++i)
+    {
+      std::size_t const slot = (start + 1 + i) % capacity;
+      h2::gpu::DeviceEvent expected = nullptr;
+      if (slots[slot].compare_exchange_strong(
+            expected, event, std::memory_order_release))
+      {
+        hint.store(slot, std::memory_order_relaxed);
+        return;
+      }
+    }
+    h2::gpu::destroy(event);
+  }
+
+  void clear()
+  {
+    for (auto& slot : slots)
+    {
+      h2::gpu::DeviceEvent event = slot.exchange(nullptr);
+      if (event != nullptr)
+      {
+        h2::gpu::destroy(event);
+      }
+    }
+  }
+
+  std::size_t size() const
+  {
+    std::size_t n = 0;
+    for (auto const& slot : slots)
+    {
+      n += slot.load(std::memory_order_relaxed) != nullptr;
+    }
+    return n;
+  }
+};
+
+struct EventPools
+{
+  EventPools()
+    : num_pools(h2::gpu::num_gpus()),
+      pools(std::make_unique<EventPool[]>(num_pools))
+  {}
+
+  EventPool& get(int gpu)
+  {
+    H2_ASSERT_DEBUG(gpu >= 0 && gpu < num_pools, "Invalid GPU ", gpu);
+    return pools[gpu];
+  }
+
+  int num_pools;
+  std::unique_ptr<EventPool[]> pools;
+};
+
+EventPools& get_pools()
+{
+  static EventPools pools;
+  return pools;
+}
+
+}  // anonymous namespace
+
+namespace h2
+{
+namespace gpu
+{
+
+DeviceEvent get_pooled_event()
+{
+  return get_pools().get(current_gpu()).get();
+}
+
+void release_pooled_event(DeviceEvent event)
+{
+  get_pools().get(current_gpu()).release(event);
+}
+
+void clear_event_pools()
+{
+  auto& pools = get_pools();
+  for (int i = 0; i < pools.num_pools; ++i)
+  {
+    pools.pools[i].clear();
+  }
+}
+
+std::size_t num_pooled_events()
+{
+  return get_pools().get(current_gpu()).size();
+}
+
+}  // namespace gpu
+}  // namespace h2
@@ -0,0 +1,463 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/gpu/jit.hpp"
+
+#include "h2/gpu/logger.hpp"
+#include "h2/utils/Error.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include "jit_backend.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+#include <unistd.h>
+
+namespace h2
+{
+namespace gpu
+{
+
+namespace
+{
+
+struct JitTypeInfo
+{
+  char const* name;
+  std::size_t size;
+};
+
+constexpr JitTypeInfo jit_types[] = {
+  {"float", sizeof(float)},
+  {"double", sizeof(double)},
+  {"bool", sizeof(bool)},
+  {"int8_t", sizeof(std::int8_t)},
+  {"uint8_t", sizeof(std::uint8_t)},
+  {"int16_t", sizeof(std::int16_t)},
+  {"uint16_t", sizeof(std::uint16_t)},
+  {"int32_t", sizeof(std::int32_t)},
+  {"uint32_t", sizeof(std::uint32_t)},
+  {"int64_t", sizeof(std::int64_t)},
+  {"uint64_t", sizeof(std::uint64_t)},
+};
+
+/**
+ * Definitions of the fixed-width integer types, as runtime compilers
+ * do not provide the standard headers.
+ */
+constexpr char const* jit_prologue = R"(typedef signed char int8_t;
+typedef unsigned char uint8_t;
+typedef short int16_t;
+typedef unsigned short uint16_t;
+typedef int int32_t;
+typedef unsigned int uint32_t;
+typedef long long int64_t;
+typedef unsigned long long uint64_t;
+
+namespace h2_jit
+{
+
+template <typename T, int W>
+struct alignas(sizeof(T) * W) Vec
+{
+  T v[W];
+};
+
+}  // namespace h2_jit
+)";
+
+bool is_identifier(std::string const& name)
+{
+  if (name.empty()
+      || !(std::isalpha(static_cast<unsigned char>(name[0])) || name[0] == '_'))
+  {
+    return false;
+  }
+  return std::all_of(name.begin(), name.end(), [](unsigned char c) {
+    return std::isalnum(c) || c == '_';
+  });
+}
+
+std::string get_kernel_name(std::string const& op_name, std::size_t vec_width)
+{
+  return "h2_jit_" + op_name + "_vec" + std::to_string(vec_width);
+}
+
+/** 64-bit FNV-1a hash. */
+std::uint64_t hash_string(std::string const& str)
+{
+  std::uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : str)
+  {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+std::string const& get_cache_dir()
+{
+  static std::string const path = env::get_raw("GPU_JIT_CACHE_PATH");
+  return path;
+}
+
+std::string get_cache_file(JitElementwiseOp const& op,
+                           std::string const& source,
+                           std::string const& arch)
+{
+  char hash[17];
+  std::snprintf(
+    hash,
+    sizeof(hash),
+    "%016llx",
+    static_cast<unsigned long long>(hash_string(
+      source + '\n' + arch + '\n' + jit_backend::get_compiler_version())));
+  return get_cache_dir() + "/h2_jit_" + op.name + "_" + arch + "_" + hash
+         + ".bin";
+}
+
+/** Return the cached binary in `path`, or an empty string. */
+std::string read_cached_binary(std::string const& path)
+{
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+  {
+    return "";
+  }
+  return std::string(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+}
+
+void write_cached_binary(std::string const& path, std::string const& binary)
+{
+  // Write to a temporary and rename it, so concurrent processes never
+  // see a partial binary.
+  std::string const tmp_path = path + ".tmp." + std::to_string(::getpid());
+  {
+    std::ofstream out(tmp_path, std::ios::binary);
+    out.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+    if (!out)
+    {
+      H2_GPU_WARN("Could not write JIT kernel cache file {}", tmp_path);
+      std::remove(tmp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+  {
+    H2_GPU_WARN("Could not write JIT kernel cache file {}", path);
+    std::remove(tmp_path.c_str());
+  }
+}
+
+std::string get_binary(JitElementwiseOp const& op, std::string const& source)
+{
+  if (get_cache_dir().empty())
+  {
+    return jit_backend::compile(source, op.name);
+  }
+  std::string const path =
+    get_cache_file(op, source, jit_backend::get_arch());
+  std::string binary = read_cached_binary(path);
+  if (!binary.empty())
+  {
+    H2_GPU_DEBUG("Loaded JIT kernel {} from {}", op.name, path);
+    return binary;
+  }
+  binary = jit_backend::compile(source, op.name);
+  write_cached_binary(path, binary);
+  return binary;
+}
+
+struct JitCache
+{
+  std::mutex mutex;
+  /** Kernels, keyed by GPU and source. */
+  std::unordered_map<std::string, std::unique_ptr<JitElementwiseKernel>>
+    kernels;
+};
+
+JitCache& get_cache()
+{
+  static JitCache cache;
+  return cache;
+}
+
+}  // anonymous namespace
+
+std::size_t jit_type_size(std::string const& type)
+{
+  for (auto const& info : jit_types)
+  {
+    if (type == info.name)
+    {
+      return info.size;
+    }
+  }
+  throw H2Exception("Type ", type, " is not supported in JIT kernels");
+}
+
+std::string make_jit_elementwise_source(JitElementwiseOp const& op)
+{
+  H2_ASSERT_ALWAYS(is_identifier(op.name),
+                   "JIT operation name '",
+                   op.name,
+                   "' is not a valid identifier");
+  // Validate the types.
+  jit_type_size(op.out_type);
+  for (auto const& type : op.in_types)
+  {
+    jit_type_size(type);
+  }
+  std::size_t const num_ins = op.in_types.size();
+  auto const in_name = [](std::size_t i) { return "in" + std::to_string(i); };
+
+  std::ostringstream src;
+  src << "// Element-wise operation " << op.name << ".\n"
+      << jit_prologue << '\n'
+      << op.preamble << '\n';
+
+  // The operation.
+  src << "__device__ __forceinline__ " << op.out_type << " h2_jit_op(";
+  for (std::size_t i = 0; i < num_ins; ++i)
+  {
+    src << (i ? ", " : "") << op.in_types[i] << ' ' << in_name(i);
+  }
+  src << ")\n{\n" << op.body << "\n}\n\n";
+
+  // The grid-strided loop: full vectors, then the remainder.
+  std::ostringstream params;
+  std::ostringstream args;
+  params << op.out_type << "* __restrict__ out";
+  args << "out";
+  for (std::size_t i = 0; i < num_ins; ++i)
+  {
+    params << ", " << op.in_types[i] << " const* __restrict__ "
+           << in_name(i);
+    args << ", " << in_name(i);
+  }
+  params << ", unsigned long long size";
+  args << ", size";
+
+  src << "template <int W>\n"
+      << "__device__ __forceinline__ void h2_jit_loop(" << params.str()
+      << ")\n{\n"
+      << "  unsigned long long const tid =\n"
+      << "    blockIdx.x * (unsigned long long) blockDim.x + threadIdx.x;\n"
+      << "  unsigned long long const num_threads =\n"
+      << "    (unsigned long long) blockDim.x * gridDim.x;\n"
+      << "  unsigned long long const num_vecs = size / W;\n"
+      << "  for (unsigned long long i = tid; i < num_vecs; i += num_threads)\n"
+      << "  {\n";
+  for (std::size_t i = 0; i < num_ins; ++i)
+  {
+    src << "    h2_jit::Vec<" << op.in_types[i] << ", W> const v" << i
+        << " =\n      reinterpret_cast<h2_jit::Vec<" << op.in_types[i]
+        << ", W> const*>(" << in_name(i) << ")[i];\n";
+  }
+  src << "    h2_jit::Vec<" << op.out_type << ", W> r;\n"
+      << "#pragma unroll\n"
+      << "    for (int j = 0; j < W; ++j)\n"
+      << "    {\n"
+      << "      r.v[j] = h2_jit_op(";
+  for (std::size_t i = 0; i < num_ins; ++i)
+  {
+    src << (i ? ", " : "") << 'v' << i << ".v[j]";
+  }
+  src << ");\n"
+      << "    }\n"
+      << "    reinterpret_cast<h2_jit::Vec<" << op.out_type
+      << ", W>*>(out)[i] = r;\n"
+      << "  }\n"
+      << "  for (unsigned long long i = num_vecs * W + tid; i < size;\n"
+      << "       i += num_threads)\n"
+      << "  {\n"
+      << "    out[i] = h2_jit_op(";
+  for (std::size_t i = 0; i < num_ins; ++i)
+  {
+    src << (i ? ", " : "") << in_name(i) << "[i]";
+  }
+  src << ");\n"
+      << "  }\n"
+      << "}\n";
+
+  for (std::size_t vec_width : jit_vec_widths)
+  {
+    src << "\nextern \"C\" __global__ void "
+        << get_kernel_name(op.name, vec_width) << '(' << params.str()
+        << ")\n{\n"
+        << "  h2_jit_loop<" << vec_width << ">(" << args.str() << ");\n"
+        << "}\n";
+  }
+  return src.str();
+}
+
+std::size_t get_jit_vec_width(std::vector<void const*> const& bufs,
+                              std::vector<std::size_t> const& sizes)
+{
+  H2_ASSERT_DEBUG(bufs.size() == sizes.size(),
+                  "Need a size for each buffer");
+  for (std::size_t vec_width : jit_vec_widths)
+  {
+    bool aligned = true;
+    for (std::size_t i = 0; i < bufs.size(); ++i)
+    {
+      std::uintptr_t const addr = reinterpret_cast<std::uintptr_t>(bufs[i]);
+      aligned = aligned && (addr % (vec_width * sizes[i]) == 0);
+    }
+    if (aligned)
+    {
+      return vec_width;
+    }
+  }
+  return 1;
+}
+
+JitElementwiseKernel::JitElementwiseKernel(
+  JitElementwiseOp op_,
+  void* module_,
+  std::array<void*, jit_vec_widths.size()> functions_)
+  : op(std::move(op_)), module(module_), functions(functions_)
+{
+  type_sizes.push_back(jit_type_size(op.out_type));
+  for (auto const& type : op.in_types)
+  {
+    type_sizes.push_back(jit_type_size(type));
+  }
+}
+
+JitElementwiseKernel::~JitElementwiseKernel()
+{
+  // The cache is destroyed at exit, possibly after the runtime.
+  if (!runtime_is_finalized())
+  {
+    jit_backend::unload_module(module);
+  }
+}
+
+void JitElementwiseKernel::check_types(
+  std::vector<char const*> const& types) const
+{
+  H2_ASSERT_ALWAYS(types.size() == op.in_types.size() + 1,
+                   "JIT operation ",
+                   op.name,
+                   " takes ",
+                   op.in_types.size(),
+                   " inputs, got ",
+                   types.size() - 1);
+  H2_ASSERT_ALWAYS(op.out_type == types[0],
+                   "JIT operation ",
+                   op.name,
+                   " outputs ",
+                   op.out_type,
+                   ", got a buffer of ",
+                   types[0]);
+  for (std::size_t i = 0; i < op.in_types.size(); ++i)
+  {
+    H2_ASSERT_ALWAYS(op.in_types[i] == types[i + 1],
+                     "Input ",
+                     i,
+                     " of JIT operation ",
+                     op.name,
+                     " is ",
+                     op.in_types[i],
+                     ", got a buffer of ",
+                     types[i + 1]);
+  }
+}
+
+void JitElementwiseKernel::launch(DeviceStream stream,
+                                  std::size_t size,
+                                  void* out,
+                                  std::vector<void const*> const& ins) const
+{
+  H2_ASSERT_ALWAYS(ins.size() == op.in_types.size(),
+                   "JIT operation ",
+                   op.name,
+                   " takes ",
+                   op.in_types.size(),
+                   " inputs, got ",
+                   ins.size());
+  if (size == 0)
+  {
+    return;
+  }
+  std::vector<void const*> bufs{out};
+  bufs.insert(bufs.end(), ins.begin(), ins.end());
+  std::size_t const vec_width = get_jit_vec_width(bufs, type_sizes);
+  std::size_t const func_idx =
+    std::find(jit_vec_widths.begin(), jit_vec_widths.end(), vec_width)
+    - jit_vec_widths.begin();
+
+  std::size_t const ele_per_block = std::size_t{num_threads_per_block}
+                                    * work_per_thread * vec_width;
+  unsigned int const num_blocks =
+    static_cast<unsigned int>(std::min<std::size_t>(
+      (size + ele_per_block - 1) / ele_per_block, max_grid_x));
+
+  // Kernel arguments are passed by address.
+  unsigned long long size_arg = size;
+  std::vector<void const*> buf_args(bufs);
+  std::vector<void*> args;
+  for (auto& buf : buf_args)
+  {
+    args.push_back(&buf);
+  }
+  args.push_back(&size_arg);
+  jit_backend::launch(functions[func_idx],
+                      num_blocks,
+                      num_threads_per_block,
+                      stream,
+                      args.data());
+}
+
+JitElementwiseKernel const&
+get_jit_elementwise_kernel(JitElementwiseOp const& op)
+{
+  std::string const source = make_jit_elementwise_source(op);
+  std::string const key = std::to_string(current_gpu()) + '\n' + source;
+  JitCache& cache = get_cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  auto i = cache.kernels.find(key);
+  if (i != cache.kernels.end())
+  {
+    return *i->second;
+  }
+
+  void* module = jit_backend::load_module(get_binary(op, source));
+  std::array<void*, jit_vec_widths.size()> functions;
+  try
+  {
+    for (std::size_t w = 0; w < jit_vec_widths.size(); ++w)
+    {
+      functions[w] = jit_backend::get_function(
+        module, get_kernel_name(op.name, jit_vec_widths[w]));
+    }
+  }
+  catch (...)
+  {
+    jit_backend::unload_module(module);
+    throw;
+  }
+  auto kernel = std::make_unique<JitElementwiseKernel>(op, module, functions);
+  return *cache.kernels.emplace(key, std::move(kernel)).first->second;
+}
+
+}  // namespace gpu
+}  // namespace h2
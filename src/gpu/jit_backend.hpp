@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Runtime-specific parts of JIT kernel compilation, implemented with
+ * NVRTC and the CUDA driver API or with hipRTC and the HIP module API.
+ */
+
+#include "h2/gpu/runtime.hpp"
+
+#include <string>
+
+namespace h2
+{
+namespace gpu
+{
+namespace jit_backend
+{
+
+/** Return the architecture of the current GPU (e.g., "sm_80"). */
+std::string get_arch();
+
+/** Return the version of the runtime compiler, for cache keys. */
+std::string get_compiler_version();
+
+/**
+ * Compile `source` for the current GPU and return the binary.
+ *
+ * `name` is used in diagnostics. Errors are thrown with the compiler
+ * log.
+ */
+std::string compile(std::string const& source, std::string const& name);
+
+/** Load a binary from `compile` on the current GPU. */
+void* load_module(std::string const& binary);
+
+/** Unload a module from `load_module`. */
+void unload_module(void* module) noexcept;
+
+/** Return the kernel `name` in `module`. */
+void* get_function(void* module, std::string const& name);
+
+/** Launch `function` with the given (1D) configuration and arguments. */
+void launch(void* function,
+            unsigned int num_blocks,
+            unsigned int block_size,
+            DeviceStream stream,
+            void** args);
+
+}  // namespace jit_backend
+}  // namespace gpu
+}  // namespace h2
@@ -6,6 +6,8 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "h2/gpu/logger.hpp"
 
+#include "h2/utils/Logger.hpp"
+
 #include <memory>
 #include <stdexcept>
 
@@ -73,11 +75,16 @@ static std::shared_ptr<spdlog::logger> make_logger()
   formatter->add_flag<HostnameFlag>('h').set_pattern("[%h:%P] [%n:%^%l%$] %v");
   console_sink->set_formatter(std::move(formatter));
 
-  auto logger = std::make_shared<spdlog::logger>(
-    std::string{"h2_gpu"}, spdlog::sinks_init_list{console_sink});
+  auto logger = h2::make_spdlog_logger(
+    std::string{"h2_gpu"}, h2::make_rate_limited_sink(console_sink));
   logger->flush_on(spdlog::get_level());
-  spdlog::register_logger(logger);
+  // Start from the default level, as other spdlog loggers do, but keep
+  // ranks that do not log off regardless of the environment.
+  if (h2::is_logging_rank())
+    logger->set_level(spdlog::get_level());
   spdlog::cfg::load_env_levels();
+  if (!h2::is_logging_rank())
+    logger->set_level(spdlog::level::off);
 
   return logger;
 }
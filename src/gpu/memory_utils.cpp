@@ -8,6 +8,10 @@
 
 #include "h2_config.hpp"
 
+#include "h2/core/size_class_allocator.hpp"
+#include "h2/utils/environment_vars.hpp"
+#include "h2/utils/Error.hpp"
+
 #include <hydrogen/device/gpu/CUB.hpp>
 
 #if H2_HAS_CUDA
@@ -19,6 +23,10 @@
 #endif
 
 #include <cstdlib>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 // Note: The behavior of functions in this file may be impacted by the
 // following user-provided environment variables (these corresponde
@@ -43,41 +51,87 @@
 //                          logs from (HIP)CUB to stdout. Default:
 //                          false.
 //
+// All of these are registered H2 environment variables (see
+// environment_vars.cpp), so they are read once and cached.
+//
+// The choice of allocator backend is controlled by the registered H2
+// environment variables (see environment_vars.cpp):
+//
+//   - H2_GPU_ALLOCATOR (string): "cub" to use the (HIP)CUB caching
+//                                allocator above, "async" to use the
+//                                device's stream-ordered memory pool,
+//                                or "sizeclass" to use H2's size-class
+//                                caching allocator. Default: "cub".
+//
+//   - H2_GPU_MEMPOOL_RELEASE_THRESHOLD (uint64): Bytes the
+//                                                stream-ordered pool
+//                                                may keep cached.
+//                                                Default: no limit.
+//
+//   - H2_GPU_CACHE_MIN_BLOCK, H2_GPU_CACHE_LINEAR_THRESHOLD,
+//     H2_GPU_CACHE_LINEAR_STEP (uint64): The rounding policy of the
+//     size-class allocator (see SizeClassPolicy). Defaults: 512 B,
+//     1 MiB, 128 KiB.
+//
+// Whether H2 shares Hydrogen's CUB allocator is controlled by:
+//
+//   - H2_INTERNAL_CUB_POOL (bool): If true, H2's CUB backend uses its
+//                                  own CUB allocator. H2 then releases
+//                                  Hydrogen's cached memory when it
+//                                  runs out, and cached_bytes() and
+//                                  trim_cache() cover both pools.
+//                                  Default: false.
+//
 // As usual, boolean environment variables are truthy if they are set
 // to any nonempty value that does not begin with '0'. That is, they
 // match '[^0].*'. The behavior is undefined if the value of the H2_*
 // variables differs across processes in one MPI universe.
 
+// These are read through the H2 environment variable cache, so only
+// the first call reads the environment. Values keep the semantics of
+// atoi (invalid values are 0) so these cannot throw.
+
+namespace
+{
+
+bool is_truthy(std::string const& val) noexcept
+{
+  return !val.empty() && val[0] != '0';
+}
+
+}  // anonymous namespace
+
 unsigned int h2::gpu::cub_growth_factor() noexcept
 {
-  char const* env = std::getenv("H2_CUB_BIN_GROWTH");
-  return (env ? static_cast<unsigned int>(std::atoi(env)) : 2);
+  return static_cast<unsigned int>(
+    std::atoi(h2::env::get_raw("CUB_BIN_GROWTH").c_str()));
 }
 
 unsigned int h2::gpu::cub_min_bin() noexcept
 {
-  char const* env = std::getenv("H2_CUB_MIN_BIN");
-  return (env ? static_cast<unsigned int>(std::atoi(env)) : 1);
+  return static_cast<unsigned int>(
+    std::atoi(h2::env::get_raw("CUB_MIN_BIN").c_str()));
 }
 
 unsigned int h2::gpu::cub_max_bin() noexcept
 {
-  char const* env = std::getenv("H2_CUB_MAX_BIN");
-  return (env ? static_cast<unsigned int>(std::atoi(env))
-              : h2::gpu::RawCUBAllocType::INVALID_BIN);
+  return (h2::env::exists("CUB_MAX_BIN")
+            ? static_cast<unsigned int>(
+                std::atoi(h2::env::get_raw("CUB_MAX_BIN").c_str()))
+            : h2::gpu::RawCUBAllocType::INVALID_BIN);
 }
 
 size_t h2::gpu::cub_max_cached_size() noexcept
 {
-  char const* env = std::getenv("H2_CUB_MAX_CACHED_SIZE");
-  return (env ? static_cast<size_t>(std::atoll(env))
-              : h2::gpu::RawCUBAllocType::INVALID_SIZE);
+  return (h2::env::exists("CUB_MAX_CACHED_SIZE")
+            ? static_cast<size_t>(
+                std::atoll(h2::env::get_raw("CUB_MAX_CACHED_SIZE").c_str()))
+            : h2::gpu::RawCUBAllocType::INVALID_SIZE);
 }
 
 bool h2::gpu::cub_debug() noexcept
 {
-  char const* env = std::getenv("H2_CUB_DEBUG");
-  return (env && std::strlen(env) && env[0] != '0');
+  return is_truthy(h2::env::get_raw("CUB_DEBUG"));
 }
 
 h2::gpu::RawCUBAllocType h2::gpu::make_allocator(unsigned int const gf,
@@ -103,8 +157,7 @@ h2::gpu::RawCUBAllocType h2::gpu::make_allocator(unsigned int const gf,
 
 static bool use_internal_pool() noexcept
 {
-  char const* env = std::getenv("H2_INTERNAL_CUB_POOL");
-  return (env && std::strlen(env) && env[0] != '0');
+  return is_truthy(h2::env::get_raw("INTERNAL_CUB_POOL"));
 }
 
 static h2::gpu::RawCUBAllocType& borrow_hydrogen_cub_allocator()
@@ -126,9 +179,248 @@ static h2::gpu::RawCUBAllocType& get_internal_cub_allocator()
   return alloc;
 }
 
+// Return Hydrogen's unused cached memory to the system, if H2 does not
+// share Hydrogen's pool, so that H2's allocations can use it. Returns
+// true if anything could have been released.
+static bool release_hydrogen_cache()
+{
+  if (h2::gpu::shares_hydrogen_memory_pool())
+  {
+    return false;
+  }
+  H2_GPU_TRACE("H2 releasing Hydrogen's cached CUB memory");
+  return hydrogen::cub::MemoryPool().FreeAllCached() == 0;
+}
+
 h2::gpu::RawCUBAllocType& h2::gpu::default_cub_allocator()
 {
+  // Static initialization is thread-safe, so concurrent first calls
+  // agree on one allocator.
   static auto& alloc = (use_internal_pool() ? get_internal_cub_allocator()
                                             : borrow_hydrogen_cub_allocator());
   return alloc;
 }
+
+namespace
+{
+
+/** (HIP)CUB pool. */
+class CUBMemoryPool final : public h2::gpu::MemoryPool
+{
+public:
+  CUBMemoryPool(h2::gpu::RawCUBAllocType& alloc_) : alloc(alloc_) {}
+
+  void* allocate(size_t bytes, h2::gpu::DeviceStream stream) override
+  {
+    void* ptr = nullptr;
+    // CUB frees its own cache before failing; if that was not enough,
+    // Hydrogen's cache may still hold memory.
+    if (alloc.DeviceAllocate(&ptr, bytes, stream) != 0
+        && (&alloc == &hydrogen::cub::MemoryPool()
+            || !release_hydrogen_cache()
+            || alloc.DeviceAllocate(&ptr, bytes, stream) != 0))
+    {
+      throw H2Exception("CUB allocation of ", bytes, " bytes failed");
+    }
+    return ptr;
+  }
+
+  void deallocate(void* ptr, h2::gpu::DeviceStream) override
+  {
+    H2_ASSERT_ALWAYS(alloc.DeviceFree(ptr) == 0, "CUB deallocation failed");
+  }
+
+  size_t cached_bytes() override
+  {
+    std::lock_guard<std::mutex> lock(alloc.mutex);
+    auto const i = alloc.cached_bytes.find(h2::gpu::current_gpu());
+    return (i == alloc.cached_bytes.end()) ? 0 : i->second.free;
+  }
+
+  void trim() override
+  {
+    H2_ASSERT_ALWAYS(alloc.FreeAllCached() == 0,
+                     "Failed to free cached CUB memory");
+  }
+
+private:
+  h2::gpu::RawCUBAllocType& alloc;
+};
+
+/** The device's stream-ordered pool. */
+class StreamOrderedMemoryPool final : public h2::gpu::MemoryPool
+{
+public:
+  void* allocate(size_t bytes, h2::gpu::DeviceStream stream) override
+  {
+    return h2::gpu::stream_ordered_allocate(bytes, stream);
+  }
+
+  void deallocate(void* ptr, h2::gpu::DeviceStream stream) override
+  {
+    h2::gpu::mem_free_async(ptr, stream);
+  }
+
+  size_t cached_bytes() override
+  {
+    return h2::gpu::mem_pool_cached_bytes(h2::gpu::current_gpu());
+  }
+
+  // The pool is trimmed according to its release threshold.
+  void trim() override {}
+};
+
+/** H2's size-class allocator. */
+class SizeClassMemoryPool final : public h2::gpu::MemoryPool
+{
+public:
+  void* allocate(size_t bytes, h2::gpu::DeviceStream stream) override
+  {
+    return h2::gpu::size_class_allocator().allocate(bytes, stream);
+  }
+
+  void deallocate(void* ptr, h2::gpu::DeviceStream) override
+  {
+    h2::gpu::size_class_allocator().deallocate(ptr);
+  }
+
+  size_t cached_bytes() override
+  {
+    return h2::gpu::size_class_allocator().cached_bytes();
+  }
+
+  void trim() override { h2::gpu::size_class_allocator().trim(); }
+};
+
+}  // anonymous namespace
+
+h2::gpu::MemoryPool& h2::gpu::memory_pool()
+{
+  ensure_runtime_active();
+  static std::unique_ptr<MemoryPool> const pool =
+    []() -> std::unique_ptr<MemoryPool> {
+    switch (allocator_backend())
+    {
+    case AllocatorBackend::CUB:
+      return std::make_unique<CUBMemoryPool>(default_cub_allocator());
+    case AllocatorBackend::StreamOrdered:
+      return std::make_unique<StreamOrderedMemoryPool>();
+    case AllocatorBackend::SizeClass:
+      return std::make_unique<SizeClassMemoryPool>();
+    }
+    throw H2FatalException("Unknown GPU allocator backend");
+  }();
+  return *pool;
+}
+
+h2::gpu::MemoryPool& h2::gpu::hydrogen_memory_pool()
+{
+  if (shares_hydrogen_memory_pool())
+  {
+    return memory_pool();
+  }
+  static CUBMemoryPool pool(hydrogen::cub::MemoryPool());
+  return pool;
+}
+
+bool h2::gpu::shares_hydrogen_memory_pool()
+{
+  return allocator_backend() == AllocatorBackend::CUB
+         && &default_cub_allocator() == &hydrogen::cub::MemoryPool();
+}
+
+h2::gpu::AllocatorBackend h2::gpu::allocator_backend()
+{
+  static AllocatorBackend const backend = []() {
+    std::string const name = env::get<std::string>("GPU_ALLOCATOR");
+    if (name == "cub")
+    {
+      return AllocatorBackend::CUB;
+    }
+    else if (name == "async")
+    {
+      return AllocatorBackend::StreamOrdered;
+    }
+    else if (name == "sizeclass")
+    {
+      return AllocatorBackend::SizeClass;
+    }
+    throw H2FatalException("Unknown GPU allocator backend '", name, "'");
+  }();
+  return backend;
+}
+
+uint64_t h2::gpu::mem_pool_release_threshold()
+{
+  if (!env::exists("GPU_MEMPOOL_RELEASE_THRESHOLD"))
+  {
+    return std::numeric_limits<uint64_t>::max();
+  }
+  return env::get<unsigned long long>("GPU_MEMPOOL_RELEASE_THRESHOLD");
+}
+
+void* h2::gpu::stream_ordered_allocate(size_t const bytes,
+                                       DeviceStream const stream)
+{
+  // Pools are per-device, so configure each one the first time it is
+  // used. This is the only synchronization on the allocation path.
+  static std::vector<std::once_flag> pool_configured(num_gpus());
+  int const device = current_gpu();
+  std::call_once(pool_configured[device], [device]() {
+    set_mem_pool_release_threshold(device, mem_pool_release_threshold());
+  });
+  return mem_alloc_async(bytes, stream);
+}
+
+h2::internal::SizeClassAllocator& h2::gpu::size_class_allocator()
+{
+  static std::vector<std::unique_ptr<internal::SizeClassAllocator>>
+    allocators = []() {
+      internal::SizeClassPolicy policy;
+      policy.min_block_size =
+        env::get<unsigned long long>("GPU_CACHE_MIN_BLOCK");
+      policy.linear_threshold =
+        env::get<unsigned long long>("GPU_CACHE_LINEAR_THRESHOLD");
+      policy.linear_step =
+        env::get<unsigned long long>("GPU_CACHE_LINEAR_STEP");
+      // Raw allocations happen with the device current, so each
+      // allocator only ever allocates on its own device.
+      std::vector<std::unique_ptr<internal::SizeClassAllocator>> v;
+      for (int i = 0; i < num_gpus(); ++i)
+      {
+        v.push_back(std::make_unique<internal::SizeClassAllocator>(
+          [](size_t bytes) {
+            void* ptr = mem_alloc(bytes);
+            if (ptr == nullptr && release_hydrogen_cache())
+            {
+              ptr = mem_alloc(bytes);
+            }
+            return ptr;
+          },
+          [](void* ptr) { mem_free(ptr); },
+          policy));
+      }
+      return v;
+    }();
+  return *allocators[current_gpu()];
+}
+
+size_t h2::gpu::cached_bytes()
+{
+  size_t bytes = memory_pool().cached_bytes();
+  if (!shares_hydrogen_memory_pool())
+  {
+    bytes += hydrogen_memory_pool().cached_bytes();
+  }
+  return bytes;
+}
+
+void h2::gpu::trim_cache()
+{
+  sync();
+  memory_pool().trim();
+  if (!shares_hydrogen_memory_pool())
+  {
+    hydrogen_memory_pool().trim();
+  }
+}
@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "../jit_backend.hpp"
+
+#include "h2/gpu/logger.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <string>
+#include <vector>
+
+#include <hip/hip_runtime.h>
+#include <hip/hiprtc.h>
+
+namespace h2
+{
+namespace gpu
+{
+namespace jit_backend
+{
+
+namespace
+{
+
+void check_hiprtc(hiprtcResult status, char const* what)
+{
+  if (status != HIPRTC_SUCCESS)
+  {
+    throw H2FatalException(what, " failed: ", hiprtcGetErrorString(status));
+  }
+}
+
+/** Destroy a hipRTC program when leaving scope. */
+struct ProgramGuard
+{
+  hiprtcProgram prog;
+  ~ProgramGuard() { hiprtcDestroyProgram(&prog); }
+};
+
+}  // anonymous namespace
+
+std::string get_arch()
+{
+  hipDeviceProp_t props;
+  H2_CHECK_HIP(hipGetDeviceProperties(&props, current_gpu()));
+  // Keep the full name (e.g., "gfx90a:sramecc+:xnack-"), since binaries
+  // depend on the target features too.
+  std::string arch = props.gcnArchName;
+  for (char& c : arch)
+  {
+    if (c == ':' || c == '+')
+    {
+      c = '_';
+    }
+  }
+  return arch;
+}
+
+std::string get_compiler_version()
+{
+  int version = 0;
+  H2_CHECK_HIP(hipRuntimeGetVersion(&version));
+  return "hiprtc" + std::to_string(version);
+}
+
+std::string compile(std::string const& source, std::string const& name)
+{
+  H2_GPU_DEBUG("Compiling JIT kernel {}", name);
+  ProgramGuard guard;
+  check_hiprtc(hiprtcCreateProgram(&guard.prog,
+                                   source.c_str(),
+                                   (name + ".hip").c_str(),
+                                   0,
+                                   nullptr,
+                                   nullptr),
+               "hiprtcCreateProgram");
+  hipDeviceProp_t props;
+  H2_CHECK_HIP(hipGetDeviceProperties(&props, current_gpu()));
+  std::string const arch_opt =
+    std::string("--offload-arch=") + props.gcnArchName;
+  std::vector<char const*> const opts = {
+    arch_opt.c_str(), "-std=c++17", "-ffast-math"};
+  hiprtcResult const status = hiprtcCompileProgram(
+    guard.prog, static_cast<int>(opts.size()), opts.data());
+  if (status != HIPRTC_SUCCESS)
+  {
+    std::size_t log_size = 0;
+    hiprtcGetProgramLogSize(guard.prog, &log_size);
+    std::string log(log_size, '\0');
+    hiprtcGetProgramLog(guard.prog, log.data());
+    throw H2FatalException("Compiling JIT kernel ",
+                           name,
+                           " failed: ",
+                           hiprtcGetErrorString(status),
+                           "\n",
+                           log);
+  }
+  std::size_t binary_size = 0;
+  check_hiprtc(hiprtcGetCodeSize(guard.prog, &binary_size),
+               "hiprtcGetCodeSize");
+  std::string binary(binary_size, '\0');
+  check_hiprtc(hiprtcGetCode(guard.prog, binary.data()), "hiprtcGetCode");
+  return binary;
+}
+
+void* load_module(std::string const& binary)
+{
+  ensure_runtime_active();
+  hipModule_t module;
+  H2_CHECK_HIP(hipModuleLoadData(&module, binary.data()));
+  return module;
+}
+
+void unload_module(void* module) noexcept
+{
+  static_cast<void>(hipModuleUnload(static_cast<hipModule_t>(module)));
+}
+
+void* get_function(void* module, std::string const& name)
+{
+  hipFunction_t function;
+  H2_CHECK_HIP(hipModuleGetFunction(
+    &function, static_cast<hipModule_t>(module), name.c_str()));
+  return function;
+}
+
+void launch(void* function,
+            unsigned int num_blocks,
+            unsigned int block_size,
+            DeviceStream stream,
+            void** args)
+{
+  H2_CHECK_HIP(hipModuleLaunchKernel(static_cast<hipFunction_t>(function),
+                                     num_blocks,
+                                     1,
+                                     1,
+                                     block_size,
+                                     1,
+                                     1,
+                                     0,
+                                     stream,
+                                     args,
+                                     nullptr));
+}
+
+}  // namespace jit_backend
+}  // namespace gpu
+}  // namespace h2
@@ -7,10 +7,14 @@
 
 #include "h2/gpu/runtime.hpp"
 
+#include "h2/gpu/event_pool.hpp"
 #include "h2/gpu/logger.hpp"
 
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
 
 #include <hip/hip_runtime.h>
 #include <rocm_smi/rocm_smi.h>
@@ -265,11 +269,6 @@ static int get_reasonable_default_gpu_id() noexcept
   return -1;
 }
 
-static void set_reasonable_default_gpu()
-{
-  h2::gpu::set_gpu(get_reasonable_default_gpu_id());
-}
-
 static std::string get_device_name_by_pci_bus(int const pci_bus)
 {
   uint32_t dev_id = 0, ndevices = 0;
@@ -349,23 +348,27 @@ void h2::gpu::init_runtime()
 {
   if (!initialized_)
   {
+    auto const start = std::chrono::steady_clock::now();
     H2_GPU_TRACE("initializing gpu runtime");
     H2_CHECK_HIP(hipInit(0));
     H2_GPU_TRACE("found {} devices", num_gpus());
-    set_reasonable_default_gpu();
+    int const gpu_id = get_reasonable_default_gpu_id();
     initialized_ = true;
 
-    hipDeviceProp_t props;
-    H2_CHECK_HIP(hipGetDeviceProperties(&props, current_gpu()));
-    is_integrated_ = props.integrated;
+    is_integrated_ = device_properties(gpu_id).integrated;
     H2_GPU_TRACE(is_integrated_ ? "GPU is integrated"
                                 : "GPU is NOT integrated");
+    log_gpu_info(gpu_id);
+    internal::start_runtime(
+      gpu_id,
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+        .count());
   }
   else
   {
     H2_GPU_TRACE("H2 GPU already initialized; current gpu={}", current_gpu());
+    log_gpu_info(current_gpu());
   }
-  log_gpu_info(current_gpu());
 }
 
 void h2::gpu::finalize_runtime()
@@ -374,6 +377,8 @@ void h2::gpu::finalize_runtime()
     return;
 
   H2_GPU_TRACE("finalizing gpu runtime");
+  clear_event_pools();
+  internal::stop_runtime();
   initialized_ = false;
 }
 
@@ -392,8 +397,36 @@ bool h2::gpu::is_integrated()
   return is_integrated_;
 }
 
+h2::gpu::DeviceProperties h2::gpu::internal::query_device_properties(int gpu_id)
+{
+  hipDeviceProp_t props;
+  H2_CHECK_HIP(hipGetDeviceProperties(&props, gpu_id));
+
+  DeviceProperties dev_props;
+  dev_props.name = props.name;
+  dev_props.num_sms = props.multiProcessorCount;
+  dev_props.warp_size = props.warpSize;
+  dev_props.l2_cache_size = static_cast<std::size_t>(props.l2CacheSize);
+  dev_props.shared_mem_per_block = props.sharedMemPerBlock;
+  dev_props.total_mem = props.totalGlobalMem;
+  // Double data rate, the clock is in kHz, and the bus width is in bits.
+  dev_props.peak_bandwidth =
+    2.0 * props.memoryClockRate * 1000.0 * (props.memoryBusWidth / 8.0);
+  dev_props.integrated = props.integrated != 0;
+  char bus_id[32];
+  std::snprintf(bus_id,
+                sizeof(bus_id),
+                "%04x:%02x:%02x.0",
+                props.pciDomainID,
+                props.pciBusID,
+                props.pciDeviceID);
+  dev_props.pci_bus_id = bus_id;
+  return dev_props;
+}
+
 hipStream_t h2::gpu::make_stream()
 {
+  ensure_runtime_active();
   hipStream_t stream;
   H2_CHECK_HIP(hipStreamCreate(&stream));
   H2_GPU_TRACE("created stream {}", (void*) stream);
@@ -402,12 +435,30 @@ hipStream_t h2::gpu::make_stream()
 
 hipStream_t h2::gpu::make_stream_nonblocking()
 {
+  ensure_runtime_active();
   hipStream_t stream;
   H2_CHECK_HIP(hipStreamCreateWithFlags(&stream, hipStreamNonBlocking));
   H2_GPU_TRACE("created non-blocking stream {}", (void*) stream);
   return stream;
 }
 
+hipStream_t h2::gpu::make_stream_with_priority(int priority)
+{
+  ensure_runtime_active();
+  hipStream_t stream;
+  H2_CHECK_HIP(
+    hipStreamCreateWithPriority(&stream, hipStreamNonBlocking, priority));
+  H2_GPU_TRACE("created stream {} with priority {}", (void*) stream, priority);
+  return stream;
+}
+
+std::pair<int, int> h2::gpu::stream_priority_range()
+{
+  int least, greatest;
+  H2_CHECK_HIP(hipDeviceGetStreamPriorityRange(&least, &greatest));
+  return {least, greatest};
+}
+
 void h2::gpu::destroy(hipStream_t stream)
 {
   H2_GPU_TRACE("destroy stream {}", (void*) stream);
@@ -475,3 +526,71 @@ void h2::gpu::sync(hipStream_t stream, hipEvent_t event)
   H2_GPU_TRACE("stream {} waiting for event {}", (void*) stream, (void*) event);
   H2_CHECK_HIP(hipStreamWaitEvent(stream, event, 0));
 }
+
+bool h2::gpu::query(hipEvent_t event)
+{
+  hipError_t const status = hipEventQuery(event);
+  if (status == hipErrorNotReady)
+  {
+    // Clear the sticky "error".
+    (void) hipGetLastError();
+    return false;
+  }
+  H2_CHECK_HIP(status);
+  return true;
+}
+
+float h2::gpu::elapsed_time(hipEvent_t start, hipEvent_t end)
+{
+  float ms;
+  H2_CHECK_HIP(hipEventElapsedTime(&ms, start, end));
+  return ms;
+}
+
+void h2::gpu::begin_capture(hipStream_t stream)
+{
+  H2_GPU_TRACE("begin capture on stream {}", (void*) stream);
+  H2_CHECK_HIP(hipStreamBeginCapture(stream, hipStreamCaptureModeRelaxed));
+}
+
+hipGraph_t h2::gpu::end_capture(hipStream_t stream)
+{
+  H2_GPU_TRACE("end capture on stream {}", (void*) stream);
+  hipGraph_t graph;
+  H2_CHECK_HIP(hipStreamEndCapture(stream, &graph));
+  return graph;
+}
+
+bool h2::gpu::is_capturing(hipStream_t stream)
+{
+  hipStreamCaptureStatus status;
+  H2_CHECK_HIP(hipStreamIsCapturing(stream, &status));
+  return status != hipStreamCaptureStatusNone;
+}
+
+hipGraphExec_t h2::gpu::instantiate(hipGraph_t graph)
+{
+  hipGraphExec_t graph_exec;
+  H2_CHECK_HIP(hipGraphInstantiateWithFlags(&graph_exec, graph, 0));
+  H2_GPU_TRACE(
+    "instantiated graph {} as {}", (void*) graph, (void*) graph_exec);
+  return graph_exec;
+}
+
+void h2::gpu::launch_graph(hipGraphExec_t graph, hipStream_t stream)
+{
+  H2_GPU_TRACE("launch graph {} on stream {}", (void*) graph, (void*) stream);
+  H2_CHECK_HIP(hipGraphLaunch(graph, stream));
+}
+
+void h2::gpu::destroy(hipGraph_t graph)
+{
+  H2_GPU_TRACE("destroy graph {}", (void*) graph);
+  H2_CHECK_HIP(hipGraphDestroy(graph));
+}
+
+void h2::gpu::destroy(hipGraphExec_t graph)
+{
+  H2_GPU_TRACE("destroy executable graph {}", (void*) graph);
+  H2_CHECK_HIP(hipGraphExecDestroy(graph));
+}
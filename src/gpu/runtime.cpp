@@ -0,0 +1,232 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+// Runtime activation, device properties, and kernel launch support
+// shared by the CUDA and ROCm runtimes.
+
+#include "h2/gpu/runtime.hpp"
+
+#include "h2_config.hpp"
+
+#include "h2/gpu/logger.hpp"
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/utils/Error.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+
+std::mutex& get_activation_mutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+/** GPU selected by `init_runtime` (-1 if not initialized). */
+int selected_gpu_id = -1;
+std::atomic<bool> runtime_active{false};
+h2::gpu::RuntimeInitTimes init_times;
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                       - start)
+    .count();
+}
+
+std::mutex& get_properties_mutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+/** Properties of each GPU, queried when first needed. */
+std::vector<std::unique_ptr<h2::gpu::DeviceProperties>>& get_properties()
+{
+  static std::vector<std::unique_ptr<h2::gpu::DeviceProperties>> props;
+  return props;
+}
+
+/** Kernel, block size, shared memory, and GPU of a cached occupancy. */
+using OccupancyKey = std::tuple<void const*, unsigned int, std::size_t, int>;
+
+std::mutex& get_occupancy_mutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::map<OccupancyKey, unsigned int>& get_occupancy_cache()
+{
+  static std::map<OccupancyKey, unsigned int> cache;
+  return cache;
+}
+
+}  // anonymous namespace
+
+void h2::gpu::internal::start_runtime(int gpu_id, double select_time)
+{
+  {
+    std::lock_guard<std::mutex> lock(get_activation_mutex());
+    selected_gpu_id = gpu_id;
+    runtime_active.store(false, std::memory_order_release);
+    init_times = RuntimeInitTimes{};
+    init_times.select_gpu = select_time;
+    init_times.lazy = env::get<bool>("GPU_LAZY_INIT");
+  }
+  // Query all GPUs now, so later lookups are cheap.
+  for (int i = 0; i < num_gpus(); ++i)
+  {
+    DeviceProperties const& props = device_properties(i);
+    H2_GPU_DEBUG("GPU {}: {}, {} SMs, warp size {}, {} bytes of L2, {} bytes "
+                 "of shared memory per block, {} bytes of memory, {} GB/s "
+                 "peak bandwidth",
+                 i,
+                 props.name,
+                 props.num_sms,
+                 props.warp_size,
+                 props.l2_cache_size,
+                 props.shared_mem_per_block,
+                 props.total_mem,
+                 props.peak_bandwidth / 1e9);
+  }
+  H2_GPU_DEBUG("selected GPU {} in {} s", gpu_id, select_time);
+  if (init_times.lazy)
+  {
+    H2_GPU_DEBUG("deferring GPU context creation until first use");
+  }
+  else
+  {
+    ensure_runtime_active();
+  }
+}
+
+void h2::gpu::internal::stop_runtime()
+{
+  std::lock_guard<std::mutex> lock(get_activation_mutex());
+  selected_gpu_id = -1;
+  runtime_active.store(false, std::memory_order_release);
+}
+
+void h2::gpu::ensure_runtime_active()
+{
+  if (runtime_active.load(std::memory_order_acquire))
+  {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(get_activation_mutex());
+  if (runtime_active.load(std::memory_order_relaxed) || selected_gpu_id < 0)
+  {
+    return;
+  }
+
+  auto const context_start = std::chrono::steady_clock::now();
+  set_gpu(selected_gpu_id);
+  // Setting the GPU may not create the context, but synchronizing it
+  // does.
+  sync();
+  init_times.create_context = seconds_since(context_start);
+  // Mark the runtime active first, so reserving memory from the pool
+  // does not come back here.
+  runtime_active.store(true, std::memory_order_release);
+
+  auto const reserve_bytes = env::get<std::size_t>("GPU_POOL_RESERVE");
+  if (reserve_bytes > 0)
+  {
+    auto const reserve_start = std::chrono::steady_clock::now();
+    MemoryPool& pool = memory_pool();
+    void* const ptr = pool.allocate(reserve_bytes, DeviceStream{});
+    pool.deallocate(ptr, DeviceStream{});
+    sync();
+    init_times.reserve_pool = seconds_since(reserve_start);
+  }
+  H2_GPU_DEBUG("activated GPU {}: context {} s, {} bytes reserved in {} s",
+               selected_gpu_id,
+               init_times.create_context,
+               reserve_bytes,
+               init_times.reserve_pool);
+}
+
+int h2::gpu::selected_gpu()
+{
+  std::lock_guard<std::mutex> lock(get_activation_mutex());
+  return selected_gpu_id;
+}
+
+h2::gpu::RuntimeInitTimes h2::gpu::get_runtime_init_times()
+{
+  std::lock_guard<std::mutex> lock(get_activation_mutex());
+  return init_times;
+}
+
+h2::gpu::DeviceProperties const& h2::gpu::device_properties(int gpu_id)
+{
+  std::lock_guard<std::mutex> lock(get_properties_mutex());
+  auto& props = get_properties();
+  if (props.empty())
+  {
+    props.resize(static_cast<std::size_t>(num_gpus()));
+  }
+  H2_ASSERT_ALWAYS(gpu_id >= 0
+                     && static_cast<std::size_t>(gpu_id) < props.size(),
+                   "Invalid GPU id ",
+                   gpu_id,
+                   " (",
+                   props.size(),
+                   " GPUs)");
+  auto& dev_props = props[static_cast<std::size_t>(gpu_id)];
+  if (!dev_props)
+  {
+    dev_props = std::make_unique<DeviceProperties>(
+      internal::query_device_properties(gpu_id));
+  }
+  return *dev_props;
+}
+
+h2::gpu::DeviceProperties const& h2::gpu::device_properties()
+{
+  return device_properties(current_gpu());
+}
+
+int h2::gpu::num_sms()
+{
+  return device_properties().num_sms;
+}
+
+std::string h2::gpu::device_name()
+{
+  return device_properties().name;
+}
+
+unsigned int h2::gpu::internal::get_cached_max_resident_blocks(
+  void const* kernel, unsigned int block_size, std::size_t shared_mem)
+{
+  OccupancyKey const key{kernel, block_size, shared_mem, current_gpu()};
+  std::lock_guard<std::mutex> lock(get_occupancy_mutex());
+  auto const& cache = get_occupancy_cache();
+  auto const i = cache.find(key);
+  return (i == cache.end()) ? 0 : i->second;
+}
+
+void h2::gpu::internal::set_cached_max_resident_blocks(
+  void const* kernel,
+  unsigned int block_size,
+  std::size_t shared_mem,
+  unsigned int num_blocks)
+{
+  OccupancyKey const key{kernel, block_size, shared_mem, current_gpu()};
+  std::lock_guard<std::mutex> lock(get_occupancy_mutex());
+  get_occupancy_cache()[key] = num_blocks;
+}
@@ -0,0 +1,199 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/loops/gpu_loop_tuning.hpp"
+
+#include "h2/gpu/logger.hpp"
+#include "h2/gpu/runtime.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+namespace h2
+{
+namespace gpu
+{
+
+namespace
+{
+
+/** Block sizes tried by the autotuner. */
+constexpr unsigned int candidate_block_sizes[] = {128, 256, 512};
+/** Unroll factors tried by the autotuner. */
+constexpr unsigned int candidate_unroll_factors[] = {1, 2, 4};
+/** Vector widths tried by the autotuner (if the buffers allow). */
+constexpr unsigned int candidate_vec_widths[] = {4, 2, 1};
+
+struct TuningCache
+{
+  std::mutex mutex;
+  std::unordered_map<std::string, ElementwiseLaunchConfig> configs;
+  /** Name of each GPU, used in keys, filled in on demand. */
+  std::vector<std::string> device_names;
+  /** Whether the on-disk cache has been loaded. */
+  bool loaded = false;
+};
+
+TuningCache& get_cache()
+{
+  static TuningCache cache;
+  return cache;
+}
+
+std::string const& get_cache_path()
+{
+  static std::string const path = env::get_raw("GPU_LOOP_AUTOTUNE_CACHE");
+  return path;
+}
+
+/** Load the on-disk cache. Must be called with the cache locked. */
+void ensure_cache_loaded(TuningCache& cache)
+{
+  if (cache.loaded)
+  {
+    return;
+  }
+  cache.loaded = true;
+  if (get_cache_path().empty())
+  {
+    return;
+  }
+  std::ifstream in(get_cache_path());
+  if (!in)
+  {
+    return;  // Nothing has been cached yet.
+  }
+  std::string key;
+  ElementwiseLaunchConfig config;
+  while (in >> key >> config.block_size >> config.vec_width >> config.unroll
+         >> config.max_blocks)
+  {
+    cache.configs.insert_or_assign(key, config);
+  }
+}
+
+/**
+ * Return the name of the current GPU, with whitespace removed so it
+ * may be used in a key. Must be called with the cache locked.
+ */
+std::string const& get_device_tag(TuningCache& cache)
+{
+  std::size_t const dev = static_cast<std::size_t>(current_gpu());
+  if (dev >= cache.device_names.size())
+  {
+    cache.device_names.resize(dev + 1);
+  }
+  std::string& name = cache.device_names[dev];
+  if (name.empty())
+  {
+    name = device_name();
+    std::replace_if(
+      name.begin(),
+      name.end(),
+      [](unsigned char c) { return std::isspace(c); },
+      '_');
+  }
+  return name;
+}
+
+}  // anonymous namespace
+
+bool elementwise_autotune_enabled()
+{
+  static bool const enabled = env::get<bool>("GPU_LOOP_AUTOTUNE");
+  return enabled;
+}
+
+std::string get_elementwise_tuning_key(std::type_info const& loop_type,
+                                       std::size_t size)
+{
+  // Bucket by the position of the highest set bit.
+  unsigned int bucket = 0;
+  for (; size > 1; size >>= 1)
+  {
+    ++bucket;
+  }
+  TuningCache& cache = get_cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  return get_device_tag(cache) + ":" + loop_type.name() + ":"
+         + std::to_string(bucket);
+}
+
+std::optional<ElementwiseLaunchConfig>
+get_tuned_elementwise_config(std::string const& key)
+{
+  TuningCache& cache = get_cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  ensure_cache_loaded(cache);
+  auto i = cache.configs.find(key);
+  if (i == cache.configs.end())
+  {
+    return std::nullopt;
+  }
+  return i->second;
+}
+
+void set_tuned_elementwise_config(std::string const& key,
+                                  ElementwiseLaunchConfig const& config)
+{
+  TuningCache& cache = get_cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  ensure_cache_loaded(cache);
+  cache.configs.insert_or_assign(key, config);
+  if (!get_cache_path().empty())
+  {
+    std::ofstream out(get_cache_path(), std::ios::app);
+    if (out)
+    {
+      out << key << ' ' << config.block_size << ' ' << config.vec_width
+          << ' ' << config.unroll << ' ' << config.max_blocks << '\n';
+    }
+    else
+    {
+      H2_GPU_WARN("Could not write GPU loop autotuning cache {}",
+                  get_cache_path());
+    }
+  }
+}
+
+void clear_tuned_elementwise_configs()
+{
+  TuningCache& cache = get_cache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.configs.clear();
+  cache.loaded = true;
+}
+
+std::vector<ElementwiseLaunchConfig>
+get_elementwise_tuning_candidates(std::size_t max_vec_width)
+{
+  std::vector<ElementwiseLaunchConfig> candidates;
+  for (unsigned int vec_width : candidate_vec_widths)
+  {
+    if (vec_width > max_vec_width)
+    {
+      continue;
+    }
+    for (unsigned int block_size : candidate_block_sizes)
+    {
+      for (unsigned int unroll : candidate_unroll_factors)
+      {
+        candidates.push_back({block_size, vec_width, unroll, 0});
+      }
+    }
+  }
+  return candidates;
+}
+
+}  // namespace gpu
+}  // namespace h2
@@ -0,0 +1,379 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/collectives.hpp"
+
+#include "h2/utils/Error.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+namespace h2
+{
+
+namespace internal
+{
+
+namespace
+{
+
+void check_mpi(int ret, char const* what)
+{
+  if (ret != MPI_SUCCESS)
+  {
+    char msg[MPI_MAX_ERROR_STRING];
+    int len = 0;
+    MPI_Error_string(ret, msg, &len);
+    throw H2Exception(what, " failed: ", std::string(msg, len));
+  }
+}
+
+constexpr int scatter_tag = 0x5ca7;
+
+/** Broadcasts in flight at once in a pipelined broadcast. */
+constexpr std::size_t broadcast_window = 8;
+
+}  // anonymous namespace
+
+void scatter_blocks(BaseTensor& dst_local,
+                    BaseTensor const& src_local,
+                    ProcessorGrid const& grid,
+                    DimensionOrderTuple const& dims,
+                    Comm& comm)
+{
+  static std::size_t const max_chunk_bytes =
+    std::max(env::get<std::size_t>("SCATTER_CHUNK"), std::size_t{1});
+  std::size_t const elem_size = dst_local.get_type_info().get_size();
+  ShapeTuple const block_shape = dst_local.shape();
+  StrideTuple const block_strides = get_contiguous_strides(block_shape);
+  std::size_t const block_bytes =
+    product<std::size_t>(block_shape) * elem_size;
+  // Chunks hold whole elements.
+  std::size_t const chunk_bytes =
+    std::max(max_chunk_bytes / elem_size, std::size_t{1}) * elem_size;
+  std::size_t const num_chunks = (block_bytes + chunk_bytes - 1) / chunk_bytes;
+  auto const get_chunk_bytes = [&](std::size_t chunk) {
+    return std::min(chunk_bytes, block_bytes - chunk * chunk_bytes);
+  };
+
+  MPI_Comm const mpi_comm = comm.GetMPIComm();
+  RankType const comm_size = comm.Size();
+  ComputeStream const& dst_stream = dst_local.get_stream();
+  ComputeStream const cpu_stream{Device::CPU};
+  H2_TRACE_SCOPE("h2::scatter", Comm, dst_stream, block_bytes);
+  H2_STRAGGLER_ARRIVAL("h2::scatter", mpi_comm);
+
+  std::vector<MPI_Request> requests;
+  if (comm.Rank() == 0)
+  {
+    ComputeStream const& src_stream = src_local.get_stream();
+    auto const get_block_ptr = [&](RankType r) {
+      ScalarIndexTuple const start =
+        get_collective_block_start(grid, dims, block_shape, r);
+      return static_cast<std::byte const*>(src_local.const_storage_data())
+             + inner_product<DataIndexType>(start, src_local.strides())
+                 * static_cast<DataIndexType>(elem_size);
+    };
+
+    // Each block is packed and its sends started before the next block
+    // is packed, so packing overlaps with communication.
+    MemoryKind const kind = (src_local.get_device() == Device::CPU)
+                              ? MemoryKind::Default
+                              : MemoryKind::Pinned;
+    ManagedBuffer<std::byte> send_buf(
+      block_bytes * (comm_size - 1), Device::CPU, cpu_stream, kind);
+    requests.reserve(num_chunks * (comm_size - 1));
+    for (RankType r = 1; r < comm_size; ++r)
+    {
+      std::byte* const buf = send_buf.data() + (r - 1) * block_bytes;
+      copy_strided_buffer(buf,
+                          block_strides,
+                          cpu_stream,
+                          get_block_ptr(r),
+                          src_local.strides(),
+                          src_stream,
+                          block_shape,
+                          elem_size);
+      src_stream.wait_for_this();
+      for (std::size_t chunk = 0; chunk < num_chunks; ++chunk)
+      {
+        requests.emplace_back(MPI_REQUEST_NULL);
+        check_mpi(MPI_Isend(buf + chunk * chunk_bytes,
+                            safe_as<int>(get_chunk_bytes(chunk)),
+                            MPI_BYTE,
+                            r,
+                            scatter_tag,
+                            mpi_comm,
+                            &requests.back()),
+                  "MPI_Isend");
+      }
+    }
+    copy_strided_buffer(dst_local.storage_data(),
+                        dst_local.strides(),
+                        dst_stream,
+                        get_block_ptr(0),
+                        src_local.strides(),
+                        src_stream,
+                        block_shape,
+                        elem_size);
+    check_mpi(MPI_Waitall(safe_as<int>(requests.size()),
+                          requests.data(),
+                          MPI_STATUSES_IGNORE),
+              "MPI_Waitall");
+    dst_stream.wait_for_this();
+    return;
+  }
+
+  // Receive CPU data in place. GPU data is received into pinned memory
+  // and each chunk is copied to the GPU once it arrives.
+  bool const is_staged = (dst_local.get_device() != Device::CPU);
+  ManagedBuffer<std::byte> recv_buf(is_staged ? block_bytes : 0,
+                                    Device::CPU,
+                                    cpu_stream,
+                                    MemoryKind::Pinned);
+  std::byte* const dst_ptr = static_cast<std::byte*>(dst_local.storage_data());
+  std::byte* const recv_ptr = is_staged ? recv_buf.data() : dst_ptr;
+  requests.resize(num_chunks, MPI_REQUEST_NULL);
+  for (std::size_t chunk = 0; chunk < num_chunks; ++chunk)
+  {
+    check_mpi(MPI_Irecv(recv_ptr + chunk * chunk_bytes,
+                        safe_as<int>(get_chunk_bytes(chunk)),
+                        MPI_BYTE,
+                        0,
+                        scatter_tag,
+                        mpi_comm,
+                        &requests[chunk]),
+              "MPI_Irecv");
+  }
+  for (std::size_t chunk = 0; chunk < num_chunks; ++chunk)
+  {
+    check_mpi(MPI_Wait(&requests[chunk], MPI_STATUS_IGNORE), "MPI_Wait");
+    if (is_staged)
+    {
+      copy_buffer<void>(dst_ptr + chunk * chunk_bytes,
+                        dst_stream,
+                        recv_ptr + chunk * chunk_bytes,
+                        cpu_stream,
+                        get_chunk_bytes(chunk));
+    }
+  }
+  // The receive buffer must outlive the copies.
+  if (is_staged)
+  {
+    dst_stream.wait_for_this();
+  }
+}
+
+std::size_t get_broadcast_chunk_bytes(std::size_t bytes,
+                                      int comm_size,
+                                      std::size_t elem_size)
+{
+  // Roughly latency times bandwidth on current interconnects.
+  constexpr double latency_bandwidth_bytes = 16384.0;
+  constexpr std::size_t min_chunk_bytes = std::size_t{1} << 16;
+  constexpr std::size_t max_chunk_bytes = std::size_t{1} << 24;
+  static std::size_t const fixed_chunk_bytes =
+    env::get<std::size_t>("BCAST_CHUNK");
+
+  std::size_t chunk_bytes = fixed_chunk_bytes;
+  if (chunk_bytes == 0)
+  {
+    double const depth =
+      std::max(std::log2(static_cast<double>(std::max(comm_size, 2))) - 1.0,
+               1.0);
+    chunk_bytes = static_cast<std::size_t>(std::sqrt(
+      static_cast<double>(bytes) * latency_bandwidth_bytes / depth));
+    chunk_bytes =
+      std::clamp(chunk_bytes, min_chunk_bytes, max_chunk_bytes);
+  }
+  chunk_bytes = std::min(chunk_bytes, bytes);
+  return std::max(chunk_bytes / elem_size, std::size_t{1}) * elem_size;
+}
+
+void broadcast_local(BaseTensor& dst_local,
+                     BaseTensor const& src_local,
+                     Comm& comm)
+{
+  std::size_t const elem_size = dst_local.get_type_info().get_size();
+  std::size_t const bytes =
+    product<std::size_t>(dst_local.shape()) * elem_size;
+  RankType const comm_size = comm.Size();
+  bool const is_root = (comm.Rank() == 0);
+  ComputeStream const& dst_stream = dst_local.get_stream();
+  ComputeStream const cpu_stream{Device::CPU};
+  std::byte* const dst_ptr = static_cast<std::byte*>(dst_local.storage_data());
+
+  // The root's own copy overlaps with the broadcast.
+  if (is_root)
+  {
+    copy_strided_buffer(dst_ptr,
+                        dst_local.strides(),
+                        dst_stream,
+                        src_local.const_storage_data(),
+                        src_local.strides(),
+                        src_local.get_stream(),
+                        dst_local.shape(),
+                        elem_size);
+  }
+  if (comm_size == 1)
+  {
+    return;
+  }
+
+  MPI_Comm const mpi_comm = comm.GetMPIComm();
+  H2_TRACE_SCOPE("h2::broadcast", Comm, dst_stream, bytes);
+  H2_STRAGGLER_ARRIVAL("h2::broadcast", mpi_comm);
+
+  // CPU data is broadcast in place (the root sends from its copy).
+  // GPU data is broadcast through pinned memory, and receivers copy
+  // each chunk to the GPU once it arrives.
+  bool const is_staged = (dst_local.get_device() != Device::CPU);
+  ManagedBuffer<std::byte> staging_buf(
+    is_staged ? bytes : 0, Device::CPU, cpu_stream, MemoryKind::Pinned);
+  std::byte* const buf = is_staged ? staging_buf.data() : dst_ptr;
+  if (is_root)
+  {
+    if (is_staged)
+    {
+      copy_strided_buffer(buf,
+                          get_contiguous_strides(dst_local.shape()),
+                          cpu_stream,
+                          src_local.const_storage_data(),
+                          src_local.strides(),
+                          src_local.get_stream(),
+                          dst_local.shape(),
+                          elem_size);
+      src_local.get_stream().wait_for_this();
+    }
+    else
+    {
+      dst_stream.wait_for_this();
+    }
+  }
+
+  std::size_t const chunk_bytes =
+    get_broadcast_chunk_bytes(bytes, comm_size, elem_size);
+  std::size_t const num_chunks = (bytes + chunk_bytes - 1) / chunk_bytes;
+  auto const get_chunk_bytes = [&](std::size_t chunk) {
+    return std::min(chunk_bytes, bytes - chunk * chunk_bytes);
+  };
+  std::vector<MPI_Request> requests(num_chunks, MPI_REQUEST_NULL);
+  auto const start_chunk = [&](std::size_t chunk) {
+    check_mpi(MPI_Ibcast(buf + chunk * chunk_bytes,
+                         safe_as<int>(get_chunk_bytes(chunk)),
+                         MPI_BYTE,
+                         0,
+                         mpi_comm,
+                         &requests[chunk]),
+              "MPI_Ibcast");
+  };
+  for (std::size_t chunk = 0; chunk < std::min(broadcast_window, num_chunks);
+       ++chunk)
+  {
+    start_chunk(chunk);
+  }
+  for (std::size_t chunk = 0; chunk < num_chunks; ++chunk)
+  {
+    check_mpi(MPI_Wait(&requests[chunk], MPI_STATUS_IGNORE), "MPI_Wait");
+    if (chunk + broadcast_window < num_chunks)
+    {
+      start_chunk(chunk + broadcast_window);
+    }
+    if (is_staged && !is_root)
+    {
+      copy_buffer<void>(dst_ptr + chunk * chunk_bytes,
+                        dst_stream,
+                        buf + chunk * chunk_bytes,
+                        cpu_stream,
+                        get_chunk_bytes(chunk));
+    }
+  }
+  // The staging buffer must outlive the copies.
+  if (is_staged)
+  {
+    dst_stream.wait_for_this();
+  }
+}
+
+}  // namespace internal
+
+void allreduce_compressed(DistTensor<float>& tensor,
+                          DimensionOrderTuple const& dims,
+                          [[maybe_unused]] CommCompression compression,
+                          DistTensor<float>* error_feedback)
+{
+  internal::check_collective_dims(
+    tensor, dims, Distribution::Replicated, "allreduce_compressed");
+  if (error_feedback != nullptr)
+  {
+    H2_ASSERT_ALWAYS(error_feedback->shape() == tensor.shape()
+                       && error_feedback->distribution()
+                            == tensor.distribution()
+                       && error_feedback->proc_grid().is_congruent_to(
+                         tensor.proc_grid())
+                       && error_feedback->get_device() == tensor.get_device(),
+                     "Error feedback must be laid out like the tensor");
+  }
+  if (tensor.is_local_empty() || dims.is_empty())
+  {
+    return;
+  }
+  H2_ASSERT_ALWAYS(tensor.data() != nullptr,
+                   "Cannot allreduce a tensor with no data");
+  H2_ASSERT_ALWAYS(tensor.local_tensor().is_contiguous(),
+                   "Cannot allreduce a tensor with non-contiguous local data");
+  float* error = nullptr;
+  if (error_feedback != nullptr)
+  {
+    H2_ASSERT_ALWAYS(error_feedback->data() != nullptr
+                       && error_feedback->local_tensor().is_contiguous(),
+                     "Error feedback must have contiguous data");
+    error_feedback->get_stream().wait_for(tensor.get_stream());
+    tensor.get_stream().wait_for(error_feedback->get_stream());
+    error = error_feedback->data();
+  }
+
+  Comm& comm = tensor.proc_grid().get_subcomm(dims);
+  std::size_t const count = static_cast<std::size_t>(tensor.local_numel());
+  if (tensor.get_device() == Device::CPU)
+  {
+    float* buf = tensor.data();
+    if (error != nullptr)
+    {
+      std::transform(buf, buf + count, error, buf, std::plus<float>());
+      std::fill(error, error + count, 0.0f);
+    }
+    internal::allreduce_buffer(
+      buf, count, ReductionOp::Sum, comm, Device::CPU, tensor.get_stream());
+  }
+#ifdef H2_HAS_GPU
+  else if (tensor.get_device() == Device::GPU)
+  {
+    internal::allreduce_compressed_gpu(
+      tensor.data(), error, count, compression, comm, tensor.get_stream());
+  }
+#endif
+  else
+  {
+    throw H2Exception("Unknown device ", tensor.get_device());
+  }
+  if (error_feedback != nullptr)
+  {
+    error_feedback->get_stream().wait_for(tensor.get_stream());
+  }
+}
+
+}  // namespace h2
@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/low_precision.hpp"
+#include "h2/loops/gpu_loops.cuh"
+#include "h2/tensor/collectives.hpp"
+#include "h2/utils/As.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <cstddef>
+
+namespace h2
+{
+namespace internal
+{
+
+namespace
+{
+
+#if H2_HAS_GPU_LOW_PRECISION
+
+/**
+ * Send `data` as bytes, since not every backend supports every
+ * low-precision type and the data is only moved, not reduced.
+ */
+template <typename T>
+unsigned char* as_bytes(T* data)
+{
+  return reinterpret_cast<unsigned char*>(data);
+}
+
+template <typename T>
+unsigned char const* as_bytes(T const* data)
+{
+  return reinterpret_cast<unsigned char const*>(data);
+}
+
+template <typename LowT>
+void allreduce_compressed_impl(float* buf,
+                               float* error,
+                               std::size_t count,
+                               Comm& comm,
+                               ComputeStream const& stream)
+{
+  std::size_t const comm_size = static_cast<std::size_t>(comm.Size());
+  std::size_t const chunk = (count + comm_size - 1) / comm_size;
+  int const chunk_bytes = safe_as<int>(chunk * sizeof(LowT));
+  El::SyncInfo<Device::GPU> const sync_info =
+    static_cast<El::SyncInfo<Device::GPU>>(stream);
+  // Padding at the end of the last chunk is never read back.
+  ManagedBuffer<LowT> send_buf(chunk * comm_size, Device::GPU, stream);
+  ManagedBuffer<LowT> recv_buf(chunk * comm_size, Device::GPU, stream);
+  ManagedBuffer<float> sum_buf(chunk, Device::GPU, stream);
+
+  // These are the element-wise conversions `cast` uses, which are
+  // used directly since float and low-precision types need not be
+  // native dispatch pairs.
+  auto const compress = [] H2_GPU_LAMBDA(float const val) -> LowT {
+    return convert_compute_type<LowT>(val);
+  };
+  gpu::launch_elementwise_loop(
+    compress, stream, count, send_buf.data(), buf);
+  if (error != nullptr)
+  {
+    gpu::launch_elementwise_loop(
+      [] H2_GPU_LAMBDA(float const val, LowT const compressed) -> float {
+        return val - convert_compute_type<float>(compressed);
+      },
+      stream,
+      count,
+      error,
+      buf,
+      send_buf.data());
+  }
+
+  // Process i sums chunk i from every process, in float.
+  H2_STRAGGLER_ARRIVAL("h2::allreduce_compressed", comm.GetMPIComm());
+  El::mpi::AllToAll(as_bytes(send_buf.const_data()),
+                    chunk_bytes,
+                    as_bytes(recv_buf.data()),
+                    chunk_bytes,
+                    comm,
+                    sync_info);
+  gpu::launch_elementwise_loop(
+    [] H2_GPU_LAMBDA(LowT const val) -> float {
+      return convert_compute_type<float>(val);
+    },
+    stream,
+    chunk,
+    sum_buf.data(),
+    recv_buf.const_data());
+  for (std::size_t i = 1; i < comm_size; ++i)
+  {
+    gpu::launch_elementwise_loop(
+      [] H2_GPU_LAMBDA(float const sum, LowT const val) -> float {
+        return sum + convert_compute_type<float>(val);
+      },
+      stream,
+      chunk,
+      sum_buf.data(),
+      sum_buf.const_data(),
+      recv_buf.const_data() + i * chunk);
+  }
+
+  gpu::launch_elementwise_loop(
+    compress, stream, chunk, send_buf.data(), sum_buf.const_data());
+  El::mpi::AllGather(as_bytes(send_buf.const_data()),
+                     chunk_bytes,
+                     as_bytes(recv_buf.data()),
+                     chunk_bytes,
+                     comm,
+                     sync_info);
+  gpu::launch_elementwise_loop(
+    [] H2_GPU_LAMBDA(LowT const val) -> float {
+      return convert_compute_type<float>(val);
+    },
+    stream,
+    count,
+    buf,
+    recv_buf.const_data());
+}
+
+#endif  // H2_HAS_GPU_LOW_PRECISION
+
+}  // anonymous namespace
+
+void allreduce_compressed_gpu(float* buf,
+                              float* error,
+                              std::size_t count,
+                              CommCompression compression,
+                              Comm& comm,
+                              ComputeStream const& stream)
+{
+  if (error != nullptr)
+  {
+    gpu::launch_elementwise_loop(
+      [] H2_GPU_LAMBDA(float const val, float const err) -> float {
+        return val + err;
+      },
+      stream,
+      count,
+      buf,
+      buf,
+      error);
+  }
+  // Without compression (or anyone to communicate with), nothing is
+  // lost.
+  if (compression == CommCompression::None || comm.Size() == 1)
+  {
+    if (error != nullptr)
+    {
+      gpu::launch_elementwise_loop(
+        [] H2_GPU_LAMBDA() -> float { return 0.0f; }, stream, count, error);
+    }
+    allreduce_buffer(
+      buf, count, ReductionOp::Sum, comm, Device::GPU, stream);
+    return;
+  }
+
+#if H2_HAS_GPU_LOW_PRECISION
+  switch (compression)
+  {
+  case CommCompression::Half:
+    allreduce_compressed_impl<gpu::Half>(buf, error, count, comm, stream);
+    break;
+  case CommCompression::BFloat16:
+    allreduce_compressed_impl<gpu::BFloat16>(buf, error, count, comm, stream);
+    break;
+  default: throw H2Exception("Unknown compression ", compression);
+  }
+#else
+  throw H2Exception("Compressed allreduces require H2 to be built with "
+                    "H2_ENABLE_GPU_LOW_PRECISION");
+#endif
+}
+
+}  // namespace internal
+}  // namespace h2
@@ -0,0 +1,333 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/compression.hpp"
+
+#include "h2/core/thread_pool.hpp"
+#include "h2/utils/Error.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace h2
+{
+
+namespace
+{
+
+/** Header preceding each compressed frame. */
+struct FrameHeader
+{
+  /** Bytes of input the frame covers. */
+  std::uint64_t raw_bytes;
+  /** Bytes of frame data following the header. */
+  std::uint64_t stored_bytes;
+  /** How the data is stored (a `DataCompression`). */
+  std::uint32_t method;
+  std::uint32_t reserved;
+};
+
+constexpr std::size_t header_bytes = sizeof(FrameHeader);
+
+/** Zero suppression works on groups of this many 4-byte words. */
+constexpr std::size_t group_words = 32;
+constexpr std::size_t group_bytes = group_words * sizeof(std::uint32_t);
+
+/** Maximum number of groups `estimate_compression_ratio` samples. */
+constexpr std::size_t max_sample_groups = 64;
+
+static_assert(internal::compression_block_bytes % group_bytes == 0,
+              "Compression blocks must be whole groups");
+
+double get_max_ratio()
+{
+  static double const max_ratio = env::get<double>("COMPRESSION_MAX_RATIO");
+  return max_ratio;
+}
+
+std::uint32_t load_word(unsigned char const* p)
+{
+  std::uint32_t word;
+  std::memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+/**
+ * Zero-suppress the `bytes` at `src` into `dst`, which has room for
+ * `bytes` bytes.
+ *
+ * Returns the compressed size, or 0 if compression would not make the
+ * data smaller.
+ */
+std::size_t encode_zeros(unsigned char* dst,
+                         unsigned char const* src,
+                         std::size_t bytes)
+{
+  std::size_t const num_words = bytes / sizeof(std::uint32_t);
+  std::size_t pos = 0;
+  for (std::size_t group = 0; group * group_words < num_words; ++group)
+  {
+    std::size_t const first = group * group_words;
+    std::size_t const count = std::min(group_words, num_words - first);
+    std::uint32_t mask = 0;
+    std::size_t nonzeros = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      if (load_word(src + (first + i) * sizeof(std::uint32_t)) != 0)
+      {
+        mask |= std::uint32_t{1} << i;
+        ++nonzeros;
+      }
+    }
+    if (pos + (1 + nonzeros) * sizeof(std::uint32_t) >= bytes)
+    {
+      return 0;
+    }
+    std::memcpy(dst + pos, &mask, sizeof(mask));
+    pos += sizeof(mask);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      if (mask & (std::uint32_t{1} << i))
+      {
+        std::memcpy(dst + pos,
+                    src + (first + i) * sizeof(std::uint32_t),
+                    sizeof(std::uint32_t));
+        pos += sizeof(std::uint32_t);
+      }
+    }
+  }
+  std::size_t const tail = bytes - num_words * sizeof(std::uint32_t);
+  if (pos + tail >= bytes)
+  {
+    return 0;
+  }
+  std::memcpy(dst + pos, src + num_words * sizeof(std::uint32_t), tail);
+  return pos + tail;
+}
+
+/** Expand the `stored_bytes` at `src` from `encode_zeros` into `dst`. */
+void decode_zeros(unsigned char* dst,
+                  std::size_t bytes,
+                  unsigned char const* src,
+                  std::size_t stored_bytes)
+{
+  std::size_t const num_words = bytes / sizeof(std::uint32_t);
+  std::size_t pos = 0;
+  for (std::size_t group = 0; group * group_words < num_words; ++group)
+  {
+    std::size_t const first = group * group_words;
+    std::size_t const count = std::min(group_words, num_words - first);
+    H2_ASSERT_ALWAYS(pos + sizeof(std::uint32_t) <= stored_bytes,
+                     "Truncated compressed data");
+    std::uint32_t const mask = load_word(src + pos);
+    pos += sizeof(mask);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      unsigned char* const word = dst + (first + i) * sizeof(std::uint32_t);
+      if (mask & (std::uint32_t{1} << i))
+      {
+        H2_ASSERT_ALWAYS(pos + sizeof(std::uint32_t) <= stored_bytes,
+                         "Truncated compressed data");
+        std::memcpy(word, src + pos, sizeof(std::uint32_t));
+        pos += sizeof(std::uint32_t);
+      }
+      else
+      {
+        std::memset(word, 0, sizeof(std::uint32_t));
+      }
+    }
+  }
+  std::size_t const tail = bytes - num_words * sizeof(std::uint32_t);
+  H2_ASSERT_ALWAYS(pos + tail == stored_bytes,
+                   "Compressed data does not match its size");
+  std::memcpy(dst + num_words * sizeof(std::uint32_t), src + pos, tail);
+}
+
+}  // anonymous namespace
+
+DataCompression get_data_compression()
+{
+  static DataCompression const compression = []() {
+    std::string const name = env::get<std::string>("COMPRESSION");
+    if (name == "none")
+    {
+      return DataCompression::None;
+    }
+    else if (name == "zeros")
+    {
+      return DataCompression::Zeros;
+    }
+    throw H2FatalException("Unknown data compression '", name, "'");
+  }();
+  return compression;
+}
+
+bool use_compression(std::size_t bytes)
+{
+  static std::size_t const threshold =
+    env::get<std::size_t>("COMPRESSION_THRESHOLD");
+  return get_data_compression() != DataCompression::None && bytes > 0
+         && bytes >= threshold;
+}
+
+namespace internal
+{
+
+double estimate_compression_ratio(void const* buf, std::size_t bytes)
+{
+  std::size_t const num_groups = bytes / group_bytes;
+  if (num_groups == 0)
+  {
+    return 1.0;
+  }
+  auto const* const data = static_cast<unsigned char const*>(buf);
+  std::size_t const num_samples = std::min(num_groups, max_sample_groups);
+  std::size_t nonzeros = 0;
+  for (std::size_t s = 0; s < num_samples; ++s)
+  {
+    unsigned char const* const group =
+      data + (s * num_groups / num_samples) * group_bytes;
+    for (std::size_t i = 0; i < group_words; ++i)
+    {
+      nonzeros += load_word(group + i * sizeof(std::uint32_t)) != 0;
+    }
+  }
+  // Each group stores a mask word and its nonzero words.
+  return static_cast<double>(num_samples + nonzeros)
+         / static_cast<double>(num_samples * group_words);
+}
+
+std::size_t get_max_compressed_size(std::size_t bytes)
+{
+  std::size_t const num_blocks =
+    (bytes + compression_block_bytes - 1) / compression_block_bytes;
+  return bytes + num_blocks * header_bytes;
+}
+
+std::size_t compress(void* dst, void const* src, std::size_t bytes)
+{
+  if (bytes == 0)
+  {
+    return 0;
+  }
+  auto* const out = static_cast<unsigned char*>(dst);
+  auto const* const in = static_cast<unsigned char const*>(src);
+  std::size_t const num_blocks =
+    (bytes + compression_block_bytes - 1) / compression_block_bytes;
+  bool const try_compress =
+    estimate_compression_ratio(src, bytes) <= get_max_ratio();
+
+  // Each frame is first written where it would be if no block
+  // compressed, then frames are packed together.
+  std::size_t const frame_stride = header_bytes + compression_block_bytes;
+  std::vector<std::size_t> frame_sizes(num_blocks);
+  cpu::parallel_for(num_blocks, [&](std::size_t block) {
+    std::size_t const offset = block * compression_block_bytes;
+    std::size_t const raw_bytes =
+      std::min(compression_block_bytes, bytes - offset);
+    unsigned char* const frame = out + block * frame_stride;
+    FrameHeader header{raw_bytes, 0, 0, 0};
+    if (try_compress)
+    {
+      header.stored_bytes =
+        encode_zeros(frame + header_bytes, in + offset, raw_bytes);
+      header.method = static_cast<std::uint32_t>(DataCompression::Zeros);
+    }
+    if (header.stored_bytes == 0)
+    {
+      std::memcpy(frame + header_bytes, in + offset, raw_bytes);
+      header.stored_bytes = raw_bytes;
+      header.method = static_cast<std::uint32_t>(DataCompression::None);
+    }
+    std::memcpy(frame, &header, header_bytes);
+    frame_sizes[block] = header_bytes + header.stored_bytes;
+  });
+  std::size_t size = frame_sizes[0];
+  for (std::size_t block = 1; block < num_blocks; ++block)
+  {
+    std::memmove(out + size, out + block * frame_stride, frame_sizes[block]);
+    size += frame_sizes[block];
+  }
+  return size;
+}
+
+void decompress(void* dst,
+                std::size_t bytes,
+                void const* src,
+                std::size_t compressed_bytes)
+{
+  auto* const out = static_cast<unsigned char*>(dst);
+  auto const* const in = static_cast<unsigned char const*>(src);
+
+  // Find the frames, then expand them in parallel.
+  struct Frame
+  {
+    FrameHeader header;
+    std::size_t in_offset;
+    std::size_t out_offset;
+  };
+  std::vector<Frame> frames;
+  std::size_t in_offset = 0;
+  std::size_t out_offset = 0;
+  while (in_offset < compressed_bytes)
+  {
+    H2_ASSERT_ALWAYS(in_offset + header_bytes <= compressed_bytes,
+                     "Truncated compressed data");
+    Frame frame;
+    std::memcpy(&frame.header, in + in_offset, header_bytes);
+    frame.in_offset = in_offset + header_bytes;
+    frame.out_offset = out_offset;
+    H2_ASSERT_ALWAYS(
+      frame.header.stored_bytes <= compressed_bytes - frame.in_offset
+        && frame.header.raw_bytes <= bytes - out_offset,
+      "Compressed data does not match its size");
+    H2_ASSERT_ALWAYS(
+      frame.header.method == static_cast<std::uint32_t>(DataCompression::None)
+        || frame.header.method
+             == static_cast<std::uint32_t>(DataCompression::Zeros),
+      "Unknown compression method ",
+      frame.header.method);
+    in_offset = frame.in_offset + frame.header.stored_bytes;
+    out_offset += frame.header.raw_bytes;
+    frames.push_back(frame);
+  }
+  H2_ASSERT_ALWAYS(out_offset == bytes,
+                   "Compressed data holds ",
+                   out_offset,
+                   " bytes, expected ",
+                   bytes);
+
+  cpu::parallel_for(frames.size(), [&](std::size_t i) {
+    Frame const& frame = frames[i];
+    if (frame.header.method
+        == static_cast<std::uint32_t>(DataCompression::Zeros))
+    {
+      decode_zeros(out + frame.out_offset,
+                   frame.header.raw_bytes,
+                   in + frame.in_offset,
+                   frame.header.stored_bytes);
+    }
+    else
+    {
+      H2_ASSERT_ALWAYS(frame.header.stored_bytes == frame.header.raw_bytes,
+                       "Compressed data does not match its size");
+      std::memcpy(out + frame.out_offset,
+                  in + frame.in_offset,
+                  frame.header.raw_bytes);
+    }
+  });
+}
+
+}  // namespace internal
+
+}  // namespace h2
@@ -8,6 +8,7 @@
 #include "h2/tensor/copy.hpp"
 
 #include "h2/core/dispatch.hpp"
+#include "h2/core/profiling.hpp"
 #include "h2/loops/cpu_loops.hpp"
 #include "h2/tensor/base_utils.hpp"
 #include "h2/utils/unique_ptr_cast.hpp"
@@ -20,38 +21,150 @@ namespace h2
 namespace internal
 {
 
-void copy_same_type(BaseTensor& dst, BaseTensor const& src)
+namespace
+{
+
+/**
+ * Make `dst` ready to receive a copy of `src`: views must have the same
+ * shape; anything else is resized.
+ */
+void prepare_copy_dst(BaseTensor& dst, BaseTensor const& src)
 {
-  dst.resize(src.shape(), src.dim_types(), src.strides());
-  dst.ensure();
-  if (src.is_contiguous())
+  if (dst.is_view())
   {
-    copy_buffer(dst.storage_data(),
-                dst.get_stream(),
-                src.const_storage_data(),
-                src.get_stream(),
-                src.numel() * src.get_type_info().get_size());
+    // Views cannot be resized, so copy into the viewed region.
+    H2_ASSERT_ALWAYS(!dst.is_const_view(), "Cannot copy into a const view");
+    H2_ASSERT_ALWAYS(dst.shape() == src.shape(),
+                     "Cannot copy a tensor of shape ",
+                     src.shape(),
+                     " into a view of shape ",
+                     dst.shape());
   }
   else
   {
-    // TODO: We may be able to optimize the non-contiguous case.
-    // For now, we just copy the entire buffer.
+    dst.resize(src.shape(), src.dim_types(), src.strides());
+    dst.ensure();
+  }
+}
+
+/** Copy data between same-type tensors of the same shape. */
+void copy_data(BaseTensor& dst, BaseTensor const& src)
+{
+  std::size_t const elem_size = src.get_type_info().get_size();
+  if (src.is_contiguous() && dst.is_contiguous())
+  {
     copy_buffer(dst.storage_data(),
                 dst.get_stream(),
                 src.const_storage_data(),
                 src.get_stream(),
-                get_extent_from_strides(src.shape(), src.strides())
-                  * src.get_type_info().get_size());
+                src.numel() * elem_size);
+  }
+  else
+  {
+    copy_strided_buffer(dst.storage_data(),
+                        dst.strides(),
+                        dst.get_stream(),
+                        src.const_storage_data(),
+                        src.strides(),
+                        src.get_stream(),
+                        src.shape(),
+                        elem_size);
   }
 }
 
+/** Convert `src` into `dst`, which have the same shape and device. */
+void convert_same_device(BaseTensor& dst, BaseTensor const& src)
+{
+  // H2_DISPATCH_NAME: cast
+  // H2_DISPATCH_NUM_TYPES: 2
+  // H2_DISPATCH_INIT_CPU: impl::cast_impl("CPUDev_t", "Tensor<{T1}>&", "const Tensor<{T2}>&")
+  // H2_DISPATCH_INIT_GPU: impl::cast_impl("GPUDev_t", "Tensor<{T1}>&", "const Tensor<{T2}>&")
+
+  // H2_DISPATCH_GET_DEVICE: "src.get_device()"
+  // H2_DISPATCH_ON: "dst", "src"
+  // H2_DISPATCH_ARGS_CPU: "CPUDev_t{}", "dst", "src"
+  // H2_DISPATCH_ARGS_GPU: "GPUDev_t{}", "dst", "src"
+  // H2_DO_DISPATCH
+}
+
+}  // anonymous namespace
+
+void copy_same_type(BaseTensor& dst, BaseTensor const& src)
+{
+  prepare_copy_dst(dst, src);
+  copy_data(dst, src);
+}
+
+void convert_data(BaseTensor& dst, BaseTensor const& src)
+{
+  H2_ASSERT_ALWAYS(is_compute_type(dst.get_type_info())
+                     && is_compute_type(src.get_type_info()),
+                   "Data type conversion in copy requires compute types");
+  if (dst.get_device() == src.get_device())
+  {
+    convert_same_device(dst, src);
+    return;
+  }
+#ifdef H2_HAS_GPU
+  // Convert on the side where the data being transferred is narrower.
+  // When both are the same size, convert on the GPU.
+  std::size_t const dst_size = dst.get_type_info().get_size();
+  std::size_t const src_size = src.get_type_info().get_size();
+  bool const convert_on_src = (dst_size != src_size)
+                                ? (dst_size < src_size)
+                                : (src.get_device() == Device::GPU);
+  if (convert_on_src)
+  {
+    auto tmp = base::make_tensor(dst.get_type_info(),
+                                 src.get_device(),
+                                 src.shape(),
+                                 src.dim_types(),
+                                 {},
+                                 StrictAlloc,
+                                 src.get_stream());
+    convert_same_device(*tmp, src);
+    copy_data(dst, *tmp);
+  }
+  else
+  {
+    auto tmp = base::make_tensor(src.get_type_info(),
+                                 dst.get_device(),
+                                 src.shape(),
+                                 src.dim_types(),
+                                 {},
+                                 StrictAlloc,
+                                 dst.get_stream());
+    copy_data(*tmp, src);
+    if (tmp->get_device() == Device::CPU)
+    {
+      // The transfer is asynchronous on the source's GPU stream.
+      src.get_stream().wait_for_this();
+    }
+    convert_same_device(dst, *tmp);
+  }
+#else   // H2_HAS_GPU
+  throw H2Exception("Unknown device combination ",
+                    src.get_device(),
+                    " and ",
+                    dst.get_device());
+#endif  // H2_HAS_GPU
+}
+
+void copy_convert(BaseTensor& dst, BaseTensor const& src)
+{
+  prepare_copy_dst(dst, src);
+  convert_data(dst, src);
+}
+
 }  // namespace internal
 
 template <typename DstT>
 std::unique_ptr<Tensor<DstT>> cast(BaseTensor& src)
 {
+  H2_PROFILE_RANGE("h2::cast", Compute);
   // H2_DISPATCH_NAME: cast
   // H2_DISPATCH_NUM_TYPES: 1
+  // H2_DISPATCH_NATIVE_IF: "IsNativeDispatchPair_v<DstT, {T1}>"
   // H2_DISPATCH_INIT_CPU: impl::cast_impl("CPUDev_t", "Tensor<DstT>&", "const Tensor<{T1}>&")
   // H2_DISPATCH_INIT_GPU: impl::cast_impl("GPUDev_t", "Tensor<DstT>&", "const Tensor<{T1}>&")
 
@@ -84,6 +197,7 @@ H2_INSTANTIATE_DEV_1(none)
 
 std::unique_ptr<BaseTensor> cast(const TypeInfo& type, BaseTensor& src)
 {
+  H2_PROFILE_RANGE("h2::cast", Compute);
   // H2_DISPATCH_NAME: cast
   // H2_DISPATCH_NUM_TYPES: 2
   // H2_DISPATCH_INIT_CPU: impl::cast_impl("CPUDev_t", "Tensor<{T1}>&", "const Tensor<{T2}>&")
@@ -117,21 +231,25 @@ namespace impl
 template <typename DstT, typename SrcT>
 void cast_impl(CPUDev_t, Tensor<DstT>& dst, Tensor<SrcT> const& src)
 {
-  static_assert(std::is_convertible_v<SrcT, DstT>,
+  static_assert(IsComputeConvertible_v<SrcT, DstT>,
                 "Attempt to cast between inconvertible types");
   SrcT const* __restrict__ src_buf = src.const_data();
   DstT* __restrict__ dst_buf = dst.data();
-  if (src.is_contiguous())
+  auto const cast_func = [](SrcT const val) -> DstT {
+    return convert_compute_type<DstT>(val);
+  };
+  if (src.is_contiguous() && dst.is_contiguous())
   {
-    h2::cpu::elementwise_loop(
-      [](SrcT const val) -> DstT { return static_cast<DstT>(val); },
-      dst.numel(),
-      dst_buf,
-      src_buf);
+    h2::cpu::parallel_elementwise_loop(
+      cast_func, dst.numel(), dst_buf, src_buf);
   }
   else
   {
-    throw H2FatalException("Not currently supporting non-contiguous cast");
+    h2::cpu::strided_elementwise_loop(cast_func,
+                                      src.shape(),
+                                      {dst.strides(), src.strides()},
+                                      dst_buf,
+                                      src_buf);
   }
 }
 
@@ -140,6 +258,35 @@ void cast_impl(CPUDev_t, Tensor<DstT>& dst, Tensor<SrcT> const& src)
 H2_INSTANTIATE_CPU_2
 #undef PROTO
 
+template <typename DstT, typename SrcT>
+void cast_scale_bias_impl(CPUDev_t,
+                          Tensor<DstT>& dst,
+                          Tensor<SrcT> const& src,
+                          DstT scale,
+                          DstT bias)
+{
+  SrcT const* __restrict__ src_buf = src.const_data();
+  DstT* __restrict__ dst_buf = dst.data();
+  auto const func = [scale, bias](SrcT const val) -> DstT {
+    return scale * static_cast<DstT>(val) + bias;
+  };
+  if (src.is_contiguous() && dst.is_contiguous())
+  {
+    h2::cpu::parallel_elementwise_loop(func, dst.numel(), dst_buf, src_buf);
+  }
+  else
+  {
+    h2::cpu::strided_elementwise_loop(
+      func, src.shape(), {dst.strides(), src.strides()}, dst_buf, src_buf);
+  }
+}
+
+#define PROTO(device, t1, t2)                                                  \
+  template void cast_scale_bias_impl<t1, t2>(                                  \
+    device, Tensor<t1>&, const Tensor<t2>&, t1, t1)
+H2_INSTANTIATE_CAST_SCALE_BIAS(CPUDev_t);
+#undef PROTO
+
 }  // namespace impl
 
 }  // namespace h2
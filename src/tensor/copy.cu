@@ -18,31 +18,77 @@ namespace impl
 template <typename DstT, typename SrcT>
 void cast_impl(GPUDev_t, Tensor<DstT>& dst, Tensor<SrcT> const& src)
 {
-  static_assert(std::is_convertible_v<SrcT, DstT>,
+  static_assert(IsComputeConvertible_v<SrcT, DstT>,
                 "Attempt to cast between inconvertible types");
   SrcT const* __restrict__ src_buf = src.const_data();
   DstT* __restrict__ dst_buf = dst.data();
   auto stream = create_multi_sync(dst.get_stream(), src.get_stream());
-  if (src.is_contiguous())
+  auto const cast_func = [] H2_GPU_LAMBDA(SrcT const val) -> DstT {
+    return convert_compute_type<DstT>(val);
+  };
+  if (src.is_contiguous() && dst.is_contiguous())
   {
     h2::gpu::launch_elementwise_loop(
-      [] H2_GPU_LAMBDA(SrcT const val) -> DstT {
-        return static_cast<DstT>(val);
+      cast_func, stream, dst.numel(), dst_buf, src_buf);
+  }
+  else
+  {
+    h2::gpu::launch_strided_elementwise_loop(cast_func,
+                                             stream,
+                                             src.shape(),
+                                             {dst.strides(), src.strides()},
+                                             dst_buf,
+                                             src_buf);
+  }
+}
+
+#define PROTO(device, t1, t2)                                                  \
+  template void cast_impl<t1, t2>(device, Tensor<t1>&, const Tensor<t2>&)
+H2_INSTANTIATE_GPU_2
+#undef PROTO
+
+template <typename DstT, typename SrcT>
+void cast_scale_bias_impl(GPUDev_t,
+                          Tensor<DstT>& dst,
+                          Tensor<SrcT> const& src,
+                          DstT scale,
+                          DstT bias)
+{
+  SrcT const* __restrict__ src_buf = src.const_data();
+  DstT* __restrict__ dst_buf = dst.data();
+  auto stream = create_multi_sync(dst.get_stream(), src.get_stream());
+  if (src.is_contiguous() && dst.is_contiguous())
+  {
+    // Pass the scale and bias as an immediate so they stay in
+    // registers rather than in the lambda's captures.
+    h2::gpu::launch_elementwise_loop_with_immediate(
+      [] H2_GPU_LAMBDA(ScaleBias<DstT> const sb, SrcT const val) -> DstT {
+        return sb.scale * static_cast<DstT>(val) + sb.bias;
       },
       stream,
       dst.numel(),
+      ScaleBias<DstT>{scale, bias},
       dst_buf,
       src_buf);
   }
   else
   {
-    throw H2FatalException("Not currently supporting non-contiguous cast");
+    h2::gpu::launch_strided_elementwise_loop(
+      [scale, bias] H2_GPU_LAMBDA(SrcT const val) -> DstT {
+        return scale * static_cast<DstT>(val) + bias;
+      },
+      stream,
+      src.shape(),
+      {dst.strides(), src.strides()},
+      dst_buf,
+      src_buf);
   }
 }
 
 #define PROTO(device, t1, t2)                                                  \
-  template void cast_impl<t1, t2>(device, Tensor<t1>&, const Tensor<t2>&)
-H2_INSTANTIATE_GPU_2
+  template void cast_scale_bias_impl<t1, t2>(                                  \
+    device, Tensor<t1>&, const Tensor<t2>&, t1, t1)
+H2_INSTANTIATE_CAST_SCALE_BIAS(GPUDev_t);
 #undef PROTO
 
 }  // namespace impl
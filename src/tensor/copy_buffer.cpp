@@ -0,0 +1,692 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/copy_buffer.hpp"
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/stream_pool.hpp"
+#include "h2/core/thread_pool.hpp"
+#include "h2/loops/cpu_loops.hpp"
+#include "h2/loops/strided_loop_helpers.hpp"
+#include "h2/tensor/strided_memory.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <utility>
+
+namespace h2
+{
+
+namespace
+{
+
+/** Edge length of the tiles used to copy transposed layouts. */
+constexpr DataIndexType tile_size = 32;
+
+/**
+ * Return the largest word size (up to 8 bytes) that elements of
+ * `elem_size` bytes at `dst` and `src` may be copied in.
+ */
+std::size_t get_word_size(void* dst, void const* src, std::size_t elem_size)
+{
+  auto const dst_addr = reinterpret_cast<std::uintptr_t>(dst);
+  auto const src_addr = reinterpret_cast<std::uintptr_t>(src);
+  for (std::size_t word_size : {8, 4, 2})
+  {
+    if (elem_size % word_size == 0 && dst_addr % word_size == 0
+        && src_addr % word_size == 0)
+    {
+      return word_size;
+    }
+  }
+  return 1;
+}
+
+/**
+ * Shape and strides of a strided copy, counted in words rather than
+ * elements.
+ *
+ * Each element becomes an innermost dimension of words.
+ */
+struct WordLayout
+{
+  ShapeTuple shape;
+  StrideTuple dst_strides;
+  StrideTuple src_strides;
+};
+
+WordLayout make_word_layout(ShapeTuple const& shape,
+                            StrideTuple const& dst_strides,
+                            StrideTuple const& src_strides,
+                            std::size_t words_per_elem)
+{
+  // Collapse first, so copies of tensors of the maximum rank can still
+  // be done in words and the copy kernels see the fewest dimensions.
+  auto const collapsed =
+    collapse_strided_layout<2>(shape, {dst_strides, src_strides});
+  if (words_per_elem == 1)
+  {
+    return {collapsed.shape, collapsed.strides[0], collapsed.strides[1]};
+  }
+  H2_ASSERT_ALWAYS(collapsed.shape.size() < MAX_TENSOR_DIMS,
+                   "Cannot copy elements of a tensor with ",
+                   collapsed.shape.size(),
+                   " dimensions in words");
+  auto const n = static_cast<DataIndexType>(words_per_elem);
+  WordLayout layout;
+  layout.shape.append(n);
+  layout.dst_strides.append(1);
+  layout.src_strides.append(1);
+  for (typename ShapeTuple::size_type d = 0; d < collapsed.shape.size(); ++d)
+  {
+    layout.shape.append(collapsed.shape[d]);
+    layout.dst_strides.append(collapsed.strides[0][d] * n);
+    layout.src_strides.append(collapsed.strides[1][d] * n);
+  }
+  return layout;
+}
+
+/** Return the number of blocks to split `numel` elements of work into. */
+std::size_t get_num_blocks(DataIndexType numel, DataIndexType max_blocks)
+{
+  return std::min({cpu::get_num_threads(),
+                   static_cast<std::size_t>(numel)
+                     / cpu::get_parallel_loop_grain_size(),
+                   static_cast<std::size_t>(max_blocks)});
+}
+
+/**
+ * Call `f(start, end)` on blocks of the range [0, `size`), in
+ * parallel if there is at least `work_per_item * size` work.
+ */
+template <typename FuncT>
+void parallel_range(DataIndexType size, DataIndexType work_per_item, FuncT f)
+{
+  std::size_t const num_blocks = get_num_blocks(size * work_per_item, size);
+  if (num_blocks <= 1)
+  {
+    f(DataIndexType{0}, size);
+    return;
+  }
+  DataIndexType const block_size =
+    (size + static_cast<DataIndexType>(num_blocks) - 1)
+    / static_cast<DataIndexType>(num_blocks);
+  cpu::parallel_for(num_blocks, [&](std::size_t block) {
+    DataIndexType const start = static_cast<DataIndexType>(block) * block_size;
+    f(start, std::min(start + block_size, size));
+  });
+}
+
+/** Copy a strided layout whose innermost dimension is contiguous. */
+void copy_rows_cpu(unsigned char* dst,
+                   unsigned char const* src,
+                   StridedLoopLayout<2> const& layout,
+                   std::size_t word_size)
+{
+  DataIndexType const row_size = layout.shape[0];
+  DataIndexType const num_rows = layout.numel() / row_size;
+  std::size_t const row_bytes = static_cast<std::size_t>(row_size) * word_size;
+  auto const copy_rows = [&](DataIndexType start, DataIndexType end) {
+    for (DataIndexType row = start; row < end; ++row)
+    {
+      DataIndexType offsets[2];
+      layout.get_offsets(row * row_size, offsets);
+      std::memcpy(dst + offsets[0] * word_size,
+                  src + offsets[1] * word_size,
+                  row_bytes);
+    }
+  };
+  parallel_range(num_rows, row_size, copy_rows);
+}
+
+/**
+ * Copy a strided layout where `dst` is contiguous in dimension 0 and
+ * `src` in dimension `t`, in tiles of those two dimensions so both are
+ * read and written in cache-line-sized runs.
+ */
+template <typename WordT>
+void copy_tiled_cpu(WordT* dst,
+                    WordT const* src,
+                    StridedLoopLayout<2> const& layout,
+                    int t)
+{
+  // Iteration space of the remaining dimensions.
+  StridedLoopLayout<2> outer;
+  for (int d = 1; d < layout.ndim; ++d)
+  {
+    if (d == t)
+    {
+      continue;
+    }
+    outer.shape[outer.ndim] = layout.shape[d];
+    outer.strides[0][outer.ndim] = layout.strides[0][d];
+    outer.strides[1][outer.ndim] = layout.strides[1][d];
+    ++outer.ndim;
+  }
+  DataIndexType const num_outer = (outer.ndim == 0) ? 1 : outer.numel();
+  DataIndexType const size0 = layout.shape[0];
+  DataIndexType const extent_t = layout.shape[t];
+  DataIndexType const tiles0 = (size0 + tile_size - 1) / tile_size;
+  DataIndexType const tiles_t = (extent_t + tile_size - 1) / tile_size;
+  DataIndexType const dst_t_stride = layout.strides[0][t];
+  DataIndexType const src_0_stride = layout.strides[1][0];
+  DataIndexType const num_tiles = num_outer * tiles0 * tiles_t;
+
+  auto const copy_tiles = [&](DataIndexType start, DataIndexType end) {
+    for (DataIndexType tile = start; tile < end; ++tile)
+    {
+      DataIndexType const tile0 = tile % tiles0;
+      DataIndexType const tile_t = (tile / tiles0) % tiles_t;
+      DataIndexType offsets[2] = {0, 0};
+      if (outer.ndim > 0)
+      {
+        outer.get_offsets(tile / (tiles0 * tiles_t), offsets);
+      }
+      DataIndexType const i0_end = std::min((tile0 + 1) * tile_size, size0);
+      DataIndexType const it_end = std::min((tile_t + 1) * tile_size, extent_t);
+      for (DataIndexType it = tile_t * tile_size; it < it_end; ++it)
+      {
+        WordT* dst_row = dst + offsets[0] + it * dst_t_stride;
+        WordT const* src_col = src + offsets[1] + it;
+        for (DataIndexType i0 = tile0 * tile_size; i0 < i0_end; ++i0)
+        {
+          dst_row[i0] = src_col[i0 * src_0_stride];
+        }
+      }
+    }
+  };
+  parallel_range(num_tiles, tile_size * tile_size, copy_tiles);
+}
+
+template <typename WordT>
+void copy_strided_cpu(void* dst, void const* src, WordLayout const& words)
+{
+  StridedLoopLayout<2> const layout = make_strided_loop_layout<2>(
+    words.shape, {words.dst_strides, words.src_strides});
+  if (layout.strides[0][0] == 1 && layout.strides[1][0] == 1)
+  {
+    copy_rows_cpu(static_cast<unsigned char*>(dst),
+                  static_cast<unsigned char const*>(src),
+                  layout,
+                  sizeof(WordT));
+    return;
+  }
+  if (layout.strides[0][0] == 1)
+  {
+    for (int t = 1; t < layout.ndim; ++t)
+    {
+      if (layout.strides[1][t] == 1)
+      {
+        copy_tiled_cpu(static_cast<WordT*>(dst),
+                       static_cast<WordT const*>(src),
+                       layout,
+                       t);
+        return;
+      }
+    }
+  }
+  cpu::strided_elementwise_loop([](WordT x) -> WordT { return x; },
+                                words.shape,
+                                {words.dst_strides, words.src_strides},
+                                static_cast<WordT*>(dst),
+                                static_cast<WordT const*>(src));
+}
+
+void copy_strided_cpu(void* dst,
+                      void const* src,
+                      WordLayout const& words,
+                      std::size_t word_size)
+{
+  switch (word_size)
+  {
+  case 8: copy_strided_cpu<std::uint64_t>(dst, src, words); break;
+  case 4: copy_strided_cpu<std::uint32_t>(dst, src, words); break;
+  case 2: copy_strided_cpu<std::uint16_t>(dst, src, words); break;
+  default: copy_strided_cpu<std::uint8_t>(dst, src, words); break;
+  }
+}
+
+#ifdef H2_HAS_GPU
+
+/**
+ * Attempt to copy with a pitched 2D or 3D copy, returning whether the
+ * layout allowed it.
+ */
+bool try_pitched_copy(void* dst,
+                      void const* src,
+                      StridedLoopLayout<2> const& layout,
+                      std::size_t word_size,
+                      gpu::DeviceStream stream)
+{
+  if (layout.ndim < 2 || layout.ndim > 3 || layout.strides[0][0] != 1
+      || layout.strides[1][0] != 1)
+  {
+    return false;
+  }
+  // Rows must not overlap.
+  for (std::size_t b = 0; b < 2; ++b)
+  {
+    if (layout.strides[b][1] < layout.shape[0])
+    {
+      return false;
+    }
+  }
+  auto const bytes = [&](DataIndexType words) {
+    return static_cast<std::size_t>(words) * word_size;
+  };
+  std::size_t const width = bytes(layout.shape[0]);
+  if (layout.ndim == 2)
+  {
+    gpu::mem_copy_2d(dst,
+                     bytes(layout.strides[0][1]),
+                     src,
+                     bytes(layout.strides[1][1]),
+                     width,
+                     static_cast<std::size_t>(layout.shape[1]),
+                     stream);
+    return true;
+  }
+  // Slices must be a whole number of rows apart, and not overlap.
+  for (std::size_t b = 0; b < 2; ++b)
+  {
+    if (layout.strides[b][2] % layout.strides[b][1] != 0
+        || layout.strides[b][2] / layout.strides[b][1] < layout.shape[1])
+    {
+      return false;
+    }
+  }
+  gpu::mem_copy_3d(
+    dst,
+    bytes(layout.strides[0][1]),
+    static_cast<std::size_t>(layout.strides[0][2] / layout.strides[0][1]),
+    src,
+    bytes(layout.strides[1][1]),
+    static_cast<std::size_t>(layout.strides[1][2] / layout.strides[1][1]),
+    width,
+    static_cast<std::size_t>(layout.shape[1]),
+    static_cast<std::size_t>(layout.shape[2]),
+    stream);
+  return true;
+}
+
+/** Copy between strided buffers on the same device. */
+void copy_strided_same_device(void* dst,
+                              void const* src,
+                              WordLayout const& words,
+                              std::size_t word_size,
+                              ComputeStream const& stream)
+{
+  if (stream.get_device() == Device::CPU)
+  {
+    copy_strided_cpu(dst, src, words, word_size);
+    return;
+  }
+  StridedLoopLayout<2> const layout = make_strided_loop_layout<2>(
+    words.shape, {words.dst_strides, words.src_strides});
+  if (!try_pitched_copy(
+        dst, src, layout, word_size, stream.get_stream<Device::GPU>()))
+  {
+    internal::copy_strided_buffer_gpu(dst,
+                                      words.dst_strides,
+                                      src,
+                                      words.src_strides,
+                                      words.shape,
+                                      word_size,
+                                      stream);
+  }
+}
+
+/** Return true if two GPU buffers are on the same GPU. */
+bool are_on_same_gpu(void const* buf1, void const* buf2)
+{
+  static int const num_gpus = gpu::num_gpus();
+  return num_gpus < 2
+         || gpu::get_mem_device(buf1) == gpu::get_mem_device(buf2);
+}
+
+/**
+ * Enable access from GPU `device` to GPU `peer`, if possible.
+ *
+ * This is only attempted once for each pair of GPUs.
+ */
+void ensure_peer_access(int device, int peer)
+{
+  static std::mutex mutex;
+  static std::set<std::pair<int, int>> attempted;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!attempted.insert({device, peer}).second)
+  {
+    return;
+  }
+  if (gpu::can_access_peer(device, peer))
+  {
+    gpu::CurrentGPUGuard const guard(device);
+    gpu::enable_peer_access(peer);
+  }
+}
+
+/** A contiguous temporary buffer for staging copies between devices. */
+class StagingBuffer
+{
+public:
+  StagingBuffer(std::size_t bytes_, ComputeStream const& stream_)
+    : bytes(bytes_), stream(stream_)
+  {
+    H2_DEVICE_DISPATCH_SAME(
+      stream.get_device(),
+      (buf = internal::Allocator<unsigned char, Dev>::allocate(bytes,
+                                                               stream)));
+  }
+
+  ~StagingBuffer()
+  {
+    // GPU memory is released in stream order; CPU staging memory is
+    // pageable, so transfers from it have consumed it on return.
+    if (stream.get_device() == Device::CPU)
+    {
+      internal::Allocator<unsigned char, Device::CPU>::deallocate(buf, stream);
+    }
+    else
+    {
+      internal::Allocator<unsigned char, Device::GPU>::deallocate(buf, stream);
+    }
+  }
+
+  StagingBuffer(StagingBuffer const&) = delete;
+  StagingBuffer& operator=(StagingBuffer const&) = delete;
+
+  unsigned char* data() const noexcept { return buf; }
+
+private:
+  std::size_t bytes;
+  ComputeStream stream;
+  unsigned char* buf = nullptr;
+};
+
+#endif  // H2_HAS_GPU
+
+}  // anonymous namespace
+
+#ifdef H2_HAS_GPU
+namespace internal
+{
+
+bool use_pipelined_copy(void const* host_ptr, std::size_t bytes)
+{
+  static std::size_t const threshold =
+    env::get<std::size_t>("COPY_PIPELINE_THRESHOLD");
+  return threshold > 0 && bytes > threshold
+         && gpu::is_pageable_host_memory(host_ptr);
+}
+
+void copy_buffer_pipelined(void* dst,
+                           ComputeStream const& dst_stream,
+                           void const* src,
+                           ComputeStream const& src_stream,
+                           std::size_t bytes)
+{
+  static std::size_t const chunk_bytes =
+    std::max(env::get<std::size_t>("COPY_PIPELINE_CHUNK"), std::size_t{1});
+  bool const to_device = (dst_stream.get_device() == Device::GPU);
+  ComputeStream const& gpu_stream = to_device ? dst_stream : src_stream;
+  auto* const dst_bytes = static_cast<unsigned char*>(dst);
+  auto const* const src_bytes = static_cast<unsigned char const*>(src);
+
+  // Chunks alternate between the GPU stream and a pool stream, which
+  // first waits for work already enqueued on the GPU stream. Each
+  // staging buffer is only used by one stream, and its event marks
+  // when the last transfer using it finished.
+  gpu::DeviceStream const streams[2] = {
+    gpu_stream.get_stream<Device::GPU>(),
+    get_gpu_pool_stream(StreamPriority::Normal).get_stream<Device::GPU>()};
+  gpu::DeviceEvent const events[2] = {gpu::get_pooled_event(),
+                                      gpu::get_pooled_event()};
+  unsigned char* const staging[2] = {
+    static_cast<unsigned char*>(pinned_allocate(chunk_bytes)),
+    static_cast<unsigned char*>(pinned_allocate(chunk_bytes))};
+  gpu::DeviceEvent const start_event = gpu::get_pooled_event();
+  gpu::record_event(start_event, streams[0]);
+  gpu::sync(streams[1], start_event);
+  gpu::release_pooled_event(start_event);
+
+  // Host copies to and from staging are multithreaded to keep up with
+  // the DMA engines.
+  auto const host_copy = [](unsigned char* to,
+                            unsigned char const* from,
+                            std::size_t n) {
+    parallel_range(static_cast<DataIndexType>(n),
+                   1,
+                   [&](DataIndexType start, DataIndexType end) {
+                     std::memcpy(to + start,
+                                 from + start,
+                                 static_cast<std::size_t>(end - start));
+                   });
+  };
+  std::size_t const num_chunks = (bytes + chunk_bytes - 1) / chunk_bytes;
+  auto const chunk_size = [&](std::size_t chunk) {
+    return std::min(chunk_bytes, bytes - chunk * chunk_bytes);
+  };
+  // Enqueue the device-to-host transfer of `chunk`.
+  auto const start_d2h = [&](std::size_t chunk) {
+    std::size_t const b = chunk % 2;
+    gpu::mem_copy(staging[b],
+                  src_bytes + chunk * chunk_bytes,
+                  chunk_size(chunk),
+                  streams[b]);
+    gpu::record_event(events[b], streams[b]);
+  };
+
+  if (to_device)
+  {
+    for (std::size_t chunk = 0; chunk < num_chunks; ++chunk)
+    {
+      std::size_t const b = chunk % 2;
+      // The staging buffer is free once its previous transfer is done.
+      gpu::sync(events[b]);
+      host_copy(staging[b], src_bytes + chunk * chunk_bytes, chunk_size(chunk));
+      gpu::mem_copy(dst_bytes + chunk * chunk_bytes,
+                    staging[b],
+                    chunk_size(chunk),
+                    streams[b]);
+      gpu::record_event(events[b], streams[b]);
+    }
+  }
+  else
+  {
+    // Keep both staging buffers in flight: while one chunk is copied
+    // out on the host, the next is transferred into the other buffer.
+    for (std::size_t chunk = 0; chunk < std::min(num_chunks, std::size_t{2});
+         ++chunk)
+    {
+      start_d2h(chunk);
+    }
+    for (std::size_t chunk = 0; chunk < num_chunks; ++chunk)
+    {
+      std::size_t const b = chunk % 2;
+      gpu::sync(events[b]);
+      host_copy(dst_bytes + chunk * chunk_bytes, staging[b], chunk_size(chunk));
+      if (chunk + 2 < num_chunks)
+      {
+        start_d2h(chunk + 2);
+      }
+    }
+  }
+
+  // Later work on the GPU stream must follow the pool stream's chunks,
+  // and the staging buffers must outlive their transfers.
+  gpu::sync(streams[0], events[1]);
+  for (std::size_t b = 0; b < 2; ++b)
+  {
+    gpu::sync(events[b]);
+    pinned_deallocate(staging[b]);
+    gpu::release_pooled_event(events[b]);
+  }
+}
+
+bool copy_buffer_peer(void* dst,
+                      ComputeStream const& dst_stream,
+                      void const* src,
+                      ComputeStream const& src_stream,
+                      std::size_t bytes)
+{
+  if (bytes == 0 || are_on_same_gpu(dst, src))
+  {
+    return false;
+  }
+  int const src_device = gpu::get_mem_device(src);
+  int const dst_device = gpu::get_mem_device(dst);
+  ensure_peer_access(dst_device, src_device);
+
+  // Events must be recorded (and returned to the pool) on the GPU they
+  // were obtained from, but streams may wait on events from any GPU.
+  gpu::CurrentGPUGuard const guard;
+  gpu::DeviceStream const dst_raw = dst_stream.get_stream<Device::GPU>();
+  gpu::DeviceStream const src_raw = src_stream.get_stream<Device::GPU>();
+  gpu::set_gpu(src_device);
+  gpu::DeviceEvent const src_event = gpu::get_pooled_event();
+  gpu::record_event(src_event, src_raw);
+  gpu::set_gpu(dst_device);
+  gpu::sync(dst_raw, src_event);
+  gpu::mem_copy_peer(dst, dst_device, src, src_device, bytes, dst_raw);
+  gpu::DeviceEvent const dst_event = gpu::get_pooled_event();
+  gpu::record_event(dst_event, dst_raw);
+  gpu::sync(src_raw, dst_event);
+  gpu::release_pooled_event(dst_event);
+  gpu::set_gpu(src_device);
+  gpu::release_pooled_event(src_event);
+  return true;
+}
+
+}  // namespace internal
+#endif  // H2_HAS_GPU
+
+void copy_strided_buffer(void* dst,
+                         StrideTuple const& dst_strides,
+                         ComputeStream const& dst_stream,
+                         void const* src,
+                         StrideTuple const& src_strides,
+                         ComputeStream const& src_stream,
+                         ShapeTuple const& shape,
+                         std::size_t elem_size)
+{
+  H2_PROFILE_RANGE("h2::copy_strided_buffer", Copy);
+  H2_ASSERT_ALWAYS(dst_strides.size() == shape.size()
+                     && src_strides.size() == shape.size(),
+                   "Strides ",
+                   dst_strides,
+                   " and ",
+                   src_strides,
+                   " do not match shape ",
+                   shape);
+  if (shape.is_empty() || product<DataIndexType>(shape) == 0)
+  {
+    return;
+  }
+  H2_ASSERT_DEBUG(dst != nullptr && src != nullptr, "Null buffers");
+  H2_TRACE_SCOPE("h2::copy_strided_buffer",
+                 Copy,
+                 (dst_stream.get_device() != Device::CPU) ? dst_stream
+                                                          : src_stream,
+                 product<std::size_t>(shape) * elem_size);
+  std::size_t const word_size = get_word_size(dst, src, elem_size);
+  WordLayout const words = make_word_layout(
+    shape, dst_strides, src_strides, elem_size / word_size);
+  StridedLoopLayout<2> const layout = make_strided_loop_layout<2>(
+    words.shape, {words.dst_strides, words.src_strides});
+  if (layout.is_contiguous())
+  {
+    copy_buffer(dst,
+                dst_stream,
+                src,
+                src_stream,
+                static_cast<std::size_t>(layout.numel()) * word_size);
+    return;
+  }
+
+  Device const src_dev = src_stream.get_device();
+  Device const dst_dev = dst_stream.get_device();
+  if (src_dev == Device::CPU && dst_dev == Device::CPU)
+  {
+    copy_strided_cpu(dst, src, words, word_size);
+    return;
+  }
+#ifdef H2_HAS_GPU
+  if (src_dev == Device::GPU && dst_dev == Device::GPU)
+  {
+    H2_ASSERT_ALWAYS(are_on_same_gpu(dst, src),
+                     "Strided copies between GPUs are not supported, copy "
+                     "contiguous buffers instead");
+    auto stream = create_multi_sync(dst_stream, src_stream);
+    copy_strided_same_device(dst, src, words, word_size, stream);
+    return;
+  }
+  // Between devices, the copy is enqueued on the GPU stream.
+  ComputeStream const& gpu_stream =
+    (src_dev == Device::GPU) ? src_stream : dst_stream;
+  if (try_pitched_copy(
+        dst, src, layout, word_size, gpu_stream.get_stream<Device::GPU>()))
+  {
+    return;
+  }
+  // Gather into a contiguous buffer on the source device, transfer
+  // that, and scatter from a contiguous buffer on the destination
+  // device, skipping the staging buffers for contiguous sides.
+  StridedLoopLayout<1> const src_layout =
+    make_strided_loop_layout<1>(words.shape, {words.src_strides});
+  StridedLoopLayout<1> const dst_layout =
+    make_strided_loop_layout<1>(words.shape, {words.dst_strides});
+  std::size_t const bytes =
+    static_cast<std::size_t>(layout.numel()) * word_size;
+  StrideTuple const contiguous_strides = get_contiguous_strides(words.shape);
+  std::unique_ptr<StagingBuffer> src_staging;
+  void const* send_buf = src;
+  if (!src_layout.is_contiguous())
+  {
+    src_staging = std::make_unique<StagingBuffer>(bytes, src_stream);
+    copy_strided_same_device(
+      src_staging->data(),
+      src,
+      {words.shape, contiguous_strides, words.src_strides},
+      word_size,
+      src_stream);
+    send_buf = src_staging->data();
+  }
+  std::unique_ptr<StagingBuffer> dst_staging;
+  void* recv_buf = dst;
+  if (!dst_layout.is_contiguous())
+  {
+    dst_staging = std::make_unique<StagingBuffer>(bytes, dst_stream);
+    recv_buf = dst_staging->data();
+  }
+  copy_buffer(recv_buf, dst_stream, send_buf, src_stream, bytes);
+  if (dst_staging)
+  {
+    if (dst_dev == Device::CPU)
+    {
+      // The transfer is asynchronous on the GPU stream.
+      src_stream.wait_for_this();
+    }
+    copy_strided_same_device(
+      dst,
+      recv_buf,
+      {words.shape, words.dst_strides, contiguous_strides},
+      word_size,
+      dst_stream);
+  }
+#else   // H2_HAS_GPU
+  throw H2Exception("Unknown device combination ", src_dev, " and ", dst_dev);
+#endif  // H2_HAS_GPU
+}
+
+}  // namespace h2
@@ -0,0 +1,221 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/loops/gpu_loops.cuh"
+#include "h2/tensor/copy_buffer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace h2
+{
+
+namespace kernels
+{
+
+/** Side length of the tiles used by `tiled_transpose`. */
+constexpr unsigned int transpose_tile_size = 32;
+/** Rows of a tile handled by each thread row of `tiled_transpose`. */
+constexpr unsigned int transpose_block_rows = 8;
+
+/**
+ * Copy a strided layout where `dst` is contiguous in one dimension
+ * and `src` in another, through tiles in shared memory so both reads
+ * and writes are coalesced.
+ *
+ * Block x indexes the tiles of the two dimensions, and block y loops
+ * over the iteration space of the remaining dimensions, `outer`.
+ */
+template <typename WordT>
+H2_GPU_GLOBAL void tiled_transpose(WordT* dst,
+                                   WordT const* src,
+                                   StridedLoopLayout<2> outer,
+                                   DataIndexType num_outer,
+                                   DataIndexType size0,
+                                   DataIndexType extent_t,
+                                   DataIndexType dst_t_stride,
+                                   DataIndexType src_0_stride)
+{
+  // Padding avoids bank conflicts when reading columns of the tile.
+  __shared__ WordT tile[transpose_tile_size][transpose_tile_size + 1];
+
+  DataIndexType const tiles0 =
+    (size0 + transpose_tile_size - 1) / transpose_tile_size;
+  DataIndexType const start0 = (blockIdx.x % tiles0) * transpose_tile_size;
+  DataIndexType const start_t = (blockIdx.x / tiles0) * transpose_tile_size;
+  for (DataIndexType outer_i = blockIdx.y; outer_i < num_outer;
+       outer_i += gridDim.y)
+  {
+    DataIndexType offsets[2] = {0, 0};
+    if (outer.ndim > 0)
+    {
+      outer.get_offsets(outer_i, offsets);
+    }
+    // Read along the contiguous dimension of src...
+    DataIndexType const it_read = start_t + threadIdx.x;
+    for (unsigned int j = threadIdx.y; j < transpose_tile_size;
+         j += transpose_block_rows)
+    {
+      DataIndexType const i0 = start0 + j;
+      if (i0 < size0 && it_read < extent_t)
+      {
+        tile[j][threadIdx.x] = src[offsets[1] + i0 * src_0_stride + it_read];
+      }
+    }
+    __syncthreads();
+    // ... and write along the contiguous dimension of dst.
+    DataIndexType const i0_write = start0 + threadIdx.x;
+    for (unsigned int j = threadIdx.y; j < transpose_tile_size;
+         j += transpose_block_rows)
+    {
+      DataIndexType const it = start_t + j;
+      if (i0_write < size0 && it < extent_t)
+      {
+        dst[offsets[0] + it * dst_t_stride + i0_write] = tile[threadIdx.x][j];
+      }
+    }
+    __syncthreads();
+  }
+}
+
+}  // namespace kernels
+
+namespace
+{
+
+/**
+ * Attempt to copy with `tiled_transpose`, returning whether the
+ * layout allowed it.
+ */
+template <typename WordT>
+bool try_tiled_transpose(void* dst,
+                         StrideTuple const& dst_strides,
+                         void const* src,
+                         StrideTuple const& src_strides,
+                         ShapeTuple const& shape,
+                         ComputeStream const& stream)
+{
+  StridedLoopLayout<2> const layout =
+    make_strided_loop_layout<2>(shape, {dst_strides, src_strides});
+  if (layout.ndim < 2 || layout.strides[0][0] != 1)
+  {
+    return false;
+  }
+  int t = 1;
+  while (t < layout.ndim && layout.strides[1][t] != 1)
+  {
+    ++t;
+  }
+  if (t == layout.ndim)
+  {
+    return false;
+  }
+  // Iteration space of the remaining dimensions.
+  StridedLoopLayout<2> outer;
+  for (int d = 1; d < layout.ndim; ++d)
+  {
+    if (d == t)
+    {
+      continue;
+    }
+    outer.shape[outer.ndim] = layout.shape[d];
+    outer.strides[0][outer.ndim] = layout.strides[0][d];
+    outer.strides[1][outer.ndim] = layout.strides[1][d];
+    ++outer.ndim;
+  }
+  DataIndexType const num_outer = (outer.ndim == 0) ? 1 : outer.numel();
+  DataIndexType const size0 = layout.shape[0];
+  DataIndexType const extent_t = layout.shape[t];
+  DataIndexType const num_tiles =
+    ((size0 + kernels::transpose_tile_size - 1) / kernels::transpose_tile_size)
+    * ((extent_t + kernels::transpose_tile_size - 1)
+       / kernels::transpose_tile_size);
+  if (num_tiles > static_cast<DataIndexType>(gpu::max_grid_x))
+  {
+    return false;
+  }
+  dim3 const grid_dim(
+    static_cast<unsigned int>(num_tiles),
+    static_cast<unsigned int>(std::min(
+      num_outer, static_cast<DataIndexType>(gpu::max_grid_y))));
+  dim3 const block_dim(kernels::transpose_tile_size,
+                       kernels::transpose_block_rows);
+  gpu::launch_kernel(kernels::tiled_transpose<WordT>,
+                     grid_dim,
+                     block_dim,
+                     0,
+                     stream.get_stream<Device::GPU>(),
+                     static_cast<WordT*>(dst),
+                     static_cast<WordT const*>(src),
+                     outer,
+                     num_outer,
+                     size0,
+                     extent_t,
+                     layout.strides[0][t],
+                     layout.strides[1][0]);
+  return true;
+}
+
+template <typename WordT>
+void launch_strided_copy(void* dst,
+                         StrideTuple const& dst_strides,
+                         void const* src,
+                         StrideTuple const& src_strides,
+                         ShapeTuple const& shape,
+                         ComputeStream const& stream)
+{
+  if (try_tiled_transpose<WordT>(
+        dst, dst_strides, src, src_strides, shape, stream))
+  {
+    return;
+  }
+  h2::gpu::launch_strided_elementwise_loop(
+    [] H2_GPU_LAMBDA(WordT const x) -> WordT { return x; },
+    stream,
+    shape,
+    {dst_strides, src_strides},
+    static_cast<WordT*>(dst),
+    static_cast<WordT const*>(src));
+}
+
+}  // anonymous namespace
+
+namespace internal
+{
+
+void copy_strided_buffer_gpu(void* dst,
+                             StrideTuple const& dst_strides,
+                             void const* src,
+                             StrideTuple const& src_strides,
+                             ShapeTuple const& shape,
+                             std::size_t word_size,
+                             ComputeStream const& stream)
+{
+  switch (word_size)
+  {
+  case 8:
+    launch_strided_copy<std::uint64_t>(
+      dst, dst_strides, src, src_strides, shape, stream);
+    break;
+  case 4:
+    launch_strided_copy<std::uint32_t>(
+      dst, dst_strides, src, src_strides, shape, stream);
+    break;
+  case 2:
+    launch_strided_copy<std::uint16_t>(
+      dst, dst_strides, src, src_strides, shape, stream);
+    break;
+  default:
+    launch_strided_copy<std::uint8_t>(
+      dst, dst_strides, src, src_strides, shape, stream);
+    break;
+  }
+}
+
+}  // namespace internal
+
+}  // namespace h2
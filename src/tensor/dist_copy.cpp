@@ -0,0 +1,529 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/copy.hpp"
+
+#include "h2/core/allocator.hpp"
+#include "h2/tensor/comm_plan_cache.hpp"
+#include "h2/tensor/compression.hpp"
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/strided_memory.hpp"
+#include "h2/tensor/tensor_utils.hpp"
+#include "h2/utils/As.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <mpi.h>
+
+namespace h2
+{
+namespace internal
+{
+
+namespace
+{
+
+void check_mpi(int ret, char const* what)
+{
+  if (ret != MPI_SUCCESS)
+  {
+    char msg[MPI_MAX_ERROR_STRING];
+    int len = 0;
+    MPI_Error_string(ret, msg, &len);
+    throw H2Exception(
+      what, " failed while redistributing: ", std::string(msg, len));
+  }
+}
+
+/**
+ * Return true if `src_rank` provides its block of a tensor distributed
+ * with `dist` over `grid` to `dst_rank`.
+ *
+ * A rank takes data from the ranks with the same grid coordinates in
+ * every replicated dimension. The blocks of these partition the tensor
+ * and include the rank's own block, so data already present locally is
+ * never communicated.
+ */
+bool is_source_for(ProcessorGrid const& grid,
+                   DistributionTypeTuple const& dist,
+                   RankType src_rank,
+                   RankType dst_rank)
+{
+  for (typename DistributionTypeTuple::size_type i = 0; i < dist.size(); ++i)
+  {
+    if (dist[i] == Distribution::Replicated
+        && grid.get_dimension_rank(i, src_rank)
+             != grid.get_dimension_rank(i, dst_rank))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Global indices of a tensor held by a rank.
+ *
+ * In dimension `i`, these are `start[i] + j * step[i]` for `j` in
+ * `[0, shape[i])`, which are at local index `j`. The step is 1 except
+ * for Cyclic distributions.
+ */
+struct StridedBlock
+{
+  ScalarIndexTuple start;
+  ShapeTuple shape;
+  StrideTuple step;
+
+  bool is_empty() const noexcept { return shape.is_empty(); }
+};
+
+/** Return the global indices `grid_rank` holds. */
+StridedBlock get_strided_block(ShapeTuple const& global_shape,
+                               ProcessorGrid const& grid,
+                               DistributionTypeTuple const& dist,
+                               BlockSizesTuple const& block_sizes,
+                               RankType grid_rank)
+{
+  ShapeTuple const shape =
+    get_local_shape(global_shape, grid, dist, grid_rank, block_sizes);
+  if (shape.is_empty())
+  {
+    return StridedBlock{};
+  }
+  return StridedBlock{get_index_range_start(get_global_indices(
+                        global_shape, grid, dist, grid_rank, block_sizes)),
+                      shape,
+                      get_global_index_strides(grid, dist)};
+}
+
+/** Return the intersection of two blocks, or an empty block. */
+StridedBlock intersect_blocks(StridedBlock const& block1,
+                              StridedBlock const& block2)
+{
+  if (block1.is_empty() || block2.is_empty())
+  {
+    return StridedBlock{};
+  }
+  StridedBlock region;
+  for (typename ShapeTuple::size_type i = 0; i < block1.shape.size(); ++i)
+  {
+    DimType const start1 = block1.start[i];
+    DimType const start2 = block2.start[i];
+    DimType const step1 = block1.step[i];
+    DimType const step2 = block2.step[i];
+    DimType const low = std::max(start1, start2);
+    DimType const high = std::min(start1 + (block1.shape[i] - 1) * step1,
+                                  start2 + (block2.shape[i] - 1) * step2);
+    if (low > high)
+    {
+      return StridedBlock{};
+    }
+    // The common indices are spaced by the least common multiple of
+    // the steps. Find the first by walking through block1's indices;
+    // if there is one, it is within the first step / step1 of them.
+    DimType const step = std::lcm(step1, step2);
+    DimType first = start1 + ((low - start1 + step1 - 1) / step1) * step1;
+    for (DimType j = 1; j < step / step1 && (first - start2) % step2 != 0;
+         ++j)
+    {
+      first += step1;
+    }
+    if (first > high || (first - start2) % step2 != 0)
+    {
+      return StridedBlock{};
+    }
+    region.start.append(first);
+    region.shape.append((high - first) / step + 1);
+    region.step.append(step);
+  }
+  return region;
+}
+
+/**
+ * Return the address of the global indices `region` in `local`, which
+ * holds the global indices `block`.
+ */
+template <typename PtrT>
+PtrT get_region_ptr(PtrT local_data,
+                    StrideTuple const& local_strides,
+                    StridedBlock const& block,
+                    StridedBlock const& region,
+                    std::size_t elem_size)
+{
+  DataIndexType offset = 0;
+  for (typename ShapeTuple::size_type i = 0; i < region.shape.size(); ++i)
+  {
+    offset += ((region.start[i] - block.start[i]) / block.step[i])
+              * local_strides[i];
+  }
+  using ByteT = std::conditional_t<
+    std::is_const_v<std::remove_pointer_t<PtrT>>,
+    std::byte const,
+    std::byte>;
+  return static_cast<PtrT>(static_cast<ByteT*>(local_data)
+                           + offset * static_cast<DataIndexType>(elem_size));
+}
+
+/**
+ * Return the strides of the global indices `region` in `local`, which
+ * holds the global indices `block`.
+ */
+StrideTuple get_region_strides(StrideTuple const& local_strides,
+                               StridedBlock const& block,
+                               StridedBlock const& region)
+{
+  return map_index(local_strides, [&](StrideTuple::size_type i) {
+    return local_strides[i] * (region.step[i] / block.step[i]);
+  });
+}
+
+/** A region exchanged with another rank. */
+struct Message
+{
+  RankType peer;
+  StridedBlock region;
+  std::size_t offset;  /**< Byte offset in the packed buffer. */
+  std::size_t bytes;
+};
+
+/**
+ * Precomputed communication for redistributing a tensor from one
+ * distribution to another on one rank.
+ */
+struct RedistributionPlan
+{
+  StridedBlock src_block;   /**< Global indices of the local source. */
+  StridedBlock dst_block;   /**< Global indices of the local target. */
+  StridedBlock self_region; /**< Region copied locally. */
+  std::vector<Message> sends;
+  std::vector<Message> recvs;
+  /** Per-rank byte counts and displacements for `MPI_Alltoallv`. */
+  std::vector<int> send_counts, send_displs, recv_counts, recv_displs;
+  std::size_t send_bytes = 0;
+  std::size_t recv_bytes = 0;
+};
+
+RedistributionPlan make_plan(ProcessorGrid const& dst_grid,
+                             DistributionTypeTuple const& dst_dist,
+                             BlockSizesTuple const& dst_block_sizes,
+                             ProcessorGrid const& src_grid,
+                             DistributionTypeTuple const& src_dist,
+                             BlockSizesTuple const& src_block_sizes,
+                             ShapeTuple const& global_shape,
+                             std::size_t elem_size)
+{
+  RankType const num_ranks = dst_grid.size();
+  RankType const my_rank = dst_grid.rank();
+  RedistributionPlan plan;
+  plan.src_block = get_strided_block(
+    global_shape, src_grid, src_dist, src_block_sizes, my_rank);
+  plan.dst_block = get_strided_block(
+    global_shape, dst_grid, dst_dist, dst_block_sizes, my_rank);
+  plan.self_region = intersect_blocks(plan.src_block, plan.dst_block);
+  plan.send_counts.assign(num_ranks, 0);
+  plan.send_displs.assign(num_ranks, 0);
+  plan.recv_counts.assign(num_ranks, 0);
+  plan.recv_displs.assign(num_ranks, 0);
+
+  // Plan which regions to send to and receive from each other rank.
+  // Peers are visited in rank order, so each rank's data is contiguous
+  // in the packed buffers as `MPI_Alltoallv` requires.
+  for (RankType peer = 0; peer < num_ranks; ++peer)
+  {
+    plan.send_displs[peer] = safe_as<int>(plan.send_bytes);
+    plan.recv_displs[peer] = safe_as<int>(plan.recv_bytes);
+    if (peer == my_rank)
+    {
+      continue;
+    }
+    StridedBlock const send_region =
+      is_source_for(src_grid, src_dist, my_rank, peer)
+        ? intersect_blocks(
+            plan.src_block,
+            get_strided_block(
+              global_shape, dst_grid, dst_dist, dst_block_sizes, peer))
+        : StridedBlock{};
+    StridedBlock const recv_region =
+      is_source_for(src_grid, src_dist, peer, my_rank)
+        ? intersect_blocks(
+            get_strided_block(
+              global_shape, src_grid, src_dist, src_block_sizes, peer),
+            plan.dst_block)
+        : StridedBlock{};
+    if (!send_region.is_empty())
+    {
+      std::size_t const bytes =
+        product<std::size_t>(send_region.shape) * elem_size;
+      plan.sends.push_back({peer, send_region, plan.send_bytes, bytes});
+      plan.send_counts[peer] = safe_as<int>(bytes);
+      plan.send_bytes += bytes;
+    }
+    if (!recv_region.is_empty())
+    {
+      std::size_t const bytes =
+        product<std::size_t>(recv_region.shape) * elem_size;
+      plan.recvs.push_back({peer, recv_region, plan.recv_bytes, bytes});
+      plan.recv_counts[peer] = safe_as<int>(bytes);
+      plan.recv_bytes += bytes;
+    }
+  }
+  return plan;
+}
+
+/**
+ * Cache of redistribution plans.
+ *
+ * Training loops perform the same redistributions every iteration, so
+ * this saves recomputing every rank pair's overlap.
+ */
+CommPlanCache<RedistributionPlan>& get_plan_cache()
+{
+  static CommPlanCache<RedistributionPlan> cache;
+  return cache;
+}
+
+/** Compressed messages of a redistribution and their layout. */
+struct CompressedMessages
+{
+  std::vector<std::byte> send_buf, recv_buf;
+  std::vector<int> send_counts, send_displs, recv_counts, recv_displs;
+};
+
+/**
+ * Compress each message packed in `send_buf` for `plan` and exchange
+ * the compressed sizes with the other ranks in `comm`, so the
+ * compressed messages can be exchanged with `MPI_Alltoallv`.
+ */
+CompressedMessages compress_messages(RedistributionPlan const& plan,
+                                     std::byte const* send_buf,
+                                     MPI_Comm comm)
+{
+  std::size_t const num_ranks = plan.send_counts.size();
+  CompressedMessages msgs;
+  msgs.send_counts.assign(num_ranks, 0);
+  msgs.send_displs.assign(num_ranks, 0);
+  msgs.recv_counts.assign(num_ranks, 0);
+  msgs.recv_displs.assign(num_ranks, 0);
+
+  std::size_t max_send_bytes = 0;
+  for (auto const& msg : plan.sends)
+  {
+    max_send_bytes += get_max_compressed_size(msg.bytes);
+  }
+  msgs.send_buf.resize(max_send_bytes);
+  std::size_t send_bytes = 0;
+  for (auto const& msg : plan.sends)
+  {
+    std::size_t const bytes = compress(
+      msgs.send_buf.data() + send_bytes, send_buf + msg.offset, msg.bytes);
+    msgs.send_counts[msg.peer] = safe_as<int>(bytes);
+    msgs.send_displs[msg.peer] = safe_as<int>(send_bytes);
+    send_bytes += bytes;
+  }
+
+  check_mpi(MPI_Alltoall(msgs.send_counts.data(),
+                         1,
+                         MPI_INT,
+                         msgs.recv_counts.data(),
+                         1,
+                         MPI_INT,
+                         comm),
+            "MPI_Alltoall");
+  std::size_t recv_bytes = 0;
+  for (std::size_t peer = 0; peer < num_ranks; ++peer)
+  {
+    msgs.recv_displs[peer] = safe_as<int>(recv_bytes);
+    recv_bytes += msgs.recv_counts[peer];
+  }
+  msgs.recv_buf.resize(recv_bytes);
+  return msgs;
+}
+
+/** Decompress the received messages of `plan` into `recv_buf`. */
+void decompress_messages(RedistributionPlan const& plan,
+                         CompressedMessages const& msgs,
+                         std::byte* recv_buf)
+{
+  for (auto const& msg : plan.recvs)
+  {
+    decompress(recv_buf + msg.offset,
+               msg.bytes,
+               msgs.recv_buf.data() + msgs.recv_displs[msg.peer],
+               msgs.recv_counts[msg.peer]);
+  }
+}
+
+}  // anonymous namespace
+
+void redistribute(BaseTensor& dst_local,
+                  ProcessorGrid const& dst_grid,
+                  DistributionTypeTuple const& dst_dist,
+                  BaseTensor const& src_local,
+                  ProcessorGrid const& src_grid,
+                  DistributionTypeTuple const& src_dist,
+                  ShapeTuple const& global_shape,
+                  BlockSizesTuple const& dst_block_sizes,
+                  BlockSizesTuple const& src_block_sizes)
+{
+  H2_ASSERT_ALWAYS(src_grid.is_similar_to(dst_grid),
+                   "Cannot redistribute between grids of different "
+                   "processes");
+  H2_ASSERT_ALWAYS(src_local.get_type_info() == dst_local.get_type_info(),
+                   "Cannot redistribute between different types");
+  std::size_t const elem_size = src_local.get_type_info().get_size();
+  std::shared_ptr<RedistributionPlan const> const plan_ptr =
+    get_plan_cache().get(make_comm_plan_key(global_shape,
+                                            src_grid,
+                                            src_dist,
+                                            dst_grid,
+                                            dst_dist,
+                                            elem_size,
+                                            src_block_sizes,
+                                            dst_block_sizes),
+                         [&]() {
+                           return make_plan(dst_grid,
+                                            dst_dist,
+                                            dst_block_sizes,
+                                            src_grid,
+                                            src_dist,
+                                            src_block_sizes,
+                                            global_shape,
+                                            elem_size);
+                         });
+  RedistributionPlan const& plan = *plan_ptr;
+
+  // MPI cannot use device buffers here, so messages are packed into
+  // host buffers (pinned, if the data is on a GPU).
+  ComputeStream const cpu_stream{Device::CPU};
+  MemoryKind const send_kind = (src_local.get_device() == Device::CPU)
+                                 ? MemoryKind::Default
+                                 : MemoryKind::Pinned;
+  MemoryKind const recv_kind = (dst_local.get_device() == Device::CPU)
+                                 ? MemoryKind::Default
+                                 : MemoryKind::Pinned;
+  ManagedBuffer<std::byte> send_buf(
+    plan.send_bytes, Device::CPU, cpu_stream, send_kind);
+  ManagedBuffer<std::byte> recv_buf(
+    plan.recv_bytes, Device::CPU, cpu_stream, recv_kind);
+
+  for (auto const& msg : plan.sends)
+  {
+    copy_strided_buffer(send_buf.data() + msg.offset,
+                        get_contiguous_strides(msg.region.shape),
+                        cpu_stream,
+                        get_region_ptr(src_local.const_storage_data(),
+                                       src_local.strides(),
+                                       plan.src_block,
+                                       msg.region,
+                                       elem_size),
+                        get_region_strides(
+                          src_local.strides(), plan.src_block, msg.region),
+                        src_local.get_stream(),
+                        msg.region.shape,
+                        elem_size);
+  }
+  if (!plan.sends.empty())
+  {
+    src_local.get_stream().wait_for_this();
+    cpu_stream.wait_for_this();
+  }
+
+  // Exchange with one collective; ranks that exchange nothing with a
+  // peer have zero counts for it. Large tensors may be compressed
+  // first; this depends only on the global size, so all ranks agree.
+  MPI_Comm const comm = dst_grid.comm().GetMPIComm();
+  bool const compress_msgs =
+    use_compression(product<std::size_t>(global_shape) * elem_size);
+  CompressedMessages compressed;
+  if (compress_msgs)
+  {
+    compressed = compress_messages(plan, send_buf.const_data(), comm);
+  }
+  MPI_Request request = MPI_REQUEST_NULL;
+  check_mpi(MPI_Ialltoallv(compress_msgs ? compressed.send_buf.data()
+                                         : send_buf.data(),
+                           compress_msgs ? compressed.send_counts.data()
+                                         : plan.send_counts.data(),
+                           compress_msgs ? compressed.send_displs.data()
+                                         : plan.send_displs.data(),
+                           MPI_BYTE,
+                           compress_msgs ? compressed.recv_buf.data()
+                                         : recv_buf.data(),
+                           compress_msgs ? compressed.recv_counts.data()
+                                         : plan.recv_counts.data(),
+                           compress_msgs ? compressed.recv_displs.data()
+                                         : plan.recv_displs.data(),
+                           MPI_BYTE,
+                           comm,
+                           &request),
+            "MPI_Ialltoallv");
+
+  // Overlap the local part with communication.
+  if (!plan.self_region.is_empty())
+  {
+    copy_strided_buffer(get_region_ptr(dst_local.storage_data(),
+                                       dst_local.strides(),
+                                       plan.dst_block,
+                                       plan.self_region,
+                                       elem_size),
+                        get_region_strides(dst_local.strides(),
+                                           plan.dst_block,
+                                           plan.self_region),
+                        dst_local.get_stream(),
+                        get_region_ptr(src_local.const_storage_data(),
+                                       src_local.strides(),
+                                       plan.src_block,
+                                       plan.self_region,
+                                       elem_size),
+                        get_region_strides(src_local.strides(),
+                                           plan.src_block,
+                                           plan.self_region),
+                        src_local.get_stream(),
+                        plan.self_region.shape,
+                        elem_size);
+  }
+
+  check_mpi(MPI_Wait(&request, MPI_STATUS_IGNORE), "MPI_Wait");
+  if (compress_msgs)
+  {
+    decompress_messages(plan, compressed, recv_buf.data());
+  }
+
+  for (auto const& msg : plan.recvs)
+  {
+    copy_strided_buffer(get_region_ptr(dst_local.storage_data(),
+                                       dst_local.strides(),
+                                       plan.dst_block,
+                                       msg.region,
+                                       elem_size),
+                        get_region_strides(
+                          dst_local.strides(), plan.dst_block, msg.region),
+                        dst_local.get_stream(),
+                        recv_buf.data() + msg.offset,
+                        get_contiguous_strides(msg.region.shape),
+                        cpu_stream,
+                        msg.region.shape,
+                        elem_size);
+  }
+  // The receive buffer must outlive the copies.
+  if (!plan.recvs.empty())
+  {
+    dst_local.get_stream().wait_for_this();
+  }
+}
+
+}  // namespace internal
+}  // namespace h2
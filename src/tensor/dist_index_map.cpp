@@ -0,0 +1,255 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/dist_index_map.hpp"
+
+#include "h2/core/thread_pool.hpp"
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/utils/As.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+namespace h2
+{
+namespace internal
+{
+
+namespace
+{
+
+/**
+ * Number of points each task handles on the CPU.
+ *
+ * Each task makes one pass per dimension over its points, so the
+ * inner loops are over contiguous arrays and can be vectorized.
+ */
+constexpr std::size_t points_per_task = 4096;
+
+}  // anonymous namespace
+
+Global2OwnerMap make_global2owner_map(ShapeTuple const& global_shape,
+                                      ShapeTuple const& grid_shape,
+                                      NDimTuple<RankType> const& grid_strides,
+                                      ScalarIndexTuple const& coords,
+                                      DistributionTypeTuple const& dist)
+{
+  H2_ASSERT_ALWAYS(global_shape.size() == grid_shape.size()
+                     && global_shape.size() == dist.size()
+                     && grid_strides.size() == grid_shape.size()
+                     && coords.size() == grid_shape.size(),
+                   "Tensor shape (",
+                   global_shape,
+                   "), grid shape (",
+                   grid_shape,
+                   "), and distribution (",
+                   dist,
+                   ") must have the same number of dimensions");
+  Global2OwnerMap map;
+  map.ndim = static_cast<NDimType>(global_shape.size());
+  for (typename ShapeTuple::size_type d = 0; d < global_shape.size(); ++d)
+  {
+    H2_ASSERT_ALWAYS(dist[d] == Distribution::Block
+                       || dist[d] == Distribution::Replicated
+                       || dist[d] == Distribution::Single
+                       || dist[d] == Distribution::Cyclic,
+                     "Invalid distribution ",
+                     dist[d]);
+    map.dims[d].dist = dist[d];
+    map.dims[d].dim_size = global_shape[d];
+    map.dims[d].grid_dim_size = grid_shape[d];
+    map.dims[d].fixed_rank =
+      (dist[d] == Distribution::Replicated) ? safe_as<RankType>(coords[d]) : 0;
+    map.dims[d].grid_stride = grid_strides[d];
+  }
+  return map;
+}
+
+Local2GlobalMap make_local2global_map(ShapeTuple const& global_shape,
+                                      ShapeTuple const& grid_shape,
+                                      ScalarIndexTuple const& coords,
+                                      DistributionTypeTuple const& dist)
+{
+  H2_ASSERT_ALWAYS(global_shape.size() == grid_shape.size()
+                     && global_shape.size() == dist.size()
+                     && coords.size() == grid_shape.size(),
+                   "Tensor shape (",
+                   global_shape,
+                   "), grid shape (",
+                   grid_shape,
+                   "), and distribution (",
+                   dist,
+                   ") must have the same number of dimensions");
+  Local2GlobalMap map;
+  map.ndim = static_cast<NDimType>(global_shape.size());
+  for (typename ShapeTuple::size_type d = 0; d < global_shape.size(); ++d)
+  {
+    RankType const dim_rank = safe_as<RankType>(coords[d]);
+    DimLocal2GlobalMap& dim_map = map.dims[d];
+    dim_map.start = 0;
+    dim_map.step = 1;
+    switch (dist[d])
+    {
+    case Distribution::Block:
+      dim_map.local_size = get_dim_local_size<Distribution::Block>(
+        global_shape[d], grid_shape[d], dim_rank, false);
+      dim_map.start = get_dim_global_indices<Distribution::Block>(
+                        global_shape[d], grid_shape[d], dim_rank, false)
+                        .start();
+      break;
+    case Distribution::Cyclic:
+      dim_map.local_size = get_dim_local_size<Distribution::Cyclic>(
+        global_shape[d], grid_shape[d], dim_rank, false);
+      dim_map.start = dim_rank;
+      dim_map.step = grid_shape[d];
+      break;
+    case Distribution::Replicated:
+      dim_map.local_size = global_shape[d];
+      break;
+    case Distribution::Single:
+      dim_map.local_size = (dim_rank == 0) ? global_shape[d] : 0;
+      break;
+    default: throw H2Exception("Invalid distribution ", dist[d]);
+    }
+  }
+  return map;
+}
+
+void global2owner_indices_impl(CPUDev_t,
+                               Global2OwnerMap const& map,
+                               std::size_t count,
+                               DimType const* global_indices,
+                               RankType* ranks,
+                               DataIndexType* local_offsets,
+                               ComputeStream const& /*stream*/)
+{
+  std::size_t const num_tasks =
+    (count + points_per_task - 1) / points_per_task;
+  cpu::parallel_for(num_tasks, [&](std::size_t task) {
+    std::size_t const start = task * points_per_task;
+    std::size_t const end = std::min(count, start + points_per_task);
+    std::array<DataIndexType, points_per_task> strides;
+    std::fill_n(ranks + start, end - start, RankType{0});
+    std::fill_n(local_offsets + start, end - start, DataIndexType{0});
+    std::fill_n(strides.begin(), end - start, DataIndexType{1});
+    for (NDimType d = 0; d < map.ndim; ++d)
+    {
+      DimGlobal2OwnerMap const dim_map = map.dims[d];
+      DimType const* dim_indices = global_indices + d * count;
+      for (std::size_t i = start; i < end; ++i)
+      {
+        DimType local_index = 0;
+        DimType local_size = 0;
+        RankType const dim_rank =
+          dim_global2owner(dim_map, dim_indices[i], local_index, local_size);
+        ranks[i] += dim_rank * dim_map.grid_stride;
+        local_offsets[i] += local_index * strides[i - start];
+        strides[i - start] *= local_size;
+      }
+    }
+  });
+}
+
+void local2global_indices_impl(CPUDev_t,
+                               Local2GlobalMap const& map,
+                               std::size_t count,
+                               DataIndexType const* local_offsets,
+                               DimType* global_indices,
+                               ComputeStream const& /*stream*/)
+{
+  std::size_t const num_tasks =
+    (count + points_per_task - 1) / points_per_task;
+  cpu::parallel_for(num_tasks, [&](std::size_t task) {
+    std::size_t const start = task * points_per_task;
+    std::size_t const end = std::min(count, start + points_per_task);
+    std::array<DataIndexType, points_per_task> remaining;
+    std::copy(
+      local_offsets + start, local_offsets + end, remaining.begin());
+    for (NDimType d = 0; d < map.ndim; ++d)
+    {
+      DimLocal2GlobalMap const dim_map = map.dims[d];
+      DimType* dim_indices = global_indices + d * count;
+      for (std::size_t i = start; i < end; ++i)
+      {
+        DimType const local_index = remaining[i - start] % dim_map.local_size;
+        remaining[i - start] /= dim_map.local_size;
+        dim_indices[i] = dim_map.start + local_index * dim_map.step;
+      }
+    }
+  });
+}
+
+}  // namespace internal
+
+void global2owner_indices(Device device,
+                          ShapeTuple const& global_shape,
+                          ProcessorGrid const& grid,
+                          DistributionTypeTuple const& dist,
+                          std::size_t count,
+                          DimType const* global_indices,
+                          RankType* ranks,
+                          DataIndexType* local_offsets,
+                          ComputeStream const& stream)
+{
+  if (count == 0)
+  {
+    return;
+  }
+  internal::Global2OwnerMap const map = internal::make_global2owner_map(
+    global_shape, grid.shape(), grid.strides(), grid.coords(), dist);
+  H2_DEVICE_DISPATCH_SAME(device,
+                          internal::global2owner_indices_impl(DeviceT_v<Dev>,
+                                                              map,
+                                                              count,
+                                                              global_indices,
+                                                              ranks,
+                                                              local_offsets,
+                                                              stream));
+}
+
+void local2global_indices(Device device,
+                          ShapeTuple const& global_shape,
+                          ProcessorGrid const& grid,
+                          DistributionTypeTuple const& dist,
+                          RankType rank,
+                          std::size_t count,
+                          DataIndexType const* local_offsets,
+                          DimType* global_indices,
+                          ComputeStream const& stream)
+{
+  if (count == 0)
+  {
+    return;
+  }
+  internal::Local2GlobalMap const map = internal::make_local2global_map(
+    global_shape, grid.shape(), grid.coords(rank), dist);
+  for (NDimType d = 0; d < map.ndim; ++d)
+  {
+    H2_ASSERT_ALWAYS(map.dims[d].local_size > 0,
+                     "Rank ",
+                     rank,
+                     " has no local data of a tensor of shape ",
+                     global_shape,
+                     " distributed ",
+                     dist,
+                     " on grid ",
+                     grid.shape());
+  }
+  H2_DEVICE_DISPATCH_SAME(device,
+                          internal::local2global_indices_impl(DeviceT_v<Dev>,
+                                                              map,
+                                                              count,
+                                                              local_offsets,
+                                                              global_indices,
+                                                              stream));
+}
+
+}  // namespace h2
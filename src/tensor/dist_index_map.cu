@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/gpu/runtime.hpp"
+#include "h2/tensor/dist_index_map.hpp"
+
+#include <cstddef>
+
+namespace h2
+{
+
+namespace kernels
+{
+
+/** Map one global index per thread to its owner. */
+__global__ void global2owner_indices(internal::Global2OwnerMap const map,
+                                     std::size_t const count,
+                                     DimType const* __restrict__ global_indices,
+                                     RankType* __restrict__ ranks,
+                                     DataIndexType* __restrict__ local_offsets)
+{
+  std::size_t const i =
+    static_cast<std::size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+  if (i < count)
+  {
+    internal::global2owner_index(
+      map, count, i, global_indices, ranks[i], local_offsets[i]);
+  }
+}
+
+/** Map one local offset per thread to its global index. */
+__global__ void
+local2global_indices(internal::Local2GlobalMap const map,
+                     std::size_t const count,
+                     DataIndexType const* __restrict__ local_offsets,
+                     DimType* __restrict__ global_indices)
+{
+  std::size_t const i =
+    static_cast<std::size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+  if (i < count)
+  {
+    internal::local2global_index(
+      map, count, i, local_offsets[i], global_indices);
+  }
+}
+
+}  // namespace kernels
+
+namespace internal
+{
+
+void global2owner_indices_impl(GPUDev_t,
+                               Global2OwnerMap const& map,
+                               std::size_t count,
+                               DimType const* global_indices,
+                               RankType* ranks,
+                               DataIndexType* local_offsets,
+                               ComputeStream const& stream)
+{
+  unsigned int const block_size = gpu::num_threads_per_block;
+  unsigned int const num_blocks = (count + block_size - 1) / block_size;
+  gpu::launch_kernel(kernels::global2owner_indices,
+                     num_blocks,
+                     block_size,
+                     0,
+                     stream.get_stream<Device::GPU>(),
+                     map,
+                     count,
+                     global_indices,
+                     ranks,
+                     local_offsets);
+}
+
+void local2global_indices_impl(GPUDev_t,
+                               Local2GlobalMap const& map,
+                               std::size_t count,
+                               DataIndexType const* local_offsets,
+                               DimType* global_indices,
+                               ComputeStream const& stream)
+{
+  unsigned int const block_size = gpu::num_threads_per_block;
+  unsigned int const num_blocks = (count + block_size - 1) / block_size;
+  gpu::launch_kernel(kernels::local2global_indices,
+                     num_blocks,
+                     block_size,
+                     0,
+                     stream.get_stream<Device::GPU>(),
+                     map,
+                     count,
+                     local_offsets,
+                     global_indices);
+}
+
+}  // namespace internal
+
+}  // namespace h2
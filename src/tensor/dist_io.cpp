@@ -0,0 +1,395 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/dist_io.hpp"
+
+#include "h2/core/allocator.hpp"
+#include "h2/tensor/copy_buffer.hpp"
+#include "h2/utils/As.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <mpi.h>
+
+namespace h2
+{
+namespace internal
+{
+
+namespace
+{
+
+void check_mpi(int ret, char const* what, std::string const& path)
+{
+  if (ret != MPI_SUCCESS)
+  {
+    char msg[MPI_MAX_ERROR_STRING];
+    int len = 0;
+    MPI_Error_string(ret, msg, &len);
+    throw H2Exception(what, " failed for ", path, ": ", std::string(msg, len));
+  }
+}
+
+/** Free an MPI datatype when leaving scope. */
+struct DatatypeRAII
+{
+  MPI_Datatype type = MPI_DATATYPE_NULL;
+  ~DatatypeRAII()
+  {
+    if (type != MPI_DATATYPE_NULL)
+    {
+      MPI_Type_free(&type);
+    }
+  }
+};
+
+/** Close an MPI file when leaving scope. */
+struct FileRAII
+{
+  MPI_File fh = MPI_FILE_NULL;
+  ~FileRAII()
+  {
+    if (fh != MPI_FILE_NULL)
+    {
+      MPI_File_close(&fh);
+    }
+  }
+};
+
+/**
+ * Set the view of `file` at `data_offset` to the block `indices` of a
+ * column-major global tensor of shape `global_shape`.
+ *
+ * Returns the number of elements in the block. Ranks with no block
+ * get an empty view (this is collective, so they must still call it).
+ */
+int set_block_view(MPI_File fh,
+                   std::string const& path,
+                   std::uint64_t data_offset,
+                   ShapeTuple const& global_shape,
+                   IndexRangeTuple const& indices,
+                   MPI_Datatype elem_type,
+                   DatatypeRAII& block_type)
+{
+  int count = 0;
+  MPI_Datatype file_type = elem_type;
+  if (!indices.is_empty() && !global_shape.is_empty())
+  {
+    int const ndim = safe_as<int>(global_shape.size());
+    std::vector<int> sizes(ndim), subsizes(ndim), starts(ndim);
+    count = 1;
+    for (int i = 0; i < ndim; ++i)
+    {
+      sizes[i] = safe_as<int>(global_shape[i]);
+      IndexRange const& range = indices[i];
+      starts[i] = safe_as<int>(range.start());
+      subsizes[i] = safe_as<int>(range.end() - range.start());
+      count = safe_as<int>(static_cast<std::int64_t>(count) * subsizes[i]);
+    }
+    check_mpi(MPI_Type_create_subarray(ndim,
+                                       sizes.data(),
+                                       subsizes.data(),
+                                       starts.data(),
+                                       MPI_ORDER_FORTRAN,
+                                       elem_type,
+                                       &block_type.type),
+              "MPI_Type_create_subarray",
+              path);
+    check_mpi(MPI_Type_commit(&block_type.type), "MPI_Type_commit", path);
+    file_type = block_type.type;
+  }
+  check_mpi(MPI_File_set_view(fh,
+                              static_cast<MPI_Offset>(data_offset),
+                              elem_type,
+                              file_type,
+                              "native",
+                              MPI_INFO_NULL),
+            "MPI_File_set_view",
+            path);
+  return count;
+}
+
+/** Return the number of elements in the block `indices`. */
+std::size_t get_block_numel(IndexRangeTuple const& indices)
+{
+  if (indices.is_empty())
+  {
+    return 0;
+  }
+  std::size_t numel = 1;
+  for (typename IndexRangeTuple::size_type i = 0; i < indices.size(); ++i)
+  {
+    numel *= static_cast<std::size_t>(indices[i].end() - indices[i].start());
+  }
+  return numel;
+}
+
+/**
+ * Return the offset, in elements, of the block `indices` of a
+ * column-major global tensor of shape `global_shape` if the block is
+ * contiguous in it, or -1 if it is not.
+ *
+ * A block is contiguous if it spans the full extent of every dimension
+ * before some dimension and has extent one in every dimension after it.
+ */
+std::int64_t get_contiguous_block_offset(ShapeTuple const& global_shape,
+                                         IndexRangeTuple const& indices)
+{
+  if (indices.is_empty() || global_shape.is_empty())
+  {
+    return -1;
+  }
+  bool partial = false;
+  std::int64_t offset = 0;
+  std::int64_t stride = 1;
+  for (typename ShapeTuple::size_type i = 0; i < global_shape.size(); ++i)
+  {
+    DimType const extent = indices[i].end() - indices[i].start();
+    if (partial && extent != 1)
+    {
+      return -1;
+    }
+    partial = partial || extent != global_shape[i];
+    offset += indices[i].start() * stride;
+    stride *= global_shape[i];
+  }
+  return offset;
+}
+
+/**
+ * Return the offset, in elements, at which the calling rank should
+ * access its block directly with GPUDirect Storage, or -1 if it should
+ * use MPI-IO.
+ */
+std::int64_t get_direct_block_offset(ShapeTuple const& global_shape,
+                                     IndexRangeTuple const& indices,
+                                     Device dev)
+{
+  if (dev != Device::GPU || !gds_enabled())
+  {
+    return -1;
+  }
+  return get_contiguous_block_offset(global_shape, indices);
+}
+
+}  // anonymous namespace
+
+void write_checkpoint_blocks(std::string const& path,
+                             TensorFileHeader const& header,
+                             ProcessorGrid const& grid,
+                             IndexRangeTuple const& indices,
+                             bool write_block,
+                             void const* buf,
+                             std::size_t type_size,
+                             Device dev,
+                             ComputeStream const& stream)
+{
+  MPI_Comm const comm = grid.comm().GetMPIComm();
+  std::ostringstream header_ss;
+  write_header(header_ss, header);
+  std::string const header_bytes = header_ss.str();
+
+  std::size_t const block_bytes =
+    write_block ? get_block_numel(indices) * type_size : 0;
+  std::int64_t const direct_offset =
+    write_block ? get_direct_block_offset(header.shape, indices, dev) : -1;
+  bool const direct = direct_offset >= 0;
+  ManagedBuffer<unsigned char> staging(Device::CPU);
+  if (write_block && !direct && dev != Device::CPU)
+  {
+    ComputeStream const cpu_stream{Device::CPU};
+    staging = ManagedBuffer<unsigned char>(
+      block_bytes, Device::CPU, cpu_stream, MemoryKind::Pinned);
+    copy_buffer(staging.data(),
+                cpu_stream,
+                static_cast<unsigned char const*>(buf),
+                stream,
+                block_bytes);
+    stream.wait_for_this();
+    buf = staging.data();
+  }
+
+  {
+    FileRAII file;
+    check_mpi(MPI_File_open(comm,
+                            path.c_str(),
+                            MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                            MPI_INFO_NULL,
+                            &file.fh),
+              "MPI_File_open",
+              path);
+    // Discard any existing contents.
+    check_mpi(MPI_File_set_size(file.fh, 0), "MPI_File_set_size", path);
+    if (grid.rank() == 0)
+    {
+      check_mpi(MPI_File_write_at(file.fh,
+                                  0,
+                                  header_bytes.data(),
+                                  safe_as<int>(header_bytes.size()),
+                                  MPI_BYTE,
+                                  MPI_STATUS_IGNORE),
+                "MPI_File_write_at",
+                path);
+    }
+
+    DatatypeRAII elem_type;
+    check_mpi(
+      MPI_Type_contiguous(safe_as<int>(type_size), MPI_BYTE, &elem_type.type),
+      "MPI_Type_contiguous",
+      path);
+    check_mpi(MPI_Type_commit(&elem_type.type), "MPI_Type_commit", path);
+    DatatypeRAII block_type;
+    int const count =
+      set_block_view(file.fh,
+                     path,
+                     header_bytes.size(),
+                     header.shape,
+                     (write_block && !direct) ? indices : IndexRangeTuple{},
+                     elem_type.type,
+                     block_type);
+    check_mpi(MPI_File_write_all(
+                file.fh, buf, count, elem_type.type, MPI_STATUS_IGNORE),
+              "MPI_File_write_all",
+              path);
+  }
+
+  // Every rank must be done truncating the file before blocks are
+  // written to it outside of MPI-IO.
+  check_mpi(MPI_Barrier(comm), "MPI_Barrier", path);
+  if (direct)
+  {
+    write_file_data(path,
+                    header_bytes.size() + direct_offset * type_size,
+                    buf,
+                    block_bytes,
+                    dev,
+                    stream,
+                    default_io_chunk_bytes);
+  }
+}
+
+std::pair<TensorFileHeader, std::uint64_t>
+read_checkpoint_header(std::string const& path, ProcessorGrid const& grid)
+{
+  MPI_Comm const comm = grid.comm().GetMPIComm();
+  // Rank 0 reads the header and broadcasts it, so the file system is
+  // not hit by every rank.
+  std::string header_bytes;
+  std::uint64_t sizes[2] = {0, 0};  // Header size, success flag.
+  if (grid.rank() == 0)
+  {
+    std::ifstream in(path, std::ios::binary);
+    if (in)
+    {
+      try
+      {
+        read_header(in);
+        sizes[0] = static_cast<std::uint64_t>(in.tellg());
+        sizes[1] = 1;
+        in.seekg(0);
+        header_bytes.resize(sizes[0]);
+        in.read(header_bytes.data(), header_bytes.size());
+      }
+      catch (H2Exception const&)
+      {
+        sizes[1] = 0;
+      }
+    }
+  }
+  MPI_Bcast(sizes, 2, MPI_UINT64_T, 0, comm);
+  H2_ASSERT_ALWAYS(sizes[1] == 1,
+                   "Could not read a serialized tensor header from ",
+                   path);
+  header_bytes.resize(sizes[0]);
+  MPI_Bcast(header_bytes.data(), safe_as<int>(sizes[0]), MPI_BYTE, 0, comm);
+  std::istringstream header_ss(header_bytes);
+  return {read_header(header_ss), sizes[0]};
+}
+
+void read_checkpoint_blocks(std::string const& path,
+                            std::uint64_t data_offset,
+                            ShapeTuple const& global_shape,
+                            ProcessorGrid const& grid,
+                            IndexRangeTuple const& indices,
+                            void* buf,
+                            std::size_t type_size,
+                            Device dev,
+                            ComputeStream const& stream)
+{
+  std::size_t const block_bytes = get_block_numel(indices) * type_size;
+  std::int64_t const direct_offset =
+    get_direct_block_offset(global_shape, indices, dev);
+  bool const direct = direct_offset >= 0;
+  ComputeStream const cpu_stream{Device::CPU};
+  ManagedBuffer<unsigned char> staging(Device::CPU);
+  void* read_buf = buf;
+  if (!indices.is_empty() && !direct && dev != Device::CPU)
+  {
+    staging = ManagedBuffer<unsigned char>(
+      block_bytes, Device::CPU, cpu_stream, MemoryKind::Pinned);
+    read_buf = staging.data();
+  }
+
+  {
+    FileRAII file;
+    check_mpi(MPI_File_open(grid.comm().GetMPIComm(),
+                            path.c_str(),
+                            MPI_MODE_RDONLY,
+                            MPI_INFO_NULL,
+                            &file.fh),
+              "MPI_File_open",
+              path);
+    DatatypeRAII elem_type;
+    check_mpi(
+      MPI_Type_contiguous(safe_as<int>(type_size), MPI_BYTE, &elem_type.type),
+      "MPI_Type_contiguous",
+      path);
+    check_mpi(MPI_Type_commit(&elem_type.type), "MPI_Type_commit", path);
+    DatatypeRAII block_type;
+    int const count = set_block_view(file.fh,
+                                     path,
+                                     data_offset,
+                                     global_shape,
+                                     direct ? IndexRangeTuple{} : indices,
+                                     elem_type.type,
+                                     block_type);
+    check_mpi(MPI_File_read_all(
+                file.fh, read_buf, count, elem_type.type, MPI_STATUS_IGNORE),
+              "MPI_File_read_all",
+              path);
+  }
+
+  if (direct)
+  {
+    read_file_data(path,
+                   data_offset + direct_offset * type_size,
+                   buf,
+                   block_bytes,
+                   dev,
+                   stream,
+                   default_io_chunk_bytes);
+  }
+  else if (read_buf != buf)
+  {
+    copy_buffer(static_cast<unsigned char*>(buf),
+                stream,
+                static_cast<unsigned char const*>(read_buf),
+                cpu_stream,
+                block_bytes);
+    // The staging buffer must outlive the copy.
+    stream.wait_for_this();
+  }
+}
+
+
+}  // namespace internal
+}  // namespace h2
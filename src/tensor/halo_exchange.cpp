@@ -0,0 +1,206 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/halo_exchange.hpp"
+
+#include "h2/core/allocator.hpp"
+#include "h2/tensor/copy_buffer.hpp"
+#include "h2/tensor/straggler_monitor.hpp"
+#include "h2/tensor/tensor_utils.hpp"
+#include "h2/utils/As.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+
+#include <mpi.h>
+
+namespace h2
+{
+namespace internal
+{
+
+namespace
+{
+
+void check_mpi(int ret, char const* what)
+{
+  if (ret != MPI_SUCCESS)
+  {
+    char msg[MPI_MAX_ERROR_STRING];
+    int len = 0;
+    MPI_Error_string(ret, msg, &len);
+    throw H2Exception(
+      what, " failed while exchanging halos: ", std::string(msg, len));
+  }
+}
+
+/**
+ * Return the address of the slab starting at index `start` of
+ * dimension `dim` in `local`.
+ */
+template <typename PtrT>
+PtrT get_slab_ptr(PtrT local_data,
+                  StrideTuple const& local_strides,
+                  typename ShapeTuple::size_type dim,
+                  DimType start,
+                  std::size_t elem_size)
+{
+  using ByteT = std::conditional_t<
+    std::is_const_v<std::remove_pointer_t<PtrT>>,
+    std::byte const,
+    std::byte>;
+  return static_cast<PtrT>(
+    static_cast<ByteT*>(local_data)
+    + start * local_strides[dim] * static_cast<DataIndexType>(elem_size));
+}
+
+/** Exchange with the neighbor in one direction of a dimension. */
+struct HaloSide
+{
+  int peer;           /**< Rank of the neighbor in the sub-communicator. */
+  DimType send_start; /**< Start of the interior slab to send. */
+  DimType recv_start; /**< Start of the ghost slab to receive into. */
+  int send_tag;
+  int recv_tag;
+};
+
+}  // anonymous namespace
+
+void exchange_halo(BaseTensor& padded_local,
+                   ShapeTuple const& halo,
+                   ProcessorGrid const& grid)
+{
+  H2_ASSERT_ALWAYS(halo.size() == padded_local.ndim(),
+                   "Halo (",
+                   halo,
+                   ") does not match the local tensor shape (",
+                   padded_local.shape(),
+                   ")");
+  std::size_t const elem_size = padded_local.get_type_info().get_size();
+  ShapeTuple const& padded_shape = padded_local.shape();
+  StrideTuple const& strides = padded_local.strides();
+  ComputeStream const& stream = padded_local.get_stream();
+  ComputeStream const cpu_stream{Device::CPU};
+  MemoryKind const kind = (padded_local.get_device() == Device::CPU)
+                            ? MemoryKind::Default
+                            : MemoryKind::Pinned;
+
+  for (typename ShapeTuple::size_type dim = 0; dim < halo.size(); ++dim)
+  {
+    if (halo[dim] == 0 || grid.shape(dim) == 1)
+    {
+      continue;
+    }
+    DimType const width = halo[dim];
+    DimType const interior_size = padded_shape[dim] - 2 * width;
+    int const dim_rank = grid.get_dimension_rank(dim);
+    int const dim_size = safe_as<int>(grid.shape(dim));
+    // Tags give the direction data moves in.
+    HaloSide const sides[2] = {
+      {dim_rank - 1, width, 0, 0, 1},
+      {dim_rank + 1, interior_size, interior_size + width, 1, 0}};
+
+    // Slabs span the full padded extent of the other dimensions.
+    ShapeTuple slab_shape = padded_shape;
+    slab_shape[dim] = width;
+    StrideTuple const slab_strides = get_contiguous_strides(slab_shape);
+    std::size_t const slab_bytes = product<std::size_t>(slab_shape) * elem_size;
+    ManagedBuffer<std::byte> send_buf(
+      2 * slab_bytes, Device::CPU, cpu_stream, kind);
+    ManagedBuffer<std::byte> recv_buf(
+      2 * slab_bytes, Device::CPU, cpu_stream, kind);
+
+    bool any_sends = false;
+    for (int i = 0; i < 2; ++i)
+    {
+      if (sides[i].peer < 0 || sides[i].peer >= dim_size)
+      {
+        continue;
+      }
+      copy_strided_buffer(send_buf.data() + i * slab_bytes,
+                          slab_strides,
+                          cpu_stream,
+                          get_slab_ptr(padded_local.const_storage_data(),
+                                       strides,
+                                       dim,
+                                       sides[i].send_start,
+                                       elem_size),
+                          strides,
+                          stream,
+                          slab_shape,
+                          elem_size);
+      any_sends = true;
+    }
+    if (any_sends)
+    {
+      stream.wait_for_this();
+      cpu_stream.wait_for_this();
+    }
+
+    MPI_Comm const comm =
+      grid.get_subcomm(DimensionOrderTuple{static_cast<NDimType>(dim)})
+        .GetMPIComm();
+    H2_STRAGGLER_ARRIVAL("h2::exchange_halo", comm);
+    MPI_Request requests[4] = {
+      MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+    int const count = safe_as<int>(slab_bytes);
+    for (int i = 0; i < 2; ++i)
+    {
+      if (sides[i].peer < 0 || sides[i].peer >= dim_size)
+      {
+        continue;
+      }
+      check_mpi(MPI_Irecv(recv_buf.data() + i * slab_bytes,
+                          count,
+                          MPI_BYTE,
+                          sides[i].peer,
+                          sides[i].recv_tag,
+                          comm,
+                          &requests[2 * i]),
+                "MPI_Irecv");
+      check_mpi(MPI_Isend(send_buf.data() + i * slab_bytes,
+                          count,
+                          MPI_BYTE,
+                          sides[i].peer,
+                          sides[i].send_tag,
+                          comm,
+                          &requests[2 * i + 1]),
+                "MPI_Isend");
+    }
+    check_mpi(MPI_Waitall(4, requests, MPI_STATUSES_IGNORE), "MPI_Waitall");
+
+    for (int i = 0; i < 2; ++i)
+    {
+      if (sides[i].peer < 0 || sides[i].peer >= dim_size)
+      {
+        continue;
+      }
+      copy_strided_buffer(get_slab_ptr(padded_local.storage_data(),
+                                       strides,
+                                       dim,
+                                       sides[i].recv_start,
+                                       elem_size),
+                          strides,
+                          stream,
+                          recv_buf.data() + i * slab_bytes,
+                          slab_strides,
+                          cpu_stream,
+                          slab_shape,
+                          elem_size);
+    }
+    // The receive buffer must outlive the copies, and the next
+    // dimension sends data received here.
+    stream.wait_for_this();
+  }
+}
+
+}  // namespace internal
+}  // namespace h2
@@ -8,6 +8,7 @@
 #include "h2/tensor/init/fill.hpp"
 
 #include "h2/core/dispatch.hpp"
+#include "h2/core/profiling.hpp"
 #include "h2/loops/cpu_loops.hpp"
 #include "h2/utils/typename.hpp"
 
@@ -16,6 +17,7 @@ namespace h2
 
 void zero(BaseTensor& tensor)
 {
+  H2_PROFILE_RANGE("h2::zero", Compute);
   // H2_DISPATCH_NAME: zero
   // H2_DISPATCH_NUM_TYPES: 1
   // H2_DISPATCH_INIT: zero<{T1}>("Tensor<{T1}>&")
@@ -32,6 +34,38 @@ void zero(BaseTensor& tensor)
   }
 }
 
+void zero(std::vector<BaseTensor*> const& tensors)
+{
+  H2_PROFILE_RANGE("h2::zero", Compute);
+  for (auto const& [stream, group] : impl::group_by_stream(tensors))
+  {
+    for (BaseTensor* tensor : group)
+    {
+      if (!tensor->is_contiguous())
+      {
+        throw H2FatalException(
+          "Zero not implemented for non-contiguous tensors");
+      }
+    }
+    if (stream.get_device() == Device::CPU)
+    {
+      // There is no launch overhead to save.
+      for (BaseTensor* tensor : group)
+      {
+        zero(tensor->storage_data(),
+             stream,
+             tensor->numel() * tensor->get_type_info().get_size());
+      }
+    }
+#ifdef H2_HAS_GPU
+    else
+    {
+      impl::zero_batched_impl(GPUDev_t{}, group, stream);
+    }
+#endif
+  }
+}
+
 namespace impl
 {
 
@@ -44,7 +78,7 @@ void fill_impl(CPUDev_t, Tensor<T>& tensor, T const& val)
   }
   if (tensor.is_contiguous())
   {
-    cpu::elementwise_loop(
+    cpu::parallel_elementwise_loop(
       [&val]() -> T { return val; }, tensor.numel(), tensor.data());
   }
   else
@@ -63,6 +97,7 @@ H2_INSTANTIATE_CPU_1
 template <typename T>
 void fill(BaseTensor& tensor, T const& val)
 {
+  H2_PROFILE_RANGE("h2::fill", Compute);
   // H2_DISPATCH_NAME: fill
   // H2_DISPATCH_NUM_TYPES: 1
   // H2_DISPATCH_INIT_CPU: impl::fill_impl("CPUDev_t", "Tensor<{T1}>&", "const {T1}&")
@@ -10,12 +10,28 @@
 #include "h2/loops/gpu_loops.cuh"
 #include "h2/tensor/init/fill.hpp"
 
+#include <cstdint>
+#include <vector>
+
 namespace h2
 {
 
 namespace impl
 {
 
+namespace
+{
+
+/**
+ * Largest tensor, in elements, filled in a batched launch.
+ *
+ * Larger tensors are filled with their own launch, which vectorizes;
+ * the batched launch only pays off for small tensors.
+ */
+constexpr std::size_t max_batched_size = std::size_t{1} << 20;
+
+}  // anonymous namespace
+
 template <typename T>
 void fill_impl(GPUDev_t, Tensor<T>& tensor, T const& val)
 {
@@ -39,8 +55,73 @@ void fill_impl(GPUDev_t, Tensor<T>& tensor, T const& val)
   }
 }
 
+void zero_batched_impl(GPUDev_t,
+                       std::vector<BaseTensor*> const& tensors,
+                       ComputeStream const& stream)
+{
+  // Zero in 32-bit words where possible.
+  using WordT = std::uint32_t;
+  std::vector<gpu::ElementwiseWorkItem<WordT*>> items;
+  for (BaseTensor* tensor : tensors)
+  {
+    std::size_t const bytes =
+      tensor->numel() * tensor->get_type_info().get_size();
+    if (bytes == 0)
+    {
+      continue;
+    }
+    void* data = tensor->storage_data();
+    if (bytes % sizeof(WordT) == 0
+        && reinterpret_cast<std::uintptr_t>(data) % alignof(WordT) == 0
+        && bytes / sizeof(WordT) <= max_batched_size)
+    {
+      items.push_back(gpu::make_elementwise_work_item(
+        bytes / sizeof(WordT), static_cast<WordT*>(data)));
+    }
+    else
+    {
+      zero(data, stream, bytes);
+    }
+  }
+  gpu::launch_batched_elementwise_loop(
+    [] H2_GPU_LAMBDA() -> WordT { return 0; }, stream, items);
+}
+
+template <typename T>
+void fill_batched_impl(GPUDev_t,
+                       std::vector<Tensor<T>*> const& tensors,
+                       ComputeStream const& stream,
+                       T const& val)
+{
+  std::vector<gpu::ElementwiseWorkItem<T*>> items;
+  for (Tensor<T>* tensor : tensors)
+  {
+    if (tensor->is_empty())
+    {
+      continue;
+    }
+    if (!tensor->is_contiguous())
+    {
+      throw H2FatalException("Not supporting non-contiguous tensors");
+    }
+    std::size_t const size = static_cast<std::size_t>(tensor->numel());
+    if (size <= max_batched_size)
+    {
+      items.push_back(gpu::make_elementwise_work_item(size, tensor->data()));
+    }
+    else
+    {
+      fill_impl(GPUDev_t{}, *tensor, val);
+    }
+  }
+  gpu::launch_batched_elementwise_loop(
+    [val] H2_GPU_LAMBDA() -> T { return val; }, stream, items);
+}
+
 #define PROTO(device, t1)                                                      \
-  template void fill_impl<t1>(device, Tensor<t1>&, const t1&);
+  template void fill_impl<t1>(device, Tensor<t1>&, const t1&);                 \
+  template void fill_batched_impl<t1>(                                         \
+    device, std::vector<Tensor<t1>*> const&, ComputeStream const&, const t1&);
 H2_INSTANTIATE_GPU_1
 #undef PROTO
 
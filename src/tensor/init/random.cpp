@@ -0,0 +1,91 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/init/random.hpp"
+
+#include "h2/core/thread_pool.hpp"
+#include "h2/loops/cpu_loops.hpp"
+#include "h2/loops/strided_loop_helpers.hpp"
+
+#include <algorithm>
+
+namespace h2
+{
+
+namespace impl
+{
+
+template <typename T>
+void fill_random_impl(CPUDev_t,
+                      Tensor<T>& tensor,
+                      RandomFill<T> const& gen,
+                      std::uint64_t index_base,
+                      StrideTuple const& index_strides)
+{
+  if (tensor.is_empty())
+  {
+    return;
+  }
+  StridedLoopLayout<2> const layout = make_strided_loop_layout<2>(
+    tensor.shape(), {tensor.strides(), index_strides});
+  DataIndexType const size = layout.numel();
+  if (size == 0)
+  {
+    return;
+  }
+  T* __restrict__ buf = tensor.data();
+
+  // Run the innermost (fastest-varying) dimension in the inner loop.
+  DataIndexType const inner_size = layout.shape[0];
+  DataIndexType const outer_size = size / inner_size;
+  auto run_outer_range = [&](DataIndexType outer_start,
+                             DataIndexType outer_end) {
+    for (DataIndexType outer = outer_start; outer < outer_end; ++outer)
+    {
+      DataIndexType offsets[2];
+      layout.get_offsets(outer * inner_size, offsets);
+      for (DataIndexType i = 0; i < inner_size; ++i)
+      {
+        buf[offsets[0] + i * layout.strides[0][0]] =
+          gen(index_base
+              + static_cast<std::uint64_t>(offsets[1]
+                                           + i * layout.strides[1][0]));
+      }
+    }
+  };
+  std::size_t const num_blocks = std::min(
+    {cpu::get_num_threads(),
+     static_cast<std::size_t>(size) / cpu::get_parallel_loop_grain_size(),
+     static_cast<std::size_t>(outer_size)});
+  if (num_blocks > 1)
+  {
+    DataIndexType const block_size =
+      (outer_size + static_cast<DataIndexType>(num_blocks) - 1)
+      / static_cast<DataIndexType>(num_blocks);
+    cpu::parallel_for(num_blocks, [&](std::size_t block) {
+      DataIndexType const start =
+        static_cast<DataIndexType>(block) * block_size;
+      run_outer_range(start, std::min(start + block_size, outer_size));
+    });
+    return;
+  }
+  run_outer_range(0, outer_size);
+}
+
+#define PROTO(device, t1)                                                      \
+  template void fill_random_impl<t1>(device,                                   \
+                                     Tensor<t1>&,                              \
+                                     RandomFill<t1> const&,                    \
+                                     std::uint64_t,                            \
+                                     StrideTuple const&)
+PROTO(CPUDev_t, float);
+PROTO(CPUDev_t, double);
+#undef PROTO
+
+}  // namespace impl
+
+}  // namespace h2
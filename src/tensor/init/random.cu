@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/gpu/runtime.hpp"
+#include "h2/loops/gpu_loops.cuh"
+#include "h2/loops/strided_loop_helpers.hpp"
+#include "h2/tensor/init/random.hpp"
+
+#include <algorithm>
+
+namespace h2
+{
+
+namespace kernels
+{
+
+/**
+ * Fill a strided buffer with random values.
+ *
+ * `layout` gives the offset in `buf` and the index of each element.
+ */
+template <typename T>
+H2_GPU_GLOBAL void random_fill(T* buf,
+                               StridedLoopLayout<2> const layout,
+                               std::size_t size,
+                               std::uint64_t index_base,
+                               impl::RandomFill<T> const gen)
+{
+  std::size_t const stride = static_cast<std::size_t>(blockDim.x) * gridDim.x;
+  for (std::size_t i = static_cast<std::size_t>(blockIdx.x) * blockDim.x
+                       + threadIdx.x;
+       i < size;
+       i += stride)
+  {
+    DataIndexType offsets[2];
+    layout.get_offsets(static_cast<DataIndexType>(i), offsets);
+    buf[offsets[0]] =
+      gen(index_base + static_cast<std::uint64_t>(offsets[1]));
+  }
+}
+
+}  // namespace kernels
+
+namespace impl
+{
+
+template <typename T>
+void fill_random_impl(GPUDev_t,
+                      Tensor<T>& tensor,
+                      RandomFill<T> const& gen,
+                      std::uint64_t index_base,
+                      StrideTuple const& index_strides)
+{
+  if (tensor.is_empty())
+  {
+    return;
+  }
+  StridedLoopLayout<2> const layout = make_strided_loop_layout<2>(
+    tensor.shape(), {tensor.strides(), index_strides});
+  std::size_t const size = static_cast<std::size_t>(layout.numel());
+  if (size == 0)
+  {
+    return;
+  }
+  unsigned int const block_size = gpu::num_threads_per_block;
+  unsigned int const num_blocks = static_cast<unsigned int>(
+    std::min<std::size_t>((size + block_size - 1) / block_size,
+                          gpu::max_grid_x));
+  gpu::launch_kernel(kernels::random_fill<T>,
+                     num_blocks,
+                     block_size,
+                     0,
+                     tensor.get_stream().template get_stream<Device::GPU>(),
+                     tensor.data(),
+                     layout,
+                     size,
+                     index_base,
+                     gen);
+}
+
+#define PROTO(device, t1)                                                      \
+  template void fill_random_impl<t1>(device,                                   \
+                                     Tensor<t1>&,                              \
+                                     RandomFill<t1> const&,                    \
+                                     std::uint64_t,                            \
+                                     StrideTuple const&)
+PROTO(GPUDev_t, float);
+PROTO(GPUDev_t, double);
+#undef PROTO
+
+}  // namespace impl
+
+}  // namespace h2
@@ -0,0 +1,636 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/io.hpp"
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/sync.hpp"
+#include "h2/utils/Error.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <vector>
+
+#ifdef H2_HAS_GPU
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/gpu/runtime.hpp"
+#endif
+
+#if H2_HAS_CUFILE
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cufile.h>
+#endif
+
+namespace h2
+{
+namespace internal
+{
+
+namespace
+{
+
+constexpr char magic[4] = {'H', '2', 'T', 'S'};
+
+template <typename T>
+void write_value(std::ostream& os, T const& val)
+{
+  os.write(reinterpret_cast<char const*>(&val), sizeof(T));
+}
+
+template <typename T>
+T read_value(std::istream& is)
+{
+  T val;
+  is.read(reinterpret_cast<char*>(&val), sizeof(T));
+  H2_ASSERT_ALWAYS(is, "Unexpected end of serialized tensor");
+  return val;
+}
+
+/** Write each entry of a tuple as `StoredT`. */
+template <typename StoredT, typename TupleT>
+void write_tuple_entries(std::ostream& os, TupleT const& tuple)
+{
+  for (typename TupleT::size_type i = 0; i < tuple.size(); ++i)
+  {
+    write_value(os, static_cast<StoredT>(tuple[i]));
+  }
+}
+
+template <typename StoredT, typename TupleT>
+TupleT read_tuple_entries(std::istream& is, std::uint32_t n)
+{
+  TupleT tuple(TuplePad<TupleT>(n));
+  for (std::uint32_t i = 0; i < n; ++i)
+  {
+    tuple[i] = static_cast<typename TupleT::type>(read_value<StoredT>(is));
+  }
+  return tuple;
+}
+
+std::uint32_t read_ndim(std::istream& is)
+{
+  std::uint32_t const n = read_value<std::uint32_t>(is);
+  H2_ASSERT_ALWAYS(n <= MAX_TENSOR_DIMS,
+                   "Serialized tensor has ",
+                   n,
+                   " dimensions, more than the maximum ",
+                   MAX_TENSOR_DIMS);
+  return n;
+}
+
+void check_stream(std::ios const& s, char const* what)
+{
+  if (!s)
+  {
+    throw H2Exception("Failed to ", what, " serialized tensor");
+  }
+}
+
+#ifdef H2_HAS_GPU
+
+/**
+ * Copy `bytes` of GPU data at `buf` to the host in chunks of at most
+ * `chunk_bytes` and call `sink(host_ptr, size)` on each chunk.
+ *
+ * Chunks go through two pinned staging buffers, so the copy of one
+ * chunk overlaps `sink` on the previous one.
+ */
+template <typename SinkT>
+void stage_from_gpu(void const* buf,
+                    std::size_t bytes,
+                    ComputeStream const& stream,
+                    std::size_t chunk_bytes,
+                    SinkT sink)
+{
+  H2_ASSERT_ALWAYS(chunk_bytes > 0, "Chunk size must be positive");
+  chunk_bytes = std::min(chunk_bytes, bytes);
+  std::array<ManagedBuffer<char>, 2> staging = {
+    ManagedBuffer<char>(chunk_bytes, Device::CPU, {}, MemoryKind::Pinned),
+    ManagedBuffer<char>(chunk_bytes, Device::CPU, {}, MemoryKind::Pinned)};
+  std::array<SyncEventRAII, 2> events = {SyncEventRAII{Device::GPU},
+                                         SyncEventRAII{Device::GPU}};
+  char const* src = static_cast<char const*>(buf);
+  std::size_t const num_chunks = (bytes + chunk_bytes - 1) / chunk_bytes;
+  auto const chunk_size = [&](std::size_t i) {
+    return std::min(chunk_bytes, bytes - i * chunk_bytes);
+  };
+  // Copy chunk i while handling chunk i - 1.
+  for (std::size_t i = 0; i <= num_chunks; ++i)
+  {
+    if (i < num_chunks)
+    {
+      gpu::mem_copy(staging[i % 2].data(),
+                    src + i * chunk_bytes,
+                    chunk_size(i),
+                    stream.get_stream<Device::GPU>());
+      stream.add_sync_point(events[i % 2]);
+    }
+    if (i > 0)
+    {
+      SyncEvent const& prev = events[(i - 1) % 2];
+      prev.wait_for_this();
+      sink(staging[(i - 1) % 2].const_data(), chunk_size(i - 1));
+    }
+  }
+}
+
+#endif  // H2_HAS_GPU
+
+/**
+ * Write `bytes` of data at `buf` on `dev` to `os` compressed with
+ * `compression`, as chunks of at most `chunk_bytes` of input.
+ */
+void write_compressed_data(std::ostream& os,
+                           void const* buf,
+                           std::size_t bytes,
+                           Device dev,
+                           [[maybe_unused]] ComputeStream const& stream,
+                           std::size_t chunk_bytes,
+                           DataCompression compression)
+{
+  H2_ASSERT_ALWAYS(compression == DataCompression::Zeros,
+                   "Unsupported data compression ",
+                   compression);
+  H2_ASSERT_ALWAYS(chunk_bytes > 0, "Chunk size must be positive");
+  chunk_bytes = std::min(chunk_bytes, bytes);
+  std::vector<char> compressed(get_max_compressed_size(chunk_bytes));
+  auto const write_chunk = [&](char const* chunk, std::size_t size) {
+    std::size_t const stored = compress(compressed.data(), chunk, size);
+    write_value(os, static_cast<std::uint64_t>(size));
+    write_value(os, static_cast<std::uint64_t>(stored));
+    os.write(compressed.data(), stored);
+    check_stream(os, "write");
+  };
+  if (dev == Device::CPU)
+  {
+    char const* src = static_cast<char const*>(buf);
+    for (std::size_t pos = 0; pos < bytes; pos += chunk_bytes)
+    {
+      write_chunk(src + pos, std::min(chunk_bytes, bytes - pos));
+    }
+    return;
+  }
+#ifdef H2_HAS_GPU
+  stage_from_gpu(buf, bytes, stream, chunk_bytes, write_chunk);
+#else   // H2_HAS_GPU
+  throw H2Exception("Unknown device ", dev);
+#endif  // H2_HAS_GPU
+}
+
+/**
+ * Read `bytes` of data into `buf` on `dev` from `is`, where it was
+ * written by `write_compressed_data`.
+ *
+ * Chunks record their own sizes, so `chunk_bytes` need not match what
+ * the data was written with; it is only the initial size of the GPU
+ * staging buffers.
+ */
+void read_compressed_data(std::istream& is,
+                          void* buf,
+                          std::size_t bytes,
+                          Device dev,
+                          [[maybe_unused]] ComputeStream const& stream,
+                          [[maybe_unused]] std::size_t chunk_bytes,
+                          DataCompression compression)
+{
+  H2_ASSERT_ALWAYS(compression == DataCompression::Zeros,
+                   "Unsupported data compression ",
+                   compression);
+#ifndef H2_HAS_GPU
+  H2_ASSERT_ALWAYS(dev == Device::CPU, "Unknown device ", dev);
+#endif
+  char* dst = static_cast<char*>(buf);
+  std::vector<char> compressed;
+#ifdef H2_HAS_GPU
+  chunk_bytes = std::min(chunk_bytes, bytes);
+  std::array<std::optional<ManagedBuffer<char>>, 2> staging;
+  std::array<SyncEventRAII, 2> events = {SyncEventRAII{Device::GPU},
+                                         SyncEventRAII{Device::GPU}};
+#endif
+  // Read and decompress chunk i while chunk i - 1 is copied to the
+  // device.
+  for (std::size_t pos = 0, i = 0; pos < bytes; ++i)
+  {
+    std::uint64_t const size = read_value<std::uint64_t>(is);
+    std::uint64_t const stored = read_value<std::uint64_t>(is);
+    H2_ASSERT_ALWAYS(size > 0 && size <= bytes - pos
+                       && stored <= get_max_compressed_size(size),
+                     "Corrupt compressed tensor data");
+    compressed.resize(stored);
+    is.read(compressed.data(), stored);
+    check_stream(is, "read");
+    if (dev == Device::CPU)
+    {
+      decompress(dst + pos, size, compressed.data(), stored);
+    }
+#ifdef H2_HAS_GPU
+    else
+    {
+      auto& buffer = staging[i % 2];
+      if (i >= 2)
+      {
+        // Staging buffer is still in use by the copy of chunk i - 2.
+        SyncEvent const& prev = events[i % 2];
+        prev.wait_for_this();
+      }
+      if (!buffer || buffer->size() < size)
+      {
+        buffer.reset();
+        buffer.emplace(std::max<std::size_t>(size, chunk_bytes),
+                       Device::CPU,
+                       std::nullopt,
+                       MemoryKind::Pinned);
+      }
+      decompress(buffer->data(), size, compressed.data(), stored);
+      gpu::mem_copy(
+        dst + pos, buffer->data(), size, stream.get_stream<Device::GPU>());
+      stream.add_sync_point(events[i % 2]);
+    }
+#endif
+    pos += size;
+  }
+#ifdef H2_HAS_GPU
+  // Staging buffers must not be released while copies are in flight.
+  for (auto const& event : events)
+  {
+    SyncEvent const& e = event;
+    e.wait_for_this();
+  }
+#endif
+}
+
+#if H2_HAS_CUFILE
+
+/** Opens the cuFile driver on construction and closes it at exit. */
+struct CuFileDriver
+{
+  CuFileDriver() : is_open(cuFileDriverOpen().err == CU_FILE_SUCCESS) {}
+
+  ~CuFileDriver()
+  {
+    if (is_open)
+    {
+      cuFileDriverClose();
+    }
+  }
+
+  bool is_open;
+};
+
+bool cufile_driver_open()
+{
+  static CuFileDriver driver;
+  return driver.is_open;
+}
+
+/** A file registered with cuFile, closed when leaving scope. */
+class CuFileHandle
+{
+public:
+  CuFileHandle(std::string const& path, int flags)
+  {
+    // Direct I/O is needed for DMA to the GPU, but cuFile falls back
+    // to its compatibility mode on file systems that lack it.
+    fd = open(path.c_str(), flags | O_DIRECT);
+    if (fd < 0)
+    {
+      fd = open(path.c_str(), flags);
+    }
+    if (fd < 0)
+    {
+      return;
+    }
+    CUfileDescr_t descr;
+    std::memset(&descr, 0, sizeof(descr));
+    descr.handle.fd = fd;
+    descr.type = CU_FILE_HANDLE_TYPE_OPAQUE_FD;
+    registered = cuFileHandleRegister(&handle, &descr).err == CU_FILE_SUCCESS;
+  }
+
+  ~CuFileHandle()
+  {
+    if (registered)
+    {
+      cuFileHandleDeregister(handle);
+    }
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+  }
+
+  CuFileHandle(CuFileHandle const&) = delete;
+  CuFileHandle& operator=(CuFileHandle const&) = delete;
+
+  bool is_valid() const noexcept { return registered; }
+
+  CUfileHandle_t get() const noexcept { return handle; }
+
+private:
+  int fd = -1;
+  bool registered = false;
+  CUfileHandle_t handle;
+};
+
+/**
+ * Transfer `bytes` between the GPU buffer `buf` and the file at `path`
+ * at `offset` with `op` (`cuFileRead` or `cuFileWrite`), in requests
+ * of at most `chunk_bytes`.
+ *
+ * Returns false if the transfer failed, in which case the caller
+ * should fall back to staging through host memory.
+ */
+template <typename BufT, typename OpT>
+bool gds_transfer(std::string const& path,
+                  int flags,
+                  std::uint64_t offset,
+                  BufT buf,
+                  std::size_t bytes,
+                  ComputeStream const& stream,
+                  std::size_t chunk_bytes,
+                  OpT op)
+{
+  CuFileHandle file(path, flags);
+  if (!file.is_valid())
+  {
+    return false;
+  }
+  gpu::CurrentGPUGuard const guard(stream.get_device_id());
+  // cuFile I/O is synchronous and not ordered on any stream.
+  stream.wait_for_this();
+  for (std::size_t done = 0; done < bytes;)
+  {
+    std::size_t const size = std::min(chunk_bytes, bytes - done);
+    ssize_t const ret = op(file.get(),
+                           buf,
+                           size,
+                           static_cast<off_t>(offset + done),
+                           static_cast<off_t>(done));
+    if (ret <= 0)
+    {
+      return false;
+    }
+    done += static_cast<std::size_t>(ret);
+  }
+  return true;
+}
+
+#endif  // H2_HAS_CUFILE
+
+}  // anonymous namespace
+
+bool gds_enabled()
+{
+#if H2_HAS_CUFILE
+  static bool const enabled = env::get<bool>("GDS") && cufile_driver_open();
+  return enabled;
+#else
+  return false;
+#endif
+}
+
+void write_file_data(std::string const& path,
+                     std::uint64_t offset,
+                     void const* buf,
+                     std::size_t bytes,
+                     Device dev,
+                     ComputeStream const& stream,
+                     std::size_t chunk_bytes)
+{
+  if (bytes == 0)
+  {
+    return;
+  }
+  H2_ASSERT_ALWAYS(chunk_bytes > 0, "Chunk size must be positive");
+#if H2_HAS_CUFILE
+  if (dev == Device::GPU && gds_enabled()
+      && gds_transfer(
+        path, O_WRONLY, offset, buf, bytes, stream, chunk_bytes, cuFileWrite))
+  {
+    return;
+  }
+#endif
+  std::fstream f(path, std::ios::binary | std::ios::in | std::ios::out);
+  H2_ASSERT_ALWAYS(f, "Could not open ", path, " for writing");
+  f.seekp(static_cast<std::streamoff>(offset));
+  write_data(f, buf, bytes, dev, stream, chunk_bytes);
+  f.close();
+  check_stream(f, "write");
+}
+
+void read_file_data(std::string const& path,
+                    std::uint64_t offset,
+                    void* buf,
+                    std::size_t bytes,
+                    Device dev,
+                    ComputeStream const& stream,
+                    std::size_t chunk_bytes)
+{
+  if (bytes == 0)
+  {
+    return;
+  }
+  H2_ASSERT_ALWAYS(chunk_bytes > 0, "Chunk size must be positive");
+#if H2_HAS_CUFILE
+  if (dev == Device::GPU && gds_enabled()
+      && gds_transfer(
+        path, O_RDONLY, offset, buf, bytes, stream, chunk_bytes, cuFileRead))
+  {
+    return;
+  }
+#endif
+  std::ifstream f(path, std::ios::binary);
+  H2_ASSERT_ALWAYS(f, "Could not open ", path, " for reading");
+  f.seekg(static_cast<std::streamoff>(offset));
+  read_data(f, buf, bytes, dev, stream, chunk_bytes);
+}
+
+void write_header(std::ostream& os, TensorFileHeader const& header)
+{
+  os.write(magic, sizeof(magic));
+  write_value(os, TensorFileHeader::version);
+  write_value(os, header.type_token);
+  write_value(os, header.type_size);
+  write_value(os, static_cast<std::uint32_t>(header.shape.size()));
+  write_tuple_entries<std::int64_t>(os, header.shape);
+  write_tuple_entries<std::int64_t>(os, header.strides);
+  write_value(os, static_cast<std::uint32_t>(header.dim_types.size()));
+  write_tuple_entries<std::uint8_t>(os, header.dim_types);
+  write_value(os, static_cast<std::uint8_t>(header.distributed));
+  if (header.distributed)
+  {
+    H2_ASSERT_ALWAYS(header.global_shape.size() == header.distribution.size(),
+                     "Inconsistent distributed tensor metadata");
+    write_value(os, static_cast<std::uint32_t>(header.global_shape.size()));
+    write_tuple_entries<std::int64_t>(os, header.global_shape);
+    write_tuple_entries<std::uint8_t>(os, header.distribution);
+    write_value(os, static_cast<std::uint32_t>(header.grid_shape.size()));
+    write_tuple_entries<std::int64_t>(os, header.grid_shape);
+    write_value(os, static_cast<std::int32_t>(header.grid_rank));
+  }
+  write_value(os, static_cast<std::uint8_t>(header.compression));
+  write_value(os, header.data_bytes);
+  check_stream(os, "write");
+}
+
+TensorFileHeader read_header(std::istream& is)
+{
+  char file_magic[sizeof(magic)];
+  is.read(file_magic, sizeof(file_magic));
+  H2_ASSERT_ALWAYS(is && std::memcmp(file_magic, magic, sizeof(magic)) == 0,
+                   "Not a serialized H2 tensor");
+  std::uint32_t const version = read_value<std::uint32_t>(is);
+  H2_ASSERT_ALWAYS(version >= 1 && version <= TensorFileHeader::version,
+                   "Unsupported serialized tensor version ",
+                   version,
+                   " (expected at most ",
+                   TensorFileHeader::version,
+                   ")");
+
+  TensorFileHeader header;
+  header.type_token = read_value<TypeInfo::TokenType>(is);
+  header.type_size = read_value<std::uint32_t>(is);
+  std::uint32_t const ndim = read_ndim(is);
+  header.shape = read_tuple_entries<std::int64_t, ShapeTuple>(is, ndim);
+  header.strides = read_tuple_entries<std::int64_t, StrideTuple>(is, ndim);
+  header.dim_types =
+    read_tuple_entries<std::uint8_t, DimensionTypeTuple>(is, read_ndim(is));
+  header.distributed = read_value<std::uint8_t>(is) != 0;
+  if (header.distributed)
+  {
+    std::uint32_t const global_ndim = read_ndim(is);
+    header.global_shape =
+      read_tuple_entries<std::int64_t, ShapeTuple>(is, global_ndim);
+    header.distribution =
+      read_tuple_entries<std::uint8_t, DistributionTypeTuple>(is,
+                                                              global_ndim);
+    std::uint32_t const grid_ndim = read_ndim(is);
+    header.grid_shape =
+      read_tuple_entries<std::int64_t, ShapeTuple>(is, grid_ndim);
+    header.grid_rank = read_value<std::int32_t>(is);
+  }
+  if (version >= 2)
+  {
+    std::uint8_t const compression = read_value<std::uint8_t>(is);
+    H2_ASSERT_ALWAYS(
+      compression <= static_cast<std::uint8_t>(DataCompression::Zeros),
+      "Unknown serialized tensor compression ",
+      static_cast<int>(compression));
+    header.compression = static_cast<DataCompression>(compression);
+  }
+  header.data_bytes = read_value<std::uint64_t>(is);
+  return header;
+}
+
+void write_data(std::ostream& os,
+                void const* buf,
+                std::size_t bytes,
+                Device dev,
+                [[maybe_unused]] ComputeStream const& stream,
+                [[maybe_unused]] std::size_t chunk_bytes,
+                DataCompression compression)
+{
+  if (bytes == 0)
+  {
+    return;
+  }
+  if (compression != DataCompression::None)
+  {
+    write_compressed_data(
+      os, buf, bytes, dev, stream, chunk_bytes, compression);
+    return;
+  }
+  if (dev == Device::CPU)
+  {
+    os.write(static_cast<char const*>(buf), bytes);
+    check_stream(os, "write");
+    return;
+  }
+#ifdef H2_HAS_GPU
+  stage_from_gpu(
+    buf, bytes, stream, chunk_bytes, [&](char const* chunk, std::size_t size) {
+      os.write(chunk, size);
+      check_stream(os, "write");
+    });
+#else   // H2_HAS_GPU
+  throw H2Exception("Unknown device ", dev);
+#endif  // H2_HAS_GPU
+}
+
+void read_data(std::istream& is,
+               void* buf,
+               std::size_t bytes,
+               Device dev,
+               [[maybe_unused]] ComputeStream const& stream,
+               [[maybe_unused]] std::size_t chunk_bytes,
+               DataCompression compression)
+{
+  if (bytes == 0)
+  {
+    return;
+  }
+  if (compression != DataCompression::None)
+  {
+    read_compressed_data(
+      is, buf, bytes, dev, stream, chunk_bytes, compression);
+    return;
+  }
+  if (dev == Device::CPU)
+  {
+    is.read(static_cast<char*>(buf), bytes);
+    check_stream(is, "read");
+    return;
+  }
+#ifdef H2_HAS_GPU
+  H2_ASSERT_ALWAYS(chunk_bytes > 0, "Chunk size must be positive");
+  chunk_bytes = std::min(chunk_bytes, bytes);
+  std::array<ManagedBuffer<char>, 2> staging = {
+    ManagedBuffer<char>(chunk_bytes, Device::CPU, {}, MemoryKind::Pinned),
+    ManagedBuffer<char>(chunk_bytes, Device::CPU, {}, MemoryKind::Pinned)};
+  std::array<SyncEventRAII, 2> events = {SyncEventRAII{Device::GPU},
+                                         SyncEventRAII{Device::GPU}};
+  char* dst = static_cast<char*>(buf);
+  std::size_t const num_chunks = (bytes + chunk_bytes - 1) / chunk_bytes;
+  // Read chunk i while chunk i - 1 is copied to the device.
+  for (std::size_t i = 0; i < num_chunks; ++i)
+  {
+    std::size_t const size = std::min(chunk_bytes, bytes - i * chunk_bytes);
+    if (i >= 2)
+    {
+      // Staging buffer is still in use by the copy of chunk i - 2.
+      SyncEvent const& prev = events[i % 2];
+      prev.wait_for_this();
+    }
+    is.read(staging[i % 2].data(), size);
+    check_stream(is, "read");
+    gpu::mem_copy(dst + i * chunk_bytes,
+                  staging[i % 2].data(),
+                  size,
+                  stream.get_stream<Device::GPU>());
+    stream.add_sync_point(events[i % 2]);
+  }
+  // Staging buffers must not be released while copies are in flight.
+  for (auto const& event : events)
+  {
+    SyncEvent const& e = event;
+    e.wait_for_this();
+  }
+#else   // H2_HAS_GPU
+  throw H2Exception("Unknown device ", dev);
+#endif  // H2_HAS_GPU
+}
+
+}  // namespace internal
+}  // namespace h2
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/mmap.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef H2_HAS_GPU
+#include "h2/gpu/memory_utils.hpp"
+#endif
+
+namespace h2
+{
+
+namespace
+{
+
+/** Close a file descriptor when leaving scope. */
+struct FileDescriptor
+{
+  int fd;
+  ~FileDescriptor()
+  {
+    if (fd >= 0)
+    {
+      ::close(fd);
+    }
+  }
+};
+
+}  // anonymous namespace
+
+MappedFile::MappedFile(std::string const& path,
+                       MmapMode mode_,
+                       std::size_t offset,
+                       std::optional<std::size_t> length,
+                       [[maybe_unused]] bool register_with_gpu)
+  : mapping(nullptr),
+    mapping_size(0),
+    region(nullptr),
+    region_size(0),
+    mode(mode_),
+    gpu_registered(false)
+{
+  FileDescriptor file{::open(path.c_str(), O_RDONLY)};
+  if (file.fd < 0)
+  {
+    throw H2Exception("Could not open ", path, ": ", std::strerror(errno));
+  }
+  struct stat st;
+  if (::fstat(file.fd, &st) != 0)
+  {
+    throw H2Exception("Could not stat ", path, ": ", std::strerror(errno));
+  }
+  std::size_t const file_size = static_cast<std::size_t>(st.st_size);
+  H2_ASSERT_ALWAYS(offset <= file_size,
+                   "Offset ",
+                   offset,
+                   " is past the end of ",
+                   path,
+                   " (",
+                   file_size,
+                   " bytes)");
+  region_size = length.value_or(file_size - offset);
+  H2_ASSERT_ALWAYS(region_size <= file_size - offset,
+                   "Cannot map ",
+                   region_size,
+                   " bytes at offset ",
+                   offset,
+                   " of ",
+                   path,
+                   " (",
+                   file_size,
+                   " bytes)");
+  if (region_size == 0)
+  {
+    return;  // Nothing to map.
+  }
+
+  // mmap requires a page-aligned offset.
+  std::size_t const page_size =
+    static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+  std::size_t const aligned_offset = offset / page_size * page_size;
+  mapping_size = region_size + (offset - aligned_offset);
+  int const prot =
+    (mode == MmapMode::ReadOnly) ? PROT_READ : (PROT_READ | PROT_WRITE);
+  mapping = ::mmap(nullptr,
+                   mapping_size,
+                   prot,
+                   MAP_PRIVATE,
+                   file.fd,
+                   static_cast<off_t>(aligned_offset));
+  if (mapping == MAP_FAILED)
+  {
+    mapping = nullptr;
+    throw H2Exception("Could not map ", path, ": ", std::strerror(errno));
+  }
+  region = static_cast<char*>(mapping) + (offset - aligned_offset);
+
+#ifdef H2_HAS_GPU
+  if (register_with_gpu)
+  {
+    try
+    {
+      gpu::host_register(mapping, mapping_size, mode == MmapMode::ReadOnly);
+    }
+    catch (...)
+    {
+      ::munmap(mapping, mapping_size);
+      throw;
+    }
+    gpu_registered = true;
+  }
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+  if (mapping)
+  {
+#ifdef H2_HAS_GPU
+    if (gpu_registered)
+    {
+      H2_TERMINATE_ON_THROW_ALWAYS(gpu::host_unregister(mapping));
+    }
+#endif
+    ::munmap(mapping, mapping_size);
+  }
+}
+
+}  // namespace h2
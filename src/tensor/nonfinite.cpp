@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/nonfinite.hpp"
+
+#include "h2/core/profiling.hpp"
+#include "h2/loops/cpu_reductions.hpp"
+
+#include <cstdint>
+
+namespace h2
+{
+
+namespace impl
+{
+
+template <typename T>
+void nonfinite_impl(CPUDev_t,
+                    Tensor<T> const& tensor,
+                    std::int32_t* flag,
+                    ComputeStream const& stream)
+{
+  H2_PROFILE_RANGE("h2::has_nonfinite", Compute);
+  auto multi_stream = create_multi_sync(stream, tensor.get_stream());
+  h2::cpu::strided_reduction_loop(
+    internal::NonfiniteReduction<T>{},
+    tensor.shape(),
+    tensor.strides(),
+    StrideTuple(TuplePad<StrideTuple>(tensor.ndim(), 0)),
+    flag,
+    tensor.const_data());
+}
+
+#define PROTO(T)                                                               \
+  template void nonfinite_impl<T>(                                             \
+    CPUDev_t, Tensor<T> const&, std::int32_t*, ComputeStream const&)
+PROTO(float);
+PROTO(double);
+PROTO(std::int32_t);
+PROTO(std::uint32_t);
+#undef PROTO
+
+}  // namespace impl
+
+}  // namespace h2
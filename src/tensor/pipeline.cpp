@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/pipeline.hpp"
+
+#include "h2/utils/Error.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace h2
+{
+
+namespace
+{
+
+/**
+ * Return the micro-batch and chunk of the `k`'th forward (or, with
+ * `backward`, backward) pass of an interleaved schedule.
+ *
+ * Passes run on groups of `num_stages` micro-batches, one chunk after
+ * the other; backward passes go through the chunks in reverse.
+ */
+PipelineOp get_interleaved_op(int k,
+                              int num_stages,
+                              int num_chunks,
+                              bool backward)
+{
+  int const group = k / (num_stages * num_chunks);
+  int chunk = (k / num_stages) % num_chunks;
+  if (backward)
+  {
+    chunk = num_chunks - 1 - chunk;
+  }
+  return {backward ? PipelineOpType::Backward : PipelineOpType::Forward,
+          group * num_stages + k % num_stages,
+          chunk};
+}
+
+}  // anonymous namespace
+
+std::vector<PipelineOp> make_pipeline_schedule(int num_stages,
+                                               int stage,
+                                               int num_micro_batches,
+                                               int num_chunks)
+{
+  H2_ASSERT_ALWAYS(num_stages > 0 && stage >= 0 && stage < num_stages,
+                   "Invalid pipeline stage ",
+                   stage,
+                   " of ",
+                   num_stages);
+  H2_ASSERT_ALWAYS(num_micro_batches >= 0,
+                   "Invalid number of micro-batches ",
+                   num_micro_batches);
+  H2_ASSERT_ALWAYS(
+    num_chunks > 0, "Invalid number of pipeline chunks ", num_chunks);
+
+  std::vector<PipelineOp> ops;
+  ops.reserve(2 * static_cast<std::size_t>(num_micro_batches) * num_chunks);
+
+  if (num_chunks == 1)
+  {
+    int const num_warmup = std::min(num_stages - stage - 1, num_micro_batches);
+    for (int i = 0; i < num_warmup; ++i)
+    {
+      ops.push_back({PipelineOpType::Forward, i, 0});
+    }
+    for (int i = 0; i < num_micro_batches - num_warmup; ++i)
+    {
+      ops.push_back({PipelineOpType::Forward, num_warmup + i, 0});
+      ops.push_back({PipelineOpType::Backward, i, 0});
+    }
+    for (int i = num_micro_batches - num_warmup; i < num_micro_batches; ++i)
+    {
+      ops.push_back({PipelineOpType::Backward, i, 0});
+    }
+    return ops;
+  }
+
+  H2_ASSERT_ALWAYS(num_micro_batches % num_stages == 0,
+                   "Interleaved pipelines need a multiple of the number of "
+                   "stages (",
+                   num_stages,
+                   ") of micro-batches, got ",
+                   num_micro_batches);
+  int const num_passes = num_micro_batches * num_chunks;
+  // Each stage runs ahead of the next by two forward passes, and the
+  // first chunk of every stage must finish before the last begins.
+  int num_warmup =
+    std::min((num_stages - stage - 1) * 2 + (num_chunks - 1) * num_stages,
+             num_passes);
+  if (num_micro_batches == num_stages)
+  {
+    num_warmup = num_passes;
+  }
+  for (int k = 0; k < num_warmup; ++k)
+  {
+    ops.push_back(get_interleaved_op(k, num_stages, num_chunks, false));
+  }
+  for (int k = 0; k < num_passes - num_warmup; ++k)
+  {
+    ops.push_back(
+      get_interleaved_op(num_warmup + k, num_stages, num_chunks, false));
+    ops.push_back(get_interleaved_op(k, num_stages, num_chunks, true));
+  }
+  for (int k = num_passes - num_warmup; k < num_passes; ++k)
+  {
+    ops.push_back(get_interleaved_op(k, num_stages, num_chunks, true));
+  }
+  return ops;
+}
+
+}  // namespace h2
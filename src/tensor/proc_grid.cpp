@@ -0,0 +1,170 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/proc_grid.hpp"
+
+#include "h2/utils/As.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+namespace h2
+{
+
+namespace
+{
+
+void check_mpi(int ret, char const* what)
+{
+  if (ret != MPI_SUCCESS)
+  {
+    char msg[MPI_MAX_ERROR_STRING];
+    int len = 0;
+    MPI_Error_string(ret, msg, &len);
+    throw H2Exception(what,
+                      " failed while creating a grid communicator: ",
+                      std::string(msg, len));
+  }
+}
+
+/** Free an MPI communicator when leaving scope. */
+struct ScopedComm
+{
+  MPI_Comm comm = MPI_COMM_NULL;
+  ~ScopedComm()
+  {
+    if (comm != MPI_COMM_NULL)
+    {
+      MPI_Comm_free(&comm);
+    }
+  }
+};
+
+}  // anonymous namespace
+
+Comm& ProcessorGrid::get_subcomm(DimensionOrderTuple const& dims) const
+{
+  std::vector<NDimType> const key(dims.begin(), dims.end());
+  std::lock_guard<std::mutex> lock(subcomms->mutex);
+  auto it = subcomms->comms.find(key);
+  if (it != subcomms->comms.end())
+  {
+    return *it->second;
+  }
+
+  H2_ASSERT_ALWAYS(grid_comm->GetMPIComm() != MPI_COMM_NULL,
+                   "Cannot get a sub-communicator of a null grid");
+  for (typename DimensionOrderTuple::size_type i = 0; i < dims.size(); ++i)
+  {
+    H2_ASSERT_ALWAYS(dims[i] >= 0
+                       && static_cast<typename ShapeTuple::size_type>(dims[i])
+                            < ndim(),
+                     "Invalid dimension ",
+                     dims[i],
+                     " for grid of shape ",
+                     grid_shape);
+    for (typename DimensionOrderTuple::size_type j = 0; j < i; ++j)
+    {
+      H2_ASSERT_ALWAYS(
+        dims[i] != dims[j], "Duplicate dimension ", dims[i], " in ", dims);
+    }
+  }
+
+  // Processes agreeing in every other dimension share a color, and are
+  // ordered by their coordinates in `dims`.
+  RankType color = rank();
+  RankType key_rank = 0;
+  RankType stride = 1;
+  for (auto const& dim : dims)
+  {
+    RankType const dim_rank = get_dimension_rank(dim);
+    color -= dim_rank * grid_strides[dim];
+    key_rank += dim_rank * stride;
+    stride *= safe_as<RankType>(grid_shape[dim]);
+  }
+  ScopedComm split_comm;
+  check_mpi(MPI_Comm_split(
+              grid_comm->GetMPIComm(), color, key_rank, &split_comm.comm),
+            "MPI_Comm_split");
+  auto const& comm = subcomms->comms[key] =
+    std::make_unique<Comm>(split_comm.comm);
+  return *comm;
+}
+
+ProcessorGrid make_topology_aware_grid(Comm const& comm,
+                                       ShapeTuple shape,
+                                       DimensionOrderTuple comm_dims)
+{
+  H2_ASSERT_ALWAYS(comm.Size() == product<RankType>(shape),
+                   "Grid size (",
+                   shape,
+                   ") must match communicator size (",
+                   comm.Size(),
+                   ")");
+  // The listed dimensions vary fastest, followed by the rest.
+  DimensionOrderTuple dim_order = comm_dims;
+  for (typename ShapeTuple::size_type i = 0; i < shape.size(); ++i)
+  {
+    auto const dim = static_cast<typename DimensionOrderTuple::type>(i);
+    if (!any_of(comm_dims, [&](auto const& d) { return d == dim; }))
+    {
+      dim_order.append(dim);
+    }
+  }
+  H2_ASSERT_ALWAYS(is_dimension_order(dim_order, shape.size()),
+                   "Invalid communication dimensions ",
+                   comm_dims,
+                   " for grid of shape ",
+                   shape);
+
+  // Find the lowest rank on each process's node.
+  MPI_Comm const mpi_comm = comm.GetMPIComm();
+  int const rank = comm.Rank();
+  int const size = comm.Size();
+  ScopedComm node_comm;
+  check_mpi(MPI_Comm_split_type(mpi_comm,
+                                MPI_COMM_TYPE_SHARED,
+                                rank,
+                                MPI_INFO_NULL,
+                                &node_comm.comm),
+            "MPI_Comm_split_type");
+  int node_leader = rank;
+  check_mpi(MPI_Bcast(&node_leader, 1, MPI_INT, 0, node_comm.comm),
+            "MPI_Bcast");
+  std::vector<int> node_leaders(size);
+  check_mpi(MPI_Allgather(&node_leader,
+                          1,
+                          MPI_INT,
+                          node_leaders.data(),
+                          1,
+                          MPI_INT,
+                          mpi_comm),
+            "MPI_Allgather");
+
+  // Order processes by node, then by their rank in `comm`.
+  int position = 0;
+  for (int r = 0; r < size; ++r)
+  {
+    if (node_leaders[r] < node_leader
+        || (node_leaders[r] == node_leader && r < rank))
+    {
+      ++position;
+    }
+  }
+  ScopedComm ordered_comm;
+  check_mpi(MPI_Comm_split(mpi_comm, 0, position, &ordered_comm.comm),
+            "MPI_Comm_split");
+  // The grid duplicates the communicator.
+  return ProcessorGrid(Comm(ordered_comm.comm), shape, dim_order);
+}
+
+}  // namespace h2
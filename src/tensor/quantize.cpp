@@ -0,0 +1,183 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/quantize.hpp"
+
+#include "h2/core/profiling.hpp"
+#include "h2/loops/cpu_loops.hpp"
+#include "h2/tensor/copy_buffer.hpp"
+
+namespace h2
+{
+
+QuantizedTensor::QuantizedTensor(Device device,
+                                 ShapeTuple const& shape,
+                                 DimensionTypeTuple const& dim_types,
+                                 float scale,
+                                 std::int32_t zero_point,
+                                 std::optional<ComputeStream> const stream)
+  : qdata(std::make_unique<Tensor<std::int8_t>>(
+      device, shape, dim_types, StrictAlloc, stream)),
+    per_channel(false),
+    channel_dim(0),
+    scales{scale},
+    zero_points{zero_point}
+{
+  init_params(qdata->get_stream());
+}
+
+QuantizedTensor::QuantizedTensor(Device device,
+                                 ShapeTuple const& shape,
+                                 DimensionTypeTuple const& dim_types,
+                                 typename ShapeTuple::size_type channel_dim_,
+                                 std::vector<float> const& scales_,
+                                 std::vector<std::int32_t> const& zero_points_,
+                                 std::optional<ComputeStream> const stream)
+  : qdata(std::make_unique<Tensor<std::int8_t>>(
+      device, shape, dim_types, StrictAlloc, stream)),
+    per_channel(true),
+    channel_dim(channel_dim_),
+    scales(scales_),
+    zero_points(zero_points_)
+{
+  H2_ASSERT_ALWAYS(channel_dim < shape.size(),
+                   "Channel dimension ",
+                   channel_dim,
+                   " is out of range for shape ",
+                   shape);
+  std::size_t const num_channels = shape[channel_dim];
+  H2_ASSERT_ALWAYS(scales.size() == num_channels
+                     && zero_points.size() == num_channels,
+                   "Need ",
+                   num_channels,
+                   " scales and zero points, got ",
+                   scales.size(),
+                   " and ",
+                   zero_points.size());
+  init_params(qdata->get_stream());
+}
+
+void QuantizedTensor::init_params(ComputeStream const& stream)
+{
+  for (float const scale : scales)
+  {
+    H2_ASSERT_ALWAYS(scale > 0.0f, "Quantization scales must be positive");
+  }
+  ShapeTuple const params_shape{static_cast<DimType>(scales.size())};
+  Device const device = stream.get_device();
+  scales_tensor = std::make_unique<Tensor<float>>(
+    device, params_shape, DTTuple{DT::Any}, StrictAlloc, stream);
+  zero_points_tensor = std::make_unique<Tensor<std::int32_t>>(
+    device, params_shape, DTTuple{DT::Any}, StrictAlloc, stream);
+  ComputeStream const cpu_stream{Device::CPU};
+  copy_buffer(scales_tensor->data(),
+              stream,
+              scales.data(),
+              cpu_stream,
+              scales.size());
+  copy_buffer(zero_points_tensor->data(),
+              stream,
+              zero_points.data(),
+              cpu_stream,
+              zero_points.size());
+}
+
+StrideTuple QuantizedTensor::get_param_strides() const
+{
+  StrideTuple strides(TuplePad<StrideTuple>(qdata->shape().size(), 0));
+  if (per_channel)
+  {
+    strides[channel_dim] = 1;
+  }
+  return strides;
+}
+
+namespace impl
+{
+
+template <typename T>
+void quantize_impl(CPUDev_t, QuantizedTensor& dst, Tensor<T> const& src)
+{
+  H2_PROFILE_RANGE("h2::quantize", Compute);
+  Tensor<std::int8_t>& qdata = dst.data();
+  T const* __restrict__ src_buf = src.const_data();
+  std::int8_t* __restrict__ dst_buf = qdata.data();
+  if (!dst.is_per_channel())
+  {
+    float const scale = dst.get_scales()[0];
+    std::int32_t const zero_point = dst.get_zero_points()[0];
+    h2::cpu::strided_elementwise_loop(
+      [scale, zero_point](T const val) {
+        return quantize_value(val, scale, zero_point);
+      },
+      src.shape(),
+      {qdata.strides(), src.strides()},
+      dst_buf,
+      src_buf);
+    return;
+  }
+  StrideTuple const param_strides = dst.get_param_strides();
+  h2::cpu::strided_elementwise_loop(
+    [](T const val, float const scale, std::int32_t const zero_point) {
+      return quantize_value(val, scale, zero_point);
+    },
+    src.shape(),
+    {qdata.strides(), src.strides(), param_strides, param_strides},
+    dst_buf,
+    src_buf,
+    dst.get_scales_tensor().const_data(),
+    dst.get_zero_points_tensor().const_data());
+}
+
+template <typename T>
+void dequantize_impl(CPUDev_t, Tensor<T>& dst, QuantizedTensor const& src)
+{
+  H2_PROFILE_RANGE("h2::dequantize", Compute);
+  Tensor<std::int8_t> const& qdata = src.data();
+  std::int8_t const* __restrict__ src_buf = qdata.const_data();
+  T* __restrict__ dst_buf = dst.data();
+  if (!src.is_per_channel())
+  {
+    float const scale = src.get_scales()[0];
+    std::int32_t const zero_point = src.get_zero_points()[0];
+    h2::cpu::strided_elementwise_loop(
+      [scale, zero_point](std::int8_t const q) -> T {
+        return dequantize_value<T>(q, scale, zero_point);
+      },
+      qdata.shape(),
+      {dst.strides(), qdata.strides()},
+      dst_buf,
+      src_buf);
+    return;
+  }
+  StrideTuple const param_strides = src.get_param_strides();
+  h2::cpu::strided_elementwise_loop(
+    [](std::int8_t const q,
+       float const scale,
+       std::int32_t const zero_point) -> T {
+      return dequantize_value<T>(q, scale, zero_point);
+    },
+    qdata.shape(),
+    {dst.strides(), qdata.strides(), param_strides, param_strides},
+    dst_buf,
+    src_buf,
+    src.get_scales_tensor().const_data(),
+    src.get_zero_points_tensor().const_data());
+}
+
+#define PROTO(T)                                                               \
+  template void quantize_impl<T>(                                              \
+    CPUDev_t, QuantizedTensor&, Tensor<T> const&);                             \
+  template void dequantize_impl<T>(                                            \
+    CPUDev_t, Tensor<T>&, QuantizedTensor const&)
+PROTO(float);
+PROTO(double);
+#undef PROTO
+
+}  // namespace impl
+
+}  // namespace h2
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/profiling.hpp"
+#include "h2/loops/gpu_loops.cuh"
+#include "h2/tensor/quantize.hpp"
+
+namespace h2
+{
+
+namespace impl
+{
+
+template <typename T>
+void quantize_impl(GPUDev_t, QuantizedTensor& dst, Tensor<T> const& src)
+{
+  H2_PROFILE_RANGE("h2::quantize", Compute);
+  Tensor<std::int8_t>& qdata = dst.data();
+  T const* __restrict__ src_buf = src.const_data();
+  std::int8_t* __restrict__ dst_buf = qdata.data();
+  auto stream = create_multi_sync(qdata.get_stream(), src.get_stream());
+  if (!dst.is_per_channel())
+  {
+    float const scale = dst.get_scales()[0];
+    std::int32_t const zero_point = dst.get_zero_points()[0];
+    h2::gpu::launch_strided_elementwise_loop(
+      [scale, zero_point] H2_GPU_LAMBDA(T const val) -> std::int8_t {
+        return quantize_value(val, scale, zero_point);
+      },
+      stream,
+      src.shape(),
+      {qdata.strides(), src.strides()},
+      dst_buf,
+      src_buf);
+    return;
+  }
+  // The scales and zero points are broadcast along all but the channel
+  // dimension, so each thread loads those of its element's channel.
+  StrideTuple const param_strides = dst.get_param_strides();
+  h2::gpu::launch_strided_elementwise_loop(
+    [] H2_GPU_LAMBDA(T const val,
+                     float const scale,
+                     std::int32_t const zero_point) -> std::int8_t {
+      return quantize_value(val, scale, zero_point);
+    },
+    stream,
+    src.shape(),
+    {qdata.strides(), src.strides(), param_strides, param_strides},
+    dst_buf,
+    src_buf,
+    dst.get_scales_tensor().const_data(),
+    dst.get_zero_points_tensor().const_data());
+}
+
+template <typename T>
+void dequantize_impl(GPUDev_t, Tensor<T>& dst, QuantizedTensor const& src)
+{
+  H2_PROFILE_RANGE("h2::dequantize", Compute);
+  Tensor<std::int8_t> const& qdata = src.data();
+  std::int8_t const* __restrict__ src_buf = qdata.const_data();
+  T* __restrict__ dst_buf = dst.data();
+  auto stream = create_multi_sync(dst.get_stream(), qdata.get_stream());
+  if (!src.is_per_channel())
+  {
+    float const scale = src.get_scales()[0];
+    std::int32_t const zero_point = src.get_zero_points()[0];
+    h2::gpu::launch_strided_elementwise_loop(
+      [scale, zero_point] H2_GPU_LAMBDA(std::int8_t const q) -> T {
+        return dequantize_value<T>(q, scale, zero_point);
+      },
+      stream,
+      qdata.shape(),
+      {dst.strides(), qdata.strides()},
+      dst_buf,
+      src_buf);
+    return;
+  }
+  StrideTuple const param_strides = src.get_param_strides();
+  h2::gpu::launch_strided_elementwise_loop(
+    [] H2_GPU_LAMBDA(std::int8_t const q,
+                     float const scale,
+                     std::int32_t const zero_point) -> T {
+      return dequantize_value<T>(q, scale, zero_point);
+    },
+    stream,
+    qdata.shape(),
+    {dst.strides(), qdata.strides(), param_strides, param_strides},
+    dst_buf,
+    src_buf,
+    src.get_scales_tensor().const_data(),
+    src.get_zero_points_tensor().const_data());
+}
+
+#define PROTO(T)                                                               \
+  template void quantize_impl<T>(                                              \
+    GPUDev_t, QuantizedTensor&, Tensor<T> const&);                             \
+  template void dequantize_impl<T>(                                            \
+    GPUDev_t, Tensor<T>&, QuantizedTensor const&)
+PROTO(float);
+PROTO(double);
+#undef PROTO
+
+}  // namespace impl
+
+}  // namespace h2
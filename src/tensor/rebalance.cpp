@@ -0,0 +1,187 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/rebalance.hpp"
+
+#include "h2/tensor/straggler_monitor.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+
+namespace h2
+{
+
+BlockSizes compute_balanced_block_sizes(BlockSizes const& block_sizes,
+                                        std::vector<double> const& work_times,
+                                        DimType min_size)
+{
+  std::size_t const num_blocks = block_sizes.size();
+  H2_ASSERT_ALWAYS(work_times.size() == num_blocks,
+                   "Need a work time for each of the ",
+                   num_blocks,
+                   " blocks, got ",
+                   work_times.size());
+  if (num_blocks == 0)
+  {
+    return BlockSizes{};
+  }
+  DimType const total =
+    std::accumulate(block_sizes.begin(), block_sizes.end(), DimType{0});
+  min_size = std::clamp(
+    min_size, DimType{0}, total / static_cast<DimType>(num_blocks));
+
+  // Speed of each rank in indices per second.
+  std::vector<double> speeds(num_blocks, 0.0);
+  double speed_sum = 0.0;
+  std::size_t num_measured = 0;
+  for (std::size_t i = 0; i < num_blocks; ++i)
+  {
+    if (block_sizes[i] > 0 && work_times[i] > 0.0)
+    {
+      speeds[i] = block_sizes[i] / work_times[i];
+      speed_sum += speeds[i];
+      ++num_measured;
+    }
+  }
+  double const default_speed =
+    (num_measured > 0) ? speed_sum / num_measured : 1.0;
+  for (std::size_t i = 0; i < num_blocks; ++i)
+  {
+    if (speeds[i] == 0.0)
+    {
+      speeds[i] = default_speed;
+    }
+  }
+
+  // Split the indices in proportion to speed, fixing blocks that would
+  // be too small at the minimum size and splitting the rest among the
+  // others, until no more are too small.
+  std::vector<double> shares(num_blocks, 0.0);
+  std::vector<bool> is_fixed(num_blocks, false);
+  for (bool changed = true; changed;)
+  {
+    changed = false;
+    double free_total = static_cast<double>(total);
+    double free_speed = 0.0;
+    for (std::size_t i = 0; i < num_blocks; ++i)
+    {
+      if (is_fixed[i])
+      {
+        free_total -= min_size;
+      }
+      else
+      {
+        free_speed += speeds[i];
+      }
+    }
+    for (std::size_t i = 0; i < num_blocks; ++i)
+    {
+      if (is_fixed[i])
+      {
+        shares[i] = min_size;
+        continue;
+      }
+      shares[i] = free_total * speeds[i] / free_speed;
+      if (shares[i] < min_size)
+      {
+        is_fixed[i] = true;
+        changed = true;
+      }
+    }
+  }
+
+  // Round down, then hand out the remaining indices to the blocks with
+  // the largest fractional parts.
+  BlockSizes new_sizes(num_blocks);
+  std::vector<std::size_t> order(num_blocks);
+  DimType assigned = 0;
+  for (std::size_t i = 0; i < num_blocks; ++i)
+  {
+    new_sizes[i] = static_cast<DimType>(std::floor(shares[i]));
+    assigned += new_sizes[i];
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+    return shares[a] - new_sizes[a] > shares[b] - new_sizes[b];
+  });
+  for (std::size_t i = 0; assigned < total; i = (i + 1) % num_blocks)
+  {
+    ++new_sizes[order[i]];
+    ++assigned;
+  }
+  return new_sizes;
+}
+
+std::vector<double> get_dim_work_times(ProcessorGrid const& grid,
+                                       typename ShapeTuple::size_type dim,
+                                       std::vector<double> const& rank_times)
+{
+  H2_ASSERT_ALWAYS(rank_times.size()
+                     == static_cast<std::size_t>(grid.size()),
+                   "Need a work time for each of the ",
+                   grid.size(),
+                   " ranks of the grid, got ",
+                   rank_times.size());
+  std::vector<double> dim_times(grid.shape(dim), 0.0);
+  for (RankType r = 0; r < grid.size(); ++r)
+  {
+    double& t = dim_times[grid.get_dimension_rank(dim, r)];
+    t = std::max(t, rank_times[r]);
+  }
+  return dim_times;
+}
+
+std::vector<double> get_straggler_work_times(ProcessorGrid const& grid)
+{
+  std::vector<StragglerStats> const stats =
+    get_straggler_stats(grid.comm().GetMPIComm());
+  std::vector<double> times;
+  if (stats.size() == static_cast<std::size_t>(grid.size()))
+  {
+    times.reserve(stats.size());
+    for (auto const& s : stats)
+    {
+      times.push_back(s.mean_work);
+    }
+  }
+  return times;
+}
+
+namespace internal
+{
+
+BlockSizes get_block_sizes(BaseDistTensor const& tensor,
+                           typename ShapeTuple::size_type dim)
+{
+  if (tensor.distribution(dim) == Distribution::Variable)
+  {
+    return tensor.block_sizes(dim);
+  }
+  H2_ASSERT_ALWAYS(tensor.distribution(dim) == Distribution::Block,
+                   "Only Block and Variable dimensions have block sizes, "
+                   "but dimension ",
+                   dim,
+                   " is ",
+                   tensor.distribution(dim));
+  ProcessorGrid const grid = tensor.proc_grid();
+  BlockSizes sizes(grid.shape(dim));
+  for (RankType r = 0; r < static_cast<RankType>(sizes.size()); ++r)
+  {
+    sizes[r] = get_dim_local_size<Distribution::Block>(
+      tensor.shape(dim), grid.shape(dim), r, false);
+  }
+  return sizes;
+}
+
+}  // namespace internal
+
+}  // namespace h2
@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/reduce.hpp"
+
+#include "h2/core/profiling.hpp"
+#include "h2/loops/cpu_loops.hpp"
+#include "h2/loops/cpu_reductions.hpp"
+#include "h2/loops/reduction_helpers.hpp"
+
+#include <cstdint>
+
+namespace h2
+{
+
+namespace impl
+{
+
+template <typename T>
+void reduce_impl(CPUDev_t,
+                 Tensor<T>& dst,
+                 Tensor<T> const& src,
+                 StrideTuple const& out_strides,
+                 ReductionOp op)
+{
+  H2_PROFILE_RANGE("h2::reduce", Compute);
+  T* __restrict__ dst_buf = dst.data();
+  dispatch_reduction_op<T>(op, [&](auto const& reduction) {
+    if (src.is_empty())
+    {
+      T const identity = reduction.identity();
+      h2::cpu::strided_elementwise_loop([identity]() { return identity; },
+                                        dst.shape(),
+                                        {dst.strides()},
+                                        dst_buf);
+      return;
+    }
+    h2::cpu::strided_reduction_loop(reduction,
+                                    src.shape(),
+                                    src.strides(),
+                                    out_strides,
+                                    dst_buf,
+                                    src.const_data());
+  });
+}
+
+template <typename T>
+void divide_impl(CPUDev_t, Tensor<T>& dst, DataIndexType count)
+{
+  T const divisor = static_cast<T>(count);
+  T* __restrict__ dst_buf = dst.data();
+  h2::cpu::strided_elementwise_loop(
+    [divisor](T const val) { return val / divisor; },
+    dst.shape(),
+    {dst.strides(), dst.strides()},
+    dst_buf,
+    static_cast<T const*>(dst_buf));
+}
+
+#define PROTO(T)                                                               \
+  template void reduce_impl<T>(CPUDev_t,                                       \
+                               Tensor<T>&,                                     \
+                               Tensor<T> const&,                               \
+                               StrideTuple const&,                             \
+                               ReductionOp);                                   \
+  template void divide_impl<T>(CPUDev_t, Tensor<T>&, DataIndexType)
+PROTO(float);
+PROTO(double);
+PROTO(std::int32_t);
+PROTO(std::uint32_t);
+#undef PROTO
+
+}  // namespace impl
+
+}  // namespace h2
@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/profiling.hpp"
+#include "h2/loops/gpu_loops.cuh"
+#include "h2/loops/gpu_reductions.cuh"
+#include "h2/loops/reduction_helpers.hpp"
+#include "h2/tensor/reduce.hpp"
+
+#include <cstdint>
+
+namespace h2
+{
+
+namespace impl
+{
+
+// This is a named function rather than a lambda since extended device
+// lambdas may not be defined in other lambdas.
+template <typename OpT, typename T>
+void launch_reduction(OpT const& reduction,
+                      Tensor<T>& dst,
+                      Tensor<T> const& src,
+                      StrideTuple const& out_strides,
+                      ComputeStream const& stream)
+{
+  T* __restrict__ dst_buf = dst.data();
+  if (src.is_empty())
+  {
+    T const identity = reduction.identity();
+    h2::gpu::launch_strided_elementwise_loop(
+      [identity] H2_GPU_LAMBDA() -> T { return identity; },
+      stream,
+      dst.shape(),
+      {dst.strides()},
+      dst_buf);
+    return;
+  }
+  h2::gpu::launch_strided_reduction_loop(reduction,
+                                         stream,
+                                         src.shape(),
+                                         src.strides(),
+                                         out_strides,
+                                         dst_buf,
+                                         src.const_data());
+}
+
+template <typename T>
+void reduce_impl(GPUDev_t,
+                 Tensor<T>& dst,
+                 Tensor<T> const& src,
+                 StrideTuple const& out_strides,
+                 ReductionOp op)
+{
+  H2_PROFILE_RANGE("h2::reduce", Compute);
+  auto stream = create_multi_sync(dst.get_stream(), src.get_stream());
+  dispatch_reduction_op<T>(op, [&](auto const& reduction) {
+    launch_reduction(reduction, dst, src, out_strides, stream);
+  });
+}
+
+template <typename T>
+void divide_impl(GPUDev_t, Tensor<T>& dst, DataIndexType count)
+{
+  T const divisor = static_cast<T>(count);
+  T* __restrict__ dst_buf = dst.data();
+  h2::gpu::launch_strided_elementwise_loop(
+    [divisor] H2_GPU_LAMBDA(T const val) -> T { return val / divisor; },
+    dst.get_stream(),
+    dst.shape(),
+    {dst.strides(), dst.strides()},
+    dst_buf,
+    static_cast<T const*>(dst_buf));
+}
+
+#define PROTO(T)                                                               \
+  template void reduce_impl<T>(GPUDev_t,                                       \
+                               Tensor<T>&,                                     \
+                               Tensor<T> const&,                               \
+                               StrideTuple const&,                             \
+                               ReductionOp);                                   \
+  template void divide_impl<T>(GPUDev_t, Tensor<T>&, DataIndexType)
+PROTO(float);
+PROTO(double);
+PROTO(std::int32_t);
+PROTO(std::uint32_t);
+#undef PROTO
+
+}  // namespace impl
+
+}  // namespace h2
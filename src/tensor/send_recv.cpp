@@ -0,0 +1,239 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/send_recv.hpp"
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/tracer.hpp"
+#include "h2/tensor/copy_buffer.hpp"
+#include "h2/tensor/tensor_utils.hpp"
+#include "h2/utils/As.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <cstddef>
+#include <string>
+
+#include <mpi.h>
+
+namespace h2
+{
+
+namespace
+{
+
+void check_mpi(int ret, char const* what)
+{
+  if (ret != MPI_SUCCESS)
+  {
+    char msg[MPI_MAX_ERROR_STRING];
+    int len = 0;
+    MPI_Error_string(ret, msg, &len);
+    throw H2Exception(
+      what, " failed while transferring a tensor: ", std::string(msg, len));
+  }
+}
+
+/** Return true if `tensor` can be transferred without staging. */
+bool is_direct(BaseTensor const& tensor)
+{
+  return tensor.get_device() == Device::CPU && tensor.is_contiguous();
+}
+
+}  // anonymous namespace
+
+struct TensorCommRequest::State
+{
+  State(std::size_t bytes_, bool staged, ComputeStream const& stream_)
+    : bytes(bytes_),
+      stream(stream_),
+      staging(staged ? bytes_ : 0,
+              Device::CPU,
+              ComputeStream{Device::CPU},
+              (stream_.get_device() == Device::CPU) ? MemoryKind::Default
+                                                    : MemoryKind::Pinned)
+  {}
+
+  MPI_Request request = MPI_REQUEST_NULL;
+  std::size_t bytes;
+  ComputeStream stream;
+  internal::ManagedBuffer<std::byte> staging;
+  // Set for staged receives, which unpack into the tensor on
+  // completion.
+  BaseTensor* recv_tensor = nullptr;
+
+  void finish(MPI_Status const& status)
+  {
+    if (recv_tensor == nullptr)
+    {
+      return;
+    }
+    int count = 0;
+    check_mpi(MPI_Get_count(&status, MPI_BYTE, &count), "MPI_Get_count");
+    if (static_cast<std::size_t>(count) != bytes)
+    {
+      throw H2Exception(
+        "Received ", count, " bytes into a tensor of ", bytes, " bytes");
+    }
+    if (staging.size() == 0)
+    {
+      return;
+    }
+    copy_strided_buffer(recv_tensor->storage_data(),
+                        recv_tensor->strides(),
+                        stream,
+                        staging.const_data(),
+                        get_contiguous_strides(recv_tensor->shape()),
+                        staging.get_stream(),
+                        recv_tensor->shape(),
+                        recv_tensor->get_type_info().get_size());
+    // The staging buffer must outlive the copy.
+    stream.wait_for_this();
+  }
+};
+
+TensorCommRequest::TensorCommRequest() = default;
+
+TensorCommRequest::TensorCommRequest(std::unique_ptr<State> state_)
+  : state(std::move(state_))
+{}
+
+TensorCommRequest::~TensorCommRequest()
+{
+  if (state)
+  {
+    H2_TERMINATE_ON_THROW_DEBUG(wait());
+  }
+}
+
+TensorCommRequest::TensorCommRequest(TensorCommRequest&&) = default;
+
+TensorCommRequest& TensorCommRequest::operator=(TensorCommRequest&& other)
+{
+  if (this != &other)
+  {
+    wait();
+    state = std::move(other.state);
+  }
+  return *this;
+}
+
+bool TensorCommRequest::test()
+{
+  if (!state)
+  {
+    return true;
+  }
+  int done = 0;
+  MPI_Status status;
+  check_mpi(MPI_Test(&state->request, &done, &status), "MPI_Test");
+  if (!done)
+  {
+    return false;
+  }
+  std::unique_ptr<State> finished = std::move(state);
+  finished->finish(status);
+  return true;
+}
+
+void TensorCommRequest::wait()
+{
+  if (!state)
+  {
+    return;
+  }
+  MPI_Status status;
+  check_mpi(MPI_Wait(&state->request, &status), "MPI_Wait");
+  std::unique_ptr<State> finished = std::move(state);
+  finished->finish(status);
+}
+
+TensorCommRequest
+isend(BaseTensor const& tensor, int peer, Comm const& comm, int tag)
+{
+  if (tensor.is_empty())
+  {
+    return TensorCommRequest();
+  }
+  H2_ASSERT_ALWAYS(tensor.const_storage_data() != nullptr,
+                   "Cannot send a tensor with no data");
+  std::size_t const elem_size = tensor.get_type_info().get_size();
+  std::size_t const bytes =
+    static_cast<std::size_t>(tensor.numel()) * elem_size;
+  ComputeStream const stream = tensor.get_stream();
+  bool const direct = is_direct(tensor);
+  auto state =
+    std::make_unique<TensorCommRequest::State>(bytes, !direct, stream);
+  H2_TRACE_SCOPE("h2::isend", Comm, stream, bytes);
+
+  void const* buf = tensor.const_storage_data();
+  if (!direct)
+  {
+    copy_strided_buffer(state->staging.data(),
+                        get_contiguous_strides(tensor.shape()),
+                        state->staging.get_stream(),
+                        tensor.const_storage_data(),
+                        tensor.strides(),
+                        stream,
+                        tensor.shape(),
+                        elem_size);
+    state->staging.get_stream().wait_for_this();
+    buf = state->staging.const_data();
+  }
+  // Data must be ready before MPI reads it.
+  stream.wait_for_this();
+  check_mpi(MPI_Isend(buf,
+                      safe_as<int>(bytes),
+                      MPI_BYTE,
+                      peer,
+                      tag,
+                      comm.GetMPIComm(),
+                      &state->request),
+            "MPI_Isend");
+  return TensorCommRequest(std::move(state));
+}
+
+TensorCommRequest
+irecv(BaseTensor& tensor, int peer, Comm const& comm, int tag)
+{
+  if (tensor.is_empty())
+  {
+    return TensorCommRequest();
+  }
+  H2_ASSERT_ALWAYS(tensor.storage_data() != nullptr,
+                   "Cannot receive into a tensor with no data");
+  H2_ASSERT_ALWAYS(!tensor.is_const_view(),
+                   "Cannot receive into a constant view");
+  std::size_t const bytes = static_cast<std::size_t>(tensor.numel())
+                            * tensor.get_type_info().get_size();
+  ComputeStream const stream = tensor.get_stream();
+  bool const direct = is_direct(tensor);
+  auto state =
+    std::make_unique<TensorCommRequest::State>(bytes, !direct, stream);
+  state->recv_tensor = &tensor;
+  H2_TRACE_SCOPE("h2::irecv", Comm, stream, bytes);
+
+  void* buf = state->staging.data();
+  if (direct)
+  {
+    // Prior work on the tensor must finish before MPI writes it.
+    stream.wait_for_this();
+    buf = tensor.storage_data();
+  }
+  check_mpi(MPI_Irecv(buf,
+                      safe_as<int>(bytes),
+                      MPI_BYTE,
+                      peer,
+                      tag,
+                      comm.GetMPIComm(),
+                      &state->request),
+            "MPI_Irecv");
+  return TensorCommRequest(std::move(state));
+}
+
+}  // namespace h2
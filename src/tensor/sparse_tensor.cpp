@@ -0,0 +1,479 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/sparse_tensor.hpp"
+
+#include "h2/core/profiling.hpp"
+#include "h2/loops/cpu_loops.hpp"
+#include "h2/tensor/copy_buffer.hpp"
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/init/fill.hpp"
+#include "h2/utils/As.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string>
+
+#include <mpi.h>
+
+namespace h2
+{
+
+namespace
+{
+
+void check_mpi(int ret, char const* what)
+{
+  if (ret != MPI_SUCCESS)
+  {
+    char msg[MPI_MAX_ERROR_STRING];
+    int len = 0;
+    MPI_Error_string(ret, msg, &len);
+    throw H2Exception(
+      what, " failed while distributing nonzeros: ", std::string(msg, len));
+  }
+}
+
+/** Copy `count` elements from `src` on `stream` to the host. */
+template <typename T>
+std::vector<T> copy_to_host(T const* src, ComputeStream const& stream,
+                            DataIndexType count)
+{
+  std::vector<T> host(static_cast<std::size_t>(count));
+  if (count > 0)
+  {
+    copy_buffer(host.data(),
+                ComputeStream{Device::CPU},
+                src,
+                stream,
+                static_cast<std::size_t>(count));
+    stream.wait_for_this();
+  }
+  return host;
+}
+
+template <typename T>
+void check_same_device(SparseTensor<T> const& sparse,
+                       BaseTensor const& dense,
+                       char const* what)
+{
+  H2_ASSERT_ALWAYS(sparse.get_device() == dense.get_device(),
+                   "Cannot ",
+                   what,
+                   " with a sparse tensor on ",
+                   sparse.get_device(),
+                   " and a dense tensor on ",
+                   dense.get_device());
+}
+
+template <typename T>
+void check_same_shape(SparseTensor<T> const& sparse,
+                      BaseTensor const& dense,
+                      char const* what)
+{
+  H2_ASSERT_ALWAYS(sparse.shape() == dense.shape(),
+                   "Cannot ",
+                   what,
+                   " with a sparse tensor of shape ",
+                   sparse.shape(),
+                   " and a dense tensor of shape ",
+                   dense.shape());
+  H2_ASSERT_ALWAYS(dense.is_contiguous(),
+                   "Cannot ",
+                   what,
+                   " with a non-contiguous dense tensor");
+}
+
+}  // anonymous namespace
+
+template <typename T>
+void SparseTensor<T>::set_nonzeros(std::vector<DataIndexType> const& indices_,
+                                   std::vector<T> const& values_)
+{
+  H2_ASSERT_ALWAYS(indices_.size() == values_.size(),
+                   "Got ",
+                   indices_.size(),
+                   " indices but ",
+                   values_.size(),
+                   " values");
+  DataIndexType const nnz_ = static_cast<DataIndexType>(indices_.size());
+  DataIndexType const size = numel();
+  std::vector<std::size_t> order(indices_.size());
+  std::iota(order.begin(), order.end(), std::size_t{0});
+  std::sort(order.begin(), order.end(), [&](std::size_t i, std::size_t j) {
+    return indices_[i] < indices_[j];
+  });
+  std::vector<DataIndexType> sorted_indices(indices_.size());
+  std::vector<T> sorted_values(values_.size());
+  for (std::size_t i = 0; i < order.size(); ++i)
+  {
+    sorted_indices[i] = indices_[order[i]];
+    sorted_values[i] = values_[order[i]];
+    H2_ASSERT_ALWAYS(sorted_indices[i] >= 0 && sorted_indices[i] < size,
+                     "Nonzero index ",
+                     sorted_indices[i],
+                     " is out of range for shape ",
+                     tensor_shape);
+    H2_ASSERT_ALWAYS(i == 0 || sorted_indices[i] != sorted_indices[i - 1],
+                     "Duplicate nonzero index ",
+                     sorted_indices[i]);
+  }
+
+  nz_indices = make_nnz_tensor<DataIndexType>(nnz_);
+  nz_values = make_nnz_tensor<T>(nnz_);
+  if (nnz_ == 0)
+  {
+    return;
+  }
+  ComputeStream const cpu_stream{Device::CPU};
+  copy_buffer(nz_indices->data(),
+              tensor_stream,
+              sorted_indices.data(),
+              cpu_stream,
+              sorted_indices.size());
+  copy_buffer(nz_values->data(),
+              tensor_stream,
+              sorted_values.data(),
+              cpu_stream,
+              sorted_values.size());
+  // The host arrays go out of scope.
+  tensor_stream.wait_for_this();
+}
+
+template <typename T>
+void SparseTensor<T>::get_nonzeros(std::vector<DataIndexType>& indices_,
+                                   std::vector<T>& values_) const
+{
+  indices_ = copy_to_host(nz_indices->const_data(), tensor_stream, nnz());
+  values_ = copy_to_host(nz_values->const_data(), tensor_stream, nnz());
+}
+
+template <typename T>
+std::vector<DataIndexType> SparseTensor<T>::get_compressed_offsets() const
+{
+  if (tensor_shape.is_empty())
+  {
+    return {0};
+  }
+  DataIndexType const num_rows = tensor_shape.back();
+  DataIndexType const row_size = num_rows == 0 ? 0 : numel() / num_rows;
+  std::vector<DataIndexType> const host_indices =
+    copy_to_host(nz_indices->const_data(), tensor_stream, nnz());
+  std::vector<DataIndexType> offsets(static_cast<std::size_t>(num_rows + 1));
+  for (DataIndexType row = 0; row <= num_rows; ++row)
+  {
+    offsets[row] = std::lower_bound(host_indices.begin(),
+                                    host_indices.end(),
+                                    row * row_size)
+                   - host_indices.begin();
+  }
+  return offsets;
+}
+
+template <typename T>
+void to_dense(Tensor<T>& dst, SparseTensor<T> const& src)
+{
+  H2_PROFILE_RANGE("h2::to_dense", Compute);
+  check_same_device(src, dst, "convert to dense");
+  if (dst.is_view())
+  {
+    H2_ASSERT_ALWAYS(!dst.is_const_view(), "Cannot write into a const view");
+  }
+  else
+  {
+    dst.resize(src.shape(), src.dim_types());
+    dst.ensure();
+  }
+  if (src.numel() == 0)
+  {
+    return;
+  }
+  check_same_shape(src, dst, "convert to dense");
+  zero(dst);
+  if (src.nnz() == 0)
+  {
+    return;
+  }
+  H2_DEVICE_DISPATCH_SAME(src.get_device(),
+                          impl::to_dense_impl(DeviceT_v<Dev>, dst, src));
+}
+
+template <typename T>
+std::unique_ptr<SparseTensor<T>> to_sparse(Tensor<T> const& src)
+{
+  H2_PROFILE_RANGE("h2::to_sparse", Compute);
+  auto dst = std::make_unique<SparseTensor<T>>(
+    src.get_device(), src.shape(), src.dim_types(), src.get_stream());
+  if (src.is_empty())
+  {
+    return dst;
+  }
+  H2_ASSERT_ALWAYS(src.is_contiguous(),
+                   "Cannot convert a non-contiguous tensor to sparse");
+  std::vector<T> const dense =
+    copy_to_host(src.const_data(), src.get_stream(), src.numel());
+  std::vector<DataIndexType> indices;
+  std::vector<T> values;
+  for (std::size_t i = 0; i < dense.size(); ++i)
+  {
+    if (dense[i] != T{0})
+    {
+      indices.push_back(static_cast<DataIndexType>(i));
+      values.push_back(dense[i]);
+    }
+  }
+  dst->set_nonzeros(indices, values);
+  return dst;
+}
+
+template <typename T>
+void sparse_dense_multiply(SparseTensor<T>& dst,
+                           SparseTensor<T> const& sparse,
+                           Tensor<T> const& dense)
+{
+  H2_PROFILE_RANGE("h2::sparse_dense_multiply", Compute);
+  check_same_device(sparse, dense, "multiply");
+  check_same_shape(sparse, dense, "multiply");
+  H2_ASSERT_ALWAYS(dst.get_device() == sparse.get_device(),
+                   "Cannot multiply into a sparse tensor on ",
+                   dst.get_device(),
+                   " from one on ",
+                   sparse.get_device());
+  if (&dst != &sparse)
+  {
+    std::vector<DataIndexType> indices;
+    std::vector<T> values;
+    sparse.get_nonzeros(indices, values);
+    dst = SparseTensor<T>(dst.get_device(),
+                          sparse.shape(),
+                          sparse.dim_types(),
+                          indices,
+                          values,
+                          dst.get_stream());
+  }
+  if (sparse.nnz() == 0)
+  {
+    return;
+  }
+  H2_DEVICE_DISPATCH_SAME(sparse.get_device(),
+                          impl::sparse_dense_multiply_impl(
+                            DeviceT_v<Dev>, dst.values(), sparse, dense));
+}
+
+template <typename T>
+void sparse_dense_add(Tensor<T>& dense, SparseTensor<T> const& sparse)
+{
+  H2_PROFILE_RANGE("h2::sparse_dense_add", Compute);
+  check_same_device(sparse, dense, "add");
+  check_same_shape(sparse, dense, "add");
+  H2_ASSERT_ALWAYS(!dense.is_const_view(), "Cannot write into a const view");
+  if (sparse.nnz() == 0)
+  {
+    return;
+  }
+  H2_DEVICE_DISPATCH_SAME(
+    sparse.get_device(),
+    impl::sparse_dense_add_impl(DeviceT_v<Dev>, dense, sparse));
+}
+
+template <typename T>
+std::unique_ptr<SparseTensor<T>>
+distribute_sparse(SparseTensor<T> const& src,
+                  ProcessorGrid const& grid,
+                  DistributionTypeTuple const& dist)
+{
+  H2_PROFILE_RANGE("h2::distribute_sparse", Comm);
+  ShapeTuple const& global_shape = src.shape();
+  H2_ASSERT_ALWAYS(dist.size() == global_shape.size(),
+                   "Distribution ",
+                   dist,
+                   " does not match shape ",
+                   global_shape);
+  H2_ASSERT_ALWAYS(grid.ndim() == global_shape.size(),
+                   "Processor grid of ",
+                   grid.ndim(),
+                   " dimensions does not match shape ",
+                   global_shape);
+  for (auto const d : dist)
+  {
+    H2_ASSERT_ALWAYS(d != Distribution::Replicated,
+                     "Cannot distribute nonzeros with replicated dimensions");
+  }
+  RankType const num_ranks = grid.size();
+  ShapeTuple const local_shape =
+    internal::get_local_shape(global_shape, grid, dist);
+
+  // Bucket the nonzeros by owner, converting their indices to the
+  // owner's local indices.
+  std::vector<DataIndexType> indices;
+  std::vector<T> values;
+  src.get_nonzeros(indices, values);
+  std::vector<RankType> owners(indices.size());
+  std::vector<int> send_counts(num_ranks, 0);
+  for (std::size_t i = 0; i < indices.size(); ++i)
+  {
+    owners[i] = internal::global2rank(
+      global_shape, grid, dist, src.get_coord(indices[i]));
+    ++send_counts[owners[i]];
+  }
+  std::vector<int> send_displs(num_ranks, 0);
+  std::partial_sum(
+    send_counts.begin(), send_counts.end() - 1, send_displs.begin() + 1);
+  std::vector<DataIndexType> send_indices(indices.size());
+  std::vector<T> send_values(values.size());
+  std::vector<int> pos(send_displs);
+  for (std::size_t i = 0; i < indices.size(); ++i)
+  {
+    RankType const owner = owners[i];
+    ShapeTuple const owner_shape =
+      internal::get_local_shape(global_shape, grid, dist, owner);
+    ScalarIndexTuple const local_coord = internal::global2local_index(
+      global_shape, grid, dist, src.get_coord(indices[i]));
+    DataIndexType local_index = 0;
+    for (typename ShapeTuple::size_type d = local_coord.size(); d > 0; --d)
+    {
+      local_index = local_index * owner_shape[d - 1] + local_coord[d - 1];
+    }
+    send_indices[pos[owner]] = local_index;
+    send_values[pos[owner]] = values[i];
+    ++pos[owner];
+  }
+
+  MPI_Comm const comm = grid.comm().GetMPIComm();
+  std::vector<int> recv_counts(num_ranks, 0);
+  check_mpi(MPI_Alltoall(send_counts.data(),
+                         1,
+                         MPI_INT,
+                         recv_counts.data(),
+                         1,
+                         MPI_INT,
+                         comm),
+            "MPI_Alltoall");
+  std::vector<int> recv_displs(num_ranks, 0);
+  std::partial_sum(
+    recv_counts.begin(), recv_counts.end() - 1, recv_displs.begin() + 1);
+  std::size_t const num_recv =
+    static_cast<std::size_t>(recv_displs.back() + recv_counts.back());
+  std::vector<DataIndexType> recv_indices(num_recv);
+  std::vector<T> recv_values(num_recv);
+  check_mpi(MPI_Alltoallv(send_indices.data(),
+                          send_counts.data(),
+                          send_displs.data(),
+                          MPI_INT64_T,
+                          recv_indices.data(),
+                          recv_counts.data(),
+                          recv_displs.data(),
+                          MPI_INT64_T,
+                          comm),
+            "MPI_Alltoallv");
+  // Values are sent as bytes, so scale the counts.
+  auto const to_bytes = [](std::vector<int> v) {
+    for (auto& x : v)
+    {
+      x = safe_as<int>(static_cast<std::size_t>(x) * sizeof(T));
+    }
+    return v;
+  };
+  check_mpi(MPI_Alltoallv(send_values.data(),
+                          to_bytes(send_counts).data(),
+                          to_bytes(send_displs).data(),
+                          MPI_BYTE,
+                          recv_values.data(),
+                          to_bytes(recv_counts).data(),
+                          to_bytes(recv_displs).data(),
+                          MPI_BYTE,
+                          comm),
+            "MPI_Alltoallv");
+
+  // Ranks without any local data get an empty tensor.
+  return std::make_unique<SparseTensor<T>>(src.get_device(),
+                                           local_shape,
+                                           local_shape.is_empty()
+                                             ? DimensionTypeTuple{}
+                                             : src.dim_types(),
+                                           recv_indices,
+                                           recv_values,
+                                           src.get_stream());
+}
+
+namespace impl
+{
+
+template <typename T>
+void to_dense_impl(CPUDev_t, Tensor<T>& dst, SparseTensor<T> const& src)
+{
+  T* __restrict__ dense = dst.data();
+  h2::cpu::parallel_elementwise_loop(
+    [dense](DataIndexType const index, T const val) { dense[index] = val; },
+    static_cast<std::size_t>(src.nnz()),
+    src.indices().const_data(),
+    src.values().const_data());
+}
+
+template <typename T>
+void sparse_dense_multiply_impl(CPUDev_t,
+                                Tensor<T>& dst_values,
+                                SparseTensor<T> const& sparse,
+                                Tensor<T> const& dense)
+{
+  T const* __restrict__ dense_buf = dense.const_data();
+  h2::cpu::parallel_elementwise_loop(
+    [dense_buf](T const val, DataIndexType const index) -> T {
+      return val * dense_buf[index];
+    },
+    static_cast<std::size_t>(sparse.nnz()),
+    dst_values.data(),
+    sparse.values().const_data(),
+    sparse.indices().const_data());
+}
+
+template <typename T>
+void sparse_dense_add_impl(CPUDev_t,
+                           Tensor<T>& dense,
+                           SparseTensor<T> const& sparse)
+{
+  // Indices are unique, so no two nonzeros update the same entry.
+  T* __restrict__ dense_buf = dense.data();
+  h2::cpu::parallel_elementwise_loop(
+    [dense_buf](DataIndexType const index, T const val) {
+      dense_buf[index] += val;
+    },
+    static_cast<std::size_t>(sparse.nnz()),
+    sparse.indices().const_data(),
+    sparse.values().const_data());
+}
+
+}  // namespace impl
+
+#define PROTO(T)                                                               \
+  template class SparseTensor<T>;                                              \
+  template void to_dense<T>(Tensor<T>&, SparseTensor<T> const&);               \
+  template std::unique_ptr<SparseTensor<T>> to_sparse<T>(Tensor<T> const&);    \
+  template void sparse_dense_multiply<T>(                                      \
+    SparseTensor<T>&, SparseTensor<T> const&, Tensor<T> const&);               \
+  template void sparse_dense_add<T>(Tensor<T>&, SparseTensor<T> const&);       \
+  template std::unique_ptr<SparseTensor<T>> distribute_sparse<T>(              \
+    SparseTensor<T> const&,                                                    \
+    ProcessorGrid const&,                                                      \
+    DistributionTypeTuple const&);                                             \
+  template void impl::to_dense_impl<T>(                                        \
+    CPUDev_t, Tensor<T>&, SparseTensor<T> const&);                             \
+  template void impl::sparse_dense_multiply_impl<T>(                           \
+    CPUDev_t, Tensor<T>&, SparseTensor<T> const&, Tensor<T> const&);           \
+  template void impl::sparse_dense_add_impl<T>(                                \
+    CPUDev_t, Tensor<T>&, SparseTensor<T> const&)
+PROTO(float);
+PROTO(double);
+PROTO(std::int32_t);
+PROTO(std::uint32_t);
+#undef PROTO
+
+}  // namespace h2
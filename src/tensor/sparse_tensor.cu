@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/profiling.hpp"
+#include "h2/loops/gpu_loops.cuh"
+#include "h2/tensor/sparse_tensor.hpp"
+
+#include <cstdint>
+
+namespace h2
+{
+
+namespace impl
+{
+
+template <typename T>
+void to_dense_impl(GPUDev_t, Tensor<T>& dst, SparseTensor<T> const& src)
+{
+  T* __restrict__ dense = dst.data();
+  auto stream = create_multi_sync(dst.get_stream(), src.get_stream());
+  h2::gpu::launch_elementwise_loop(
+    [dense] H2_GPU_LAMBDA(DataIndexType const index, T const val) {
+      dense[index] = val;
+    },
+    stream,
+    static_cast<std::size_t>(src.nnz()),
+    src.indices().const_data(),
+    src.values().const_data());
+}
+
+template <typename T>
+void sparse_dense_multiply_impl(GPUDev_t,
+                                Tensor<T>& dst_values,
+                                SparseTensor<T> const& sparse,
+                                Tensor<T> const& dense)
+{
+  T const* __restrict__ dense_buf = dense.const_data();
+  auto stream = create_multi_sync(
+    dst_values.get_stream(), sparse.get_stream(), dense.get_stream());
+  h2::gpu::launch_elementwise_loop(
+    [dense_buf] H2_GPU_LAMBDA(T const val, DataIndexType const index) -> T {
+      return val * dense_buf[index];
+    },
+    stream,
+    static_cast<std::size_t>(sparse.nnz()),
+    dst_values.data(),
+    sparse.values().const_data(),
+    sparse.indices().const_data());
+}
+
+template <typename T>
+void sparse_dense_add_impl(GPUDev_t,
+                           Tensor<T>& dense,
+                           SparseTensor<T> const& sparse)
+{
+  // Indices are unique, so no atomics are needed.
+  T* __restrict__ dense_buf = dense.data();
+  auto stream = create_multi_sync(dense.get_stream(), sparse.get_stream());
+  h2::gpu::launch_elementwise_loop(
+    [dense_buf] H2_GPU_LAMBDA(DataIndexType const index, T const val) {
+      dense_buf[index] += val;
+    },
+    stream,
+    static_cast<std::size_t>(sparse.nnz()),
+    sparse.indices().const_data(),
+    sparse.values().const_data());
+}
+
+#define PROTO(T)                                                               \
+  template void to_dense_impl<T>(                                              \
+    GPUDev_t, Tensor<T>&, SparseTensor<T> const&);                             \
+  template void sparse_dense_multiply_impl<T>(                                 \
+    GPUDev_t, Tensor<T>&, SparseTensor<T> const&, Tensor<T> const&);           \
+  template void sparse_dense_add_impl<T>(                                      \
+    GPUDev_t, Tensor<T>&, SparseTensor<T> const&)
+PROTO(float);
+PROTO(double);
+PROTO(std::int32_t);
+PROTO(std::uint32_t);
+#undef PROTO
+
+}  // namespace impl
+
+}  // namespace h2
@@ -0,0 +1,46 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/stats.hpp"
+
+#include "h2/core/profiling.hpp"
+#include "h2/loops/cpu_reductions.hpp"
+
+#include <cstdint>
+
+namespace h2
+{
+
+namespace impl
+{
+
+template <typename T>
+internal::StatsValue<T> stats_impl(CPUDev_t, Tensor<T> const& tensor)
+{
+  H2_PROFILE_RANGE("h2::get_stats", Compute);
+  internal::StatsValue<T> val;
+  h2::cpu::strided_reduction_loop(
+    internal::StatsReduction<T>{},
+    tensor.shape(),
+    tensor.strides(),
+    StrideTuple(TuplePad<StrideTuple>(tensor.ndim(), 0)),
+    &val,
+    tensor.const_data());
+  return val;
+}
+
+#define PROTO(T)                                                               \
+  template internal::StatsValue<T> stats_impl<T>(CPUDev_t, Tensor<T> const&)
+PROTO(float);
+PROTO(double);
+PROTO(std::int32_t);
+PROTO(std::uint32_t);
+#undef PROTO
+
+}  // namespace impl
+
+}  // namespace h2
@@ -0,0 +1,55 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/profiling.hpp"
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/loops/gpu_reductions.cuh"
+#include "h2/tensor/stats.hpp"
+
+#include <cstdint>
+
+namespace h2
+{
+
+namespace impl
+{
+
+template <typename T>
+internal::StatsValue<T> stats_impl(GPUDev_t, Tensor<T> const& tensor)
+{
+  using ValueT = internal::StatsValue<T>;
+  H2_PROFILE_RANGE("h2::get_stats", Compute);
+  ComputeStream const& stream = tensor.get_stream();
+  ValueT* dev_val =
+    ::h2::internal::Allocator<ValueT, Device::GPU>::allocate(1, stream);
+  h2::gpu::launch_strided_reduction_loop(
+    internal::StatsReduction<T>{},
+    stream,
+    tensor.shape(),
+    tensor.strides(),
+    StrideTuple(TuplePad<StrideTuple>(tensor.ndim(), 0)),
+    dev_val,
+    tensor.const_data());
+  ValueT val;
+  gpu::mem_copy(&val, dev_val, 1, stream.get_stream<Device::GPU>());
+  stream.wait_for_this();
+  ::h2::internal::Allocator<ValueT, Device::GPU>::deallocate(dev_val, stream);
+  return val;
+}
+
+#define PROTO(T)                                                               \
+  template internal::StatsValue<T> stats_impl<T>(GPUDev_t, Tensor<T> const&)
+PROTO(float);
+PROTO(double);
+PROTO(std::int32_t);
+PROTO(std::uint32_t);
+#undef PROTO
+
+}  // namespace impl
+
+}  // namespace h2
@@ -0,0 +1,274 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/tensor/straggler_monitor.hpp"
+
+#include "h2/core/sync.hpp"
+#include "h2/core/tracer.hpp"
+#include "h2/utils/Error.hpp"
+#include "h2/utils/Logger.hpp"
+#include "h2/utils/environment_vars.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+namespace h2
+{
+
+namespace
+{
+
+/** Arrivals of this rank on one communicator in the current window. */
+struct CommArrivals
+{
+  std::vector<double> times;
+  std::vector<char const*> names;
+  /** Consecutive windows each rank of the communicator was late in. */
+  std::vector<std::size_t> num_late_windows;
+  /** Lateness of each rank in the last complete window. */
+  std::vector<StragglerStats> last_stats;
+};
+
+std::mutex& get_monitor_mutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::map<MPI_Comm, CommArrivals>& get_comm_arrivals()
+{
+  static std::map<MPI_Comm, CommArrivals> arrivals;
+  return arrivals;
+}
+
+h2::Logger& get_straggler_logger()
+{
+  static h2::Logger logger("h2_straggler");
+  return logger;
+}
+
+double now()
+{
+  return std::chrono::duration<double>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+void check_mpi(int ret, char const* what)
+{
+  H2_ASSERT_ALWAYS(
+    ret == MPI_SUCCESS, what, " failed while checking for stragglers");
+}
+
+/**
+ * Gather the arrivals of a full window on `comm`, update how many
+ * consecutive windows each rank was late in, and log late ranks.
+ */
+void check_window(MPI_Comm comm, CommArrivals& arrivals)
+{
+  std::size_t const num_points = arrivals.times.size();
+  int rank = 0;
+  int size = 0;
+  int world_rank = 0;
+  check_mpi(MPI_Comm_rank(comm, &rank), "MPI_Comm_rank");
+  check_mpi(MPI_Comm_size(comm, &size), "MPI_Comm_size");
+  check_mpi(MPI_Comm_rank(MPI_COMM_WORLD, &world_rank), "MPI_Comm_rank");
+  std::size_t const num_ranks = static_cast<std::size_t>(size);
+  ComputeStream const cpu_stream{Device::CPU};
+  H2_TRACE_SCOPE("h2::straggler_monitor",
+                 Comm,
+                 cpu_stream,
+                 num_ranks * (num_points + 1) * sizeof(double));
+
+  // Everyone leaves the barrier at about the same time, so times
+  // relative to then are comparable across ranks. Each rank sends its
+  // world rank followed by its arrivals.
+  check_mpi(MPI_Barrier(comm), "MPI_Barrier");
+  double const base = now();
+  std::vector<double> local(num_points + 1);
+  local[0] = world_rank;
+  for (std::size_t i = 0; i < num_points; ++i)
+  {
+    local[i + 1] = arrivals.times[i] - base;
+  }
+  std::vector<double> gathered(num_ranks * (num_points + 1));
+  check_mpi(MPI_Allgather(local.data(),
+                          static_cast<int>(num_points + 1),
+                          MPI_DOUBLE,
+                          gathered.data(),
+                          static_cast<int>(num_points + 1),
+                          MPI_DOUBLE,
+                          comm),
+            "MPI_Allgather");
+
+  std::vector<double> times(num_ranks * num_points);
+  for (std::size_t r = 0; r < num_ranks; ++r)
+  {
+    std::copy_n(gathered.begin() + r * (num_points + 1) + 1,
+                num_points,
+                times.begin() + r * num_points);
+  }
+  arrivals.last_stats = compute_straggler_stats(times, num_ranks, num_points);
+  auto const& stats = arrivals.last_stats;
+
+  double const threshold = env::get<double>("STRAGGLER_THRESHOLD") * 1e-3;
+  std::size_t const min_windows =
+    std::max(env::get<std::size_t>("STRAGGLER_MIN_WINDOWS"), std::size_t{1});
+  arrivals.num_late_windows.resize(num_ranks, 0);
+  std::ostringstream summary;
+  std::size_t num_stragglers = 0;
+  for (std::size_t r = 0; r < num_ranks; ++r)
+  {
+    std::size_t& num_late = arrivals.num_late_windows[r];
+    num_late = (stats[r].mean_lateness > threshold) ? num_late + 1 : 0;
+    if (num_late < min_windows)
+    {
+      continue;
+    }
+    summary << (num_stragglers == 0 ? "" : ", ") << "rank "
+            << static_cast<int>(gathered[r * (num_points + 1)]) << " ("
+            << stats[r].mean_lateness * 1e3 << " ms)";
+    ++num_stragglers;
+    if (r == static_cast<std::size_t>(rank))
+    {
+      std::ostringstream ss;
+      ss << "Late to synchronize with " << size - 1 << " other ranks for "
+         << num_late << " windows: " << stats[r].mean_lateness * 1e3
+         << " ms after the median rank on average over the last "
+         << num_points << " points, last to arrive at " << stats[r].num_last
+         << ", and " << stats[r].worst_lateness * 1e3 << " ms late at "
+         << arrivals.names[stats[r].worst_point];
+      get_straggler_logger().get().warn(ss.str());
+    }
+  }
+  if (rank == 0 && num_stragglers > 0)
+  {
+    get_straggler_logger().get().warn(
+      std::to_string(num_stragglers) + " of " + std::to_string(size)
+      + " ranks are consistently late to synchronize (mean lateness): "
+      + summary.str());
+  }
+}
+
+}  // anonymous namespace
+
+std::vector<StragglerStats>
+compute_straggler_stats(std::vector<double> const& arrivals,
+                        std::size_t num_ranks,
+                        std::size_t num_points)
+{
+  H2_ASSERT_ALWAYS(arrivals.size() == num_ranks * num_points,
+                   "Expected ",
+                   num_ranks * num_points,
+                   " arrival times, got ",
+                   arrivals.size());
+  std::vector<StragglerStats> stats(num_ranks);
+  if (num_ranks == 0 || num_points == 0)
+  {
+    return stats;
+  }
+  std::vector<double> point(num_ranks);
+  double prev_last_arrival = 0.0;
+  for (std::size_t i = 0; i < num_points; ++i)
+  {
+    for (std::size_t r = 0; r < num_ranks; ++r)
+    {
+      point[r] = arrivals[r * num_points + i];
+      if (i > 0)
+      {
+        stats[r].mean_work += point[r] - prev_last_arrival;
+      }
+    }
+    auto const last = std::max_element(point.begin(), point.end());
+    ++stats[last - point.begin()].num_last;
+    prev_last_arrival = *last;
+    // Take the lower middle rank as the median of an even number of
+    // ranks, so the later of two ranks is late.
+    std::size_t const mid = (num_ranks - 1) / 2;
+    std::nth_element(point.begin(), point.begin() + mid, point.end());
+    double const median = point[mid];
+    for (std::size_t r = 0; r < num_ranks; ++r)
+    {
+      double const lateness = arrivals[r * num_points + i] - median;
+      stats[r].mean_lateness += lateness;
+      if (i == 0 || lateness > stats[r].worst_lateness)
+      {
+        stats[r].worst_point = i;
+        stats[r].worst_lateness = lateness;
+      }
+    }
+  }
+  for (auto& s : stats)
+  {
+    s.mean_lateness /= num_points;
+    if (num_points > 1)
+    {
+      s.mean_work /= num_points - 1;
+    }
+  }
+  return stats;
+}
+
+std::vector<StragglerStats> get_straggler_stats(MPI_Comm comm)
+{
+  std::lock_guard<std::mutex> lock(get_monitor_mutex());
+  auto const& comm_arrivals = get_comm_arrivals();
+  auto const i = comm_arrivals.find(comm);
+  return (i == comm_arrivals.end()) ? std::vector<StragglerStats>{}
+                                    : i->second.last_stats;
+}
+
+namespace internal
+{
+
+bool check_straggler_monitor_enabled()
+{
+  bool const enabled = env::get<bool>("STRAGGLER_MONITOR");
+  if (enabled)
+  {
+    get_straggler_logger();
+    H2_ASSERT_ALWAYS(env::get<std::size_t>("STRAGGLER_WINDOW") > 0,
+                     "H2_STRAGGLER_WINDOW must be positive");
+  }
+  return enabled;
+}
+
+void record_sync_arrival(char const* name, MPI_Comm comm)
+{
+  double const time = now();
+  static std::size_t const window = env::get<std::size_t>("STRAGGLER_WINDOW");
+  CommArrivals full;
+  {
+    std::lock_guard<std::mutex> lock(get_monitor_mutex());
+    CommArrivals& arrivals = get_comm_arrivals()[comm];
+    arrivals.times.push_back(time);
+    arrivals.names.push_back(name);
+    if (arrivals.times.size() < window)
+    {
+      return;
+    }
+    full = std::move(arrivals);
+    arrivals = CommArrivals{};
+  }
+  // Check without the lock, so other threads synchronizing on other
+  // communicators are not blocked by this rank's collectives.
+  check_window(comm, full);
+  std::lock_guard<std::mutex> lock(get_monitor_mutex());
+  CommArrivals& arrivals = get_comm_arrivals()[comm];
+  arrivals.num_late_windows = std::move(full.num_late_windows);
+  arrivals.last_stats = std::move(full.last_stats);
+}
+
+}  // namespace internal
+
+}  // namespace h2
@@ -0,0 +1,28 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/tensor.hpp"
+
+#include <cstdint>
+
+// Instantiations declared extern in the headers, so translation units
+// using tensors of these types do not each compile them.
+
+namespace h2
+{
+
+template class StridedMemory<float>;
+template class StridedMemory<double>;
+template class StridedMemory<std::int32_t>;
+template class StridedMemory<std::uint32_t>;
+
+template class Tensor<float>;
+template class Tensor<double>;
+template class Tensor<std::int32_t>;
+template class Tensor<std::uint32_t>;
+
+}  // namespace h2
@@ -9,13 +9,19 @@
 
 #include "h2_config.hpp"
 
+#include "h2/utils/environment_vars.hpp"
+
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
+#include <mutex>
 #include <sstream>
 #include <unordered_map>
 
 #include "logger_internals.hpp"
 #include "spdlog/sinks/basic_file_sink.h"
+#include <spdlog/async.h>
 #include <spdlog/pattern_formatter.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 
@@ -58,11 +64,17 @@ public:
   }
 
   static std::string get_rank_str()
+  {
+    int const rank = get_rank();
+    return (rank >= 0 ? std::to_string(rank) : std::string("?"));
+  }
+
+  static int get_rank()
   {
     int rank = get_rank_mpi();
     if (rank < 0)
       rank = get_rank_env();
-    return (rank >= 0 ? std::to_string(rank) : std::string("?"));
+    return rank;
   }
 
   static int get_rank_mpi()
@@ -198,7 +210,7 @@ using MaskMapType = std::unordered_map<std::string, unsigned char>;
 
   auto& sink = sink_map_[sinkname];
   if (!sink)
-    sink = make_file_sink(sinkname);
+    sink = h2::make_rate_limited_sink(make_file_sink(sinkname));
   return sink;
 }
 
@@ -219,11 +231,9 @@ h2_internal::make_logger(std::string name,
                          std::string const& sink_name,
                          std::string const& pattern_prefix)
 {
-  auto logger = std::make_shared<::spdlog::logger>(std::move(name),
-                                                   get_file_sink(sink_name));
+  auto logger =
+    h2::make_spdlog_logger(std::move(name), get_file_sink(sink_name));
   logger->set_formatter(make_h2_formatter(pattern_prefix));
-  ::spdlog::register_logger(logger);
-  logger->set_level(::spdlog::level::trace);
   return logger;
 }
 
@@ -373,6 +383,116 @@ LevelMapType h2_internal::get_keys_and_levels(std::string const& str)
   return kl;
 }
 
+bool h2_internal::is_rank_selected(std::string const& ranks, int rank)
+{
+  if (ranks.empty() || ranks == "all" || rank < 0)
+    return true;
+  if (ranks == "none")
+    return false;
+
+  std::string token;
+  std::istringstream token_stream(ranks);
+  while (std::getline(token_stream, token, ','))
+  {
+    trim(token);
+    if (token.empty())
+      continue;
+    try
+    {
+      std::size_t pos = 0;
+      long const first = std::stol(token, &pos);
+      long last = first;
+      long stride = 1;
+      if (pos < token.size() && token[pos] == '-')
+      {
+        ++pos;
+        if (pos == token.size() || token[pos] == ':')
+          last = std::numeric_limits<long>::max();
+        else
+        {
+          std::size_t len = 0;
+          last = std::stol(token.substr(pos), &len);
+          pos += len;
+        }
+        if (pos < token.size() && token[pos] == ':')
+        {
+          std::size_t len = 0;
+          stride = std::stol(token.substr(pos + 1), &len);
+          pos += len + 1;
+        }
+      }
+      if (pos != token.size() || first < 0 || last < first || stride <= 0)
+        throw std::invalid_argument(token);
+      if (rank >= first && rank <= last && (rank - first) % stride == 0)
+        return true;
+    }
+    catch (std::logic_error const&)
+    {
+      throw std::runtime_error("Invalid log ranks: " + ranks);
+    }
+  }
+  return false;
+}
+
+h2_internal::RateLimitedSink::RateLimitedSink(::spdlog::sink_ptr sink,
+                                              std::size_t max_per_second)
+  : m_sink{std::move(sink)}, m_max_per_second{max_per_second}
+{}
+
+void h2_internal::RateLimitedSink::sink_it_(
+  ::spdlog::details::log_msg const& msg)
+{
+  if (msg.time - m_window_start >= std::chrono::seconds(1))
+  {
+    report_dropped(msg.time);
+    m_window_start = msg.time;
+    m_window_count = 0;
+  }
+  if (m_window_count < m_max_per_second)
+  {
+    ++m_window_count;
+    if (m_sink->should_log(msg.level))
+      m_sink->log(msg);
+  }
+  else
+  {
+    ++m_window_dropped;
+    m_num_dropped.fetch_add(1, std::memory_order_relaxed);
+    m_logger_name.assign(msg.logger_name.data(), msg.logger_name.size());
+  }
+}
+
+void h2_internal::RateLimitedSink::flush_()
+{
+  report_dropped(::spdlog::log_clock::now());
+  m_sink->flush();
+}
+
+void h2_internal::RateLimitedSink::set_pattern_(std::string const& pattern)
+{
+  m_sink->set_pattern(pattern);
+}
+
+void h2_internal::RateLimitedSink::set_formatter_(
+  std::unique_ptr<::spdlog::formatter> formatter)
+{
+  m_sink->set_formatter(std::move(formatter));
+}
+
+void h2_internal::RateLimitedSink::report_dropped(
+  ::spdlog::log_clock::time_point time)
+{
+  if (m_window_dropped == 0)
+    return;
+  std::string const text = "Dropped " + std::to_string(m_window_dropped)
+                           + " messages over the limit of "
+                           + std::to_string(m_max_per_second) + " per second";
+  ::spdlog::details::log_msg const msg(
+    time, ::spdlog::source_loc{}, m_logger_name, ::spdlog::level::warn, text);
+  m_sink->log(msg);
+  m_window_dropped = 0;
+}
+
 namespace h2
 {
 
@@ -403,7 +523,7 @@ void Logger::set_log_level(LogLevelType level)
 
 void Logger::set_mask(unsigned char mask)
 {
-  m_mask = mask;
+  m_mask = is_logging_rank() ? mask : 0;
 }
 
 bool Logger::should_log(LogLevelType level) const noexcept
@@ -483,4 +603,82 @@ spdlog::level::level_enum to_spdlog_level(Logger::LogLevelType level)
   default: return spdlog::level::off;
   }
 }
+
+std::string expand_rank_pattern(std::string const& pattern)
+{
+  std::string expanded;
+  for (std::size_t i = 0; i < pattern.size(); ++i)
+  {
+    if (pattern[i] != '%' || i + 1 == pattern.size())
+    {
+      expanded += pattern[i];
+      continue;
+    }
+    switch (pattern[++i])
+    {
+    case 'h': expanded += HostnameFlag::get_hostname(); break;
+    case 'w': expanded += MPIRankFlag::get_rank_str(); break;
+    case 'W': expanded += MPISizeFlag::get_size_str(); break;
+    case '%': expanded += '%'; break;
+    default:
+      expanded += '%';
+      expanded += pattern[i];
+      break;
+    }
+  }
+  return expanded;
+}
+
+bool is_logging_rank()
+{
+  static bool const selected = h2_internal::is_rank_selected(
+    env::get_raw("LOG_RANKS"), MPIRankFlag::get_rank());
+  return selected;
+}
+
+::spdlog::sink_ptr make_rate_limited_sink(::spdlog::sink_ptr sink)
+{
+  auto const max_per_second = env::get<std::size_t>("LOG_RATE_LIMIT");
+  if (max_per_second == 0)
+    return sink;
+  return std::make_shared<h2_internal::RateLimitedSink>(std::move(sink),
+                                                        max_per_second);
+}
+
+std::shared_ptr<::spdlog::logger> make_spdlog_logger(std::string name,
+                                                     ::spdlog::sink_ptr sink)
+{
+  std::shared_ptr<::spdlog::logger> logger;
+  if (env::get<bool>("LOG_ASYNC"))
+  {
+    static std::once_flag init_flag;
+    std::call_once(init_flag, []() {
+      // Reuse the application's thread pool if it made one.
+      if (!::spdlog::thread_pool())
+        ::spdlog::init_thread_pool(
+          env::get<std::size_t>("LOG_ASYNC_QUEUE_SIZE"), 1);
+    });
+    std::string const overflow = env::get_raw("LOG_ASYNC_OVERFLOW");
+    ::spdlog::async_overflow_policy policy;
+    if (overflow == "block")
+      policy = ::spdlog::async_overflow_policy::block;
+    else if (overflow == "overrun")
+      policy = ::spdlog::async_overflow_policy::overrun_oldest;
+    else
+      throw std::runtime_error("Invalid log async overflow policy: "
+                               + overflow);
+    logger = std::make_shared<::spdlog::async_logger>(
+      std::move(name), std::move(sink), ::spdlog::thread_pool(), policy);
+  }
+  else
+  {
+    logger =
+      std::make_shared<::spdlog::logger>(std::move(name), std::move(sink));
+  }
+  ::spdlog::register_logger(logger);
+  logger->set_level(is_logging_rank() ? ::spdlog::level::trace
+                                      : ::spdlog::level::off);
+  return logger;
+}
+
 }  // namespace h2
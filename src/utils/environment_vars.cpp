@@ -11,31 +11,37 @@
 
 #include <stdlib.h>
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace
 {
 
+/** An immutable value of an environment variable. */
+struct H2EnvValue
+{
+  std::string value; /**< Value of the variable (or its default). */
+  bool is_set;       /**< Whether the variable was set in the environment. */
+};
+
+/**
+ * Cache entry for an environment variable.
+ *
+ * The value is read from the environment on first access and then
+ * published through an atomic pointer, so later accesses neither lock
+ * nor call getenv.
+ */
 struct H2EnvVar
 {
-  std::mutex mutex;
-  std::string value;         /**< Cached value of the variable. */
   std::string default_value; /**< Default value of the variable. */
-  bool is_set;         /**< Whether the variable was set in the environment. */
-  bool is_initialized; /**< Whether we have initialized this entry. */
-
-  H2EnvVar()
-  {
-    // This is to make unordered_map happy.
-    H2_ASSERT_DEBUG(false, "Should not be here");
-  }
+  /** The cached value, or null if it has not been read. */
+  std::atomic<H2EnvValue const*> value;
 
   H2EnvVar(std::string default_value_)
-    : value(""),
-      default_value(default_value_),
-      is_set(false),
-      is_initialized(false)
+    : default_value(default_value_), value(nullptr)
   {}
 };
 
@@ -49,6 +55,213 @@ struct H2EnvManager
     register_h2_env_var("DEBUG_BACKTRACE",
                         "false",
                         "Whether to always print backtraces in exceptions");
+    register_h2_env_var(
+      "GPU_ALLOCATOR",
+      "cub",
+      "GPU memory allocator backend (cub, async, or sizeclass)");
+    register_h2_env_var("CUB_BIN_GROWTH",
+                        "2",
+                        "Geometric growth factor of (HIP)CUB allocator bins");
+    register_h2_env_var("CUB_MIN_BIN",
+                        "1",
+                        "Smallest (HIP)CUB allocator bin, as a power of "
+                        "the growth factor");
+    register_h2_env_var("CUB_MAX_BIN",
+                        "",
+                        "Largest (HIP)CUB allocator bin, as a power of the "
+                        "growth factor (unset for no limit)");
+    register_h2_env_var("CUB_MAX_CACHED_SIZE",
+                        "",
+                        "Maximum bytes cached per device by the (HIP)CUB "
+                        "allocator (unset for no limit)");
+    register_h2_env_var("CUB_DEBUG",
+                        "",
+                        "Whether the (HIP)CUB allocator logs allocations");
+    register_h2_env_var("INTERNAL_CUB_POOL",
+                        "",
+                        "Whether H2 uses its own (HIP)CUB allocator rather "
+                        "than sharing Hydrogen's");
+    register_h2_env_var(
+      "GPU_MEMPOOL_RELEASE_THRESHOLD",
+      "",
+      "Bytes the stream-ordered GPU memory pool may keep cached");
+    register_h2_env_var(
+      "GPU_CACHE_MIN_BLOCK",
+      "512",
+      "Smallest block size, in bytes, of the size-class GPU allocator");
+    register_h2_env_var(
+      "GPU_CACHE_LINEAR_THRESHOLD",
+      "1048576",
+      "Bytes above which the size-class GPU allocator rounds linearly");
+    register_h2_env_var(
+      "GPU_CACHE_LINEAR_STEP",
+      "131072",
+      "Rounding step, in bytes, for large size-class GPU allocations");
+    register_h2_env_var("GPU_LAZY_INIT",
+                        "false",
+                        "Whether to defer setting the GPU and creating its "
+                        "context until first device use");
+    register_h2_env_var(
+      "GPU_POOL_RESERVE",
+      "0",
+      "Bytes to allocate and cache in the GPU memory pool when the GPU "
+      "runtime is activated");
+    register_h2_env_var(
+      "CPU_NUM_THREADS",
+      "0",
+      "Number of threads running H2 CPU work (0 for one per hardware "
+      "thread)");
+    register_h2_env_var("CPU_ALLOCATOR",
+                        "default",
+                        "CPU memory allocator backend (default or numa)");
+    register_h2_env_var(
+      "CPU_NUMA_THRESHOLD",
+      "262144",
+      "Bytes at and above which the NUMA CPU allocator binds allocations to "
+      "a NUMA node");
+    register_h2_env_var(
+      "CPU_HUGE_PAGES",
+      "transparent",
+      "Huge pages for large NUMA CPU allocations (none, transparent, or "
+      "explicit)");
+    register_h2_env_var(
+      "CPU_HUGE_PAGE_THRESHOLD",
+      "4194304",
+      "Bytes at and above which the NUMA CPU allocator uses huge pages");
+    register_h2_env_var("CPU_FIRST_TOUCH",
+                        "true",
+                        "Whether the NUMA CPU allocator faults in pages on "
+                        "the CPU thread pool at allocation");
+    register_h2_env_var(
+      "CPU_LOOP_GRAIN_SIZE",
+      "32768",
+      "Minimum elements per thread in multithreaded CPU element-wise loops");
+    register_h2_env_var("GPU_LOOP_AUTOTUNE",
+                        "false",
+                        "Whether to autotune GPU element-wise loop launches");
+    register_h2_env_var(
+      "GPU_LOOP_AUTOTUNE_CACHE",
+      "",
+      "File to load and save autotuned GPU loop launch configurations");
+    register_h2_env_var("GPU_JIT_CACHE_PATH",
+                        "",
+                        "Directory to cache JIT-compiled GPU kernels in");
+    register_h2_env_var(
+      "STREAM_POOL_SIZE",
+      "4",
+      "Number of pooled GPU compute streams of each priority per GPU");
+    register_h2_env_var("COMPRESSION",
+                        "none",
+                        "Compression for large tensor files and "
+                        "redistributions (none or zeros)");
+    register_h2_env_var(
+      "COMPRESSION_THRESHOLD",
+      "1048576",
+      "Bytes at and above which tensor data is compressed");
+    register_h2_env_var(
+      "COMPRESSION_MAX_RATIO",
+      "0.75",
+      "Largest estimated compressed-to-original size ratio at which data "
+      "is still compressed");
+    register_h2_env_var("GDS",
+                        "true",
+                        "Whether to read and write GPU tensor data in files "
+                        "with GPUDirect Storage when it is available");
+    register_h2_env_var(
+      "COPY_PIPELINE_THRESHOLD",
+      "33554432",
+      "Bytes above which copies between pageable host memory and GPUs are "
+      "pipelined through pinned staging buffers (0 to disable)");
+    register_h2_env_var(
+      "COPY_PIPELINE_CHUNK",
+      "4194304",
+      "Bytes per staging buffer in pipelined host-GPU copies");
+    register_h2_env_var(
+      "OBJECT_POOL_SIZE",
+      "256",
+      "Blocks of each size cached per thread for tensor metadata objects "
+      "(0 to disable pooling)");
+    register_h2_env_var(
+      "ALLOCATOR_STATS",
+      "false",
+      "Whether to time allocations and log allocator statistics at exit");
+    register_h2_env_var(
+      "PROFILING",
+      "all",
+      "Categories of profiler ranges to emit in profiling builds (all, "
+      "none, or a comma-separated list of copy, compute, memory, comm, "
+      "and dispatch)");
+    register_h2_env_var("LOG_ASYNC",
+                        "false",
+                        "Whether H2 loggers format and write messages on a "
+                        "background thread");
+    register_h2_env_var("LOG_ASYNC_QUEUE_SIZE",
+                        "8192",
+                        "Messages queued for the background logging thread");
+    register_h2_env_var(
+      "LOG_ASYNC_OVERFLOW",
+      "block",
+      "What loggers do when the async queue is full (block, or overrun to "
+      "discard the oldest message)");
+    register_h2_env_var(
+      "LOG_RANKS",
+      "all",
+      "Ranks that log (all, none, or a comma-separated list of ranks and "
+      "ranges A-B, optionally with a stride, e.g., 0-:100)");
+    register_h2_env_var("LOG_RATE_LIMIT",
+                        "0",
+                        "Maximum messages per second written to each log "
+                        "output (0 for no limit)");
+    register_h2_env_var("TRACE",
+                        "false",
+                        "Whether to trace H2 operations and write a Chrome "
+                        "trace file for each rank");
+    register_h2_env_var(
+      "TRACE_FILE",
+      "h2_trace.%h.%w.json",
+      "Trace file name; %h, %w, and %W expand to the hostname, rank, and "
+      "number of ranks");
+    register_h2_env_var("TRACE_BUFFER_SIZE",
+                        "65536",
+                        "Records buffered per thread when tracing");
+    register_h2_env_var("STRAGGLER_MONITOR",
+                        "false",
+                        "Whether to log ranks that are consistently late to "
+                        "collectives and halo exchanges");
+    register_h2_env_var("STRAGGLER_WINDOW",
+                        "100",
+                        "Synchronization points on a communicator between "
+                        "straggler checks");
+    register_h2_env_var("STRAGGLER_THRESHOLD",
+                        "1.0",
+                        "Mean lateness, in milliseconds, after the median "
+                        "rank that makes a rank late in a window");
+    register_h2_env_var("STRAGGLER_MIN_WINDOWS",
+                        "3",
+                        "Consecutive late windows before a rank is reported "
+                        "as a straggler");
+    register_h2_env_var("TRACE_ROOFLINE",
+                        "false",
+                        "Whether to log achieved versus peak bandwidth of "
+                        "traced operations at exit");
+    register_h2_env_var(
+      "COMM_PLAN_CACHE_SIZE",
+      "64",
+      "Maximum number of cached communication plans of each kind (0 to "
+      "disable caching)");
+    register_h2_env_var(
+      "SCATTER_CHUNK",
+      "4194304",
+      "Bytes per message when scattering a tensor from one process");
+    register_h2_env_var(
+      "BCAST_CHUNK",
+      "0",
+      "Bytes per chunk in pipelined tensor broadcasts (0 to choose from "
+      "the message and communicator sizes)");
+    register_h2_env_var(
+      "ALLREDUCE_BUCKET_SIZE",
+      "67108864",
+      "Default bytes per fused buffer in bucketed allreduces");
   }
 
   /**
@@ -63,27 +276,24 @@ struct H2EnvManager
                            std::string default_value,
                            std::string about);
 
-  /**
-   * Ensure an environment variable cache entry is initialized.
-   *
-   * Assumes the caller holds the cache entry's mutex.
-   */
-  void ensure_env_var_init(std::string const& name, H2EnvVar& cache_entry);
+  /** Return the cached value of a registered environment variable. */
+  H2EnvValue const& get_value(std::string const& name);
 
-  bool check_env_var(std::string const& name)
-  {
-    return env_var_cache.count(name) > 0;
-  }
-
-  H2EnvVar& get_env_var(std::string const& name)
-  {
-    H2_ASSERT_DEBUG(
-      check_env_var(name), "environment variable H2_", name, " not registered");
-
-    return env_var_cache[name];
-  }
+  /** Discard cached values so they are read from the environment again. */
+  void reload();
 
+  /**
+   * Registered variables. This is not modified after construction, so
+   * it may be read concurrently.
+   */
   std::unordered_map<std::string, H2EnvVar> env_var_cache;
+  /** Protects reading values from the environment. */
+  std::mutex mutex;
+  /**
+   * All values ever read. Values are kept until exit so references
+   * returned before a reload remain valid.
+   */
+  std::vector<std::unique_ptr<H2EnvValue>> values;
 };
 
 // Wrapper to use either secure_getenv or getenv.
@@ -100,36 +310,57 @@ void H2EnvManager::register_h2_env_var(std::string name,
                                        std::string default_value,
                                        [[maybe_unused]] std::string about)
 {
-  env_var_cache.emplace(name, default_value);
+  env_var_cache.try_emplace(name, default_value);
 }
 
-void H2EnvManager::ensure_env_var_init(std::string const& name,
-                                       H2EnvVar& cache_entry)
+H2EnvValue const& H2EnvManager::get_value(std::string const& name)
 {
-  if (cache_entry.is_initialized)
+  auto i = env_var_cache.find(name);
+  H2_ASSERT_ALWAYS(i != env_var_cache.end(),
+                   "environment variable H2_",
+                   name,
+                   " not registered");
+  H2EnvVar& cache_entry = i->second;
+  if (H2EnvValue const* value =
+        cache_entry.value.load(std::memory_order_acquire))
   {
-    return;
+    return *value;
   }
 
-  std::string const h2_name = "H2_" + name;
-  char const* env = raw_getenv(h2_name.c_str());
-  if (env == nullptr)
+  std::lock_guard<std::mutex> lock(mutex);
+  // Another thread may have read it while we waited.
+  if (H2EnvValue const* value =
+        cache_entry.value.load(std::memory_order_relaxed))
   {
-    // Variable is not set.
-    cache_entry.is_set = false;
-    cache_entry.value = cache_entry.default_value;
+    return *value;
   }
-  else
+  std::string const h2_name = "H2_" + name;
+  char const* env = raw_getenv(h2_name.c_str());
+  auto value = std::make_unique<H2EnvValue>(
+    (env == nullptr) ? H2EnvValue{cache_entry.default_value, false}
+                     : H2EnvValue{std::string(env), true});
+  values.push_back(std::move(value));
+  cache_entry.value.store(values.back().get(), std::memory_order_release);
+  return *values.back();
+}
+
+void H2EnvManager::reload()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto& [name, cache_entry] : env_var_cache)
   {
-    // Variable is set.
-    cache_entry.is_set = true;
-    cache_entry.value = std::string(env);
+    cache_entry.value.store(nullptr, std::memory_order_release);
   }
-  cache_entry.is_initialized = true;
 }
 
-// Cache for environment variables.
-H2EnvManager h2_env_var_cache;
+// Cache for environment variables. This is a function-local static so
+// it is initialized (thread-safely) on first use, even from other
+// static initializers.
+H2EnvManager& get_env_manager()
+{
+  static H2EnvManager manager;
+  return manager;
+}
 
 }  // anonymous namespace
 
@@ -141,18 +372,22 @@ namespace env
 
 bool exists(std::string const& name)
 {
-  H2EnvVar& cache_entry = h2_env_var_cache.get_env_var(name);
-  std::lock_guard<std::mutex> lock(cache_entry.mutex);
-  h2_env_var_cache.ensure_env_var_init(name, cache_entry);
-  return cache_entry.is_set;
+  return get_env_manager().get_value(name).is_set;
 }
 
-std::string get_raw(std::string const& name)
+std::string const& get_raw(std::string const& name)
+{
+  return get_env_manager().get_value(name).value;
+}
+
+bool is_registered(std::string const& name)
+{
+  return get_env_manager().env_var_cache.count(name) > 0;
+}
+
+void reload()
 {
-  H2EnvVar& cache_entry = h2_env_var_cache.get_env_var(name);
-  std::lock_guard<std::mutex> lock(cache_entry.mutex);
-  h2_env_var_cache.ensure_env_var_init(name, cache_entry);
-  return cache_entry.value;
+  get_env_manager().reload();
 }
 
 namespace raw
@@ -7,8 +7,12 @@
 
 #pragma once
 
+#include "spdlog/sinks/base_sink.h"
 #include "spdlog/spdlog.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace h2_internal
 {
 using LevelMapType = std::unordered_map<std::string, h2::Logger::LogLevelType>;
@@ -45,4 +49,46 @@ MaskMapType get_keys_and_masks(std::string const& str);
 
 LevelMapType get_keys_and_levels(std::string const& str);
 
+/** @brief Return whether `rank` is selected by a rank list.
+ *  @param ranks "all", "none", or a comma-separated list of ranks `N`
+ *  and ranges `A-B`, `A-` (open-ended), or `A-B:S` (every `S`th rank).
+ *  @param rank Rank to check; unknown (negative) ranks are selected.
+ **/
+bool is_rank_selected(std::string const& ranks, int rank);
+
+/** @brief Sink writing at most a fixed number of messages per second.
+ *
+ *  Messages over the limit are dropped, and the number dropped is
+ *  reported once the next one-second window starts (or on flush).
+ **/
+class RateLimitedSink final : public ::spdlog::sinks::base_sink<std::mutex>
+{
+public:
+  RateLimitedSink(::spdlog::sink_ptr sink, std::size_t max_per_second);
+
+  /** @brief Total number of messages dropped. */
+  std::size_t num_dropped() const noexcept
+  {
+    return m_num_dropped.load(std::memory_order_relaxed);
+  }
+
+protected:
+  void sink_it_(::spdlog::details::log_msg const& msg) override;
+  void flush_() override;
+  void set_pattern_(std::string const& pattern) override;
+  void set_formatter_(std::unique_ptr<::spdlog::formatter> formatter) override;
+
+private:
+  void report_dropped(::spdlog::log_clock::time_point time);
+
+  ::spdlog::sink_ptr m_sink;
+  std::size_t m_max_per_second;
+  ::spdlog::log_clock::time_point m_window_start;
+  std::size_t m_window_count = 0;
+  std::size_t m_window_dropped = 0;
+  std::string m_logger_name;
+  std::atomic<std::size_t> m_num_dropped{0};
+};
+
+
 }  // namespace h2_internal
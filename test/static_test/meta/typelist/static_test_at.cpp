@@ -18,3 +18,12 @@ static_assert(EqV<tlist::At<tlist::Empty, 5>, tlist::Nil>(),
               "At index out of bounds.");
 static_assert(EqV<tlist::At<TList, 5>, tlist::Nil>(),
               "At index out of bounds.");
+
+using LongTList =
+  TL<char, short, int, long, float, double, long double, bool, void>;
+static_assert(EqV<tlist::At<LongTList, 0>, char>(), "At first index.");
+static_assert(EqV<tlist::At<LongTList, 8>, void>(), "At last index.");
+static_assert(EqV<tlist::At<LongTList, 9>, tlist::Nil>(),
+              "At index one past the end.");
+static_assert(EqV<tlist::At<TL<int, int, float>, 1>, int>(),
+              "At index with repeated types.");
@@ -48,3 +48,121 @@ TEMPLATE_LIST_TEST_CASE("Zero-size allocation and deallocation works",
   REQUIRE_NOTHROW(
     h2::internal::Allocator<DataType, Dev>::deallocate(buf, stream));
 }
+
+TEST_CASE("Pinned allocation and deallocation works", "[allocator]")
+{
+  ComputeStream stream{Device::CPU};
+
+  DataType* buf = h2::internal::PinnedAllocator<DataType>::allocate(8, stream);
+  REQUIRE(buf != nullptr);
+  DataType* buf2 = h2::internal::PinnedAllocator<DataType>::allocate(8, stream);
+  REQUIRE(buf2 != nullptr);
+  REQUIRE(buf != buf2);
+  buf[7] = 42;
+
+  REQUIRE_NOTHROW(
+    h2::internal::PinnedAllocator<DataType>::deallocate(buf, stream));
+  // Freed blocks are cached and handed out again.
+  DataType* buf3 = h2::internal::PinnedAllocator<DataType>::allocate(8, stream);
+  REQUIRE(buf3 == buf);
+
+  REQUIRE_NOTHROW(
+    h2::internal::PinnedAllocator<DataType>::deallocate(buf2, stream));
+  REQUIRE_NOTHROW(
+    h2::internal::PinnedAllocator<DataType>::deallocate(buf3, stream));
+  REQUIRE_NOTHROW(h2::internal::pinned_release_cached());
+}
+
+TEST_CASE("Managed buffers with pinned memory work", "[allocator]")
+{
+  h2::internal::ManagedBuffer<DataType> buf(
+    16, Device::CPU, std::nullopt, MemoryKind::Pinned);
+  REQUIRE(buf.data() != nullptr);
+  REQUIRE(buf.size() == 16);
+  REQUIRE(buf.get_memory_kind() == MemoryKind::Pinned);
+
+  h2::internal::ManagedBuffer<DataType> buf2(std::move(buf));
+  REQUIRE(buf.data() == nullptr);
+  REQUIRE(buf2.get_memory_kind() == MemoryKind::Pinned);
+}
+
+TEMPLATE_LIST_TEST_CASE("Allocator statistics track managed buffers",
+                        "[allocator]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+
+  reset_allocator_stats(Dev);
+  AllocatorStats const before = get_allocator_stats(Dev);
+  REQUIRE(before.num_allocations == 0);
+  REQUIRE(before.num_deallocations == 0);
+  REQUIRE(before.peak_bytes_live == before.bytes_live);
+
+  {
+    h2::internal::ManagedBuffer<DataType> buf(32, Dev);
+    AllocatorStats const during = get_allocator_stats(Dev);
+    REQUIRE(during.bytes_live == before.bytes_live + 32 * sizeof(DataType));
+    REQUIRE(during.peak_bytes_live >= during.bytes_live);
+    REQUIRE(during.num_allocations == 1);
+    REQUIRE(during.num_deallocations == 0);
+  }
+
+  AllocatorStats const after = get_allocator_stats(Dev);
+  REQUIRE(after.bytes_live == before.bytes_live);
+  REQUIRE(after.peak_bytes_live >= before.bytes_live + 32 * sizeof(DataType));
+  REQUIRE(after.num_allocations == 1);
+  REQUIRE(after.num_deallocations == 1);
+}
+
+TEST_CASE("Allocator statistics track the pinned cache", "[allocator]")
+{
+  // Warm the cache so the next allocation of this size hits.
+  {
+    h2::internal::ManagedBuffer<DataType> buf(
+      1024, Device::CPU, std::nullopt, MemoryKind::Pinned);
+  }
+  reset_allocator_stats(Device::CPU);
+  REQUIRE(get_allocator_stats(Device::CPU).bytes_cached
+          >= 1024 * sizeof(DataType));
+  {
+    h2::internal::ManagedBuffer<DataType> buf(
+      1024, Device::CPU, std::nullopt, MemoryKind::Pinned);
+    AllocatorStats const stats = get_allocator_stats(Device::CPU);
+    REQUIRE(stats.num_cache_hits == 1);
+    REQUIRE(stats.num_cache_misses == 0);
+    REQUIRE(stats.cache_hit_rate() == 1.0);
+  }
+}
+
+#ifdef H2_HAS_GPU
+TEST_CASE("GPU memory pools share one trim/stats surface", "[allocator]")
+{
+  gpu::MemoryPool& pool = gpu::memory_pool();
+  gpu::MemoryPool& h_pool = gpu::hydrogen_memory_pool();
+  REQUIRE(gpu::shares_hydrogen_memory_pool() == (&pool == &h_pool));
+
+  ComputeStream const stream{Device::GPU};
+  gpu::DeviceStream const dev_stream = stream.get_stream<Device::GPU>();
+  void* ptr = pool.allocate(1024, dev_stream);
+  REQUIRE(ptr != nullptr);
+  pool.deallocate(ptr, dev_stream);
+  void* h_ptr = h_pool.allocate(1024, dev_stream);
+  REQUIRE(h_ptr != nullptr);
+  h_pool.deallocate(h_ptr, dev_stream);
+
+  std::size_t expected = pool.cached_bytes();
+  if (!gpu::shares_hydrogen_memory_pool())
+  {
+    expected += h_pool.cached_bytes();
+  }
+  REQUIRE(gpu::cached_bytes() == expected);
+
+  gpu::trim_cache();
+  if (gpu::allocator_backend() != gpu::AllocatorBackend::StreamOrdered)
+  {
+    REQUIRE(pool.cached_bytes() == 0);
+  }
+  // Hydrogen's pool is always a CUB pool, which trimming empties.
+  REQUIRE(h_pool.cached_bytes() == 0);
+}
+#endif
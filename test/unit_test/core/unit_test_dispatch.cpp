@@ -419,23 +419,37 @@ void dyndist_tester(BaseTensor& dst, const BaseTensor& src)
          Tensor<std::uint32_t>&,
          const Tensor<std::uint32_t>&>::call},
     }};
+  static h2::internal::DispatchSite _dispatch_site_dyndist_tester_gpu{
+    "dyndist_tester_gpu"};
 #endif
+  static h2::internal::DispatchSite _dispatch_site_dyndist_tester_cpu{
+    "dyndist_tester_cpu"};
 
   H2_DEVICE_DISPATCH(src.get_device(),
                      do_dispatch(_dispatch_table_dyndist_tester_cpu,
-                                 "dyndist_tester_cpu",
+                                 _dispatch_site_dyndist_tester_cpu,
                                  DispatchOn<2>(dst, src),
                                  CPUDev_t{},
                                  dst,
                                  src),
                      do_dispatch(_dispatch_table_dyndist_tester_gpu,
-                                 "dyndist_tester_gpu",
+                                 _dispatch_site_dyndist_tester_gpu,
                                  DispatchOn<2>(dst, src),
                                  GPUDev_t{},
                                  dst,
                                  src));
 }
 
+void dyndist_intern_test(int& v)
+{
+  v = 1;
+}
+
+void dyndist_site_test(int& v)
+{
+  v = 2;
+}
+
 }  // anonymous namespace
 
 TEMPLATE_LIST_TEST_CASE("Dynamic dispatch works for H2 compute types",
@@ -529,3 +543,136 @@ TEMPLATE_LIST_TEST_CASE("Dynamic dispatch to non-native compute type works",
                                        get_h2_type<dyndist_cust_type_t>()));
 #endif
 }
+
+TEST_CASE("Dispatch names are interned", "[dispatch]")
+{
+  using namespace h2::internal;
+
+  DispatchNameHandle const handle =
+    get_dispatch_name_handle("dispatch_intern_tester");
+  REQUIRE(get_dispatch_name_handle("dispatch_intern_tester") == handle);
+  REQUIRE(get_dispatch_name_handle("dispatch_intern_tester2") != handle);
+  REQUIRE(get_dispatch_name(handle) == "dispatch_intern_tester");
+
+  auto const key = get_dispatch_key(get_h2_type<dyndist_cust_type_t>());
+  REQUIRE(find_dispatch_entry(handle, key) == nullptr);
+  REQUIRE_FALSE(has_dispatch_entry(handle, key));
+  REQUIRE_THROWS(get_dispatch_entry(handle, key));
+
+  // Registering by name is visible through the handle.
+  dispatch_register("dispatch_intern_tester", key, &dyndist_intern_test);
+  DispatchFunctionEntry const* entry = find_dispatch_entry(handle, key);
+  REQUIRE(entry != nullptr);
+  REQUIRE(entry->func_ptr == reinterpret_cast<void*>(&dyndist_intern_test));
+  REQUIRE(has_dispatch_entry("dispatch_intern_tester", key));
+
+  int v = 0;
+  call_dispatch_entry(handle, key, v);
+  REQUIRE(v == 1);
+
+  // Entries for other keys and names are independent.
+  auto const key2 = get_dispatch_key(get_h2_type<dyndist_cust_type_t>(),
+                                     get_h2_type<dyndist_cust_type_t>());
+  REQUIRE_FALSE(has_dispatch_entry(handle, key2));
+  REQUIRE_FALSE(has_dispatch_entry("dispatch_intern_tester2", key));
+
+  dispatch_unregister("dispatch_intern_tester", key);
+  REQUIRE(find_dispatch_entry(handle, key) == nullptr);
+  // Earlier lookups remain valid.
+  REQUIRE(entry->func_ptr == reinterpret_cast<void*>(&dyndist_intern_test));
+}
+
+TEST_CASE("Dispatch sites cache registered entries", "[dispatch]")
+{
+  using namespace h2::internal;
+
+  DispatchSite site{"dispatch_site_tester"};
+  REQUIRE(site.get_handle()
+          == get_dispatch_name_handle("dispatch_site_tester"));
+
+  auto const key = get_dispatch_key(get_h2_type<dyndist_cust_type_t>());
+  auto const key2 = get_dispatch_key(get_h2_type<dyndist_cust_type_t>(),
+                                     get_h2_type<dyndist_cust_type_t>());
+  REQUIRE(site.lookup(key) == nullptr);
+
+  dispatch_register("dispatch_site_tester", key, &dyndist_intern_test);
+  DispatchFunctionEntry const* entry =
+    find_dispatch_entry(site.get_handle(), key);
+  REQUIRE(entry != nullptr);
+  site.update(key, get_dispatch_generation(), entry);
+  REQUIRE(site.lookup(key) == entry);
+  // A different key misses.
+  REQUIRE(site.lookup(key2) == nullptr);
+
+  // Registering anything invalidates the cache, even for other names.
+  dispatch_register("dispatch_site_tester2", key, &dyndist_site_test);
+  REQUIRE(site.lookup(key) == nullptr);
+  std::uint64_t const generation = get_dispatch_generation();
+  site.update(key, generation, entry);
+  REQUIRE(site.lookup(key) == entry);
+
+  // Re-registering the key changes what dispatch resolves to.
+  dispatch_unregister("dispatch_site_tester", key);
+  REQUIRE(site.lookup(key) == nullptr);
+  dispatch_register("dispatch_site_tester", key, &dyndist_site_test);
+  REQUIRE(site.lookup(key) == nullptr);
+  int v = 0;
+  call_dispatch_entry(site.get_handle(), key, v);
+  REQUIRE(v == 2);
+
+  // An entry looked up at an old generation is not served.
+  site.update(key, generation, entry);
+  REQUIRE(site.lookup(key) == nullptr);
+
+  dispatch_unregister("dispatch_site_tester", key);
+  dispatch_unregister("dispatch_site_tester2", key);
+}
+
+TEST_CASE("Native dispatch pairs are consistent", "[dispatch]")
+{
+  using AllPairs = meta::tlist::CartProdTL<ComputeTypes, ComputeTypes>;
+  REQUIRE(meta::tlist::Length<NativeDispatchPairs>
+          <= meta::tlist::Length<AllPairs>);
+  REQUIRE(IsNativeDispatchPair_v<float, double>
+          == static_cast<bool>(H2_NATIVE_DISPATCH_float_double));
+  REQUIRE(IsNativeDispatchPair_v<std::uint32_t, std::int32_t>
+          == static_cast<bool>(H2_NATIVE_DISPATCH_uint32_int32));
+  REQUIRE_FALSE(IsNativeDispatchPair_v<dyndist_cust_type_t, float>);
+}
+
+TEST_CASE("Native types without native entries use registered dispatch",
+          "[dispatch]")
+{
+  using namespace h2::internal;
+
+  // Only std::int32_t has a native entry.
+  static std::array<DispatchFunctionEntry, NumComputeTypes> table = {{
+    {nullptr, nullptr},
+    {nullptr, nullptr},
+    {reinterpret_cast<void*>(&dyndist_intern_test),
+     &DispatchFunctionWrapper<void, int&>::call},
+    {nullptr, nullptr},
+  }};
+  DispatchSite site{"dispatch_fallback_tester"};
+
+  int v = 0;
+  do_dispatch(table, site, DispatchOn<1>(get_h2_type<std::int32_t>()), v);
+  REQUIRE(v == 1);
+  REQUIRE_THROWS(
+    do_dispatch(table, site, DispatchOn<1>(get_h2_type<float>()), v));
+
+  auto const key = get_dispatch_key(get_h2_type<float>());
+  dispatch_register("dispatch_fallback_tester", key, &dyndist_site_test);
+  v = 0;
+  do_dispatch(table, site, DispatchOn<1>(get_h2_type<float>()), v);
+  REQUIRE(v == 2);
+  v = 0;
+  do_dispatch(table,
+              std::string("dispatch_fallback_tester"),
+              DispatchOn<1>(get_h2_type<float>()),
+              v);
+  REQUIRE(v == 2);
+  REQUIRE_THROWS(
+    do_dispatch(table, site, DispatchOn<1>(get_h2_type<double>()), v));
+  dispatch_unregister("dispatch_fallback_tester", key);
+}
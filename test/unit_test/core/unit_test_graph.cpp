@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/graph.hpp"
+#include "h2/gpu/memory_utils.hpp"
+
+#include "../tensor/utils.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+TEST_CASE("Compute graphs capture and replay", "[sync][graph]")
+{
+  ComputeStream stream = create_new_compute_stream<Device::GPU>();
+  constexpr std::size_t size = 16;
+  internal::ManagedBuffer<DataType> src(size, Device::GPU, stream);
+  internal::ManagedBuffer<DataType> dst(size, Device::GPU, stream);
+  gpu::mem_zero(dst.data(), size, stream.get_stream<Device::GPU>());
+
+  ComputeGraph graph;
+  REQUIRE_FALSE(graph.is_capturing());
+  REQUIRE_FALSE(graph.is_captured());
+
+  DataType* tmp_buf = nullptr;
+  graph.begin_capture(stream);
+  REQUIRE(graph.is_capturing());
+  {
+    // This temporary is released during capture, but the graph keeps
+    // its memory.
+    internal::ManagedBuffer<DataType> tmp(size, Device::GPU, stream);
+    tmp_buf = tmp.data();
+    gpu::mem_copy(
+      tmp.data(), src.const_data(), size, stream.get_stream<Device::GPU>());
+    gpu::mem_copy(
+      dst.data(), tmp.const_data(), size, stream.get_stream<Device::GPU>());
+  }
+  graph.end_capture();
+  REQUIRE_FALSE(graph.is_capturing());
+  REQUIRE(graph.is_captured());
+
+  // Nothing ran during capture.
+  stream.wait_for_this();
+  REQUIRE(read_ele<Device::GPU>(dst.data(), 0, stream) == DataType{0});
+
+  for (int iter = 1; iter <= 3; ++iter)
+  {
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      write_ele<Device::GPU>(
+        src.data(), i, static_cast<DataType>(iter * i), stream);
+    }
+    graph.replay(stream);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      REQUIRE(read_ele<Device::GPU>(dst.data(), i, stream)
+              == static_cast<DataType>(iter * i));
+    }
+  }
+
+  SECTION("Graph memory is not reused while the graph exists")
+  {
+    internal::ManagedBuffer<DataType> other(size, Device::GPU, stream);
+    REQUIRE(other.data() != tmp_buf);
+  }
+
+  SECTION("Moved graphs replay")
+  {
+    ComputeGraph moved = std::move(graph);
+    REQUIRE_FALSE(graph.is_captured());
+    REQUIRE(moved.is_captured());
+    REQUIRE_NOTHROW(moved.replay(stream));
+    stream.wait_for_this();
+  }
+
+  SECTION("Reset releases the graph")
+  {
+    graph.reset();
+    REQUIRE_FALSE(graph.is_captured());
+    REQUIRE_THROWS(graph.replay(stream));
+  }
+
+  graph.reset();
+  destroy_compute_stream(stream);
+}
+
+TEST_CASE("capture_graph works", "[sync][graph]")
+{
+  ComputeStream stream = create_new_compute_stream<Device::GPU>();
+  internal::ManagedBuffer<DataType> buf(1, Device::GPU, stream);
+  write_ele<Device::GPU>(buf.data(), 0, DataType{1}, stream);
+
+  ComputeGraph graph = capture_graph(stream, [&]() {
+    gpu::mem_zero(buf.data(), 1, stream.get_stream<Device::GPU>());
+  });
+  REQUIRE(graph.is_captured());
+  REQUIRE(read_ele<Device::GPU>(buf.data(), 0, stream) == DataType{1});
+  graph.replay(stream);
+  REQUIRE(read_ele<Device::GPU>(buf.data(), 0, stream) == DataType{0});
+
+  SECTION("Exceptions abandon capture")
+  {
+    REQUIRE_THROWS(capture_graph(stream, []() { throw H2Exception("test"); }));
+    REQUIRE_FALSE(internal::graph_capture_in_progress());
+    // The stream is usable again.
+    REQUIRE_NOTHROW(capture_graph(stream, []() {}));
+  }
+
+  graph.reset();
+  destroy_compute_stream(stream);
+}
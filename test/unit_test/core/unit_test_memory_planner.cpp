@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/memory_planner.hpp"
+#include "h2/tensor/tensor.hpp"
+
+#include "../tensor/utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+namespace
+{
+
+/** Check no two buffers with overlapping lifetimes overlap in memory. */
+bool plan_is_valid(std::vector<BufferLifetime> const& buffers,
+                   MemoryPlan const& plan)
+{
+  for (std::size_t i = 0; i < buffers.size(); ++i)
+  {
+    if (plan.offsets[i] + buffers[i].bytes > plan.total_bytes)
+    {
+      return false;
+    }
+    for (std::size_t j = i + 1; j < buffers.size(); ++j)
+    {
+      bool const live_together = buffers[i].first_use <= buffers[j].last_use
+                                 && buffers[j].first_use <= buffers[i].last_use;
+      bool const share_memory =
+        plan.offsets[i] < plan.offsets[j] + buffers[j].bytes
+        && plan.offsets[j] < plan.offsets[i] + buffers[i].bytes;
+      if (live_together && share_memory && buffers[i].bytes
+          && buffers[j].bytes)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("Memory plans reuse memory for disjoint lifetimes",
+          "[allocator][planner]")
+{
+  SECTION("Empty plan")
+  {
+    MemoryPlan plan = plan_memory_reuse({});
+    REQUIRE(plan.offsets.empty());
+    REQUIRE(plan.total_bytes == 0);
+  }
+  SECTION("Disjoint buffers share memory")
+  {
+    std::vector<BufferLifetime> buffers = {
+      {100, 0, 2}, {200, 1, 4}, {100, 3, 5}};
+    MemoryPlan plan = plan_memory_reuse(buffers, 1);
+    REQUIRE(plan_is_valid(buffers, plan));
+    REQUIRE(plan.total_bytes == 300);
+    REQUIRE(plan.offsets[0] == plan.offsets[2]);
+  }
+  SECTION("Overlapping buffers do not share memory")
+  {
+    std::vector<BufferLifetime> buffers = {{100, 0, 5}, {100, 5, 6}};
+    MemoryPlan plan = plan_memory_reuse(buffers, 1);
+    REQUIRE(plan_is_valid(buffers, plan));
+    REQUIRE(plan.total_bytes == 200);
+  }
+  SECTION("Smaller buffers reuse freed space")
+  {
+    // 3 starts after 1 is dead, so it takes 1's place.
+    std::vector<BufferLifetime> buffers = {
+      {256, 0, 10}, {128, 0, 1}, {256, 0, 10}, {128, 2, 3}};
+    MemoryPlan plan = plan_memory_reuse(buffers, 1);
+    REQUIRE(plan_is_valid(buffers, plan));
+    REQUIRE(plan.total_bytes == 640);
+  }
+  SECTION("Offsets are aligned")
+  {
+    std::vector<BufferLifetime> buffers = {{1, 0, 1}, {1, 0, 1}, {1, 0, 1}};
+    MemoryPlan plan = plan_memory_reuse(buffers, 256);
+    REQUIRE(plan_is_valid(buffers, plan));
+    REQUIRE(plan.total_bytes == 3 * 256);
+    for (auto offset : plan.offsets)
+    {
+      REQUIRE(offset % 256 == 0);
+    }
+  }
+  SECTION("Invalid lifetimes are rejected")
+  {
+    REQUIRE_THROWS(plan_memory_reuse({{1, 2, 1}}));
+  }
+}
+
+TEST_CASE("Memory plan recorder tracks lifetimes", "[allocator][planner]")
+{
+  MemoryPlanRecorder recorder;
+  int a, b;
+
+  REQUIRE(recorder.record_ensure(&a, 1024) == 0);
+  REQUIRE(recorder.record_ensure(&b, 512) == 1);
+  REQUIRE_THROWS(recorder.record_ensure(&a, 1024));
+  recorder.record_release(&a);
+  REQUIRE_THROWS(recorder.record_release(&a));
+  REQUIRE(recorder.record_ensure(&a, 512) == 2);
+  recorder.record_release(&b);
+  REQUIRE(recorder.num_buffers() == 3);
+
+  auto lifetimes = recorder.get_lifetimes();
+  REQUIRE(lifetimes[0].first_use == 0);
+  REQUIRE(lifetimes[0].last_use == 2);
+  REQUIRE(lifetimes[1].last_use == 4);
+  // Still live, so lasts until the end.
+  REQUIRE(lifetimes[2].last_use == 5);
+
+  MemoryPlan plan = recorder.plan(1);
+  REQUIRE(plan_is_valid(lifetimes, plan));
+  // The last buffer reuses the first's memory.
+  REQUIRE(plan.total_bytes == 1536);
+  REQUIRE(plan.offsets[2] == plan.offsets[0]);
+
+  recorder.clear();
+  REQUIRE(recorder.num_buffers() == 0);
+}
+
+TEMPLATE_LIST_TEST_CASE("Memory slabs back tensors",
+                        "[allocator][planner]",
+                        AllDevList)
+{
+  using TensorType = Tensor<DataType>;
+  constexpr Device Dev = TestType::value;
+
+  std::vector<BufferLifetime> buffers = {{16 * sizeof(DataType), 0, 1},
+                                         {16 * sizeof(DataType), 1, 2},
+                                         {16 * sizeof(DataType), 2, 3}};
+  MemorySlab slab(Dev, plan_memory_reuse(buffers));
+  REQUIRE(slab.get_device() == Dev);
+  REQUIRE(slab.num_buffers() == 3);
+  REQUIRE(slab.size() == 2 * 256);
+  REQUIRE(slab.get(0) == slab.get(2));
+  REQUIRE(slab.get(0) != slab.get(1));
+
+  TensorType tensor(Dev,
+                    slab.get_as<DataType>(1),
+                    {4, 4},
+                    {DT::Sample, DT::Any},
+                    {1, 4},
+                    slab.get_stream());
+  REQUIRE(tensor.data() == slab.get_as<DataType>(1));
+  write_ele<Dev>(
+    tensor.data(), 3, static_cast<DataType>(42), tensor.get_stream());
+  REQUIRE(read_ele<Dev>(slab.get_as<DataType>(1), 3, slab.get_stream())
+          == 42);
+}
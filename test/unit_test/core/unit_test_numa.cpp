@@ -0,0 +1,55 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/numa.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+using namespace h2;
+
+TEST_CASE("NUMA node selection works", "[allocator][numa]")
+{
+  REQUIRE(cpu::get_current_numa_node() >= -1);
+  REQUIRE(cpu::get_numa_node() == -1);
+  {
+    cpu::NumaNodeGuard guard(0);
+    REQUIRE(cpu::get_numa_node() == 0);
+    {
+      cpu::NumaNodeGuard inner_guard(-1);
+      REQUIRE(cpu::get_numa_node() == -1);
+    }
+    REQUIRE(cpu::get_numa_node() == 0);
+  }
+  REQUIRE(cpu::get_numa_node() == -1);
+}
+
+TEST_CASE("NUMA allocation and deallocation works", "[allocator][numa]")
+{
+  // Small and large (mapped, huge page) sizes.
+  std::size_t const size = GENERATE(std::size_t{0},
+                                    std::size_t{100},
+                                    std::size_t{1} << 20,
+                                    (std::size_t{9} << 20) + 3);
+  cpu::NumaNodeGuard guard(cpu::get_current_numa_node());
+  auto* buf = static_cast<unsigned char*>(cpu::internal::numa_allocate(size));
+  REQUIRE(buf != nullptr);
+  REQUIRE(reinterpret_cast<std::uintptr_t>(buf) % alignof(std::max_align_t)
+          == 0);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    buf[i] = static_cast<unsigned char>(i);
+  }
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    REQUIRE(buf[i] == static_cast<unsigned char>(i));
+  }
+  REQUIRE_NOTHROW(cpu::internal::numa_deallocate(buf));
+}
@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/object_pool.hpp"
+#include "h2/tensor/tensor.hpp"
+
+#include "../tensor/utils.hpp"
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <thread>
+
+using namespace h2;
+
+TEST_CASE("Object pool reuses freed blocks", "[allocator][pool]")
+{
+  void* ptr = internal::pool_allocate(100);
+  REQUIRE(ptr != nullptr);
+  std::size_t const num_cached = internal::pool_num_cached();
+  internal::pool_deallocate(ptr, 100);
+  REQUIRE(internal::pool_num_cached() == num_cached + 1);
+
+  // Sizes in the same class share blocks.
+  void* ptr2 = internal::pool_allocate(120);
+  REQUIRE(ptr2 == ptr);
+  REQUIRE(internal::pool_num_cached() == num_cached);
+
+  // Sizes in other classes do not.
+  void* ptr3 = internal::pool_allocate(8);
+  REQUIRE(ptr3 != ptr2);
+  std::size_t const num_cached3 = internal::pool_num_cached();
+  internal::pool_deallocate(ptr3, 8);
+  internal::pool_deallocate(ptr2, 120);
+  REQUIRE(internal::pool_num_cached() == num_cached3 + 2);
+
+  // Large objects are not pooled.
+  std::size_t const large = internal::max_pooled_object_size + 1;
+  void* ptr4 = internal::pool_allocate(large);
+  internal::pool_deallocate(ptr4, large);
+  REQUIRE(internal::pool_num_cached() == num_cached3 + 2);
+}
+
+TEST_CASE("Object pool blocks may be freed on other threads",
+          "[allocator][pool]")
+{
+  void* ptr = nullptr;
+  std::thread t([&]() { ptr = internal::pool_allocate(64); });
+  t.join();
+  REQUIRE(ptr != nullptr);
+  internal::pool_deallocate(ptr, 64);
+  REQUIRE(internal::pool_allocate(64) == ptr);
+  internal::pool_deallocate(ptr, 64);
+
+  // Blocks cached by a thread are released when it exits.
+  std::thread t2([&]() {
+    void* p = internal::pool_allocate(64);
+    internal::pool_deallocate(p, 64);
+  });
+  t2.join();
+}
+
+TEST_CASE("Raw buffers and their control blocks are pooled",
+          "[allocator][pool]")
+{
+  struct Data
+  {
+    int x;
+    double y;
+  };
+  auto ptr = std::allocate_shared<Data>(
+    internal::PoolAllocator<Data>{}, Data{1, 2.0});
+  REQUIRE(ptr->x == 1);
+  REQUIRE(ptr->y == 2.0);
+  std::size_t const num_cached = internal::pool_num_cached();
+  ptr.reset();
+  REQUIRE(internal::pool_num_cached() == num_cached + 1);
+}
+
+TEST_CASE("Tensor views are pooled", "[allocator][pool][tensor]")
+{
+  using TensorType = Tensor<DataType>;
+  TensorType tensor(Device::CPU, {4, 6}, {DT::Sample, DT::Any});
+
+  auto view = tensor.view();
+  TensorType const* const addr = view.get();
+  view.reset();
+  auto view2 = tensor.view();
+  REQUIRE(view2.get() == addr);
+  REQUIRE(view2->data() == tensor.data());
+
+  std::unique_ptr<BaseTensor> base_view = tensor.view();
+  REQUIRE(base_view->shape() == tensor.shape());
+  base_view.reset();
+}
@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/profiling.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+namespace
+{
+
+std::uint32_t category_bit(ProfileCategory category)
+{
+  return std::uint32_t{1} << static_cast<std::uint32_t>(category);
+}
+
+}  // anonymous namespace
+
+TEST_CASE("Profile categories are parsed", "[profiling]")
+{
+  REQUIRE(internal::parse_profile_categories("") == 0);
+  REQUIRE(internal::parse_profile_categories("none") == 0);
+  REQUIRE(internal::parse_profile_categories("copy")
+          == category_bit(ProfileCategory::Copy));
+  REQUIRE(internal::parse_profile_categories("comm,dispatch")
+          == (category_bit(ProfileCategory::Comm)
+              | category_bit(ProfileCategory::Dispatch)));
+
+  std::uint32_t const all = internal::parse_profile_categories("all");
+  for (std::uint32_t c = 1; c <= num_profile_categories; ++c)
+  {
+    ProfileCategory const category = static_cast<ProfileCategory>(c);
+    REQUIRE((all & category_bit(category)) != 0);
+    REQUIRE(internal::parse_profile_categories(
+              get_profile_category_name(category))
+            == category_bit(category));
+  }
+
+  REQUIRE_THROWS(internal::parse_profile_categories("copy,bogus"));
+}
+
+TEST_CASE("Profile ranges are scoped", "[profiling]")
+{
+#if !H2_HAS_PROFILING
+  REQUIRE_FALSE(profiling_enabled(ProfileCategory::Copy));
+#endif
+  {
+    H2_PROFILE_RANGE("outer", Copy);
+    {
+      H2_PROFILE_RANGE("inner", Compute);
+      ProfileRange range("explicit", ProfileCategory::Memory);
+    }
+  }
+  SUCCEED();
+}
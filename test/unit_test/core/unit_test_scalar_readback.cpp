@@ -0,0 +1,126 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/allocator.hpp"
+#include "h2/core/scalar_readback.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "../tensor/utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+TEMPLATE_LIST_TEST_CASE("Scalar readback works",
+                        "[sync][scalar_readback]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  ComputeStream stream{Dev};
+  h2::internal::ManagedBuffer<float> buf(3, Dev, stream);
+  for (std::size_t i = 0; i < buf.size(); ++i)
+  {
+    write_ele<Dev>(buf.data(), i, static_cast<float>(i) + 0.5f, stream);
+  }
+
+  ScalarReadbackRing ring(Dev, 4);
+  REQUIRE(ring.get_device() == Dev);
+  REQUIRE(ring.num_slots() == 4);
+
+  SECTION("Values are read back")
+  {
+    auto val0 = ring.read(buf.const_data(), stream);
+    auto val2 = ring.read(buf.const_data() + 2, stream);
+    REQUIRE(val2.get() == 2.5f);
+    REQUIRE(val0.get() == 0.5f);
+    REQUIRE(val0.ready());
+    // Handles can be read more than once.
+    REQUIRE(val0.get() == 0.5f);
+  }
+
+  SECTION("Values of different types share a ring")
+  {
+    h2::internal::ManagedBuffer<std::int32_t> flag(1, Dev, stream);
+    write_ele<Dev>(flag.data(), 0, std::int32_t{7}, stream);
+    auto val = ring.read(buf.const_data() + 1, stream);
+    auto flag_val = ring.read(flag.const_data(), stream);
+    REQUIRE(val.get() == 1.5f);
+    REQUIRE(flag_val.get() == 7);
+  }
+
+  SECTION("Reused slots are detected")
+  {
+    auto val = ring.read(buf.const_data(), stream);
+    for (std::size_t i = 0; i < ring.num_slots() - 1; ++i)
+    {
+      REQUIRE(ring.read(buf.const_data() + 1, stream).get() == 1.5f);
+    }
+    REQUIRE(val.get() == 0.5f);
+    auto reused = ring.read(buf.const_data() + 2, stream);
+    REQUIRE(reused.get() == 2.5f);
+    REQUIRE_THROWS(val.get());
+    REQUIRE_THROWS(val.ready());
+  }
+}
+
+#ifdef H2_TEST_WITH_GPU
+TEST_CASE("Scalar readback rejects mismatched streams",
+          "[sync][scalar_readback]")
+{
+  ScalarReadbackRing ring(Device::CPU, 1);
+  float value = 1.0f;
+  REQUIRE_THROWS(ring.read(&value, ComputeStream{Device::GPU}));
+}
+#endif
+
+TEST_CASE("Scalar readback does not block async CPU streams",
+          "[sync][scalar_readback]")
+{
+  ComputeStream stream = create_new_async_cpu_stream();
+  ScalarReadbackRing ring(Device::CPU, 2);
+  std::atomic<bool> release{false};
+  float value = 0.0f;
+  enqueue_cpu_task(stream, [&]() {
+    while (!release.load())
+    {
+      std::this_thread::yield();
+    }
+    value = 3.0f;
+  });
+  auto val = ring.read(&value, stream);
+  REQUIRE_FALSE(val.ready());
+  release = true;
+  REQUIRE(val.get() == 3.0f);
+  REQUIRE(val.ready());
+  destroy_compute_stream(stream);
+}
+
+TEST_CASE("SyncEvent completion can be queried", "[sync][scalar_readback]")
+{
+  REQUIRE(SyncEvent{Device::CPU}.is_complete());
+
+  ComputeStream stream = create_new_async_cpu_stream();
+  SyncEvent event = create_new_async_cpu_event();
+  REQUIRE(event.is_complete());
+  std::atomic<bool> release{false};
+  enqueue_cpu_task(stream, [&]() {
+    while (!release.load())
+    {
+      std::this_thread::yield();
+    }
+  });
+  stream.add_sync_point(event);
+  REQUIRE_FALSE(event.is_complete());
+  release = true;
+  event.wait_for_this();
+  REQUIRE(event.is_complete());
+  destroy_sync_event(event);
+  destroy_compute_stream(stream);
+}
@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/scratch_arena.hpp"
+#include "h2/tensor/tensor.hpp"
+
+#include "../tensor/utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+TEMPLATE_LIST_TEST_CASE("Scratch arenas bump allocate",
+                        "[allocator][arena]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+
+  ScratchArena arena(Dev, 4 * ScratchArena::alignment);
+  REQUIRE(arena.get_device() == Dev);
+  REQUIRE(arena.capacity() == 4 * ScratchArena::alignment);
+  REQUIRE(arena.used() == 0);
+
+  void* buf1 = arena.allocate(1);
+  REQUIRE(buf1 != nullptr);
+  REQUIRE(arena.used() == ScratchArena::alignment);
+  void* buf2 = arena.allocate(ScratchArena::alignment + 1);
+  REQUIRE(buf2 != nullptr);
+  REQUIRE(buf2 != buf1);
+  REQUIRE(arena.used() == 3 * ScratchArena::alignment);
+  REQUIRE(arena.num_live() == 2);
+
+  // Does not fit.
+  REQUIRE(arena.allocate(2 * ScratchArena::alignment) == nullptr);
+  REQUIRE(arena.num_fallbacks() == 1);
+
+  arena.deallocate(buf1, arena.get_stream());
+  arena.deallocate(buf2, arena.get_stream());
+  REQUIRE(arena.num_live() == 0);
+  REQUIRE(arena.high_water_mark() == 3 * ScratchArena::alignment);
+}
+
+TEMPLATE_LIST_TEST_CASE("Tensors draw from scratch arena scopes",
+                        "[allocator][arena]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+
+  ScratchArena arena(Dev, 1024 * sizeof(DataType));
+  DataType* first_buf = nullptr;
+  {
+    ScratchArenaScope scope(arena);
+    TensorType tensor(Dev, {4, 6}, {DT::Sample, DT::Any});
+    first_buf = tensor.data();
+    REQUIRE(arena.used() > 0);
+    REQUIRE(arena.num_live() == 1);
+
+    SECTION("Nested scopes rewind to their start")
+    {
+      std::size_t const used = arena.used();
+      {
+        ScratchArenaScope inner(arena);
+        TensorType tensor2(Dev, {4, 6}, {DT::Sample, DT::Any});
+        REQUIRE(arena.used() > used);
+      }
+      REQUIRE(arena.used() == used);
+    }
+    SECTION("Oversized tensors fall back to the regular allocator")
+    {
+      TensorType big(Dev, {1024, 2}, {DT::Sample, DT::Any});
+      REQUIRE(big.data() != nullptr);
+      REQUIRE(arena.num_fallbacks() == 1);
+      REQUIRE(arena.num_live() == 1);
+    }
+  }
+  REQUIRE(arena.used() == 0);
+  REQUIRE(arena.num_live() == 0);
+
+  // Memory is reused by the next scope.
+  {
+    ScratchArenaScope scope(arena);
+    TensorType tensor(Dev, {4, 6}, {DT::Sample, DT::Any});
+    REQUIRE(tensor.data() == first_buf);
+  }
+
+  // No scope: regular allocation.
+  TensorType tensor(Dev, {4, 6}, {DT::Sample, DT::Any});
+  REQUIRE(arena.num_live() == 0);
+  REQUIRE(arena.used() == 0);
+}
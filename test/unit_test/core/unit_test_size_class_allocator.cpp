@@ -0,0 +1,186 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/size_class_allocator.hpp"
+#include "h2/utils/Error.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdlib>
+
+using namespace h2;
+using internal::SizeClassAllocator;
+using internal::SizeClassPolicy;
+
+namespace
+{
+
+constexpr std::size_t KiB = 1024;
+
+SizeClassPolicy test_policy()
+{
+  SizeClassPolicy policy;
+  policy.min_block_size = 256;
+  policy.linear_threshold = 64 * KiB;
+  policy.linear_step = 16 * KiB;
+  return policy;
+}
+
+/** Raw allocator that counts calls and can be made to fail. */
+struct RawCounter
+{
+  std::size_t num_allocs = 0;
+  std::size_t num_frees = 0;
+  std::size_t limit = ~std::size_t{0};
+  std::size_t live_bytes = 0;
+
+  SizeClassAllocator make_allocator()
+  {
+    return SizeClassAllocator(
+      [this](std::size_t bytes) -> void* {
+        if (live_bytes + bytes > limit)
+        {
+          return nullptr;
+        }
+        ++num_allocs;
+        live_bytes += bytes;
+        // Stash the size in front so frees can be accounted.
+        auto* p = static_cast<std::size_t*>(
+          std::malloc(bytes + sizeof(std::size_t)));
+        *p = bytes;
+        return p + 1;
+      },
+      [this](void* ptr) {
+        ++num_frees;
+        auto* p = static_cast<std::size_t*>(ptr) - 1;
+        live_bytes -= *p;
+        std::free(p);
+      },
+      test_policy());
+  }
+};
+
+int stream_a, stream_b;
+
+}  // anonymous namespace
+
+TEST_CASE("Size class rounding", "[allocator][sizeclass]")
+{
+  SizeClassPolicy policy = test_policy();
+  REQUIRE(policy.round(0) == 256);
+  REQUIRE(policy.round(1) == 256);
+  REQUIRE(policy.round(256) == 256);
+  REQUIRE(policy.round(257) == 512);
+  REQUIRE(policy.round(33 * KiB) == 64 * KiB);
+  REQUIRE(policy.round(64 * KiB) == 64 * KiB);
+  REQUIRE(policy.round(64 * KiB + 1) == 80 * KiB);
+  REQUIRE(policy.round(100 * KiB) == 112 * KiB);
+}
+
+TEST_CASE("Size class allocator caches small blocks per stream",
+          "[allocator][sizeclass]")
+{
+  RawCounter raw;
+  auto alloc = raw.make_allocator();
+
+  void* buf = alloc.allocate(300, &stream_a);
+  REQUIRE(buf != nullptr);
+  REQUIRE(alloc.allocated_bytes() == 512);
+  REQUIRE(alloc.reserved_bytes() == 512);
+  alloc.deallocate(buf);
+  REQUIRE(alloc.allocated_bytes() == 0);
+  REQUIRE(alloc.cached_bytes() == 512);
+
+  // Same stream and size class reuses the block.
+  REQUIRE(alloc.allocate(400, &stream_a) == buf);
+  REQUIRE(raw.num_allocs == 1);
+  REQUIRE(alloc.cached_bytes() == 0);
+  alloc.deallocate(buf);
+
+  // A different stream does not.
+  void* buf2 = alloc.allocate(400, &stream_b);
+  REQUIRE(buf2 != buf);
+  REQUIRE(raw.num_allocs == 2);
+  alloc.deallocate(buf2);
+
+  alloc.trim();
+  REQUIRE(alloc.cached_bytes() == 0);
+  REQUIRE(alloc.reserved_bytes() == 0);
+  REQUIRE(raw.num_frees == 2);
+}
+
+TEST_CASE("Size class allocator splits and coalesces large blocks",
+          "[allocator][sizeclass]")
+{
+  RawCounter raw;
+  auto alloc = raw.make_allocator();
+
+  char* big = static_cast<char*>(alloc.allocate(256 * KiB, &stream_a));
+  alloc.deallocate(big);
+  REQUIRE(alloc.cached_bytes() == 256 * KiB);
+
+  // Both fit in the cached segment.
+  char* buf1 = static_cast<char*>(alloc.allocate(100 * KiB, &stream_a));
+  char* buf2 = static_cast<char*>(alloc.allocate(64 * KiB, &stream_a));
+  REQUIRE(raw.num_allocs == 1);
+  REQUIRE(buf1 == big);
+  REQUIRE(buf2 == big + 112 * KiB);
+  REQUIRE(alloc.allocated_bytes() == 176 * KiB);
+  REQUIRE(alloc.cached_bytes() == 80 * KiB);
+
+  // A partially used segment cannot be trimmed.
+  alloc.trim();
+  REQUIRE(alloc.reserved_bytes() == 256 * KiB);
+
+  // Another stream does not see the remainder.
+  void* other = alloc.allocate(64 * KiB, &stream_b);
+  REQUIRE(raw.num_allocs == 2);
+  alloc.deallocate(other);
+
+  alloc.deallocate(buf1);
+  alloc.deallocate(buf2);
+  REQUIRE(alloc.allocated_bytes() == 0);
+  // Coalesced back into one block.
+  REQUIRE(alloc.allocate(256 * KiB, &stream_a) == big);
+  REQUIRE(raw.num_allocs == 2);
+  alloc.deallocate(big);
+
+  alloc.trim();
+  REQUIRE(alloc.reserved_bytes() == 0);
+  REQUIRE(raw.num_frees == 2);
+}
+
+TEST_CASE("Size class allocator trims and retries when out of memory",
+          "[allocator][sizeclass]")
+{
+  RawCounter raw;
+  raw.limit = 128 * KiB;
+  auto alloc = raw.make_allocator();
+
+  void* buf = alloc.allocate(128 * KiB, &stream_a);
+  alloc.deallocate(buf);
+  REQUIRE(alloc.cached_bytes() == 128 * KiB);
+
+  // Cannot reuse the cached block on another stream, so it is freed.
+  void* buf2 = alloc.allocate(96 * KiB, &stream_b);
+  REQUIRE(buf2 != nullptr);
+  REQUIRE(raw.num_frees == 1);
+  REQUIRE(alloc.cached_bytes() == 0);
+
+  REQUIRE_THROWS_AS(alloc.allocate(64 * KiB, &stream_b), H2Exception);
+  alloc.deallocate(buf2);
+}
+
+TEST_CASE("Size class allocator rejects unknown pointers",
+          "[allocator][sizeclass]")
+{
+  RawCounter raw;
+  auto alloc = raw.make_allocator();
+  int x;
+  REQUIRE_THROWS(alloc.deallocate(&x));
+  REQUIRE_NOTHROW(alloc.deallocate(nullptr));
+}
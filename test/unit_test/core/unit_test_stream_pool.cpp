@@ -0,0 +1,63 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/stream_pool.hpp"
+
+#include <unordered_set>
+
+#include "../tensor/utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+TEMPLATE_LIST_TEST_CASE("Pool streams work", "[sync][stream_pool]", AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+
+  REQUIRE(get_stream_pool_size() > 0);
+
+  for (auto priority : {StreamPriority::Normal, StreamPriority::High})
+  {
+    ComputeStream stream = get_pool_stream<Dev>(priority);
+    REQUIRE(stream.get_device() == Dev);
+    REQUIRE(get_pool_stream(Dev, priority).get_device() == Dev);
+    // Indexing is modulo the pool size.
+    REQUIRE(get_pool_stream<Dev>(priority, 1)
+            == get_pool_stream<Dev>(priority, 1 + get_stream_pool_size()));
+    REQUIRE_NOTHROW(stream.wait_for(get_pool_stream<Dev>(priority)));
+  }
+}
+
+TEST_CASE("CPU pool streams are the default stream", "[sync][stream_pool]")
+{
+  REQUIRE(get_pool_stream<Device::CPU>() == ComputeStream{Device::CPU});
+  REQUIRE(get_pool_stream<Device::CPU>(StreamPriority::High, 3)
+          == ComputeStream{Device::CPU});
+}
+
+#ifdef H2_TEST_WITH_GPU
+
+TEST_CASE("GPU pool streams are distinct and reused", "[sync][stream_pool]")
+{
+  std::size_t const pool_size = get_stream_pool_size();
+  std::unordered_set<ComputeStream> normal_streams, high_streams;
+  for (std::size_t i = 0; i < 2 * pool_size; ++i)
+  {
+    normal_streams.insert(get_pool_stream<Device::GPU>());
+    high_streams.insert(get_pool_stream<Device::GPU>(StreamPriority::High));
+  }
+  REQUIRE(normal_streams.size() == pool_size);
+  REQUIRE(high_streams.size() == pool_size);
+  for (auto const& stream : normal_streams)
+  {
+    REQUIRE(high_streams.count(stream) == 0);
+    REQUIRE(stream != ComputeStream{Device::GPU});
+  }
+}
+
+#endif  // H2_TEST_WITH_GPU
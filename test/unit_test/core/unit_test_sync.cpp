@@ -9,7 +9,10 @@
 
 #include <El.hpp>
 
+#include <atomic>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "../tensor/utils.hpp"
 #include <catch2/catch_template_test_macros.hpp>
@@ -128,6 +131,15 @@ TEMPLATE_LIST_TEST_CASE("Sync helpers work", "[sync]", AllDevList)
   REQUIRE_NOTHROW(stream_wait_on_all(stream1, stream2, stream3, cpu_stream));
 }
 
+TEST_CASE("CPU streams have no GPU ordinal", "[sync]")
+{
+  ComputeStream stream{Device::CPU};
+  REQUIRE(stream.get_device_id() == -1);
+  ComputeStream async_stream = create_new_async_cpu_stream();
+  REQUIRE(async_stream.get_device_id() == -1);
+  destroy_compute_stream(async_stream);
+}
+
 TEST_CASE("Stream equality works", "[sync]")
 {
   ComputeStream stream1 = create_new_compute_stream<Device::CPU>();
@@ -175,6 +187,88 @@ TEST_CASE("CPU sync El::SyncInfo conversion works", "[sync]")
   }());
 }
 
+TEST_CASE("Asynchronous CPU streams run tasks in order", "[sync]")
+{
+  ComputeStream stream = create_new_async_cpu_stream();
+  REQUIRE(stream.get_device() == Device::CPU);
+  REQUIRE(stream != ComputeStream{Device::CPU});
+
+  std::vector<int> order;
+  std::atomic<bool> release{false};
+  enqueue_cpu_task(stream, [&]() {
+    while (!release.load())
+    {
+      std::this_thread::yield();
+    }
+    order.push_back(1);
+  });
+  enqueue_cpu_task(stream, [&]() { order.push_back(2); });
+  // The enqueue did not block on the first task.
+  release = true;
+  stream.wait_for_this();
+  REQUIRE(order == std::vector<int>{1, 2});
+
+  // Tasks on the default stream run immediately.
+  int ran = 0;
+  enqueue_cpu_task(ComputeStream{Device::CPU}, [&]() { ran = 1; });
+  REQUIRE(ran == 1);
+
+  destroy_compute_stream(stream);
+}
+
+TEST_CASE("Asynchronous CPU streams synchronize", "[sync]")
+{
+  ComputeStream stream1 = create_new_async_cpu_stream();
+  ComputeStream stream2 = create_new_async_cpu_stream();
+  SyncEvent event = create_new_async_cpu_event();
+  REQUIRE(event != SyncEvent{Device::CPU});
+
+  std::atomic<int> value{0};
+  std::atomic<bool> release{false};
+  enqueue_cpu_task(stream1, [&]() {
+    while (!release.load())
+    {
+      std::this_thread::yield();
+    }
+    value = 1;
+  });
+
+  SECTION("With events")
+  {
+    stream1.add_sync_point(event);
+    stream2.wait_for(event);
+  }
+  SECTION("With streams") { stream2.wait_for(stream1); }
+
+  int seen = -1;
+  enqueue_cpu_task(stream2, [&]() { seen = value.load(); });
+  release = true;
+  stream2.wait_for_this();
+  REQUIRE(seen == 1);
+
+  // The caller (on the default stream) can wait too.
+  enqueue_cpu_task(stream1, [&]() { value = 2; });
+  stream1.add_sync_point(event);
+  ComputeStream{Device::CPU}.wait_for(event);
+  REQUIRE(value == 2);
+
+  destroy_sync_event(event);
+  destroy_compute_stream(stream1);
+  destroy_compute_stream(stream2);
+}
+
+TEST_CASE("Asynchronous CPU stream errors are reported", "[sync]")
+{
+  ComputeStream stream = create_new_async_cpu_stream();
+  enqueue_cpu_task(stream, []() { throw H2Exception("task failed"); });
+  int ran = 0;
+  enqueue_cpu_task(stream, [&]() { ran = 1; });
+  REQUIRE_THROWS_AS(stream.wait_for_this(), H2Exception);
+  REQUIRE(ran == 1);
+  REQUIRE_NOTHROW(stream.wait_for_this());
+  destroy_compute_stream(stream);
+}
+
 #ifdef H2_TEST_WITH_GPU
 
 TEST_CASE("GPU stream equality works", "[sync]")
@@ -236,6 +330,24 @@ TEST_CASE("GPU sync El::SyncInfo conversion works", "[sync]")
   REQUIRE(sync_info.Stream() == stream.get_stream<Device::GPU>());
 }
 
+TEST_CASE("GPU El::SyncInfo round trips keep the event", "[sync]")
+{
+  El::SyncInfo<El::Device::GPU> sync_info =
+    El::CreateNewSyncInfo<Device::GPU>();
+  ComputeStream stream(sync_info);
+  ComputeStream stream_copy = stream;
+  auto const round_trip =
+    static_cast<El::SyncInfo<El::Device::GPU>>(stream_copy);
+  REQUIRE(round_trip.Stream() == sync_info.Stream());
+  REQUIRE(round_trip.Event() == sync_info.Event());
+
+  // Streams not from Hydrogen use the default event.
+  ComputeStream default_stream{Device::GPU};
+  REQUIRE(static_cast<El::SyncInfo<El::Device::GPU>>(default_stream).Event()
+          == internal::get_default_event<Device::GPU>());
+  El::DestroySyncInfo(sync_info);
+}
+
 TEST_CASE("GPU and CPU syncs interoperate", "[sync]")
 {
   ComputeStream gpu_stream{Device::GPU};
@@ -257,6 +369,12 @@ TEST_CASE("GPU and CPU syncs interoperate", "[sync]")
   REQUIRE_NOTHROW([&]() {
     auto multi_sync = create_multi_sync(gpu_stream, cpu_stream);
   }());
+
+  ComputeStream async_cpu_stream = create_new_async_cpu_stream();
+  REQUIRE_NOTHROW(async_cpu_stream.wait_for(gpu_stream));
+  REQUIRE_NOTHROW(gpu_stream.wait_for(async_cpu_stream));
+  REQUIRE_NOTHROW(async_cpu_stream.wait_for_this());
+  destroy_compute_stream(async_cpu_stream);
 }
 
 TEST_CASE("Moving GPU syncs clears handles", "[sync]")
@@ -276,6 +394,144 @@ TEST_CASE("Moving GPU syncs clears handles", "[sync]")
   REQUIRE(event.get_event<Device::GPU>() == nullptr);
 }
 
+TEST_CASE("GPU streams know their GPU", "[sync]")
+{
+  int const device = gpu::current_gpu();
+  ComputeStream default_stream{Device::GPU};
+  REQUIRE(default_stream.get_device_id() == device);
+  REQUIRE(ComputeStream(Device::GPU, device) == default_stream);
+
+  ComputeStream stream = create_new_compute_stream<Device::GPU>(device);
+  REQUIRE(stream.get_device_id() == device);
+  ComputeStream moved_stream = std::move(stream);
+  REQUIRE(moved_stream.get_device_id() == device);
+
+  // Streams on every GPU can wait on each other from this thread.
+  std::vector<ComputeStream> streams;
+  for (int i = 0; i < gpu::num_gpus(); ++i)
+  {
+    streams.push_back(create_new_compute_stream(Device::GPU, i));
+    REQUIRE(streams.back().get_device_id() == i);
+  }
+  for (auto const& s : streams)
+  {
+    REQUIRE_NOTHROW(moved_stream.wait_for(s));
+    REQUIRE_NOTHROW(s.wait_for(moved_stream));
+  }
+  REQUIRE(gpu::current_gpu() == device);
+  for (auto& s : streams)
+  {
+    destroy_compute_stream(s);
+  }
+  destroy_compute_stream(moved_stream);
+  REQUIRE(gpu::current_gpu() == device);
+}
+
+TEST_CASE("GPU events are recycled", "[sync]")
+{
+  h2::gpu::clear_event_pools();
+  REQUIRE(h2::gpu::num_pooled_events() == 0);
+
+  SyncEvent event = create_new_sync_event<Device::GPU>();
+  auto raw_event = event.get_event<Device::GPU>();
+  destroy_sync_event(event);
+  REQUIRE(h2::gpu::num_pooled_events() == 1);
+
+  SyncEvent event2 = create_new_sync_event<Device::GPU>();
+  REQUIRE(event2.get_event<Device::GPU>() == raw_event);
+  REQUIRE(h2::gpu::num_pooled_events() == 0);
+  destroy_sync_event(event2);
+
+  // Cross-stream waits return their events to the pool.
+  ComputeStream stream1 = create_new_compute_stream<Device::GPU>();
+  ComputeStream stream2 = create_new_compute_stream<Device::GPU>();
+  REQUIRE_NOTHROW([&]() {
+    auto multi_sync = create_multi_sync(stream1, stream2);
+  }());
+  REQUIRE(h2::gpu::num_pooled_events() == 1);
+  destroy_compute_stream(stream1);
+  destroy_compute_stream(stream2);
+}
+
+TEST_CASE("Redundant GPU stream waits are skipped", "[sync]")
+{
+  ComputeStream stream1 = create_new_compute_stream<Device::GPU>();
+  ComputeStream stream2 = create_new_compute_stream<Device::GPU>();
+  auto tracker1 =
+    internal::find_stream_tracker(stream1.get_stream<Device::GPU>());
+  auto tracker2 =
+    internal::find_stream_tracker(stream2.get_stream<Device::GPU>());
+  REQUIRE(tracker1 != nullptr);
+  REQUIRE(tracker2 != nullptr);
+  REQUIRE(tracker1 != tracker2);
+
+  REQUIRE_FALSE(internal::stream_wait_is_satisfied(
+    tracker1, tracker2, tracker2->epoch.load()));
+  stream1.wait_for(stream2);
+  REQUIRE(internal::stream_wait_is_satisfied(
+    tracker1, tracker2, tracker2->epoch.load()));
+  // Waiting is not symmetric.
+  REQUIRE_FALSE(internal::stream_wait_is_satisfied(
+    tracker2, tracker1, tracker1->epoch.load()));
+
+  // Accessing the raw stream may submit work, so waits are needed.
+  (void) stream2.get_stream<Device::GPU>();
+  REQUIRE_FALSE(internal::stream_wait_is_satisfied(
+    tracker1, tracker2, tracker2->epoch.load()));
+  stream1.wait_for(stream2);
+  REQUIRE(internal::stream_wait_is_satisfied(
+    tracker1, tracker2, tracker2->epoch.load()));
+
+  // Streams H2 did not create are not tracked.
+  ComputeStream default_stream{Device::GPU};
+  REQUIRE(internal::find_stream_tracker(
+            default_stream.get_stream<Device::GPU>())
+          == nullptr);
+
+  destroy_compute_stream(stream1);
+  destroy_compute_stream(stream2);
+}
+
+TEST_CASE("Threads may have their own default GPU streams", "[sync]")
+{
+  ComputeStream const default_stream{Device::GPU};
+  ComputeStream stream1 = create_new_compute_stream<Device::GPU>();
+  ComputeStream stream2 = create_new_compute_stream<Device::GPU>();
+  {
+    ThreadDefaultStreamGuard const guard1(stream1);
+    REQUIRE(ComputeStream{Device::GPU} == stream1);
+    {
+      ThreadDefaultStreamGuard const guard2(stream2);
+      REQUIRE(ComputeStream{Device::GPU} == stream2);
+    }
+    REQUIRE(ComputeStream{Device::GPU} == stream1);
+
+    // Other threads keep the process-wide default.
+    bool other_uses_default = false;
+    std::thread t([&]() {
+      gpu::set_gpu(stream1.get_device_id());
+      other_uses_default = (ComputeStream{Device::GPU} == default_stream);
+    });
+    t.join();
+    REQUIRE(other_uses_default);
+
+    // Streams from the thread default keep its work tracking.
+    ComputeStream const thread_stream{Device::GPU};
+    auto tracker1 =
+      internal::find_stream_tracker(stream1.get_stream<Device::GPU>());
+    auto tracker2 =
+      internal::find_stream_tracker(stream2.get_stream<Device::GPU>());
+    stream2.wait_for(thread_stream);
+    REQUIRE(internal::stream_wait_is_satisfied(
+      tracker2, tracker1, tracker1->epoch.load()));
+  }
+  REQUIRE(ComputeStream{Device::GPU} == default_stream);
+  REQUIRE_THROWS(ThreadDefaultStreamGuard(ComputeStream{Device::CPU}));
+
+  destroy_compute_stream(stream1);
+  destroy_compute_stream(stream2);
+}
+
 #endif  // H2_TEST_WITH_GPU
 
 TEMPLATE_LIST_TEST_CASE("MultiSyncs are sane", "[sync]", AllDevPairsList)
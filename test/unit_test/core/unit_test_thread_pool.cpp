@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/core/sync.hpp"
+#include "h2/core/thread_pool.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+TEST_CASE("parallel_for runs every block once", "[thread_pool]")
+{
+  REQUIRE(cpu::get_num_threads() > 0);
+  REQUIRE_FALSE(cpu::in_thread_pool());
+
+  for (std::size_t num_blocks : {0, 1, 2, 7, 1000})
+  {
+    std::vector<std::atomic<int>> counts(num_blocks);
+    cpu::parallel_for(num_blocks, [&](std::size_t block) {
+      counts[block].fetch_add(1);
+    });
+    for (std::size_t i = 0; i < num_blocks; ++i)
+    {
+      REQUIRE(counts[i].load() == 1);
+    }
+  }
+}
+
+TEST_CASE("parallel_for may be nested", "[thread_pool]")
+{
+  constexpr std::size_t outer = 16;
+  constexpr std::size_t inner = 64;
+  std::vector<std::atomic<int>> counts(outer * inner);
+  cpu::parallel_for(outer, [&](std::size_t i) {
+    cpu::parallel_for(inner, [&](std::size_t j) {
+      counts[i * inner + j].fetch_add(1);
+    });
+  });
+  for (auto const& count : counts)
+  {
+    REQUIRE(count.load() == 1);
+  }
+}
+
+TEST_CASE("parallel_for rethrows exceptions", "[thread_pool]")
+{
+  std::atomic<int> num_run{0};
+  REQUIRE_THROWS_AS(cpu::parallel_for(100,
+                                      [&](std::size_t block) {
+                                        num_run.fetch_add(1);
+                                        if (block == 42)
+                                        {
+                                          throw std::runtime_error("42");
+                                        }
+                                      }),
+                    std::runtime_error);
+  // Remaining blocks still run.
+  REQUIRE(num_run.load() == 100);
+}
+
+TEST_CASE("Concurrent CPU streams share the thread pool",
+          "[thread_pool][sync]")
+{
+  constexpr std::size_t num_streams = 4;
+  constexpr std::size_t num_blocks = 256;
+  std::vector<ComputeStream> streams;
+  std::vector<std::atomic<int>> counts(num_streams * num_blocks);
+  for (std::size_t s = 0; s < num_streams; ++s)
+  {
+    streams.push_back(create_new_async_cpu_stream());
+    enqueue_cpu_task(streams.back(), [&counts, s]() {
+      cpu::parallel_for(num_blocks, [&counts, s](std::size_t block) {
+        counts[s * num_blocks + block].fetch_add(1);
+      });
+    });
+  }
+  for (auto& stream : streams)
+  {
+    stream.wait_for_this();
+    destroy_compute_stream(stream);
+  }
+  for (auto const& count : counts)
+  {
+    REQUIRE(count.load() == 1);
+  }
+}
@@ -0,0 +1,179 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include <h2_config.hpp>
+
+#include "h2/core/tracer.hpp"
+#include "h2/utils/Logger.hpp"
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+// These call the internal interface directly, since tracing is
+// usually not enabled when testing. Each test records on its own
+// thread, so it has a fresh buffer.
+
+namespace
+{
+
+std::string get_trace()
+{
+  std::ostringstream ss;
+  write_trace(ss);
+  return ss.str();
+}
+
+bool has(std::string const& str, std::string const& sub)
+{
+  return str.find(sub) != std::string::npos;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("Trace records are written as Chrome trace JSON", "[tracer]")
+{
+  std::string trace1, trace2, trace3;
+  bool distinct = false;
+  std::thread([&]() {
+    ComputeStream stream{Device::CPU};
+    auto* outer = internal::trace_begin(
+      "test_trace_outer", ProfileCategory::Copy, stream, 64);
+    auto* inner = internal::trace_begin(
+      "test_trace_\"inner\"", ProfileCategory::Compute, stream, 8);
+    distinct = outer != nullptr && inner != nullptr && inner != outer;
+    internal::trace_end(inner, stream);
+    // The outer record is not done, so nothing is written yet.
+    trace1 = get_trace();
+    internal::trace_end(outer, stream);
+    trace2 = get_trace();
+    // Records are only written once.
+    trace3 = get_trace();
+  }).join();
+
+  REQUIRE(distinct);
+  REQUIRE(has(trace1, "{\"traceEvents\":["));
+  REQUIRE_FALSE(has(trace1, "test_trace_"));
+
+  REQUIRE(has(trace2, "\"name\":\"test_trace_outer\",\"cat\":\"copy\""));
+  REQUIRE(has(trace2, "\"name\":\"test_trace_\\\"inner\\\"\""));
+  REQUIRE(has(trace2, "\"bytes\":64"));
+  REQUIRE(has(trace2, "\"ph\":\"X\""));
+  REQUIRE(has(trace2, "thread_name"));
+  REQUIRE(has(trace2, "\"dropped_records\":"));
+  // Outer starts first, so it is written first.
+  REQUIRE(trace2.find("test_trace_outer") < trace2.find("test_trace_\\\""));
+
+  REQUIRE_FALSE(has(trace3, "test_trace_"));
+}
+
+TEST_CASE("Trace records are dropped when buffers are full", "[tracer]")
+{
+  std::size_t const capacity = internal::get_trace_buffer_size();
+  std::size_t const dropped = get_num_dropped_trace_records();
+  std::size_t num_recorded = 0;
+  bool dropped_when_full = false;
+  bool recorded_after_write = false;
+  std::thread([&]() {
+    ComputeStream stream{Device::CPU};
+    for (std::size_t i = 0; i < capacity + 1; ++i)
+    {
+      auto* record = internal::trace_begin(
+        "test_trace_fill", ProfileCategory::Memory, stream, 0);
+      if (record != nullptr)
+      {
+        internal::trace_end(record, stream);
+        ++num_recorded;
+      }
+    }
+    dropped_when_full = get_num_dropped_trace_records() == dropped + 1;
+
+    // Writing the trace frees the buffer.
+    get_trace();
+    auto* record = internal::trace_begin(
+      "test_trace_fill", ProfileCategory::Memory, stream, 0);
+    recorded_after_write = record != nullptr;
+    if (record != nullptr)
+    {
+      internal::trace_end(record, stream);
+    }
+    get_trace();
+  }).join();
+
+  REQUIRE(num_recorded == capacity);
+  REQUIRE(dropped_when_full);
+  REQUIRE(recorded_after_write);
+}
+
+TEST_CASE("Trace scopes record only when tracing is enabled", "[tracer]")
+{
+  ComputeStream stream{Device::CPU};
+  {
+    H2_TRACE_SCOPE("test_trace_scope", Copy, stream, 1);
+    TraceScope scope("test_trace_scope", ProfileCategory::Comm, stream);
+  }
+  REQUIRE(has(get_trace(), "test_trace_scope") == tracing_enabled());
+}
+
+TEST_CASE("Roofline statistics are gathered from written records",
+          "[tracer]")
+{
+  enable_roofline_stats();
+  clear_roofline_stats();
+  std::string trace;
+  std::thread([&]() {
+    ComputeStream stream{Device::CPU};
+    for (int i = 0; i < 2; ++i)
+    {
+      auto* record = internal::trace_begin(
+        "test_roofline_op", ProfileCategory::Compute, stream, 100, 10);
+      internal::trace_end(record, stream);
+    }
+    auto* record = internal::trace_begin(
+      "test_roofline_other", ProfileCategory::Copy, stream, 8);
+    internal::trace_end(record, stream);
+    trace = get_trace();
+  }).join();
+
+  REQUIRE(has(trace, "\"flops\":10"));
+
+  auto const stats = get_roofline_stats();
+  REQUIRE(stats.size() == 2);
+  auto op = stats[0].name == "test_roofline_op" ? stats[0] : stats[1];
+  REQUIRE(op.name == "test_roofline_op");
+  REQUIRE(op.device == Device::CPU);
+  REQUIRE(op.num_calls == 2);
+  REQUIRE(op.bytes == 200);
+  REQUIRE(op.flops == 20);
+  REQUIRE(op.time >= 0.0);
+  REQUIRE(op.arithmetic_intensity() == 0.1);
+  REQUIRE(op.fraction_of_peak() == 0.0);
+  REQUIRE(stats[0].time >= stats[1].time);
+
+  std::ostringstream ss;
+  write_roofline_report(ss);
+  REQUIRE(has(ss.str(), "test_roofline_op"));
+  REQUIRE(has(ss.str(), "test_roofline_other"));
+
+  clear_roofline_stats();
+  REQUIRE(get_roofline_stats().empty());
+}
+
+TEST_CASE("Rank patterns are expanded", "[tracer][logging]")
+{
+  REQUIRE(expand_rank_pattern("trace.json") == "trace.json");
+  REQUIRE(expand_rank_pattern("100%%") == "100%");
+  REQUIRE(expand_rank_pattern("%q") == "%q");
+  std::string const rank = expand_rank_pattern("%w");
+  REQUIRE_FALSE(rank.empty());
+  REQUIRE(expand_rank_pattern("t.%w.json") == "t." + rank + ".json");
+  REQUIRE_FALSE(expand_rank_pattern("%h").empty());
+}
@@ -63,3 +63,42 @@ TEST_CASE("Runtime type info works for any type", "[types]")
     REQUIRE(*tinfo.get_type_info() == typeid(TestStruct));
   }
 }
+
+TEST_CASE("Compute type tokens do not depend on low-precision types",
+          "[types]")
+{
+  REQUIRE(get_h2_type<float>().get_token() == 0);
+  REQUIRE(get_h2_type<double>().get_token() == 1);
+  REQUIRE(get_h2_type<std::int32_t>().get_token() == 2);
+  REQUIRE(get_h2_type<std::uint32_t>().get_token() == 3);
+  REQUIRE(NumComputeTypes
+          == 4 + meta::tlist::Length<LowPrecisionFloatTypes>);
+  static_assert(!IsLowPrecisionFloat_v<float>);
+  static_assert(!IsLowPrecisionFloat_v<std::int32_t>);
+}
+
+TEST_CASE("Converting compute types works", "[types]")
+{
+  REQUIRE(convert_compute_type<std::int32_t>(2.5f) == 2);
+  REQUIRE(convert_compute_type<double>(3) == 3.0);
+  REQUIRE(convert_compute_type<float>(4.0f) == 4.0f);
+  static_assert(IsComputeConvertible_v<float, std::uint32_t>);
+  static_assert(!IsComputeConvertible_v<float, TestStruct>);
+
+#if H2_HAS_GPU_LOW_PRECISION
+  static_assert(IsH2ComputeType_v<gpu::Half>);
+  static_assert(IsH2ComputeType_v<gpu::BFloat16>);
+  static_assert(IsComputeConvertible_v<gpu::Half, gpu::BFloat16>);
+  REQUIRE(get_h2_type<gpu::Half>().get_token() == 4);
+  REQUIRE(get_h2_type<gpu::BFloat16>().get_token() == 5);
+  REQUIRE(convert_compute_type<float>(convert_compute_type<gpu::Half>(1.5f))
+          == 1.5f);
+  REQUIRE(convert_compute_type<float>(
+            convert_compute_type<gpu::BFloat16>(
+              convert_compute_type<gpu::Half>(-2.0f)))
+          == -2.0f);
+  REQUIRE(convert_compute_type<std::int32_t>(
+            convert_compute_type<gpu::BFloat16>(7))
+          == 7);
+#endif
+}
@@ -15,6 +15,15 @@ __global__ void test_kernel(int* buf, int val)
   *buf = val;
 }
 
+__global__ void test_grid_stride_kernel(int* buf, unsigned int size, int val)
+{
+  for (unsigned int i = blockIdx.x * blockDim.x + threadIdx.x; i < size;
+       i += gridDim.x * blockDim.x)
+  {
+    buf[i] = val;
+  }
+}
+
 }  // namespace
 
 void unit_test_gpu_launch_kernel_test(int* buf,
@@ -23,3 +32,29 @@ void unit_test_gpu_launch_kernel_test(int* buf,
 {
   h2::gpu::launch_kernel(test_kernel, 1, 1, 0, stream, buf, val);
 }
+
+void unit_test_gpu_launch_occupancy_kernel_test(
+  int* buf, unsigned int size, int val, h2::gpu::DeviceStream const& stream)
+{
+  unsigned int const block_size = 256;
+  h2::gpu::launch_occupancy_kernel(test_grid_stride_kernel,
+                                   (size + block_size - 1) / block_size,
+                                   block_size,
+                                   0,
+                                   stream,
+                                   buf,
+                                   size,
+                                   val);
+}
+
+unsigned int unit_test_gpu_max_resident_blocks(unsigned int block_size)
+{
+  return h2::gpu::max_resident_blocks(test_grid_stride_kernel, block_size);
+}
+
+unsigned int unit_test_gpu_occupancy_num_blocks(std::size_t num_work_blocks,
+                                                unsigned int block_size)
+{
+  return h2::gpu::occupancy_num_blocks(
+    test_grid_stride_kernel, num_work_blocks, block_size);
+}
@@ -0,0 +1,116 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/gpu/jit.hpp"
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/gpu/runtime.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using namespace h2;
+
+TEST_CASE("JIT type names and sizes", "[gpu][jit]")
+{
+  REQUIRE(std::string(gpu::jit_type_name<float>()) == "float");
+  REQUIRE(std::string(gpu::jit_type_name<std::int32_t const>()) == "int32_t");
+  REQUIRE(gpu::jit_type_size("double") == sizeof(double));
+  REQUIRE(gpu::jit_type_size("uint8_t") == 1);
+  REQUIRE_THROWS(gpu::jit_type_size("std::string"));
+}
+
+TEST_CASE("JIT element-wise source generation", "[gpu][jit]")
+{
+  gpu::JitElementwiseOp op{
+    "axpb", "float", {"float", "float"}, "return 2.0f * in0 + in1;"};
+  std::string const source = gpu::make_jit_elementwise_source(op);
+  for (std::size_t w : gpu::jit_vec_widths)
+  {
+    REQUIRE(source.find("h2_jit_axpb_vec" + std::to_string(w))
+            != std::string::npos);
+  }
+  REQUIRE(source.find(op.body) != std::string::npos);
+
+  gpu::JitElementwiseOp bad_name = op;
+  bad_name.name = "not an identifier";
+  REQUIRE_THROWS(gpu::make_jit_elementwise_source(bad_name));
+  gpu::JitElementwiseOp bad_type = op;
+  bad_type.in_types[1] = "foo";
+  REQUIRE_THROWS(gpu::make_jit_elementwise_source(bad_type));
+}
+
+TEST_CASE("JIT element-wise vector width", "[gpu][jit]")
+{
+  alignas(64) float buf[32];
+  REQUIRE(gpu::get_jit_vec_width({buf, buf + 4}, {4, 4}) == 4);
+  REQUIRE(gpu::get_jit_vec_width({buf, buf + 2}, {4, 4}) == 2);
+  REQUIRE(gpu::get_jit_vec_width({buf, buf + 1}, {4, 4}) == 1);
+}
+
+TEST_CASE("JIT element-wise kernels compute results", "[gpu][jit]")
+{
+  gpu::JitElementwiseOp op{
+    "axpb", "float", {"float", "float"}, "return 2.0f * in0 + in1;"};
+  gpu::JitElementwiseKernel const& kernel =
+    gpu::get_jit_elementwise_kernel(op);
+  REQUIRE(&gpu::get_jit_elementwise_kernel(op) == &kernel);
+  REQUIRE(kernel.get_op().name == "axpb");
+
+  gpu::DeviceStream const stream = gpu::make_stream();
+  // Odd sizes and offsets exercise every vector width and the remainder.
+  constexpr std::size_t size = 1031;
+  for (std::size_t offset : {0, 1, 2})
+  {
+    std::vector<float> x(size + offset), y(size + offset);
+    for (std::size_t i = 0; i < x.size(); ++i)
+    {
+      x[i] = static_cast<float>(i);
+      y[i] = 1.0f;
+    }
+    std::size_t const bytes = (size + offset) * sizeof(float);
+    float* const dx =
+      static_cast<float*>(gpu::memory_pool().allocate(bytes, stream));
+    float* const dy =
+      static_cast<float*>(gpu::memory_pool().allocate(bytes, stream));
+    float* const dout =
+      static_cast<float*>(gpu::memory_pool().allocate(bytes, stream));
+    gpu::mem_copy(dx, x.data(), x.size(), stream);
+    gpu::mem_copy(dy, y.data(), y.size(), stream);
+    kernel(stream,
+           size,
+           dout + offset,
+           static_cast<float const*>(dx + offset),
+           static_cast<float const*>(dy + offset));
+    std::vector<float> out(size);
+    gpu::mem_copy(out.data(), dout + offset, size, stream);
+    gpu::sync(stream);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      REQUIRE(out[i] == 2.0f * x[i + offset] + 1.0f);
+    }
+    gpu::memory_pool().deallocate(dx, stream);
+    gpu::memory_pool().deallocate(dy, stream);
+    gpu::memory_pool().deallocate(dout, stream);
+  }
+
+  // Mismatched buffer types are rejected.
+  REQUIRE_THROWS(kernel(stream,
+                        size,
+                        static_cast<double*>(nullptr),
+                        static_cast<float const*>(nullptr),
+                        static_cast<float const*>(nullptr)));
+  gpu::destroy(stream);
+}
+
+TEST_CASE("JIT compilation errors are reported", "[gpu][jit]")
+{
+  gpu::JitElementwiseOp op{
+    "broken", "float", {"float"}, "return in0 + undefined_variable;"};
+  REQUIRE_THROWS(gpu::get_jit_elementwise_kernel(op));
+}
@@ -15,6 +15,11 @@ using namespace h2;
 
 extern void
 unit_test_gpu_launch_kernel_test(int*, int, h2::gpu::DeviceStream const&);
+extern void unit_test_gpu_launch_occupancy_kernel_test(
+  int*, unsigned int, int, h2::gpu::DeviceStream const&);
+extern unsigned int unit_test_gpu_max_resident_blocks(unsigned int);
+extern unsigned int unit_test_gpu_occupancy_num_blocks(std::size_t,
+                                                       unsigned int);
 
 TEST_CASE("Kernels successfully launch", "[gpu]")
 {
@@ -25,3 +30,31 @@ TEST_CASE("Kernels successfully launch", "[gpu]")
     buf.buf, 42, stream.get_stream<Device::GPU>());
   REQUIRE(read_ele<Device::GPU>(buf.buf, stream) == 42);
 }
+
+TEST_CASE("Occupancy-based grid sizes are bounded", "[gpu]")
+{
+  unsigned int const max_blocks = unit_test_gpu_max_resident_blocks(256);
+  REQUIRE(max_blocks >= 1);
+  // The result is cached, so this must be the same.
+  REQUIRE(unit_test_gpu_max_resident_blocks(256) == max_blocks);
+
+  REQUIRE(unit_test_gpu_occupancy_num_blocks(0, 256) == 1);
+  REQUIRE(unit_test_gpu_occupancy_num_blocks(1, 256) == 1);
+  REQUIRE(unit_test_gpu_occupancy_num_blocks(max_blocks, 256) == max_blocks);
+  REQUIRE(unit_test_gpu_occupancy_num_blocks(std::size_t{max_blocks} * 4, 256)
+          == max_blocks);
+}
+
+TEST_CASE("Occupancy-based kernels cover all work", "[gpu]")
+{
+  auto stream = ComputeStream{Device::GPU};
+  // Enough work that each block loops several times.
+  unsigned int const size = unit_test_gpu_max_resident_blocks(256) * 256 * 4;
+  DeviceBuf<int, Device::GPU> buf(size);
+  write_ele<Device::GPU>(buf.buf, 0, 0, stream);
+  write_ele<Device::GPU>(buf.buf, size - 1, 0, stream);
+  unit_test_gpu_launch_occupancy_kernel_test(
+    buf.buf, size, 42, stream.get_stream<Device::GPU>());
+  REQUIRE(read_ele<Device::GPU>(buf.buf, stream) == 42);
+  REQUIRE(read_ele<Device::GPU>(buf.buf, size - 1, stream) == 42);
+}
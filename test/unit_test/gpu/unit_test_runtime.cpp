@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/gpu/runtime.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+TEST_CASE("GPU runtime activation is idempotent", "[gpu]")
+{
+  REQUIRE(gpu::runtime_is_initialized());
+  REQUIRE_NOTHROW(gpu::ensure_runtime_active());
+  int const gpu_id = gpu::current_gpu();
+  REQUIRE_NOTHROW(gpu::ensure_runtime_active());
+  REQUIRE(gpu::current_gpu() == gpu_id);
+
+  // Using the memory pool or creating a stream activates lazy runtimes.
+  gpu::DeviceStream const stream = gpu::make_stream();
+  void* const ptr = gpu::memory_pool().allocate(64, stream);
+  gpu::memory_pool().deallocate(ptr, stream);
+  gpu::sync(stream);
+  gpu::destroy(stream);
+
+  gpu::RuntimeInitTimes const times = gpu::get_runtime_init_times();
+  REQUIRE(times.select_gpu >= 0.0);
+  REQUIRE(times.create_context >= 0.0);
+  REQUIRE(times.reserve_pool >= 0.0);
+}
+
+TEST_CASE("GPU device properties are cached", "[gpu]")
+{
+  gpu::DeviceProperties const& props = gpu::device_properties();
+  REQUIRE(&gpu::device_properties(gpu::current_gpu()) == &props);
+  REQUIRE_FALSE(props.name.empty());
+  REQUIRE(props.name == gpu::device_name());
+  REQUIRE(props.num_sms > 0);
+  REQUIRE(props.num_sms == gpu::num_sms());
+  REQUIRE(props.warp_size == static_cast<int>(gpu::warp_size));
+  REQUIRE(props.shared_mem_per_block > 0);
+  REQUIRE(props.total_mem > 0);
+  REQUIRE(props.peak_bandwidth >= 0.0);
+  REQUIRE_THROWS(gpu::device_properties(gpu::num_gpus()));
+}
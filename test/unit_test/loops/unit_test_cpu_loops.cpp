@@ -6,6 +6,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "h2/loops/cpu_loops.hpp"
+#include "h2/loops/fused_ops.hpp"
 
 #include "../tensor/utils.hpp"
 #include <catch2/catch_template_test_macros.hpp>
@@ -109,3 +110,237 @@ TEMPLATE_LIST_TEST_CASE("CPU elementwise loop works",
     }
   }
 }
+
+TEMPLATE_LIST_TEST_CASE("CPU parallel elementwise loop works",
+                        "[loops]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  SECTION("Empty buffer")
+  {
+    Type* empty_buf = nullptr;
+    cpu::parallel_elementwise_loop([](Type) {}, 0, empty_buf);
+    cpu::parallel_elementwise_loop(
+      []() -> Type { return static_cast<Type>(42); }, 0, empty_buf);
+  }
+
+  SECTION("Buffers smaller and larger than the grain size")
+  {
+    std::size_t const grain_size = cpu::get_parallel_loop_grain_size();
+    for (std::size_t size : {grain_size / 2, 4 * grain_size + 3})
+    {
+      DeviceBuf<Type, Device::CPU> in_buf{size}, out_buf{size};
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        in_buf.buf[i] = static_cast<Type>(i % 100);
+      }
+      out_buf.fill(static_cast<Type>(0));
+      cpu::parallel_elementwise_loop([](Type v) -> Type { return v + 1; },
+                                     out_buf.size,
+                                     out_buf.buf,
+                                     static_cast<Type const*>(in_buf.buf));
+      bool ok = true;
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        ok = ok && out_buf.buf[i] == static_cast<Type>(i % 100 + 1);
+      }
+      REQUIRE(ok);
+    }
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("CPU vectorized elementwise loop works",
+                        "[loops]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+  constexpr std::size_t lanes = cpu::vector_lanes_v<Type>;
+
+  SECTION("Empty buffer")
+  {
+    Type* empty_buf = nullptr;
+    cpu::vectorized_elementwise_loop([](Type) {}, 0, empty_buf);
+    cpu::vectorized_elementwise_loop(
+      []() -> Type { return static_cast<Type>(42); }, 0, empty_buf);
+  }
+
+  SECTION("Unaligned buffers with remainders")
+  {
+    DeviceBuf<Type, Device::CPU> in_buf{4 * lanes + 8}, out_buf{4 * lanes + 8};
+    for (std::size_t i = 0; i < in_buf.size; ++i)
+    {
+      in_buf.buf[i] = static_cast<Type>(i);
+    }
+    for (std::size_t offset : {std::size_t{0}, std::size_t{1}, std::size_t{3}})
+    {
+      for (std::size_t size : {lanes - 1, lanes, 3 * lanes + 1})
+      {
+        out_buf.fill(static_cast<Type>(0));
+        cpu::vectorized_elementwise_loop(
+          [](Type a, Type b) -> Type { return a + b; },
+          size,
+          out_buf.buf + offset,
+          static_cast<Type const*>(in_buf.buf + offset),
+          static_cast<Type const*>(in_buf.buf + offset));
+        for (std::size_t i = 0; i < out_buf.size; ++i)
+        {
+          Type const expected = (i >= offset && i < offset + size)
+                                  ? static_cast<Type>(2 * i)
+                                  : static_cast<Type>(0);
+          REQUIRE(out_buf.buf[i] == expected);
+        }
+      }
+    }
+  }
+
+  SECTION("In-place")
+  {
+    DeviceBuf<Type, Device::CPU> buf{2 * lanes + 3};
+    buf.fill(static_cast<Type>(1));
+    cpu::vectorized_elementwise_loop(
+      [](Type v) -> Type { return v + 1; },
+      buf.size,
+      buf.buf,
+      static_cast<Type const*>(buf.buf));
+    for (std::size_t i = 0; i < buf.size; ++i)
+    {
+      REQUIRE(buf.buf[i] == static_cast<Type>(2));
+    }
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("CPU strided elementwise loop works",
+                        "[loops]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  SECTION("Contiguous dimensions are collapsed")
+  {
+    auto layout = make_strided_loop_layout<2>(
+      {4, 1, 6}, {StrideTuple{1, 4, 4}, StrideTuple{1, 4, 4}});
+    REQUIRE(layout.ndim == 1);
+    REQUIRE(layout.shape[0] == 24);
+    REQUIRE(layout.is_contiguous());
+
+    auto strided_layout = make_strided_loop_layout<2>(
+      {4, 6}, {StrideTuple{1, 4}, StrideTuple{1, 8}});
+    REQUIRE(strided_layout.ndim == 2);
+    REQUIRE_FALSE(strided_layout.is_contiguous());
+  }
+
+  SECTION("Strided buffers")
+  {
+    // Output is contiguous 4x3, input is every other column of 4x6.
+    DeviceBuf<Type, Device::CPU> in_buf{24}, out_buf{12};
+    for (std::size_t i = 0; i < in_buf.size; ++i)
+    {
+      in_buf.buf[i] = static_cast<Type>(i);
+    }
+    out_buf.fill(static_cast<Type>(0));
+    cpu::strided_elementwise_loop([](Type v) -> Type { return v + 1; },
+                                  ShapeTuple{4, 3},
+                                  {StrideTuple{1, 4}, StrideTuple{1, 8}},
+                                  out_buf.buf,
+                                  static_cast<Type const*>(in_buf.buf));
+    for (std::size_t j = 0; j < 3; ++j)
+    {
+      for (std::size_t i = 0; i < 4; ++i)
+      {
+        REQUIRE(out_buf.buf[i + 4 * j] == static_cast<Type>(i + 8 * j + 1));
+      }
+    }
+  }
+
+  SECTION("Broadcasting")
+  {
+    // Add a length-4 column to every column of a 4x3 buffer.
+    DeviceBuf<Type, Device::CPU> col_buf{4}, in_buf{12}, out_buf{12};
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      col_buf.buf[i] = static_cast<Type>(i);
+    }
+    in_buf.fill(static_cast<Type>(10));
+    cpu::strided_elementwise_loop(
+      [](Type a, Type b) -> Type { return a + b; },
+      ShapeTuple{4, 3},
+      {StrideTuple{1, 4}, StrideTuple{1, 4}, StrideTuple{1, 0}},
+      out_buf.buf,
+      static_cast<Type const*>(in_buf.buf),
+      static_cast<Type const*>(col_buf.buf));
+    for (std::size_t i = 0; i < out_buf.size; ++i)
+    {
+      REQUIRE(out_buf.buf[i] == static_cast<Type>(10 + i % 4));
+    }
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Fused elementwise functions work",
+                        "[loops]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  auto to_double = [](Type v) -> double { return static_cast<double>(v); };
+  auto scale = [](double v) -> double { return 2.0 * v; };
+  auto clamp = [](double v) -> Type {
+    return static_cast<Type>(v > 10.0 ? 10.0 : v);
+  };
+
+  SECTION("Traits of fused functions")
+  {
+    using Traits = FunctionTraits<decltype(fuse(to_double, scale, clamp))>;
+    STATIC_REQUIRE(Traits::arity == 1);
+    STATIC_REQUIRE(Traits::has_return);
+    STATIC_REQUIRE(std::is_same_v<typename Traits::RetT, Type>);
+    STATIC_REQUIRE(
+      std::is_same_v<typename Traits::ArgsList, meta::TL<Type>>);
+
+    auto add = [](Type a, Type b) -> Type { return a + b; };
+    auto discard = [](double) {};
+    using FusedAddT = decltype(fuse(add, to_double, discard));
+    STATIC_REQUIRE(FunctionTraits<FusedAddT>::arity == 2);
+    STATIC_REQUIRE_FALSE(FunctionTraits<FusedAddT>::has_return);
+  }
+
+  SECTION("Chains run in one loop")
+  {
+    DeviceBuf<Type, Device::CPU> in_buf{37}, out_buf{37};
+    for (std::size_t i = 0; i < in_buf.size; ++i)
+    {
+      in_buf.buf[i] = static_cast<Type>(i % 8);
+    }
+    out_buf.fill(static_cast<Type>(0));
+    cpu::vectorized_elementwise_loop(fuse(to_double, scale, clamp),
+                                     in_buf.size,
+                                     out_buf.buf,
+                                     static_cast<Type const*>(in_buf.buf));
+    for (std::size_t i = 0; i < out_buf.size; ++i)
+    {
+      Type const expected =
+        static_cast<Type>(2 * (i % 8) > 10 ? 10 : 2 * (i % 8));
+      REQUIRE(out_buf.buf[i] == expected);
+    }
+  }
+
+  SECTION("Multiple inputs and captures")
+  {
+    DeviceBuf<Type, Device::CPU> a_buf{19}, b_buf{19}, out_buf{19};
+    a_buf.fill(static_cast<Type>(1));
+    b_buf.fill(static_cast<Type>(2));
+    out_buf.fill(static_cast<Type>(0));
+    Type const offset = static_cast<Type>(3);
+    cpu::parallel_elementwise_loop(
+      fuse([](Type a, Type b) -> Type { return a + b; },
+           [offset](Type v) -> Type { return v + offset; }),
+      out_buf.size,
+      out_buf.buf,
+      static_cast<Type const*>(a_buf.buf),
+      static_cast<Type const*>(b_buf.buf));
+    for (std::size_t i = 0; i < out_buf.size; ++i)
+    {
+      REQUIRE(out_buf.buf[i] == static_cast<Type>(6));
+    }
+  }
+}
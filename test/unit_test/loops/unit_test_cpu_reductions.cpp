@@ -0,0 +1,228 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/loops/cpu_reductions.hpp"
+
+#include "../tensor/utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+TEMPLATE_LIST_TEST_CASE("CPU reduction loop works",
+                        "[loops][reduction]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  SECTION("Empty buffer gives the identity")
+  {
+    Type* empty_buf = nullptr;
+    Type sum = static_cast<Type>(42);
+    cpu::reduction_loop(SumReduction<Type>{}, 0, &sum, empty_buf);
+    REQUIRE(sum == static_cast<Type>(0));
+    ValueIndexPair<Type> argmax;
+    cpu::reduction_loop(ArgMaxReduction<Type>{}, 0, &argmax, empty_buf);
+    REQUIRE(argmax.index == std::numeric_limits<DataIndexType>::max());
+  }
+
+  SECTION("Full reductions")
+  {
+    std::size_t const grain_size = cpu::get_parallel_loop_grain_size();
+    for (std::size_t size :
+         {std::size_t{1}, std::size_t{37}, 3 * grain_size + 5})
+    {
+      DeviceBuf<Type, Device::CPU> buf{size};
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        buf.buf[i] = static_cast<Type>((i * 7) % 50 + 1);
+      }
+      // Plant unique extremes.
+      std::size_t const max_idx = size / 2;
+      std::size_t const min_idx = size - 1;
+      buf.buf[max_idx] = static_cast<Type>(100);
+      if (size > 1)
+      {
+        buf.buf[min_idx] = static_cast<Type>(0);
+      }
+      Type const* in = buf.buf;
+
+      Type expected_sum = static_cast<Type>(0);
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        expected_sum += buf.buf[i];
+      }
+      Type sum, max, min;
+      cpu::reduction_loop(SumReduction<Type>{}, size, &sum, in);
+      cpu::reduction_loop(MaxReduction<Type>{}, size, &max, in);
+      cpu::reduction_loop(MinReduction<Type>{}, size, &min, in);
+      REQUIRE(sum == expected_sum);
+      REQUIRE(max == static_cast<Type>(100));
+      REQUIRE(min == static_cast<Type>(size > 1 ? 0 : 100));
+
+      ValueIndexPair<Type> argmax, argmin;
+      cpu::reduction_loop(ArgMaxReduction<Type>{}, size, &argmax, in);
+      cpu::reduction_loop(ArgMinReduction<Type>{}, size, &argmin, in);
+      REQUIRE(argmax.value == static_cast<Type>(100));
+      REQUIRE(argmax.index == static_cast<DataIndexType>(max_idx));
+      REQUIRE(argmin.index == static_cast<DataIndexType>(min_idx));
+    }
+  }
+
+  SECTION("Arg-reductions pick the first of ties")
+  {
+    DeviceBuf<Type, Device::CPU> buf{64};
+    buf.fill(static_cast<Type>(3));
+    ValueIndexPair<Type> argmax;
+    cpu::reduction_loop(ArgMaxReduction<Type>{},
+                        buf.size,
+                        &argmax,
+                        static_cast<Type const*>(buf.buf));
+    REQUIRE(argmax.index == 0);
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("CPU strided reduction loop works",
+                        "[loops][reduction]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  // A 4x6 buffer with value i + 10 * j at (i, j).
+  DeviceBuf<Type, Device::CPU> in_buf{24};
+  for (std::size_t j = 0; j < 6; ++j)
+  {
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      in_buf.buf[i + 4 * j] = static_cast<Type>(i + 10 * j);
+    }
+  }
+  Type const* in = in_buf.buf;
+
+  SECTION("Reduce the first dimension")
+  {
+    DeviceBuf<Type, Device::CPU> out_buf{6};
+    cpu::strided_reduction_loop(SumReduction<Type>{},
+                                ShapeTuple{4, 6},
+                                StrideTuple{1, 4},
+                                StrideTuple{0, 1},
+                                out_buf.buf,
+                                in);
+    for (std::size_t j = 0; j < 6; ++j)
+    {
+      REQUIRE(out_buf.buf[j] == static_cast<Type>(6 + 40 * j));
+    }
+  }
+
+  SECTION("Reduce the last dimension")
+  {
+    DeviceBuf<Type, Device::CPU> out_buf{4};
+    cpu::strided_reduction_loop(MaxReduction<Type>{},
+                                ShapeTuple{4, 6},
+                                StrideTuple{1, 4},
+                                StrideTuple{1, 0},
+                                out_buf.buf,
+                                in);
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      REQUIRE(out_buf.buf[i] == static_cast<Type>(i + 50));
+    }
+  }
+
+  SECTION("Reduce all dimensions of a view")
+  {
+    // The 2x3 view starting at (1, 2).
+    Type sum;
+    cpu::strided_reduction_loop(SumReduction<Type>{},
+                                ShapeTuple{2, 3},
+                                StrideTuple{1, 4},
+                                StrideTuple{0, 0},
+                                &sum,
+                                in + 1 + 4 * 2);
+    REQUIRE(sum == static_cast<Type>(3 * (1 + 2) + 2 * (20 + 30 + 40)));
+  }
+
+  SECTION("Arg-reductions index the reduced dimensions")
+  {
+    std::vector<ValueIndexPair<Type>> out(4);
+    cpu::strided_reduction_loop(ArgMinReduction<Type>{},
+                                ShapeTuple{4, 6},
+                                StrideTuple{1, 4},
+                                StrideTuple{1, 0},
+                                out.data(),
+                                in);
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      REQUIRE(out[i].value == static_cast<Type>(i));
+      REQUIRE(out[i].index == 0);
+    }
+  }
+
+  SECTION("No reduced elements give the identity")
+  {
+    DeviceBuf<Type, Device::CPU> out_buf{4};
+    out_buf.fill(static_cast<Type>(42));
+    cpu::strided_reduction_loop(SumReduction<Type>{},
+                                ShapeTuple{4, 0},
+                                StrideTuple{1, 4},
+                                StrideTuple{1, 0},
+                                out_buf.buf,
+                                in);
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      REQUIRE(out_buf.buf[i] == static_cast<Type>(0));
+    }
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("CPU transform-reduction loop works",
+                        "[loops][reduction]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  DeviceBuf<Type, Device::CPU> buf{4 * 25};
+  for (std::size_t i = 0; i < buf.size; ++i)
+  {
+    buf.buf[i] = static_cast<Type>(i % 4);
+  }
+  Type const* in = buf.buf;
+  auto square = [](Type v) -> double {
+    return static_cast<double>(v) * static_cast<double>(v);
+  };
+
+  SECTION("Full reduction")
+  {
+    // Sum of squares, accumulated in double.
+    double sum_sq;
+    cpu::transform_reduction_loop(
+      square, SumReduction<double>{}, buf.size, &sum_sq, in);
+    REQUIRE(sum_sq == 25.0 * (0 + 1 + 4 + 9));
+
+    ValueIndexPair<double> argmax;
+    cpu::transform_reduction_loop(
+      square, ArgMaxReduction<double>{}, buf.size, &argmax, in);
+    REQUIRE(argmax.value == 9.0);
+    REQUIRE(argmax.index == 3);
+  }
+
+  SECTION("Strided reduction")
+  {
+    std::vector<double> out(4);
+    cpu::strided_transform_reduction_loop(square,
+                                          SumReduction<double>{},
+                                          ShapeTuple{4, 25},
+                                          StrideTuple{1, 4},
+                                          StrideTuple{1, 0},
+                                          out.data(),
+                                          in);
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      REQUIRE(out[i] == 25.0 * i * i);
+    }
+  }
+}
@@ -5,12 +5,16 @@
 // SPDX-License-Identifier: Apache-2.0
 ////////////////////////////////////////////////////////////////////////////////
 
+#include "h2/loops/fused_ops.hpp"
 #include "h2/loops/gpu_loops.cuh"
 
 #include "../tensor/utils.hpp"
 #include <catch2/catch_template_test_macros.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <memory>
+#include <vector>
+
 using namespace h2;
 
 // Test helpers, use `gpu::launch_elementwise_loop`, etc. in real code.
@@ -817,3 +821,202 @@ TEMPLATE_LIST_TEST_CASE("Vectorized GPU element-wise loop with immediate works",
     }
   }
 }
+
+TEMPLATE_LIST_TEST_CASE("Fused GPU element-wise loop works",
+                        "[loops]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  ComputeStream stream{Device::GPU};
+
+  DeviceBuf<Type, Device::GPU> in_buf{37}, out_buf{37};
+  in_buf.fill(static_cast<Type>(7));
+  out_buf.fill(static_cast<Type>(0));
+  Type const offset = static_cast<Type>(3);
+  auto func = fuse(
+    [] H2_GPU_LAMBDA(Type v) -> double { return static_cast<double>(v); },
+    [] H2_GPU_LAMBDA(double v) -> double { return 2.0 * v; },
+    [offset] H2_GPU_LAMBDA(double v) -> Type {
+      return static_cast<Type>(v > 10.0 ? 10.0 : v) + offset;
+    });
+  test_launch_vectorized_elementwise_loop<4, 4>(
+    func,
+    stream,
+    out_buf.size,
+    out_buf.buf,
+    static_cast<Type const*>(in_buf.buf));
+  for (std::size_t i = 0; i < out_buf.size; ++i)
+  {
+    REQUIRE(read_ele<Device::GPU>(out_buf.buf, i, stream)
+            == static_cast<Type>(13));
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Autotuned GPU element-wise loop works",
+                        "[loops]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  ComputeStream stream{Device::GPU};
+
+  SECTION("In-place loops are only applied once")
+  {
+    gpu::clear_tuned_elementwise_configs();
+    DeviceBuf<Type, Device::GPU> buf{1031};
+    buf.fill(static_cast<Type>(1));
+    auto func = [] H2_GPU_LAMBDA(Type v) -> Type { return v + 1; };
+    gpu::launch_autotuned_elementwise_loop(
+      func, stream, buf.size, buf.buf, static_cast<Type const*>(buf.buf));
+    for (std::size_t i = 0; i < buf.size; ++i)
+    {
+      REQUIRE(read_ele<Device::GPU>(buf.buf, i, stream)
+              == static_cast<Type>(2));
+    }
+    // Now uses the cached configuration.
+    gpu::launch_autotuned_elementwise_loop(
+      func, stream, buf.size, buf.buf, static_cast<Type const*>(buf.buf));
+    for (std::size_t i = 0; i < buf.size; ++i)
+    {
+      REQUIRE(read_ele<Device::GPU>(buf.buf, i, stream)
+              == static_cast<Type>(3));
+    }
+  }
+
+  SECTION("With immediate")
+  {
+    DeviceBuf<Type, Device::GPU> in_buf{77}, out_buf{77};
+    in_buf.fill(static_cast<Type>(21));
+    out_buf.fill(static_cast<Type>(0));
+    gpu::launch_autotuned_elementwise_loop_with_immediate(
+      [] H2_GPU_LAMBDA(Type a, Type v) -> Type { return a + v; },
+      stream,
+      out_buf.size,
+      static_cast<Type>(1),
+      out_buf.buf,
+      static_cast<Type const*>(in_buf.buf));
+    for (std::size_t i = 0; i < out_buf.size; ++i)
+    {
+      REQUIRE(read_ele<Device::GPU>(out_buf.buf, i, stream)
+              == static_cast<Type>(22));
+    }
+  }
+}
+
+TEST_CASE("GPU loop autotuning cache works", "[loops]")
+{
+  gpu::clear_tuned_elementwise_configs();
+  std::string const key = gpu::get_elementwise_tuning_key(typeid(int), 1000);
+  REQUIRE(key == gpu::get_elementwise_tuning_key(typeid(int), 1023));
+  REQUIRE(key != gpu::get_elementwise_tuning_key(typeid(int), 1024));
+  REQUIRE(key != gpu::get_elementwise_tuning_key(typeid(float), 1000));
+  REQUIRE_FALSE(gpu::get_tuned_elementwise_config(key).has_value());
+
+  gpu::ElementwiseLaunchConfig const config{256, 2, 4, 100};
+  gpu::set_tuned_elementwise_config(key, config);
+  REQUIRE(gpu::get_tuned_elementwise_config(key) == config);
+
+  gpu::clear_tuned_elementwise_configs();
+  REQUIRE_FALSE(gpu::get_tuned_elementwise_config(key).has_value());
+
+  for (std::size_t vec_width : {1, 2, 4})
+  {
+    auto const candidates = gpu::get_elementwise_tuning_candidates(vec_width);
+    REQUIRE_FALSE(candidates.empty());
+    for (auto const& candidate : candidates)
+    {
+      REQUIRE(candidate.vec_width <= vec_width);
+    }
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Batched GPU element-wise loop works",
+                        "[loops]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  ComputeStream stream{Device::GPU};
+
+  // Include an empty item and one spanning several tiles.
+  std::vector<std::size_t> const sizes = {
+    1, 37, 0, gpu::work_per_block, 3 * gpu::work_per_block + 5};
+  std::vector<std::unique_ptr<DeviceBuf<Type, Device::GPU>>> in_bufs,
+    out_bufs;
+  for (std::size_t const size : sizes)
+  {
+    in_bufs.push_back(std::make_unique<DeviceBuf<Type, Device::GPU>>(size));
+    out_bufs.push_back(std::make_unique<DeviceBuf<Type, Device::GPU>>(size));
+  }
+  std::vector<gpu::ElementwiseWorkItem<Type*, Type const*>> items;
+  for (std::size_t i = 0; i < sizes.size(); ++i)
+  {
+    if (sizes[i] > 0)
+    {
+      in_bufs[i]->fill(static_cast<Type>(i + 1));
+      out_bufs[i]->fill(static_cast<Type>(0));
+    }
+    items.push_back(gpu::make_elementwise_work_item(
+      sizes[i],
+      out_bufs[i]->buf,
+      static_cast<Type const*>(in_bufs[i]->buf)));
+  }
+  auto func = [] H2_GPU_LAMBDA(Type v) -> Type {
+    return v + static_cast<Type>(1);
+  };
+
+  SECTION("Temporary work list")
+  {
+    gpu::launch_batched_elementwise_loop(func, stream, items);
+    for (std::size_t i = 0; i < sizes.size(); ++i)
+    {
+      for (std::size_t j = 0; j < sizes[i]; ++j)
+      {
+        REQUIRE(read_ele<Device::GPU>(out_bufs[i]->buf, j, stream)
+                == static_cast<Type>(i + 2));
+      }
+    }
+  }
+
+  SECTION("Reused work list")
+  {
+    gpu::ElementwiseWorkList<Type*, Type const*> work_list(items, stream);
+    REQUIRE(work_list.get_num_items() == sizes.size());
+    REQUIRE(work_list.get_num_tiles() == 1 + 1 + 0 + 1 + 4);
+    for (int rep = 0; rep < 2; ++rep)
+    {
+      gpu::launch_batched_elementwise_loop(func, stream, work_list);
+    }
+    for (std::size_t i = 0; i < sizes.size(); ++i)
+    {
+      for (std::size_t j = 0; j < sizes[i]; ++j)
+      {
+        REQUIRE(read_ele<Device::GPU>(out_bufs[i]->buf, j, stream)
+                == static_cast<Type>(i + 2));
+      }
+    }
+  }
+
+  SECTION("In-place updates")
+  {
+    std::vector<gpu::ElementwiseWorkItem<Type*>> inplace_items;
+    for (std::size_t i = 0; i < sizes.size(); ++i)
+    {
+      inplace_items.push_back(
+        gpu::make_elementwise_work_item(sizes[i], in_bufs[i]->buf));
+    }
+    gpu::launch_batched_elementwise_loop(
+      [] H2_GPU_LAMBDA(Type& v) { v = v * static_cast<Type>(2); },
+      stream,
+      inplace_items);
+    for (std::size_t i = 0; i < sizes.size(); ++i)
+    {
+      for (std::size_t j = 0; j < sizes[i]; ++j)
+      {
+        REQUIRE(read_ele<Device::GPU>(in_bufs[i]->buf, j, stream)
+                == static_cast<Type>(2 * (i + 1)));
+      }
+    }
+  }
+}
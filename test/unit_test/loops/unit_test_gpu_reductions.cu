@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/gpu/memory_utils.hpp"
+#include "h2/loops/gpu_reductions.cuh"
+
+#include "../tensor/utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+using namespace h2;
+
+namespace
+{
+
+template <typename T>
+T read_result(T const* buf, ComputeStream const& stream)
+{
+  T val;
+  gpu::mem_copy(&val, buf, 1, stream.get_stream<Device::GPU>());
+  stream.wait_for_this();
+  return val;
+}
+
+}  // anonymous namespace
+
+TEMPLATE_LIST_TEST_CASE("GPU reduction loop works",
+                        "[loops][reduction]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  ComputeStream stream{Device::GPU};
+
+  SECTION("Empty buffer gives the identity")
+  {
+    DeviceBuf<Type, Device::GPU> out{1};
+    out.fill(static_cast<Type>(42));
+    Type const* empty_buf = nullptr;
+    gpu::launch_reduction_loop(
+      SumReduction<Type>{}, stream, 0, out.buf, empty_buf);
+    REQUIRE(read_result(out.buf, stream) == static_cast<Type>(0));
+  }
+
+  SECTION("Full reductions in one and two passes")
+  {
+    for (std::size_t size :
+         {std::size_t{1}, std::size_t{37}, std::size_t{1} << 22})
+    {
+      std::vector<Type> host(size);
+      for (std::size_t i = 0; i < size; ++i)
+      {
+        host[i] = static_cast<Type>((i * 7) % 5 + 1);
+      }
+      std::size_t const max_idx = size / 2;
+      host[max_idx] = static_cast<Type>(100);
+      Type expected_sum = static_cast<Type>(0);
+      for (auto const& v : host)
+      {
+        expected_sum += v;
+      }
+
+      DeviceBuf<Type, Device::GPU> in{size}, out{1};
+      gpu::mem_copy(
+        in.buf, host.data(), size, stream.get_stream<Device::GPU>());
+      Type const* in_buf = in.buf;
+
+      gpu::launch_reduction_loop(
+        SumReduction<Type>{}, stream, size, out.buf, in_buf);
+      REQUIRE(read_result(out.buf, stream) == expected_sum);
+      gpu::launch_reduction_loop(
+        MaxReduction<Type>{}, stream, size, out.buf, in_buf);
+      REQUIRE(read_result(out.buf, stream) == static_cast<Type>(100));
+
+      DeviceBuf<ValueIndexPair<Type>, Device::GPU> arg_out{1};
+      gpu::launch_reduction_loop(
+        ArgMaxReduction<Type>{}, stream, size, arg_out.buf, in_buf);
+      auto const argmax = read_result(arg_out.buf, stream);
+      REQUIRE(argmax.value == static_cast<Type>(100));
+      REQUIRE(argmax.index == static_cast<DataIndexType>(max_idx));
+      gpu::launch_reduction_loop(
+        ArgMinReduction<Type>{}, stream, size, arg_out.buf, in_buf);
+      // The minimum is first at index 0 (unless the only element).
+      REQUIRE(read_result(arg_out.buf, stream).index == 0);
+    }
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("GPU strided reduction loop works",
+                        "[loops][reduction]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  ComputeStream stream{Device::GPU};
+
+  // A 4x100 buffer with value i + 10 * (j % 10) at (i, j).
+  constexpr std::size_t rows = 4, cols = 100;
+  std::vector<Type> host(rows * cols);
+  for (std::size_t j = 0; j < cols; ++j)
+  {
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+      host[i + rows * j] = static_cast<Type>(i + 10 * (j % 10));
+    }
+  }
+  DeviceBuf<Type, Device::GPU> in{rows * cols};
+  gpu::mem_copy(
+    in.buf, host.data(), host.size(), stream.get_stream<Device::GPU>());
+  Type const* in_buf = in.buf;
+
+  SECTION("Few elements per output")
+  {
+    DeviceBuf<Type, Device::GPU> out{cols};
+    gpu::launch_strided_reduction_loop(SumReduction<Type>{},
+                                       stream,
+                                       ShapeTuple{rows, cols},
+                                       StrideTuple{1, rows},
+                                       StrideTuple{0, 1},
+                                       out.buf,
+                                       in_buf);
+    for (std::size_t j = 0; j < cols; ++j)
+    {
+      REQUIRE(read_ele<Device::GPU>(out.buf, j, stream)
+              == static_cast<Type>(6 + 40 * (j % 10)));
+    }
+  }
+
+  SECTION("Many elements per output")
+  {
+    DeviceBuf<Type, Device::GPU> out{rows};
+    gpu::launch_strided_reduction_loop(MaxReduction<Type>{},
+                                       stream,
+                                       ShapeTuple{rows, cols},
+                                       StrideTuple{1, rows},
+                                       StrideTuple{1, 0},
+                                       out.buf,
+                                       in_buf);
+    for (std::size_t i = 0; i < rows; ++i)
+    {
+      REQUIRE(read_ele<Device::GPU>(out.buf, i, stream)
+              == static_cast<Type>(i + 90));
+    }
+  }
+
+  SECTION("Reduce all dimensions of a view")
+  {
+    DeviceBuf<Type, Device::GPU> out{1};
+    gpu::launch_strided_reduction_loop(SumReduction<Type>{},
+                                       stream,
+                                       ShapeTuple{2, 3},
+                                       StrideTuple{1, rows},
+                                       StrideTuple{0, 0},
+                                       out.buf,
+                                       in_buf + 1 + rows * 2);
+    REQUIRE(read_result(out.buf, stream)
+            == static_cast<Type>(3 * (1 + 2) + 2 * (20 + 30 + 40)));
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("GPU transform-reduction loop works",
+                        "[loops][reduction]",
+                        h2::ComputeTypes)
+{
+  using Type = TestType;
+
+  ComputeStream stream{Device::GPU};
+
+  constexpr std::size_t size = std::size_t{1} << 20;
+  std::vector<Type> host(size);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    host[i] = static_cast<Type>(i % 4);
+  }
+  DeviceBuf<Type, Device::GPU> in{size};
+  gpu::mem_copy(in.buf, host.data(), size, stream.get_stream<Device::GPU>());
+  Type const* in_buf = in.buf;
+  auto square = [] H2_GPU_LAMBDA(Type v) -> double {
+    return static_cast<double>(v) * static_cast<double>(v);
+  };
+
+  SECTION("Full reduction")
+  {
+    DeviceBuf<double, Device::GPU> out{1};
+    gpu::launch_transform_reduction_loop(
+      square, SumReduction<double>{}, stream, size, out.buf, in_buf);
+    REQUIRE(read_result(out.buf, stream) == (size / 4) * 14.0);
+  }
+
+  SECTION("Strided reduction")
+  {
+    DeviceBuf<double, Device::GPU> out{4};
+    gpu::launch_strided_transform_reduction_loop(
+      square,
+      SumReduction<double>{},
+      stream,
+      ShapeTuple{4, static_cast<DataIndexType>(size / 4)},
+      StrideTuple{1, 4},
+      StrideTuple{1, 0},
+      out.buf,
+      in_buf);
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+      REQUIRE(read_ele<Device::GPU>(out.buf, i, stream)
+              == static_cast<double>((size / 4) * i * i));
+    }
+  }
+}
@@ -5,10 +5,18 @@
 // SPDX-License-Identifier: Apache-2.0
 ////////////////////////////////////////////////////////////////////////////////
 
+#include "mpi_timings.hpp"
+
 #include <mpi.h>
 
+#include <algorithm>
 #include <array>
 #include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <catch2/reporters/catch_reporter_cumulative_base.hpp>
 #include <catch2/reporters/catch_reporter_registrars.hpp>
@@ -128,8 +136,139 @@ void write_report(std::vector<Catch::Totals> const& all_totals,
   endl(os);
   flush(os);
 }
+
+using TimingList = std::vector<std::pair<std::string, double>>;
+
+// Timings recorded on this rank, in the order they were first recorded.
+TimingList& get_timings()
+{
+  static TimingList timings;
+  return timings;
+}
+
+// Gather the timings of every rank to rank 0, as one list per rank.
+std::vector<TimingList> gather_timings(int rank, int size)
+{
+  std::ostringstream oss;
+  oss.precision(17);
+  for (auto const& [name, seconds] : get_timings())
+  {
+    oss << name << '\t' << seconds << '\n';
+  }
+  std::string const local = oss.str();
+
+  bool const i_am_root = (rank == 0);
+  int const local_size = static_cast<int>(local.size());
+  std::vector<int> sizes(i_am_root ? size : 0);
+  MPI_Gather(
+    &local_size, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+  std::vector<int> displs(sizes.size(), 0);
+  for (size_t i = 1; i < sizes.size(); ++i)
+  {
+    displs[i] = displs[i - 1] + sizes[i - 1];
+  }
+  std::string all(i_am_root ? displs.back() + sizes.back() : 0, '\0');
+  MPI_Gatherv(local.data(),
+              local_size,
+              MPI_CHAR,
+              all.data(),
+              sizes.data(),
+              displs.data(),
+              MPI_CHAR,
+              0,
+              MPI_COMM_WORLD);
+
+  std::vector<TimingList> all_timings(sizes.size());
+  for (size_t i = 0; i < sizes.size(); ++i)
+  {
+    std::istringstream iss(all.substr(displs[i], sizes[i]));
+    std::string name;
+    double seconds;
+    while (std::getline(iss, name, '\t') && iss >> seconds)
+    {
+      iss.ignore();  // The newline.
+      all_timings[i].emplace_back(std::move(name), seconds);
+    }
+  }
+  return all_timings;
+}
+
+void write_timing_report(std::vector<TimingList> const& all_timings,
+                         std::ostream& os)
+{
+  // Per-rank times of each name, in the order names first appear.
+  std::vector<std::string> names;
+  std::unordered_map<std::string, std::vector<std::pair<size_t, double>>>
+    times;
+  for (size_t mpi_rank = 0; mpi_rank < all_timings.size(); ++mpi_rank)
+  {
+    for (auto const& [name, seconds] : all_timings[mpi_rank])
+    {
+      auto& name_times = times[name];
+      if (name_times.empty())
+        names.push_back(name);
+      name_times.emplace_back(mpi_rank, seconds);
+    }
+  }
+  if (names.empty())
+    return;
+
+  using std::right;
+  using std::setw;
+  auto const rwidth = std::to_string(all_timings.size()).size();
+  auto const format = [](double value, bool scientific = true) {
+    std::ostringstream oss;
+    oss << (scientific ? std::scientific : std::fixed) << std::setprecision(3)
+        << value;
+    return oss.str();
+  };
+
+  os << "\nTIMINGS (seconds per iteration)\n";
+  for (auto const& name : names)
+  {
+    auto const& name_times = times[name];
+    double min_time = name_times.front().second;
+    double max_time = min_time;
+    double sum = 0;
+    for (auto const& [mpi_rank, seconds] : name_times)
+    {
+      min_time = std::min(min_time, seconds);
+      max_time = std::max(max_time, seconds);
+      sum += seconds;
+    }
+    double const mean = sum / name_times.size();
+    os << name << "\n   ranks: " << name_times.size()
+       << " | min: " << format(min_time) << " | mean: " << format(mean)
+       << " | max: " << format(max_time) << " | max/mean: "
+       << format(mean > 0 ? max_time / mean : 1.0, false) << "\n";
+    for (size_t i = 0; i < name_times.size(); ++i)
+    {
+      if (i > 0)
+        os << ((i % 4 == 0) ? "\n" : "   ");
+      if (i % 4 == 0)
+        os << "     ";
+      os << "RANK " << setw(rwidth) << right << name_times[i].first << ": "
+         << format(name_times[i].second);
+    }
+    os << "\n\n";
+  }
+  flush(os);
+}
 }  // namespace
 
+void record_mpi_timing(std::string const& name, double seconds)
+{
+  auto& timings = get_timings();
+  auto const it =
+    std::find_if(timings.begin(), timings.end(), [&name](auto const& t) {
+      return t.first == name;
+    });
+  if (it != timings.end())
+    it->second = seconds;
+  else
+    timings.emplace_back(name, seconds);
+}
+
 // Assumptions
 // - All processes in MPI_COMM_WORLD participate in testing.
 // - All processes in MPI_COMM_WORLD see the same command line.
@@ -185,6 +324,11 @@ public:
 
     if (i_am_root)
       write_report(all_totals, m_stream);
+
+    // Timings are only recorded by benchmarks.
+    std::vector<TimingList> const all_timings = gather_timings(rank, size);
+    if (i_am_root)
+      write_timing_report(all_timings, m_stream);
   }
 
   void testRunEndedCumulative() final {}
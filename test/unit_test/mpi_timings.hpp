@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/** @file
+ *
+ * Timing of operations on communicators for MPI benchmarks.
+ *
+ * Timings are recorded per rank with `record_mpi_timing` and reported
+ * at the end of the run by the "mpicumulative" reporter, which gathers
+ * them from every rank and prints each rank's time along with the
+ * minimum, maximum, and mean across the ranks that recorded it.
+ */
+
+#include "h2/tensor/dist_types.hpp"
+
+#include <chrono>
+#include <string>
+#include <utility>
+
+/**
+ * Record that the operation `name` took `seconds` on this rank.
+ *
+ * Ranks that do not participate in an operation should not record it.
+ * Recording the same name again on a rank replaces the earlier time.
+ */
+void record_mpi_timing(std::string const& name, double seconds);
+
+/**
+ * Return the mean time, in seconds, of `num_iters` calls to `f` on
+ * this rank, after `num_warmup` untimed calls.
+ *
+ * The ranks of `comm` start timing together, but are not synchronized
+ * at the end, so per-rank times show load imbalance. `f` must complete
+ * any asynchronous work it starts (e.g., wait for its streams) and is
+ * called the same number of times on every rank of `comm`, so it may
+ * use collectives.
+ */
+template <typename F>
+double time_on_comm(h2::Comm const& comm,
+                    F&& f,
+                    int num_iters = 10,
+                    int num_warmup = 2)
+{
+  for (int i = 0; i < num_warmup; ++i)
+  {
+    f();
+  }
+  MPI_Barrier(comm.GetMPIComm());
+  auto const start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_iters; ++i)
+  {
+    f();
+  }
+  std::chrono::duration<double> const elapsed =
+    std::chrono::steady_clock::now() - start;
+  return elapsed.count() / num_iters;
+}
+
+/** Time `f` with `time_on_comm` and record the result as `name`. */
+template <typename F>
+void record_time_on_comm(std::string const& name,
+                         h2::Comm const& comm,
+                         F&& f,
+                         int num_iters = 10,
+                         int num_warmup = 2)
+{
+  record_mpi_timing(
+    name, time_on_comm(comm, std::forward<F>(f), num_iters, num_warmup));
+}
@@ -0,0 +1,170 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/meta/TypeList.hpp"
+#include "h2/patterns/multimethods/MatrixDispatcher.hpp"
+
+#include <catch2/catch_template_test_macros.hpp>
+
+#include <thread>
+#include <vector>
+
+using namespace h2::meta;
+using namespace h2::multimethods;
+
+namespace
+{
+struct base
+{
+  virtual ~base() = default;
+};
+struct derived_one final : base
+{};
+struct derived_two final : base
+{};
+struct derived_thr final : base
+{};
+
+struct otherbase
+{
+  virtual ~otherbase() = default;
+};
+struct other_d1 : otherbase
+{};
+struct other_d2 : otherbase
+{};
+
+struct TestFunctor
+{
+  int operator()(derived_one const&, other_d1 const&) const { return 0; }
+  int operator()(derived_one const&, other_d2 const&) const { return 1; }
+  int operator()(derived_two const&, other_d1 const&) const { return 2; }
+  int operator()(derived_two const&, other_d2 const&) const { return 3; }
+};
+
+int test_function(derived_two const&, other_d1 const&)
+{
+  return 52;
+}
+
+}  // namespace
+
+template <template <class, class> class CasterT>
+struct DispatcherMaker
+{
+  using type = MatrixDispatcher<int,
+                                TL<base const, otherbase const>,
+                                TL<TL<derived_one, derived_two, derived_thr>,
+                                   TL<other_d1, other_d2>>,
+                                CasterT>;
+};
+
+using DispatcherMakers =
+  TL<DispatcherMaker<DynamicDownCaster>, DispatcherMaker<StaticDownCaster>>;
+
+TEMPLATE_LIST_TEST_CASE("Constant-time matrix-based dispatcher",
+                        "[utilities][multimethods][matrixdispatcher]",
+                        DispatcherMakers)
+{
+  using DispatcherT = typename TestType::type;
+
+  derived_one d1;
+  derived_two d2;
+  derived_thr d3;
+  base& d1_b = d1;
+  base& d2_b = d2;
+  base& d3_b = d3;
+
+  other_d1 od1;
+  other_d2 od2;
+  otherbase& od1_b = od1;
+  otherbase& od2_b = od2;
+
+  DispatcherT d;
+  TestFunctor f;
+
+  SECTION("Double dispatch with a basic functor")
+  {
+    REQUIRE_NOTHROW(H2_MDISP_ADD(d, f, derived_one, other_d1));
+    REQUIRE_NOTHROW(d.template add<derived_one, other_d2>(f));
+    REQUIRE_NOTHROW(d.template add<derived_two, other_d1>(f));
+    REQUIRE_NOTHROW(d.template add<derived_two, other_d2>(f));
+
+    CHECK(d.call(d1_b, od1_b) == f(d1, od1));
+    CHECK(d.call(d1_b, od2_b) == f(d1, od2));
+    CHECK(d.call(d2_b, od1_b) == f(d2, od1));
+    CHECK(d.call(d2_b, od2_b) == f(d2, od2));
+
+    // In the concrete types, but not registered.
+    CHECK_THROWS_AS(d.call(d3_b, od1_b), NoDispatchAdded);
+  }
+
+  SECTION("Types not in the concrete types have no dispatch")
+  {
+    struct derived_fou final : base
+    {} d4;
+    base& d4_b = d4;
+    REQUIRE_NOTHROW(d.template add<derived_one, other_d1>(f));
+    CHECK_THROWS_AS(d.call(d4_b, od1_b), NoDispatchAdded);
+  }
+
+  SECTION("Registering a raw function pointer replaces existing dispatch")
+  {
+    REQUIRE_NOTHROW(d.template add<derived_two, other_d1>(f));
+    REQUIRE(d.call(d2_b, od1_b) == 2);
+    REQUIRE_NOTHROW(
+      H2_MDISP_ADD_FP(d, test_function, derived_two, other_d1));
+    REQUIRE(d.call(d2_b, od1_b) == 52);
+  }
+
+  SECTION("Batched dispatch")
+  {
+    REQUIRE_NOTHROW(d.template add<derived_one, other_d1>(f));
+    REQUIRE_NOTHROW(d.template add<derived_one, other_d2>(f));
+    REQUIRE_NOTHROW(d.template add<derived_two, other_d1>(f));
+    REQUIRE_NOTHROW(d.template add<derived_two, other_d2>(f));
+
+    std::vector<typename DispatcherT::ArgsT> args;
+    args.emplace_back(d2_b, od2_b);
+    args.emplace_back(d1_b, od1_b);
+    args.emplace_back(d2_b, od1_b);
+    args.emplace_back(d1_b, od2_b);
+    CHECK(d.call_batch(args) == std::vector<int>{3, 0, 2, 1});
+
+    args.emplace_back(d3_b, od2_b);
+    CHECK_THROWS_AS(d.call_batch(args), NoDispatchAdded);
+  }
+
+  SECTION("Concurrent registration and dispatch")
+  {
+    REQUIRE_NOTHROW(d.template add<derived_one, other_d1>(f));
+    std::vector<std::thread> threads;
+    std::vector<int> ok(4, 1);
+    for (int t = 0; t < 4; ++t)
+    {
+      threads.emplace_back([&, t]() {
+        for (int i = 0; i < 1000; ++i)
+        {
+          if (t == 0)
+          {
+            d.template add<derived_two, other_d2>(f);
+          }
+          else if (d.call(d1_b, od1_b) != 0)
+          {
+            ok[t] = 0;
+          }
+        }
+      });
+    }
+    for (auto& thread : threads)
+    {
+      thread.join();
+    }
+    CHECK(ok == std::vector<int>(4, 1));
+    CHECK(d.call(d2_b, od2_b) == 3);
+  }
+}
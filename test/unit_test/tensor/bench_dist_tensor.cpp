@@ -0,0 +1,239 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+// Scaling benchmarks of distributed tensors. These are built into the
+// MPIBenchmarks executable, not the tests; run it with
+// "-r mpicumulative" to get the timings of every rank and their
+// minimum, maximum, and mean.
+//
+// Every benchmark runs on communicators of each size up to the world
+// and every grid shape of up to three dimensions, with both a fixed
+// global size (strong scaling) and a fixed local size (weak scaling).
+
+#include "h2/tensor/copy.hpp"
+#include "h2/tensor/dist_tensor.hpp"
+#include "h2/tensor/hydrogen_interop.hpp"
+#include "h2/tensor/proc_grid.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "../mpi_timings.hpp"
+#include "../mpi_utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+namespace
+{
+
+enum class Scaling
+{
+  Strong,
+  Weak
+};
+
+// Elements of the global (strong) or local (weak) tensor.
+constexpr DataIndexType bench_sizes[] = {DataIndexType{1} << 16,
+                                         DataIndexType{1} << 22};
+
+constexpr ShapeTuple::size_type max_grid_ndim = 3;
+
+/**
+ * Return a tensor shape with the dimensions of `grid_shape` and about
+ * `size` elements globally (strong scaling) or per process (weak
+ * scaling).
+ */
+ShapeTuple make_bench_shape(ShapeTuple const& grid_shape,
+                            DataIndexType size,
+                            Scaling scaling)
+{
+  DimType const extent = static_cast<DimType>(
+    std::round(std::pow(static_cast<double>(size), 1.0 / grid_shape.size())));
+  ShapeTuple shape(TuplePad<ShapeTuple>(grid_shape.size()));
+  for (ShapeTuple::size_type i = 0; i < grid_shape.size(); ++i)
+  {
+    shape[i] = (scaling == Scaling::Weak)
+                 ? extent * grid_shape[i]
+                 : std::max(extent, grid_shape[i]);
+  }
+  return shape;
+}
+
+std::string bench_name(std::string const& op,
+                       Device dev,
+                       Comm const& comm,
+                       ShapeTuple const& grid_shape,
+                       ShapeTuple const& shape,
+                       Scaling scaling)
+{
+  std::ostringstream oss;
+  oss << op << " | " << dev << " | procs " << comm.Size() << " | grid "
+      << grid_shape << " | shape " << shape << " | "
+      << (scaling == Scaling::Weak ? "weak" : "strong");
+  return oss.str();
+}
+
+/**
+ * Invoke `f(comm, grid_shape, shape, scaling)` for every benchmark
+ * configuration.
+ */
+template <typename F>
+void for_bench_configs(F f)
+{
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple grid_shape) {
+        for (Scaling scaling : {Scaling::Strong, Scaling::Weak})
+        {
+          for (DataIndexType size : bench_sizes)
+          {
+            f(comm,
+              grid_shape,
+              make_bench_shape(grid_shape, size, scaling),
+              scaling);
+          }
+        }
+      },
+      comm,
+      1,
+      max_grid_ndim);
+  });
+}
+
+}  // namespace
+
+TEST_CASE("Benchmark processor grid construction", "[benchmark][proc-grid]")
+{
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple grid_shape) {
+        std::ostringstream oss;
+        oss << "ProcessorGrid | procs " << comm.Size() << " | grid "
+            << grid_shape;
+        record_time_on_comm(
+          oss.str(), comm, [&]() { ProcessorGrid grid(comm, grid_shape); });
+      },
+      comm,
+      1,
+      max_grid_ndim);
+  });
+}
+
+TEMPLATE_LIST_TEST_CASE("Benchmark distributed tensor construction",
+                        "[benchmark][dist-tensor]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+
+  for_bench_configs([&](Comm& comm,
+                        ShapeTuple const& grid_shape,
+                        ShapeTuple const& shape,
+                        Scaling scaling) {
+    ProcessorGrid grid(comm, grid_shape);
+    DTTuple const dim_types(TuplePad<DTTuple>(grid.ndim(), DT::Any));
+    for (Distribution dist : {Distribution::Block, Distribution::Replicated})
+    {
+      DistTTuple const dists(TuplePad<DistTTuple>(grid.ndim(), dist));
+      std::ostringstream op;
+      op << "DistTensor " << dist;
+      record_time_on_comm(
+        bench_name(op.str(), Dev, comm, grid_shape, shape, scaling),
+        comm,
+        [&]() {
+          DistTensor<DataType> tensor(Dev, shape, dim_types, grid, dists);
+          tensor.get_stream().wait_for_this();
+        });
+    }
+  });
+}
+
+TEMPLATE_LIST_TEST_CASE("Benchmark distributed tensor copy",
+                        "[benchmark][dist-tensor][dist-copy]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  // Same distributions are local copies, the rest redistribute.
+  constexpr std::pair<Distribution, Distribution> dist_pairs[] = {
+    {Distribution::Block, Distribution::Block},
+    {Distribution::Block, Distribution::Replicated},
+    {Distribution::Replicated, Distribution::Block},
+    {Distribution::Block, Distribution::Single},
+    {Distribution::Single, Distribution::Block},
+  };
+
+  for_bench_configs([&](Comm& comm,
+                        ShapeTuple const& grid_shape,
+                        ShapeTuple const& shape,
+                        Scaling scaling) {
+    ProcessorGrid grid(comm, grid_shape);
+    DTTuple const dim_types(TuplePad<DTTuple>(grid.ndim(), DT::Any));
+    for (auto const& [src_dist, dst_dist] : dist_pairs)
+    {
+      DistTensor<DataType> src(
+        Dev,
+        shape,
+        dim_types,
+        grid,
+        DistTTuple(TuplePad<DistTTuple>(grid.ndim(), src_dist)));
+      // Keeps its distribution, since it has the same shape.
+      DistTensor<DataType> dst(
+        Dev,
+        shape,
+        dim_types,
+        grid,
+        DistTTuple(TuplePad<DistTTuple>(grid.ndim(), dst_dist)));
+      std::ostringstream op;
+      op << "copy " << src_dist << " -> " << dst_dist;
+      record_time_on_comm(
+        bench_name(op.str(), Dev, comm, grid_shape, shape, scaling),
+        comm,
+        [&]() {
+          copy(dst, src);
+          dst.get_stream().wait_for_this();
+        });
+    }
+  });
+}
+
+TEMPLATE_LIST_TEST_CASE("Benchmark Hydrogen interop",
+                        "[benchmark][dist-tensor][h_h2]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  constexpr hydrogen::Device HDev = HydrogenDevice<Dev>;
+
+  // COMM_WORLD, as square as possible, column-major ordering.
+  El::Grid const g{El::mpi::NewWorldComm()};
+  ShapeTuple const grid_shape{g.Height(), g.Width()};
+  for (Scaling scaling : {Scaling::Strong, Scaling::Weak})
+  {
+    for (DataIndexType size : bench_sizes)
+    {
+      ShapeTuple const shape = make_bench_shape(grid_shape, size, scaling);
+      El::DistMatrix<DataType, El::MC, El::MR, El::ELEMENT, HDev> A(
+        shape[0], shape[1], g);
+      ProcessorGrid const proc_grid{g.VCComm(), grid_shape};
+
+      record_time_on_comm(
+        bench_name("as_h2_tensor", Dev, g.VCComm(), grid_shape, shape, scaling),
+        g.VCComm(),
+        [&]() { DistTensor<DataType> tensor = as_h2_tensor(A, proc_grid); });
+
+      DistTensor<DataType> tensor = as_h2_tensor(A, proc_grid);
+      record_time_on_comm(
+        bench_name("as_h_matrix", Dev, g.VCComm(), grid_shape, shape, scaling),
+        g.VCComm(),
+        [&]() { auto mat = as_h_matrix(tensor, g, El::MC, El::MR); });
+    }
+  }
+}
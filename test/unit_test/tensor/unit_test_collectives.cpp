@@ -0,0 +1,323 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/bucketed_allreduce.hpp"
+#include "h2/tensor/collectives.hpp"
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/tensor_utils.hpp"
+#include "utils.hpp"
+
+#include "../mpi_utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using namespace h2;
+
+TEMPLATE_LIST_TEST_CASE("Distributed tensor collectives work",
+                        "[dist-tensor][collectives]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using DistTensorType = DistTensor<DataType>;
+
+  auto get_val = [](ShapeTuple const& shape, ScalarIndexTuple const& idx) {
+    return static_cast<DataType>(
+      inner_product<DataIndexType>(idx, prefix_product<DataIndexType>(shape))
+      + 1);
+  };
+
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple grid_shape) {
+        ProcessorGrid grid = ProcessorGrid(comm, grid_shape);
+        // Dimensions must divide evenly.
+        ShapeTuple tensor_shape = grid_shape;
+        for (auto& s : tensor_shape)
+        {
+          s *= 3;
+        }
+        DTTuple tensor_dim_types(TuplePad<DTTuple>(grid.ndim(), DT::Any));
+        DistTTuple block_dist(
+          TuplePad<DistTTuple>(grid.ndim(), Distribution::Block));
+
+        for (typename ShapeTuple::size_type i = 0; i < grid.ndim(); ++i)
+        {
+          // Reduce over one dimension, then over all of them.
+          for (DimensionOrderTuple const& dims :
+               {DimensionOrderTuple{static_cast<NDimType>(i)},
+                grid.dim_order()})
+          {
+            DistTTuple replicated_dist = block_dist;
+            for (auto const& dim : dims)
+            {
+              replicated_dist[dim] = Distribution::Replicated;
+            }
+            RankType const sub_rank = grid.get_subcomm(dims).Rank();
+            RankType const sub_size = grid.get_subcomm(dims).Size();
+            DataType const factor =
+              static_cast<DataType>(sub_size * (sub_size + 1) / 2);
+            auto fill = [&](DistTensorType& tensor, DataType scale) {
+              Tensor<DataType>& local = tensor.local_tensor();
+              for_ndim(local.shape(), [&](ScalarIndexTuple const& idx) {
+                write_ele<Dev>(local.get(idx),
+                               0,
+                               scale
+                                 * get_val(tensor_shape,
+                                           h2::internal::local2global_index(
+                                             tensor_shape,
+                                             grid,
+                                             tensor.distribution(),
+                                             grid.rank(),
+                                             idx)),
+                               local.get_stream());
+              });
+            };
+            auto check = [&](DistTensorType& tensor, DataType scale) {
+              Tensor<DataType>& local = tensor.local_tensor();
+              for_ndim(local.shape(), [&](ScalarIndexTuple const& idx) {
+                REQUIRE(read_ele<Dev>(local.get(idx), 0, local.get_stream())
+                        == scale
+                             * get_val(tensor_shape,
+                                       h2::internal::local2global_index(
+                                         tensor_shape,
+                                         grid,
+                                         tensor.distribution(),
+                                         grid.rank(),
+                                         idx)));
+              });
+            };
+
+            // Allgather.
+            {
+              DistTensorType src = DistTensorType(
+                Dev, tensor_shape, tensor_dim_types, grid, block_dist);
+              DistTensorType dst = DistTensorType(
+                Dev, tensor_shape, tensor_dim_types, grid, replicated_dist);
+              fill(src, DataType{1});
+              REQUIRE_NOTHROW(allgather(dst, src, dims));
+              check(dst, DataType{1});
+            }
+            // Allreduce.
+            {
+              DistTensorType tensor = DistTensorType(
+                Dev, tensor_shape, tensor_dim_types, grid, replicated_dist);
+              fill(tensor, static_cast<DataType>(sub_rank + 1));
+              REQUIRE_NOTHROW(allreduce(tensor, dims));
+              check(tensor, factor);
+              fill(tensor, static_cast<DataType>(sub_rank + 1));
+              REQUIRE_NOTHROW(allreduce(tensor, dims, ReductionOp::Max));
+              check(tensor, static_cast<DataType>(sub_size));
+            }
+            // Reduce-scatter.
+            {
+              DistTensorType src = DistTensorType(
+                Dev, tensor_shape, tensor_dim_types, grid, replicated_dist);
+              DistTensorType dst = DistTensorType(
+                Dev, tensor_shape, tensor_dim_types, grid, block_dist);
+              fill(src, static_cast<DataType>(sub_rank + 1));
+              REQUIRE_NOTHROW(reduce_scatter(dst, src, dims));
+              check(dst, factor);
+            }
+            // Scatter.
+            {
+              DistTTuple single_dist = block_dist;
+              for (auto const& dim : dims)
+              {
+                single_dist[dim] = Distribution::Single;
+              }
+              DistTensorType src = DistTensorType(
+                Dev, tensor_shape, tensor_dim_types, grid, single_dist);
+              DistTensorType dst = DistTensorType(
+                Dev, tensor_shape, tensor_dim_types, grid, block_dist);
+              fill(src, DataType{1});
+              REQUIRE_NOTHROW(scatter(dst, src, dims));
+              check(dst, DataType{1});
+            }
+            // Broadcast.
+            {
+              DistTTuple single_dist = replicated_dist;
+              for (auto const& dim : dims)
+              {
+                single_dist[dim] = Distribution::Single;
+              }
+              DistTensorType src = DistTensorType(
+                Dev, tensor_shape, tensor_dim_types, grid, single_dist);
+              DistTensorType dst = DistTensorType(
+                Dev, tensor_shape, tensor_dim_types, grid, replicated_dist);
+              fill(src, DataType{1});
+              REQUIRE_NOTHROW(broadcast(dst, src, dims));
+              check(dst, DataType{1});
+            }
+          }
+        }
+      },
+      comm);
+  });
+}
+
+TEMPLATE_LIST_TEST_CASE("Distributed tensor collectives check distributions",
+                        "[dist-tensor][collectives]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using DistTensorType = DistTensor<DataType>;
+
+  for_comms([&](Comm& comm) {
+    ProcessorGrid grid = ProcessorGrid(comm, ShapeTuple{comm.Size()});
+    DimType const n = 2 * comm.Size();
+    DistTensorType block =
+      DistTensorType(Dev, {n}, {DT::Any}, grid, {Distribution::Block});
+    DistTensorType replicated =
+      DistTensorType(Dev, {n}, {DT::Any}, grid, {Distribution::Replicated});
+    REQUIRE_THROWS(allreduce(block, {0}));
+    REQUIRE_THROWS(allgather(block, replicated, {0}));
+    REQUIRE_THROWS(reduce_scatter(replicated, block, {0}));
+    REQUIRE_THROWS(scatter(replicated, block, {0}));
+    REQUIRE_THROWS(broadcast(block, replicated, {0}));
+    REQUIRE_THROWS(allreduce(replicated, {1}));
+  });
+}
+
+TEST_CASE("Broadcast chunk sizes are sensible", "[dist-tensor][collectives]")
+{
+  using h2::internal::get_broadcast_chunk_bytes;
+  // Small messages are sent whole.
+  REQUIRE(get_broadcast_chunk_bytes(1000, 1024, 4) == 1000);
+  // Chunks are whole elements.
+  REQUIRE(get_broadcast_chunk_bytes(std::size_t{1} << 30, 1024, 12) % 12 == 0);
+  // Larger messages use larger chunks, more processes smaller ones.
+  REQUIRE(get_broadcast_chunk_bytes(std::size_t{1} << 30, 1024, 4)
+          > get_broadcast_chunk_bytes(std::size_t{1} << 24, 1024, 4));
+  REQUIRE(get_broadcast_chunk_bytes(std::size_t{1} << 30, 1024, 4)
+          < get_broadcast_chunk_bytes(std::size_t{1} << 30, 8, 4));
+}
+
+TEMPLATE_LIST_TEST_CASE("Bucketed allreduces work",
+                        "[dist-tensor][collectives]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using DistTensorType = DistTensor<DataType>;
+  constexpr int num_tensors = 20;
+
+  for_comms([&](Comm& comm) {
+    ProcessorGrid grid = ProcessorGrid(comm, ShapeTuple{comm.Size(), 1});
+    DataType const factor =
+      static_cast<DataType>(comm.Size() * (comm.Size() + 1) / 2);
+    // From one bucket per tensor to one bucket for all of them.
+    for (std::size_t bucket_bytes :
+         {std::size_t{1}, 10 * sizeof(DataType), std::size_t{1} << 20})
+    {
+      BucketedAllreduce<DataType> bucketer(
+        grid, {0}, Dev, std::nullopt, ReductionOp::Sum, bucket_bytes);
+      std::vector<std::unique_ptr<DistTensorType>> tensors;
+      for (int i = 0; i < num_tensors; ++i)
+      {
+        tensors.push_back(std::make_unique<DistTensorType>(
+          Dev,
+          ShapeTuple{1 + i % 7, 3},
+          DTTuple{DT::Any, DT::Any},
+          grid,
+          DistTTuple{Distribution::Replicated, Distribution::Block}));
+        DistTensorType& tensor = *tensors.back();
+        for (DataIndexType j = 0; j < tensor.local_numel(); ++j)
+        {
+          write_ele<Dev>(tensor.data(),
+                         j,
+                         static_cast<DataType>((i + j) * (grid.rank() + 1)),
+                         tensor.get_stream());
+        }
+        REQUIRE_NOTHROW(bucketer.add(tensor));
+      }
+      REQUIRE_NOTHROW(bucketer.flush());
+      REQUIRE(bucketer.size() == 0);
+      if (bucket_bytes == 1)
+      {
+        REQUIRE(bucketer.get_num_flushes() == num_tensors);
+      }
+      else if (bucket_bytes == std::size_t{1} << 20)
+      {
+        REQUIRE(bucketer.get_num_flushes() == 1);
+      }
+
+      for (int i = 0; i < num_tensors; ++i)
+      {
+        DistTensorType& tensor = *tensors[i];
+        for (DataIndexType j = 0; j < tensor.local_numel(); ++j)
+        {
+          REQUIRE(read_ele<Dev>(tensor.data(), j, tensor.get_stream())
+                  == static_cast<DataType>(i + j) * factor);
+        }
+      }
+    }
+  });
+}
+
+TEMPLATE_LIST_TEST_CASE("Compressed allreduces work",
+                        "[dist-tensor][collectives]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using DistTensorType = DistTensor<float>;
+
+  for_comms([&](Comm& comm) {
+    ProcessorGrid grid = ProcessorGrid(comm, ShapeTuple{comm.Size(), 1});
+    ShapeTuple const shape{5, 7};
+    DTTuple const dim_types{DT::Any, DT::Any};
+    DistTTuple const dist{Distribution::Replicated, Distribution::Block};
+    float const factor =
+      static_cast<float>(comm.Size() * (comm.Size() + 1) / 2);
+
+    std::vector<CommCompression> compressions = {CommCompression::None};
+#if H2_HAS_GPU_LOW_PRECISION
+    compressions.push_back(CommCompression::Half);
+    compressions.push_back(CommCompression::BFloat16);
+#else
+    // Only GPUs compress; the CPU always sends full precision.
+    if constexpr (Dev == Device::CPU)
+    {
+      compressions.push_back(CommCompression::BFloat16);
+    }
+#endif
+    for (CommCompression compression : compressions)
+    {
+      bool const is_exact =
+        compression == CommCompression::None || Dev == Device::CPU;
+      DistTensorType tensor =
+        DistTensorType(Dev, shape, dim_types, grid, dist);
+      DistTensorType error = DistTensorType(Dev, shape, dim_types, grid, dist);
+      for (DataIndexType i = 0; i < tensor.local_numel(); ++i)
+      {
+        write_ele<Dev>(tensor.data(),
+                       i,
+                       static_cast<float>(i) * (grid.rank() + 1) + 0.1f,
+                       tensor.get_stream());
+        write_ele<Dev>(error.data(), i, 0.0f, error.get_stream());
+      }
+      REQUIRE_NOTHROW(
+        allreduce_compressed(tensor, {0}, compression, &error));
+      for (DataIndexType i = 0; i < tensor.local_numel(); ++i)
+      {
+        float const expected =
+          static_cast<float>(i) * factor + 0.1f * comm.Size();
+        float const val = read_ele<Dev>(tensor.data(), i, tensor.get_stream());
+        float const err = read_ele<Dev>(error.data(), i, error.get_stream());
+        // Compressed data is rounded twice to at least 8 bits.
+        float const tolerance = is_exact ? 1e-5f : 2e-2f;
+        REQUIRE(std::abs(val - expected) <= tolerance * std::abs(expected));
+        if (is_exact)
+        {
+          REQUIRE(err == 0.0f);
+        }
+      }
+    }
+  });
+}
@@ -0,0 +1,113 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/compression.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+namespace
+{
+
+/** Return `bytes` of data where every `stride`th word is nonzero. */
+std::vector<unsigned char> make_sparse_data(std::size_t bytes,
+                                            std::size_t stride)
+{
+  std::vector<unsigned char> data(bytes, 0);
+  for (std::size_t i = 0; i + sizeof(std::uint32_t) <= bytes;
+       i += stride * sizeof(std::uint32_t))
+  {
+    std::uint32_t const word = static_cast<std::uint32_t>(i + 1);
+    std::memcpy(data.data() + i, &word, sizeof(word));
+  }
+  if (bytes % sizeof(std::uint32_t))
+  {
+    data.back() = 0xAB;
+  }
+  return data;
+}
+
+/** Compress and decompress `data`, returning the compressed size. */
+std::size_t round_trip(std::vector<unsigned char> const& data)
+{
+  std::vector<unsigned char> compressed(
+    internal::get_max_compressed_size(data.size()));
+  std::size_t const compressed_bytes =
+    internal::compress(compressed.data(), data.data(), data.size());
+  REQUIRE(compressed_bytes <= compressed.size());
+  std::vector<unsigned char> out(data.size(), 0xFF);
+  internal::decompress(
+    out.data(), out.size(), compressed.data(), compressed_bytes);
+  REQUIRE(out == data);
+  return compressed_bytes;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("Zero-suppression compression round-trips", "[tensor][compression]")
+{
+  SECTION("Empty data")
+  {
+    REQUIRE(round_trip({}) == 0);
+  }
+
+  SECTION("Sparse data compresses")
+  {
+    for (std::size_t bytes : {std::size_t{128},
+                              std::size_t{1001},
+                              internal::compression_block_bytes,
+                              internal::compression_block_bytes * 2 + 77})
+    {
+      auto const data = make_sparse_data(bytes, 16);
+      REQUIRE(round_trip(data) < bytes);
+    }
+  }
+
+  SECTION("All-zero data compresses")
+  {
+    std::vector<unsigned char> const data(4096, 0);
+    REQUIRE(round_trip(data) < data.size() / 16);
+  }
+
+  SECTION("Dense data is stored")
+  {
+    auto const data = make_sparse_data(internal::compression_block_bytes + 12, 1);
+    REQUIRE(round_trip(data)
+            <= internal::get_max_compressed_size(data.size()));
+  }
+
+  SECTION("Mismatched sizes are rejected")
+  {
+    auto const data = make_sparse_data(1024, 8);
+    std::vector<unsigned char> compressed(
+      internal::get_max_compressed_size(data.size()));
+    std::size_t const compressed_bytes =
+      internal::compress(compressed.data(), data.data(), data.size());
+    std::vector<unsigned char> out(data.size() * 2);
+    REQUIRE_THROWS(internal::decompress(
+      out.data(), out.size(), compressed.data(), compressed_bytes));
+    REQUIRE_THROWS(internal::decompress(
+      out.data(), data.size(), compressed.data(), compressed_bytes - 1));
+  }
+}
+
+TEST_CASE("Compression ratio estimates work", "[tensor][compression]")
+{
+  std::vector<unsigned char> const zeros(4096, 0);
+  REQUIRE(internal::estimate_compression_ratio(zeros.data(), zeros.size())
+          < 0.1);
+  auto const dense = make_sparse_data(4096, 1);
+  REQUIRE(internal::estimate_compression_ratio(dense.data(), dense.size())
+          > 1.0);
+  // Too small to sample.
+  REQUIRE(internal::estimate_compression_ratio(dense.data(), 16) == 1.0);
+}
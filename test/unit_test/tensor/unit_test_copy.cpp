@@ -14,6 +14,8 @@
 #include <catch2/catch_template_test_macros.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <vector>
+
 using namespace h2;
 
 TEMPLATE_LIST_TEST_CASE("Buffer copy works", "[tensor][copy]", AllDevPairsList)
@@ -329,6 +331,64 @@ TEMPLATE_LIST_TEST_CASE("make_accessible_on_device works with constant tensors",
   }
 }
 
+TEMPLATE_LIST_TEST_CASE("make_accessible_on_device caches mirrors",
+                        "[tensor][copy]",
+                        AllDevPairsList)
+{
+  constexpr Device SrcDev = meta::tlist::At<TestType, 0>::value;
+  constexpr Device DstDev = meta::tlist::At<TestType, 1>::value;
+  using TensorType = Tensor<DataType>;
+
+  TensorType src_tensor(SrcDev, {4, 6}, {DT::Sample, DT::Any});
+  for (DataIndexType i = 0; i < src_tensor.numel(); ++i)
+  {
+    write_ele<SrcDev>(src_tensor.data(),
+                      i,
+                      static_cast<DataType>(i),
+                      src_tensor.get_stream());
+  }
+  src_tensor.set_mirror_cache(true);
+  REQUIRE(src_tensor.is_mirror_cache_enabled());
+
+  TensorType const& const_src = src_tensor;
+  std::unique_ptr<TensorType> dst_tensor =
+    make_accessible_on_device(const_src, DstDev);
+  REQUIRE(dst_tensor->get_device() == DstDev);
+  REQUIRE(dst_tensor->shape() == src_tensor.shape());
+  for (DataIndexType i = 0; i < dst_tensor->numel(); ++i)
+  {
+    REQUIRE(read_ele<DstDev>(
+              dst_tensor->const_data(), i, dst_tensor->get_stream())
+            == i);
+  }
+
+  std::unique_ptr<TensorType> dst_tensor2 =
+    make_accessible_on_device(const_src, DstDev);
+  bool const is_copied = SrcDev != DstDev
+#ifdef H2_TEST_WITH_GPU
+                         && !gpu::is_integrated()
+#endif
+    ;
+  if (is_copied)
+  {
+    // The cached copy is reused until the source is modified.
+    REQUIRE(dst_tensor->is_const_view());
+    REQUIRE(dst_tensor2->const_data() == dst_tensor->const_data());
+    write_ele<SrcDev>(
+      src_tensor.data(), 0, DataType{-1}, src_tensor.get_stream());
+    std::unique_ptr<TensorType> dst_tensor3 =
+      make_accessible_on_device(const_src, DstDev);
+    REQUIRE(dst_tensor3->const_data() != dst_tensor->const_data());
+    REQUIRE(read_ele<DstDev>(
+              dst_tensor3->const_data(), 0, dst_tensor3->get_stream())
+            == -1);
+  }
+  else
+  {
+    REQUIRE(dst_tensor2->const_data() == src_tensor.const_data());
+  }
+}
+
 TEMPLATE_LIST_TEST_CASE("make_accessible_on_device works with subviews",
                         "[tensor][copy]",
                         AllDevPairsList)
@@ -370,6 +430,155 @@ TEMPLATE_LIST_TEST_CASE("make_accessible_on_device works with subviews",
   }
 }
 
+TEMPLATE_LIST_TEST_CASE("Strided tensor copy works",
+                        "[tensor][copy]",
+                        AllDevPairsList)
+{
+  constexpr Device SrcDev = meta::tlist::At<TestType, 0>::value;
+  constexpr Device DstDev = meta::tlist::At<TestType, 1>::value;
+  using SrcTensorType = Tensor<DataType>;
+  using DstTensorType = Tensor<DataType>;
+
+  // Sizes are not multiples of the CPU tile size.
+  SrcTensorType src_tensor(SrcDev, {37, 45, 3}, {DT::Any, DT::Any, DT::Any});
+  for (DataIndexType i = 0; i < src_tensor.numel(); ++i)
+  {
+    write_ele<SrcDev>(src_tensor.data(),
+                      i,
+                      static_cast<DataType>(i),
+                      src_tensor.get_stream());
+  }
+
+  auto const check_copy = [](DstTensorType& dst, SrcTensorType& src) {
+    for_ndim(src.shape(), [&](ScalarIndexTuple const& i) {
+      REQUIRE(read_ele<DstDev>(dst.get(i), dst.get_stream())
+              == read_ele<SrcDev>(src.get(i), src.get_stream()));
+    });
+  };
+
+  SECTION("Gathering a sub-volume works")
+  {
+    auto src_view =
+      src_tensor.view({IRng{1, 30}, IRng{2, 40}, IRng{1, 3}});
+    DstTensorType dst_tensor(
+      DstDev, src_view->shape(), src_view->dim_types());
+    REQUIRE_NOTHROW(copy_strided_buffer(dst_tensor.data(),
+                                        dst_tensor.strides(),
+                                        dst_tensor.get_stream(),
+                                        src_view->const_data(),
+                                        src_view->strides(),
+                                        src_view->get_stream(),
+                                        src_view->shape()));
+    check_copy(dst_tensor, *src_view);
+  }
+
+  SECTION("Transposing works")
+  {
+    DstTensorType dst_tensor(DstDev,
+                             src_tensor.shape(),
+                             src_tensor.dim_types(),
+                             StrideTuple{45 * 3, 3, 1});
+    REQUIRE_NOTHROW(copy_strided_buffer(dst_tensor.data(),
+                                        dst_tensor.strides(),
+                                        dst_tensor.get_stream(),
+                                        src_tensor.const_data(),
+                                        src_tensor.strides(),
+                                        src_tensor.get_stream(),
+                                        src_tensor.shape()));
+    check_copy(dst_tensor, src_tensor);
+  }
+
+  SECTION("Copying into a view works")
+  {
+    constexpr DataType dst_val = static_cast<DataType>(-1);
+    DstTensorType dst_tensor(DstDev, {40, 50, 4}, {DT::Any, DT::Any, DT::Any});
+    write_ele<DstDev>(dst_tensor.data(), 0, dst_val, dst_tensor.get_stream());
+    auto dst_view =
+      dst_tensor.view({IRng{2, 39}, IRng{3, 48}, IRng{1, 4}});
+
+    REQUIRE_NOTHROW(copy(*dst_view, src_tensor));
+
+    REQUIRE(dst_view->shape() == src_tensor.shape());
+    REQUIRE(dst_view->strides() == StrideTuple{1, 40, 40 * 50});
+    check_copy(*dst_view, src_tensor);
+    // Elements outside the view are not touched.
+    REQUIRE(read_ele<DstDev>(dst_tensor.data(), 0, dst_tensor.get_stream())
+            == dst_val);
+  }
+
+  SECTION("Copying into a view with a different shape fails")
+  {
+    DstTensorType dst_tensor(DstDev, {40, 50, 4}, {DT::Any, DT::Any, DT::Any});
+    auto dst_view = dst_tensor.view({IRng{2, 38}, ALL, IRng{1, 4}});
+    REQUIRE_THROWS(copy(*dst_view, src_tensor));
+  }
+}
+
+namespace
+{
+
+template <Device SrcDev, Device DstDev, typename SrcT, typename DstT>
+void check_converting_copy()
+{
+  Tensor<SrcT> src_tensor(SrcDev, {5, 7}, {DT::Sample, DT::Any});
+  for (DataIndexType i = 0; i < src_tensor.numel(); ++i)
+  {
+    write_ele<SrcDev>(src_tensor.data(),
+                      i,
+                      static_cast<SrcT>(0.25 * i),
+                      src_tensor.get_stream());
+  }
+  auto const check_values = [&](Tensor<DstT>& dst) {
+    for_ndim(src_tensor.shape(), [&](ScalarIndexTuple const& i) {
+      REQUIRE(read_ele<DstDev>(dst.get(i), dst.get_stream())
+              == static_cast<DstT>(
+                read_ele<SrcDev>(src_tensor.get(i), src_tensor.get_stream())));
+    });
+  };
+
+  Tensor<DstT> dst_tensor(DstDev, {2, 2}, {DT::Any, DT::Any});
+  REQUIRE_NOTHROW(copy(dst_tensor, src_tensor));
+  REQUIRE(dst_tensor.shape() == src_tensor.shape());
+  REQUIRE(dst_tensor.dim_types() == src_tensor.dim_types());
+  REQUIRE(dst_tensor.strides() == src_tensor.strides());
+  REQUIRE(dst_tensor.get_device() == DstDev);
+  check_values(dst_tensor);
+
+  Tensor<DstT> big_tensor(DstDev, {8, 9}, {DT::Any, DT::Any});
+  auto dst_view = big_tensor.view({IRng{1, 6}, IRng{2, 9}});
+  REQUIRE_NOTHROW(copy(*dst_view, src_tensor));
+  check_values(*dst_view);
+
+  // Through BaseTensors.
+  Tensor<DstT> base_dst_tensor(DstDev);
+  BaseTensor& base_dst = base_dst_tensor;
+  REQUIRE_NOTHROW(copy(base_dst, static_cast<BaseTensor const&>(src_tensor)));
+  check_values(base_dst_tensor);
+}
+
+}  // anonymous namespace
+
+TEMPLATE_LIST_TEST_CASE("Different-type tensor copy works",
+                        "[tensor][copy]",
+                        AllDevPairsList)
+{
+  constexpr Device SrcDev = meta::tlist::At<TestType, 0>::value;
+  constexpr Device DstDev = meta::tlist::At<TestType, 1>::value;
+
+  SECTION("Narrowing copies work")
+  {
+    check_converting_copy<SrcDev, DstDev, double, float>();
+  }
+  SECTION("Widening copies work")
+  {
+    check_converting_copy<SrcDev, DstDev, std::int32_t, double>();
+  }
+  SECTION("Same-size copies work")
+  {
+    check_converting_copy<SrcDev, DstDev, float, std::int32_t>();
+  }
+}
+
 #ifdef H2_TEST_WITH_GPU
 
 TEST_CASE("GPU-GPU copy synchronizes correctly", "[tensor][copy]")
@@ -453,6 +662,77 @@ TEST_CASE("GPU-CPU copy synchronzies correctly", "[tensor][copy]")
   }
 }
 
+TEST_CASE("GPU-GPU copy between devices works", "[tensor][copy]")
+{
+  if (gpu::num_gpus() < 2)
+  {
+    SKIP("Requires at least two GPUs");
+  }
+  constexpr std::size_t buf_size = 1024;
+  int const orig_gpu = gpu::current_gpu();
+  int const peer_gpu = (orig_gpu == 0) ? 1 : 0;
+
+  ComputeStream stream = create_new_compute_stream<Device::GPU>();
+  DeviceBuf<DataType, Device::GPU> buf{buf_size};
+  gpu::set_gpu(peer_gpu);
+  ComputeStream peer_stream = create_new_compute_stream<Device::GPU>();
+  auto* peer_buf =
+    static_cast<DataType*>(gpu::mem_alloc(buf_size * sizeof(DataType)));
+  gpu::set_gpu(orig_gpu);
+
+  buf.fill(static_cast<DataType>(1));
+  REQUIRE_NOTHROW(
+    copy_buffer(peer_buf, peer_stream, buf.buf, stream, buf_size));
+  buf.fill(static_cast<DataType>(2));
+  REQUIRE_NOTHROW(copy_buffer(buf.buf, stream, peer_buf, peer_stream, 2));
+  for (std::size_t i = 0; i < buf_size; ++i)
+  {
+    REQUIRE(read_ele<Device::GPU>(buf.buf, i, stream)
+            == static_cast<DataType>(i < 2 ? 1 : 2));
+  }
+
+  gpu::set_gpu(peer_gpu);
+  peer_stream.wait_for_this();
+  gpu::mem_free(peer_buf);
+  gpu::set_gpu(orig_gpu);
+}
+
+TEST_CASE("Large pageable host-GPU copy works", "[tensor][copy]")
+{
+  // Larger than the default H2_COPY_PIPELINE_THRESHOLD, and not a
+  // multiple of the chunk size, so the copy is pipelined.
+  constexpr std::size_t buf_size = 10 * 1024 * 1024 + 3;
+  constexpr std::size_t change_i = 1;
+
+  ComputeStream stream = create_new_compute_stream<Device::GPU>();
+  DeviceBuf<DataType, Device::GPU> buf_gpu{buf_size};
+  std::vector<DataType> src(buf_size), dst(buf_size);
+  for (std::size_t i = 0; i < buf_size; ++i)
+  {
+    src[i] = static_cast<DataType>(i % 1024);
+  }
+
+  REQUIRE_NOTHROW(copy_buffer(
+    buf_gpu.buf, stream, src.data(), ComputeStream{Device::CPU}, buf_size));
+  // The copy back must wait for work already on the stream.
+  gpu_wait(0.001, stream);
+  write_ele_nosync<Device::GPU>(
+    buf_gpu.buf, change_i, static_cast<DataType>(3), stream);
+  REQUIRE_NOTHROW(copy_buffer(
+    dst.data(), ComputeStream{Device::CPU}, buf_gpu.buf, stream, buf_size));
+  stream.wait_for_this();
+  for (std::size_t i = 0; i < buf_size; ++i)
+  {
+    DataType const expected =
+      (i == change_i) ? static_cast<DataType>(3) : src[i];
+    if (dst[i] != expected)
+    {
+      // Avoid logging tens of millions of assertions.
+      REQUIRE(dst[i] == expected);
+    }
+  }
+}
+
 #endif  // H2_TEST_WITH_GPU
 
 TEMPLATE_LIST_TEST_CASE("Same-type cast works",
@@ -525,6 +805,37 @@ TEMPLATE_LIST_TEST_CASE("Different-type cast works",
   }
 }
 
+TEMPLATE_LIST_TEST_CASE("Different-type cast works with non-contiguous tensors",
+                        "[tensor][copy]",
+                        AllDevComputeTypePairsPairsList)
+{
+  constexpr Device Dev = meta::tlist::At<TestType, 0>::value;
+  using SrcType = meta::tlist::At<meta::tlist::At<TestType, 1>, 0>;
+  using DstType = meta::tlist::At<meta::tlist::At<TestType, 1>, 1>;
+  using SrcTensorType = Tensor<SrcType>;
+  using DstTensorType = Tensor<DstType>;
+
+  SrcTensorType src_tensor{Dev, {4, 6, 3}, {DT::Sample, DT::Any, DT::Any}};
+  for (DataIndexType i = 0; i < src_tensor.numel(); ++i)
+  {
+    write_ele<Dev>(src_tensor.data(),
+                   i,
+                   static_cast<SrcType>(i),
+                   src_tensor.get_stream());
+  }
+  auto view = src_tensor.view({IRng(1, 3), ALL, IRng(0, 2)});
+  REQUIRE_FALSE(view->is_contiguous());
+
+  std::unique_ptr<DstTensorType> cast_tensor = cast<DstType>(*view);
+  REQUIRE(cast_tensor->shape() == view->shape());
+  REQUIRE(cast_tensor->strides() == view->strides());
+  for_ndim(view->shape(), [&](ScalarIndexTuple const& i) {
+    REQUIRE(read_ele<Dev>(cast_tensor->get(i), cast_tensor->get_stream())
+            == static_cast<DstType>(
+              read_ele<Dev>(view->get(i), view->get_stream())));
+  });
+}
+
 TEMPLATE_LIST_TEST_CASE("Different-type cast works with constant tensors",
                         "[tensor][copy]",
                         AllDevComputeTypePairsPairsList)
@@ -676,3 +987,64 @@ TEMPLATE_LIST_TEST_CASE("Runtime cast through a BaseTensor works",
             == dst_val);
   }
 }
+
+namespace
+{
+
+template <Device Dev, typename SrcT, typename DstT>
+void check_cast_scale_bias()
+{
+  constexpr DstT scale = static_cast<DstT>(0.5);
+  constexpr DstT bias = static_cast<DstT>(-1);
+  Tensor<SrcT> src_tensor(Dev, {5, 7}, {DT::Sample, DT::Any});
+  for (DataIndexType i = 0; i < src_tensor.numel(); ++i)
+  {
+    write_ele<Dev>(
+      src_tensor.data(), i, static_cast<SrcT>(i), src_tensor.get_stream());
+  }
+  auto const check_values = [&](Tensor<DstT>& dst) {
+    for_ndim(src_tensor.shape(), [&](ScalarIndexTuple const& i) {
+      SrcT const val =
+        read_ele<Dev>(src_tensor.get(i), src_tensor.get_stream());
+      REQUIRE(read_ele<Dev>(dst.get(i), dst.get_stream())
+              == scale * static_cast<DstT>(val) + bias);
+    });
+  };
+
+  Tensor<DstT> dst_tensor(Dev, {2, 2}, {DT::Any, DT::Any});
+  REQUIRE_NOTHROW(cast_scale_bias(dst_tensor, src_tensor, scale, bias));
+  REQUIRE(dst_tensor.shape() == src_tensor.shape());
+  REQUIRE(dst_tensor.strides() == src_tensor.strides());
+  check_values(dst_tensor);
+
+  Tensor<DstT> big_tensor(Dev, {8, 9}, {DT::Any, DT::Any});
+  auto dst_view = big_tensor.view({IRng{1, 6}, IRng{2, 9}});
+  REQUIRE_NOTHROW(cast_scale_bias(*dst_view, src_tensor, scale, bias));
+  check_values(*dst_view);
+
+  auto small_view = big_tensor.view({IRng{1, 3}, IRng{2, 9}});
+  REQUIRE_THROWS(cast_scale_bias(*small_view, src_tensor, scale, bias));
+}
+
+}  // anonymous namespace
+
+TEMPLATE_LIST_TEST_CASE("cast_scale_bias works", "[tensor][copy]", AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+
+  SECTION("8-bit integer sources work")
+  {
+    check_cast_scale_bias<Dev, std::int8_t, float>();
+    check_cast_scale_bias<Dev, std::uint8_t, double>();
+  }
+  SECTION("16-bit integer sources work")
+  {
+    check_cast_scale_bias<Dev, std::uint16_t, float>();
+    check_cast_scale_bias<Dev, std::int16_t, double>();
+  }
+  SECTION("Floating point sources work")
+  {
+    check_cast_scale_bias<Dev, double, float>();
+    check_cast_scale_bias<Dev, float, float>();
+  }
+}
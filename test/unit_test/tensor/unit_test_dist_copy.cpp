@@ -6,7 +6,9 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "h2/tensor/copy.hpp"
+#include "h2/tensor/dist_utils.hpp"
 #include "h2/tensor/tensor.hpp"
+#include "h2/tensor/tensor_utils.hpp"
 #include "utils.hpp"
 
 #include "../mpi_utils.hpp"
@@ -201,3 +203,244 @@ TEMPLATE_LIST_TEST_CASE("Same-type distributed tensor copy works",
     });
   }
 }
+
+TEMPLATE_LIST_TEST_CASE("Redistributing distributed tensor copy works",
+                        "[dist-tensor][dist-copy]",
+                        AllDevPairsList)
+{
+  constexpr Device SrcDev = meta::tlist::At<TestType, 0>::value;
+  constexpr Device DstDev = meta::tlist::At<TestType, 1>::value;
+  using SrcTensorType = DistTensor<DataType>;
+  using DstTensorType = DistTensor<DataType>;
+
+  // Each element holds its global linear index.
+  auto get_val = [](ShapeTuple const& shape, ScalarIndexTuple const& idx) {
+    return static_cast<DataType>(
+      inner_product<DataIndexType>(idx, prefix_product<DataIndexType>(shape)));
+  };
+
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple src_grid_shape) {
+        // Also redistribute onto a transposed grid.
+        ShapeTuple dst_grid_shape = src_grid_shape;
+        for (ShapeTuple::size_type i = 0; i < src_grid_shape.size(); ++i)
+        {
+          dst_grid_shape[i] = src_grid_shape[src_grid_shape.size() - 1 - i];
+        }
+        ProcessorGrid src_grid = ProcessorGrid(comm, src_grid_shape);
+        ProcessorGrid dst_grid = ProcessorGrid(comm, dst_grid_shape);
+        ShapeTuple tensor_shape(8, 5, 12);
+        tensor_shape.set_size(src_grid.ndim());
+        DTTuple tensor_dim_types(TuplePad<DTTuple>(src_grid.ndim(), DT::Any));
+        for (Distribution src_dist : {Distribution::Block,
+                                      Distribution::Replicated,
+                                      Distribution::Single})
+        {
+          for (Distribution dst_dist : {Distribution::Block,
+                                        Distribution::Replicated,
+                                        Distribution::Single})
+          {
+            DistTTuple src_tensor_dist(
+              TuplePad<DistTTuple>(src_grid.ndim(), src_dist));
+            DistTTuple dst_tensor_dist(
+              TuplePad<DistTTuple>(src_grid.ndim(), dst_dist));
+            SrcTensorType src_tensor = SrcTensorType(SrcDev,
+                                                     tensor_shape,
+                                                     tensor_dim_types,
+                                                     src_grid,
+                                                     src_tensor_dist);
+            DstTensorType dst_tensor = DstTensorType(DstDev,
+                                                     tensor_shape,
+                                                     tensor_dim_types,
+                                                     dst_grid,
+                                                     dst_tensor_dist);
+
+            Tensor<DataType>& src_local = src_tensor.local_tensor();
+            for_ndim(src_local.shape(), [&](ScalarIndexTuple const& idx) {
+              write_ele<SrcDev>(
+                src_local.get(idx),
+                0,
+                get_val(tensor_shape,
+                        h2::internal::local2global_index(tensor_shape,
+                                                         src_grid,
+                                                         src_tensor_dist,
+                                                         src_grid.rank(),
+                                                         idx)),
+                src_local.get_stream());
+            });
+
+            REQUIRE_NOTHROW(copy(dst_tensor, src_tensor));
+
+            REQUIRE(dst_tensor.shape() == tensor_shape);
+            REQUIRE(dst_tensor.distribution() == dst_tensor_dist);
+            REQUIRE(dst_tensor.proc_grid() == dst_grid);
+            REQUIRE(dst_tensor.local_shape()
+                    == h2::internal::get_local_shape(
+                      tensor_shape, dst_grid, dst_tensor_dist));
+
+            Tensor<DataType>& dst_local = dst_tensor.local_tensor();
+            for_ndim(dst_local.shape(), [&](ScalarIndexTuple const& idx) {
+              REQUIRE(
+                read_ele<DstDev>(dst_local.get(idx), 0, dst_local.get_stream())
+                == get_val(tensor_shape,
+                           h2::internal::local2global_index(tensor_shape,
+                                                            dst_grid,
+                                                            dst_tensor_dist,
+                                                            dst_grid.rank(),
+                                                            idx)));
+            });
+          }
+        }
+      },
+      comm);
+  });
+}
+
+TEMPLATE_LIST_TEST_CASE("Redistributing distributed tensors works",
+                        "[dist-tensor][dist-copy]",
+                        AllDevPairsList)
+{
+  constexpr Device SrcDev = meta::tlist::At<TestType, 0>::value;
+  constexpr Device DstDev = meta::tlist::At<TestType, 1>::value;
+  using SrcTensorType = DistTensor<DataType>;
+  using DstTensorType = DistTensor<DataType>;
+
+  // Each element holds its global linear index.
+  auto get_val = [](ShapeTuple const& shape, ScalarIndexTuple const& idx) {
+    return static_cast<DataType>(
+      inner_product<DataIndexType>(idx, prefix_product<DataIndexType>(shape)));
+  };
+
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple grid_shape) {
+        ProcessorGrid grid = ProcessorGrid(comm, grid_shape);
+        ShapeTuple tensor_shape(7, 5, 12);
+        tensor_shape.set_size(grid.ndim());
+        DTTuple tensor_dim_types(TuplePad<DTTuple>(grid.ndim(), DT::Any));
+        DistTTuple src_tensor_dist(
+          TuplePad<DistTTuple>(grid.ndim(), Distribution::Block));
+        DistTTuple dst_tensor_dist(
+          TuplePad<DistTTuple>(grid.ndim(), Distribution::Replicated));
+        dst_tensor_dist[0] = Distribution::Block;
+        SrcTensorType src_tensor = SrcTensorType(
+          SrcDev, tensor_shape, tensor_dim_types, grid, src_tensor_dist);
+        DstTensorType dst_tensor = DstTensorType(
+          DstDev, tensor_shape, tensor_dim_types, grid, dst_tensor_dist);
+
+        Tensor<DataType>& src_local = src_tensor.local_tensor();
+        for_ndim(src_local.shape(), [&](ScalarIndexTuple const& idx) {
+          write_ele<SrcDev>(src_local.get(idx),
+                            0,
+                            get_val(tensor_shape,
+                                    h2::internal::local2global_index(
+                                      tensor_shape,
+                                      grid,
+                                      src_tensor_dist,
+                                      grid.rank(),
+                                      idx)),
+                            src_local.get_stream());
+        });
+
+        // Redistribute twice to check the cached plan gives the same
+        // result.
+        for (int i = 0; i < 2; ++i)
+        {
+          REQUIRE_NOTHROW(redistribute(dst_tensor, src_tensor));
+          REQUIRE(dst_tensor.distribution() == dst_tensor_dist);
+          REQUIRE(dst_tensor.proc_grid() == grid);
+
+          Tensor<DataType>& dst_local = dst_tensor.local_tensor();
+          for_ndim(dst_local.shape(), [&](ScalarIndexTuple const& idx) {
+            REQUIRE(read_ele<DstDev>(
+                      dst_local.get(idx), 0, dst_local.get_stream())
+                    == get_val(tensor_shape,
+                               h2::internal::local2global_index(
+                                 tensor_shape,
+                                 grid,
+                                 dst_tensor_dist,
+                                 grid.rank(),
+                                 idx)));
+          });
+        }
+
+        DstTensorType bad_tensor =
+          DstTensorType(DstDev,
+                        ShapeTuple(TuplePad<ShapeTuple>(grid.ndim(), 3)),
+                        tensor_dim_types,
+                        grid,
+                        dst_tensor_dist);
+        REQUIRE_THROWS(redistribute(bad_tensor, src_tensor));
+      },
+      comm);
+  });
+}
+
+TEMPLATE_LIST_TEST_CASE("Redistributing to and from Cyclic works",
+                        "[dist-tensor][dist-copy]",
+                        AllDevPairsList)
+{
+  constexpr Device SrcDev = meta::tlist::At<TestType, 0>::value;
+  constexpr Device DstDev = meta::tlist::At<TestType, 1>::value;
+  using TensorType = DistTensor<DataType>;
+
+  auto get_val = [](ShapeTuple const& shape, ScalarIndexTuple const& idx) {
+    return static_cast<DataType>(
+      inner_product<DataIndexType>(idx, prefix_product<DataIndexType>(shape)));
+  };
+
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple grid_shape) {
+        ProcessorGrid grid = ProcessorGrid(comm, grid_shape);
+        ShapeTuple tensor_shape(7, 5, 12);
+        tensor_shape.set_size(grid.ndim());
+        DTTuple tensor_dim_types(TuplePad<DTTuple>(grid.ndim(), DT::Any));
+        DistTTuple block_dist(
+          TuplePad<DistTTuple>(grid.ndim(), Distribution::Block));
+        DistTTuple cyclic_dist(
+          TuplePad<DistTTuple>(grid.ndim(), Distribution::Cyclic));
+        TensorType src_tensor = TensorType(
+          SrcDev, tensor_shape, tensor_dim_types, grid, block_dist);
+        TensorType cyclic_tensor = TensorType(
+          DstDev, tensor_shape, tensor_dim_types, grid, cyclic_dist);
+        TensorType block_tensor = TensorType(
+          SrcDev, tensor_shape, tensor_dim_types, grid, block_dist);
+
+        Tensor<DataType>& src_local = src_tensor.local_tensor();
+        for_ndim(src_local.shape(), [&](ScalarIndexTuple const& idx) {
+          write_ele<SrcDev>(
+            src_local.get(idx),
+            0,
+            get_val(tensor_shape,
+                    h2::internal::local2global_index(
+                      tensor_shape, grid, block_dist, grid.rank(), idx)),
+            src_local.get_stream());
+        });
+
+        REQUIRE_NOTHROW(redistribute(cyclic_tensor, src_tensor));
+        Tensor<DataType>& cyclic_local = cyclic_tensor.local_tensor();
+        for_ndim(cyclic_local.shape(), [&](ScalarIndexTuple const& idx) {
+          REQUIRE(read_ele<DstDev>(
+                    cyclic_local.get(idx), 0, cyclic_local.get_stream())
+                  == get_val(tensor_shape,
+                             h2::internal::local2global_index(
+                               tensor_shape,
+                               grid,
+                               cyclic_dist,
+                               grid.rank(),
+                               idx)));
+        });
+
+        REQUIRE_NOTHROW(redistribute(block_tensor, cyclic_tensor));
+        Tensor<DataType>& block_local = block_tensor.local_tensor();
+        for_ndim(block_local.shape(), [&](ScalarIndexTuple const& idx) {
+          REQUIRE(
+            read_ele<SrcDev>(block_local.get(idx), 0, block_local.get_stream())
+            == read_ele<SrcDev>(src_local.get(idx), 0, src_local.get_stream()));
+        });
+      },
+      comm);
+  });
+}
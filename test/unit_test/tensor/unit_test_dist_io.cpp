@@ -0,0 +1,163 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/dist_io.hpp"
+#include "h2/tensor/dist_tensor.hpp"
+#include "h2/tensor/io.hpp"
+#include "utils.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#include "../mpi_utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+namespace
+{
+
+// Value of an element of a checkpointed tensor at a global coordinate.
+DataType global_value(ShapeTuple const& shape, ScalarIndexTuple const& coord)
+{
+  return static_cast<DataType>(
+    inner_product<DataIndexType>(coord, get_contiguous_strides(shape)));
+}
+
+template <Device Dev>
+void fill_with_global_values(DistTensor<DataType>& tensor)
+{
+  if (tensor.is_local_empty())
+  {
+    return;
+  }
+  IndexRangeTuple const indices = internal::get_global_indices(
+    tensor.shape(), tensor.proc_grid(), tensor.distribution());
+  Tensor<DataType>& local = tensor.local_tensor();
+  for_ndim(local.shape(), [&](ScalarIndexTuple const& c) {
+    ScalarIndexTuple global = c;
+    for (typename ScalarIndexTuple::size_type i = 0; i < c.size(); ++i)
+    {
+      global[i] += indices[i].start();
+    }
+    write_ele<Dev>(local.get(c),
+                   0,
+                   global_value(tensor.shape(), global),
+                   local.get_stream());
+  });
+}
+
+template <Device Dev>
+bool has_global_values(DistTensor<DataType>& tensor)
+{
+  if (tensor.is_local_empty())
+  {
+    return true;
+  }
+  IndexRangeTuple const indices = internal::get_global_indices(
+    tensor.shape(), tensor.proc_grid(), tensor.distribution());
+  Tensor<DataType>& local = tensor.local_tensor();
+  bool ok = true;
+  for_ndim(local.shape(), [&](ScalarIndexTuple const& c) {
+    ScalarIndexTuple global = c;
+    for (typename ScalarIndexTuple::size_type i = 0; i < c.size(); ++i)
+    {
+      global[i] += indices[i].start();
+    }
+    ok = ok
+         && read_ele<Dev>(local.get(c), local.get_stream())
+              == global_value(tensor.shape(), global);
+  });
+  return ok;
+}
+
+}  // anonymous namespace
+
+TEMPLATE_LIST_TEST_CASE("Distributed tensor checkpoints work",
+                        "[dist-tensor][io]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using DistTensorType = DistTensor<DataType>;
+
+  for_comms([&](Comm& comm) {
+    std::string const path =
+      (std::filesystem::temp_directory_path()
+       / ("h2_dist_io_test_" + std::to_string(comm.Size()) + ".bin"))
+        .string();
+    for_grid_shapes(
+      [&](ShapeTuple grid_shape) {
+        ProcessorGrid grid = ProcessorGrid(comm, grid_shape);
+        ShapeTuple tensor_shape(8, 5, 12);
+        tensor_shape.set_size(grid.ndim());
+        DTTuple tensor_dim_types(TuplePad<DTTuple>(grid.ndim(), DT::Any));
+        DistTTuple block_dist(
+          TuplePad<DistTTuple>(grid.ndim(), Distribution::Block));
+        DistTensorType tensor(
+          Dev, tensor_shape, tensor_dim_types, grid, block_dist);
+        fill_with_global_values<Dev>(tensor);
+        write_checkpoint(path, tensor);
+
+        // Read back with the same distribution.
+        DistTensorType same_tensor(Dev, grid);
+        read_checkpoint(path, same_tensor);
+        REQUIRE(same_tensor.shape() == tensor_shape);
+        REQUIRE(same_tensor.dim_types() == tensor_dim_types);
+        REQUIRE(same_tensor.local_shape() == tensor.local_shape());
+        REQUIRE(has_global_values<Dev>(same_tensor));
+
+        // Read back with a different distribution.
+        DistTTuple other_dist(
+          TuplePad<DistTTuple>(grid.ndim(), Distribution::Replicated));
+        other_dist[0] = Distribution::Block;
+        DistTensorType other_tensor(
+          Dev, tensor_shape, tensor_dim_types, grid, other_dist);
+        read_checkpoint(path, other_tensor);
+        REQUIRE(other_tensor.distribution() == other_dist);
+        REQUIRE(has_global_values<Dev>(other_tensor));
+
+        // Checkpoints are ordinary serialized tensors.
+        if (comm.Rank() == 0)
+        {
+          std::ifstream in(path, std::ios::binary);
+          Tensor<DataType> global_tensor(Dev);
+          deserialize(in, global_tensor);
+          REQUIRE(global_tensor.shape() == tensor_shape);
+          bool ok = true;
+          for_ndim(tensor_shape, [&](ScalarIndexTuple const& c) {
+            ok = ok
+                 && read_ele<Dev>(global_tensor.get(c),
+                                  global_tensor.get_stream())
+                      == global_value(tensor_shape, c);
+          });
+          REQUIRE(ok);
+        }
+
+        // Replicated data is written once and reads back correctly.
+        DistTTuple rep_dist(
+          TuplePad<DistTTuple>(grid.ndim(), Distribution::Replicated));
+        DistTensorType rep_tensor(
+          Dev, tensor_shape, tensor_dim_types, grid, rep_dist);
+        fill_with_global_values<Dev>(rep_tensor);
+        write_checkpoint(path, rep_tensor);
+        DistTensorType block_tensor(Dev, grid);
+        read_checkpoint(path, block_tensor);
+        REQUIRE(block_tensor.distribution()
+                == DistTTuple(TuplePad<DistTTuple>(grid.ndim(),
+                                                   Distribution::Block)));
+        REQUIRE(has_global_values<Dev>(block_tensor));
+      },
+      comm,
+      1,
+      3);
+    if (comm.Rank() == 0)
+    {
+      std::filesystem::remove(path);
+    }
+  });
+}
@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/init/random.hpp"
+#include "utils.hpp"
+
+#include "../mpi_utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+TEMPLATE_LIST_TEST_CASE("Random fills of distributed tensors are grid-agnostic",
+                        "[dist-tensor][random]",
+                        AllDevList)
+{
+  using DistTensorType = DistTensor<DataType>;
+  constexpr Device Dev = TestType::value;
+
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple grid_shape) {
+        ProcessorGrid grid = ProcessorGrid(comm, grid_shape);
+        ShapeTuple tensor_shape(8, 5, 12);
+        tensor_shape.set_size(grid.ndim());
+        DTTuple tensor_dim_types(TuplePad<DTTuple>(grid.ndim(), DT::Any));
+
+        // Every distribution should match a local tensor.
+        Tensor<DataType> ref_tensor(Dev, tensor_shape, tensor_dim_types);
+        fill_uniform(ref_tensor, DataType(-1), DataType(1), 42);
+
+        for (Distribution dist : {Distribution::Block,
+                                  Distribution::Replicated,
+                                  Distribution::Single})
+        {
+          DistTTuple tensor_dist(TuplePad<DistTTuple>(grid.ndim(), dist));
+          DistTensorType tensor = DistTensorType(
+            Dev, tensor_shape, tensor_dim_types, grid, tensor_dist);
+          REQUIRE_NOTHROW(
+            fill_uniform(tensor, DataType(-1), DataType(1), 42));
+
+          if (tensor.is_local_empty())
+          {
+            continue;
+          }
+          Tensor<DataType>& local_tensor = tensor.local_tensor();
+          for_ndim(local_tensor.shape(), [&](ScalarIndexTuple const& idx) {
+            ScalarIndexTuple const global_idx =
+              h2::internal::local2global_index(
+                tensor_shape, grid, tensor_dist, grid.rank(), idx);
+            REQUIRE(read_ele<Dev>(local_tensor.get(idx),
+                                  local_tensor.get_stream())
+                    == read_ele<Dev>(ref_tensor.get(global_idx),
+                                     ref_tensor.get_stream()));
+          });
+        }
+      },
+      comm,
+      0,
+      3);
+  });
+}
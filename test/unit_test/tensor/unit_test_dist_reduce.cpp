@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/reduce.hpp"
+#include "utils.hpp"
+
+#include "../mpi_utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+
+using namespace h2;
+
+namespace
+{
+
+DataIndexType linear_index(ScalarIndexTuple const& coord,
+                           StrideTuple const& strides)
+{
+  DataIndexType index = 0;
+  for (typename ShapeTuple::size_type d = 0; d < coord.size(); ++d)
+  {
+    index += coord[d] * strides[d];
+  }
+  return index;
+}
+
+}  // anonymous namespace
+
+TEMPLATE_LIST_TEST_CASE("Reducing distributed tensors works",
+                        "[tensor][reduce]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple grid_shape) {
+        ProcessorGrid grid = ProcessorGrid(comm, grid_shape);
+        ShapeTuple global_shape(8, 5, 12);
+        global_shape.set_size(grid.ndim());
+        DTTuple dim_types(TuplePad<DTTuple>(grid.ndim(), DT::Any));
+        StrideTuple const global_strides = get_contiguous_strides(global_shape);
+        DimensionOrderTuple all_dims;
+        for (typename ShapeTuple::size_type d = 0; d < grid.ndim(); ++d)
+        {
+          all_dims.append(d);
+        }
+
+        for (Distribution dist : {Distribution::Block,
+                                  Distribution::Cyclic,
+                                  Distribution::Replicated,
+                                  Distribution::Single})
+        {
+          DistTTuple dists(TuplePad<DistTTuple>(grid.ndim(), dist));
+          DistTensor<float> src(Dev, global_shape, dim_types, grid, dists);
+          // Each element is its global linear index.
+          if (!src.is_local_empty())
+          {
+            for_ndim(src.local_shape(), [&](ScalarIndexTuple const& coord) {
+              ScalarIndexTuple const global = h2::internal::local2global_index(
+                global_shape, grid, dists, grid.rank(), coord);
+              write_ele<Dev>(
+                src.local_tensor().get(coord),
+                0,
+                static_cast<float>(linear_index(global, global_strides)),
+                src.get_stream());
+            });
+          }
+
+          for (ReductionOp op :
+               {ReductionOp::Sum, ReductionOp::Max, ReductionOp::Mean})
+          {
+            for (DimensionOrderTuple const& dims :
+                 {DimensionOrderTuple{0}, all_dims})
+            {
+              auto dst = reduce(src, dims, op);
+              ShapeTuple const dst_shape =
+                h2::internal::get_reduced_shape(global_shape, dims, true);
+              REQUIRE(dst->shape() == dst_shape);
+              REQUIRE(dst->proc_grid() == grid);
+              DistTTuple const dst_dists = dst->distribution();
+              for (auto d : dims)
+              {
+                REQUIRE(dst_dists[d] == Distribution::Replicated);
+              }
+              if (dst->is_local_empty())
+              {
+                continue;
+              }
+
+              // The reduced part of the global tensor.
+              ShapeTuple const reduced_shape =
+                map_index(global_shape, [&](typename ShapeTuple::size_type d) {
+                  return h2::internal::is_reduced_dim(dims, d)
+                           ? global_shape[d]
+                           : DimType{1};
+                });
+              DataIndexType const count = product<DataIndexType>(reduced_shape);
+              for_ndim(dst->local_shape(), [&](ScalarIndexTuple const& coord) {
+                ScalarIndexTuple const global =
+                  h2::internal::local2global_index(
+                    dst_shape, grid, dst_dists, grid.rank(), coord);
+                float expected = (op == ReductionOp::Max) ? -1.0f : 0.0f;
+                for_ndim(reduced_shape, [&](ScalarIndexTuple const& offset) {
+                  float const val = static_cast<float>(
+                    linear_index(global, global_strides)
+                    + linear_index(offset, global_strides));
+                  expected = (op == ReductionOp::Max) ? std::max(expected, val)
+                                                      : expected + val;
+                });
+                if (op == ReductionOp::Mean)
+                {
+                  expected /= static_cast<float>(count);
+                }
+                REQUIRE(read_ele<Dev>(dst->local_tensor().get(coord),
+                                      dst->get_stream())
+                        == expected);
+              });
+            }
+          }
+        }
+      },
+      comm,
+      0,
+      3);
+  });
+}
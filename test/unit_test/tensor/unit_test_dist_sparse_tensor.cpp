@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/sparse_tensor.hpp"
+#include "utils.hpp"
+
+#include "../mpi_utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+using namespace h2;
+
+TEMPLATE_LIST_TEST_CASE("Distributing sparse tensors works",
+                        "[tensor][sparse]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple grid_shape) {
+        for (Distribution dist : {Distribution::Block, Distribution::Single})
+        {
+          ProcessorGrid grid = ProcessorGrid(comm, grid_shape);
+          ShapeTuple global_shape(8, 5, 12);
+          global_shape.set_size(grid.ndim());
+          DTTuple dim_types(TuplePad<DTTuple>(grid.ndim(), DT::Any));
+          DistTTuple dists(TuplePad<DistTTuple>(grid.ndim(), dist));
+
+          // Every third entry is a nonzero with value its index plus
+          // one, held round-robin by the ranks.
+          std::vector<DataIndexType> indices;
+          std::vector<float> values;
+          DataIndexType const numel = product<DataIndexType>(global_shape);
+          for (DataIndexType i = 0; i < numel; i += 3)
+          {
+            if ((i / 3) % comm.Size() == comm.Rank())
+            {
+              indices.push_back(i);
+              values.push_back(static_cast<float>(i + 1));
+            }
+          }
+          SparseTensor<float> src(
+            Dev, global_shape, dim_types, indices, values);
+
+          auto local = distribute_sparse(src, grid, dists);
+          REQUIRE(local->shape()
+                  == h2::internal::get_local_shape(global_shape, grid, dists));
+          local->get_nonzeros(indices, values);
+          DataIndexType expected_nnz = 0;
+          for_ndim(local->shape(), [&](ScalarIndexTuple const& coord) {
+            DataIndexType const global_index = src.get_index(
+              h2::internal::local2global_index(
+                global_shape, grid, dists, grid.rank(), coord));
+            if (global_index % 3 == 0)
+            {
+              ++expected_nnz;
+            }
+          });
+          REQUIRE(local->nnz() == expected_nnz);
+          for (std::size_t i = 0; i < indices.size(); ++i)
+          {
+            DataIndexType const global_index = src.get_index(
+              h2::internal::local2global_index(global_shape,
+                                           grid,
+                                           dists,
+                                           grid.rank(),
+                                           local->get_coord(indices[i])));
+            REQUIRE(global_index % 3 == 0);
+            REQUIRE(values[i] == static_cast<float>(global_index + 1));
+          }
+        }
+      },
+      comm,
+      0,
+      3);
+  });
+}
@@ -5,13 +5,18 @@
 // SPDX-License-Identifier: Apache-2.0
 ////////////////////////////////////////////////////////////////////////////////
 
+#include "h2/tensor/comm_plan_cache.hpp"
+#include "h2/tensor/dist_index_map.hpp"
 #include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/rebalance.hpp"
 #include "utils.hpp"
 
 #include <catch2/catch_template_test_macros.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/generators/catch_generators.hpp>
 
+#include <vector>
+
 using namespace h2;
 
 TEST_CASE("Dimension local size works", "[dist-tensor][utils]")
@@ -173,3 +178,196 @@ TEST_CASE("Dimension local-to-global index works", "[dist-tensor][utils]")
   REQUIRE(h2::internal::dim_local2global_index<Distribution::Single>(4, 2, 0, 3)
           == 3);
 }
+
+TEST_CASE("Cyclic dimension utilities work", "[dist-tensor][utils]")
+{
+  using h2::internal::dim_global2local_index;
+  using h2::internal::dim_global2rank;
+  using h2::internal::dim_local2global_index;
+  using h2::internal::get_dim_global_indices;
+  using h2::internal::get_dim_local_size;
+
+  REQUIRE(get_dim_local_size<Distribution::Cyclic>(5, 2, 0, false) == 3);
+  REQUIRE(get_dim_local_size<Distribution::Cyclic>(5, 2, 1, false) == 2);
+  REQUIRE(get_dim_local_size<Distribution::Cyclic>(2, 3, 2, false) == 0);
+
+  REQUIRE(get_dim_global_indices<Distribution::Cyclic>(5, 2, 0, false)
+          == IRng(0, 5));
+  REQUIRE(get_dim_global_indices<Distribution::Cyclic>(5, 2, 1, false)
+          == IRng(1, 4));
+  REQUIRE(get_dim_global_indices<Distribution::Cyclic>(2, 3, 2, false)
+          == IRng());
+
+  // Every global index maps to a rank and local index and back.
+  for (DimType grid_dim_size = 1; grid_dim_size < 5; ++grid_dim_size)
+  {
+    DimType total_size = 0;
+    for (RankType rank = 0; rank < grid_dim_size; ++rank)
+    {
+      total_size += get_dim_local_size<Distribution::Cyclic>(
+        11, grid_dim_size, rank, false);
+    }
+    REQUIRE(total_size == 11);
+    for (DimType i = 0; i < 11; ++i)
+    {
+      RankType const rank =
+        dim_global2rank<Distribution::Cyclic>(11, grid_dim_size, i);
+      DimType const local_index =
+        dim_global2local_index<Distribution::Cyclic>(11, grid_dim_size, i);
+      REQUIRE(rank == i % grid_dim_size);
+      REQUIRE(local_index < get_dim_local_size<Distribution::Cyclic>(
+                11, grid_dim_size, rank, false));
+      REQUIRE(dim_local2global_index<Distribution::Cyclic>(
+                11, grid_dim_size, rank, local_index)
+              == i);
+    }
+  }
+}
+
+TEST_CASE("Variable dimension utilities work", "[dist-tensor][utils]")
+{
+  using h2::internal::get_variable_block_rank;
+  using h2::internal::get_variable_block_start;
+
+  BlockSizes const sizes = {3, 0, 5, 2};
+  REQUIRE(get_variable_block_start(sizes, 0) == 0);
+  REQUIRE(get_variable_block_start(sizes, 1) == 3);
+  REQUIRE(get_variable_block_start(sizes, 2) == 3);
+  REQUIRE(get_variable_block_start(sizes, 3) == 8);
+  for (DimType i = 0; i < 10; ++i)
+  {
+    RankType const rank = get_variable_block_rank(sizes, i);
+    REQUIRE(sizes[rank] > 0);
+    REQUIRE(get_variable_block_start(sizes, rank) <= i);
+    REQUIRE(i < get_variable_block_start(sizes, rank) + sizes[rank]);
+  }
+}
+
+TEST_CASE("Balanced block sizes work", "[dist-tensor][utils]")
+{
+  // Equal speeds keep the sizes.
+  REQUIRE(compute_balanced_block_sizes({4, 4}, {1.0, 1.0}) == BlockSizes{4, 4});
+  // A rank three times slower gets a third the indices.
+  REQUIRE(compute_balanced_block_sizes({4, 4}, {1.0, 3.0}) == BlockSizes{6, 2});
+  // Unmeasured ranks get the mean speed.
+  REQUIRE(compute_balanced_block_sizes({3, 0, 3}, {1.0, 0.0, 1.0})
+          == BlockSizes{2, 2, 2});
+  // Minimum sizes are respected and the total is preserved.
+  BlockSizes const sizes =
+    compute_balanced_block_sizes({5, 5, 5}, {1.0, 1.0, 100.0}, 2);
+  REQUIRE(sizes[2] == 2);
+  REQUIRE(sizes[0] + sizes[1] + sizes[2] == 15);
+  REQUIRE_THROWS(compute_balanced_block_sizes({4, 4}, {1.0}));
+}
+
+TEST_CASE("Communication plan caches work", "[dist-tensor][utils]")
+{
+  using h2::internal::CommPlanKey;
+  h2::internal::CommPlanCache<int> cache;
+  CommPlanKey const key{ShapeTuple{4, 6},
+                        ShapeTuple{2, 1},
+                        ShapeTuple{1, 2},
+                        0,
+                        DistTTuple{Distribution::Block, Distribution::Block},
+                        DistTTuple{Distribution::Block, Distribution::Block},
+                        4,
+                        DimensionOrderTuple{0, 1},
+                        DimensionOrderTuple{0, 1}};
+  CommPlanKey other_key = key;
+  other_key.dst_dist = DistTTuple{Distribution::Block, Distribution::Single};
+  CommPlanKey reordered_key = key;
+  reordered_key.src_grid_order = DimensionOrderTuple{1, 0};
+
+  int num_made = 0;
+  auto make_plan = [&]() { return ++num_made; };
+  REQUIRE(*cache.get(key, make_plan) == 1);
+  REQUIRE(*cache.get(key, make_plan) == 1);
+  REQUIRE(*cache.get(other_key, make_plan) == 2);
+  REQUIRE(*cache.get(key, make_plan) == 1);
+  REQUIRE(num_made == 2);
+  REQUIRE(cache.size() == 2);
+  REQUIRE(*cache.get(reordered_key, make_plan) == 3);
+  REQUIRE(cache.size() == 3);
+
+  cache.clear();
+  REQUIRE(*cache.get(key, make_plan) == 4);
+}
+
+TEST_CASE("Batched global-to-owner index mapping works",
+          "[dist-tensor][utils]")
+{
+  using h2::internal::make_global2owner_map;
+  using h2::internal::make_local2global_map;
+
+  ShapeTuple const global_shape{5, 7, 3};
+  ShapeTuple const grid_shape{2, 3, 2};
+  NDimTuple<RankType> const grid_strides{1, 2, 6};
+  ScalarIndexTuple const coords{1, 2, 1};
+  DistTTuple const dist = GENERATE(
+    DistTTuple{Distribution::Block, Distribution::Block, Distribution::Block},
+    DistTTuple{
+      Distribution::Block, Distribution::Replicated, Distribution::Single},
+    DistTTuple{
+      Distribution::Cyclic, Distribution::Block, Distribution::Replicated});
+  ComputeStream const stream{Device::CPU};
+
+  std::size_t const count = product<std::size_t>(global_shape);
+  std::vector<DimType> global_indices(count * global_shape.size());
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    DataIndexType rest = i;
+    for (std::size_t d = 0; d < global_shape.size(); ++d)
+    {
+      global_indices[d * count + i] = rest % global_shape[d];
+      rest /= global_shape[d];
+    }
+  }
+  std::vector<RankType> ranks(count);
+  std::vector<DataIndexType> local_offsets(count);
+  h2::internal::global2owner_indices_impl(
+    CPUDev_t{},
+    make_global2owner_map(global_shape, grid_shape, grid_strides, coords, dist),
+    count,
+    global_indices.data(),
+    ranks.data(),
+    local_offsets.data(),
+    stream);
+
+  std::vector<DimType> round_trip(global_shape.size());
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    ScalarIndexTuple owner_coords(TuplePad<ScalarIndexTuple>(3));
+    RankType rest = ranks[i];
+    for (std::size_t d = 0; d < grid_shape.size(); ++d)
+    {
+      owner_coords[d] = rest % grid_shape[d];
+      rest /= grid_shape[d];
+      DimType const global_index = global_indices[d * count + i];
+      if (dist[d] == Distribution::Block)
+      {
+        REQUIRE(owner_coords[d]
+                == h2::internal::dim_global2rank<Distribution::Block>(
+                  global_shape[d], grid_shape[d], global_index));
+      }
+      else if (dist[d] == Distribution::Replicated)
+      {
+        REQUIRE(owner_coords[d] == coords[d]);
+      }
+      else if (dist[d] == Distribution::Single)
+      {
+        REQUIRE(owner_coords[d] == 0);
+      }
+    }
+    h2::internal::local2global_indices_impl(
+      CPUDev_t{},
+      make_local2global_map(global_shape, grid_shape, owner_coords, dist),
+      1,
+      &local_offsets[i],
+      round_trip.data(),
+      stream);
+    for (std::size_t d = 0; d < global_shape.size(); ++d)
+    {
+      REQUIRE(round_trip[d] == global_indices[d * count + i]);
+    }
+  }
+}
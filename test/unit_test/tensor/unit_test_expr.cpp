@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/expr.hpp"
+#include "utils.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <type_traits>
+
+using namespace h2;
+
+namespace
+{
+
+template <typename T>
+Tensor<T> make_iota(ShapeTuple const& shape, T offset = T{0})
+{
+  Tensor<T> tensor(
+    Device::CPU, shape, DTTuple(TuplePad<DTTuple>(shape.size(), DT::Any)));
+  for (DataIndexType i = 0; i < tensor.numel(); ++i)
+  {
+    tensor.data()[i] = static_cast<T>(i) + offset;
+  }
+  return tensor;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("Lazy expressions have the right types", "[tensor][lazy]")
+{
+  Tensor<float> a(Device::CPU, {4}, {DT::Any});
+  Tensor<std::int32_t> b(Device::CPU, {4}, {DT::Any});
+  auto e = lazy::ref(a) * lazy::ref(b) + 2.0;
+  REQUIRE(e.num_leaves == 2);
+  REQUIRE(std::is_same_v<decltype(e)::value_type, double>);
+  REQUIRE(std::is_same_v<decltype(e)::LeafTypes,
+                         meta::TL<float, std::int32_t>>);
+  REQUIRE(std::is_same_v<decltype(lazy::ref(a) < 1.0f)::value_type, bool>);
+  REQUIRE(
+    std::is_same_v<decltype(lazy::cast<std::int32_t>(lazy::ref(a)))::value_type,
+                   std::int32_t>);
+  REQUIRE(std::get<0>(e.leaves()) == &a);
+  REQUIRE(std::get<1>(e.leaves()) == &b);
+}
+
+TEST_CASE("Lazy arithmetic works", "[tensor][lazy]")
+{
+  Tensor<float> a = make_iota<float>({3, 5});
+  Tensor<float> b = make_iota<float>({3, 5}, 1.0f);
+  Tensor<float> dst(Device::CPU, StrictAlloc);
+
+  REQUIRE_NOTHROW(lazy::assign(
+    dst, lazy::ref(a) * lazy::ref(b) + 2.0f - lazy::ref(a) / 2.0f));
+  REQUIRE(dst.shape() == a.shape());
+  for (DataIndexType i = 0; i < a.numel(); ++i)
+  {
+    float const av = static_cast<float>(i);
+    float const bv = av + 1.0f;
+    REQUIRE(dst.data()[i] == av * bv + 2.0f - av / 2.0f);
+  }
+
+  REQUIRE_NOTHROW(lazy::assign(dst, -lazy::ref(b)));
+  for (DataIndexType i = 0; i < a.numel(); ++i)
+  {
+    REQUIRE(dst.data()[i] == -static_cast<float>(i + 1));
+  }
+
+  // Scalar-only expressions fill the destination.
+  REQUIRE_NOTHROW(lazy::assign(dst, lazy::as_expr(3.0f) * 2.0f));
+  REQUIRE(dst.shape() == a.shape());
+  for (DataIndexType i = 0; i < a.numel(); ++i)
+  {
+    REQUIRE(dst.data()[i] == 6.0f);
+  }
+
+  // In-place.
+  REQUIRE_NOTHROW(lazy::assign(a, lazy::ref(a) * 3.0f));
+  for (DataIndexType i = 0; i < a.numel(); ++i)
+  {
+    REQUIRE(a.data()[i] == 3.0f * static_cast<float>(i));
+  }
+}
+
+TEST_CASE("Lazy comparisons, selection, and casts work", "[tensor][lazy]")
+{
+  Tensor<float> a = make_iota<float>({8}, -4.0f);
+  Tensor<std::int32_t> dst(Device::CPU, StrictAlloc);
+
+  REQUIRE_NOTHROW(lazy::assign(dst, lazy::ref(a) >= 0.0f));
+  for (DataIndexType i = 0; i < a.numel(); ++i)
+  {
+    REQUIRE(dst.data()[i] == (i >= 4 ? 1 : 0));
+  }
+
+  Tensor<float> relu(Device::CPU, StrictAlloc);
+  REQUIRE_NOTHROW(lazy::assign(
+    relu, lazy::where(lazy::ref(a) > 0.0f, lazy::ref(a), 0.0f)));
+  REQUIRE_NOTHROW(lazy::assign(
+    dst, lazy::cast<std::int32_t>(lazy::maximum(lazy::ref(a), 0.0f))));
+  for (DataIndexType i = 0; i < a.numel(); ++i)
+  {
+    float const expected = i > 4 ? static_cast<float>(i - 4) : 0.0f;
+    REQUIRE(relu.data()[i] == expected);
+    REQUIRE(dst.data()[i] == static_cast<std::int32_t>(expected));
+  }
+
+  REQUIRE_NOTHROW(
+    lazy::assign(relu, lazy::minimum(lazy::ref(a), -1.0f) * lazy::ref(a)));
+  for (DataIndexType i = 0; i < a.numel(); ++i)
+  {
+    float const av = static_cast<float>(i) - 4.0f;
+    REQUIRE(relu.data()[i] == (av < -1.0f ? av : -1.0f) * av);
+  }
+
+  auto const square = [](float v) { return v * v; };
+  REQUIRE_NOTHROW(lazy::assign(relu, lazy::map(square, lazy::ref(a)) + 1.0f));
+  for (DataIndexType i = 0; i < a.numel(); ++i)
+  {
+    float const av = static_cast<float>(i) - 4.0f;
+    REQUIRE(relu.data()[i] == av * av + 1.0f);
+  }
+}
+
+TEST_CASE("Lazy expressions work with views", "[tensor][lazy]")
+{
+  Tensor<float> a = make_iota<float>({6, 5});
+  Tensor<float> b = make_iota<float>({4, 3});
+  Tensor<float> dst(Device::CPU, {6, 5}, {DT::Any, DT::Any});
+  for (DataIndexType i = 0; i < dst.numel(); ++i)
+  {
+    dst.data()[i] = -1.0f;
+  }
+
+  auto a_view = a.view({IRng{1, 5}, IRng{2, 5}});
+  auto dst_view = dst.view({IRng{2, 6}, IRng{0, 3}});
+  REQUIRE_NOTHROW(
+    lazy::assign(*dst_view, lazy::ref(*a_view) + lazy::ref(b) * 10.0f));
+  for_ndim(dst.shape(), [&](ScalarIndexTuple const& i) {
+    float expected = -1.0f;
+    if (i[0] >= 2 && i[1] < 3)
+    {
+      ScalarIndexTuple const vi{i[0] - 2, i[1]};
+      expected = *a_view->get(vi) + *b.get(vi) * 10.0f;
+    }
+    REQUIRE(*dst.get(i) == expected);
+  });
+
+  Tensor<float> wrong(Device::CPU, {3, 4}, {DT::Any, DT::Any});
+  REQUIRE_THROWS(lazy::assign(*dst_view, lazy::ref(wrong) + 1.0f));
+  REQUIRE_THROWS(lazy::assign(dst, lazy::ref(wrong) + lazy::ref(b)));
+}
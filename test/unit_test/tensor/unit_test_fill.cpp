@@ -11,6 +11,9 @@
 #include <catch2/catch_template_test_macros.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <cstdint>
+#include <vector>
+
 using namespace h2;
 
 TEMPLATE_LIST_TEST_CASE("Zeroing buffers works",
@@ -111,3 +114,96 @@ TEMPLATE_LIST_TEST_CASE("Filling contiguous tensors",
     REQUIRE(read_ele<Dev>(tensor.data(), i, tensor.get_stream()) == fill_val);
   }
 }
+
+TEMPLATE_LIST_TEST_CASE("Zeroing multiple tensors",
+                        "[tensor][fill]",
+                        AllDevComputeTypePairsList)
+{
+  constexpr Device Dev = meta::tlist::At<TestType, 0>::value;
+  using Type = meta::tlist::At<TestType, 1>;
+  using TensorType = Tensor<Type>;
+
+  TensorType tensor1{Dev, {4, 6}, {DT::Sample, DT::Any}};
+  TensorType tensor2{Dev, {3}, {DT::Any}};
+  TensorType tensor3{Dev, {17, 5, 9}, {DT::Sample, DT::Any, DT::Any}};
+  TensorType empty_tensor{Dev};
+  Tensor<std::uint8_t> byte_tensor{Dev, {7}, {DT::Any}};
+  std::vector<TensorType*> tensors = {
+    &tensor1, &tensor2, &empty_tensor, &tensor3};
+  for (TensorType* tensor : tensors)
+  {
+    for (DataIndexType i = 0; i < tensor->numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor->data(), i, static_cast<Type>(42), tensor->get_stream());
+    }
+  }
+  for (DataIndexType i = 0; i < byte_tensor.numel(); ++i)
+  {
+    write_ele<Dev>(byte_tensor.data(),
+                   i,
+                   static_cast<std::uint8_t>(42),
+                   byte_tensor.get_stream());
+  }
+
+  SECTION("Zeroing tensors of one type works")
+  {
+    REQUIRE_NOTHROW(zero(tensors));
+  }
+  SECTION("Zeroing tensors of different types works")
+  {
+    std::vector<BaseTensor*> base_tensors(tensors.begin(), tensors.end());
+    base_tensors.push_back(&byte_tensor);
+    REQUIRE_NOTHROW(zero(base_tensors));
+    for (DataIndexType i = 0; i < byte_tensor.numel(); ++i)
+    {
+      REQUIRE(read_ele<Dev>(byte_tensor.data(), i, byte_tensor.get_stream())
+              == 0);
+    }
+  }
+
+  for (TensorType* tensor : tensors)
+  {
+    for (DataIndexType i = 0; i < tensor->numel(); ++i)
+    {
+      REQUIRE(read_ele<Dev>(tensor->data(), i, tensor->get_stream())
+              == static_cast<Type>(0));
+    }
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Filling multiple tensors",
+                        "[tensor][fill]",
+                        AllDevComputeTypePairsList)
+{
+  constexpr Device Dev = meta::tlist::At<TestType, 0>::value;
+  using Type = meta::tlist::At<TestType, 1>;
+  using TensorType = Tensor<Type>;
+  constexpr Type fill_val = static_cast<Type>(42);
+
+  TensorType tensor1{Dev, {4, 6}, {DT::Sample, DT::Any}};
+  TensorType tensor2{Dev, {3}, {DT::Any}};
+  TensorType tensor3{Dev, {17, 5, 9}, {DT::Sample, DT::Any, DT::Any}};
+  TensorType empty_tensor{Dev};
+  std::vector<TensorType*> tensors = {
+    &tensor1, &tensor2, &empty_tensor, &tensor3};
+  for (TensorType* tensor : tensors)
+  {
+    for (DataIndexType i = 0; i < tensor->numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor->data(), i, static_cast<Type>(0), tensor->get_stream());
+    }
+  }
+
+  REQUIRE_NOTHROW(fill(tensors, fill_val));
+
+  for (TensorType* tensor : tensors)
+  {
+    for (DataIndexType i = 0; i < tensor->numel(); ++i)
+    {
+      REQUIRE(read_ele<Dev>(tensor->data(), i, tensor->get_stream())
+              == fill_val);
+    }
+  }
+}
@@ -0,0 +1,162 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/dist_utils.hpp"
+#include "h2/tensor/halo_exchange.hpp"
+#include "h2/tensor/tensor_utils.hpp"
+#include "utils.hpp"
+
+#include "../mpi_utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+
+using namespace h2;
+
+TEMPLATE_LIST_TEST_CASE("Distributed tensor halos work",
+                        "[dist-tensor][halo]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using DistTensorType = DistTensor<DataType>;
+
+  // Entries of the global tensor are nonzero; ghosts start out as -1.
+  auto get_val = [](ShapeTuple const& shape, ScalarIndexTuple const& idx) {
+    return static_cast<DataType>(
+      inner_product<DataIndexType>(idx, prefix_product<DataIndexType>(shape))
+      + 1);
+  };
+  auto add_index = [](ScalarIndexTuple a, ScalarIndexTuple const& b) {
+    for (typename ScalarIndexTuple::size_type i = 0; i < a.size(); ++i)
+    {
+      a[i] += b[i];
+    }
+    return a;
+  };
+
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple grid_shape) {
+        ProcessorGrid grid = ProcessorGrid(comm, grid_shape);
+        ShapeTuple tensor_shape(8, 12, 6);
+        tensor_shape.set_size(grid.ndim());
+        DTTuple tensor_dim_types(TuplePad<DTTuple>(grid.ndim(), DT::Any));
+        DistTTuple tensor_dist(
+          TuplePad<DistTTuple>(grid.ndim(), Distribution::Block));
+        // Every rank's block must be at least as large as the halo.
+        ShapeTuple halo(TuplePad<ShapeTuple>(grid.ndim(), 0));
+        for (typename ShapeTuple::size_type i = 0; i < grid.ndim(); ++i)
+        {
+          halo[i] = std::min<DimType>(i + 1, tensor_shape[i] / grid_shape[i]);
+        }
+        DistTensorType tensor = DistTensorType(
+          Dev, tensor_shape, tensor_dim_types, grid, tensor_dist);
+        if (tensor.is_local_empty())
+        {
+          return;
+        }
+
+        Tensor<DataType>& local = tensor.local_tensor();
+        ScalarIndexTuple const local_start = h2::internal::local2global_index(
+          tensor_shape,
+          grid,
+          tensor_dist,
+          grid.rank(),
+          ScalarIndexTuple(TuplePad<ScalarIndexTuple>(grid.ndim(), 0)));
+        for_ndim(local.shape(), [&](ScalarIndexTuple const& idx) {
+          write_ele<Dev>(local.get(idx),
+                         0,
+                         get_val(tensor_shape, add_index(local_start, idx)),
+                         local.get_stream());
+        });
+
+        REQUIRE_NOTHROW(tensor.set_halo(halo));
+        REQUIRE(tensor.has_halo() == any_of(halo, [](DimType h) {
+                  return h > 0;
+                }));
+        Tensor<DataType>& interior = tensor.local_tensor();
+        Tensor<DataType>& padded = tensor.local_tensor_with_halo();
+        REQUIRE(interior.shape() == local.shape());
+        for (typename ShapeTuple::size_type i = 0; i < grid.ndim(); ++i)
+        {
+          REQUIRE(padded.shape(i) == interior.shape(i) + 2 * halo[i]);
+        }
+
+        // Existing data is preserved; mark the ghost regions.
+        for_ndim(padded.shape(), [&](ScalarIndexTuple const& idx) {
+          bool is_ghost = false;
+          ScalarIndexTuple interior_idx = idx;
+          for (typename ShapeTuple::size_type i = 0; i < idx.size(); ++i)
+          {
+            is_ghost |= idx[i] < halo[i] || idx[i] >= padded.shape(i) - halo[i];
+            interior_idx[i] = idx[i] - halo[i];
+          }
+          if (is_ghost)
+          {
+            write_ele<Dev>(
+              padded.get(idx), 0, DataType{-1}, padded.get_stream());
+          }
+          else
+          {
+            REQUIRE(read_ele<Dev>(padded.get(idx), 0, padded.get_stream())
+                    == get_val(tensor_shape,
+                                    add_index(local_start, interior_idx)));
+          }
+        });
+
+        REQUIRE_NOTHROW(exchange_halo(tensor));
+
+        // Ghosts inside the global tensor hold the neighbors' entries,
+        // including corners; those outside are unchanged.
+        for_ndim(padded.shape(), [&](ScalarIndexTuple const& idx) {
+          bool is_inside = true;
+          ScalarIndexTuple global_idx = idx;
+          for (typename ShapeTuple::size_type i = 0; i < idx.size(); ++i)
+          {
+            if (local_start[i] + idx[i] < halo[i]
+                || local_start[i] + idx[i] - halo[i] >= tensor_shape[i])
+            {
+              is_inside = false;
+            }
+            else
+            {
+              global_idx[i] = local_start[i] + idx[i] - halo[i];
+            }
+          }
+          REQUIRE(read_ele<Dev>(padded.get(idx), 0, padded.get_stream())
+                  == (is_inside ? get_val(tensor_shape, global_idx)
+                                : DataType{-1}));
+        });
+
+        REQUIRE_NOTHROW(tensor.set_halo(
+          ShapeTuple(TuplePad<ShapeTuple>(grid.ndim(), 0))));
+        REQUIRE_FALSE(tensor.has_halo());
+        REQUIRE(tensor.local_tensor().shape() == local.shape());
+      },
+      comm);
+  });
+}
+
+TEMPLATE_LIST_TEST_CASE("Invalid distributed tensor halos are rejected",
+                        "[dist-tensor][halo]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using DistTensorType = DistTensor<DataType>;
+
+  for_comms([&](Comm& comm) {
+    ProcessorGrid grid = ProcessorGrid(comm, ShapeTuple{comm.Size()});
+    DistTensorType replicated = DistTensorType(
+      Dev, {8}, {DT::Any}, grid, {Distribution::Replicated});
+    REQUIRE_THROWS(replicated.set_halo({1}));
+    DistTensorType block =
+      DistTensorType(Dev, {8}, {DT::Any}, grid, {Distribution::Block});
+    REQUIRE_THROWS(block.set_halo({1, 1}));
+    REQUIRE_THROWS(block.set_halo({9}));
+  });
+}
@@ -11,6 +11,8 @@
 #include <catch2/catch_template_test_macros.hpp>
 #include <catch2/catch_test_macros.hpp>
 
+#include <vector>
+
 namespace
 {
 
@@ -677,3 +679,95 @@ TEMPLATE_LIST_TEST_CASE("DiHydrogen to Hydrogen conversion",
     CHECK_THROWS(h2::as_h_mat<Dev>(tensor));
   }
 }
+
+TEMPLATE_LIST_TEST_CASE("Batched Hydrogen/DiHydrogen conversion",
+                        "[tensor][h_h2][h2_h]",
+                        AllDevList)
+{
+  constexpr h2::Device Dev = TestType::value;
+  constexpr hydrogen::Device HDev = h2::HydrogenDevice<Dev>;
+  using TensorType = h2::Tensor<DataType>;
+  using MatrixType = El::Matrix<DataType, HDev>;
+
+  SECTION("Matrices to tensors")
+  {
+    auto mat1 = make_matrix<HDev>(6, 1);
+    auto mat2 = make_matrix<HDev>(1, 4, 3);
+    auto mat3 = make_matrix<HDev>(6, 4, 9);
+    std::vector<TensorType> tensors;
+
+    h2::as_h2_tensors(std::vector<MatrixType*>{&mat1, &mat2, &mat3}, tensors);
+    REQUIRE(tensors.size() == 3);
+    CHECK(tensors[0].shape() == h2::ShapeTuple{6});
+    CHECK(tensors[0].strides() == h2::StrideTuple{1});
+    CHECK(tensors[1].shape() == h2::ShapeTuple{4});
+    CHECK(tensors[1].strides() == h2::StrideTuple{3});
+    CHECK(tensors[2].shape() == h2::ShapeTuple{6, 4});
+    CHECK(tensors[2].strides() == h2::StrideTuple{1, 9});
+    CHECK(tensors[0].const_data() == mat1.LockedBuffer());
+    CHECK(tensors[1].const_data() == mat2.LockedBuffer());
+    CHECK(tensors[2].const_data() == mat3.LockedBuffer());
+    for (auto const& tensor : tensors)
+    {
+      CHECK(tensor.get_view_type() == h2::ViewType::Mutable);
+    }
+
+    // Re-wrapping reuses the existing tensors.
+    TensorType const* const first = tensors.data();
+    std::vector<MatrixType const*> const const_mats{&mat3, &mat1};
+    h2::as_h2_tensors(const_mats, tensors);
+    REQUIRE(tensors.size() == 2);
+    CHECK(tensors.data() == first);
+    CHECK(tensors[0].shape() == h2::ShapeTuple{6, 4});
+    CHECK(tensors[0].const_data() == mat3.LockedBuffer());
+    CHECK(tensors[1].shape() == h2::ShapeTuple{6});
+    CHECK(tensors[1].const_data() == mat1.LockedBuffer());
+    for (auto const& tensor : tensors)
+    {
+      CHECK(tensor.get_view_type() == h2::ViewType::Const);
+    }
+
+    MatrixType empty;
+    CHECK_THROWS(
+      h2::as_h2_tensors(std::vector<MatrixType*>{&mat1, &empty}, tensors));
+  }
+
+  SECTION("Tensors to matrices")
+  {
+    TensorType tensor1{Dev, {9}, {h2::DT::Any}};
+    TensorType tensor2{Dev, {3, 9}, {h2::DT::Any, h2::DT::Any}};
+    std::vector<MatrixType> mats;
+
+    h2::as_h_mats<Dev>(std::vector<TensorType*>{&tensor1, &tensor2}, mats);
+    REQUIRE(mats.size() == 2);
+    CHECK(mats[0].Height() == El::Int{9});
+    CHECK(mats[0].Width() == El::Int{1});
+    CHECK(mats[1].Height() == El::Int{3});
+    CHECK(mats[1].Width() == El::Int{9});
+    CHECK(mats[1].LDim() == El::Int{3});
+    CHECK(mats[0].LockedBuffer() == tensor1.const_data());
+    CHECK(mats[1].LockedBuffer() == tensor2.const_data());
+    for (auto const& mat : mats)
+    {
+      CHECK(mat.Viewing());
+      CHECK_FALSE(mat.Locked());
+    }
+
+    h2::as_h_mats<Dev>(
+      std::vector<TensorType const*>{&tensor2, &tensor1, &tensor2}, mats);
+    REQUIRE(mats.size() == 3);
+    CHECK(mats[0].LockedBuffer() == tensor2.const_data());
+    CHECK(mats[1].LockedBuffer() == tensor1.const_data());
+    CHECK(mats[2].LockedBuffer() == tensor2.const_data());
+    CHECK(mats[1].Height() == El::Int{9});
+    for (auto const& mat : mats)
+    {
+      CHECK(mat.Viewing());
+      CHECK(mat.Locked());
+    }
+
+    TensorType empty{Dev, {0}, {h2::DT::Any}};
+    CHECK_THROWS(
+      h2::as_h_mats<Dev>(std::vector<TensorType*>{&tensor1, &empty}, mats));
+  }
+}
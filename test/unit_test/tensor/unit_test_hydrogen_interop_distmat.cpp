@@ -1153,3 +1153,76 @@ TEMPLATE_LIST_TEST_CASE(
     }
   }
 }
+
+TEMPLATE_LIST_TEST_CASE("Copying Hydrogen DistMatrix/DistTensor conversion",
+                        "[dist-tensor][h_h2]",
+                        AllDevList)
+{
+  constexpr h2::Device Dev = TestType::value;
+  constexpr hydrogen::Device HDev = h2::HydrogenDevice<Dev>;
+
+  El::Grid grid;
+  El::Int const height = grid.Height() * 3 + 1;
+  El::Int const width = grid.Width() * 2 + 1;
+  auto const value = [&](El::Int i, El::Int j) {
+    return static_cast<DataType>(i + j * height);
+  };
+
+  El::DistMatrix<DataType, El::MC, El::MR, El::ELEMENT, El::Device::CPU>
+    A_cpu(grid);
+  A_cpu.Resize(height, width);
+  for (El::Int lj = 0; lj < A_cpu.LocalWidth(); ++lj)
+  {
+    for (El::Int li = 0; li < A_cpu.LocalHeight(); ++li)
+    {
+      A_cpu.SetLocal(li, lj, value(A_cpu.GlobalRow(li), A_cpu.GlobalCol(lj)));
+    }
+  }
+  El::DistMatrix<DataType, El::MC, El::MR, El::ELEMENT, HDev> A(grid);
+  SECTION("Aligned matrix") {}
+  SECTION("Misaligned matrix")
+  {
+    A.Align(grid.Height() > 1 ? 1 : 0, grid.Width() > 1 ? 1 : 0);
+  }
+  El::Copy(A_cpu, A);
+
+  // A 1D block distribution has no zero-copy equivalent for (MC, MR).
+  h2::ProcessorGrid const proc_grid{grid.VCComm(),
+                                    h2::ShapeTuple{grid.Size(), 1}};
+  h2::DistributionTypeTuple const dist{h2::Distribution::Block,
+                                       h2::Distribution::Replicated};
+  El::AbstractDistMatrix<DataType> const& A_ref = A;
+  h2::DistTensor<DataType> tensor = h2::to_h2_tensor(A_ref, proc_grid, dist);
+  REQUIRE(tensor.shape() == h2::ShapeTuple{height, width});
+  REQUIRE(tensor.distribution() == dist);
+
+  if (!tensor.is_local_empty())
+  {
+    auto const& local = tensor.const_local_tensor();
+    h2::IndexRangeTuple const indices = h2::internal::get_global_indices(
+      tensor.shape(), proc_grid, dist, proc_grid.rank());
+    for (h2::DimType j = 0; j < local.shape(1); ++j)
+    {
+      for (h2::DimType i = 0; i < local.shape(0); ++i)
+      {
+        REQUIRE(read_ele<Dev>(local.const_get({i, j}), local.get_stream())
+                == value(indices[0].start() + i, indices[1].start() + j));
+      }
+    }
+  }
+
+  auto B = h2::to_h_matrix(tensor, grid, El::STAR, El::VC);
+  REQUIRE(B->Height() == height);
+  REQUIRE(B->Width() == width);
+  El::DistMatrix<DataType, El::STAR, El::VC, El::ELEMENT, El::Device::CPU>
+    B_cpu(grid);
+  El::Copy(*B, B_cpu);
+  for (El::Int lj = 0; lj < B_cpu.LocalWidth(); ++lj)
+  {
+    for (El::Int li = 0; li < B_cpu.LocalHeight(); ++li)
+    {
+      REQUIRE(B_cpu.GetLocal(li, lj)
+              == value(B_cpu.GlobalRow(li), B_cpu.GlobalCol(lj)));
+    }
+  }
+}
@@ -9,6 +9,10 @@
 #include "h2/tensor/tensor.hpp"
 #include "utils.hpp"
 
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
 #include <sstream>
 
 #include <catch2/catch_template_test_macros.hpp>
@@ -144,3 +148,302 @@ TEMPLATE_LIST_TEST_CASE("Printing tensors works", "[tensor][io]", AllDevList)
     REQUIRE(ss.str() == expected);
   }
 }
+
+TEMPLATE_LIST_TEST_CASE("Tensor statistics work", "[tensor][io]", AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+
+  SECTION("Empty tensors have default statistics")
+  {
+    TensorType tensor{Dev};
+    auto stats = get_stats(tensor);
+    REQUIRE(stats.count == 0);
+    REQUIRE(stats.nan_count == 0);
+  }
+
+  SECTION("Statistics of a strided view work")
+  {
+    TensorType tensor{Dev, {4, 6}, {DT::Any, DT::Any}};
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+    }
+    auto stats = get_stats(tensor);
+    REQUIRE(stats.count == 24);
+    REQUIRE(stats.nan_count == 0);
+    REQUIRE(stats.min == 0.0f);
+    REQUIRE(stats.max == 23.0f);
+    REQUIRE(stats.mean == 11.5);
+
+    auto view = tensor.view({IRng(1, 3), IRng(2, 4)});
+    auto view_stats = get_stats(*view);
+    REQUIRE(view_stats.count == 4);
+    REQUIRE(view_stats.min == 9.0f);
+    REQUIRE(view_stats.max == 14.0f);
+    REQUIRE(view_stats.mean == 11.5);
+  }
+
+  SECTION("NaNs are counted and skipped")
+  {
+    TensorType tensor{Dev, {4}, {DT::Any}};
+    DataType const nan = std::numeric_limits<DataType>::quiet_NaN();
+    write_ele<Dev>(tensor.data(), 0, 1.0f, tensor.get_stream());
+    write_ele<Dev>(tensor.data(), 1, nan, tensor.get_stream());
+    write_ele<Dev>(tensor.data(), 2, -3.0f, tensor.get_stream());
+    write_ele<Dev>(tensor.data(), 3, nan, tensor.get_stream());
+    auto stats = get_stats(tensor);
+    REQUIRE(stats.count == 4);
+    REQUIRE(stats.nan_count == 2);
+    REQUIRE(stats.min == -3.0f);
+    REQUIRE(stats.max == 1.0f);
+    REQUIRE(stats.mean == -1.0);
+
+    write_ele<Dev>(tensor.data(), 0, nan, tensor.get_stream());
+    write_ele<Dev>(tensor.data(), 2, nan, tensor.get_stream());
+    auto nan_stats = get_stats(tensor);
+    REQUIRE(nan_stats.nan_count == 4);
+    REQUIRE(std::isnan(nan_stats.min));
+    REQUIRE(std::isnan(nan_stats.mean));
+  }
+
+  SECTION("Integer statistics work")
+  {
+    Tensor<std::int32_t> tensor{Dev, {3}, {DT::Any}};
+    write_ele<Dev>(tensor.data(), 0, -5, tensor.get_stream());
+    write_ele<Dev>(tensor.data(), 1, 2, tensor.get_stream());
+    write_ele<Dev>(tensor.data(), 2, 6, tensor.get_stream());
+    auto stats = get_stats(tensor);
+    REQUIRE(stats.min == -5);
+    REQUIRE(stats.max == 6);
+    REQUIRE(stats.mean == 1.0);
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Printing tensor summaries works",
+                        "[tensor][io]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+
+  SECTION("Empty tensors print as empty")
+  {
+    TensorType tensor{Dev};
+    std::stringstream ss;
+    print_summary(ss, tensor);
+    REQUIRE(ss.str() == "[]");
+  }
+
+  SECTION("Large tensors are elided")
+  {
+    TensorType tensor{Dev, {3, 4}, {DT::Any, DT::Any}};
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+    }
+    std::stringstream ss;
+    print_summary(ss, tensor);
+    // Elements are in the same order as `print`.
+    REQUIRE(ss.str()
+            == "shape {3, 4}, min: 0, max: 11, mean: 5.5, NaNs: 0\n"
+               "[0, 3, 6, ..., 5, 8, 11]");
+  }
+
+  SECTION("Small tensors are printed in full")
+  {
+    TensorType tensor{Dev, {2, 2}, {DT::Any, DT::Any}};
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+    }
+    std::stringstream ss;
+    print_summary(ss, tensor, 2);
+    REQUIRE(ss.str()
+            == "shape {2, 2}, min: 0, max: 3, mean: 1.5, NaNs: 0\n"
+               "[0, 2, 1, 3]");
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Serializing tensors works", "[tensor][io]", AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+
+  SECTION("Empty tensors round-trip")
+  {
+    TensorType tensor{Dev};
+    std::stringstream ss;
+    serialize(ss, tensor);
+    TensorType read_tensor{Dev, {2}, {DT::Any}};
+    deserialize(ss, read_tensor);
+    REQUIRE(read_tensor.is_empty());
+  }
+
+  SECTION("Contiguous tensors round-trip")
+  {
+    TensorType tensor{Dev, {4, 6}, {DT::Sample, DT::Any}};
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+    }
+    std::stringstream ss;
+    // Use a small chunk size to exercise streaming.
+    serialize(ss, tensor, 5 * sizeof(DataType));
+    TensorType read_tensor{Dev};
+    deserialize(ss, read_tensor, 5 * sizeof(DataType));
+    REQUIRE(read_tensor.shape() == tensor.shape());
+    REQUIRE(read_tensor.dim_types() == tensor.dim_types());
+    REQUIRE(read_tensor.strides() == tensor.strides());
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      REQUIRE(read_ele<Dev>(read_tensor.data(), i, read_tensor.get_stream())
+              == static_cast<DataType>(i));
+    }
+  }
+
+  SECTION("Non-contiguous tensors keep their strides")
+  {
+    TensorType tensor{Dev, {4, 6}, {DT::Sample, DT::Any}};
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+    }
+    auto view = tensor.view({IRng(1, 3), IRng(2, 4)});
+    std::stringstream ss;
+    serialize(ss, *view);
+    TensorType read_tensor{Dev};
+    deserialize(ss, read_tensor);
+    REQUIRE(read_tensor.shape() == ShapeTuple{2, 2});
+    REQUIRE(read_tensor.strides() == view->strides());
+    REQUIRE(read_ele<Dev>(read_tensor.get({0, 0}), read_tensor.get_stream())
+            == static_cast<DataType>(9));
+    REQUIRE(read_ele<Dev>(read_tensor.get({1, 1}), read_tensor.get_stream())
+            == static_cast<DataType>(14));
+  }
+
+  SECTION("Tensors round-trip through files")
+  {
+    TensorType tensor{Dev, {5, 3}, {DT::Sample, DT::Any}};
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+    }
+    std::string const path =
+      "h2_unit_test_io_" + std::to_string(static_cast<int>(Dev)) + ".bin";
+    serialize(path, tensor, 4 * sizeof(DataType));
+    TensorType read_tensor{Dev};
+    deserialize(path, read_tensor, 4 * sizeof(DataType));
+    std::remove(path.c_str());
+    REQUIRE(read_tensor.shape() == tensor.shape());
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      REQUIRE(read_ele<Dev>(read_tensor.data(), i, read_tensor.get_stream())
+              == static_cast<DataType>(i));
+    }
+
+    REQUIRE_THROWS(deserialize(path, read_tensor));
+  }
+
+  SECTION("Data is read and written at file offsets")
+  {
+    TensorType tensor{Dev, {7}, {DT::Any}};
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+    }
+    std::string const path = "h2_unit_test_io_offset_"
+                             + std::to_string(static_cast<int>(Dev)) + ".bin";
+    std::ofstream(path, std::ios::binary) << "header";
+    std::size_t const bytes = tensor.numel() * sizeof(DataType);
+    internal::write_file_data(path,
+                              6,
+                              tensor.const_data(),
+                              bytes,
+                              Dev,
+                              tensor.get_stream(),
+                              3 * sizeof(DataType));
+    TensorType read_tensor{Dev, {7}, {DT::Any}};
+    internal::read_file_data(path,
+                             6,
+                             read_tensor.data(),
+                             bytes,
+                             Dev,
+                             read_tensor.get_stream(),
+                             3 * sizeof(DataType));
+    std::ifstream is(path, std::ios::binary);
+    std::string header(6, ' ');
+    is.read(header.data(), header.size());
+    is.close();
+    std::remove(path.c_str());
+    REQUIRE(header == "header");
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      REQUIRE(read_ele<Dev>(read_tensor.data(), i, read_tensor.get_stream())
+              == static_cast<DataType>(i));
+    }
+  }
+
+  SECTION("Compressed data round-trips")
+  {
+    TensorType tensor{Dev, {1000}, {DT::Any}};
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      write_ele<Dev>(tensor.data(),
+                     i,
+                     static_cast<DataType>((i % 5 == 0) ? i : 0),
+                     tensor.get_stream());
+    }
+    std::size_t const bytes = tensor.numel() * sizeof(DataType);
+    std::stringstream ss;
+    internal::write_data(ss,
+                         tensor.const_data(),
+                         bytes,
+                         Dev,
+                         tensor.get_stream(),
+                         300 * sizeof(DataType),
+                         DataCompression::Zeros);
+    REQUIRE(ss.str().size() < bytes);
+    TensorType read_tensor{Dev, {1000}, {DT::Any}};
+    // Chunks record their sizes, so the chunk size need not match.
+    internal::read_data(ss,
+                        read_tensor.data(),
+                        bytes,
+                        Dev,
+                        read_tensor.get_stream(),
+                        128 * sizeof(DataType),
+                        DataCompression::Zeros);
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      REQUIRE(read_ele<Dev>(read_tensor.data(), i, read_tensor.get_stream())
+              == static_cast<DataType>((i % 5 == 0) ? i : 0));
+    }
+  }
+
+  SECTION("Bad data is rejected")
+  {
+    TensorType tensor{Dev, {4}, {DT::Any}};
+    tensor.ensure();
+    std::stringstream ss;
+    serialize(ss, tensor);
+    std::string const data = ss.str();
+
+    std::stringstream wrong_type(data);
+    Tensor<std::int32_t> int_tensor{Dev};
+    REQUIRE_THROWS(deserialize(wrong_type, int_tensor));
+
+    std::stringstream bad_magic("XXXX" + data.substr(4));
+    TensorType read_tensor{Dev};
+    REQUIRE_THROWS(deserialize(bad_magic, read_tensor));
+
+    std::stringstream truncated(data.substr(0, data.size() - 1));
+    REQUIRE_THROWS(deserialize(truncated, read_tensor));
+  }
+}
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/mmap.hpp"
+#include "h2/tensor/tensor.hpp"
+#include "utils.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace h2;
+
+namespace
+{
+
+/** A temporary file holding `n` consecutive values after a header. */
+struct TempDataFile
+{
+  std::string path;
+
+  TempDataFile(std::size_t n, std::size_t header_bytes = 0)
+  {
+    path = (std::filesystem::temp_directory_path()
+            / ("h2_mmap_test_" + std::to_string(::getpid()) + ".bin"))
+             .string();
+    std::ofstream out(path, std::ios::binary);
+    std::vector<char> header(header_bytes, 'x');
+    out.write(header.data(), header.size());
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      DataType const val = static_cast<DataType>(i);
+      out.write(reinterpret_cast<char const*>(&val), sizeof(val));
+    }
+  }
+
+  ~TempDataFile() { std::filesystem::remove(path); }
+
+  DataType read(std::size_t i, std::size_t header_bytes = 0) const
+  {
+    std::ifstream in(path, std::ios::binary);
+    in.seekg(header_bytes + i * sizeof(DataType));
+    DataType val;
+    in.read(reinterpret_cast<char*>(&val), sizeof(val));
+    return val;
+  }
+};
+
+}  // anonymous namespace
+
+TEST_CASE("Memory-mapped files work", "[tensor][mmap]")
+{
+  TempDataFile file(16);
+
+  MappedFile mapped(file.path, MmapMode::ReadOnly);
+  REQUIRE(mapped.size() == 16 * sizeof(DataType));
+  REQUIRE(mapped.get_mode() == MmapMode::ReadOnly);
+  REQUIRE_FALSE(mapped.is_gpu_registered());
+  REQUIRE(static_cast<DataType const*>(mapped.data())[3]
+          == static_cast<DataType>(3));
+
+  MappedFile partial(file.path, MmapMode::ReadOnly, 4 * sizeof(DataType));
+  REQUIRE(partial.size() == 12 * sizeof(DataType));
+  REQUIRE(static_cast<DataType const*>(partial.data())[0]
+          == static_cast<DataType>(4));
+
+  REQUIRE_THROWS(MappedFile(file.path, MmapMode::ReadOnly, 0, 1024));
+  REQUIRE_THROWS(MappedFile(file.path + ".missing", MmapMode::ReadOnly));
+}
+
+TEST_CASE("Memory-mapped tensors work", "[tensor][mmap]")
+{
+  using TensorType = Tensor<DataType>;
+  constexpr std::size_t header = 64;
+  TempDataFile file(24, header);
+
+  SECTION("Read-only")
+  {
+    auto tensor = make_mmap_tensor<DataType>(
+      file.path, {4, 6}, {DT::Sample, DT::Any}, MmapMode::ReadOnly, header);
+    REQUIRE(tensor->get_device() == Device::CPU);
+    REQUIRE(tensor->shape() == ShapeTuple{4, 6});
+    REQUIRE(tensor->strides() == StrideTuple{1, 4});
+    REQUIRE(tensor->is_view());
+    REQUIRE(tensor->is_const_view());
+    for (DataIndexType i = 0; i < tensor->numel(); ++i)
+    {
+      REQUIRE(tensor->const_data()[i] == static_cast<DataType>(i));
+    }
+  }
+  SECTION("Copy-on-write")
+  {
+    auto tensor = make_mmap_tensor<DataType>(
+      file.path, {4, 6}, {DT::Sample, DT::Any}, MmapMode::CopyOnWrite, header);
+    REQUIRE_FALSE(tensor->is_const_view());
+    tensor->data()[2] = static_cast<DataType>(42);
+    REQUIRE(tensor->const_data()[2] == static_cast<DataType>(42));
+    // The file is unchanged.
+    REQUIRE(file.read(2, header) == static_cast<DataType>(2));
+  }
+  SECTION("Views keep the mapping alive")
+  {
+    std::unique_ptr<TensorType> view;
+    {
+      auto tensor = make_mmap_tensor<DataType>(
+        file.path, {4, 6}, {DT::Sample, DT::Any}, MmapMode::ReadOnly, header);
+      view = tensor->const_view({ALL, IRng(2, 4)});
+    }
+    REQUIRE(view->const_get({1, 1}) != nullptr);
+    REQUIRE(*view->const_get({1, 1}) == static_cast<DataType>(13));
+  }
+  SECTION("Bad requests are rejected")
+  {
+    REQUIRE_THROWS(make_mmap_tensor<DataType>(
+      file.path, {8, 8}, {DT::Sample, DT::Any}, MmapMode::ReadOnly, header));
+    REQUIRE_THROWS(make_mmap_tensor<DataType>(
+      file.path, {4, 6}, {DT::Sample, DT::Any}, MmapMode::ReadOnly, 1));
+  }
+}
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/nonfinite.hpp"
+#include "utils.hpp"
+
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <limits>
+
+using namespace h2;
+
+TEMPLATE_LIST_TEST_CASE("Detecting non-finite values works",
+                        "[tensor][nonfinite]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+
+  TensorType tensor{Dev, {6, 5}, {DT::Any, DT::Any}};
+  for (DataIndexType i = 0; i < tensor.numel(); ++i)
+  {
+    write_ele<Dev>(
+      tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+  }
+
+  SECTION("Finite tensors have no non-finite values")
+  {
+    REQUIRE_FALSE(has_nonfinite(tensor));
+    REQUIRE_FALSE(has_nonfinite(TensorType{Dev}));
+  }
+
+  SECTION("NaNs and infinities are detected")
+  {
+    for (DataType val : {std::numeric_limits<DataType>::quiet_NaN(),
+                         std::numeric_limits<DataType>::infinity(),
+                         -std::numeric_limits<DataType>::infinity()})
+    {
+      write_ele<Dev>(tensor.data(), 17, val, tensor.get_stream());
+      REQUIRE(has_nonfinite(tensor));
+    }
+  }
+
+  SECTION("Only elements in views are checked")
+  {
+    write_ele<Dev>(tensor.data(),
+                   0,
+                   std::numeric_limits<DataType>::quiet_NaN(),
+                   tensor.get_stream());
+    auto view = tensor.view({IRng(1, 4), IRng(1, 3)});
+    REQUIRE_FALSE(has_nonfinite(*view));
+    write_ele<Dev>(view->get({2, 1}),
+                   0,
+                   std::numeric_limits<DataType>::infinity(),
+                   tensor.get_stream());
+    REQUIRE(has_nonfinite(*view));
+  }
+
+  SECTION("Integer tensors are always finite")
+  {
+    Tensor<std::int32_t> int_tensor{Dev, {4}, {DT::Any}};
+    for (DataIndexType i = 0; i < int_tensor.numel(); ++i)
+    {
+      write_ele<Dev>(int_tensor.data(),
+                     i,
+                     std::numeric_limits<std::int32_t>::max(),
+                     int_tensor.get_stream());
+    }
+    REQUIRE_FALSE(has_nonfinite(int_tensor));
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Checking several tensors for non-finite values works",
+                        "[tensor][nonfinite]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+
+  TensorType tensor1{Dev, {7}, {DT::Any}};
+  TensorType tensor2{Dev, {3, 3}, {DT::Any, DT::Any}};
+  TensorType empty{Dev};
+  for (TensorType* tensor : {&tensor1, &tensor2})
+  {
+    for (DataIndexType i = 0; i < tensor->numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor->data(), i, static_cast<DataType>(i), tensor->get_stream());
+    }
+  }
+  std::vector<TensorType const*> tensors{&tensor1, &empty, &tensor2};
+
+  REQUIRE_FALSE(has_nonfinite(tensors));
+  REQUIRE_FALSE(has_nonfinite(std::vector<TensorType const*>{}));
+
+  NonfiniteCheck check(tensor1.get_stream());
+  REQUIRE_FALSE(check.get());
+  check.start(tensors);
+  REQUIRE_FALSE(check.get());
+
+  write_ele<Dev>(tensor2.data(),
+                 8,
+                 std::numeric_limits<DataType>::quiet_NaN(),
+                 tensor2.get_stream());
+  REQUIRE(has_nonfinite(tensors));
+  check.start(tensors);
+  REQUIRE(check.get());
+
+  // Checks may be reused with a different number of tensors.
+  check.start(tensor1);
+  REQUIRE_FALSE(check.get());
+  check.start(tensor2);
+  REQUIRE(check.get());
+}
@@ -0,0 +1,145 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/pipeline.hpp"
+#include "utils.hpp"
+
+#include "../mpi_utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+
+using namespace h2;
+
+namespace
+{
+
+/**
+ * Each virtual stage adds one to its input going forward and one to
+ * its output gradient going back, and checks what it receives.
+ */
+template <Device Dev>
+class CountingStage : public PipelineStage<DataType>
+{
+public:
+  CountingStage(int num_stages_, int stage_, int num_chunks_)
+    : num_stages(num_stages_), stage(stage_), num_chunks(num_chunks_)
+  {}
+
+  void forward(int chunk,
+               int micro_batch,
+               Tensor<DataType> const* input,
+               Tensor<DataType>& output) override
+  {
+    int const vs = chunk * num_stages + stage;
+    if (vs == 0)
+    {
+      num_errors += input != nullptr;
+      fill(output, micro_batch + 1);
+    }
+    else
+    {
+      num_errors += !check(input, micro_batch + vs);
+      fill(output, micro_batch + vs + 1);
+    }
+    ++num_forward;
+  }
+
+  void backward(int chunk,
+                int micro_batch,
+                Tensor<DataType> const* input,
+                Tensor<DataType> const* grad_output,
+                Tensor<DataType>* grad_input) override
+  {
+    int const vs = chunk * num_stages + stage;
+    int const num_virtual = num_stages * num_chunks;
+    int const grad = 100 * micro_batch + (num_virtual - 1 - vs);
+    if (vs == num_virtual - 1)
+    {
+      num_errors += grad_output != nullptr;
+    }
+    else
+    {
+      num_errors += !check(grad_output, grad - 1);
+    }
+    if (vs == 0)
+    {
+      num_errors += input != nullptr || grad_input != nullptr;
+    }
+    else
+    {
+      num_errors += !check(input, micro_batch + vs);
+      fill(*grad_input, grad);
+    }
+    ++num_backward;
+  }
+
+  int num_errors = 0;
+  int num_forward = 0;
+  int num_backward = 0;
+
+private:
+  int num_stages;
+  int stage;
+  int num_chunks;
+
+  void fill(Tensor<DataType>& tensor, int val)
+  {
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor.data(), i, static_cast<DataType>(val), tensor.get_stream());
+    }
+  }
+
+  bool check(Tensor<DataType> const* tensor, int val)
+  {
+    if (tensor == nullptr)
+    {
+      return false;
+    }
+    for (DataIndexType i = 0; i < tensor->numel(); ++i)
+    {
+      if (read_ele<Dev>(tensor->const_data(), i, tensor->get_stream())
+          != static_cast<DataType>(val))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+}  // anonymous namespace
+
+TEMPLATE_LIST_TEST_CASE("Pipeline executors work",
+                        "[tensor][pipeline]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+
+  for_comms([&](Comm& comm) {
+    int const num_stages = comm.Size();
+    for (int num_chunks : {1, 2})
+    {
+      int const num_micro_batches = 2 * num_stages;
+      CountingStage<Dev> stage_impl(num_stages, comm.Rank(), num_chunks);
+      PipelineExecutor<DataType> executor(
+        stage_impl, comm, num_chunks, Dev, {2, 3}, {DT::Any, DT::Any});
+      REQUIRE_NOTHROW(executor.run(num_micro_batches));
+      REQUIRE(stage_impl.num_errors == 0);
+      REQUIRE(stage_impl.num_forward == num_micro_batches * num_chunks);
+      REQUIRE(stage_impl.num_backward == num_micro_batches * num_chunks);
+      if (num_chunks == 1)
+      {
+        REQUIRE(executor.get_max_in_flight()
+                == std::min(num_stages - comm.Rank(), num_micro_batches));
+      }
+    }
+  });
+}
@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/pipeline.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <algorithm>
+#include <set>
+#include <tuple>
+#include <vector>
+
+using namespace h2;
+
+namespace
+{
+
+/**
+ * Run the schedules of all stages with unbounded message buffering,
+ * each stage stepping whenever its next pass has its inputs, and
+ * return whether every pass ran.
+ */
+bool simulate(int num_stages, int num_micro_batches, int num_chunks)
+{
+  int const num_virtual = num_stages * num_chunks;
+  std::vector<std::vector<PipelineOp>> schedules;
+  for (int s = 0; s < num_stages; ++s)
+  {
+    schedules.push_back(
+      make_pipeline_schedule(num_stages, s, num_micro_batches, num_chunks));
+  }
+  // Passes done, by (type, micro-batch, virtual stage).
+  std::set<std::tuple<PipelineOpType, int, int>> done;
+  std::vector<std::size_t> next(num_stages, 0);
+  bool progressed = true;
+  while (progressed)
+  {
+    progressed = false;
+    for (int s = 0; s < num_stages; ++s)
+    {
+      if (next[s] == schedules[s].size())
+      {
+        continue;
+      }
+      PipelineOp const& op = schedules[s][next[s]];
+      int const vs = op.chunk * num_stages + s;
+      bool ready;
+      if (op.type == PipelineOpType::Forward)
+      {
+        ready =
+          vs == 0
+          || done.count({PipelineOpType::Forward, op.micro_batch, vs - 1});
+      }
+      else
+      {
+        ready = done.count({PipelineOpType::Forward, op.micro_batch, vs})
+                && (vs == num_virtual - 1
+                    || done.count(
+                      {PipelineOpType::Backward, op.micro_batch, vs + 1}));
+      }
+      if (ready)
+      {
+        done.insert({op.type, op.micro_batch, vs});
+        ++next[s];
+        progressed = true;
+      }
+    }
+  }
+  return done.size()
+         == 2 * static_cast<std::size_t>(num_micro_batches) * num_virtual;
+}
+
+int get_max_in_flight(std::vector<PipelineOp> const& ops)
+{
+  int in_flight = 0;
+  int max_in_flight = 0;
+  for (auto const& op : ops)
+  {
+    in_flight += (op.type == PipelineOpType::Forward) ? 1 : -1;
+    max_in_flight = std::max(max_in_flight, in_flight);
+  }
+  return max_in_flight;
+}
+
+}  // anonymous namespace
+
+TEST_CASE("1F1B pipeline schedules work", "[pipeline]")
+{
+  std::vector<PipelineOp> const expected = {{PipelineOpType::Forward, 0, 0},
+                                            {PipelineOpType::Forward, 1, 0},
+                                            {PipelineOpType::Backward, 0, 0},
+                                            {PipelineOpType::Forward, 2, 0},
+                                            {PipelineOpType::Backward, 1, 0},
+                                            {PipelineOpType::Backward, 2, 0}};
+  REQUIRE(make_pipeline_schedule(2, 0, 3) == expected);
+
+  int const num_stages = GENERATE(1, 2, 4);
+  int const num_micro_batches = GENERATE(0, 1, 3, 8);
+  for (int s = 0; s < num_stages; ++s)
+  {
+    auto const ops = make_pipeline_schedule(num_stages, s, num_micro_batches);
+    REQUIRE(ops.size() == 2 * static_cast<std::size_t>(num_micro_batches));
+    REQUIRE(get_max_in_flight(ops)
+            == std::min(num_stages - s, num_micro_batches));
+    // Each stage runs passes of micro-batches in order.
+    int next_forward = 0;
+    int next_backward = 0;
+    for (auto const& op : ops)
+    {
+      REQUIRE(op.chunk == 0);
+      if (op.type == PipelineOpType::Forward)
+      {
+        REQUIRE(op.micro_batch == next_forward++);
+      }
+      else
+      {
+        REQUIRE(op.micro_batch == next_backward++);
+        REQUIRE(next_backward <= next_forward);
+      }
+    }
+  }
+  REQUIRE(simulate(num_stages, num_micro_batches, 1));
+}
+
+TEST_CASE("Interleaved pipeline schedules work", "[pipeline]")
+{
+  int const num_stages = GENERATE(1, 2, 4);
+  int const num_chunks = GENERATE(2, 3);
+  int const num_micro_batches = num_stages * GENERATE(1, 2, 3);
+  for (int s = 0; s < num_stages; ++s)
+  {
+    auto const ops =
+      make_pipeline_schedule(num_stages, s, num_micro_batches, num_chunks);
+    REQUIRE(ops.size()
+            == 2 * static_cast<std::size_t>(num_micro_batches) * num_chunks);
+    std::set<std::tuple<PipelineOpType, int, int>> seen;
+    for (auto const& op : ops)
+    {
+      REQUIRE(op.chunk >= 0);
+      REQUIRE(op.chunk < num_chunks);
+      REQUIRE(op.micro_batch >= 0);
+      REQUIRE(op.micro_batch < num_micro_batches);
+      REQUIRE(seen.insert({op.type, op.micro_batch, op.chunk}).second);
+    }
+  }
+  REQUIRE(simulate(num_stages, num_micro_batches, num_chunks));
+
+  REQUIRE_THROWS(make_pipeline_schedule(2, 0, 3, 2));
+}
@@ -102,6 +102,87 @@ TEST_CASE("Processor grid coordinates and ranks are sane",
   });
 }
 
+TEST_CASE("Processor grids with dimension orders are sane",
+          "[dist-tensor][proc-grid]")
+{
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple shape) {
+        DimensionOrderTuple order(TuplePad<DimensionOrderTuple>(shape.size()));
+        for (typename ShapeTuple::size_type i = 0; i < shape.size(); ++i)
+        {
+          order[i] = static_cast<NDimType>(shape.size() - 1 - i);
+        }
+        ProcessorGrid grid = ProcessorGrid(comm, shape, order);
+        REQUIRE(grid.shape() == shape);
+        REQUIRE(grid.dim_order() == order);
+        for (RankType rank = 0; rank < comm.Size(); ++rank)
+        {
+          auto coord = grid.coords(rank);
+          REQUIRE(grid.rank(coord) == rank);
+          // The last dimension varies fastest.
+          REQUIRE(grid.get_dimension_rank(shape.size() - 1, rank)
+                  == rank % shape[shape.size() - 1]);
+        }
+        REQUIRE_THROWS(ProcessorGrid(comm, shape, DimensionOrderTuple{}));
+      },
+      comm);
+  });
+}
+
+TEST_CASE("Topology-aware processor grids are sane",
+          "[dist-tensor][proc-grid]")
+{
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple shape) {
+        NDimType const comm_dim = static_cast<NDimType>(shape.size() - 1);
+        ProcessorGrid grid =
+          make_topology_aware_grid(comm, shape, DimensionOrderTuple{comm_dim});
+        REQUIRE(grid.shape() == shape);
+        REQUIRE(grid.size() == comm.Size());
+        REQUIRE(grid.dim_order()[0] == comm_dim);
+        for (RankType rank = 0; rank < comm.Size(); ++rank)
+        {
+          REQUIRE(grid.rank(grid.coords(rank)) == rank);
+        }
+        REQUIRE_THROWS(make_topology_aware_grid(
+          comm, shape, DimensionOrderTuple{comm_dim, comm_dim}));
+      },
+      comm);
+  });
+}
+
+TEST_CASE("Processor grid sub-communicators work",
+          "[dist-tensor][proc-grid]")
+{
+  for_comms([&](Comm& comm) {
+    for_grid_shapes(
+      [&](ShapeTuple shape) {
+        ProcessorGrid grid = ProcessorGrid(comm, shape);
+        for (typename ShapeTuple::size_type dim = 0; dim < shape.size(); ++dim)
+        {
+          DimensionOrderTuple const dims{static_cast<NDimType>(dim)};
+          Comm& subcomm = grid.get_subcomm(dims);
+          REQUIRE(subcomm.Size() == shape[dim]);
+          REQUIRE(subcomm.Rank() == grid.get_dimension_rank(dim));
+          // Copies of the grid share cached communicators.
+          ProcessorGrid grid_copy = grid;
+          REQUIRE(&grid_copy.get_subcomm(dims) == &subcomm);
+        }
+        REQUIRE(grid.get_num_cached_subcomms() == shape.size());
+
+        Comm& all_comm = grid.get_subcomm(grid.dim_order());
+        REQUIRE(all_comm.Size() == grid.size());
+        REQUIRE(all_comm.Rank() == grid.rank());
+        REQUIRE(grid.get_subcomm(DimensionOrderTuple{}).Size() == 1);
+        REQUIRE_THROWS(grid.get_subcomm(
+          DimensionOrderTuple{static_cast<NDimType>(shape.size())}));
+      },
+      comm);
+  });
+}
+
 TEST_CASE("Processor grid equality works", "[dist-tensor][proc-grid]")
 {
   SECTION("Empty processor grid equality")
@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/quantize.hpp"
+#include "utils.hpp"
+
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <vector>
+
+using namespace h2;
+
+TEST_CASE("quantize_value and dequantize_value work", "[tensor][quantize]")
+{
+  CHECK(quantize_value(0.0f, 0.5f, 0) == 0);
+  CHECK(quantize_value(1.0f, 0.5f, 0) == 2);
+  CHECK(quantize_value(1.2f, 0.5f, 0) == 2);
+  CHECK(quantize_value(1.3f, 0.5f, 0) == 3);
+  CHECK(quantize_value(-1.3f, 0.5f, 0) == -3);
+  CHECK(quantize_value(1.0f, 0.5f, 10) == 12);
+  // Saturation:
+  CHECK(quantize_value(1000.0, 0.5f, 0) == 127);
+  CHECK(quantize_value(-1000.0, 0.5f, 0) == -128);
+  CHECK(quantize_value(10.0f, 0.5f, 120) == 127);
+
+  CHECK(dequantize_value<float>(2, 0.5f, 0) == 1.0f);
+  CHECK(dequantize_value<float>(12, 0.5f, 10) == 1.0f);
+  CHECK(dequantize_value<double>(-128, 0.25f, -128) == 0.0);
+}
+
+TEMPLATE_LIST_TEST_CASE("Per-tensor quantization works",
+                        "[tensor][quantize]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  Tensor<float> src(Dev, {5, 7}, {DT::Sample, DT::Any});
+  for (DataIndexType i = 0; i < src.numel(); ++i)
+  {
+    write_ele<Dev>(
+      src.data(), i, static_cast<float>(i) - 17.0f, src.get_stream());
+  }
+  QuantizedTensor qtensor(Dev, {5, 7}, {DT::Sample, DT::Any}, 0.5f, 3);
+  REQUIRE_FALSE(qtensor.is_per_channel());
+  REQUIRE_NOTHROW(quantize(qtensor, src));
+  for (DataIndexType i = 0; i < src.numel(); ++i)
+  {
+    REQUIRE(read_ele<Dev>(qtensor.data().const_data(),
+                          i,
+                          qtensor.get_stream())
+            == static_cast<std::int8_t>(2 * (i - 17) + 3));
+  }
+
+  Tensor<double> dst(Dev, {2, 2}, {DT::Any, DT::Any});
+  REQUIRE_NOTHROW(dequantize(dst, qtensor));
+  REQUIRE(dst.shape() == src.shape());
+  for (DataIndexType i = 0; i < src.numel(); ++i)
+  {
+    REQUIRE(read_ele<Dev>(dst.const_data(), i, dst.get_stream())
+            == static_cast<double>(i) - 17.0);
+  }
+
+  auto cast_dst = cast<float>(qtensor);
+  REQUIRE(cast_dst->shape() == src.shape());
+  for (DataIndexType i = 0; i < src.numel(); ++i)
+  {
+    REQUIRE(read_ele<Dev>(cast_dst->const_data(), i, cast_dst->get_stream())
+            == static_cast<float>(i) - 17.0f);
+  }
+
+  QuantizedTensor wrong_shape(Dev, {7, 5}, {DT::Sample, DT::Any}, 0.5f, 3);
+  REQUIRE_THROWS(quantize(wrong_shape, src));
+}
+
+TEMPLATE_LIST_TEST_CASE("Per-channel quantization works",
+                        "[tensor][quantize]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  // Channels are the outer dimension, so their scales broadcast over
+  // the inner one.
+  std::vector<float> const scales{0.5f, 0.25f, 1.0f};
+  std::vector<std::int32_t> const zero_points{0, -4, 10};
+  Tensor<float> src(Dev, {4, 3}, {DT::Any, DT::Channel});
+  for (DataIndexType i = 0; i < src.numel(); ++i)
+  {
+    write_ele<Dev>(src.data(), i, static_cast<float>(i), src.get_stream());
+  }
+  QuantizedTensor qtensor(
+    Dev, {4, 3}, {DT::Any, DT::Channel}, 1, scales, zero_points);
+  REQUIRE(qtensor.is_per_channel());
+  REQUIRE(qtensor.get_channel_dim() == 1);
+  REQUIRE_NOTHROW(quantize(qtensor, src));
+  for (DataIndexType i = 0; i < src.numel(); ++i)
+  {
+    std::size_t const c = static_cast<std::size_t>(i / 4);
+    std::int8_t const expected =
+      quantize_value(static_cast<float>(i), scales[c], zero_points[c]);
+    REQUIRE(read_ele<Dev>(qtensor.data().const_data(),
+                          i,
+                          qtensor.get_stream())
+            == expected);
+  }
+
+  Tensor<float> big(Dev, {6, 5}, {DT::Any, DT::Any});
+  auto dst_view = big.view({IRng{1, 5}, IRng{2, 5}});
+  REQUIRE_NOTHROW(dequantize(*dst_view, qtensor));
+  for_ndim(src.shape(), [&](ScalarIndexTuple const& i) {
+    REQUIRE(read_ele<Dev>(dst_view->get(i), dst_view->get_stream())
+            == read_ele<Dev>(src.get(i), src.get_stream()));
+  });
+
+  REQUIRE_THROWS(QuantizedTensor(
+    Dev, {4, 3}, {DT::Any, DT::Channel}, 0, scales, zero_points));
+  REQUIRE_THROWS(QuantizedTensor(
+    Dev, {4, 3}, {DT::Any, DT::Channel}, 2, scales, zero_points));
+}
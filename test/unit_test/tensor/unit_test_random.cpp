@@ -0,0 +1,220 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/init/random.hpp"
+#include "utils.hpp"
+
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <vector>
+
+using namespace h2;
+
+namespace
+{
+
+using RandomTypes = h2::meta::TL<float, double>;
+using AllDevRandomTypesList =
+  h2::meta::tlist::CartProdTL<AllDevList, RandomTypes>;
+
+template <Device Dev, typename T>
+std::vector<T> get_values(Tensor<T> const& tensor)
+{
+  std::vector<T> values;
+  for_ndim(tensor.shape(), [&](ScalarIndexTuple const& idx) {
+    values.push_back(read_ele<Dev>(tensor.get(idx), tensor.get_stream()));
+  });
+  return values;
+}
+
+template <typename T>
+double get_mean(std::vector<T> const& values)
+{
+  double sum = 0;
+  for (T const& x : values)
+  {
+    sum += x;
+  }
+  return sum / values.size();
+}
+
+template <typename T>
+double get_stddev(std::vector<T> const& values)
+{
+  double const mean = get_mean(values);
+  double sum = 0;
+  for (T const& x : values)
+  {
+    sum += (x - mean) * (x - mean);
+  }
+  return std::sqrt(sum / values.size());
+}
+
+}  // anonymous namespace
+
+TEMPLATE_LIST_TEST_CASE("Random uniform fills work",
+                        "[tensor][random]",
+                        AllDevRandomTypesList)
+{
+  constexpr Device Dev = meta::tlist::At<TestType, 0>::value;
+  using Type = meta::tlist::At<TestType, 1>;
+  using TensorType = Tensor<Type>;
+  constexpr Type low = -2;
+  constexpr Type high = 3;
+
+  TensorType tensor{Dev, {64, 51}, {DT::Sample, DT::Any}};
+  REQUIRE_NOTHROW(fill_uniform(tensor, low, high, 42));
+  std::vector<Type> const values = get_values<Dev>(tensor);
+  for (Type const& x : values)
+  {
+    REQUIRE(x >= low);
+    REQUIRE(x <= high);
+  }
+  REQUIRE(std::abs(get_mean(values) - 0.5) < 0.1);
+  REQUIRE(std::abs(get_stddev(values) - 5 / std::sqrt(12.0)) < 0.1);
+
+  SECTION("Same seeds give the same values")
+  {
+    TensorType tensor2{Dev, {64, 51}, {DT::Sample, DT::Any}};
+    fill_uniform(tensor2, low, high, 42);
+    REQUIRE(get_values<Dev>(tensor2) == values);
+  }
+  SECTION("Different seeds give different values")
+  {
+    TensorType tensor2{Dev, {64, 51}, {DT::Sample, DT::Any}};
+    fill_uniform(tensor2, low, high, 43);
+    std::vector<Type> const values2 = get_values<Dev>(tensor2);
+    std::size_t num_same = 0;
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+      num_same += (values[i] == values2[i]) ? 1 : 0;
+    }
+    REQUIRE(num_same < values.size() / 100);
+  }
+  SECTION("Values depend only on the index")
+  {
+    // A view of a larger tensor gets the values of a tensor of the
+    // same shape.
+    TensorType big_tensor{Dev, {70, 51}, {DT::Sample, DT::Any}};
+    std::unique_ptr<TensorType> view = big_tensor.view({IRng(3, 67), ALL});
+    fill_uniform(*view, low, high, 42);
+    REQUIRE(get_values<Dev>(*view) == values);
+    // As does a permuted view of a tensor of the transposed shape.
+    TensorType transposed{Dev, {51, 64}, {DT::Any, DT::Sample}};
+    std::unique_ptr<TensorType> permuted = transposed.permute_view({1, 0});
+    fill_uniform(*permuted, low, high, 42);
+    REQUIRE(get_values<Dev>(*permuted) == values);
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Random normal fills work",
+                        "[tensor][random]",
+                        AllDevRandomTypesList)
+{
+  constexpr Device Dev = meta::tlist::At<TestType, 0>::value;
+  using Type = meta::tlist::At<TestType, 1>;
+  using TensorType = Tensor<Type>;
+
+  TensorType tensor{Dev, {101, 99}, {DT::Sample, DT::Any}};
+  REQUIRE_NOTHROW(fill_normal(tensor, Type(2), Type(3), 1234));
+  std::vector<Type> const values = get_values<Dev>(tensor);
+  for (Type const& x : values)
+  {
+    REQUIRE(std::isfinite(x));
+  }
+  REQUIRE(std::abs(get_mean(values) - 2) < 0.1);
+  REQUIRE(std::abs(get_stddev(values) - 3) < 0.1);
+
+  TensorType tensor2{Dev, {101, 99}, {DT::Sample, DT::Any}};
+  fill_normal(tensor2, Type(2), Type(3), 1234);
+  REQUIRE(get_values<Dev>(tensor2) == values);
+}
+
+TEMPLATE_LIST_TEST_CASE("Random weight initializations work",
+                        "[tensor][random]",
+                        AllDevRandomTypesList)
+{
+  constexpr Device Dev = meta::tlist::At<TestType, 0>::value;
+  using Type = meta::tlist::At<TestType, 1>;
+  using TensorType = Tensor<Type>;
+  constexpr std::size_t fan_in = 100;
+  constexpr std::size_t fan_out = 50;
+
+  TensorType tensor{Dev, {fan_in, fan_out}, {DT::Any, DT::Any}};
+
+  SECTION("Xavier uniform")
+  {
+    fill_xavier_uniform(tensor, fan_in, fan_out, 1);
+    double const bound = std::sqrt(6.0 / (fan_in + fan_out));
+    for (Type const& x : get_values<Dev>(tensor))
+    {
+      REQUIRE(std::abs(x) <= bound);
+    }
+  }
+  SECTION("Xavier normal")
+  {
+    fill_xavier_normal(tensor, fan_in, fan_out, 1);
+    REQUIRE(std::abs(get_stddev(get_values<Dev>(tensor))
+                     - std::sqrt(2.0 / (fan_in + fan_out)))
+            < 0.01);
+  }
+  SECTION("He uniform")
+  {
+    fill_he_uniform(tensor, fan_in, 1);
+    double const bound = std::sqrt(6.0 / fan_in);
+    for (Type const& x : get_values<Dev>(tensor))
+    {
+      REQUIRE(std::abs(x) <= bound);
+    }
+  }
+  SECTION("He normal")
+  {
+    fill_he_normal(tensor, fan_in, 1);
+    REQUIRE(std::abs(get_stddev(get_values<Dev>(tensor))
+                     - std::sqrt(2.0 / fan_in))
+            < 0.01);
+  }
+  SECTION("Invalid fans are rejected")
+  {
+    REQUIRE_THROWS(fill_xavier_uniform(tensor, 0, 0, 1));
+    REQUIRE_THROWS(fill_he_normal(tensor, 0, 1));
+  }
+}
+
+#ifdef H2_TEST_WITH_GPU
+TEMPLATE_LIST_TEST_CASE("Random fills match on CPU and GPU",
+                        "[tensor][random]",
+                        RandomTypes)
+{
+  using Type = TestType;
+  using TensorType = Tensor<Type>;
+
+  TensorType cpu_tensor{Device::CPU, {33, 65}, {DT::Sample, DT::Any}};
+  TensorType gpu_tensor{Device::GPU, {33, 65}, {DT::Sample, DT::Any}};
+
+  SECTION("Uniform")
+  {
+    fill_uniform(cpu_tensor, Type(-1), Type(1), 7);
+    fill_uniform(gpu_tensor, Type(-1), Type(1), 7);
+  }
+  SECTION("Normal")
+  {
+    fill_normal(cpu_tensor, Type(0), Type(1), 7);
+    fill_normal(gpu_tensor, Type(0), Type(1), 7);
+  }
+
+  std::vector<Type> const cpu_values = get_values<Device::CPU>(cpu_tensor);
+  std::vector<Type> const gpu_values = get_values<Device::GPU>(gpu_tensor);
+  for (std::size_t i = 0; i < cpu_values.size(); ++i)
+  {
+    // Math functions may round differently on GPUs.
+    REQUIRE(std::abs(cpu_values[i] - gpu_values[i]) <= Type(1e-5));
+  }
+}
+#endif
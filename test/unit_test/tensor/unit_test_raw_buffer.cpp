@@ -9,6 +9,8 @@
 #include "h2/utils/typename.hpp"
 #include "utils.hpp"
 
+#include <cstdint>
+#include <memory>
 #include <type_traits>
 
 #include <catch2/catch_template_test_macros.hpp>
@@ -207,6 +209,39 @@ TEMPLATE_LIST_TEST_CASE("Raw buffers are writable",
   }
 }
 
+TEMPLATE_LIST_TEST_CASE("Raw buffers resize in place within capacity",
+                        "[tensor][raw_buffer]",
+                        AllDevList)
+{
+  using BufType = RawBuffer<DataType>;
+  constexpr Device Dev = TestType::value;
+
+  BufType buf = BufType(Dev, 32, false, ComputeStream{Dev});
+  DataType* orig_buf = buf.data();
+  REQUIRE(buf.capacity() == 32);
+
+  REQUIRE(buf.resize_in_place(8));
+  REQUIRE(buf.size() == 8);
+  REQUIRE(buf.capacity() == 32);
+  REQUIRE(buf.data() == orig_buf);
+  REQUIRE(buf.resize_in_place(32));
+  REQUIRE(buf.data() == orig_buf);
+  REQUIRE_FALSE(buf.resize_in_place(33));
+  REQUIRE(buf.size() == 32);
+
+  // Unallocated buffers take the new size when allocated.
+  buf.release();
+  REQUIRE(buf.capacity() == 0);
+  REQUIRE(buf.resize_in_place(64));
+  buf.ensure();
+  REQUIRE(buf.size() == 64);
+  REQUIRE(buf.capacity() == 64);
+
+  DataType external[4];
+  BufType external_buf = BufType(Dev, external, 4, ComputeStream{Dev});
+  REQUIRE_FALSE(external_buf.resize_in_place(2));
+}
+
 TEMPLATE_LIST_TEST_CASE("Raw buffer release registration works",
                         "[tensor][raw_buffer]",
                         AllDevPairsList)
@@ -240,6 +275,41 @@ TEMPLATE_LIST_TEST_CASE("Raw buffer stream get/set works",
   REQUIRE(buf.get_stream() == stream2);
 }
 
+TEMPLATE_LIST_TEST_CASE("Raw buffer mirrors work",
+                        "[tensor][raw_buffer]",
+                        AllDevPairsList)
+{
+  constexpr Device Dev1 = meta::tlist::At<TestType, 0>::value;
+  constexpr Device Dev2 = meta::tlist::At<TestType, 1>::value;
+  using BufType = RawBuffer<DataType>;
+
+  BufType buf(Dev1, 8, false, ComputeStream{Dev1});
+  auto mirror = std::make_shared<BufType>(Dev2, 8, false, ComputeStream{Dev2});
+  REQUIRE(buf.get_mirror(Dev2) == nullptr);
+
+  buf.set_mirror(mirror);
+  REQUIRE(buf.get_mirror(Dev2) == mirror);
+
+  SECTION("Modifying the buffer invalidates the mirror")
+  {
+    std::uint64_t const version = buf.get_version();
+    buf.mark_modified();
+    REQUIRE(buf.get_version() != version);
+    REQUIRE(buf.get_mirror(Dev2) == nullptr);
+  }
+  SECTION("Modifying the mirror invalidates it")
+  {
+    mirror->mark_modified();
+    REQUIRE(buf.get_mirror(Dev2) == nullptr);
+  }
+  SECTION("Releasing the buffer drops the mirror")
+  {
+    buf.release();
+    REQUIRE(buf.get_mirror(Dev2) == nullptr);
+    REQUIRE(mirror.use_count() == 1);
+  }
+}
+
 TEMPLATE_LIST_TEST_CASE("Raw buffers are printable",
                         "[tensor][raw_buffer]",
                         AllDevList)
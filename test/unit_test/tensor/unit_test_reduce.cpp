@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/reduce.hpp"
+#include "utils.hpp"
+
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace h2;
+
+namespace
+{
+
+/** Fill `tensor` so each element is its coordinates' linear index. */
+template <Device Dev, typename T>
+void fill_with_index(Tensor<T>& tensor)
+{
+  StrideTuple const strides = get_contiguous_strides(tensor.shape());
+  for_ndim(tensor.shape(), [&](ScalarIndexTuple const& coord) {
+    DataIndexType index = 0;
+    for (typename ShapeTuple::size_type d = 0; d < coord.size(); ++d)
+    {
+      index += coord[d] * strides[d];
+    }
+    write_ele<Dev>(
+      tensor.get(coord), 0, static_cast<T>(index), tensor.get_stream());
+  });
+}
+
+}  // anonymous namespace
+
+TEMPLATE_LIST_TEST_CASE("Reducing tensors works",
+                        "[tensor][reduce]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  Tensor<float> src(Dev, {3, 4, 5}, {DT::Sample, DT::Channel, DT::Any});
+  fill_with_index<Dev>(src);
+
+  SECTION("Sum over one dimension")
+  {
+    auto dst = reduce(src, {1}, ReductionOp::Sum);
+    REQUIRE(dst->shape() == ShapeTuple{3, 5});
+    REQUIRE(dst->dim_types() == DTTuple{DT::Sample, DT::Any});
+    for (DimType i = 0; i < 3; ++i)
+    {
+      for (DimType k = 0; k < 5; ++k)
+      {
+        float expected = 0.0f;
+        for (DimType j = 0; j < 4; ++j)
+        {
+          expected += static_cast<float>(i + 3 * j + 12 * k);
+        }
+        REQUIRE(read_ele<Dev>(dst->get({i, k}), dst->get_stream())
+                == expected);
+      }
+    }
+  }
+
+  SECTION("Max over several dimensions keeping them")
+  {
+    auto dst = reduce(src, {0, 2}, ReductionOp::Max, true);
+    REQUIRE(dst->shape() == ShapeTuple{1, 4, 1});
+    REQUIRE(dst->dim_types() == src.dim_types());
+    for (DimType j = 0; j < 4; ++j)
+    {
+      REQUIRE(read_ele<Dev>(dst->get({0, j, 0}), dst->get_stream())
+              == static_cast<float>(2 + 3 * j + 12 * 4));
+    }
+  }
+
+  SECTION("Mean over every dimension")
+  {
+    auto dst = reduce(src, {0, 1, 2}, ReductionOp::Mean);
+    REQUIRE(dst->shape() == ShapeTuple{1});
+    REQUIRE(dst->dim_types() == DTTuple{DT::Scalar});
+    REQUIRE(read_ele<Dev>(dst->data(), dst->get_stream()) == 29.5f);
+
+    auto kept = reduce(src, {2, 0, 1}, ReductionOp::Min, true);
+    REQUIRE(kept->shape() == ShapeTuple{1, 1, 1});
+    REQUIRE(read_ele<Dev>(kept->data(), kept->get_stream()) == 0.0f);
+  }
+
+  SECTION("Reducing no dimensions copies")
+  {
+    auto dst = reduce(src, {}, ReductionOp::Prod);
+    REQUIRE(dst->shape() == src.shape());
+    for (DataIndexType i = 0; i < src.numel(); ++i)
+    {
+      REQUIRE(read_ele<Dev>(dst->data(), i, dst->get_stream())
+              == static_cast<float>(i));
+    }
+  }
+
+  SECTION("Invalid dimensions are rejected")
+  {
+    REQUIRE_THROWS(reduce(src, {3}, ReductionOp::Sum));
+    REQUIRE_THROWS(reduce(src, {1, 1}, ReductionOp::Sum));
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Reducing tensor views works",
+                        "[tensor][reduce]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  Tensor<std::int32_t> src(Dev, {6, 7}, {DT::Any, DT::Any});
+  fill_with_index<Dev>(src);
+  // A strided view of rows 1-3 and columns 2-5.
+  auto src_view = src.view({IRng{1, 4}, IRng{2, 6}});
+
+  Tensor<std::int32_t> dst(Dev, {2, 5}, {DT::Any, DT::Any});
+  auto dst_view = dst.view({IRng{1, 2}, IRng{0, 4}});
+  reduce(*dst_view, *src_view, {0}, ReductionOp::Sum, true);
+  for (DimType j = 0; j < 4; ++j)
+  {
+    std::int32_t expected = 0;
+    for (DimType i = 1; i < 4; ++i)
+    {
+      expected += i + 6 * (j + 2);
+    }
+    REQUIRE(read_ele<Dev>(dst.get({1, j}), dst.get_stream()) == expected);
+  }
+
+  // Integer means truncate.
+  auto mean = reduce(*src_view, {1}, ReductionOp::Mean);
+  REQUIRE(mean->shape() == ShapeTuple{3});
+  for (DimType i = 0; i < 3; ++i)
+  {
+    std::int32_t const expected = ((i + 1) * 4 + 6 * (2 + 3 + 4 + 5)) / 4;
+    REQUIRE(read_ele<Dev>(mean->data(), i, mean->get_stream()) == expected);
+  }
+
+  // Views must already have the reduced shape.
+  REQUIRE_THROWS(reduce(*dst_view, *src_view, {0}, ReductionOp::Sum));
+}
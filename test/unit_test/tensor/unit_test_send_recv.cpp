@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/send_recv.hpp"
+#include "h2/tensor/tensor_utils.hpp"
+#include "utils.hpp"
+
+#include "../mpi_utils.hpp"
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+TEMPLATE_LIST_TEST_CASE("Sending tensors between ranks works",
+                        "[tensor][send-recv]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+
+  auto get_val = [](int rank, DataIndexType i) {
+    return static_cast<DataType>(rank * 1000 + i + 1);
+  };
+
+  for_comms([&](Comm& comm) {
+    int const rank = comm.Rank();
+    int const size = comm.Size();
+    int const next = (rank + 1) % size;
+    int const prev = (rank + size - 1) % size;
+    ShapeTuple const shape{4, 6};
+
+    SECTION("Contiguous tensors")
+    {
+      TensorType src(Dev, shape, {DT::Any, DT::Any});
+      TensorType dst(Dev, shape, {DT::Any, DT::Any});
+      for (DataIndexType i = 0; i < src.numel(); ++i)
+      {
+        write_ele<Dev>(src.data(), i, get_val(rank, i), src.get_stream());
+        write_ele<Dev>(dst.data(), i, DataType{-1}, dst.get_stream());
+      }
+      TensorCommRequest recv_req = irecv(dst, prev, comm);
+      TensorCommRequest send_req = isend(src, next, comm);
+      REQUIRE_NOTHROW(send_req.wait());
+      REQUIRE_NOTHROW(recv_req.wait());
+      REQUIRE(send_req.is_complete());
+      REQUIRE(recv_req.is_complete());
+      for (DataIndexType i = 0; i < dst.numel(); ++i)
+      {
+        REQUIRE(read_ele<Dev>(dst.data(), i, dst.get_stream())
+                == get_val(prev, i));
+      }
+    }
+
+    SECTION("Strided tensors")
+    {
+      // Send a column range and receive into a different one.
+      TensorType src(Dev, {4, 8}, {DT::Any, DT::Any});
+      TensorType dst(Dev, {4, 8}, {DT::Any, DT::Any});
+      for (DataIndexType i = 0; i < src.numel(); ++i)
+      {
+        write_ele<Dev>(src.data(), i, get_val(rank, i), src.get_stream());
+        write_ele<Dev>(dst.data(), i, DataType{-1}, dst.get_stream());
+      }
+      auto src_view = src.view({ALL, IRng(1, 4)});
+      auto dst_view = dst.view({ALL, IRng(4, 7)});
+      REQUIRE_FALSE(src_view->is_contiguous());
+      TensorCommRequest recv_req = irecv(*dst_view, prev, comm);
+      REQUIRE_NOTHROW(send(*src_view, next, comm));
+      while (!recv_req.test()) {}
+      for_ndim(dst.shape(), [&](ScalarIndexTuple const& idx) {
+        DataType const expected =
+          (idx[1] >= 4 && idx[1] < 7)
+            ? get_val(prev, idx[0] + 4 * (idx[1] - 3))
+            : DataType{-1};
+        REQUIRE(read_ele<Dev>(dst.get(idx), 0, dst.get_stream())
+                == expected);
+      });
+    }
+
+    SECTION("Mismatched sizes are errors")
+    {
+      // Receiving fewer bytes than expected is reported.
+      TensorType src(Dev, {4, 5}, {DT::Any, DT::Any});
+      TensorType dst(Dev, {4, 6}, {DT::Any, DT::Any});
+      TensorCommRequest recv_req = irecv(dst, prev, comm, 1);
+      TensorCommRequest send_req = isend(src, next, comm, 1);
+      REQUIRE_THROWS(recv_req.wait());
+      REQUIRE(recv_req.is_complete());
+      send_req.wait();
+    }
+  });
+}
@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/sparse_tensor.hpp"
+#include "utils.hpp"
+
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+using namespace h2;
+
+TEST_CASE("Sparse tensor coordinates work", "[tensor][sparse]")
+{
+  SparseTensor<float> sparse(
+    Device::CPU, {3, 4, 5}, {DT::Any, DT::Any, DT::Any});
+  REQUIRE(sparse.ndim() == 3);
+  REQUIRE(sparse.numel() == 60);
+  REQUIRE(sparse.nnz() == 0);
+  REQUIRE(sparse.get_coord(0) == ScalarIndexTuple{0, 0, 0});
+  REQUIRE(sparse.get_coord(1) == ScalarIndexTuple{1, 0, 0});
+  REQUIRE(sparse.get_coord(4) == ScalarIndexTuple{1, 1, 0});
+  REQUIRE(sparse.get_coord(59) == ScalarIndexTuple{2, 3, 4});
+  for (DataIndexType i = 0; i < sparse.numel(); ++i)
+  {
+    REQUIRE(sparse.get_index(sparse.get_coord(i)) == i);
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Sparse tensor nonzeros work",
+                        "[tensor][sparse]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  SparseTensor<float> sparse(
+    Dev, {4, 3}, {DT::Any, DT::Any}, {9, 1, 4, 11}, {3.0f, 1.0f, 2.0f, 4.0f});
+  REQUIRE(sparse.get_device() == Dev);
+  REQUIRE(sparse.nnz() == 4);
+
+  std::vector<DataIndexType> indices;
+  std::vector<float> values;
+  sparse.get_nonzeros(indices, values);
+  REQUIRE(indices == std::vector<DataIndexType>{1, 4, 9, 11});
+  REQUIRE(values == std::vector<float>{1.0f, 2.0f, 3.0f, 4.0f});
+
+  // Rows are the outer dimension, with four entries each.
+  REQUIRE(sparse.get_compressed_offsets()
+          == std::vector<DataIndexType>{0, 1, 2, 4});
+
+  REQUIRE_THROWS(sparse.set_nonzeros({12}, {1.0f}));
+  REQUIRE_THROWS(sparse.set_nonzeros({1, 1}, {1.0f, 2.0f}));
+  REQUIRE_THROWS(sparse.set_nonzeros({1, 2}, {1.0f}));
+
+  REQUIRE_NOTHROW(sparse.set_nonzeros({}, {}));
+  REQUIRE(sparse.nnz() == 0);
+  REQUIRE(sparse.get_compressed_offsets()
+          == std::vector<DataIndexType>{0, 0, 0, 0});
+}
+
+TEMPLATE_LIST_TEST_CASE("Sparse to dense conversion works",
+                        "[tensor][sparse]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  Tensor<float> dense(Dev, {5, 6}, {DT::Any, DT::Any});
+  for (DataIndexType i = 0; i < dense.numel(); ++i)
+  {
+    write_ele<Dev>(dense.data(),
+                   i,
+                   (i % 7 == 0) ? static_cast<float>(i + 1) : 0.0f,
+                   dense.get_stream());
+  }
+
+  auto sparse = to_sparse(dense);
+  REQUIRE(sparse->shape() == dense.shape());
+  REQUIRE(sparse->nnz() == 5);
+  std::vector<DataIndexType> indices;
+  std::vector<float> values;
+  sparse->get_nonzeros(indices, values);
+  REQUIRE(indices == std::vector<DataIndexType>{0, 7, 14, 21, 28});
+  REQUIRE(values == std::vector<float>{1.0f, 8.0f, 15.0f, 22.0f, 29.0f});
+
+  Tensor<float> roundtrip(Dev, {2, 2}, {DT::Any, DT::Any});
+  REQUIRE_NOTHROW(to_dense(roundtrip, *sparse));
+  REQUIRE(roundtrip.shape() == dense.shape());
+  for (DataIndexType i = 0; i < dense.numel(); ++i)
+  {
+    REQUIRE(read_ele<Dev>(roundtrip.const_data(), i, roundtrip.get_stream())
+            == read_ele<Dev>(dense.const_data(), i, dense.get_stream()));
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Sparse-dense operations work",
+                        "[tensor][sparse]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  Tensor<float> dense(Dev, {4, 4}, {DT::Any, DT::Any});
+  for (DataIndexType i = 0; i < dense.numel(); ++i)
+  {
+    write_ele<Dev>(dense.data(), i, static_cast<float>(i), dense.get_stream());
+  }
+  SparseTensor<float> sparse(
+    Dev, {4, 4}, {DT::Any, DT::Any}, {2, 5, 15}, {2.0f, -1.0f, 0.5f});
+
+  SECTION("Multiply")
+  {
+    SparseTensor<float> dst(Dev, {1}, {DT::Any});
+    REQUIRE_NOTHROW(sparse_dense_multiply(dst, sparse, dense));
+    REQUIRE(dst.shape() == sparse.shape());
+    std::vector<DataIndexType> indices;
+    std::vector<float> values;
+    dst.get_nonzeros(indices, values);
+    REQUIRE(indices == std::vector<DataIndexType>{2, 5, 15});
+    REQUIRE(values == std::vector<float>{4.0f, -5.0f, 7.5f});
+
+    // In-place.
+    REQUIRE_NOTHROW(sparse_dense_multiply(sparse, sparse, dense));
+    sparse.get_nonzeros(indices, values);
+    REQUIRE(values == std::vector<float>{4.0f, -5.0f, 7.5f});
+  }
+
+  SECTION("Add")
+  {
+    REQUIRE_NOTHROW(sparse_dense_add(dense, sparse));
+    for (DataIndexType i = 0; i < dense.numel(); ++i)
+    {
+      float expected = static_cast<float>(i);
+      expected += (i == 2) ? 2.0f : (i == 5) ? -1.0f : (i == 15) ? 0.5f : 0.0f;
+      REQUIRE(read_ele<Dev>(dense.const_data(), i, dense.get_stream())
+              == expected);
+    }
+  }
+
+  SECTION("Mismatched shapes")
+  {
+    Tensor<float> wrong(Dev, {2, 8}, {DT::Any, DT::Any});
+    REQUIRE_THROWS(sparse_dense_add(wrong, sparse));
+    REQUIRE_THROWS(sparse_dense_multiply(sparse, sparse, wrong));
+  }
+}
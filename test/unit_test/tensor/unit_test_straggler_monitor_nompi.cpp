@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/straggler_monitor.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <vector>
+
+using namespace h2;
+using Catch::Matchers::WithinAbs;
+
+TEST_CASE("Straggler stats find late ranks", "[straggler]")
+{
+  // Three ranks at four points, stored rank by rank. Rank 2 is late
+  // by 1 at every point but the third, where rank 0 is late by 3.
+  std::vector<double> const arrivals = {
+    0.0, 10.0, 23.0, 30.0,  // Rank 0
+    0.0, 10.0, 20.0, 30.0,  // Rank 1
+    1.0, 11.0, 20.0, 31.0}; // Rank 2
+  auto const stats = compute_straggler_stats(arrivals, 3, 4);
+  REQUIRE(stats.size() == 3);
+
+  REQUIRE_THAT(stats[0].mean_lateness, WithinAbs(0.75, 1e-12));
+  REQUIRE(stats[0].num_last == 1);
+  REQUIRE(stats[0].worst_point == 2);
+  REQUIRE_THAT(stats[0].worst_lateness, WithinAbs(3.0, 1e-12));
+
+  REQUIRE_THAT(stats[1].mean_lateness, WithinAbs(0.0, 1e-12));
+
+  REQUIRE_THAT(stats[2].mean_lateness, WithinAbs(0.75, 1e-12));
+  REQUIRE(stats[2].num_last == 3);
+  REQUIRE(stats[2].worst_point == 0);
+  REQUIRE_THAT(stats[2].worst_lateness, WithinAbs(1.0, 1e-12));
+
+  // Work is timed from the last arrival at the previous point.
+  REQUIRE_THAT(stats[0].mean_work, WithinAbs(28.0 / 3.0, 1e-12));
+  REQUIRE_THAT(stats[1].mean_work, WithinAbs(25.0 / 3.0, 1e-12));
+  REQUIRE_THAT(stats[2].mean_work, WithinAbs(9.0, 1e-12));
+}
+
+TEST_CASE("Straggler stats of two ranks compare with the earlier",
+          "[straggler]")
+{
+  std::vector<double> const arrivals = {5.0, 7.0, 4.0, 6.0};
+  auto const stats = compute_straggler_stats(arrivals, 2, 2);
+  REQUIRE_THAT(stats[0].mean_lateness, WithinAbs(1.0, 1e-12));
+  REQUIRE_THAT(stats[1].mean_lateness, WithinAbs(0.0, 1e-12));
+  REQUIRE(stats[0].num_last == 2);
+  REQUIRE(stats[1].num_last == 0);
+}
+
+TEST_CASE("Straggler stats of no points are empty", "[straggler]")
+{
+  auto const stats = compute_straggler_stats({}, 4, 0);
+  REQUIRE(stats.size() == 4);
+  REQUIRE(stats[0].mean_lateness == 0.0);
+  REQUIRE(stats[0].num_last == 0);
+}
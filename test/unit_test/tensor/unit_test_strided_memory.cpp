@@ -60,6 +60,66 @@ TEST_CASE("get_contiguous_strides and are_strides_contiguous are compatible",
                                get_contiguous_strides(ShapeTuple{13, 3, 7})));
 }
 
+TEST_CASE("collapse_strided_layout works", "[tensor][strided_memory]")
+{
+  SECTION("Empty and single element")
+  {
+    auto const empty =
+      collapse_strided_layout<1>(ShapeTuple{}, {StrideTuple{}});
+    CHECK(empty.shape == ShapeTuple{});
+    auto const zero =
+      collapse_strided_layout<1>(ShapeTuple{4, 0, 3}, {StrideTuple{1, 4, 4}});
+    CHECK(zero.shape == ShapeTuple{0});
+    auto const one =
+      collapse_strided_layout<1>(ShapeTuple{1, 1}, {StrideTuple{3, 7}});
+    CHECK(one.shape == ShapeTuple{1});
+    CHECK(one.strides[0] == StrideTuple{1});
+  }
+
+  SECTION("Contiguous collapses to one dimension")
+  {
+    auto const layout = collapse_strided_layout<1>(
+      ShapeTuple{13, 3, 7}, {get_contiguous_strides(ShapeTuple{13, 3, 7})});
+    CHECK(layout.shape == ShapeTuple{273});
+    CHECK(layout.strides[0] == StrideTuple{1});
+  }
+
+  SECTION("Extent 1 dimensions are dropped")
+  {
+    auto const layout = collapse_strided_layout<1>(
+      ShapeTuple{1, 13, 1, 3}, {StrideTuple{100, 2, 5, 26}});
+    CHECK(layout.shape == ShapeTuple{39});
+    CHECK(layout.strides[0] == StrideTuple{2});
+  }
+
+  SECTION("Strided outer dimension is kept")
+  {
+    auto const layout = collapse_strided_layout<1>(ShapeTuple{13, 3, 7},
+                                                   {StrideTuple{1, 13, 50}});
+    CHECK(layout.shape == ShapeTuple{39, 7});
+    CHECK(layout.strides[0] == StrideTuple{1, 50});
+  }
+
+  SECTION("Buffers are collapsed jointly")
+  {
+    auto const layout = collapse_strided_layout<2>(
+      ShapeTuple{13, 3, 7},
+      {StrideTuple{1, 13, 39}, StrideTuple{1, 16, 48}});
+    CHECK(layout.shape == ShapeTuple{13, 21});
+    CHECK(layout.strides[0] == StrideTuple{1, 13});
+    CHECK(layout.strides[1] == StrideTuple{1, 16});
+  }
+
+  SECTION("Broadcast dimensions collapse with each other")
+  {
+    auto const layout = collapse_strided_layout<2>(
+      ShapeTuple{13, 3, 7}, {StrideTuple{1, 13, 39}, StrideTuple{1, 0, 0}});
+    CHECK(layout.shape == ShapeTuple{13, 21});
+    CHECK(layout.strides[0] == StrideTuple{1, 13});
+    CHECK(layout.strides[1] == StrideTuple{1, 0});
+  }
+}
+
 TEST_CASE("get_extent_from_strides works", "[tensor][strided_memor]")
 {
   // Contiguous:
@@ -813,6 +873,57 @@ TEMPLATE_LIST_TEST_CASE("Cloning StridedMemory works",
   }
 }
 
+TEMPLATE_LIST_TEST_CASE("Mirroring StridedMemory works",
+                        "[tensor][strided_memory]",
+                        AllDevPairsList)
+{
+  constexpr Device SrcDev = meta::tlist::At<TestType, 0>::value;
+  constexpr Device DstDev = meta::tlist::At<TestType, 1>::value;
+  using MemType = StridedMemory<DataType>;
+
+  ComputeStream src_stream{SrcDev};
+  ComputeStream dst_stream{DstDev};
+  MemType mem(SrcDev, {3, 5}, false, src_stream);
+  for (std::size_t i = 0; i < 15; ++i)
+  {
+    write_ele<SrcDev>(mem.data(), i, static_cast<DataType>(i), src_stream);
+  }
+  MemType mem_view(mem, {IRng(1, 3), ALL});
+
+  MemType mirror = mem_view.mirror(DstDev, dst_stream);
+  REQUIRE(mirror.get_device() == DstDev);
+  REQUIRE(mirror.get_stream() == dst_stream);
+  REQUIRE(mirror.shape() == mem_view.shape());
+  REQUIRE(mirror.strides() == mem_view.strides());
+  REQUIRE(mirror.const_data() != mem_view.const_data());
+  for (DimType j = 0; j < 5; ++j)
+  {
+    for (DimType i = 0; i < 2; ++i)
+    {
+      REQUIRE(read_ele<DstDev>(mirror.const_get({i, j}), dst_stream)
+              == static_cast<DataType>(i + 1 + j * 3));
+    }
+  }
+
+  SECTION("Mirrors are reused until modified")
+  {
+    // Any view of the same memory gets the same mirror.
+    MemType mirror2 = mem.mirror(DstDev, dst_stream);
+    REQUIRE(mirror2.const_data() + 1 == mirror.const_data());
+    write_ele<SrcDev>(mem.data(), 1, DataType{-1}, src_stream);
+    MemType mirror3 = mem.mirror(DstDev, dst_stream);
+    REQUIRE(mirror3.const_data() != mirror2.const_data());
+    REQUIRE(read_ele<DstDev>(mirror3.const_data(), 1, dst_stream) == -1);
+  }
+  SECTION("Modifying a mirror invalidates it")
+  {
+    write_ele<DstDev>(mirror.data(), 0, DataType{-1}, dst_stream);
+    MemType mirror2 = mem_view.mirror(DstDev, dst_stream);
+    REQUIRE(mirror2.const_data() != mirror.const_data());
+    REQUIRE(read_ele<DstDev>(mirror2.const_data(), 0, dst_stream) == 1);
+  }
+}
+
 TEMPLATE_LIST_TEST_CASE("StridedMemory get works",
                         "[tensor][strided_memory]",
                         AllDevList)
@@ -364,6 +364,137 @@ TEMPLATE_LIST_TEST_CASE("Lazy and strict tensors are sane",
   REQUIRE(TensorType(Dev, {4, 6}, {DT::Sample, DT::Any}, LazyAlloc).is_lazy());
 }
 
+TEST_CASE("Pinned CPU tensors are sane", "[tensor]")
+{
+  using TensorType = Tensor<DataType>;
+
+  REQUIRE(TensorType(Device::CPU).get_memory_kind() == MemoryKind::Default);
+
+  TensorType tensor(Device::CPU,
+                    {4, 6},
+                    {DT::Sample, DT::Any},
+                    StrictAlloc,
+                    std::nullopt,
+                    MemoryKind::Pinned);
+  REQUIRE(tensor.get_memory_kind() == MemoryKind::Pinned);
+  REQUIRE(tensor.data() != nullptr);
+  for (DataIndexType i = 0; i < tensor.numel(); ++i)
+  {
+    tensor.data()[i] = static_cast<DataType>(i);
+  }
+
+  SECTION("Views and clones keep the memory kind")
+  {
+    auto view = tensor.view({ALL, IRng(1, 3)});
+    REQUIRE(view->get_memory_kind() == MemoryKind::Pinned);
+    auto clone = tensor.clone();
+    REQUIRE(clone->get_memory_kind() == MemoryKind::Pinned);
+    REQUIRE(clone->const_data()[5] == static_cast<DataType>(5));
+  }
+  SECTION("Resizing keeps the memory kind")
+  {
+    tensor.resize({8, 8});
+    REQUIRE(tensor.get_memory_kind() == MemoryKind::Pinned);
+    REQUIRE(tensor.data() != nullptr);
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Asynchronously ensuring tensors works",
+                        "[tensor]",
+                        AllDevList)
+{
+  using TensorType = Tensor<DataType>;
+  constexpr Device Dev = TestType::value;
+
+  ComputeStream side_stream = create_new_compute_stream<Dev>();
+  TensorType tensor(Dev, {4, 6}, {DT::Sample, DT::Any}, LazyAlloc);
+  REQUIRE(tensor.const_data() == nullptr);
+  tensor.ensure_async(side_stream);
+  REQUIRE(tensor.data() != nullptr);
+
+  for (DataIndexType i = 0; i < tensor.numel(); ++i)
+  {
+    write_ele<Dev>(
+      tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+  }
+  REQUIRE(read_ele<Dev>(tensor.data(), 5, tensor.get_stream()) == 5);
+
+  SECTION("Ensuring again does not reallocate")
+  {
+    DataType* buf = tensor.data();
+    tensor.ensure_async(side_stream);
+    REQUIRE(tensor.data() == buf);
+  }
+  SECTION("Released memory can be recovered from views")
+  {
+    auto view = tensor.view();
+    DataType* buf = tensor.data();
+    tensor.release();
+    REQUIRE(tensor.const_data() == nullptr);
+    tensor.ensure_async(side_stream);
+    REQUIRE(tensor.data() == buf);
+  }
+  SECTION("Empty tensors are fine")
+  {
+    TensorType empty_tensor(Dev, LazyAlloc);
+    REQUIRE_NOTHROW(empty_tensor.ensure_async(side_stream));
+    REQUIRE(empty_tensor.const_data() == nullptr);
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Prefetching non-managed tensors does nothing",
+                        "[tensor]",
+                        AllDevList)
+{
+  using TensorType = Tensor<DataType>;
+  constexpr Device Dev = TestType::value;
+
+  TensorType tensor(Dev, {4, 6}, {DT::Sample, DT::Any});
+  TensorType lazy(Dev, {4, 6}, {DT::Sample, DT::Any}, LazyAlloc);
+  REQUIRE_NOTHROW(tensor.prefetch(Dev));
+  REQUIRE_NOTHROW(tensor.advise(ManagedAdvice::ReadMostly, Dev));
+  REQUIRE_NOTHROW(lazy.prefetch(Dev));
+}
+
+#ifdef H2_HAS_GPU
+TEST_CASE("Managed GPU tensors are sane", "[tensor]")
+{
+  using TensorType = Tensor<DataType>;
+
+  TensorType tensor(Device::GPU,
+                    {4, 6},
+                    {DT::Sample, DT::Any},
+                    StrictAlloc,
+                    std::nullopt,
+                    MemoryKind::Managed);
+  REQUIRE(tensor.get_memory_kind() == MemoryKind::Managed);
+  REQUIRE(tensor.data() != nullptr);
+  REQUIRE_NOTHROW(
+    tensor.advise(ManagedAdvice::PreferredLocation, Device::GPU));
+
+  // Managed memory may be written directly from the host.
+  tensor.prefetch(Device::CPU);
+  tensor.get_stream().wait_for_this();
+  for (DataIndexType i = 0; i < tensor.numel(); ++i)
+  {
+    tensor.data()[i] = static_cast<DataType>(i);
+  }
+  tensor.prefetch(Device::GPU);
+  REQUIRE(read_ele<Device::GPU>(tensor.data(), 5, tensor.get_stream())
+          == static_cast<DataType>(5));
+
+  SECTION("Views and clones keep the memory kind")
+  {
+    auto view = tensor.view({ALL, IRng(1, 3)});
+    REQUIRE(view->get_memory_kind() == MemoryKind::Managed);
+    auto clone = tensor.clone();
+    REQUIRE(clone->get_memory_kind() == MemoryKind::Managed);
+    REQUIRE(read_ele<Device::GPU>(clone->const_data(), 5, clone->get_stream())
+            == static_cast<DataType>(5));
+  }
+}
+#endif  // H2_HAS_GPU
+
 TEMPLATE_LIST_TEST_CASE("Resizing tensors works", "[tensor]", AllDevList)
 {
   constexpr Device Dev = TestType::value;
@@ -439,6 +570,86 @@ TEMPLATE_LIST_TEST_CASE("Resizing tensors works", "[tensor]", AllDevList)
   }
 }
 
+TEMPLATE_LIST_TEST_CASE("Resizing tensors reuses memory",
+                        "[tensor]",
+                        AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+
+  TensorType tensor = TensorType(Dev, {4, 6}, {DT::Sample, DT::Any});
+  DataType* orig_data = tensor.data();
+  REQUIRE(tensor.capacity() == 4 * 6);
+
+  SECTION("Shrinking and regrowing keeps the allocation")
+  {
+    tensor.resize({3, 6});
+    REQUIRE(tensor.shape() == ShapeTuple{3, 6});
+    REQUIRE(tensor.strides() == StrideTuple{1, 3});
+    REQUIRE(tensor.data() == orig_data);
+    REQUIRE(tensor.capacity() == 4 * 6);
+
+    tensor.resize({2, 2, 6}, {DT::Sample, DT::Any, DT::Any});
+    REQUIRE(tensor.data() == orig_data);
+    tensor.resize({4, 6}, {DT::Sample, DT::Any});
+    REQUIRE(tensor.data() == orig_data);
+    tensor.resize({4, 6}, {DT::Sample, DT::Any}, {1, 4});
+    REQUIRE(tensor.data() == orig_data);
+
+    // Growing past the capacity reallocates.
+    tensor.resize({5, 6});
+    REQUIRE(tensor.capacity() == 5 * 6);
+    REQUIRE(tensor.numel() == 5 * 6);
+  }
+
+  SECTION("Memory shared with views is not reused")
+  {
+    write_ele<Dev>(tensor.data(), 0, DataType{42}, tensor.get_stream());
+    auto view = tensor.view();
+    tensor.resize({2, 6});
+    REQUIRE(tensor.data() != orig_data);
+    REQUIRE(view->const_data() == orig_data);
+    REQUIRE(read_ele<Dev>(view->const_data(), tensor.get_stream()) == 42);
+  }
+
+  SECTION("Shrinking to fit reallocates and keeps contents")
+  {
+    tensor.resize({2, 3});
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      write_ele<Dev>(
+        tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+    }
+    tensor.shrink_to_fit();
+    REQUIRE(tensor.capacity() == 2 * 3);
+    REQUIRE(tensor.shape() == ShapeTuple{2, 3});
+    REQUIRE(tensor.strides() == StrideTuple{1, 2});
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      REQUIRE(read_ele<Dev>(tensor.const_data(), i, tensor.get_stream())
+              == static_cast<DataType>(i));
+    }
+    DataType* shrunk_data = tensor.data();
+    tensor.shrink_to_fit();
+    REQUIRE(tensor.data() == shrunk_data);
+  }
+
+  SECTION("Lazy tensors allocate their new size")
+  {
+    TensorType lazy(Dev, {4, 6}, {DT::Sample, DT::Any}, LazyAlloc);
+    REQUIRE(lazy.capacity() == 0);
+    lazy.resize({2, 3});
+    lazy.ensure();
+    REQUIRE(lazy.capacity() == 2 * 3);
+  }
+
+  SECTION("Views cannot be shrunk")
+  {
+    auto view = tensor.view();
+    REQUIRE_THROWS(view->shrink_to_fit());
+  }
+}
+
 TEMPLATE_LIST_TEST_CASE("Writing to tensors works", "[tensor]", AllDevList)
 {
   constexpr Device Dev = TestType::value;
@@ -503,6 +714,57 @@ TEMPLATE_LIST_TEST_CASE("Attaching tensors to existing buffers works",
   }
 }
 
+TEMPLATE_LIST_TEST_CASE("Re-wrapping tensors works", "[tensor]", AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+  constexpr std::size_t buf_size = 4 * 6;
+
+  DeviceBuf<DataType, Dev> buf1(buf_size);
+  DeviceBuf<DataType, Dev> buf2(buf_size);
+  for (std::size_t i = 0; i < buf_size; ++i)
+  {
+    write_ele<Dev>(buf1.buf, i, static_cast<DataType>(i), ComputeStream{Dev});
+    write_ele<Dev>(
+      buf2.buf, i, static_cast<DataType>(2 * i), ComputeStream{Dev});
+  }
+
+  TensorType tensor = TensorType(
+    Dev, buf1.buf, {4, 6}, {DT::Sample, DT::Any}, {1, 4}, ComputeStream{Dev});
+  REQUIRE(tensor.data() == buf1.buf);
+
+  tensor.wrap(
+    Dev, buf2.buf, {6, 4}, {DT::Any, DT::Any}, {1, 6}, ComputeStream{Dev});
+  REQUIRE(tensor.data() == buf2.buf);
+  REQUIRE(tensor.shape() == ShapeTuple{6, 4});
+  REQUIRE(tensor.dim_types() == DTTuple{DT::Any, DT::Any});
+  REQUIRE(tensor.strides() == StrideTuple{1, 6});
+  REQUIRE(tensor.numel() == buf_size);
+  REQUIRE(tensor.get_view_type() == ViewType::Mutable);
+  for (DataIndexType i = 0; i < tensor.numel(); ++i)
+  {
+    REQUIRE(read_ele<Dev>(tensor.data(), i, tensor.get_stream()) == 2 * i);
+  }
+
+  // Wrapping while a view shares the memory leaves the view alone.
+  auto view = tensor.view();
+  tensor.wrap(Dev,
+              const_cast<DataType const*>(buf1.buf),
+              {buf_size},
+              {DT::Any},
+              {1},
+              ComputeStream{Dev});
+  REQUIRE(tensor.const_data() == buf1.buf);
+  REQUIRE(tensor.shape() == ShapeTuple{buf_size});
+  REQUIRE(tensor.get_view_type() == ViewType::Const);
+  REQUIRE(view->data() == buf2.buf);
+  REQUIRE(view->shape() == ShapeTuple{6, 4});
+  for (DataIndexType i = 0; i < tensor.numel(); ++i)
+  {
+    REQUIRE(read_ele<Dev>(tensor.const_data(), i, tensor.get_stream()) == i);
+  }
+}
+
 TEMPLATE_LIST_TEST_CASE("Viewing tensors works", "[tensor]", AllDevList)
 {
   constexpr Device Dev = TestType::value;
@@ -867,9 +1129,8 @@ TEMPLATE_LIST_TEST_CASE("Empty views work", "[tensor]", AllDevList)
   }
 }
 
-// contiguous is not yet implemented.
 TEMPLATE_LIST_TEST_CASE("Making tensors contiguous works",
-                        "[tensor][!mayfail]",
+                        "[tensor]",
                         AllDevList)
 {
   constexpr Device Dev = TestType::value;
@@ -891,7 +1152,7 @@ TEMPLATE_LIST_TEST_CASE("Making tensors contiguous works",
   }
   SECTION("Making non-contiguous tensors contiguous work")
   {
-    std::unique_ptr<TensorType> view = tensor.view({IRng(1, 2), ALL});
+    std::unique_ptr<TensorType> view = tensor.view({IRng(1), ALL});
     REQUIRE_FALSE(view->is_contiguous());
 
     std::unique_ptr<TensorType> contig = view->contiguous();
@@ -907,6 +1168,98 @@ TEMPLATE_LIST_TEST_CASE("Making tensors contiguous works",
   }
 }
 
+TEMPLATE_LIST_TEST_CASE("Permuting tensors works", "[tensor]", AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+
+  // Large enough to span several tiles with partial edge tiles.
+  TensorType tensor =
+    TensorType(Dev, {37, 5, 41}, {DT::Channel, DT::Spatial, DT::Sample});
+  for (DataIndexType i = 0; i < tensor.numel(); ++i)
+  {
+    write_ele<Dev>(
+      tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+  }
+  DimensionOrderTuple const order{2, 0, 1};
+  ShapeTuple const permuted_shape{41, 37, 5};
+  DimensionTypeTuple const permuted_dim_types{
+    DT::Sample, DT::Channel, DT::Spatial};
+  auto const check = [&](TensorType const& permuted) {
+    for_ndim(permuted.shape(), [&](ScalarIndexTuple const& idx) {
+      ScalarIndexTuple const orig_idx{idx[1], idx[2], idx[0]};
+      REQUIRE(read_ele<Dev>(permuted.get(idx), permuted.get_stream())
+              == read_ele<Dev>(tensor.get(orig_idx), tensor.get_stream()));
+    });
+  };
+
+  SECTION("Permuting into a new tensor works")
+  {
+    std::unique_ptr<TensorType> permuted = tensor.permute(order);
+    REQUIRE_FALSE(permuted->is_view());
+    REQUIRE(permuted->is_contiguous());
+    REQUIRE(permuted->shape() == permuted_shape);
+    REQUIRE(permuted->dim_types() == permuted_dim_types);
+    REQUIRE(permuted->const_data() != tensor.const_data());
+    check(*permuted);
+  }
+  SECTION("Permuting a view works")
+  {
+    std::unique_ptr<TensorType> view = tensor.view({IRng(1, 36), ALL, ALL});
+    std::unique_ptr<TensorType> permuted = view->permute(order);
+    REQUIRE(permuted->is_contiguous());
+    REQUIRE(permuted->shape() == ShapeTuple{41, 35, 5});
+    for_ndim(permuted->shape(), [&](ScalarIndexTuple const& idx) {
+      REQUIRE(read_ele<Dev>(permuted->get(idx), permuted->get_stream())
+              == read_ele<Dev>(tensor.get({idx[1] + 1, idx[2], idx[0]}),
+                               tensor.get_stream()));
+    });
+  }
+  SECTION("Permuted views work")
+  {
+    std::unique_ptr<TensorType> view = tensor.permute_view(order);
+    REQUIRE(view->is_view());
+    REQUIRE(view->get_view_type() == ViewType::Mutable);
+    REQUIRE_FALSE(view->is_contiguous());
+    REQUIRE(view->shape() == permuted_shape);
+    REQUIRE(view->dim_types() == permuted_dim_types);
+    REQUIRE(view->strides() == StrideTuple{37 * 5, 1, 37});
+    REQUIRE(view->data() == tensor.data());
+    check(*view);
+
+    std::unique_ptr<TensorType> contig = view->contiguous();
+    REQUIRE(contig->is_contiguous());
+    check(*contig);
+  }
+  SECTION("Constant permuted views work")
+  {
+    TensorType const& const_tensor = tensor;
+    std::unique_ptr<TensorType> view = const_tensor.permute_view(order);
+    REQUIRE(view->get_view_type() == ViewType::Const);
+    REQUIRE(view->const_data() == tensor.const_data());
+    check(*view);
+  }
+  SECTION("Identity permutations work")
+  {
+    std::unique_ptr<TensorType> view = tensor.permute_view({0, 1, 2});
+    REQUIRE(view->is_contiguous());
+    REQUIRE(view->shape() == tensor.shape());
+    std::unique_ptr<TensorType> permuted = tensor.permute({0, 1, 2});
+    REQUIRE(permuted->shape() == tensor.shape());
+    for (DataIndexType i = 0; i < tensor.numel(); ++i)
+    {
+      REQUIRE(read_ele<Dev>(permuted->const_data(), i, permuted->get_stream())
+              == static_cast<DataType>(i));
+    }
+  }
+  SECTION("Invalid permutations are rejected")
+  {
+    REQUIRE_THROWS(tensor.permute({0, 1}));
+    REQUIRE_THROWS(tensor.permute_view({0, 1, 1}));
+    REQUIRE_THROWS(tensor.permute_view({0, 1, 3}));
+  }
+}
+
 TEMPLATE_LIST_TEST_CASE("Cloning tensors works", "[tensor]", AllDevList)
 {
   constexpr Device Dev = TestType::value;
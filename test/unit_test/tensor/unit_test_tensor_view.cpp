@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/tensor/tensor_view.hpp"
+#include "utils.hpp"
+
+#include <catch2/catch_template_test_macros.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <type_traits>
+
+using namespace h2;
+
+TEMPLATE_LIST_TEST_CASE("Tensor views work", "[tensor]", AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+  using ViewT = TensorView<DataType>;
+
+  TensorType tensor = TensorType(Dev, {4, 6}, {DT::Sample, DT::Any});
+  for (DataIndexType i = 0; i < tensor.numel(); ++i)
+  {
+    write_ele<Dev>(
+      tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+  }
+
+  SECTION("Viewing an entire tensor works")
+  {
+    ViewT view = make_tensor_view(tensor);
+    REQUIRE(view.shape() == ShapeTuple{4, 6});
+    REQUIRE(view.strides() == StrideTuple{1, 4});
+    REQUIRE(view.ndim() == 2);
+    REQUIRE(view.numel() == tensor.numel());
+    REQUIRE(view.data() == tensor.data());
+    REQUIRE(view.get_device() == Dev);
+    REQUIRE(view.get_stream() == tensor.get_stream());
+    REQUIRE(view.is_contiguous());
+    REQUIRE_FALSE(view.is_empty());
+  }
+  SECTION("Constant views work")
+  {
+    TensorType const& const_tensor = tensor;
+    auto view = make_tensor_view(const_tensor);
+    static_assert(
+      std::is_same_v<decltype(view), TensorView<DataType const>>);
+    REQUIRE(view.data() == tensor.const_data());
+    TensorView<DataType const> converted = make_tensor_view(tensor);
+    REQUIRE(converted.data() == tensor.const_data());
+    REQUIRE(converted.shape() == tensor.shape());
+  }
+  SECTION("Slicing matches tensor views")
+  {
+    ViewT view = make_tensor_view(tensor);
+    for (IndexRangeTuple const& coords :
+         {IndexRangeTuple{IRng(1), ALL},
+          IndexRangeTuple{ALL, IRng(1, 3)},
+          IndexRangeTuple{IRng(1, 3), ALL},
+          IndexRangeTuple{IRng(1, 2), IRng(0, 1)},
+          IndexRangeTuple{IRng(1), IRng(2)}})
+    {
+      std::unique_ptr<TensorType> tensor_view = tensor.view(coords);
+      ViewT sub = view(coords);
+      REQUIRE(sub.shape() == tensor_view->shape());
+      REQUIRE(sub.strides() == tensor_view->strides());
+      REQUIRE(sub.data() == tensor_view->data());
+      REQUIRE(sub.is_contiguous() == tensor_view->is_contiguous());
+    }
+  }
+  SECTION("Slicing views repeatedly works")
+  {
+    ViewT view = make_tensor_view(tensor);
+    for (DimType j = 0; j < 6; ++j)
+    {
+      ViewT column = view({ALL, IRng(j)});
+      REQUIRE(column.shape() == ShapeTuple{4});
+      ViewT part = column({IRng(1, 3)});
+      REQUIRE(part.shape() == ShapeTuple{2});
+      for (DimType i = 0; i < part.shape(0); ++i)
+      {
+        REQUIRE(read_ele<Dev>(part.get({i}), part.get_stream())
+                == (i + 1 + j * 4));
+      }
+      ViewT element = part.view({IRng(1)});
+      REQUIRE(element.shape() == ShapeTuple{1});
+      REQUIRE(read_ele<Dev>(element.data(), element.get_stream())
+              == (2 + j * 4));
+    }
+  }
+  SECTION("Empty slices work")
+  {
+    ViewT view = make_tensor_view(tensor);
+    ViewT empty = view({IRng(), ALL});
+    REQUIRE(empty.is_empty());
+    REQUIRE(empty.numel() == 0);
+    REQUIRE(empty.ndim() == 0);
+    REQUIRE(empty.data() == nullptr);
+  }
+  SECTION("Permuting views works")
+  {
+    ViewT view = make_tensor_view(tensor).permute({1, 0});
+    REQUIRE(view.shape() == ShapeTuple{6, 4});
+    REQUIRE(view.strides() == StrideTuple{4, 1});
+    REQUIRE_FALSE(view.is_contiguous());
+    for (DimType j = 0; j < view.shape(1); ++j)
+    {
+      for (DimType i = 0; i < view.shape(0); ++i)
+      {
+        REQUIRE(read_ele<Dev>(view.get({i, j}), view.get_stream())
+                == (j + i * 4));
+      }
+    }
+  }
+  SECTION("Writing through views works")
+  {
+    ViewT view = make_tensor_view(tensor)({IRng(2), ALL});
+    for (DimType i = 0; i < view.shape(0); ++i)
+    {
+      write_ele<Dev>(view.get({i}), 0, DataType{-1}, view.get_stream());
+    }
+    for (DimType j = 0; j < tensor.shape(1); ++j)
+    {
+      REQUIRE(read_ele<Dev>(tensor.get({2, j}), tensor.get_stream()) == -1);
+    }
+  }
+}
+
+TEMPLATE_LIST_TEST_CASE("Ranked tensor views work", "[tensor]", AllDevList)
+{
+  constexpr Device Dev = TestType::value;
+  using TensorType = Tensor<DataType>;
+
+  TensorType tensor = TensorType(Dev, {4, 3, 2}, {DT::Any, DT::Any, DT::Any});
+  for (DataIndexType i = 0; i < tensor.numel(); ++i)
+  {
+    write_ele<Dev>(
+      tensor.data(), i, static_cast<DataType>(i), tensor.get_stream());
+  }
+  TensorView<DataType> view = make_tensor_view(tensor);
+
+  SECTION("Ranked views match dynamic views")
+  {
+    TensorView<DataType, 3> ranked(view);
+    static_assert(TensorView<DataType, 3>::ndim() == 3);
+    REQUIRE(ranked.shape() == std::array<DimType, 3>{4, 3, 2});
+    REQUIRE(ranked.strides() == std::array<DataIndexType, 3>{1, 4, 12});
+    REQUIRE(ranked.numel() == view.numel());
+    REQUIRE(ranked.is_contiguous());
+    REQUIRE_FALSE(ranked.is_empty());
+    REQUIRE(ranked.data() == view.data());
+    REQUIRE(ranked.get_device() == Dev);
+    REQUIRE(ranked.get_stream() == view.get_stream());
+    for (DimType k = 0; k < 2; ++k)
+    {
+      for (DimType j = 0; j < 3; ++j)
+      {
+        for (DimType i = 0; i < 4; ++i)
+        {
+          REQUIRE(ranked.get(i, j, k) == view.get({i, j, k}));
+          REQUIRE(ranked.get({i, j, k}) == view.get({i, j, k}));
+        }
+      }
+    }
+    for (DataIndexType i = 0; i < ranked.numel(); ++i)
+    {
+      REQUIRE(ranked.get_linear(i) == view.data() + i);
+    }
+
+    TensorView<DataType> dynamic = ranked.as_dynamic();
+    REQUIRE(dynamic.shape() == view.shape());
+    REQUIRE(dynamic.strides() == view.strides());
+    REQUIRE(dynamic.data() == view.data());
+
+    TensorView<DataType const, 3> const_ranked = ranked;
+    REQUIRE(const_ranked.data() == ranked.data());
+  }
+  SECTION("Ranked views of strided views work")
+  {
+    TensorView<DataType, 2> ranked(view.permute({2, 0, 1})({ALL, IRng(1, 3), IRng(0)}));
+    REQUIRE(ranked.shape() == std::array<DimType, 2>{2, 2});
+    REQUIRE_FALSE(ranked.is_contiguous());
+    for (DataIndexType i = 0; i < ranked.numel(); ++i)
+    {
+      DimType const i0 = static_cast<DimType>(i % 2);
+      DimType const i1 = static_cast<DimType>(i / 2);
+      REQUIRE(ranked.get_linear(i) == ranked.get(i0, i1));
+      REQUIRE(read_ele<Dev>(ranked.get_linear(i), ranked.get_stream())
+              == 1 + i1 + 12 * i0);
+    }
+  }
+  SECTION("Dispatching to ranked views works")
+  {
+    for (std::size_t ndim = 1; ndim <= MAX_TENSOR_DIMS; ++ndim)
+    {
+      TensorView<DataType> v(view.data(),
+                             ShapeTuple(TuplePad<ShapeTuple>(ndim, 1)),
+                             StrideTuple(TuplePad<StrideTuple>(ndim, 1)),
+                             Dev,
+                             view.get_stream());
+      std::size_t const rank = dispatch_ranked_view(v, [](auto ranked) {
+        REQUIRE(ranked.numel() == 1);
+        return static_cast<std::size_t>(ranked.ndim());
+      });
+      REQUIRE(rank == ndim);
+    }
+    bool const was_ranked = dispatch_ranked_view(view, [](auto ranked) {
+      return !std::is_same_v<decltype(ranked), TensorView<DataType>>;
+    });
+    REQUIRE(was_ranked);
+  }
+}
@@ -9,7 +9,9 @@
 
 #include <stdlib.h>
 
+#include <thread>
 #include <tuple>
+#include <vector>
 
 #include <catch2/catch_test_macros.hpp>
 
@@ -73,3 +75,53 @@ TEST_CASE("H2 env vars work", "[utilities][environment_vars]")
   REQUIRE(env::get_raw(h2_env2) == "1");
   REQUIRE(env::get<int>(h2_env2) == 1);
 }
+
+TEST_CASE("H2 env vars can be reloaded", "[utilities][environment_vars]")
+{
+  std::string const h2_env = "TEST_VAR1";
+  // Start from (and leave behind) values that match the environment.
+  env::reload();
+
+  REQUIRE(env::get_raw(h2_env) == "0");
+  {
+    RAIIEnvVar env_manager("H2_" + h2_env, "5");
+    // Cached until reloaded.
+    REQUIRE_FALSE(env::exists(h2_env));
+    std::string const& old_value = env::get_raw(h2_env);
+    env::reload();
+    REQUIRE(env::exists(h2_env));
+    REQUIRE(env::get<int>(h2_env) == 5);
+    // Earlier values remain valid.
+    REQUIRE(old_value == "0");
+  }
+  env::reload();
+  REQUIRE_FALSE(env::exists(h2_env));
+  REQUIRE(env::get<int>(h2_env) == 0);
+}
+
+TEST_CASE("Unregistered H2 env vars are rejected",
+          "[utilities][environment_vars]")
+{
+  REQUIRE(env::is_registered("TEST_VAR1"));
+  REQUIRE_FALSE(env::is_registered("NOT_A_REAL_VAR"));
+  REQUIRE_THROWS(env::get_raw("NOT_A_REAL_VAR"));
+  REQUIRE_THROWS(env::exists("NOT_A_REAL_VAR"));
+}
+
+TEST_CASE("H2 env vars can be read concurrently",
+          "[utilities][environment_vars]")
+{
+  env::reload();
+  std::vector<std::thread> threads;
+  std::vector<int> values(8, -1);
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    threads.emplace_back(
+      [&values, i]() { values[i] = env::get<int>("TEST_VAR1"); });
+  }
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+  REQUIRE(values == std::vector<int>(8, 0));
+}
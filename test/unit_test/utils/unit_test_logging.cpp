@@ -9,10 +9,12 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <sstream>
 
 #include "../src/utils/logger_internals.hpp"
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers.hpp>
+#include <spdlog/sinks/ostream_sink.h>
 
 TEST_CASE("Testing the internal functions used by the logging class",
           "[logging][utilities]")
@@ -264,4 +266,52 @@ TEST_CASE("Testing the internal functions used by the logging class",
     CHECK(m.at("io") == LogLevelType::WARN);
     CHECK(m.at("training") == LogLevelType::DEBUG);
   }
+
+  SECTION("Select ranks")
+  {
+    CHECK(h2_internal::is_rank_selected("all", 7));
+    CHECK(h2_internal::is_rank_selected("", 7));
+    CHECK_FALSE(h2_internal::is_rank_selected("none", 7));
+    CHECK(h2_internal::is_rank_selected("none", -1));
+
+    CHECK(h2_internal::is_rank_selected("0,7", 7));
+    CHECK_FALSE(h2_internal::is_rank_selected("0,7", 3));
+    CHECK(h2_internal::is_rank_selected("2-4", 3));
+    CHECK_FALSE(h2_internal::is_rank_selected("2-4", 5));
+    CHECK(h2_internal::is_rank_selected("10-", 1000));
+    CHECK(h2_internal::is_rank_selected("0-:100", 300));
+    CHECK_FALSE(h2_internal::is_rank_selected("0-:100", 301));
+    CHECK(h2_internal::is_rank_selected("1-9:4, 20", 5));
+    CHECK(h2_internal::is_rank_selected("1-9:4, 20", 20));
+    CHECK_FALSE(h2_internal::is_rank_selected("1-9:4, 20", 13));
+
+    CHECK_THROWS_WITH(h2_internal::is_rank_selected("4-2", 3),
+                      "Invalid log ranks: 4-2");
+    CHECK_THROWS_WITH(h2_internal::is_rank_selected("0-8:0", 3),
+                      "Invalid log ranks: 0-8:0");
+    CHECK_THROWS_WITH(h2_internal::is_rank_selected("one", 1),
+                      "Invalid log ranks: one");
+  }
+}
+
+TEST_CASE("Rate-limited sinks drop excess messages", "[logging][utilities]")
+{
+  std::ostringstream out;
+  auto const ostream_sink =
+    std::make_shared<spdlog::sinks::ostream_sink_mt>(out);
+  auto const sink =
+    std::make_shared<h2_internal::RateLimitedSink>(ostream_sink, 3);
+  sink->set_pattern("%v");
+  spdlog::logger logger("rate_limit_test", sink);
+  logger.set_level(spdlog::level::trace);
+
+  for (int i = 0; i < 10; ++i)
+    logger.info("message {}", i);
+  logger.flush();
+
+  std::string const text = out.str();
+  CHECK(text.find("message 2") != std::string::npos);
+  CHECK(text.find("message 3") == std::string::npos);
+  CHECK(sink->num_dropped() == 7);
+  CHECK(text.find("Dropped 7 messages") != std::string::npos);
 }
@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/utils/lru_cache.hpp"
+
+#include <string>
+
+#include <catch2/catch_test_macros.hpp>
+
+using namespace h2;
+
+TEST_CASE("LRU caches work", "[utilities]")
+{
+  LRUCache<int, std::string> cache(2);
+  REQUIRE(cache.capacity() == 2);
+  REQUIRE(cache.size() == 0);
+  REQUIRE(cache.get(1) == nullptr);
+
+  REQUIRE(*cache.insert(1, "one") == "one");
+  REQUIRE(*cache.insert(2, "two") == "two");
+  REQUIRE(cache.size() == 2);
+  REQUIRE(*cache.get(1) == "one");
+  REQUIRE(*cache.get(2) == "two");
+
+  SECTION("Least recently used entries are evicted")
+  {
+    // 1 is now the least recently used.
+    cache.insert(3, "three");
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.get(1) == nullptr);
+    REQUIRE(*cache.get(2) == "two");
+    REQUIRE(*cache.get(3) == "three");
+
+    // Using 2 makes 3 the least recently used.
+    cache.get(2);
+    cache.insert(4, "four");
+    REQUIRE(cache.get(3) == nullptr);
+    REQUIRE(*cache.get(2) == "two");
+  }
+  SECTION("Replacing entries works")
+  {
+    cache.insert(1, "uno");
+    REQUIRE(cache.size() == 2);
+    REQUIRE(*cache.get(1) == "uno");
+  }
+  SECTION("Shrinking evicts entries")
+  {
+    cache.get(1);
+    cache.set_capacity(1);
+    REQUIRE(cache.size() == 1);
+    REQUIRE(*cache.get(1) == "one");
+    REQUIRE(cache.get(2) == nullptr);
+  }
+  SECTION("Zero capacity disables caching")
+  {
+    cache.set_capacity(0);
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.insert(5, "five") == nullptr);
+    REQUIRE(cache.get(5) == nullptr);
+  }
+  SECTION("Clearing works")
+  {
+    cache.clear();
+    REQUIRE(cache.size() == 0);
+    REQUIRE(cache.get(1) == nullptr);
+  }
+}
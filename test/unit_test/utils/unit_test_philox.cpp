@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////////////////
+// Copyright 2019-2024 Lawrence Livermore National Security, LLC and other
+// DiHydrogen Project Developers. See the top-level LICENSE file for details.
+//
+// SPDX-License-Identifier: Apache-2.0
+////////////////////////////////////////////////////////////////////////////////
+
+#include "h2/utils/philox.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+
+using namespace h2;
+
+namespace
+{
+
+bool is_same_block(Philox4x32Block const& x, Philox4x32Block const& y)
+{
+  return x.v[0] == y.v[0] && x.v[1] == y.v[1] && x.v[2] == y.v[2]
+         && x.v[3] == y.v[3];
+}
+
+}  // anonymous namespace
+
+TEST_CASE("Philox4x32-10 matches known answers", "[utilities][philox]")
+{
+  // Known-answer tests from the Random123 distribution.
+  REQUIRE(is_same_block(
+    philox4x32_10(Philox4x32Block{{0, 0, 0, 0}}, 0),
+    Philox4x32Block{{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}}));
+  REQUIRE(is_same_block(
+    philox4x32_10(
+      Philox4x32Block{{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}},
+      0xffffffffffffffff),
+    Philox4x32Block{{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}}));
+  REQUIRE(is_same_block(
+    philox4x32_10(
+      Philox4x32Block{{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}},
+      0x299f31d0a4093822),
+    Philox4x32Block{{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}}));
+}
+
+TEST_CASE("Philox4x32-10 64-bit counters work", "[utilities][philox]")
+{
+  std::uint64_t const ctr = 0x0123456789abcdef;
+  REQUIRE(is_same_block(
+    philox4x32_10(ctr, 42, 7),
+    philox4x32_10(Philox4x32Block{{0x89abcdef, 0x01234567, 7, 0}}, 42)));
+  REQUIRE_FALSE(
+    is_same_block(philox4x32_10(ctr, 42), philox4x32_10(ctr + 1, 42)));
+  REQUIRE_FALSE(
+    is_same_block(philox4x32_10(ctr, 42), philox4x32_10(ctr, 43)));
+  REQUIRE_FALSE(
+    is_same_block(philox4x32_10(ctr, 42, 0), philox4x32_10(ctr, 42, 1)));
+}